@@ -16,6 +16,12 @@ void NanoApp::setup()
 {
    gui = std::make_shared<View>();
    gui->create (getWindow());
+   // The whole app drops to a few frames per second after ten seconds without input or GUI activity
+   gui->setIdleThrottle (10.0);
+   gui->setIdleCallback ([this] (bool idle)
+   {
+      setFrameRate (idle ? 4.0f : 30.0f);
+   });
 }
 
 void NanoApp::update()
@@ -0,0 +1,481 @@
+// Headless benchmark for nanogui widget rendering
+// Copyright (c) 2015, HurleyWorks
+
+// Builds synthetic UIs in a hidden window, renders each for a fixed number of frames and writes
+// CPU time, GPU time, draw call counts and per frame upload sizes to a JSON file.
+//
+// usage: BenchmarkApp [--out nanogui_benchmark.json] [--frames 300] [--warmup 30]
+//                     [--replay session.ngir [--replay-scenario windows_1x10] [--replay-speed max|recorded]]
+//                     [--capture frame.nvgc]
+//
+// With --replay, the input recorded by nanogui::InputRecorder is fed into one of the scenarios after
+// the others have run, one recorded frame per frame or at the recorded pace, and the frames drawn
+// until the recording ends are measured as scenario "replay_<name>".
+//
+// The flush_<n> scenarios draw n rectangles straight through NanoVG and measure nvgEndFrame() alone,
+// the cost of handing n calls to GL; MicroBench measures the CPU side of NanoVG without a window.
+//
+// With --capture, the NanoVG frames captured with nvgCaptureFrames() are drawn again in turn, one
+// per frame, as scenario "capture"; CaptureReplay replays them without a window.
+
+#include "cinder/app/App.h"
+#include "cinder/app/RendererGl.h"
+#include "cinder/gl/gl.h"
+
+#include "../gui/nanogui/nanogui.h"
+#include "../gui/util/Performance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ci;
+using namespace ci::app;
+using namespace nanogui;
+
+class BenchmarkScreen : public nanogui::Screen
+{
+   public:
+      BenchmarkScreen()
+      {
+         mTheme = new Theme (mNVGContext);
+      }
+
+      NVGcontext * context() const
+      {
+         return mNVGContext;
+      }
+
+      void clear()
+      {
+         while (childCount() > 0)
+            removeChild (childCount() - 1);
+      }
+};
+
+struct Scenario
+{
+   std::string name;
+   std::function<void (BenchmarkScreen *)> build;
+   bool replay = false;	// fed the recorded input, measured until it ends
+   /* Draws the frame itself instead of the screen, returns the seconds measured and fills the stats */
+   std::function<double (BenchmarkScreen *, NVGframeStats &)> frame;
+};
+
+struct Summary
+{
+   double min, avg, p99;
+};
+
+static Summary summarize (std::vector<double> values)
+{
+   Summary s = { 0.0, 0.0, 0.0 };
+   if (values.empty())
+      return s;
+   std::sort (values.begin(), values.end());
+   double sum = 0.0;
+   for (double v : values)
+      sum += v;
+   s.min = values.front();
+   s.avg = sum / values.size();
+   s.p99 = values[(values.size() - 1) * 99 / 100];
+   return s;
+}
+
+class BenchmarkApp : public App
+{
+   public:
+      void setup() override;
+      void draw() override;
+
+   private:
+      void addScenarios();
+      void beginScenario();
+      void endScenario();
+      void writeResults();
+
+      std::shared_ptr<BenchmarkScreen> mScreen;
+      std::vector<Scenario> mScenarios;
+      std::vector<std::string> mResults;
+      GPUtimer mGpuTimer;
+      int mImage = 0;
+
+      std::string mOutPath = "nanogui_benchmark.json";
+      int mFrames = 300;
+      int mWarmup = 30;
+      std::string mReplayPath, mReplayScenario = "windows_1x10";
+      bool mReplayRecordedSpeed = false;
+      std::unique_ptr<InputReplayer> mReplay;
+      std::chrono::steady_clock::time_point mReplayStart;
+      std::string mCapturePath;
+      NVGreplay * mCapture = nullptr;
+
+      size_t mScenario = 0;
+      int mFrame = 0;
+      std::vector<double> mCpuTimes, mGpuTimes;
+      NVGframeStats mStatsSum;
+};
+
+void BenchmarkApp::setup()
+{
+   const std::vector<std::string> & args = getCommandLineArgs();
+   for (size_t i = 1; i + 1 < args.size(); ++i)
+   {
+      if (args[i] == "--out")
+         mOutPath = args[++i];
+      else
+         if (args[i] == "--frames")
+            mFrames = std::max (1, std::stoi (args[++i]));
+         else
+            if (args[i] == "--warmup")
+               mWarmup = std::max (0, std::stoi (args[++i]));
+            else
+               if (args[i] == "--replay")
+                  mReplayPath = args[++i];
+               else
+                  if (args[i] == "--replay-scenario")
+                     mReplayScenario = args[++i];
+                  else
+                     if (args[i] == "--replay-speed")
+                        mReplayRecordedSpeed = args[++i] == "recorded";
+                     else
+                        if (args[i] == "--capture")
+                           mCapturePath = args[++i];
+   }
+   getWindow()->hide();
+   gl::enableVerticalSync (false);
+   mScreen = std::make_shared<BenchmarkScreen>();
+   mScreen->setSize (Vector2i (getWindowWidth(), getWindowHeight()));
+   std::vector<unsigned char> pixels (64 * 64 * 4);
+   for (size_t i = 0; i < pixels.size(); ++i)
+      pixels[i] = (unsigned char) (i * 7);
+   mImage = nvgCreateImageRGBA (mScreen->context(), 64, 64, 0, pixels.data());
+   addScenarios();
+   if (!mReplayPath.empty())
+   {
+      auto scenario = std::find_if (mScenarios.begin(), mScenarios.end(), [this] (const Scenario & s)
+      {
+         return s.name == mReplayScenario;
+      });
+      try
+      {
+         if (scenario == mScenarios.end())
+            throw std::runtime_error ("no scenario named " + mReplayScenario);
+         mReplay.reset (new InputReplayer (mReplayPath));
+         Scenario replay = *scenario;
+         replay.name = "replay_" + replay.name;
+         replay.replay = true;
+         mScenarios.push_back (replay);
+      }
+      catch (const std::exception & e)
+      {
+         console() << "not replaying " << mReplayPath << ": " << e.what() << std::endl;
+      }
+   }
+   beginScenario();
+}
+
+void BenchmarkApp::addScenarios()
+{
+   for (int n : { 1, 8 })
+   {
+      for (int m : { 10, 50 })
+      {
+         mScenarios.push_back ({ "windows_" + std::to_string (n) + "x" + std::to_string (m), [n, m] (BenchmarkScreen * screen)
+         {
+            for (int w = 0; w < n; ++w)
+            {
+               Window * window = new Window (screen, "Window " + std::to_string (w));
+               window->setPosition (Vector2i (15 + 40 * w, 15 + 20 * w));
+               window->setLayout (new GroupLayout());
+               for (int i = 0; i < m; ++i)
+               {
+                  switch (i % 3)
+                  {
+                     case 0:
+                        new Button (window, "Button " + std::to_string (i));
+                        break;
+                     case 1:
+                     {
+                        TextBox * textBox = new TextBox (window);
+                        textBox->setValue (std::to_string (i * 17));
+                        textBox->setUnits ("MHz");
+                        break;
+                     }
+                     default:
+                     {
+                        Slider * slider = new Slider (window);
+                        slider->setValue ((i % 10) / 10.f);
+                        break;
+                     }
+                  }
+               }
+            }
+         }
+                               });
+      }
+   }
+   mScenarios.push_back ({ "deep_vscrollpanel", [] (BenchmarkScreen * screen)
+   {
+      Window * window = new Window (screen, "Scroll panel");
+      window->setPosition (Vector2i (15, 15));
+      window->setLayout (new GroupLayout());
+      VScrollPanel * vscroll = new VScrollPanel (window);
+      vscroll->setFixedSize (Vector2i (300, 600));
+      Widget * column = new Widget (vscroll);
+      column->setLayout (new BoxLayout (Orientation::Vertical, Alignment::Fill, 4, 2));
+      for (int i = 0; i < 2000; ++i)
+      {
+         if (i % 2)
+            new Label (column, "Label " + std::to_string (i));
+         else
+            new Button (column, "Button " + std::to_string (i));
+      }
+   }
+                         });
+   mScenarios.push_back ({ "virtual_list_20k", [] (BenchmarkScreen * screen)
+   {
+      Window * window = new Window (screen, "Virtual list");
+      window->setPosition (Vector2i (15, 15));
+      window->setLayout (new GroupLayout());
+      VListPanel * list = new VListPanel (window);
+      list->setFixedSize (Vector2i (300, 600));
+      list->setRowFactory ([] (Widget * parent)
+      {
+         return new Label (parent, "");
+      });
+      list->setRowBinder ([] (Widget * row, int index)
+      {
+         ((Label *) row)->setCaption ("Item " + std::to_string (index));
+      });
+      list->setItemCount (20000);
+   }
+                         });
+   int image = mImage;
+   mScenarios.push_back ({ "large_imagepanel", [image] (BenchmarkScreen * screen)
+   {
+      Window * window = new Window (screen, "Image panel");
+      window->setPosition (Vector2i (15, 15));
+      window->setLayout (new GroupLayout());
+      ImagePanel * panel = new ImagePanel (window);
+      ImagePanel::Images images;
+      for (int i = 0; i < 1000; ++i)
+         images.push_back (std::make_pair (image, "image" + std::to_string (i)));
+      panel->setImages (images);
+   }
+                         });
+   mScenarios.push_back ({ "graph_10k", [] (BenchmarkScreen * screen)
+   {
+      Window * window = new Window (screen, "Graph");
+      window->setPosition (Vector2i (15, 15));
+      window->setLayout (new GroupLayout());
+      Graph * graph = new Graph (window, "10k points");
+      graph->setFixedSize (Vector2i (800, 300));
+      VectorXf & values = graph->values();
+      values.resize (10000);
+      for (int i = 0; i < 10000; ++i)
+         values[i] = 0.5f * (0.5f * std::sin (i / 100.f) + 0.5f * std::cos (i / 230.f) + 1);
+   }
+                         });
+   for (int n : { 100, 1000, 10000 })
+   {
+      Scenario flush = { "flush_" + std::to_string (n), [] (BenchmarkScreen *) { } };
+      flush.frame = [n] (BenchmarkScreen * screen, NVGframeStats & stats)
+      {
+         NVGcontext * ctx = screen->context();
+         nvgBeginFrame (ctx, screen->width(), screen->height(), screen->pixelRatio());
+         for (int i = 0; i < n; ++i)
+         {
+            nvgBeginPath (ctx);
+            nvgRect (ctx, (float) (i * 7 % 1200), (float) (i * 13 % 760), 40, 24);
+            nvgFillColor (ctx, nvgRGBA (i * 37 % 256, i * 59 % 256, 160, 255));
+            nvgFill (ctx);
+         }
+         auto start = std::chrono::steady_clock::now();
+         nvgEndFrame (ctx);
+         double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+         nvgFrameStats (ctx, &stats);
+         return seconds;
+      };
+      mScenarios.push_back (flush);
+   }
+   if (mCapturePath.empty())
+      return;
+   std::vector<unsigned char> data;
+   if (FILE * f = fopen (mCapturePath.c_str(), "rb"))
+   {
+      unsigned char buffer[65536];
+      size_t n;
+      while ((n = fread (buffer, 1, sizeof (buffer), f)) > 0)
+         data.insert (data.end(), buffer, buffer + n);
+      fclose (f);
+   }
+   mCapture = nvgCreateReplay (data.data(), (int)data.size());
+   if (!mCapture)
+   {
+      console() << "not replaying " << mCapturePath << ": not a capture of this build" << std::endl;
+      return;
+   }
+   Scenario capture = { "capture", [] (BenchmarkScreen *) { } };
+   NVGreplay * replay = mCapture;
+   capture.frame = [replay] (BenchmarkScreen * screen, NVGframeStats & stats)
+   {
+      NVGcontext * ctx = screen->context();
+      auto start = std::chrono::steady_clock::now();
+      if (nvgReplayFrame (ctx, replay) != 1)
+      {
+         nvgRewindReplay (replay);
+         nvgReplayFrame (ctx, replay);
+      }
+      double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+      nvgFrameStats (ctx, &stats);
+      return seconds;
+   };
+   mScenarios.push_back (capture);
+}
+
+void BenchmarkApp::beginScenario()
+{
+   mScreen->clear();
+   if (mScenarios[mScenario].replay)
+   {
+      /* The recorded positions are only meaningful on a screen of the recorded size */
+      if (mReplay->size().x() > 0 && mReplay->size().y() > 0)
+         mScreen->setSize (mReplay->size());
+      mReplay->rewind();
+      mReplayStart = std::chrono::steady_clock::now();
+   }
+   mScenarios[mScenario].build (mScreen.get());
+   mScreen->performLayout (mScreen->context());
+   /* A fresh timer so that queries of the previous scenario can't leak into this one */
+   initGPUTimer (&mGpuTimer);
+   mFrame = 0;
+   mCpuTimes.clear();
+   mGpuTimes.clear();
+   memset (&mStatsSum, 0, sizeof (mStatsSum));
+}
+
+void BenchmarkApp::draw()
+{
+   gl::clear (Color (0.1f, 0.11f, 0.12f));
+   bool replay = mScenarios[mScenario].replay;
+   bool measure = replay || mFrame >= mWarmup;
+   float gpuTimes[GPU_QUERY_COUNT];
+   startGPUTimer (&mGpuTimer);
+   auto start = std::chrono::steady_clock::now();
+   /* Delivering the events is part of the frame, as it would be live */
+   bool replaying = false;
+   if (replay)
+   {
+      if (mReplayRecordedSpeed)
+         replaying = mReplay->replayUntil (mScreen.get(), std::chrono::duration<double> (start - mReplayStart).count());
+      else
+         replaying = mReplay->replayFrame (mScreen.get());
+   }
+   double cpu;
+   NVGframeStats stats;
+   if (mScenarios[mScenario].frame)
+      cpu = mScenarios[mScenario].frame (mScreen.get(), stats);
+   else
+   {
+      mScreen->markDirty();
+      mScreen->drawWidgets();
+      cpu = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+      stats = mScreen->frameStats();
+   }
+   int n = stopGPUTimer (&mGpuTimer, gpuTimes, GPU_QUERY_COUNT);
+   if (measure)
+   {
+      mCpuTimes.push_back (cpu * 1000.0);
+      for (int i = 0; i < n; ++i)
+         mGpuTimes.push_back (gpuTimes[i] * 1000.0);
+      mStatsSum.drawCalls += stats.drawCalls;
+      mStatsSum.glDrawCalls += stats.glDrawCalls;
+      mStatsSum.fillTriCount += stats.fillTriCount;
+      mStatsSum.strokeTriCount += stats.strokeTriCount;
+      mStatsSum.textTriCount += stats.textTriCount;
+      mStatsSum.vertexBytes += stats.vertexBytes;
+      mStatsSum.uniformBytes += stats.uniformBytes;
+      mStatsSum.textureBinds += stats.textureBinds;
+      mStatsSum.stencilPasses += stats.stencilPasses;
+      mStatsSum.curveSegments += stats.curveSegments;
+      mStatsSum.peakVerts = std::max (mStatsSum.peakVerts, stats.peakVerts);
+      mStatsSum.peakPoints = std::max (mStatsSum.peakPoints, stats.peakPoints);
+   }
+   if (replay ? replaying : ++mFrame < mWarmup + mFrames)
+      return;
+   endScenario();
+   if (++mScenario < mScenarios.size())
+   {
+      beginScenario();
+      return;
+   }
+   writeResults();
+   nvgDeleteReplay (mScreen->context(), mCapture);
+   mCapture = nullptr;
+   quit();
+}
+
+void BenchmarkApp::endScenario()
+{
+   /* Wait for the GPU so that the last frames' timer queries can be read */
+   glFinish();
+   float gpuTimes[GPU_QUERY_COUNT];
+   startGPUTimer (&mGpuTimer);
+   int n = stopGPUTimer (&mGpuTimer, gpuTimes, GPU_QUERY_COUNT);
+   int measured = (int)mCpuTimes.size();
+   for (int i = 0; i < n && (int)mGpuTimes.size() < measured; ++i)
+      mGpuTimes.push_back (gpuTimes[i] * 1000.0);
+   deleteGPUTimer (&mGpuTimer);
+   Summary cpu = summarize (mCpuTimes), gpu = summarize (mGpuTimes);
+   double frames = (double)std::max (measured, 1);
+   char json[1024];
+   snprintf (json, sizeof (json),
+             "    {\"name\": \"%s\", \"frames\": %d,\n"
+             "     \"cpu_ms\": {\"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f},\n"
+             "     \"gpu_ms\": {\"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f, \"samples\": %d},\n"
+             "     \"draw_calls\": %.1f, \"gl_draw_calls\": %.1f,\n"
+             "     \"fill_tris\": %.1f, \"stroke_tris\": %.1f, \"text_tris\": %.1f,\n"
+             "     \"vertex_bytes\": %.1f, \"uniform_bytes\": %.1f, \"texture_binds\": %.1f, \"stencil_passes\": %.1f,\n"
+             "     \"curve_segments\": %.1f,\n"
+             "     \"peak_verts\": %d, \"peak_points\": %d}",
+             mScenarios[mScenario].name.c_str(), measured,
+             cpu.min, cpu.avg, cpu.p99,
+             gpu.min, gpu.avg, gpu.p99, (int)mGpuTimes.size(),
+             mStatsSum.drawCalls / frames, mStatsSum.glDrawCalls / frames,
+             mStatsSum.fillTriCount / frames, mStatsSum.strokeTriCount / frames, mStatsSum.textTriCount / frames,
+             mStatsSum.vertexBytes / frames, mStatsSum.uniformBytes / frames, mStatsSum.textureBinds / frames,
+             mStatsSum.stencilPasses / frames, mStatsSum.curveSegments / frames,
+             mStatsSum.peakVerts, mStatsSum.peakPoints);
+   mResults.push_back (json);
+}
+
+void BenchmarkApp::writeResults()
+{
+   FILE * f = fopen (mOutPath.c_str(), "w");
+   if (!f)
+   {
+      console() << "could not write " << mOutPath << std::endl;
+      return;
+   }
+   fprintf (f, "{\n  \"gl_renderer\": \"%s\",\n  \"width\": %d, \"height\": %d,\n  \"scenarios\": [\n",
+            (const char *)glGetString (GL_RENDERER), getWindowWidth(), getWindowHeight());
+   for (size_t i = 0; i < mResults.size(); ++i)
+      fprintf (f, "%s%s\n", mResults[i].c_str(), i + 1 < mResults.size() ? "," : "");
+   fprintf (f, "  ]\n}\n");
+   fclose (f);
+   console() << "wrote " << mOutPath << std::endl;
+}
+
+CINDER_APP (BenchmarkApp, RendererGl (RendererGl::Options().stencil()),
+            [&] (App::Settings * settings)
+{
+   settings->setWindowSize (1280, 800);
+   settings->disableFrameRate();
+   settings->setTitle ("nanogui benchmark");
+})
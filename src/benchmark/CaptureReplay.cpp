@@ -0,0 +1,111 @@
+// Replays frames captured with nvgCaptureFrames() without a window
+// Copyright (c) 2015, HurleyWorks
+
+// Draws the captured frames into a back-end that draws nothing, over and over, and reports the
+// CPU time per frame with the tessellation counts of the frames, so that changes to tessellation
+// and text layout can be measured on frames of a real session. BenchmarkApp --capture replays the
+// same file through GL.
+//
+// usage: CaptureReplay nanogui_frame.nvgc [--repeat 100]
+
+#include "HeadlessNanoVG.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static std::vector<unsigned char> readFile (const std::string & path)
+{
+   std::vector<unsigned char> data;
+   FILE * f = fopen (path.c_str(), "rb");
+   if (!f)
+      return data;
+   unsigned char buffer[65536];
+   size_t n;
+   while ((n = fread (buffer, 1, sizeof (buffer), f)) > 0)
+      data.insert (data.end(), buffer, buffer + n);
+   fclose (f);
+   return data;
+}
+
+int main (int argc, char ** argv)
+{
+   if (argc < 2)
+   {
+      fprintf (stderr, "usage: CaptureReplay capture.nvgc [--repeat 100]\n");
+      return 1;
+   }
+   std::string path = argv[1];
+   int repeat = 100;
+   for (int i = 2; i + 1 < argc; ++i)
+   {
+      if (std::string (argv[i]) == "--repeat")
+         repeat = std::max (1, atoi (argv[++i]));
+   }
+
+   std::vector<unsigned char> data = readFile (path);
+   NullBackend backend;
+   NVGcontext * ctx = createNullContext (&backend);
+   createEmbeddedFonts (ctx);
+   NVGreplay * replay = nvgCreateReplay (data.data(), (int)data.size());
+   if (!replay)
+   {
+      fprintf (stderr, "%s is not a capture of this build of NanoVG\n", path.c_str());
+      nvgDeleteInternal (ctx);
+      return 1;
+   }
+
+   /* The first pass creates the stand-in images and geometries and fills the glyph atlas */
+   int frames = 0;
+   while (nvgReplayFrame (ctx, replay) == 1)
+      frames++;
+   if (frames == 0)
+   {
+      fprintf (stderr, "%s holds no complete frame\n", path.c_str());
+      nvgDeleteReplay (ctx, replay);
+      nvgDeleteInternal (ctx);
+      return 1;
+   }
+
+   typedef std::chrono::steady_clock Clock;
+   std::vector<double> times;
+   NVGframeStats stats, sum;
+   memset (&sum, 0, sizeof (sum));
+   for (int r = 0; r < repeat; ++r)
+   {
+      nvgRewindReplay (replay);
+      for (;;)
+      {
+         auto start = Clock::now();
+         if (nvgReplayFrame (ctx, replay) != 1)
+            break;
+         times.push_back (std::chrono::duration<double, std::milli> (Clock::now() - start).count());
+         if (r == 0)
+         {
+            nvgFrameStats (ctx, &stats);
+            sum.drawCalls += stats.drawCalls;
+            sum.fillTriCount += stats.fillTriCount;
+            sum.strokeTriCount += stats.strokeTriCount;
+            sum.textTriCount += stats.textTriCount;
+            sum.curveSegments += stats.curveSegments;
+         }
+      }
+   }
+
+   std::sort (times.begin(), times.end());
+   double total = 0.0;
+   for (double t : times)
+      total += t;
+   printf ("%s: %d frames, %d bytes, replayed %d times\n", path.c_str(), frames, (int)data.size(), repeat);
+   printf ("ms/frame: min %.4f  avg %.4f  p50 %.4f  p99 %.4f\n", times.front(), total / times.size(),
+           times[(times.size() - 1) / 2], times[(times.size() - 1) * 99 / 100]);
+   printf ("per frame: %.1f draw calls, %.1f fill tris, %.1f stroke tris, %.1f text tris, %.1f curve segments\n",
+           (double)sum.drawCalls / frames, (double)sum.fillTriCount / frames, (double)sum.strokeTriCount / frames,
+           (double)sum.textTriCount / frames, (double)sum.curveSegments / frames);
+
+   nvgDeleteReplay (ctx, replay);
+   nvgDeleteInternal (ctx);
+   return 0;
+}
@@ -0,0 +1,291 @@
+// Event dispatch and hit-testing benchmark for nanogui
+// Copyright (c) 2015, HurleyWorks
+
+// Builds a tree of plain widgets with a given fan-out and depth in a hidden window, then fires
+// synthetic motion, button and scroll events through the Screen callbacks and writes events per
+// second and per event latency percentiles to a JSON file. Every phase runs once with linear child
+// scans and once with the spatial index enabled on every widget that has children.
+//
+// usage: EventStormApp [--out nanogui_event_storm.json] [--fanout 4] [--depth 5] [--events 1000000]
+//
+// Phases: find_widget calls Screen::findWidget, motion and motion_coalesced go through
+// cursorPosCallbackEvent (coalesced motion is flushed every 16 events, as a frame would),
+// button fires press/release pairs, scroll calls scrollEvent, focus calls Screen::updateFocus on
+// random leaves, and mixed interleaves motion, button and scroll events 8:1:1.
+
+#include "cinder/app/App.h"
+#include "cinder/app/RendererGl.h"
+#include "cinder/gl/gl.h"
+
+#include "../gui/nanogui/nanogui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ci;
+using namespace ci::app;
+using namespace nanogui;
+
+class StormScreen : public nanogui::Screen
+{
+   public:
+      StormScreen()
+      {
+         mTheme = new Theme (mNVGContext);
+      }
+};
+
+struct Latency
+{
+   double p50, p90, p99, p999, max;
+};
+
+static Latency percentiles (std::vector<float> & ns)
+{
+   Latency l = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+   if (ns.empty())
+      return l;
+   std::sort (ns.begin(), ns.end());
+   size_t last = ns.size() - 1;
+   l.p50 = ns[last * 50 / 100];
+   l.p90 = ns[last * 90 / 100];
+   l.p99 = ns[last * 99 / 100];
+   l.p999 = ns[last * 999 / 1000];
+   l.max = ns[last];
+   return l;
+}
+
+class EventStormApp : public App
+{
+   public:
+      void setup() override;
+      void draw() override;
+
+   private:
+      /// Split the rectangle of parent into a grid of fan-out children, down to the depth
+      void buildTree (Widget * parent, int level);
+      void setSpatialIndex (Widget * widget, bool enabled);
+      /// Time event(i) for every event, record it as phase name
+      void runPhase (const std::string & name, const std::function<void (int)> & event);
+      void writeResults();
+
+      std::shared_ptr<StormScreen> mScreen;
+      std::vector<Widget *> mLeaves;
+      std::vector<Vector2i> mPoints;	// cursor path, a random walk over the screen
+      std::vector<std::string> mResults;
+      bool mIndexed = false;
+
+      std::string mOutPath = "nanogui_event_storm.json";
+      int mFanout = 4;
+      int mDepth = 5;
+      int mEvents = 1000000;
+      size_t mWidgets = 0;
+};
+
+void EventStormApp::setup()
+{
+   const std::vector<std::string> & args = getCommandLineArgs();
+   for (size_t i = 1; i + 1 < args.size(); ++i)
+   {
+      if (args[i] == "--out")
+         mOutPath = args[++i];
+      else
+         if (args[i] == "--fanout")
+            mFanout = std::max (1, std::stoi (args[++i]));
+         else
+            if (args[i] == "--depth")
+               mDepth = std::max (1, std::stoi (args[++i]));
+            else
+               if (args[i] == "--events")
+                  mEvents = std::max (1, std::stoi (args[++i]));
+   }
+   getWindow()->hide();
+   mScreen = std::make_shared<StormScreen>();
+   mScreen->setSize (Vector2i (getWindowWidth(), getWindowHeight()));
+   /* The top level of the tree are windows, so that focus and window ordering take their usual paths */
+   int columns = (int)std::ceil (std::sqrt ((double)mFanout));
+   int rows = (mFanout + columns - 1) / columns;
+   Vector2i cell = mScreen->size().cwiseQuotient (Vector2i (columns, rows));
+   for (int i = 0; i < mFanout; ++i)
+   {
+      Window * window = new Window (mScreen.get(), "Window " + std::to_string (i));
+      window->setPosition (Vector2i (i % columns, i / columns).cwiseProduct (cell));
+      window->setSize (cell);
+      mWidgets++;
+      buildTree (window, 1);
+   }
+
+   std::mt19937 random (1);
+   std::uniform_int_distribution<int> step (-24, 24);
+   Vector2i p = mScreen->size() / 2;
+   mPoints.resize (mEvents);
+   for (Vector2i & point : mPoints)
+   {
+      p = Vector2i (std::min (std::max (p.x() + step (random), 0), mScreen->width() - 1),
+                    std::min (std::max (p.y() + step (random), 0), mScreen->height() - 1));
+      point = p;
+   }
+}
+
+void EventStormApp::buildTree (Widget * parent, int level)
+{
+   if (level >= mDepth)
+   {
+      mLeaves.push_back (parent);
+      return;
+   }
+   int columns = (int)std::ceil (std::sqrt ((double)mFanout));
+   int rows = (mFanout + columns - 1) / columns;
+   Vector2i cell = parent->size().cwiseQuotient (Vector2i (columns, rows)).cwiseMax (Vector2i (1, 1));
+   for (int i = 0; i < mFanout; ++i)
+   {
+      Widget * child = new Widget (parent);
+      child->setPosition (Vector2i (i % columns, i / columns).cwiseProduct (cell));
+      child->setSize (cell);
+      mWidgets++;
+      buildTree (child, level + 1);
+   }
+}
+
+void EventStormApp::setSpatialIndex (Widget * widget, bool enabled)
+{
+   if (widget->childCount() == 0)
+      return;
+   widget->setSpatialIndex (enabled);
+   for (Widget * child : widget->children())
+      setSpatialIndex (child, enabled);
+}
+
+void EventStormApp::runPhase (const std::string & name, const std::function<void (int)> & event)
+{
+   typedef std::chrono::steady_clock Clock;
+   /* A short warmup builds the spatial grids and faults in the tree */
+   for (int i = 0; i < std::min (mEvents, 1000); ++i)
+      event (i);
+   std::vector<float> ns (mEvents);
+   auto begin = Clock::now();
+   for (int i = 0; i < mEvents; ++i)
+   {
+      auto start = Clock::now();
+      event (i);
+      ns[i] = (float)std::chrono::duration<double, std::nano> (Clock::now() - start).count();
+   }
+   /* Includes reading the clock twice per event, which the latencies also do */
+   double seconds = std::chrono::duration<double> (Clock::now() - begin).count();
+   Latency l = percentiles (ns);
+   char json[512];
+   snprintf (json, sizeof (json),
+             "    {\"name\": \"%s\", \"spatial_index\": %s, \"events\": %d, \"events_per_s\": %.0f,\n"
+             "     \"latency_ns\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}}",
+             name.c_str(), mIndexed ? "true" : "false", mEvents, mEvents / seconds,
+             l.p50, l.p90, l.p99, l.p999, l.max);
+   mResults.push_back (json);
+   console() << name << (mIndexed ? " (indexed)" : "") << ": " << (int) (mEvents / seconds) << " events/s, p99 "
+             << l.p99 << " ns" << std::endl;
+}
+
+void EventStormApp::draw()
+{
+   StormScreen * screen = mScreen.get();
+   const std::vector<Vector2i> & points = mPoints;
+   std::mt19937 random (2);
+   std::vector<int> leaves (mEvents), kinds (mEvents);
+   std::uniform_int_distribution<int> leaf (0, (int)mLeaves.size() - 1), kind (0, 9);
+   for (int i = 0; i < mEvents; ++i)
+   {
+      leaves[i] = leaf (random);
+      kinds[i] = kind (random);
+   }
+   auto button = [screen] (int i)
+   {
+      screen->mouseButtonCallbackEvent (MOUSE_BUTTON_LEFT, (i & 1) ? RELEASE : PRESS, 0);
+   };
+
+   for (bool indexed : { false, true })
+   {
+      mIndexed = indexed;
+      setSpatialIndex (screen, indexed);
+      screen->setCoalesceMotion (false);
+      runPhase ("find_widget", [screen, &points] (int i)
+      {
+         screen->findWidget (points[i]);
+      });
+      runPhase ("motion", [screen, &points] (int i)
+      {
+         screen->cursorPosCallbackEvent (points[i].x(), points[i].y());
+      });
+      screen->setCoalesceMotion (true);
+      runPhase ("motion_coalesced", [screen, &points] (int i)
+      {
+         screen->cursorPosCallbackEvent (points[i].x(), points[i].y());
+         if (i % 16 == 15)
+            screen->flushMotion();
+      });
+      screen->setCoalesceMotion (false);
+      /* Press and release in pairs at one position, so that no drag moves a window */
+      runPhase ("button", [screen, &points, button] (int i)
+      {
+         if (!(i & 1))
+            screen->cursorPosCallbackEvent (points[i].x(), points[i].y());
+         button (i);
+      });
+      runPhase ("scroll", [screen, &points] (int i)
+      {
+         screen->scrollEvent (points[i], Vector2f (0.0f, (i & 1) ? 1.0f : -1.0f));
+      });
+      runPhase ("focus", [this, screen, &leaves] (int i)
+      {
+         screen->updateFocus (mLeaves[leaves[i]]);
+      });
+      bool pressed = false;
+      runPhase ("mixed", [screen, &points, &kinds, &pressed] (int i)
+      {
+         if (pressed || kinds[i] == 0)
+         {
+            screen->mouseButtonCallbackEvent (MOUSE_BUTTON_LEFT, pressed ? RELEASE : PRESS, 0);
+            pressed = !pressed;
+         }
+         else
+            if (kinds[i] == 1)
+               screen->scrollEvent (points[i], Vector2f (0.0f, 1.0f));
+            else
+               screen->cursorPosCallbackEvent (points[i].x(), points[i].y());
+      });
+      if (pressed)
+         screen->mouseButtonCallbackEvent (MOUSE_BUTTON_LEFT, RELEASE, 0);
+   }
+   writeResults();
+   quit();
+}
+
+void EventStormApp::writeResults()
+{
+   FILE * f = fopen (mOutPath.c_str(), "w");
+   if (!f)
+   {
+      console() << "could not write " << mOutPath << std::endl;
+      return;
+   }
+   fprintf (f, "{\n  \"fanout\": %d, \"depth\": %d, \"widgets\": %d, \"leaves\": %d,\n  \"phases\": [\n",
+            mFanout, mDepth, (int)mWidgets, (int)mLeaves.size());
+   for (size_t i = 0; i < mResults.size(); ++i)
+      fprintf (f, "%s%s\n", mResults[i].c_str(), i + 1 < mResults.size() ? "," : "");
+   fprintf (f, "  ]\n}\n");
+   fclose (f);
+   console() << "wrote " << mOutPath << std::endl;
+}
+
+CINDER_APP (EventStormApp, RendererGl (RendererGl::Options().stencil()),
+            [&] (App::Settings * settings)
+{
+   settings->setWindowSize (1280, 800);
+   settings->disableFrameRate();
+   settings->setTitle ("nanogui event storm");
+})
@@ -0,0 +1,129 @@
+// Headless NanoVG for the benchmark tools
+// Copyright (c) 2015, HurleyWorks
+
+// A NanoVG context whose back-end accepts everything and draws nothing, to measure the CPU side
+// of NanoVG without a window, and the fonts embedded in nanogui under the names the theme uses.
+
+#pragma once
+
+#include "../gui/nanovg/nanovg.h"
+#include "../gui/nanovg/stb_image.h"
+#include "../gui/nanogui/resources.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Back-end that accepts everything and draws nothing, textures only keep their size */
+struct NullBackend
+{
+   std::vector<std::pair<int, int>> textures;
+};
+
+inline int nullCreate (void *)
+{
+   return 1;
+}
+
+inline int nullCreateTexture (void * uptr, int, int w, int h, int, const unsigned char *)
+{
+   NullBackend * backend = (NullBackend *)uptr;
+   backend->textures.push_back (std::make_pair (w, h));
+   return (int)backend->textures.size();
+}
+
+inline int nullDeleteTexture (void *, int)
+{
+   return 1;
+}
+
+inline int nullUpdateTexture (void *, int, int, int, int, int, const unsigned char *)
+{
+   return 1;
+}
+
+inline int nullGetTextureSize (void * uptr, int image, int * w, int * h)
+{
+   NullBackend * backend = (NullBackend *)uptr;
+   if (image < 1 || image > (int)backend->textures.size())
+      return 0;
+   *w = backend->textures[image - 1].first;
+   *h = backend->textures[image - 1].second;
+   return 1;
+}
+
+inline void nullViewport (void *, int, int, float) {}
+inline void nullCancel (void *) {}
+inline void nullFlush (void *) {}
+inline void nullFill (void *, NVGpaint *, NVGscissor *, float, const float *, const NVGpath *, int) {}
+inline void nullStroke (void *, NVGpaint *, NVGscissor *, float, float, const NVGpath *, int) {}
+inline void nullTriangles (void *, NVGpaint *, NVGscissor *, const NVGvertex *, int) {}
+inline void nullDelete (void *) {}
+
+inline NVGcontext * createNullContext (NullBackend * backend)
+{
+   NVGparams params;
+   memset (&params, 0, sizeof (params));
+   params.userPtr = backend;
+   params.edgeAntiAlias = 1;
+   params.renderCreate = nullCreate;
+   params.renderCreateTexture = nullCreateTexture;
+   params.renderDeleteTexture = nullDeleteTexture;
+   params.renderUpdateTexture = nullUpdateTexture;
+   params.renderGetTextureSize = nullGetTextureSize;
+   params.renderViewport = nullViewport;
+   params.renderCancel = nullCancel;
+   params.renderFlush = nullFlush;
+   params.renderFill = nullFill;
+   params.renderStroke = nullStroke;
+   params.renderTriangles = nullTriangles;
+   params.renderDelete = nullDelete;
+   return nvgCreateInternal (&params);
+}
+
+/* An embedded font by the name nanogui gives it, decompressed once, exits if there is none */
+inline std::vector<char> & embeddedFont (const std::string & name)
+{
+   struct Font
+   {
+      const char * name;
+      const uint8_t * compressed;
+      uint32_t compressedSize, size;
+      std::vector<char> data;
+   };
+   static Font fonts[] =
+   {
+      { "sans", roboto_regular_ttf_z, roboto_regular_ttf_z_size, roboto_regular_ttf_size, {} },
+      { "sans-bold", roboto_bold_ttf_z, roboto_bold_ttf_z_size, roboto_bold_ttf_size, {} },
+      { "icons", entypo_ttf_z, entypo_ttf_z_size, entypo_ttf_size, {} }
+   };
+   for (Font & font : fonts)
+   {
+      if (name != font.name)
+         continue;
+      if (font.data.empty())
+      {
+         font.data.resize (font.size);
+         if (stbi_zlib_decode_buffer (font.data.data(), (int)font.data.size(), (const char *)font.compressed,
+                                      (int)font.compressedSize) != (int)font.data.size())
+            break;
+      }
+      return font.data;
+   }
+   fprintf (stderr, "could not decompress the embedded font %s\n", name.c_str());
+   exit (1);
+}
+
+/* Create the fonts of the nanogui theme on a context */
+inline void createEmbeddedFonts (NVGcontext * ctx)
+{
+   for (const char * name : { "sans", "sans-bold", "icons" })
+   {
+      std::vector<char> & data = embeddedFont (name);
+      nvgCreateFontMem (ctx, name, (unsigned char *)data.data(), (int)data.size(), 0);
+   }
+}
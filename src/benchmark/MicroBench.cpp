@@ -0,0 +1,342 @@
+// Microbenchmarks of nanovg and fontstash, without a window
+// Copyright (c) 2015, HurleyWorks
+
+// Every benchmark runs for a fixed time, several times over, and reports the median nanoseconds
+// and the heap allocations per operation. NanoVG draws into a back-end that keeps nothing, so the
+// CPU side of tessellation and text layout is measured alone. Flushing to GL needs a context and is
+// measured by the flush_* scenarios of BenchmarkApp instead.
+//
+// usage: MicroBench [--filter substring] [--time 0.2] [--save results.txt] [--baseline results.txt]
+//
+// --save writes one line per benchmark, --baseline reads such a file and prints the change of
+// every benchmark against it.
+
+#include "HeadlessNanoVG.h"
+extern "C" {
+#include "../gui/nanovg/fontstash.h"
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+/* Heap allocations, counted by replacing malloc where the C library allows it, else operator new */
+static long allocations = 0;
+
+#if defined(__GLIBC__)
+extern "C" void * __libc_malloc (size_t size);
+extern "C" void * __libc_calloc (size_t count, size_t size);
+extern "C" void * __libc_realloc (void * ptr, size_t size);
+extern "C" void __libc_free (void * ptr);
+
+extern "C" void * malloc (size_t size)
+{
+   allocations++;
+   return __libc_malloc (size);
+}
+
+extern "C" void * calloc (size_t count, size_t size)
+{
+   allocations++;
+   return __libc_calloc (count, size);
+}
+
+extern "C" void * realloc (void * ptr, size_t size)
+{
+   allocations++;
+   return __libc_realloc (ptr, size);
+}
+
+extern "C" void free (void * ptr)
+{
+   __libc_free (ptr);
+}
+#else
+void * operator new (size_t size)
+{
+   allocations++;
+   if (void * p = std::malloc (size ? size : 1))
+      return p;
+   throw std::bad_alloc();
+}
+
+void operator delete (void * p) noexcept
+{
+   std::free (p);
+}
+#endif
+
+struct Benchmark
+{
+   std::string name;
+   std::function<void (int ops)> run;
+};
+
+struct Result
+{
+   std::string name;
+   double nsPerOp;
+   double allocsPerOp;
+};
+
+static const char * shortText = "Button";
+static const char * longText =
+   "The quick brown fox jumps over the lazy dog, while the five boxing wizards jump quickly and "
+   "a wizard's job is to vex chumps quickly in fog. Pack my box with five dozen liquor jugs. "
+   "Sphinx of black quartz, judge my vow; how vexingly quick daft zebras jump!";
+
+/* Runs op for ops operations, in frames of at most 256 so that the command buffers stay bounded */
+static std::function<void (int)> inFrames (NVGcontext * ctx, std::function<void (int)> op)
+{
+   return [ctx, op] (int ops)
+   {
+      nvgBeginFrame (ctx, 1280, 800, 1.0f);
+      for (int i = 0; i < ops; ++i)
+      {
+         op (i);
+         if ((i + 1) % 256 == 0)
+         {
+            nvgEndFrame (ctx);
+            nvgBeginFrame (ctx, 1280, 800, 1.0f);
+         }
+      }
+      nvgEndFrame (ctx);
+   };
+}
+
+static void addShapeBenchmarks (std::vector<Benchmark> & benchmarks, NVGcontext * ctx)
+{
+   typedef std::function<void (NVGcontext *)> Shape;
+   std::vector<std::pair<std::string, Shape>> shapes =
+   {
+      { "rect", [] (NVGcontext * vg) { nvgRect (vg, 10.5f, 10.5f, 120, 30); } },
+      { "rounded_rect", [] (NVGcontext * vg) { nvgRoundedRect (vg, 10.5f, 10.5f, 120, 30, 6); } },
+      { "circle", [] (NVGcontext * vg) { nvgCircle (vg, 60, 60, 20); } },
+      { "arc", [] (NVGcontext * vg) { nvgArc (vg, 60, 60, 20, 0.0f, 1.5f * NVG_PI, NVG_CW); } },
+      {
+         "polyline_1000", [] (NVGcontext * vg)
+         {
+            nvgMoveTo (vg, 0, 400);
+            for (int i = 1; i < 1000; ++i)
+               nvgLineTo (vg, i * 1.2f, 400 + 100 * std::sin (i * 0.05f));
+         }
+      }
+   };
+   for (auto & shape : shapes)
+   {
+      Shape path = shape.second;
+      benchmarks.push_back ({ "fill_" + shape.first, inFrames (ctx, [ctx, path] (int)
+      {
+         nvgBeginPath (ctx);
+         path (ctx);
+         nvgFillColor (ctx, nvgRGBA (200, 120, 40, 255));
+         nvgFill (ctx);
+      }) });
+      benchmarks.push_back ({ "stroke_" + shape.first, inFrames (ctx, [ctx, path] (int)
+      {
+         nvgBeginPath (ctx);
+         path (ctx);
+         nvgStrokeColor (ctx, nvgRGBA (200, 120, 40, 255));
+         nvgStrokeWidth (ctx, 2.0f);
+         nvgStroke (ctx);
+      }) });
+   }
+}
+
+static void addTextBenchmarks (std::vector<Benchmark> & benchmarks, NVGcontext * ctx)
+{
+   std::vector<std::pair<std::string, const char *>> texts = { { "short", shortText }, { "long", longText } };
+   for (auto & text : texts)
+   {
+      const char * str = text.second;
+      benchmarks.push_back ({ "text_" + text.first, inFrames (ctx, [ctx, str] (int)
+      {
+         nvgFontFace (ctx, "sans");
+         nvgFontSize (ctx, 16.0f);
+         nvgFillColor (ctx, nvgRGBA (255, 255, 255, 255));
+         nvgText (ctx, 10, 30, str, nullptr);
+      }) });
+      benchmarks.push_back ({ "text_bounds_" + text.first, inFrames (ctx, [ctx, str] (int)
+      {
+         float bounds[4];
+         nvgFontFace (ctx, "sans");
+         nvgFontSize (ctx, 16.0f);
+         nvgTextBounds (ctx, 10, 30, str, nullptr, bounds);
+      }) });
+   }
+   benchmarks.push_back ({ "text_break_lines", inFrames (ctx, [ctx] (int)
+   {
+      NVGtextRow rows[16];
+      nvgFontFace (ctx, "sans");
+      nvgFontSize (ctx, 16.0f);
+      const char * start = longText, * end = longText + strlen (longText);
+      int n;
+      while ((n = nvgTextBreakLines (ctx, start, end, 300.0f, rows, 16)) > 0)
+         start = rows[n - 1].next;
+   }) });
+}
+
+static void addFontstashBenchmarks (std::vector<Benchmark> & benchmarks, FONScontext * fs, int font)
+{
+   /* One op is one glyph */
+   benchmarks.push_back ({ "fons_text_iter_next", [fs, font] (int ops)
+   {
+      FONStextIter iter;
+      FONSquad quad;
+      fonsSetFont (fs, font);
+      fonsSetSize (fs, 16.0f);
+      int done = 0;
+      while (done < ops)
+      {
+         fonsTextIterInit (fs, &iter, 0, 0, longText, nullptr);
+         while (done < ops && fonsTextIterNext (fs, &iter, &quad))
+            done++;
+      }
+   } });
+   /* fons__atlasAddRect is internal to fontstash, so a glyph new to the atlas is rasterized and
+      inserted; the reset that makes room again every 1024 glyphs is part of the cost */
+   benchmarks.push_back ({ "fons_glyph_insert", [fs, font] (int ops)
+   {
+      fonsSetFont (fs, font);
+      for (int i = 0; i < ops; ++i)
+      {
+         if (i % 1024 == 0)
+            fonsResetAtlas (fs, 1024, 1024);
+         char glyph[2] = { (char) ('a' + i % 26), 0 };
+         fonsSetSize (fs, 8.0f + (i / 26) % 40);
+         fonsPrewarm (fs, glyph, glyph + 1);
+      }
+   } });
+}
+
+static Result measure (const Benchmark & benchmark, double seconds)
+{
+   typedef std::chrono::steady_clock Clock;
+   /* Grow the count until a run takes a tenth of the time, then size the runs to take all of it */
+   int ops = 1;
+   double elapsed = 0.0;
+   for (;;)
+   {
+      auto start = Clock::now();
+      benchmark.run (ops);
+      elapsed = std::chrono::duration<double> (Clock::now() - start).count();
+      if (elapsed >= seconds * 0.1 || ops >= (1 << 28))
+         break;
+      ops *= 2;
+   }
+   ops = std::max (1, (int)std::min (ops * seconds / std::max (elapsed, 1e-9), (double) (1 << 28)));
+   const int runs = 5;
+   std::vector<double> times;
+   long allocated = allocations;
+   for (int r = 0; r < runs; ++r)
+   {
+      auto start = Clock::now();
+      benchmark.run (ops);
+      times.push_back (std::chrono::duration<double> (Clock::now() - start).count() * 1e9 / ops);
+   }
+   allocated = allocations - allocated;
+   std::sort (times.begin(), times.end());
+   return { benchmark.name, times[runs / 2], (double)allocated / ((double)ops * runs) };
+}
+
+static std::map<std::string, Result> readBaseline (const std::string & path)
+{
+   std::map<std::string, Result> baseline;
+   FILE * f = fopen (path.c_str(), "r");
+   if (!f)
+   {
+      fprintf (stderr, "could not read %s\n", path.c_str());
+      return baseline;
+   }
+   char name[128];
+   Result r;
+   while (fscanf (f, "%127s %lf %lf", name, &r.nsPerOp, &r.allocsPerOp) == 3)
+   {
+      r.name = name;
+      baseline[r.name] = r;
+   }
+   fclose (f);
+   return baseline;
+}
+
+int main (int argc, char ** argv)
+{
+   std::string filter, savePath, baselinePath;
+   double seconds = 0.2;
+   for (int i = 1; i + 1 < argc; ++i)
+   {
+      std::string arg = argv[i];
+      if (arg == "--filter")
+         filter = argv[++i];
+      else
+         if (arg == "--time")
+            seconds = std::max (0.001, atof (argv[++i]));
+         else
+            if (arg == "--save")
+               savePath = argv[++i];
+            else
+               if (arg == "--baseline")
+                  baselinePath = argv[++i];
+   }
+
+   NullBackend backend;
+   NVGcontext * ctx = createNullContext (&backend);
+   std::vector<char> & font = embeddedFont ("sans");
+   nvgCreateFontMem (ctx, "sans", (unsigned char *)font.data(), (int)font.size(), 0);
+   FONSparams params;
+   memset (&params, 0, sizeof (params));
+   params.width = params.height = 1024;
+   params.flags = FONS_ZERO_TOPLEFT;
+   FONScontext * fs = fonsCreateInternal (&params);
+   int fsFont = fonsAddFontMem (fs, "sans", (unsigned char *)font.data(), (int)font.size(), 0);
+
+   std::vector<Benchmark> benchmarks;
+   addShapeBenchmarks (benchmarks, ctx);
+   addTextBenchmarks (benchmarks, ctx);
+   addFontstashBenchmarks (benchmarks, fs, fsFont);
+
+   std::map<std::string, Result> baseline;
+   if (!baselinePath.empty())
+      baseline = readBaseline (baselinePath);
+   std::vector<Result> results;
+   printf ("%-24s %12s %12s", "benchmark", "ns/op", "allocs/op");
+   if (!baseline.empty())
+      printf (" %12s %8s", "baseline", "change");
+   printf ("\n");
+   for (const Benchmark & benchmark : benchmarks)
+   {
+      if (!filter.empty() && benchmark.name.find (filter) == std::string::npos)
+         continue;
+      Result r = measure (benchmark, seconds);
+      results.push_back (r);
+      printf ("%-24s %12.1f %12.3f", r.name.c_str(), r.nsPerOp, r.allocsPerOp);
+      auto base = baseline.find (r.name);
+      if (base != baseline.end())
+         printf (" %12.1f %+7.1f%%", base->second.nsPerOp, 100.0 * (r.nsPerOp / base->second.nsPerOp - 1.0));
+      printf ("\n");
+   }
+
+   if (!savePath.empty())
+   {
+      FILE * f = fopen (savePath.c_str(), "w");
+      if (!f)
+         fprintf (stderr, "could not write %s\n", savePath.c_str());
+      else
+      {
+         for (const Result & r : results)
+            fprintf (f, "%s %.3f %.4f\n", r.name.c_str(), r.nsPerOp, r.allocsPerOp);
+         fclose (f);
+      }
+   }
+   fonsDeleteInternal (fs);
+   nvgDeleteInternal (ctx);
+   return 0;
+}
@@ -4,6 +4,9 @@
 
 #include "View.h"
 #include "util/NanoUtil.h"
+#include "util/FramePacer.h"
+#include "util/ImageLoader.h"
+#include "util/StartupTimeline.h"
 #include "nanogui/nanogui.h"
 
 using namespace nanogui;
@@ -16,21 +19,53 @@ using std::endl;
 View::View ()
    : nanogui::Screen()
 {
+   STARTUP_STEP ("theme");
    mTheme = new Theme (mNVGContext);
 }
 
 // dtor
 View::~View ()
 {
+   setProfileCallback (nullptr, nullptr);
+   deleteGPUTimer (&gpuTimer);
+   hitches.dump (stdout);
 }
 
 void View::create (WindowRef & ciWindow)
 {
+   STARTUP_STEP ("View::create");
    try
    {
       initGraph (&fps, GRAPH_RENDER_FPS, "Frame Time");
       initGraph (&cpuGraph, GRAPH_RENDER_MS, "CPU Time");
+      initGraph (&gpuGraph, GRAPH_RENDER_MS, "GPU Time");
+      initGraph (&latencyGraph, GRAPH_RENDER_MS, "Input Latency");
+      initFrameHistogram (&frameTimes, 600);
+      initPerfHistory (&frameHistory);
+      initGPUTimer (&gpuTimer);
+      setProfileCallback (gpuTimerScopeCallback, &gpuTimer);
+      /* Sample the pointer right before drawing, as late as the refresh deadline allows */
+      setCoalesceMotion (true);
+      setFramePacing (true);
+      /* Fringes or multisampling, whichever this GPU renders the widgets cheaper with */
+      setAntiAliasing (AntiAliasing::Automatic);
+      /* Step the rendering down when the widgets take more than their share of a 60 Hz frame */
+      setFrameBudget (0.008);
+      setInputSampler ([ciWindow] (Vector2i & pos)
+      {
+         glm::ivec2 p = App::get()->getMousePos() - ciWindow->getPos();
+         pos = Vector2i (p.x, p.y);
+         return true;
+      });
       setSize (Vector2i (ciWindow->getSize().x, ciWindow->getSize().y));
+      /* Retained widgets and glyphs follow the window to displays of another density */
+      setPixelRatio (ciWindow->getContentScale());
+      ci::app::Window * host = ciWindow.get();
+      ciWindow->getSignalDisplayChange().connect ([this, host]
+      {
+         setPixelRatio (host->getContentScale());
+      });
+      prewarmGlyphs();
       nanogui::Window * window = new nanogui::Window (this, "Button demo");
       window->setPosition (Vector2i (15, 15));
       window->setLayout (new GroupLayout());
@@ -111,22 +146,42 @@ void View::create (WindowRef & ciWindow)
 	  
 	  // FIXME how to find relative path??
       std::string iconPath ("E:/Code4/nanofish/projects/qdemos/cinder/ciNanogui/assets/icons");
-      std::vector<std::pair<int, std::string>> icons = NanoUtil::loadImageDirectory (getContext(), iconPath);
       new Label (window, "Image panel & scroll panel", "sans-bold");
       PopupButton * imagePanelBtn = new PopupButton (window, "Image Panel");
       imagePanelBtn->setIcon (ENTYPO_ICON_FOLDER);
       popup = imagePanelBtn->popup();
       VScrollPanel * vscroll = new VScrollPanel (popup);
       ImagePanel * imgPanel = new ImagePanel (vscroll);
-      imgPanel->setImages (icons);
       popup->setFixedSize (Vector2i (245, 150));
       new Label (window, "Selected image", "sans-bold");
       auto img = new ImageView (window);
       img->setFixedSize (Vector2i (40, 40));
-      img->setImage (icons[0].first);
+      /* The icons are decoded in the background and replace their placeholders as they arrive,
+         thumbnails of unchanged files come straight from the cache of the last run */
+      imageLoader().setThumbnailCache (iconPath + "/thumbnails.cache");
+      std::vector<std::pair<int, std::string>> icons = NanoUtil::loadImageDirectory (imageLoader(), iconPath,
+            [img, imgPanel] (size_t index, int image)
+      {
+         imgPanel->setImage (index, image);
+         if (index == 0)
+            img->setImage (image);
+      }, imgPanel->thumbSize());
+      imgPanel->setImages (icons);
+      if (!icons.empty())
+         img->setImage (icons[0].first);
+      /* Only the thumbnails stay resident, the selected image is loaded at full size on demand */
       imgPanel->setCallback ([ &, img, imgPanel, imagePanelBtn] (int i)
       {
          img->setImage (imgPanel->images()[i].first);
+         imageLoader().load (imgPanel->images()[i].second + ".png", 0, [this, img] (int image)
+         {
+            if (!image)
+               return;
+            img->setImage (image);
+            if (mSelectedImage)
+               nvgDeleteImage (mNVGContext, mSelectedImage);
+            mSelectedImage = image;
+         });
          cout << "Selected item " << i << endl;
       });
       new Label (window, "Combo box", "sans-bold");
@@ -160,7 +215,9 @@ void View::create (WindowRef & ciWindow)
       textBox->setUnits ("%");
       slider->setCallback ([textBox] (float value)
       {
-         textBox->setValue (std::to_string ((int) (value * 100)));
+         char buffer[NumberBufferSize];
+         formatInteger (buffer, (int) (value * 100));
+         textBox->setValue (buffer);
       });
       slider->setFinalCallback ([&] (float value)
       {
@@ -178,11 +235,13 @@ void View::create (WindowRef & ciWindow)
       Graph * graph = new Graph (window, "Some function");
       graph->setHeader ("E = 2.35e-3");
       graph->setFooter ("Iteration 89");
-      VectorXf & func = graph->values();
-      func.resize (100);
+      VectorXf func (100);
       for (int i = 0; i < 100; ++i)
          func[i] = 0.5f * (0.5f * std::sin (i / 10.f) +
                            0.5f * std::cos (i / 23.f) + 1);
+      graph->setValues (func);
+      new Label (window, "Frame time history, scroll to zoom", "sans-bold");
+      new PerfHistoryGraph (window, &frameHistory);
       window = new nanogui::Window (this, "Grid of small widgets");
       window->setPosition (Vector2i (425, 288));
       GridLayout * layout =
@@ -250,7 +309,10 @@ void View::create (WindowRef & ciWindow)
             popupBtn->setPushed (false);
          }
       });
-      performLayout (mNVGContext);
+      {
+         STARTUP_STEP ("performLayout");
+         performLayout (mNVGContext);
+      }
    }
    catch (const std::exception & e)
    {
@@ -261,11 +323,52 @@ void View::create (WindowRef & ciWindow)
 void View::draw (double time)
 {
    mProgress->setValue (std::fmod ((float)time / 10, 1.0f));
+   float gpuTimes[3];
+   startGPUTimer (&gpuTimer);
    drawWidgets();
+   /* Prints how long each step up to here took, once */
+   StartupTimeline::instance().firstFrame();
+   if (capturing)
+   {
+      int size = 0;
+      if (const unsigned char * data = nvgCaptureData (mNVGContext, &size))
+      {
+         capturing = false;
+         if (FILE * f = fopen ("nanogui_frame.nvgc", "wb"))
+         {
+            fwrite (data, 1, size, f);
+            fclose (f);
+            cout << "captured a frame of " << size << " bytes to nanogui_frame.nvgc" << endl;
+         }
+      }
+   }
+   int n = stopGPUTimer (&gpuTimer, gpuTimes, 3);
+   for (int i = 0; i < n; i++)
+   {
+      updateGraph (&gpuGraph, gpuTimes[i]);
+      addGpuTime (gpuTimes[i]);
+   }
+   float latencies[GPU_QUERY_COUNT];
+   markGPUFrameEnd (&gpuTimer, elapsedTime().count(), frameInputTime());
+   n = getGPUFrameLatencies (&gpuTimer, latencies, GPU_QUERY_COUNT);
+   for (int i = 0; i < n; i++)
+      updateGraph (&latencyGraph, latencies[i]);
+   /* The frame time graph names the step the quality governor is at */
+   if (quality() == Quality::Full)
+      snprintf (fps.name, sizeof (fps.name), "Frame Time");
+   else
+      snprintf (fps.name, sizeof (fps.name), "Frame Time - %s", qualityName (quality()));
    float x = 5;
    float y = mSize[1] - 40;
    renderGraph (mNVGContext, x, y, &fps, nvgRGBA (128, 0, 0, 255));
    renderGraph (mNVGContext, x + 200 + 5, y, &cpuGraph, nvgRGBA (0, 128, 0, 255));
+   if (gpuTimer.supported)
+   {
+      renderGraph (mNVGContext, x + 2 * (200 + 5), y, &gpuGraph, nvgRGBA (0, 0, 128, 255));
+      renderGraph (mNVGContext, x + 3 * (200 + 5), y, &latencyGraph, nvgRGBA (128, 0, 128, 255));
+   }
+   renderFrameStats (mNVGContext, x + (gpuTimer.supported ? 4 : 2) * (200 + 5), y, &frameTimes, nvgRGBA (128, 0, 0, 255));
+   renderHitches (mNVGContext, x, y - 5, hitches);
 }
 
 bool View::mouseMove (MouseEvent e)
@@ -276,6 +379,7 @@ bool View::mouseMove (MouseEvent e)
 bool View::mouseDown (MouseEvent e)
 {
    if (!e.isLeft()) return false;
+   hitches.noteEvent ("mouse down " + std::to_string (e.getPos().x) + "," + std::to_string (e.getPos().y));
    return mouseButtonCallbackEvent (MOUSE_BUTTON_LEFT, PRESS, 0);
 }
 
@@ -288,11 +392,58 @@ bool View::mouseDrag (MouseEvent e)
 bool View::mouseUp (MouseEvent e)
 {
    if (!e.isLeft()) return false;
+   hitches.noteEvent ("mouse up " + std::to_string (e.getPos().x) + "," + std::to_string (e.getPos().y));
    return mouseButtonCallbackEvent (MOUSE_BUTTON_LEFT, RELEASE, 0);
 }
 
 bool View::keyDown (KeyEvent e)
 {
+   hitches.noteEvent ("key down " + std::to_string (e.getCode()));
+   /* F6 captures the NanoVG calls of the next frame, for CaptureReplay and the benchmark */
+   if (e.getCode() == KeyEvent::KEY_F6)
+   {
+      nvgCaptureFrames (mNVGContext, 1);
+      capturing = true;
+      markDirty();
+      return true;
+   }
+   /* F7 starts and stops recording the input, for replays in the benchmark */
+   if (e.getCode() == KeyEvent::KEY_F7)
+   {
+      setInputRecorder (nullptr);
+      if (recorder)
+      {
+         cout << "recorded " << recorder->frames() << " frames to nanogui_input.ngir" << endl;
+         recorder.reset();
+      }
+      else
+      {
+         try
+         {
+            recorder.reset (new InputRecorder ("nanogui_input.ngir", size()));
+            setInputRecorder (recorder.get());
+         }
+         catch (const std::exception & ex)
+         {
+            cerr << ex.what() << endl;
+         }
+      }
+      return true;
+   }
+#ifdef NANOGUI_DRAW_INSPECTOR
+   /* F8 shows the draw cost of the widgets, F9 sorts the list by the next column */
+   DrawInspector & inspector = DrawInspector::instance();
+   if (e.getCode() == KeyEvent::KEY_F8)
+   {
+      inspector.setEnabled (!inspector.enabled());
+      return true;
+   }
+   if (e.getCode() == KeyEvent::KEY_F9 && inspector.enabled())
+   {
+      inspector.setSortKey ((DrawInspector::SortKey) (((int)inspector.sortKey() + 1) % 4));
+      return true;
+   }
+#endif
    if (e.getChar() > 32)
       charCallbackEvent (e.getChar());
    return keyCallbackEvent ( e.getCode(), 0, PRESS, 0);
@@ -300,6 +451,7 @@ bool View::keyDown (KeyEvent e)
 
 bool View::keyUp (KeyEvent e)
 {
+   hitches.noteEvent ("key up " + std::to_string (e.getCode()));
    return keyCallbackEvent (e.getCode(), 0, RELEASE, 0);
 }
 
@@ -307,6 +459,9 @@ void View::updatePerfGraph (float dt, float cpuTime)
 {
    updateGraph (&fps, dt);
    updateGraph (&cpuGraph, cpuTime);
+   updateFrameHistogram (&frameTimes, dt);
+   updatePerfHistory (&frameHistory, elapsedTime().count(), dt);
+   hitches.endFrame (dt, cpuTime, frameStats());
 }
 
 
@@ -6,6 +6,7 @@
 
 #include <cinder/app/Window.h>
 #include "nanogui/screen.h"
+#include "nanogui/inputrecorder.h"
 #include "util/Performance.h"
 
 typedef std::shared_ptr<class View> ViewRef;
@@ -37,8 +38,14 @@ class View : public nanogui::Screen
       void updatePerfGraph (float dt, float cpuTime);
 
    private:
-      PerfGraph fps, cpuGraph, gpuGraph;
+      PerfGraph fps, cpuGraph, gpuGraph, latencyGraph;
+      FrameHistogram frameTimes;	// of the last 10 seconds at 60 Hz
+      HitchDetector hitches;
+      PerfHistory frameHistory;
+      std::unique_ptr<nanogui::InputRecorder> recorder;	// while F7 records the session
+      bool capturing = false;	// F6 asked NanoVG to capture the next frame
       GPUtimer gpuTimer;
       nanogui::ProgressBar * mProgress = nullptr;
+      int mSelectedImage = 0;	// full size image shown by the image view
 
 }; // end class View
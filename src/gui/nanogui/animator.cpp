@@ -0,0 +1,189 @@
+/*
+    src/animator.cpp -- Tweens of widget positions, sizes, opacity and
+    values, updated together once per frame
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "animator.h"
+#include "widget.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NAMESPACE_BEGIN (nanogui)
+
+Animator::Animator() {}
+
+Animator::~Animator() {}
+
+void Animator::animatePosition (Widget * widget, const Vector2i & to, double duration, Easing easing,
+                                const std::function<void()> & done)
+{
+   const Vector2i & from = widget->position();
+   track (widget, Property::Position, (float)from.x(), (float)from.y(), (float)to.x(), (float)to.y(), duration, easing, done);
+}
+
+void Animator::animateSize (Widget * widget, const Vector2i & to, double duration, Easing easing,
+                            const std::function<void()> & done)
+{
+   const Vector2i & from = widget->size();
+   track (widget, Property::Size, (float)from.x(), (float)from.y(), (float)to.x(), (float)to.y(), duration, easing, done);
+}
+
+void Animator::animateAlpha (Widget * widget, float to, double duration, Easing easing, const std::function<void()> & done)
+{
+   track (widget, Property::Alpha, widget->alpha(), 0.0f, to, 0.0f, duration, easing, done);
+}
+
+void Animator::animateValue (Widget * widget, float from, float to, double duration, const std::function<void (float)> & set,
+                             Easing easing, const std::function<void()> & done)
+{
+   size_t index = track (widget, Property::Value, from, 0.0f, to, 0.0f, duration, easing, done);
+   mSetters[index] = set;
+}
+
+size_t Animator::track (Widget * widget, Property property, float from0, float from1, float to0, float to1,
+                        double duration, Easing easing, const std::function<void()> & done)
+{
+   size_t index = 0;
+   while (index < mWidgets.size() && (mWidgets[index].get() != widget || mProperties[index] != property))
+      ++index;
+   if (index == mWidgets.size())
+   {
+      mWidgets.push_back (widget);
+      mProperties.push_back (property);
+      for (auto array : { &mFrom0, &mFrom1, &mTo0, &mTo1, &mStart, &mRate, &mEase1, &mEase2, &mEase3, &mValue0, &mValue1 })
+         array->push_back (0.0f);
+      mSetters.push_back (nullptr);
+      mDone.push_back (nullptr);
+   }
+   static const float coefficients[4][3] =
+   {
+      { 1.0f, 0.0f, 0.0f },	// t
+      { 0.0f, 1.0f, 0.0f },	// t^2
+      { 2.0f, -1.0f, 0.0f },	// 1 - (1 - t)^2
+      { 0.0f, 3.0f, -2.0f }	// smoothstep
+   };
+   const float * ease = coefficients[(int)easing];
+   mFrom0[index] = from0;
+   mFrom1[index] = from1;
+   mTo0[index] = to0;
+   mTo1[index] = to1;
+   /* Tracks start with the next update; those without a duration started long ago */
+   mStart[index] = duration > 0.0 ? std::numeric_limits<float>::quiet_NaN() : -1e30f;
+   mRate[index] = duration > 0.0 ? (float) (1.0 / duration) : 1.0f;
+   mEase1[index] = ease[0];
+   mEase2[index] = ease[1];
+   mEase3[index] = ease[2];
+   mSetters[index] = nullptr;
+   mDone[index] = done;
+   return index;
+}
+
+void Animator::remove (size_t index)
+{
+   size_t last = mWidgets.size() - 1;
+   if (index != last)
+   {
+      mWidgets[index] = std::move (mWidgets[last]);
+      mProperties[index] = mProperties[last];
+      for (auto array : { &mFrom0, &mFrom1, &mTo0, &mTo1, &mStart, &mRate, &mEase1, &mEase2, &mEase3, &mValue0, &mValue1 })
+         (*array)[index] = (*array)[last];
+      mSetters[index] = std::move (mSetters[last]);
+      mDone[index] = std::move (mDone[last]);
+   }
+   mWidgets.pop_back();
+   mProperties.pop_back();
+   for (auto array : { &mFrom0, &mFrom1, &mTo0, &mTo1, &mStart, &mRate, &mEase1, &mEase2, &mEase3, &mValue0, &mValue1 })
+      array->pop_back();
+   mSetters.pop_back();
+   mDone.pop_back();
+}
+
+void Animator::stop (Widget * widget)
+{
+   for (size_t i = mWidgets.size(); i-- > 0;)
+      if (mWidgets[i].get() == widget)
+         remove (i);
+}
+
+bool Animator::animating (const Widget * widget, Property property) const
+{
+   for (size_t i = 0; i < mWidgets.size(); ++i)
+      if (mWidgets[i].get() == widget && mProperties[i] == property)
+         return true;
+   return false;
+}
+
+void Animator::update (double now, NVGcontext * ctx)
+{
+   if (mWidgets.empty())
+   {
+      mEpoch = -1.0;
+      return;
+   }
+   PROFILE_ZONE ("Animator::update");
+   if (mEpoch < 0.0)
+      mEpoch = now;
+   const float time = (float) (now - mEpoch);
+   const size_t n = mWidgets.size();
+
+   /* All tracks at once, without branches, so that the loop vectorizes */
+   float * start = mStart.data();
+   const float * rate = mRate.data();
+   const float * e1 = mEase1.data(), * e2 = mEase2.data(), * e3 = mEase3.data();
+   const float * from0 = mFrom0.data(), * from1 = mFrom1.data(), * to0 = mTo0.data(), * to1 = mTo1.data();
+   float * value0 = mValue0.data(), * value1 = mValue1.data();
+   for (size_t i = 0; i < n; ++i)
+   {
+      start[i] = start[i] != start[i] ? time : start[i];
+      float t = std::min (std::max ((time - start[i]) * rate[i], 0.0f), 1.0f);
+      float e = t * (e1[i] + t * (e2[i] + t * e3[i]));
+      value0[i] = from0[i] + (to0[i] - from0[i]) * e;
+      value1[i] = from1[i] + (to1[i] - from1[i]) * e;
+   }
+
+   /* Backwards, so that finished tracks can be swapped out on the way */
+   for (size_t i = n; i-- > 0;)
+   {
+      Widget * widget = mWidgets[i].get();
+      switch (mProperties[i])
+      {
+         case Property::Position:
+            widget->setPosition (Vector2i ((int) std::round (value0[i]), (int) std::round (value1[i])));
+            break;
+         case Property::Size:
+            widget->setSize (Vector2i ((int) std::round (value0[i]), (int) std::round (value1[i])));
+            widget->performLayout (ctx);
+            break;
+         case Property::Alpha:
+            widget->setAlpha (value0[i]);
+            break;
+         case Property::Value:
+            if (mSetters[i])
+               mSetters[i] (value0[i]);
+            break;
+      }
+      if ((time - start[i]) * rate[i] >= 1.0f)
+      {
+         if (mDone[i])
+            mFinished.push_back (std::move (mDone[i]));
+         remove (i);
+      }
+   }
+
+   /* Last, they may start new tracks */
+   std::vector<std::function<void()>> finished;
+   finished.swap (mFinished);
+   for (auto & done : finished)
+      done();
+}
+
+NAMESPACE_END (nanogui)
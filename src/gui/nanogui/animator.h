@@ -0,0 +1,116 @@
+/*
+    nanogui/animator.h -- Tweens of widget positions, sizes, opacity and
+    values, updated together once per frame
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "object.h"
+#include <functional>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+class Widget;
+
+/**
+   \brief Animates widget properties from their current state to a target
+
+   Every track is one property of one widget, with up to two components.
+   Their start values, targets, timing and easing are kept in parallel arrays,
+   and \ref update() evaluates all of them in one pass over those arrays
+   before it hands the results to the widgets. Positions and sizes are set
+   without invalidating the layout of the parent, and an animated size only
+   lays out the widget's own children. A new track of a widget and property
+   replaces the running one; finished tracks are swapped out in O(1).
+
+   The screen owns an animator, see \ref Screen::animator(), updates it at the
+   start of every frame and keeps drawing while tracks are running.
+*/
+class  Animator
+{
+   public:
+      enum class Property
+      {
+         Position,
+         Size,
+         Alpha,
+         Value
+      };
+      /// Progress over time, all of them cubic polynomials
+      enum class Easing
+      {
+         Linear,
+         In,
+         Out,
+         InOut
+      };
+
+      Animator();
+      ~Animator();
+
+      Animator (const Animator &) = delete;
+      Animator & operator= (const Animator &) = delete;
+
+      /// Move \c widget to \c to within its parent
+      void animatePosition (Widget * widget, const Vector2i & to, double duration, Easing easing = Easing::InOut,
+                            const std::function<void()> & done = nullptr);
+      /// Resize \c widget to \c to and lay out its children at every step
+      void animateSize (Widget * widget, const Vector2i & to, double duration, Easing easing = Easing::InOut,
+                        const std::function<void()> & done = nullptr);
+      /// Fade \c widget to \c to, see \ref Widget::setAlpha()
+      void animateAlpha (Widget * widget, float to, double duration, Easing easing = Easing::InOut,
+                         const std::function<void()> & done = nullptr);
+      /// Call \c set with values from \c from to \c to, e.g. a setter of \c widget that does not notify
+      void animateValue (Widget * widget, float from, float to, double duration, const std::function<void (float)> & set,
+                         Easing easing = Easing::InOut, const std::function<void()> & done = nullptr);
+
+      /// Stop the tracks of \c widget where they are, without calling their completion callbacks
+      void stop (Widget * widget);
+      /// Return whether \c widget has a running track of \c property
+      bool animating (const Widget * widget, Property property) const;
+
+      /// Number of running tracks
+      size_t size() const
+      {
+         return mWidgets.size();
+      }
+      /// Return whether any track is running
+      bool active() const
+      {
+         return !mWidgets.empty();
+      }
+
+      /// Advance every track to \c now, in seconds; \c ctx lays out animated sizes
+      void update (double now, NVGcontext * ctx);
+
+   protected:
+      /// Add or replace the track of \c widget and \c property, return its index
+      size_t track (Widget * widget, Property property, float from0, float from1, float to0, float to1,
+                    double duration, Easing easing, const std::function<void()> & done);
+      /// Swap the last track into \c index
+      void remove (size_t index);
+
+      /* One entry per track in each array */
+      std::vector<ref<Widget>> mWidgets;
+      std::vector<Property> mProperties;
+      std::vector<float> mFrom0, mFrom1, mTo0, mTo1;
+      std::vector<float> mStart;	// seconds after mEpoch, NaN until the first update
+      std::vector<float> mRate;	// 1 / duration
+      std::vector<float> mEase1, mEase2, mEase3;	// coefficients of t, t^2 and t^3
+      std::vector<float> mValue0, mValue1;	// eased values of the last update
+      std::vector<std::function<void (float)>> mSetters;	// of value tracks
+      std::vector<std::function<void()>> mDone;
+      double mEpoch = -1.0;	// time of the first update, keeps the float times precise
+      /* Tracks finished by an update, their callbacks run once the arrays are consistent again */
+      std::vector<std::function<void()>> mFinished;
+};
+
+NAMESPACE_END (nanogui)
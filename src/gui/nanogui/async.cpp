@@ -0,0 +1,69 @@
+/*
+    src/async.cpp -- Work started from the GUI thread that runs on a
+    thread of its own and finishes back on the GUI thread
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "async.h"
+#include "progressbar.h"
+#include "screen.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+AsyncOperation::AsyncOperation (Screen * screen)
+   : mScreen (screen) {}
+
+AsyncOperation::~AsyncOperation()
+{
+   if (mThread.joinable())
+      mThread.join();
+}
+
+void AsyncOperation::setProgress (float progress)
+{
+   mProgress.store (progress, std::memory_order_relaxed);
+   /* One update in flight at a time, it shows the latest progress when it runs */
+   if (mProgressPosted.exchange (true))
+      return;
+   ref<AsyncOperation> op = this;
+   mScreen->post ([op]() mutable
+   {
+      op->mProgressPosted = false;
+      if (op->mProgressBar && !op->mFinished)
+         op->mProgressBar->setValue (op->progress());
+   });
+}
+
+void AsyncOperation::bindProgress (ProgressBar * bar)
+{
+   mProgressBar = bar;
+   if (bar)
+      bar->setValue (mFinished && !mError && !cancelled() ? 1.0f : progress());
+}
+
+void AsyncOperation::disableWhileRunning (Widget * widget)
+{
+   if (mFinished)
+      return;
+   widget->setEnabled (false);
+   mDisabled.push_back (widget);
+}
+
+void AsyncOperation::finish()
+{
+   mThread.join();
+   mFinished = true;
+   for (auto & widget : mDisabled)
+      widget->setEnabled (true);
+   mDisabled.clear();
+   if (mProgressBar && !mError && !cancelled())
+      mProgressBar->setValue (1.0f);
+}
+
+NAMESPACE_END (nanogui)
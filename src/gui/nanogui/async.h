@@ -0,0 +1,95 @@
+/*
+    nanogui/async.h -- Work started from the GUI thread that runs on a
+    thread of its own and finishes back on the GUI thread
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "object.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+class ProgressBar;
+class Screen;
+class Widget;
+
+/**
+   \brief A job started with \ref Screen::runAsync()
+
+   The work function runs on a thread of its own and only calls \ref progress
+   setters and \ref cancelled() on the operation. Everything else is for the
+   GUI thread: the bound progress bar follows \ref setProgress() a frame later,
+   bound widgets are disabled until the operation finishes, and the completion
+   callback runs as a task posted to the screen, see \ref Screen::post().
+*/
+class  AsyncOperation : public Object
+{
+   public:
+      /// Report progress in [0, 1], callable from the work function
+      void setProgress (float progress);
+      /// Return the last progress reported
+      float progress() const
+      {
+         return mProgress.load (std::memory_order_relaxed);
+      }
+
+      /// Ask the work function to stop, it checks \ref cancelled() itself
+      void cancel()
+      {
+         mCancelled.store (true, std::memory_order_relaxed);
+      }
+      /// Return whether \ref cancel() was called, callable from the work function
+      bool cancelled() const
+      {
+         return mCancelled.load (std::memory_order_relaxed);
+      }
+
+      /// Return whether the work function returned and the completion callback ran, GUI thread
+      bool finished() const
+      {
+         return mFinished;
+      }
+      /// Return the exception the work function threw, if any; valid once finished
+      std::exception_ptr error() const
+      {
+         return mError;
+      }
+
+      /// Show the progress in \c bar, set to 1 when the work completes uncancelled
+      void bindProgress (ProgressBar * bar);
+      /// Disable \c widget, e.g. the button that started the work, until the operation finishes
+      void disableWhileRunning (Widget * widget);
+
+   protected:
+      friend class Screen;
+
+      AsyncOperation (Screen * screen);
+      virtual ~AsyncOperation();
+
+      /// Called on the GUI thread once the work function returned
+      void finish();
+
+      Screen * mScreen;
+      std::atomic<float> mProgress { 0.0f };
+      std::atomic<bool> mProgressPosted { false };
+      std::atomic<bool> mCancelled { false };
+      bool mFinished = false;
+      std::exception_ptr mError;
+      ref<ProgressBar> mProgressBar;
+      std::vector<ref<Widget>> mDisabled;
+      std::thread mThread;
+};
+
+NAMESPACE_END (nanogui)
@@ -19,13 +19,93 @@ Button::Button (Widget * parent, const std::string & caption, int icon)
    : Widget (parent), mCaption (caption), mIcon (icon),
      mIconPosition (IconPosition::LeftCentered), mPushed (false),
      mFlags (NormalButton), mBackgroundColor (Color (0, 0)),
-     mTextColor (Color (0, 0)) {}
+     mTextColor (Color (0, 0))
+{
+   mKind |= ButtonKind;
+}
+
+Button::~Button()
+{
+   if (mButtonGroup && mButtonGroup->mPushed == this)
+      mButtonGroup->mPushed = nullptr;
+}
+
+void Button::setPushed (bool pushed)
+{
+   if (pushed && (mFlags & (RadioButton | PopupButton)))
+   {
+      ButtonGroup * group = exclusiveGroup();
+      if (group->mPushed && group->mPushed != this)
+      {
+         group->mPushed->mPushed = false;
+         group->mPushed->markDirty();
+      }
+   }
+   mPushed = pushed;
+   if (mButtonGroup)
+   {
+      if (pushed)
+         mButtonGroup->mPushed = this;
+      else
+         if (mButtonGroup->mPushed == this)
+            mButtonGroup->mPushed = nullptr;
+   }
+   markDirty();
+}
+
+void Button::setButtonGroup (ButtonGroup * buttonGroup)
+{
+   if (mButtonGroup && mButtonGroup->mPushed == this)
+      mButtonGroup->mPushed = nullptr;
+   mButtonGroup = buttonGroup;
+   if (mButtonGroup && mPushed)
+      mButtonGroup->mPushed = this;
+}
+
+void Button::setButtonGroup (const std::vector<Button *> & buttonGroup)
+{
+   ref<ButtonGroup> group = new ButtonGroup();
+   setButtonGroup (group);
+   for (auto b : buttonGroup)
+      b->setButtonGroup (group);
+}
+
+ButtonGroup * Button::exclusiveGroup()
+{
+   if (mButtonGroup)
+      return mButtonGroup;
+   /* Siblings of the same kind share a group, so they are visited once per button instead of on every push */
+   int kind = mFlags & RadioButton ? RadioButton : PopupButton;
+   ButtonGroup * group = nullptr;
+   for (auto widget : parent()->children())
+   {
+      Button * b = widget->isButton() ? (Button *) widget : nullptr;
+      if (b && b != this && (b->mFlags & kind) && b->mButtonGroup && b->mButtonGroup->mImplicit)
+      {
+         group = b->mButtonGroup;
+         break;
+      }
+   }
+   if (!group)
+   {
+      group = new ButtonGroup();
+      group->mImplicit = true;
+      for (auto widget : parent()->children())
+      {
+         Button * b = widget->isButton() ? (Button *) widget : nullptr;
+         if (b && b != this && (b->mFlags & kind) && !b->mButtonGroup)
+            b->setButtonGroup (group);
+      }
+   }
+   setButtonGroup (group);
+   return group;
+}
 
 Vector2i Button::preferredSize (NVGcontext * ctx) const
 {
    int fontSize = mFontSize == -1 ? mTheme->mButtonFontSize : mFontSize;
    nvgFontSize (ctx, fontSize);
-   nvgFontFace (ctx, "sans-bold");
+   nvgFontFaceId (ctx, mTheme->mFontBold.id (ctx));
    float tw = nvgTextBounds (ctx, 0, 0, mCaption.c_str(), nullptr, nullptr);
    float iw = 0.0f, ih = fontSize;
    if (mIcon)
@@ -33,9 +113,9 @@ Vector2i Button::preferredSize (NVGcontext * ctx) const
       if (nvgIsFontIcon (mIcon))
       {
          ih *= 1.5f;
-         nvgFontFace (ctx, "icons");
+         nvgFontFaceId (ctx, mTheme->mFontIcons.id (ctx));
          nvgFontSize (ctx, ih);
-         iw = nvgTextBounds (ctx, 0, 0, utf8 (mIcon).data(), nullptr, nullptr)
+         iw = nvgIconBounds (ctx, 0, 0, mIcon, nullptr)
               + mSize.y() * 0.15f;
       }
       else
@@ -60,39 +140,8 @@ bool Button::mouseButtonEvent (const Vector2i & p, int button, bool down, int mo
       bool pushedBackup = mPushed;
       if (down)
       {
-         if (mFlags & RadioButton)
-         {
-            if (mButtonGroup.empty())
-            {
-               for (auto widget : parent()->children())
-               {
-                  Button * b = dynamic_cast<Button *> (widget);
-                  if (b != this && b && b->flags() & RadioButton)
-                     b->mPushed = false;
-               }
-            }
-            else
-            {
-               for (auto b : mButtonGroup)
-               {
-                  if (b != this && b->flags() & RadioButton)
-                     b->mPushed = false;
-               }
-            }
-         }
-         if (mFlags & PopupButton)
-         {
-            for (auto widget : parent()->children())
-            {
-               Button * b = dynamic_cast<Button *> (widget);
-               if (b != this && b && b->flags() & PopupButton)
-                  b->mPushed = false;
-            }
-         }
-         if (mFlags & ToggleButton)
-            mPushed = !mPushed;
-         else
-            mPushed = true;
+         /* Pushing a radio or popup button releases the other member of its group */
+         setPushed (mFlags & ToggleButton ? !mPushed : true);
       }
       else
          if (mPushed)
@@ -100,7 +149,7 @@ bool Button::mouseButtonEvent (const Vector2i & p, int button, bool down, int mo
             if (contains (p) && mCallback)
                mCallback();
             if (mFlags & NormalButton)
-               mPushed = false;
+               setPushed (false);
          }
       if (pushedBackup != mPushed && mChangeCallback)
          mChangeCallback (mPushed);
@@ -112,51 +161,45 @@ bool Button::mouseButtonEvent (const Vector2i & p, int button, bool down, int mo
 void Button::draw (NVGcontext * ctx)
 {
    Widget::draw (ctx);
-   NVGcolor gradTop = mTheme->mButtonGradientTopUnfocused;
-   NVGcolor gradBot = mTheme->mButtonGradientBotUnfocused;
-   if (mPushed)
+   /* Buttons with a background color of their own blend it with the gradient, only the others come from the atlas */
+   Theme::Skin skin = mPushed ? Theme::Skin::ButtonPushed
+                      : mMouseFocus && mEnabled ? Theme::Skin::ButtonFocused : Theme::Skin::Button;
+   if (mBackgroundColor.w() != 0 || !mTheme->drawSkin (ctx, skin, mPos.x(), mPos.y(), mSize.x(), mSize.y()))
    {
-      gradTop = mTheme->mButtonGradientTopPushed;
-      gradBot = mTheme->mButtonGradientBotPushed;
-   }
-   else
-      if (mMouseFocus && mEnabled)
+      const NVGpaint & unit = mPushed ? mTheme->mButtonPaintPushed
+                              : mMouseFocus && mEnabled ? mTheme->mButtonPaintFocused : mTheme->mButtonPaintUnfocused;
+      NVGpaint bg = Theme::placePaint (unit, mPos.x(), mPos.y(), mSize.y());
+      nvgBeginPath (ctx);
+      nvgRoundedRect (ctx, mPos.x() + 1, mPos.y() + 1.0f, mSize.x() - 2,
+                      mSize.y() - 2, mTheme->mButtonCornerRadius - 1);
+      if (mBackgroundColor.w() != 0)
       {
-         gradTop = mTheme->mButtonGradientTopFocused;
-         gradBot = mTheme->mButtonGradientBotFocused;
+         nvgFillColor (ctx, Color (mBackgroundColor.head<3>(), 1.f));
+         nvgFill (ctx);
+         if (mPushed)
+            bg.innerColor.a = bg.outerColor.a = 0.8f;
+         else
+         {
+            double v = 1 - mBackgroundColor.w();
+            bg.innerColor.a = bg.outerColor.a = mEnabled ? v : v * .5f + .5f;
+         }
       }
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + 1, mPos.y() + 1.0f, mSize.x() - 2,
-                   mSize.y() - 2, mTheme->mButtonCornerRadius - 1);
-   if (mBackgroundColor.w() != 0)
-   {
-      nvgFillColor (ctx, Color (mBackgroundColor.head<3>(), 1.f));
+      nvgFillPaint (ctx, bg);
       nvgFill (ctx);
-      if (mPushed)
-         gradTop.a = gradBot.a = 0.8f;
-      else
-      {
-         double v = 1 - mBackgroundColor.w();
-         gradTop.a = gradBot.a = mEnabled ? v : v * .5f + .5f;
-      }
+      nvgBeginPath (ctx);
+      nvgRoundedRect (ctx, mPos.x() + 0.5f, mPos.y() + (mPushed ? 0.5f : 1.5f), mSize.x() - 1,
+                      mSize.y() - 1 - (mPushed ? 0.0f : 1.0f), mTheme->mButtonCornerRadius);
+      nvgStrokeColor (ctx, mTheme->mBorderLight);
+      nvgStroke (ctx);
+      nvgBeginPath (ctx);
+      nvgRoundedRect (ctx, mPos.x() + 0.5f, mPos.y() + 0.5f, mSize.x() - 1,
+                      mSize.y() - 2, mTheme->mButtonCornerRadius);
+      nvgStrokeColor (ctx, mTheme->mBorderDark);
+      nvgStroke (ctx);
    }
-   NVGpaint bg = nvgLinearGradient (ctx, mPos.x(), mPos.y(), mPos.x(),
-                                    mPos.y() + mSize.y(), gradTop, gradBot);
-   nvgFillPaint (ctx, bg);
-   nvgFill (ctx);
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + 0.5f, mPos.y() + (mPushed ? 0.5f : 1.5f), mSize.x() - 1,
-                   mSize.y() - 1 - (mPushed ? 0.0f : 1.0f), mTheme->mButtonCornerRadius);
-   nvgStrokeColor (ctx, mTheme->mBorderLight);
-   nvgStroke (ctx);
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + 0.5f, mPos.y() + 0.5f, mSize.x() - 1,
-                   mSize.y() - 2, mTheme->mButtonCornerRadius);
-   nvgStrokeColor (ctx, mTheme->mBorderDark);
-   nvgStroke (ctx);
    int fontSize = mFontSize == -1 ? mTheme->mButtonFontSize : mFontSize;
    nvgFontSize (ctx, fontSize);
-   nvgFontFace (ctx, "sans-bold");
+   nvgFontFaceId (ctx, mTheme->mFontBold.id (ctx));
    float tw = nvgTextBounds (ctx, 0, 0, mCaption.c_str(), nullptr, nullptr);
    Vector2f center = mPos.cast<float>() + mSize.cast<float>() * 0.5f;
    Vector2f textPos (center.x() - tw * 0.5f, center.y() - 1);
@@ -166,14 +209,13 @@ void Button::draw (NVGcontext * ctx)
       textColor = mTheme->mDisabledTextColor;
    if (mIcon)
    {
-      auto icon = utf8 (mIcon);
       float iw, ih = fontSize;
       if (nvgIsFontIcon (mIcon))
       {
          ih *= 1.5f;
          nvgFontSize (ctx, ih);
-         nvgFontFace (ctx, "icons");
-         iw = nvgTextBounds (ctx, 0, 0, icon.data(), nullptr, nullptr);
+         nvgFontFaceId (ctx, mTheme->mFontIcons.id (ctx));
+         iw = nvgIconBounds (ctx, 0, 0, mIcon, nullptr);
       }
       else
       {
@@ -206,7 +248,7 @@ void Button::draw (NVGcontext * ctx)
                if (mIconPosition == IconPosition::Right)
                   iconPos.x() = mPos.x() + mSize.x() - iw - 8;
       if (nvgIsFontIcon (mIcon))
-         nvgText (ctx, iconPos.x(), iconPos.y() + 1, icon.data(), nullptr);
+         nvgIcon (ctx, iconPos.x(), iconPos.y() + 1, mIcon);
       else
       {
          NVGpaint imgPaint = nvgImagePattern (ctx,
@@ -216,7 +258,7 @@ void Button::draw (NVGcontext * ctx)
       }
    }
    nvgFontSize (ctx, fontSize);
-   nvgFontFace (ctx, "sans-bold");
+   nvgFontFaceId (ctx, mTheme->mFontBold.id (ctx));
    nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
    nvgFillColor (ctx, mTheme->mTextColorShadow);
    nvgText (ctx, textPos.x(), textPos.y(), mCaption.c_str(), nullptr);
@@ -12,9 +12,35 @@
 #pragma once
 
 #include "widget.h"
+#include "callback.h"
 
 NAMESPACE_BEGIN (nanogui)
 
+class Button;
+
+/**
+   \brief Set of radio or popup buttons of which at most one is pushed
+
+   The group remembers its pushed member, so pushing another one only releases
+   that button instead of visiting every sibling. Radio and popup buttons that
+   are not given a group share one with their siblings of the same kind, found
+   the first time they are pushed.
+*/
+class  ButtonGroup : public Object
+{
+   public:
+      /// Return the pushed member, if any
+      Button * pushed() const
+      {
+         return mPushed;
+      }
+
+   protected:
+      friend class Button;
+      Button * mPushed = nullptr;
+      bool mImplicit = false;	// shared by siblings that were not given a group
+};
+
 class  Button : public Widget
 {
    public:
@@ -44,6 +70,12 @@ class  Button : public Widget
       void setCaption (const std::string & caption)
       {
          mCaption = caption;
+         invalidateLayout();
+         searchTextChanged();
+      }
+      virtual const std::string & searchText() const
+      {
+         return mCaption;
       }
 
       const Color & backgroundColor() const
@@ -53,6 +85,7 @@ class  Button : public Widget
       void setBackgroundColor (const Color & backgroundColor)
       {
          mBackgroundColor = backgroundColor;
+         markDirty();
       }
 
       const Color & textColor() const
@@ -62,6 +95,7 @@ class  Button : public Widget
       void setTextColor (const Color & textColor)
       {
          mTextColor = textColor;
+         markDirty();
       }
 
       int icon() const
@@ -71,6 +105,7 @@ class  Button : public Widget
       void setIcon (int icon)
       {
          mIcon = icon;
+         invalidateLayout();
       }
 
       int flags() const
@@ -80,6 +115,7 @@ class  Button : public Widget
       void setFlags (int buttonFlags)
       {
          mFlags = buttonFlags;
+         markDirty();
       }
 
       IconPosition iconPosition() const
@@ -89,51 +125,57 @@ class  Button : public Widget
       void setIconPosition (IconPosition iconPosition)
       {
          mIconPosition = iconPosition;
+         markDirty();
       }
 
       bool pushed() const
       {
          return mPushed;
       }
-      void setPushed (bool pushed)
-      {
-         mPushed = pushed;
-      }
+      virtual void setPushed (bool pushed);
 
       /// Set the push callback (for any type of button)
-      std::function<void()> callback() const
+      const Callback<void()> & callback() const
       {
          return mCallback;
       }
-      void setCallback (const std::function<void()> & callback)
+      void setCallback (Callback<void()> callback)
       {
-         mCallback = callback;
+         mCallback = std::move (callback);
       }
 
       /// Set the change callback (for toggle buttons)
-      std::function<void (bool)> changeCallback() const
+      const Callback<void (bool)> & changeCallback() const
       {
          return mChangeCallback;
       }
-      void setChangeCallback (const std::function<void (bool)> & callback)
+      void setChangeCallback (Callback<void (bool)> callback)
       {
-         mChangeCallback = callback;
+         mChangeCallback = std::move (callback);
       }
 
-      /// Set the button group (for radio buttons)
-      void setButtonGroup (const std::vector<Button *> & buttonGroup)
+      /// Set the button group (for radio and popup buttons)
+      void setButtonGroup (ButtonGroup * buttonGroup);
+      /// Put this and the given buttons into a new group
+      void setButtonGroup (const std::vector<Button *> & buttonGroup);
+      /// Return the group, which is null for a radio or popup button not pushed yet unless set
+      ButtonGroup * buttonGroup()
       {
-         mButtonGroup = buttonGroup;
+         return mButtonGroup;
       }
-      const std::vector<Button *> & buttonGroup() const
+      const ButtonGroup * buttonGroup() const
       {
-         return mButtonGroup;
+         return mButtonGroup.get();
       }
 
+      virtual ~Button();
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
       virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
       virtual void draw (NVGcontext * ctx);
    protected:
+      /// Return the group, first sharing one with the siblings of the same kind if none was set
+      ButtonGroup * exclusiveGroup();
+
       std::string mCaption;
       int mIcon;
       IconPosition mIconPosition;
@@ -141,9 +183,9 @@ class  Button : public Widget
       int mFlags;
       Color mBackgroundColor;
       Color mTextColor;
-      std::function<void()> mCallback;
-      std::function<void (bool)> mChangeCallback;
-      std::vector<Button *> mButtonGroup;
+      Callback<void()> mCallback;
+      Callback<void (bool)> mChangeCallback;
+      ref<ButtonGroup> mButtonGroup;
 };
 
 NAMESPACE_END (nanogui)
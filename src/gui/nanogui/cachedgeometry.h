@@ -0,0 +1,56 @@
+/*
+    nanogui/cachedgeometry.h -- Static path that is tessellated once and
+    drawn again until the values it was built from change
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include "../nanovg/nanovg.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Owns an NVGgeometry built from a handful of values, such as a size and a radius
+
+   Shapes are best built around the origin and placed with nvgTranslate(), so
+   that moving a widget does not change the key. See nvgCreateGeometry().
+*/
+class  CachedGeometry
+{
+   public:
+      CachedGeometry() {}
+      ~CachedGeometry()
+      {
+         nvgDeleteGeometry (mGeometry);
+      }
+      CachedGeometry (const CachedGeometry &) = delete;
+      CachedGeometry & operator= (const CachedGeometry &) = delete;
+
+      /// Return the geometry for \c key, rebuilding it with \c build (which adds to a fresh path) when the key changed
+      template <typename Build> NVGgeometry * get (NVGcontext * ctx, const Vector4f & key, const Build & build)
+      {
+         if (!mGeometry || key != mKey)
+         {
+            nvgDeleteGeometry (mGeometry);
+            nvgBeginPath (ctx);
+            build();
+            mGeometry = nvgCreateGeometry (ctx);
+            mKey = key;
+         }
+         return mGeometry;
+      }
+
+   protected:
+      NVGgeometry * mGeometry = nullptr;
+      Vector4f mKey = Vector4f::Zero();
+};
+
+NAMESPACE_END (nanogui)
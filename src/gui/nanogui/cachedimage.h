@@ -0,0 +1,73 @@
+/*
+    nanogui/cachedimage.h -- Image rasterized on the CPU and drawn again
+    until the values it was built from change
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include "../nanovg/nanovg.h"
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Owns an RGBA image filled from a handful of values, such as a size and a color
+
+   The counterpart of CachedGeometry for content that would take many gradient
+   fills to draw, which then costs a single image fill per frame. The pixels are
+   only rebuilt when the key changes; a new key of the same size updates the
+   existing image instead of creating another one.
+*/
+class  CachedImage
+{
+   public:
+      CachedImage() {}
+      ~CachedImage()
+      {
+         if (mImage)
+            nvgDeleteImage (mContext, mImage);
+      }
+      CachedImage (const CachedImage &) = delete;
+      CachedImage & operator= (const CachedImage &) = delete;
+
+      /// Return the image for \c key, rebuilding it with \c build (which fills \c width x \c height
+      /// zeroed, premultiplied RGBA pixels) when the key changed
+      template <typename Build> int get (NVGcontext * ctx, const Vector4f & key, int width, int height, const Build & build)
+      {
+         if (!mImage || key != mKey || width != mWidth || height != mHeight)
+         {
+            mPixels.assign ((size_t)width * height * 4, 0);
+            build (mPixels.data());
+            if (mImage && width == mWidth && height == mHeight)
+               nvgUpdateImage (ctx, mImage, mPixels.data());
+            else
+            {
+               if (mImage)
+                  nvgDeleteImage (ctx, mImage);
+               mImage = nvgCreateImageRGBA (ctx, width, height, NVG_IMAGE_PREMULTIPLIED, mPixels.data());
+            }
+            mContext = ctx;
+            mKey = key;
+            mWidth = width;
+            mHeight = height;
+         }
+         return mImage;
+      }
+
+   protected:
+      NVGcontext * mContext = nullptr;
+      int mImage = 0;
+      int mWidth = 0, mHeight = 0;
+      Vector4f mKey = Vector4f::Zero();
+      std::vector<unsigned char> mPixels;
+};
+
+NAMESPACE_END (nanogui)
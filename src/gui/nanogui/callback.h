@@ -0,0 +1,271 @@
+/*
+    nanogui/callback.h -- Function wrapper that stores its target inline,
+    used for the callbacks of widgets
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/// Inline capacity of widget callbacks in bytes, room for a std::function and a pointer
+#if !defined(NANOGUI_CALLBACK_CAPACITY)
+#  define NANOGUI_CALLBACK_CAPACITY (10 * sizeof (void *))
+#endif
+
+NAMESPACE_BEGIN (nanogui)
+
+NAMESPACE_BEGIN (detail)
+/* Tell empty function pointers and std::functions apart, so that wrapping one gives an empty callback */
+template <typename T> bool isEmptyCallable (const T &)
+{
+   return false;
+}
+template <typename T> bool isEmptyCallable (T * f)
+{
+   return f == nullptr;
+}
+template <typename S> bool isEmptyCallable (const std::function<S> & f)
+{
+   return !f;
+}
+NAMESPACE_END (detail)
+
+template <typename Signature, size_t Capacity = NANOGUI_CALLBACK_CAPACITY> class InplaceFunction;
+
+/**
+   \brief Replacement for std::function that never allocates
+
+   The callable, e.g. a lambda and its captures, is stored in a buffer of
+   \c Capacity bytes inside the object. A callable that does not fit fails to
+   compile instead of falling back to the heap; capture less, or capture a
+   pointer to the state. Move-only callables are supported, copying a function
+   holding one throws std::logic_error.
+*/
+template <typename R, typename ... Args, size_t Capacity>
+class  InplaceFunction<R (Args...), Capacity>
+{
+   public:
+      InplaceFunction() noexcept {}
+      InplaceFunction (std::nullptr_t) noexcept {}
+
+      template <typename F, typename = typename std::enable_if <
+                   !std::is_same<typename std::decay<F>::type, InplaceFunction>::value >::type >
+      InplaceFunction (F && f)
+      {
+         typedef typename std::decay<F>::type T;
+         static_assert (sizeof (T) <= Capacity,
+                        "The callable does not fit into the inline buffer of the callback, capture less or by pointer");
+         static_assert (alignof (T) <= alignof (Storage), "The callable is over-aligned for the callback");
+         const T & target = f;	// a function decays to a pointer here
+         if (detail::isEmptyCallable (target))
+            return;
+         new (&mStorage) T (std::forward<F> (f));
+         mOps = &Ops<T>::table;
+      }
+
+      InplaceFunction (const InplaceFunction & other)
+      {
+         copyFrom (other);
+      }
+      InplaceFunction (InplaceFunction && other) noexcept
+      {
+         moveFrom (other);
+      }
+      ~InplaceFunction()
+      {
+         reset();
+      }
+
+      InplaceFunction & operator= (const InplaceFunction & other)
+      {
+         if (this != &other)
+         {
+            reset();
+            copyFrom (other);
+         }
+         return *this;
+      }
+      InplaceFunction & operator= (InplaceFunction && other) noexcept
+      {
+         if (this != &other)
+         {
+            reset();
+            moveFrom (other);
+         }
+         return *this;
+      }
+      InplaceFunction & operator= (std::nullptr_t) noexcept
+      {
+         reset();
+         return *this;
+      }
+
+      explicit operator bool() const noexcept
+      {
+         return mOps != nullptr;
+      }
+
+      R operator() (Args... args) const
+      {
+         if (!mOps)
+            throw std::bad_function_call();
+         return mOps->invoke (&mStorage, std::forward<Args> (args)...);
+      }
+
+   protected:
+      typedef typename std::aligned_storage<Capacity, alignof (std::max_align_t)>::type Storage;
+
+      struct Table
+      {
+         R (*invoke) (void * f, Args && ... args);
+         void (*copy) (void * to, const void * from);	// null for move-only callables
+         void (*move) (void * to, void * from);	// also destroys the source
+         void (*destroy) (void * f);
+      };
+
+      template <typename T> struct Ops
+      {
+         static R invoke (void * f, Args && ... args)
+         {
+            return (*static_cast<T *> (f)) (std::forward<Args> (args)...);
+         }
+         template <typename U = T>
+         static typename std::enable_if<std::is_copy_constructible<U>::value, void (*) (void *, const void *)>::type copier()
+         {
+            return [] (void * to, const void * from)
+            {
+               new (to) T (*static_cast<const T *> (from));
+            };
+         }
+         template <typename U = T>
+         static typename std::enable_if < !std::is_copy_constructible<U>::value, void (*) (void *, const void *) >::type copier()
+         {
+            return nullptr;
+         }
+         static void move (void * to, void * from)
+         {
+            new (to) T (std::move (*static_cast<T *> (from)));
+            static_cast<T *> (from)->~T();
+         }
+         static void destroy (void * f)
+         {
+            static_cast<T *> (f)->~T();
+         }
+         static const Table table;
+      };
+
+      void reset() noexcept
+      {
+         if (mOps)
+            mOps->destroy (&mStorage);
+         mOps = nullptr;
+      }
+      void copyFrom (const InplaceFunction & other)
+      {
+         if (!other.mOps)
+            return;
+         if (!other.mOps->copy)
+            throw std::logic_error ("InplaceFunction: the callable is move-only and cannot be copied");
+         other.mOps->copy (&mStorage, &other.mStorage);
+         mOps = other.mOps;
+      }
+      void moveFrom (InplaceFunction & other) noexcept
+      {
+         if (!other.mOps)
+            return;
+         other.mOps->move (&mStorage, &other.mStorage);
+         mOps = other.mOps;
+         other.mOps = nullptr;
+      }
+
+      mutable Storage mStorage;	// mutable like the target of a std::function
+      const Table * mOps = nullptr;
+};
+
+template <typename R, typename ... Args, size_t Capacity>
+template <typename T>
+const typename InplaceFunction<R (Args...), Capacity>::Table InplaceFunction<R (Args...), Capacity>::Ops<T>::table =
+{
+   &Ops<T>::invoke, Ops<T>::copier(), &Ops<T>::move, &Ops<T>::destroy
+};
+
+/// Callback of a widget
+template <typename Signature> using Callback = InplaceFunction<Signature>;
+
+/**
+   \brief Change and final callbacks of a value the user drags
+
+   By default every change is passed on at once. With \ref setPerFrame() the
+   changes are held back and only the latest one is delivered by \ref flush(),
+   which the widget calls from a poll of the screen, so that expensive
+   callbacks run at most once per frame. \ref finished() delivers a held-back
+   change and then calls the final callback exactly once per interaction.
+*/
+template <typename Arg> class  DragCallbacks
+{
+   public:
+      typedef typename std::decay<Arg>::type Value;
+
+      Callback<void (Arg)> change;
+      Callback<void (Arg)> final;
+
+      bool perFrame() const
+      {
+         return mPerFrame;
+      }
+      void setPerFrame (bool perFrame)
+      {
+         if (!perFrame)
+            flush();
+         mPerFrame = perFrame;
+      }
+
+      /// Report a new value
+      void changed (const Value & value)
+      {
+         if (!mPerFrame)
+         {
+            if (change)
+               change (value);
+            return;
+         }
+         mPending = value;
+         mHasPending = true;
+      }
+      /// Deliver the latest value held back since the last frame
+      void flush()
+      {
+         if (!mHasPending)
+            return;
+         mHasPending = false;
+         if (change)
+            change (mPending);
+      }
+      /// End the interaction with \c value
+      void finished (const Value & value)
+      {
+         flush();
+         if (final)
+            final (value);
+      }
+
+   protected:
+      Value mPending = Value();
+      bool mHasPending = false;
+      bool mPerFrame = false;
+};
+
+NAMESPACE_END (nanogui)
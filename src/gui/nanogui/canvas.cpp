@@ -0,0 +1,264 @@
+/*
+    src/canvas.cpp -- Zoomable and pannable surface of items with
+    retained shapes, culled through a spatial index
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "canvas.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NAMESPACE_BEGIN (nanogui)
+
+static const int maxCellsPerAxis = 256;
+
+CanvasItem::~CanvasItem()
+{
+   for (auto shape : mShapes)
+      nvgDeleteGeometry (shape);
+}
+
+void CanvasItem::setPosition (const Vector2f & pos)
+{
+   mPos = pos;
+   if (mCanvas)
+      mCanvas->itemsMoved();
+}
+
+void CanvasItem::setSize (const Vector2f & size)
+{
+   mSize = size;
+   invalidateShape();
+   if (mCanvas)
+      mCanvas->itemsMoved();
+}
+
+void CanvasItem::invalidateShape()
+{
+   for (auto & shape : mShapes)
+   {
+      nvgDeleteGeometry (shape);
+      shape = nullptr;
+   }
+   if (mCanvas)
+      mCanvas->markDirty();
+}
+
+void CanvasItem::shape (NVGcontext * ctx, int)
+{
+   nvgRect (ctx, 0, 0, mSize.x(), mSize.y());
+}
+
+Canvas::Canvas (Widget * parent)
+   : Widget (parent), mZoom (1.0f), mMinZoom (0.01f), mMaxZoom (100.0f), mPan (Vector2f::Zero()),
+     mIndexDirty (true), mGridOrigin (Vector2f::Zero()), mCellSize (Vector2f::Ones()),
+     mCells (Vector2i::Zero()), mStamp (0) {}
+
+Canvas::~Canvas()
+{
+   for (auto & item : mItems)
+      item->mCanvas = nullptr;
+}
+
+void Canvas::addItem (CanvasItem * item)
+{
+   if (item->mCanvas)
+      item->mCanvas->removeItem (item);
+   item->mCanvas = this;
+   mItems.push_back (item);
+   itemsMoved();
+}
+
+void Canvas::removeItem (CanvasItem * item)
+{
+   auto it = std::find (mItems.begin(), mItems.end(), item);
+   if (it == mItems.end())
+      return;
+   item->mCanvas = nullptr;
+   mItems.erase (it);
+   itemsMoved();
+}
+
+void Canvas::clear()
+{
+   for (auto & item : mItems)
+      item->mCanvas = nullptr;
+   mItems.clear();
+   itemsMoved();
+}
+
+void Canvas::setZoom (float zoom, const Vector2f & anchor)
+{
+   Vector2f point = toCanvas (anchor);
+   mZoom = std::max (mMinZoom, std::min (zoom, mMaxZoom));
+   mPan = anchor - point * mZoom;
+   markDirty();
+}
+
+void Canvas::setZoomRange (float minZoom, float maxZoom)
+{
+   mMinZoom = std::max (1e-6f, minZoom);
+   mMaxZoom = std::max (mMinZoom, maxZoom);
+   setZoom (mZoom);
+}
+
+void Canvas::buildIndex()
+{
+   mIndexDirty = false;
+   mCellStart.clear();
+   mCellItems.clear();
+   mCells = Vector2i::Zero();
+   mVisited.assign (mItems.size(), 0);
+   mStamp = 0;
+   if (mItems.empty())
+      return;
+   Vector2f lo = Vector2f::Constant (std::numeric_limits<float>::max());
+   Vector2f hi = Vector2f::Constant (-std::numeric_limits<float>::max());
+   for (auto & item : mItems)
+   {
+      lo = lo.cwiseMin (item->mPos);
+      hi = hi.cwiseMax (item->mPos + item->mSize);
+   }
+   /* Roughly one item per cell, with square-ish cells, like SpatialGrid */
+   Vector2f extent = (hi - lo).cwiseMax (Vector2f::Constant (1e-3f));
+   int count = (int) mItems.size();
+   int cx = std::max (1, std::min ((int) std::ceil (std::sqrt (count * extent.x() / extent.y())), maxCellsPerAxis));
+   int cy = std::max (1, std::min ((count + cx - 1) / cx, maxCellsPerAxis));
+   mGridOrigin = lo;
+   mCells = Vector2i (cx, cy);
+   mCellSize = Vector2f (extent.x() / cx, extent.y() / cy);
+   /* Two passes: count the entries of every cell, then fill them in item order */
+   mCellStart.assign (cx * cy + 1, 0);
+   for (int pass = 0; pass < 2; ++pass)
+   {
+      for (int i = 0; i < count; ++i)
+      {
+         const CanvasItem * item = mItems[i];
+         int x0 = std::min (cx - 1, (int) ((item->mPos.x() - lo.x()) / mCellSize.x()));
+         int y0 = std::min (cy - 1, (int) ((item->mPos.y() - lo.y()) / mCellSize.y()));
+         int x1 = std::min (cx - 1, (int) ((item->mPos.x() + item->mSize.x() - lo.x()) / mCellSize.x()));
+         int y1 = std::min (cy - 1, (int) ((item->mPos.y() + item->mSize.y() - lo.y()) / mCellSize.y()));
+         for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+            {
+               if (pass == 0)
+                  mCellStart[y * cx + x + 1]++;
+               else
+                  mCellItems[mCellStart[y * cx + x]++] = i;
+            }
+      }
+      if (pass == 0)
+      {
+         for (int c = 0; c < cx * cy; ++c)
+            mCellStart[c + 1] += mCellStart[c];
+         mCellItems.resize (mCellStart.back());
+      }
+   }
+   /* The fill pass advanced every start to the next cell's start */
+   for (int c = cx * cy; c > 0; --c)
+      mCellStart[c] = mCellStart[c - 1];
+   mCellStart[0] = 0;
+}
+
+void Canvas::query (const Vector2f & lo, const Vector2f & hi)
+{
+   mQuery.clear();
+   if (mIndexDirty)
+      buildIndex();
+   if (mCells.x() == 0)
+      return;
+   Vector2f a = (lo - mGridOrigin).cwiseQuotient (mCellSize), b = (hi - mGridOrigin).cwiseQuotient (mCellSize);
+   if (b.x() < 0 || b.y() < 0 || a.x() >= mCells.x() || a.y() >= mCells.y())
+      return;
+   int x0 = std::max (0, (int) a.x()), y0 = std::max (0, (int) a.y());
+   int x1 = std::min (mCells.x() - 1, (int) b.x()), y1 = std::min (mCells.y() - 1, (int) b.y());
+   if (++mStamp == 0)
+   {
+      std::fill (mVisited.begin(), mVisited.end(), 0);
+      mStamp = 1;
+   }
+   for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x)
+      {
+         int c = y * mCells.x() + x;
+         for (int k = mCellStart[c]; k < mCellStart[c + 1]; ++k)
+         {
+            int i = mCellItems[k];
+            if (mVisited[i] == mStamp)
+               continue;
+            mVisited[i] = mStamp;
+            const CanvasItem * item = mItems[i];
+            if (item->mPos.x() <= hi.x() && item->mPos.y() <= hi.y() &&
+                  item->mPos.x() + item->mSize.x() >= lo.x() && item->mPos.y() + item->mSize.y() >= lo.y())
+               mQuery.push_back (i);
+         }
+      }
+   std::sort (mQuery.begin(), mQuery.end());
+}
+
+CanvasItem * Canvas::itemAt (const Vector2f & p)
+{
+   query (p, p);
+   return mQuery.empty() ? nullptr : mItems[mQuery.back()].get();
+}
+
+void Canvas::itemsIn (const Vector2f & lo, const Vector2f & hi, std::vector<CanvasItem *> & result)
+{
+   query (lo, hi);
+   for (int i : mQuery)
+      result.push_back (mItems[i]);
+}
+
+bool Canvas::mouseDragEvent (const Vector2i &, const Vector2i & rel, int, int)
+{
+   setPan (mPan + rel.cast<float>());
+   return true;
+}
+
+bool Canvas::scrollEvent (const Vector2i & p, const Vector2f & rel)
+{
+   setZoom (mZoom * std::pow (1.1f, rel.y()), (p - mPos).cast<float>());
+   return true;
+}
+
+void Canvas::draw (NVGcontext * ctx)
+{
+   int level = mLevelOfDetail ? std::max (0, std::min (mLevelOfDetail (mZoom), CanvasDetailLevels - 1)) : 0;
+   nvgSave (ctx);
+   nvgIntersectScissor (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y());
+   nvgTranslate (ctx, mPos.x() + mPan.x(), mPos.y() + mPan.y());
+   nvgScale (ctx, mZoom, mZoom);
+   /* Every item is placed from the canvas transform, so that no error accumulates over the items */
+   float xform[6];
+   nvgCurrentTransform (ctx, xform);
+   drawBatches (ctx, level);
+   query (toCanvas (Vector2f::Zero()), toCanvas (mSize.cast<float>()));
+   for (int i : mQuery)
+   {
+      CanvasItem * item = mItems[i];
+      if (item->mBatched)
+         continue;
+      nvgResetTransform (ctx);
+      nvgTransform (ctx, xform[0], xform[1], xform[2], xform[3], xform[4], xform[5]);
+      nvgTranslate (ctx, item->mPos.x(), item->mPos.y());
+      NVGgeometry *& shape = item->mShapes[level];
+      if (!shape)
+      {
+         nvgBeginPath (ctx);
+         item->shape (ctx, level);
+         shape = nvgCreateGeometry (ctx);
+      }
+      item->draw (ctx, shape, level);
+   }
+   nvgRestore (ctx);
+   Widget::draw (ctx);
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,215 @@
+/*
+    nanogui/canvas.h -- Zoomable and pannable surface of items with
+    retained shapes, culled through a spatial index
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include "callback.h"
+#include "../nanovg/nanovg.h"
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+class Canvas;
+
+/// Number of levels of detail a canvas item keeps a shape for
+const int CanvasDetailLevels = 4;
+
+/**
+   \brief Something drawn on a \ref Canvas, e.g. a node of a graph or a clip of a timeline
+
+   The item builds its shape once per level of detail, in its own coordinates
+   with the origin at its position, and draws it through the retained
+   geometry it gets back. NanoVG tessellates the geometry for the zoom it is
+   drawn at and only tessellates it again once the zoom moved the edges by
+   more than its tolerance, so panning and small zoom steps cost no
+   tessellation at all.
+*/
+class  CanvasItem : public Object
+{
+      friend class Canvas;
+   public:
+      CanvasItem (const Vector2f & pos = Vector2f::Zero(), const Vector2f & size = Vector2f::Zero())
+         : mPos (pos), mSize (size) {}
+
+      /// Return the position in canvas coordinates
+      const Vector2f & position() const
+      {
+         return mPos;
+      }
+      /// Move the item; the shapes stay as they are
+      void setPosition (const Vector2f & pos);
+
+      /// Return the size in canvas coordinates, which bounds everything the item draws
+      const Vector2f & size() const
+      {
+         return mSize;
+      }
+      /// Resize the item, which builds its shapes again
+      void setSize (const Vector2f & size);
+
+      /// Build the shapes again the next time the item is drawn, e.g. after its contents changed
+      void invalidateShape();
+
+      /// Return the canvas showing the item, nullptr if none
+      Canvas * canvas() const
+      {
+         return mCanvas;
+      }
+
+      /// Return whether the canvas only indexes the item and leaves drawing it to \ref Canvas::drawBatches()
+      bool batched() const
+      {
+         return mBatched;
+      }
+
+      /**
+         \brief Add the shape of the item at \c level to the current path
+
+         Level 0 is the full detail. The default is the bounding box, which is
+         what coarse levels usually want.
+      */
+      virtual void shape (NVGcontext * ctx, int level);
+      /// Draw the item with its retained \c shape at \c level, translated to its position
+      virtual void draw (NVGcontext * ctx, NVGgeometry * shape, int level) = 0;
+
+   protected:
+      virtual ~CanvasItem();
+
+      Canvas * mCanvas = nullptr;
+      bool mBatched = false;
+      Vector2f mPos, mSize;
+      NVGgeometry * mShapes[CanvasDetailLevels] = {};
+};
+
+/**
+   \brief Surface of items under a zoom and pan transform
+
+   Items are indexed in a uniform grid over their rectangles, rebuilt the next
+   time the canvas is drawn after items were added, removed or moved. Drawing
+   only visits the items overlapping the visible area, in the order they were
+   added, and gives them the level of detail the callback picks for the
+   current zoom, so that e.g. nodes become plain boxes when zoomed far out.
+
+   Dragging pans and scrolling zooms around the cursor.
+
+   \code
+   Canvas * canvas = new Canvas (window);
+   canvas->setLevelOfDetail ([] (float zoom) { return zoom < 0.4f ? 1 : 0; });
+   for (auto & node : graph.nodes)
+      canvas->addItem (new NodeItem (node));
+   \endcode
+*/
+class  Canvas : public Widget
+{
+   public:
+      Canvas (Widget * parent);
+      ~Canvas();
+
+      /// Add an item on top of the others
+      void addItem (CanvasItem * item);
+      /// Remove an item
+      void removeItem (CanvasItem * item);
+      /// Remove all items
+      void clear();
+      /// Return the items, bottom first
+      const std::vector<ref<CanvasItem>> & items() const
+      {
+         return mItems;
+      }
+
+      /// Return the zoom, the size of one canvas unit in pixels
+      float zoom() const
+      {
+         return mZoom;
+      }
+      /// Set the zoom, keeping the canvas point under \c anchor, in widget coordinates, in place
+      void setZoom (float zoom, const Vector2f & anchor = Vector2f::Zero());
+      /// Limit the zoom to [\c minZoom, \c maxZoom]
+      void setZoomRange (float minZoom, float maxZoom);
+
+      /// Return the widget coordinates of the canvas origin
+      const Vector2f & pan() const
+      {
+         return mPan;
+      }
+      /// Set the widget coordinates of the canvas origin
+      void setPan (const Vector2f & pan)
+      {
+         mPan = pan;
+         markDirty();
+      }
+
+      /// Convert widget coordinates to canvas coordinates
+      Vector2f toCanvas (const Vector2f & p) const
+      {
+         return (p - mPan) / mZoom;
+      }
+      /// Convert canvas coordinates to widget coordinates
+      Vector2f fromCanvas (const Vector2f & p) const
+      {
+         return p * mZoom + mPan;
+      }
+
+      /// Set the function returning the level of detail for a zoom, from 0 to \ref CanvasDetailLevels - 1
+      void setLevelOfDetail (Callback<int (float zoom)> levelOfDetail)
+      {
+         mLevelOfDetail = std::move (levelOfDetail);
+         markDirty();
+      }
+
+      /// The topmost item containing \c p in canvas coordinates, nullptr if none
+      CanvasItem * itemAt (const Vector2f & p);
+      /// Append the items overlapping the canvas rectangle [\c lo, \c hi] to \c result, bottom first
+      void itemsIn (const Vector2f & lo, const Vector2f & hi, std::vector<CanvasItem *> & result);
+
+      /// Mark the spatial index stale, called by the items when they move
+      void itemsMoved()
+      {
+         mIndexDirty = true;
+         markDirty();
+      }
+
+      virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual bool scrollEvent (const Vector2i & p, const Vector2f & rel);
+      virtual void draw (NVGcontext * ctx);
+
+   protected:
+      /**
+         \brief Draw what many items share in a few calls, below the items
+
+         Called with the canvas transform in place. Batched items, see
+         \ref CanvasItem::batched(), are only drawn here.
+      */
+      virtual void drawBatches (NVGcontext *, int) { }
+      /// Rebuild the grid over the item rectangles
+      void buildIndex();
+      /// Indices of the items overlapping [\c lo, \c hi] into mQuery, ascending
+      void query (const Vector2f & lo, const Vector2f & hi);
+
+      std::vector<ref<CanvasItem>> mItems;
+      Callback<int (float zoom)> mLevelOfDetail;
+      float mZoom, mMinZoom, mMaxZoom;
+      Vector2f mPan;
+
+      /* Spatial index, see buildIndex() */
+      bool mIndexDirty;
+      Vector2f mGridOrigin, mCellSize;
+      Vector2i mCells;
+      std::vector<int> mCellStart;	// mCells.prod() + 1 offsets into mCellItems
+      std::vector<int> mCellItems;
+      std::vector<unsigned int> mVisited;	// query stamp per item, reports items spanning several cells once
+      unsigned int mStamp;
+      std::vector<int> mQuery;
+};
+
+NAMESPACE_END (nanogui)
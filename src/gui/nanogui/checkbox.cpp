@@ -17,9 +17,9 @@
 NAMESPACE_BEGIN (nanogui)
 
 CheckBox::CheckBox (Widget * parent, const std::string & caption,
-                    const std::function<void (bool) > & callback)
+                    Callback<void (bool)> callback)
    : Widget (parent), mCaption (caption), mPushed (false), mChecked (false),
-     mCallback (callback) { }
+     mCallback (std::move (callback)) { }
 
 bool CheckBox::mouseButtonEvent (const Vector2i & p, int button, bool down,
                                  int modifiers)
@@ -49,10 +49,10 @@ bool CheckBox::mouseButtonEvent (const Vector2i & p, int button, bool down,
 
 Vector2i CheckBox::preferredSize (NVGcontext * ctx) const
 {
-   if (mFixedSize != Vector2i::Zero())
-      return mFixedSize;
+   if (fixedSize() != Vector2i::Zero())
+      return fixedSize();
    nvgFontSize (ctx, fontSize());
-   nvgFontFace (ctx, "sans");
+   nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
    return Vector2i (
              nvgTextBounds (ctx, 0, 0, mCaption.c_str(), nullptr, nullptr) +
              1.7f * fontSize(),
@@ -63,31 +63,32 @@ void CheckBox::draw (NVGcontext * ctx)
 {
    Widget::draw (ctx);
    nvgFontSize (ctx, fontSize());
-   nvgFontFace (ctx, "sans");
+   nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
    nvgFillColor (ctx,
                  mEnabled ? mTheme->mTextColor : mTheme->mDisabledTextColor);
    nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
    nvgText (ctx, mPos.x() + 1.2f * mSize.y() + 5, mPos.y() + mSize.y() * 0.5f,
             mCaption.c_str(), nullptr);
-   NVGpaint bg = nvgBoxGradient (ctx, mPos.x() + 1.5f, mPos.y() + 1.5f,
-                                 mSize.y() - 2.0f, mSize.y() - 2.0f, 3, 3,
-                                 mPushed ? Color (0, 100) : Color (0, 32),
-                                 Color (0, 0, 0, 180));
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + 1.0f, mPos.y() + 1.0f, mSize.y() - 2.0f,
-                   mSize.y() - 2.0f, 3);
-   nvgFillPaint (ctx, bg);
-   nvgFill (ctx);
+   if (!mTheme->drawSkin (ctx, mPushed ? Theme::Skin::CheckBoxPushed : Theme::Skin::CheckBox,
+                          mPos.x(), mPos.y(), mSize.y(), mSize.y()))
+   {
+      NVGpaint bg = nvgBoxGradient (ctx, mPos.x() + 1.5f, mPos.y() + 1.5f,
+                                    mSize.y() - 2.0f, mSize.y() - 2.0f, 3, 3,
+                                    mPushed ? Color (0, 100) : Color (0, 32),
+                                    Color (0, 0, 0, 180));
+      nvgFillPaint (ctx, bg);
+      nvgDrawRoundedRectSDF (ctx, mPos.x() + 1.0f, mPos.y() + 1.0f, mSize.y() - 2.0f,
+                             mSize.y() - 2.0f, 3);
+   }
    if (mChecked)
    {
       nvgFontSize (ctx, 1.8 * mSize.y());
-      nvgFontFace (ctx, "icons");
+      nvgFontFaceId (ctx, mTheme->mFontIcons.id (ctx));
       nvgFillColor (ctx, mEnabled ? mTheme->mIconColor
                     : mTheme->mDisabledTextColor);
       nvgTextAlign (ctx, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
-      nvgText (ctx, mPos.x() + mSize.y() * 0.5f + 1,
-               mPos.y() + mSize.y() * 0.5f, utf8 (ENTYPO_ICON_CHECK).data(),
-               nullptr);
+      nvgIcon (ctx, mPos.x() + mSize.y() * 0.5f + 1,
+               mPos.y() + mSize.y() * 0.5f, ENTYPO_ICON_CHECK);
    }
 }
 
@@ -12,6 +12,7 @@
 #pragma once
 
 #include "widget.h"
+#include "callback.h"
 
 NAMESPACE_BEGIN (nanogui)
 
@@ -19,7 +20,7 @@ class  CheckBox : public Widget
 {
    public:
       CheckBox (Widget * parent, const std::string & caption = "Untitled",
-                const std::function<void (bool)> & callback = std::function<void (bool)>());
+                Callback<void (bool)> callback = nullptr);
 
       const std::string & caption() const
       {
@@ -28,6 +29,12 @@ class  CheckBox : public Widget
       void setCaption (const std::string & caption)
       {
          mCaption = caption;
+         invalidateLayout();
+         searchTextChanged();
+      }
+      virtual const std::string & searchText() const
+      {
+         return mCaption;
       }
 
       const bool & checked() const
@@ -37,6 +44,7 @@ class  CheckBox : public Widget
       void setChecked (const bool & checked)
       {
          mChecked = checked;
+         markDirty();
       }
 
       const bool & pushed() const
@@ -46,15 +54,16 @@ class  CheckBox : public Widget
       void setPushed (const bool & pushed)
       {
          mPushed = pushed;
+         markDirty();
       }
 
-      std::function<void (bool)> callback() const
+      const Callback<void (bool)> & callback() const
       {
          return mCallback;
       }
-      void setCallback (const std::function<void (bool)> & callback)
+      void setCallback (Callback<void (bool)> callback)
       {
-         mCallback = callback;
+         mCallback = std::move (callback);
       }
 
       virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
@@ -63,7 +72,7 @@ class  CheckBox : public Widget
    protected:
       std::string mCaption;
       bool mPushed, mChecked;
-      std::function<void (bool)> mCallback;
+      Callback<void (bool)> mCallback;
 };
 
 NAMESPACE_END (nanogui)
@@ -44,6 +44,11 @@ ColorPicker::ColorPicker (Widget * parent, const Color & color) : PopupButton (p
    });
 }
 
+void ColorPicker::setCallbackPerFrame (bool perFrame)
+{
+   mColorWheel->setCallbackPerFrame (perFrame);
+}
+
 Color ColorPicker::color() const
 {
    return backgroundColor();
@@ -23,22 +23,25 @@ class  ColorPicker : public PopupButton
       ColorPicker (Widget * parent, const Color & color = { 1.f, 0.f, 0.f, 1.f });
 
       /// Set the change callback
-      std::function<void (const Color &)> callback() const
+      const Callback<void (const Color &)> & callback() const
       {
          return mCallback;
       }
-      void setCallback (const std::function<void (const Color &)> & callback)
+      void setCallback (Callback<void (const Color &)> callback)
       {
-         mCallback = callback;
+         mCallback = std::move (callback);
       }
 
+      /// Limit the preview of the wheel while dragging to one update per frame, see ColorWheel::setCallbackPerFrame()
+      void setCallbackPerFrame (bool perFrame);
+
       /// Get the current color
       Color color() const;
       /// Set the current color
       void setColor (const Color & color);
 
    protected:
-      std::function<void (const Color &)> mCallback;
+      Callback<void (const Color &)> mCallback;
       ColorWheel * mColorWheel;
       Button * mPickButton;
 };
@@ -13,6 +13,7 @@
 
 #include "colorwheel.h"
 #include "theme.h"
+#include "screen.h"
 #include "../nanovg/nanovg.h"
 #include "../eigen/Eigen/QR"
 #include "../eigen/Eigen/Geometry"
@@ -30,6 +31,75 @@ Vector2i ColorWheel::preferredSize (NVGcontext *) const
    return { 100, 100. };
 }
 
+namespace
+{
+   void putPixel (unsigned char * p, float r, float g, float b, float a)
+   {
+      p[0] = (unsigned char) (std::min (r, 1.0f) * 255.0f + 0.5f);
+      p[1] = (unsigned char) (std::min (g, 1.0f) * 255.0f + 0.5f);
+      p[2] = (unsigned char) (std::min (b, 1.0f) * 255.0f + 0.5f);
+      p[3] = (unsigned char) (std::min (a, 1.0f) * 255.0f + 0.5f);
+   }
+
+   float coverage (float d)
+   {
+      return std::min (std::max (d + 0.5f, 0.0f), 1.0f);
+   }
+
+   /* Hue ring between the radii r0 and r1 (in pixels) around the center of a size x size image,
+      with the one pixel outlines the wheel used to stroke on both edges */
+   void rasterRing (unsigned char * pixels, int size, float r0, float r1, float scale)
+   {
+      float c = size * 0.5f, outline = 64.0f / 255.0f;
+      for (int y = 0; y < size; ++y)
+         for (int x = 0; x < size; ++x)
+         {
+            float dx = x + 0.5f - c, dy = y + 0.5f - c, d = std::sqrt (dx * dx + dy * dy);
+            float cover = coverage (d - r0) * coverage (r1 - d);
+            float hue = std::atan2 (dy, dx) / (2.0f * NVG_PI);
+            NVGcolor col = nvgHSLA (hue < 0.0f ? hue + 1.0f : hue, 1.0f, 0.55f, 255);
+            float line = std::max (coverage (0.5f * scale - std::abs (d - (r0 - 0.5f * scale))),
+                                   coverage (0.5f * scale - std::abs (d - (r1 + 0.5f * scale))));
+            float oa = outline * std::min (line, 1.0f), keep = 1.0f - oa;
+            putPixel (&pixels[((size_t)y * size + x) * 4], col.r * cover * keep, col.g * cover * keep, col.b * cover * keep,
+                      cover + oa * (1.0f - cover));
+         }
+   }
+
+   /* Triangle with the hue at (r, 0) and white and black at +-120 degrees, in a size x size image
+      centered on the wheel; the colors mix linearly like the selection in adjustPosition() */
+   void rasterTriangle (unsigned char * pixels, int size, float r, float scale, const NVGcolor & hue)
+   {
+      Vector2f v[3] = { { r, 0.0f },
+         { std::cos (120.0f / 180.0f * NVG_PI) * r, std::sin (120.0f / 180.0f * NVG_PI) * r },
+         { std::cos (-120.0f / 180.0f * NVG_PI) * r, std::sin (-120.0f / 180.0f * NVG_PI) * r } };
+      float area = (v[1] - v[0]).x() * (v[2] - v[0]).y() - (v[1] - v[0]).y() * (v[2] - v[0]).x();
+      float c = size * 0.5f;
+      for (int y = 0; y < size; ++y)
+         for (int x = 0; x < size; ++x)
+         {
+            Vector2f q ((x + 0.5f - c) / scale, (y + 0.5f - c) / scale);
+            float l[3], inside = 1e6f;
+            for (int i = 0; i < 3; ++i)
+            {
+               const Vector2f & a = v[(i + 1) % 3], & b = v[(i + 2) % 3];
+               /* Barycentric weight of vertex i, and the distance to the opposite edge */
+               float cross = (b - a).x() * (q - a).y() - (b - a).y() * (q - a).x();
+               l[i] = cross / area;
+               inside = std::min (inside, cross / (b - a).norm() * scale);
+            }
+            float cover = coverage (inside);
+            if (cover <= 0.0f)
+               continue;
+            float h = std::max (l[0], 0.0f), w = std::max (l[1], 0.0f), sum = h + std::max (l[2], 0.0f) + w;
+            h /= sum;
+            w /= sum;
+            putPixel (&pixels[((size_t)y * size + x) * 4], (hue.r * h + w) * cover, (hue.g * h + w) * cover,
+                      (hue.b * h + w) * cover, cover);
+         }
+   }
+}
+
 void ColorWheel::draw (NVGcontext * ctx)
 {
    Widget::draw (ctx);
@@ -40,8 +110,7 @@ void ColorWheel::draw (NVGcontext * ctx)
          w = mSize.x(),
          h = mSize.y();
    NVGcontext * vg = ctx;
-   int i;
-   float r0, r1, ax, ay, bx, by, cx, cy, aeps, r;
+   float r0, r1, ax, ay, bx, by, cx, cy, r;
    float hue = mHue;
    NVGpaint paint;
    nvgSave (vg);
@@ -49,34 +118,29 @@ void ColorWheel::draw (NVGcontext * ctx)
    cy = y + h * 0.5f;
    r1 = (w < h ? w : h) * 0.5f - 5.0f;
    r0 = r1 * .75f;
-   aeps = 0.5f / r1;   // half a pixel arc length in radians (2pi cancels out).
-   for (i = 0; i < 6; i++)
+   if (r1 <= 0.0f)
    {
-      float a0 = (float)i / 6.0f * NVG_PI * 2.0f - aeps;
-      float a1 = (float) (i + 1.0f) / 6.0f * NVG_PI * 2.0f + aeps;
-      nvgBeginPath (vg);
-      nvgArc (vg, cx, cy, r0, a0, a1, NVG_CW);
-      nvgArc (vg, cx, cy, r1, a1, a0, NVG_CCW);
-      nvgClosePath (vg);
-      ax = cx + cosf (a0) * (r0 + r1) * 0.5f;
-      ay = cy + sinf (a0) * (r0 + r1) * 0.5f;
-      bx = cx + cosf (a1) * (r0 + r1) * 0.5f;
-      by = cy + sinf (a1) * (r0 + r1) * 0.5f;
-      paint = nvgLinearGradient (vg, ax, ay, bx, by,
-                                 nvgHSLA (a0 / (NVG_PI * 2), 1.0f, 0.55f, 255),
-                                 nvgHSLA (a1 / (NVG_PI * 2), 1.0f, 0.55f, 255));
-      nvgFillPaint (vg, paint);
-      nvgFill (vg);
+      nvgRestore (vg);
+      return;
    }
+   // The ring and the triangle are images at the resolution of the current transform, drawn around the center
+   float xform[6];
+   nvgCurrentTransform (vg, xform);
+   float scale = std::max ((std::sqrt (xform[0] * xform[0] + xform[1] * xform[1]) +
+                            std::sqrt (xform[2] * xform[2] + xform[3] * xform[3])) * 0.5f, 0.1f);
+   nvgTranslate (vg, cx, cy);
+   int size = (int)std::ceil ((r1 + 2.0f) * 2.0f * scale);
+   int ring = mRingImage.get (vg, Vector4f (r0, r1, scale, 0), size, size, [&] (unsigned char * pixels)
+   {
+      rasterRing (pixels, size, r0 * scale, r1 * scale, scale);
+   });
+   float half = size * 0.5f / scale;
    nvgBeginPath (vg);
-   nvgCircle (vg, cx, cy, r0 - 0.5f);
-   nvgCircle (vg, cx, cy, r1 + 0.5f);
-   nvgStrokeColor (vg, nvgRGBA (0, 0, 0, 64));
-   nvgStrokeWidth (vg, 1.0f);
-   nvgStroke (vg);
+   nvgRect (vg, -half, -half, 2 * half, 2 * half);
+   nvgFillPaint (vg, nvgImagePattern (vg, -half, -half, 2 * half, 2 * half, 0, ring, 1.0f));
+   nvgFill (vg);
    // Selector
    nvgSave (vg);
-   nvgTranslate (vg, cx, cy);
    nvgRotate (vg, hue * NVG_PI * 2);
    // Marker on
    float u = std::max (r1 / 50, 1.5f);
@@ -93,27 +157,26 @@ void ColorWheel::draw (NVGcontext * ctx)
    nvgPathWinding (vg, NVG_HOLE);
    nvgFillPaint (vg, paint);
    nvgFill (vg);
-   // Center triangle
+   // Center triangle, drawn in the rotated frame so that only a new hue rebuilds it
    r = r0 - 6;
    ax = cosf (120.0f / 180.0f * NVG_PI) * r;
    ay = sinf (120.0f / 180.0f * NVG_PI) * r;
    bx = cosf (-120.0f / 180.0f * NVG_PI) * r;
    by = sinf (-120.0f / 180.0f * NVG_PI) * r;
+   int triSize = (int)std::ceil ((r + 2.0f) * 2.0f * scale);
+   int triangle = mTriangleImage.get (vg, Vector4f (r, scale, hue, 0), triSize, triSize, [&] (unsigned char * pixels)
+   {
+      rasterTriangle (pixels, triSize, r, scale, nvgHSLA (hue, 1.0f, 0.5f, 255));
+   });
+   half = triSize * 0.5f / scale;
    nvgBeginPath (vg);
    nvgMoveTo (vg, r, 0);
    nvgLineTo (vg, ax, ay);
    nvgLineTo (vg, bx, by);
    nvgClosePath (vg);
-   paint = nvgLinearGradient (vg, r, 0, ax, ay, nvgHSLA (hue, 1.0f, 0.5f, 255),
-                              nvgRGBA (255, 255, 255, 255));
-   nvgFillPaint (vg, paint);
-   nvgFill (vg);
-   paint = nvgLinearGradient (vg, (r + ax) * 0.5f, (0 + ay) * 0.5f, bx, by,
-                              nvgRGBA (0, 0, 0, 0), nvgRGBA (0, 0, 0, 255));
-   nvgFillPaint (vg, paint);
-   nvgFill (vg);
+   nvgFillPaint (vg, nvgImagePattern (vg, -half, -half, 2 * half, 2 * half, 0, triangle, 1.0f));
    nvgStrokeColor (vg, nvgRGBA (0, 0, 0, 64));
-   nvgStroke (vg);
+   nvgFillStroke (vg);
    // Select circle on triangle
    float sx = r * (1 - mWhite - mBlack) + ax * mWhite + bx * mBlack;
    float sy =                           ay * mWhite + by * mBlack;
@@ -139,17 +202,39 @@ bool ColorWheel::mouseButtonEvent (const Vector2i & p, int button, bool down,
    }
    else
    {
+      if (mDragRegion != None)
+         mCallbacks.finished (color());
       mDragRegion = None;
       return true;
    }
 }
 
+void ColorWheel::setCallbackPerFrame (bool perFrame)
+{
+   mCallbacks.setPerFrame (perFrame);
+   if (perFrame && !mFlushPoll)
+   {
+      mFlushPoll = std::make_shared<std::function<void()>> ([this]() { mCallbacks.flush(); });
+      if (Screen * screen = this->screen())
+         screen->addPoll (mFlushPoll);
+   }
+}
+
 bool ColorWheel::mouseDragEvent (const Vector2i & p, const Vector2i &,
                                  int, int)
 {
    return adjustPosition (p, mDragRegion) != None;
 }
 
+bool ColorWheel::mouseDragSamplesEvent (const std::vector<PointerSample> & samples, const Vector2i &, int, int)
+{
+   /* The callback follows the whole stroke, the wheel is drawn once for it */
+   bool handled = false;
+   for (const PointerSample & sample : samples)
+      handled = adjustPosition (sample.pos, mDragRegion) != None || handled;
+   return handled;
+}
+
 ColorWheel::Region ColorWheel::adjustPosition (const Vector2i & p, Region consideredRegions)
 {
    float x = p.x() - mPos.x(),
@@ -172,8 +257,7 @@ ColorWheel::Region ColorWheel::adjustPosition (const Vector2i & p, Region consid
       if (x < 0)
          mHue += NVG_PI;
       mHue /= 2 * NVG_PI;
-      if (mCallback)
-         mCallback (color());
+      mCallbacks.changed (color());
       return OuterCircle;
    }
    float r = r0 - 6;
@@ -207,8 +291,7 @@ ColorWheel::Region ColorWheel::adjustPosition (const Vector2i & p, Region consid
       l1 /= sum;
       mWhite = l0;
       mBlack = l1;
-      if (mCallback)
-         mCallback (color());
+      mCallbacks.changed (color());
       return InnerTriangle;
    }
    return None;
@@ -14,24 +14,44 @@
 #pragma once
 
 #include "widget.h"
+#include "callback.h"
+#include "cachedimage.h"
+#include <memory>
 
 NAMESPACE_BEGIN (nanogui)
 
-class  ColorWheel : public Widget
+class  ColorWheel final : public Widget
 {
    public:
       ColorWheel (Widget * parent, const Color & color = { 1.f, 0.f, 0.f, 1.f });
 
       /// Set the change callback
-      std::function<void (const Color &)> callback() const
+      const Callback<void (const Color &)> & callback() const
       {
-         return mCallback;
+         return mCallbacks.change;
       }
-      void setCallback (const std::function<void (const Color &)> & callback)
+      void setCallback (Callback<void (const Color &)> callback)
       {
-         mCallback = callback;
+         mCallbacks.change = std::move (callback);
       }
 
+      /// Set a function called once when the user releases the wheel
+      const Callback<void (const Color &)> & finalCallback() const
+      {
+         return mCallbacks.final;
+      }
+      void setFinalCallback (Callback<void (const Color &)> callback)
+      {
+         mCallbacks.final = std::move (callback);
+      }
+
+      /// Return whether the change callback runs at most once per frame with the latest color while dragging
+      bool callbackPerFrame() const
+      {
+         return mCallbacks.perFrame();
+      }
+      void setCallbackPerFrame (bool perFrame);
+
       /// Get the current color
       Color color() const;
       /// Set the current color
@@ -39,8 +59,15 @@ class  ColorWheel : public Widget
 
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
       virtual void draw (NVGcontext * ctx);
+      /// The cached image is an object of the context drawn with
+      virtual bool threadSafeDraw() const
+      {
+         return false;
+      }
       virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
       virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual bool mouseDragSamplesEvent (const std::vector<PointerSample> & samples, const Vector2i & rel, int button,
+                                          int modifiers);
 
    private:
       enum Region
@@ -59,7 +86,10 @@ class  ColorWheel : public Widget
       float mWhite;
       float mBlack;
       Region mDragRegion;
-      std::function<void (const Color &)> mCallback;
+      DragCallbacks<const Color &> mCallbacks;
+      std::shared_ptr<std::function<void()>> mFlushPoll;	// delivers held-back changes, see Screen::addPoll()
+      /// Hue ring with its outline, rebuilt on resize, and the triangle, rebuilt when the hue changes
+      CachedImage mRingImage, mTriangleImage;
 };
 
 NAMESPACE_END (nanogui)
@@ -11,64 +11,218 @@
 
 #include "combobox.h"
 #include "layout.h"
+#include "theme.h"
+#include "vlistpanel.h"
+#include "../nanovg/nanovg.h"
 #include <cassert>
+#include <cctype>
+#include <cmath>
 
 NAMESPACE_BEGIN (nanogui)
 
-ComboBox::ComboBox (Widget * parent) : PopupButton (parent), mSelectedIndex (0)
+ComboBox::ComboBox (Widget * parent)
+   : PopupButton (parent), mSelectedIndex (0), mHighlightIndex (0), mVisibleItems (10),
+     mListWidth (-1), mList (nullptr)
 {
 }
 
+Popup * ComboBox::createPopup()
+{
+   Popup * popup = PopupButton::createPopup();
+   popup->setLayout (new GroupLayout (10));
+   mList = new VListPanel (popup);
+   mList->setRowFactory ([] (Widget * parent)
+   {
+      Button * button = new Button (parent, "");
+      button->setFlags (Button::RadioButton);
+      return button;
+   });
+   mList->setRowBinder ([this] (Widget * row, int index)
+   {
+      Button * button = (Button *) row;
+      button->setCaption (mItems.str (index));
+      button->setPushed (index == mHighlightIndex);
+      button->setCallback ([this, index]
+      {
+         selectItem (index);
+      });
+   });
+   mList->setItemCount (mItems.size());
+   mListWidth = -1;
+   resizeList();
+   return popup;
+}
+
 ComboBox::ComboBox (Widget * parent, const std::vector<std::string> & items)
-   : PopupButton (parent), mSelectedIndex (0)
+   : ComboBox (parent)
 {
    setItems (items);
 }
 
 ComboBox::ComboBox (Widget * parent, const std::vector<std::string> & items, const std::vector<std::string> & itemsShort)
-   : PopupButton (parent), mSelectedIndex (0)
+   : ComboBox (parent)
 {
    setItems (items, itemsShort);
 }
 
 void ComboBox::setSelectedIndex (int idx)
 {
-   if (mItemsShort.empty())
+   if (idx < 0 || idx >= mItems.size())
       return;
-   const std::vector<Widget *> & children = popup()->children();
-   ((Button *) children[mSelectedIndex])->setPushed (false);
-   ((Button *) children[idx])->setPushed (true);
    mSelectedIndex = idx;
-   setCaption (mItemsShort[idx]);
+   mHighlightIndex = idx;
+   setCaption (itemsShort().str (idx));
+   if (mList)
+      mList->refresh();
 }
 
 void ComboBox::setItems (const std::vector<std::string> & items, const std::vector<std::string> & itemsShort)
 {
    assert (items.size() == itemsShort.size());
-   mItems = items;
-   mItemsShort = itemsShort;
+   mItems.assign (items);
+   if (itemsShort == items)
+      mItemsShort.clear();
+   else
+      mItemsShort.assign (itemsShort);
    if (mSelectedIndex < 0 || mSelectedIndex >= (int) items.size())
       mSelectedIndex = 0;
-   while (mPopup->childCount() != 0)
-      mPopup->removeChild (mPopup->childCount() - 1);
-   mPopup->setLayout (new GroupLayout (10));
-   int index = 0;
-   for (const auto & str : items)
+   if (mList)
    {
-      Button * button = new Button (mPopup, str);
-      button->setFlags (Button::RadioButton);
-      button->setCallback ([ &, index]
-      {
-         mSelectedIndex = index;
-         setCaption (mItemsShort[index]);
-         setPushed (false);
-         popup()->setVisible (false);
-         if (mCallback)
-            mCallback (index);
-      });
-      index++;
+      mList->setItemCount (mItems.size());
+      mListWidth = -1;
+      resizeList();
    }
    setSelectedIndex (mSelectedIndex);
 }
 
+void ComboBox::setVisibleItems (int count)
+{
+   mVisibleItems = std::max (1, count);
+   resizeList();
+}
+
+void ComboBox::resizeList()
+{
+   if (!mList)
+      return;
+   mList->setFixedHeight (std::min (mItems.size(), mVisibleItems) * mList->rowHeight());
+   mPopup->invalidateLayout();
+}
+
+void ComboBox::draw (NVGcontext * ctx)
+{
+   if (mPushed && mList && mListWidth < 0)
+      measureList (ctx);
+   PopupButton::draw (ctx);
+}
+
+void ComboBox::measureList (NVGcontext * ctx)
+{
+   /* The popup is as wide as the widest item, measured once per item list */
+   nvgFontSize (ctx, mTheme->mButtonFontSize);
+   nvgFontFaceId (ctx, mTheme->mFontBold.id (ctx));
+   float widest = 0.0f;
+   for (int i = 0; i < mItems.size(); ++i)
+      widest = std::max (widest, nvgTextBounds (ctx, 0, 0, mItems[i], mItems[i] + mItems.length (i), nullptr));
+   mListWidth = (int) std::ceil (widest) + 20 + 12;
+   mList->setFixedWidth (mListWidth);
+   mPopup->invalidateLayout();
+}
+
+void ComboBox::highlightItem (int index)
+{
+   mHighlightIndex = index;
+   mList->refresh();
+   mList->scrollToItem (index);
+}
+
+void ComboBox::selectItem (int index)
+{
+   mSelectedIndex = index;
+   mHighlightIndex = index;
+   setCaption (itemsShort().str (index));
+   setPushed (false);
+   popup()->setVisible (false);
+   if (mList)
+      mList->refresh();
+   if (mCallback)
+      mCallback (index);
+}
+
+int ComboBox::findItem (const std::string & prefix, int from) const
+{
+   int count = mItems.size();
+   for (int n = 0; n < count; ++n)
+   {
+      int index = (from + n) % count;
+      if (mItems.length (index) < prefix.size())
+         continue;
+      const char * item = mItems[index];
+      size_t i = 0;
+      while (i < prefix.size() && std::tolower ((unsigned char) item[i]) == std::tolower ((unsigned char) prefix[i]))
+         ++i;
+      if (i == prefix.size())
+         return index;
+   }
+   return -1;
+}
+
+bool ComboBox::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
+{
+   bool pushed = mPushed;
+   bool result = PopupButton::mouseButtonEvent (p, button, down, modifiers);
+   if (!pushed && mPushed)
+   {
+      mSearch.clear();
+      highlightItem (mSelectedIndex);
+   }
+   return result;
+}
+
+bool ComboBox::keyboardEvent (int key, int scancode, int action, int modifiers)
+{
+   if (!mPushed || mItems.empty() || (action != PRESS && action != REPEAT))
+      return PopupButton::keyboardEvent (key, scancode, action, modifiers);
+   int last = mItems.size() - 1;
+   if (key == KEY_UP || key == KEY_DOWN || key == KEY_PAGEUP || key == KEY_PAGEDOWN)
+   {
+      int step = key == KEY_UP || key == KEY_DOWN ? 1 : mVisibleItems;
+      int index = mHighlightIndex + (key == KEY_UP || key == KEY_PAGEUP ? -step : step);
+      highlightItem (std::max (0, std::min (index, last)));
+   }
+   else
+      if (key == KEY_HOME || key == KEY_END)
+         highlightItem (key == KEY_HOME ? 0 : last);
+      else
+         if (key == KEY_RETURN || key == KEY_KP_ENTER)
+            selectItem (mHighlightIndex);
+         else
+            if (key == KEY_ESCAPE)
+            {
+               setPushed (false);
+               popup()->setVisible (false);
+               markDirty();
+            }
+            else
+               return false;
+   return true;
+}
+
+bool ComboBox::keyboardCharacterEvent (unsigned int codepoint)
+{
+   if (!mPushed || mItems.empty())
+      return PopupButton::keyboardCharacterEvent (codepoint);
+   auto now = std::chrono::steady_clock::now();
+   if (now - mSearchTime > std::chrono::seconds (1))
+      mSearch.clear();
+   mSearchTime = now;
+   std::string typed = utf8 (codepoint).data();
+   mSearch += typed;
+   /* A longer prefix may still match the highlighted item, a fresh one looks behind it */
+   int index = findItem (mSearch, mSearch == typed ? mHighlightIndex + 1 : mHighlightIndex);
+   if (index >= 0)
+      highlightItem (index);
+   return true;
+}
+
 NAMESPACE_END (nanogui)
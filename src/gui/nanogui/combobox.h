@@ -12,9 +12,21 @@
 #pragma once
 
 #include "popupbutton.h"
+#include "stringtable.h"
+#include <chrono>
 
 NAMESPACE_BEGIN (nanogui)
 
+class VListPanel;
+
+/**
+   \brief Popup button choosing one of a list of items
+
+   The items are kept in string tables and the popup shows them in a
+   VListPanel, so only the visible rows have a button, however long the list.
+   While the popup is open, typing jumps to the next item starting with the
+   typed text, the arrow keys move the highlighted item and return selects it.
+*/
 class  ComboBox : public PopupButton
 {
    public:
@@ -31,13 +43,13 @@ class  ComboBox : public PopupButton
       ComboBox (Widget * parent, const std::vector<std::string> & items,
                 const std::vector<std::string> & itemsShort);
 
-      std::function<void (int)> callback() const
+      const Callback<void (int)> & callback() const
       {
          return mCallback;
       }
-      void setCallback (const std::function<void (int)> & callback)
+      void setCallback (Callback<void (int)> callback)
       {
-         mCallback = callback;
+         mCallback = std::move (callback);
       }
 
       int selectedIndex() const
@@ -51,18 +63,53 @@ class  ComboBox : public PopupButton
       {
          setItems (items, items);
       }
-      const std::vector<std::string> & items() const
+      const StringTable & items() const
       {
          return mItems;
       }
-      const std::vector<std::string> & itemsShort() const
+      /// Return the short labels, which are the items themselves unless given separately
+      const StringTable & itemsShort() const
       {
-         return mItemsShort;
+         return mItemsShort.empty() ? mItems : mItemsShort;
       }
+
+      /// Return the number of items the popup shows without scrolling
+      int visibleItems() const
+      {
+         return mVisibleItems;
+      }
+      void setVisibleItems (int count);
+
+      virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
+      virtual bool keyboardEvent (int key, int scancode, int action, int modifiers);
+      virtual bool keyboardCharacterEvent (unsigned int codepoint);
+      virtual void draw (NVGcontext * ctx);
+
    protected:
-      std::vector<std::string> mItems, mItemsShort;
-      std::function<void (int)> mCallback;
+      /// Create the popup with the list of items
+      virtual Popup * createPopup();
+      /// Size the list in the popup for the item count, its width is measured when it is opened
+      void resizeList();
+      /// Make the list as wide as the widest item
+      void measureList (NVGcontext * ctx);
+      /// Highlight an item of the open popup and scroll it into view
+      void highlightItem (int index);
+      /// Select an item from the popup, close it and notify the callback
+      void selectItem (int index);
+      /// Return the first item from \c from on (wrapping around) starting with \c prefix, ignoring
+      /// the case of ASCII letters, or -1
+      int findItem (const std::string & prefix, int from) const;
+
+      StringTable mItems, mItemsShort;	// mItemsShort is empty when equal to mItems
+      Callback<void (int)> mCallback;
       int mSelectedIndex;
+      int mHighlightIndex;	// item pushed in the popup
+      int mVisibleItems;
+      int mListWidth;	// -1 until measured
+      VListPanel * mList;	// null until the popup is created
+      // Type-ahead search, restarted after a pause
+      std::string mSearch;
+      std::chrono::steady_clock::time_point mSearchTime;
 };
 
 NAMESPACE_END (nanogui)
@@ -0,0 +1,217 @@
+/*
+    src/commandpalette.cpp -- Popup for jumping to any widget of a screen
+    by typing part of its caption or id
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "commandpalette.h"
+#include "screen.h"
+#include "theme.h"
+#include "../nanovg/nanovg.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+static const int Margin = 8;
+
+CommandPalette::SearchBox::SearchBox (CommandPalette * palette)
+   : TextBox (palette, ""), mPalette (palette)
+{
+   setEditable (true);
+   setAlignment (Alignment::Left);
+}
+
+bool CommandPalette::SearchBox::keyboardEvent (int key, int scancode, int action, int modifiers)
+{
+   if (focused() && (action == PRESS || action == REPEAT))
+   {
+      int rows = mPalette->rowCount();
+      switch (key)
+      {
+         case KEY_UP:
+            mPalette->mSelected = std::max (mPalette->mSelected - 1, 0);
+            mPalette->markDirty();
+            return true;
+         case KEY_DOWN:
+            mPalette->mSelected = std::max (std::min (mPalette->mSelected + 1, rows - 1), 0);
+            mPalette->markDirty();
+            return true;
+         case KEY_RETURN:
+         case KEY_KP_ENTER:
+            mPalette->choose (mPalette->mSelected);
+            return true;
+         case KEY_ESCAPE:
+            mPalette->close();
+            return true;
+         default:
+            break;
+      }
+   }
+   bool handled = TextBox::keyboardEvent (key, scancode, action, modifiers);
+   edited();
+   return handled;
+}
+
+bool CommandPalette::SearchBox::keyboardCharacterEvent (unsigned int codepoint)
+{
+   bool handled = TextBox::keyboardCharacterEvent (codepoint);
+   edited();
+   return handled;
+}
+
+void CommandPalette::SearchBox::edited()
+{
+   /* Cursor keys get here too, setQuery() does nothing for the same text */
+   mPalette->setQuery (mValueTemp);
+}
+
+CommandPalette::CommandPalette (Widget * parent, int maxRows)
+   : Window (parent, ""), mMaxRows (std::max (maxRows, 1))
+{
+   mBox = new SearchBox (this);
+   setVisible (false);
+}
+
+void CommandPalette::open()
+{
+   mBox->setValue ("");
+   mQuery.clear();
+   mSelected = 0;
+   mRows.clear();
+   setVisible (true);
+   center();
+   mBox->requestFocus();
+   fitRows();
+}
+
+void CommandPalette::close()
+{
+   if (Screen * screen = this->screen())
+      screen->updateFocus (nullptr);
+   setVisible (false);
+}
+
+void CommandPalette::setQuery (const std::string & query)
+{
+   Screen * screen = this->screen();
+   if (!screen || query == mQuery)
+      return;
+   mQuery = query;
+   if (query.empty())
+   {
+      mRows.clear();
+      mSelected = 0;
+      fitRows();
+      return;
+   }
+   screen->searchIndex().search (query, mMatches, mMaxRows + 1);
+   mRows.clear();
+   for (const WidgetSearch::Match & match : mMatches)
+   {
+      /* Never offer the palette itself */
+      if (match.widget->window() == this || (int) mRows.size() == mMaxRows)
+         continue;
+      mRows.push_back (Row { match.widget, *match.text });
+   }
+   mSelected = 0;
+   fitRows();
+}
+
+void CommandPalette::fitRows()
+{
+   /* The window grows and shrinks with the number of matches, below the search box */
+   if (mBox->height() == 0)
+      return;
+   int height = mBox->position().y() + mBox->height() + Margin / 2 + (int) mRows.size() * rowHeight() + Margin;
+   if (height != mSize.y())
+      setSize (Vector2i (mSize.x(), height));
+   markDirty();
+}
+
+void CommandPalette::choose (int index)
+{
+   if (index < 0 || index >= (int) mRows.size())
+      return;
+   ref<Widget> widget = mRows[index].widget;
+   close();
+   /* The widget may have been removed since the query */
+   if (Screen * screen = this->screen())
+      if (widget->screen() == screen)
+         screen->revealWidget (widget);
+}
+
+int CommandPalette::rowHeight() const
+{
+   return (int) (fontSize() * 1.4f);
+}
+
+int CommandPalette::rowAt (const Vector2i & p) const
+{
+   int top = mBox->position().y() + mBox->height() + Margin / 2;
+   if (p.y() < top || p.x() < 0 || p.x() >= mSize.x())
+      return -1;
+   int row = (p.y() - top) / rowHeight();
+   return row < (int) mRows.size() ? row : -1;
+}
+
+bool CommandPalette::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
+{
+   if (button == MOUSE_BUTTON_LEFT && down)
+   {
+      int row = rowAt (p - mPos);
+      if (row >= 0)
+      {
+         choose (row);
+         return true;
+      }
+   }
+   return Window::mouseButtonEvent (p, button, down, modifiers);
+}
+
+Vector2i CommandPalette::preferredSize (NVGcontext * ctx) const
+{
+   int boxHeight = mBox->cachedPreferredSize (ctx).y();
+   return Vector2i (420, Margin * 2 + boxHeight + Margin / 2 + (int) mRows.size() * rowHeight());
+}
+
+void CommandPalette::performLayout (NVGcontext * ctx)
+{
+   mBox->setPosition (Vector2i (Margin, Margin));
+   mBox->setSize (Vector2i (mSize.x() - Margin * 2, mBox->cachedPreferredSize (ctx).y()));
+   mBox->performLayout (ctx);
+}
+
+void CommandPalette::draw (NVGcontext * ctx)
+{
+   Window::draw (ctx);
+   if (mRows.empty())
+      return;
+   int rh = rowHeight(), top = mBox->position().y() + mBox->height() + Margin / 2;
+   nvgSave (ctx);
+   nvgTranslate (ctx, mPos.x(), mPos.y());
+   nvgIntersectScissor (ctx, 0, 0, mSize.x(), mSize.y());
+   nvgFontSize (ctx, fontSize());
+   nvgFontFace (ctx, "sans");
+   nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+   for (int i = 0; i < (int) mRows.size(); ++i)
+   {
+      float y = (float) (top + i * rh);
+      if (i == mSelected)
+      {
+         nvgBeginPath (ctx);
+         nvgRoundedRect (ctx, Margin / 2, y, mSize.x() - Margin, rh, 3);
+         nvgFillColor (ctx, mTheme->mButtonGradientTopFocused);
+         nvgFill (ctx);
+      }
+      nvgFillColor (ctx, mTheme->mTextColor);
+      nvgText (ctx, Margin, y + rh * 0.5f, mRows[i].text.c_str(), nullptr);
+   }
+   nvgRestore (ctx);
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,95 @@
+/*
+    nanogui/commandpalette.h -- Popup for jumping to any widget of a screen
+    by typing part of its caption or id
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "window.h"
+#include "textbox.h"
+#include "widgetsearch.h"
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Command palette over the \ref Screen::searchIndex() of its screen
+
+   Every keystroke queries the index again; the best matches are listed below
+   the search box as plain text rows, so the palette adds no widgets to the
+   index. Up and Down pick a row, Enter or a click reveals its widget through
+   \ref Screen::revealWidget() and closes the palette, Escape closes it.
+   Create it once and call \ref open() from a keyboard shortcut.
+*/
+class  CommandPalette : public Window
+{
+   public:
+      CommandPalette (Widget * parent, int maxRows = 10);
+
+      /// Show the palette centered on the screen, with an empty query and the search box focused
+      void open();
+      /// Hide the palette
+      void close();
+
+      /// Search for \c query and list the best matches
+      void setQuery (const std::string & query);
+      /// Reveal the widget listed at row \c index and close the palette
+      void choose (int index);
+
+      /// Return the number of rows listed for the current query
+      int rowCount() const
+      {
+         return (int) mRows.size();
+      }
+
+      virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
+      virtual void performLayout (NVGcontext * ctx);
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual void draw (NVGcontext * ctx);
+
+   protected:
+      /// Text box reporting every edit and handing the navigation keys to the palette
+      class SearchBox : public TextBox
+      {
+         public:
+            SearchBox (CommandPalette * palette);
+
+            virtual bool keyboardEvent (int key, int scancode, int action, int modifiers);
+            virtual bool keyboardCharacterEvent (unsigned int codepoint);
+
+         protected:
+            /// Query again when the text being edited changed
+            void edited();
+
+            CommandPalette * mPalette;
+      };
+
+      /// Return the row at \c p, relative to the palette, or -1
+      int rowAt (const Vector2i & p) const;
+      int rowHeight() const;
+      /// Resize the palette to the rows listed
+      void fitRows();
+
+      /// Match copied out of the index, which may change before the palette is drawn
+      struct Row
+      {
+         ref<Widget> widget;
+         std::string text;
+      };
+
+      SearchBox * mBox;
+      int mMaxRows;
+      int mSelected = 0;
+      std::string mQuery;
+      std::vector<Row> mRows;
+      std::vector<WidgetSearch::Match> mMatches;	// scratch of setQuery()
+};
+
+NAMESPACE_END (nanogui)
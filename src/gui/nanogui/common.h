@@ -12,6 +12,7 @@
 #pragma once
 
 #include "../eigen/Eigen/Core"
+#include "vec.h"
 #include <stdint.h>
 #include <array>
 #include <vector>
@@ -31,6 +32,8 @@
 struct NVGcontext;
 struct NVGcolor;
 struct NVGglyphPosition;
+struct NVGdrawList;
+struct NVGparagraph;
 
 NAMESPACE_BEGIN (nanogui)
 
@@ -94,6 +97,8 @@ class Color : public Eigen::Vector4f
 
       Color (int r, int g, int b, int a) : Color (Vector4i (r, g, b, a)) { }
 
+      Color (const RGBA & c) : Color (c.r, c.g, c.b, c.a) { }
+
       /// Construct a color vector from MatrixBase (needed to play nice with Eigen)
       template <typename Derived> Color (const Eigen::MatrixBase<Derived> & p)
          : Base (p) { }
@@ -142,6 +147,12 @@ class Color : public Eigen::Vector4f
          return Color (luminance < 0.5f ? 1.f : 0.f, 1.f);
       }
 
+      /// View the color as the plain \ref RGBA used by the hot paths
+      const RGBA & rgba() const
+      {
+         return reinterpret_cast<const RGBA &> (*this);
+      }
+
       inline operator const NVGcolor & () const
       {
          return reinterpret_cast<const NVGcolor &> (*this);
@@ -154,6 +165,9 @@ template <typename T> class ref;
 class AdvancedGridLayout;
 class BoxLayout;
 class Button;
+class CachedGeometry;
+class Canvas;
+class CanvasItem;
 class CheckBox;
 class ColorWheel;
 class ColorPicker;
@@ -166,17 +180,24 @@ class ImagePanel;
 class Label;
 class Layout;
 class MessageDialog;
+class NodeEditor;
 class Object;
 class Popup;
 class PopupButton;
 class ProgressBar;
 class Screen;
 class Slider;
+class SpatialGrid;
 class TextBox;
 class Theme;
 class ToolButton;
+class VectorIcon;
+class VListPanel;
 class VScrollPanel;
+class Waterfall;
 class Widget;
+class WidgetArena;
+class WidgetSearch;
 class Window;
 
 /// Determine whether an icon ID is a texture loaded via nvgImageIcon
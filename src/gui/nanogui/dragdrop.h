@@ -0,0 +1,83 @@
+/*
+    nanogui/dragdrop.h -- Payloads dragged between widgets, materialized
+    only when they are dropped
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "object.h"
+#include "callback.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+NAMESPACE_BEGIN (nanogui)
+
+class Widget;
+
+/// Data of a dropped payload, the drop target knows its type from \ref DragPayload::type
+typedef std::shared_ptr<void> DragData;
+
+/**
+   \brief Description of what is being dragged, without the data itself
+
+   A drag source fills it in when a drag starts, which has to be cheap: only
+   the type, a description and the expected size are known then. The data is
+   produced by \ref provider once the payload is dropped on a target that
+   accepts it, and never for a drag that is cancelled or ends elsewhere. With
+   \ref async set the provider runs on a thread of its own through
+   \ref Screen::runAsync(), so that e.g. reading a full resolution image does
+   not stall the GUI; the target receives the data on the GUI thread.
+
+   The cursor is followed by a preview: \ref previewImage at \ref previewSize
+   if one is given, otherwise \ref previewWidget, recorded once into a draw
+   list when the drag starts and replayed at the cursor on every frame.
+*/
+struct DragPayload
+{
+   /// Kind of data, e.g. "image" or "cue", matched by the drop targets
+   std::string type;
+   /// Shown to the user and available to the targets before the data is
+   std::string description;
+   /// Expected size of the data in bytes, 0 if unknown
+   size_t size = 0;
+   /// Identifies the dragged item within the source, e.g. an index
+   int item = -1;
+   /// Produce the data on drop; may throw, the target then receives empty data
+   std::function<DragData()> provider;
+   /// Run the provider on a worker thread
+   bool async = false;
+
+   /// NanoVG image drawn under the cursor, e.g. the thumbnail of the dragged image
+   int previewImage = 0;
+   Vector2i previewSize = Vector2i::Zero();
+   /// Widget whose rendering follows the cursor when there is no preview image
+   ref<Widget> previewWidget;
+};
+
+/// Fill in the payload of a drag starting at \c p, in the coordinates of the parent of the source. Return false to not drag
+typedef Callback<bool (const Vector2i & p, DragPayload & payload)> DragSource;
+
+/**
+   \brief Widget receiving dropped payloads
+
+   The target is found under the cursor, going up from the widget there to
+   the first ancestor whose \ref accepts returns true. Positions are in the
+   coordinates of the parent of the target, like those of mouse events.
+*/
+struct DropTarget
+{
+   /// Return whether a drop of \c payload at \c p would be taken, called while the cursor moves
+   Callback<bool (const DragPayload & payload, const Vector2i & p)> accepts;
+   /// Take the data of \c payload dropped at \c p; \c data is empty when the provider failed
+   Callback<void (const DragPayload & payload, DragData data, const Vector2i & p)> drop;
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,295 @@
+/*
+    src/drawinspector.cpp -- Debug overlay of the draw and layout cost of
+    every widget
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "drawinspector.h"
+
+#ifdef NANOGUI_DRAW_INSPECTOR
+
+#include "widget.h"
+#include "numberformat.h"
+#include "../nanovg/nanovg.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <typeinfo>
+#if defined(__GNUC__)
+   #include <cxxabi.h>
+#endif
+
+NAMESPACE_BEGIN (nanogui)
+
+typedef std::chrono::steady_clock Clock;
+
+/* Weight of a frame in the averages, and frames after which a widget not seen is forgotten */
+static const double frameWeight = 1.0 / 30.0;
+static const int forgetFrames = 300;
+
+/* A widget being measured, whose children are taken off its cost */
+struct OpenScope
+{
+   const Widget * widget;
+   Clock::time_point start;
+   int drawCalls, triangles;
+   float rect[4];
+   double childTime;
+   int childDrawCalls, childTriangles;
+};
+
+static thread_local std::vector<OpenScope> drawStack, layoutStack;
+
+static std::string typeName (const Widget * widget)
+{
+   const char * name = typeid (*widget).name();
+   std::string result = name;
+#if defined(__GNUC__)
+   int status = 0;
+   if (char * demangled = abi::__cxa_demangle (name, nullptr, nullptr, &status))
+   {
+      result = demangled;
+      std::free (demangled);
+   }
+#endif
+   for (const char * prefix : { "class ", "nanogui::" })
+   {
+      size_t n = std::strlen (prefix);
+      if (result.compare (0, n, prefix) == 0)
+         result.erase (0, n);
+   }
+   return result;
+}
+
+DrawInspector::DrawScope::DrawScope (const Widget * widget, NVGcontext * ctx)
+   : ctx (DrawInspector::instance().enabled() ? ctx : nullptr)
+{
+   if (!this->ctx)
+      return;
+   OpenScope open = { widget, Clock::now(), nvgDrawCallCount (ctx), nvgTriangleCount (ctx), { 0, 0, 0, 0 }, 0.0, 0, 0 };
+   /* The screen space bounds, like the culling of Widget::draw() */
+   float xf[6];
+   nvgCurrentTransform (ctx, xf);
+   float hw = widget->width() * 0.5f, hh = widget->height() * 0.5f;
+   float cx = widget->position().x() + hw, cy = widget->position().y() + hh;
+   float sx = xf[0] * cx + xf[2] * cy + xf[4], sy = xf[1] * cx + xf[3] * cy + xf[5];
+   float ex = std::abs (xf[0]) * hw + std::abs (xf[2]) * hh;
+   float ey = std::abs (xf[1]) * hw + std::abs (xf[3]) * hh;
+   open.rect[0] = sx - ex;
+   open.rect[1] = sy - ey;
+   open.rect[2] = sx + ex;
+   open.rect[3] = sy + ey;
+   drawStack.push_back (open);
+}
+
+DrawInspector::DrawScope::~DrawScope()
+{
+   if (!ctx)
+      return;
+   OpenScope open = drawStack.back();
+   drawStack.pop_back();
+   double time = std::chrono::duration<double> (Clock::now() - open.start).count();
+   int drawCalls = nvgDrawCallCount (ctx) - open.drawCalls, triangles = nvgTriangleCount (ctx) - open.triangles;
+   if (!drawStack.empty())
+   {
+      OpenScope & parent = drawStack.back();
+      parent.childTime += time;
+      parent.childDrawCalls += drawCalls;
+      parent.childTriangles += triangles;
+   }
+   DrawInspector & inspector = DrawInspector::instance();
+   std::lock_guard<std::mutex> lock (inspector.mMutex);
+   Entry & e = inspector.entry (open.widget);
+   e.frameDrawTime += time - open.childTime;
+   e.frameDrawCalls += drawCalls - open.childDrawCalls;
+   e.frameTriangles += triangles - open.childTriangles;
+   std::copy (open.rect, open.rect + 4, e.rect);
+   e.lastFrame = inspector.mFrame;
+}
+
+DrawInspector::LayoutScope::LayoutScope (const Widget * widget)
+   : active (DrawInspector::instance().enabled())
+{
+   if (!active)
+      return;
+   OpenScope open = { widget, Clock::now(), 0, 0, { 0, 0, 0, 0 }, 0.0, 0, 0 };
+   layoutStack.push_back (open);
+}
+
+DrawInspector::LayoutScope::~LayoutScope()
+{
+   if (!active)
+      return;
+   OpenScope open = layoutStack.back();
+   layoutStack.pop_back();
+   double time = std::chrono::duration<double> (Clock::now() - open.start).count();
+   if (!layoutStack.empty())
+      layoutStack.back().childTime += time;
+   DrawInspector & inspector = DrawInspector::instance();
+   std::lock_guard<std::mutex> lock (inspector.mMutex);
+   Entry & e = inspector.entry (open.widget);
+   e.frameLayoutTime += time - open.childTime;
+   e.lastFrame = inspector.mFrame;
+}
+
+DrawInspector & DrawInspector::instance()
+{
+   static DrawInspector inspector;
+   return inspector;
+}
+
+void DrawInspector::setEnabled (bool enabled)
+{
+   mEnabled = enabled;
+   if (!enabled)
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mEntries.clear();
+   }
+}
+
+DrawInspector::Entry & DrawInspector::entry (const Widget * widget)
+{
+   Entry & e = mEntries[widget];
+   if (e.type.empty())
+   {
+      e.type = typeName (widget);
+      e.id = widget->id();
+   }
+   return e;
+}
+
+void DrawInspector::endFrame()
+{
+   if (!enabled())
+      return;
+   std::lock_guard<std::mutex> lock (mMutex);
+   for (auto it = mEntries.begin(); it != mEntries.end();)
+   {
+      Entry & e = it->second;
+      if (mFrame - e.lastFrame > forgetFrames)
+      {
+         it = mEntries.erase (it);
+         continue;
+      }
+      e.drawTime += (e.frameDrawTime - e.drawTime) * frameWeight;
+      e.layoutTime += (e.frameLayoutTime - e.layoutTime) * frameWeight;
+      e.drawCalls += (float) ((e.frameDrawCalls - e.drawCalls) * frameWeight);
+      e.triangles += (float) ((e.frameTriangles - e.triangles) * frameWeight);
+      e.peakDrawTime = std::max (e.peakDrawTime, e.frameDrawTime);
+      e.frameDrawTime = e.frameLayoutTime = 0.0;
+      e.frameDrawCalls = e.frameTriangles = 0;
+      ++it;
+   }
+   ++mFrame;
+}
+
+double DrawInspector::value (const Entry & e) const
+{
+   switch (mSortKey)
+   {
+      case SortKey::LayoutTime:
+         return e.layoutTime;
+      case SortKey::DrawCalls:
+         return e.drawCalls;
+      case SortKey::Triangles:
+         return e.triangles;
+      default:
+         return e.drawTime;
+   }
+}
+
+std::vector<const DrawInspector::Entry *> DrawInspector::ranking() const
+{
+   std::vector<const Entry *> result;
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      result.reserve (mEntries.size());
+      for (auto & entry : mEntries)
+         result.push_back (&entry.second);
+   }
+   std::sort (result.begin(), result.end(), [this] (const Entry * a, const Entry * b)
+   {
+      return value (*a) > value (*b);
+   });
+   return result;
+}
+
+void DrawInspector::drawOverlay (NVGcontext * ctx, float width, float)
+{
+   std::vector<const Entry *> entries = ranking();
+   nvgSave (ctx);
+   nvgReset (ctx);
+   /* Heat map of the widgets drawn in this frame, relative to the most expensive one */
+   double peak = 0.0;
+   for (const Entry * e : entries)
+   {
+      if (e->lastFrame == mFrame)
+         peak = std::max (peak, e->drawTime);
+   }
+   for (const Entry * e : entries)
+   {
+      if (e->lastFrame != mFrame || peak <= 0.0 || e->drawTime <= 0.0)
+         continue;
+      nvgBeginPath (ctx);
+      nvgRect (ctx, e->rect[0], e->rect[1], e->rect[2] - e->rect[0], e->rect[3] - e->rect[1]);
+      nvgFillColor (ctx, nvgRGBA (255, 0, 0, (unsigned char) (160.0 * e->drawTime / peak)));
+      nvgFill (ctx);
+   }
+   int font = nvgFindFont (ctx, "sans");
+   int rows = std::min ((int)entries.size(), mTopCount);
+   if (font < 0 || rows == 0)
+   {
+      nvgRestore (ctx);
+      return;
+   }
+   /* The list of the most expensive widgets, the sorted column is marked */
+   static const char * headers[] = { "draw ms", "layout ms", "calls", "tris" };
+   const float rowHeight = 16.0f, nameWidth = 200.0f, columnWidth = 64.0f;
+   float w = nameWidth + 4 * columnWidth + 6, x = width - w - 10, y = 10;
+   nvgBeginPath (ctx);
+   nvgRect (ctx, x, y, w, (rows + 1) * rowHeight + 4);
+   nvgFillColor (ctx, nvgRGBA (0, 0, 0, 192));
+   nvgFill (ctx);
+   nvgFontFaceId (ctx, font);
+   nvgFontSize (ctx, 14.0f);
+   nvgTextAlign (ctx, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP);
+   for (int c = 0; c < 4; ++c)
+   {
+      nvgFillColor (ctx, c == (int)mSortKey ? nvgRGBA (255, 192, 0, 255) : nvgRGBA (240, 240, 240, 192));
+      nvgText (ctx, x + nameWidth + (c + 1) * columnWidth, y + 2, headers[c], nullptr);
+   }
+   char str[NumberBufferSize];
+   nvgFillColor (ctx, nvgRGBA (240, 240, 240, 255));
+   for (int i = 0; i < rows; ++i)
+   {
+      const Entry * e = entries[i];
+      float ry = y + 2 + (i + 1) * rowHeight;
+      std::string name = e->id.empty() ? e->type : e->type + " " + e->id;
+      nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+      nvgSave (ctx);
+      nvgIntersectScissor (ctx, x, ry, nameWidth, rowHeight);
+      nvgText (ctx, x + 4, ry, name.c_str(), nullptr);
+      nvgRestore (ctx);
+      nvgTextAlign (ctx, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP);
+      double values[4] = { e->drawTime * 1000.0, e->layoutTime * 1000.0, e->drawCalls, e->triangles };
+      for (int c = 0; c < 4; ++c)
+      {
+         formatFloat (str, values[c], NumberFormat::Fixed, c < 2 ? 3 : 0);
+         nvgText (ctx, x + nameWidth + (c + 1) * columnWidth, ry, str, nullptr);
+      }
+   }
+   nvgRestore (ctx);
+}
+
+NAMESPACE_END (nanogui)
+
+#endif
@@ -0,0 +1,154 @@
+/*
+    nanogui/drawinspector.h -- Debug overlay of the draw and layout cost of
+    every widget
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+/* The inspector is compiled in only when NANOGUI_DRAW_INSPECTOR is defined, otherwise the
+   INSPECT_* macros expand to nothing and DrawInspector does not exist */
+#ifdef NANOGUI_DRAW_INSPECTOR
+
+#include "common.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct NVGcontext;
+
+NAMESPACE_BEGIN (nanogui)
+
+class Widget;
+
+/**
+   \brief Measures what every widget costs to draw and to lay out
+
+   While enabled, \ref Widget::draw() times each child it draws and counts
+   the NanoVG draw calls and triangles the child submitted, and
+   \ref Widget::performLayout() times each widget it lays out. The cost of
+   the children is taken off, so every widget is charged for its own work
+   only. A retained widget replaying its recording is charged for the
+   replay, the widgets inside the recording are not seen. The costs are
+   averaged over the frames at the end of every \ref Screen::drawWidgets().
+
+   The overlay tints every widget drawn in the frame red by its share of the
+   most expensive one and lists the costliest widgets in the top right
+   corner, sorted by \ref sortKey(). The screen repaints fully every frame
+   while the inspector is enabled, so that the overlay does not stay behind
+   in partial repaints.
+
+   \code
+   DrawInspector::instance().setEnabled (true);
+   DrawInspector::instance().setSortKey (DrawInspector::SortKey::Triangles);
+   \endcode
+*/
+class  DrawInspector
+{
+   public:
+      enum class SortKey
+      {
+         DrawTime,
+         LayoutTime,
+         DrawCalls,
+         Triangles
+      };
+
+      /// Cost of one widget, per frame and without its children, averaged over the frames
+      struct Entry
+      {
+         std::string type;	// class of the widget
+         std::string id;
+         float rect[4];	// screen space bounds when last drawn
+         double drawTime = 0, layoutTime = 0;	// seconds
+         double peakDrawTime = 0;
+         float drawCalls = 0, triangles = 0;
+         int lastFrame = 0;	// last frame the widget was drawn or laid out
+         /* Accumulated while the frame is open */
+         double frameDrawTime = 0, frameLayoutTime = 0;
+         int frameDrawCalls = 0, frameTriangles = 0;
+      };
+
+      /// Times a widget drawn by \ref Widget::draw()
+      struct DrawScope
+      {
+         DrawScope (const Widget * widget, NVGcontext * ctx);
+         ~DrawScope();
+         NVGcontext * ctx;
+      };
+      /// Times a widget laid out by \ref Widget::performLayout()
+      struct LayoutScope
+      {
+         LayoutScope (const Widget * widget);
+         ~LayoutScope();
+         bool active;
+      };
+
+      static DrawInspector & instance();
+
+      void setEnabled (bool enabled);
+      bool enabled() const
+      {
+         return mEnabled.load (std::memory_order_relaxed);
+      }
+
+      SortKey sortKey() const
+      {
+         return mSortKey;
+      }
+      void setSortKey (SortKey sortKey)
+      {
+         mSortKey = sortKey;
+      }
+      /// Set how many widgets the list of the overlay shows
+      void setTopCount (int count)
+      {
+         mTopCount = count;
+      }
+      int topCount() const
+      {
+         return mTopCount;
+      }
+
+      /// Average the costs of the frame into the entries, forget widgets not seen for a while
+      void endFrame();
+      /// Draw the heat map and the list over the widgets, inside an open NanoVG frame
+      void drawOverlay (NVGcontext * ctx, float width, float height);
+
+      /// Return the entries, sorted by \ref sortKey(), most expensive first
+      std::vector<const Entry *> ranking() const;
+
+   private:
+      DrawInspector() = default;
+
+      /// The entry of a widget, with mMutex locked
+      Entry & entry (const Widget * widget);
+      double value (const Entry & entry) const;
+
+      std::atomic<bool> mEnabled { false };
+      SortKey mSortKey = SortKey::DrawTime;
+      int mTopCount = 12;
+      mutable std::mutex mMutex;	// layouts run on pool threads
+      std::unordered_map<const Widget *, Entry> mEntries;
+      int mFrame = 1;
+};
+
+NAMESPACE_END (nanogui)
+
+#define INSPECT_DRAW(widget, ctx) nanogui::DrawInspector::DrawScope inspectDrawScope (widget, ctx)
+#define INSPECT_LAYOUT(widget) nanogui::DrawInspector::LayoutScope inspectLayoutScope (widget)
+
+#else
+
+#define INSPECT_DRAW(widget, ctx)
+#define INSPECT_LAYOUT(widget)
+
+#endif
@@ -19,14 +19,64 @@
 #include "combobox.h"
 #include "colorpicker.h"
 #include "layout.h"
+#include "property.h"
 #include <cassert>
+#include <memory>
+#include <tuple>
+#include <utility>
 
 NAMESPACE_BEGIN (nanogui)
 
 NAMESPACE_BEGIN (detail)
 template <typename T, typename sfinae = std::true_type> class FormWidget { };
+template <typename S, typename Fields> class StructForm;
 NAMESPACE_END (detail)
 
+/// Member of a struct shown by \ref FormHelper::addStruct(), with the label of its row
+template <typename S, typename T> struct FormField
+{
+   typedef T Type;
+   T S::* member;
+   const char * label;
+};
+
+template <typename S, typename T> FormField<S, T> makeFormField (T S::* member, const char * label)
+{
+   return FormField<S, T> { member, label };
+}
+
+/**
+   \brief Compile-time list of the members of \c S shown by \ref FormHelper::addStruct()
+
+   Specialized with \ref NANOGUI_FORM_STRUCT, \c fields() returns a tuple of
+   \ref FormField in the order of the rows.
+*/
+template <typename S> struct FormFields;
+
+/**
+   \brief List the members of a struct for \ref FormHelper::addStruct()
+
+   Use at global scope with the fully qualified struct name:
+
+   <pre>
+   NANOGUI_FORM_STRUCT (app::Settings,
+                        NANOGUI_FORM_FIELD (samples, "Samples"),
+                        NANOGUI_FORM_FIELD (gamma, "Gamma"))
+   </pre>
+*/
+#define NANOGUI_FORM_STRUCT(Struct, ...) \
+   namespace nanogui { \
+      template <> struct FormFields<Struct> \
+      { \
+         typedef Struct Type; \
+         static auto fields() \
+         { \
+            return std::make_tuple (__VA_ARGS__); \
+         } \
+      }; \
+   }
+#define NANOGUI_FORM_FIELD(member, label) nanogui::makeFormField (&Type::member, label)
+
 /**
    \brief Convenience class to create simple AntTweakBar-style layouts that
          expose variables of various types using NanoGUI widgets
@@ -56,14 +106,26 @@ NAMESPACE_END (detail)
    // add a new button
    h->addButton("Button",[&](){ std::cout << "Button pressed" << std::endl; });
    </pre>
+
+   Variables exposed by reference or getter are polled by \ref refresh(), or by
+   \ref refreshVisible() for the windows currently shown. Variables held in a
+   \ref Property tell the helper when they change, and \ref refreshChanged()
+   only updates the widgets of those.
 */
 
-class FormHelper
+class FormHelper : public PropertyObserver
 {
    public:
       /// Create a helper class to construct NanoGUI widgets on the given screen
       FormHelper (Screen * screen) : mScreen (screen) { }
 
+      ~FormHelper()
+      {
+         for (auto & binding : mBindings)
+            if (binding.property)
+               binding.property->setObserver (nullptr, -1);
+      }
+
       /// Add a new top-level window
       Window * addWindow (const Vector2i & pos,
                           const std::string & title = "Untitled")
@@ -79,6 +141,35 @@ class FormHelper
          return mWindow;
       }
 
+      /**
+         \brief Reserve room for the next \c variables rows of the current window
+
+         Building a form with hundreds of variables then grows the child list,
+         the grid rows and anchors and the refresh callbacks once. Nothing is laid
+         out while the rows are added; \ref endBatch() lays out the window a single
+         time, and later shows reuse that layout until its content changes. Wrap
+         the batch in a WidgetArena::Scope to also allocate the labels and widgets
+         in bulk.
+      */
+      void beginBatch (int variables)
+      {
+         mWindow->reserveChildren (2 * variables);
+         mLayout->reserve (2 * variables, 2 * variables);
+         if (mRefreshGroups.empty() || mRefreshGroups.back().window != mWindow)
+            mRefreshGroups.push_back (RefreshGroup { mWindow, {} });
+         std::vector<Callback<void()>> & callbacks = mRefreshGroups.back().callbacks;
+         callbacks.reserve (callbacks.size() + variables);
+      }
+
+      /// Size and lay out the current window once after \ref beginBatch()
+      void endBatch()
+      {
+         NVGcontext * ctx = mScreen->getContext();
+         Vector2i pref = mWindow->cachedPreferredSize (ctx), fix = mWindow->fixedSize();
+         mWindow->setSize (Vector2i (fix[0] ? fix[0] : pref[0], fix[1] ? fix[1] : pref[1]));
+         mWindow->performLayout (ctx);
+      }
+
       /// Add a new group that may contain several sub-widgets
       Label * addGroup (const std::string & caption)
       {
@@ -96,27 +187,35 @@ class FormHelper
       addVariable (const std::string & label, const std::function<void (Type)> & setter,
                    const std::function<Type()> & getter, bool editable = true)
       {
-         Label * labelW = new Label (mWindow, label, mLabelFontName, mLabelFontSize);
-         auto widget = new detail::FormWidget<Type> (mWindow);
-         auto refresh = [widget, getter]
+         Callback<void()> refresh;
+         auto widget = createVariable<Type> (label, setter, getter, editable, refresh);
+         if (mRefreshGroups.empty() || mRefreshGroups.back().window != mWindow)
+            mRefreshGroups.push_back (RefreshGroup { mWindow, {} });
+         mRefreshGroups.back().callbacks.push_back (std::move (refresh));
+         return widget;
+      }
+
+      /**
+         \brief Add a new data widget bound to a property
+
+         The widget is updated by \ref refreshChanged() after the property changed
+         instead of being polled. A property is bound to one widget at a time.
+      */
+      template <typename Type> detail::FormWidget<Type> *
+      addVariable (const std::string & label, Property<Type> & property, bool editable = true)
+      {
+         Callback<void()> refresh;
+         auto widget = createVariable<Type> (label,
+                                             [&property] (Type v)
          {
-            Type value = getter(), current = widget->value();
-            if (value != current)
-               widget->setValue (value);
-         };
-         refresh();
-         widget->setCallback (setter);
-         widget->setEditable (editable);
-         widget->setFontSize (mWidgetFontSize);
-         Vector2i fs = widget->fixedSize();
-         widget->setFixedSize (Vector2i (fs.x() != 0 ? fs.x() : mFixedSize.x(),
-                                         fs.y() != 0 ? fs.y() : mFixedSize.y()));
-         mRefreshCallbacks.push_back (refresh);
-         if (mLayout->rowCount() > 0)
-            mLayout->appendRow (mVariableSpacing);
-         mLayout->appendRow (0);
-         mLayout->setAnchor (labelW, AdvancedGridLayout::Anchor (1, mLayout->rowCount() - 1));
-         mLayout->setAnchor (widget, AdvancedGridLayout::Anchor (3, mLayout->rowCount() - 1));
+            property.set (v);
+         },
+         [&property]() -> Type { return property.get(); },
+         editable, refresh);
+         if (property.observer())
+            property.observer()->propertyDestroyed (&property);
+         property.setObserver (this, (int) mBindings.size());
+         mBindings.push_back (Binding { &property, std::move (refresh) });
          return widget;
       }
 
@@ -134,11 +233,36 @@ class FormHelper
                                   );
       }
 
+      /**
+         \brief Add a row for every member of a struct listed with \ref NANOGUI_FORM_STRUCT
+
+         The whole struct is polled by one refresh routine, unrolled at compile
+         time over its members: each member is compared with a snapshot copy
+         taken at the last refresh, and only the widgets of the members that
+         differ are updated. When \c version is given, a counter the owner bumps
+         after changing the struct, a refresh with an unchanged counter returns
+         before looking at any member. The struct must be copyable and its
+         members comparable with ==.
+      */
+      template <typename S> void addStruct (S & object, bool editable = true, const unsigned * version = nullptr)
+      {
+         auto fields = FormFields<S>::fields();
+         typedef detail::StructForm<S, decltype (fields)> Form;
+         std::shared_ptr<Form> form = std::make_shared<Form> (object, fields, version);
+         form->create (*this, editable);
+         if (mRefreshGroups.empty() || mRefreshGroups.back().window != mWindow)
+            mRefreshGroups.push_back (RefreshGroup { mWindow, {} });
+         mRefreshGroups.back().callbacks.push_back ([form]
+         {
+            form->refresh();
+         });
+      }
+
       /// Add a button with a custom callback
-      Button * addButton (const std::string & label, const std::function<void()> & cb)
+      Button * addButton (const std::string & label, Callback<void()> cb)
       {
          Button * button = new Button (mWindow, label);
-         button->setCallback (cb);
+         button->setCallback (std::move (cb));
          button->setFixedHeight (25);
          if (mLayout->rowCount() > 0)
             mLayout->appendRow (mVariableSpacing);
@@ -164,8 +288,48 @@ class FormHelper
       /// Cause all widgets to re-synchronize with the underlying variable state
       void refresh()
       {
-         for (auto const & callback : mRefreshCallbacks)
-            callback();
+         for (auto const & group : mRefreshGroups)
+            for (auto const & callback : group.callbacks)
+               callback();
+         refreshChanged();
+      }
+
+      /// Re-synchronize the polled widgets of the visible windows and the widgets of changed properties
+      void refreshVisible()
+      {
+         for (auto const & group : mRefreshGroups)
+         {
+            if (!group.window->visible())
+               continue;
+            for (auto const & callback : group.callbacks)
+               callback();
+         }
+         refreshChanged();
+      }
+
+      /// Update only the widgets of the properties that changed since the last call
+      void refreshChanged()
+      {
+         std::vector<int> changed;
+         changed.swap (mChanged);
+         for (int slot : changed)
+         {
+            Binding & binding = mBindings[slot];
+            if (!binding.property)
+               continue;
+            binding.property->delivered();
+            binding.refresh();
+         }
+      }
+
+      virtual void propertyChanged (PropertyBase * property)
+      {
+         mChanged.push_back (property->observerSlot());
+      }
+      virtual void propertyDestroyed (PropertyBase * property)
+      {
+         mBindings[property->observerSlot()].property = nullptr;
+         property->setObserver (nullptr, -1);
       }
 
       /// Access the currently active \ref Window instance
@@ -235,10 +399,62 @@ class FormHelper
       }
 
    protected:
+      template <typename S, typename Fields> friend class detail::StructForm;
+
+      /// Create the label and widget of a variable and return the function re-synchronizing the widget
+      template <typename Type> detail::FormWidget<Type> *
+      createVariable (const std::string & label, const std::function<void (Type)> & setter,
+                      const std::function<Type()> & getter, bool editable, Callback<void()> & refresh)
+      {
+         auto widget = createWidget<Type> (label, editable);
+         refresh = [widget, getter]
+         {
+            Type value = getter(), current = widget->value();
+            if (value != current)
+               widget->setValue (value);
+         };
+         refresh();
+         widget->setCallback (setter);
+         return widget;
+      }
+
+      /// Create the label and widget of a variable and add them as a new row of the current window
+      template <typename Type> detail::FormWidget<Type> * createWidget (const std::string & label, bool editable)
+      {
+         Label * labelW = new Label (mWindow, label, mLabelFontName, mLabelFontSize);
+         auto widget = new detail::FormWidget<Type> (mWindow);
+         widget->setEditable (editable);
+         widget->setFontSize (mWidgetFontSize);
+         Vector2i fs = widget->fixedSize();
+         widget->setFixedSize (Vector2i (fs.x() != 0 ? fs.x() : mFixedSize.x(),
+                                         fs.y() != 0 ? fs.y() : mFixedSize.y()));
+         if (mLayout->rowCount() > 0)
+            mLayout->appendRow (mVariableSpacing);
+         mLayout->appendRow (0);
+         mLayout->setAnchor (labelW, AdvancedGridLayout::Anchor (1, mLayout->rowCount() - 1));
+         mLayout->setAnchor (widget, AdvancedGridLayout::Anchor (3, mLayout->rowCount() - 1));
+         return widget;
+      }
+
+      /// Polled widgets of one window
+      struct RefreshGroup
+      {
+         ref<Window> window;
+         std::vector<Callback<void()>> callbacks;
+      };
+      /// Widget of a property, which is null once the property was destroyed
+      struct Binding
+      {
+         PropertyBase * property;
+         Callback<void()> refresh;
+      };
+
       ref<Screen> mScreen;
       ref<Window> mWindow;
       ref<AdvancedGridLayout> mLayout;
-      std::vector<std::function<void()>> mRefreshCallbacks;
+      std::vector<RefreshGroup> mRefreshGroups;
+      std::vector<Binding> mBindings;
+      std::vector<int> mChanged;	// slots of the properties changed since refreshChanged()
       std::string mGroupFontName = "sans-bold";
       std::string mLabelFontName = "sans";
       Vector2i mFixedSize = Vector2i (0, 20);
@@ -286,17 +502,21 @@ template <typename T> class FormWidget<T, typename std::is_enum<T>::type> : publ
          setSelectedIndex ((int) value);
          mSelectedIndex = (int) value;
       }
-      void setCallback (const std::function<void (T)> & cb)
+      void setCallback (Callback<void (T)> cb)
       {
-         ComboBox::setCallback ([cb] (int v)
+         mValueCallback = std::move (cb);
+         ComboBox::setCallback ([this] (int v)
          {
-            cb ((T) v);
+            mValueCallback ((T) v);
          });
       }
       void setEditable (bool e)
       {
          setEnabled (e);
       }
+
+   protected:
+      Callback<void (T)> mValueCallback;
 };
 
 template <typename T> class FormWidget<T, typename std::is_integral<T>::type> : public IntBox<T>
@@ -324,14 +544,18 @@ template <> class FormWidget<std::string, std::true_type> : public TextBox
       {
          setAlignment (TextBox::Alignment::Left);
       }
-      void setCallback (const std::function<void (const std::string &)> & cb)
+      void setCallback (Callback<void (const std::string &)> cb)
       {
-         TextBox::setCallback ([cb] (const std::string & str)
+         mValueCallback = std::move (cb);
+         TextBox::setCallback ([this] (const std::string & str)
          {
-            cb (str);
+            mValueCallback (str);
             return true;
          });
       }
+
+   protected:
+      Callback<void (const std::string &)> mValueCallback;
 };
 
 template <> class FormWidget<Color, std::true_type> : public ColorPicker
@@ -352,5 +576,78 @@ template <> class FormWidget<Color, std::true_type> : public ColorPicker
       }
 };
 
+/* Widgets of a struct added by FormHelper::addStruct() and the snapshot its refresh compares with */
+template <typename S, typename ... F> class StructForm<S, std::tuple<F...>>
+{
+   public:
+      StructForm (S & object, const std::tuple<F...> & fields, const unsigned * version)
+         : mObject (&object), mSnapshot (object), mFields (fields), mVersion (version),
+           mSeenVersion (version ? *version : 0) { }
+
+      void create (FormHelper & helper, bool editable)
+      {
+         create (helper, editable, std::index_sequence_for<F...>());
+      }
+
+      void refresh()
+      {
+         if (mVersion)
+         {
+            if (*mVersion == mSeenVersion)
+               return;
+            mSeenVersion = *mVersion;
+         }
+         refresh (std::index_sequence_for<F...>());
+      }
+
+   protected:
+      template <size_t ... I> void create (FormHelper & helper, bool editable, std::index_sequence<I...>)
+      {
+         int expand[] = { 0, (createField<I> (helper, editable), 0)... };
+         (void) expand;
+      }
+
+      template <size_t I> void createField (FormHelper & helper, bool editable)
+      {
+         typedef typename std::tuple_element<I, std::tuple<F...>>::type Field;
+         typedef typename Field::Type Type;
+         const Field & field = std::get<I> (mFields);
+         auto widget = helper.template createWidget<Type> (field.label, editable);
+         widget->setValue (mObject->*field.member);
+         /* Edits go to the snapshot too, so the next refresh does not write them back to the widget */
+         S * object = mObject, * snapshot = &mSnapshot;
+         Type S::* member = field.member;
+         widget->setCallback ([object, snapshot, member] (const Type & value)
+         {
+            object->*member = value;
+            snapshot->*member = value;
+         });
+         std::get<I> (mWidgets) = widget;
+      }
+
+      template <size_t ... I> void refresh (std::index_sequence<I...>)
+      {
+         int expand[] = { 0, (refreshField (std::get<I> (mFields), std::get<I> (mWidgets)), 0)... };
+         (void) expand;
+      }
+
+      template <typename T> void refreshField (const FormField<S, T> & field, FormWidget<T> * widget)
+      {
+         const T & value = mObject->*field.member;
+         T & seen = mSnapshot.*field.member;
+         if (value == seen)
+            return;
+         seen = value;
+         widget->setValue (value);
+      }
+
+      S * mObject;
+      S mSnapshot;
+      std::tuple<F...> mFields;
+      std::tuple<FormWidget<typename F::Type> *...> mWidgets;
+      const unsigned * mVersion;
+      unsigned mSeenVersion;
+};
+
 NAMESPACE_END (detail)
 NAMESPACE_END (nanogui)
@@ -11,16 +11,26 @@
 
 #include "graph.h"
 #include "theme.h"
+#include "screen.h"
 #include "../nanovg/nanovg.h"
+#include "../util/SampleQueue.h"
+#include <cmath>
 
 NAMESPACE_BEGIN (nanogui)
 
 Graph::Graph (Widget * parent, const std::string & caption)
-   : Widget (parent), mCaption (caption)
+   : Widget (parent), mCaption (caption), mSeries (1), mRange (0.0f, 1.0f)
 {
    mBackgroundColor = Color (20, 128);
    mForegroundColor = Color (255, 192, 0, 128);
    mTextColor = Color (240, 192);
+   mSeries[0].data.resize (256);
+   mSeries[0].color = Color (100, 255);
+}
+
+Graph::~Graph()
+{
+   releasePlots();
 }
 
 Vector2i Graph::preferredSize (NVGcontext *) const
@@ -28,6 +38,230 @@ Vector2i Graph::preferredSize (NVGcontext *) const
    return Vector2i (180, 45);
 }
 
+VectorXf Graph::values (int series) const
+{
+   const Series & s = mSeries[series];
+   VectorXf result ((int)s.count);
+   size_t start = s.head + s.data.size() - s.count;
+   for (size_t i = 0; i < s.count; ++i)
+      result[(int)i] = s.data[(start + i) % s.data.size()];
+   return result;
+}
+
+void Graph::setValues (const VectorXf & values, int series)
+{
+   if (series == 0 || (int)values.size() > capacity())
+      setCapacity ((int)values.size());
+   Series & s = mSeries[series];
+   s.head = s.count = s.pending = 0;
+   s.reset = true;
+   push (values.data(), (size_t)values.size(), series);
+}
+
+void Graph::push (const float * values, size_t count, int series)
+{
+   Series & s = mSeries[series];
+   size_t n = s.data.size();
+   /* Only the newest capacity() samples survive */
+   if (count > n)
+   {
+      values += count - n;
+      count = n;
+   }
+   for (size_t i = 0; i < count; ++i)
+   {
+      s.data[s.head] = values[i];
+      s.head = s.head + 1 == n ? 0 : s.head + 1;
+   }
+   s.count = std::min (s.count + count, n);
+   s.pending = std::min (s.pending + count, n);
+   markDirty();
+}
+
+void Graph::setCapacity (int capacity)
+{
+   capacity = std::max (capacity, 2);
+   for (auto & s : mSeries)
+   {
+      VectorXf kept = values ((int)(&s - mSeries.data()));
+      s.data.assign ((size_t)capacity, 0.0f);
+      s.head = s.count = 0;
+      size_t count = std::min ((size_t)kept.size(), (size_t)capacity);
+      push (kept.data() + kept.size() - count, count, (int)(&s - mSeries.data()));
+   }
+   markDirty();
+}
+
+int Graph::addSeries (const Color & color)
+{
+   Series s;
+   s.data.resize (mSeries[0].data.size());
+   s.color = color;
+   mSeries.push_back (s);
+   return (int)mSeries.size() - 1;
+}
+
+void Graph::clear()
+{
+   for (auto & s : mSeries)
+   {
+      s.head = s.count = s.pending = 0;
+      s.reset = true;
+   }
+   markDirty();
+}
+
+std::shared_ptr<SampleQueue> Graph::feed (int series, size_t capacity)
+{
+   Series & s = mSeries[series];
+   if (s.feed)
+      return s.feed;
+   s.feed = std::make_shared<SampleQueue> (capacity);
+   if (!mPoll)
+   {
+      mPoll = std::make_shared<std::function<void()>> ([this]() { drainFeeds(); });
+      if (Screen * screen = this->screen())
+         screen->addPoll (mPoll);
+   }
+   return s.feed;
+}
+
+void Graph::drainFeeds()
+{
+   float buffer[1024];
+   for (size_t i = 0; i < mSeries.size(); ++i)
+   {
+      if (!mSeries[i].feed)
+         continue;
+      /* Pushing the chunks marks the graph dirty */
+      while (size_t n = mSeries[i].feed->pop (buffer, 1024))
+         push (buffer, n, (int)i);
+   }
+}
+
+void Graph::setGpuPlot (bool gpuPlot)
+{
+   mGpuPlot = gpuPlot;
+   if (!gpuPlot)
+      releasePlots();
+   markDirty();
+}
+
+void Graph::releasePlots()
+{
+   for (auto & s : mSeries)
+   {
+      if (s.plot)
+         nvgDeletePlot (mPlotContext, s.plot);
+      s.plot = s.plotCapacity = 0;
+   }
+}
+
+bool Graph::drawPlot (NVGcontext * ctx, Series & series)
+{
+   size_t n = series.data.size();
+   /* setCapacity() replaced the ring */
+   if (series.plot && series.plotCapacity != (int)n)
+   {
+      nvgDeletePlot (ctx, series.plot);
+      series.plot = 0;
+   }
+   if (!series.plot)
+   {
+      series.plot = nvgCreatePlot (ctx, (int)n);
+      if (!series.plot)
+      {
+         mGpuPlot = false;
+         return false;
+      }
+      mPlotContext = ctx;
+      series.plotCapacity = (int)n;
+      series.pending = series.count;
+      series.reset = false;
+   }
+   if (series.reset)
+   {
+      nvgPlotClear (ctx, series.plot);
+      series.reset = false;
+   }
+   /* Only what was pushed since the last frame, in at most two pieces of the ring */
+   size_t m = std::min (series.pending, series.count), start = (series.head + n - m) % n;
+   size_t first = std::min (m, n - start);
+   nvgPlotAppend (ctx, series.plot, &series.data[start], (int)first);
+   nvgPlotAppend (ctx, series.plot, series.data.data(), (int) (m - first));
+   series.pending = 0;
+   nvgDrawPlot (ctx, series.plot, mPos.x(), mPos.y(), mSize.x(), mSize.y(), mRange.x(), mRange.y());
+   return true;
+}
+
+void Graph::seriesPath (NVGcontext * ctx, const Series & series, bool closed, int columnWidth) const
+{
+   size_t n = series.data.size(), start = series.head + n - series.count;
+   /* Sample p of the capacity, counted from the oldest slot, sits at p * step; the newest one at the right edge */
+   float step = mSize.x() / (float) (n - 1), bottom = mPos.y() + mSize.y();
+   float scale = mRange.y() != mRange.x() ? mSize.y() / (mRange.y() - mRange.x()) : 0.0f;
+   size_t first = n - series.count;
+   auto y = [&] (float value) { return bottom - (value - mRange.x()) * scale; };
+   nvgBeginPath (ctx);
+   if (closed)
+      nvgMoveTo (ctx, mPos.x() + first * step, bottom);
+   if (n - 1 <= (size_t)mSize.x() * 2 / columnWidth)
+   {
+      for (size_t i = 0; i < series.count; ++i)
+      {
+         float vx = mPos.x() + (first + i) * step, vy = y (series.data[(start + i) % n]);
+         if (i == 0 && !closed)
+            nvgMoveTo (ctx, vx, vy);
+         else
+            nvgLineTo (ctx, vx, vy);
+      }
+   }
+   else
+   {
+      /* More samples than pixel columns: two points per column, the extreme nearer the previous
+         column first so that the polyline does not cross itself */
+      float last = 0.0f;
+      bool started = false;
+      auto emit = [&] (int column, float lo, float hi)
+      {
+         float vx = mPos.x() + column * columnWidth, a = y (hi), b = y (lo);
+         if (started && std::abs (last - b) < std::abs (last - a))
+            std::swap (a, b);
+         if (!started && !closed)
+            nvgMoveTo (ctx, vx, a);
+         else
+            nvgLineTo (ctx, vx, a);
+         nvgLineTo (ctx, vx, b);
+         last = b;
+         started = true;
+      };
+      float columnsPerSample = mSize.x() / (float) (n - 1) / columnWidth;
+      int column = -1;
+      float lo = 0.0f, hi = 0.0f;
+      for (size_t i = 0; i < series.count; ++i)
+      {
+         float value = series.data[(start + i) % n];
+         int c = (int) ((first + i) * columnsPerSample);
+         if (c != column)
+         {
+            if (column >= 0)
+               emit (column, lo, hi);
+            column = c;
+            lo = hi = value;
+         }
+         else
+         {
+            lo = std::min (lo, value);
+            hi = std::max (hi, value);
+         }
+      }
+      if (column >= 0)
+         emit (column, lo, hi);
+   }
+   if (closed)
+      nvgLineTo (ctx, mPos.x() + mSize.x(), bottom);
+}
+
 void Graph::draw (NVGcontext * ctx)
 {
    Widget::draw (ctx);
@@ -35,23 +269,31 @@ void Graph::draw (NVGcontext * ctx)
    nvgRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y());
    nvgFillColor (ctx, mBackgroundColor);
    nvgFill (ctx);
-   if (mValues.size() < 2)
-      return;
-   nvgBeginPath (ctx);
-   nvgMoveTo (ctx, mPos.x(), mPos.y() + mSize.y());
-   for (size_t i = 0; i < (size_t) mValues.size(); i++)
+   /* The quality governor of the screen may halve the columns of the paths */
+   Screen * screen = this->screen();
+   int columnWidth = screen && screen->quality() >= Screen::Quality::CoarseGraphs ? 2 : 1;
+   for (size_t i = 0; i < mSeries.size(); ++i)
    {
-      float value = mValues[i];
-      float vx = mPos.x() + i * mSize.x() / (float) (mValues.size() - 1);
-      float vy = mPos.y() + (1 - value) * mSize.y();
-      nvgLineTo (ctx, vx, vy);
+      Series & s = mSeries[i];
+      if (mGpuPlot)
+      {
+         nvgStrokeColor (ctx, s.color);
+         nvgFillColor (ctx, i == 0 ? mForegroundColor : Color (0, 0));
+         if (drawPlot (ctx, s))
+            continue;
+      }
+      if (s.count < 2)
+         continue;
+      seriesPath (ctx, s, i == 0, columnWidth);
+      nvgStrokeColor (ctx, s.color);
+      nvgStroke (ctx);
+      if (i == 0)
+      {
+         nvgFillColor (ctx, mForegroundColor);
+         nvgFill (ctx);
+      }
    }
-   nvgLineTo (ctx, mPos.x() + mSize.x(), mPos.y() + mSize.y());
-   nvgStrokeColor (ctx, Color (100, 255));
-   nvgStroke (ctx);
-   nvgFillColor (ctx, mForegroundColor);
-   nvgFill (ctx);
-   nvgFontFace (ctx, "sans");
+   nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
    if (!mCaption.empty())
    {
       nvgFontSize (ctx, 14.0f);
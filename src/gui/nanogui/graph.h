@@ -12,13 +12,36 @@
 #pragma once
 
 #include "widget.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+class SampleQueue;
 
 NAMESPACE_BEGIN (nanogui)
 
+/**
+   \brief Plot of one or more series of samples sharing the same axes
+
+   Each series keeps its latest \ref capacity() samples in a ring buffer, so
+   \ref push() is O(1) and the newest sample is always drawn at the right edge.
+   When a series has more samples than the widget has pixel columns, each
+   column is drawn as the minimum and maximum of the samples falling into it,
+   which bounds the path at two points per column however many samples are kept.
+   The first series is filled with the foreground color, further series are
+   stroked in their own colors. Threads other than the GUI thread push into the
+   lock-free queue of \ref feed() instead, which the screen drains every frame.
+
+   By default the series are drawn as NanoVG plots: their samples are kept in
+   video memory, only the samples pushed since the last frame are uploaded and
+   the line is expanded on the GPU, so a frame costs the same however many
+   samples are shown. Back-ends without plots fall back to the decimated paths.
+*/
 class  Graph : public Widget
 {
    public:
       Graph (Widget * parent, const std::string & caption = "Untitled");
+      ~Graph();
 
       const std::string & caption() const
       {
@@ -27,6 +50,7 @@ class  Graph : public Widget
       void setCaption (const std::string & caption)
       {
          mCaption = caption;
+         markDirty();
       }
 
       const std::string & header() const
@@ -36,6 +60,7 @@ class  Graph : public Widget
       void setHeader (const std::string & header)
       {
          mHeader = header;
+         markDirty();
       }
 
       const std::string & footer() const
@@ -45,6 +70,7 @@ class  Graph : public Widget
       void setFooter (const std::string & footer)
       {
          mFooter = footer;
+         markDirty();
       }
 
       const Color & backgroundColor() const
@@ -54,6 +80,7 @@ class  Graph : public Widget
       void setBackgroundColor (const Color & backgroundColor)
       {
          mBackgroundColor = backgroundColor;
+         markDirty();
       }
 
       const Color & foregroundColor() const
@@ -63,6 +90,7 @@ class  Graph : public Widget
       void setForegroundColor (const Color & foregroundColor)
       {
          mForegroundColor = foregroundColor;
+         markDirty();
       }
 
       const Color & textColor() const
@@ -72,27 +100,112 @@ class  Graph : public Widget
       void setTextColor (const Color & textColor)
       {
          mTextColor = textColor;
+         markDirty();
       }
 
-      const VectorXf & values() const
+      /// Return the samples of a series, oldest first
+      VectorXf values (int series = 0) const;
+      /// Replace the samples of a series. For the first series the capacity becomes their number, so
+      /// that they span the whole width, other series only grow it
+      void setValues (const VectorXf & values, int series = 0);
+
+      /// Append a sample to a series, dropping its oldest one when it holds \ref capacity() samples
+      void push (float value, int series = 0)
       {
-         return mValues;
+         Series & s = mSeries[series];
+         s.data[s.head] = value;
+         s.head = (s.head + 1) % s.data.size();
+         s.count = std::min (s.count + 1, s.data.size());
+         s.pending = std::min (s.pending + 1, s.data.size());
+         markDirty();
       }
-      VectorXf & values()
+      /// Append several samples to a series
+      void push (const float * values, size_t count, int series = 0);
+
+      /**
+         \brief Return the queue other threads push samples of a series into
+
+         Created on first call, which has to happen on the GUI thread once the
+         graph is attached to a screen. A single producer thread may push into
+         it without blocking; every \ref Screen::drawWidgets() moves the queued
+         samples into the series and redraws the graph when there were any.
+         The queue may outlive the graph.
+      */
+      std::shared_ptr<SampleQueue> feed (int series = 0, size_t capacity = 1 << 14);
+
+      /// Return the number of samples kept per series, which also spans the width of the graph
+      int capacity() const
       {
-         return mValues;
+         return (int)mSeries[0].data.size();
       }
-      void setValues (const VectorXf & values)
+      /// Set the number of samples kept per series, keeping the newest ones
+      void setCapacity (int capacity);
+
+      /// Add a series stroked in \c color, returns its index for \ref push()
+      int addSeries (const Color & color);
+      int seriesCount() const
       {
-         mValues = values;
+         return (int)mSeries.size();
       }
+      /// Drop the samples of all series
+      void clear();
+
+      /// Return the values shown at the bottom and top edge, 0 and 1 by default
+      const Vector2f & range() const
+      {
+         return mRange;
+      }
+      void setRange (float min, float max)
+      {
+         mRange = Vector2f (min, max);
+         markDirty();
+      }
+
+      /// Return whether the series are drawn as GPU plots, see nvgDrawPlot()
+      bool gpuPlot() const
+      {
+         return mGpuPlot;
+      }
+      /// Draw the series as GPU plots, turned off again when the back-end has none
+      void setGpuPlot (bool gpuPlot);
 
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
       virtual void draw (NVGcontext * ctx);
+      /// Plots are objects of the context drawn with
+      virtual bool threadSafeDraw() const
+      {
+         return false;
+      }
    protected:
+      struct Series
+      {
+         std::vector<float> data;	// ring of capacity() samples
+         size_t head = 0;	// where the next sample goes
+         size_t count = 0;
+         Color color;
+         std::shared_ptr<SampleQueue> feed;
+         int plot = 0;	// GPU copy of the ring, see drawPlot()
+         int plotCapacity = 0;
+         size_t pending = 0;	// newest samples not uploaded to the plot yet
+         bool reset = false;	// the plot holds samples dropped since
+      };
+
+      /// Move the samples queued by other threads into their series
+      void drainFeeds();
+
+      /// Add the path of a series, decimated to the minimum and maximum of every column of \c columnWidth pixels
+      void seriesPath (NVGcontext * ctx, const Series & series, bool closed, int columnWidth = 1) const;
+      /// Upload the pending samples of a series and draw it as a plot, false if plots are not available
+      bool drawPlot (NVGcontext * ctx, Series & series);
+      void releasePlots();
+
       std::string mCaption, mHeader, mFooter;
       Color mBackgroundColor, mForegroundColor, mTextColor;
-      VectorXf mValues;
+      std::vector<Series> mSeries;
+      Vector2f mRange;
+      bool mGpuPlot = true;
+      NVGcontext * mPlotContext = nullptr;	// the plots were created with
+      std::shared_ptr<std::function<void()>> mPoll;	// registered with the screen while feeds exist
 };
 
 NAMESPACE_END (nanogui)
@@ -12,6 +12,7 @@
 
 #include "imagepanel.h"
 #include "../nanovg/nanovg.h"
+#include <cfloat>
 
 NAMESPACE_BEGIN (nanogui)
 
@@ -44,7 +45,10 @@ int ImagePanel::indexForPosition (const Vector2i & p) const
 bool ImagePanel::mouseMotionEvent (const Vector2i & p, const Vector2i & /* rel */,
                                    int /* button */, int /* modifiers */)
 {
-   mMouseIndex = indexForPosition (p);
+   int index = indexForPosition (p);
+   if (index != mMouseIndex)
+      markDirty();
+   mMouseIndex = index;
    return true;
 }
 
@@ -57,6 +61,33 @@ bool ImagePanel::mouseButtonEvent (const Vector2i & p, int /* button */, bool do
    return true;
 }
 
+void ImagePanel::setDragPayload (Callback<bool (int, DragPayload &)> payload)
+{
+   mDragPayload = std::move (payload);
+   if (!mDragPayload)
+   {
+      setDragSource (DragSource());
+      return;
+   }
+   setDragSource ([this] (const Vector2i & p, DragPayload & drag)
+   {
+      int index = indexForPosition (p);
+      if (index < 0)
+         return false;
+      drag.item = index;
+      drag.description = mImages[index].second;
+      if (!mDragPayload (index, drag))
+         return false;
+      /* The thumbnail already drawn by the panel doubles as the preview */
+      if (!drag.previewImage && !drag.previewWidget)
+      {
+         drag.previewImage = mImages[index].first;
+         drag.previewSize = Vector2i::Constant (mThumbSize);
+      }
+      return true;
+   });
+}
+
 Vector2i ImagePanel::preferredSize (NVGcontext *) const
 {
    Vector2i grid = gridSize();
@@ -66,13 +97,63 @@ Vector2i ImagePanel::preferredSize (NVGcontext *) const
           );
 }
 
+void ImagePanel::visibleRange (NVGcontext * ctx, int & first, int & last) const
+{
+   Vector2i grid = gridSize();
+   first = 0;
+   last = (int) mImages.size();
+   float clip[4], xf[6], inv[6];
+   if (!nvgCurrentClipBounds (ctx, clip))
+      return;
+   nvgCurrentTransform (ctx, xf);
+   if (!nvgTransformInverse (inv, xf))
+      return;
+   /* Vertical extent of the clip bounds in the space of the panel, widened by the shadow spread */
+   float top = FLT_MAX, bottom = -FLT_MAX;
+   for (int k = 0; k < 4; ++k)
+   {
+      float x, y;
+      nvgTransformPoint (&x, &y, inv, clip[k & 1 ? 2 : 0], clip[k & 2 ? 3 : 1]);
+      top = std::min (top, y);
+      bottom = std::max (bottom, y);
+   }
+   float pitch = (float) (mThumbSize + mSpacing);
+   top -= mPos.y() + mMargin + 6;
+   bottom -= mPos.y() + mMargin - 6;
+   int firstRow = std::max (0, (int) std::floor (top / pitch));
+   int lastRow = std::min (grid.y(), (int) std::floor (bottom / pitch) + 1);
+   first = std::min (last, firstRow * grid.x());
+   last = std::max (first, std::min (last, lastRow * grid.x()));
+}
+
 void ImagePanel::draw (NVGcontext * ctx)
 {
+   int first, last;
+   visibleRange (ctx, first, last);
+   if (first == last)
+      return;
    Vector2i grid = gridSize();
-   for (size_t i = 0; i < mImages.size(); ++i)
+   int pitch = mThumbSize + mSpacing;
+   float ts = mThumbSize;
+   auto origin = [&] (int i)
+   {
+      return mPos + Vector2i::Constant (mMargin) + Vector2i (i % grid.x(), i / grid.x()) * pitch;
+   };
+   /* The thumbnails are drawn in passes rather than one after another, so that consecutive fills
+      share their texture (no image for the shadows, the atlas page for the thumbnails) and are
+      merged into single draws, and all borders are one stroke */
+   for (int i = first; i < last; ++i)
+   {
+      Vector2i p = origin (i);
+      NVGpaint shadowPaint =
+         nvgBoxGradient (ctx, p.x() - 1, p.y(), ts + 2, ts + 2, 5, 3,
+                         nvgRGBA (0, 0, 0, 128), nvgRGBA (0, 0, 0, 0));
+      nvgFillPaint (ctx, shadowPaint);
+      nvgDrawBoxShadow (ctx, p.x(), p.y(), ts, ts, 6, 5);
+   }
+   for (int i = first; i < last; ++i)
    {
-      Vector2i p = mPos + Vector2i::Constant (mMargin) +
-                   Vector2i ((int) i % grid.x(), (int) i / grid.x()) * (mThumbSize + mSpacing);
+      Vector2i p = origin (i);
       int imgw, imgh;
       nvgImageSize (ctx, mImages[i].first, &imgw, &imgh);
       float iw, ih, ix, iy;
@@ -92,26 +173,24 @@ void ImagePanel::draw (NVGcontext * ctx)
       }
       NVGpaint imgPaint = nvgImagePattern (
                              ctx, p.x() + ix, p.y() + iy, iw, ih, 0, mImages[i].first,
-                             mMouseIndex == (int)i ? 1.0 : 0.7);
-      nvgBeginPath (ctx);
-      nvgRoundedRect (ctx, p.x(), p.y(), mThumbSize, mThumbSize, 5);
+                             mMouseIndex == i ? 1.0 : 0.7);
       nvgFillPaint (ctx, imgPaint);
-      nvgFill (ctx);
-      NVGpaint shadowPaint =
-         nvgBoxGradient (ctx, p.x() - 1, p.y(), mThumbSize + 2, mThumbSize + 2, 5, 3,
-                         nvgRGBA (0, 0, 0, 128), nvgRGBA (0, 0, 0, 0));
-      nvgBeginPath (ctx);
-      nvgRect (ctx, p.x() - 5, p.y() - 5, mThumbSize + 10, mThumbSize + 10);
-      nvgRoundedRect (ctx, p.x(), p.y(), mThumbSize, mThumbSize, 6);
-      nvgPathWinding (ctx, NVG_HOLE);
-      nvgFillPaint (ctx, shadowPaint);
-      nvgFill (ctx);
-      nvgBeginPath (ctx);
-      nvgRoundedRect (ctx, p.x() + 0.5f, p.y() + 0.5f, mThumbSize - 1, mThumbSize - 1, 4 - 0.5f);
-      nvgStrokeWidth (ctx, 1.0f);
-      nvgStrokeColor (ctx, nvgRGBA (255, 255, 255, 80));
-      nvgStroke (ctx);
+      nvgDrawRoundedRectSDF (ctx, p.x(), p.y(), ts, ts, 5);
    }
+   Vector4f key (ts, (float) grid.x(), (float) first, (float) (last - first));
+   nvgSave (ctx);
+   nvgTranslate (ctx, mPos.x() + mMargin, mPos.y() + mMargin);
+   nvgStrokeWidth (ctx, 1.0f);
+   nvgStrokeColor (ctx, nvgRGBA (255, 255, 255, 80));
+   nvgStrokeGeometry (ctx, mBorderGeometry.get (ctx, key, [&]
+   {
+      for (int i = first; i < last; ++i)
+      {
+         Vector2i p = Vector2i (i % grid.x(), i / grid.x()) * pitch;
+         nvgRoundedRect (ctx, p.x() + 0.5f, p.y() + 0.5f, ts - 1, ts - 1, 4 - 0.5f);
+      }
+   }));
+   nvgRestore (ctx);
 }
 
 NAMESPACE_END (nanogui)
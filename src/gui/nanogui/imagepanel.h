@@ -13,9 +13,21 @@
 #pragma once
 
 #include "widget.h"
+#include "callback.h"
+#include "cachedgeometry.h"
 
 NAMESPACE_BEGIN (nanogui)
 
+/**
+   \brief Grid of square thumbnails
+
+   Only the rows that intersect the current clip bounds are drawn, so the
+   panel stays cheap inside a \ref VScrollPanel with thousands of images.
+   Thumbnails of the same size, such as those produced by
+   NanoUtil::loadImageDirectory() with the thumb size, are packed into shared
+   atlas pages by the renderer; their fills, the shadows and the borders are
+   then each submitted as one batched draw.
+*/
 class  ImagePanel : public Widget
 {
    public:
@@ -26,21 +38,46 @@ class  ImagePanel : public Widget
       void setImages (const Images & data)
       {
          mImages = data;
+         invalidateLayout();
       }
       const Images & images() const
       {
          return mImages;
       }
+      /// Replace the image of one entry, e.g. once a placeholder finished loading
+      void setImage (size_t index, int image)
+      {
+         if (index >= mImages.size())
+            return;
+         mImages[index].first = image;
+         markDirty();
+      }
 
-      std::function<void (int)> callback() const
+      /// Return the side of the square thumbnails in pixels
+      int thumbSize() const
+      {
+         return mThumbSize;
+      }
+
+      const Callback<void (int)> & callback() const
       {
          return mCallback;
       }
-      void setCallback (const std::function<void (int)> & callback)
+      void setCallback (Callback<void (int)> callback)
       {
-         mCallback = callback;
+         mCallback = std::move (callback);
       }
 
+      /**
+         \brief Let the thumbnails be dragged to drop targets, see \ref Widget::setDropTarget()
+
+         \c payload describes the image at an index when a drag starts, e.g.
+         with a provider loading it at full resolution, and returns false to
+         not drag it. The description defaults to the name of the image and
+         the thumbnail follows the cursor unless another preview is set.
+      */
+      void setDragPayload (Callback<bool (int index, DragPayload & payload)> payload);
+
       virtual bool mouseMotionEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
       virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
@@ -48,13 +85,18 @@ class  ImagePanel : public Widget
    protected:
       Vector2i gridSize() const;
       int indexForPosition (const Vector2i & p) const;
+      /// Compute the range of images in rows that intersect the clip bounds
+      void visibleRange (NVGcontext * ctx, int & first, int & last) const;
    protected:
       Images mImages;
-      std::function<void (int)> mCallback;
+      Callback<void (int)> mCallback;
+      Callback<bool (int, DragPayload &)> mDragPayload;
       int mThumbSize;
       int mSpacing;
       int mMargin;
       int mMouseIndex;
+      /// Borders of the visible thumbnails, stroked at once
+      CachedGeometry mBorderGeometry;
 };
 
 NAMESPACE_END (nanogui)
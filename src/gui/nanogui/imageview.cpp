@@ -12,14 +12,56 @@
 
 #include "imageview.h"
 #include "../nanovg/nanovg.h"
+#include "../util/TileCache.h"
+#include <cmath>
 
 NAMESPACE_BEGIN (nanogui)
 
 ImageView::ImageView (Widget * parent, int img)
-   : Widget (parent), mImage (img) {}
+   : Widget (parent), mImage (img), mZoomable (false), mScale (0.0f), mOffset (Vector2f::Zero()),
+     mContentSize (Vector2i::Zero()) {}
 
-Vector2i ImageView::preferredSize (NVGcontext * ctx) const
+ImageView::~ImageView()
+{
+   if (mTiles)
+      mTiles->setCallback (nullptr);
+}
+
+void ImageView::setTiles (const std::shared_ptr<TileCache> & tiles)
+{
+   if (mTiles)
+      mTiles->setCallback (nullptr);
+   mTiles = tiles;
+   if (mTiles)
+      mTiles->setCallback ([this]
+   {
+      markDirty();
+   });
+   invalidateLayout();
+}
+
+void ImageView::setScale (float scale)
+{
+   if (scale <= 0.0f)
+   {
+      mScale = 0.0f;
+      mOffset = Vector2f::Zero();
+   }
+   else
+   {
+      Vector2f center = mSize.cast<float>() * 0.5f;
+      float current = mScale > 0.0f ? mScale : fitScale (mContentSize);
+      Vector2f point = (center - mOffset) / current;
+      mScale = scale;
+      mOffset = center - point * scale;
+   }
+   markDirty();
+}
+
+Vector2i ImageView::contentSize (NVGcontext * ctx) const
 {
+   if (mTiles)
+      return Vector2i (mTiles->width(), mTiles->height());
    if (!mImage)
       return Vector2i (0, 0);
    int w, h;
@@ -27,29 +69,116 @@ Vector2i ImageView::preferredSize (NVGcontext * ctx) const
    return Vector2i (w, h);
 }
 
+float ImageView::fitScale (const Vector2i & content) const
+{
+   if (content.x() <= 0 || content.y() <= 0)
+      return 1.0f;
+   return std::min (1.0f, std::min (mSize.x() / (float) content.x(), mSize.y() / (float) content.y()));
+}
+
+Vector2i ImageView::preferredSize (NVGcontext * ctx) const
+{
+   /* A pyramid is as large as its coarsest level, the full image would rarely fit on screen */
+   if (mTiles)
+      return Vector2i (std::max (1, mTiles->width() >> (mTiles->levels() - 1)),
+                       std::max (1, mTiles->height() >> (mTiles->levels() - 1)));
+   return contentSize (ctx);
+}
+
+bool ImageView::mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers)
+{
+   if (!mZoomable)
+      return Widget::mouseDragEvent (p, rel, button, modifiers);
+   if (mScale <= 0.0f)
+      mScale = fitScale (mContentSize);
+   mOffset += rel.cast<float>();
+   markDirty();
+   return true;
+}
+
+bool ImageView::scrollEvent (const Vector2i & p, const Vector2f & rel)
+{
+   if (!mZoomable)
+      return Widget::scrollEvent (p, rel);
+   /* Zoom around the image point under the cursor */
+   Vector2f local = (p - mPos).cast<float>();
+   if (mScale <= 0.0f)
+      mScale = fitScale (mContentSize);
+   Vector2f point = (local - mOffset) / mScale;
+   mScale = std::max (1.0f / 1024.0f, std::min (64.0f, mScale * std::pow (1.1f, rel.y())));
+   mOffset = local - point * mScale;
+   markDirty();
+   return true;
+}
+
+/* Fills the part of x,y,w,h inside the widget with paint, nothing when they do not overlap */
+static void fillClipped (NVGcontext * ctx, const NVGpaint & paint, const Vector2i & pos, const Vector2i & size,
+                         float x, float y, float w, float h)
+{
+   float x0 = std::max (x, (float) pos.x()), y0 = std::max (y, (float) pos.y());
+   float x1 = std::min (x + w, (float) (pos.x() + size.x())), y1 = std::min (y + h, (float) (pos.y() + size.y()));
+   if (x1 <= x0 || y1 <= y0)
+      return;
+   nvgFillPaint (ctx, paint);
+   nvgDrawRoundedRectSDF (ctx, x0, y0, x1 - x0, y1 - y0, 0);
+}
+
 void ImageView::draw (NVGcontext * ctx)
 {
-   if (!mImage)
+   mContentSize = contentSize (ctx);
+   if (mContentSize.x() <= 0 || mContentSize.y() <= 0)
       return;
-   Vector2i p = mPos;
-   Vector2i s = Widget::size();
-   int w, h;
-   nvgImageSize (ctx, mImage, &w, &h);
-   if (s.x() < w)
+   float scale = mScale > 0.0f ? mScale : fitScale (mContentSize);
+   Vector2f origin = mPos.cast<float>() + (mScale > 0.0f ? mOffset : Vector2f::Zero());
+   if (mTiles)
    {
-      h = (int) std::round (h * (float) s.x() / w);
-      w = s.x();
+      drawTiles (ctx, scale, origin);
+      return;
    }
-   if (s.y() < h)
+   float w = mScale > 0.0f ? mContentSize.x() * scale : std::round (mContentSize.x() * scale);
+   float h = mScale > 0.0f ? mContentSize.y() * scale : std::round (mContentSize.y() * scale);
+   NVGpaint imgPaint = nvgImagePattern (ctx, origin.x(), origin.y(), w, h, 0, mImage, 1.0);
+   fillClipped (ctx, imgPaint, mPos, mSize, origin.x(), origin.y(), w, h);
+}
+
+void ImageView::drawTiles (NVGcontext * ctx, float scale, const Vector2f & origin)
+{
+   TileCache & tiles = *mTiles;
+   /* The coarsest level whose pixels still cover at most one screen pixel */
+   int level = 0;
+   while (level + 1 < tiles.levels() && scale * (1 << (level + 1)) <= 1.0f)
+      level++;
+   float span = (float) (tiles.tileSize() << level);	// of a tile in level 0 pixels
+   Vector2f first = (mPos.cast<float>() - origin) / (scale * span);
+   Vector2f last = first + mSize.cast<float>() / (scale * span);
+   int c0 = std::max (0, (int) std::floor (first.x())), c1 = std::min (tiles.columns (level) - 1, (int) std::floor (last.x()));
+   int r0 = std::max (0, (int) std::floor (first.y())), r1 = std::min (tiles.rows (level) - 1, (int) std::floor (last.y()));
+   for (int r = r0; r <= r1; ++r)
    {
-      w = (int) std::round (w * (float) s.y() / h);
-      h = s.y();
+      for (int c = c0; c <= c1; ++c)
+      {
+         /* Screen rect of the tile, cut at the edges of the image */
+         float x = origin.x() + c * span * scale, y = origin.y() + r * span * scale;
+         float w = std::min (span, mContentSize.x() - c * span) * scale;
+         float h = std::min (span, mContentSize.y() - r * span) * scale;
+         /* Fall back to the coarser tiles covering this one while it loads, asking for the coarsest */
+         for (int l = level; l < tiles.levels(); ++l)
+         {
+            int shift = l - level;
+            int image = tiles.tile (l, c >> shift, r >> shift, l == level || l == tiles.levels() - 1);
+            if (!image)
+               continue;
+            int iw, ih;
+            nvgImageSize (ctx, image, &iw, &ih);
+            float coarse = (float) (tiles.tileSize() << l) * scale;
+            float pixel = (float) (1 << l) * scale;
+            NVGpaint paint = nvgImagePattern (ctx, origin.x() + (c >> shift) * coarse, origin.y() + (r >> shift) * coarse,
+                                              iw * pixel, ih * pixel, 0, image, 1.0f);
+            fillClipped (ctx, paint, mPos, mSize, x, y, w, h);
+            break;
+         }
+      }
    }
-   NVGpaint imgPaint = nvgImagePattern (ctx, p.x(), p.y(), w, h, 0, mImage, 1.0);
-   nvgBeginPath (ctx);
-   nvgRect (ctx, p.x(), p.y(), w, h);
-   nvgFillPaint (ctx, imgPaint);
-   nvgFill (ctx);
 }
 
 NAMESPACE_END (nanogui)
@@ -13,28 +13,96 @@
 #pragma once
 
 #include "widget.h"
+#include <memory>
+
+class TileCache;
 
 NAMESPACE_BEGIN (nanogui)
 
+/**
+   \brief Shows an image scaled down to fit the widget
+
+   Live sources, such as video or a camera, can keep one image and replace its
+   pixels every frame with nvglStreamImage(), or wrap a texture they render
+   themselves with nvglCreateImageFromHandle(); see NanoUtil::streamImage() and
+   NanoUtil::createImage(). Call markDirty() after each new frame so that
+   retained and offscreen drawing pick it up.
+
+   A zoomable view is zoomed with the scroll wheel around the cursor and panned
+   by dragging. Images too large for a texture are shown from a \ref TileCache
+   instead, with the tiles of the pyramid level matching the scale on screen;
+   tiles still loading are covered by those of coarser levels.
+*/
 class  ImageView : public Widget
 {
    public:
       ImageView (Widget * parent, int image = 0);
+      ~ImageView();
 
       void setImage (int img)
       {
          mImage = img;
+         invalidateLayout();
       }
       int  image() const
       {
          return mImage;
       }
 
+      /// Show the tiles of a pyramid instead of the image, nullptr goes back to the image
+      void setTiles (const std::shared_ptr<TileCache> & tiles);
+      const std::shared_ptr<TileCache> & tiles() const
+      {
+         return mTiles;
+      }
+
+      /// Let the scroll wheel zoom and dragging pan the image
+      void setZoomable (bool zoomable)
+      {
+         mZoomable = zoomable;
+      }
+      bool zoomable() const
+      {
+         return mZoomable;
+      }
+      /// Return the screen pixels per image pixel, 0 while the image is fit into the widget
+      float scale() const
+      {
+         return mScale;
+      }
+      /// Set the screen pixels per image pixel, keeping the center of the widget on the same image point.
+      /// 0 fits the image into the widget again
+      void setScale (float scale);
+      /// Return the position of the top left image corner relative to the widget while zoomed
+      const Vector2f & offset() const
+      {
+         return mOffset;
+      }
+      void setOffset (const Vector2f & offset)
+      {
+         mOffset = offset;
+         markDirty();
+      }
+
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual bool scrollEvent (const Vector2i & p, const Vector2f & rel);
       virtual void draw (NVGcontext * ctx);
 
    protected:
+      /// Size of the image or of level 0 of the tiles
+      Vector2i contentSize (NVGcontext * ctx) const;
+      /// Screen pixels per image pixel when the image is fit into the widget
+      float fitScale (const Vector2i & content) const;
+      /// Draw the tiles covering the widget at the level matching \c scale
+      void drawTiles (NVGcontext * ctx, float scale, const Vector2f & origin);
+
       int mImage;
+      std::shared_ptr<TileCache> mTiles;
+      bool mZoomable;
+      float mScale;
+      Vector2f mOffset;
+      Vector2i mContentSize;	// of the last draw, for events
 };
 
 NAMESPACE_END (nanogui)
@@ -0,0 +1,279 @@
+/*
+    src/immediate.cpp -- Immediate mode front end creating and updating
+    retained widgets behind the scenes
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "immediate.h"
+#include "button.h"
+#include "checkbox.h"
+#include "label.h"
+#include "layout.h"
+#include "screen.h"
+#include "slider.h"
+#include "textbox.h"
+#include <algorithm>
+
+NAMESPACE_BEGIN (nanogui)
+
+static uint64_t hashId (uint64_t seed, const char * data, size_t size)
+{
+   /* FNV-1a */
+   uint64_t h = seed;
+   for (size_t i = 0; i < size; ++i)
+      h = (h ^ (uint8_t) data[i]) * 1099511628211ull;
+   return h;
+}
+
+/* The part of a caption shown, before any "##" */
+static std::string shown (const std::string & caption)
+{
+   size_t hidden = caption.find ("##");
+   return hidden == std::string::npos ? caption : caption.substr (0, hidden);
+}
+
+ImmediateGui::ImmediateGui (Widget * container)
+   : mContainer (container)
+{
+}
+
+ImmediateGui::~ImmediateGui()
+{
+   /* The callbacks of the widgets point into the slots */
+   for (auto & entry : mSlots)
+   {
+      Widget * widget = entry.second.widget;
+      if (Widget * parent = widget->parent())
+         if (parent->childIndex (widget) >= 0)
+            parent->removeChild (widget);
+   }
+}
+
+void ImmediateGui::run (std::function<void (ImmediateGui &)> build)
+{
+   mBuild = std::move (build);
+   Screen * screen = mContainer->screen();
+   if (!screen || mPoll)
+      return;
+   mPoll = std::make_shared<std::function<void()>> ([this]()
+   {
+      begin();
+      mBuild (*this);
+      end();
+   });
+   screen->addPoll (mPoll);
+}
+
+void ImmediateGui::begin()
+{
+   mFrame++;
+   mIds.assign (1, 14695981039346656037ull);
+   mLevels.assign (1, Level { mContainer, 0 });
+}
+
+void ImmediateGui::end()
+{
+   /* Hold on to all stale widgets until every one is detached, a removed row takes its children along */
+   std::vector<ref<Widget>> stale;
+   for (auto it = mSlots.begin(); it != mSlots.end();)
+   {
+      if (it->second.frame == mFrame)
+      {
+         ++it;
+         continue;
+      }
+      stale.push_back (it->second.widget);
+      it = mSlots.erase (it);
+   }
+   for (Widget * widget : stale)
+      if (Widget * parent = widget->parent())
+         if (parent->childIndex (widget) >= 0)
+            parent->removeChild (widget);
+}
+
+void ImmediateGui::pushId (const std::string & id)
+{
+   mIds.push_back (hashId (mIds.back() ^ 0x9e3779b97f4a7c15ull, id.data(), id.size()));
+}
+
+void ImmediateGui::pushId (int id)
+{
+   mIds.push_back (hashId (mIds.back() ^ 0x9e3779b97f4a7c15ull, (const char *) &id, sizeof (id)));
+}
+
+void ImmediateGui::popId()
+{
+   if (mIds.size() > 1)
+      mIds.pop_back();
+}
+
+ImmediateGui::Slot & ImmediateGui::slot (Kind kind, const std::string & id, bool & created)
+{
+   uint64_t h = hashId (mIds.back() + kind, id.data(), id.size());
+   auto it = mSlots.find (h);
+   /* Calls repeating an id in one frame are told apart by their order */
+   for (uint64_t n = 1; it != mSlots.end() && it->second.frame == mFrame; ++n)
+      it = mSlots.find (h = hashId (h, (const char *) &n, sizeof (n)));
+   created = it == mSlots.end();
+   Slot & slot = created ? mSlots[h] : it->second;
+   slot.frame = mFrame;
+   return slot;
+}
+
+void ImmediateGui::place (Slot & slot)
+{
+   Level & level = mLevels.back();
+   if (level.parent->childIndex (slot.widget) != level.index)
+      level.parent->moveChild (slot.widget, level.index);
+   level.index++;
+}
+
+void ImmediateGui::beginRow (const std::string & id)
+{
+   bool created;
+   Slot & row = slot (RowKind, id, created);
+   if (created)
+   {
+      Widget * panel = new Widget (parent());
+      panel->setLayout (new BoxLayout (Orientation::Horizontal, Alignment::Middle, 0, 6));
+      row.widget = panel;
+   }
+   place (row);
+   mLevels.push_back (Level { row.widget, 0 });
+   pushId (id);
+}
+
+void ImmediateGui::endRow()
+{
+   if (mLevels.size() <= 1)
+      return;
+   mLevels.pop_back();
+   popId();
+}
+
+void ImmediateGui::label (const std::string & caption)
+{
+   bool created;
+   Slot & s = slot (LabelKind, caption, created);
+   if (created)
+      s.widget = new Label (parent(), shown (caption));
+   place (s);
+}
+
+bool ImmediateGui::button (const std::string & caption, int icon)
+{
+   bool created;
+   Slot & s = slot (ButtonKind, caption, created);
+   if (created)
+   {
+      Button * button = new Button (parent(), shown (caption), icon);
+      Slot * target = &s;
+      button->setCallback ([target] { target->fired = true; });
+      s.widget = button;
+   }
+   else
+   {
+      Button * button = (Button *) s.widget.get();
+      if (button->icon() != icon)
+         button->setIcon (icon);
+   }
+   place (s);
+   bool clicked = s.fired;
+   s.fired = false;
+   return clicked;
+}
+
+bool ImmediateGui::checkbox (const std::string & caption, bool & value)
+{
+   bool created;
+   Slot & s = slot (CheckBoxKind, caption, created);
+   if (created)
+   {
+      CheckBox * checkBox = new CheckBox (parent(), shown (caption));
+      Slot * target = &s;
+      checkBox->setCallback ([target] (bool checked)
+      {
+         target->fired = true;
+         target->value = checked ? 1.0f : 0.0f;
+      });
+      s.widget = checkBox;
+   }
+   place (s);
+   CheckBox * checkBox = (CheckBox *) s.widget.get();
+   bool toggled = s.fired;
+   s.fired = false;
+   if (toggled)
+      value = s.value != 0.0f;
+   else
+      if (checkBox->checked() != value)
+         checkBox->setChecked (value);
+   return toggled;
+}
+
+bool ImmediateGui::slider (const std::string & id, float & value, float min, float max)
+{
+   bool created;
+   Slot & s = slot (SliderKind, id, created);
+   if (created)
+   {
+      Slider * slider = new Slider (parent());
+      Slot * target = &s;
+      slider->setCallback ([target] (float v)
+      {
+         target->fired = true;
+         target->value = v;
+      });
+      s.widget = slider;
+   }
+   place (s);
+   Slider * slider = (Slider *) s.widget.get();
+   float range = max - min;
+   bool moved = s.fired;
+   s.fired = false;
+   if (moved)
+      value = min + s.value * range;
+   else
+   {
+      float shown = range != 0.0f ? std::min (std::max ((value - min) / range, 0.0f), 1.0f) : 0.0f;
+      if (slider->value() != shown)
+         slider->setValue (shown);
+   }
+   return moved;
+}
+
+bool ImmediateGui::textBox (const std::string & id, std::string & value)
+{
+   bool created;
+   Slot & s = slot (TextBoxKind, id, created);
+   if (created)
+   {
+      TextBox * textBox = new TextBox (parent(), value);
+      textBox->setEditable (true);
+      Slot * target = &s;
+      textBox->setCallback ([target] (const std::string & text)
+      {
+         target->fired = true;
+         target->text = text;
+         return true;
+      });
+      s.widget = textBox;
+   }
+   place (s);
+   TextBox * textBox = (TextBox *) s.widget.get();
+   bool committed = s.fired;
+   s.fired = false;
+   if (committed)
+      value = s.text;
+   else
+      if (!textBox->focused())
+         textBox->setValue (value);
+   return committed;
+}
+
+NAMESPACE_END (nanogui)
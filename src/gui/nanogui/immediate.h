@@ -0,0 +1,145 @@
+/*
+    nanogui/immediate.h -- Immediate mode front end creating and updating
+    retained widgets behind the scenes
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Immediate mode calls mapped onto cached widgets
+
+   The panel is described again by calls between \ref begin() and \ref end()
+   whenever the application likes, usually every frame through \ref run():
+
+   \code
+   ImmediateGui gui (window);
+   gui.run ([&] (ImmediateGui & ui)
+   {
+      ui.label ("Exposure");
+      ui.slider ("exposure", mExposure, -4.0f, 4.0f);
+      ui.beginRow();
+      if (ui.button ("Reset"))
+         mExposure = 0.0f;
+      ui.checkbox ("Auto", mAuto);
+      ui.endRow();
+   });
+   \endcode
+
+   Every call hashes its id with the ids pushed around it into a table of
+   the widgets made by earlier frames. A caption doubles as the id, unless it
+   holds "##", in which case only what precedes it is shown and the whole
+   string is hashed; calls repeating an id in one frame get told apart by
+   their order. A call finding its widget only touches it when the value
+   passed differs from what it shows, and widgets stay in place unless calls
+   come in another order, so an unchanged frame neither lays out nor redraws
+   anything. Widgets not called for in a frame are removed by \ref end().
+
+   What the user does is reported by the next call for the widget: a click
+   makes \ref button() return true once, an edit writes the new value to the
+   variable passed and makes the call return true.
+*/
+class  ImmediateGui
+{
+   public:
+      explicit ImmediateGui (Widget * container);
+      ~ImmediateGui();
+
+      /**
+         \brief Call \c build between \ref begin() and \ref end() on every frame of the screen
+
+         It runs from \ref Screen::drawWidgets(), before the widgets are laid
+         out and drawn. Once the container is attached to a screen only.
+      */
+      void run (std::function<void (ImmediateGui &)> build);
+
+      /// Start describing the panel, widgets are added to the container from the first one on
+      void begin();
+      /// Remove the widgets no call asked for since \ref begin()
+      void end();
+
+      /// Prefix the ids of the calls up to the matching \ref popId() with \c id, e.g. the index of a list item
+      void pushId (const std::string & id);
+      void pushId (int id);
+      void popId();
+
+      /// Put the widgets up to \ref endRow() next to each other
+      void beginRow (const std::string & id = "##row");
+      void endRow();
+
+      void label (const std::string & caption);
+      /// Return whether the button was clicked since the last call
+      bool button (const std::string & caption, int icon = 0);
+      /// Return whether the user toggled the box, \c value then holds the new state
+      bool checkbox (const std::string & caption, bool & value);
+      /// Return whether the user moved the slider, \c value then holds the new value
+      bool slider (const std::string & id, float & value, float min = 0.0f, float max = 1.0f);
+      /// Return whether the user committed an edit, \c value then holds the new text
+      bool textBox (const std::string & id, std::string & value);
+
+      /// Return the number of widgets made for the calls of the last frame
+      size_t size() const
+      {
+         return mSlots.size();
+      }
+
+   protected:
+      enum Kind : uint8_t
+      {
+         RowKind,
+         LabelKind,
+         ButtonKind,
+         CheckBoxKind,
+         SliderKind,
+         TextBoxKind
+      };
+      /// Widget of one call, its input since the last call
+      struct Slot
+      {
+         ref<Widget> widget;
+         unsigned int frame = 0;
+         bool fired = false;
+         float value = 0.0f;
+         std::string text;
+      };
+      struct Level
+      {
+         Widget * parent;
+         int index;	// of the next widget among the children of parent
+      };
+
+      /// Return the slot for \c id in this frame and whether it was just made
+      Slot & slot (Kind kind, const std::string & id, bool & created);
+      /// Keep the widget of \c slot at the position of the call among its siblings
+      void place (Slot & slot);
+      Widget * parent() const
+      {
+         return mLevels.back().parent;
+      }
+
+      ref<Widget> mContainer;
+      std::unordered_map<uint64_t, Slot> mSlots;
+      std::vector<uint64_t> mIds;	// seeds pushed by pushId() and rows
+      std::vector<Level> mLevels;
+      unsigned int mFrame = 0;
+      std::shared_ptr<std::function<void()>> mPoll;
+      std::function<void (ImmediateGui &)> mBuild;
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,275 @@
+/*
+    src/inputrecorder.cpp -- Recording of the input events of a screen to
+    a compact binary file, and their replay
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "inputrecorder.h"
+#include "screen.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+NAMESPACE_BEGIN (nanogui)
+
+static const char magic[4] = { 'N', 'G', 'I', 'R' };
+static const uint8_t formatVersion = 1;
+static const size_t flushSize = 1 << 14;
+
+InputRecorder::InputRecorder (const std::string & path, const Vector2i & size)
+   : mFile (fopen (path.c_str(), "wb")), mLast (std::chrono::steady_clock::now())
+{
+   if (!mFile)
+      throw std::runtime_error ("InputRecorder: could not create \"" + path + "\"");
+   mBuffer.insert (mBuffer.end(), magic, magic + 4);
+   mBuffer.push_back (formatVersion);
+   put ((uint64_t)std::max (0, size.x()));
+   put ((uint64_t)std::max (0, size.y()));
+}
+
+InputRecorder::~InputRecorder()
+{
+   flush();
+   fclose (mFile);
+}
+
+void InputRecorder::flush()
+{
+   if (!mBuffer.empty())
+      fwrite (mBuffer.data(), 1, mBuffer.size(), mFile);
+   mBuffer.clear();
+   fflush (mFile);
+}
+
+void InputRecorder::put (uint64_t value)
+{
+   /* LEB128, 7 bits per byte with the high bit flagging that more follow */
+   while (value >= 0x80)
+   {
+      mBuffer.push_back ((uint8_t) (value | 0x80));
+      value >>= 7;
+   }
+   mBuffer.push_back ((uint8_t)value);
+}
+
+void InputRecorder::putSigned (int64_t value)
+{
+   /* Zigzag, so that small negative numbers stay short */
+   put (((uint64_t)value << 1) ^ (uint64_t) (value >> 63));
+}
+
+void InputRecorder::begin (Record type)
+{
+   auto now = std::chrono::steady_clock::now();
+   mBuffer.push_back (type);
+   put ((uint64_t)std::chrono::duration_cast<std::chrono::microseconds> (now - mLast).count());
+   mLast = now;
+}
+
+void InputRecorder::cursorPos (int x, int y)
+{
+   begin (CursorPos);
+   putSigned (x - mX);
+   putSigned (y - mY);
+   mX = x;
+   mY = y;
+}
+
+void InputRecorder::mouseButton (int button, int action, int modifiers)
+{
+   begin (MouseButton);
+   putSigned (button);
+   putSigned (action);
+   putSigned (modifiers);
+}
+
+void InputRecorder::key (int key, int scancode, int action, int mods)
+{
+   begin (Key);
+   putSigned (key);
+   putSigned (scancode);
+   putSigned (action);
+   putSigned (mods);
+}
+
+void InputRecorder::character (unsigned int codepoint)
+{
+   begin (Char);
+   put (codepoint);
+}
+
+void InputRecorder::resize (int width, int height)
+{
+   begin (Resize);
+   putSigned (width);
+   putSigned (height);
+}
+
+void InputRecorder::frame()
+{
+   begin (Frame);
+   mFrames++;
+   if (mBuffer.size() >= flushSize)
+      flush();
+}
+
+/* Readers of the variable length integers, throwing at the end of the data */
+static uint64_t get (const std::vector<uint8_t> & data, size_t & pos)
+{
+   uint64_t value = 0;
+   for (int shift = 0; shift < 64; shift += 7)
+   {
+      if (pos >= data.size())
+         throw std::runtime_error ("InputReplayer: the recording is truncated");
+      uint8_t byte = data[pos++];
+      value |= (uint64_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return value;
+   }
+   throw std::runtime_error ("InputReplayer: the recording is damaged");
+}
+
+static int getSigned (const std::vector<uint8_t> & data, size_t & pos)
+{
+   uint64_t value = get (data, pos);
+   return (int) ((int64_t) (value >> 1) ^ -(int64_t) (value & 1));
+}
+
+InputReplayer::InputReplayer (const std::string & path)
+{
+   FILE * file = fopen (path.c_str(), "rb");
+   if (!file)
+      throw std::runtime_error ("InputReplayer: could not open \"" + path + "\"");
+   uint8_t chunk[1 << 14];
+   while (size_t n = fread (chunk, 1, sizeof (chunk), file))
+      mData.insert (mData.end(), chunk, chunk + n);
+   fclose (file);
+   if (mData.size() < 5 || memcmp (mData.data(), magic, 4) != 0 || mData[4] != formatVersion)
+      throw std::runtime_error ("InputReplayer: \"" + path + "\" is not an input recording");
+   size_t pos = 5;
+   mSize.x() = (int)get (mData, pos);
+   mSize.y() = (int)get (mData, pos);
+   mStart = pos;
+   /* Check every record now rather than fail halfway through a run */
+   double time = 0.0;
+   int x = 0, y = 0;
+   Event event;
+   while (decode (pos, time, x, y, event))
+   {
+      if (event.type == InputRecorder::Frame)
+         mFrameCount++;
+   }
+   mDuration = time;
+   rewind();
+}
+
+void InputReplayer::rewind()
+{
+   mPos = mStart;
+   mTime = 0.0;
+   mX = mY = 0;
+}
+
+bool InputReplayer::decode (size_t & pos, double & time, int & x, int & y, Event & event) const
+{
+   if (pos >= mData.size())
+      return false;
+   event.type = (InputRecorder::Record)mData[pos++];
+   time += get (mData, pos) * 1e-6;
+   event.time = time;
+   switch (event.type)
+   {
+      case InputRecorder::CursorPos:
+         x += getSigned (mData, pos);
+         y += getSigned (mData, pos);
+         event.args[0] = x;
+         event.args[1] = y;
+         break;
+      case InputRecorder::MouseButton:
+         for (int i = 0; i < 3; ++i)
+            event.args[i] = getSigned (mData, pos);
+         break;
+      case InputRecorder::Key:
+         for (int i = 0; i < 4; ++i)
+            event.args[i] = getSigned (mData, pos);
+         break;
+      case InputRecorder::Char:
+         event.args[0] = (int)get (mData, pos);
+         break;
+      case InputRecorder::Resize:
+         event.args[0] = getSigned (mData, pos);
+         event.args[1] = getSigned (mData, pos);
+         break;
+      case InputRecorder::Frame:
+         break;
+      default:
+         throw std::runtime_error ("InputReplayer: unknown record type " + std::to_string ((int)event.type));
+   }
+   return true;
+}
+
+void InputReplayer::deliver (Screen * screen, const Event & event)
+{
+   switch (event.type)
+   {
+      case InputRecorder::CursorPos:
+         screen->cursorPosCallbackEvent (event.args[0], event.args[1]);
+         break;
+      case InputRecorder::MouseButton:
+         screen->mouseButtonCallbackEvent (event.args[0], event.args[1], event.args[2]);
+         break;
+      case InputRecorder::Key:
+         screen->keyCallbackEvent (event.args[0], event.args[1], event.args[2], event.args[3]);
+         break;
+      case InputRecorder::Char:
+         screen->charCallbackEvent ((unsigned int)event.args[0]);
+         break;
+      case InputRecorder::Resize:
+         screen->resizeCallbackEvent (event.args[0], event.args[1]);
+         break;
+      default:
+         break;
+   }
+}
+
+bool InputReplayer::replayFrame (Screen * screen)
+{
+   if (finished())
+      return false;
+   Event event;
+   while (decode (mPos, mTime, mX, mY, event))
+   {
+      if (event.type == InputRecorder::Frame)
+         break;
+      deliver (screen, event);
+   }
+   return true;
+}
+
+bool InputReplayer::replayUntil (Screen * screen, double time)
+{
+   while (!finished())
+   {
+      size_t pos = mPos;
+      double eventTime = mTime;
+      int x = mX, y = mY;
+      Event event;
+      decode (pos, eventTime, x, y, event);
+      if (eventTime > time)
+         break;
+      mPos = pos;
+      mTime = eventTime;
+      mX = x;
+      mY = y;
+      deliver (screen, event);
+   }
+   return !finished();
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,163 @@
+/*
+    nanogui/inputrecorder.h -- Recording of the input events of a screen to
+    a compact binary file, and their replay
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+class Screen;
+
+/**
+   \brief Writes the input events of a screen to a file as they arrive
+
+   Attached with \ref Screen::setInputRecorder(), the recorder receives the
+   arguments of every call to the screen's \c *CallbackEvent() entry points,
+   including the motions of the input sampler, and a marker for every
+   \ref Screen::drawWidgets(), so a replay can deliver the events between
+   the same frames. Every record is a type byte, the microseconds since the
+   previous record and the arguments, as variable length integers with
+   cursor positions relative to the previous one; a minute of busy input
+   takes a few dozen kilobytes.
+
+   \code
+   InputRecorder recorder ("session.ngir", screen->size());
+   screen->setInputRecorder (&recorder);
+   \endcode
+*/
+class  InputRecorder
+{
+   public:
+      /// Record types, also the format of the file
+      enum Record : uint8_t
+      {
+         CursorPos = 1,
+         MouseButton,
+         Key,
+         Char,
+         Resize,
+         Frame
+      };
+
+      /// Open \c path for writing, throws std::runtime_error if it cannot be created
+      InputRecorder (const std::string & path, const Vector2i & size);
+      /// Flush and close the file
+      ~InputRecorder();
+
+      void cursorPos (int x, int y);
+      void mouseButton (int button, int action, int modifiers);
+      void key (int key, int scancode, int action, int mods);
+      void character (unsigned int codepoint);
+      void resize (int width, int height);
+      /// Mark the start of a frame
+      void frame();
+
+      /// Return the number of frames recorded so far
+      int frames() const
+      {
+         return mFrames;
+      }
+      /// Write the buffered records to the file
+      void flush();
+
+   protected:
+      void begin (Record type);
+      void put (uint64_t value);
+      void putSigned (int64_t value);
+
+      FILE * mFile;
+      std::vector<uint8_t> mBuffer;
+      std::chrono::steady_clock::time_point mLast;
+      int mX = 0, mY = 0;
+      int mFrames = 0;
+};
+
+/**
+   \brief Feeds the events of a file written by \ref InputRecorder into a screen
+
+   The whole file is read and checked up front. \ref replayFrame() delivers
+   the events of one recorded frame per call, for runs at maximum speed that
+   draw exactly the frames of the recording; \ref replayUntil() delivers
+   the events whose recorded time has come, for runs at the recorded speed.
+   The screen should be of the recorded \ref size() and have no input
+   sampler, whose motions would be mixed into the replayed ones.
+
+   \code
+   InputReplayer replay ("session.ngir");
+   while (replay.replayFrame (screen))
+      screen->drawWidgets();
+   \endcode
+*/
+class  InputReplayer
+{
+   public:
+      /// Read \c path, throws std::runtime_error if it cannot be read or is not a recording
+      explicit InputReplayer (const std::string & path);
+
+      /// Return the size of the screen when the recording started
+      const Vector2i & size() const
+      {
+         return mSize;
+      }
+      /// Return the number of frames in the recording
+      int frameCount() const
+      {
+         return mFrameCount;
+      }
+      /// Return the seconds from the start to the last record
+      double duration() const
+      {
+         return mDuration;
+      }
+      /// Return whether every event was delivered
+      bool finished() const
+      {
+         return mPos >= mData.size();
+      }
+
+      /// Start over from the first event
+      void rewind();
+      /// Deliver the events up to the next frame marker, false if the recording had ended
+      bool replayFrame (Screen * screen);
+      /// Deliver the events recorded up to \c time seconds after the start, false once the recording ended
+      bool replayUntil (Screen * screen, double time);
+
+   protected:
+      struct Event
+      {
+         InputRecorder::Record type;
+         double time;
+         int args[4];
+      };
+
+      /// Decode the record at \c pos, advancing it, throws std::runtime_error if it is damaged
+      bool decode (size_t & pos, double & time, int & x, int & y, Event & event) const;
+      void deliver (Screen * screen, const Event & event);
+
+      std::vector<uint8_t> mData;
+      size_t mStart = 0;	// of the first record
+      Vector2i mSize = Vector2i::Zero();
+      int mFrameCount = 0;
+      double mDuration = 0.0;
+      /* Replay position */
+      size_t mPos = 0;
+      double mTime = 0.0;
+      int mX = 0, mY = 0;
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,54 @@
+/*
+    src/internedstring.cpp -- Strings stored once per distinct value
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "internedstring.h"
+#include <mutex>
+#include <unordered_set>
+
+NAMESPACE_BEGIN (nanogui)
+
+namespace
+{
+   /* Leaked on purpose, handles held by static objects outlive any destruction order */
+   struct Pool
+   {
+      std::mutex mutex;
+      std::unordered_set<std::string> strings;	// nodes never move, so their addresses are the handles
+   };
+
+   Pool & pool()
+   {
+      static Pool * instance = new Pool();
+      return *instance;
+   }
+}
+
+const std::string * InternedString::emptyString()
+{
+   static const std::string * str = intern (std::string());
+   return str;
+}
+
+const std::string * InternedString::intern (const std::string & str)
+{
+   Pool & p = pool();
+   std::lock_guard<std::mutex> lock (p.mutex);
+   return &*p.strings.insert (str).first;
+}
+
+size_t InternedString::poolSize()
+{
+   Pool & p = pool();
+   std::lock_guard<std::mutex> lock (p.mutex);
+   return p.strings.size();
+}
+
+NAMESPACE_END (nanogui)
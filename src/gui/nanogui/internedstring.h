@@ -0,0 +1,76 @@
+/*
+    nanogui/internedstring.h -- Strings stored once per distinct value
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <string>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Handle of a string in a process-wide pool of distinct strings
+
+   Ids, tooltips and font names repeat across thousands of widgets. Each
+   distinct value is stored once and never freed, and a handle is a single
+   pointer that compares in O(1). Interning takes a lock and may happen on
+   any thread, reading a handle takes none.
+*/
+class  InternedString
+{
+   public:
+      InternedString() : mStr (emptyString()) {}
+      InternedString (const std::string & str) : mStr (intern (str)) {}
+      InternedString (const char * str) : mStr (intern (str)) {}
+
+      InternedString & operator= (const std::string & str)
+      {
+         mStr = intern (str);
+         return *this;
+      }
+
+      const std::string & str() const
+      {
+         return *mStr;
+      }
+      operator const std::string & () const
+      {
+         return *mStr;
+      }
+      const char * c_str() const
+      {
+         return mStr->c_str();
+      }
+      bool empty() const
+      {
+         return mStr->empty();
+      }
+
+      bool operator== (const InternedString & other) const
+      {
+         return mStr == other.mStr;
+      }
+      bool operator!= (const InternedString & other) const
+      {
+         return mStr != other.mStr;
+      }
+
+      /// Number of distinct strings interned so far
+      static size_t poolSize();
+
+   protected:
+      static const std::string * emptyString();
+      static const std::string * intern (const std::string & str);
+
+      const std::string * mStr;
+};
+
+NAMESPACE_END (nanogui)
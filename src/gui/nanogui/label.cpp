@@ -18,23 +18,32 @@ NAMESPACE_BEGIN (nanogui)
 Label::Label (Widget * parent, const std::string & caption, const std::string & font, int fontSize)
    : Widget (parent), mCaption (caption), mFont (font)
 {
+   mKind |= LabelKind;
    mFontSize = fontSize < 0 ? mTheme->mStandardFontSize : fontSize;
    mColor = mTheme->mTextColor;
 }
 
+Label::~Label()
+{
+   nvgDeleteParagraph (mParagraph);
+}
+
 Vector2i Label::preferredSize (NVGcontext * ctx) const
 {
    if (mCaption == "")
       return Vector2i::Zero();
    nvgFontSize (ctx, fontSize());
-   nvgFontFace (ctx, mFont.c_str());
-   if (mFixedSize.x() > 0)
+   nvgFontFaceId (ctx, mFont.id (ctx));
+   if (fixedWidth() > 0)
    {
       float bounds[4];
+      if (!mParagraph)
+         mParagraph = nvgCreateParagraph();
       nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
-      nvgTextBoxBounds (ctx, 0, 0, mFixedSize.x(), mCaption.c_str(), nullptr, bounds);
+      nvgParagraphLayout (ctx, mParagraph, mCaption.c_str(), nullptr, fixedWidth());
+      nvgParagraphBounds (ctx, mParagraph, 0, 0, bounds);
       return Vector2i (
-                mFixedSize.x(), bounds[3] - bounds[1]
+                fixedWidth(), bounds[3] - bounds[1]
              );
    }
    else
@@ -51,12 +60,15 @@ void Label::draw (NVGcontext * ctx)
 {
    Widget::draw (ctx);
    nvgFontSize (ctx, fontSize());
-   nvgFontFace (ctx, mFont.c_str());
+   nvgFontFaceId (ctx, mFont.id (ctx));
    nvgFillColor (ctx, mColor);
-   if (mFixedSize.x() > 0)
+   if (fixedWidth() > 0)
    {
+      if (!mParagraph)
+         mParagraph = nvgCreateParagraph();
       nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
-      nvgTextBox (ctx, mPos.x(), mPos.y(), mFixedSize.x(), mCaption.c_str(), nullptr);
+      nvgParagraphLayout (ctx, mParagraph, mCaption.c_str(), nullptr, fixedWidth());
+      nvgParagraphDraw (ctx, mParagraph, mPos.x(), mPos.y());
    }
    else
    {
@@ -12,6 +12,7 @@
 #pragma once
 
 #include "widget.h"
+#include "theme.h"
 
 NAMESPACE_BEGIN (nanogui)
 
@@ -21,11 +22,12 @@ NAMESPACE_BEGIN (nanogui)
    The font and color can be customized. When \ref Widget::setFixedWidth()
    is used, the text is wrapped when it surpasses the specified width
 */
-class  Label : public Widget
+class  Label final : public Widget
 {
    public:
       Label (Widget * parent, const std::string & caption,
              const std::string & font = "sans", int fontSize = -1);
+      virtual ~Label();
 
       /// Get the label's text caption
       const std::string & caption() const
@@ -36,17 +38,24 @@ class  Label : public Widget
       void setCaption (const std::string & caption)
       {
          mCaption = caption;
+         invalidateLayout();
+         searchTextChanged();
+      }
+      virtual const std::string & searchText() const
+      {
+         return mCaption;
       }
 
       /// Set the currently active font (2 are available by default: 'sans' and 'sans-bold')
       void setFont (const std::string & font)
       {
-         mFont = font;
+         mFont.setName (font);
+         invalidateLayout();
       }
       /// Get the currently active font
       const std::string & font() const
       {
-         return mFont;
+         return mFont.name();
       }
 
       /// Get the label color
@@ -58,6 +67,7 @@ class  Label : public Widget
       void setColor (Color color)
       {
          mColor = color;
+         markDirty();
       }
 
       /// Compute the size needed to fully display the label
@@ -66,8 +76,10 @@ class  Label : public Widget
       virtual void draw (NVGcontext * ctx);
    protected:
       std::string mCaption;
-      std::string mFont;
+      FontHandle mFont;
       Color mColor;
+      /// Wrapped rows of the caption, only used with a fixed width
+      mutable NVGparagraph * mParagraph = nullptr;
 };
 
 NAMESPACE_END (nanogui)
@@ -30,7 +30,7 @@ BoxLayout::BoxLayout (Orientation orientation, Alignment alignment,
 Vector2i BoxLayout::preferredSize (NVGcontext * ctx, const Widget * widget) const
 {
    Vector2i size = Vector2i::Constant (2 * mMargin);
-   if (dynamic_cast<const Window *> (widget))
+   if (widget->isWindow())
       size[1] += widget->theme()->mWindowHeaderHeight - mMargin / 2;
    bool first = true;
    int axis1 = (int) mOrientation, axis2 = ((int) mOrientation + 1) % 2;
@@ -40,7 +40,7 @@ Vector2i BoxLayout::preferredSize (NVGcontext * ctx, const Widget * widget) cons
          first = false;
       else
          size[axis1] += mSpacing;
-      Vector2i ps = w->preferredSize (ctx), fs = w->fixedSize();
+      Vector2i ps = w->cachedPreferredSize (ctx), fs = w->fixedSize();
       Vector2i targetSize (
          fs[0] ? fs[0] : ps[0],
          fs[1] ? fs[1] : ps[1]
@@ -61,7 +61,7 @@ void BoxLayout::performLayout (NVGcontext * ctx, Widget * widget) const
    );
    int axis1 = (int) mOrientation, axis2 = ((int) mOrientation + 1) % 2;
    int position = mMargin;
-   if (dynamic_cast<Window *> (widget))
+   if (widget->isWindow())
       position += widget->theme()->mWindowHeaderHeight - mMargin / 2;
    bool first = true;
    for (auto w : widget->children())
@@ -70,7 +70,7 @@ void BoxLayout::performLayout (NVGcontext * ctx, Widget * widget) const
          first = false;
       else
          position += mSpacing;
-      Vector2i ps = w->preferredSize (ctx), fs = w->fixedSize();
+      Vector2i ps = w->cachedPreferredSize (ctx), fs = w->fixedSize();
       Vector2i targetSize (
          fs[0] ? fs[0] : ps[0],
          fs[1] ? fs[1] : ps[1]
@@ -103,17 +103,17 @@ void BoxLayout::performLayout (NVGcontext * ctx, Widget * widget) const
 Vector2i GroupLayout::preferredSize (NVGcontext * ctx, const Widget * widget) const
 {
    int height = mMargin, width = 2 * mMargin;
-   const Window * window = dynamic_cast<const Window *> (widget);
+   const Window * window = widget->isWindow() ? (const Window *) widget : nullptr;
    if (window && !window->title().empty())
       height += widget->theme()->mWindowHeaderHeight - mMargin / 2;
    bool first = true, indent = false;
    for (auto c : widget->children())
    {
-      const Label * label = dynamic_cast<const Label *> (c);
+      const Label * label = c->isLabel() ? (const Label *) c : nullptr;
       if (!first)
          height += (label == nullptr) ? mSpacing : mGroupSpacing;
       first = false;
-      Vector2i ps = c->preferredSize (ctx), fs = c->fixedSize();
+      Vector2i ps = c->cachedPreferredSize (ctx), fs = c->fixedSize();
       Vector2i targetSize (
          fs[0] ? fs[0] : ps[0],
          fs[1] ? fs[1] : ps[1]
@@ -132,19 +132,19 @@ void GroupLayout::performLayout (NVGcontext * ctx, Widget * widget) const
 {
    int height = mMargin, availableWidth =
                    (widget->fixedWidth() ? widget->fixedWidth() : widget->width()) - 2 * mMargin;
-   const Window * window = dynamic_cast<const Window *> (widget);
+   const Window * window = widget->isWindow() ? (const Window *) widget : nullptr;
    if (window && !window->title().empty())
       height += widget->theme()->mWindowHeaderHeight - mMargin / 2;
    bool first = true, indent = false;
    for (auto c : widget->children())
    {
-      const Label * label = dynamic_cast<const Label *> (c);
+      const Label * label = c->isLabel() ? (const Label *) c : nullptr;
       if (!first)
          height += (label == nullptr) ? mSpacing : mGroupSpacing;
       first = false;
       bool indentCur = indent && label == nullptr;
       Vector2i ps = Vector2i (availableWidth - (indentCur ? mGroupIndent : 0),
-                              c->preferredSize (ctx).y());
+                              c->cachedPreferredSize (ctx).y());
       Vector2i fs = c->fixedSize();
       Vector2i targetSize (
          fs[0] ? fs[0] : ps[0],
@@ -171,7 +171,7 @@ Vector2i GridLayout::preferredSize (NVGcontext * ctx,
       2 * mMargin + std::accumulate (grid[1].begin(), grid[1].end(), 0)
       + std::max ((int) grid[1].size() - 1, 0) * mSpacing[1]
    );
-   if (dynamic_cast<const Window *> (widget))
+   if (widget->isWindow())
       size[1] += widget->theme()->mWindowHeaderHeight - mMargin / 2;
    return size;
 }
@@ -195,7 +195,7 @@ void GridLayout::computeLayout (NVGcontext * ctx, const Widget * widget, std::ve
          if (child >= numChildren)
             return;
          Widget * w = widget->children()[child++];
-         Vector2i ps = w->preferredSize (ctx);
+         Vector2i ps = w->cachedPreferredSize (ctx);
          Vector2i fs = w->fixedSize();
          Vector2i targetSize (
             fs[0] ? fs[0] : ps[0],
@@ -219,7 +219,7 @@ void GridLayout::performLayout (NVGcontext * ctx, Widget * widget) const
    computeLayout (ctx, widget, grid);
    int dim[2] = { (int) grid[0].size(), (int) grid[1].size() };
    Vector2i extra = Vector2i::Zero();
-   if (dynamic_cast<Window *> (widget))
+   if (widget->isWindow())
       extra[1] += widget->theme()->mWindowHeaderHeight - mMargin / 2;
    /* Strech to size provided by \c widget */
    for (int i = 0; i < 2; i++)
@@ -256,7 +256,7 @@ void GridLayout::performLayout (NVGcontext * ctx, Widget * widget) const
          if (child >= numChildren)
             return;
          Widget * w = widget->children()[child++];
-         Vector2i ps = w->preferredSize (ctx);
+         Vector2i ps = w->cachedPreferredSize (ctx);
          Vector2i fs = w->fixedSize();
          Vector2i targetSize (
             fs[0] ? fs[0] : ps[0],
@@ -303,12 +303,16 @@ Vector2i AdvancedGridLayout::preferredSize (NVGcontext * ctx, const Widget * wid
 {
    /* Compute minimum row / column sizes */
    std::vector<int> grid[2];
-   computeLayout (ctx, widget, grid);
+   computeMinimum (ctx, grid);
+   mMinimum[0] = grid[0];
+   mMinimum[1] = grid[1];
+   mMinimumFor = widget;
+   distribute (widget, grid);
    Vector2i size (
       std::accumulate (grid[0].begin(), grid[0].end(), 0),
       std::accumulate (grid[1].begin(), grid[1].end(), 0));
    Vector2i extra = Vector2i::Constant (2 * mMargin);
-   if (dynamic_cast<const Window *> (widget))
+   if (widget->isWindow())
       extra[1] += widget->theme()->mWindowHeaderHeight - mMargin / 2;
    return size + extra;
 }
@@ -316,23 +320,34 @@ Vector2i AdvancedGridLayout::preferredSize (NVGcontext * ctx, const Widget * wid
 void AdvancedGridLayout::performLayout (NVGcontext * ctx, Widget * widget) const
 {
    std::vector<int> grid[2];
-   computeLayout (ctx, widget, grid);
+   if (mMinimumFor == widget)
+   {
+      grid[0].swap (mMinimum[0]);
+      grid[1].swap (mMinimum[1]);
+      mMinimumFor = nullptr;
+   }
+   else
+      computeMinimum (ctx, grid);
+   distribute (widget, grid);
    grid[0].insert (grid[0].begin(), mMargin);
-   if (dynamic_cast<const Window *> (widget))
+   if (widget->isWindow())
       grid[1].insert (grid[1].begin(), widget->theme()->mWindowHeaderHeight + mMargin / 2);
    else
       grid[1].insert (grid[1].begin(), mMargin);
    for (int axis = 0; axis < 2; ++axis)
-   {
       for (size_t i = 1; i < grid[axis].size(); ++i)
          grid[axis][i] += grid[axis][i - 1];
-      for (Widget * w : widget->children())
+   /* Both axes are placed before the child is laid out, so that it is laid out once */
+   for (Widget * w : widget->children())
+   {
+      Anchor anchor = this->anchor (w);
+      Vector2i ps = w->cachedPreferredSize (ctx), fs = w->fixedSize();
+      Vector2i pos, size;
+      for (int axis = 0; axis < 2; ++axis)
       {
-         Anchor anchor = this->anchor (w);
          int itemPos = grid[axis][anchor.pos[axis]];
          int cellSize  = grid[axis][anchor.pos[axis] + anchor.size[axis]] - itemPos;
-         int ps = w->preferredSize (ctx)[axis], fs = w->fixedSize()[axis];
-         int targetSize = fs ? fs : ps;
+         int targetSize = fs[axis] ? fs[axis] : ps[axis];
          switch (anchor.align[axis])
          {
             case Alignment::Minimum:
@@ -344,31 +359,20 @@ void AdvancedGridLayout::performLayout (NVGcontext * ctx, Widget * widget) const
                itemPos += cellSize - targetSize;
                break;
             case Alignment::Fill:
-               targetSize = fs ? fs : cellSize;
+               targetSize = fs[axis] ? fs[axis] : cellSize;
                break;
          }
-         Vector2i pos = w->position(), size = w->size();
          pos[axis] = itemPos;
          size[axis] = targetSize;
-         w->setPosition (pos);
-         w->setSize (size);
-         w->performLayout (ctx);
       }
+      w->setPosition (pos);
+      w->setSize (size);
+      w->performLayout (ctx);
    }
 }
 
-void AdvancedGridLayout::computeLayout (NVGcontext * ctx, const Widget * widget,
-                                        std::vector<int> * _grid) const
+void AdvancedGridLayout::computeMinimum (NVGcontext * ctx, std::vector<int> * _grid) const
 {
-   Vector2i fs_w = widget->fixedSize();
-   Vector2i containerSize (
-      fs_w[0] ? fs_w[0] : widget->width(),
-      fs_w[1] ? fs_w[1] : widget->height()
-   );
-   Vector2i extra = Vector2i::Constant (2 * mMargin);
-   if (dynamic_cast<const Window *> (widget))
-      extra[1] += widget->theme()->mWindowHeaderHeight - mMargin / 2;
-   containerSize -= extra;
    for (int axis = 0; axis < 2; ++axis)
    {
       std::vector<int> & grid = _grid[axis];
@@ -383,7 +387,7 @@ void AdvancedGridLayout::computeLayout (NVGcontext * ctx, const Widget * widget,
             const Anchor & anchor = pair.second;
             if ((anchor.size[axis] == 1) != (phase == 0))
                continue;
-            int ps = w->preferredSize (ctx)[axis], fs = w->fixedSize()[axis];
+            int ps = w->cachedPreferredSize (ctx)[axis], fs = w->fixedSize()[axis];
             int targetSize = fs ? fs : ps;
             if (anchor.pos[axis] + anchor.size[axis] > grid.size())
                throw std::runtime_error (
@@ -411,6 +415,24 @@ void AdvancedGridLayout::computeLayout (NVGcontext * ctx, const Widget * widget,
                grid[i] += (int) std::round (amt * stretch[i]);
          }
       }
+   }
+}
+
+void AdvancedGridLayout::distribute (const Widget * widget, std::vector<int> * _grid) const
+{
+   Vector2i fs_w = widget->fixedSize();
+   Vector2i containerSize (
+      fs_w[0] ? fs_w[0] : widget->width(),
+      fs_w[1] ? fs_w[1] : widget->height()
+   );
+   Vector2i extra = Vector2i::Constant (2 * mMargin);
+   if (widget->isWindow())
+      extra[1] += widget->theme()->mWindowHeaderHeight - mMargin / 2;
+   containerSize -= extra;
+   for (int axis = 0; axis < 2; ++axis)
+   {
+      std::vector<int> & grid = _grid[axis];
+      const std::vector<float> & stretch = axis == 0 ? mColStretch : mRowStretch;
       int currentSize = std::accumulate (grid.begin(), grid.end(), 0);
       float totalStretch = std::accumulate (stretch.begin(), stretch.end(), 0.0f);
       if (currentSize >= containerSize[axis] || totalStretch == 0)
@@ -421,4 +443,184 @@ void AdvancedGridLayout::computeLayout (NVGcontext * ctx, const Widget * widget,
    }
 }
 
+Vector2i FlexLayout::extra (const Widget * widget) const
+{
+   Vector2i extra = Vector2i::Constant (2 * mMargin);
+   if (widget->isWindow())
+      extra[1] += widget->theme()->mWindowHeaderHeight - mMargin / 2;
+   return extra;
+}
+
+void FlexLayout::measure (NVGcontext * ctx, const Widget * widget, int available) const
+{
+   int axis1 = (int) mOrientation;
+   mWidgets.clear();
+   mSizes.clear();
+   mLineEnds.clear();
+   size_t lineStart = 0;
+   int line = 0;
+   for (Widget * w : widget->children())
+   {
+      if (!w->visible())
+         continue;
+      Vector2i ps = w->cachedPreferredSize (ctx), fs = w->fixedSize();
+      Vector2i size (
+         fs[0] ? fs[0] : ps[0],
+         fs[1] ? fs[1] : ps[1]
+      );
+      int basis = item (w).basis;
+      if (basis >= 0)
+         size[axis1] = basis;
+      bool first = mSizes.size() == lineStart;
+      if (!first && mWrap && available > 0 && line + mSpacing + size[axis1] > available)
+      {
+         mLineEnds.push_back ((int) mSizes.size());
+         lineStart = mSizes.size();
+         first = true;
+      }
+      line = first ? size[axis1] : line + mSpacing + size[axis1];
+      mWidgets.push_back (w);
+      mSizes.push_back (size);
+   }
+   if (mSizes.size() > lineStart)
+      mLineEnds.push_back ((int) mSizes.size());
+   mMeasuredFor = widget;
+   mMeasuredAvailable = available;
+}
+
+Vector2i FlexLayout::preferredSize (NVGcontext * ctx, const Widget * widget) const
+{
+   int axis1 = (int) mOrientation, axis2 = ((int) mOrientation + 1) % 2;
+   Vector2i extra = this->extra (widget);
+   /* Wrapping needs a width, the one the container has or is fixed to */
+   int available = 0;
+   if (mWrap)
+   {
+      int fs = widget->fixedSize()[axis1];
+      available = std::max ((fs ? fs : widget->size()[axis1]) - extra[axis1], 0);
+   }
+   measure (ctx, widget, available);
+   Vector2i size = Vector2i::Zero();
+   int first = 0;
+   for (int end : mLineEnds)
+   {
+      int main = 0, cross = 0;
+      for (int i = first; i < end; ++i)
+      {
+         main += mSizes[i][axis1] + (i > first ? mSpacing : 0);
+         cross = std::max (cross, mSizes[i][axis2]);
+      }
+      size[axis1] = std::max (size[axis1], main);
+      size[axis2] += cross + (first > 0 ? mLineSpacing : 0);
+      first = end;
+   }
+   return size + extra;
+}
+
+void FlexLayout::performLayout (NVGcontext * ctx, Widget * widget) const
+{
+   int axis1 = (int) mOrientation, axis2 = ((int) mOrientation + 1) % 2;
+   Vector2i fs_w = widget->fixedSize();
+   Vector2i containerSize (
+      fs_w[0] ? fs_w[0] : widget->width(),
+      fs_w[1] ? fs_w[1] : widget->height()
+   );
+   Vector2i available = containerSize - extra (widget);
+   Vector2i origin = Vector2i::Constant (mMargin);
+   if (widget->isWindow())
+      origin[1] = widget->theme()->mWindowHeaderHeight + mMargin / 2;
+   int wrapAt = mWrap ? std::max (available[axis1], 0) : 0;
+   if (mMeasuredFor != widget || mMeasuredAvailable != wrapAt)
+      measure (ctx, widget, wrapAt);
+   mMeasuredFor = nullptr;
+
+   int cross = origin[axis2], first = 0;
+   for (int end : mLineEnds)
+   {
+      /* Space left over or missing on the line, and who takes it */
+      int used = mSpacing * (end - first - 1), lineCross = 0, lastGrow = -1, lastShrink = -1;
+      float growSum = 0.0f, shrinkSum = 0.0f;
+      for (int i = first; i < end; ++i)
+      {
+         Item it = item (mWidgets[i]);
+         used += mSizes[i][axis1];
+         lineCross = std::max (lineCross, mSizes[i][axis2]);
+         if (it.grow > 0.0f)
+         {
+            growSum += it.grow;
+            lastGrow = i;
+         }
+         if (it.shrink > 0.0f && mSizes[i][axis1] > 0)
+         {
+            shrinkSum += it.shrink * mSizes[i][axis1];
+            lastShrink = i;
+         }
+      }
+      /* A single line spans the container, like a box layout */
+      if (!mWrap)
+         lineCross = available[axis2];
+      int free = available[axis1] - used, position = origin[axis1], gap = mSpacing, handed = 0;
+      if (free > 0 && growSum == 0.0f)
+      {
+         switch (mJustify)
+         {
+            case Alignment::Minimum:
+               break;
+            case Alignment::Middle:
+               position += free / 2;
+               break;
+            case Alignment::Maximum:
+               position += free;
+               break;
+            case Alignment::Fill:
+               if (end - first > 1)
+                  gap += free / (end - first - 1);
+               break;
+         }
+      }
+      for (int i = first; i < end; ++i)
+      {
+         Widget * w = mWidgets[i];
+         Item it = item (w);
+         Vector2i size = mSizes[i], pos;
+         /* The last widget taking a share gets the rounding remainder, so the line ends flush */
+         if (free > 0 && it.grow > 0.0f)
+         {
+            int share = i == lastGrow ? free - handed : (int) (free * it.grow / growSum);
+            size[axis1] += share;
+            handed += share;
+         }
+         else if (free < 0 && it.shrink > 0.0f && size[axis1] > 0)
+         {
+            int share = i == lastShrink ? -free - handed : (int) (-free * it.shrink * size[axis1] / shrinkSum);
+            share = std::min (share, size[axis1]);
+            size[axis1] -= share;
+            handed += share;
+         }
+         pos[axis1] = position;
+         pos[axis2] = cross;
+         switch (it.ownAlignment ? it.align : mAlignment)
+         {
+            case Alignment::Minimum:
+               break;
+            case Alignment::Middle:
+               pos[axis2] += (lineCross - size[axis2]) / 2;
+               break;
+            case Alignment::Maximum:
+               pos[axis2] += lineCross - size[axis2];
+               break;
+            case Alignment::Fill:
+               size[axis2] = w->fixedSize()[axis2] ? w->fixedSize()[axis2] : lineCross;
+               break;
+         }
+         w->setPosition (pos);
+         w->setSize (size);
+         w->performLayout (ctx);
+         position += size[axis1] + gap;
+      }
+      cross += lineCross + mLineSpacing;
+      first = end;
+   }
+}
+
 NAMESPACE_END (nanogui)
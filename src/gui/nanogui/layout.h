@@ -261,6 +261,11 @@ class  GridLayout : public Layout
       {
          mAlignment[1] = value;
       }
+      /// Return the alignments set for individual columns (axis 0) or rows (axis 1)
+      const std::vector<Alignment> & alignments (int axis) const
+      {
+         return mAlignment[axis];
+      }
 
       /* Implementation of the layout interface */
       Vector2i preferredSize (NVGcontext * ctx, const Widget * widget) const;
@@ -313,8 +318,8 @@ class  AdvancedGridLayout : public Layout
    public:
       struct Anchor
       {
-         uint8_t pos[2];
-         uint8_t size[2];
+         uint16_t pos[2];
+         uint16_t size[2];
          Alignment align[2];
 
          Anchor() { }
@@ -322,8 +327,8 @@ class  AdvancedGridLayout : public Layout
          Anchor (int x, int y, Alignment horiz = Alignment::Fill,
                  Alignment vert = Alignment::Fill)
          {
-            pos[0] = (uint8_t) x;
-            pos[1] = (uint8_t) y;
+            pos[0] = (uint16_t) x;
+            pos[1] = (uint16_t) y;
             size[0] = size[1] = 1;
             align[0] = horiz;
             align[1] = vert;
@@ -333,10 +338,10 @@ class  AdvancedGridLayout : public Layout
                  Alignment horiz = Alignment::Fill,
                  Alignment vert = Alignment::Fill)
          {
-            pos[0] = (uint8_t) x;
-            pos[1] = (uint8_t) y;
-            size[0] = (uint8_t) w;
-            size[1] = (uint8_t) h;
+            pos[0] = (uint16_t) x;
+            pos[1] = (uint16_t) y;
+            size[0] = (uint16_t) w;
+            size[1] = (uint16_t) h;
             align[0] = horiz;
             align[1] = vert;
          }
@@ -373,11 +378,20 @@ class  AdvancedGridLayout : public Layout
          return (int) mRows.size();
       }
 
+      /// Reserve room for \c rows more rows and the anchors of \c widgets more widgets
+      void reserve (int rows, int widgets)
+      {
+         mRows.reserve (mRows.size() + rows);
+         mRowStretch.reserve (mRowStretch.size() + rows);
+         mAnchor.reserve (mAnchor.size() + widgets);
+      }
+
       /// Append a row of the given size (and stretch factor)
       void appendRow (int size, float stretch = 0.f)
       {
          mRows.push_back (size);
          mRowStretch.push_back (stretch);
+         mMinimumFor = nullptr;
       };
 
       /// Append a column of the given size (and stretch factor)
@@ -385,24 +399,28 @@ class  AdvancedGridLayout : public Layout
       {
          mCols.push_back (size);
          mColStretch.push_back (stretch);
+         mMinimumFor = nullptr;
       };
 
       /// Set the stretch factor of a given row
       void setRowStretch (int index, float stretch)
       {
          mRowStretch.at (index) = stretch;
+         mMinimumFor = nullptr;
       }
 
       /// Set the stretch factor of a given column
       void setColStretch (int index, float stretch)
       {
          mColStretch.at (index) = stretch;
+         mMinimumFor = nullptr;
       }
 
       /// Specify the anchor data structure for a given widget
       void setAnchor (const Widget * widget, const Anchor & anchor)
       {
          mAnchor[widget] = anchor;
+         mMinimumFor = nullptr;
       }
 
       /// Retrieve the anchor data structure for a given widget
@@ -419,14 +437,179 @@ class  AdvancedGridLayout : public Layout
       void performLayout (NVGcontext * ctx, Widget * widget) const;
 
    protected:
-      void computeLayout (NVGcontext * ctx, const Widget * widget,
-                          std::vector<int> * grid) const;
+      /// Compute the smallest row and column sizes that fit the widgets
+      void computeMinimum (NVGcontext * ctx, std::vector<int> * grid) const;
+      /// Hand the space of the container left over by the minimum sizes to the stretched rows and columns
+      void distribute (const Widget * widget, std::vector<int> * grid) const;
 
    protected:
       std::vector<int> mCols, mRows;
       std::vector<float> mColStretch, mRowStretch;
       std::unordered_map<const Widget *, Anchor> mAnchor;
       int mMargin;
+      /* The minimum grid computed for the preferred size is reused by the layout that follows it */
+      mutable std::vector<int> mMinimum[2];
+      mutable const Widget * mMinimumFor = nullptr;
+};
+
+/**
+   \brief Flexbox style layout that packs widgets along a line, growing, shrinking and wrapping them
+
+   Widgets are placed along the main axis given by the orientation, with
+   \c spacing between them. Each widget may carry an \ref Item with grow and
+   shrink factors that hand out the space left over or missing on its line, a
+   basis that replaces its preferred size along the main axis, and an alignment
+   of its own across the lines. With wrapping, a widget that would overflow the
+   container starts a new line, \c lineSpacing below the previous one.
+
+   The layout measures in one pass and arranges in a second one. Measurements
+   come from \ref Widget::cachedPreferredSize(), which is only recomputed for
+   widgets whose layout was invalidated; the line breaks of the preferred size
+   are reused by the layout that follows it at the same width. Hidden widgets
+   take no space.
+
+   Without items, wrapping or justification, it places the widgets like a
+   \ref BoxLayout with the same orientation, alignment, margin and spacing,
+   except that filled widgets keep the margin on both sides. Panels can
+   therefore move over one at a time.
+*/
+class  FlexLayout : public Layout
+{
+   public:
+      /// Per widget flex parameters
+      struct Item
+      {
+         float grow = 0.0f;	///< share of the space left over on the line
+         float shrink = 0.0f;	///< share of the space missing on the line, weighted by the basis
+         int basis = -1;	///< size along the main axis before growing or shrinking, -1 for the preferred one
+         bool ownAlignment = false;	///< use \ref align instead of the alignment of the layout
+         Alignment align = Alignment::Middle;
+
+         Item() { }
+
+         Item (float grow, float shrink = 0.0f, int basis = -1)
+            : grow (grow), shrink (shrink), basis (basis) { }
+
+         Item (float grow, float shrink, int basis, Alignment align)
+            : grow (grow), shrink (shrink), basis (basis), ownAlignment (true), align (align) { }
+      };
+
+      FlexLayout (Orientation orientation, Alignment alignment = Alignment::Middle,
+                  int margin = 0, int spacing = 0)
+         : mOrientation (orientation), mAlignment (alignment), mMargin (margin),
+           mSpacing (spacing), mLineSpacing (spacing) { }
+
+      Orientation orientation() const
+      {
+         return mOrientation;
+      }
+      void setOrientation (Orientation orientation)
+      {
+         mOrientation = orientation;
+         mMeasuredFor = nullptr;
+      }
+
+      /// Return the alignment of widgets across their line
+      Alignment alignment() const
+      {
+         return mAlignment;
+      }
+      void setAlignment (Alignment alignment)
+      {
+         mAlignment = alignment;
+      }
+
+      /// Return how left over space along a line is used, \ref Alignment::Fill spreads it between the widgets
+      Alignment justify() const
+      {
+         return mJustify;
+      }
+      void setJustify (Alignment justify)
+      {
+         mJustify = justify;
+      }
+
+      int margin() const
+      {
+         return mMargin;
+      }
+      void setMargin (int margin)
+      {
+         mMargin = margin;
+         mMeasuredFor = nullptr;
+      }
+
+      int spacing() const
+      {
+         return mSpacing;
+      }
+      void setSpacing (int spacing)
+      {
+         mSpacing = spacing;
+         mMeasuredFor = nullptr;
+      }
+
+      /// Return the spacing between wrapped lines
+      int lineSpacing() const
+      {
+         return mLineSpacing;
+      }
+      void setLineSpacing (int lineSpacing)
+      {
+         mLineSpacing = lineSpacing;
+         mMeasuredFor = nullptr;
+      }
+
+      /// Return whether widgets that do not fit on a line start a new one
+      bool wrap() const
+      {
+         return mWrap;
+      }
+      void setWrap (bool wrap)
+      {
+         mWrap = wrap;
+         mMeasuredFor = nullptr;
+      }
+
+      /// Specify the flex parameters of a given widget
+      void setItem (const Widget * widget, const Item & item)
+      {
+         mItems[widget] = item;
+         mMeasuredFor = nullptr;
+      }
+
+      /// Retrieve the flex parameters of a given widget, the defaults if none were set
+      Item item (const Widget * widget) const
+      {
+         auto it = mItems.find (widget);
+         return it == mItems.end() ? Item() : it->second;
+      }
+
+      /* Implementation of the layout interface */
+      Vector2i preferredSize (NVGcontext * ctx, const Widget * widget) const;
+      void performLayout (NVGcontext * ctx, Widget * widget) const;
+
+   protected:
+      /// Return the space the margins and a window header take from the container
+      Vector2i extra (const Widget * widget) const;
+      /// Measure the visible children and break them into lines no longer than \c available, 0 for one line
+      void measure (NVGcontext * ctx, const Widget * widget, int available) const;
+
+   protected:
+      Orientation mOrientation;
+      Alignment mAlignment;
+      Alignment mJustify = Alignment::Minimum;
+      int mMargin;
+      int mSpacing;
+      int mLineSpacing;
+      bool mWrap = false;
+      std::unordered_map<const Widget *, Item> mItems;
+      /* The measurement of the preferred size is reused by the layout that follows it at the same width */
+      mutable std::vector<Widget *> mWidgets;	// the visible children
+      mutable std::vector<Vector2i> mSizes;	// of mWidgets, the basis along the main axis
+      mutable std::vector<int> mLineEnds;	// one past the last item of each line
+      mutable const Widget * mMeasuredFor = nullptr;
+      mutable int mMeasuredAvailable = 0;
 };
 
 NAMESPACE_END (nanogui)
@@ -0,0 +1,262 @@
+/*
+    src/logconsole.cpp -- Scrolling view of log lines pushed at a high
+    rate from any number of threads
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "logconsole.h"
+#include "screen.h"
+#include "theme.h"
+#include "../nanovg/nanovg.h"
+#include "../util/LogRing.h"
+#include <algorithm>
+#include <cstring>
+
+NAMESPACE_BEGIN (nanogui)
+
+/* New lines up to this many are filtered on the GUI thread, a few frames' worth at 50k lines per second */
+static const uint64_t InlineScanLines = 4096;
+
+LogConsole::LogConsole (Widget * parent, size_t capacity, size_t lineBytes)
+   : Widget (parent), mLog (std::make_shared<LogRing> (capacity, lineBytes))
+{
+   mLine.resize (mLog->lineBytes());
+   attach();
+}
+
+void LogConsole::attach()
+{
+   if (mPoll)
+      return;
+   if (Screen * screen = this->screen())
+   {
+      mPoll = std::make_shared<std::function<void()>> ([this]() { poll(); });
+      screen->addPoll (mPoll);
+   }
+}
+
+void LogConsole::append (const std::string & line, int level)
+{
+   mLog->push (line.data(), line.size(), level);
+}
+
+void LogConsole::poll()
+{
+   uint64_t head = mLog->head(), tail = mLog->tail();
+   /* Lines are claimed in order but may finish out of order, stop at the first one still being written */
+   uint64_t known = std::max (mKnown, tail);
+   while (known < head && mLog->ready (known))
+      known++;
+   if (known == mKnown)
+      return;
+   mKnown = known;
+   while (!mMatches.empty() && mMatches.front() < tail)
+      mMatches.pop_front();
+   scanMore();
+   markDirty();
+}
+
+void LogConsole::setFollowing (bool following)
+{
+   if (!following && mFollowing)
+   {
+      int rows = std::max ((int) (height() / lineHeight()), 1);
+      mTop = lineCount() ? lineAt (firstShown (rows)) : mKnown;
+   }
+   mFollowing = following;
+   markDirty();
+}
+
+void LogConsole::setFilter (const std::string & text)
+{
+   if (text == mFilter)
+      return;
+   if (mScan)
+      mScan->cancel();
+   mScan = nullptr;
+   mFilterGeneration++;
+   mFilter = text;
+   mMatches.clear();
+   mScanned = 0;
+   mFollowing = true;
+   scanMore();
+   markDirty();
+}
+
+void LogConsole::scanMore()
+{
+   if (mFilter.empty() || mScan)
+      return;
+   uint64_t from = std::max (mScanned, mLog->tail()), to = mKnown;
+   if (from >= to)
+      return;
+   if (to - from <= InlineScanLines)
+   {
+      for (uint64_t seq = from; seq < to; ++seq)
+         if (mLog->read (seq, mLine.data()) >= 0 && strstr (mLine.data(), mFilter.c_str()))
+            mMatches.push_back (seq);
+      mScanned = to;
+      return;
+   }
+   Screen * screen = this->screen();
+   if (!screen)
+      return;
+   std::shared_ptr<LogRing> log = mLog;
+   std::shared_ptr<std::vector<uint64_t>> matches = std::make_shared<std::vector<uint64_t>>();
+   std::string filter = mFilter;
+   int generation = mFilterGeneration;
+   ref<LogConsole> self = this;
+   mScan = screen->runAsync ([log, filter, from, to, matches] (AsyncOperation & op)
+   {
+      std::vector<char> line (log->lineBytes());
+      for (uint64_t seq = std::max (from, log->tail()); seq < to && !op.cancelled(); ++seq)
+      {
+         if (log->read (seq, line.data()) >= 0 && strstr (line.data(), filter.c_str()))
+            matches->push_back (seq);
+         if (((seq - from) & 0xffff) == 0)
+            op.setProgress ((float) (seq - from) / (float) (to - from));
+      }
+   },
+   [self, matches, to, generation] (AsyncOperation &) mutable
+   {
+      /* A scan of a filter replaced meanwhile is dropped */
+      if (generation != self->mFilterGeneration)
+         return;
+      self->mScan = nullptr;
+      uint64_t tail = self->mLog->tail();
+      for (uint64_t seq : *matches)
+         if (seq >= tail)
+            self->mMatches.push_back (seq);
+      self->mScanned = to;
+      self->scanMore();
+      self->markDirty();
+   });
+}
+
+size_t LogConsole::lineCount() const
+{
+   if (!mFilter.empty())
+      return mMatches.size();
+   return (size_t) (mKnown - std::min (mLog->tail(), mKnown));
+}
+
+uint64_t LogConsole::lineAt (size_t index) const
+{
+   if (!mFilter.empty())
+      return mMatches[index];
+   return std::min (mLog->tail(), mKnown) + index;
+}
+
+size_t LogConsole::firstShown (int rows) const
+{
+   size_t count = lineCount(), last = count > (size_t)rows ? count - rows : 0;
+   if (mFollowing)
+      return last;
+   size_t index;
+   if (!mFilter.empty())
+      index = (size_t) (std::lower_bound (mMatches.begin(), mMatches.end(), mTop) - mMatches.begin());
+   else
+   {
+      uint64_t tail = std::min (mLog->tail(), mKnown);
+      index = mTop > tail ? (size_t) (mTop - tail) : 0;
+   }
+   return std::min (index, last);
+}
+
+void LogConsole::scrollTo (double index, int rows)
+{
+   size_t count = lineCount(), last = count > (size_t)rows ? count - rows : 0;
+   size_t first = (size_t) std::min (std::max (index, 0.0), (double)last);
+   mFollowing = first >= last;
+   if (!mFollowing)
+      mTop = lineAt (first);
+   markDirty();
+}
+
+float LogConsole::lineHeight() const
+{
+   return std::max (fontSize() * 1.2f, 1.0f);
+}
+
+bool LogConsole::scrollEvent (const Vector2i &, const Vector2f & rel)
+{
+   int rows = std::max ((int) (height() / lineHeight()), 1);
+   scrollTo ((double)firstShown (rows) - rel.y() * 3.0, rows);
+   return true;
+}
+
+bool LogConsole::mouseDragEvent (const Vector2i &, const Vector2i & rel, int, int)
+{
+   /* Like dragging the scroll bar, the whole height spans all lines */
+   int rows = std::max ((int) (height() / lineHeight()), 1);
+   size_t count = lineCount();
+   if (count <= (size_t)rows || height() <= 0)
+      return false;
+   scrollTo ((double)firstShown (rows) + rel.y() * (double)count / height(), rows);
+   return true;
+}
+
+Vector2i LogConsole::preferredSize (NVGcontext *) const
+{
+   return Vector2i (400, 200);
+}
+
+void LogConsole::draw (NVGcontext * ctx)
+{
+   Widget::draw (ctx);
+   attach();
+   if (!mCustomColors)
+   {
+      mLevelColors[0] = mTheme->mTextColor;
+      mLevelColors[1] = Color (255, 210, 64, 255);
+      mLevelColors[2] = Color (255, 80, 64, 255);
+   }
+   float lh = lineHeight();
+   int rows = std::max ((int) (mSize.y() / lh), 1);
+   size_t count = lineCount(), first = firstShown (rows);
+
+   nvgSave (ctx);
+   nvgTranslate (ctx, mPos.x(), mPos.y());
+   nvgIntersectScissor (ctx, 0, 0, mSize.x(), mSize.y());
+   nvgFontSize (ctx, fontSize());
+   nvgFontFace (ctx, "sans");
+   nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+   /* Only the lines in view are read from the ring, lines overwritten since are left blank */
+   for (int row = 0; row < rows && first + row < count; ++row)
+   {
+      int level = 0;
+      int length = mLog->read (lineAt (first + row), mLine.data(), &level);
+      if (length <= 0)
+         continue;
+      nvgFillColor (ctx, mLevelColors[std::min (level, 2)]);
+      nvgText (ctx, 4, row * lh, mLine.data(), mLine.data() + length);
+   }
+   nvgRestore (ctx);
+
+   if (count <= (size_t)rows)
+      return;
+   float scrollh = std::max (mSize.y() * (float)rows / (float)count, 8.0f);
+   float scroll = (float)first / (float) (count - rows);
+   NVGpaint paint = nvgBoxGradient (
+                       ctx, mPos.x() + mSize.x() - 12 + 1, mPos.y() + 4 + 1, 8,
+                       mSize.y() - 8, 3, 4, Color (0, 32), Color (0, 92));
+   nvgFillPaint (ctx, paint);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + mSize.x() - 12, mPos.y() + 4, 8,
+                          mSize.y() - 8, 3);
+   paint = nvgBoxGradient (
+              ctx, mPos.x() + mSize.x() - 12 - 1,
+              mPos.y() + 4 + (mSize.y() - 8 - scrollh) * scroll - 1, 8, scrollh,
+              3, 4, Color (220, 100), Color (128, 100));
+   nvgFillPaint (ctx, paint);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + mSize.x() - 12 + 1,
+                          mPos.y() + 4 + 1 + (mSize.y() - 8 - scrollh) * scroll, 8 - 2,
+                          scrollh - 2, 2);
+}
+
+NAMESPACE_END (nanogui)
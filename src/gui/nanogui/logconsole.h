@@ -0,0 +1,131 @@
+/*
+    nanogui/logconsole.h -- Scrolling view of log lines pushed at a high
+    rate from any number of threads
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include "async.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class LogRing;
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Log viewer fed from any thread through a lock-free ring
+
+   Lines go into a LogRing of fixed size, see \ref log(), and the oldest ones
+   are dropped once it is full. The console never copies the history: every
+   frame it only reads and draws the lines that fit its height, straight from
+   the ring, and short lines redraw from the shaped text cache of NanoVG.
+   While following, the view stays pinned to the newest line with no work but
+   an index subtraction; scrolling up stops following, scrolling back to the
+   bottom resumes it.
+
+   \ref setFilter() keeps an index of the lines containing a text. The lines
+   already held are scanned on a worker thread; lines arriving later are
+   scanned as they come, on a worker while there are many of them.
+*/
+class  LogConsole : public Widget
+{
+   public:
+      LogConsole (Widget * parent, size_t capacity = 16384, size_t lineBytes = 160);
+
+      /**
+         \brief Return the ring producers push lines into, from any thread
+
+         It may outlive the console. Once the console is attached to a screen,
+         every \ref Screen::drawWidgets() picks up the lines pushed since the
+         last one and redraws the console when there were any.
+      */
+      const std::shared_ptr<LogRing> & log()
+      {
+         attach();
+         return mLog;
+      }
+      /// Push a line on the GUI thread, see LogRing::push()
+      void append (const std::string & line, int level = 0);
+
+      /// Return whether the view is pinned to the newest line
+      bool following() const
+      {
+         return mFollowing;
+      }
+      /// Pin the view to the newest line, or keep it where it is
+      void setFollowing (bool following);
+
+      /// Return the text lines have to contain to be shown, empty for all lines
+      const std::string & filter() const
+      {
+         return mFilter;
+      }
+      /// Only show the lines containing \c text, all of them when it is empty
+      void setFilter (const std::string & text);
+      /// Return whether the lines held when the filter was set are still being scanned
+      bool filtering() const
+      {
+         return mScan.get() != nullptr;
+      }
+
+      /// Return the number of lines shown, all the ring holds or those matching the filter
+      size_t lineCount() const;
+
+      /// Set the colors of lines of level 0, 1 and 2 and above, the text color of the theme and yellow and red by default
+      void setLevelColors (const Color & info, const Color & warning, const Color & error)
+      {
+         mLevelColors[0] = info;
+         mLevelColors[1] = warning;
+         mLevelColors[2] = error;
+         mCustomColors = true;
+         markDirty();
+      }
+
+      virtual bool scrollEvent (const Vector2i & p, const Vector2f & rel);
+      virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual void draw (NVGcontext * ctx);
+
+   protected:
+      /// Register the poll with the screen, once the console is attached to one
+      void attach();
+      /// Pick up the lines written since the last frame
+      void poll();
+      /// Filter the lines that arrived since the last scan, on a worker when there are many
+      void scanMore();
+      /// Return the sequence number of the line shown at \c index, see \ref lineCount()
+      uint64_t lineAt (size_t index) const;
+      /// Return the index of the first line shown
+      size_t firstShown (int rows) const;
+      /// Scroll so that the line at \c index is the first shown
+      void scrollTo (double index, int rows);
+      float lineHeight() const;
+
+      std::shared_ptr<LogRing> mLog;
+      std::shared_ptr<std::function<void()>> mPoll;	// registered with the screen once attached
+      uint64_t mKnown = 0;	// the lines before it were written
+      bool mFollowing = true;
+      uint64_t mTop = 0;	// sequence number of the first line shown while not following
+      std::string mFilter;
+      std::deque<uint64_t> mMatches;	// sequence numbers of the lines containing the filter, ascending
+      uint64_t mScanned = 0;	// lines before it were filtered
+      int mFilterGeneration = 0;	// bumped by setFilter(), so that scans of an older filter are dropped
+      ref<AsyncOperation> mScan;
+      std::vector<char> mLine;	// scratch for the line being drawn or scanned
+      Color mLevelColors[3];
+      bool mCustomColors = false;
+};
+
+NAMESPACE_END (nanogui)
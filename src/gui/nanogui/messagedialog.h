@@ -12,6 +12,7 @@
 #pragma once
 
 #include "window.h"
+#include "callback.h"
 
 NAMESPACE_BEGIN (nanogui)
 
@@ -30,16 +31,16 @@ class  MessageDialog : public Window
                      const std::string & buttonText = "OK",
                      const std::string & altButtonText = "Cancel", bool altButton = false);
 
-      std::function<void (int)> callback() const
+      const Callback<void (int)> & callback() const
       {
          return mCallback;
       }
-      void setCallback (const std::function<void (int)> & callback)
+      void setCallback (Callback<void (int)> callback)
       {
-         mCallback = callback;
+         mCallback = std::move (callback);
       }
    protected:
-      std::function<void (int)> mCallback;
+      Callback<void (int)> mCallback;
 };
 
 NAMESPACE_END (nanogui)
@@ -12,8 +12,13 @@
 #pragma once
 
 #include "common.h"
+#include "callback.h"
+#include "numberformat.h"
 #include "widget.h"
 #include "screen.h"
+#include "async.h"
+#include "dragdrop.h"
+#include "animator.h"
 #include "theme.h"
 #include "window.h"
 #include "layout.h"
@@ -23,15 +28,39 @@
 #include "toolbutton.h"
 #include "popup.h"
 #include "popupbutton.h"
+#include "stringtable.h"
 #include "combobox.h"
 #include "progressbar.h"
 #include "entypo.h"
 #include "messagedialog.h"
 #include "textbox.h"
+#include "textarea.h"
 #include "slider.h"
 #include "imagepanel.h"
 #include "imageview.h"
 #include "vscrollpanel.h"
+#include "vlistpanel.h"
+#include "treeview.h"
+#include "tableview.h"
+#include "canvas.h"
+#include "nodeeditor.h"
 #include "colorwheel.h"
 #include "graph.h"
+#include "perfhistorygraph.h"
+#include "property.h"
 #include "formhelper.h"
+#include "profilerview.h"
+#include "widgetarena.h"
+#include "uifile.h"
+#include "cachedgeometry.h"
+#include "cachedimage.h"
+#include "vectoricon.h"
+#include "drawinspector.h"
+#include "inputrecorder.h"
+#include "remote.h"
+#include "waterfall.h"
+#include "logconsole.h"
+#include "widgetsearch.h"
+#include "commandpalette.h"
+#include "reconciler.h"
+#include "immediate.h"
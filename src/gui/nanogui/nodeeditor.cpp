@@ -0,0 +1,365 @@
+/*
+    src/nodeeditor.cpp -- Graph of nodes, ports and wires on a canvas,
+    with the wires stroked in batches
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "nodeeditor.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NAMESPACE_BEGIN (nanogui)
+
+/* Segments a wire is split into for hit-testing */
+static const int wireHitSegments = 24;
+
+NodeItem::NodeItem (const std::string & title, int inputs, int outputs, const Vector2f & pos, float width)
+   : CanvasItem (pos, Vector2f (width, (float) (headerHeight + std::max (1, std::max (inputs, outputs)) * portSpacing + 4))),
+     mTitle (title), mInputs (std::max (0, inputs)), mOutputs (std::max (0, outputs)),
+     mColor (Color (50, 50, 55, 230)) {}
+
+Vector2f NodeItem::portPosition (bool output, int index) const
+{
+   return mPos + Vector2f (output ? mSize.x() : 0.0f, headerHeight + (index + 0.5f) * portSpacing);
+}
+
+void NodeItem::setSelected (bool selected)
+{
+   mSelected = selected;
+   if (mCanvas)
+      mCanvas->markDirty();
+}
+
+void NodeItem::shape (NVGcontext * ctx, int level)
+{
+   if (level == 0)
+      nvgRoundedRect (ctx, 0, 0, mSize.x(), mSize.y(), 4);
+   else
+      nvgRect (ctx, 0, 0, mSize.x(), mSize.y());
+}
+
+void NodeItem::draw (NVGcontext * ctx, NVGgeometry * shape, int level)
+{
+   nvgFillColor (ctx, mColor);
+   nvgFillGeometry (ctx, shape);
+   if (level == 0 || mSelected)
+   {
+      nvgStrokeWidth (ctx, mSelected ? 2.0f : 1.0f);
+      nvgStrokeColor (ctx, mSelected ? Color (255, 200, 80, 255) : Color (0, 160));
+      nvgStrokeGeometry (ctx, shape);
+   }
+   if (level > 0)
+      return;
+   nvgFontSize (ctx, 14.0f);
+   nvgFontFace (ctx, "sans");
+   nvgFillColor (ctx, Color (255, 220));
+   nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+   nvgText (ctx, 6, headerHeight * 0.5f, mTitle.c_str(), nullptr);
+   /* Ports are quads shaded as circles, nothing to tessellate */
+   nvgFillColor (ctx, Color (200, 255));
+   for (int side = 0; side < 2; ++side)
+      for (int i = 0; i < (side ? mOutputs : mInputs); ++i)
+      {
+         float x = side ? mSize.x() : 0.0f, y = headerHeight + (i + 0.5f) * portSpacing;
+         nvgDrawRoundedRectSDF (ctx, x - portRadius, y - portRadius, 2 * portRadius, 2 * portRadius, portRadius);
+      }
+}
+
+NodeWire::NodeWire (NodeItem * from, int output, NodeItem * to, int input, int type)
+   : mFrom (from), mTo (to), mOutput (output), mInput (input), mType (std::max (0, type))
+{
+   mBatched = true;
+   updateBounds();
+}
+
+void NodeWire::curve (Vector2f points[4]) const
+{
+   points[0] = mFrom->portPosition (true, mOutput);
+   points[3] = mTo->portPosition (false, mInput);
+   float d = std::max (30.0f, 0.5f * std::abs (points[3].x() - points[0].x()));
+   points[1] = points[0] + Vector2f (d, 0.0f);
+   points[2] = points[3] - Vector2f (d, 0.0f);
+}
+
+float NodeWire::distance (const Vector2f & p) const
+{
+   Vector2f c[4];
+   curve (c);
+   float best = std::numeric_limits<float>::max();
+   Vector2f prev = c[0];
+   for (int i = 1; i <= wireHitSegments; ++i)
+   {
+      float t = (float) i / wireHitSegments, u = 1.0f - t;
+      Vector2f next = u * u * u * c[0] + 3 * u * u * t * c[1] + 3 * u * t * t * c[2] + t * t * t * c[3];
+      Vector2f segment = next - prev;
+      float s = std::max (0.0f, std::min (1.0f, (p - prev).dot (segment) / std::max (1e-6f, segment.squaredNorm())));
+      best = std::min (best, (prev + s * segment - p).norm());
+      prev = next;
+   }
+   return best;
+}
+
+void NodeWire::updateBounds()
+{
+   /* The curve stays within the hull of its control points */
+   Vector2f c[4];
+   curve (c);
+   Vector2f lo = c[0].cwiseMin (c[1]).cwiseMin (c[2]).cwiseMin (c[3]);
+   Vector2f hi = c[0].cwiseMax (c[1]).cwiseMax (c[2]).cwiseMax (c[3]);
+   mPos = lo;
+   mSize = hi - lo;
+   if (mCanvas)
+      mCanvas->itemsMoved();
+}
+
+NodeEditor::NodeEditor (Widget * parent)
+   : Canvas (parent), mWireWidth (2.0f), mDragNode (nullptr), mDragOffset (Vector2f::Zero()),
+     mWireFrom (nullptr), mWireOutput (0), mWireEnd (Vector2f::Zero()) {}
+
+NodeEditor::~NodeEditor()
+{
+   for (auto & batch : mBatches)
+      nvgDeleteGeometry (batch.geometry);
+}
+
+NodeEditor::Batch & NodeEditor::batch (int type)
+{
+   while ((int) mBatches.size() <= type)
+   {
+      mBatches.push_back (Batch());
+      mBatches.back().color = Color (180, 255);
+   }
+   return mBatches[type];
+}
+
+void NodeEditor::invalidateWires (const NodeItem * node)
+{
+   for (auto wire : node->mWires)
+      batch (wire->mType).dirty = true;
+   markDirty();
+}
+
+void NodeEditor::addNode (NodeItem * node)
+{
+   addItem (node);
+}
+
+void NodeEditor::removeNode (NodeItem * node)
+{
+   std::vector<NodeWire *> wires = node->mWires;
+   for (auto wire : wires)
+      disconnect (wire);
+   if (mDragNode == node)
+      mDragNode = nullptr;
+   if (mWireFrom == node)
+      mWireFrom = nullptr;
+   removeItem (node);
+}
+
+void NodeEditor::moveNode (NodeItem * node, const Vector2f & pos)
+{
+   node->setPosition (pos);
+   for (auto wire : node->mWires)
+      wire->updateBounds();
+   /* The wires of a dragged node are stroked on their own until the drag ends */
+   if (node != mDragNode)
+      invalidateWires (node);
+}
+
+NodeWire * NodeEditor::connect (NodeItem * from, int output, NodeItem * to, int input, int type)
+{
+   if (output < 0 || output >= from->mOutputs || input < 0 || input >= to->mInputs)
+      return nullptr;
+   NodeWire * wire = new NodeWire (from, output, to, input, type);
+   from->mWires.push_back (wire);
+   if (to != from)
+      to->mWires.push_back (wire);
+   mWires.push_back (wire);
+   batch (wire->mType).dirty = true;
+   addItem (wire);
+   return wire;
+}
+
+void NodeEditor::disconnect (NodeWire * wire)
+{
+   auto it = std::find (mWires.begin(), mWires.end(), wire);
+   if (it == mWires.end())
+      return;
+   mWires.erase (it);
+   for (NodeItem * node : { wire->mFrom, wire->mTo })
+      node->mWires.erase (std::remove (node->mWires.begin(), node->mWires.end(), wire), node->mWires.end());
+   batch (wire->mType).dirty = true;
+   /* The canvas holds the last reference */
+   removeItem (wire);
+}
+
+NodeWire * NodeEditor::wireAt (const Vector2f & p, float tolerance)
+{
+   float t = tolerance / mZoom;
+   query (p - Vector2f::Constant (t), p + Vector2f::Constant (t));
+   for (auto it = mQuery.rbegin(); it != mQuery.rend(); ++it)
+   {
+      CanvasItem * item = mItems[*it];
+      if (item->batched() && static_cast<NodeWire *> (item)->distance (p) <= t)
+         return static_cast<NodeWire *> (item);
+   }
+   return nullptr;
+}
+
+NodeItem * NodeEditor::portAt (const Vector2f & p, bool & output, int & index)
+{
+   float r = NodeItem::portRadius + 2.0f;
+   query (p - Vector2f::Constant (r), p + Vector2f::Constant (r));
+   for (auto it = mQuery.rbegin(); it != mQuery.rend(); ++it)
+   {
+      CanvasItem * item = mItems[*it];
+      if (item->batched())
+         continue;
+      NodeItem * node = static_cast<NodeItem *> (item);
+      for (int side = 0; side < 2; ++side)
+         for (int i = 0; i < (side ? node->mOutputs : node->mInputs); ++i)
+            if ((node->portPosition (side != 0, i) - p).squaredNorm() <= r * r)
+            {
+               output = side != 0;
+               index = i;
+               return node;
+            }
+   }
+   return nullptr;
+}
+
+void NodeEditor::setWireColor (int type, const Color & color)
+{
+   batch (std::max (0, type)).color = color;
+   markDirty();
+}
+
+void NodeEditor::setWireWidth (float width)
+{
+   mWireWidth = width;
+   markDirty();
+}
+
+bool NodeEditor::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
+{
+   if (button != MOUSE_BUTTON_LEFT)
+      return Canvas::mouseButtonEvent (p, button, down, modifiers);
+   Vector2f q = toCanvas ((p - mPos).cast<float>());
+   bool output;
+   int index;
+   if (down)
+   {
+      NodeItem * node = portAt (q, output, index);
+      if (node && output)
+      {
+         mWireFrom = node;
+         mWireOutput = index;
+         mWireEnd = q;
+         markDirty();
+         return true;
+      }
+      query (q, q);
+      for (auto it = mQuery.rbegin(); it != mQuery.rend() && !mDragNode; ++it)
+         if (!mItems[*it]->batched())
+            mDragNode = static_cast<NodeItem *> (mItems[*it].get());
+      if (mDragNode)
+      {
+         mDragOffset = mDragNode->position() - q;
+         invalidateWires (mDragNode);
+      }
+      return true;
+   }
+   if (mWireFrom)
+   {
+      NodeItem * to = portAt (q, output, index);
+      if (to && !output && (!mConnectCallback || mConnectCallback (mWireFrom, mWireOutput, to, index)))
+         connect (mWireFrom, mWireOutput, to, index);
+      mWireFrom = nullptr;
+      markDirty();
+   }
+   if (mDragNode)
+   {
+      NodeItem * node = mDragNode;
+      mDragNode = nullptr;
+      invalidateWires (node);
+   }
+   return true;
+}
+
+bool NodeEditor::mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers)
+{
+   Vector2f q = toCanvas ((p - mPos).cast<float>());
+   if (mWireFrom)
+   {
+      mWireEnd = q;
+      markDirty();
+      return true;
+   }
+   if (mDragNode)
+   {
+      moveNode (mDragNode, q + mDragOffset);
+      return true;
+   }
+   return Canvas::mouseDragEvent (p, rel, button, modifiers);
+}
+
+void NodeEditor::drawBatches (NVGcontext * ctx, int)
+{
+   Vector2f c[4];
+   for (int type = 0; type < (int) mBatches.size(); ++type)
+   {
+      Batch & b = mBatches[type];
+      if (!b.dirty)
+         continue;
+      /* One path of many subpaths, tessellated once for all of them */
+      nvgDeleteGeometry (b.geometry);
+      nvgBeginPath (ctx);
+      for (auto wire : mWires)
+      {
+         if (wire->mType != type || wire->mFrom == mDragNode || wire->mTo == mDragNode)
+            continue;
+         wire->curve (c);
+         nvgMoveTo (ctx, c[0].x(), c[0].y());
+         nvgBezierTo (ctx, c[1].x(), c[1].y(), c[2].x(), c[2].y(), c[3].x(), c[3].y());
+      }
+      b.geometry = nvgCreateGeometry (ctx);
+      b.dirty = false;
+   }
+   nvgStrokeWidth (ctx, mWireWidth);
+   for (auto & b : mBatches)
+      if (b.geometry)
+      {
+         nvgStrokeColor (ctx, b.color);
+         nvgStrokeGeometry (ctx, b.geometry);
+      }
+   if (mDragNode)
+      for (auto wire : mDragNode->mWires)
+      {
+         wire->curve (c);
+         nvgBeginPath (ctx);
+         nvgMoveTo (ctx, c[0].x(), c[0].y());
+         nvgBezierTo (ctx, c[1].x(), c[1].y(), c[2].x(), c[2].y(), c[3].x(), c[3].y());
+         nvgStrokeColor (ctx, batch (wire->mType).color);
+         nvgStroke (ctx);
+      }
+   if (mWireFrom)
+   {
+      c[0] = mWireFrom->portPosition (true, mWireOutput);
+      c[3] = mWireEnd;
+      float d = std::max (30.0f, 0.5f * std::abs (c[3].x() - c[0].x()));
+      nvgBeginPath (ctx);
+      nvgMoveTo (ctx, c[0].x(), c[0].y());
+      nvgBezierTo (ctx, c[0].x() + d, c[0].y(), c[3].x() - d, c[3].y(), c[3].x(), c[3].y());
+      nvgStrokeColor (ctx, Color (255, 160));
+      nvgStroke (ctx);
+   }
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,231 @@
+/*
+    nanogui/nodeeditor.h -- Graph of nodes, ports and wires on a canvas,
+    with the wires stroked in batches
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "canvas.h"
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+class NodeEditor;
+class NodeWire;
+
+/**
+   \brief Node of a \ref NodeEditor with input ports on the left and output ports on the right
+
+   Drawn as a rounded box with a title and its ports; the coarse levels of
+   detail of the canvas get a plain box. Override \ref shape() and \ref draw()
+   for other looks, keeping the ports where \ref portPosition() says.
+*/
+class  NodeItem : public CanvasItem
+{
+      friend class NodeEditor;
+   public:
+      NodeItem (const std::string & title, int inputs, int outputs,
+                const Vector2f & pos = Vector2f::Zero(), float width = 120);
+
+      const std::string & title() const
+      {
+         return mTitle;
+      }
+      int inputs() const
+      {
+         return mInputs;
+      }
+      int outputs() const
+      {
+         return mOutputs;
+      }
+
+      /// Return the center of a port in canvas coordinates
+      Vector2f portPosition (bool output, int index) const;
+      /// Return the wires attached to the node
+      const std::vector<NodeWire *> & wires() const
+      {
+         return mWires;
+      }
+
+      bool selected() const
+      {
+         return mSelected;
+      }
+      void setSelected (bool selected);
+
+      const Color & color() const
+      {
+         return mColor;
+      }
+      void setColor (const Color & color)
+      {
+         mColor = color;
+         if (mCanvas)
+            mCanvas->markDirty();
+      }
+
+      virtual void shape (NVGcontext * ctx, int level);
+      virtual void draw (NVGcontext * ctx, NVGgeometry * shape, int level);
+
+      static const int headerHeight = 20;
+      static const int portSpacing = 18;
+      static const int portRadius = 5;
+
+   protected:
+      std::string mTitle;
+      int mInputs, mOutputs;
+      bool mSelected = false;
+      Color mColor;
+      std::vector<NodeWire *> mWires;	// owned by the editor
+};
+
+/**
+   \brief Wire from an output port to an input port
+
+   Only indexed by the canvas, for hit-testing; the editor strokes all wires
+   of a type in one retained geometry.
+*/
+class  NodeWire : public CanvasItem
+{
+      friend class NodeEditor;
+   public:
+      NodeWire (NodeItem * from, int output, NodeItem * to, int input, int type = 0);
+
+      NodeItem * from() const
+      {
+         return mFrom;
+      }
+      int output() const
+      {
+         return mOutput;
+      }
+      NodeItem * to() const
+      {
+         return mTo;
+      }
+      int input() const
+      {
+         return mInput;
+      }
+      /// Return the type, which picks the color of the wire, see \ref NodeEditor::setWireColor()
+      int type() const
+      {
+         return mType;
+      }
+
+      /// Return the start, the two control points and the end of the bezier curve of the wire
+      void curve (Vector2f points[4]) const;
+      /// Return the distance of \c p to the curve, in canvas units
+      float distance (const Vector2f & p) const;
+
+      virtual void draw (NVGcontext *, NVGgeometry *, int) { }
+
+   protected:
+      /// Fit the rectangle of the wire around its curve after a node moved
+      void updateBounds();
+
+      NodeItem * mFrom, * mTo;
+      int mOutput, mInput;
+      int mType;
+};
+
+/**
+   \brief Editor of a graph of nodes and wires on a \ref Canvas
+
+   Stroking thousands of wires one by one tessellates every bezier each frame.
+   Here all wires of a type are added to one path, kept as a retained
+   geometry that NanoVG tessellates again only when the zoom changes beyond
+   its tolerance, and stroked in one call. While a node is dragged, the wires
+   attached to it are left out of the batches and stroked on their own, so
+   a drag frame only flattens those; the batches are built again once the
+   drag ends.
+
+   Nodes and wires share the spatial index of the canvas, which hit-tests
+   ports and wires. Dragging a node moves it, dragging from an output port
+   draws a new wire that connects when released over an input port, and
+   dragging elsewhere pans.
+
+   \code
+   NodeEditor * editor = new NodeEditor (window);
+   NodeItem * osc = new NodeItem ("Oscillator", 1, 1, Vector2f (20, 20));
+   NodeItem * out = new NodeItem ("Output", 2, 0, Vector2f (240, 60));
+   editor->addNode (osc);
+   editor->addNode (out);
+   editor->connect (osc, 0, out, 0);
+   \endcode
+*/
+class  NodeEditor : public Canvas
+{
+   public:
+      NodeEditor (Widget * parent);
+      ~NodeEditor();
+
+      /// Add a node
+      void addNode (NodeItem * node);
+      /// Remove a node and its wires
+      void removeNode (NodeItem * node);
+      /// Move a node, which only updates the wires attached to it
+      void moveNode (NodeItem * node, const Vector2f & pos);
+
+      /// Connect an output port to an input port, return the new wire, nullptr if a port is out of range
+      NodeWire * connect (NodeItem * from, int output, NodeItem * to, int input, int type = 0);
+      /// Remove a wire
+      void disconnect (NodeWire * wire);
+
+      /// The topmost wire within \c tolerance pixels of \c p in canvas coordinates, nullptr if none
+      NodeWire * wireAt (const Vector2f & p, float tolerance = 4);
+      /// The node with a port at \c p in canvas coordinates and which port it is, nullptr if none
+      NodeItem * portAt (const Vector2f & p, bool & output, int & index);
+
+      /// Set the color of the wires of a type
+      void setWireColor (int type, const Color & color);
+      /// Set the width of all wires in canvas units
+      void setWireWidth (float width);
+
+      /// Set the function deciding whether a wire dragged by the user connects, nullptr allows all
+      void setConnectCallback (Callback<bool (NodeItem * from, int output, NodeItem * to, int input)> callback)
+      {
+         mConnectCallback = std::move (callback);
+      }
+
+      virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
+      virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+
+   protected:
+      /// Wires of one type, stroked together
+      struct Batch
+      {
+         Color color;
+         NVGgeometry * geometry = nullptr;
+         bool dirty = true;
+      };
+
+      virtual void drawBatches (NVGcontext * ctx, int level);
+      /// The batch of a type, created on first use
+      Batch & batch (int type);
+      /// Build the batches of the wires attached to \c node again
+      void invalidateWires (const NodeItem * node);
+
+      std::vector<NodeWire *> mWires;	// also held by the canvas
+      std::vector<Batch> mBatches;
+      float mWireWidth;
+      Callback<bool (NodeItem *, int, NodeItem *, int)> mConnectCallback;
+
+      /* Interaction */
+      NodeItem * mDragNode;	// whose wires are left out of the batches
+      Vector2f mDragOffset;	// from the mouse to the node, in canvas units
+      NodeItem * mWireFrom;	// node of the output port a new wire is dragged from
+      int mWireOutput;
+      Vector2f mWireEnd;
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,230 @@
+/*
+    nanogui/numberformat.h -- Formatting and parsing of numbers into
+    caller provided buffers, without allocating or consulting the locale
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+
+NAMESPACE_BEGIN (nanogui)
+
+/// Notation of formatted floating point numbers, like the printf conversions g, f and e
+enum class NumberFormat
+{
+   General,
+   Fixed,
+   Scientific
+};
+
+/// Size of a buffer that holds any number formatted here, including the null character
+const int NumberBufferSize = 40;
+
+NAMESPACE_BEGIN (detail)
+inline double powerOf10 (int exponent)
+{
+   static const double table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+                                 };
+   return table[exponent];
+}
+template <typename T> bool isNegative (T value, std::true_type)
+{
+   return value < 0;
+}
+template <typename T> bool isNegative (T, std::false_type)
+{
+   return false;
+}
+/* Writes the digits of value backwards from end, returns the first one */
+inline char * writeDigits (char * end, uint64_t value)
+{
+   do
+   {
+      *--end = (char) ('0' + value % 10);
+      value /= 10;
+   }
+   while (value != 0);
+   return end;
+}
+NAMESPACE_END (detail)
+
+/// Write \c value in decimal and a null character into \c buf, return the length
+template <typename T> int formatInteger (char * buf, T value)
+{
+   static_assert (std::is_integral<T>::value, "formatInteger() takes integers");
+   char digits[24];
+   bool negative = detail::isNegative (value, std::is_signed<T>());
+   uint64_t magnitude = negative ? (uint64_t)0 - (uint64_t) (int64_t)value : (uint64_t)value;
+   char * first = detail::writeDigits (digits + sizeof (digits), magnitude);
+   int length = 0;
+   if (negative)
+      buf[length++] = '-';
+   while (first != digits + sizeof (digits))
+      buf[length++] = *first++;
+   buf[length] = '\0';
+   return length;
+}
+
+/**
+   \brief Write \c value and a null character into \c buf, at least \ref NumberBufferSize bytes
+
+   \c precision is the number of significant digits for NumberFormat::General
+   and of decimals otherwise, as in printf. The decimal separator is always a
+   point. Returns the length.
+*/
+inline int formatFloat (char * buf, double value, NumberFormat format, int precision)
+{
+   if (precision < 0)
+      precision = 0;
+   if (format == NumberFormat::Fixed && precision <= 15 && std::fabs (value) * detail::powerOf10 (precision) < 1e15)
+   {
+      /* Exact in a double, so rounding the scaled value rounds the decimals */
+      char digits[24];
+      char * end = digits + sizeof (digits);
+      uint64_t scaled = (uint64_t) std::llround (std::fabs (value) * detail::powerOf10 (precision));
+      char * first = detail::writeDigits (end, scaled);
+      while (end - first <= precision)
+         *--first = '0';
+      int length = 0;
+      if (value < 0.0 && scaled != 0)
+         buf[length++] = '-';
+      for (; first != end; ++first)
+      {
+         if (end - first == precision)
+            buf[length++] = '.';
+         buf[length++] = *first;
+      }
+      buf[length] = '\0';
+      return length;
+   }
+   if (std::isnan (value))
+      return snprintf (buf, NumberBufferSize, "nan");
+   if (std::isinf (value))
+      return snprintf (buf, NumberBufferSize, value < 0.0 ? "-inf" : "inf");
+   /* Fixed notation of very large values would not fit, they fall back to the general one */
+   precision = std::min (precision, 17);
+   int length = snprintf (buf, NumberBufferSize, format == NumberFormat::Scientific ? "%.*e" : "%.*g", precision, value);
+   for (int i = 0; i < length; ++i)
+      if (buf[i] == ',')
+         buf[i] = '.';
+   return length;
+}
+
+/// Parse the decimal integer in [first, last), return \c false unless all of it is a number in range
+template <typename T> bool parseInteger (const char * first, const char * last, T & value)
+{
+   static_assert (std::is_integral<T>::value, "parseInteger() takes integers");
+   bool negative = false;
+   if (first != last && (*first == '-' || *first == '+'))
+   {
+      negative = *first == '-';
+      if (negative && !std::is_signed<T>::value)
+         return false;
+      ++first;
+   }
+   if (first == last)
+      return false;
+   uint64_t limit = negative ? (uint64_t)std::numeric_limits<T>::max() + 1 : (uint64_t)std::numeric_limits<T>::max();
+   uint64_t magnitude = 0;
+   for (; first != last; ++first)
+   {
+      if (*first < '0' || *first > '9')
+         return false;
+      unsigned digit = (unsigned) (*first - '0');
+      if (magnitude > (limit - digit) / 10)
+         return false;
+      magnitude = magnitude * 10 + digit;
+   }
+   value = negative ? (T) (0 - magnitude) : (T)magnitude;
+   return true;
+}
+
+/**
+   \brief Parse the decimal floating point number in [first, last), return \c false unless all of it is one
+
+   Numbers with at most 15 significant digits and a decimal exponent up to 22
+   are converted exactly, by one multiplication or division. Others go through
+   strtod(), which assumes the C locale.
+*/
+inline bool parseFloat (const char * first, const char * last, double & value)
+{
+   const char * p = first;
+   bool negative = false;
+   if (p != last && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+   uint64_t mantissa = 0;
+   int digits = 0, exponent = 0, mantissaDigits = 0;
+   bool exact = true;
+   for (bool fraction = false; p != last; ++p)
+   {
+      if (*p == '.' && !fraction)
+      {
+         fraction = true;
+         continue;
+      }
+      if (*p < '0' || *p > '9')
+         break;
+      ++digits;
+      if (mantissa == 0 && *p == '0')
+      {
+         exponent -= fraction ? 1 : 0;
+         continue;
+      }
+      if (++mantissaDigits > 15)
+         exact = false;
+      else
+      {
+         mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+         exponent -= fraction ? 1 : 0;
+      }
+   }
+   if (digits == 0)
+      return false;
+   if (p != last && (*p == 'e' || *p == 'E'))
+   {
+      ++p;
+      bool negativeExponent = p != last && *p == '-';
+      if (p != last && (*p == '-' || *p == '+'))
+         ++p;
+      if (p == last)
+         return false;
+      int e = 0;
+      for (; p != last && *p >= '0' && *p <= '9'; ++p)
+         e = std::min (e * 10 + (*p - '0'), 100000);
+      exponent += negativeExponent ? -e : e;
+   }
+   if (p != last)
+      return false;
+   if (exact && exponent >= -22 && exponent <= 22)
+   {
+      double v = (double)mantissa;
+      v = exponent < 0 ? v / detail::powerOf10 (-exponent) : v * detail::powerOf10 (exponent);
+      value = negative ? -v : v;
+      return true;
+   }
+   char copy[64];
+   if (last - first >= (ptrdiff_t)sizeof (copy))
+      return false;
+   std::copy (first, last, copy);
+   copy[last - first] = '\0';
+   value = std::strtod (copy, nullptr);
+   return true;
+}
+
+NAMESPACE_END (nanogui)
@@ -13,10 +13,17 @@
 
 #include "common.h"
 #include <atomic>
+#include <utility>
 
 NAMESPACE_BEGIN (nanogui)
 
-/// Reference counted object base class
+/**
+   \brief Reference counted object base class
+
+   Reference counts are atomic unless \c NANOGUI_NONATOMIC_REFCOUNT is defined,
+   which makes them plain integers for GUIs that never share objects between
+   threads.
+*/
 class  Object
 {
    public:
@@ -46,11 +53,11 @@ class  Object
       */
       void decRef (bool dealloc = true) const
       {
-         --m_refCount;
-         if (m_refCount == 0 && dealloc)
+         int refCount = --m_refCount;
+         if (refCount == 0 && dealloc)
             delete this;
          else
-            if (m_refCount < 0)
+            if (refCount < 0)
                throw std::runtime_error ("Internal error: reference count < 0!");
       }
    protected:
@@ -59,7 +66,11 @@ class  Object
       */
       virtual ~Object() { }
    private:
+#if defined(NANOGUI_NONATOMIC_REFCOUNT)
+      mutable int m_refCount = 0;
+#else
       mutable std::atomic<int> m_refCount { 0 };
+#endif
 };
 
 /**
@@ -92,11 +103,16 @@ template <typename T> class ref
       }
 
       /// Move constructor
-      ref (ref && r) : m_ptr (r.m_ptr)
+      ref (ref && r) noexcept : m_ptr (r.m_ptr)
       {
          r.m_ptr = nullptr;
       }
 
+      /// Move a reference to a derived type, without touching the reference count
+      template <typename U> ref (ref<U> && r) noexcept : m_ptr (r.release())
+      {
+      }
+
       /// Destroy this reference
       ~ref()
       {
@@ -104,7 +120,7 @@ template <typename T> class ref
             ((Object *) m_ptr)->decRef();
       }
 
-      /// Move another reference into the current one
+      /// Move another reference into the current one, releasing the old object may throw like decRef()
       ref & operator= (ref && r)
       {
          if (*this == r)
@@ -213,6 +229,20 @@ template <typename T> class ref
       {
          return m_ptr != nullptr;
       }
+
+      /// Give up ownership of the object without decreasing its reference count
+      T * release()
+      {
+         T * ptr = m_ptr;
+         m_ptr = nullptr;
+         return ptr;
+      }
+
+      /// Exchange the objects of two references, without touching the reference counts
+      void swap (ref & r) noexcept
+      {
+         std::swap (m_ptr, r.m_ptr);
+      }
    private:
       T * m_ptr;
 };
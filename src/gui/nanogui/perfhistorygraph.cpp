@@ -0,0 +1,81 @@
+/*
+    src/perfhistorygraph.cpp -- Graph of a long performance history that
+    zooms across its resolutions
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "perfhistorygraph.h"
+#include "numberformat.h"
+#include "screen.h"
+#include "../util/Performance.h"
+#include <cstring>
+
+NAMESPACE_BEGIN (nanogui)
+
+static const char * resolutionNames[PERF_HISTORY_RESOLUTIONS] = { "frames", "1 s", "1 min", "10 min" };
+
+PerfHistoryGraph::PerfHistoryGraph (Widget * parent, const PerfHistory * history, const std::string & caption)
+   : Graph (parent, caption), mHistory (history), mResolution (PERF_HISTORY_FRAMES), mSeen (0)
+{
+   /* Series 0, the filled one, is the maximum */
+   addSeries (Color (255, 255, 255, 192));
+   addSeries (Color (100, 255, 100, 192));
+   setCapacity (PERF_HISTORY_CAPACITY);
+   setRange (0.0f, 1.0f / 20.0f);
+   setHeader (resolutionNames[mResolution]);
+   mRefresh = std::make_shared<std::function<void()>> ([this]() { refresh(); });
+   if (Screen * screen = this->screen())
+      screen->addPoll (mRefresh);
+}
+
+void PerfHistoryGraph::setResolution (int resolution)
+{
+   resolution = std::max (0, std::min (resolution, PERF_HISTORY_RESOLUTIONS - 1));
+   if (resolution == mResolution)
+      return;
+   mResolution = resolution;
+   setHeader (resolutionNames[mResolution]);
+   clear();
+   mSeen = mHistory->rings[mResolution].total - (unsigned int)mHistory->rings[mResolution].count;
+   refresh();
+}
+
+void PerfHistoryGraph::refresh()
+{
+   const PerfHistoryRing & ring = mHistory->rings[mResolution];
+   int n = (int)std::min (ring.total - mSeen, (unsigned int)PERF_HISTORY_CAPACITY);
+   if (n == 0)
+      return;
+   mSeen = ring.total;
+   PerfBucket buckets[PERF_HISTORY_CAPACITY];
+   float values[PERF_HISTORY_CAPACITY];
+   n = getPerfHistory (mHistory, mResolution, buckets, n);
+   for (int i = 0; i < n; ++i)
+      values[i] = buckets[i].max;
+   push (values, (size_t)n, 0);
+   for (int i = 0; i < n; ++i)
+      values[i] = buckets[i].avg;
+   push (values, (size_t)n, 1);
+   for (int i = 0; i < n; ++i)
+      values[i] = buckets[i].min;
+   push (values, (size_t)n, 2);
+   char str[NumberBufferSize + 4];
+   int len = formatFloat (str, buckets[n - 1].avg * 1000.0f, NumberFormat::Fixed, 2);
+   std::strcpy (str + len, " ms");
+   setFooter (str);
+}
+
+bool PerfHistoryGraph::scrollEvent (const Vector2i &, const Vector2f & rel)
+{
+   if (rel.y() != 0.0f)
+      setResolution (mResolution + (rel.y() < 0.0f ? 1 : -1));
+   return true;
+}
+
+NAMESPACE_END (nanogui)
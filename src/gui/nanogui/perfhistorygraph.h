@@ -0,0 +1,63 @@
+/*
+    nanogui/perfhistorygraph.h -- Graph of a long performance history that
+    zooms across its resolutions
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "graph.h"
+
+struct PerfHistory;
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Graph of a \ref PerfHistory, from single frames up to ten minute buckets
+
+   The maximum of every bucket is filled, the average and the minimum are
+   stroked above it. Scrolling switches to a finer or coarser resolution of
+   the history. Every frame the screen pushes only the buckets the history
+   closed since the last frame, so following a history that runs for hours
+   costs as little as following one that runs for seconds. Buckets are drawn
+   side by side, a stretch without samples leaves no gap. The history is
+   owned by the caller and must outlive the graph.
+
+   \code
+   PerfHistory history;	// updated with updatePerfHistory() every frame
+   initPerfHistory (&history);
+   PerfHistoryGraph * graph = new PerfHistoryGraph (window, &history);
+   graph->setResolution (PERF_HISTORY_MINUTES);
+   \endcode
+*/
+class  PerfHistoryGraph : public Graph
+{
+   public:
+      PerfHistoryGraph (Widget * parent, const PerfHistory * history, const std::string & caption = "Frame Time");
+
+      /// Return the shown resolution, one of the PerfHistoryResolution values
+      int resolution() const
+      {
+         return mResolution;
+      }
+      void setResolution (int resolution);
+
+      /// Push the buckets the history closed since the last call, done by the screen every frame
+      void refresh();
+
+      virtual bool scrollEvent (const Vector2i & p, const Vector2f & rel);
+
+   protected:
+      const PerfHistory * mHistory;
+      int mResolution;
+      unsigned int mSeen;	// total of the ring when it was last pushed
+      std::shared_ptr<std::function<void()>> mRefresh;	// registered with the screen
+};
+
+NAMESPACE_END (nanogui)
@@ -18,12 +18,21 @@ NAMESPACE_BEGIN (nanogui)
 
 Popup::Popup (Widget * parent, Window * parentWindow)
    : Window (parent, ""), mParentWindow (parentWindow),
-     mAnchorPos (Vector2i::Zero()), mAnchorHeight (30)
+     mAnchorPos (Vector2i::Zero()), mAnchorHeight (30), mLayoutPending (true),
+     mPlaced (false), mPlacedFrom (Vector2i::Zero())
 {
+   mKind |= PopupKind;
 }
 
 void Popup::performLayout (NVGcontext * ctx)
 {
+   /* Popups that are never opened are never laid out */
+   if (!mVisible)
+   {
+      mLayoutPending = true;
+      return;
+   }
+   mLayoutPending = false;
    if (mLayout || mChildren.size() != 1)
       Widget::performLayout (ctx);
    else
@@ -31,40 +40,68 @@ void Popup::performLayout (NVGcontext * ctx)
       mChildren[0]->setPosition (Vector2i::Zero());
       mChildren[0]->setSize (mSize);
       mChildren[0]->performLayout (ctx);
+      mLayoutDirty = false;
+      mLayoutSize = mSize;
    }
 }
 
+Vector2i Popup::preferredSize (NVGcontext * ctx) const
+{
+   if (!mVisible)
+      return mSize;
+   return Window::preferredSize (ctx);
+}
+
+void Popup::updateLayout (NVGcontext * ctx)
+{
+   if (!mVisible || (!mLayoutPending && !mLayoutDirty))
+      return;
+   mPreferredSizeValid = false;
+   Vector2i pref = cachedPreferredSize (ctx), fix = fixedSize();
+   setSize (Vector2i (fix[0] ? fix[0] : pref[0], fix[1] ? fix[1] : pref[1]));
+   performLayout (ctx);
+}
+
 void Popup::refreshRelativePlacement()
 {
    mParentWindow->refreshRelativePlacement();
    mVisible &= mParentWindow->visibleRecursive();
-   mPos = mParentWindow->position() + mAnchorPos - Vector2i (0, mAnchorHeight);
+   setPosition (mParentWindow->position() + mAnchorPos - Vector2i (0, mAnchorHeight));
+   mPlacedFrom = mParentWindow->position();
+   mPlaced = true;
 }
 
 void Popup::draw (NVGcontext * ctx)
 {
-   refreshRelativePlacement();
+   if (!mVisible)
+      return;
+   if (!mPlaced || mParentWindow->position() != mPlacedFrom)
+      refreshRelativePlacement();
+   else
+      mVisible &= mParentWindow->visibleRecursive();
    if (!mVisible)
       return;
    int ds = mTheme->mWindowDropShadowSize, cr = mTheme->mWindowCornerRadius;
+   float w = mSize.x(), h = mSize.y();
+   nvgSave (ctx);
+   nvgTranslate (ctx, mPos.x(), mPos.y());
    /* Draw a drop shadow */
    NVGpaint shadowPaint = nvgBoxGradient (
-                             ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), cr * 2, ds * 2,
+                             ctx, 0, 0, w, h, cr * 2, ds * 2,
                              mTheme->mDropShadow, mTheme->mTransparent);
-   nvgBeginPath (ctx);
-   nvgRect (ctx, mPos.x() - ds, mPos.y() - ds, mSize.x() + 2 * ds, mSize.y() + 2 * ds);
-   nvgRoundedRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), cr);
-   nvgPathWinding (ctx, NVG_HOLE);
    nvgFillPaint (ctx, shadowPaint);
-   nvgFill (ctx);
+   nvgDrawBoxShadow (ctx, 0, 0, w, h, cr, ds);
    /* Draw window */
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), cr);
-   nvgMoveTo (ctx, mPos.x() - 15, mPos.y() + mAnchorHeight);
-   nvgLineTo (ctx, mPos.x() + 1, mPos.y() + mAnchorHeight - 15);
-   nvgLineTo (ctx, mPos.x() + 1, mPos.y() + mAnchorHeight + 15);
+   NVGgeometry * body = mBodyGeometry.get (ctx, Vector4f (w, h, cr, mAnchorHeight), [&]
+   {
+      nvgRoundedRect (ctx, 0, 0, w, h, cr);
+      nvgMoveTo (ctx, -15, mAnchorHeight);
+      nvgLineTo (ctx, 1, mAnchorHeight - 15);
+      nvgLineTo (ctx, 1, mAnchorHeight + 15);
+   });
    nvgFillColor (ctx, mTheme->mWindowPopup);
-   nvgFill (ctx);
+   nvgFillGeometry (ctx, body);
+   nvgRestore (ctx);
    Widget::draw (ctx);
 }
 
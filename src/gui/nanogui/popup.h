@@ -20,7 +20,9 @@ NAMESPACE_BEGIN (nanogui)
    \brief Popup window for combo boxes, popup buttons, nested dialogs etc.
 
    Usually the Popup instance is constructed by another widget (e.g. \ref PopupButton)
-   and does not need to be created by hand.
+   and does not need to be created by hand. A hidden popup skips layouts; the
+   widget opening it calls \ref updateLayout() instead. Its placement is only
+   recomputed when the anchor or the position of the parent window changed.
 */
 class  Popup : public Window
 {
@@ -32,6 +34,8 @@ class  Popup : public Window
       void setAnchorPos (const Vector2i & anchorPos)
       {
          mAnchorPos = anchorPos;
+         mPlaced = false;
+         markDirty();
       }
       /// Set the anchor position in the parent window; the placement of the popup is relative to it
       const Vector2i & anchorPos() const
@@ -43,6 +47,8 @@ class  Popup : public Window
       void setAnchorHeight (int anchorHeight)
       {
          mAnchorHeight = anchorHeight;
+         mPlaced = false;
+         markDirty();
       }
       /// Return the anchor height; this determines the vertical shift relative to the anchor position
       int anchorHeight() const
@@ -63,6 +69,10 @@ class  Popup : public Window
 
       /// Invoke the associated layout generator to properly place child widgets, if any
       virtual void performLayout (NVGcontext * ctx);
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+
+      /// Size and lay out the popup if layouts were skipped while it was hidden or its content changed
+      void updateLayout (NVGcontext * ctx);
 
       /// Draw the popup window
       virtual void draw (NVGcontext * ctx);
@@ -74,6 +84,9 @@ class  Popup : public Window
       Window * mParentWindow;
       Vector2i mAnchorPos;
       int mAnchorHeight;
+      bool mLayoutPending;	// a layout was skipped while hidden
+      bool mPlaced;	// mPos is up to date for the anchor and mPlacedFrom
+      Vector2i mPlacedFrom;	// parent window position mPos was computed from
 };
 
 NAMESPACE_END (nanogui)
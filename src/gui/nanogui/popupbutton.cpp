@@ -21,9 +21,33 @@ PopupButton::PopupButton (Widget * parent, const std::string & caption,
    : Button (parent, caption, buttonIcon), mChevronIcon (chevronIcon)
 {
    setFlags (Flags::ToggleButton | Flags::PopupButton);
+   mPopup = nullptr;
+}
+
+Popup * PopupButton::createPopup()
+{
    Window * parentWindow = window();
-   mPopup = new Popup (parentWindow->parent(), window());
-   mPopup->setSize (Vector2i (320, 250));
+   Popup * popup = new Popup (parentWindow->parent(), parentWindow);
+   popup->setSize (Vector2i (320, 250));
+   popup->setVisible (false);
+   mPopup = popup;
+   updateAnchor();
+   return popup;
+}
+
+void PopupButton::updateAnchor()
+{
+   const Window * parentWindow = window();
+   mPopup->setAnchorPos (Vector2i (parentWindow->width() + 15,
+                                   absolutePosition().y() - parentWindow->position().y() + mSize.y() / 2));
+}
+
+void PopupButton::setPushed (bool pushed)
+{
+   /* Created here rather than in draw(), which must not add windows to the screen */
+   if (pushed && !mPopup)
+      popup();
+   Button::setPushed (pushed);
 }
 
 Vector2i PopupButton::preferredSize (NVGcontext * ctx) const
@@ -35,30 +59,32 @@ void PopupButton::draw (NVGcontext * ctx)
 {
    if (!mEnabled && mPushed)
       mPushed = false;
-   mPopup->setVisible (mPushed);
+   if (mPopup)
+   {
+      mPopup->setVisible (mPushed);
+      mPopup->updateLayout (ctx);
+   }
    Button::draw (ctx);
    if (mChevronIcon)
    {
-      auto icon = utf8 (mChevronIcon);
       NVGcolor textColor =
          mTextColor.w() == 0 ? mTheme->mTextColor : mTextColor;
       nvgFontSize (ctx, (mFontSize < 0 ? mTheme->mButtonFontSize : mFontSize) * 1.5f);
-      nvgFontFace (ctx, "icons");
+      nvgFontFaceId (ctx, mTheme->mFontIcons.id (ctx));
       nvgFillColor (ctx, mEnabled ? textColor : mTheme->mDisabledTextColor);
       nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
-      float iw = nvgTextBounds (ctx, 0, 0, icon.data(), nullptr, nullptr);
+      float iw = nvgIconBounds (ctx, 0, 0, mChevronIcon, nullptr);
       Vector2f iconPos (mPos.x() + mSize.x() - iw - 8,
                         mPos.y() + mSize.y() * 0.5f - 1);
-      nvgText (ctx, iconPos.x(), iconPos.y(), icon.data(), nullptr);
+      nvgIcon (ctx, iconPos.x(), iconPos.y(), mChevronIcon);
    }
 }
 
 void PopupButton::performLayout (NVGcontext * ctx)
 {
    Widget::performLayout (ctx);
-   const Window * parentWindow = window();
-   mPopup->setAnchorPos (Vector2i (parentWindow->width() + 15,
-                                   absolutePosition().y() - parentWindow->position().y() + mSize.y() / 2));
+   if (mPopup)
+      updateAnchor();
 }
 
 NAMESPACE_END (nanogui)
@@ -17,6 +17,13 @@
 
 NAMESPACE_BEGIN (nanogui)
 
+/**
+   \brief Button which opens a popup window while it is pushed
+
+   The popup is created the first time \ref popup() is called or the button is
+   pushed, and laid out when it is opened. Subclasses that fill the popup
+   themselves override \ref createPopup().
+*/
 class  PopupButton : public Button
 {
    public:
@@ -27,26 +34,38 @@ class  PopupButton : public Button
       void setChevronIcon (int icon)
       {
          mChevronIcon = icon;
+         markDirty();
       }
       int chevronIcon() const
       {
          return mChevronIcon;
       }
 
+      /// Return the popup, creating it if necessary
       Popup * popup()
       {
+         if (!mPopup)
+            mPopup = createPopup();
          return mPopup;
       }
+      /// Return the popup, which is null until it was needed
       const Popup * popup() const
       {
          return mPopup;
       }
 
+      /// Push or release the button, creating the popup when it is first pushed
+      virtual void setPushed (bool pushed);
       virtual void draw (NVGcontext * ctx);
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
       virtual void performLayout (NVGcontext * ctx);
 
    protected:
+      /// Create the hidden popup
+      virtual Popup * createPopup();
+      /// Place the popup next to the button
+      void updateAnchor();
+
       Popup * mPopup;
       int mChevronIcon;
 };
@@ -0,0 +1,100 @@
+/*
+    src/profilerview.cpp -- Table of the CPU profiler's zone tree
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "profilerview.h"
+#include "numberformat.h"
+#include "theme.h"
+#include "../nanovg/nanovg.h"
+#include "../util/Profiler.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+static const float valueColumnWidth = 60.f;
+
+ProfilerView::ProfilerView (Widget * parent)
+   : Widget (parent), mRowHeight (16)
+{
+   Profiler::instance().setEnabled (true);
+}
+
+Vector2i ProfilerView::preferredSize (NVGcontext *) const
+{
+   int rows = std::max ((int)Profiler::instance().zones().size(), 8) + 1;
+   return Vector2i (380, rows * mRowHeight);
+}
+
+void ProfilerView::drawRow (NVGcontext * ctx, int row, const char * name, int depth, double min, double avg, double p99)
+{
+   float y = mPos.y() + (row + 0.5f) * mRowHeight;
+   float x = mPos.x() + mSize.x() - 3 * valueColumnWidth;
+   char str[NumberBufferSize];
+   nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+   nvgText (ctx, mPos.x() + 4 + depth * 10, y, name, nullptr);
+   nvgTextAlign (ctx, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE);
+   if (row == 0)
+   {
+      nvgText (ctx, x + valueColumnWidth, y, "min", nullptr);
+      nvgText (ctx, x + 2 * valueColumnWidth, y, "avg", nullptr);
+      nvgText (ctx, x + 3 * valueColumnWidth - 4, y, "p99", nullptr);
+      return;
+   }
+   formatFloat (str, min * 1000.0, NumberFormat::Fixed, 3);
+   nvgText (ctx, x + valueColumnWidth, y, str, nullptr);
+   formatFloat (str, avg * 1000.0, NumberFormat::Fixed, 3);
+   nvgText (ctx, x + 2 * valueColumnWidth, y, str, nullptr);
+   formatFloat (str, p99 * 1000.0, NumberFormat::Fixed, 3);
+   nvgText (ctx, x + 3 * valueColumnWidth - 4, y, str, nullptr);
+}
+
+void ProfilerView::draw (NVGcontext * ctx)
+{
+   Widget::draw (ctx);
+   const std::vector<Profiler::ZoneStats> & zones = Profiler::instance().zones();
+   /* Depth-first order; parents precede their children, so a stack walk suffices */
+   mOrder.clear();
+   std::vector<int> stack;
+   for (int i = (int)zones.size() - 1; i >= 0; --i)
+      if (zones[i].parent < 0)
+         stack.push_back (i);
+   while (!stack.empty())
+   {
+      int z = stack.back();
+      stack.pop_back();
+      mOrder.push_back (z);
+      for (int i = (int)zones.size() - 1; i > z; --i)
+         if (zones[i].parent == z)
+            stack.push_back (i);
+   }
+   nvgBeginPath (ctx);
+   nvgRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y());
+   nvgFillColor (ctx, Color (20, 128));
+   nvgFill (ctx);
+   nvgSave (ctx);
+   nvgIntersectScissor (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y());
+   nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
+   nvgFontSize (ctx, mRowHeight - 2.f);
+   nvgFillColor (ctx, mTheme->mTextColor);
+   drawRow (ctx, 0, "zone (ms)", 0, 0, 0, 0);
+   int rows = std::min ((int)mOrder.size(), mSize.y() / mRowHeight - 1);
+   for (int row = 0; row < rows; ++row)
+   {
+      const Profiler::ZoneStats & zone = zones[mOrder[row]];
+      drawRow (ctx, row + 1, zone.name, zone.depth, zone.min, zone.avg, zone.p99);
+   }
+   nvgRestore (ctx);
+   /* Statistics change every frame, and new zones grow the preferred height */
+   if (mPreferredSizeValid && mPreferredSize != preferredSize (ctx))
+      invalidateLayout();
+   else
+      markDirty();
+}
+
+NAMESPACE_END (nanogui)
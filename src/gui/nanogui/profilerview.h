@@ -0,0 +1,50 @@
+/*
+    nanogui/profilerview.h -- Table of the CPU profiler's zone tree
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Shows min/avg/p99 frame time of every profiler zone as an indented tree
+
+   Creating the view enables the profiler. The view marks itself dirty every
+   frame, so a screen in redraw-on-demand mode keeps rendering while it is
+   visible. Keep it out of retained subtrees, whose recording would freeze it.
+*/
+class  ProfilerView : public Widget
+{
+   public:
+      ProfilerView (Widget * parent);
+
+      /// Height of a single zone row
+      int rowHeight() const
+      {
+         return mRowHeight;
+      }
+      void setRowHeight (int rowHeight)
+      {
+         mRowHeight = rowHeight;
+         invalidateLayout();
+      }
+
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual void draw (NVGcontext * ctx);
+   protected:
+      void drawRow (NVGcontext * ctx, int row, const char * name, int depth, double min, double avg, double p99);
+
+      int mRowHeight;
+      std::vector<int> mOrder;
+};
+
+NAMESPACE_END (nanogui)
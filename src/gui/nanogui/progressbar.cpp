@@ -10,12 +10,122 @@
 */
 
 #include "progressbar.h"
+#include "screen.h"
+#include "theme.h"
 #include "../nanovg/nanovg.h"
+#include <algorithm>
 
 NAMESPACE_BEGIN (nanogui)
 
+ProgressModel::ProgressModel (int tasks)
+   : mWeights (std::max (tasks, 1), 1.0f), mTotalWeight ((float)std::max (tasks, 1)), mProgress (mWeights.size())
+{
+   for (auto & progress : mProgress)
+      progress.store (0.0f, std::memory_order_relaxed);
+}
+
+ProgressModel::~ProgressModel() {}
+
+void ProgressModel::setWeight (int task, float weight)
+{
+   mTotalWeight += weight - mWeights[task];
+   mWeights[task] = weight;
+}
+
+void ProgressModel::setProgress (int task, float progress)
+{
+   mProgress[task].store (progress, std::memory_order_relaxed);
+   changed();
+}
+
+void ProgressModel::addProgress (int task, float delta)
+{
+   float progress = mProgress[task].load (std::memory_order_relaxed);
+   while (!mProgress[task].compare_exchange_weak (progress, progress + delta, std::memory_order_relaxed))
+      ;
+   changed();
+}
+
+float ProgressModel::value() const
+{
+   if (mTotalWeight <= 0.0f)
+      return 0.0f;
+   float sum = 0.0f;
+   for (size_t i = 0; i < mWeights.size(); ++i)
+      sum += mWeights[i] * std::min (std::max (0.0f, mProgress[i].load (std::memory_order_relaxed)), 1.0f);
+   return sum / mTotalWeight;
+}
+
+void ProgressModel::changed()
+{
+   Screen * screen = mScreen.load (std::memory_order_acquire);
+   /* The update shows the latest value when it runs, so one in flight is enough */
+   if (!screen || mPosted.exchange (true))
+      return;
+   ref<ProgressModel> model = this;
+   screen->post ([model]() mutable
+   {
+      model->mPosted = false;
+      float value = model->value();
+      for (auto bar : model->mBars)
+         bar->setValue (value);
+   });
+}
+
 ProgressBar::ProgressBar (Widget * parent)
-   : Widget (parent), mValue (0.0f) {}
+   : Widget (parent), mValue (0.0f), mGradientContext (nullptr), mGradient (0), mGradientDirty (false)
+{
+   mKind |= ProgressBarKind;
+}
+
+ProgressBar::~ProgressBar()
+{
+   setModel (nullptr);
+   if (mGradient)
+      nvgDeleteGradient (mGradientContext, mGradient);
+}
+
+void ProgressBar::setValue (float value)
+{
+   bool redraw = barWidth (value) != barWidth (mValue);
+   mValue = value;
+   if (redraw)
+      markDirty();
+}
+
+void ProgressBar::setModel (ProgressModel * model)
+{
+   if (mModel.get() == model)
+      return;
+   if (mModel)
+   {
+      auto & bars = mModel->mBars;
+      bars.erase (std::find (bars.begin(), bars.end(), this));
+      /* Producers may outlive the screen, they stop posting to it with the last bar */
+      if (bars.empty())
+         mModel->mScreen.store (nullptr, std::memory_order_release);
+   }
+   mModel = model;
+   if (model)
+   {
+      model->mBars.push_back (this);
+      if (Screen * screen = this->screen())
+         model->mScreen.store (screen, std::memory_order_release);
+      setValue (model->value());
+   }
+}
+
+void ProgressBar::setColorStops (const std::vector<std::pair<float, Color>> & stops)
+{
+   mColorStops = stops;
+   mGradientDirty = true;
+   markDirty();
+}
+
+int ProgressBar::barWidth (float value) const
+{
+   return (int) std::round ((mSize.x() - 2) * std::min (std::max (0.0f, value), 1.0f));
+}
 
 Vector2i ProgressBar::preferredSize (NVGcontext *) const
 {
@@ -24,26 +134,51 @@ Vector2i ProgressBar::preferredSize (NVGcontext *) const
 
 void ProgressBar::draw (NVGcontext * ctx)
 {
+   /* A bar given a model before it was added to a screen picks up the updates from now on */
+   if (mModel && !mModel->mScreen.load (std::memory_order_relaxed))
+   {
+      mModel->mScreen.store (screen(), std::memory_order_release);
+      mValue = mModel->value();
+   }
    Widget::draw (ctx);
+   if (!mTheme->drawSkin (ctx, Theme::Skin::ProgressBar, mPos.x(), mPos.y(), mSize.x(), mSize.y()))
+   {
+      NVGpaint paint = nvgBoxGradient (
+                          ctx, mPos.x() + 1, mPos.y() + 1,
+                          mSize.x() - 2, mSize.y(), 3, 4, Color (0, 32), Color (0, 92));
+      nvgFillPaint (ctx, paint);
+      nvgDrawRoundedRectSDF (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), 3);
+   }
+   int barPos = barWidth (mValue);
+   if (!mColorStops.empty())
+   {
+      if (!mGradient || mGradientDirty)
+      {
+         std::vector<NVGgradientStop> stops (mColorStops.size());
+         for (size_t i = 0; i < stops.size(); ++i)
+         {
+            stops[i].offset = mColorStops[i].first;
+            stops[i].color = mColorStops[i].second;
+         }
+         if (mGradient)
+            nvgUpdateGradient (ctx, mGradient, stops.data(), (int)stops.size());
+         else
+         {
+            mGradient = nvgCreateGradient (ctx, stops.data(), (int)stops.size());
+            mGradientContext = ctx;
+         }
+         mGradientDirty = false;
+      }
+      nvgFillPaint (ctx, nvgLinearGradientStops (ctx, mPos.x() + 1, 0, mPos.x() + mSize.x() - 1, 0, mGradient));
+      nvgDrawRoundedRectSDF (ctx, mPos.x() + 1, mPos.y() + 1, barPos, mSize.y() - 2, 3);
+      return;
+   }
    NVGpaint paint = nvgBoxGradient (
-                       ctx, mPos.x() + 1, mPos.y() + 1,
-                       mSize.x() - 2, mSize.y(), 3, 4, Color (0, 32), Color (0, 92));
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), 3);
-   nvgFillPaint (ctx, paint);
-   nvgFill (ctx);
-   float value = std::min (std::max (0.0f, mValue), 1.0f);
-   int barPos = (int) std::round ((mSize.x() - 2) * value);
-   paint = nvgBoxGradient (
-              ctx, mPos.x(), mPos.y(),
-              barPos + 1.5f, mSize.y() - 1, 3, 4,
-              Color (220, 100), Color (128, 100));
-   nvgBeginPath (ctx);
-   nvgRoundedRect (
-      ctx, mPos.x() + 1, mPos.y() + 1,
-      barPos, mSize.y() - 2, 3);
+                       ctx, mPos.x(), mPos.y(),
+                       barPos + 1.5f, mSize.y() - 1, 3, 4,
+                       Color (220, 100), Color (128, 100));
    nvgFillPaint (ctx, paint);
-   nvgFill (ctx);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + 1, mPos.y() + 1, barPos, mSize.y() - 2, 3);
 }
 
 NAMESPACE_END (nanogui)
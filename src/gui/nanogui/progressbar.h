@@ -12,27 +12,114 @@
 #pragma once
 
 #include "widget.h"
+#include <atomic>
+#include <utility>
+#include <vector>
 
 NAMESPACE_BEGIN (nanogui)
 
-class  ProgressBar : public Widget
+class ProgressBar;
+
+/**
+   \brief Progress of work split into weighted tasks, reported from any thread
+
+   Producers call \ref setProgress() and \ref addProgress() without taking a
+   lock. The progress bars showing the model are updated by a task posted to
+   their screen, see \ref Screen::post(), at most one at a time, so they
+   follow the progress once per frame however often it is reported. Set the
+   weights before the work starts.
+*/
+class  ProgressModel : public Object
+{
+   public:
+      /// Create a model of \c tasks tasks of weight 1
+      ProgressModel (int tasks = 1);
+
+      /// Return the number of tasks
+      int taskCount() const
+      {
+         return (int)mWeights.size();
+      }
+      /// Set the share of \c task in the total, relative to the weights of the other tasks
+      void setWeight (int task, float weight);
+      float weight (int task) const
+      {
+         return mWeights[task];
+      }
+
+      /// Set the progress of \c task in [0, 1], callable from any thread
+      void setProgress (int task, float progress);
+      /// Add \c delta to the progress of \c task, callable from any thread
+      void addProgress (int task, float delta);
+      /// Return the progress of \c task
+      float progress (int task) const
+      {
+         return mProgress[task].load (std::memory_order_relaxed);
+      }
+
+      /// Return the weighted progress of all tasks in [0, 1]
+      float value() const;
+
+   protected:
+      friend class ProgressBar;
+
+      virtual ~ProgressModel();
+      /// Post an update of the bars unless one is pending
+      void changed();
+
+      std::vector<float> mWeights;
+      float mTotalWeight;
+      std::vector<std::atomic<float>> mProgress;
+      std::atomic<bool> mPosted { false };
+      std::atomic<Screen *> mScreen { nullptr };	// of the bars, set on the GUI thread
+      std::vector<ProgressBar *> mBars;	// GUI thread
+};
+
+class  ProgressBar final : public Widget
 {
    public:
       ProgressBar (Widget * parent);
+      virtual ~ProgressBar();
 
       float value()
       {
          return mValue;
       }
-      void setValue (float value)
+      /// Set the value in [0, 1]; the bar is only drawn again when the filled part changes width
+      void setValue (float value);
+
+      /// Show the value of \c model, which may be updated from other threads, \c nullptr for none
+      void setModel (ProgressModel * model);
+      ProgressModel * model()
       {
-         mValue = value;
+         return mModel.get();
+      }
+
+      /// Fill the bar with colors fixed along its width, like a level meter, given as offsets in [0, 1]
+      /// and colors; empty for the default look. The colors are drawn as one multi-stop gradient fill.
+      void setColorStops (const std::vector<std::pair<float, Color>> & stops);
+      const std::vector<std::pair<float, Color>> & colorStops() const
+      {
+         return mColorStops;
       }
 
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
       virtual void draw (NVGcontext * ctx);
+      /// Gradients with color stops are objects of the context drawn with
+      virtual bool threadSafeDraw() const
+      {
+         return mColorStops.empty();
+      }
    protected:
+      /// Width of the filled part at \c value
+      int barWidth (float value) const;
+
       float mValue;
+      ref<ProgressModel> mModel;
+      std::vector<std::pair<float, Color>> mColorStops;
+      NVGcontext * mGradientContext;	// of mGradient
+      int mGradient;
+      bool mGradientDirty;
 };
 
 NAMESPACE_END (nanogui)
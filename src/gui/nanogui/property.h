@@ -0,0 +1,134 @@
+/*
+    nanogui/property.h -- Value cells that tell a bound form about their
+    changes instead of being polled
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+
+NAMESPACE_BEGIN (nanogui)
+
+class PropertyBase;
+
+/// Receives the first change of a property since the observer last handled it
+class  PropertyObserver
+{
+   public:
+      virtual ~PropertyObserver() {}
+      virtual void propertyChanged (PropertyBase * property) = 0;
+      virtual void propertyDestroyed (PropertyBase * property) = 0;
+};
+
+/**
+   \brief Untyped part of a \ref Property: a version counter and at most one observer
+
+   The observer is called only for the first change after it last called
+   \ref delivered(), so a value written many times per frame costs it a
+   single notification. Properties are meant to be used from the GUI thread.
+*/
+class  PropertyBase
+{
+   public:
+      PropertyBase() {}
+      PropertyBase (const PropertyBase &) = delete;
+      PropertyBase & operator= (const PropertyBase &) = delete;
+      ~PropertyBase()
+      {
+         if (mObserver)
+            mObserver->propertyDestroyed (this);
+      }
+
+      /// Return a counter increased by every change of the value
+      uint64_t version() const
+      {
+         return mVersion;
+      }
+
+      /// Set the observer told about changes, with a slot number of its choosing
+      void setObserver (PropertyObserver * observer, int slot)
+      {
+         mObserver = observer;
+         mSlot = slot;
+         mQueued = false;
+      }
+      PropertyObserver * observer() const
+      {
+         return mObserver;
+      }
+      int observerSlot() const
+      {
+         return mSlot;
+      }
+      /// Let the next change notify the observer again
+      void delivered()
+      {
+         mQueued = false;
+      }
+
+   protected:
+      void changed()
+      {
+         ++mVersion;
+         if (mObserver && !mQueued)
+         {
+            mQueued = true;
+            mObserver->propertyChanged (this);
+         }
+      }
+
+      uint64_t mVersion = 0;
+      PropertyObserver * mObserver = nullptr;
+      int mSlot = -1;
+      bool mQueued = false;	// the observer was told and did not handle the change yet
+};
+
+/**
+   \brief Value cell that bumps its version and notifies its observer when set to a different value
+
+   \code
+   Property<float> gain (1.0f);
+   formHelper->addVariable ("Gain", gain);
+   gain = 0.5f;	// the form updates its widget in its next refreshChanged()
+   \endcode
+*/
+template <typename T> class Property : public PropertyBase
+{
+   public:
+      explicit Property (const T & value = T()) : mValue (value) {}
+
+      const T & get() const
+      {
+         return mValue;
+      }
+      operator const T & () const
+      {
+         return mValue;
+      }
+
+      void set (const T & value)
+      {
+         if (value == mValue)
+            return;
+         mValue = value;
+         changed();
+      }
+      Property & operator= (const T & value)
+      {
+         set (value);
+         return *this;
+      }
+
+   protected:
+      T mValue;
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,188 @@
+/*
+    src/reconciler.cpp -- Keeps a widget tree in line with a description
+    that the application builds anew on every change
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "reconciler.h"
+#include "button.h"
+#include "checkbox.h"
+#include "label.h"
+#include "textbox.h"
+#include <unordered_map>
+
+NAMESPACE_BEGIN (nanogui)
+
+Widget * PanelProps::create (Widget * parent) const
+{
+   Widget * panel = new Widget (parent);
+   apply (panel);
+   return panel;
+}
+
+void PanelProps::apply (Widget * widget) const
+{
+   widget->setLayout (new BoxLayout (orientation, alignment, margin, spacing));
+}
+
+Label * LabelProps::create (Widget * parent) const
+{
+   return new Label (parent, caption, font, fontSize);
+}
+
+void LabelProps::apply (Label * label) const
+{
+   if (label->caption() != caption)
+      label->setCaption (caption);
+   if (label->font() != font)
+      label->setFont (font);
+   label->setFontSize (fontSize);
+}
+
+Button * ButtonProps::create (Widget * parent) const
+{
+   return new Button (parent, caption, icon);
+}
+
+void ButtonProps::apply (Button * button) const
+{
+   if (button->caption() != caption)
+      button->setCaption (caption);
+   if (button->icon() != icon)
+      button->setIcon (icon);
+}
+
+CheckBox * CheckBoxProps::create (Widget * parent) const
+{
+   CheckBox * checkBox = new CheckBox (parent, caption);
+   checkBox->setChecked (checked);
+   return checkBox;
+}
+
+void CheckBoxProps::apply (CheckBox * checkBox) const
+{
+   if (checkBox->caption() != caption)
+      checkBox->setCaption (caption);
+   checkBox->setChecked (checked);
+}
+
+TextBox * TextBoxProps::create (Widget * parent) const
+{
+   TextBox * textBox = new TextBox (parent, value);
+   apply (textBox);
+   return textBox;
+}
+
+void TextBoxProps::apply (TextBox * textBox) const
+{
+   if (!textBox->focused())
+      textBox->setValue (value);
+   if (textBox->units() != units)
+      textBox->setUnits (units);
+   if (textBox->editable() != editable)
+      textBox->setEditable (editable);
+   if (fixedWidth > 0 && textBox->fixedWidth() != fixedWidth)
+      textBox->setFixedWidth (fixedWidth);
+}
+
+Reconciler::Reconciler (Widget * container)
+   : mContainer (container)
+{
+}
+
+void Reconciler::update (const std::vector<UiNode> & nodes)
+{
+   mStats = Stats();
+   reconcile (mContainer, mRecords, nodes);
+}
+
+Widget * Reconciler::find (const std::string & key)
+{
+   for (Record & record : mRecords)
+      if (record.key == key)
+         return record.widget.get();
+   return nullptr;
+}
+
+void Reconciler::reconcile (Widget * parent, std::vector<Record> & records, const std::vector<UiNode> & nodes)
+{
+   /* Match the nodes to the records of the last update. Descriptions mostly keep their order, so
+      the record at the same index is tried first and the keys are only hashed once that fails */
+   std::vector<int> match (nodes.size(), -1);
+   std::vector<bool> taken (records.size(), false);
+   std::unordered_map<std::string, int> byKey;
+   for (size_t i = 0; i < nodes.size(); ++i)
+   {
+      int found = -1;
+      if (i < records.size() && !taken[i] && records[i].key == nodes[i].key)
+         found = (int) i;
+      else
+      {
+         if (byKey.empty())
+            for (int j = (int) records.size() - 1; j >= 0; --j)
+               byKey[records[j].key] = j;
+         auto it = byKey.find (nodes[i].key);
+         if (it != byKey.end() && !taken[it->second])
+            found = it->second;
+      }
+      /* A node of another type replaces the widget */
+      if (found >= 0 && records[found].props->type() == nodes[i].props->type() &&
+            records[found].widget->parent() == parent)
+      {
+         match[i] = found;
+         taken[found] = true;
+      }
+   }
+
+   /* Remove first, so that the kept widgets only move among what stays */
+   for (size_t j = 0; j < records.size(); ++j)
+   {
+      if (taken[j])
+         continue;
+      if (records[j].widget->parent() == parent)
+         parent->removeChild (records[j].widget.get());
+      mStats.removed++;
+   }
+
+   std::vector<Record> next (nodes.size());
+   for (size_t i = 0; i < nodes.size(); ++i)
+   {
+      const UiNode & node = nodes[i];
+      Record & record = next[i];
+      if (match[i] >= 0)
+      {
+         record = std::move (records[match[i]]);
+         if (!node.props->equals (*record.props))
+         {
+            node.props->apply (record.widget);
+            record.props = node.props;
+            mStats.updated++;
+         }
+         if (parent->childIndex (record.widget) != (int) i)
+         {
+            parent->moveChild (record.widget, (int) i);
+            mStats.moved++;
+         }
+      }
+      else
+      {
+         record.key = node.key;
+         record.props = node.props;
+         record.widget = node.props->create (parent);
+         parent->moveChild (record.widget, (int) i);
+         if (node.onCreate)
+            node.onCreate (record.widget);
+         mStats.created++;
+      }
+      reconcile (record.widget, record.children, node.children);
+   }
+   records.swap (next);
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,248 @@
+/*
+    nanogui/reconciler.h -- Keeps a widget tree in line with a description
+    that the application builds anew on every change
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include "layout.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Description of one widget for a \ref Reconciler
+
+   Nodes are matched to the widgets of the last update by \c key among their
+   siblings, so keys only need to be unique below one parent. The properties
+   are a plain struct, see \ref uiNode(), and are only applied to the widget
+   when they differ from the last ones. \ref bind() is called once, when the
+   widget is created; set callbacks there, reading the current state of the
+   application rather than capturing it.
+*/
+struct UiNode
+{
+   /// Type erased properties, see \ref uiNode()
+   struct Props
+   {
+      virtual ~Props() { }
+      virtual std::type_index type() const = 0;
+      virtual bool equals (const Props & other) const = 0;
+      virtual Widget * create (Widget * parent) const = 0;
+      virtual void apply (Widget * widget) const = 0;
+   };
+
+   std::string key;
+   std::shared_ptr<const Props> props;
+   std::vector<UiNode> children;
+   std::function<void (Widget *)> onCreate;
+
+   /// Call \c f with the widget once it is created
+   UiNode & bind (std::function<void (Widget *)> f)
+   {
+      onCreate = std::move (f);
+      return *this;
+   }
+};
+
+NAMESPACE_BEGIN (detail)
+
+template <typename P> struct UiProps : UiNode::Props
+{
+   typedef typename P::WidgetType W;
+   P props;
+
+   explicit UiProps (P p) : props (std::move (p)) { }
+
+   std::type_index type() const
+   {
+      return std::type_index (typeid (P));
+   }
+   bool equals (const UiNode::Props & other) const
+   {
+      return other.type() == type() && static_cast<const UiProps &> (other).props == props;
+   }
+   Widget * create (Widget * parent) const
+   {
+      return props.create (parent);
+   }
+   void apply (Widget * widget) const
+   {
+      props.apply (static_cast<W *> (widget));
+   }
+};
+
+NAMESPACE_END (detail)
+
+/**
+   \brief Describe a widget by its properties \c props
+
+   \c P is a struct with a \c WidgetType typedef, an \c operator==, a
+   <tt>WidgetType * create (Widget * parent) const</tt> making the widget with
+   the properties and a <tt>void apply (WidgetType *) const</tt> setting them
+   on an existing one. Structs for the common widgets follow.
+*/
+template <typename P> UiNode uiNode (const std::string & key, P props, std::vector<UiNode> children = {})
+{
+   UiNode node;
+   node.key = key;
+   node.props = std::make_shared<detail::UiProps<P>> (std::move (props));
+   node.children = std::move (children);
+   return node;
+}
+
+/// Plain widget holding others in a BoxLayout
+struct PanelProps
+{
+   typedef Widget WidgetType;
+   Orientation orientation = Orientation::Vertical;
+   Alignment alignment = Alignment::Middle;
+   int margin = 0, spacing = 0;
+
+   bool operator== (const PanelProps & o) const
+   {
+      return orientation == o.orientation && alignment == o.alignment && margin == o.margin && spacing == o.spacing;
+   }
+   Widget * create (Widget * parent) const;
+   void apply (Widget * widget) const;
+};
+
+struct LabelProps
+{
+   typedef Label WidgetType;
+   std::string caption;
+   std::string font = "sans";
+   int fontSize = -1;
+
+   bool operator== (const LabelProps & o) const
+   {
+      return caption == o.caption && font == o.font && fontSize == o.fontSize;
+   }
+   Label * create (Widget * parent) const;
+   void apply (Label * label) const;
+};
+
+struct ButtonProps
+{
+   typedef Button WidgetType;
+   std::string caption;
+   int icon = 0;
+
+   bool operator== (const ButtonProps & o) const
+   {
+      return caption == o.caption && icon == o.icon;
+   }
+   Button * create (Widget * parent) const;
+   void apply (Button * button) const;
+};
+
+struct CheckBoxProps
+{
+   typedef CheckBox WidgetType;
+   std::string caption;
+   bool checked = false;
+
+   bool operator== (const CheckBoxProps & o) const
+   {
+      return caption == o.caption && checked == o.checked;
+   }
+   CheckBox * create (Widget * parent) const;
+   void apply (CheckBox * checkBox) const;
+};
+
+/// The value is left alone while the box is being edited
+struct TextBoxProps
+{
+   typedef TextBox WidgetType;
+   std::string value;
+   std::string units;
+   bool editable = true;
+   int fixedWidth = 0;
+
+   bool operator== (const TextBoxProps & o) const
+   {
+      return value == o.value && units == o.units && editable == o.editable && fixedWidth == o.fixedWidth;
+   }
+   TextBox * create (Widget * parent) const;
+   void apply (TextBox * textBox) const;
+};
+
+/**
+   \brief Updates the children of a container to match a list of \ref UiNode
+
+   Each \ref update() walks the new description alongside the one from the
+   last update. Widgets whose key and property type are still there are kept
+   along with their focus, scroll position and caches, and only get the
+   properties that changed; the others are removed, new nodes are created and
+   kept widgets are moved to their new place among their siblings. Changing a
+   few properties of a large inspector thus costs one comparison per node and
+   the setters of what changed, not a rebuild and a full layout.
+
+   The reconciler owns the children of the container: widgets added to it
+   some other way end up after the reconciled ones.
+
+   \code
+   Reconciler inspector (window);
+   void showSelection()
+   {
+      std::vector<UiNode> rows;
+      for (const Property & p : selection.properties())
+         rows.push_back (uiNode (p.name, PanelProps { Orientation::Horizontal }, {
+            uiNode ("name", LabelProps { p.name }),
+            uiNode ("value", TextBoxProps { p.text() })
+         }));
+      inspector.update (rows);
+   }
+   \endcode
+*/
+class  Reconciler
+{
+   public:
+      /// What the last \ref update() did
+      struct Stats
+      {
+         int created = 0, updated = 0, moved = 0, removed = 0;
+      };
+
+      explicit Reconciler (Widget * container);
+
+      /// Bring the children of the container in line with \c nodes
+      void update (const std::vector<UiNode> & nodes);
+
+      /// Return the widget made for the top level node \c key, or null
+      Widget * find (const std::string & key);
+
+      const Stats & stats() const
+      {
+         return mStats;
+      }
+
+   protected:
+      struct Record
+      {
+         std::string key;
+         std::shared_ptr<const UiNode::Props> props;
+         ref<Widget> widget;
+         std::vector<Record> children;
+      };
+
+      void reconcile (Widget * parent, std::vector<Record> & records, const std::vector<UiNode> & nodes);
+
+      ref<Widget> mContainer;
+      std::vector<Record> mRecords;
+      Stats mStats;
+};
+
+NAMESPACE_END (nanogui)
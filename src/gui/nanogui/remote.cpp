@@ -0,0 +1,459 @@
+/*
+    src/remote.cpp -- Streaming of the frames of a screen to a remote
+    client as delta coded NanoVG captures, with its input sent back
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "remote.h"
+#include "screen.h"
+#include <cmath>
+#include <cstring>
+
+NAMESPACE_BEGIN (nanogui)
+
+/* Messages of the server */
+static const uint8_t keyframeMessage = 'K';
+static const uint8_t deltaMessage = 'D';
+
+/* Messages of the client */
+enum ClientMessage : uint8_t
+{
+   CursorPos = 1, MouseButton, Key, Char, Scroll, Resize, KeyframeRequest
+};
+
+/* Operations of a frame delta */
+static const uint8_t copyChunks = 0;
+static const uint8_t literalBytes = 1;
+
+static const size_t minChunk = 16;
+static const size_t maxChunk = 256;
+
+/* The same LEB128 and zigzag coding as the input recordings */
+static void put (std::vector<uint8_t> & out, uint64_t value)
+{
+   while (value >= 0x80)
+   {
+      out.push_back ((uint8_t) (value | 0x80));
+      value >>= 7;
+   }
+   out.push_back ((uint8_t)value);
+}
+
+static void putSigned (std::vector<uint8_t> & out, int64_t value)
+{
+   put (out, ((uint64_t)value << 1) ^ (uint64_t) (value >> 63));
+}
+
+/* Readers of the variable length integers, false at the end of the data */
+static bool get (const uint8_t * data, size_t size, size_t & pos, uint64_t & value)
+{
+   value = 0;
+   for (int shift = 0; shift < 64 && pos < size; shift += 7)
+   {
+      uint8_t byte = data[pos++];
+      value |= (uint64_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return true;
+   }
+   return false;
+}
+
+static bool getSigned (const uint8_t * data, size_t size, size_t & pos, int & value)
+{
+   uint64_t v;
+   if (!get (data, size, pos, v))
+      return false;
+   value = (int) ((int64_t) (v >> 1) ^ -(int64_t) (v & 1));
+   return true;
+}
+
+static uint64_t hashChunk (const uint8_t * data, size_t size)
+{
+   /* FNV-1a */
+   uint64_t h = 14695981039346656037ull;
+   for (size_t i = 0; i < size; ++i)
+      h = (h ^ data[i]) * 1099511628211ull;
+   return h;
+}
+
+/* Cuts where the gear hash of the bytes before has its top 6 bits clear, a chunk of 80 bytes on average */
+static void cutChunks (const uint8_t * data, size_t size, std::vector<uint64_t> & ends)
+{
+   static uint64_t gear[256];
+   static bool gearReady = false;
+   if (!gearReady)
+   {
+      uint64_t seed = 0x9e3779b97f4a7c15ull;
+      for (uint64_t & g : gear)
+      {
+         /* splitmix64, so that both ends of the stream have the same table */
+         uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+         z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+         z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+         g = z ^ (z >> 31);
+      }
+      gearReady = true;
+   }
+   ends.clear();
+   uint64_t h = 0;
+   size_t start = 0;
+   for (size_t i = 0; i < size; ++i)
+   {
+      h = (h << 1) + gear[data[i]];
+      size_t length = i + 1 - start;
+      if (length >= maxChunk || (length >= minChunk && (h >> 58) == 0))
+      {
+         ends.push_back (i + 1);
+         start = i + 1;
+         h = 0;
+      }
+   }
+   if (start < size)
+      ends.push_back (size);
+}
+
+void FrameDelta::reset()
+{
+   mPrevious.clear();
+   mChunks.clear();
+   mIndex.clear();
+}
+
+void FrameDelta::setPrevious (std::vector<uint8_t> frame)
+{
+   reset();
+   mPrevious = std::move (frame);
+   std::vector<uint64_t> ends;
+   cutChunks (mPrevious.data(), mPrevious.size(), ends);
+   uint32_t offset = 0;
+   for (uint64_t end : ends)
+   {
+      Chunk chunk = { offset, (uint32_t)end - offset, hashChunk (mPrevious.data() + offset, (size_t)end - offset) };
+      mIndex.emplace (chunk.hash, (uint32_t)mChunks.size());
+      mChunks.push_back (chunk);
+      offset = (uint32_t)end;
+   }
+}
+
+void FrameDelta::encode (const uint8_t * frame, size_t size, bool keyframe, std::vector<uint8_t> & out)
+{
+   if (keyframe)
+      reset();
+   std::vector<uint64_t> ends;
+   cutChunks (frame, size, ends);
+   size_t literalStart = 0, literalEnd = 0;
+   uint32_t copyStart = 0, copyCount = 0;
+   auto flushLiteral = [&]()
+   {
+      if (literalEnd > literalStart)
+      {
+         out.push_back (literalBytes);
+         put (out, literalEnd - literalStart);
+         out.insert (out.end(), frame + literalStart, frame + literalEnd);
+      }
+   };
+   auto flushCopy = [&]()
+   {
+      if (copyCount)
+      {
+         out.push_back (copyChunks);
+         put (out, copyStart);
+         put (out, copyCount);
+         copyCount = 0;
+      }
+   };
+   size_t offset = 0;
+   for (uint64_t end : ends)
+   {
+      size_t length = (size_t)end - offset;
+      auto found = mIndex.find (hashChunk (frame + offset, length));
+      const Chunk * chunk = found != mIndex.end() ? &mChunks[found->second] : nullptr;
+      /* Cut alike, equal bytes give equal chunks; the compare only guards against a collision */
+      if (chunk && chunk->size == length && memcmp (mPrevious.data() + chunk->offset, frame + offset, length) == 0)
+      {
+         flushLiteral();
+         literalStart = literalEnd = end;
+         if (copyCount && found->second == copyStart + copyCount)
+            copyCount++;
+         else
+         {
+            flushCopy();
+            copyStart = found->second;
+            copyCount = 1;
+         }
+      }
+      else
+      {
+         flushCopy();
+         if (literalEnd == literalStart)
+            literalStart = offset;
+         literalEnd = end;
+      }
+      offset = end;
+   }
+   flushCopy();
+   flushLiteral();
+   setPrevious (std::vector<uint8_t> (frame, frame + size));
+}
+
+bool FrameDelta::decode (const uint8_t * code, size_t size, bool keyframe, std::vector<uint8_t> & frame)
+{
+   if (keyframe)
+      reset();
+   frame.clear();
+   size_t pos = 0;
+   bool damaged = false;
+   while (pos < size && !damaged)
+   {
+      uint8_t op = code[pos++];
+      uint64_t a, b;
+      if (op == copyChunks)
+      {
+         if (!get (code, size, pos, a) || !get (code, size, pos, b) || b == 0 || a + b > mChunks.size())
+         {
+            damaged = true;
+            break;
+         }
+         const Chunk & first = mChunks[a], & last = mChunks[a + b - 1];
+         frame.insert (frame.end(), mPrevious.begin() + first.offset, mPrevious.begin() + last.offset + last.size);
+      }
+      else
+         if (op == literalBytes)
+         {
+            if (!get (code, size, pos, a) || a > size - pos)
+            {
+               damaged = true;
+               break;
+            }
+            frame.insert (frame.end(), code + pos, code + pos + a);
+            pos += (size_t)a;
+         }
+         else
+            damaged = true;
+   }
+   if (damaged)
+   {
+      /* Whatever follows builds on a frame the encoder never had */
+      reset();
+      frame.clear();
+      return false;
+   }
+   setPrevious (frame);
+   return true;
+}
+
+RemoteServer::RemoteServer (Screen * screen, const Send & send)
+   : mScreen (screen), mSend (send)
+{
+   /* A capture holds what is drawn, so every frame has to draw all of the screen */
+   mScreen->setOffscreen (false);
+   mScreen->setPartialRedraw (false);
+   mPoll = std::make_shared<std::function<void()>> ([this]()
+   {
+      poll();
+   });
+   mScreen->addPoll (mPoll);
+   requestKeyframe();
+}
+
+RemoteServer::~RemoteServer()
+{
+   /* The capture is dropped with the next one, stop taking it */
+   if (mArmed)
+      nvgCaptureFrames (mScreen->getContext(), 0);
+}
+
+void RemoteServer::requestKeyframe()
+{
+   mKeyframe = true;
+   mScreen->requestRedraw();
+}
+
+void RemoteServer::poll()
+{
+   NVGcontext * ctx = mScreen->getContext();
+   int size = 0;
+   const unsigned char * data = mArmed ? nvgCaptureData (ctx, &size) : nullptr;
+   if (data)
+   {
+      mMessage.clear();
+      mMessage.push_back (mKeyframe ? keyframeMessage : deltaMessage);
+      put (mMessage, mFrame);
+      mDelta.encode (data, (size_t)size, mKeyframe, mMessage);
+      mKeyframe = false;
+      mFrame++;
+      mBytesSent += mMessage.size();
+      mArmed = false;
+      mSend (mMessage);
+   }
+   /* Armed until the screen draws again, which may be many polls later */
+   if (!mArmed)
+   {
+      nvgCaptureFrames (ctx, 1);
+      mArmed = true;
+   }
+}
+
+void RemoteServer::receive (const uint8_t * data, size_t size)
+{
+   size_t pos = 0;
+   if (size == 0)
+      return;
+   int args[4];
+   uint64_t codepoint;
+   switch (data[pos++])
+   {
+      case CursorPos:
+         if (getSigned (data, size, pos, args[0]) && getSigned (data, size, pos, args[1]))
+            mScreen->cursorPosCallbackEvent (args[0], args[1]);
+         break;
+      case MouseButton:
+         if (getSigned (data, size, pos, args[0]) && getSigned (data, size, pos, args[1])
+             && getSigned (data, size, pos, args[2]))
+            mScreen->mouseButtonCallbackEvent (args[0], args[1], args[2]);
+         break;
+      case Key:
+         if (getSigned (data, size, pos, args[0]) && getSigned (data, size, pos, args[1])
+             && getSigned (data, size, pos, args[2]) && getSigned (data, size, pos, args[3]))
+            mScreen->keyCallbackEvent (args[0], args[1], args[2], args[3]);
+         break;
+      case Char:
+         if (get (data, size, pos, codepoint))
+            mScreen->charCallbackEvent ((unsigned int)codepoint);
+         break;
+      case Scroll:
+         /* The offsets come in 1/256 steps */
+         if (getSigned (data, size, pos, args[0]) && getSigned (data, size, pos, args[1])
+             && getSigned (data, size, pos, args[2]) && getSigned (data, size, pos, args[3]))
+            mScreen->scrollEvent (Vector2i (args[0], args[1]), Vector2f (args[2], args[3]) / 256.0f);
+         break;
+      case Resize:
+         if (getSigned (data, size, pos, args[0]) && getSigned (data, size, pos, args[1]))
+         {
+            mScreen->resizeCallbackEvent (args[0], args[1]);
+            requestKeyframe();
+         }
+         break;
+      case KeyframeRequest:
+         requestKeyframe();
+         break;
+   }
+}
+
+RemoteClient::RemoteClient (NVGcontext * ctx, const Send & send)
+   : mContext (ctx), mSend (send)
+{
+}
+
+RemoteClient::~RemoteClient()
+{
+   if (mReplay)
+      nvgDeleteReplay (mContext, mReplay);
+}
+
+bool RemoteClient::receive (const uint8_t * data, size_t size)
+{
+   size_t pos = 1;
+   uint64_t frame;
+   if (size == 0 || (data[0] != keyframeMessage && data[0] != deltaMessage) || !get (data, size, pos, frame))
+      return true;
+   bool keyframe = data[0] == keyframeMessage;
+   /* A delta only fits the frame it was coded against */
+   if (!keyframe && (!mSynced || frame != (uint64_t)mFrame + 1))
+   {
+      requestKeyframe();
+      return false;
+   }
+   if (!mDelta.decode (data + pos, size - pos, keyframe, mFrameData))
+   {
+      requestKeyframe();
+      return false;
+   }
+   bool loaded = mReplay ? nvgReplayLoad (mReplay, mFrameData.data(), (int)mFrameData.size()) != 0
+                 : (mReplay = nvgCreateReplay (mFrameData.data(), (int)mFrameData.size())) != nullptr;
+   if (!loaded)
+   {
+      /* Another build of NanoVG, asking again will not help */
+      mSynced = false;
+      return false;
+   }
+   mFrame = (uint32_t)frame;
+   mSynced = true;
+   mNewFrame = true;
+   return true;
+}
+
+bool RemoteClient::draw()
+{
+   mNewFrame = false;
+   if (!mReplay)
+      return false;
+   nvgRewindReplay (mReplay);
+   return nvgReplayFrame (mContext, mReplay) == 1;
+}
+
+void RemoteClient::requestKeyframe()
+{
+   mSynced = false;
+   mSend (std::vector<uint8_t> (1, KeyframeRequest));
+}
+
+void RemoteClient::cursorPos (int x, int y)
+{
+   std::vector<uint8_t> message (1, CursorPos);
+   putSigned (message, x);
+   putSigned (message, y);
+   mSend (message);
+}
+
+void RemoteClient::mouseButton (int button, int action, int modifiers)
+{
+   std::vector<uint8_t> message (1, MouseButton);
+   putSigned (message, button);
+   putSigned (message, action);
+   putSigned (message, modifiers);
+   mSend (message);
+}
+
+void RemoteClient::key (int key, int scancode, int action, int mods)
+{
+   std::vector<uint8_t> message (1, Key);
+   putSigned (message, key);
+   putSigned (message, scancode);
+   putSigned (message, action);
+   putSigned (message, mods);
+   mSend (message);
+}
+
+void RemoteClient::character (unsigned int codepoint)
+{
+   std::vector<uint8_t> message (1, Char);
+   put (message, codepoint);
+   mSend (message);
+}
+
+void RemoteClient::scroll (int x, int y, float dx, float dy)
+{
+   std::vector<uint8_t> message (1, Scroll);
+   putSigned (message, x);
+   putSigned (message, y);
+   putSigned (message, std::lround (dx * 256.0f));
+   putSigned (message, std::lround (dy * 256.0f));
+   mSend (message);
+}
+
+void RemoteClient::resize (int width, int height)
+{
+   std::vector<uint8_t> message (1, Resize);
+   putSigned (message, width);
+   putSigned (message, height);
+   mSend (message);
+}
+
+NAMESPACE_END (nanogui)
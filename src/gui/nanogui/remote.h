@@ -0,0 +1,188 @@
+/*
+    nanogui/remote.h -- Streaming of the frames of a screen to a remote
+    client as delta coded NanoVG captures, with its input sent back
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct NVGcontext;
+struct NVGreplay;
+
+NAMESPACE_BEGIN (nanogui)
+
+class Screen;
+
+/**
+   \brief Codes a frame as the differences to the previous one
+
+   The frame is cut into chunks where its content says so, with a rolling
+   hash, so that an insertion only changes the chunks around it. A chunk
+   also found in the previous frame is sent as its index there, runs of
+   such chunks as one copy, and everything else as literal bytes. Encoder
+   and decoder keep the same previous frame and cut it the same way.
+*/
+class  FrameDelta
+{
+   public:
+      /// Append the code of \c frame to \c out, in full if \c keyframe, and make it the previous frame
+      void encode (const uint8_t * frame, size_t size, bool keyframe, std::vector<uint8_t> & out);
+      /// Decode a code made by \ref encode() into \c frame and make it the previous frame, false if it is damaged
+      bool decode (const uint8_t * code, size_t size, bool keyframe, std::vector<uint8_t> & frame);
+      /// Forget the previous frame
+      void reset();
+
+   protected:
+      struct Chunk
+      {
+         uint32_t offset, size;
+         uint64_t hash;
+      };
+
+      /// Cut \c frame into chunks and keep it as the previous frame
+      void setPrevious (std::vector<uint8_t> frame);
+
+      std::vector<uint8_t> mPrevious;
+      std::vector<Chunk> mChunks;
+      std::unordered_map<uint64_t, uint32_t> mIndex;	// first chunk with a hash
+};
+
+/**
+   \brief Sends the frames of a screen to a \ref RemoteClient and delivers its input
+
+   Every frame the screen draws is captured with nvgCaptureFrames() and sent
+   coded against the previous one, so the bandwidth follows what changed
+   rather than the resolution, and a screen that does not redraw sends
+   nothing. Messages of the client are handed to \ref receive(); they carry
+   input, which goes into the screen's callbacks, resizes and requests for a
+   full frame. How messages travel is up to the application: each call of
+   \c send is one message, to be delivered whole and in order.
+
+   A frame is sent at the start of the next \ref Screen::drawWidgets(). The
+   widgets are drawn in full while streaming, without offscreen rendering or
+   partial redraws, and the content of images is not sent: the client draws
+   blank images of their size.
+
+   \code
+   RemoteServer server (screen, [&] (const std::vector<uint8_t> & message)
+   {
+      connection.send (message.data(), message.size());
+   });
+   // for every message of the client
+   server.receive (data, size);
+   \endcode
+*/
+class  RemoteServer
+{
+   public:
+      typedef std::function<void (const std::vector<uint8_t> &)> Send;
+
+      RemoteServer (Screen * screen, const Send & send);
+      ~RemoteServer();
+
+      /// Handle a message of the client
+      void receive (const uint8_t * data, size_t size);
+      /// Redraw and send the next frame in full, as to a client that just connected
+      void requestKeyframe();
+
+      /// Return the number of frames sent
+      uint32_t frames() const
+      {
+         return mFrame;
+      }
+      /// Return the number of bytes sent
+      uint64_t bytesSent() const
+      {
+         return mBytesSent;
+      }
+
+   protected:
+      /// Send the frame captured last and capture the next one
+      void poll();
+
+      Screen * mScreen;
+      Send mSend;
+      std::shared_ptr<std::function<void()>> mPoll;
+      FrameDelta mDelta;
+      std::vector<uint8_t> mMessage;
+      bool mArmed = false;	// a frame capture is requested
+      bool mKeyframe = true;
+      uint32_t mFrame = 0;
+      uint64_t mBytesSent = 0;
+};
+
+/**
+   \brief Draws the frames sent by a \ref RemoteServer and sends input back
+
+   Needs nothing of nanogui but a NanoVG context with the fonts of the
+   server's theme, so it fits a thin client. Messages of the server are
+   handed to \ref receive(), and \ref draw() draws the latest frame. A
+   message that does not fit the previous frame, after a loss or a
+   reconnection, makes the client ask for a full frame.
+
+   \code
+   RemoteClient client (ctx, [&] (const std::vector<uint8_t> & message)
+   {
+      connection.send (message.data(), message.size());
+   });
+   client.resize (width, height);
+   // for every message of the server
+   client.receive (data, size);
+   // every frame
+   client.draw();
+   \endcode
+*/
+class  RemoteClient
+{
+   public:
+      typedef RemoteServer::Send Send;
+
+      RemoteClient (NVGcontext * ctx, const Send & send);
+      ~RemoteClient();
+
+      /// Handle a message of the server, false if it did not fit and a full frame was requested
+      bool receive (const uint8_t * data, size_t size);
+      /// Draw the latest frame, false if there is none
+      bool draw();
+      /// Return whether a frame arrived since the last \ref draw()
+      bool hasNewFrame() const
+      {
+         return mNewFrame;
+      }
+
+      /* Input, sent to the server at once */
+      void cursorPos (int x, int y);
+      void mouseButton (int button, int action, int modifiers);
+      void key (int key, int scancode, int action, int mods);
+      void character (unsigned int codepoint);
+      void scroll (int x, int y, float dx, float dy);
+      /// Ask the server to lay its screen out for the size of the client
+      void resize (int width, int height);
+
+   protected:
+      void requestKeyframe();
+
+      NVGcontext * mContext;
+      Send mSend;
+      NVGreplay * mReplay = nullptr;
+      FrameDelta mDelta;
+      std::vector<uint8_t> mFrameData;
+      uint32_t mFrame = 0;
+      bool mSynced = false;	// the previous frame is the server's
+      bool mNewFrame = false;
+};
+
+NAMESPACE_END (nanogui)
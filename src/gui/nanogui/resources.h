@@ -1,17 +1,20 @@
 #if !defined(__RESOURCES_H)
 #define __RESOURCES_H
 
-/* Autogenerated by bin2c */
+/* Autogenerated by bin2c, the data is zlib compressed */
 
 #include <stdint.h>
 
-extern uint8_t entypo_ttf[];
+extern uint8_t entypo_ttf_z[];
+extern uint32_t entypo_ttf_z_size;
 extern uint32_t entypo_ttf_size;
 
-extern uint8_t roboto_bold_ttf[];
+extern uint8_t roboto_bold_ttf_z[];
+extern uint32_t roboto_bold_ttf_z_size;
 extern uint32_t roboto_bold_ttf_size;
 
-extern uint8_t roboto_regular_ttf[];
+extern uint8_t roboto_regular_ttf_z[];
+extern uint32_t roboto_regular_ttf_z_size;
 extern uint32_t roboto_regular_ttf_size;
 
 #endif /* __RESOURCES_H */
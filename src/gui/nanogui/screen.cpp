@@ -13,63 +13,1459 @@
 
 #include "screen.h"
 #include "window.h"
+#include "popup.h"
+#include "animator.h"
 #include "theme.h"
+#include "entypo.h"
+#include "drawinspector.h"
+#include "inputrecorder.h"
+#include "vscrollpanel.h"
+#include "widgetsearch.h"
+#include "../util/FrameCapture.h"
+#include "../util/FramePacer.h"
+#include "../util/GlyphWorker.h"
+#include "../util/ImageLoader.h"
+#include "../util/ImageManager.h"
+#include "../util/Profiler.h"
+#include "../util/RenderThread.h"
+#include "../util/StartupTimeline.h"
+#include "../util/TaskPool.h"
+#include "../util/TaskQueue.h"
+#include "../util/TimerWheel.h"
+#include "../util/TraceSink.h"
 #include "cinder/gl/gl.h"
 
 /* Allow enforcing the GL2 implementation of NanoVG */
 #define NANOVG_GL3_IMPLEMENTATION
 #include "../nanovg/nanovg_gl.h"
+#include "../nanovg/nanovg_gl_utils.h"
 
 NAMESPACE_BEGIN (nanogui)
 
+/* Frames AntiAliasing::Automatic renders each way, the first of which settle and are not measured */
+static const int AntiAliasingTrialFrames = 40;
+static const int AntiAliasingWarmupFrames = 8;
+/* Frames per window of the quality governor and frames left out after a step while the redraw settles,
+   the share of the budget a window stays under to step back up, and the tolerance factor of coarse curves */
+static const int GovernorWindowFrames = 30;
+static const int GovernorSettleFrames = 8;
+static const double GovernorHeadroom = 0.6;
+static const float CoarseCurveTolerance = 4.0f;
+
+static NVGcontext * createGL3Context()
+{
+#ifdef NDEBUG
+   return nvgCreateGL3 (NVG_STENCIL_STROKES | NVG_ANTIALIAS | NVG_RING_BUFFERS | NVG_MERGE_CALLS | NVG_REORDER_CALLS | NVG_INSTANCED_QUADS | NVG_ATLAS_IMAGES | NVG_BATCH_UPLOADS | NVG_SHADER_VARIANTS | NVG_HARDWARE_SCISSOR | NVG_DIRECT_STATE_ACCESS | NVG_PATH_RENDERING | NVG_INSTANCE_SHAPES);
+#else
+   return nvgCreateGL3 (NVG_STENCIL_STROKES | NVG_ANTIALIAS | NVG_RING_BUFFERS | NVG_MERGE_CALLS | NVG_REORDER_CALLS | NVG_INSTANCED_QUADS | NVG_ATLAS_IMAGES | NVG_BATCH_UPLOADS | NVG_SHADER_VARIANTS | NVG_HARDWARE_SCISSOR | NVG_DIRECT_STATE_ACCESS | NVG_PATH_RENDERING | NVG_INSTANCE_SHAPES | NVG_DEBUG);
+#endif
+}
+
+ScreenContext::ScreenContext()
+{
+   STARTUP_STEP ("nanovg context");
+   mContext = createGL3Context();
+   if (mContext == nullptr)
+      throw std::runtime_error ("Could not initialize NanoVG!");
+   nvgSetProfileCallback (mContext, Profiler::nvgCallback, nullptr);
+}
+
+ScreenContext::ScreenContext (const std::function<void()> & makeCurrent, const std::function<void (int, int)> & begin,
+                              const std::function<void()> & present)
+{
+   STARTUP_STEP ("render thread and nanovg context");
+   RenderThread::Callbacks callbacks;
+   callbacks.makeCurrent = makeCurrent;
+   callbacks.createContext = createGL3Context;
+   callbacks.deleteContext = nvgDeleteGL3;
+   callbacks.begin = begin;
+   callbacks.present = present;
+   /* Throws when the back-end could not be created on the render thread */
+   mRenderThread.reset (new RenderThread (callbacks));
+   mContext = mRenderThread->context();
+   nvgSetProfileCallback (mContext, Profiler::nvgCallback, nullptr);
+}
+
+ScreenContext::~ScreenContext()
+{
+   mTheme = nullptr;
+   /* The render thread deletes the back-end itself */
+   if (mRenderThread)
+      mRenderThread.reset();
+   else
+      nvgDeleteGL3 (mContext);
+}
+
+Theme * ScreenContext::theme()
+{
+   if (!mTheme)
+   {
+      STARTUP_STEP ("theme");
+      mTheme = new Theme (mContext);
+   }
+   return mTheme;
+}
+
 // ctor
 Screen::Screen()
-   : Widget (nullptr)
+   : Screen (new ScreenContext(), false)
+{
+}
+
+Screen::Screen (ScreenContext * shared)
+   : Screen (shared, true)
+{
+   mTheme = shared->theme();
+}
+
+Screen::Screen (ScreenContext * shared, bool windowState)
+   : Widget (nullptr), mShared (shared), mNVGContext (shared->context())
+{
+   mKind |= ScreenKind;
+   mTasks[0].reset (new TaskQueue());
+   mTasks[1].reset (new TaskQueue());
+   mTimers.reset (new TimerWheel());
+   /* Vertex arrays are not shared between GL contexts, so this window needs its own */
+   if (windowState && !shared->threaded())
+      mWindowState = nvglCreateWindowState (mNVGContext);
+   mGlState.reset (new NVGglState());
+   memset (&mFrameStats, 0, sizeof (mFrameStats));
+   start = std::chrono::system_clock::now();
+}
+
+// dtor
+Screen::~Screen ()
+{
+   for (auto & op : mAsyncOperations)
+      op->cancel();
+   for (auto & op : mAsyncOperations)
+      op->mThread.join();
+   mGlyphWorker.reset();
+   mImageManager.reset();
+   mImageLoader.reset();
+   if (mTaskPool)
+      nvgSetParallelCallback (mNVGContext, nullptr, nullptr);
+   for (auto ctx : mMeasureContexts)
+      nvgDeleteMeasureContext (ctx);
+   if (mGlyphThread.joinable())
+      mGlyphThread.join();
+   nvgDeleteGlyphBuilder (mGlyphBuilder);
+   if (mFramebuffer)
+      nvgluDeleteFramebuffer (mFramebuffer);
+   if (mMultisampleFramebuffer)
+      nvgluDeleteFramebuffer (mMultisampleFramebuffer);
+   mFrameCapture.reset();
+   if (mDragPreview)
+      nvgDeleteDrawList (mDragPreview);
+   if (!mShared->threaded())
+      nvglDeleteWindowState (mNVGContext, mWindowState);
+}
+
+void Screen::setTessellationThreads (int threads)
+{
+   nvgSetParallelCallback (mNVGContext, nullptr, nullptr);
+   mTaskPool.reset();
+   if (threads == 0)
+      return;
+   mTaskPool.reset (new TaskPool (threads > 0 ? threads : 0));
+   nvgSetParallelCallback (mNVGContext, TaskPool::nvgCallback, mTaskPool.get());
+}
+
+int Screen::tessellationThreads() const
+{
+   return mTaskPool ? mTaskPool->threadCount() : 0;
+}
+
+void Screen::performLayout (NVGcontext * ctx)
+{
+   mLayoutWindows.clear();
+   if (mTaskPool && !mLayout && (mLayoutDirty || mLayoutSize != mSize))
+      for (auto c : mChildren)
+         if (c->isWindow() && !c->isPopup() && c->layoutDirty())
+            mLayoutWindows.push_back ((Window *) c);
+   if (mLayoutWindows.size() < 2)
+   {
+      Widget::performLayout (ctx);
+      return;
+   }
+   PROFILE_ZONE ("Screen::performLayout");
+   if (!prepareMeasureContexts (ctx, mLayoutWindows))
+   {
+      Widget::performLayout (ctx);
+      return;
+   }
+
+   /* The windows are sized in between, on this thread, since that touches the screen */
+   mTaskPool->parallelFor ([] (void * data, int index)
+   {
+      Screen * screen = (Screen *)data;
+      NVGcontext * measure = screen->acquireMeasureContext();
+      screen->mLayoutWindows[index]->cachedPreferredSize (measure);
+      screen->releaseMeasureContext (measure);
+   }, this, (int)mLayoutWindows.size());
+   for (auto window : mLayoutWindows)
+   {
+      Vector2i pref = window->cachedPreferredSize (ctx), fix = window->fixedSize();
+      window->setSize (Vector2i (fix[0] ? fix[0] : pref[0], fix[1] ? fix[1] : pref[1]));
+   }
+
+   /* Widgets marked dirty below the windows only read the flag of the screen and skip the damage,
+      which then covers the whole screen */
+   mDirty = true;
+   mParallelLayout = true;
+   mTaskPool->parallelFor ([] (void * data, int index)
+   {
+      Screen * screen = (Screen *)data;
+      NVGcontext * measure = screen->acquireMeasureContext();
+      screen->mLayoutWindows[index]->performLayout (measure);
+      screen->releaseMeasureContext (measure);
+   }, this, (int)mLayoutWindows.size());
+   mParallelLayout = false;
+   markDirty();
+
+   /* Lays out the other children; the windows above are up to date and return right away */
+   Widget::performLayout (ctx);
+}
+
+bool Screen::prepareMeasureContexts (NVGcontext * ctx, const std::vector<Window *> & windows)
+{
+   /* Measure contexts cannot load fonts, so the fonts of the themes are looked up here first */
+   auto loadFonts = [ctx] (const Theme * theme)
+   {
+      if (!theme)
+         return;
+      theme->mFontNormal.id (ctx);
+      theme->mFontBold.id (ctx);
+      theme->mFontIcons.id (ctx);
+   };
+   loadFonts (mTheme);
+   for (auto window : windows)
+      loadFonts (window->theme());
+   for (auto measure : mMeasureContexts)
+      if (nvgMeasureParent (measure) != ctx)
+      {
+         for (auto m : mMeasureContexts)
+            nvgDeleteMeasureContext (m);
+         mMeasureContexts.clear();
+         break;
+      }
+   while ((int)mMeasureContexts.size() < mTaskPool->threadCount() + 1)
+   {
+      NVGcontext * measure = nvgCreateMeasureContext (ctx);
+      if (!measure)
+         break;
+      mMeasureContexts.push_back (measure);
+   }
+   for (auto measure : mMeasureContexts)
+      nvgUpdateMeasureContext (measure);
+   if (mMeasureContexts.size() < 2)
+      return false;
+   mFreeMeasureContexts = mMeasureContexts;
+   return true;
+}
+
+/* Whether nothing in the subtree draws with objects of the screen's context */
+static bool recordableSubtree (const Widget * widget)
+{
+   if (!widget->threadSafeDraw() || (widget->layered() && widget->alpha() < 1.0f))
+      return false;
+   for (const Widget * child : widget->children())
+      if (child->visible() && !recordableSubtree (child))
+         return false;
+   return true;
+}
+
+void Screen::recordWindows (NVGcontext * ctx)
+{
+   mDrawWindows.clear();
+   if (!mParallelDraw || !mTaskPool)
+      return;
+#ifdef NANOGUI_DRAW_INSPECTOR
+   if (DrawInspector::instance().enabled())
+      return;
+#endif
+   /* Windows missing every damaged rectangle are not drawn this frame */
+   float margin = mTheme ? (float) mTheme->mWindowDropShadowSize : 0.0f;
+   for (auto c : mChildren)
+   {
+      if (!c->isWindow() || !c->visible() || c->occluded() || c->alpha() < 1.0f)
+         continue;
+      bool damaged = mFrameDamage.empty();
+      for (const Vector4i & r : mFrameDamage)
+         if (c->position().x() - margin < r[2] / mPixelRatio && c->position().x() + c->width() + margin > r[0] / mPixelRatio &&
+               c->position().y() - margin < r[3] / mPixelRatio && c->position().y() + c->height() + margin > r[1] / mPixelRatio)
+         {
+            damaged = true;
+            break;
+         }
+      if (damaged && recordableSubtree (c))
+         mDrawWindows.push_back ((Window *) c);
+   }
+   if (mDrawWindows.size() < 2 || !prepareMeasureContexts (ctx, mDrawWindows))
+   {
+      mDrawWindows.clear();
+      return;
+   }
+   PROFILE_ZONE ("Screen::recordWindows");
+   for (auto window : mDrawWindows)
+      if (!window->extras().frameList)
+         window->extras().frameList = nvgCreateDrawList();
+   mTaskPool->parallelFor ([] (void * data, int index)
+   {
+      Screen * screen = (Screen *)data;
+      Window * window = screen->mDrawWindows[index];
+      Widget::Extras & extras = window->extras();
+      if (!extras.frameList)
+         return;
+      NVGcontext * measure = screen->acquireMeasureContext();
+      nvgSave (measure);
+      nvgReset (measure);
+      nvgTranslate (measure, screen->mPos.x(), screen->mPos.y());
+      nvgRecordDrawList (measure, extras.frameList);
+      window->drawRetained (measure);
+      nvgEndDrawList (measure);
+      nvgRestore (measure);
+      /* A list that failed is not replayed, the window is then drawn again on this thread */
+      extras.frameRecorded = true;
+      screen->releaseMeasureContext (measure);
+   }, this, (int)mDrawWindows.size());
+}
+
+NVGcontext * Screen::acquireMeasureContext()
+{
+   std::lock_guard<std::mutex> lock (mMeasureMutex);
+   NVGcontext * ctx = mFreeMeasureContexts.back();
+   mFreeMeasureContexts.pop_back();
+   return ctx;
+}
+
+void Screen::releaseMeasureContext (NVGcontext * ctx)
+{
+   std::lock_guard<std::mutex> lock (mMeasureMutex);
+   mFreeMeasureContexts.push_back (ctx);
+}
+
+void Screen::setAsyncGlyphs (bool enabled)
+{
+   if (enabled == asyncGlyphs())
+      return;
+   mGlyphWorker.reset (enabled ? new GlyphWorker (mNVGContext) : nullptr);
+   markDirty();
+}
+
+ImageLoader & Screen::imageLoader()
+{
+   if (!mImageLoader)
+      mImageLoader.reset (new ImageLoader (mNVGContext));
+   return *mImageLoader;
+}
+
+ImageManager & Screen::imageManager()
+{
+   if (!mImageManager)
+   {
+      mImageManager.reset (new ImageManager (imageLoader()));
+      mImageManager->setCallback ([this]() { markDirty(); });
+   }
+   return *mImageManager;
+}
+
+void Screen::setOffscreen (bool offscreen)
+{
+   /* The framebuffer would have to live on the render thread */
+   mOffscreen = offscreen && !mShared->threaded();
+   if (!mOffscreen && !mMultisampled && mFramebuffer)
+   {
+      nvgluDeleteFramebuffer (mFramebuffer);
+      mFramebuffer = nullptr;
+      mFramebufferSize = Vector2i::Zero();
+   }
+   markDirty();
+}
+
+void Screen::setRenderTarget (unsigned int fbo, int width, int height)
+{
+   /* The framebuffer is drawn on the thread of the host */
+   if (mShared->threaded() || width <= 0 || height <= 0)
+      fbo = 0;
+   Vector2i size = fbo ? Vector2i (width, height) : Vector2i::Zero();
+   if (fbo == mRenderTarget && size == mRenderTargetSize)
+      return;
+   mRenderTarget = fbo;
+   mRenderTargetSize = size;
+   mRenderTargetFresh = fbo != 0;
+   /* Our own framebuffers are made again at the size needed next */
+   if (mFramebuffer)
+   {
+      nvgluDeleteFramebuffer (mFramebuffer);
+      mFramebuffer = nullptr;
+      mFramebufferSize = Vector2i::Zero();
+   }
+   if (mMultisampleFramebuffer)
+   {
+      nvgluDeleteFramebuffer (mMultisampleFramebuffer);
+      mMultisampleFramebuffer = nullptr;
+   }
+   requestRedraw();
+}
+
+Vector2i Screen::renderTargetPosition (const Vector2f & uv) const
+{
+   if (!mRenderTarget)
+      return Vector2i ((int) std::floor (uv.x() * mSize.x()), (int) std::floor ((1.0f - uv.y()) * mSize.y()));
+   /* The widgets take up the top rows, which GL puts at the end of the texture */
+   return Vector2i ((int) std::floor (uv.x() * mRenderTargetSize.x() / mPixelRatio),
+                    (int) std::floor ((1.0f - uv.y()) * mRenderTargetSize.y() / mPixelRatio));
+}
+
+void Screen::setAntiAliasing (AntiAliasing mode, int samples)
+{
+   /* The framebuffers would have to live on the render thread */
+   mAntiAliasing = mShared->threaded() ? AntiAliasing::Fringes : mode;
+   mSamples = std::max (samples, 2);
+   mTrialFrame = 0;
+   for (int i = 0; i < 2; ++i)
+   {
+      mTrialCpu[i] = mTrialGpu[i] = 0.0;
+      mTrialCpuFrames[i] = mTrialGpuFrames[i] = 0;
+   }
+   /* Automatic starts out with fringes */
+   setMultisampled (mAntiAliasing == AntiAliasing::Multisample);
+   if (mMultisampleFramebuffer)
+   {
+      /* Recreated with the new sample count */
+      nvgluDeleteFramebuffer (mMultisampleFramebuffer);
+      mMultisampleFramebuffer = nullptr;
+   }
+}
+
+void Screen::setMultisampled (bool multisampled)
+{
+   mMultisampled = multisampled;
+   if (!mMultisampled && mMultisampleFramebuffer)
+   {
+      nvgluDeleteFramebuffer (mMultisampleFramebuffer);
+      mMultisampleFramebuffer = nullptr;
+   }
+   if (!mMultisampled && !mOffscreen && mFramebuffer)
+   {
+      nvgluDeleteFramebuffer (mFramebuffer);
+      mFramebuffer = nullptr;
+      mFramebufferSize = Vector2i::Zero();
+   }
+   markDirty();
+}
+
+bool Screen::antiAliasingTrial() const
+{
+   return mAntiAliasing == AntiAliasing::Automatic && mTrialFrame < 2 * AntiAliasingTrialFrames;
+}
+
+void Screen::measureAntiAliasing (double seconds)
+{
+   if (!antiAliasingTrial())
+      return;
+   int way = mTrialFrame / AntiAliasingTrialFrames;
+   if (mTrialFrame % AntiAliasingTrialFrames >= AntiAliasingWarmupFrames)
+   {
+      mTrialCpu[way] += seconds;
+      mTrialCpuFrames[way]++;
+   }
+   if (++mTrialFrame == AntiAliasingTrialFrames)
+      setMultisampled (true);
+   else if (mTrialFrame == 2 * AntiAliasingTrialFrames)
+   {
+      double cost[2];
+      for (int i = 0; i < 2; ++i)
+         cost[i] = mTrialCpu[i] / std::max (mTrialCpuFrames[i], 1) + mTrialGpu[i] / std::max (mTrialGpuFrames[i], 1);
+      setMultisampled (cost[1] < cost[0]);
+   }
+}
+
+void Screen::addGpuTime (double seconds)
+{
+   if (mFramePacer)
+      mFramePacer->addGpuTime (seconds);
+   /* Timer results arrive a few frames late, which the warmup frames absorb */
+   if (antiAliasingTrial() && mTrialFrame % AntiAliasingTrialFrames >= AntiAliasingWarmupFrames)
+   {
+      int way = mTrialFrame / AntiAliasingTrialFrames;
+      mTrialGpu[way] += seconds;
+      mTrialGpuFrames[way]++;
+   }
+   if (mFrameBudget > 0.0 && mGovernorFrames >= 0)
+      mGovernorGpu += seconds;
+}
+
+void Screen::setFrameBudget (double seconds)
+{
+   mFrameBudget = std::max (seconds, 0.0);
+   mGovernorFrames = 0;
+   mGovernorCpu = mGovernorGpu = 0.0;
+   if (mFrameBudget == 0.0)
+      setQuality (Quality::Full);
+}
+
+const char * Screen::qualityName (Quality quality)
+{
+   switch (quality)
+   {
+      case Quality::Full:
+         return "full quality";
+      case Quality::NoShadows:
+         return "no shadows";
+      case Quality::NoEdgeAA:
+         return "no edge AA";
+      case Quality::CoarseCurves:
+         return "coarse curves";
+      case Quality::CoarseGraphs:
+         return "coarse graphs";
+      case Quality::HalfRate:
+         return "half rate";
+   }
+   return "";
+}
+
+void Screen::governQuality (double seconds)
+{
+   if (mFrameBudget <= 0.0 || antiAliasingTrial())
+      return;
+   if (mGovernorFrames < 0)
+   {
+      /* GPU times of frames drawn before the step are still coming in */
+      ++mGovernorFrames;
+      mGovernorGpu = 0.0;
+      return;
+   }
+   mGovernorCpu += seconds;
+   if (++mGovernorFrames < GovernorWindowFrames)
+      return;
+   /* Per frame shown, so that skipped repaints count at half rate */
+   double cost = (mGovernorCpu + mGovernorGpu) / mGovernorFrames;
+   mGovernorFrames = 0;
+   mGovernorCpu = mGovernorGpu = 0.0;
+   bool keepsImage = mOffscreen || mMultisampled || mRedrawOnDemand || mRenderTarget;
+   Quality lowest = keepsImage ? Quality::HalfRate : Quality::CoarseGraphs;
+   if (mQuality > lowest)
+      setQuality (lowest);
+   else if (cost > mFrameBudget && mQuality < lowest)
+      setQuality ((Quality) ((int) mQuality + 1));
+   else if (cost < mFrameBudget * GovernorHeadroom && mQuality > Quality::Full)
+      setQuality ((Quality) ((int) mQuality - 1));
+}
+
+void Screen::setQuality (Quality quality)
+{
+   if (quality == mQuality)
+      return;
+   /* The tessellation settings belong to the context, whatever they were is restored on the way back */
+   bool coarse = quality >= Quality::CoarseCurves;
+   if (coarse != (mQuality >= Quality::CoarseCurves))
+   {
+      if (coarse)
+      {
+         nvgCurrentTessellation (mNVGContext, &mTessellationMode, &mTessellationTolerance);
+         nvgTessellationMode (mNVGContext, mTessellationMode, mTessellationTolerance * CoarseCurveTolerance);
+      }
+      else
+         nvgTessellationMode (mNVGContext, mTessellationMode, mTessellationTolerance);
+   }
+   mQuality = quality;
+   mSkipRepaint = false;
+   mGovernorFrames = -GovernorSettleFrames;
+   mGovernorCpu = mGovernorGpu = 0.0;
+   TRACE_COUNTER ("GUI quality", (int) quality);
+   /* Shadows and graph paths are recorded in the draw lists of the widgets */
+   markSubtreeDirty();
+   requestRedraw();
+}
+
+void Screen::setPixelRatio (float ratio)
+{
+   if (ratio <= 0.0f || ratio == mPixelRatio)
+      return;
+   mPixelRatio = ratio;
+   markDirty();
+}
+
+void Screen::prewarmGlyphs (const std::string & cacheFile, bool background)
+{
+   if (!mTheme || mGlyphBuilder)
+      return;
+   STARTUP_STEP ("glyph prewarm");
+   /* Load the fonts first, a cached atlas only restores the glyphs of fonts that exist */
+   int fonts[] = { nvgFindFont (mNVGContext, "sans"), nvgFindFont (mNVGContext, "sans-bold") };
+   int iconFont = nvgFindFont (mNVGContext, "icons");
+   if (!cacheFile.empty() && nvgLoadFontAtlas (mNVGContext, cacheFile.c_str()))
+      return;
+   mGlyphBuilder = nvgCreateGlyphBuilder (mNVGContext);
+   if (!mGlyphBuilder)
+      return;
+   /* The same ratio renderFrame() passes to nvgBeginFrame() */
+   float ratio = mPixelRatio;
+   std::vector<float> textSizes { (float)mTheme->mStandardFontSize, (float)mTheme->mButtonFontSize,
+                                  (float)mTheme->mTextBoxFontSize, 18.0f };
+   std::vector<float> iconSizes { mTheme->mButtonFontSize * 1.5f };
+   std::string text, icons;
+   for (char c = ' '; c <= '~'; ++c)
+      text += c;
+   for (int icon : { ENTYPO_ICON_CHECK, ENTYPO_ICON_CHEVRON_SMALL_RIGHT, ENTYPO_ICON_CHEVRON_SMALL_LEFT,
+                     ENTYPO_ICON_CIRCLED_INFO, ENTYPO_ICON_CIRCLED_HELP, ENTYPO_ICON_WARNING, ENTYPO_ICON_CIRCLED_CROSS })
+      icons += utf8 (icon).data();
+   NVGglyphBuilder * builder = mGlyphBuilder;
+   auto job = [=]()
+   {
+      for (int font : fonts)
+         nvgBuilderPrewarmGlyphs (builder, font, textSizes.data(), (int)textSizes.size(), ratio, text.c_str(), nullptr);
+      nvgBuilderPrewarmGlyphs (builder, iconFont, iconSizes.data(), (int)iconSizes.size(), ratio, icons.c_str(), nullptr);
+      if (!cacheFile.empty())
+         nvgBuilderSaveFontAtlas (builder, cacheFile.c_str());
+      mGlyphsReady = true;
+   };
+   if (background)
+      mGlyphThread = std::thread (job);
+   else
+   {
+      job();
+      installGlyphs();
+   }
+}
+
+void Screen::installGlyphs()
+{
+   if (!mGlyphsReady)
+      return;
+   if (mGlyphThread.joinable())
+      mGlyphThread.join();
+   nvgInstallGlyphBuilder (mNVGContext, mGlyphBuilder);
+   nvgDeleteGlyphBuilder (mGlyphBuilder);
+   mGlyphBuilder = nullptr;
+   mGlyphsReady = false;
+}
+
+void Screen::setProfileCallback (void (*callback) (void * userPtr, const char * name, int begin), void * userPtr)
+{
+   if (!mShared->threaded())
+      nvglSetProfileCallback (mNVGContext, callback, userPtr);
+}
+
+void Screen::drawWidgets()
+{
+   /* The profiler's frames run from one drawWidgets() to the next */
+   Profiler::instance().endFrame();
+   PROFILE_ZONE ("Screen::drawWidgets");
+   if (mInputRecorder)
+      mInputRecorder->frame();
+   bool paced = mFramePacer && mVisible && (!mRedrawOnDemand || mDragActive || needsRedraw());
+   if (paced)
+   {
+      double delay = mFramePacer->frameStart (elapsedTime().count());
+      if (delay > 0.0)
+      {
+         PROFILE_ZONE ("Screen::framePacing");
+         std::this_thread::sleep_for (std::chrono::duration<double> (delay));
+      }
+   }
+   double now = elapsedTime().count();
+   if (tasksPending() || animating() || nextTimer() <= now)
+      mLastActivity = now;
+   if (mIdleSeconds > 0.0)
+      updateIdle (now - mLastActivity >= mIdleSeconds);
+   mTimers->advance (now);
+   if (mAnimator)
+      mAnimator->update (now, mNVGContext);
+   for (size_t i = 0; i < mPolls.size();)
+   {
+      if (auto poll = mPolls[i].lock())
+      {
+         (*poll)();
+         ++i;
+      }
+      else
+         mPolls.erase (mPolls.begin() + i);
+   }
+   runTasks();
+   /* As late as possible, the polls and tasks may have taken a while */
+   sampleInput();
+   mFrameInputTime = -1.0;
+#ifdef NANOGUI_DRAW_INSPECTOR
+   /* The overlay spans the screen, partial repaints would leave parts of older ones behind */
+   if (DrawInspector::instance().enabled())
+   {
+      damageWidget (this);
+      requestRedraw();
+   }
+#endif
+   auto renderStart = std::chrono::steady_clock::now();
+   renderWidgets();
+   governQuality (std::chrono::duration<double> (std::chrono::steady_clock::now() - renderStart).count());
+#ifdef NANOGUI_DRAW_INSPECTOR
+   DrawInspector::instance().endFrame();
+#endif
+   /* Input that did not lead to a frame was drawn as it is now */
+   mInputTime = -1.0;
+   if (paced)
+      mFramePacer->frameEnd (elapsedTime().count());
+}
+
+void Screen::post (std::function<void()> task, TaskPriority priority)
+{
+   mTasks[(int)priority]->push (std::move (task));
+   mLastActivity = elapsedTime().count();
+   if (mWakeCallback)
+      mWakeCallback();
+}
+
+ref<AsyncOperation> Screen::runAsync (std::function<void (AsyncOperation &)> work,
+                                     std::function<void (AsyncOperation &)> done)
+{
+   ref<AsyncOperation> op = new AsyncOperation (this);
+   mAsyncOperations.push_back (op);
+   op->mThread = std::thread ([this, op, work, done]() mutable
+   {
+      try
+      {
+         work (*op);
+      }
+      catch (...)
+      {
+         op->mError = std::current_exception();
+      }
+      post ([this, op, done]() mutable
+      {
+         op->finish();
+         mAsyncOperations.erase (std::find (mAsyncOperations.begin(), mAsyncOperations.end(), op));
+         if (done)
+            done (*op);
+      });
+   });
+   return op;
+}
+
+double Screen::timeUntilRedraw()
+{
+   double now = elapsedTime().count();
+   /* A throttled repaint waits for its slot, but tasks still run on the next frame */
+   double slot = !tasksPending() ? mLastRepaint + repaintInterval() - now : 0.0;
+   if (mDirty || mMotionPending || tasksPending() || animating())
+      return std::max (0.0, slot);
+   return std::max (slot, std::min (mRedrawTime, nextTimer()) - now);
+}
+
+void Screen::setIdleThrottle (double idleSeconds, double idleRate)
+{
+   mIdleSeconds = std::max (idleSeconds, 0.0);
+   mIdleRate = std::max (idleRate, 0.01);
+   if (mIdleSeconds == 0.0)
+      updateIdle (false);
+}
+
+void Screen::noteActivity()
+{
+   mLastActivity = elapsedTime().count();
+   updateIdle (false);
+}
+
+void Screen::updateIdle (bool idle)
+{
+   if (idle == mIdle)
+      return;
+   mIdle = idle;
+   if (mIdleCallback)
+      mIdleCallback (idle);
+}
+
+bool Screen::throttleRepaint()
+{
+   return elapsedTime().count() - mLastRepaint < repaintInterval();
+}
+
+void Screen::setGuiRate (double hz)
+{
+   mGuiRate = std::max (hz, 0.0);
+   /* Frames between the repaints need the last image */
+   if (mGuiRate > 0.0)
+      setOffscreen (true);
+}
+
+uint64_t Screen::addTimer (double delay, const std::function<void()> & callback, double period)
+{
+   return mTimers->add (elapsedTime().count(), delay, callback, period);
+}
+
+void Screen::cancelTimer (uint64_t id)
+{
+   mTimers->cancel (id);
+}
+
+double Screen::nextTimer() const
+{
+   return mTimers->nextDeadline();
+}
+
+Animator & Screen::animator()
+{
+   if (!mAnimator)
+      mAnimator.reset (new Animator());
+   return *mAnimator;
+}
+
+bool Screen::animating() const
+{
+   return mAnimator && mAnimator->active();
+}
+
+bool Screen::tasksPending() const
+{
+   return !mTasks[0]->empty() || !mTasks[1]->empty();
+}
+
+void Screen::runTasks()
+{
+   if (!tasksPending())
+      return;
+   PROFILE_ZONE ("Screen::runTasks");
+   std::function<void()> task;
+   while (mTasks[(int)TaskPriority::Input]->pop (task))
+      task();
+   /* At least one bulk task per frame, so a budget smaller than any task still makes progress */
+   double deadline = elapsedTime().count() + mTaskBudget;
+   TaskQueue & bulk = *mTasks[(int)TaskPriority::Bulk];
+   if (bulk.pop (task))
+   {
+      task();
+      while (elapsedTime().count() < deadline && bulk.pop (task))
+         task();
+   }
+}
+
+void Screen::setFramePacing (bool enabled)
+{
+   if (enabled != framePacing())
+      mFramePacer.reset (enabled ? new FramePacer() : nullptr);
+}
+
+void Screen::sampleInput()
+{
+   Vector2i pos;
+   if (mInputSampler && mInputSampler (pos))
+   {
+      /* Positions arrive with the offset cursorPosCallbackEvent() removes */
+      const Vector2i & last = mMotionPending ? mPendingMotionPos : mMousePos;
+      if (pos - Vector2i (1, 2) != last)
+         cursorPosCallbackEvent (pos.x(), pos.y());
+   }
+   flushMotion();
+}
+
+void Screen::renderWidgets()
 {
-#ifdef NDEBUG
-   mNVGContext = nvgCreateGL3 (NVG_STENCIL_STROKES | NVG_ANTIALIAS);
-#else
-   mNVGContext = nvgCreateGL3 (NVG_STENCIL_STROKES | NVG_ANTIALIAS | NVG_DEBUG);
+   if (!mVisible)
+      return;
+   /* Captures in flight are mapped once their copy is done, which takes a frame or two */
+   if (mFrameCapture && mFrameCapture->poll())
+      requestRedraw (1.0 / 60.0);
+   /* A new window order repaints everything, which has to be known before the repaint is planned */
+   arrangeWindows();
+   /* At half rate every other frame shows the previous image again */
+   bool skip = false;
+   if (mQuality >= Quality::HalfRate)
+   {
+      mSkipRepaint = !mSkipRepaint;
+      skip = mSkipRepaint;
+   }
+   /* A throttled or rate limited repaint stays pending, needsRedraw() still reports it */
+   skip = skip || throttleRepaint();
+   if (mRenderTarget)
+   {
+      /* Scaled to fit, so that panels of the scene can have any resolution */
+      if (mSize.x() > 0 && mSize.y() > 0)
+         setPixelRatio (std::min ((float) mRenderTargetSize.x() / mSize.x(), (float) mRenderTargetSize.y() / mSize.y()));
+      mRenderTargetUpdated = (needsRedraw() && !skip) || mRenderTargetFresh;
+      if (mRenderTargetUpdated)
+         renderOffscreen();
+      if (mFrameCapture && mFrameCapture->wanted())
+         mFrameCapture->read (mRenderTarget, mRenderTargetSize.x(), mRenderTargetSize.y(), true, false);
+      return;
+   }
+   if (mOffscreen || mMultisampled || antiAliasingTrial())
+   {
+      /* Trial frames are all rendered, idle ones would not measure anything */
+      if (antiAliasingTrial())
+      {
+         auto start = std::chrono::steady_clock::now();
+         renderOffscreen();
+         measureAntiAliasing (std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count());
+      }
+      else if ((needsRedraw() && !skip) || mFramebufferSize != pixelSize())
+         renderOffscreen();
+      if (mFramebuffer && mFrameCapture && mFrameCapture->wanted())
+         mFrameCapture->read (mFramebuffer->fbo, mFramebufferSize.x(), mFramebufferSize.y(), true, false);
+      if (mFramebuffer)
+         compositeOffscreen();
+      return;
+   }
+   if (mRedrawOnDemand && (!needsRedraw() || skip))
+      return;
+   renderFrame();
+   if (mFrameCapture && mFrameCapture->wanted())
+   {
+      GLint fbo;
+      glGetIntegerv (GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+      Vector2i pixels = pixelSize();
+      mFrameCapture->read ((unsigned int)fbo, pixels.x(), pixels.y(), false, true);
+   }
+}
+
+bool Screen::captureFrame (const std::string & path, int maxWidth,
+                           const std::function<void (const std::vector<unsigned char> &, int, int)> & callback)
+{
+   if (mShared->threaded())
+      return false;
+   if (!mFrameCapture)
+      mFrameCapture.reset (new FrameCapture());
+   mFrameCapture->request (path, maxWidth, callback);
+   requestRedraw();
+   return true;
+}
+
+void Screen::renderFrame()
+{
+   /* Children that are not retained keep their flag; only the screen's own request is consumed */
+   mDirty = false;
+   mDamageAll = false;
+   mDamage.clear();
+   mRedrawTime = std::numeric_limits<double>::infinity();
+   mLastRepaint = elapsedTime().count();
+   mPaintedDragWindow = mDragActive && mDragWidget ? mDragWidget->window() : nullptr;
+   if (mPaintedDragWindow)
+      mPaintedDragPos = mPaintedDragWindow->absolutePosition();
+   mFrameInputTime = mInputTime;
+   installGlyphs();
+   if (mGlyphWorker)
+      mGlyphWorker->merge();
+   /* Callbacks of finished images update their widgets before they are drawn */
+   bool imagesPending = mImageLoader && mImageLoader->update (mImageUploadBudget);
+   if (!mShared->threaded())
+      nvglUseWindowState (mNVGContext, mWindowState);
+   /* Per frame, the screens sharing the context may differ */
+   nvgEdgeAntiAlias (mNVGContext, !mMultisampled && mQuality < Quality::NoEdgeAA);
+   nvgBeginFrame (mNVGContext, mSize[0], mSize[1], mPixelRatio);
+   arrangeWindows();
+   drawDamaged();
+#ifdef NANOGUI_DRAW_INSPECTOR
+   if (DrawInspector::instance().enabled())
+      DrawInspector::instance().drawOverlay (mNVGContext, (float)mSize.x(), (float)mSize.y());
 #endif
-   if (mNVGContext == nullptr)
-      throw std::runtime_error ("Could not initialize NanoVG!");
-   start = std::chrono::system_clock::now();
+   mFrameDamage.clear();
+   endFrame();
+   if (mImageManager)
+      mImageManager->endFrame();
+   /* Come back for the glyphs this frame left blank */
+   if ((mGlyphWorker && mGlyphWorker->submit()) || imagesPending)
+      requestRedraw (1.0 / 60.0);
+   nvgFrameStats (mNVGContext, &mFrameStats);
+   TRACE_COUNTER ("draw calls", mFrameStats.drawCalls);
+   TRACE_COUNTER ("GL draw calls", mFrameStats.glDrawCalls);
+   TRACE_COUNTER ("fill triangles", mFrameStats.fillTriCount);
+   TRACE_COUNTER ("stroke triangles", mFrameStats.strokeTriCount);
+   TRACE_COUNTER ("text triangles", mFrameStats.textTriCount);
+   TRACE_COUNTER ("vertex bytes", mFrameStats.vertexBytes);
+   TRACE_COUNTER ("uniform bytes", mFrameStats.uniformBytes);
+   if (mFrameStatsCallback)
+      mFrameStatsCallback (mFrameStats);
 }
 
-// dtor
-Screen::~Screen ()
+void Screen::renderOffscreen()
 {
-   if (mNVGContext)
-      nvgDeleteGL3 (mNVGContext);
+   if (mSize.x() <= 0 || mSize.y() <= 0)
+      return;
+   Vector2i pixels = pixelSize();
+   Vector2i extent = pixels;	// of the framebuffer drawn into
+   bool fresh = mFramebufferSize != pixels;
+   if (mRenderTarget)
+   {
+      /* The framebuffer of the host takes the place of ours, only a multisampled one is made here */
+      extent = mRenderTargetSize;
+      pixels = pixels.cwiseMin (extent);
+      fresh = mRenderTargetFresh;
+      mRenderTargetFresh = false;
+      if (mMultisampleFramebuffer && mFramebufferSize != extent)
+      {
+         nvgluDeleteFramebuffer (mMultisampleFramebuffer);
+         mMultisampleFramebuffer = nullptr;
+      }
+      mFramebufferSize = extent;
+   }
+   else if (mFramebufferSize != pixels)
+   {
+      if (mFramebuffer)
+         nvgluDeleteFramebuffer (mFramebuffer);
+      mFramebuffer = nvgluCreateFramebuffer (mNVGContext, pixels.x(), pixels.y(), 0);
+      mFramebufferSize = mFramebuffer ? pixels : Vector2i::Zero();
+      if (!mFramebuffer)
+      {
+         std::cerr << "Could not create the offscreen GUI framebuffer, drawing directly" << std::endl;
+         mOffscreen = false;
+         mAntiAliasing = AntiAliasing::Fringes;
+         mMultisampled = false;
+         renderFrame();
+         return;
+      }
+      if (mMultisampleFramebuffer)
+      {
+         nvgluDeleteFramebuffer (mMultisampleFramebuffer);
+         mMultisampleFramebuffer = nullptr;
+      }
+   }
+   if (mMultisampled && !mMultisampleFramebuffer)
+   {
+      mMultisampleFramebuffer = nvgluCreateMultisampleFramebuffer (mNVGContext, extent.x(), extent.y(), mSamples);
+      fresh = true;
+      if (!mMultisampleFramebuffer)
+      {
+         std::cerr << "Could not create the multisampled GUI framebuffer, anti-aliasing with fringes" << std::endl;
+         mAntiAliasing = AntiAliasing::Fringes;
+         mMultisampled = false;
+      }
+   }
+   /* Partial repaints build on the previous frame, which new framebuffers and timed redraws do not have */
+   mFrameDamage.clear();
+   if (mPartialRedraw && !fresh && !mDamageAll && !mDamage.empty() && !antiAliasingTrial() &&
+         elapsedTime().count() < mRedrawTime)
+   {
+      for (const Vector4i & r : mDamage)
+      {
+         Vector4i px ((int) std::floor (r[0] * mPixelRatio), (int) std::floor (r[1] * mPixelRatio),
+                      (int) std::ceil (r[2] * mPixelRatio), (int) std::ceil (r[3] * mPixelRatio));
+         mFrameDamage.push_back (px.cwiseMax (Vector4i::Zero()).cwiseMin (Vector4i (pixels.x(), pixels.y(), pixels.x(), pixels.y())));
+      }
+   }
+   /* Flashes are drawn when compositing, which a render target is not */
+   if (mShowDamage && !mRenderTarget)
+   {
+      double now = elapsedTime().count();
+      if (mFrameDamage.empty())
+         mDamageFlashes.push_back ({ Vector4i (0, 0, pixels.x(), pixels.y()), now });
+      for (const Vector4i & r : mFrameDamage)
+         mDamageFlashes.push_back ({ r, now });
+   }
+   GLint prevFramebuffer, prevViewport[4];
+   glGetIntegerv (GL_FRAMEBUFFER_BINDING, &prevFramebuffer);
+   glGetIntegerv (GL_VIEWPORT, prevViewport);
+   NVGLUframebuffer target = { mNVGContext, mRenderTarget, 0, 0, 0, 0 };
+   NVGLUframebuffer * resolved = mRenderTarget ? &target : mFramebuffer;
+   glBindFramebuffer (GL_FRAMEBUFFER, mMultisampleFramebuffer ? mMultisampleFramebuffer->fbo : resolved->fbo);
+   /* GL counts rows from the bottom, the widgets go to the top of a render target with another aspect */
+   glViewport (0, extent.y() - pixels.y(), pixels.x(), pixels.y());
+   glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+   glClearStencil (0);
+   if (mFrameDamage.empty())
+      glClear (GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+   else
+   {
+      glEnable (GL_SCISSOR_TEST);
+      for (const Vector4i & r : mFrameDamage)
+      {
+         glScissor (r[0], extent.y() - r[3], r[2] - r[0], r[3] - r[1]);
+         glClear (GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+      }
+      glDisable (GL_SCISSOR_TEST);
+   }
+   renderFrame();
+   if (mMultisampleFramebuffer)
+      nvgluResolveFramebuffer (mMultisampleFramebuffer, resolved, extent.x(), extent.y());
+   glBindFramebuffer (GL_FRAMEBUFFER, prevFramebuffer);
+   glViewport (prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
 }
 
-void Screen::drawWidgets()
+/* Damage beyond this many rectangles is merged into one, and beyond half of the screen repaints all of it */
+static const size_t MaxDamageRects = 8;
+static const double DamageFlashSeconds = 0.3;
+/* Hover time before a tooltip shows, and the width its text wraps at */
+static const double TooltipDelay = 0.5;
+static const int DragDropThreshold = 4;
+static const float TooltipWidth = 150.0f;
+
+void Screen::addDamage (const Vector2i & pos, const Vector2i & size)
 {
-   if (!mVisible)
+   if (!mPartialRedraw || mDamageAll)
+      return;
+   Vector4i rect (std::max (pos.x(), 0), std::max (pos.y(), 0),
+                  std::min (pos.x() + size.x(), mSize.x()), std::min (pos.y() + size.y(), mSize.y()));
+   if (rect[0] >= rect[2] || rect[1] >= rect[3])
+      return;
+   /* Rectangles that nearly touch become one, which may then touch others */
+   const int slack = 8;
+   for (size_t i = 0; i < mDamage.size();)
+   {
+      const Vector4i & r = mDamage[i];
+      if (rect[0] > r[2] + slack || r[0] > rect[2] + slack || rect[1] > r[3] + slack || r[1] > rect[3] + slack)
+      {
+         ++i;
+         continue;
+      }
+      rect = Vector4i (std::min (rect[0], r[0]), std::min (rect[1], r[1]), std::max (rect[2], r[2]), std::max (rect[3], r[3]));
+      mDamage.erase (mDamage.begin() + i);
+      i = 0;
+   }
+   mDamage.push_back (rect);
+   if (mDamage.size() > MaxDamageRects)
+   {
+      for (const Vector4i & r : mDamage)
+         rect = Vector4i (std::min (rect[0], r[0]), std::min (rect[1], r[1]), std::max (rect[2], r[2]), std::max (rect[3], r[3]));
+      mDamage.assign (1, rect);
+   }
+   long area = 0;
+   for (const Vector4i & r : mDamage)
+      area += (long) (r[2] - r[0]) * (r[3] - r[1]);
+   if (2 * area > (long) mSize.x() * mSize.y())
+   {
+      mDamageAll = true;
+      mDamage.clear();
+   }
+}
+
+void Screen::damageWidget (const Widget * widget)
+{
+   if (mParallelLayout)
+      return;
+   if (widget == this)
+   {
+      invalidateBackdrops (this, Vector2i::Zero(), mSize);
+      mDamageAll = true;
+      mDamage.clear();
+      return;
+   }
+   /* Scrolled content is not drawn at its position, the outermost scroll panel covers it */
+   for (const Widget * w = widget->parent(); w && w != this; w = w->parent())
+      if (w->isScroll())
+         widget = w;
+   /* Fringes and focus rings reach a little outside, windows cast a shadow and popups point at their anchor */
+   int margin = 2;
+   if (widget->isWindow() && widget->theme())
+      margin += std::max (widget->theme()->mWindowDropShadowSize, widget->isPopup() ? 15 : 0);
+   Vector2i pos = widget->absolutePosition() - Vector2i::Constant (margin), size = widget->size() + Vector2i::Constant (2 * margin);
+   /* Also without partial repaints, which only decide how much of the frame is drawn */
+   invalidateBackdrops (widget, pos, size);
+   if (!mPartialRedraw || mDamageAll)
+      return;
+   addDamage (pos, size);
+}
+
+void Screen::invalidateBackdrops (const Widget * widget, const Vector2i & pos, const Vector2i & size)
+{
+   /* Windows are drawn in the order of the children, those before the one of the widget lie behind it */
+   const Widget * top = widget;
+   while (top != this && top->parent() != this)
+      top = top->parent();
+   bool behind = top == this;
+   for (Widget * child : mChildren)
+   {
+      if (child == top)
+      {
+         behind = true;
+         continue;
+      }
+      if (!behind || !child->isWindow())
+         continue;
+      Window * window = (Window *) child;
+      if (!window->mBackdropValid)
+         continue;
+      Vector2i p = window->absolutePosition();
+      if (p.x() >= pos.x() + size.x() || pos.x() >= p.x() + window->width() ||
+            p.y() >= pos.y() + size.y() || pos.y() >= p.y() + window->height())
+         continue;
+      /* Marks the window dirty, which goes on with the windows in front of it */
+      window->invalidateBackdrop();
+   }
+}
+
+Widget * Screen::findWidget (const Vector2i & p)
+{
+   if (!mGeometry.current())
+      mGeometry.rebuild (this);
+   return mGeometry.find (p);
+}
+
+void Screen::drawDamaged()
+{
+   /* Windows recorded here are replayed by draw() in their order among the children */
+   recordWindows (mNVGContext);
+   if (mFrameDamage.empty())
+   {
+      draw (mNVGContext);
+      drawTooltip();
+      drawDragPreview();
+   }
+   else
+   {
+      /* The rectangles are whole framebuffer pixels, so the scissor covers exactly what was cleared */
+      for (const Vector4i & r : mFrameDamage)
+      {
+         nvgSave (mNVGContext);
+         nvgScissor (mNVGContext, r[0] / mPixelRatio, r[1] / mPixelRatio,
+                     (r[2] - r[0]) / mPixelRatio, (r[3] - r[1]) / mPixelRatio);
+         draw (mNVGContext);
+         drawTooltip();
+         drawDragPreview();
+         nvgRestore (mNVGContext);
+      }
+   }
+   for (auto window : mDrawWindows)
+      window->extras().frameRecorded = false;
+   mDrawWindows.clear();
+}
+
+void Screen::updateTooltip (Widget * widget)
+{
+   /* The tooltip of the nearest widget that has one */
+   while (widget && widget != this && widget->tooltip().empty())
+      widget = widget->parent();
+   if (widget == this)
+      widget = nullptr;
+   if (widget == mTooltipWidget.get())
+      return;
+   hideTooltip();
+   cancelTimer (mTooltipTimer);
+   mTooltipTimer = 0;
+   mTooltipWidget = widget;
+   if (widget)
+      mTooltipTimer = addTimer (TooltipDelay, [this]()
+   {
+      mTooltipTimer = 0;
+      showTooltip();
+   });
+}
+
+void Screen::showTooltip()
+{
+   Widget * widget = mTooltipWidget.get();
+   if (!widget || !widget->visibleRecursive() || !mTheme)
+      return;
+   float bounds[4];
+   nvgSave (mNVGContext);
+   nvgFontFaceId (mNVGContext, mTheme->mFontNormal.id (mNVGContext));
+   nvgFontSize (mNVGContext, 15.0f);
+   nvgTextAlign (mNVGContext, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+   nvgTextLineHeight (mNVGContext, 1.1f);
+   nvgTextBoxBounds (mNVGContext, 0, 0, TooltipWidth, widget->tooltip().c_str(), nullptr, bounds);
+   nvgRestore (mNVGContext);
+   mTooltipSize = Vector2i ((int) std::ceil (bounds[2] - bounds[0]) + 8, (int) std::ceil (bounds[3] - bounds[1]) + 8);
+   mTooltipPos = widget->absolutePosition() + Vector2i (widget->width() / 2 - mTooltipSize.x() / 2, widget->height() + 10);
+   mTooltipPos.x() = std::max (0, std::min (mTooltipPos.x(), mSize.x() - mTooltipSize.x()));
+   mTooltipVisible = true;
+   addDamage (mTooltipPos - Vector2i (0, 10), mTooltipSize + Vector2i (0, 10));
+   mDirty = true;
+}
+
+void Screen::hideTooltip()
+{
+   if (!mTooltipVisible)
+      return;
+   mTooltipVisible = false;
+   addDamage (mTooltipPos - Vector2i (0, 10), mTooltipSize + Vector2i (0, 10));
+   mDirty = true;
+}
+
+void Screen::drawTooltip()
+{
+   if (!mTooltipVisible || !mTooltipWidget)
+      return;
+   NVGcontext * ctx = mNVGContext;
+   const Vector2i & pos = mTooltipPos;
+   nvgSave (ctx);
+   nvgGlobalAlpha (ctx, 0.8f);
+   nvgBeginPath (ctx);
+   nvgFillColor (ctx, Color (0, 255));
+   nvgRoundedRect (ctx, pos.x(), pos.y(), mTooltipSize.x(), mTooltipSize.y(), 3);
+   /* The arrow points at the middle of the widget, which may be off the middle of a box pushed into the screen */
+   float px = std::max (pos.x() + 8.0f, std::min (mTooltipWidget->absolutePosition().x() + mTooltipWidget->width() * 0.5f,
+                                                  pos.x() + mTooltipSize.x() - 8.0f));
+   nvgMoveTo (ctx, px, pos.y() - 6);
+   nvgLineTo (ctx, px + 7, pos.y() + 1);
+   nvgLineTo (ctx, px - 7, pos.y() + 1);
+   nvgFill (ctx);
+   nvgFillColor (ctx, Color (255, 255));
+   nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
+   nvgFontSize (ctx, 15.0f);
+   nvgFontBlur (ctx, 0.0f);
+   nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+   nvgTextLineHeight (ctx, 1.1f);
+   nvgTextBox (ctx, pos.x() + 4, pos.y() + 4, TooltipWidth, mTooltipWidget->tooltip().c_str(), nullptr);
+   nvgRestore (ctx);
+}
+
+void Screen::compositeOffscreen()
+{
+   nvglUseWindowState (mNVGContext, mWindowState);
+   nvgEdgeAntiAlias (mNVGContext, 1);
+   nvgBeginFrame (mNVGContext, mSize[0], mSize[1], mPixelRatio);
+   /* One framebuffer pixel per device pixel, stretched over the screen in window units */
+   NVGpaint paint = nvgImagePattern (mNVGContext, 0, 0, mSize.x(), mSize.y(), 0, mFramebuffer->image, 1.0f);
+   nvgBeginPath (mNVGContext);
+   nvgRect (mNVGContext, 0, 0, mSize.x(), mSize.y());
+   nvgFillPaint (mNVGContext, paint);
+   nvgFill (mNVGContext);
+   /* Until the next repaint a dragged window is cut from the last image and drawn where it is now */
+   Window * dragged = mDragActive && mDragWidget ? mDragWidget->window() : nullptr;
+   if (dragged && dragged == mPaintedDragWindow)
+   {
+      Vector2i pos = dragged->absolutePosition(), delta = pos - mPaintedDragPos;
+      if (delta != Vector2i::Zero())
+      {
+         NVGpaint moved = nvgImagePattern (mNVGContext, delta.x(), delta.y(), mSize.x(), mSize.y(), 0,
+                                           mFramebuffer->image, 1.0f);
+         nvgBeginPath (mNVGContext);
+         nvgRect (mNVGContext, pos.x(), pos.y(), dragged->width(), dragged->height());
+         nvgFillPaint (mNVGContext, moved);
+         nvgFill (mNVGContext);
+      }
+   }
+   if (mOverlayCallback)
+      mOverlayCallback (mNVGContext);
+   if (mShowDamage)
+   {
+      double now = elapsedTime().count();
+      size_t kept = 0;
+      for (const DamageFlash & flash : mDamageFlashes)
+      {
+         double age = now - flash.time;
+         if (age >= DamageFlashSeconds)
+            continue;
+         const Vector4i & r = flash.rect;
+         nvgBeginPath (mNVGContext);
+         nvgRect (mNVGContext, r[0] / mPixelRatio, r[1] / mPixelRatio,
+                  (r[2] - r[0]) / mPixelRatio, (r[3] - r[1]) / mPixelRatio);
+         nvgFillColor (mNVGContext, nvgRGBAf (1.0f, 0.0f, 0.0f, (float) (0.4 * (1.0 - age / DamageFlashSeconds))));
+         nvgFill (mNVGContext);
+         mDamageFlashes[kept++] = flash;
+      }
+      mDamageFlashes.resize (kept);
+   }
+   endFrame();
+}
+
+/* The part of the state NanoVG sets that Cinder caches, the rest NanoVG sets on its first flush */
+static void readCinderGlState (NVGglState & state)
+{
+   ci::gl::Context * ctx = ci::gl::context();
+   const ci::gl::GlslProg * prog = ctx->getGlslProg();
+   ci::gl::Vao * vao = ctx->getVao();
+   state.known = NVG_GL_PROGRAM | NVG_GL_VERTEX_ARRAY | NVG_GL_ACTIVE_TEXTURE | NVG_GL_TEXTURE | NVG_GL_BLEND |
+                 NVG_GL_CULL_FACE | NVG_GL_DEPTH_TEST | NVG_GL_SCISSOR_TEST | NVG_GL_STENCIL_TEST;
+   state.program = prog != nullptr ? prog->getHandle() : 0;
+   state.vertexArray = vao != nullptr ? vao->getId() : 0;
+   state.activeTexture = GL_TEXTURE0 + ctx->getActiveTexture();
+   state.texture = ctx->getTextureBinding (GL_TEXTURE_2D, 0);
+   state.blend = ctx->getBoolState (GL_BLEND);
+   state.cullFaceEnabled = ctx->getBoolState (GL_CULL_FACE);
+   state.depthTest = ctx->getBoolState (GL_DEPTH_TEST);
+   state.scissorTest = ctx->getBoolState (GL_SCISSOR_TEST);
+   state.stencilTest = ctx->getBoolState (GL_STENCIL_TEST);
+}
+
+static void setCap (GLenum cap, GLboolean on)
+{
+   if (on)
+      glEnable (cap);
+   else
+      glDisable (cap);
+}
+
+/* Puts back what NanoVG left different from Cinder's cache, so that the cache stays true */
+static void restoreCinderGlState (const NVGglState & state)
+{
+   NVGglState cinder;
+   readCinderGlState (cinder);
+   if (state.program != cinder.program)
+      glUseProgram (cinder.program);
+   if (state.vertexArray != cinder.vertexArray)
+      glBindVertexArray (cinder.vertexArray);
+   if (state.texture != cinder.texture)
+   {
+      /* NanoVG binds its images to unit 0 */
+      if (state.activeTexture != GL_TEXTURE0)
+         glActiveTexture (GL_TEXTURE0);
+      glBindTexture (GL_TEXTURE_2D, cinder.texture);
+      if (cinder.activeTexture != GL_TEXTURE0)
+         glActiveTexture (cinder.activeTexture);
+   }
+   else if (state.activeTexture != cinder.activeTexture)
+      glActiveTexture (cinder.activeTexture);
+   if (state.blend != cinder.blend)
+      setCap (GL_BLEND, cinder.blend);
+   if (state.cullFaceEnabled != cinder.cullFaceEnabled)
+      setCap (GL_CULL_FACE, cinder.cullFaceEnabled);
+   if (state.depthTest != cinder.depthTest)
+      setCap (GL_DEPTH_TEST, cinder.depthTest);
+   if (state.scissorTest != cinder.scissorTest)
+      setCap (GL_SCISSOR_TEST, cinder.scissorTest);
+   if (state.stencilTest != cinder.stencilTest)
+      setCap (GL_STENCIL_TEST, cinder.stencilTest);
+}
+
+void Screen::endFrame()
+{
+   /* With a render thread the frame is only handed over, GL is not touched here */
+   if (mShared->threaded())
+   {
+      nvgEndFrame (mNVGContext);
       return;
-   float aspect = (float)mSize[0] / (float)mSize[1];
-   nvgBeginFrame (mNVGContext, mSize[0], mSize[1], aspect);
-   draw (mNVGContext);
-   // work around for Cinder not rendering after nanovg
-   ci::gl::ScopedGlslProg scopedProg (nullptr);
-   ci::gl::ScopedVao scopedVao (nullptr);
-   ci::gl::ScopedTextureBind text (GL_TEXTURE_2D, 0);
-   //ci::gl::ScopedDepth depth(false, false);  // FIXME causes GL errors
+   }
+   /* NanoVG starts from Cinder's state and only sets what differs, then whatever it left
+      different is put back once, instead of saving and restoring around it */
+   readCinderGlState (*mGlState);
+   nvglShareState (mNVGContext, mGlState.get());
    nvgEndFrame (mNVGContext);
+   nvglShareState (mNVGContext, nullptr);
+   restoreCinderGlState (*mGlState);
 }
 
-bool Screen::cursorPosCallbackEvent (double x, double y)
+bool Screen::cursorPosCallbackEvent (double x, double y, float pressure)
 {
    auto end = std::chrono::system_clock::now();
    Vector2i p ((int)x, (int)y);
-   bool ret = false;
+   if (mInputRecorder)
+      mInputRecorder->cursorPos (p.x(), p.y());
    mLastInteraction = end - start;
+   if (mInputTime < 0.0)
+      mInputTime = mLastInteraction.count();
+   noteActivity();
+   p -= Vector2i (1, 2);
+   if (mCoalesceMotion)
+   {
+      /* The relative motion is taken against the last dispatched position, so it accumulates */
+      mPendingMotionPos = p;
+      mMotionPending = true;
+      if (mDragActive)
+         mPendingSamples.push_back (PointerSample { p, mLastInteraction.count(), pressure });
+      return false;
+   }
+   return dispatchMotion (p);
+}
+
+bool Screen::flushMotion()
+{
+   if (!mMotionPending)
+      return false;
+   mMotionPending = false;
+   std::vector<PointerSample> samples;
+   samples.swap (mPendingSamples);
+   return dispatchMotion (mPendingMotionPos, &samples);
+}
+
+bool Screen::dispatchMotion (const Vector2i & p, const std::vector<PointerSample> * samples)
+{
+   PROFILE_ZONE ("Screen::cursorPosCallbackEvent");
+   arrangeWindows();
+   bool ret = false;
    try
    {
-      p -= Vector2i (1, 2);
       if (!mDragActive)
       {
          Widget * const widget = findWidget (p);
+         updateTooltip (widget);
          // No cursor support in Cinder?????
          //if (widget != nullptr && widget->cursor() != mCursor)
          //{
@@ -78,10 +1474,33 @@ bool Screen::cursorPosCallbackEvent (double x, double y)
          //}
       }
       else
+         if (mDragDrop)
+         {
+            moveDragDrop (p);
+            mMousePos = p;
+            return true;
+         }
+         else
       {
-         ret = mDragWidget->mouseDragEvent (p - mDragWidget->parent()->absolutePosition(),
-                                            p - mMousePos,
-                                            mMouseState, mModifiers);
+         /* Dragging a window only moves it, its contents stay as they are */
+         if (!mDragWidget->isWindow())
+            mDragWidget->markDirty();
+         Vector2i offset = mDragWidget->parent()->absolutePosition();
+         if (samples && !samples->empty())
+         {
+            std::vector<PointerSample> local (*samples);
+            for (PointerSample & sample : local)
+               sample.pos -= offset;
+            ret = mDragWidget->mouseDragSamplesEvent (local, p - mMousePos, mMouseState, mModifiers);
+         }
+         else
+            ret = mDragWidget->mouseDragEvent (p - offset, p - mMousePos, mMouseState, mModifiers);
+         /* A press the widget did not take and that moved far enough may start dragging a payload */
+         if (!ret && (p - mPressPos).cwiseAbs().maxCoeff() >= DragDropThreshold && startDragDrop (p))
+         {
+            mMousePos = p;
+            return true;
+         }
       }
       if (!ret)
          ret = mouseMotionEvent (p, p - mMousePos, mMouseState, mModifiers);
@@ -95,38 +1514,243 @@ bool Screen::cursorPosCallbackEvent (double x, double y)
    return false;
 }
 
+/* Position of the parent of \c widget, mouse events get theirs relative to it */
+static Vector2i parentOffset (const Widget * widget)
+{
+   return widget->parent() ? widget->parent()->absolutePosition() : Vector2i (0, 0);
+}
+
+bool Screen::startDragDrop (const Vector2i & p)
+{
+   for (Widget * widget = mDragWidget; widget && widget != this; widget = widget->parent())
+   {
+      const DragSource & source = widget->dragSource();
+      if (!source)
+         continue;
+      std::unique_ptr<DragDrop> drag (new DragDrop());
+      DragPayload & payload = drag->payload;
+      if (!source (mPressPos - parentOffset (widget), payload))
+         return false;
+      if (payload.previewImage)
+      {
+         drag->previewSize = payload.previewSize;
+         drag->grab = payload.previewSize / 2;
+      }
+      else
+         if (payload.previewWidget)
+         {
+            drag->previewSize = payload.previewWidget->size();
+            drag->grab = mPressPos - payload.previewWidget->absolutePosition();
+         }
+         else
+            drag->previewSize = drag->grab = Vector2i (0, 0);
+      drag->pos = p;
+      mDragDrop = std::move (drag);
+      updateTooltip (nullptr);
+      moveDragDrop (p);
+      return true;
+   }
+   return false;
+}
+
+void Screen::moveDragDrop (const Vector2i & p)
+{
+   damageDragDrop (false);
+   mDragDrop->pos = p;
+   /* The target is the first widget accepting the payload, going up from the one the spatial index finds under the cursor */
+   Widget * target = nullptr;
+   for (Widget * widget = findWidget (p); widget; widget = widget->parent())
+   {
+      const DropTarget & drop = widget->dropTarget();
+      if (drop.accepts && drop.accepts (mDragDrop->payload, p - parentOffset (widget)))
+      {
+         target = widget;
+         break;
+      }
+   }
+   if (target != mDragDrop->target.get())
+   {
+      damageDragDrop (true);
+      mDragDrop->target = target;
+   }
+   damageDragDrop (target != nullptr);
+}
+
+void Screen::endDragDrop()
+{
+   damageDragDrop (true);
+   std::unique_ptr<DragDrop> drag (std::move (mDragDrop));
+   ref<Widget> target = drag->target;
+   if (!target)
+      return;
+   Vector2i p = drag->pos - parentOffset (target);
+   /* Only now is the data produced; the preview is not needed any more */
+   std::shared_ptr<DragPayload> payload = std::make_shared<DragPayload> (std::move (drag->payload));
+   payload->previewWidget = nullptr;
+   if (payload->async && payload->provider)
+   {
+      std::shared_ptr<DragData> data = std::make_shared<DragData>();
+      runAsync ([payload, data] (AsyncOperation &)
+      {
+         *data = payload->provider();
+      },
+      [this, payload, data, target, p] (AsyncOperation & op) mutable
+      {
+         /* The target may have been removed while the data was produced */
+         const DropTarget & drop = target->dropTarget();
+         if (target->screen() == this && drop.drop)
+            drop.drop (*payload, op.error() ? nullptr : *data, p);
+      });
+      return;
+   }
+   DragData data;
+   if (payload->provider)
+   {
+      try
+      {
+         data = payload->provider();
+      }
+      catch (const std::exception & e)
+      {
+         std::cerr << "Caught exception in drag provider: " << e.what() << std::endl;
+      }
+   }
+   const DropTarget & drop = target->dropTarget();
+   if (drop.drop)
+      drop.drop (*payload, std::move (data), p);
+}
+
+void Screen::cancelDragDrop()
+{
+   if (!mDragDrop)
+      return;
+   damageDragDrop (true);
+   mDragDrop.reset();
+   /* The press is over, the cursor only hovers until the next one */
+   mDragActive = false;
+   mDragWidget = nullptr;
+}
+
+void Screen::damageDragDrop (bool target)
+{
+   const DragDrop & drag = *mDragDrop;
+   addDamage (drag.pos - drag.grab - Vector2i (1, 1), drag.previewSize + Vector2i (2, 2));
+   if (target && drag.target)
+      addDamage (drag.target->absolutePosition() - Vector2i (2, 2), drag.target->size() + Vector2i (4, 4));
+   mDirty = true;
+}
+
+void Screen::drawDragPreview()
+{
+   if (!mDragDrop)
+      return;
+   NVGcontext * ctx = mNVGContext;
+   DragDrop & drag = *mDragDrop;
+   const DragPayload & payload = drag.payload;
+   nvgSave (ctx);
+   if (drag.target)
+   {
+      Vector2i pos = drag.target->absolutePosition();
+      nvgBeginPath (ctx);
+      nvgRoundedRect (ctx, pos.x() - 0.5f, pos.y() - 0.5f, drag.target->width() + 1.0f, drag.target->height() + 1.0f, 2.0f);
+      nvgStrokeWidth (ctx, 2.0f);
+      nvgStrokeColor (ctx, Color (255, 180));
+      nvgStroke (ctx);
+   }
+   Vector2i origin = drag.pos - drag.grab;
+   nvgGlobalAlpha (ctx, 0.7f);
+   if (payload.previewImage)
+   {
+      NVGpaint paint = nvgImagePattern (ctx, origin.x(), origin.y(), drag.previewSize.x(), drag.previewSize.y(), 0, payload.previewImage, 1.0f);
+      nvgBeginPath (ctx);
+      nvgRect (ctx, origin.x(), origin.y(), drag.previewSize.x(), drag.previewSize.y());
+      nvgFillPaint (ctx, paint);
+      nvgFill (ctx);
+   }
+   else
+      if (payload.previewWidget)
+      {
+         /* Recorded once without a scissor, then replayed at the cursor, clipped to whatever damage is drawn */
+         Widget * widget = drag.payload.previewWidget;
+         nvgTranslate (ctx, origin.x() - widget->position().x(), origin.y() - widget->position().y());
+         if (!drag.recorded || !nvgDrawList (ctx, mDragPreview))
+         {
+            if (!mDragPreview)
+               mDragPreview = nvgCreateDrawList();
+            nvgSave (ctx);
+            nvgResetScissor (ctx);
+            nvgRecordDrawList (ctx, mDragPreview);
+            widget->draw (ctx);
+            nvgEndDrawList (ctx);
+            nvgRestore (ctx);
+            drag.recorded = true;
+            /* The recording fails when draw lists are nested too deeply */
+            if (!nvgDrawList (ctx, mDragPreview))
+               widget->draw (ctx);
+         }
+      }
+   nvgRestore (ctx);
+}
+
 bool Screen::mouseButtonCallbackEvent (int button, int action, int modifiers)
 {
+   if (mInputRecorder)
+      mInputRecorder->mouseButton (button, action, modifiers);
+   flushMotion();
+   PROFILE_ZONE ("Screen::mouseButtonCallbackEvent");
+   arrangeWindows();
    auto end = std::chrono::system_clock::now();
    mModifiers = modifiers;
    mLastInteraction = end - start;
+   if (mInputTime < 0.0)
+      mInputTime = mLastInteraction.count();
+   noteActivity();
    try
    {
       if (mFocusPath.size() > 1)
       {
-         const Window * window =
-            dynamic_cast<Window *> (mFocusPath[mFocusPath.size() - 2]);
+         const Widget * w = mFocusPath[mFocusPath.size() - 2];
+         const Window * window = w->isWindow() ? (const Window *) w : nullptr;
          if (window && window->modal())
          {
             if (!window->contains (mMousePos))
                return false;
          }
       }
+      updateTooltip (nullptr);
       if (action == PRESS)
          mMouseState |= 1 << button;
       else
          mMouseState &= ~ (1 << button);
+      if (mDragDrop)
+      {
+         /* Releasing the left button drops the payload, any other button cancels the drag */
+         if (button == MOUSE_BUTTON_LEFT && action != PRESS)
+            endDragDrop();
+         else
+            cancelDragDrop();
+         mDragActive = false;
+         mDragWidget = nullptr;
+         return true;
+      }
       if (action == PRESS && button == MOUSE_BUTTON_LEFT)
       {
+         mPressPos = mMousePos;
          mDragWidget = findWidget (mMousePos);
          if (mDragWidget == this)
             mDragWidget = nullptr;
          mDragActive = mDragWidget != nullptr;
          if (!mDragActive)
             updateFocus (nullptr);
+         /* Widgets update their pressed state directly in the event handlers */
+         if (mDragWidget)
+            mDragWidget->markDirty();
       }
       else
       {
+         /* The widget found by the press is the one to release, without searching again */
+         if (mDragWidget)
+            mDragWidget->markDirty();
          mDragActive = false;
          mDragWidget = nullptr;
       }
@@ -142,10 +1766,24 @@ bool Screen::mouseButtonCallbackEvent (int button, int action, int modifiers)
 
 bool Screen::keyCallbackEvent (int key, int scancode, int action, int mods)
 {
+   if (mInputRecorder)
+      mInputRecorder->key (key, scancode, action, mods);
+   flushMotion();
+   PROFILE_ZONE ("Screen::keyCallbackEvent");
    auto end = std::chrono::system_clock::now();
    mLastInteraction = end - start;
+   if (mInputTime < 0.0)
+      mInputTime = mLastInteraction.count();
+   noteActivity();
+   if (mDragDrop && key == KEY_ESCAPE && action == PRESS)
+   {
+      cancelDragDrop();
+      return true;
+   }
    try
    {
+      if (!mFocusPath.empty())
+         mFocusPath.front()->markDirty();
       return keyboardEvent (key, scancode, action, mods);
    }
    catch (const std::exception & e)
@@ -179,10 +1817,19 @@ bool Screen::keyboardCharacterEvent (unsigned int codepoint)
 
 bool Screen::charCallbackEvent (unsigned int codepoint)
 {
+   if (mInputRecorder)
+      mInputRecorder->character (codepoint);
+   flushMotion();
+   PROFILE_ZONE ("Screen::charCallbackEvent");
    auto end = std::chrono::system_clock::now();
    mLastInteraction = end - start;
+   if (mInputTime < 0.0)
+      mInputTime = mLastInteraction.count();
+   noteActivity();
    try
    {
+      if (!mFocusPath.empty())
+         mFocusPath.front()->markDirty();
       return keyboardCharacterEvent (codepoint);
    }
    catch (const std::exception & e)
@@ -206,7 +1853,7 @@ void Screen::updateFocus (Widget * widget)
    while (widget)
    {
       mFocusPath.push_back (widget);
-      if (dynamic_cast<Window *> (widget))
+      if (widget->isWindow())
          window = widget;
       widget = widget->parent();
    }
@@ -218,13 +1865,112 @@ void Screen::updateFocus (Widget * widget)
 
 void Screen::moveWindowToFront (Window * window)
 {
+   /* Only the stacking order changes here, the children are sorted by arrangeWindows() once no
+      event walks them anymore. Popups raise the windows they belong to first */
+   Window * chain[16];
+   int n = 0;
+   for (Window * w = window; w && n < 16; w = w->isPopup() ? ((Popup *) w)->parentWindow() : nullptr)
+      chain[n++] = w;
+   while (n > 0)
+      chain[--n]->mStackOrder = ++Window::sStackOrder;
+   markDirty();
+}
+
+WidgetSearch & Screen::searchIndex()
+{
+   if (!mSearch)
+   {
+      mSearch.reset (new WidgetSearch());
+      mSearch->add (this);
+   }
+   return *mSearch;
+}
+
+void Screen::revealWidget (Widget * widget)
+{
+   Window * window = widget->window();
+   if (!window)
+      return;
+   window->setVisible (true);
+   moveWindowToFront (window);
+   for (Widget * w = widget->parent(); w; w = w->parent())
+      if (w->isScroll())
+         ((VScrollPanel *) w)->scrollToVisible (widget);
+   widget->requestFocus();
+}
+
+void Screen::arrangeWindows()
+{
+   mWindowSlots.clear();
+   mWindowIndices.clear();
+   for (int i = 0; i < (int) mChildren.size(); ++i)
+   {
+      if (!mChildren[i]->isWindow())
+         continue;
+      Window * window = (Window *) mChildren[i];
+      WindowSlot slot { 0, window->mStackOrder, 0, window };
+      Window * root = window;
+      while (root->isPopup() && ((Popup *) root)->parentWindow() && slot.depth < 16)
+      {
+         root = ((Popup *) root)->parentWindow();
+         ++slot.depth;
+      }
+      slot.root = root->mStackOrder;
+      mWindowSlots.push_back (slot);
+      mWindowIndices.push_back (i);
+   }
+   auto below = [] (const WindowSlot & a, const WindowSlot & b)
+   {
+      if (a.root != b.root)
+         return a.root < b.root;
+      if (a.depth != b.depth)
+         return a.depth < b.depth;
+      return a.own < b.own;
+   };
+   if (!std::is_sorted (mWindowSlots.begin(), mWindowSlots.end(), below))
+   {
+      std::stable_sort (mWindowSlots.begin(), mWindowSlots.end(), below);
+      for (size_t i = 0; i < mWindowSlots.size(); ++i)
+         mChildren[mWindowIndices[i]] = mWindowSlots[i].window;
+      sStructureGeneration++;
+      mSpatialIndexStale = true;
+      markDirty();
+   }
+
+   /* Occlusion by a single opaque window in front, the corners are left out of its rectangle */
+   for (size_t i = 0; i < mWindowSlots.size(); ++i)
+   {
+      Window * window = mWindowSlots[i].window;
+      bool occluded = false;
+      if (window->visible() && window->mTheme)
+      {
+         int margin = window->mTheme->mWindowDropShadowSize + 2;
+         Vector2i lo = window->position() - Vector2i::Constant (margin);
+         Vector2i hi = window->position() + window->size() + Vector2i::Constant (margin);
+         for (size_t j = i + 1; j < mWindowSlots.size() && !occluded; ++j)
+         {
+            const Window * front = mWindowSlots[j].window;
+            if (!front->visible() || !front->opaque())
+               continue;
+            int inset = (int) std::ceil (front->mTheme->mWindowCornerRadius * (1.0f - 0.7071f)) + 1;
+            Vector2i flo = front->position() + Vector2i::Constant (inset);
+            Vector2i fhi = front->position() + front->size() - Vector2i::Constant (inset);
+            occluded = (lo.array() >= flo.array()).all() && (hi.array() <= fhi.array()).all();
+         }
+      }
+      if (window->mOccluded != occluded)
+      {
+         window->mOccluded = occluded;
+         window->geometryChanged();
+      }
+   }
 }
 
 void Screen::centerWindow (Window * window)
 {
    if (window->size() == Vector2i::Zero())
    {
-      window->setSize (window->preferredSize (mNVGContext));
+      window->setSize (window->cachedPreferredSize (mNVGContext));
       window->performLayout (mNVGContext);
    }
    window->setPosition ((mSize - window->size()) / 2);
@@ -241,10 +1987,17 @@ void Screen::disposeWindow (Window * window)
 
 bool Screen::resizeCallbackEvent (int width, int height)
 {
+   if (mInputRecorder)
+      mInputRecorder->resize (width, height);
+   PROFILE_ZONE ("Screen::resizeCallbackEvent");
    auto end = std::chrono::system_clock::now();
    mLastInteraction = end - start;
+   if (mInputTime < 0.0)
+      mInputTime = mLastInteraction.count();
+   noteActivity();
    try
    {
+      markDirty();
       return resizeEvent (width, height);
    }
    catch (const std::exception & e)
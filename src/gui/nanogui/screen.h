@@ -14,11 +14,92 @@
 // This is a modified version of Nanogui!
 
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include "widget.h"
+#include "async.h"
+#include "widgetgeometry.h"
+#include "../nanovg/nanovg.h"
+
+struct NVGLUframebuffer;
+struct NVGglState;
+class FrameCapture;
+class FramePacer;
+class GlyphWorker;
+class ImageLoader;
+class ImageManager;
+class RenderThread;
+class TaskPool;
+class TaskQueue;
+class TimerWheel;
 
 NAMESPACE_BEGIN (nanogui)
 
+class Animator;
+class InputRecorder;
+
+/**
+   \brief NanoVG context shared by the screens of several windows
+
+   Fonts, the glyph atlas, images and shaders live in the NanoVG context, so
+   screens sharing one load and compile them once. Create it with the GL
+   context of the first window current, and the GL contexts of the other
+   windows sharing objects with that one. Every \ref Screen made from it keeps
+   the GL state that cannot be shared, and it is deleted with the last screen,
+   which must happen with one of the GL contexts current.
+
+   A context created with render callbacks submits to the GPU on a thread of
+   its own, see RenderThread. The screen then only tessellates on the calling
+   thread, and finishing a frame hands it over without waiting for the GPU.
+   Such a context draws into a single window, with no offscreen mode and no
+   GPU profiling, and no GL context needs to be current on the calling thread.
+*/
+class  ScreenContext : public Object
+{
+   public:
+      ScreenContext();
+      /**
+         \brief Create a context whose frames are submitted by a render thread
+
+         \c makeCurrent is called once on the render thread to make the GL
+         context of the window current there, \c begin before every frame with
+         its size to bind and clear the framebuffer, and \c present after it,
+         e.g. to swap buffers. \c begin and \c present may be empty.
+      */
+      ScreenContext (const std::function<void()> & makeCurrent, const std::function<void (int, int)> & begin,
+                     const std::function<void()> & present);
+
+      NVGcontext * context() const
+      {
+         return mContext;
+      }
+      /// Return whether frames are submitted by a render thread
+      bool threaded() const
+      {
+         return (bool)mRenderThread;
+      }
+      /// Return the render thread, or \c nullptr when frames are submitted by the drawing thread
+      RenderThread * renderThread() const
+      {
+         return mRenderThread.get();
+      }
+      /// Return the theme of the screens, created on first use
+      Theme * theme();
+
+   protected:
+      virtual ~ScreenContext();
+
+      NVGcontext * mContext = nullptr;
+      ref<Theme> mTheme;
+      std::unique_ptr<RenderThread> mRenderThread;
+};
+
 class Screen : public Widget
 {
       friend class Widget;
@@ -26,10 +107,27 @@ class Screen : public Widget
 
    public:
       Screen();
+      /**
+         \brief Create the screen of another window, drawing with a shared NanoVG context
+
+         Call with the GL context of the window current. The screen takes the
+         theme of \c shared and draws, like any screen, only when its own content
+         changed if \ref setRedrawOnDemand() is enabled. Tessellation threads and
+         asynchronous glyphs belong to the NanoVG context, enable them on one of
+         its screens only. A threaded context serves a single screen.
+      */
+      Screen (ScreenContext * shared);
       virtual ~Screen();
 
+      /// Return the NanoVG context with its resources, possibly shared with other screens
+      ScreenContext * sharedContext()
+      {
+         return mShared;
+      }
+
       virtual void drawWidgets();
-      bool cursorPosCallbackEvent (double x, double y);
+      /// Cursor motion, \c pressure from 0 to 1 for pens
+      bool cursorPosCallbackEvent (double x, double y, float pressure = 1.0f);
       bool mouseButtonCallbackEvent (int button, int action, int modifiers);
       bool resizeCallbackEvent (int width, int height);
       bool keyCallbackEvent (int key, int scancode, int action, int mods);
@@ -47,6 +145,17 @@ class Screen : public Widget
       void centerWindow (Window * window);
       void disposeWindow (Window * window);
 
+      /**
+         \brief Return the index for finding widgets of this screen by id or caption
+
+         Created on first use, from then on widgets attached to or removed from
+         the screen and changes of their ids and captions update it, see
+         \ref WidgetSearch and \ref CommandPalette.
+      */
+      WidgetSearch & searchIndex();
+      /// Show the window of \c widget, raise it, scroll the panels around the widget to it and focus it
+      void revealWidget (Widget * widget);
+
       NVGcontext * getContext()
       {
          return mNVGContext;
@@ -59,6 +168,602 @@ class Screen : public Widget
          return  end - start;
       }
 
+      /// Time in seconds since the last input event was received
+      double idleTime()
+      {
+         return (elapsedTime() - mLastInteraction).count();
+      }
+
+      /// Return whether a widget changed or a requested redraw is due since the last drawWidgets()
+      bool needsRedraw()
+      {
+         return mDirty || mMotionPending || tasksPending() || animating() || elapsedTime().count() >= std::min (mRedrawTime, nextTimer());
+      }
+      /// Return the seconds until the screen needs to be drawn, 0 if it does now and infinity if only input wakes it
+      double timeUntilRedraw();
+
+      /**
+         \brief Call \c callback after \c delay seconds, then every \c period seconds if it is positive
+
+         Timers fire at the start of \ref drawWidgets() on this thread, and a due
+         timer is reported by \ref needsRedraw(), so a host that sleeps for
+         \ref timeUntilRedraw() only wakes up when there is something to draw.
+         Adding, cancelling and firing a timer is O(1), see TimerWheel. Returns
+         the id for \ref cancelTimer(), never 0.
+      */
+      uint64_t addTimer (double delay, const std::function<void()> & callback, double period = 0.0);
+      /// Stop a timer, ids of timers that fired or were cancelled already are ignored
+      void cancelTimer (uint64_t id);
+
+      /**
+         \brief Return the animator of the widgets of this screen
+
+         It is created on first use and updated at the start of \ref drawWidgets(),
+         after the timers, and \ref needsRedraw() holds while it has tracks.
+      */
+      Animator & animator();
+
+      /**
+         \brief Determine the widget at \c p, like \ref Widget::findWidget()
+
+         Scans the rectangles of all widgets in flat arrays, see WidgetGeometry,
+         which are rebuilt first if widgets were added, removed or reordered.
+      */
+      Widget * findWidget (const Vector2i & p);
+
+      /**
+         \brief Request that the screen is redrawn
+
+         With a zero delay the next frame is drawn; otherwise the request is
+         scheduled, which lets animations and blinking cursors wake up an idle
+         screen. Widgets usually call \ref Widget::markDirty() instead.
+      */
+      void requestRedraw (double delay = 0.0)
+      {
+         if (delay <= 0.0)
+         {
+            mDirty = true;
+            mDamageAll = true;
+         }
+         else
+            mRedrawTime = std::min (mRedrawTime, elapsedTime().count() + delay);
+      }
+
+      /**
+         \brief Set the ratio of framebuffer pixels to window units, e.g. 2 on Retina displays
+
+         Passed to nvgBeginFrame(), it sets the tessellation tolerance and the
+         size glyphs are rasterized at. Set it again when the window moves to a
+         display with another content scale: retained recordings of the old
+         ratio are recorded again, glyphs are rasterized at the new size as text
+         is drawn, and cached geometry is re-tessellated on its next use.
+      */
+      void setPixelRatio (float ratio);
+      /// Return the ratio of framebuffer pixels to window units
+      float pixelRatio() const
+      {
+         return mPixelRatio;
+      }
+
+      /**
+         \brief Skip drawing in \ref drawWidgets() when nothing needs to be redrawn
+
+         Only enable this when the previous GUI image survives until the next
+         frame (e.g. the host does not clear the color buffer underneath it).
+      */
+      void setRedrawOnDemand (bool redrawOnDemand)
+      {
+         mRedrawOnDemand = redrawOnDemand;
+      }
+      /// Return whether idle frames are skipped in \ref drawWidgets()
+      bool redrawOnDemand() const
+      {
+         return mRedrawOnDemand;
+      }
+
+      /**
+         \brief Lower the repaint rate after \c idleSeconds without activity
+
+         Input, posted tasks, due timers and running animations are activity.
+         Once there was none for \c idleSeconds, repaints are at least 1 /
+         \c idleRate seconds apart, and \ref timeUntilRedraw() waits for that.
+         Input ends the throttle at once, the rest on the next frame. Skipping
+         a repaint needs the previous image to survive, so the GUI rate only
+         drops with \ref setRedrawOnDemand() or \ref setOffscreen(); the whole
+         app can follow through \ref setIdleCallback(). Zero seconds turns the
+         throttle off.
+      */
+      void setIdleThrottle (double idleSeconds, double idleRate = 4.0);
+      /// Return the seconds without activity after which repaints are throttled, 0 when they never are
+      double idleThrottle() const
+      {
+         return mIdleSeconds;
+      }
+      /// Return whether repaints are throttled right now
+      bool idle() const
+      {
+         return mIdle;
+      }
+      /// Set a callback called on this thread when the throttle starts (true) and ends (false), e.g. to change the frame rate of the app
+      void setIdleCallback (const std::function<void (bool)> & callback)
+      {
+         mIdleCallback = callback;
+      }
+
+      /**
+         \brief Collapse all cursor motion between two frames into a single event
+
+         While enabled, \ref cursorPosCallbackEvent() only records the latest cursor
+         position and returns \c false. The motion (or drag) event is dispatched once,
+         with the accumulated relative motion, at the start of \ref drawWidgets() or
+         right before the next button, key or character event, so their ordering
+         relative to the motion is preserved. A widget being dragged still gets
+         every position, with its time and pressure, in a single
+         \ref Widget::mouseDragSamplesEvent().
+      */
+      void setCoalesceMotion (bool coalesceMotion)
+      {
+         if (!coalesceMotion)
+            flushMotion();
+         mCoalesceMotion = coalesceMotion;
+      }
+      /// Return whether cursor motion is coalesced into one event per frame
+      bool coalesceMotion() const
+      {
+         return mCoalesceMotion;
+      }
+      /// Dispatch a queued cursor motion now, returns whether a widget handled it
+      bool flushMotion();
+
+      /**
+         \brief Start drawing as late before the display refresh as the recent frames allow
+
+         \ref drawWidgets() then first waits for the time the previous frames
+         left unused before the deadline, see FramePacer, and only then samples
+         the input: queued motion is dispatched after the polls, right before the
+         widgets are drawn. Meant for hosts that draw once per refresh with vsync,
+         where the wait would otherwise happen after submitting, in the buffer
+         swap. Feed GPU times to \ref addGpuTime() to include them in the estimate.
+      */
+      void setFramePacing (bool enabled);
+      /// Return whether drawing is delayed towards the refresh deadline
+      bool framePacing() const
+      {
+         return (bool)mFramePacer;
+      }
+      /// Return the frame pacer, \c nullptr unless frame pacing is enabled
+      FramePacer * framePacer()
+      {
+         return mFramePacer.get();
+      }
+
+      /// Record the input events and frames to \c recorder, owned by the caller, \c nullptr stops recording
+      void setInputRecorder (InputRecorder * recorder)
+      {
+         mInputRecorder = recorder;
+      }
+      InputRecorder * inputRecorder() const
+      {
+         return mInputRecorder;
+      }
+
+      /**
+         \brief Read the cursor position right before the widgets are drawn
+
+         \c sampler stores the position, in the coordinates passed to
+         \ref cursorPosCallbackEvent(), and returns \c true when it could read
+         one. A position that differs from the last one is handled as a cursor
+         motion, so drags follow the pointer even if its latest event has not
+         been delivered yet.
+      */
+      void setInputSampler (const std::function<bool (Vector2i &)> & sampler)
+      {
+         mInputSampler = sampler;
+      }
+
+      /**
+         \brief Return when the oldest input drawn by the last frame was received
+
+         In seconds of \ref elapsedTime(), negative when the last \ref drawWidgets()
+         drew no new input. Subtract it from the time the frame reached the
+         display to obtain the input latency, see markGPUFrameEnd().
+      */
+      double frameInputTime() const
+      {
+         return mFrameInputTime;
+      }
+
+      /**
+         \brief Tessellate the paths of a frame on \c threads worker threads
+
+         Fills and strokes are deferred and flattened and expanded in parallel when
+         the frame ends, see nvgSetParallelCallback(). Pays off for frames with many
+         large paths such as dense plots. A negative count uses one thread less
+         than the hardware has, 0 (the default) tessellates every path immediately
+         on the calling thread.
+      */
+      void setTessellationThreads (int threads);
+      /// Return the number of tessellation worker threads, 0 when disabled
+      int tessellationThreads() const;
+
+      /**
+         \brief Lay out the widgets, windows in parallel on the tessellation threads
+
+         Without a layout of its own, the screen measures and arranges the stale
+         top-level windows on the threads of \ref setTessellationThreads(), each
+         with a measure context that shares the fonts of \c ctx, see
+         nvgCreateMeasureContext(). Their layout code must then only touch their
+         own subtree. Fonts are looked up in \c ctx first, popups and other
+         children are laid out afterwards on the calling thread.
+      */
+      virtual void performLayout (NVGcontext * ctx) override;
+
+      /**
+         \brief Record the top-level windows in parallel before drawing them
+
+         With \ref setTessellationThreads(), each visible opaque window is drawn
+         into a draw list of its own on a worker thread, with a measure context
+         of the screen's context, see nvgCreateMeasureContext(). Paths are
+         tessellated there; text keeps its string and is shaped, and its missing
+         glyphs rasterized or queued, when the lists are replayed in window order
+         on the calling thread. Windows whose subtree has a widget that is not
+         \ref Widget::threadSafeDraw(), or a translucent layered one, are drawn
+         on the calling thread as before. Their draw code must only touch their
+         own subtree. Off by default.
+      */
+      void setParallelDraw (bool parallel)
+      {
+         mParallelDraw = parallel;
+      }
+      /// Return whether windows are recorded in parallel, see \ref setParallelDraw()
+      bool parallelDraw() const
+      {
+         return mParallelDraw;
+      }
+
+      /**
+         \brief Rasterize glyphs missing from the font atlas on a worker thread
+
+         A frame that draws new text then no longer waits for the glyphs to be
+         rasterized. They are left blank and filled in a frame or two later,
+         the screen schedules the redraws itself. See nvgSetAsyncGlyphs().
+      */
+      void setAsyncGlyphs (bool enabled);
+      /// Return whether glyphs are rasterized on a worker thread
+      bool asyncGlyphs() const
+      {
+         return (bool)mGlyphWorker;
+      }
+
+      /**
+         \brief Return the loader decoding image files for this screen in the background
+
+         It is created on first use. Every frame creates the textures of the
+         images it finished decoding, up to \ref imageUploadBudget() bytes of
+         pixels, and the screen keeps redrawing while files are pending.
+      */
+      ImageLoader & imageLoader();
+      /// Set the bytes of image pixels uploaded per frame by \ref imageLoader()
+      void setImageUploadBudget (size_t bytes)
+      {
+         mImageUploadBudget = bytes;
+      }
+      /// Return the bytes of image pixels uploaded per frame by \ref imageLoader()
+      size_t imageUploadBudget() const
+      {
+         return mImageUploadBudget;
+      }
+      /**
+         \brief Return the manager keeping images of files within a texture memory budget
+
+         It is created on first use and loads through \ref imageLoader(). Every
+         frame ends by evicting the least recently drawn images beyond its budget,
+         and an image that arrives redraws the screen.
+      */
+      ImageManager & imageManager();
+
+      /**
+         \brief Capture the next frame into an image file without stalling the pipeline
+
+         With \ref setOffscreen() the GUI framebuffer is read, transparent where
+         no widget is drawn; otherwise the framebuffer the screen draws into,
+         with whatever the host drew there. The pixels are copied into a pixel
+         pack buffer that is mapped once its fence signals, a frame or two later.
+         A worker thread then shrinks the image to \c maxWidth pixels (0 keeps
+         its size) and writes \c path, as TGA or BMP after its extension and as
+         PNG otherwise, or nothing for an empty path. \c callback is then called
+         from \ref drawWidgets() with the RGBA pixels, empty if the capture
+         failed. Returns false with a threaded \ref ScreenContext, which does
+         not draw on this thread.
+      */
+      bool captureFrame (const std::string & path, int maxWidth = 0,
+                         const std::function<void (const std::vector<unsigned char> &, int, int)> & callback = nullptr);
+
+      /**
+         \brief Render the widgets into a persistent offscreen framebuffer
+
+         The framebuffer is only repainted when \ref needsRedraw() reports a
+         change; every call to \ref drawWidgets() composites it with a single
+         textured quad. This keeps idle GUI frames cheap even when the host
+         clears the screen every frame. Not available with a threaded
+         \ref ScreenContext.
+      */
+      void setOffscreen (bool offscreen);
+      /// Return whether the widgets are rendered through an offscreen framebuffer
+      bool offscreen() const
+      {
+         return mOffscreen;
+      }
+
+      /**
+         \brief Render the widgets into a framebuffer of the host, e.g. one textured onto a surface of the scene
+
+         \ref drawWidgets() then repaints the \c width by \c height pixels of
+         \c fbo only when \ref needsRedraw() reports a change, with
+         \ref setPartialRedraw() only the damaged parts, and draws nothing into
+         the framebuffer bound at the time. The screen keeps its size in window
+         units and scales to the largest pixel ratio that fits the framebuffer,
+         the widgets taking up its top left corner if the aspects differ. Any
+         resolution works, the framebuffer needs a stencil attachment; for a
+         Cinder gl::Fbo pass its getId() and size. Several screens sharing a
+         \ref ScreenContext can each draw a panel of the scene this way. A zero
+         \c fbo draws into the bound framebuffer again. Not available with a
+         threaded \ref ScreenContext.
+      */
+      void setRenderTarget (unsigned int fbo, int width, int height);
+      /// Return the framebuffer of the host the widgets are rendered into, 0 if none
+      unsigned int renderTarget() const
+      {
+         return mRenderTarget;
+      }
+      /// Return whether the last \ref drawWidgets() repainted the render target, e.g. to update the mipmaps of its texture
+      bool renderTargetUpdated() const
+      {
+         return mRenderTargetUpdated;
+      }
+      /**
+         \brief Map a point of the render target to screen coordinates
+
+         \c uv are texture coordinates of the point, e.g. where a ray cast from
+         the pointer hits the surface showing the panel, with v pointing up as
+         in GL. Returns the position in window units.
+      */
+      Vector2i renderTargetPosition (const Vector2f & uv) const;
+      /// Move the cursor to a point of the render target, see \ref renderTargetPosition(); buttons, keys and scrolling go through the usual callbacks
+      bool renderTargetCursorEvent (const Vector2f & uv, float pressure = 1.0f)
+      {
+         /* Offset like the positions of the window, cursorPosCallbackEvent() removes it */
+         Vector2i p = renderTargetPosition (uv) + Vector2i (1, 2);
+         return cursorPosCallbackEvent (p.x(), p.y(), pressure);
+      }
+
+      /**
+         \brief Repaint the widgets at most \c hz times per second, whatever the rate of the host
+
+         Layout, tessellation and rendering of the widgets only run on frames
+         that need a repaint and whose slot came; the frames in between
+         composite the last offscreen image, which is enabled with the rate. A
+         window being dragged is shown moved on those frames, cut from the last
+         image, and the overlay callback is drawn on every frame, so that drag
+         and cursor feedback keep the rate of the host. Zero repaints whenever
+         something changed.
+      */
+      void setGuiRate (double hz);
+      /// Return the highest number of widget repaints per second, 0 when not limited
+      double guiRate() const
+      {
+         return mGuiRate;
+      }
+      /// Set a callback drawing on top of the composited widgets every frame, e.g. feedback that follows the cursor
+      void setOverlayCallback (const std::function<void (NVGcontext *)> & overlay)
+      {
+         mOverlayCallback = overlay;
+      }
+
+      /**
+         \brief Repaint only the damaged parts of the offscreen framebuffer
+
+         Widgets marked dirty report their rectangle, and a window its drop
+         shadow besides. The rectangles of a frame are merged into at most a
+         handful, which are cleared and repainted with the widgets drawn under a
+         scissor, culling everything outside. Changes to the screen itself, like
+         moving a window, reordering windows or timed redraws, still repaint it
+         all. Only takes effect with \ref setOffscreen() or multisampling.
+      */
+      void setPartialRedraw (bool partial)
+      {
+         mPartialRedraw = partial;
+         mDamageAll = true;
+      }
+      /// Return whether only the damaged parts of the offscreen framebuffer are repainted
+      bool partialRedraw() const
+      {
+         return mPartialRedraw;
+      }
+      /// Mark a rectangle of the screen, in window units, as needing to be repainted
+      void addDamage (const Vector2i & pos, const Vector2i & size);
+      /// Flash the repainted regions when compositing, to find widgets that invalidate too much
+      void setShowDamage (bool show)
+      {
+         mShowDamage = show;
+         mDamageFlashes.clear();
+      }
+      /// Return whether the repainted regions are flashed
+      bool showDamage() const
+      {
+         return mShowDamage;
+      }
+
+      /// How the edges of shapes are anti-aliased, see \ref setAntiAliasing()
+      enum class AntiAliasing
+      {
+         Fringes,		///< Fringe strips generated by NanoVG around every fill
+         Multisample,	///< A multisampled framebuffer, without fringes
+         Automatic		///< Whichever of the two measured cheaper on this screen
+      };
+      /**
+         \brief Choose how the edges of shapes are anti-aliased
+
+         Multisampling renders the widgets into a framebuffer with \c samples
+         samples per pixel and resolves it into the offscreen framebuffer, so it
+         works like \ref setOffscreen() besides. NanoVG then generates no fringes,
+         which saves about half the vertices of fills and a draw call per path.
+         Automatic renders a few dozen frames each way and keeps the one with the
+         lower CPU plus GPU time; GPU times count when they are fed to
+         \ref addGpuTime(). Not available with a threaded \ref ScreenContext, or
+         where multisampled framebuffers are not.
+      */
+      void setAntiAliasing (AntiAliasing mode, int samples = 4);
+      /// Return the anti-aliasing mode that was set
+      AntiAliasing antiAliasing() const
+      {
+         return mAntiAliasing;
+      }
+      /// Return whether the widgets are currently rendered into a multisampled framebuffer
+      bool multisampled() const
+      {
+         return mMultisampled;
+      }
+      /// Add the GPU time of a frame, as read back from a GPU timer, for frame pacing, anti-aliasing and the quality governor
+      void addGpuTime (double seconds);
+
+      /// Steps the quality governor lowers the rendering by, each one keeping the ones before it
+      enum class Quality
+      {
+         Full,
+         NoShadows,		///< windows without drop shadows
+         NoEdgeAA,		///< no anti-aliasing fringes around fills and strokes
+         CoarseCurves,	///< curves flattened with a larger tolerance
+         CoarseGraphs,	///< graph paths decimated to every other pixel column
+         HalfRate		///< the widgets repainted every other frame
+      };
+      /**
+         \brief Lower the rendering quality in steps while the GUI takes longer than \c seconds per frame
+
+         The governor adds up the CPU time of \ref drawWidgets() and the GPU
+         times fed to \ref addGpuTime() over windows of a few dozen frames. A
+         window over budget goes one \ref Quality step down, one with ample
+         headroom one step back up, and every change redraws all widgets.
+         Repainting at half rate needs an image that survives the skipped
+         frames, from \ref setOffscreen(), multisampling or
+         \ref setRedrawOnDemand(); without one the governor stops a step
+         earlier. 0, the default, turns it off and restores full quality.
+      */
+      void setFrameBudget (double seconds);
+      /// Return the seconds per frame the quality governor keeps the GUI within, 0 when it is off
+      double frameBudget() const
+      {
+         return mFrameBudget;
+      }
+      /// Return the current step of the quality governor
+      Quality quality() const
+      {
+         return mQuality;
+      }
+      /// Return a short name of a quality step, for performance overlays
+      static const char * qualityName (Quality quality);
+
+      /**
+         \brief Receive named, nested scopes around the GPU work of every NanoVG flush
+
+         \c begin is 1 when a scope opens and 0 when it closes. Pass
+         \c nullptr to stop profiling. Ignored with a threaded \ref ScreenContext.
+      */
+      void setProfileCallback (void (*callback) (void * userPtr, const char * name, int begin), void * userPtr);
+
+      /**
+         \brief Rasterize the glyphs of the theme fonts before they are first drawn
+
+         Loads \c cacheFile when it holds the font atlas of an earlier run.
+         Otherwise printable ASCII at the theme font sizes and the icons NanoGUI
+         draws itself are rasterized, on a background thread when \c background
+         is set, and installed at the start of a later frame. The result is
+         written to \c cacheFile unless it is empty. Call once the theme is set
+         and the screen has its size.
+      */
+      void prewarmGlyphs (const std::string & cacheFile = std::string(), bool background = true);
+
+      /// Return the NanoVG statistics of the last rendered frame
+      const NVGframeStats & frameStats() const
+      {
+         return mFrameStats;
+      }
+      /// Set a callback that receives the statistics of every rendered frame
+      void setFrameStatsCallback (const std::function<void (const NVGframeStats &)> & callback)
+      {
+         mFrameStatsCallback = callback;
+      }
+
+      /**
+         \brief Call \c poll at the start of every \ref drawWidgets(), rendering or not
+
+         Widgets fed from other threads pull their data here and mark themselves
+         dirty when it changed. The screen only keeps a weak reference, the poll
+         ends when its owner drops the last shared pointer to it.
+      */
+      void addPoll (const std::shared_ptr<std::function<void()>> & poll)
+      {
+         mPolls.push_back (poll);
+      }
+
+      /// Priority of a task handed to \ref post()
+      enum class TaskPriority
+      {
+         Input,	///< runs before the next frame, e.g. the reaction to a device event
+         Bulk	///< runs within the budget of a frame, e.g. filling a large list
+      };
+
+      /**
+         \brief Run \c task on the thread drawing the screen, callable from any thread
+
+         This is how other threads touch widgets. Tasks run in \ref drawWidgets()
+         after the polls, in the order they were posted. Every input task runs;
+         bulk tasks run until \ref taskBudget() is spent, at least one per frame,
+         and the rest wait for the next frame. \ref needsRedraw() reports queued
+         tasks, a host that blocks waiting for events sets \ref setWakeCallback().
+      */
+      void post (std::function<void()> task, TaskPriority priority = TaskPriority::Input);
+      /// Set the seconds per frame spent on bulk tasks
+      void setTaskBudget (double seconds)
+      {
+         mTaskBudget = seconds;
+      }
+      /// Return the seconds per frame spent on bulk tasks
+      double taskBudget() const
+      {
+         return mTaskBudget;
+      }
+      /// Set a callback, e.g. glfwPostEmptyEvent(), that \ref post() calls on the posting thread. Set it before tasks are posted
+      void setWakeCallback (const std::function<void()> & wake)
+      {
+         mWakeCallback = wake;
+      }
+
+      /**
+         \brief Run \c work on a thread of its own, then \c done on this thread
+
+         Keeps the screen responsive during long actions such as exporting or
+         scanning a folder. \c work receives the operation to report progress
+         and check for cancellation, \c done runs as an input task once it
+         returned, whether it completed, was cancelled or threw. Deleting the
+         screen cancels the operations still running and waits for them.
+      */
+      ref<AsyncOperation> runAsync (std::function<void (AsyncOperation &)> work,
+                                    std::function<void (AsyncOperation &)> done = nullptr);
+
+      /// Return whether a payload is being dragged, see \ref Widget::setDragSource()
+      bool dropping() const
+      {
+         return mDragDrop != nullptr;
+      }
+      /// Return the payload being dragged, null if none
+      const DragPayload * dragPayload() const
+      {
+         return mDragDrop ? &mDragDrop->payload : nullptr;
+      }
+      /// Drop nothing and let go of the payload being dragged; Escape does the same
+      void cancelDragDrop();
+
       /// Default keyboard event handler
       virtual bool keyboardEvent (int key, int scancode, int action, int modifiers);
 
@@ -66,17 +771,218 @@ class Screen : public Widget
       virtual bool keyboardCharacterEvent (unsigned int codepoint);
 
    protected:
+      /**
+         \brief Bring the window order in line with the stacking order and find the occluded windows
+
+         Windows are kept in the child list sorted by the stacking order of their
+         root window, with popups directly above the window they belong to. A
+         window whose rectangle and drop shadow lie inside an opaque window in
+         front of it is marked occluded. Called before drawing and hit-testing,
+         never while an event walks the children.
+      */
+      void arrangeWindows();
+      /// Bring a measure context per thread up to date with \c ctx and the themes of \c windows, false with fewer than two
+      bool prepareMeasureContexts (NVGcontext * ctx, const std::vector<Window *> & windows);
+      /// Record the windows that can be drawn in parallel into their frame lists, see \ref setParallelDraw()
+      void recordWindows (NVGcontext * ctx);
+      /// Take a measure context for a window laid out or drawn in parallel, hand it back with \ref releaseMeasureContext()
+      NVGcontext * acquireMeasureContext();
+      void releaseMeasureContext (NVGcontext * ctx);
+      /// Return whether tasks were posted and did not run yet
+      bool tasksPending() const;
+      /// Return the time the next timer is due, infinity without timers
+      double nextTimer() const;
+      /// Return whether the animator has running tracks
+      bool animating() const;
+      /// Follow the widget under the cursor, its tooltip shows after it was hovered for a while
+      void updateTooltip (Widget * widget);
+      void showTooltip();
+      void hideTooltip();
+      /// Draw the tooltip above the widgets
+      void drawTooltip();
+      /// Record activity now, ending the idle throttle
+      void noteActivity();
+      /// Start or end the idle throttle, see \ref setIdleThrottle()
+      void updateIdle (bool idle);
+      /// Return the shortest time between two repaints allowed now by the GUI rate and the idle throttle
+      double repaintInterval() const
+      {
+         return std::max (mGuiRate > 0.0 ? 1.0 / mGuiRate : 0.0, mIdle ? 1.0 / mIdleRate : 0.0);
+      }
+      /// Return whether the GUI rate or the idle throttle holds back the repaint of this frame
+      bool throttleRepaint();
+      /// Run the posted tasks, see \ref post()
+      void runTasks();
+      /// Report the rectangle of a widget marked dirty, see \ref setPartialRedraw()
+      void damageWidget (const Widget * widget);
+      /// Invalidate the backdrops of the windows drawn after \c widget that overlap the rectangle \c pos, \c size
+      void invalidateBackdrops (const Widget * widget, const Vector2i & pos, const Vector2i & size);
+      /// Draw the widgets, only within the damaged rectangles of the frame if there are any
+      void drawDamaged();
+      /// Start dragging the payload of the first drag source at or above the pressed widget
+      bool startDragDrop (const Vector2i & p);
+      /// Follow the cursor with the preview and find the drop target under it
+      void moveDragDrop (const Vector2i & p);
+      /// Drop the payload on the target under the cursor, producing its data now
+      void endDragDrop();
+      /// Report the preview as damaged, and the highlight of the target if \c target
+      void damageDragDrop (bool target);
+      /// Draw the preview of the dragged payload above the widgets
+      void drawDragPreview();
+      /// Route a cursor motion to the dragged widget or the widgets under the cursor
+      bool dispatchMotion (const Vector2i & p, const std::vector<PointerSample> * samples = nullptr);
+      /// Read the input sampler and dispatch the queued cursor motion
+      void sampleInput();
+      /// Draw, offscreen or not, unless nothing changed and only changes are drawn
+      void renderWidgets();
+      /// Draw all widgets into the currently bound framebuffer
+      void renderFrame();
+      /// Repaint the offscreen framebuffer, (re)creating it to match the screen size, or the render target
+      void renderOffscreen();
+      /// Return the size of the screen in framebuffer pixels
+      Vector2i pixelSize() const
+      {
+         return (mSize.cast<float>() * mPixelRatio + Vector2f::Constant (0.5f)).cast<int>();
+      }
+      /// Composite the offscreen framebuffer onto the currently bound framebuffer
+      void compositeOffscreen();
+      /// Switch between fringes and multisampling, dropping the framebuffers no longer needed
+      void setMultisampled (bool multisampled);
+      /// Return whether the automatic anti-aliasing mode still measures both ways
+      bool antiAliasingTrial() const;
+      /// Count a rendered frame and its CPU time towards the automatic anti-aliasing mode
+      void measureAntiAliasing (double seconds);
+      /// Count the CPU time of a frame towards the quality governor, which steps at the end of a window
+      void governQuality (double seconds);
+      /// Switch to a quality step and redraw all widgets with it
+      void setQuality (Quality quality);
+      /// Hand the glyphs of a finished \ref prewarmGlyphs() over to the NanoVG context
+      void installGlyphs();
+      /// End the NanoVG frame, keeping the GL state of the host intact
+      void endFrame();
+
+   protected:
+      Screen (ScreenContext * shared, bool windowState);
+
+      ref<ScreenContext> mShared;
       NVGcontext * mNVGContext = nullptr;
+      int mWindowState = 0;	// GL state of this window when the context is shared, see nvglCreateWindowState()
+      std::unique_ptr<NVGglState> mGlState;	// GL state shadow shared with NanoVG, see nvglShareState()
       bool mDragActive = false;
       Widget * mDragWidget = nullptr;
       int mMouseState = 0;
       int mModifiers = 0;
       std::vector<Widget *> mFocusPath;
+      struct WindowSlot
+      {
+         uint64_t root, own;	// stacking order of the root window and of the window itself
+         int depth;	// popups between the window and its root
+         Window * window;
+      };
+      std::vector<WindowSlot> mWindowSlots;	// scratch of arrangeWindows()
+      std::vector<int> mWindowIndices;
 
       std::chrono::time_point<std::chrono::system_clock> start;
       std::chrono::duration<double> mLastInteraction;
+      double mRedrawTime = std::numeric_limits<double>::infinity();
+      bool mRedrawOnDemand = false;
+      double mIdleSeconds = 0.0, mIdleRate = 4.0;
+      std::atomic<double> mLastActivity { 0.0 };	// seconds since start, written by post() from any thread
+      double mLastRepaint = -std::numeric_limits<double>::infinity();
+      bool mIdle = false;
+      std::function<void (bool)> mIdleCallback;
+      double mGuiRate = 0.0;
+      std::function<void (NVGcontext *)> mOverlayCallback;
+      Window * mPaintedDragWindow = nullptr;	// being dragged at the last repaint, only compared
+      Vector2i mPaintedDragPos = Vector2i::Zero();	// its absolute position then
+      bool mOffscreen = false;
+      float mPixelRatio = 1.0f;
+      NVGLUframebuffer * mFramebuffer = nullptr;
+      Vector2i mFramebufferSize = Vector2i::Zero();	// in pixels
+      unsigned int mRenderTarget = 0;	// framebuffer of the host, see setRenderTarget()
+      Vector2i mRenderTargetSize = Vector2i::Zero();	// in pixels
+      bool mRenderTargetFresh = false;	// holds nothing drawn by the screen yet
+      bool mRenderTargetUpdated = false;
+      AntiAliasing mAntiAliasing = AntiAliasing::Fringes;
+      int mSamples = 4;
+      bool mMultisampled = false;
+      NVGLUframebuffer * mMultisampleFramebuffer = nullptr;	// resolved into mFramebuffer
+      bool mPartialRedraw = false;
+      bool mDamageAll = true;	// the next repaint covers the whole screen
+      std::vector<Vector4i> mDamage;	// corners, in window units, of the rectangles to repaint
+      std::vector<Vector4i> mFrameDamage;	// of the repaint in progress, empty when all of it
+      bool mShowDamage = false;
+      struct DamageFlash
+      {
+         Vector4i rect;
+         double time;
+      };
+      std::vector<DamageFlash> mDamageFlashes;
+      /* Frames rendered by AntiAliasing::Automatic so far, and the CPU and GPU seconds and samples with fringes [0] and multisampling [1] */
+      int mTrialFrame = 0;
+      double mTrialCpu[2] = { 0.0, 0.0 }, mTrialGpu[2] = { 0.0, 0.0 };
+      int mTrialCpuFrames[2] = { 0, 0 }, mTrialGpuFrames[2] = { 0, 0 };
+      /* Quality governor: the frames of the current window, negative while a new step settles, and their CPU and GPU seconds */
+      double mFrameBudget = 0.0;
+      Quality mQuality = Quality::Full;
+      int mGovernorFrames = 0;
+      double mGovernorCpu = 0.0, mGovernorGpu = 0.0;
+      bool mSkipRepaint = false;	// toggled every frame at Quality::HalfRate
+      int mTessellationMode = NVG_TESS_RECURSIVE;	// restored when leaving Quality::CoarseCurves
+      float mTessellationTolerance = 1.0f;
+      NVGframeStats mFrameStats;
+      std::function<void (const NVGframeStats &)> mFrameStatsCallback;
+      std::vector<std::weak_ptr<std::function<void()>>> mPolls;
+      std::unique_ptr<TaskQueue> mTasks[2];	// per TaskPriority
+      double mTaskBudget = 0.002;
+      std::function<void()> mWakeCallback;
+      std::vector<ref<AsyncOperation>> mAsyncOperations;	// running
+      std::unique_ptr<TimerWheel> mTimers;
+      ref<Widget> mTooltipWidget;	// hovered, with a tooltip
+      uint64_t mTooltipTimer = 0;
+      bool mTooltipVisible = false;
+      Vector2i mTooltipPos = Vector2i::Zero(), mTooltipSize = Vector2i::Zero();	// of the box, the arrow is above it
+      std::unique_ptr<Animator> mAnimator;
+      WidgetGeometry mGeometry;	// hit-testing, kept up to date by the setters of the widgets
+      std::unique_ptr<WidgetSearch> mSearch;	// see searchIndex()
 
       Vector2i mMousePos;
+      bool mCoalesceMotion = false;
+      bool mMotionPending = false;
+      Vector2i mPendingMotionPos;
+      std::vector<PointerSample> mPendingSamples;	// of a drag, in screen coordinates
+      Vector2i mPressPos = Vector2i::Zero();	// of the left button, where a drag and drop starts from
+      struct DragDrop
+      {
+         DragPayload payload;
+         ref<Widget> target;	// accepting a drop at pos
+         Vector2i pos, grab;	// cursor, and its offset from the top left corner of the preview
+         Vector2i previewSize;
+         bool recorded = false;	// mDragPreview holds the preview widget
+      };
+      std::unique_ptr<DragDrop> mDragDrop;
+      NVGdrawList * mDragPreview = nullptr;	// reused by all drags
+      std::unique_ptr<FramePacer> mFramePacer;
+      InputRecorder * mInputRecorder = nullptr;
+      std::function<bool (Vector2i &)> mInputSampler;
+      double mInputTime = -1.0;	// of the oldest input since the last drawWidgets(), negative when none
+      double mFrameInputTime = -1.0;
+      std::unique_ptr<TaskPool> mTaskPool;
+      std::vector<NVGcontext *> mMeasureContexts;	// one per thread laying out or drawing windows
+      std::vector<NVGcontext *> mFreeMeasureContexts;
+      std::mutex mMeasureMutex;
+      std::vector<Window *> mLayoutWindows;	// laid out in parallel
+      bool mParallelLayout = false;
+      std::vector<Window *> mDrawWindows;	// recorded in parallel this frame
+      bool mParallelDraw = false;
+      std::unique_ptr<GlyphWorker> mGlyphWorker;
+      std::unique_ptr<ImageLoader> mImageLoader;
+      std::unique_ptr<ImageManager> mImageManager;
+      std::unique_ptr<FrameCapture> mFrameCapture;
+      size_t mImageUploadBudget = 4 << 20;
+      NVGglyphBuilder * mGlyphBuilder = nullptr;
+      std::thread mGlyphThread;
+      std::atomic<bool> mGlyphsReady { false };
 
 }; // end class Screen
 
@@ -11,6 +11,7 @@
 
 #include "slider.h"
 #include "theme.h"
+#include "screen.h"
 #include "../nanovg/nanovg.h"
 
 NAMESPACE_BEGIN (nanogui)
@@ -18,6 +19,7 @@ NAMESPACE_BEGIN (nanogui)
 Slider::Slider (Widget * parent)
    : Widget (parent), mValue (0.0f), mHighlightedRange (std::make_pair (0.f, 0.f))
 {
+   mKind |= SliderKind;
    mHighlightColor = Color (255, 80, 80, 70);
 }
 
@@ -32,8 +34,26 @@ bool Slider::mouseDragEvent (const Vector2i & p, const Vector2i & /* rel */,
    if (!mEnabled)
       return false;
    mValue = std::min (std::max ((p.x() - mPos.x()) / (float) mSize.x(), (float) 0.0f), (float) 1.0f);
-   if (mCallback)
-      mCallback (mValue);
+   mCallbacks.changed (mValue);
+   markDirty();
+   return true;
+}
+
+bool Slider::mouseDragSamplesEvent (const std::vector<PointerSample> & samples, const Vector2i & /* rel */,
+                                    int /* button */, int /* modifiers */)
+{
+   if (!mEnabled)
+      return false;
+   /* Every value scrubbed over reaches the callback, the slider is drawn once for all of them */
+   for (const PointerSample & sample : samples)
+   {
+      float value = std::min (std::max ((sample.pos.x() - mPos.x()) / (float) mSize.x(), 0.0f), 1.0f);
+      if (value == mValue)
+         continue;
+      mValue = value;
+      mCallbacks.changed (mValue);
+   }
+   markDirty();
    return true;
 }
 
@@ -42,39 +62,45 @@ bool Slider::mouseButtonEvent (const Vector2i & p, int /* button */, bool down,
    if (!mEnabled)
       return false;
    mValue = std::min (std::max ((p.x() - mPos.x()) / (float) mSize.x(), (float) 0.0f), (float) 1.0f);
-   if (mCallback)
-      mCallback (mValue);
-   if (mFinalCallback && !down)
-      mFinalCallback (mValue);
+   mCallbacks.changed (mValue);
+   if (!down)
+      mCallbacks.finished (mValue);
+   markDirty();
    return true;
 }
 
+void Slider::setCallbackPerFrame (bool perFrame)
+{
+   mCallbacks.setPerFrame (perFrame);
+   if (perFrame && !mFlushPoll)
+   {
+      mFlushPoll = std::make_shared<std::function<void()>> ([this]() { mCallbacks.flush(); });
+      if (Screen * screen = this->screen())
+         screen->addPoll (mFlushPoll);
+   }
+}
+
 void Slider::draw (NVGcontext * ctx)
 {
+   /* Every part is an analytic rounded rectangle (a circle for the knob) drawn as a single quad, and
+      the outer half of a stroke is a larger circle under the fill, so nothing is tessellated or stenciled */
    Vector2f center = mPos.cast<float>() + mSize.cast<float>() * 0.5f;
    Vector2f knobPos (mPos.x() + mValue * mSize.x(), center.y() + 0.5f);
    float kr = (int) (mSize.y() * 0.5f);
    NVGpaint bg = nvgBoxGradient (ctx,
                                  mPos.x(), center.y() - 3 + 1, mSize.x(), 6, 3, 3, Color (0, mEnabled ? 32 : 10), Color (0, mEnabled ? 128 : 210));
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x(), center.y() - 3 + 1, mSize.x(), 6, 2);
    nvgFillPaint (ctx, bg);
-   nvgFill (ctx);
+   nvgDrawRoundedRectSDF (ctx, mPos.x(), center.y() - 3 + 1, mSize.x(), 6, 2);
    if (mHighlightedRange.second != mHighlightedRange.first)
    {
-      nvgBeginPath (ctx);
-      nvgRoundedRect (ctx, mPos.x() + mHighlightedRange.first * mSize.x(), center.y() - 3 + 1, mSize.x() * (mHighlightedRange.second - mHighlightedRange.first), 6, 2);
       nvgFillColor (ctx, mHighlightColor);
-      nvgFill (ctx);
+      nvgDrawRoundedRectSDF (ctx, mPos.x() + mHighlightedRange.first * mSize.x(), center.y() - 3 + 1,
+                             mSize.x() * (mHighlightedRange.second - mHighlightedRange.first), 6, 2);
    }
    NVGpaint knobShadow = nvgRadialGradient (ctx,
                          knobPos.x(), knobPos.y(), kr - 3, kr + 3, Color (0, 64), mTheme->mTransparent);
-   nvgBeginPath (ctx);
-   nvgRect (ctx, knobPos.x() - kr - 5, knobPos.y() - kr - 5, kr * 2 + 10, kr * 2 + 10 + 3);
-   nvgCircle (ctx, knobPos.x(), knobPos.y(), kr);
-   nvgPathWinding (ctx, NVG_HOLE);
    nvgFillPaint (ctx, knobShadow);
-   nvgFill (ctx);
+   nvgDrawBoxShadow (ctx, knobPos.x() - kr, knobPos.y() - kr, kr * 2, kr * 2, kr, 5);
    NVGpaint knob = nvgLinearGradient (ctx,
                                       mPos.x(), center.y() - kr, mPos.x(), center.y() + kr,
                                       mTheme->mBorderLight, mTheme->mBorderMedium);
@@ -82,18 +108,17 @@ void Slider::draw (NVGcontext * ctx)
                           mPos.x(), center.y() - kr, mPos.x(), center.y() + kr,
                           mTheme->mBorderMedium,
                           mTheme->mBorderLight);
-   nvgBeginPath (ctx);
-   nvgCircle (ctx, knobPos.x(), knobPos.y(), kr);
-   nvgStrokeColor (ctx, mTheme->mBorderDark);
+   float outer = kr + 0.5f, inner = kr;
+   nvgFillColor (ctx, mTheme->mBorderDark);
+   nvgDrawRoundedRectSDF (ctx, knobPos.x() - outer, knobPos.y() - outer, outer * 2, outer * 2, outer);
    nvgFillPaint (ctx, knob);
-   nvgStroke (ctx);
-   nvgFill (ctx);
-   nvgBeginPath (ctx);
-   nvgCircle (ctx, knobPos.x(), knobPos.y(), kr / 2);
+   nvgDrawRoundedRectSDF (ctx, knobPos.x() - inner, knobPos.y() - inner, inner * 2, inner * 2, inner);
+   outer = kr / 2 + 0.5f;
+   inner = kr / 2;
+   nvgFillPaint (ctx, knobReverse);
+   nvgDrawRoundedRectSDF (ctx, knobPos.x() - outer, knobPos.y() - outer, outer * 2, outer * 2, outer);
    nvgFillColor (ctx, Color (150, mEnabled ? 255 : 100));
-   nvgStrokePaint (ctx, knobReverse);
-   nvgStroke (ctx);
-   nvgFill (ctx);
+   nvgDrawRoundedRectSDF (ctx, knobPos.x() - inner, knobPos.y() - inner, inner * 2, inner * 2, inner);
 }
 
 NAMESPACE_END (nanogui)
@@ -12,10 +12,12 @@
 #pragma once
 
 #include "widget.h"
+#include "callback.h"
+#include <memory>
 
 NAMESPACE_BEGIN (nanogui)
 
-class  Slider : public Widget
+class  Slider final : public Widget
 {
    public:
       Slider (Widget * parent);
@@ -27,6 +29,7 @@ class  Slider : public Widget
       void setValue (float value)
       {
          mValue = value;
+         markDirty();
       }
 
       const Color & highlightColor() const
@@ -36,6 +39,7 @@ class  Slider : public Widget
       void setHighlightColor (const Color & highlightColor)
       {
          mHighlightColor = highlightColor;
+         markDirty();
       }
 
       std::pair<float, float> highlightedRange() const
@@ -45,35 +49,46 @@ class  Slider : public Widget
       void setHighlightedRange (std::pair<float, float> highlightedRange)
       {
          mHighlightedRange = highlightedRange;
+         markDirty();
       }
 
-      std::function<void (float)> callback() const
+      const Callback<void (float)> & callback() const
       {
-         return mCallback;
+         return mCallbacks.change;
       }
-      void setCallback (const std::function<void (float)> & callback)
+      void setCallback (Callback<void (float)> callback)
       {
-         mCallback = callback;
+         mCallbacks.change = std::move (callback);
       }
 
-      std::function<void (float)> finalCallback() const
+      /// Set a function called once when the user releases the slider
+      const Callback<void (float)> & finalCallback() const
       {
-         return mFinalCallback;
+         return mCallbacks.final;
       }
-      void setFinalCallback (const std::function<void (float)> & callback)
+      void setFinalCallback (Callback<void (float)> callback)
       {
-         mFinalCallback = callback;
+         mCallbacks.final = std::move (callback);
       }
 
+      /// Return whether the change callback runs at most once per frame with the latest value while dragging
+      bool callbackPerFrame() const
+      {
+         return mCallbacks.perFrame();
+      }
+      void setCallbackPerFrame (bool perFrame);
+
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
       virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual bool mouseDragSamplesEvent (const std::vector<PointerSample> & samples, const Vector2i & rel, int button,
+                                          int modifiers);
       virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
       virtual void draw (NVGcontext * ctx);
 
    protected:
       float mValue;
-      std::function<void (float)> mCallback;
-      std::function<void (float)> mFinalCallback;
+      DragCallbacks<float> mCallbacks;
+      std::shared_ptr<std::function<void()>> mFlushPoll;	// delivers held-back changes, see Screen::addPoll()
       std::pair<float, float> mHighlightedRange;
       Color mHighlightColor;
 };
@@ -0,0 +1,115 @@
+/*
+    src/spatialgrid.cpp -- Uniform grid over the child rectangles of a widget
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "spatialgrid.h"
+#include "widget.h"
+#include <cmath>
+#include <limits>
+
+NAMESPACE_BEGIN (nanogui)
+
+static const int maxCellsPerAxis = 256;
+
+void SpatialGrid::build (const std::vector<Widget *> & children)
+{
+   mCellStart.clear();
+   mIndices.clear();
+   mCells = Vector2i::Zero();
+   Vector2i lo = Vector2i::Constant (std::numeric_limits<int>::max());
+   Vector2i hi = Vector2i::Constant (std::numeric_limits<int>::min());
+   int count = 0;
+   for (auto child : children)
+   {
+      if (child->width() <= 0 || child->height() <= 0)
+         continue;
+      lo = lo.cwiseMin (child->position());
+      hi = hi.cwiseMax (child->position() + child->size());
+      count++;
+   }
+   if (count == 0)
+      return;
+   /* Roughly one child per cell, with square-ish cells */
+   Vector2i extent = hi - lo;
+   int cx = (int) std::ceil (std::sqrt (count * (float) extent.x() / extent.y()));
+   cx = std::max (1, std::min (cx, std::min (extent.x(), maxCellsPerAxis)));
+   int cy = std::max (1, std::min ((count + cx - 1) / cx, std::min (extent.y(), maxCellsPerAxis)));
+   mOrigin = lo;
+   mCells = Vector2i (cx, cy);
+   mCellSize = Vector2i ((extent.x() + cx - 1) / cx, (extent.y() + cy - 1) / cy);
+   /* Two passes: count the entries of every cell, then fill them in child order */
+   mCellStart.assign (cx * cy + 1, 0);
+   for (int pass = 0; pass < 2; ++pass)
+   {
+      for (int i = 0; i < (int) children.size(); ++i)
+      {
+         const Widget * child = children[i];
+         if (child->width() <= 0 || child->height() <= 0)
+            continue;
+         Vector2i c0 = (child->position() - mOrigin).cwiseQuotient (mCellSize);
+         Vector2i c1 = (child->position() + child->size() - Vector2i::Ones() - mOrigin).cwiseQuotient (mCellSize);
+         for (int y = c0.y(); y <= c1.y(); ++y)
+            for (int x = c0.x(); x <= c1.x(); ++x)
+            {
+               if (pass == 0)
+                  mCellStart[y * cx + x + 1]++;
+               else
+                  mIndices[mCellStart[y * cx + x]++] = i;
+            }
+      }
+      if (pass == 0)
+      {
+         for (int c = 0; c < cx * cy; ++c)
+            mCellStart[c + 1] += mCellStart[c];
+         mIndices.resize (mCellStart.back());
+      }
+   }
+   /* The fill pass advanced every start to the next cell's start */
+   for (int c = cx * cy; c > 0; --c)
+      mCellStart[c] = mCellStart[c - 1];
+   mCellStart[0] = 0;
+}
+
+void SpatialGrid::cell (const Vector2i & p, const int *& begin, const int *& end) const
+{
+   begin = end = nullptr;
+   if (mCells.x() == 0)
+      return;
+   Vector2i d = p - mOrigin;
+   if ((d.array() < 0).any())
+      return;
+   Vector2i c = d.cwiseQuotient (mCellSize);
+   if ((c.array() >= mCells.array()).any())
+      return;
+   int index = c.y() * mCells.x() + c.x();
+   begin = mIndices.data() + mCellStart[index];
+   end = mIndices.data() + mCellStart[index + 1];
+}
+
+SpatialGrid::Candidates SpatialGrid::query (const Vector2i & p, const Vector2i & q) const
+{
+   Candidates result;
+   cell (p, result.mABegin, result.mA);
+   cell (q, result.mBBegin, result.mB);
+   /* Both points in the same cell: walk it only once */
+   if (result.mBBegin == result.mABegin)
+      result.mBBegin = result.mB = nullptr;
+   return result;
+}
+
+SpatialGrid::Candidates SpatialGrid::all (int count)
+{
+   Candidates result;
+   result.mAll = true;
+   result.mRemaining = count;
+   return result;
+}
+
+NAMESPACE_END (nanogui)
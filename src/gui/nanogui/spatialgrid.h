@@ -0,0 +1,75 @@
+/*
+    nanogui/spatialgrid.h -- Uniform grid over the child rectangles of a widget
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <algorithm>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Uniform grid accelerating point queries over the children of a widget
+
+   Every cell lists, in ascending order, the indices of the children whose
+   rectangle overlaps it. A point query therefore only has to test the few
+   children sharing its cell instead of all of them. The grid only looks at
+   the rectangles; visibility is checked by the caller.
+*/
+class  SpatialGrid
+{
+   public:
+      /// Walks the children that may contain one or two points, topmost (highest index) first
+      class Candidates
+      {
+         public:
+            /// Return the next child index, or -1 once all candidates were visited
+            int next()
+            {
+               if (mAll)
+                  return mRemaining > 0 ? --mRemaining : -1;
+               int a = mA != mABegin ? mA[-1] : -1, b = mB != mBBegin ? mB[-1] : -1;
+               int index = std::max (a, b);
+               if (index < 0)
+                  return -1;
+               if (a == index)
+                  --mA;
+               if (b == index)
+                  --mB;
+               return index;
+            }
+
+         private:
+            friend class SpatialGrid;
+            const int * mABegin = nullptr, * mA = nullptr;
+            const int * mBBegin = nullptr, * mB = nullptr;
+            bool mAll = false;
+            int mRemaining = 0;
+      };
+
+      /// Rebuild the grid from the rectangles of the given widgets
+      void build (const std::vector<Widget *> & children);
+
+      /// Children whose rectangle may contain \c p or \c q, each reported once
+      Candidates query (const Vector2i & p, const Vector2i & q) const;
+      /// Every one of \c count children, for containers without a grid
+      static Candidates all (int count);
+
+   protected:
+      void cell (const Vector2i & p, const int *& begin, const int *& end) const;
+
+      Vector2i mOrigin = Vector2i::Zero(), mCellSize = Vector2i::Ones(), mCells = Vector2i::Zero();
+      std::vector<int> mCellStart;	// mCells.prod() + 1 offsets into mIndices
+      std::vector<int> mIndices;
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,93 @@
+/*
+    nanogui/stringtable.h -- Immutable list of strings packed into a
+    single buffer
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Strings stored back to back, each followed by a null character
+
+   Holds thousands of item labels in two allocations instead of one per
+   string. Entries are read as C strings, which the text functions of NanoVG
+   take directly.
+*/
+class  StringTable
+{
+   public:
+      StringTable() {}
+      StringTable (const std::vector<std::string> & strings)
+      {
+         assign (strings);
+      }
+
+      void assign (const std::vector<std::string> & strings)
+      {
+         size_t total = 0;
+         for (const auto & str : strings)
+            total += str.size() + 1;
+         mData.clear();
+         mData.reserve (total);
+         mOffsets.clear();
+         mOffsets.reserve (strings.size() + 1);
+         for (const auto & str : strings)
+         {
+            mOffsets.push_back ((uint32_t) mData.size());
+            mData.append (str.c_str(), str.size() + 1);
+         }
+         mOffsets.push_back ((uint32_t) mData.size());
+      }
+      void clear()
+      {
+         mData.clear();
+         mOffsets.clear();
+      }
+
+      int size() const
+      {
+         return mOffsets.empty() ? 0 : (int) mOffsets.size() - 1;
+      }
+      bool empty() const
+      {
+         return size() == 0;
+      }
+
+      const char * operator[] (int index) const
+      {
+         return mData.data() + mOffsets[index];
+      }
+      /// Return the length of an entry without its null character
+      size_t length (int index) const
+      {
+         return mOffsets[index + 1] - mOffsets[index] - 1;
+      }
+      std::string str (int index) const
+      {
+         return std::string ((*this)[index], length (index));
+      }
+
+      bool operator== (const StringTable & other) const
+      {
+         return mOffsets == other.mOffsets && mData == other.mData;
+      }
+
+   protected:
+      std::string mData;
+      std::vector<uint32_t> mOffsets;	// start of every entry and the end of the last one
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,505 @@
+/*
+    src/tableview.cpp -- Virtualized table that draws only the visible
+    cells, with sorting, filtering and a single editor
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "tableview.h"
+#include "textbox.h"
+#include "theme.h"
+#include "entypo.h"
+#include "numberformat.h"
+#include <cstring>
+
+NAMESPACE_BEGIN (nanogui)
+
+static const int scrollbarWidth = 12;
+static const int cellPadding = 4;
+/* Cells longer than this are cut off */
+static const int cellBufferSize = 256;
+
+int TableModel::compare (int column, int a, int b) const
+{
+   char bufA[cellBufferSize], bufB[cellBufferSize];
+   int lengthA = std::max (0, std::min (format (a, column, bufA, cellBufferSize), cellBufferSize - 1));
+   int lengthB = std::max (0, std::min (format (b, column, bufB, cellBufferSize), cellBufferSize - 1));
+   /* Numbers order by value, so that 10 follows 9 */
+   double valueA, valueB;
+   if (parseFloat (bufA, bufA + lengthA, valueA) && parseFloat (bufB, bufB + lengthB, valueB))
+      return valueA < valueB ? -1 : (valueB < valueA ? 1 : 0);
+   return std::strcmp (bufA, bufB);
+}
+
+/* Track and knob of a scrollbar along x when horizontal, along y otherwise */
+static void drawScrollbar (NVGcontext * ctx, float x, float y, float length, float visible,
+                           float content, float offset, bool horizontal)
+{
+   float knobLength = length * std::min (1.0f, visible / std::max (1.0f, content));
+   float knob = (length - knobLength) * std::min (1.0f, offset / std::max (1.0f, content - visible));
+   float w = horizontal ? length : 8, h = horizontal ? 8 : length;
+   NVGpaint paint = nvgBoxGradient (ctx, x + 1, y + 1, w, h, 3, 4, Color (0, 32), Color (0, 92));
+   nvgFillPaint (ctx, paint);
+   nvgDrawRoundedRectSDF (ctx, x, y, w, h, 3);
+   float kx = horizontal ? x + knob : x, ky = horizontal ? y : y + knob;
+   float kw = horizontal ? knobLength : 8, kh = horizontal ? 8 : knobLength;
+   paint = nvgBoxGradient (ctx, kx - 1, ky - 1, kw, kh, 3, 4, Color (220, 100), Color (128, 100));
+   nvgFillPaint (ctx, paint);
+   nvgDrawRoundedRectSDF (ctx, kx + 1, ky + 1, kw - 2, kh - 2, 2);
+}
+
+TableView::TableView (Widget * parent)
+   : Widget (parent), mEditor (nullptr), mEditRow (-1), mEditColumn (-1), mSelectedRow (-1),
+     mSelectedColumn (-1), mSortColumn (-1), mSortAscending (true), mRowHeight (20),
+     mHeaderHeight (24), mDragAxis (0), mScrollOffset (Vector2f::Zero())
+{
+   mColumnOffsets.push_back (0);
+}
+
+void TableView::setModel (TableModel * model)
+{
+   mModel = model;
+   mSelectedRow = mSelectedColumn = -1;
+   updateOrder();
+}
+
+void TableView::modelChanged()
+{
+   updateOrder();
+}
+
+void TableView::setColumns (const std::vector<TableColumn> & columns)
+{
+   mColumns = columns;
+   mColumnOffsets.assign (1, 0);
+   for (auto & column : mColumns)
+      mColumnOffsets.push_back (mColumnOffsets.back() + std::max (0, column.width));
+   if (mSortColumn >= (int) mColumns.size())
+      mSortColumn = -1;
+   if (mSelectedColumn >= (int) mColumns.size())
+      mSelectedRow = mSelectedColumn = -1;
+   updateOrder();
+}
+
+void TableView::setColumnWidth (int column, int width)
+{
+   if (column < 0 || column >= (int) mColumns.size())
+      return;
+   mColumns[column].width = std::max (0, width);
+   for (size_t i = column; i < mColumns.size(); ++i)
+      mColumnOffsets[i + 1] = mColumnOffsets[i] + mColumns[i].width;
+   setScrollOffset (mScrollOffset);
+   placeEditor();
+   markDirty();
+}
+
+void TableView::setRowHeight (int rowHeight)
+{
+   mRowHeight = std::max (0, rowHeight);
+   updateOrder();
+}
+
+void TableView::sortByColumn (int column, bool ascending)
+{
+   mSortColumn = column >= 0 && column < (int) mColumns.size() ? column : -1;
+   mSortAscending = ascending;
+   updateOrder();
+}
+
+void TableView::setFilter (Callback<bool (int row)> filter)
+{
+   mFilter = std::move (filter);
+   updateOrder();
+}
+
+void TableView::updateOrder()
+{
+   mOrder.clear();
+   int count = mModel ? mModel->rowCount() : 0;
+   mOrder.reserve (count);
+   for (int row = 0; row < count; ++row)
+      if (!mFilter || mFilter (row))
+         mOrder.push_back (row);
+   if (mSortColumn >= 0 && mModel)
+   {
+      const TableModel * model = mModel.get();
+      int column = mSortColumn;
+      bool ascending = mSortAscending;
+      std::stable_sort (mOrder.begin(), mOrder.end(), [model, column, ascending] (int a, int b)
+      {
+         int order = model->compare (column, a, b);
+         return ascending ? order < 0 : order > 0;
+      });
+   }
+   mRowOffsets.clear();
+   if (mRowHeight == 0)
+   {
+      mRowOffsets.reserve (mOrder.size() + 1);
+      mRowOffsets.push_back (0);
+      for (int row : mOrder)
+         mRowOffsets.push_back (mRowOffsets.back() + std::max (1, mModel->rowHeight (row)));
+   }
+   setScrollOffset (mScrollOffset);
+   placeEditor();
+   markDirty();
+}
+
+int TableView::rowAt (float y) const
+{
+   int count = shownRows();
+   if (count == 0)
+      return -1;
+   int index = mRowHeight > 0 ? (int) std::floor (y / mRowHeight)
+               : (int) (std::upper_bound (mRowOffsets.begin(), mRowOffsets.end(), (int) std::floor (y)) - mRowOffsets.begin()) - 1;
+   return std::max (0, std::min (index, count - 1));
+}
+
+int TableView::columnAt (float x) const
+{
+   if (x < 0 || x >= mColumnOffsets.back())
+      return -1;
+   return (int) (std::upper_bound (mColumnOffsets.begin(), mColumnOffsets.end(), (int) std::floor (x)) - mColumnOffsets.begin()) - 1;
+}
+
+int TableView::shownIndex (int row) const
+{
+   auto it = std::find (mOrder.begin(), mOrder.end(), row);
+   return it == mOrder.end() ? -1 : (int) (it - mOrder.begin());
+}
+
+Vector2f TableView::cellArea() const
+{
+   float width = (float) (mSize.x() - scrollbarWidth);
+   bool horizontal = mColumnOffsets.back() > width;
+   return Vector2f (width, (float) (mSize.y() - mHeaderHeight - (horizontal ? scrollbarWidth : 0)));
+}
+
+void TableView::setScrollOffset (const Vector2f & offset)
+{
+   Vector2f area = cellArea();
+   float maxX = std::max (0.0f, mColumnOffsets.back() - area.x());
+   float maxY = std::max (0.0f, rowTop (shownRows()) - area.y());
+   Vector2f clamped (std::max (0.0f, std::min (offset.x(), maxX)), std::max (0.0f, std::min (offset.y(), maxY)));
+   if (clamped == mScrollOffset)
+      return;
+   mScrollOffset = clamped;
+   placeEditor();
+   markDirty();
+}
+
+void TableView::scrollToCell (int row, int column)
+{
+   int index = shownIndex (row);
+   if (index < 0)
+      return;
+   Vector2f area = cellArea();
+   Vector2f offset = mScrollOffset;
+   float top = (float) rowTop (index), bottom = (float) rowTop (index + 1);
+   if (top < offset.y())
+      offset.y() = top;
+   else
+      if (bottom > offset.y() + area.y())
+         offset.y() = bottom - area.y();
+   if (column >= 0 && column < (int) mColumns.size())
+   {
+      float left = (float) columnLeft (column), right = (float) columnLeft (column + 1);
+      if (left < offset.x())
+         offset.x() = left;
+      else
+         if (right > offset.x() + area.x())
+            offset.x() = right - area.x();
+   }
+   setScrollOffset (offset);
+}
+
+void TableView::setSelected (int row, int column)
+{
+   mSelectedRow = row;
+   mSelectedColumn = column;
+   markDirty();
+}
+
+bool TableView::edit (int row, int column)
+{
+   if (!mModel || column < 0 || column >= (int) mColumns.size() || shownIndex (row) < 0 ||
+         !mModel->editable (row, column))
+      return false;
+   if (!mEditor)
+   {
+      mEditor = new TextBox (this, "");
+      mEditor->setEditable (true);
+      mEditor->setCallback ([this] (const std::string & text) -> bool
+      {
+         /* Called when the editor loses focus, the cell is closed before the model sees the text */
+         if (mEditRow < 0)
+            return true;
+         int editRow = mEditRow, editColumn = mEditColumn;
+         mEditRow = mEditColumn = -1;
+         mEditor->setVisible (false);
+         markDirty();
+         return mModel && mModel->setText (editRow, editColumn, text);
+      });
+   }
+   scrollToCell (row, column);
+   char buf[cellBufferSize];
+   int length = std::max (0, std::min (mModel->format (row, column, buf, cellBufferSize), cellBufferSize - 1));
+   buf[length] = '\0';
+   mEditor->setValue (buf);
+   mEditRow = row;
+   mEditColumn = column;
+   mEditor->setVisible (true);
+   placeEditor();
+   mEditor->requestFocus();
+   return true;
+}
+
+void TableView::placeEditor()
+{
+   if (!mEditor || mEditRow < 0)
+      return;
+   int index = shownIndex (mEditRow);
+   if (index < 0 || mEditColumn >= (int) mColumns.size())
+   {
+      mEditRow = mEditColumn = -1;
+      mEditor->setVisible (false);
+      return;
+   }
+   mEditor->setPosition (Vector2i (columnLeft (mEditColumn) - (int) mScrollOffset.x(),
+                                   mHeaderHeight + rowTop (index) - (int) mScrollOffset.y()));
+   mEditor->setSize (Vector2i (mColumns[mEditColumn].width, rowTop (index + 1) - rowTop (index)));
+}
+
+Vector2i TableView::preferredSize (NVGcontext *) const
+{
+   return Vector2i (mColumnOffsets.back() + scrollbarWidth, mHeaderHeight + rowTop (shownRows()));
+}
+
+bool TableView::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
+{
+   if (mEditor && mEditor->visible() && mEditor->contains (p - mPos))
+      return Widget::mouseButtonEvent (p, button, down, modifiers);
+   if (button != MOUSE_BUTTON_LEFT)
+      return false;
+   if (!down)
+   {
+      mDragAxis = 0;
+      return true;
+   }
+   /* Taking the focus closes the editor, so the model has the edited text before anything else happens */
+   if (!focused())
+      requestFocus();
+   Vector2f area = cellArea();
+   float x = (float) (p.x() - mPos.x()), y = (float) (p.y() - mPos.y());
+   if (x >= area.x())
+   {
+      mDragAxis = 1;
+      return true;
+   }
+   if (y >= mHeaderHeight + area.y())
+   {
+      mDragAxis = 2;
+      return true;
+   }
+   int column = columnAt (x + mScrollOffset.x());
+   if (column < 0)
+      return true;
+   if (y < mHeaderHeight)
+   {
+      sortByColumn (column, column == mSortColumn ? !mSortAscending : true);
+      return true;
+   }
+   float contentY = y - mHeaderHeight + mScrollOffset.y();
+   if (contentY >= rowTop (shownRows()))
+      return true;
+   int row = mOrder[rowAt (contentY)];
+   if (row == mSelectedRow && column == mSelectedColumn)
+      edit (row, column);
+   else
+   {
+      setSelected (row, column);
+      if (mCallback)
+         mCallback (row, column);
+   }
+   return true;
+}
+
+bool TableView::mouseDragEvent (const Vector2i &, const Vector2i & rel, int, int)
+{
+   Vector2f area = cellArea();
+   if (mDragAxis == 1)
+   {
+      float content = (float) rowTop (shownRows());
+      float track = (area.y() - 8) * (1.0f - std::min (1.0f, area.y() / std::max (1.0f, content)));
+      if (track > 0)
+         setScrollOffset (Vector2f (mScrollOffset.x(), mScrollOffset.y() + rel.y() * (content - area.y()) / track));
+      return true;
+   }
+   if (mDragAxis == 2)
+   {
+      float content = (float) mColumnOffsets.back();
+      float track = (area.x() - 8) * (1.0f - std::min (1.0f, area.x() / std::max (1.0f, content)));
+      if (track > 0)
+         setScrollOffset (Vector2f (mScrollOffset.x() + rel.x() * (content - area.x()) / track, mScrollOffset.y()));
+      return true;
+   }
+   return false;
+}
+
+bool TableView::scrollEvent (const Vector2i &, const Vector2f & rel)
+{
+   float step = (float) (mRowHeight > 0 ? mRowHeight : 20);
+   setScrollOffset (mScrollOffset - Vector2f (rel.x() * 3 * step, rel.y() * 3 * step));
+   return true;
+}
+
+bool TableView::keyboardEvent (int key, int scancode, int action, int modifiers)
+{
+   if (!focused() || (action != PRESS && action != REPEAT) || !mModel || mOrder.empty() || mColumns.empty())
+      return Widget::keyboardEvent (key, scancode, action, modifiers);
+   int index = mSelectedRow < 0 ? -1 : shownIndex (mSelectedRow);
+   int column = mSelectedColumn;
+   if (key == KEY_RETURN || key == KEY_KP_ENTER)
+      return index >= 0 && edit (mSelectedRow, mSelectedColumn);
+   if (key == KEY_UP)
+      index = std::max (0, index - 1);
+   else
+      if (key == KEY_DOWN)
+         index = std::min (shownRows() - 1, index + 1);
+      else
+         if (key == KEY_LEFT)
+            column = std::max (0, column - 1);
+         else
+            if (key == KEY_RIGHT)
+               column = std::min ((int) mColumns.size() - 1, column + 1);
+            else
+               return Widget::keyboardEvent (key, scancode, action, modifiers);
+   index = std::max (0, index);
+   column = std::max (0, column);
+   setSelected (mOrder[index], column);
+   scrollToCell (mSelectedRow, mSelectedColumn);
+   if (mCallback)
+      mCallback (mSelectedRow, mSelectedColumn);
+   return true;
+}
+
+void TableView::draw (NVGcontext * ctx)
+{
+   Vector2f area = cellArea();
+   float left = mPos.x() - mScrollOffset.x(), top = mPos.y() + mHeaderHeight - mScrollOffset.y();
+   int rows = shownRows(), columns = (int) mColumns.size();
+   nvgSave (ctx);
+   nvgIntersectScissor (ctx, mPos.x(), mPos.y() + mHeaderHeight, area.x(), area.y());
+   if (rows > 0 && columns > 0)
+   {
+      int firstRow = rowAt (mScrollOffset.y()), lastRow = rowAt (mScrollOffset.y() + area.y());
+      int firstColumn = std::max (0, columnAt (mScrollOffset.x()));
+      int lastColumn = columnAt (mScrollOffset.x() + area.x());
+      if (lastColumn < 0)
+         lastColumn = columns - 1;
+      float width = (float) std::min (mColumnOffsets.back(), (int) (mScrollOffset.x() + area.x())) - mScrollOffset.x();
+
+      /* Stripes and the selection under the text */
+      nvgBeginPath (ctx);
+      for (int i = firstRow; i <= lastRow; ++i)
+         if (i % 2)
+            nvgRect (ctx, mPos.x(), top + rowTop (i), width, rowTop (i + 1) - rowTop (i));
+      nvgFillColor (ctx, Color (255, 8));
+      nvgFill (ctx);
+      for (int i = firstRow; i <= lastRow; ++i)
+         if (mOrder[i] == mSelectedRow)
+         {
+            float y = top + rowTop (i), h = (float) (rowTop (i + 1) - rowTop (i));
+            nvgBeginPath (ctx);
+            nvgRect (ctx, mPos.x(), y, width, h);
+            nvgFillColor (ctx, Color (255, 16));
+            nvgFill (ctx);
+            if (mSelectedColumn >= 0 && mSelectedColumn < columns)
+            {
+               nvgBeginPath (ctx);
+               nvgRect (ctx, left + columnLeft (mSelectedColumn), y, mColumns[mSelectedColumn].width, h);
+               nvgFillColor (ctx, Color (255, 32));
+               nvgFill (ctx);
+            }
+         }
+
+      /* Column by column, so that one scissor clips all of its cells */
+      char buf[cellBufferSize];
+      nvgFontSize (ctx, fontSize());
+      nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
+      nvgFillColor (ctx, mTheme->mTextColor);
+      for (int c = firstColumn; c <= lastColumn; ++c)
+      {
+         const TableColumn & column = mColumns[c];
+         float x = left + columnLeft (c);
+         float tx = column.align & NVG_ALIGN_RIGHT ? x + column.width - cellPadding
+                    : (column.align & NVG_ALIGN_CENTER ? x + column.width * 0.5f : x + cellPadding);
+         nvgSave (ctx);
+         nvgIntersectScissor (ctx, x, mPos.y() + mHeaderHeight, column.width, area.y());
+         nvgTextAlign (ctx, column.align | NVG_ALIGN_MIDDLE);
+         for (int i = firstRow; i <= lastRow; ++i)
+         {
+            int row = mOrder[i];
+            if (row == mEditRow && c == mEditColumn)
+               continue;
+            int length = std::max (0, std::min (mModel->format (row, c, buf, cellBufferSize), cellBufferSize - 1));
+            buf[length] = '\0';
+            float y = top + rowTop (i), h = (float) (rowTop (i + 1) - rowTop (i));
+            if (mRenderer)
+               mRenderer (ctx, Vector2f (x, y), Vector2f ((float) column.width, h), row, c, buf);
+            else
+               nvgText (ctx, tx, y + h * 0.5f, buf, buf + length);
+         }
+         nvgRestore (ctx);
+      }
+   }
+   Widget::draw (ctx);
+   nvgRestore (ctx);
+
+   if (mHeaderHeight > 0)
+   {
+      nvgSave (ctx);
+      nvgIntersectScissor (ctx, mPos.x(), mPos.y(), area.x(), mHeaderHeight);
+      nvgBeginPath (ctx);
+      nvgRect (ctx, mPos.x(), mPos.y(), area.x(), mHeaderHeight);
+      nvgFillColor (ctx, mTheme->mButtonGradientBotUnfocused);
+      nvgFill (ctx);
+      float y = mPos.y() + mHeaderHeight * 0.5f;
+      nvgFontSize (ctx, fontSize());
+      nvgFontFaceId (ctx, mTheme->mFontBold.id (ctx));
+      nvgFillColor (ctx, mTheme->mTextColor);
+      nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+      for (int c = 0; c < columns; ++c)
+      {
+         float x = left + columnLeft (c);
+         if (x + mColumns[c].width < mPos.x() || x > mPos.x() + area.x())
+            continue;
+         nvgText (ctx, x + cellPadding, y, mColumns[c].title.c_str(), nullptr);
+      }
+      if (mSortColumn >= 0)
+      {
+         nvgFontFaceId (ctx, mTheme->mFontIcons.id (ctx));
+         nvgTextAlign (ctx, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE);
+         nvgIcon (ctx, left + columnLeft (mSortColumn + 1) - cellPadding, y,
+                  mSortAscending ? ENTYPO_ICON_CHEVRON_UP : ENTYPO_ICON_CHEVRON_DOWN);
+      }
+      nvgBeginPath (ctx);
+      nvgMoveTo (ctx, mPos.x(), mPos.y() + mHeaderHeight - 0.5f);
+      nvgLineTo (ctx, mPos.x() + area.x(), mPos.y() + mHeaderHeight - 0.5f);
+      nvgStrokeColor (ctx, mTheme->mBorderDark);
+      nvgStroke (ctx);
+      nvgRestore (ctx);
+   }
+
+   drawScrollbar (ctx, mPos.x() + mSize.x() - scrollbarWidth, mPos.y() + mHeaderHeight + 4, area.y() - 8,
+                  area.y(), (float) rowTop (rows), mScrollOffset.y(), false);
+   if (mColumnOffsets.back() > area.x())
+      drawScrollbar (ctx, mPos.x() + 4, mPos.y() + mHeaderHeight + area.y() + 2, area.x() - 8,
+                     area.x(), (float) mColumnOffsets.back(), mScrollOffset.x(), true);
+}
+
+NAMESPACE_END (nanogui)
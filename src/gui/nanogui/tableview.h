@@ -0,0 +1,260 @@
+/*
+    nanogui/tableview.h -- Virtualized table that draws only the visible
+    cells, with sorting, filtering and a single editor
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include "callback.h"
+#include "../nanovg/nanovg.h"
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+class TextBox;
+
+/**
+   \brief Cells shown by a \ref TableView
+
+   Rows and columns are indices into the application's data. Cells are asked
+   for their text only while visible, and write it into a buffer of the view,
+   e.g. with \ref formatFloat(), so drawing a cell allocates nothing.
+*/
+class  TableModel : public Object
+{
+   public:
+      /// Return the number of rows
+      virtual int rowCount() const = 0;
+      /// Write the text of a cell and a null character into \c buf of \c size bytes, return the length
+      virtual int format (int row, int column, char * buf, int size) const = 0;
+
+      /// Return whether a cell can be edited
+      virtual bool editable (int, int) const
+      {
+         return false;
+      }
+      /// Store the edited text of a cell, return false to reject it
+      virtual bool setText (int, int, const std::string &)
+      {
+         return false;
+      }
+      /// Order two rows by a column, negative if \c a comes first; the default compares the text
+      virtual int compare (int column, int a, int b) const;
+      /// Height of a row, used when the view measures its rows, see \ref TableView::setRowHeight()
+      virtual int rowHeight (int) const
+      {
+         return 0;
+      }
+
+   protected:
+      virtual ~TableModel() { }
+};
+
+/// Column of a \ref TableView
+struct TableColumn
+{
+   std::string title;
+   int width;
+   /// Horizontal alignment of the text, NVG_ALIGN_LEFT, NVG_ALIGN_CENTER or NVG_ALIGN_RIGHT
+   int align;
+
+   TableColumn (const std::string & title = "", int width = 80, int align = NVG_ALIGN_LEFT)
+      : title (title), width (width), align (align) {}
+};
+
+/**
+   \brief Scrolling table of model cells with a header row
+
+   No widget exists per cell: the view draws the cells within the visible
+   rows and columns, clipped by column, through the cell renderer or as
+   plain text. The rows are shown through a permutation of the model rows,
+   so sorting by a column and filtering only reorder indices. Clicking a
+   selected editable cell, or pressing return, opens the one text box the
+   view owns over that cell; the model receives the text once it loses
+   focus.
+
+   Rows are \ref rowHeight() pixels high, or when that is zero as high as
+   \ref TableModel::rowHeight() says, which is asked once per row whenever
+   the rows are ordered and kept as running offsets.
+
+   \code
+   TableView * table = new TableView (window);
+   table->setFixedSize (Vector2i (800, 500));
+   table->setColumns ({ { "Channel", 60 }, { "Dimmer", 60, NVG_ALIGN_RIGHT }, { "Pan", 60, NVG_ALIGN_RIGHT } });
+   table->setModel (new PatchModel (patch));
+   table->sortByColumn (1, false);
+   \endcode
+*/
+class  TableView : public Widget
+{
+   public:
+      /// Draws a cell within the given rectangle, in place of the plain text
+      typedef Callback<void (NVGcontext * ctx, const Vector2f & pos, const Vector2f & size,
+                             int row, int column, const char * text)> CellRenderer;
+
+      TableView (Widget * parent);
+
+      /// Return the model
+      TableModel * model()
+      {
+         return mModel;
+      }
+      /// Return the model
+      const TableModel * model() const
+      {
+         return mModel.get();
+      }
+      /// Show \c model, keeping the sort column and the filter
+      void setModel (TableModel * model);
+      /// Order and measure the rows again after rows of the model were added, removed or changed
+      void modelChanged();
+
+      /// Return the columns
+      const std::vector<TableColumn> & columns() const
+      {
+         return mColumns;
+      }
+      /// Set the columns
+      void setColumns (const std::vector<TableColumn> & columns);
+      /// Set the width of a column
+      void setColumnWidth (int column, int width);
+
+      /// Return the height of a row, zero if the rows are measured
+      int rowHeight() const
+      {
+         return mRowHeight;
+      }
+      /// Set the height of all rows, or zero to measure them with \ref TableModel::rowHeight()
+      void setRowHeight (int rowHeight);
+
+      /// Return the height of the header row
+      int headerHeight() const
+      {
+         return mHeaderHeight;
+      }
+      /// Set the height of the header row, zero hides it
+      void setHeaderHeight (int height)
+      {
+         mHeaderHeight = std::max (0, height);
+         markDirty();
+      }
+
+      /// Set the function drawing the cells, nullptr draws their text
+      void setCellRenderer (CellRenderer renderer)
+      {
+         mRenderer = std::move (renderer);
+         markDirty();
+      }
+
+      /// Sort the rows by \c column, or restore the model order with -1
+      void sortByColumn (int column, bool ascending = true);
+      /// Return the column the rows are sorted by, -1 if none
+      int sortColumn() const
+      {
+         return mSortColumn;
+      }
+      /// Show only the model rows for which \c filter returns true, nullptr shows all
+      void setFilter (Callback<bool (int row)> filter);
+
+      /// Return the number of shown rows
+      int shownRows() const
+      {
+         return (int) mOrder.size();
+      }
+      /// Return the model row shown at \c index
+      int modelRow (int index) const
+      {
+         return mOrder[index];
+      }
+
+      /// Return the selected model row, -1 if none
+      int selectedRow() const
+      {
+         return mSelectedRow;
+      }
+      /// Return the selected column, -1 if none
+      int selectedColumn() const
+      {
+         return mSelectedColumn;
+      }
+      /// Select a cell by model row without calling the callback
+      void setSelected (int row, int column);
+      /// Set the function called with the model row and column of a cell that was clicked
+      void setCallback (Callback<void (int row, int column)> callback)
+      {
+         mCallback = std::move (callback);
+      }
+
+      /// Open the editor over a cell by model row, return false if it is not shown or not editable
+      bool edit (int row, int column);
+
+      /// Return the scroll offsets in pixels
+      const Vector2f & scrollOffset() const
+      {
+         return mScrollOffset;
+      }
+      /// Set the scroll offsets in pixels, clamped to the scrollable range
+      void setScrollOffset (const Vector2f & offset);
+      /// Scroll so that the cell of a model row is visible
+      void scrollToCell (int row, int column);
+
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
+      virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual bool scrollEvent (const Vector2i & p, const Vector2f & rel);
+      virtual bool keyboardEvent (int key, int scancode, int action, int modifiers);
+      virtual void draw (NVGcontext * ctx);
+
+   protected:
+      /// Rebuild the permutation, and the row offsets if the rows are measured
+      void updateOrder();
+      /// Top of the shown row \c index relative to the first row
+      int rowTop (int index) const
+      {
+         return mRowHeight > 0 ? index * mRowHeight : mRowOffsets[index];
+      }
+      /// Shown row at \c y relative to the first row, clamped to the shown rows
+      int rowAt (float y) const;
+      /// Left of a column relative to the first column
+      int columnLeft (int column) const
+      {
+         return mColumnOffsets[column];
+      }
+      /// Column at \c x relative to the first column, -1 past the last
+      int columnAt (float x) const;
+      /// Shown index of a model row, -1 if it is filtered out
+      int shownIndex (int row) const;
+      /// Size of the area below the header that shows cells
+      Vector2f cellArea() const;
+      /// Move the editor over its cell, or close it if the cell is gone
+      void placeEditor();
+
+      ref<TableModel> mModel;
+      std::vector<TableColumn> mColumns;
+      std::vector<int> mColumnOffsets;	// left of every column, and the total width at the end
+      std::vector<int> mOrder;	// model row of every shown row
+      std::vector<int> mRowOffsets;	// top of every shown row and the total height, when measured
+      Callback<bool (int row)> mFilter;
+      Callback<void (int row, int column)> mCallback;
+      CellRenderer mRenderer;
+      TextBox * mEditor;
+      int mEditRow, mEditColumn;
+      int mSelectedRow, mSelectedColumn;
+      int mSortColumn;
+      bool mSortAscending;
+      int mRowHeight;
+      int mHeaderHeight;
+      int mDragAxis;	// scrollbar pressed last, 0 for none, 1 for the vertical one, 2 for the horizontal one
+      Vector2f mScrollOffset;
+};
+
+NAMESPACE_END (nanogui)
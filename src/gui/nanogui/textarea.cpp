@@ -0,0 +1,608 @@
+/*
+    src/textarea.cpp -- Multi-line text field for logs, notes and code
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "textarea.h"
+#include "../nanovg/nanovg.h"
+#include "theme.h"
+#include <algorithm>
+#include <cmath>
+#include <cinder/Clipboard.h>
+
+NAMESPACE_BEGIN (nanogui)
+
+namespace
+{
+   // Space between the border and the text
+   const float padding = 5.0f;
+}
+
+TextArea::TextArea (Widget * parent, const std::string & value)
+   : Widget (parent)
+{
+   setCursor (Cursor::IBeam);
+   setValue (value);
+}
+
+void TextArea::setValue (const std::string & value)
+{
+   mText.assign (value);
+   mLayout.assign (mText.lineCount(), LineLayout());
+   rebuildRows();
+   mCursor = 0;
+   mSelection = std::string::npos;
+   rowsChanged();
+   markDirty();
+}
+
+void TextArea::append (const std::string & text)
+{
+   insertText (mText.size(), text);
+   rowsChanged();
+   markDirty();
+}
+
+void TextArea::setEditable (bool editable)
+{
+   mEditable = editable;
+   setCursor (editable ? Cursor::IBeam : Cursor::Arrow);
+}
+
+void TextArea::setWrap (bool wrap)
+{
+   if (wrap == mWrap)
+      return;
+   mWrap = wrap;
+   mLayout.assign (mText.lineCount(), LineLayout());
+   rebuildRows();
+   rowsChanged();
+}
+
+void TextArea::insertText (size_t pos, const std::string & text)
+{
+   size_t line = mText.lineOf (pos);
+   bool last = line + 1 == mText.lineCount();
+   int oldRows = rowsOf (line);
+   mText.insert (pos, text);
+   mLayout[line] = LineLayout();
+   addRows (line, 1 - oldRows);
+   size_t added = (size_t) std::count (text.begin(), text.end(), '\n');
+   if (added == 0)
+      return;
+   mLayout.insert (mLayout.begin() + line + 1, added, LineLayout());
+   if (last)
+   {
+      /* New lines at the end, e.g. of a log, extend the row index instead of rebuilding it */
+      for (size_t i = 0; i < added; ++i)
+         appendRows (1);
+   }
+   else
+      rebuildRows();
+}
+
+void TextArea::eraseText (size_t pos, size_t count)
+{
+   size_t first = mText.lineOf (pos);
+   size_t last = mText.lineOf (std::min (pos + count, mText.size()));
+   int oldRows = rowsOf (first);
+   mText.erase (pos, count);
+   mLayout[first] = LineLayout();
+   if (last > first)
+   {
+      mLayout.erase (mLayout.begin() + first + 1, mLayout.begin() + last + 1);
+      rebuildRows();
+   }
+   else
+      addRows (first, 1 - oldRows);
+}
+
+bool TextArea::deleteSelection()
+{
+   if (mSelection == std::string::npos)
+      return false;
+   size_t begin = std::min (mCursor, mSelection), end = std::max (mCursor, mSelection);
+   eraseText (begin, end - begin);
+   mCursor = begin;
+   mSelection = std::string::npos;
+   return true;
+}
+
+void TextArea::edited()
+{
+   rowsChanged();
+   markDirty();
+   if (mCallback)
+      mCallback();
+}
+
+void TextArea::rowsChanged()
+{
+   if (mTotalRows != mLayoutRows)
+   {
+      mLayoutRows = mTotalRows;
+      invalidateLayout();
+   }
+}
+
+void TextArea::rebuildRows()
+{
+   size_t n = mLayout.size();
+   mRowTree.assign (n + 1, 0);
+   mTotalRows = 0;
+   for (size_t i = 1; i <= n; ++i)
+   {
+      int rows = rowsOf (i - 1);
+      mTotalRows += rows;
+      mRowTree[i] += rows;
+      size_t parent = i + (i & (~i + 1));
+      if (parent <= n)
+         mRowTree[parent] += mRowTree[i];
+   }
+}
+
+void TextArea::addRows (size_t line, int delta)
+{
+   if (delta == 0)
+      return;
+   for (size_t i = line + 1; i < mRowTree.size(); i += i & (~i + 1))
+      mRowTree[i] += delta;
+   mTotalRows += delta;
+}
+
+void TextArea::appendRows (int rows)
+{
+   /* The new node covers the lines since the previous node of its size */
+   size_t i = mRowTree.size();
+   size_t low = i & (~i + 1);
+   mRowTree.push_back (rows + rowOfLine (i - 1) - rowOfLine (i - low));
+   mTotalRows += rows;
+}
+
+int TextArea::rowOfLine (size_t line) const
+{
+   int row = 0;
+   for (size_t i = line; i > 0; i -= i & (~i + 1))
+      row += mRowTree[i];
+   return row;
+}
+
+size_t TextArea::lineAtRow (int row) const
+{
+   size_t n = mRowTree.size() - 1, line = 0, step = 1;
+   while (step * 2 <= n)
+      step *= 2;
+   for (; step > 0; step /= 2)
+   {
+      if (line + step <= n && mRowTree[line + step] <= row)
+      {
+         line += step;
+         row -= mRowTree[line];
+      }
+   }
+   return std::min (line, n - 1);
+}
+
+void TextArea::applyFont (NVGcontext * ctx) const
+{
+   nvgFontSize (ctx, mTheme->mTextBoxFontSize);
+   nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
+   nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+}
+
+void TextArea::layoutLine (NVGcontext * ctx, size_t line)
+{
+   LineLayout & layout = mLayout[line];
+   if (layout.rows > 0)
+      return;
+   layout.breaks.clear();
+   if (mWrap)
+   {
+      std::string text = mText.substr (mText.lineStart (line), mText.lineEnd (line) - mText.lineStart (line));
+      const char * p = text.data(), * end = text.data() + text.size();
+      NVGtextRow rows[64];
+      int n;
+      while (p < end && (n = nvgTextBreakLines (ctx, p, end, mLayoutWidth, rows, 64)) > 0)
+      {
+         for (int i = 0; i < n; ++i)
+         {
+            if (layout.rows > 0)
+               layout.breaks.push_back ((int) (rows[i].start - text.data()));
+            ++layout.rows;
+         }
+         p = rows[n - 1].next;
+      }
+   }
+   layout.rows = std::max (layout.rows, 1);
+   addRows (line, layout.rows - 1);
+}
+
+int TextArea::rowInLine (size_t line, size_t pos) const
+{
+   const std::vector<int> & breaks = mLayout[line].breaks;
+   return (int) (std::upper_bound (breaks.begin(), breaks.end(), (int) pos) - breaks.begin());
+}
+
+void TextArea::rowRange (size_t line, int row, size_t & begin, size_t & end) const
+{
+   const std::vector<int> & breaks = mLayout[line].breaks;
+   begin = row > 0 ? breaks[row - 1] : 0;
+   end = row < (int) breaks.size() ? breaks[row] : mText.lineEnd (line) - mText.lineStart (line);
+}
+
+float TextArea::positionX (NVGcontext * ctx, size_t pos)
+{
+   size_t line = mText.lineOf (pos), start = mText.lineStart (line), begin, end;
+   layoutLine (ctx, line);
+   rowRange (line, rowInLine (line, pos - start), begin, end);
+   if (pos == start + begin)
+      return 0.0f;
+   std::string text = mText.substr (start + begin, pos - start - begin);
+   return nvgTextBounds (ctx, 0, 0, text.data(), text.data() + text.size(), nullptr);
+}
+
+size_t TextArea::hitTest (NVGcontext * ctx, float x, float y)
+{
+   int row = (int) std::floor ((y - mPos.y() - padding) / mLineHeight);
+   row = std::max (0, std::min (row, mTotalRows - 1));
+   return hitTestRow (ctx, row, x - mPos.x() - padding);
+}
+
+size_t TextArea::hitTestRow (NVGcontext * ctx, int row, float x)
+{
+   size_t line = lineAtRow (row), start = mText.lineStart (line), begin, end;
+   layoutLine (ctx, line);
+   int inLine = std::min (row - rowOfLine (line), mLayout[line].rows - 1);
+   rowRange (line, inLine, begin, end);
+   std::string text = mText.substr (start + begin, end - begin);
+   std::vector<NVGglyphPosition> glyphs (text.size());
+   int n = nvgTextGlyphPositions (ctx, 0, 0, text.data(), text.data() + text.size(), glyphs.data(), (int) glyphs.size());
+   for (int i = 0; i < n; ++i)
+   {
+      if (x < (glyphs[i].minx + glyphs[i].maxx) * 0.5f)
+         return start + begin + (size_t) (glyphs[i].str - text.data());
+   }
+   // Behind a wrapped row, stay in front of the character the next row starts after
+   if (inLine + 1 < mLayout[line].rows)
+      return prevChar (start + end);
+   return start + end;
+}
+
+void TextArea::moveCursor (size_t pos, bool select)
+{
+   if (select)
+   {
+      if (mSelection == std::string::npos)
+         mSelection = mCursor;
+   }
+   else
+      mSelection = std::string::npos;
+   mCursor = pos;
+   if (mSelection == mCursor)
+      mSelection = std::string::npos;
+   markDirty();
+}
+
+size_t TextArea::prevChar (size_t pos) const
+{
+   // Step over UTF-8 continuation bytes
+   while (pos > 0 && (mText.at (--pos) & 0xC0) == 0x80)
+      ;
+   return pos;
+}
+
+size_t TextArea::nextChar (size_t pos) const
+{
+   if (pos < mText.size())
+      ++pos;
+   while (pos < mText.size() && (mText.at (pos) & 0xC0) == 0x80)
+      ++pos;
+   return pos;
+}
+
+Vector2i TextArea::preferredSize (NVGcontext * ctx) const
+{
+   applyFont (ctx);
+   float lineh;
+   nvgTextMetrics (ctx, nullptr, nullptr, &lineh);
+   return Vector2i (320, (int) std::ceil (mTotalRows * lineh + 2 * padding));
+}
+
+void TextArea::draw (NVGcontext * ctx)
+{
+   Widget::draw (ctx);
+   NVGpaint bg = nvgBoxGradient (ctx,
+                                 mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
+                                 3, 4, Color (255, 32), Color (32, 32));
+   NVGpaint fg = nvgBoxGradient (ctx,
+                                 mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
+                                 3, 4, Color (150, 32), Color (32, 32));
+   nvgFillPaint (ctx, mEditable && focused() ? fg : bg);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2,
+                          mSize.y() - 2, 3);
+   nvgBeginPath (ctx);
+   nvgRoundedRect (ctx, mPos.x() + 0.5f, mPos.y() + 0.5f, mSize.x() - 1,
+                   mSize.y() - 1, 2.5f);
+   nvgStrokeColor (ctx, Color (0, 48));
+   nvgStroke (ctx);
+
+   applyFont (ctx);
+   nvgTextMetrics (ctx, nullptr, nullptr, &mLineHeight);
+   float width = mSize.x() - 2 * padding;
+   if ((mWrap && width != mLayoutWidth) || mTheme->mTextBoxFontSize != mLayoutFontSize)
+   {
+      mLayout.assign (mText.lineCount(), LineLayout());
+      rebuildRows();
+   }
+   mLayoutWidth = width;
+   mLayoutFontSize = mTheme->mTextBoxFontSize;
+
+   // Resolve mouse and vertical keyboard motions now that glyphs can be measured
+   if (mMouseDownPos.x() != -1)
+   {
+      moveCursor (hitTest (ctx, mMouseDownPos.x(), mMouseDownPos.y()), mMouseDownModifier == SHIFT_DOWN);
+      mMouseDownPos = Vector2i (-1, -1);
+   }
+   if (mMouseDragPos.x() != -1)
+   {
+      moveCursor (hitTest (ctx, mMouseDragPos.x(), mMouseDragPos.y()), true);
+      mMouseDragPos = Vector2i (-1, -1);
+   }
+   if (mMoveRows != 0)
+   {
+      size_t line = mText.lineOf (mCursor);
+      float x = positionX (ctx, mCursor);
+      int row = rowOfLine (line) + rowInLine (line, mCursor - mText.lineStart (line)) + mMoveRows;
+      if (row < 0)
+         moveCursor (0, mMoveSelect);
+      else
+         if (row >= mTotalRows)
+            moveCursor (mText.size(), mMoveSelect);
+         else
+            moveCursor (hitTestRow (ctx, row, x), mMoveSelect);
+      mMoveRows = 0;
+   }
+
+   // Only the rows inside the clip bounds are drawn; the transform is a translation and scale
+   float x0 = mPos.x() + padding, y0 = mPos.y() + padding;
+   float top = mPos.y(), bottom = mPos.y() + mSize.y();
+   float clip[4], xform[6];
+   if (nvgCurrentClipBounds (ctx, clip))
+   {
+      nvgCurrentTransform (ctx, xform);
+      top = std::max (top, (clip[1] - xform[5]) / xform[3]);
+      bottom = std::min (bottom, (clip[3] - xform[5]) / xform[3]);
+   }
+   mPageRows = std::max (1, (int) ((bottom - top) / mLineHeight));
+   int firstRow = std::max (0, (int) std::floor ((top - y0) / mLineHeight));
+   int lastRow = (int) std::floor ((bottom - y0) / mLineHeight);
+
+   nvgSave (ctx);
+   nvgIntersectScissor (ctx, mPos.x() + 1, mPos.y() + 1, mSize.x() - 2, mSize.y() - 2);
+   nvgFillColor (ctx, mEnabled ? mTheme->mTextColor : mTheme->mDisabledTextColor);
+   bool caret = focused();
+   size_t selBegin = std::string::npos, selEnd = std::string::npos;
+   if (mSelection != std::string::npos)
+   {
+      selBegin = std::min (mCursor, mSelection);
+      selEnd = std::max (mCursor, mSelection);
+   }
+   size_t line = firstRow < mTotalRows ? lineAtRow (firstRow) : mText.lineCount();
+   int row = line < mText.lineCount() ? rowOfLine (line) : 0;
+   for (; line < mText.lineCount() && row <= lastRow; ++line)
+   {
+      layoutLine (ctx, line);
+      size_t start = mText.lineStart (line);
+      std::string text = mText.substr (start, mText.lineEnd (line) - start);
+      for (int r = 0; r < mLayout[line].rows; ++r, ++row)
+      {
+         if (row < firstRow || row > lastRow)
+            continue;
+         size_t begin, end;
+         rowRange (line, r, begin, end);
+         const char * str = text.data() + begin;
+         float y = y0 + row * mLineHeight;
+         nvgText (ctx, x0, y, str, text.data() + end);
+         if (selBegin < start + end + (end == text.size() ? 1 : 0) && selEnd > start + begin)
+         {
+            // Selections reaching past a row's end cover a little of its right
+            size_t a = std::max (selBegin, start + begin) - start, b = std::min (selEnd, start + end) - start;
+            float xa = a > begin ? nvgTextBounds (ctx, 0, 0, str, text.data() + a, nullptr) : 0.0f;
+            float xb = b > begin ? nvgTextBounds (ctx, 0, 0, str, text.data() + b, nullptr) : 0.0f;
+            if (selEnd > start + end)
+               xb += mLineHeight * 0.3f;
+            nvgBeginPath (ctx);
+            nvgFillColor (ctx, nvgRGBA (255, 255, 255, 80));
+            nvgRect (ctx, x0 + xa, y, xb - xa, mLineHeight);
+            nvgFill (ctx);
+            nvgFillColor (ctx, mEnabled ? mTheme->mTextColor : mTheme->mDisabledTextColor);
+         }
+         if (caret && mCursor >= start && mCursor <= start + text.size() && rowInLine (line, mCursor - start) == r)
+         {
+            size_t c = mCursor - start;
+            float x = x0 + (c > begin ? nvgTextBounds (ctx, 0, 0, str, text.data() + c, nullptr) : 0.0f);
+            nvgBeginPath (ctx);
+            nvgMoveTo (ctx, x, y);
+            nvgLineTo (ctx, x, y + mLineHeight);
+            nvgStrokeColor (ctx, nvgRGBA (255, 192, 0, 255));
+            nvgStrokeWidth (ctx, 1.0f);
+            nvgStroke (ctx);
+         }
+      }
+   }
+   nvgRestore (ctx);
+   // Lines measured for the first time may wrap into more rows
+   rowsChanged();
+}
+
+bool TextArea::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
+{
+   Widget::mouseButtonEvent (p, button, down, modifiers);
+   if (focused() && button == MOUSE_BUTTON_LEFT)
+   {
+      if (down)
+      {
+         mMouseDownPos = p;
+         mMouseDownModifier = modifiers;
+         markDirty();
+      }
+      return true;
+   }
+   return false;
+}
+
+bool TextArea::mouseDragEvent (const Vector2i & p, const Vector2i & /* rel */,
+                               int /* button */, int /* modifiers */)
+{
+   if (focused())
+   {
+      mMouseDragPos = p;
+      markDirty();
+      return true;
+   }
+   return false;
+}
+
+bool TextArea::focusEvent (bool focused)
+{
+   Widget::focusEvent (focused);
+   if (!focused)
+      mSelection = std::string::npos;
+   markDirty();
+   return true;
+}
+
+bool TextArea::keyboardEvent (int key, int /* scancode */, int action, int modifiers)
+{
+   if (!focused() || (action != PRESS && action != REPEAT))
+      return false;
+   bool select = modifiers == SHIFT_DOWN;
+   if (key == KEY_LEFT)
+      moveCursor (prevChar (mCursor), select);
+   else
+      if (key == KEY_RIGHT)
+         moveCursor (nextChar (mCursor), select);
+      else
+         if (key == KEY_HOME)
+            moveCursor (mText.lineStart (mText.lineOf (mCursor)), select);
+         else
+            if (key == KEY_END)
+               moveCursor (mText.lineEnd (mText.lineOf (mCursor)), select);
+            else
+               if (key == KEY_UP || key == KEY_DOWN || key == KEY_PAGEUP || key == KEY_PAGEDOWN)
+               {
+                  int rows = key == KEY_UP || key == KEY_DOWN ? 1 : mPageRows;
+                  mMoveRows += key == KEY_UP || key == KEY_PAGEUP ? -rows : rows;
+                  mMoveSelect = select;
+                  markDirty();
+               }
+               else
+                  if (key == KEY_a && modifiers == SYSTEM_COMMAND_MOD)
+                  {
+                     mSelection = 0;
+                     mCursor = mText.size();
+                     markDirty();
+                  }
+                  else
+                     if ((key == KEY_c || key == KEY_x) && modifiers == SYSTEM_COMMAND_MOD)
+                     {
+                        if (mSelection != std::string::npos)
+                        {
+                           size_t begin = std::min (mCursor, mSelection), end = std::max (mCursor, mSelection);
+                           cinder::Clipboard::setString (mText.substr (begin, end - begin));
+                           if (key == KEY_x && mEditable)
+                           {
+                              deleteSelection();
+                              edited();
+                           }
+                        }
+                     }
+                     else
+                     {
+                        if (!mEditable)
+                           return true;
+                        if (key == KEY_BACKSPACE)
+                        {
+                           if (!deleteSelection() && mCursor > 0)
+                           {
+                              size_t prev = prevChar (mCursor);
+                              eraseText (prev, mCursor - prev);
+                              mCursor = prev;
+                           }
+                        }
+                        else
+                           if (key == KEY_DELETE)
+                           {
+                              if (!deleteSelection() && mCursor < mText.size())
+                                 eraseText (mCursor, nextChar (mCursor) - mCursor);
+                           }
+                           else
+                              if (key == KEY_RETURN || key == KEY_KP_ENTER)
+                              {
+                                 deleteSelection();
+                                 insertText (mCursor, "\n");
+                                 ++mCursor;
+                              }
+                              else
+                                 if (key == KEY_v && modifiers == SYSTEM_COMMAND_MOD)
+                                 {
+                                    std::string str = cinder::Clipboard::getString();
+                                    deleteSelection();
+                                    insertText (mCursor, str);
+                                    mCursor += str.size();
+                                 }
+                                 else
+                                    return true;
+                        edited();
+                     }
+   return true;
+}
+
+bool TextArea::keyboardCharacterEvent (unsigned int codepoint)
+{
+   if (!mEditable || !focused())
+      return false;
+   char utf8[4];
+   size_t n;
+   if (codepoint < 0x80)
+   {
+      utf8[0] = (char) codepoint;
+      n = 1;
+   }
+   else
+      if (codepoint < 0x800)
+      {
+         utf8[0] = (char) (0xC0 | (codepoint >> 6));
+         utf8[1] = (char) (0x80 | (codepoint & 0x3F));
+         n = 2;
+      }
+      else
+         if (codepoint < 0x10000)
+         {
+            utf8[0] = (char) (0xE0 | (codepoint >> 12));
+            utf8[1] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+            utf8[2] = (char) (0x80 | (codepoint & 0x3F));
+            n = 3;
+         }
+         else
+         {
+            utf8[0] = (char) (0xF0 | (codepoint >> 18));
+            utf8[1] = (char) (0x80 | ((codepoint >> 12) & 0x3F));
+            utf8[2] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+            utf8[3] = (char) (0x80 | (codepoint & 0x3F));
+            n = 4;
+         }
+   deleteSelection();
+   insertText (mCursor, std::string (utf8, n));
+   mCursor += n;
+   edited();
+   return true;
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,157 @@
+/*
+    nanogui/textarea.h -- Multi-line text field for logs, notes and code
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include "../util/PieceTable.h"
+#include "callback.h"
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Multi-line text field that stays responsive with very long texts
+
+   The text lives in a PieceTable, so an edit costs the same anywhere in it.
+   The rows each line wraps into are found with nvgTextBreakLines() when the
+   line is first drawn and kept until it is edited or the width changes; lines
+   not measured yet count as a single row. Only the rows within the current
+   clip bounds are drawn, so put the area into a VScrollPanel, which gives it
+   its preferred height of all rows. Like TextBox, the keyboard and mouse
+   positions are resolved in \ref draw(), where glyphs can be measured.
+*/
+class  TextArea : public Widget
+{
+   public:
+      TextArea (Widget * parent, const std::string & value = "");
+
+      /// Return the whole text, which copies it
+      std::string value() const
+      {
+         return mText.text();
+      }
+      void setValue (const std::string & value);
+      /// Append to the end without disturbing the cursor or the layout of the lines before, e.g. for logs
+      void append (const std::string & text);
+
+      bool editable() const
+      {
+         return mEditable;
+      }
+      void setEditable (bool editable);
+
+      /// Return whether lines longer than the width wrap into several rows, off by default
+      bool wrap() const
+      {
+         return mWrap;
+      }
+      void setWrap (bool wrap);
+
+      int lineCount() const
+      {
+         return (int)mText.lineCount();
+      }
+      const PieceTable & text() const
+      {
+         return mText;
+      }
+
+      /// Set a function called after every edit made by the user
+      const Callback<void()> & callback() const
+      {
+         return mCallback;
+      }
+      void setCallback (Callback<void()> callback)
+      {
+         mCallback = std::move (callback);
+      }
+
+      virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
+      virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual bool focusEvent (bool focused);
+      virtual bool keyboardEvent (int key, int scancode, int action, int modifiers);
+      virtual bool keyboardCharacterEvent (unsigned int codepoint);
+
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual void draw (NVGcontext * ctx);
+
+   protected:
+      /// Rows a line wraps into, starting at offset 0 and at every break
+      struct LineLayout
+      {
+         int rows = 0;	// 0 until measured
+         std::vector<int> breaks;	// offsets in the line of rows after the first
+      };
+
+      /// Text edits, keeping the line layouts and the row index in step
+      void insertText (size_t pos, const std::string & text);
+      void eraseText (size_t pos, size_t count);
+      bool deleteSelection();
+      /// Called after every edit by the user
+      void edited();
+      /// Ask for a new layout when the number of rows, and with it the preferred height, changed
+      void rowsChanged();
+
+      /// Row index: a Fenwick tree over the rows of every line, so that the row of a line and the
+      /// line of a row are found in logarithmic time
+      int rowsOf (size_t line) const
+      {
+         return mLayout[line].rows > 0 ? mLayout[line].rows : 1;
+      }
+      void rebuildRows();
+      void addRows (size_t line, int delta);
+      /// Add a line with \c rows rows behind all others
+      void appendRows (int rows);
+      int rowOfLine (size_t line) const;
+      size_t lineAtRow (int row) const;
+
+      /// Set the font the text is measured and drawn with
+      void applyFont (NVGcontext * ctx) const;
+      /// Break a line into rows unless done since it changed
+      void layoutLine (NVGcontext * ctx, size_t line);
+      /// Row of a line a position is on, a position at a break belongs to the row it starts
+      int rowInLine (size_t line, size_t pos) const;
+      /// Offsets in the line of the first and behind the last byte of one of its rows
+      void rowRange (size_t line, int row, size_t & begin, size_t & end) const;
+      /// x of a position relative to the left of the text
+      float positionX (NVGcontext * ctx, size_t pos);
+      /// Position closest to a point in the coordinates of \ref draw()
+      size_t hitTest (NVGcontext * ctx, float x, float y);
+      size_t hitTestRow (NVGcontext * ctx, int row, float x);
+      /// Move the cursor, extending the selection when \c select is set
+      void moveCursor (size_t pos, bool select);
+      size_t prevChar (size_t pos) const;
+      size_t nextChar (size_t pos) const;
+
+      PieceTable mText;
+      std::vector<LineLayout> mLayout;	// per line of mText
+      std::vector<int> mRowTree;	// Fenwick tree of rowsOf(), 1-based
+      int mTotalRows = 1;
+      int mLayoutRows = 1;	// total rows the preferred size was last computed with
+      float mLayoutWidth = 0.0f;	// wrap width and font size the layouts were measured with
+      float mLayoutFontSize = 0.0f;
+      float mLineHeight = 0.0f;
+      bool mEditable = true;
+      bool mWrap = false;
+      size_t mCursor = 0;
+      size_t mSelection = std::string::npos;	// other end of the selection, npos if none
+      int mPageRows = 1;	// rows visible in the last frame
+      // Mouse and vertical keyboard motions wait for draw()
+      Vector2i mMouseDownPos = Vector2i (-1, -1);
+      Vector2i mMouseDragPos = Vector2i (-1, -1);
+      int mMouseDownModifier = 0;
+      int mMoveRows = 0;
+      bool mMoveSelect = false;
+      Callback<void()> mCallback;
+};
+
+NAMESPACE_END (nanogui)
@@ -17,12 +17,19 @@
 #include "textbox.h"
 #include "../nanovg/nanovg.h"
 #include "theme.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <regex>
+#include <unordered_map>
 #include "../util/NanoUtil.h"
 #include <cinder/Clipboard.h>
 
 NAMESPACE_BEGIN (nanogui)
 
+/* Seconds the caret is shown and hidden in turn */
+static const double CaretBlinkPeriod = 0.5;
+
 TextBox::TextBox (Widget * parent, const std::string & value)
    : Widget (parent),
      mEditable (false),
@@ -75,30 +82,30 @@ Vector2i TextBox::preferredSize (NVGcontext * ctx) const
 void TextBox::draw (NVGcontext * ctx)
 {
    Widget::draw (ctx);
-   NVGpaint bg = nvgBoxGradient (ctx,
-                                 mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
-                                 3, 4, Color (255, 32), Color (32, 32));
-   NVGpaint fg1 = nvgBoxGradient (ctx,
-                                  mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
-                                  3, 4, Color (150, 32), Color (32, 32));
-   NVGpaint fg2 = nvgBoxGradient (ctx,
-                                  mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
-                                  3, 4, nvgRGBA (255, 0, 0, 100), nvgRGBA (255, 0, 0, 50));
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2,
-                   mSize.y() - 2, 3);
-   if (mEditable && focused())
-      mValidFormat ? nvgFillPaint (ctx, fg1) : nvgFillPaint (ctx, fg2);
-   else
+   bool editing = mEditable && focused(), valid = !editing || validFormat();
+   Theme::Skin skin = !editing ? Theme::Skin::TextBox : valid ? Theme::Skin::TextBoxEditing : Theme::Skin::TextBoxInvalid;
+   if (!mTheme->drawSkin (ctx, skin, mPos.x(), mPos.y(), mSize.x(), mSize.y()))
+   {
+      NVGpaint bg = !editing ? nvgBoxGradient (ctx,
+                                               mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
+                                               3, 4, Color (255, 32), Color (32, 32))
+                    : valid ? nvgBoxGradient (ctx,
+                                              mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
+                                              3, 4, Color (150, 32), Color (32, 32))
+                    : nvgBoxGradient (ctx,
+                                      mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2, mSize.y() - 2,
+                                      3, 4, nvgRGBA (255, 0, 0, 100), nvgRGBA (255, 0, 0, 50));
       nvgFillPaint (ctx, bg);
-   nvgFill (ctx);
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + 0.5f, mPos.y() + 0.5f, mSize.x() - 1,
-                   mSize.y() - 1, 2.5f);
-   nvgStrokeColor (ctx, Color (0, 48));
-   nvgStroke (ctx);
+      nvgDrawRoundedRectSDF (ctx, mPos.x() + 1, mPos.y() + 1 + 1.0f, mSize.x() - 2,
+                             mSize.y() - 2, 3);
+      nvgBeginPath (ctx);
+      nvgRoundedRect (ctx, mPos.x() + 0.5f, mPos.y() + 0.5f, mSize.x() - 1,
+                      mSize.y() - 1, 2.5f);
+      nvgStrokeColor (ctx, Color (0, 48));
+      nvgStroke (ctx);
+   }
    nvgFontSize (ctx, fontSize());
-   nvgFontFace (ctx, "sans");
+   nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
    Vector2i drawPos (mPos.x(), mPos.y() + mSize.y() * 0.5f + 1);
    float xSpacing = mSize.y() * 0.3f;
    float unitWidth = 0;
@@ -152,49 +159,41 @@ void TextBox::draw (NVGcontext * ctx)
    float clipY = mPos.y() + 1.0f;
    float clipWidth = mSize.x() - unitWidth - 2 * xSpacing + 2.0f;
    float clipHeight = mSize.y() - 3.0f;
-   nvgScissor (ctx, clipX, clipY, clipWidth, clipHeight);
+   nvgSave (ctx);
+   nvgIntersectScissor (ctx, clipX, clipY, clipWidth, clipHeight);
    Vector2i oldDrawPos (drawPos);
    drawPos.x() += mTextOffset;
    if (mCommitted)
       nvgText (ctx, drawPos.x(), drawPos.y(), mValue.c_str(), nullptr);
    else
    {
-      const int maxGlyphs = 1024;
-      NVGglyphPosition glyphs[maxGlyphs];
-      float textBound[4];
-      nvgTextBounds (ctx, drawPos.x(), drawPos.y(), mValueTemp.c_str(),
-                     nullptr, textBound);
-      float lineh = textBound[3] - textBound[1];
-      // find cursor positions
-      int nglyphs =
-         nvgTextGlyphPositions (ctx, drawPos.x(), drawPos.y(),
-                                mValueTemp.c_str(), nullptr, glyphs, maxGlyphs);
-      updateCursor (ctx, textBound[2], glyphs, nglyphs);
+      float ascender, descender;
+      updateGlyphs (ctx);
+      nvgTextMetrics (ctx, &ascender, &descender, nullptr);
+      float lineh = ascender - descender;
+      float width = mGlyphX.back();
+      float shift = mAlignment == Alignment::Right ? -width : mAlignment == Alignment::Center ? -width * 0.5f : 0.0f;
+      updateCursor (drawPos.x() + shift);
       // compute text offset
+      int nglyphs = (int)mValueTemp.size();
       int prevCPos = mCursorPos > 0 ? mCursorPos - 1 : 0;
       int nextCPos = mCursorPos < nglyphs ? mCursorPos + 1 : nglyphs;
-      float prevCX = cursorIndex2Position (prevCPos, textBound[2], glyphs, nglyphs);
-      float nextCX = cursorIndex2Position (nextCPos, textBound[2], glyphs, nglyphs);
+      float prevCX = cursorIndex2Position (prevCPos, drawPos.x() + shift);
+      float nextCX = cursorIndex2Position (nextCPos, drawPos.x() + shift);
       if (nextCX > clipX + clipWidth)
          mTextOffset -= nextCX - (clipX + clipWidth) + 1;
       if (prevCX < clipX)
          mTextOffset += clipX - prevCX + 1;
       drawPos.x() = oldDrawPos.x() + mTextOffset;
+      float originX = drawPos.x() + shift;
       // draw text with offset
       nvgText (ctx, drawPos.x(), drawPos.y(), mValueTemp.c_str(), nullptr);
-      nvgTextBounds (ctx, drawPos.x(), drawPos.y(), mValueTemp.c_str(),
-                     nullptr, textBound);
-      // recompute cursor positions
-      nglyphs = nvgTextGlyphPositions (ctx, drawPos.x(), drawPos.y(),
-                                       mValueTemp.c_str(), nullptr, glyphs, maxGlyphs);
       if (mCursorPos > -1)
       {
          if (mSelectionPos > -1)
          {
-            float caretx = cursorIndex2Position (mCursorPos, textBound[2],
-                                                 glyphs, nglyphs);
-            float selx = cursorIndex2Position (mSelectionPos, textBound[2],
-                                               glyphs, nglyphs);
+            float caretx = cursorIndex2Position (mCursorPos, originX);
+            float selx = cursorIndex2Position (mSelectionPos, originX);
             if (caretx > selx)
                std::swap (caretx, selx);
             // draw selection
@@ -204,17 +203,20 @@ void TextBox::draw (NVGcontext * ctx)
                      lineh);
             nvgFill (ctx);
          }
-         float caretx = cursorIndex2Position (mCursorPos, textBound[2], glyphs, nglyphs);
+         float caretx = cursorIndex2Position (mCursorPos, originX);
          // draw cursor
-         nvgBeginPath (ctx);
-         nvgMoveTo (ctx, caretx, drawPos.y() - lineh * 0.5f);
-         nvgLineTo (ctx, caretx, drawPos.y() + lineh * 0.5f);
-         nvgStrokeColor (ctx, nvgRGBA (255, 192, 0, 255));
-         nvgStrokeWidth (ctx, 1.0f);
-         nvgStroke (ctx);
+         if (mCaretVisible)
+         {
+            nvgBeginPath (ctx);
+            nvgMoveTo (ctx, caretx, drawPos.y() - lineh * 0.5f);
+            nvgLineTo (ctx, caretx, drawPos.y() + lineh * 0.5f);
+            nvgStrokeColor (ctx, nvgRGBA (255, 192, 0, 255));
+            nvgStrokeWidth (ctx, 1.0f);
+            nvgStroke (ctx);
+         }
       }
    }
-   nvgResetScissor (ctx);
+   nvgRestore (ctx);
 }
 
 bool TextBox::mouseButtonEvent (const Vector2i & p, int button, bool down,
@@ -223,6 +225,7 @@ bool TextBox::mouseButtonEvent (const Vector2i & p, int button, bool down,
    Widget::mouseButtonEvent (p, button, down, modifiers);
    if (mEditable && focused() && button == MOUSE_BUTTON_LEFT)
    {
+      restartBlink();
       if (down)
       {
          mMouseDownPos = p;
@@ -253,6 +256,7 @@ bool TextBox::mouseMotionEvent (const Vector2i & p, const Vector2i & /* rel */,
    if (mEditable && focused())
    {
       mMousePos = p;
+      markDirty();
       return true;
    }
    return false;
@@ -264,6 +268,7 @@ bool TextBox::mouseDragEvent (const Vector2i & p, const Vector2i & /* rel */,
    if (mEditable && focused())
    {
       mMouseDragPos = p;
+      markDirty();
       return true;
    }
    return false;
@@ -284,12 +289,13 @@ bool TextBox::focusEvent (bool focused)
       if (focused)
       {
          mValueTemp = mValue;
+         textChanged (0);
          mCommitted = false;
          mCursorPos = 0;
       }
       else
       {
-         if (mValidFormat)
+         if (validFormat())
          {
             if (mValueTemp == "")
                mValue = mDefaultValue;
@@ -303,16 +309,48 @@ bool TextBox::focusEvent (bool focused)
          mCursorPos = -1;
          mSelectionPos = -1;
          mTextOffset = 0;
+         // Only the box being edited keeps glyph positions
+         std::vector<float>().swap (mGlyphX);
+         mGlyphsValid = 0;
       }
-      mValidFormat = (mValueTemp == "") || checkFormat (mValueTemp, mFormat);
+      if (mValue != backup)
+         invalidateLayout();
+      restartBlink();
    }
    return true;
 }
 
+void TextBox::restartBlink()
+{
+   mCaretVisible = true;
+   Screen * screen = this->screen();
+   if (!screen)
+      return;
+   screen->cancelTimer (mBlinkTimer);
+   mBlinkTimer = 0;
+   if (!mEditable || !focused())
+      return;
+   ref<TextBox> self = this;
+   mBlinkTimer = screen->addTimer (CaretBlinkPeriod, [self, screen]() mutable
+   {
+      /* A box that lost the focus without being told, e.g. by leaving the screen, stops here */
+      if (!self->focused() || self->screen() != screen)
+      {
+         screen->cancelTimer (self->mBlinkTimer);
+         self->mBlinkTimer = 0;
+         self->mCaretVisible = true;
+         return;
+      }
+      self->mCaretVisible = !self->mCaretVisible;
+      self->markDirty();
+   }, CaretBlinkPeriod);
+}
+
 bool TextBox::keyboardEvent (int key, int /* scancode */, int action, int modifiers)
 {
    if (mEditable && focused())
    {
+      restartBlink();
       if (action == PRESS || action == REPEAT)
       {
          if (key == KEY_LEFT)
@@ -371,6 +409,7 @@ bool TextBox::keyboardEvent (int key, int /* scancode */, int action, int modifi
                         {
                            if (mCursorPos > 0)
                            {
+                              textChanged (mCursorPos - 1);
                               mValueTemp.erase (mValueTemp.begin() + mCursorPos - 1);
                               mCursorPos--;
                            }
@@ -382,7 +421,10 @@ bool TextBox::keyboardEvent (int key, int /* scancode */, int action, int modifi
                            if (!deleteSelection())
                            {
                               if (mCursorPos < (int) mValueTemp.length())
+                              {
+                                 textChanged (mCursorPos);
                                  mValueTemp.erase (mValueTemp.begin() + mCursorPos);
+                              }
                            }
                         }
                         else
@@ -412,8 +454,6 @@ bool TextBox::keyboardEvent (int key, int /* scancode */, int action, int modifi
                                           deleteSelection();
                                           pasteFromClipboard();
                                        }
-         mValidFormat =
-            (mValueTemp == "") || checkFormat (mValueTemp, mFormat);
       }
       return true;
    }
@@ -424,23 +464,98 @@ bool TextBox::keyboardCharacterEvent (unsigned int codepoint)
 {
    if (mEditable && focused())
    {
-      std::ostringstream convert;
-      convert << (char) codepoint;
+      restartBlink();
       deleteSelection();
-      mValueTemp.insert (mCursorPos, convert.str());
-      mCursorPos++;
-      mValidFormat = (mValueTemp == "") || checkFormat (mValueTemp, mFormat);
+      std::array<char, 8> seq = utf8 ((int)codepoint);
+      insertText (seq.data(), strlen (seq.data()));
       return true;
    }
    return false;
 }
 
+struct TextBox::CompiledFormat
+{
+   explicit CompiledFormat (const std::string & format) : regex (format) {}
+   std::regex regex;
+};
+
+bool TextBox::validFormat()
+{
+   if (mFormatStale)
+   {
+      mValidFormat = mValueTemp.empty() || checkFormat (mValueTemp, mFormat);
+      mFormatStale = false;
+   }
+   return mValidFormat;
+}
+
 bool TextBox::checkFormat (const std::string & input, const std::string & format)
 {
+   if (mValidator && format == mFormat)
+      return mValidator (input);
    if (format.empty())
       return true;
-   std::regex regex (format);
-   return regex_match (input, regex);
+   if (format != mFormat)
+      return std::regex_match (input, std::regex (format));
+   if (!mCompiledFormat)
+   {
+      /* Compiling a regex is slow, boxes of the same kind share theirs. Expired entries are
+         replaced on their next use */
+      static std::mutex mutex;
+      static std::unordered_map<std::string, std::weak_ptr<const CompiledFormat>> compiled;
+      std::lock_guard<std::mutex> lock (mutex);
+      auto & shared = compiled[format];
+      mCompiledFormat = shared.lock();
+      if (!mCompiledFormat)
+      {
+         mCompiledFormat = std::make_shared<const CompiledFormat> (format);
+         shared = mCompiledFormat;
+      }
+   }
+   return std::regex_match (input, mCompiledFormat->regex);
+}
+
+bool TextBox::isInteger (const std::string & str, bool allowSign)
+{
+   size_t i = allowSign && !str.empty() && str[0] == '-' ? 1 : 0;
+   for (; i < str.size(); ++i)
+      if (str[i] < '0' || str[i] > '9')
+         return false;
+   return true;
+}
+
+bool TextBox::isFloat (const std::string & str)
+{
+   size_t i = 0, n = str.size();
+   auto digits = [&]()
+   {
+      size_t start = i;
+      while (i < n && str[i] >= '0' && str[i] <= '9')
+         ++i;
+      return i - start;
+   };
+   if (i < n && (str[i] == '-' || str[i] == '+'))
+      ++i;
+   size_t whole = digits();
+   /* The mantissa ends in a digit, "1." is not a number but ".5" is */
+   if (i < n && str[i] == '.')
+   {
+      ++i;
+      if (digits() == 0)
+         return false;
+   }
+   else
+      if (whole == 0)
+         return false;
+   if (i < n && (str[i] == 'e' || str[i] == 'E'))
+   {
+      ++i;
+      if (i < n && (str[i] == '-' || str[i] == '+'))
+         ++i;
+      if (digits() == 0)
+         return false;
+   }
+   return i == n;
 }
 
 bool TextBox::copySelection()
@@ -452,7 +567,7 @@ bool TextBox::copySelection()
       int end = mSelectionPos;
       if (begin > end)
          std::swap (begin, end);
-      cinder::Clipboard::setString (mValueTemp.substr (begin, end).c_str());
+      cinder::Clipboard::setString (mValueTemp.substr (begin, end - begin).c_str());
       //glfwSetClipboardString(sc->glfwWindow(),
       //                       mValueTemp.substr(begin, end).c_str());
       return true;
@@ -465,7 +580,20 @@ void TextBox::pasteFromClipboard()
    Screen * sc = dynamic_cast<Screen *> (this->window()->parent());
    std::string str = cinder::Clipboard::getString();
    //std::string str(glfwGetClipboardString(sc->glfwWindow()));
-   mValueTemp.insert (mCursorPos, str);
+   insertText (str.data(), str.size());
+}
+
+void TextBox::insertText (const char * text, size_t length)
+{
+   if (length == 0)
+      return;
+   /* A paste of many kilobytes grows the text and the glyph positions once; the format is
+      checked and the glyphs from the cursor on measured once, on the next draw */
+   textChanged (mCursorPos);
+   mValueTemp.reserve (mValueTemp.size() + length);
+   mValueTemp.insert ((size_t)mCursorPos, text, length);
+   mGlyphX.reserve (mValueTemp.size() + 1);
+   mCursorPos += (int)length;
 }
 
 bool TextBox::deleteSelection()
@@ -476,6 +604,7 @@ bool TextBox::deleteSelection()
       int end = mSelectionPos;
       if (begin > end)
          std::swap (begin, end);
+      textChanged (begin);
       if (begin == end - 1)
          mValueTemp.erase (mValueTemp.begin() + begin);
       else
@@ -488,8 +617,41 @@ bool TextBox::deleteSelection()
    return false;
 }
 
-void TextBox::updateCursor (NVGcontext *, float lastx,
-                            const NVGglyphPosition * glyphs, int size)
+void TextBox::updateGlyphs (NVGcontext * ctx)
+{
+   int n = (int)mValueTemp.size();
+   if (mGlyphFontSize != fontSize())
+   {
+      mGlyphFontSize = fontSize();
+      mGlyphsValid = 0;
+   }
+   if (mGlyphsValid > n && (int)mGlyphX.size() == n + 1)
+      return;
+   // Typing at the end only measures the last glyphs. The glyph before the change is measured
+   // again since its kerning with the next one may have changed.
+   int start = std::max (std::min (mGlyphsValid, n) - 1, 0);
+   float x0 = start > 0 ? mGlyphX[start] : 0.0f;
+   mGlyphX.resize (n + 1);
+   std::vector<NVGglyphPosition> glyphs (n - start + 1);
+   const char * text = mValueTemp.c_str();
+   nvgSave (ctx);
+   nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+   int count = nvgTextGlyphPositions (ctx, x0, 0, text + start, text + n, glyphs.data(), (int)glyphs.size());
+   float end = x0 + nvgTextBounds (ctx, x0, 0, text + start, text + n, nullptr);
+   nvgRestore (ctx);
+   // Bytes within a multi-byte character share the position of its glyph
+   for (int i = 0; i < count; ++i)
+   {
+      int first = (int) (glyphs[i].str - text);
+      int last = i + 1 < count ? (int) (glyphs[i + 1].str - text) : n;
+      for (int j = first; j < last; ++j)
+         mGlyphX[j] = glyphs[i].x;
+   }
+   mGlyphX[n] = end;
+   mGlyphsValid = n + 1;
+}
+
+void TextBox::updateCursor (float originX)
 {
    // handle mouse cursor events
    if (mMouseDownPos.x() != -1)
@@ -501,8 +663,7 @@ void TextBox::updateCursor (NVGcontext *, float lastx,
       }
       else
          mSelectionPos = -1;
-      mCursorPos =
-         position2CursorIndex (mMouseDownPos.x(), lastx, glyphs, size);
+      mCursorPos = position2CursorIndex (mMouseDownPos.x(), originX);
       mMouseDownPos = Vector2i (-1, -1);
    }
    else
@@ -510,46 +671,36 @@ void TextBox::updateCursor (NVGcontext *, float lastx,
       {
          if (mSelectionPos == -1)
             mSelectionPos = mCursorPos;
-         mCursorPos =
-            position2CursorIndex (mMouseDragPos.x(), lastx, glyphs, size);
+         mCursorPos = position2CursorIndex (mMouseDragPos.x(), originX);
       }
       else
       {
          // set cursor to last character
          if (mCursorPos == -2)
-            mCursorPos = size;
+            mCursorPos = (int)mValueTemp.size();
       }
    if (mCursorPos == mSelectionPos)
       mSelectionPos = -1;
 }
 
-float TextBox::cursorIndex2Position (int index, float lastx,
-                                     const NVGglyphPosition * glyphs, int size)
+float TextBox::cursorIndex2Position (int index, float originX) const
 {
-   float pos = 0;
-   if (index == size)
-      pos = lastx; // last character
-   else
-      pos = glyphs[index].x;
-   return pos;
+   return originX + mGlyphX[std::min (std::max (index, 0), (int)mGlyphX.size() - 1)];
 }
 
-int TextBox::position2CursorIndex (float posx, float lastx,
-                                   const NVGglyphPosition * glyphs, int size)
+int TextBox::position2CursorIndex (float posx, float originX) const
 {
-   int mCursorId = 0;
-   float caretx = glyphs[mCursorId].x;
-   for (int j = 1; j < size; j++)
-   {
-      if (std::abs (caretx - posx) > std::abs (glyphs[j].x - posx))
-      {
-         mCursorId = j;
-         caretx = glyphs[mCursorId].x;
-      }
-   }
-   if (std::abs (caretx - posx) > std::abs (lastx - posx))
-      mCursorId = size;
-   return mCursorId;
+   // Positions never decrease, the nearest one is either side of the first one right of posx
+   float x = posx - originX;
+   int i = (int) (std::lower_bound (mGlyphX.begin(), mGlyphX.end(), x) - mGlyphX.begin());
+   if (i == (int)mGlyphX.size())
+      return i - 1;
+   if (i > 0 && x - mGlyphX[i - 1] <= mGlyphX[i] - x)
+      i--;
+   // The first byte of a multi-byte character
+   while (i > 0 && mGlyphX[i - 1] == mGlyphX[i])
+      i--;
+   return i;
 }
 
 NAMESPACE_END (nanogui)
@@ -15,7 +15,12 @@
 #pragma once
 
 #include "widget.h"
-#include <sstream>
+#include "callback.h"
+#include "numberformat.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 
 NAMESPACE_BEGIN (nanogui)
 
@@ -41,9 +46,21 @@ class  TextBox : public Widget
       {
          return mValue;
       }
+      /// Set the shown text, nothing is measured or redrawn when it did not change
       void setValue (const std::string & value)
       {
+         if (value == mValue)
+            return;
          mValue = value;
+         invalidateLayout();
+      }
+      /// Set the shown text from a null terminated buffer, reusing the storage of the old text
+      void setValue (const char * value)
+      {
+         if (std::strcmp (value, mValue.c_str()) == 0)
+            return;
+         mValue.assign (value);
+         invalidateLayout();
       }
 
       const std::string & defaultValue() const
@@ -62,6 +79,7 @@ class  TextBox : public Widget
       void setAlignment (Alignment align)
       {
          mAlignment = align;
+         markDirty();
       }
 
       const std::string & units() const
@@ -71,6 +89,7 @@ class  TextBox : public Widget
       void setUnits (const std::string & units)
       {
          mUnits = units;
+         invalidateLayout();
       }
 
       int unitsImage() const
@@ -80,6 +99,7 @@ class  TextBox : public Widget
       void setUnitsImage (int image)
       {
          mUnitsImage = image;
+         invalidateLayout();
       }
 
       /// Return the underlying regular expression specifying valid formats
@@ -87,20 +107,40 @@ class  TextBox : public Widget
       {
          return mFormat;
       }
-      /// Specify a regular expression specifying valid formats
+      /// Specify a regular expression specifying valid formats. It is compiled once and shared by
+      /// all text boxes with the same format; any validator set before is dropped
       void setFormat (const std::string & format)
       {
          mFormat = format;
+         mCompiledFormat.reset();
+         mValidator = nullptr;
+      }
+
+      /// Return the function checking the input in place of the format, if any
+      const Callback<bool (const std::string & str)> & validator() const
+      {
+         return mValidator;
       }
+      /// Check the input with a function instead of compiling the format, which is then only
+      /// reported by \ref format(). Set it after \ref setFormat()
+      void setValidator (Callback<bool (const std::string & str)> validator)
+      {
+         mValidator = std::move (validator);
+      }
+
+      /// Whether \c str matches "[-]?[0-9]*", or "[0-9]*" without \c allowSign
+      static bool isInteger (const std::string & str, bool allowSign);
+      /// Whether \c str matches "[-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?"
+      static bool isFloat (const std::string & str);
 
       /// Set the change callback
-      std::function<bool (const std::string & str)> callback() const
+      const Callback<bool (const std::string & str)> & callback() const
       {
          return mCallback;
       }
-      void setCallback (const std::function<bool (const std::string & str)> & callback)
+      void setCallback (Callback<bool (const std::string & str)> callback)
       {
-         mCallback = callback;
+         mCallback = std::move (callback);
       }
 
       bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
@@ -114,17 +154,32 @@ class  TextBox : public Widget
       Vector2i preferredSize (NVGcontext * ctx) const;
       void draw (NVGcontext * ctx);
    protected:
+      struct CompiledFormat;
+
       bool checkFormat (const std::string & input, const std::string & format);
       bool copySelection();
       void pasteFromClipboard();
       bool deleteSelection();
+      /// Insert \c text at the cursor in one edit and move the cursor past it
+      void insertText (const char * text, size_t length);
 
-      void updateCursor (NVGcontext * ctx, float lastx,
-                         const NVGglyphPosition * glyphs, int size);
-      float cursorIndex2Position (int index, float lastx,
-                                  const NVGglyphPosition * glyphs, int size);
-      int position2CursorIndex (float posx, float lastx,
-                                const NVGglyphPosition * glyphs, int size);
+      /// Note that the text being edited changed from byte \c from on
+      void textChanged (int from)
+      {
+         mGlyphsValid = std::min (mGlyphsValid, std::max (from, 0));
+         mFormatStale = true;
+      }
+      /// Whether the text being edited matches the format, checked once after any number of edits
+      bool validFormat();
+      /// Measure the glyphs of the text being edited from the first changed one on
+      void updateGlyphs (NVGcontext * ctx);
+
+      /// \c originX is where the first glyph of the edited text is drawn
+      void updateCursor (float originX);
+      float cursorIndex2Position (int index, float originX) const;
+      int position2CursorIndex (float posx, float originX) const;
+      /// Show the caret and blink it from now on while the box is being edited, on a timer of the screen
+      void restartBlink();
    protected:
       bool mEditable;
       bool mCommitted;
@@ -133,9 +188,12 @@ class  TextBox : public Widget
       Alignment mAlignment;
       std::string mUnits;
       std::string mFormat;
+      std::shared_ptr<const CompiledFormat> mCompiledFormat;	// of mFormat, compiled on first check
+      Callback<bool (const std::string & str)> mValidator;
       int mUnitsImage;
-      std::function<bool (const std::string & str)> mCallback;
+      Callback<bool (const std::string & str)> mCallback;
       bool mValidFormat;
+      bool mFormatStale = false;	// mValidFormat predates the last edit
       std::string mValueTemp;
       int mCursorPos;
       int mSelectionPos;
@@ -145,6 +203,13 @@ class  TextBox : public Widget
       int mMouseDownModifier;
       float mTextOffset;
       double mLastClick;
+      uint64_t mBlinkTimer = 0;
+      bool mCaretVisible = true;
+      /// While editing, the x of every byte of mValueTemp relative to the first glyph, followed by
+      /// the width of the text. Only entries before mGlyphsValid are up to date
+      std::vector<float> mGlyphX;
+      int mGlyphsValid = 0;
+      float mGlyphFontSize = 0.0f;
 };
 
 template <typename Scalar> class IntBox : public TextBox
@@ -154,37 +219,47 @@ template <typename Scalar> class IntBox : public TextBox
       {
          setDefaultValue ("0");
          setFormat (std::is_signed<Scalar>::value ? "[-]?[0-9]*" : "[0-9]*");
+         setValidator ([] (const std::string & str)
+         {
+            return isInteger (str, std::is_signed<Scalar>::value);
+         });
          setValue (value);
       }
 
       Scalar value() const
       {
-         Scalar value;
-         std::istringstream iss (TextBox::value());
-         if (! (iss >> value))
-            throw std::invalid_argument ("Could not parse integer value!");
-         return value;
+         return parse (TextBox::value());
       }
 
       void setValue (Scalar value)
       {
-         TextBox::setValue (std::to_string (value));
+         char buffer[NumberBufferSize];
+         formatInteger (buffer, value);
+         TextBox::setValue (buffer);
       }
 
-      void setCallback (const std::function<void (Scalar)> & cb)
+      void setCallback (Callback<void (Scalar)> cb)
       {
+         mScalarCallback = std::move (cb);
          TextBox::setCallback (
-            [cb] (const std::string & str)
+            [this] (const std::string & str)
          {
-            std::istringstream iss (str);
-            Scalar value;
-            if (! (iss >> value))
-               throw std::invalid_argument ("Could not parse integer value!");
-            cb (value);
+            mScalarCallback (parse (str));
             return true;
          }
          );
       }
+
+   protected:
+      static Scalar parse (const std::string & str)
+      {
+         Scalar value;
+         if (!parseInteger (str.data(), str.data() + str.size(), value))
+            throw std::invalid_argument ("Could not parse integer value!");
+         return value;
+      }
+
+      Callback<void (Scalar)> mScalarCallback;	// kept here, too big to capture in the text callback
 };
 
 template <typename Scalar> class FloatBox : public TextBox
@@ -194,30 +269,66 @@ template <typename Scalar> class FloatBox : public TextBox
       {
          setDefaultValue ("0");
          setFormat ("[-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?");
+         setValidator (isFloat);
          setValue (value);
       }
 
       Scalar value() const
       {
-         return (Scalar) std::stod (TextBox::value());
+         return parse (TextBox::value());
       }
 
       void setValue (Scalar value)
       {
-         char buffer[30];
-         snprintf (buffer, 30, sizeof (Scalar) == sizeof (float) ? "%.4g" : "%.7g", value);
+         char buffer[NumberBufferSize];
+         formatFloat (buffer, value, mNumberFormat, mPrecision);
          TextBox::setValue (buffer);
       }
 
-      void setCallback (const std::function<void (Scalar)> & cb)
+      /// Return the notation the value is shown in
+      NumberFormat numberFormat() const
       {
+         return mNumberFormat;
+      }
+      /// Return the significant digits, or the decimals outside of NumberFormat::General
+      int precision() const
+      {
+         return mPrecision;
+      }
+      /// Show the value in \c format with \c precision digits, see formatFloat()
+      void setNumberFormat (NumberFormat format, int precision)
+      {
+         double current;
+         bool valid = parseFloat (mValue.data(), mValue.data() + mValue.size(), current);
+         mNumberFormat = format;
+         mPrecision = precision;
+         if (valid)
+            setValue ((Scalar)current);
+      }
+
+      void setCallback (Callback<void (Scalar)> cb)
+      {
+         mScalarCallback = std::move (cb);
          TextBox::setCallback (
-            [cb] (const std::string & str)
+            [this] (const std::string & str)
          {
-            cb ((Scalar) std::stod (str));
+            mScalarCallback (parse (str));
             return true;
          });
       }
+
+   protected:
+      static Scalar parse (const std::string & str)
+      {
+         double value;
+         if (!parseFloat (str.data(), str.data() + str.size(), value))
+            throw std::invalid_argument ("Could not parse floating point value!");
+         return (Scalar)value;
+      }
+
+      Callback<void (Scalar)> mScalarCallback;
+      NumberFormat mNumberFormat = NumberFormat::General;
+      int mPrecision = sizeof (Scalar) == sizeof (float) ? 4 : 7;
 };
 
 NAMESPACE_END (nanogui)
@@ -13,11 +13,135 @@
 
 #include "theme.h"
 #include "../nanovg/nanovg.h"
+#include "../nanovg/stb_image.h"
 #include "resources.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <vector>
 
 NAMESPACE_BEGIN (nanogui)
 
-Theme::Theme (NVGcontext * ctx)
+namespace
+{
+   /* The embedded fonts are inflated on first use and shared by every context */
+   struct EmbeddedFont
+   {
+      const char * name;
+      const uint8_t * compressed;
+      const uint32_t & compressedSize;
+      const uint32_t & size;
+      std::once_flag once;
+      unsigned char * data;
+   };
+
+   EmbeddedFont embeddedFonts[] =
+   {
+      { "sans", roboto_regular_ttf_z, roboto_regular_ttf_z_size, roboto_regular_ttf_size, {}, nullptr },
+      { "sans-bold", roboto_bold_ttf_z, roboto_bold_ttf_z_size, roboto_bold_ttf_size, {}, nullptr },
+      { "icons", entypo_ttf_z, entypo_ttf_z_size, entypo_ttf_size, {}, nullptr }
+   };
+
+   int loadEmbeddedFont (void *, NVGcontext * ctx, const char * name)
+   {
+      for (EmbeddedFont & font : embeddedFonts)
+      {
+         if (std::strcmp (font.name, name) != 0)
+            continue;
+         std::call_once (font.once, [&font]()
+         {
+            char * data = new char[font.size];
+            if (stbi_zlib_decode_buffer (data, font.size, (const char *)font.compressed, font.compressedSize) == (int)font.size)
+               font.data = (unsigned char *)data;
+            else
+               delete[] data;
+         });
+         if (!font.data)
+            return -1;
+         return nvgCreateFontMem (ctx, font.name, font.data, font.size, 0);
+      }
+      return -1;
+   }
+
+   /* Signed distance from the pixel center px, py to the rounded rectangle x, y, w, h, r */
+   float roundedRectDistance (float px, float py, float x, float y, float w, float h, float r)
+   {
+      r = std::min (r, std::min (w, h) * 0.5f);
+      float dx = std::abs (px - (x + w * 0.5f)) - (w * 0.5f - r);
+      float dy = std::abs (py - (y + h * 0.5f)) - (h * 0.5f - r);
+      float ox = std::max (dx, 0.0f), oy = std::max (dy, 0.0f);
+      return std::min (std::max (dx, dy), 0.0f) + std::sqrt (ox * ox + oy * oy) - r;
+   }
+
+   /* Software rendering of one skin, premultiplied, with the coverage and paints NanoVG would use */
+   struct SkinCanvas
+   {
+      int w, h;
+      std::vector<float> rgba;
+
+      SkinCanvas (int w, int h) : w (w), h (h), rgba (w * h * 4, 0.0f) { }
+
+      void blend (int i, int j, const Color & color, float coverage)
+      {
+         float a = color.w() * coverage, * p = &rgba[(j * w + i) * 4];
+         p[0] = color.r() * a + p[0] * (1.0f - a);
+         p[1] = color.g() * a + p[1] * (1.0f - a);
+         p[2] = color.b() * a + p[2] * (1.0f - a);
+         p[3] = a + p[3] * (1.0f - a);
+      }
+      /* Fill the rounded rectangle with the color paint(px, py) */
+      template <typename Paint> void fill (float x, float y, float rw, float rh, float r, Paint paint)
+      {
+         for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+            {
+               float cover = std::min (std::max (0.5f - roundedRectDistance (i + 0.5f, j + 0.5f, x, y, rw, rh, r), 0.0f), 1.0f);
+               if (cover > 0.0f)
+                  blend (i, j, paint (i + 0.5f, j + 0.5f), cover);
+            }
+      }
+      /* Stroke the outline of the rounded rectangle one pixel wide */
+      void stroke (float x, float y, float rw, float rh, float r, const Color & color)
+      {
+         for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+            {
+               float cover = std::min (std::max (1.0f - std::abs (roundedRectDistance (i + 0.5f, j + 0.5f, x, y, rw, rh, r)), 0.0f), 1.0f);
+               if (cover > 0.0f)
+                  blend (i, j, color, cover);
+            }
+      }
+   };
+
+   /* The color of nvgBoxGradient (x, y, w, h, r, f, inner, outer) at px, py */
+   struct BoxGradient
+   {
+      float x, y, w, h, r, f;
+      Color inner, outer;
+
+      Color operator() (float px, float py) const
+      {
+         float t = std::min (std::max ((roundedRectDistance (px, py, x, y, w, h, r) + f * 0.5f) / f, 0.0f), 1.0f);
+         return Color (inner * (1.0f - t) + outer * t);
+      }
+   };
+
+   /* The color of a vertical gradient from the top to the bottom of a box of height h */
+   struct VerticalGradient
+   {
+      float h;
+      Color top, bottom;
+
+      Color operator() (float, float py) const
+      {
+         float t = std::min (std::max (py / h, 0.0f), 1.0f);
+         return Color (top * (1.0f - t) + bottom * t);
+      }
+   };
+}
+
+Theme::Theme (NVGcontext * ctx) : mContext (ctx)
 {
    mStandardFontSize                 = 16;
    mButtonFontSize                   = 20;
@@ -52,14 +176,137 @@ Theme::Theme (NVGcontext * ctx)
    mWindowHeaderSepBot               = mBorderDark;
    mWindowPopup                      = Color (50, 255);
    mWindowPopupTransparent           = Color (50, 0);
-   mFontNormal = nvgCreateFontMem (ctx, "sans", roboto_regular_ttf,
-                                   roboto_regular_ttf_size, 0);
-   mFontBold = nvgCreateFontMem (ctx, "sans-bold", roboto_bold_ttf,
-                                 roboto_bold_ttf_size, 0);
-   mFontIcons = nvgCreateFontMem (ctx, "icons", entypo_ttf,
-                                  entypo_ttf_size, 0);
-   if (mFontNormal == -1 || mFontBold == -1 || mFontIcons == -1)
-      throw std::runtime_error ("Could not load fonts!");
+   /* Fonts are created when a widget first asks for them by name */
+   nvgSetFontLoader (ctx, loadEmbeddedFont, nullptr);
+   changed();
+}
+
+void Theme::changed()
+{
+   mButtonPaintFocused = nvgLinearGradient (mContext, 0, 0, 0, 1, mButtonGradientTopFocused, mButtonGradientBotFocused);
+   mButtonPaintUnfocused = nvgLinearGradient (mContext, 0, 0, 0, 1, mButtonGradientTopUnfocused,
+                           mButtonGradientBotUnfocused);
+   mButtonPaintPushed = nvgLinearGradient (mContext, 0, 0, 0, 1, mButtonGradientTopPushed, mButtonGradientBotPushed);
+   mWindowHeaderPaint = nvgLinearGradient (mContext, 0, 0, 0, 1, mWindowHeaderGradientTop, mWindowHeaderGradientBot);
+   if (mSkinAtlas)
+      renderSkins();
+   ++mVersion;
+}
+
+void Theme::renderSkins()
+{
+   /* Each skin is drawn the way its widget draws its background, at a size leaving a few pixels
+      to stretch between the borders. Buttons are drawn at their usual height, so that their
+      vertical gradient is only stretched a little */
+   int br = std::max (mButtonCornerRadius, 1) + 3;
+   const Vector2i sizes[(int) Skin::Count] =
+   {
+      Vector2i (2 * br + 4, 30), Vector2i (2 * br + 4, 30), Vector2i (2 * br + 4, 30),
+      Vector2i (20, 24), Vector2i (20, 24), Vector2i (20, 24),
+      Vector2i (18, 18), Vector2i (18, 18),
+      Vector2i (20, 12)
+   };
+   const Vector2i borders[(int) Skin::Count] =
+   {
+      Vector2i (br, br), Vector2i (br, br), Vector2i (br, br),
+      Vector2i (8, 8), Vector2i (8, 8), Vector2i (8, 8),
+      Vector2i (7, 7), Vector2i (7, 7),
+      Vector2i (8, 6)
+   };
+   /* One row of cells, two transparent pixels apart so that filtering never reaches a neighbor */
+   int width = 0, height = 0;
+   for (int s = 0; s < (int) Skin::Count; ++s)
+   {
+      mSkinCells[s] = SkinCell { width + 2, 2, sizes[s].x(), sizes[s].y(), borders[s].x(), borders[s].y() };
+      width += sizes[s].x() + 2;
+      height = std::max (height, sizes[s].y() + 4);
+   }
+   width += 2;
+   std::vector<unsigned char> pixels (width * height * 4, 0);
+
+   for (int s = 0; s < (int) Skin::Count; ++s)
+   {
+      const SkinCell & cell = mSkinCells[s];
+      SkinCanvas canvas (cell.w, cell.h);
+      float w = (float) cell.w, h = (float) cell.h, cr = (float) mButtonCornerRadius;
+      switch ((Skin) s)
+      {
+         case Skin::Button:
+         case Skin::ButtonFocused:
+         case Skin::ButtonPushed:
+         {
+            /* See Button::draw() */
+            bool pushed = (Skin) s == Skin::ButtonPushed;
+            VerticalGradient bg = (Skin) s == Skin::Button ? VerticalGradient { h, mButtonGradientTopUnfocused, mButtonGradientBotUnfocused }
+                                  : pushed ? VerticalGradient { h, mButtonGradientTopPushed, mButtonGradientBotPushed }
+                                  : VerticalGradient { h, mButtonGradientTopFocused, mButtonGradientBotFocused };
+            canvas.fill (1, 1, w - 2, h - 2, cr - 1, bg);
+            canvas.stroke (0.5f, pushed ? 0.5f : 1.5f, w - 1, h - 1 - (pushed ? 0.0f : 1.0f), cr, mBorderLight);
+            canvas.stroke (0.5f, 0.5f, w - 1, h - 2, cr, mBorderDark);
+            break;
+         }
+         case Skin::TextBox:
+         case Skin::TextBoxEditing:
+         case Skin::TextBoxInvalid:
+         {
+            /* See TextBox::draw() */
+            BoxGradient bg = (Skin) s == Skin::TextBox ? BoxGradient { 1, 2, w - 2, h - 2, 3, 4, Color (255, 32), Color (32, 32) }
+                             : (Skin) s == Skin::TextBoxEditing ? BoxGradient { 1, 2, w - 2, h - 2, 3, 4, Color (150, 32), Color (32, 32) }
+                             : BoxGradient { 1, 2, w - 2, h - 2, 3, 4, Color (255, 0, 0, 100), Color (255, 0, 0, 50) };
+            canvas.fill (1, 2, w - 2, h - 2, 3, bg);
+            canvas.stroke (0.5f, 0.5f, w - 1, h - 1, 2.5f, Color (0, 48));
+            break;
+         }
+         case Skin::CheckBox:
+         case Skin::CheckBoxPushed:
+         {
+            /* See CheckBox::draw() */
+            BoxGradient bg { 1.5f, 1.5f, h - 2, h - 2, 3, 3, (Skin) s == Skin::CheckBoxPushed ? Color (0, 100) : Color (0, 32),
+                             Color (0, 0, 0, 180) };
+            canvas.fill (1, 1, h - 2, h - 2, 3, bg);
+            break;
+         }
+         case Skin::ProgressBar:
+         {
+            /* See ProgressBar::draw() */
+            BoxGradient bg { 1, 1, w - 2, h, 3, 4, Color (0, 32), Color (0, 92) };
+            canvas.fill (0, 0, w, h, 3, bg);
+            break;
+         }
+         default:
+            break;
+      }
+      for (int j = 0; j < cell.h; ++j)
+         for (int i = 0; i < cell.w * 4; ++i)
+         {
+            float v = canvas.rgba[j * cell.w * 4 + i];
+            pixels[((cell.y + j) * width + cell.x) * 4 + i] = (unsigned char) std::lround (std::min (std::max (v, 0.0f), 1.0f) * 255.0f);
+         }
+   }
+
+   if (mSkinImage && (width != mSkinWidth || height != mSkinHeight))
+   {
+      nvgDeleteImage (mContext, mSkinImage);
+      mSkinImage = 0;
+   }
+   if (mSkinImage)
+      nvgUpdateImage (mContext, mSkinImage, pixels.data());
+   else
+      mSkinImage = nvgCreateImageRGBA (mContext, width, height, NVG_IMAGE_PREMULTIPLIED, pixels.data());
+   mSkinWidth = width;
+   mSkinHeight = height;
+}
+
+bool Theme::drawSkin (NVGcontext * ctx, Skin skin, float x, float y, float w, float h, float alpha) const
+{
+   /* Measure contexts recording a window in parallel draw with the images of their parent */
+   if (!mSkinAtlas || !mSkinImage || nvgMeasureParent (ctx) != mContext)
+      return false;
+   const SkinCell & cell = mSkinCells[(int) skin];
+   float bx = (float) cell.borderX, by = (float) cell.borderY;
+   nvgDrawImageSlices (ctx, mSkinImage, (float) cell.x, (float) cell.y, (float) cell.w, (float) cell.h,
+                       bx, by, bx, by, x, y, w, h, alpha);
+   return true;
 }
 
 NAMESPACE_END (nanogui)
@@ -15,18 +15,118 @@
 
 #include "common.h"
 #include "object.h"
+#include "internedstring.h"
+#include "../nanovg/nanovg.h"
+#include <cstdint>
+#include <string>
 
 NAMESPACE_BEGIN (nanogui)
 
+/**
+   \brief Font name resolved to a NanoVG handle on first use
+
+   Draw code passes \ref id() to nvgFontFaceId() instead of looking the name
+   up on every call. A name that was not found is looked up again only after
+   fonts were added to the context.
+*/
+class FontHandle
+{
+   public:
+      FontHandle (const std::string & name) : mName (name) { }
+
+      /// Return the font name
+      const std::string & name() const
+      {
+         return mName.str();
+      }
+      /// Set the font name, resolved again on the next \ref id()
+      void setName (const std::string & name)
+      {
+         mName = name;
+         mContext = nullptr;
+      }
+
+      /// Return the handle of the font in \c ctx, -1 if there is no such font
+      int id (NVGcontext * ctx) const
+      {
+         /* Measure contexts have the fonts of their parent under the same handles, and may be
+            used from several threads at once, so they leave the cache alone */
+         NVGcontext * parent = nvgMeasureParent (ctx);
+         if (parent != ctx)
+            return parent == mContext && mId >= 0 ? mId : nvgFindFont (ctx, mName.c_str());
+         if (ctx != mContext || (mId < 0 && mFontCount != nvgFontCount (ctx)))
+         {
+            mContext = ctx;
+            mId = nvgFindFont (ctx, mName.c_str());
+            /* Read after the lookup, which may have loaded fonts */
+            mFontCount = nvgFontCount (ctx);
+         }
+         return mId;
+      }
+
+   private:
+      InternedString mName;
+      mutable NVGcontext * mContext = nullptr;
+      mutable int mId = -1;
+      mutable int mFontCount = 0;
+};
+
+/**
+   \brief Storage class for basic theme-related properties
+
+   After editing the fields below, call \ref changed() to rebuild the paints
+   derived from them and to let retained widgets record themselves again.
+
+   \ref changed() also renders the backgrounds of buttons, text boxes, check
+   boxes and progress bars in each of their states once into a skin atlas,
+   an image the widgets then draw as nine-slices, see \ref drawSkin(). Their
+   backgrounds are then textured quads of one image, which the renderer
+   merges into few draws, instead of gradients, fills and strokes per widget.
+*/
 class  Theme : public Object
 {
    public:
       Theme (NVGcontext * ctx);
 
-      /* Fonts */
-      int mFontNormal;
-      int mFontBold;
-      int mFontIcons;
+      /// Rebuild the precomputed paints and bump \ref version()
+      void changed();
+      /// Return a counter increased by every \ref changed(), compared by the draw caches of the widgets
+      uint32_t version() const
+      {
+         return mVersion;
+      }
+
+      /// Widget backgrounds in the skin atlas
+      enum class Skin : uint8_t
+      {
+         Button,
+         ButtonFocused,
+         ButtonPushed,
+         TextBox,
+         TextBoxEditing,
+         TextBoxInvalid,
+         CheckBox,
+         CheckBoxPushed,
+         ProgressBar,
+         Count
+      };
+
+      /**
+         \brief Draw \c skin stretched over the rectangle, return false when the widget has to draw it itself
+
+         That is when \ref mSkinAtlas is off, or \c ctx is not the context the
+         theme was created with.
+      */
+      bool drawSkin (NVGcontext * ctx, Skin skin, float x, float y, float w, float h, float alpha = 1.0f) const;
+
+      /// Place a paint built for the unit box at \c x, \c y, scaled to the height \c h
+      static NVGpaint placePaint (const NVGpaint & unit, float x, float y, float h)
+      {
+         NVGpaint paint = unit;
+         float xform[6] = { h, 0.0f, 0.0f, h, x, y };
+         nvgTransformMultiply (paint.xform, xform);
+         return paint;
+      }
 
       /* Spacing-related parameters */
       int mStandardFontSize;
@@ -37,6 +137,11 @@ class  Theme : public Object
       int mWindowDropShadowSize;
       int mButtonCornerRadius;
 
+      /* Fonts */
+      FontHandle mFontNormal { "sans" };
+      FontHandle mFontBold { "sans-bold" };
+      FontHandle mFontIcons { "icons" };
+
       /* Generic colors */
       Color mDropShadow;
       Color mTransparent;
@@ -69,8 +174,33 @@ class  Theme : public Object
 
       Color mWindowPopup;
       Color mWindowPopupTransparent;
+
+      /* Vertical gradients from the top to the bottom of the unit box, see placePaint() */
+      NVGpaint mButtonPaintFocused;
+      NVGpaint mButtonPaintUnfocused;
+      NVGpaint mButtonPaintPushed;
+      NVGpaint mWindowHeaderPaint;
+
+      /// Whether widgets draw their backgrounds from the skin atlas, like the other fields followed by \ref changed()
+      bool mSkinAtlas = true;
    protected:
+      /* The atlas is left to the context, which may be gone by the time the last widget drops its theme */
       virtual ~Theme() { };
+
+      /// Cell of a skin in the atlas, with the borders kept when it is stretched
+      struct SkinCell
+      {
+         int x, y, w, h;
+         int borderX, borderY;
+      };
+      /// Render the skins into the atlas, creating it or replacing its contents
+      void renderSkins();
+
+      NVGcontext * mContext;
+      uint32_t mVersion = 0;
+      int mSkinImage = 0;
+      int mSkinWidth = 0, mSkinHeight = 0;
+      SkinCell mSkinCells[(int) Skin::Count];
 };
 
 NAMESPACE_END (nanogui)
@@ -0,0 +1,332 @@
+/*
+    src/treeview.cpp -- Virtualized tree of expandable rows driven by
+    a model
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "treeview.h"
+#include "theme.h"
+#include "entypo.h"
+#include "../nanovg/nanovg.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+/* The children of a node that was expanded at least once */
+struct TreeView::Expansion
+{
+   Expansion * parent;	// nullptr for the root
+   int index;	// among the children of the parent
+   Node node;
+   int depth;	// of the rows of the children
+   bool open;
+   int rows;	// rows of the children and of their open expansions
+   std::vector<int> counts;	// Fenwick tree of the rows of each child, 1-based
+   std::vector<std::unique_ptr<Expansion>> children;	// nullptr if never expanded
+
+   int size() const
+   {
+      return (int) children.size();
+   }
+
+   void add (int i, int delta)
+   {
+      for (++i; i < (int) counts.size(); i += i & -i)
+         counts[i] += delta;
+      rows += delta;
+   }
+
+   /// Rows of the children before \c i
+   int prefix (int i) const
+   {
+      int sum = 0;
+      for (; i > 0; i -= i & -i)
+         sum += counts[i];
+      return sum;
+   }
+
+   /// The child whose rows contain \c row, which becomes the offset within them
+   int find (int & row) const
+   {
+      int n = size(), pos = 0, step = 1;
+      while (step * 2 <= n)
+         step *= 2;
+      for (; step > 0; step /= 2)
+         if (pos + step <= n && counts[pos + step] <= row)
+         {
+            pos += step;
+            row -= counts[pos];
+         }
+      return pos;
+   }
+};
+
+/* Recycled row widget; hands clicks back to the view by row */
+class TreeViewRow : public Widget
+{
+   public:
+      TreeViewRow (TreeView * tree)
+         : Widget (tree), mTree (tree) {}
+
+      virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int)
+      {
+         if (button != MOUSE_BUTTON_LEFT || !down)
+            return false;
+         int chevron = mPos.x() + mDepth * mTree->indent();
+         if (mExpandable && p.x() >= chevron && p.x() < chevron + mSize.y())
+            mTree->toggleRow (mRow);
+         else
+            mTree->selectRow (mRow);
+         return true;
+      }
+
+      virtual void draw (NVGcontext * ctx)
+      {
+         if (mSelected)
+         {
+            nvgBeginPath (ctx);
+            nvgRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y());
+            nvgFillColor (ctx, Color (255, 32));
+            nvgFill (ctx);
+         }
+         float x = mPos.x() + mDepth * mTree->indent();
+         float y = mPos.y() + mSize.y() * 0.5f;
+         nvgFillColor (ctx, mTheme->mTextColor);
+         nvgTextAlign (ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+         if (mExpandable)
+         {
+            nvgFontSize (ctx, fontSize() * 1.5f);
+            nvgFontFaceId (ctx, mTheme->mFontIcons.id (ctx));
+            nvgIcon (ctx, x, y - 1, mOpen ? ENTYPO_ICON_CHEVRON_DOWN : ENTYPO_ICON_CHEVRON_RIGHT);
+         }
+         nvgFontSize (ctx, fontSize());
+         nvgFontFaceId (ctx, mTheme->mFontNormal.id (ctx));
+         nvgText (ctx, x + mSize.y(), y, mLabel.c_str(), nullptr);
+      }
+
+      TreeView * mTree;
+      std::string mLabel;
+      int mRow = -1;
+      int mDepth = 0;
+      bool mExpandable = false;
+      bool mOpen = false;
+      bool mSelected = false;
+};
+
+TreeView::TreeView (Widget * parent)
+   : VListPanel (parent), mSelected (nullptr), mIndent (16)
+{
+   setRowFactory ([this] (Widget *) -> Widget * { return new TreeViewRow (this); });
+   setRowBinder ([this] (Widget * row, int index) { bind (row, index); });
+}
+
+TreeView::~TreeView() {}
+
+void TreeView::setModel (TreeModel * model)
+{
+   mModel = model;
+   mRoot.reset();
+   if (mModel)
+   {
+      mRoot = expand (nullptr, -1, nullptr, 0);
+      mRoot->open = true;
+   }
+   setItemCount (mRoot ? mRoot->rows : 0);
+}
+
+std::unique_ptr<TreeView::Expansion> TreeView::expand (Expansion * parent, int index, Node node, int depth)
+{
+   std::unique_ptr<Expansion> e (new Expansion());
+   e->parent = parent;
+   e->index = index;
+   e->node = node;
+   e->depth = depth;
+   e->open = false;
+   e->rows = 0;
+   int n = std::max (0, mModel->childCount (node));
+   e->children.resize (n);
+   e->counts.assign (n + 1, 0);
+   for (int i = 0; i < n; ++i)
+   {
+      Node child = mModel->child (node, i);
+      int rows = 1;
+      if (mModel->expanded (child))
+      {
+         e->children[i] = expand (e.get(), i, child, depth + 1);
+         e->children[i]->open = true;
+         rows += e->children[i]->rows;
+      }
+      e->counts[i + 1] = rows;
+      e->rows += rows;
+   }
+   /* Build the Fenwick tree in place in linear time */
+   for (int i = 1; i <= n; ++i)
+   {
+      int j = i + (i & -i);
+      if (j <= n)
+         e->counts[j] += e->counts[i];
+   }
+   return e;
+}
+
+TreeView::Expansion * TreeView::locate (int row, int & index) const
+{
+   Expansion * e = mRoot.get();
+   while (true)
+   {
+      int i = e->find (row);
+      if (row == 0)
+      {
+         index = i;
+         return e;
+      }
+      /* Skip the row of the child itself, the rest are its open expansion */
+      row -= 1;
+      e = e->children[i].get();
+   }
+}
+
+TreeView::Expansion * TreeView::locate (Node node, int & index)
+{
+   if (!mRoot || !node)
+      return nullptr;
+   std::vector<int> path;
+   for (Node n = node; n; n = mModel->parent (n))
+   {
+      int i = mModel->indexOf (n);
+      if (i < 0)
+         return nullptr;
+      path.push_back (i);
+   }
+   Expansion * e = mRoot.get();
+   for (size_t k = path.size() - 1; k > 0; --k)
+   {
+      int i = path[k];
+      if (i >= e->size())
+         return nullptr;
+      /* Ancestors are created collapsed, which leaves all row counts as they are */
+      if (!e->children[i])
+         e->children[i] = expand (e, i, mModel->child (e->node, i), e->depth + 1);
+      e = e->children[i].get();
+   }
+   if (path[0] >= e->size())
+      return nullptr;
+   index = path[0];
+   return e;
+}
+
+void TreeView::setExpanded (Expansion * parent, int index, bool expanded)
+{
+   std::unique_ptr<Expansion> & child = parent->children[index];
+   if (!child)
+   {
+      if (!expanded)
+         return;
+      child = expand (parent, index, mModel->child (parent->node, index), parent->depth + 1);
+   }
+   if (child->open == expanded)
+      return;
+   child->open = expanded;
+   /* Only ancestors up to the first collapsed one show the rows of the child */
+   int delta = expanded ? child->rows : -child->rows;
+   for (Expansion * e = parent; ; index = e->index, e = e->parent)
+   {
+      e->add (index, delta);
+      if (!e->open || !e->parent)
+         break;
+   }
+}
+
+bool TreeView::expanded (Node node) const
+{
+   if (!mRoot || !node)
+      return false;
+   std::vector<int> path;
+   for (Node n = node; n; n = mModel->parent (n))
+   {
+      int i = mModel->indexOf (n);
+      if (i < 0)
+         return false;
+      path.push_back (i);
+   }
+   const Expansion * e = mRoot.get();
+   for (size_t k = path.size(); k > 0 && e; --k)
+   {
+      if (path[k - 1] >= e->size())
+         return false;
+      e = e->children[path[k - 1]].get();
+   }
+   return e && e->open;
+}
+
+bool TreeView::setExpanded (Node node, bool expanded)
+{
+   int index;
+   Expansion * e = locate (node, index);
+   if (!e)
+      return false;
+   setExpanded (e, index, expanded);
+   setItemCount (mRoot->rows);
+   return true;
+}
+
+bool TreeView::scrollToNode (Node node)
+{
+   int index;
+   Expansion * e = locate (node, index);
+   if (!e)
+      return false;
+   int row = e->prefix (index);
+   for (Expansion * a = e; a->parent; a = a->parent)
+      setExpanded (a->parent, a->index, true);
+   for (Expansion * a = e; a->parent; a = a->parent)
+      row += a->parent->prefix (a->index) + 1;
+   setItemCount (mRoot->rows);
+   scrollToItem (row);
+   return true;
+}
+
+void TreeView::toggleRow (int row)
+{
+   if (!mRoot || row < 0 || row >= mRoot->rows)
+      return;
+   int index;
+   Expansion * e = locate (row, index);
+   const Expansion * child = e->children[index].get();
+   setExpanded (e, index, !(child && child->open));
+   setItemCount (mRoot->rows);
+}
+
+void TreeView::selectRow (int row)
+{
+   if (!mRoot || row < 0 || row >= mRoot->rows)
+      return;
+   int index;
+   Expansion * e = locate (row, index);
+   mSelected = mModel->child (e->node, index);
+   refresh();
+   if (mCallback)
+      mCallback (mSelected);
+}
+
+void TreeView::bind (Widget * widget, int row)
+{
+   TreeViewRow * r = (TreeViewRow *) widget;
+   int index;
+   Expansion * e = locate (row, index);
+   Node node = mModel->child (e->node, index);
+   const Expansion * child = e->children[index].get();
+   r->mRow = row;
+   r->mDepth = e->depth;
+   r->mExpandable = mModel->childCount (node) > 0;
+   r->mOpen = child && child->open;
+   r->mSelected = node == mSelected;
+   r->mLabel = mModel->label (node);
+}
+
+NAMESPACE_END (nanogui)
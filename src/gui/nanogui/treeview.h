@@ -0,0 +1,168 @@
+/*
+    nanogui/treeview.h -- Virtualized tree of expandable rows driven by
+    a model
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "vlistpanel.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Hierarchy shown by a \ref TreeView
+
+   Nodes are opaque pointers owned by the application, e.g. the scene graph
+   nodes themselves; \c nullptr stands for the invisible root whose children
+   are the top level rows. The view only asks for the children of nodes that
+   are expanded, so the model may produce them lazily.
+*/
+class  TreeModel : public Object
+{
+   public:
+      typedef const void * Node;
+
+      /// Return the number of children of \c node
+      virtual int childCount (Node node) const = 0;
+      /// Return the child \c index of \c node
+      virtual Node child (Node node, int index) const = 0;
+      /// Return the text of the row of \c node
+      virtual std::string label (Node node) const = 0;
+
+      /// Return whether \c node starts out expanded when the view first reaches it
+      virtual bool expanded (Node) const
+      {
+         return false;
+      }
+      /// Return the parent of \c node, needed by \ref TreeView::scrollToNode()
+      virtual Node parent (Node) const
+      {
+         return nullptr;
+      }
+      /// Return the index of \c node among the children of its parent, -1 if unknown
+      virtual int indexOf (Node) const
+      {
+         return -1;
+      }
+
+   protected:
+      virtual ~TreeModel() { }
+};
+
+/**
+   \brief Tree of expandable rows on top of \ref VListPanel
+
+   Only the visible rows exist as widgets, recycled while scrolling like the
+   rows of the list panel. For every node that was ever expanded, the view
+   keeps the number of rows below each of its children in a Fenwick tree, so
+   that the node of a row is found, a node is expanded or collapsed, and a
+   node is scrolled to by walking its ancestors with a logarithmic step per
+   level, independent of how many rows the tree has. Collapsing keeps the
+   state below, so expanding again restores the nested expansions.
+
+   The view reads the structure of the model as it expands nodes; call
+   \ref setModel() again after the model's children change.
+
+   \code
+   TreeView * tree = new TreeView (window);
+   tree->setFixedSize (Vector2i (300, 500));
+   tree->setModel (new SceneModel (scene));
+   tree->setCallback ([&] (TreeModel::Node node) { select ((const SceneNode *) node); });
+   \endcode
+*/
+class  TreeView : public VListPanel
+{
+   public:
+      typedef TreeModel::Node Node;
+
+      TreeView (Widget * parent);
+      ~TreeView();
+
+      /// Return the model
+      TreeModel * model()
+      {
+         return mModel;
+      }
+      /// Return the model
+      const TreeModel * model() const
+      {
+         return mModel.get();
+      }
+      /// Show \c model, collapsing everything to the model's initial state
+      void setModel (TreeModel * model);
+
+      /// Return whether \c node is expanded
+      bool expanded (Node node) const;
+      /// Expand or collapse \c node, return false if the model cannot locate it
+      bool setExpanded (Node node, bool expanded);
+
+      /// Expand the ancestors of \c node and scroll its row into view, return false if the model cannot locate it
+      bool scrollToNode (Node node);
+
+      /// Return the selected node, nullptr if none
+      Node selected() const
+      {
+         return mSelected;
+      }
+      /// Select \c node without calling the callback
+      void setSelected (Node node)
+      {
+         mSelected = node;
+         refresh();
+      }
+
+      /// Set the function called with the node of a row that was clicked
+      void setCallback (Callback<void (Node)> callback)
+      {
+         mCallback = std::move (callback);
+      }
+
+      /// Return the horizontal indentation per level
+      int indent() const
+      {
+         return mIndent;
+      }
+      /// Set the horizontal indentation per level
+      void setIndent (int indent)
+      {
+         mIndent = std::max (0, indent);
+         refresh();
+      }
+
+      /// Expand or collapse the node of \c row
+      void toggleRow (int row);
+      /// Select the node of \c row and call the callback
+      void selectRow (int row);
+
+   protected:
+      struct Expansion;
+
+      /// Children of \c node, with the row counts of those the model starts out expanded
+      std::unique_ptr<Expansion> expand (Expansion * parent, int index, Node node, int depth);
+      /// The expansion holding the row \c row of the tree, and the child that \c row is
+      Expansion * locate (int row, int & index) const;
+      /// The expansion holding \c node, creating its ancestors, nullptr if the model cannot locate it
+      Expansion * locate (Node node, int & index);
+      /// Expand or collapse child \c index of \c parent
+      void setExpanded (Expansion * parent, int index, bool expanded);
+      /// Fill a row widget with the node of \c row
+      void bind (Widget * widget, int row);
+
+      ref<TreeModel> mModel;
+      std::unique_ptr<Expansion> mRoot;
+      Callback<void (Node)> mCallback;
+      Node mSelected;
+      int mIndent;
+};
+
+NAMESPACE_END (nanogui)
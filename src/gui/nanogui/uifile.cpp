@@ -0,0 +1,643 @@
+/*
+    src/uifile.cpp -- Compact binary description of widget trees
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "uifile.h"
+#include "button.h"
+#include "checkbox.h"
+#include "label.h"
+#include "layout.h"
+#include "progressbar.h"
+#include "slider.h"
+#include "toolbutton.h"
+#include "widgetarena.h"
+#include "window.h"
+#include "../util/MappedFile.h"
+#include "../util/Profiler.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+NAMESPACE_BEGIN (nanogui)
+
+/* The header, the string indices of the class names, the offsets of the strings followed by their
+   bytes padded to a word, then the records. Numbers are 32-bit words in native byte order, the
+   version changes with the layout. */
+static const uint32_t UiMagic = 0x49554e47;	// "NGUI"
+static const uint32_t UiVersion = 1;
+static const uint32_t UiLayoutResults = 1;	// header flag
+static const int HeaderWords = 8;
+
+enum UiLayoutKind
+{
+   NoLayout,
+   BoxLayoutKind,
+   GroupLayoutKind,
+   GridLayoutKind
+};
+
+namespace
+{
+   struct Registry
+   {
+      std::unordered_map<std::type_index, std::pair<std::string, UiType>> byType;
+      std::unordered_map<std::string, UiType> byName;
+   };
+
+   void putButton (const Button * button, UiWriter & out)
+   {
+      out.putString (button->caption());
+      out.putInt (button->icon());
+      out.putInt (button->flags());
+      out.putInt ((int)button->iconPosition());
+      out.putInt (button->pushed());
+      out.putColor (button->backgroundColor());
+      out.putColor (button->textColor());
+   }
+
+   Button * getButton (Button * button, UiReader & in)
+   {
+      button->setIcon (in.getInt());
+      button->setFlags (in.getInt());
+      button->setIconPosition ((Button::IconPosition)in.getInt());
+      button->setPushed (in.getInt() != 0);
+      button->setBackgroundColor (in.getColor());
+      button->setTextColor (in.getColor());
+      return button;
+   }
+
+   void addBuiltins()
+   {
+      registerUiType<Widget> ("Widget",
+                              [] (const Widget *, UiWriter &) {},
+                              [] (Widget * parent, UiReader &) { return new Widget (parent); });
+      registerUiType<Window> ("Window",
+                              [] (const Window * window, UiWriter & out)
+      {
+         out.putString (window->title());
+         out.putInt (window->modal());
+      },
+      [] (Widget * parent, UiReader & in)
+      {
+         Window * window = new Window (parent, in.getString());
+         window->setModal (in.getInt() != 0);
+         return window;
+      });
+      registerUiType<Label> ("Label",
+                             [] (const Label * label, UiWriter & out)
+      {
+         out.putString (label->caption());
+         out.putString (label->font());
+         out.putColor (label->color());
+      },
+      [] (Widget * parent, UiReader & in)
+      {
+         std::string caption = in.getString();
+         Label * label = new Label (parent, caption, in.getString());
+         label->setColor (in.getColor());
+         return label;
+      });
+      registerUiType<Button> ("Button", putButton, [] (Widget * parent, UiReader & in)
+      {
+         return getButton (new Button (parent, in.getString()), in);
+      });
+      registerUiType<ToolButton> ("ToolButton", putButton, [] (Widget * parent, UiReader & in)
+      {
+         std::string caption = in.getString();
+         return getButton (new ToolButton (parent, 0, caption), in);
+      });
+      registerUiType<CheckBox> ("CheckBox",
+                                [] (const CheckBox * checkBox, UiWriter & out)
+      {
+         out.putString (checkBox->caption());
+         out.putInt (checkBox->checked());
+      },
+      [] (Widget * parent, UiReader & in)
+      {
+         CheckBox * checkBox = new CheckBox (parent, in.getString());
+         checkBox->setChecked (in.getInt() != 0);
+         return checkBox;
+      });
+      registerUiType<ProgressBar> ("ProgressBar",
+                                   [] (const ProgressBar * bar, UiWriter & out)
+      {
+         out.putFloat (const_cast<ProgressBar *> (bar)->value());
+      },
+      [] (Widget * parent, UiReader & in)
+      {
+         ProgressBar * bar = new ProgressBar (parent);
+         bar->setValue (in.getFloat());
+         return bar;
+      });
+      registerUiType<Slider> ("Slider",
+                              [] (const Slider * slider, UiWriter & out)
+      {
+         out.putFloat (slider->value());
+         out.putColor (slider->highlightColor());
+         out.putFloat (slider->highlightedRange().first);
+         out.putFloat (slider->highlightedRange().second);
+      },
+      [] (Widget * parent, UiReader & in)
+      {
+         Slider * slider = new Slider (parent);
+         slider->setValue (in.getFloat());
+         slider->setHighlightColor (in.getColor());
+         float first = in.getFloat();
+         slider->setHighlightedRange (std::make_pair (first, in.getFloat()));
+         return slider;
+      });
+   }
+
+   /* Built on first use, registering types is not thread-safe */
+   Registry & registry()
+   {
+      static Registry * instance = nullptr;
+      if (!instance)
+      {
+         instance = new Registry();
+         addBuiltins();
+      }
+      return *instance;
+   }
+}
+
+void registerUiType (std::type_index type, const std::string & name, const UiType & ui)
+{
+   Registry & r = registry();
+   r.byType[type] = std::make_pair (name, ui);
+   r.byName[name] = ui;
+}
+
+UiWriter::UiWriter (const std::vector<Theme *> & themes)
+   : mThemes (themes) {}
+
+void UiWriter::write (const Widget * root, bool layoutResults)
+{
+   mLayoutResults = layoutResults;
+   mWidgetCount = 0;
+   mTypes.clear();
+   mTypeIndices.clear();
+   mStrings.assign (1, std::string());
+   mStringIndices.clear();
+   mStringIndices[std::string()] = 0;
+   mRecords.clear();
+   /* Pre-order with an explicit stack, every record followed by those of its children */
+   std::vector<const Widget *> stack (1, root);
+   while (!stack.empty())
+   {
+      const Widget * widget = stack.back();
+      stack.pop_back();
+      writeWidget (widget);
+      for (int i = widget->childCount(); i-- > 0;)
+         stack.push_back (widget->children()[i]);
+   }
+}
+
+void UiWriter::writeWidget (const Widget * widget)
+{
+   Registry & r = registry();
+   auto type = r.byType.find (std::type_index (typeid (*widget)));
+   if (type == r.byType.end())
+      throw std::runtime_error (std::string ("UiWriter: no UiType for ") + typeid (*widget).name());
+   auto index = mTypeIndices.find (type->second.first);
+   if (index == mTypeIndices.end())
+   {
+      index = mTypeIndices.insert (std::make_pair (type->second.first, (uint32_t)mTypes.size())).first;
+      mTypes.push_back (stringIndex (type->second.first));
+   }
+   putInt ((int)index->second);
+   putInt (widget->childCount());
+   putInt ((widget->visible() ? 1 : 0) | (widget->enabled() ? 2 : 0));
+   /* Themes that differ from the parent's, the others are inherited when the widget is constructed */
+   int theme = 0;
+   const Widget * parent = widget->parent();
+   if (widget->theme() && (!parent || parent->theme() != widget->theme()))
+      for (size_t i = 0; i < mThemes.size(); ++i)
+         if (mThemes[i] == widget->theme())
+            theme = (int)i + 1;
+   putInt (theme);
+   putString (widget->id());
+   putString (widget->tooltip());
+   putInt (widget->mFontSize);
+   putInt (widget->fixedWidth());
+   putInt (widget->fixedHeight());
+   putInt (widget->position().x());
+   putInt (widget->position().y());
+   putInt (widget->width());
+   putInt (widget->height());
+   if (mLayoutResults)
+   {
+      Vector2i preferred = widget->mPreferredSizeValid ? widget->mPreferredSize : widget->size();
+      putInt (preferred.x());
+      putInt (preferred.y());
+   }
+   writeLayout (widget->layout());
+   /* Preceded by its length, which the reader checks */
+   size_t length = mRecords.size();
+   putInt (0);
+   type->second.second.write (widget, *this);
+   mRecords[length] = (uint32_t) (mRecords.size() - length - 1);
+   ++mWidgetCount;
+}
+
+void UiWriter::writeLayout (const Layout * layout)
+{
+   if (!layout)
+      putInt (NoLayout);
+   else if (auto box = dynamic_cast<const BoxLayout *> (layout))
+   {
+      putInt (BoxLayoutKind);
+      putInt ((int)box->orientation());
+      putInt ((int)box->alignment());
+      putInt (box->margin());
+      putInt (box->spacing());
+   }
+   else if (auto group = dynamic_cast<const GroupLayout *> (layout))
+   {
+      putInt (GroupLayoutKind);
+      putInt (group->margin());
+      putInt (group->spacing());
+      putInt (group->groupSpacing());
+      putInt (group->groupIndent());
+   }
+   else if (auto grid = dynamic_cast<const GridLayout *> (layout))
+   {
+      putInt (GridLayoutKind);
+      putInt ((int)grid->orientation());
+      putInt (grid->resolution());
+      putInt (grid->margin());
+      putInt (grid->spacing (0));
+      putInt (grid->spacing (1));
+      for (int axis = 0; axis < 2; ++axis)
+      {
+         const std::vector<Alignment> & alignments = grid->alignments (axis);
+         putInt ((int)grid->alignment (axis, (int)alignments.size()));
+         putInt ((int)alignments.size());
+         for (Alignment alignment : alignments)
+            putInt ((int)alignment);
+      }
+   }
+   else
+      throw std::runtime_error (std::string ("UiWriter: layouts of type ") + typeid (*layout).name() + " cannot be stored");
+}
+
+uint32_t UiWriter::stringIndex (const std::string & str)
+{
+   auto it = mStringIndices.find (str);
+   if (it != mStringIndices.end())
+      return it->second;
+   uint32_t index = (uint32_t)mStrings.size();
+   mStrings.push_back (str);
+   mStringIndices[str] = index;
+   return index;
+}
+
+void UiWriter::putFloat (float value)
+{
+   uint32_t word;
+   memcpy (&word, &value, sizeof (word));
+   mRecords.push_back (word);
+}
+
+void UiWriter::putString (const std::string & str)
+{
+   mRecords.push_back (stringIndex (str));
+}
+
+void UiWriter::putColor (const Color & color)
+{
+   for (int i = 0; i < 4; ++i)
+      putFloat (color[i]);
+}
+
+std::vector<unsigned char> UiWriter::data() const
+{
+   std::vector<uint32_t> words;
+   uint32_t stringBytes = 0;
+   for (const auto & str : mStrings)
+      stringBytes += (uint32_t)str.size();
+   uint32_t header[HeaderWords] =
+   {
+      UiMagic, UiVersion, mLayoutResults ? UiLayoutResults : 0, (uint32_t)mWidgetCount,
+      (uint32_t)mTypes.size(), (uint32_t)mStrings.size(), stringBytes, (uint32_t)mRecords.size()
+   };
+   words.insert (words.end(), header, header + HeaderWords);
+   words.insert (words.end(), mTypes.begin(), mTypes.end());
+   uint32_t offset = 0;
+   for (const auto & str : mStrings)
+   {
+      words.push_back (offset);
+      offset += (uint32_t)str.size();
+   }
+   words.push_back (offset);
+   std::vector<unsigned char> bytes (words.size() * 4 + ((stringBytes + 3) & ~3u) + mRecords.size() * 4, 0);
+   unsigned char * out = bytes.data();
+   memcpy (out, words.data(), words.size() * 4);
+   out += words.size() * 4;
+   for (const auto & str : mStrings)
+   {
+      memcpy (out, str.data(), str.size());
+      out += str.size();
+   }
+   out = bytes.data() + words.size() * 4 + ((stringBytes + 3) & ~3u);
+   if (!mRecords.empty())
+      memcpy (out, mRecords.data(), mRecords.size() * 4);
+   return bytes;
+}
+
+bool UiWriter::save (const std::string & path) const
+{
+   std::vector<unsigned char> bytes = data();
+   FILE * fp = fopen (path.c_str(), "wb");
+   if (!fp)
+      return false;
+   bool ok = fwrite (bytes.data(), 1, bytes.size(), fp) == bytes.size();
+   return fclose (fp) == 0 && ok;
+}
+
+UiReader::UiReader (const std::vector<Theme *> & themes)
+   : mThemes (themes) {}
+
+uint32_t UiReader::word()
+{
+   if (mEnd - mPos < 4)
+      throw std::runtime_error ("UiReader: unexpected end of data");
+   uint32_t value;
+   memcpy (&value, mPos, sizeof (value));
+   mPos += 4;
+   return value;
+}
+
+float UiReader::getFloat()
+{
+   uint32_t value = word();
+   float result;
+   memcpy (&result, &value, sizeof (result));
+   return result;
+}
+
+const std::string & UiReader::getString()
+{
+   uint32_t index = word();
+   if (index >= mStrings.size())
+      throw std::runtime_error ("UiReader: string index out of range");
+   return mStrings[index];
+}
+
+Color UiReader::getColor()
+{
+   Color color;
+   for (int i = 0; i < 4; ++i)
+      color[i] = getFloat();
+   return color;
+}
+
+Widget * UiReader::load (const std::string & path, Widget * parent, WidgetArena * arena, const Binder & bind)
+{
+   MappedFile file (path);
+   if (!file.data())
+      throw std::runtime_error ("UiReader: cannot open " + path);
+   return read (file.data(), file.size(), parent, arena, bind);
+}
+
+Widget * UiReader::read (const void * data, size_t size, Widget * parent, WidgetArena * arena, const Binder & bind)
+{
+   PROFILE_ZONE ("UiReader::read");
+   mPos = (const unsigned char *)data;
+   mEnd = mPos + size;
+   uint32_t header[HeaderWords];
+   for (auto & value : header)
+      value = word();
+   if (header[0] != UiMagic || header[1] != UiVersion)
+      throw std::runtime_error ("UiReader: not a UI file of this version");
+   mLayoutResults = (header[2] & UiLayoutResults) != 0;
+   uint32_t widgetCount = header[3], typeCount = header[4], stringCount = header[5], stringBytes = header[6];
+   /* The counts size the tables before they are read, they have to fit in what is left */
+   size_t left = (size_t) (mEnd - mPos) / 4;
+   if (stringCount == 0xFFFFFFFF || left < typeCount || left - typeCount <= stringCount)
+      throw std::runtime_error ("UiReader: unexpected end of data");
+   std::vector<uint32_t> typeNames (typeCount);
+   for (auto & name : typeNames)
+      name = word();
+   std::vector<uint32_t> offsets (stringCount + 1);
+   for (auto & offset : offsets)
+      offset = word();
+   if ((size_t) (mEnd - mPos) < stringBytes || offsets.back() != stringBytes)
+      throw std::runtime_error ("UiReader: malformed string table");
+   mStrings.resize (stringCount);
+   for (uint32_t i = 0; i < stringCount; ++i)
+   {
+      if (offsets[i] > offsets[i + 1])
+         throw std::runtime_error ("UiReader: malformed string table");
+      mStrings[i].assign ((const char *)mPos + offsets[i], offsets[i + 1] - offsets[i]);
+   }
+   mPos += (stringBytes + 3) & ~3u;
+   if ((size_t) (mEnd - mPos) / 4 < header[7])
+      throw std::runtime_error ("UiReader: unexpected end of data");
+   mEnd = mPos + header[7] * 4;
+   if (widgetCount > header[7])
+      throw std::runtime_error ("UiReader: malformed header");
+   Registry & r = registry();
+   mTypes.clear();
+   for (uint32_t name : typeNames)
+   {
+      auto type = name < mStrings.size() ? r.byName.find (mStrings[name]) : r.byName.end();
+      if (type == r.byName.end())
+         throw std::runtime_error ("UiReader: no UiType named " + (name < mStrings.size() ? mStrings[name] : std::string ("?")));
+      mTypes.push_back (&type->second);
+   }
+   mLaidOut.clear();
+   if (mLayoutResults)
+      mLaidOut.reserve (widgetCount);
+   if (arena)
+   {
+      WidgetArena::Scope scope (*arena);
+      return readTree (parent, bind);
+   }
+   return readTree (parent, bind);
+}
+
+Widget * UiReader::readTree (Widget * parent, const Binder & bind)
+{
+   struct Open
+   {
+      Widget * widget;
+      int remaining;	// children still to be read
+   };
+   Widget * root = nullptr;
+   std::vector<Open> open;
+   try
+   {
+      do
+      {
+         int children = 0;
+         Widget * widget = readWidget (open.empty() ? parent : open.back().widget, bind, children);
+         if (!root)
+            root = widget;
+         else
+            --open.back().remaining;
+         if (children > 0)
+            open.push_back (Open { widget, children });
+         while (!open.empty() && open.back().remaining == 0)
+            open.pop_back();
+      }
+      while (!open.empty());
+   }
+   catch (...)
+   {
+      if (root && parent)
+         parent->removeChild (root);
+      else if (root)
+         ref<Widget> release (root);
+      mLaidOut.clear();
+      throw;
+   }
+   /* Adding the widgets invalidated the layout of all of them, the stored results are current again */
+   for (auto & entry : mLaidOut)
+   {
+      Widget * widget = entry.first;
+      widget->mPreferredSize = entry.second;
+      widget->mPreferredSizeValid = true;
+      widget->mLayoutDirty = false;
+      widget->mLayoutSize = widget->mSize;
+   }
+   mLaidOut.clear();
+   return root;
+}
+
+Widget * UiReader::readWidget (Widget * parent, const Binder & bind, int & children)
+{
+   uint32_t type = word();
+   if (type >= mTypes.size())
+      throw std::runtime_error ("UiReader: type index out of range");
+   children = (int)word();
+   uint32_t flags = word();
+   uint32_t theme = word();
+   if (theme > mThemes.size())
+      throw std::runtime_error ("UiReader: theme index out of range");
+   const std::string & id = getString();
+   const std::string & tooltip = getString();
+   int fontSize = getInt();
+   Vector2i fixedSize, pos, size, preferred;
+   fixedSize.x() = getInt();
+   fixedSize.y() = getInt();
+   pos.x() = getInt();
+   pos.y() = getInt();
+   size.x() = getInt();
+   size.y() = getInt();
+   if (mLayoutResults)
+   {
+      preferred.x() = getInt();
+      preferred.y() = getInt();
+   }
+   ref<Layout> layout = readLayout();
+   uint32_t length = word();
+   if ((size_t) (mEnd - mPos) / 4 < length)
+      throw std::runtime_error ("UiReader: unexpected end of data");
+   /* The class reads its own record only; what it attached to the parent is removed again on failure */
+   const unsigned char * end = mEnd;
+   int attached = parent ? parent->childCount() : 0;
+   Widget * widget = nullptr;
+   mEnd = mPos + (size_t)length * 4;
+   try
+   {
+      widget = mTypes[type]->create (parent, *this);
+      if (!widget || mPos != mEnd)
+         throw std::runtime_error ("UiReader: malformed record");
+      mEnd = end;
+      if (theme)
+         widget->setTheme (mThemes[theme - 1]);
+      if (!id.empty())
+         widget->setId (id);
+      if (!tooltip.empty())
+         widget->setTooltip (tooltip);
+      if (fontSize > 0)
+         widget->setFontSize (fontSize);
+      widget->setFixedSize (fixedSize);
+      widget->setPosition (pos);
+      widget->setSize (size);
+      widget->setVisible ((flags & 1) != 0);
+      widget->setEnabled ((flags & 2) != 0);
+      if (layout)
+         widget->setLayout (layout);
+      if (mLayoutResults)
+         mLaidOut.push_back (std::make_pair (widget, preferred));
+      if (bind && !id.empty())
+         bind (id, widget);
+   }
+   catch (...)
+   {
+      mEnd = end;
+      if (parent)
+      {
+         while (parent->childCount() > attached)
+            parent->removeChild (parent->childCount() - 1);
+      }
+      else
+         if (widget)
+            ref<Widget> release (widget);
+      throw;
+   }
+   return widget;
+}
+
+ref<Layout> UiReader::readLayout()
+{
+   switch (word())
+   {
+      case NoLayout:
+         return ref<Layout>();
+      case BoxLayoutKind:
+      {
+         Orientation orientation = (Orientation)getInt();
+         Alignment alignment = (Alignment)getInt();
+         int margin = getInt();
+         return ref<Layout> (new BoxLayout (orientation, alignment, margin, getInt()));
+      }
+      case GroupLayoutKind:
+      {
+         int margin = getInt(), spacing = getInt(), groupSpacing = getInt();
+         return ref<Layout> (new GroupLayout (margin, spacing, groupSpacing, getInt()));
+      }
+      case GridLayoutKind:
+      {
+         Orientation orientation = (Orientation)getInt();
+         int resolution = getInt(), margin = getInt();
+         ref<GridLayout> grid = new GridLayout (orientation, resolution, Alignment::Middle, margin);
+         grid->setSpacing (0, getInt());
+         grid->setSpacing (1, getInt());
+         for (int axis = 0; axis < 2; ++axis)
+         {
+            Alignment fallback = (Alignment)getInt();
+            int count = getInt();
+            if (count < 0 || count > (mEnd - mPos) / 4)
+               throw std::runtime_error ("UiReader: malformed grid layout");
+            std::vector<Alignment> alignments (count);
+            for (auto & alignment : alignments)
+               alignment = (Alignment)getInt();
+            if (axis == 0)
+            {
+               grid->setColAlignment (fallback);
+               grid->setColAlignment (alignments);
+            }
+            else
+            {
+               grid->setRowAlignment (fallback);
+               grid->setRowAlignment (alignments);
+            }
+         }
+         return ref<Layout> (grid.get());
+      }
+      default:
+         throw std::runtime_error ("UiReader: unknown layout");
+   }
+}
+
+NAMESPACE_END (nanogui)
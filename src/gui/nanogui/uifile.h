@@ -0,0 +1,176 @@
+/*
+    nanogui/uifile.h -- Compact binary description of widget trees
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include <functional>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+class UiReader;
+class UiWriter;
+class WidgetArena;
+
+/**
+   \brief How the widgets of one class are stored in UI files
+
+   \c write stores what the class needs beyond the state every widget has,
+   which is its id, tooltip, theme, font size, fixed size, position, size,
+   visibility and layout. \c create constructs the widget below \c parent
+   from the same values, read back in the same order. Callbacks are not
+   stored; the ids of the widgets bind them after loading.
+*/
+struct UiType
+{
+   std::function<void (const Widget *, UiWriter &)> write;
+   std::function<Widget * (Widget *, UiReader &)> create;
+};
+
+/// Register how widgets of exactly the class \c type are stored, under a \c name that files refer to
+void registerUiType (std::type_index type, const std::string & name, const UiType & ui);
+
+/// Register \c T with functions taking the class itself, see \ref UiType
+template <typename T, typename Write, typename Create>
+void registerUiType (const std::string & name, Write write, Create create)
+{
+   UiType ui;
+   ui.write = [write] (const Widget * widget, UiWriter & out)
+   {
+      write (static_cast<const T *> (widget), out);
+   };
+   ui.create = [create] (Widget * parent, UiReader & in) -> Widget *
+   {
+      return create (parent, in);
+   };
+   registerUiType (std::type_index (typeid (T)), name, ui);
+}
+
+/**
+   \brief Stores widget trees built in code as a UI file
+
+   The file holds the names of the widget classes and every distinct string
+   once, followed by the widgets in pre-order as flat records of 32-bit words
+   in native byte order. Themes are stored as indices into a list of themes
+   that the reader is given as well. Widgets whose class or layout has no
+   \ref UiType, such as popups, are refused with a \c std::runtime_error.
+
+   \code
+   UiWriter writer ({ theme });
+   writer.write (window, true);
+   writer.save ("operator.ui");
+   \endcode
+*/
+class  UiWriter
+{
+   public:
+      explicit UiWriter (const std::vector<Theme *> & themes = {});
+
+      /**
+         \brief Store \c root and all widgets below it, replacing what was stored before
+
+         With \c layoutResults the tree must have been laid out, and the reader
+         restores it as laid out instead of measuring and arranging it again.
+      */
+      void write (const Widget * root, bool layoutResults = false);
+
+      /// Return the contents of the file
+      std::vector<unsigned char> data() const;
+      /// Write the file, return whether it succeeded
+      bool save (const std::string & path) const;
+
+      /* For UiType::write */
+      void putInt (int value)
+      {
+         mRecords.push_back ((uint32_t)value);
+      }
+      void putFloat (float value);
+      void putString (const std::string & str);
+      void putColor (const Color & color);
+
+   protected:
+      void writeWidget (const Widget * widget);
+      void writeLayout (const Layout * layout);
+      uint32_t stringIndex (const std::string & str);
+
+      std::vector<Theme *> mThemes;
+      bool mLayoutResults = false;
+      int mWidgetCount = 0;
+      std::vector<uint32_t> mTypes;	// string indices of the class names
+      std::unordered_map<std::string, uint32_t> mTypeIndices;
+      std::vector<std::string> mStrings;	// the first is the empty string
+      std::unordered_map<std::string, uint32_t> mStringIndices;
+      std::vector<uint32_t> mRecords;
+};
+
+/**
+   \brief Creates the widget trees stored by \ref UiWriter
+
+   A file is read in one pass over its records, constructing every widget
+   right after its parent, within a \ref WidgetArena if one is given. Files
+   written with layout results come back laid out and with their preferred
+   sizes cached, so nothing is measured until a widget changes. Malformed
+   files and unknown classes throw a \c std::runtime_error and leave
+   \c parent as it was.
+
+   \code
+   UiReader reader ({ theme });
+   Widget * window = reader.load ("operator.ui", screen, &arena, [&] (const std::string & id, Widget * widget)
+   {
+      if (id == "go")
+         ((Button *) widget)->setCallback (go);
+   });
+   \endcode
+*/
+class  UiReader
+{
+   public:
+      /// Called for every widget with an id, once the widget and its state are in place
+      typedef std::function<void (const std::string & id, Widget * widget)> Binder;
+
+      explicit UiReader (const std::vector<Theme *> & themes = {});
+
+      /// Create the tree in \c data below \c parent and return its root
+      Widget * read (const void * data, size_t size, Widget * parent, WidgetArena * arena = nullptr,
+                     const Binder & bind = nullptr);
+      /// Create the tree in the file \c path, which is memory mapped while it is read
+      Widget * load (const std::string & path, Widget * parent, WidgetArena * arena = nullptr,
+                     const Binder & bind = nullptr);
+
+      /* For UiType::create */
+      int getInt()
+      {
+         return (int)word();
+      }
+      float getFloat();
+      const std::string & getString();
+      Color getColor();
+
+   protected:
+      uint32_t word();
+      Widget * readTree (Widget * parent, const Binder & bind);
+      Widget * readWidget (Widget * parent, const Binder & bind, int & children);
+      ref<Layout> readLayout();
+
+      std::vector<Theme *> mThemes;
+      const unsigned char * mPos = nullptr, * mEnd = nullptr;
+      bool mLayoutResults = false;
+      std::vector<std::string> mStrings;
+      std::vector<const UiType *> mTypes;
+      /* Preferred sizes of a tree read with layout results, applied once all of it is in place */
+      std::vector<std::pair<Widget *, Vector2i>> mLaidOut;
+};
+
+NAMESPACE_END (nanogui)
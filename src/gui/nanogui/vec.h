@@ -0,0 +1,140 @@
+/*
+    nanogui/vec.h -- Small constexpr geometry and color types for hot paths
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#if !defined(NAMESPACE_BEGIN)
+   #define NAMESPACE_BEGIN(name) namespace name {
+#endif
+#if !defined(NAMESPACE_END)
+   #define NAMESPACE_END(name) }
+#endif
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Plain two component vector
+
+   Unlike the Eigen vectors used by the widget API, the operators below are
+   ordinary inline functions on two scalars, so hit tests and position math
+   stay cheap in debug builds where Eigen's expression templates are not
+   inlined. The header does not include Eigen. Any vector type with \c x() and
+   \c y() accessors, Eigen's included, converts explicitly; \ref as() converts
+   back to one that is constructible from two scalars.
+*/
+template <typename T> struct Vec2
+{
+   T x, y;
+
+   constexpr Vec2() : x (0), y (0) { }
+   constexpr Vec2 (T x, T y) : x (x), y (y) { }
+
+   template <typename V, typename = decltype (std::declval<const V &>().x())>
+   explicit Vec2 (const V & v) : x (T (v.x())), y (T (v.y())) { }
+
+   template <typename V> V as() const
+   {
+      return V (x, y);
+   }
+
+   template <typename U> constexpr Vec2<U> cast() const
+   {
+      return Vec2<U> (U (x), U (y));
+   }
+
+   constexpr Vec2 operator+ (Vec2 o) const
+   {
+      return Vec2 (x + o.x, y + o.y);
+   }
+   constexpr Vec2 operator- (Vec2 o) const
+   {
+      return Vec2 (x - o.x, y - o.y);
+   }
+   constexpr Vec2 operator- () const
+   {
+      return Vec2 (-x, -y);
+   }
+   constexpr Vec2 operator* (T s) const
+   {
+      return Vec2 (x * s, y * s);
+   }
+   Vec2 & operator+= (Vec2 o)
+   {
+      x += o.x;
+      y += o.y;
+      return *this;
+   }
+   Vec2 & operator-= (Vec2 o)
+   {
+      x -= o.x;
+      y -= o.y;
+      return *this;
+   }
+   constexpr bool operator== (Vec2 o) const
+   {
+      return x == o.x && y == o.y;
+   }
+   constexpr bool operator!= (Vec2 o) const
+   {
+      return !(*this == o);
+   }
+
+   /// Whether this point lies in the half open rectangle at \c pos of extent \c size
+   constexpr bool inside (Vec2 pos, Vec2 size) const
+   {
+      return x >= pos.x && y >= pos.y && x < pos.x + size.x && y < pos.y + size.y;
+   }
+};
+
+typedef Vec2<int> Vec2i;
+typedef Vec2<float> Vec2f;
+
+/**
+   \brief Plain RGBA color with float channels in [0, 1]
+
+   Laid out like NVGcolor and \ref Color, so either converts without copying
+   through a reinterpret_cast at the API boundary.
+*/
+struct RGBA
+{
+   float r, g, b, a;
+
+   constexpr RGBA() : r (0), g (0), b (0), a (0) { }
+   constexpr RGBA (float r, float g, float b, float a = 1.f) : r (r), g (g), b (b), a (a) { }
+
+   /// Color from 8 bit channels
+   static constexpr RGBA bytes (int r, int g, int b, int a = 255)
+   {
+      return RGBA (r / 255.f, g / 255.f, b / 255.f, a / 255.f);
+   }
+
+   constexpr RGBA withAlpha (float alpha) const
+   {
+      return RGBA (r, g, b, alpha);
+   }
+   constexpr bool operator== (const RGBA & o) const
+   {
+      return r == o.r && g == o.g && b == o.b && a == o.a;
+   }
+   constexpr bool operator!= (const RGBA & o) const
+   {
+      return !(*this == o);
+   }
+};
+
+static_assert (std::is_trivially_copyable<Vec2i>::value && std::is_trivially_copyable<Vec2f>::value &&
+               std::is_trivially_copyable<RGBA>::value, "hot path types must stay trivially copyable");
+static_assert (sizeof (Vec2i) == 2 * sizeof (int) && sizeof (RGBA) == 4 * sizeof (float), "unexpected padding");
+
+NAMESPACE_END (nanogui)
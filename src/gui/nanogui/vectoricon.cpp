@@ -0,0 +1,918 @@
+/*
+    src/vectoricon.cpp -- Icon parsed from SVG once and drawn through
+    retained geometry at any scale
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "vectoricon.h"
+#include "../util/MappedFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+NAMESPACE_BEGIN (nanogui)
+
+namespace
+{
+/* Shape commands, each followed by its points */
+enum Command
+{
+   CommandMove,		// x y, starts a solid contour
+   CommandMoveHole,	// x y, starts a contour inside an odd number of others
+   CommandLine,		// x y
+   CommandBezier,		// c1x c1y c2x c2y x y
+   CommandClose
+};
+
+const float Pi = 3.14159265358979f;
+const float Kappa = 0.5522847493f;	// control point offset of a quarter circle bezier
+
+/* Presentation attributes, inherited from the enclosing groups */
+struct Style
+{
+   VectorIcon::Paint fill = VectorIcon::PaintColor, stroke = VectorIcon::PaintNone;
+   Color fillColor = Color (0.0f, 1.0f), strokeColor = Color (0.0f, 1.0f);
+   float strokeWidth = 1, miterLimit = 4;
+   float opacity = 1, fillOpacity = 1, strokeOpacity = 1;
+   int lineCap = NVG_BUTT, lineJoin = NVG_MITER;
+   bool visible = true;
+   float xform[6] = { 1, 0, 0, 1, 0, 0 };
+};
+
+bool isSpace (char c)
+{
+   return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void skipSeparators (const char *& s)
+{
+   while (isSpace (*s) || *s == ',')
+      ++s;
+}
+
+/* Reads the next number of a list, false at the end of the list or before a letter */
+bool number (const char *& s, float & value)
+{
+   skipSeparators (s);
+   char * end;
+   value = strtof (s, &end);
+   if (end == s)
+      return false;
+   s = end;
+   return true;
+}
+
+/* Arc flags may be written without separators, as in "a1 1 0 00 1 1" */
+bool flag (const char *& s, bool & value)
+{
+   skipSeparators (s);
+   if (*s != '0' && *s != '1')
+      return false;
+   value = *s++ == '1';
+   return true;
+}
+
+float hexDigit (char c)
+{
+   if (c >= '0' && c <= '9')
+      return (float) (c - '0');
+   if (c >= 'a' && c <= 'f')
+      return (float) (c - 'a' + 10);
+   if (c >= 'A' && c <= 'F')
+      return (float) (c - 'A' + 10);
+   return 0;
+}
+
+/* Parses a paint, colors keep an alpha of one */
+VectorIcon::Paint paint (const std::string & value, Color & color)
+{
+   static const struct
+   {
+      const char * name;
+      int rgb;
+   } names[] =
+   {
+      { "black", 0x000000 }, { "white", 0xffffff }, { "red", 0xff0000 }, { "lime", 0x00ff00 },
+      { "green", 0x008000 }, { "blue", 0x0000ff }, { "yellow", 0xffff00 }, { "orange", 0xffa500 },
+      { "gray", 0x808080 }, { "grey", 0x808080 }, { "silver", 0xc0c0c0 }, { "purple", 0x800080 }
+   };
+   if (value == "none" || value == "transparent")
+      return VectorIcon::PaintNone;
+   if (value[0] == '#')
+   {
+      const char * s = value.c_str() + 1;
+      size_t length = value.size() - 1;
+      if (length == 3)
+         color = Color (hexDigit (s[0]) / 15.0f, hexDigit (s[1]) / 15.0f, hexDigit (s[2]) / 15.0f, 1.0f);
+      else
+         if (length >= 6)
+            color = Color ((hexDigit (s[0]) * 16 + hexDigit (s[1])) / 255.0f, (hexDigit (s[2]) * 16 + hexDigit (s[3])) / 255.0f,
+                           (hexDigit (s[4]) * 16 + hexDigit (s[5])) / 255.0f, 1.0f);
+      return VectorIcon::PaintColor;
+   }
+   if (value.compare (0, 4, "rgb(") == 0)
+   {
+      const char * s = value.c_str() + 4;
+      float channels[3] = { 0, 0, 0 };
+      for (auto & channel : channels)
+      {
+         if (!number (s, channel))
+            break;
+         if (*s == '%')
+         {
+            channel *= 2.55f;
+            ++s;
+         }
+      }
+      color = Color (channels[0] / 255.0f, channels[1] / 255.0f, channels[2] / 255.0f, 1.0f);
+      return VectorIcon::PaintColor;
+   }
+   for (auto & entry : names)
+      if (value == entry.name)
+      {
+         color = Color (((entry.rgb >> 16) & 0xff) / 255.0f, ((entry.rgb >> 8) & 0xff) / 255.0f, (entry.rgb & 0xff) / 255.0f, 1.0f);
+         return VectorIcon::PaintColor;
+      }
+   /* currentColor, and gradients through url(), which are not supported */
+   return VectorIcon::PaintCurrent;
+}
+
+/* Parses a transform list into the transform applied first, as nvgTransformMultiply() composes them */
+void transform (const std::string & value, float * xform)
+{
+   nvgTransformIdentity (xform);
+   const char * s = value.c_str();
+   while (*s)
+   {
+      skipSeparators (s);
+      const char * name = s;
+      while (*s && *s != '(')
+         ++s;
+      if (!*s)
+         break;
+      std::string op (name, s - name);
+      op.erase (std::remove_if (op.begin(), op.end(), isSpace), op.end());
+      ++s;
+      float args[6] = { 0, 0, 0, 0, 0, 0 };
+      int count = 0;
+      while (count < 6 && number (s, args[count]))
+         ++count;
+      while (*s && *s != ')')
+         ++s;
+      if (*s)
+         ++s;
+      float t[6], r[6];
+      nvgTransformIdentity (t);
+      if (op == "matrix" && count == 6)
+         std::copy (args, args + 6, t);
+      else
+         if (op == "translate")
+            nvgTransformTranslate (t, args[0], count > 1 ? args[1] : 0);
+         else
+            if (op == "scale")
+               nvgTransformScale (t, args[0], count > 1 ? args[1] : args[0]);
+            else
+               if (op == "rotate")
+               {
+                  nvgTransformRotate (t, nvgDegToRad (args[0]));
+                  if (count == 3)
+                  {
+                     /* About (cx, cy): move it to the origin, rotate and move it back */
+                     nvgTransformTranslate (r, -args[1], -args[2]);
+                     nvgTransformMultiply (r, t);
+                     nvgTransformTranslate (t, args[1], args[2]);
+                     nvgTransformPremultiply (t, r);
+                  }
+               }
+               else
+                  if (op == "skewX")
+                     nvgTransformSkewX (t, nvgDegToRad (args[0]));
+                  else
+                     if (op == "skewY")
+                        nvgTransformSkewY (t, nvgDegToRad (args[0]));
+      /* The rightmost transform of the list applies first */
+      nvgTransformPremultiply (xform, t);
+   }
+}
+
+void applyProperty (Style & style, const std::string & name, const std::string & value)
+{
+   if (name == "fill")
+      style.fill = paint (value, style.fillColor);
+   else
+      if (name == "stroke")
+         style.stroke = paint (value, style.strokeColor);
+      else
+         if (name == "stroke-width")
+            style.strokeWidth = std::max (0.0f, (float) atof (value.c_str()));
+         else
+            if (name == "opacity")
+               style.opacity *= (float) atof (value.c_str());
+            else
+               if (name == "fill-opacity")
+                  style.fillOpacity = (float) atof (value.c_str());
+               else
+                  if (name == "stroke-opacity")
+                     style.strokeOpacity = (float) atof (value.c_str());
+                  else
+                     if (name == "stroke-miterlimit")
+                        style.miterLimit = (float) atof (value.c_str());
+                     else
+                        if (name == "stroke-linecap")
+                           style.lineCap = value == "round" ? NVG_ROUND : value == "square" ? NVG_SQUARE : NVG_BUTT;
+                        else
+                           if (name == "stroke-linejoin")
+                              style.lineJoin = value == "round" ? NVG_ROUND : value == "bevel" ? NVG_BEVEL : NVG_MITER;
+                           else
+                              if ((name == "display" && value == "none") || (name == "visibility" && value == "hidden"))
+                                 style.visible = false;
+}
+
+std::string trim (const std::string & s)
+{
+   size_t begin = 0, end = s.size();
+   while (begin < end && isSpace (s[begin]))
+      ++begin;
+   while (end > begin && isSpace (s[end - 1]))
+      --end;
+   return s.substr (begin, end - begin);
+}
+
+/* Applies the attributes of an element to the style inherited from its parent, the style attribute last */
+void applyAttributes (Style & style, const std::vector<std::pair<std::string, std::string>> & attributes)
+{
+   for (auto & attribute : attributes)
+      if (attribute.first == "transform")
+      {
+         float t[6];
+         transform (attribute.second, t);
+         nvgTransformMultiply (t, style.xform);
+         std::copy (t, t + 6, style.xform);
+      }
+      else
+         applyProperty (style, attribute.first, trim (attribute.second));
+   for (auto & attribute : attributes)
+      if (attribute.first == "style")
+      {
+         const std::string & s = attribute.second;
+         size_t begin = 0;
+         while (begin < s.size())
+         {
+            size_t end = s.find (';', begin);
+            if (end == std::string::npos)
+               end = s.size();
+            size_t colon = s.find (':', begin);
+            if (colon < end)
+               applyProperty (style, trim (s.substr (begin, colon - begin)), trim (s.substr (colon + 1, end - colon - 1)));
+            begin = end + 1;
+         }
+      }
+}
+
+/* Builds the commands of one shape in document coordinates */
+class PathBuilder
+{
+   public:
+      PathBuilder (const float * xform, std::vector<float> & commands) : mXform (xform), mCommands (commands) {}
+
+      void moveTo (float x, float y)
+      {
+         mContours.push_back (mCommands.size());
+         emit (CommandMove, x, y);
+         mStartX = mX = x;
+         mStartY = mY = y;
+      }
+      void lineTo (float x, float y)
+      {
+         if (mContours.empty())
+            moveTo (mX, mY);
+         emit (CommandLine, x, y);
+         mX = x;
+         mY = y;
+      }
+      void bezierTo (float c1x, float c1y, float c2x, float c2y, float x, float y)
+      {
+         if (mContours.empty())
+            moveTo (mX, mY);
+         emit (CommandBezier, c1x, c1y);
+         point (c2x, c2y);
+         point (x, y);
+         mX = x;
+         mY = y;
+      }
+      void close()
+      {
+         if (mContours.empty())
+            return;
+         mCommands.push_back ((float) CommandClose);
+         mX = mStartX;
+         mY = mStartY;
+      }
+
+      /* Elliptical arc from the current point, split into beziers of at most a quarter turn */
+      void arcTo (float rx, float ry, float rotation, bool largeArc, bool sweep, float x, float y)
+      {
+         float x1 = mX, y1 = mY;
+         rx = std::fabs (rx);
+         ry = std::fabs (ry);
+         float dx = x1 - x, dy = y1 - y;
+         if (dx * dx + dy * dy < 1e-12f || rx < 1e-6f || ry < 1e-6f)
+         {
+            lineTo (x, y);
+            return;
+         }
+         float sinr = std::sin (nvgDegToRad (rotation)), cosr = std::cos (nvgDegToRad (rotation));
+         /* Center parameterization, see the implementation notes of the SVG specification */
+         float x1p = cosr * dx * 0.5f + sinr * dy * 0.5f;
+         float y1p = -sinr * dx * 0.5f + cosr * dy * 0.5f;
+         float d = (x1p * x1p) / (rx * rx) + (y1p * y1p) / (ry * ry);
+         if (d > 1)
+         {
+            d = std::sqrt (d);
+            rx *= d;
+            ry *= d;
+         }
+         float sa = std::max (0.0f, rx * rx * ry * ry - rx * rx * y1p * y1p - ry * ry * x1p * x1p);
+         float sb = rx * rx * y1p * y1p + ry * ry * x1p * x1p;
+         float s = sb > 0 ? std::sqrt (sa / sb) : 0;
+         if (largeArc == sweep)
+            s = -s;
+         float cxp = s * rx * y1p / ry, cyp = -s * ry * x1p / rx;
+         float cx = (x1 + x) * 0.5f + cosr * cxp - sinr * cyp;
+         float cy = (y1 + y) * 0.5f + sinr * cxp + cosr * cyp;
+         float ux = (x1p - cxp) / rx, uy = (y1p - cyp) / ry;
+         float vx = (-x1p - cxp) / rx, vy = (-y1p - cyp) / ry;
+         float a = std::atan2 (uy, ux);
+         float da = std::atan2 (ux * vy - uy * vx, ux * vx + uy * vy);
+         if (!sweep && da > 0)
+            da -= 2 * Pi;
+         else
+            if (sweep && da < 0)
+               da += 2 * Pi;
+         int segments = std::max (1, (int) std::ceil (std::fabs (da) / (Pi * 0.5f) - 1e-3f));
+         float step = da / segments, k = 4.0f / 3.0f * std::tan (step * 0.25f);
+         for (int i = 0; i < segments; ++i)
+         {
+            float a0 = a + step * i, a1 = a0 + step;
+            float c0 = std::cos (a0), s0 = std::sin (a0), c1 = std::cos (a1), s1 = std::sin (a1);
+            float p0x = cx + cosr * rx * c0 - sinr * ry * s0, p0y = cy + sinr * rx * c0 + cosr * ry * s0;
+            float p1x = cx + cosr * rx * c1 - sinr * ry * s1, p1y = cy + sinr * rx * c1 + cosr * ry * s1;
+            float t0x = -cosr * rx * s0 - sinr * ry * c0, t0y = -sinr * rx * s0 + cosr * ry * c0;
+            float t1x = -cosr * rx * s1 - sinr * ry * c1, t1y = -sinr * rx * s1 + cosr * ry * c1;
+            if (i == segments - 1)
+            {
+               p1x = x;
+               p1y = y;
+            }
+            bezierTo (p0x + k * t0x, p0y + k * t0y, p1x - k * t1x, p1y - k * t1y, p1x, p1y);
+         }
+      }
+
+      void ellipse (float cx, float cy, float rx, float ry)
+      {
+         moveTo (cx + rx, cy);
+         bezierTo (cx + rx, cy + ry * Kappa, cx + rx * Kappa, cy + ry, cx, cy + ry);
+         bezierTo (cx - rx * Kappa, cy + ry, cx - rx, cy + ry * Kappa, cx - rx, cy);
+         bezierTo (cx - rx, cy - ry * Kappa, cx - rx * Kappa, cy - ry, cx, cy - ry);
+         bezierTo (cx + rx * Kappa, cy - ry, cx + rx, cy - ry * Kappa, cx + rx, cy);
+         close();
+      }
+
+      float x() const
+      {
+         return mX;
+      }
+      float y() const
+      {
+         return mY;
+      }
+
+      /* Marks the contours inside an odd number of others as holes, NanoVG enforces the winding of every contour */
+      void markHoles()
+      {
+         if (mContours.size() < 2)
+            return;
+         /* The end points of the segments approximate every contour by a polygon */
+         std::vector<std::vector<float>> polygons (mContours.size());
+         for (size_t c = 0; c < mContours.size(); ++c)
+         {
+            size_t i = mContours[c], end = c + 1 < mContours.size() ? mContours[c + 1] : mCommands.size();
+            while (i < end)
+            {
+               int command = (int) mCommands[i];
+               size_t points = command == CommandBezier ? 3 : command == CommandClose ? 0 : 1;
+               if (points)
+               {
+                  polygons[c].push_back (mCommands[i + points * 2 - 1]);
+                  polygons[c].push_back (mCommands[i + points * 2]);
+               }
+               i += 1 + points * 2;
+            }
+         }
+         for (size_t c = 0; c < mContours.size(); ++c)
+         {
+            float px = mCommands[mContours[c] + 1], py = mCommands[mContours[c] + 2];
+            bool inside = false;
+            for (size_t o = 0; o < polygons.size(); ++o)
+               if (o != c && contains (polygons[o], px, py))
+                  inside = !inside;
+            if (inside)
+               mCommands[mContours[c]] = (float) CommandMoveHole;
+         }
+      }
+
+   private:
+      void emit (Command command, float x, float y)
+      {
+         mCommands.push_back ((float) command);
+         point (x, y);
+      }
+      void point (float x, float y)
+      {
+         float tx, ty;
+         nvgTransformPoint (&tx, &ty, mXform, x, y);
+         mCommands.push_back (tx);
+         mCommands.push_back (ty);
+      }
+
+      static bool contains (const std::vector<float> & polygon, float x, float y)
+      {
+         bool inside = false;
+         size_t n = polygon.size() / 2;
+         for (size_t i = 0, j = n - 1; i < n; j = i++)
+         {
+            float xi = polygon[i * 2], yi = polygon[i * 2 + 1], xj = polygon[j * 2], yj = polygon[j * 2 + 1];
+            if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi)
+               inside = !inside;
+         }
+         return inside;
+      }
+
+      const float * mXform;
+      std::vector<float> & mCommands;
+      std::vector<size_t> mContours;	// offsets of the move commands
+      float mX = 0, mY = 0, mStartX = 0, mStartY = 0;
+};
+
+/* Path data, with the shorthand forms of the curves and relative coordinates resolved */
+void pathData (PathBuilder & path, const char * s)
+{
+   char command = 0;
+   float lastControlX = 0, lastControlY = 0;
+   char lastCommand = 0;
+   while (true)
+   {
+      skipSeparators (s);
+      if (!*s)
+         break;
+      if ((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z'))
+         command = *s++;
+      else
+         if (!command)
+            break;
+      bool relative = command >= 'a';
+      float ox = relative ? path.x() : 0, oy = relative ? path.y() : 0;
+      float v[6];
+      bool ok = true;
+      switch (command | 0x20)
+      {
+         case 'm':
+            ok = number (s, v[0]) && number (s, v[1]);
+            if (ok)
+               path.moveTo (ox + v[0], oy + v[1]);
+            /* Further pairs are implicit line commands */
+            command = relative ? 'l' : 'L';
+            break;
+         case 'l':
+            ok = number (s, v[0]) && number (s, v[1]);
+            if (ok)
+               path.lineTo (ox + v[0], oy + v[1]);
+            break;
+         case 'h':
+            ok = number (s, v[0]);
+            if (ok)
+               path.lineTo (ox + v[0], path.y());
+            break;
+         case 'v':
+            ok = number (s, v[0]);
+            if (ok)
+               path.lineTo (path.x(), oy + v[0]);
+            break;
+         case 'c':
+            ok = number (s, v[0]) && number (s, v[1]) && number (s, v[2]) && number (s, v[3]) && number (s, v[4]) && number (s, v[5]);
+            if (ok)
+            {
+               path.bezierTo (ox + v[0], oy + v[1], ox + v[2], oy + v[3], ox + v[4], oy + v[5]);
+               lastControlX = ox + v[2];
+               lastControlY = oy + v[3];
+            }
+            break;
+         case 's':
+            ok = number (s, v[2]) && number (s, v[3]) && number (s, v[4]) && number (s, v[5]);
+            if (ok)
+            {
+               /* The first control point mirrors the last one of a preceding cubic */
+               bool smooth = (lastCommand | 0x20) == 'c' || (lastCommand | 0x20) == 's';
+               float c1x = smooth ? 2 * path.x() - lastControlX : path.x();
+               float c1y = smooth ? 2 * path.y() - lastControlY : path.y();
+               path.bezierTo (c1x, c1y, ox + v[2], oy + v[3], ox + v[4], oy + v[5]);
+               lastControlX = ox + v[2];
+               lastControlY = oy + v[3];
+            }
+            break;
+         case 'q':
+         case 't':
+            if ((command | 0x20) == 'q')
+               ok = number (s, v[0]) && number (s, v[1]) && number (s, v[2]) && number (s, v[3]);
+            else
+            {
+               ok = number (s, v[2]) && number (s, v[3]);
+               bool smooth = (lastCommand | 0x20) == 'q' || (lastCommand | 0x20) == 't';
+               v[0] = (smooth ? 2 * path.x() - lastControlX : path.x()) - ox;
+               v[1] = (smooth ? 2 * path.y() - lastControlY : path.y()) - oy;
+            }
+            if (ok)
+            {
+               /* Raised to a cubic */
+               float qx = ox + v[0], qy = oy + v[1], x = ox + v[2], y = oy + v[3];
+               path.bezierTo (path.x() + 2.0f / 3.0f * (qx - path.x()), path.y() + 2.0f / 3.0f * (qy - path.y()),
+                              x + 2.0f / 3.0f * (qx - x), y + 2.0f / 3.0f * (qy - y), x, y);
+               lastControlX = qx;
+               lastControlY = qy;
+            }
+            break;
+         case 'a':
+         {
+            bool largeArc, sweep;
+            ok = number (s, v[0]) && number (s, v[1]) && number (s, v[2]) && flag (s, largeArc) && flag (s, sweep) &&
+                 number (s, v[3]) && number (s, v[4]);
+            if (ok)
+               path.arcTo (v[0], v[1], v[2], largeArc, sweep, ox + v[3], oy + v[4]);
+            break;
+         }
+         case 'z':
+            path.close();
+            /* Nothing may follow but another command */
+            command = 0;
+            break;
+         default:
+            ok = false;
+      }
+      if (!ok)
+         break;
+      lastCommand = command ? command : 'z';
+   }
+}
+
+/* Numbers of a points attribute */
+std::vector<float> numbers (const std::string & value)
+{
+   std::vector<float> result;
+   const char * s = value.c_str();
+   float v;
+   while (number (s, v))
+      result.push_back (v);
+   return result;
+}
+
+float attribute (const std::vector<std::pair<std::string, std::string>> & attributes, const char * name, float fallback = 0)
+{
+   for (auto & attribute : attributes)
+      if (attribute.first == name)
+         return (float) atof (attribute.second.c_str());
+   return fallback;
+}
+
+bool hasAttribute (const std::vector<std::pair<std::string, std::string>> & attributes, const char * name)
+{
+   for (auto & attribute : attributes)
+      if (attribute.first == name)
+         return true;
+   return false;
+}
+
+/* Elements whose content is never drawn directly */
+bool skipped (const std::string & name)
+{
+   static const char * names[] =
+   {
+      "defs", "clipPath", "mask", "symbol", "pattern", "marker", "linearGradient", "radialGradient",
+      "style", "title", "desc", "metadata", "text"
+   };
+   for (auto n : names)
+      if (name == n)
+         return true;
+   return false;
+}
+}
+
+ref<VectorIcon> VectorIcon::load (const std::string & path)
+{
+   MappedFile file (path);
+   if (!file.data())
+      throw std::runtime_error ("VectorIcon: cannot open " + path);
+   return new VectorIcon (std::string ((const char *) file.data(), file.size()));
+}
+
+VectorIcon::~VectorIcon()
+{
+   clear();
+}
+
+void VectorIcon::clear()
+{
+   for (auto & shape : mShapes)
+      nvgDeleteGeometry (shape.geometry);
+   mShapes.clear();
+}
+
+void VectorIcon::parse (const std::string & svg)
+{
+   clear();
+   mViewBox = Vector4f::Zero();
+   std::vector<Style> styles (1);
+   std::vector<std::pair<std::string, std::string>> attributes;
+   int skipDepth = 0;
+   bool root = true;
+   const char * s = svg.c_str(), * end = s + svg.size();
+   while ((s = (const char *) memchr (s, '<', end - s)) != nullptr)
+   {
+      if (strncmp (s, "<!--", 4) == 0)
+      {
+         const char * close = strstr (s + 4, "-->");
+         s = close ? close + 3 : end;
+         continue;
+      }
+      if (s[1] == '?' || s[1] == '!')
+      {
+         const char * close = (const char *) memchr (s, '>', end - s);
+         s = close ? close + 1 : end;
+         continue;
+      }
+      bool closing = s[1] == '/';
+      s += closing ? 2 : 1;
+      const char * name = s;
+      while (s < end && !isSpace (*s) && *s != '>' && *s != '/')
+         ++s;
+      std::string element (name, s - name);
+      /* Attributes up to the end of the tag */
+      attributes.clear();
+      bool selfClosing = false;
+      while (s < end && *s != '>')
+      {
+         if (*s == '/')
+         {
+            selfClosing = true;
+            ++s;
+            continue;
+         }
+         if (isSpace (*s))
+         {
+            ++s;
+            continue;
+         }
+         const char * key = s;
+         while (s < end && !isSpace (*s) && *s != '=' && *s != '>' && *s != '/')
+            ++s;
+         std::string attributeName (key, s - key);
+         while (s < end && isSpace (*s))
+            ++s;
+         if (s == end || *s != '=')
+            continue;
+         ++s;
+         while (s < end && isSpace (*s))
+            ++s;
+         if (s == end || (*s != '"' && *s != '\''))
+            continue;
+         char quote = *s++;
+         const char * value = s;
+         while (s < end && *s != quote)
+            ++s;
+         attributes.emplace_back (attributeName, std::string (value, s - value));
+         if (s < end)
+            ++s;
+      }
+      if (s < end)
+         ++s;
+      if (closing)
+      {
+         if (skipDepth > 0)
+            --skipDepth;
+         else
+            if ((element == "g" || element == "svg") && styles.size() > 1)
+               styles.pop_back();
+         continue;
+      }
+      if (skipDepth > 0 || skipped (element))
+      {
+         if (!selfClosing)
+            ++skipDepth;
+         continue;
+      }
+      Style style = styles.back();
+      applyAttributes (style, attributes);
+      if (element == "svg" || element == "g")
+      {
+         if (element == "svg" && root)
+         {
+            root = false;
+            for (auto & attribute : attributes)
+               if (attribute.first == "viewBox")
+               {
+                  std::vector<float> box = numbers (attribute.second);
+                  if (box.size() == 4)
+                     mViewBox = Vector4f (box[0], box[1], box[2], box[3]);
+               }
+            if (mViewBox.z() <= 0 || mViewBox.w() <= 0)
+               mViewBox = Vector4f (0, 0, attribute (attributes, "width"), attribute (attributes, "height"));
+         }
+         if (!selfClosing)
+            styles.push_back (style);
+         continue;
+      }
+      if (!style.visible || (style.fill == PaintNone && (style.stroke == PaintNone || style.strokeWidth <= 0)))
+         continue;
+      Shape shape;
+      PathBuilder path (style.xform, shape.commands);
+      if (element == "path")
+      {
+         for (auto & attribute : attributes)
+            if (attribute.first == "d")
+               pathData (path, attribute.second.c_str());
+      }
+      else
+         if (element == "rect")
+         {
+            float x = attribute (attributes, "x"), y = attribute (attributes, "y");
+            float w = attribute (attributes, "width"), h = attribute (attributes, "height");
+            float rx = attribute (attributes, "rx", -1), ry = attribute (attributes, "ry", -1);
+            if (rx < 0)
+               rx = ry;
+            if (ry < 0)
+               ry = rx;
+            rx = std::max (0.0f, std::min (rx, w * 0.5f));
+            ry = std::max (0.0f, std::min (ry, h * 0.5f));
+            if (w <= 0 || h <= 0)
+               continue;
+            if (rx <= 0 || ry <= 0)
+            {
+               path.moveTo (x, y);
+               path.lineTo (x + w, y);
+               path.lineTo (x + w, y + h);
+               path.lineTo (x, y + h);
+            }
+            else
+            {
+               float kx = rx * (1 - Kappa), ky = ry * (1 - Kappa);
+               path.moveTo (x + rx, y);
+               path.lineTo (x + w - rx, y);
+               path.bezierTo (x + w - kx, y, x + w, y + ky, x + w, y + ry);
+               path.lineTo (x + w, y + h - ry);
+               path.bezierTo (x + w, y + h - ky, x + w - kx, y + h, x + w - rx, y + h);
+               path.lineTo (x + rx, y + h);
+               path.bezierTo (x + kx, y + h, x, y + h - ky, x, y + h - ry);
+               path.lineTo (x, y + ry);
+               path.bezierTo (x, y + ky, x + kx, y, x + rx, y);
+            }
+            path.close();
+         }
+         else
+            if (element == "circle" || element == "ellipse")
+            {
+               float rx = attribute (attributes, element == "circle" ? "r" : "rx");
+               float ry = element == "circle" ? rx : attribute (attributes, "ry");
+               if (rx <= 0 || ry <= 0)
+                  continue;
+               path.ellipse (attribute (attributes, "cx"), attribute (attributes, "cy"), rx, ry);
+            }
+            else
+               if (element == "line")
+               {
+                  path.moveTo (attribute (attributes, "x1"), attribute (attributes, "y1"));
+                  path.lineTo (attribute (attributes, "x2"), attribute (attributes, "y2"));
+                  style.fill = PaintNone;
+               }
+               else
+                  if ((element == "polyline" || element == "polygon") && hasAttribute (attributes, "points"))
+                  {
+                     std::vector<float> points;
+                     for (auto & attribute : attributes)
+                        if (attribute.first == "points")
+                           points = numbers (attribute.second);
+                     for (size_t i = 0; i + 1 < points.size(); i += 2)
+                        if (i == 0)
+                           path.moveTo (points[0], points[1]);
+                        else
+                           path.lineTo (points[i], points[i + 1]);
+                     if (element == "polygon")
+                        path.close();
+                  }
+                  else
+                     continue;
+      if (shape.commands.empty())
+         continue;
+      path.markHoles();
+      shape.fill = style.fill;
+      shape.stroke = style.stroke;
+      shape.fillColor = style.fillColor;
+      shape.fillColor.w() *= style.fillOpacity * style.opacity;
+      shape.strokeColor = style.strokeColor;
+      shape.strokeColor.w() *= style.strokeOpacity * style.opacity;
+      /* The commands are in document coordinates, so is the width */
+      shape.strokeWidth = style.strokeWidth * std::sqrt (std::fabs (style.xform[0] * style.xform[3] - style.xform[1] * style.xform[2]));
+      shape.miterLimit = style.miterLimit;
+      shape.lineCap = style.lineCap;
+      shape.lineJoin = style.lineJoin;
+      if (shape.stroke != PaintNone && shape.strokeWidth <= 0)
+         shape.stroke = PaintNone;
+      if (shape.fill != PaintNone || shape.stroke != PaintNone)
+         mShapes.push_back (std::move (shape));
+   }
+   /* Documents without a size are drawn at the size of their shapes */
+   if (mViewBox.z() <= 0 || mViewBox.w() <= 0)
+   {
+      Vector2f lo = Vector2f::Constant (std::numeric_limits<float>::max()), hi = -lo;
+      for (auto & shape : mShapes)
+         for (size_t i = 0; i < shape.commands.size();)
+         {
+            int command = (int) shape.commands[i++];
+            int points = command == CommandBezier ? 3 : command == CommandClose ? 0 : 1;
+            for (int p = 0; p < points; ++p, i += 2)
+            {
+               lo = lo.cwiseMin (Vector2f (shape.commands[i], shape.commands[i + 1]));
+               hi = hi.cwiseMax (Vector2f (shape.commands[i], shape.commands[i + 1]));
+            }
+         }
+      if (!mShapes.empty())
+         mViewBox = Vector4f (lo.x(), lo.y(), hi.x() - lo.x(), hi.y() - lo.y());
+   }
+}
+
+void VectorIcon::draw (NVGcontext * ctx, float x, float y, float size, const Color & color)
+{
+   if (mShapes.empty() || mViewBox.z() <= 0 || mViewBox.w() <= 0)
+      return;
+   float scale = size / std::max (mViewBox.z(), mViewBox.w());
+   nvgSave (ctx);
+   nvgTranslate (ctx, x + (size - mViewBox.z() * scale) * 0.5f, y + (size - mViewBox.w() * scale) * 0.5f);
+   nvgScale (ctx, scale, scale);
+   nvgTranslate (ctx, -mViewBox.x(), -mViewBox.y());
+   for (auto & shape : mShapes)
+   {
+      if (!shape.geometry)
+      {
+         nvgBeginPath (ctx);
+         const std::vector<float> & c = shape.commands;
+         for (size_t i = 0; i < c.size();)
+            switch ((int) c[i])
+            {
+               case CommandMove:
+               case CommandMoveHole:
+                  nvgMoveTo (ctx, c[i + 1], c[i + 2]);
+                  nvgPathWinding (ctx, (int) c[i] == CommandMoveHole ? NVG_HOLE : NVG_SOLID);
+                  i += 3;
+                  break;
+               case CommandLine:
+                  nvgLineTo (ctx, c[i + 1], c[i + 2]);
+                  i += 3;
+                  break;
+               case CommandBezier:
+                  nvgBezierTo (ctx, c[i + 1], c[i + 2], c[i + 3], c[i + 4], c[i + 5], c[i + 6]);
+                  i += 7;
+                  break;
+               default:
+                  nvgClosePath (ctx);
+                  i += 1;
+            }
+         shape.geometry = nvgCreateGeometry (ctx);
+         if (!shape.geometry)
+            continue;
+      }
+      if (shape.fill != PaintNone)
+      {
+         nvgFillColor (ctx, shape.fill == PaintCurrent ? Color (color.head<3>(), color.w() * shape.fillColor.w()) : shape.fillColor);
+         nvgFillGeometry (ctx, shape.geometry);
+      }
+      if (shape.stroke != PaintNone)
+      {
+         nvgStrokeColor (ctx, shape.stroke == PaintCurrent ? Color (color.head<3>(), color.w() * shape.strokeColor.w()) : shape.strokeColor);
+         nvgStrokeWidth (ctx, shape.strokeWidth);
+         nvgMiterLimit (ctx, shape.miterLimit);
+         nvgLineCap (ctx, shape.lineCap);
+         nvgLineJoin (ctx, shape.lineJoin);
+         nvgStrokeGeometry (ctx, shape.geometry);
+      }
+   }
+   nvgRestore (ctx);
+}
+
+NAMESPACE_END (nanogui)
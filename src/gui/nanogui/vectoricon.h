@@ -0,0 +1,107 @@
+/*
+    nanogui/vectoricon.h -- Icon parsed from SVG once and drawn through
+    retained geometry at any scale
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "object.h"
+#include "../nanovg/nanovg.h"
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Icon loaded from an SVG document, crisp at any size
+
+   The document is parsed once into NanoVG path commands, one shape per
+   filled or stroked element. Each shape becomes a retained geometry the
+   first time it is drawn; NanoVG tessellates it for the scale it is drawn
+   at and only tessellates it again when the scale changes beyond its
+   tolerance, so an icon drawn at the same size every frame costs no more
+   tessellation than a textured one. An icon shown at several sizes at once
+   is best loaded once per size.
+
+   Supported are the path, rect, circle, ellipse, line, polyline and
+   polygon elements inside groups, the transform attribute, solid fill and
+   stroke colors with their opacities, given as attributes or in the style
+   attribute, and the viewBox of the document. Definitions, clipping and
+   text are skipped, and gradients fall back to the color the icon is drawn
+   with, as does \c currentColor. Holes follow the even-odd rule.
+
+   \code
+   ref<VectorIcon> icon = VectorIcon::load ("assets/icons/folder.svg");
+   icon->draw (ctx, mPos.x(), mPos.y(), 24, mTheme->mIconColor);
+   \endcode
+*/
+class  VectorIcon : public Object
+{
+   public:
+      /// How a shape is painted
+      enum Paint
+      {
+         PaintNone,
+         PaintColor,
+         PaintCurrent	// the color passed to draw(), with the alpha of the shape color
+      };
+
+      /// Path commands and style of one element
+      struct Shape
+      {
+         std::vector<float> commands;	// see the Command enum in vectoricon.cpp
+         Paint fill = PaintColor, stroke = PaintNone;
+         Color fillColor, strokeColor;
+         float strokeWidth = 1, miterLimit = 4;
+         int lineCap = NVG_BUTT, lineJoin = NVG_MITER;
+         NVGgeometry * geometry = nullptr;	// built on first draw
+      };
+
+      VectorIcon() {}
+      /// Parse the text of an SVG document
+      explicit VectorIcon (const std::string & svg)
+      {
+         parse (svg);
+      }
+
+      /// Load an SVG file, throws std::runtime_error if it cannot be read
+      static ref<VectorIcon> load (const std::string & path);
+
+      /// Replace the icon with the shapes of the text of an SVG document
+      void parse (const std::string & svg);
+
+      /// Return the viewBox of the document as origin and size
+      const Vector4f & viewBox() const
+      {
+         return mViewBox;
+      }
+      /// Return whether the document had nothing to draw
+      bool empty() const
+      {
+         return mShapes.empty();
+      }
+      const std::vector<Shape> & shapes() const
+      {
+         return mShapes;
+      }
+
+      /// Draw the icon fit into the square of side \c size at (\c x, \c y), centered, under the current transform
+      void draw (NVGcontext * ctx, float x, float y, float size, const Color & color);
+
+   protected:
+      ~VectorIcon();
+      /// Delete the geometries of the shapes
+      void clear();
+
+      std::vector<Shape> mShapes;
+      Vector4f mViewBox = Vector4f::Zero();
+};
+
+NAMESPACE_END (nanogui)
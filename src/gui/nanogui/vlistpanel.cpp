@@ -0,0 +1,185 @@
+/*
+    src/vlistpanel.cpp -- Vertically scrolling list that only keeps
+    widgets for the rows that are currently visible
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "vlistpanel.h"
+#include "theme.h"
+#include "../nanovg/nanovg.h"
+#include <cmath>
+
+NAMESPACE_BEGIN (nanogui)
+
+static const int scrollbarWidth = 12;
+
+VListPanel::VListPanel (Widget * parent)
+   : Widget (parent), mItemCount (0), mRowHeight (25), mOverscan (2),
+     mScrollOffset (0.0f) {}
+
+void VListPanel::setItemCount (int itemCount)
+{
+   mItemCount = std::max (0, itemCount);
+   setScrollOffset (mScrollOffset);
+   refresh();
+}
+
+void VListPanel::setRowFactory (Callback<Widget * (Widget *)> factory)
+{
+   clearChildren();
+   mRowItems.clear();
+   mFactory = std::move (factory);
+   markDirty();
+}
+
+void VListPanel::setDragPayload (Callback<bool (int, DragPayload &)> payload)
+{
+   mDragPayload = std::move (payload);
+   if (!mDragPayload)
+   {
+      setDragSource (DragSource());
+      return;
+   }
+   setDragSource ([this] (const Vector2i & p, DragPayload & drag)
+   {
+      for (size_t r = 0; r < mRowItems.size(); ++r)
+      {
+         Widget * row = mChildren[r];
+         if (mRowItems[r] < 0 || !row->visible() || !row->contains (p - mPos))
+            continue;
+         drag.item = mRowItems[r];
+         if (!mDragPayload (mRowItems[r], drag))
+            return false;
+         if (!drag.previewImage && !drag.previewWidget)
+            drag.previewWidget = row;
+         return true;
+      }
+      return false;
+   });
+}
+
+void VListPanel::refresh()
+{
+   std::fill (mRowItems.begin(), mRowItems.end(), -1);
+   markDirty();
+}
+
+void VListPanel::setScrollOffset (float offset)
+{
+   float maxOffset = std::max (0.0f, contentHeight() - mSize.y());
+   offset = std::max (0.0f, std::min (offset, maxOffset));
+   if (offset == mScrollOffset)
+      return;
+   mScrollOffset = offset;
+   markDirty();
+}
+
+void VListPanel::scrollToItem (int index)
+{
+   float top = (float) index * mRowHeight;
+   if (top < mScrollOffset)
+      setScrollOffset (top);
+   else
+      if (top + mRowHeight > mScrollOffset + mSize.y())
+         setScrollOffset (top + mRowHeight - mSize.y());
+}
+
+void VListPanel::updateRows (NVGcontext * ctx)
+{
+   if (!mFactory)
+      return;
+   int first = std::max (0, (int) (mScrollOffset / mRowHeight) - mOverscan);
+   int last = std::min (mItemCount, (int) std::ceil ((mScrollOffset + mSize.y()) / mRowHeight) + mOverscan);
+   int rows = std::max (0, last - first);
+   while ((int) mRowItems.size() < rows)
+   {
+      Widget * row = mFactory (this);
+      if (!row || row->parent() != this)
+         throw std::runtime_error ("VListPanel: the row factory must construct rows with the panel as parent!");
+      mRowItems.push_back (-1);
+   }
+   /* Item i always lands in row i % count, so scrolling by one row only rebinds one widget */
+   int count = (int) mRowItems.size();
+   if (count == 0)
+      return;
+   for (int r = 0; r < count; ++r)
+   {
+      int item = first + ((r - first % count) + count) % count;
+      Widget * row = mChildren[r];
+      row->setVisible (item < last);
+      if (item >= last)
+         continue;
+      if (mRowItems[r] != item)
+      {
+         mRowItems[r] = item;
+         if (mBinder)
+            mBinder (row, item);
+      }
+      row->setPosition (Vector2i (0, (int) std::floor (item * (float) mRowHeight - mScrollOffset)));
+      row->setSize (Vector2i (mSize.x() - scrollbarWidth, mRowHeight));
+      row->performLayout (ctx);
+   }
+}
+
+void VListPanel::performLayout (NVGcontext * ctx)
+{
+   setScrollOffset (mScrollOffset);
+   updateRows (ctx);
+}
+
+Vector2i VListPanel::preferredSize (NVGcontext * ctx) const
+{
+   int width = mChildren.empty() ? 0 : mChildren[0]->cachedPreferredSize (ctx).x();
+   return Vector2i (width + scrollbarWidth, (int) contentHeight());
+}
+
+bool VListPanel::mouseDragEvent (const Vector2i &, const Vector2i & rel, int, int)
+{
+   float scrollh = mSize.y() * std::min (1.0f, mSize.y() / std::max (1.0f, contentHeight()));
+   float track = mSize.y() - 8 - scrollh;
+   if (track <= 0)
+      return false;
+   setScrollOffset (mScrollOffset + rel.y() * (contentHeight() - mSize.y()) / track);
+   return true;
+}
+
+bool VListPanel::scrollEvent (const Vector2i &, const Vector2f & rel)
+{
+   setScrollOffset (mScrollOffset - rel.y() * 3 * mRowHeight);
+   return true;
+}
+
+void VListPanel::draw (NVGcontext * ctx)
+{
+   updateRows (ctx);
+   nvgSave (ctx);
+   nvgIntersectScissor (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y());
+   Widget::draw (ctx);
+   nvgRestore (ctx);
+   float total = std::max (1.0f, contentHeight());
+   float scrollh = mSize.y() * std::min (1.0f, mSize.y() / total);
+   float maxOffset = std::max (1.0f, total - mSize.y());
+   float knob = (mSize.y() - 8 - scrollh) * std::min (1.0f, mScrollOffset / maxOffset);
+   NVGpaint paint = nvgBoxGradient (
+                       ctx, mPos.x() + mSize.x() - scrollbarWidth + 1, mPos.y() + 4 + 1, 8,
+                       mSize.y() - 8, 3, 4, Color (0, 32), Color (0, 92));
+   nvgFillPaint (ctx, paint);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + mSize.x() - scrollbarWidth, mPos.y() + 4, 8,
+                          mSize.y() - 8, 3);
+   paint = nvgBoxGradient (
+              ctx, mPos.x() + mSize.x() - scrollbarWidth - 1,
+              mPos.y() + 4 + knob - 1, 8, scrollh,
+              3, 4, Color (220, 100), Color (128, 100));
+   nvgFillPaint (ctx, paint);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + mSize.x() - scrollbarWidth + 1,
+                          mPos.y() + 4 + 1 + knob, 8 - 2,
+                          scrollh - 2, 2);
+}
+
+NAMESPACE_END (nanogui)
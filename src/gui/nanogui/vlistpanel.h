@@ -0,0 +1,131 @@
+/*
+    nanogui/vlistpanel.h -- Vertically scrolling list that only keeps
+    widgets for the rows that are currently visible
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include "callback.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Virtualized list of equally tall rows with a vertical scrollbar
+
+   Instead of holding a widget for every item, the panel creates row widgets
+   with the row factory only for the visible rows plus a few rows of overscan,
+   and recycles them while scrolling. The binder fills a row widget with the
+   contents of an item whenever the row is assigned to a different item. The
+   scrollbar is derived from the item count and the row height, no layout of
+   the full content is ever needed.
+
+   \code
+   VListPanel * list = new VListPanel (window);
+   list->setFixedSize (Vector2i (300, 400));
+   list->setRowFactory ([] (Widget * parent) { return new Label (parent, ""); });
+   list->setRowBinder ([&] (Widget * row, int index) { ((Label *) row)->setCaption (cues[index].name); });
+   list->setItemCount ((int) cues.size());
+   \endcode
+*/
+class  VListPanel : public Widget
+{
+   public:
+      VListPanel (Widget * parent);
+
+      /// Return the number of items in the list
+      int itemCount() const
+      {
+         return mItemCount;
+      }
+      /// Set the number of items in the list; all rows are bound again
+      void setItemCount (int itemCount);
+
+      /// Return the height of a single row
+      int rowHeight() const
+      {
+         return mRowHeight;
+      }
+      /// Set the height of a single row
+      void setRowHeight (int rowHeight)
+      {
+         mRowHeight = std::max (1, rowHeight);
+         refresh();
+      }
+
+      /// Return the number of rows kept above and below the visible ones
+      int overscan() const
+      {
+         return mOverscan;
+      }
+      /// Set the number of rows kept above and below the visible ones
+      void setOverscan (int overscan)
+      {
+         mOverscan = std::max (0, overscan);
+         markDirty();
+      }
+
+      /// Set the function creating a row widget; it must construct the row with the given parent
+      void setRowFactory (Callback<Widget * (Widget *)> factory);
+      /// Set the function filling a row widget with the contents of an item
+      void setRowBinder (Callback<void (Widget *, int)> binder)
+      {
+         mBinder = std::move (binder);
+         refresh();
+      }
+
+      /**
+         \brief Let the rows be dragged to drop targets, see \ref Widget::setDropTarget()
+
+         \c payload describes the item at an index when a drag starts and
+         returns false to not drag it. The row widget follows the cursor
+         unless another preview is set.
+      */
+      void setDragPayload (Callback<bool (int index, DragPayload & payload)> payload);
+
+      /// Bind all rows again, e.g. after the contents of the items changed
+      void refresh();
+
+      /// Return the scroll offset in pixels from the top of the first item
+      float scrollOffset() const
+      {
+         return mScrollOffset;
+      }
+      /// Set the scroll offset in pixels, clamped to the scrollable range
+      void setScrollOffset (float offset);
+      /// Scroll so that the given item is visible
+      void scrollToItem (int index);
+
+      virtual void performLayout (NVGcontext * ctx);
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
+      virtual bool scrollEvent (const Vector2i & p, const Vector2f & rel);
+      virtual void draw (NVGcontext * ctx);
+
+   protected:
+      /// Height of all items together
+      float contentHeight() const
+      {
+         return (float) mItemCount * mRowHeight;
+      }
+      /// Create, recycle and bind the row widgets for the current scroll offset
+      void updateRows (NVGcontext * ctx);
+
+      Callback<Widget * (Widget *)> mFactory;
+      Callback<void (Widget *, int)> mBinder;
+      Callback<bool (int, DragPayload &)> mDragPayload;
+      std::vector<int> mRowItems;	// item bound to each row widget, -1 if none
+      int mItemCount;
+      int mRowHeight;
+      int mOverscan;
+      float mScrollOffset;
+};
+
+NAMESPACE_END (nanogui)
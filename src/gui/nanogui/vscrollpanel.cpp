@@ -13,18 +13,26 @@
 #include "vscrollpanel.h"
 #include "theme.h"
 #include "../nanovg/nanovg.h"
+#include <cmath>
 
 NAMESPACE_BEGIN (nanogui)
 
 VScrollPanel::VScrollPanel (Widget * parent)
-   : Widget (parent), mChildPreferredHeight (0), mScroll (0.0f) {}
+   : Widget (parent), mChildPreferredHeight (0), mScroll (0.0f), mCacheContent (false),
+     mKineticScrolling (false), mScrollVelocity (0.0f)
+{
+   mKind |= ScrollKind;
+}
+
+/* A kinetic scroll decays exponentially and travels as far as a plain scroll event would */
+static const float ScrollFriction = 10.0f;
 
 void VScrollPanel::performLayout (NVGcontext * ctx)
 {
    if (mChildren.empty())
       return;
    Widget * child = mChildren[0];
-   mChildPreferredHeight = child->preferredSize (ctx).y();
+   mChildPreferredHeight = child->cachedPreferredSize (ctx).y();
    child->setPosition (Vector2i (0, 0));
    child->setSize (Vector2i (mSize.x() - 12, mChildPreferredHeight));
 }
@@ -33,7 +41,7 @@ Vector2i VScrollPanel::preferredSize (NVGcontext * ctx) const
 {
    if (mChildren.empty())
       return Vector2i::Zero();
-   return mChildren[0]->preferredSize (ctx) + Vector2i (12, 0);
+   return mChildren[0]->cachedPreferredSize (ctx) + Vector2i (12, 0);
 }
 
 bool VScrollPanel::mouseDragEvent (const Vector2i &, const Vector2i & rel,
@@ -45,6 +53,8 @@ bool VScrollPanel::mouseDragEvent (const Vector2i &, const Vector2i & rel,
                    std::min (1.0f, height() / (float)mChildPreferredHeight);
    mScroll = std::max ((float) 0.0f, std::min ((float) 1.0f,
                        mScroll + rel.y() / (float) (mSize.y() - 8 - scrollh)));
+   mScrollVelocity = 0.0f;
+   markDirty();
    return true;
 }
 
@@ -53,11 +63,58 @@ bool VScrollPanel::scrollEvent (const Vector2i & /* p */, const Vector2f & rel)
    float scrollAmount = rel.y() * (mSize.y() / 20.0f);
    float scrollh = height() *
                    std::min (1.0f, height() / (float)mChildPreferredHeight);
-   mScroll = std::max ((float) 0.0f, std::min ((float) 1.0f,
-                       mScroll - scrollAmount / (float) (mSize.y() - 8 - scrollh)));
+   float delta = -scrollAmount / (float) (mSize.y() - 8 - scrollh);
+   if (mKineticScrolling)
+   {
+      if (mScrollVelocity == 0.0f)
+         mLastScrollTime = std::chrono::steady_clock::now();
+      mScrollVelocity += delta * ScrollFriction;
+   }
+   else
+      mScroll = std::max ((float) 0.0f, std::min ((float) 1.0f, mScroll + delta));
+   markDirty();
    return true;
 }
 
+void VScrollPanel::scrollToVisible (const Widget * widget)
+{
+   /* Extent of the widget within the content, which is laid out at the origin of the panel */
+   int top = 0, height = widget ? widget->height() : 0;
+   while (widget && widget->parent() != this)
+   {
+      top += widget->position().y();
+      widget = widget->parent();
+   }
+   int range = mChildPreferredHeight - mSize.y();
+   if (!widget || range <= 0)
+      return;
+   float offset = mScroll * range;
+   if (top + height > offset + mSize.y())
+      offset = (float) (top + height - mSize.y());
+   if (top < offset)
+      offset = (float) top;
+   mScroll = std::max (0.0f, std::min (1.0f, offset / range));
+   mScrollVelocity = 0.0f;
+   markDirty();
+}
+
+void VScrollPanel::updateKineticScroll()
+{
+   if (mScrollVelocity == 0.0f)
+      return;
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+   float dt = std::min (0.1f, std::chrono::duration<float> (now - mLastScrollTime).count());
+   mLastScrollTime = now;
+   float decay = std::exp (-ScrollFriction * dt);
+   mScroll += mScrollVelocity * (1.0f - decay) / ScrollFriction;
+   mScrollVelocity *= decay;
+   if (mScroll <= 0.0f || mScroll >= 1.0f || std::abs (mScrollVelocity) * mChildPreferredHeight < 1.0f)
+      mScrollVelocity = 0.0f;
+   mScroll = std::max (0.0f, std::min (1.0f, mScroll));
+   /* Keep frames coming until the motion has settled */
+   markDirty();
+}
+
 bool VScrollPanel::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
 {
    if (mChildren.empty())
@@ -79,34 +136,37 @@ void VScrollPanel::draw (NVGcontext * ctx)
    if (mChildren.empty())
       return;
    Widget * child = mChildren[0];
-   mChildPreferredHeight = child->preferredSize (ctx).y();
+   mChildPreferredHeight = child->cachedPreferredSize (ctx).y();
+   updateKineticScroll();
    float scrollh = height() *
                    std::min (1.0f, height() / (float) mChildPreferredHeight);
+   float offset = mScroll * (mChildPreferredHeight - mSize.y());
    nvgSave (ctx);
    nvgTranslate (ctx, mPos.x(), mPos.y());
-   nvgScissor (ctx, 0, 0, mSize.x(), mSize.y());
-   nvgTranslate (ctx, 0, -mScroll * (mChildPreferredHeight - mSize.y()));
+   nvgIntersectScissor (ctx, 0, 0, mSize.x(), mSize.y());
+   nvgTranslate (ctx, 0, -offset);
    if (child->visible())
-      child->draw (ctx);
+   {
+      if (mCacheContent)
+         child->drawCached (ctx, 0, offset - mSize.y(), mSize.x(), 3 * mSize.y());
+      else
+         child->drawRetained (ctx);
+   }
    nvgRestore (ctx);
    NVGpaint paint = nvgBoxGradient (
                        ctx, mPos.x() + mSize.x() - 12 + 1, mPos.y() + 4 + 1, 8,
                        mSize.y() - 8, 3, 4, Color (0, 32), Color (0, 92));
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + mSize.x() - 12, mPos.y() + 4, 8,
-                   mSize.y() - 8, 3);
    nvgFillPaint (ctx, paint);
-   nvgFill (ctx);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + mSize.x() - 12, mPos.y() + 4, 8,
+                          mSize.y() - 8, 3);
    paint = nvgBoxGradient (
               ctx, mPos.x() + mSize.x() - 12 - 1,
               mPos.y() + 4 + (mSize.y() - 8 - scrollh) * mScroll - 1, 8, scrollh,
               3, 4, Color (220, 100), Color (128, 100));
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x() + mSize.x() - 12 + 1,
-                   mPos.x() + 4 + 1 + (mSize.y() - 8 - scrollh) * mScroll, 8 - 2,
-                   scrollh - 2, 2);
    nvgFillPaint (ctx, paint);
-   nvgFill (ctx);
+   nvgDrawRoundedRectSDF (ctx, mPos.x() + mSize.x() - 12 + 1,
+                          mPos.y() + 4 + 1 + (mSize.y() - 8 - scrollh) * mScroll, 8 - 2,
+                          scrollh - 2, 2);
 }
 
 NAMESPACE_END (nanogui)
@@ -13,6 +13,7 @@
 #pragma once
 
 #include "widget.h"
+#include <chrono>
 
 NAMESPACE_BEGIN (nanogui)
 
@@ -28,9 +29,49 @@ class  VScrollPanel : public Widget
       virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
       virtual bool mouseMotionEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
       virtual void draw (NVGcontext * ctx);
+
+      /**
+         \brief Keep a recording of the content and only move it while scrolling
+
+         The recording covers one panel height above and below the visible part and
+         is redone when the content is marked dirty or scrolled past that margin.
+         Only enable this when the content calls markDirty() for every change of
+         its appearance. Disabled by default.
+      */
+      void setCacheContent (bool cache)
+      {
+         mCacheContent = cache;
+         markDirty();
+      }
+      bool cacheContent() const
+      {
+         return mCacheContent;
+      }
+
+      /// Let the scroll wheel start a motion that slows down over time instead of jumping
+      void setKineticScrolling (bool kinetic)
+      {
+         mKineticScrolling = kinetic;
+         mScrollVelocity = 0.0f;
+      }
+      bool kineticScrolling() const
+      {
+         return mKineticScrolling;
+      }
+
+      /// Scroll the least amount that brings \c widget, somewhere below the panel, fully into view
+      void scrollToVisible (const Widget * widget);
+
    protected:
+      /// Advance a kinetic scroll by the time passed since the last frame
+      void updateKineticScroll();
+
       int mChildPreferredHeight;
       float mScroll;
+      bool mCacheContent;
+      bool mKineticScrolling;
+      float mScrollVelocity;	// of mScroll per second
+      std::chrono::steady_clock::time_point mLastScrollTime;
 };
 
 NAMESPACE_END (nanogui)
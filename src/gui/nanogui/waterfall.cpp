@@ -0,0 +1,248 @@
+/*
+    src/waterfall.cpp -- Scrolling waterfall of rows of values, such as
+    the spectra of a spectrogram
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "waterfall.h"
+#include "screen.h"
+#include "../nanovg/nanovg.h"
+#include "../util/RowQueue.h"
+#include <algorithm>
+#include <cstring>
+
+#if !defined(NVG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define WATERFALL_SSE2 1
+#elif !defined(NVG_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WATERFALL_NEON 1
+#endif
+
+NAMESPACE_BEGIN (nanogui)
+
+WaterfallFeed::WaterfallFeed (int bins, size_t capacity, const std::shared_ptr<const Mapping> & mapping)
+   : mQueue (new RowQueue ((size_t)bins * 4, capacity)), mMapping (mapping), mBins (bins)
+{
+}
+
+WaterfallFeed::~WaterfallFeed()
+{
+}
+
+uint64_t WaterfallFeed::dropped() const
+{
+   return mQueue->dropped();
+}
+
+bool WaterfallFeed::push (const float * values)
+{
+   std::shared_ptr<const Mapping> mapping = std::atomic_load (&mMapping);
+   return mQueue->push ([&] (unsigned char * row)
+   {
+      mapRow (*mapping, values, mBins, row);
+   });
+}
+
+void WaterfallFeed::mapRow (const Mapping & mapping, const float * values, int count, unsigned char * row)
+{
+   const unsigned char * colors = mapping.colors.data();
+   int i = 0;
+   /* The indices four at a time, clamped to the colormap; NaN ends up at the first entry */
+#if defined(WATERFALL_SSE2)
+   const __m128 min = _mm_set1_ps (mapping.min), scale = _mm_set1_ps (mapping.scale);
+   const __m128 zero = _mm_setzero_ps(), last = _mm_set1_ps (255.0f), half = _mm_set1_ps (0.5f);
+   for (; i + 4 <= count; i += 4)
+   {
+      __m128 v = _mm_mul_ps (_mm_sub_ps (_mm_loadu_ps (values + i), min), scale);
+      /* maxps returns its second operand when the first is NaN */
+      v = _mm_min_ps (_mm_max_ps (v, zero), last);
+      int index[4];
+      _mm_storeu_si128 ((__m128i *)index, _mm_cvttps_epi32 (_mm_add_ps (v, half)));
+      for (int k = 0; k < 4; ++k)
+         memcpy (row + (i + k) * 4, colors + index[k] * 4, 4);
+   }
+#elif defined(WATERFALL_NEON)
+   const float32x4_t min = vdupq_n_f32 (mapping.min), scale = vdupq_n_f32 (mapping.scale);
+   const float32x4_t zero = vdupq_n_f32 (0.0f), last = vdupq_n_f32 (255.0f), half = vdupq_n_f32 (0.5f);
+   for (; i + 4 <= count; i += 4)
+   {
+      float32x4_t v = vmulq_f32 (vsubq_f32 (vld1q_f32 (values + i), min), scale);
+      /* maxnm returns the number when the other operand is NaN */
+      v = vminq_f32 (vmaxnmq_f32 (v, zero), last);
+      int32_t index[4];
+      vst1q_s32 (index, vcvtq_s32_f32 (vaddq_f32 (v, half)));
+      for (int k = 0; k < 4; ++k)
+         memcpy (row + (i + k) * 4, colors + index[k] * 4, 4);
+   }
+#endif
+   for (; i < count; ++i)
+   {
+      float v = (values[i] - mapping.min) * mapping.scale;
+      int index = v > 0.0f ? (int)std::min (v + 0.5f, 255.0f) : 0;
+      memcpy (row + i * 4, colors + index * 4, 4);
+   }
+}
+
+Waterfall::Waterfall (Widget * parent, int bins, int history)
+   : Widget (parent), mBins (0), mHistory (0), mRange (0.0f, 1.0f)
+{
+   setColormap ({ Color (0, 0, 0, 255), Color (32, 0, 128, 255), Color (200, 0, 64, 255),
+                  Color (255, 160, 0, 255), Color (255, 255, 224, 255) });
+   setDimensions (bins, history);
+}
+
+Waterfall::~Waterfall()
+{
+   releaseImage();
+}
+
+Vector2i Waterfall::preferredSize (NVGcontext *) const
+{
+   return Vector2i (256, 128);
+}
+
+void Waterfall::setDimensions (int bins, int history)
+{
+   mBins = std::max (bins, 1);
+   mHistory = std::max (history, 1);
+   /* A new size needs a new image, and the rows queued by the feed have the old one */
+   releaseImage();
+   mFeed.reset();
+   mPoll.reset();
+   clear();
+}
+
+void Waterfall::setColormap (const std::vector<Color> & colors)
+{
+   mColormap.assign (256 * 4, 0);
+   if (colors.empty())
+      return;
+   for (int i = 0; i < 256; ++i)
+   {
+      float t = i / 255.0f * (colors.size() - 1);
+      size_t a = std::min ((size_t)t, colors.size() - 1), b = std::min (a + 1, colors.size() - 1);
+      Color c = colors[a] * (1.0f - (t - a)) + colors[b] * (t - a);
+      /* Premultiplied, as the image is */
+      mColormap[i * 4 + 0] = (unsigned char) (c.r() * c.w() * 255.0f + 0.5f);
+      mColormap[i * 4 + 1] = (unsigned char) (c.g() * c.w() * 255.0f + 0.5f);
+      mColormap[i * 4 + 2] = (unsigned char) (c.b() * c.w() * 255.0f + 0.5f);
+      mColormap[i * 4 + 3] = (unsigned char) (c.w() * 255.0f + 0.5f);
+   }
+   updateMapping();
+}
+
+void Waterfall::updateMapping()
+{
+   std::shared_ptr<WaterfallFeed::Mapping> mapping = std::make_shared<WaterfallFeed::Mapping>();
+   mapping->colors = mColormap;
+   mapping->min = mRange.x();
+   mapping->scale = mRange.y() != mRange.x() ? 255.0f / (mRange.y() - mRange.x()) : 0.0f;
+   mMapping = mapping;
+   if (mFeed)
+      std::atomic_store (&mFeed->mMapping, mMapping);
+}
+
+void Waterfall::push (const float * values)
+{
+   mHead = (mHead + mHistory - 1) % mHistory;
+   WaterfallFeed::mapRow (*mMapping, values, mBins, &mPixels[(size_t)mHead * mBins * 4]);
+   mPending = std::min (mPending + 1, mHistory);
+   markDirty();
+}
+
+void Waterfall::clear()
+{
+   mPixels.assign ((size_t)mBins * mHistory * 4, 0);
+   mHead = 0;
+   mPending = mHistory;
+   markDirty();
+}
+
+std::shared_ptr<WaterfallFeed> Waterfall::feed (size_t capacity)
+{
+   if (!mFeed)
+   {
+      mFeed.reset (new WaterfallFeed (mBins, capacity, mMapping));
+      mPoll = std::make_shared<std::function<void()>> ([this]() { drainFeed(); });
+      if (Screen * screen = this->screen())
+         screen->addPoll (mPoll);
+   }
+   return mFeed;
+}
+
+void Waterfall::drainFeed()
+{
+   int rows = 0;
+   for (;;)
+   {
+      /* Straight into the slot of the oldest row, which the row becomes the newest of */
+      int head = (mHead + mHistory - 1) % mHistory;
+      if (!mFeed->mQueue->pop (&mPixels[(size_t)head * mBins * 4]))
+         break;
+      mHead = head;
+      rows++;
+   }
+   if (rows)
+   {
+      mPending = std::min (mPending + rows, mHistory);
+      markDirty();
+   }
+}
+
+void Waterfall::releaseImage()
+{
+   if (mImage)
+      nvgDeleteImage (mImageContext, mImage);
+   mImage = 0;
+   mImageContext = nullptr;
+}
+
+void Waterfall::upload (NVGcontext * ctx)
+{
+   if (!mImage)
+   {
+      mImage = nvgCreateImageRGBA (ctx, mBins, mHistory, NVG_IMAGE_REPEATY | NVG_IMAGE_PREMULTIPLIED, mPixels.data());
+      mImageContext = ctx;
+      mPending = 0;
+      return;
+   }
+   if (mPending == 0)
+      return;
+   /* The newest rows, in at most two pieces of the ring */
+   int first = std::min (mPending, mHistory - mHead), rowBytes = mBins * 4;
+   if (mRegionUpdates)
+   {
+      mRegionUpdates = nvgUpdateImageRegion (ctx, mImage, 0, mHead, mBins, first,
+                                             &mPixels[(size_t)mHead * rowBytes], rowBytes) != 0;
+      if (mRegionUpdates && mPending > first)
+         nvgUpdateImageRegion (ctx, mImage, 0, 0, mBins, mPending - first, mPixels.data(), rowBytes);
+   }
+   if (!mRegionUpdates)
+      nvgUpdateImage (ctx, mImage, mPixels.data());
+   mPending = 0;
+}
+
+void Waterfall::draw (NVGcontext * ctx)
+{
+   Widget::draw (ctx);
+   upload (ctx);
+   if (!mImage)
+      return;
+   /* Texture row mHead at the top edge, older rows below it, wrapping around the ring */
+   float rowHeight = mSize.y() / (float)mHistory;
+   NVGpaint paint = nvgImagePattern (ctx, mPos.x(), mPos.y() - mHead * rowHeight, mSize.x(), mHistory * rowHeight,
+                                     0.0f, mImage, 1.0f);
+   nvgBeginPath (ctx);
+   nvgRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y());
+   nvgFillPaint (ctx, paint);
+   nvgFill (ctx);
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,164 @@
+/*
+    nanogui/waterfall.h -- Scrolling waterfall of rows of values, such as
+    the spectra of a spectrogram
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "widget.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+class RowQueue;
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Queue through which another thread pushes rows into a \ref Waterfall
+
+   The producer maps its rows through the colormap itself, four values at a
+   time with SSE2 or NEON, and writes the colors straight into a lock-free
+   ring, so the GUI thread only copies finished rows into the image. The feed
+   follows changes of the colormap and range of its waterfall and may outlive
+   it.
+*/
+class  WaterfallFeed
+{
+   public:
+      ~WaterfallFeed();
+
+      /// Producer side, maps a row of \ref bins() values and queues it, false if the queue was full and the row dropped
+      bool push (const float * values);
+
+      int bins() const
+      {
+         return mBins;
+      }
+      /// Return the number of rows dropped because the queue was full
+      uint64_t dropped() const;
+
+   protected:
+      friend class Waterfall;
+
+      /// Colormap and range, replaced as a whole so that the producer never sees half of a change
+      struct Mapping
+      {
+         std::vector<unsigned char> colors;	// 256 premultiplied RGBA entries
+         float min, scale;	// value min maps to the first entry, min + 255 / scale to the last
+      };
+
+      WaterfallFeed (int bins, size_t capacity, const std::shared_ptr<const Mapping> & mapping);
+
+      /// Write the colors of \c count values to \c row
+      static void mapRow (const Mapping & mapping, const float * values, int count, unsigned char * row);
+
+      std::unique_ptr<RowQueue> mQueue;
+      std::shared_ptr<const Mapping> mMapping;	// read and replaced with std::atomic_load/store
+      int mBins;
+};
+
+/**
+   \brief Rows of values mapped through a colormap, the newest at the top
+
+   A sibling of \ref Graph for spectra: one row per frame, of a few thousand
+   bins, pushed on the GUI thread with \ref push() or from a worker thread
+   through \ref feed().
+
+   The rows are kept in an image used as a ring: a new row overwrites the
+   oldest one and only that row is uploaded with nvgUpdateImageRegion(), so a
+   frame costs one row of pixels however long the history. The image is drawn
+   as a pattern repeating vertically, offset so that the newest row lands at
+   the top, which scrolls the waterfall without moving any pixels, and the
+   cost of a frame stays the same however deep the history. Back-ends without
+   rect updates get the whole image instead.
+*/
+class  Waterfall : public Widget
+{
+   public:
+      Waterfall (Widget * parent, int bins = 256, int history = 256);
+      ~Waterfall();
+
+      /// Return the number of values per row
+      int bins() const
+      {
+         return mBins;
+      }
+      /// Return the number of rows kept
+      int history() const
+      {
+         return mHistory;
+      }
+      /// Set the number of values per row and of rows kept, dropping all rows. Detaches the feed.
+      void setDimensions (int bins, int history);
+
+      /// Return the values mapped to the first and last color of the colormap, 0 and 1 by default
+      const Vector2f & range() const
+      {
+         return mRange;
+      }
+      /// Set the range of the values, which applies to rows pushed from now on
+      void setRange (float min, float max)
+      {
+         mRange = Vector2f (min, max);
+         updateMapping();
+      }
+
+      /// Set the colormap as colors spaced evenly over the range, which applies to rows pushed from now on
+      void setColormap (const std::vector<Color> & colors);
+
+      /// Add a row of \ref bins() values at the top, dropping the oldest one when there are \ref history() rows
+      void push (const float * values);
+      /// Drop all rows
+      void clear();
+
+      /**
+         \brief Return the queue another thread pushes rows into
+
+         Created on first call, which has to happen on the GUI thread once the
+         waterfall is attached to a screen. A single producer thread may push
+         into it without blocking; every \ref Screen::drawWidgets() moves the
+         queued rows into the image and redraws the waterfall when there were
+         any. \c capacity is the number of rows the queue holds.
+      */
+      std::shared_ptr<WaterfallFeed> feed (size_t capacity = 64);
+
+      virtual Vector2i preferredSize (NVGcontext * ctx) const;
+      virtual void draw (NVGcontext * ctx);
+      /// The image is an object of the context drawn with
+      virtual bool threadSafeDraw() const
+      {
+         return false;
+      }
+
+   protected:
+      /// Upload the rows pushed since the last frame, creating the image if needed
+      void upload (NVGcontext * ctx);
+      void releaseImage();
+      /// Rebuild the mapping from the colormap and range and hand it to the feed
+      void updateMapping();
+      /// Move the rows queued by the feed into the ring
+      void drainFeed();
+
+      int mBins, mHistory;
+      std::vector<unsigned char> mPixels;	// RGBA ring of history() rows
+      std::vector<unsigned char> mColormap;	// 256 premultiplied RGBA entries
+      Vector2f mRange;
+      std::shared_ptr<const WaterfallFeed::Mapping> mMapping;
+      std::shared_ptr<WaterfallFeed> mFeed;
+      std::shared_ptr<std::function<void()>> mPoll;	// registered with the screen while the feed exists
+      int mHead = 0;	// row of the newest values
+      int mPending = 0;	// newest rows not uploaded yet
+      bool mRegionUpdates = true;	// the back-end updates rects
+      NVGcontext * mImageContext = nullptr;	// the image was created with
+      int mImage = 0;
+};
+
+NAMESPACE_END (nanogui)
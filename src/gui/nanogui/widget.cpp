@@ -13,18 +13,36 @@
 #include "layout.h"
 #include "theme.h"
 #include "window.h"
+#include "label.h"
+#include "slider.h"
+#include "progressbar.h"
 //#include "cinder/gl/gl.h"
 #include "../nanovg/nanovg.h"
 #include "screen.h"
+#include "widgetarena.h"
+#include "widgetsearch.h"
+#include "drawinspector.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 
 NAMESPACE_BEGIN (nanogui)
 
+std::atomic<unsigned int> Widget::sStructureGeneration { 1 };
+const Widget::Extras Widget::sNoExtras;
+
 Widget::Widget (Widget * parent)
    : mParent (nullptr), mTheme (nullptr), mLayout (nullptr),
-     mPos (Vector2i::Zero()), mSize (Vector2i::Zero()),
-     mFixedSize (Vector2i::Zero()), mVisible (true), mEnabled (true),
-     mFocused (false), mMouseFocus (false), mTooltip (""), mFontSize (-1.0f),
-     mCursor (Cursor::Arrow)
+     mDrawList (nullptr), mSpatialIndex (nullptr),
+     mPos (Vector2i::Zero()), mSize (Vector2i::Zero()), mPreferredSize (Vector2i::Zero()),
+     mLayoutSize (Vector2i::Zero()), mAbsolutePosition(), mAbsolutePositionValid (false),
+     mGeometryIndex (-1), mChildIndex (-1),
+     mDrawListTheme (0), mFontSize (-1), mKind (0), mCursor ((uint8_t)Cursor::Arrow),
+     mVisible (true), mEnabled (true), mOccluded (false), mFocused (false), mMouseFocus (false),
+     mDirty (true), mRetained (false), mLayered (false), mPreferredSizeValid (false), mLayoutDirty (true),
+     mSpatialIndexStale (true), mUnorderedChildren (false)
 {
    if (parent)
    {
@@ -33,6 +51,30 @@ Widget::Widget (Widget * parent)
    }
 }
 
+/* Every widget allocation is prefixed with the arena it came from (nullptr for the heap) */
+static const size_t allocationHeaderSize = alignof (std::max_align_t);
+
+void * Widget::operator new (size_t size)
+{
+   WidgetArena * arena = WidgetArena::current();
+   size += allocationHeaderSize;
+   char * mem = (char *) (arena ? arena->allocate (size) : ::operator new (size));
+   * (WidgetArena **) mem = arena;
+   return mem + allocationHeaderSize;
+}
+
+void Widget::operator delete (void * ptr)
+{
+   if (!ptr)
+      return;
+   char * mem = (char *) ptr - allocationHeaderSize;
+   WidgetArena * arena = * (WidgetArena **) mem;
+   if (arena)
+      arena->release (mem);
+   else
+      ::operator delete (mem);
+}
+
 Widget::~Widget()
 {
    for (auto child : mChildren)
@@ -40,6 +82,13 @@ Widget::~Widget()
       if (child)
          child->decRef();
    }
+   if (mDrawList)
+      nvgDeleteDrawList (mDrawList);
+   if (mExtras && mExtras->layer)
+      nvgDeleteLayer (mExtras->layerContext, mExtras->layer);
+   if (mExtras && mExtras->frameList)
+      nvgDeleteDrawList (mExtras->frameList);
+   delete mSpatialIndex;
 }
 
 int Widget::fontSize() const
@@ -55,15 +104,75 @@ Vector2i Widget::preferredSize (NVGcontext * ctx) const
       return mSize;
 }
 
+/* Label, Slider and ProgressBar are final and make up most leaves, so their calls from the traversals
+   below are bound statically through their kind and can be inlined; other children go through the vtable */
+static Vector2i preferredSizeOf (const Widget * widget, NVGcontext * ctx)
+{
+   switch (widget->kind())
+   {
+      case Widget::LabelKind:
+         return static_cast<const Label *> (widget)->preferredSize (ctx);
+      case Widget::SliderKind:
+         return static_cast<const Slider *> (widget)->preferredSize (ctx);
+      case Widget::ProgressBarKind:
+         return static_cast<const ProgressBar *> (widget)->preferredSize (ctx);
+      default:
+         return widget->preferredSize (ctx);
+   }
+}
+
+static bool mouseMotionOf (Widget * widget, const Vector2i & p, const Vector2i & rel, int button, int modifiers)
+{
+   switch (widget->kind())
+   {
+      case Widget::LabelKind:
+         return static_cast<Label *> (widget)->mouseMotionEvent (p, rel, button, modifiers);
+      case Widget::SliderKind:
+         return static_cast<Slider *> (widget)->mouseMotionEvent (p, rel, button, modifiers);
+      case Widget::ProgressBarKind:
+         return static_cast<ProgressBar *> (widget)->mouseMotionEvent (p, rel, button, modifiers);
+      default:
+         return widget->mouseMotionEvent (p, rel, button, modifiers);
+   }
+}
+
+Vector2i Widget::cachedPreferredSize (NVGcontext * ctx) const
+{
+   if (!mPreferredSizeValid)
+   {
+      mPreferredSize = preferredSizeOf (this, ctx);
+      mPreferredSizeValid = true;
+   }
+   return mPreferredSize;
+}
+
+void Widget::invalidateLayout()
+{
+   // The preferred size of every ancestor may depend on this one
+   Widget * widget = this;
+   while (widget)
+   {
+      widget->mPreferredSizeValid = false;
+      widget->mLayoutDirty = true;
+      widget = widget->mParent;
+   }
+   markDirty();
+}
+
 void Widget::performLayout (NVGcontext * ctx)
 {
+   // Nothing below this widget changed and its parent gave it the same size as last time
+   if (!mLayoutDirty && mLayoutSize == mSize)
+      return;
+   PROFILE_ZONE ("Widget::performLayout");
+   INSPECT_LAYOUT (this);
    if (mLayout)
       mLayout->performLayout (ctx, this);
    else
    {
       for (auto c : mChildren)
       {
-         Vector2i pref = c->preferredSize (ctx), fix = c->fixedSize();
+         Vector2i pref = c->cachedPreferredSize (ctx), fix = c->fixedSize();
          c->setSize (Vector2i (
                         fix[0] ? fix[0] : pref[0],
                         fix[1] ? fix[1] : pref[1]
@@ -71,26 +180,70 @@ void Widget::performLayout (NVGcontext * ctx)
          c->performLayout (ctx);
       }
    }
+   mLayoutDirty = false;
+   mLayoutSize = mSize;
+   if (mSpatialIndex)
+   {
+      mSpatialIndex->build (mChildren);
+      mSpatialIndexStale = false;
+   }
+}
+
+void Widget::setSpatialIndex (bool enabled)
+{
+   if (enabled == (mSpatialIndex != nullptr))
+      return;
+   if (enabled)
+      mSpatialIndex = new SpatialGrid();
+   else
+   {
+      delete mSpatialIndex;
+      mSpatialIndex = nullptr;
+   }
+   mSpatialIndexStale = true;
+}
+
+SpatialGrid::Candidates Widget::childrenAt (const Vector2i & p)
+{
+   return childrenAt (p, p);
+}
+
+SpatialGrid::Candidates Widget::childrenAt (const Vector2i & p, const Vector2i & q)
+{
+   if (!mSpatialIndex)
+      return SpatialGrid::all (childCount());
+   if (mSpatialIndexStale)
+   {
+      mSpatialIndex->build (mChildren);
+      mSpatialIndexStale = false;
+   }
+   return mSpatialIndex->query (p, q);
 }
 
 Widget * Widget::findWidget (const Vector2i & p)
 {
-   for (auto it = mChildren.rbegin(); it != mChildren.rend(); ++it)
+   const Vector2i local = p - mPos;
+   const Vec2i q (local);
+   SpatialGrid::Candidates candidates = childrenAt (local);
+   for (int i = candidates.next(); i >= 0; i = candidates.next())
    {
-      Widget * child = *it;
-      if (child->visible() && child->contains (p - mPos))
-         return child->findWidget (p - mPos);
+      Widget * child = mChildren[i];
+      if (child->visible() && !child->mOccluded && child->contains (q))
+         return child->findWidget (local);
    }
-   return contains (p) ? this : nullptr;
+   return contains (Vec2i (p)) ? this : nullptr;
 }
 
 bool Widget::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
 {
-   for (auto it = mChildren.rbegin(); it != mChildren.rend(); ++it)
+   const Vector2i local = p - mPos;
+   const Vec2i q (local);
+   SpatialGrid::Candidates candidates = childrenAt (local);
+   for (int i = candidates.next(); i >= 0; i = candidates.next())
    {
-      Widget * child = *it;
-      if (child->visible() && child->contains (p - mPos) &&
-            child->mouseButtonEvent (p - mPos, button, down, modifiers))
+      Widget * child = mChildren[i];
+      if (child->visible() && !child->mOccluded && child->contains (q) &&
+            child->mouseButtonEvent (local, button, down, modifiers))
          return true;
    }
    if (button == MOUSE_BUTTON_LEFT && down && !mFocused)
@@ -100,16 +253,20 @@ bool Widget::mouseButtonEvent (const Vector2i & p, int button, bool down, int mo
 
 bool Widget::mouseMotionEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers)
 {
-   for (auto it = mChildren.rbegin(); it != mChildren.rend(); ++it)
+   const Vector2i local = p - mPos, prevLocal = local - rel;
+   const Vec2i q (local), prevQ (prevLocal);
+   // Only children under the current or the previous cursor position can see a motion or enter/leave
+   SpatialGrid::Candidates candidates = childrenAt (local, prevLocal);
+   for (int i = candidates.next(); i >= 0; i = candidates.next())
    {
-      Widget * child = *it;
-      if (!child->visible())
+      Widget * child = mChildren[i];
+      if (!child->visible() || child->mOccluded)
          continue;
-      bool contained = child->contains (p - mPos), prevContained = child->contains (p - mPos - rel);
+      bool contained = child->contains (q), prevContained = child->contains (prevQ);
       if (contained != prevContained)
          child->mouseEnterEvent (p, contained);
       if ((contained || prevContained) &&
-            child->mouseMotionEvent (p - mPos, rel, button, modifiers))
+            mouseMotionOf (child, local, rel, button, modifiers))
          return true;
    }
    return false;
@@ -117,12 +274,15 @@ bool Widget::mouseMotionEvent (const Vector2i & p, const Vector2i & rel, int but
 
 bool Widget::scrollEvent (const Vector2i & p, const Vector2f & rel)
 {
-   for (auto it = mChildren.rbegin(); it != mChildren.rend(); ++it)
+   const Vector2i local = p - mPos;
+   const Vec2i q (local);
+   SpatialGrid::Candidates candidates = childrenAt (local);
+   for (int i = candidates.next(); i >= 0; i = candidates.next())
    {
-      Widget * child = *it;
-      if (!child->visible())
+      Widget * child = mChildren[i];
+      if (!child->visible() || child->mOccluded)
          continue;
-      if (child->contains (p - mPos) && child->scrollEvent (p - mPos, rel))
+      if (child->contains (q) && child->scrollEvent (local, rel))
          return true;
    }
    return false;
@@ -133,14 +293,24 @@ bool Widget::mouseDragEvent (const Vector2i &, const Vector2i &, int, int)
    return false;
 }
 
+bool Widget::mouseDragSamplesEvent (const std::vector<PointerSample> & samples, const Vector2i & rel, int button,
+                                    int modifiers)
+{
+   return !samples.empty() && mouseDragEvent (samples.back().pos, rel, button, modifiers);
+}
+
 bool Widget::mouseEnterEvent (const Vector2i &, bool enter)
 {
+   if (mMouseFocus != enter)
+      markDirty();
    mMouseFocus = enter;
    return false;
 }
 
 bool Widget::focusEvent (bool focused)
 {
+   if (mFocused != focused)
+      markDirty();
    mFocused = focused;
    return false;
 }
@@ -157,22 +327,111 @@ bool Widget::keyboardCharacterEvent (unsigned int)
 
 void Widget::addChild (Widget * widget)
 {
+   widget->mChildIndex = (int) mChildren.size();
    mChildren.push_back (widget);
    widget->incRef();
    widget->setParent (this);
+   mSpatialIndexStale = true;
+   invalidateLayout();
+   if (WidgetSearch * search = attachedSearch())
+      search->add (widget);
+}
+
+void Widget::addChildren (const std::vector<Widget *> & widgets)
+{
+   if (widgets.empty())
+      return;
+   mChildren.reserve (mChildren.size() + widgets.size());
+   for (auto widget : widgets)
+   {
+      widget->mChildIndex = (int) mChildren.size();
+      mChildren.push_back (widget);
+      widget->incRef();
+      widget->mParent = this;
+      widget->invalidateAbsolutePosition();
+   }
+   sStructureGeneration++;
+   mSpatialIndexStale = true;
+   invalidateLayout();
+   if (WidgetSearch * search = attachedSearch())
+      for (auto widget : widgets)
+         search->add (widget);
+}
+
+int Widget::childIndex (const Widget * widget) const
+{
+   /* The index a child was added at stays right until children before it are removed or reordered */
+   int hint = widget->mChildIndex;
+   if (hint >= 0 && hint < (int) mChildren.size() && mChildren[hint] == widget)
+      return hint;
+   auto it = std::find (mChildren.begin(), mChildren.end(), widget);
+   if (it == mChildren.end())
+      return -1;
+   widget->mChildIndex = (int) (it - mChildren.begin());
+   return widget->mChildIndex;
+}
+
+void Widget::moveChild (const Widget * widget, int index)
+{
+   int from = childIndex (widget);
+   if (from < 0)
+      return;
+   index = std::max (0, std::min (index, (int) mChildren.size() - 1));
+   if (index == from)
+      return;
+   auto first = mChildren.begin();
+   if (from < index)
+      std::rotate (first + from, first + from + 1, first + index + 1);
+   else
+      std::rotate (first + index, first + from, first + from + 1);
+   for (int i = std::min (from, index); i <= std::max (from, index); ++i)
+      mChildren[i]->mChildIndex = i;
+   sStructureGeneration++;
+   mSpatialIndexStale = true;
+   invalidateLayout();
 }
 
 void Widget::removeChild (const Widget * widget)
 {
-   mChildren.erase (std::remove (mChildren.begin(), mChildren.end(), widget), mChildren.end());
-   widget->decRef();
+   int index = childIndex (widget);
+   if (index >= 0)
+      removeChild (index);
 }
 
 void Widget::removeChild (int index)
 {
    Widget * widget = mChildren[index];
-   mChildren.erase (mChildren.begin() + index);
+   if (mUnorderedChildren && index + 1 < (int) mChildren.size())
+   {
+      mChildren[index] = mChildren.back();
+      mChildren[index]->mChildIndex = index;
+      mChildren.pop_back();
+   }
+   else
+      mChildren.erase (mChildren.begin() + index);
+   if (WidgetSearch * search = attachedSearch())
+      search->remove (widget);
    widget->decRef();
+   sStructureGeneration++;
+   mSpatialIndexStale = true;
+   invalidateLayout();
+}
+
+void Widget::clearChildren()
+{
+   if (mChildren.empty())
+      return;
+   WidgetSearch * search = attachedSearch();
+   for (auto child : mChildren)
+   {
+      if (search)
+         search->remove (child);
+      child->decRef();
+   }
+   mChildren.clear();
+   sStructureGeneration++;
+   mSpatialIndexStale = true;
+   invalidateLayout();
 }
 
 Window * Widget::window()
@@ -183,13 +442,20 @@ Window * Widget::window()
       if (!widget)
          throw std::runtime_error (
             "Widget:internal error (could not find parent window)");
-      Window * window = dynamic_cast<Window *> (widget);
-      if (window)
-         return window;
+      if (widget->isWindow())
+         return (Window *) widget;
       widget = widget->parent();
    }
 }
 
+Screen * Widget::screen()
+{
+   Widget * widget = this;
+   while (widget->parent())
+      widget = widget->parent();
+   return widget->isScreen() ? (Screen *) widget : nullptr;
+}
+
 void Widget::requestFocus()
 {
    Widget * widget = this;
@@ -210,10 +476,272 @@ void Widget::draw (NVGcontext * ctx)
    if (mChildren.empty())
       return;
    nvgTranslate (ctx, mPos.x(), mPos.y());
+   /* Skip children whose bounds, transformed to screen space, miss the clip bounds entirely.
+      The margin keeps drop shadows and other decorations drawn just outside a widget. */
+   float clip[4], xf[6];
+   bool cull = nvgCurrentClipBounds (ctx, clip) != 0;
+   if (cull)
+   {
+      float margin = mTheme ? (float) mTheme->mWindowDropShadowSize : 0.0f;
+      clip[0] -= margin;
+      clip[1] -= margin;
+      clip[2] += margin;
+      clip[3] += margin;
+      nvgCurrentTransform (ctx, xf);
+   }
    for (auto child : mChildren)
-      if (child->visible())
-         child->draw (ctx);
+   {
+      if (!child->visible() || child->mOccluded)
+         continue;
+      if (cull)
+      {
+         float hw = child->width() * 0.5f, hh = child->height() * 0.5f;
+         float cx = child->position().x() + hw, cy = child->position().y() + hh;
+         float sx = xf[0] * cx + xf[2] * cy + xf[4], sy = xf[1] * cx + xf[3] * cy + xf[5];
+         float ex = std::abs (xf[0]) * hw + std::abs (xf[2]) * hh;
+         float ey = std::abs (xf[1]) * hw + std::abs (xf[3]) * hh;
+         if (sx + ex < clip[0] || sx - ex > clip[2] || sy + ey < clip[1] || sy - ey > clip[3])
+            continue;
+      }
+      INSPECT_DRAW (child, ctx);
+      if (child->mAlpha < 1.0f)
+      {
+         if (child->mAlpha <= 0.0f)
+            continue;
+         if (child->mLayered && child->drawLayered (ctx, child->mAlpha))
+            continue;
+         /* NanoVG sets the global alpha rather than multiplying it, so the ancestors are folded in here,
+            up to the one whose layer is being drawn */
+         float alpha = 1.0f;
+         for (const Widget * widget = child; widget && !(widget->mExtras && widget->mExtras->layerOpen);
+              widget = widget->mParent)
+            alpha *= widget->mAlpha;
+         nvgSave (ctx);
+         nvgGlobalAlpha (ctx, alpha);
+         drawChild (child, ctx);
+         nvgRestore (ctx);
+         continue;
+      }
+      drawChild (child, ctx);
+   }
    nvgTranslate (ctx, -mPos.x(), -mPos.y());
 }
 
+void Widget::setAlpha (float alpha)
+{
+   alpha = std::min (std::max (alpha, 0.0f), 1.0f);
+   if (alpha == mAlpha)
+      return;
+   mAlpha = alpha;
+   if (mLayered && mExtras && mExtras->layer)
+   {
+      /* The layer is drawn opaque and keeps its content, only the area has to be composited again */
+      bool dirty = mDirty;
+      markDirty();
+      mDirty = dirty;
+      return;
+   }
+   /* Recordings have the global alpha baked in, so every one below is recorded again */
+   markSubtreeDirty();
+}
+
+void Widget::setLayered (bool layered)
+{
+   if (layered == mLayered)
+      return;
+   mLayered = layered;
+   if (!layered && mExtras && mExtras->layer)
+   {
+      nvgDeleteLayer (mExtras->layerContext, mExtras->layer);
+      mExtras->layer = 0;
+      mExtras->layerContext = nullptr;
+   }
+   markSubtreeDirty();
+}
+
+void Widget::markSubtreeDirty()
+{
+   std::vector<Widget *> stack (1, this);
+   while (!stack.empty())
+   {
+      Widget * widget = stack.back();
+      stack.pop_back();
+      widget->mDirty = true;
+      stack.insert (stack.end(), widget->mChildren.begin(), widget->mChildren.end());
+   }
+   markDirty();
+}
+
+void Widget::markDirty()
+{
+   // Always walk up to the root: the screen clears its own flag after every frame. Flags already
+   // set are only read, so windows laid out in parallel do not write to their shared ancestors
+   Widget * widget = this, * root = this;
+   while (widget)
+   {
+      if (!widget->mDirty)
+         widget->mDirty = true;
+      root = widget;
+      widget = widget->mParent;
+   }
+   if (root->isScreen())
+      ((Screen *) root)->damageWidget (this);
+}
+
+void Widget::geometryChanged()
+{
+   if (mGeometryIndex < 0)
+      return;
+   Widget * root = this;
+   while (root->mParent)
+      root = root->mParent;
+   if (root->isScreen())
+      ((Screen *) root)->mGeometry.update (this);
+}
+
+void Widget::invalidateAbsolutePosition()
+{
+   /* An ancestor of a widget with a valid cache has one too, so the walk stops at the first stale widget */
+   if (!mAbsolutePositionValid)
+      return;
+   mAbsolutePositionValid = false;
+   for (auto child : mChildren)
+      child->invalidateAbsolutePosition();
+}
+
+void Widget::searchTextChanged()
+{
+   if (WidgetSearch * search = attachedSearch())
+      search->touch (this);
+}
+
+WidgetSearch * Widget::attachedSearch()
+{
+   Widget * root = this;
+   while (root->mParent)
+      root = root->mParent;
+   return root->isScreen() ? ((Screen *) root)->mSearch.get() : nullptr;
+}
+
+void Widget::clearDirty()
+{
+   mDirty = false;
+   for (auto child : mChildren)
+      child->clearDirty();
+}
+
+bool Widget::recordingCurrent() const
+{
+   return !mTheme || mTheme->version() == mDrawListTheme;
+}
+
+template <typename T> void Widget::drawRetainedAs (T * widget, NVGcontext * ctx)
+{
+   Widget * self = widget;
+   /* Recorded on another thread by the screen for this frame */
+   if (self->mExtras && self->mExtras->frameRecorded && nvgDrawList (ctx, self->mExtras->frameList))
+      return;
+   if (!self->mRetained)
+   {
+      widget->draw (ctx);
+      return;
+   }
+   if (!self->mDirty && self->recordingCurrent() && nvgDrawList (ctx, self->mDrawList))
+      return;
+   if (!self->mDrawList)
+      self->mDrawList = nvgCreateDrawList();
+   nvgBeginDrawList (ctx, self->mDrawList);
+   widget->draw (ctx);
+   nvgEndDrawList (ctx);
+   self->clearDirty();
+   self->mDrawListTheme = self->mTheme ? self->mTheme->version() : 0;
+}
+
+void Widget::drawRetained (NVGcontext * ctx)
+{
+   drawRetainedAs (this, ctx);
+}
+
+void Widget::drawChild (Widget * child, NVGcontext * ctx)
+{
+   switch (child->mKind)
+   {
+      case LabelKind:
+         drawRetainedAs (static_cast<Label *> (child), ctx);
+         break;
+      case SliderKind:
+         drawRetainedAs (static_cast<Slider *> (child), ctx);
+         break;
+      case ProgressBarKind:
+         drawRetainedAs (static_cast<ProgressBar *> (child), ctx);
+         break;
+      default:
+         child->drawRetained (ctx);
+   }
+}
+
+bool Widget::drawLayered (NVGcontext * ctx, float alpha)
+{
+   Extras & extras = this->extras();
+   if (extras.layerContext != ctx)
+   {
+      if (extras.layer)
+         nvgDeleteLayer (extras.layerContext, extras.layer);
+      extras.layer = nvgCreateLayer (ctx);
+      extras.layerContext = ctx;
+      mDirty = true;
+   }
+   if (!extras.layer)
+      return false;
+   /* The view rectangle covering the widget and its drop shadow under the current transform */
+   float xf[6], rect[4] = { 1e30f, 1e30f, -1e30f, -1e30f };
+   float margin = mTheme ? (float) mTheme->mWindowDropShadowSize : 0.0f;
+   nvgCurrentTransform (ctx, xf);
+   for (int i = 0; i < 4; ++i)
+   {
+      float x = (i & 1) ? mPos.x() + mSize.x() + margin : mPos.x() - margin;
+      float y = (i & 2) ? mPos.y() + mSize.y() + margin : mPos.y() - margin;
+      float sx = xf[0] * x + xf[2] * y + xf[4], sy = xf[1] * x + xf[3] * y + xf[5];
+      rect[0] = std::min (rect[0], sx);
+      rect[1] = std::min (rect[1], sy);
+      rect[2] = std::max (rect[2], sx);
+      rect[3] = std::max (rect[3], sy);
+   }
+   uint32_t theme = mTheme ? mTheme->version() : 0;
+   if (mDirty || theme != extras.layerTheme || memcmp (rect, extras.layerRect, sizeof (rect)) != 0)
+   {
+      if (!nvgBeginLayer (ctx, extras.layer, rect[0], rect[1], rect[2] - rect[0], rect[3] - rect[1]))
+         return false;
+      /* The whole widget, not just the damaged part, so that later frames can composite it as is */
+      nvgResetScissor (ctx);
+      extras.layerOpen = true;
+      drawRetained (ctx);
+      extras.layerOpen = false;
+      nvgEndLayer (ctx);
+      clearDirty();
+      memcpy (extras.layerRect, rect, sizeof (rect));
+      extras.layerTheme = theme;
+   }
+   return nvgDrawLayer (ctx, extras.layer, alpha) != 0;
+}
+
+void Widget::drawCached (NVGcontext * ctx, float x, float y, float w, float h)
+{
+   if (!mDirty && recordingCurrent() && nvgDrawList (ctx, mDrawList))
+      return;
+   if (!mDrawList)
+      mDrawList = nvgCreateDrawList();
+   nvgSave (ctx);
+   nvgScissor (ctx, x, y, w, h);
+   nvgRecordDrawList (ctx, mDrawList);
+   draw (ctx);
+   nvgEndDrawList (ctx);
+   nvgRestore (ctx);
+   clearDirty();
+   mDrawListTheme = mTheme ? mTheme->version() : 0;
+   /* The recording fails when draw lists are nested too deeply */
+   if (!nvgDrawList (ctx, mDrawList))
+      draw (ctx);
+}
+
 NAMESPACE_END (nanogui)
@@ -12,12 +12,26 @@
 #pragma once
 
 #include "object.h"
+#include "dragdrop.h"
+#include "internedstring.h"
+#include "spatialgrid.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 NAMESPACE_BEGIN (nanogui)
 
 enum class Cursor;
 
+/// One cursor position of a drag as reported by the system, see \ref Widget::mouseDragSamplesEvent()
+struct PointerSample
+{
+   Vector2i pos;	// in the coordinates of the parent, as for mouseDragEvent()
+   double time;	// seconds since the screen was created
+   float pressure;	// from 0 to 1, 1 for devices without pressure
+};
+
 /**
    \brief Base class of all widgets
 
@@ -27,10 +41,18 @@ enum class Cursor;
 */
 class  Widget : public Object
 {
+      friend class UiReader;
+      friend class UiWriter;
+      friend class WidgetGeometry;
    public:
       /// Construct a new widget with the given parent widget
       Widget (Widget * parent);
 
+      /// Allocate from the current \ref WidgetArena, or from the heap outside of an arena scope
+      static void * operator new (size_t size);
+      /// Return the memory to the arena or heap it came from
+      static void operator delete (void * ptr);
+
       /// Return the parent widget
       Widget * parent()
       {
@@ -45,6 +67,58 @@ class  Widget : public Object
       void setParent (Widget * parent)
       {
          mParent = parent;
+         invalidateAbsolutePosition();
+         sStructureGeneration++;
+      }
+
+      /// Widget kinds that can be tested without RTTI; a subclass carries the kinds of its bases
+      enum Kind
+      {
+         WindowKind = 1,
+         PopupKind  = 2,
+         ScreenKind = 4,
+         LabelKind  = 8,
+         ButtonKind = 16,
+         ScrollKind = 32,
+         SliderKind = 64,
+         ProgressBarKind = 128
+      };
+
+      /// Return the \ref Kind flags of this widget
+      int kind() const
+      {
+         return mKind;
+      }
+      /// Return whether this widget is a \ref Window (this includes popups)
+      bool isWindow() const
+      {
+         return (mKind & WindowKind) != 0;
+      }
+      /// Return whether this widget is a \ref Popup
+      bool isPopup() const
+      {
+         return (mKind & PopupKind) != 0;
+      }
+      /// Return whether this widget is a \ref Screen
+      bool isScreen() const
+      {
+         return (mKind & ScreenKind) != 0;
+      }
+      /// Return whether this widget is a \ref Label
+      bool isLabel() const
+      {
+         return (mKind & LabelKind) != 0;
+      }
+      /// Return whether this widget is a \ref Button (or one of its subclasses)
+      bool isButton() const
+      {
+         return (mKind & ButtonKind) != 0;
+      }
+
+      /// Return whether this widget draws its children shifted from their positions, like a \ref VScrollPanel
+      bool isScroll() const
+      {
+         return (mKind & ScrollKind) != 0;
       }
 
       /// Return the used \ref Layout generator
@@ -61,6 +135,7 @@ class  Widget : public Object
       void setLayout (Layout * layout)
       {
          mLayout = layout;
+         invalidateLayout();
       }
 
       /// Return the \ref Theme used to draw this widget
@@ -77,6 +152,7 @@ class  Widget : public Object
       void setTheme (Theme * theme)
       {
          mTheme = theme;
+         invalidateLayout();
       }
 
       /// Return the position relative to the parent widget
@@ -87,14 +163,31 @@ class  Widget : public Object
       /// Set the position relative to the parent widget
       void setPosition (const Vector2i & pos)
       {
+         if (mPos == pos)
+            return;
          mPos = pos;
+         invalidateAbsolutePosition();
+         geometryChanged();
+         // Cached content is replayed at the new offset; only the parent's recording is stale
+         if (mParent)
+         {
+            mParent->mSpatialIndexStale = true;
+            mParent->markDirty();
+         }
       }
 
       /// Return the absolute position on screen
       Vector2i absolutePosition() const
       {
-         return mParent ?
-                (parent()->absolutePosition() + mPos) : mPos;
+         // Only recomputed when this widget or one of its ancestors moved or was reparented since the last query
+         if (!mAbsolutePositionValid)
+         {
+            mAbsolutePosition = Vec2i (mPos);
+            if (mParent)
+               mAbsolutePosition += Vec2i (parent()->absolutePosition());
+            mAbsolutePositionValid = true;
+         }
+         return mAbsolutePosition.as<Vector2i>();
       }
 
       /// Return the size of the widget
@@ -105,7 +198,17 @@ class  Widget : public Object
       /// set the size of the widget
       void setSize (const Vector2i & size)
       {
+         if (mSize == size)
+            return;
          mSize = size;
+         mPreferredSizeValid = false;
+         geometryChanged();
+         if (mParent)
+            mParent->mSpatialIndexStale = true;
+         markDirty();
+         // The parent repaints the area the widget no longer covers
+         if (mParent)
+            mParent->markDirty();
       }
 
       /// Return the width of the widget
@@ -116,7 +219,17 @@ class  Widget : public Object
       /// Set the width of the widget
       void setWidth (int width)
       {
+         if (mSize.x() == width)
+            return;
          mSize.x() = width;
+         mPreferredSizeValid = false;
+         geometryChanged();
+         if (mParent)
+            mParent->mSpatialIndexStale = true;
+         markDirty();
+         // The parent repaints the area the widget no longer covers
+         if (mParent)
+            mParent->markDirty();
       }
 
       /// Return the height of the widget
@@ -127,7 +240,17 @@ class  Widget : public Object
       /// Set the height of the widget
       void setHeight (int height)
       {
+         if (mSize.y() == height)
+            return;
          mSize.y() = height;
+         mPreferredSizeValid = false;
+         geometryChanged();
+         if (mParent)
+            mParent->mSpatialIndexStale = true;
+         markDirty();
+         // The parent repaints the area the widget no longer covers
+         if (mParent)
+            mParent->markDirty();
       }
 
       /**
@@ -141,34 +264,43 @@ class  Widget : public Object
       */
       void setFixedSize (const Vector2i & fixedSize)
       {
-         mFixedSize = fixedSize;
+         if (this->fixedSize() == fixedSize)
+            return;
+         extras().fixedSize = fixedSize;
+         invalidateLayout();
       }
 
       /// Return the fixed size (see \ref setFixedSize())
       const Vector2i & fixedSize() const
       {
-         return mFixedSize;
+         return mExtras ? mExtras->fixedSize : sNoExtras.fixedSize;
       }
 
       // Return the fixed width (see \ref setFixedSize())
       int fixedWidth() const
       {
-         return mFixedSize.x();
+         return fixedSize().x();
       }
       // Return the fixed height (see \ref setFixedSize())
       int fixedHeight() const
       {
-         return mFixedSize.y();
+         return fixedSize().y();
       }
       /// Set the fixed width (see \ref setFixedSize())
       void setFixedWidth (int width)
       {
-         mFixedSize.x() = width;
+         if (fixedWidth() == width)
+            return;
+         extras().fixedSize.x() = width;
+         invalidateLayout();
       }
       /// Set the fixed height (see \ref setFixedSize())
       void setFixedHeight (int height)
       {
-         mFixedSize.y() = height;
+         if (fixedHeight() == height)
+            return;
+         extras().fixedSize.y() = height;
+         invalidateLayout();
       }
 
       /// Return whether or not the widget is currently visible (assuming all parents are visible)
@@ -179,7 +311,12 @@ class  Widget : public Object
       /// Set whether or not the widget is currently visible (assuming all parents are visible)
       void setVisible (bool visible)
       {
+         if (mVisible == visible)
+            return;
          mVisible = visible;
+         geometryChanged();
+         if (mParent)
+            mParent->invalidateLayout();
       }
 
       /// Check if this widget is currently visible, taking parent widgets into account
@@ -195,6 +332,37 @@ class  Widget : public Object
          return visible;
       }
 
+      /// Return whether the screen found this window covered by an opaque window, it is then neither drawn nor hit-tested
+      bool occluded() const
+      {
+         return mOccluded;
+      }
+
+      /// Return the opacity of the widget and its children, on top of that of the ancestors
+      float alpha() const
+      {
+         return mAlpha;
+      }
+      /// Set the opacity in [0, 1], drawn with nvgGlobalAlpha() or through a layer, see \ref setLayered(); a widget at 0 is not drawn but still gets events
+      void setAlpha (float alpha);
+
+      /**
+         \brief Draw the widget through an offscreen layer while it is translucent
+
+         The subtree is drawn opaque into a nanovg layer, which is composited
+         with the alpha of the widget as a single quad, so overlapping children
+         don't show through each other. The layer is only drawn again once the
+         subtree is marked dirty: a fade changing nothing but the alpha costs one
+         quad a frame. Without layers in the back-end, and within a recording,
+         the widget falls back to nvgGlobalAlpha(). Windows are layered.
+      */
+      void setLayered (bool layered);
+      /// Return whether the widget is drawn through a layer while translucent
+      bool layered() const
+      {
+         return mLayered;
+      }
+
       /// Return the number of child widgets
       int childCount() const
       {
@@ -216,24 +384,70 @@ class  Widget : public Object
       */
       void addChild (Widget * widget);
 
+      /// Add detached widgets as children, in order, invalidating the layout once
+      void addChildren (const std::vector<Widget *> & widgets);
+
+      /// Reserve room for \c count more child widgets, e.g. before building a large form
+      void reserveChildren (int count)
+      {
+         mChildren.reserve (mChildren.size() + count);
+      }
+
       /// Remove a child widget by index
       void removeChild (int index);
 
-      /// Remove a child widget by value
+      /// Remove a child widget by value, without searching the children unless they were reordered
       void removeChild (const Widget * widget);
 
+      /// Release all child widgets in one pass, keeping the room they took for the next ones
+      void clearChildren();
+
+      /// Return the index of a child widget, or -1 if it is not a child of this widget
+      int childIndex (const Widget * widget) const;
+
+      /// Move a child widget to \c index among the children, keeping the order of the others
+      void moveChild (const Widget * widget, int index);
+
+      /**
+         \brief Let removals reorder the children
+
+         Removing a child from the middle then moves the last child into its
+         place instead of shifting all that follow, so that it takes constant
+         time. Meant for containers whose children are positioned by their
+         own data, such as tiles or nodes: the drawing and event order of the
+         children changes.
+      */
+      void setUnorderedChildren (bool unordered)
+      {
+         mUnorderedChildren = unordered;
+      }
+      bool unorderedChildren() const
+      {
+         return mUnorderedChildren;
+      }
+
       // Walk up the hierarchy and return the parent window
       Window * window();
 
+      /// Walk up the hierarchy and return the parent screen (or \c nullptr if not attached)
+      Screen * screen();
+
       /// Associate this widget with an ID value (optional)
       void setId (const std::string & id)
       {
-         mId = id;
+         if (mExtras || !id.empty())
+            extras().id = id;
+         searchTextChanged();
       }
       /// Return the ID value associated with this widget, if any
       const std::string & id() const
       {
-         return mId;
+         return mExtras ? mExtras->id : sNoExtras.id;
+      }
+      /// Return the caption the widget is found by in a \ref WidgetSearch, besides its id; subclasses with captions override it
+      virtual const std::string & searchText() const
+      {
+         return sNoExtras.id;
       }
 
       /// Return whether or not this widget is currently enabled
@@ -244,7 +458,10 @@ class  Widget : public Object
       /// Set whether or not this widget is currently enabled
       void setEnabled (bool enabled)
       {
+         if (mEnabled == enabled)
+            return;
          mEnabled = enabled;
+         markDirty();
       }
 
       /// Return whether or not this widget is currently focused
@@ -255,18 +472,44 @@ class  Widget : public Object
       /// Set whether or not this widget is currently focused
       void setFocused (bool focused)
       {
+         if (mFocused == focused)
+            return;
          mFocused = focused;
+         markDirty();
       }
       /// Request the focus to be moved to this widget
       void requestFocus();
 
       const std::string & tooltip() const
       {
-         return mTooltip;
+         return mExtras ? mExtras->tooltip : sNoExtras.tooltip;
       }
       void setTooltip (const std::string & tooltip)
       {
-         mTooltip = tooltip;
+         if (mExtras || !tooltip.empty())
+            extras().tooltip = tooltip;
+      }
+
+      /// Return the source of drags starting on this widget or on descendants without one of their own
+      const DragSource & dragSource() const
+      {
+         return mExtras ? mExtras->dragSource : sNoExtras.dragSource;
+      }
+      /// Let this widget start drag and drop once a press on it or a descendant is dragged and not taken by \ref mouseDragEvent()
+      void setDragSource (DragSource source)
+      {
+         if (mExtras || source)
+            extras().dragSource = std::move (source);
+      }
+      const DropTarget & dropTarget() const
+      {
+         return mExtras ? mExtras->dropTarget : sNoExtras.dropTarget;
+      }
+      /// Let payloads be dropped on this widget, see \ref DropTarget
+      void setDropTarget (DropTarget target)
+      {
+         if (mExtras || target.accepts)
+            extras().dropTarget = std::move (target);
       }
 
       /// Return current font size. If not set the default of the current theme will be returned
@@ -274,7 +517,8 @@ class  Widget : public Object
       /// Set the font size of this widget
       void setFontSize (int fontSize)
       {
-         mFontSize = fontSize;
+         mFontSize = (int16_t)fontSize;
+         invalidateLayout();
       }
       /// Return whether the font size is explicitly specified for this widget
       bool hasFontSize() const
@@ -285,24 +529,87 @@ class  Widget : public Object
       /// Return a pointer to the cursor of the widget
       Cursor cursor() const
       {
-         return mCursor;
+         return (Cursor)mCursor;
       }
       /// Set the cursor of the widget
       void setCursor (Cursor cursor)
       {
-         mCursor = cursor;
+         mCursor = (uint8_t)cursor;
+      }
+
+      /**
+         \brief Enable or disable the retained draw cache of this widget
+
+         A retained widget records the nanovg geometry of itself and all of its
+         children, and replays that recording on later frames until the widget or
+         one of its descendants is marked dirty (see \ref markDirty()).
+      */
+      void setRetained (bool retained)
+      {
+         mRetained = retained;
+         markDirty();
+      }
+      /// Return whether the retained draw cache is enabled for this widget
+      bool retained() const
+      {
+         return mRetained;
       }
 
+      /// Return whether this widget or one of its descendants changed since it was last recorded
+      bool dirty() const
+      {
+         return mDirty;
+      }
+      /// Flag this widget and all of its ancestors (including the screen) as needing to be redrawn
+      void markDirty();
+      /// Like \ref markDirty(), and also flag all descendants, so that every recording below is made again
+      void markSubtreeDirty();
+
+      /// Draw the widget, replaying the cached recording of a clean retained subtree
+      void drawRetained (NVGcontext * ctx);
+      /// Draw the widget through its layer with the given alpha, false if no layer could be used
+      bool drawLayered (NVGcontext * ctx, float alpha);
+
+      /**
+         \brief Draw the widget from a recording that survives moving it under the current scissor
+
+         When the widget or a descendant is dirty, or the last recording does not
+         cover the current scissor at the current translation, the subtree is
+         recorded (without rendering) under the larger scissor \c x, \c y, \c w,
+         \c h given in the current transform space. The part inside the current
+         scissor is then replayed. Scrolling containers use this so that a scroll
+         only moves the recording of their content.
+      */
+      void drawCached (NVGcontext * ctx, float x, float y, float w, float h);
+
       /// Check if the widget contains a certain position
       bool contains (const Vector2i & p) const
       {
-         auto d = (p - mPos).array();
-         return (d >= 0).all() && (d < mSize.array()).all();
+         return contains (Vec2i (p));
+      }
+      bool contains (Vec2i p) const
+      {
+         return p.inside (Vec2i (mPos), Vec2i (mSize));
       }
 
       /// Determine the widget located at the given position value (recursive)
       Widget * findWidget (const Vector2i & p);
 
+      /**
+         \brief Enable or disable a spatial index over the child widgets
+
+         Containers with many children (e.g. tile views) can keep a uniform grid
+         over their child rectangles. \ref findWidget() and mouse event routing
+         then only test the children sharing the cell of the cursor. The grid is
+         rebuilt by \ref performLayout() and, lazily, after children moved.
+      */
+      void setSpatialIndex (bool enabled);
+      /// Return whether the child widgets are spatially indexed
+      bool spatialIndex() const
+      {
+         return mSpatialIndex != nullptr;
+      }
+
       /// Handle a mouse button event (default implementation: propagate to children)
       virtual bool mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers);
 
@@ -312,6 +619,18 @@ class  Widget : public Object
       /// Handle a mouse drag event (default implementation: do nothing)
       virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
 
+      /**
+         \brief Handle every cursor position of a drag since the last frame in one call
+
+         While \ref Screen::coalesceMotion() is set, drags arrive this way
+         once per frame, oldest sample first, with \c rel the motion over
+         all of them. Widgets that follow a stroke or scrub a value override
+         it to see the positions in between. The default passes the last
+         position to \ref mouseDragEvent().
+      */
+      virtual bool mouseDragSamplesEvent (const std::vector<PointerSample> & samples, const Vector2i & rel, int button,
+                                          int modifiers);
+
       /// Handle a mouse enter/leave event (default implementation: record this fact, but do nothing)
       virtual bool mouseEnterEvent (const Vector2i & p, bool enter);
 
@@ -330,28 +649,134 @@ class  Widget : public Object
       /// Compute the preferred size of the widget
       virtual Vector2i preferredSize (NVGcontext * ctx) const;
 
+      /**
+         \brief Return the preferred size, computing it only if it was invalidated
+
+         Layout generators use this instead of \ref preferredSize(). The cached
+         value is dropped by \ref invalidateLayout() and when the widget is resized.
+      */
+      Vector2i cachedPreferredSize (NVGcontext * ctx) const;
+
+      /**
+         \brief Flag the preferred size and the layout of this widget and of all of its ancestors as stale
+
+         Call this whenever state that \ref preferredSize() depends on changes. The
+         setters of the built-in widgets do so already; \ref performLayout() only
+         revisits subtrees that were invalidated or resized since their last layout.
+      */
+      void invalidateLayout();
+
+      /// Return whether this widget needs to be laid out again
+      bool layoutDirty() const
+      {
+         return mLayoutDirty;
+      }
+
       /// Invoke the associated layout generator to properly place child widgets, if any
       virtual void performLayout (NVGcontext * ctx);
 
       /// Draw the widget (and all child widgets)
       virtual void draw (NVGcontext * ctx);
 
+      /**
+         \brief Return whether \ref draw() works on a measure context on another thread
+
+         See \ref Screen::setParallelDraw(). Widgets creating images, plots,
+         gradients or other objects of the context they draw with return false,
+         their window is then drawn on the thread of the screen.
+      */
+      virtual bool threadSafeDraw() const
+      {
+         return true;
+      }
+
    protected:
       /// Free all resources used by the widget and any children
       virtual ~Widget();
 
+      /// Clear the dirty flag of this widget and all of its descendants
+      void clearDirty();
+      /// Pass a new position, size or visibility on to the \ref WidgetGeometry of the screen
+      void geometryChanged();
+      /// Drop the cached absolute position of this widget and all of its descendants
+      void invalidateAbsolutePosition();
+      /// Tell the search index of the screen that the id or \ref searchText() changed
+      void searchTextChanged();
+      /// Return the search index of the screen this widget is attached to, if it has one
+      WidgetSearch * attachedSearch();
+      /// Whether the draw list was recorded with the current version of the theme. Descendants
+      /// using another theme are not checked, mark them dirty after editing it
+      bool recordingCurrent() const;
+
+      /// As \ref drawRetained(), calling draw() through \c T, so that it is bound statically when \c T is final
+      template <typename T> static void drawRetainedAs (T * widget, NVGcontext * ctx);
+      /// Draw \c child through \ref drawRetained(), calling the draw() of the final leaf kinds directly
+      static void drawChild (Widget * child, NVGcontext * ctx);
+
+      /// Children whose rectangle may contain \c p, topmost first
+      SpatialGrid::Candidates childrenAt (const Vector2i & p);
+      /// Children whose rectangle may contain \c p or \c q, topmost first
+      SpatialGrid::Candidates childrenAt (const Vector2i & p, const Vector2i & q);
+
+      /// Fields most widgets leave at their defaults, allocated when one is set
+      struct Extras
+      {
+         InternedString id;
+         InternedString tooltip;
+         Vector2i fixedSize = Vector2i::Zero();
+         int layer = 0;	// of a layered widget, see setLayered()
+         NVGcontext * layerContext = nullptr;	// the layer was created with
+         float layerRect[4] = { 0, 0, 0, 0 };	// the layer covers, in view coordinates
+         uint32_t layerTheme = 0;	// theme version the layer was drawn with
+         bool layerOpen = false;	// the subtree is being drawn into the layer
+         NVGdrawList * frameList = nullptr;	// of a window drawn in parallel, see Screen::setParallelDraw()
+         bool frameRecorded = false;	// frameList holds the current frame
+         DragSource dragSource;
+         DropTarget dropTarget;
+      };
+      Extras & extras()
+      {
+         if (!mExtras)
+            mExtras.reset (new Extras());
+         return *mExtras;
+      }
+
    protected:
+      /* Ordered by size, so that a widget has no padding: tens of thousands of them are walked every frame */
+      float mAlpha = 1.0f;
       Widget * mParent;
       ref<Theme> mTheme;
       ref<Layout> mLayout;
-      std::string mId;
-      Vector2i mPos, mSize, mFixedSize;
       std::vector<Widget *> mChildren;
-      bool mVisible, mEnabled;
-      bool mFocused, mMouseFocus;
-      std::string mTooltip;
-      int mFontSize;
-      Cursor mCursor;
+      std::unique_ptr<Extras> mExtras;
+      NVGdrawList * mDrawList;
+      SpatialGrid * mSpatialIndex;
+      Vector2i mPos, mSize;
+      mutable Vector2i mPreferredSize;
+      Vector2i mLayoutSize;
+      mutable Vec2i mAbsolutePosition;
+      /// Not a bit field: const queries set it, also while top-level windows are laid out in parallel
+      mutable bool mAbsolutePositionValid;
+      int mGeometryIndex;	// in the WidgetGeometry of the screen, -1 if it was never indexed
+      mutable int mChildIndex;	// last known index in the children of the parent, see childIndex()
+      uint32_t mDrawListTheme;	// theme version the draw list was recorded with
+      int16_t mFontSize;
+      uint16_t mKind;
+      uint8_t mCursor;	// a Cursor
+      /* Flags of one widget share a word, only the thread owning the widget writes them */
+      bool mVisible : 1, mEnabled : 1;
+      bool mOccluded : 1;
+      bool mFocused : 1, mMouseFocus : 1;
+      bool mDirty : 1, mRetained : 1, mLayered : 1;
+      mutable bool mPreferredSizeValid : 1;
+      bool mLayoutDirty : 1;
+      bool mSpatialIndexStale : 1;
+      bool mUnorderedChildren : 1;
+
+      /// Bumped whenever a widget is added, removed or reordered, invalidating every \ref WidgetGeometry
+      static std::atomic<unsigned int> sStructureGeneration;
+      /// What the accessors of \ref Extras return for widgets without them
+      static const Extras sNoExtras;
 };
 
 NAMESPACE_END (nanogui)
@@ -0,0 +1,88 @@
+/*
+    src/widgetarena.cpp -- Bump allocator for short-lived widget trees
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "widgetarena.h"
+#include <algorithm>
+#include <cstddef>
+
+NAMESPACE_BEGIN (nanogui)
+
+static const size_t arenaAlignment = alignof (std::max_align_t);
+
+static thread_local WidgetArena * currentArena = nullptr;
+
+WidgetArena::Scope::Scope (WidgetArena & arena)
+   : mPrevious (currentArena)
+{
+   currentArena = &arena;
+}
+
+WidgetArena::Scope::~Scope()
+{
+   currentArena = mPrevious;
+}
+
+WidgetArena::WidgetArena (size_t blockSize)
+   : mBlockSize (blockSize)
+{
+}
+
+WidgetArena::~WidgetArena()
+{
+   for (auto & block : mBlocks)
+      ::operator delete (block.data);
+}
+
+WidgetArena * WidgetArena::current()
+{
+   return currentArena;
+}
+
+size_t WidgetArena::capacity() const
+{
+   size_t total = 0;
+   for (auto & block : mBlocks)
+      total += block.size;
+   return total;
+}
+
+void * WidgetArena::allocate (size_t size)
+{
+   size = (size + arenaAlignment - 1) & ~(arenaAlignment - 1);
+   while (mBlock < mBlocks.size() && mOffset + size > mBlocks[mBlock].size)
+   {
+      mBlock++;
+      mOffset = 0;
+   }
+   if (mBlock == mBlocks.size())
+   {
+      /* Oversized widgets get a block of their own */
+      Block block;
+      block.size = std::max (mBlockSize, size);
+      block.data = (char *) ::operator new (block.size);
+      mBlocks.push_back (block);
+   }
+   void * ptr = mBlocks[mBlock].data + mOffset;
+   mOffset += size;
+   mLiveCount++;
+   return ptr;
+}
+
+void WidgetArena::release (void *)
+{
+   if (mLiveCount > 0 && --mLiveCount == 0)
+   {
+      mBlock = 0;
+      mOffset = 0;
+   }
+}
+
+NAMESPACE_END (nanogui)
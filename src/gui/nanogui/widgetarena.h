@@ -0,0 +1,85 @@
+/*
+    nanogui/widgetarena.h -- Bump allocator for short-lived widget trees
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Bump allocator for widget trees that are rebuilt often
+
+   While a \ref WidgetArena::Scope is alive, every widget constructed with
+   \c new on the same thread is carved out of the arena's blocks instead of
+   the heap. Widgets are still reference counted and destroyed as usual, but
+   freeing one only decrements the arena's live count. Once all widgets of the
+   arena are gone its blocks are reused from the start, so rebuilding a panel
+   does not touch the heap for the widgets themselves.
+
+   The arena must outlive all widgets allocated from it.
+
+   \code
+   WidgetArena arena;
+   {
+      WidgetArena::Scope scope (arena);
+      Window * inspector = new Window (screen, "Inspector");
+      ...
+   }
+   \endcode
+*/
+class  WidgetArena
+{
+   public:
+      /// Routes the widget allocations of the current thread to an arena while alive
+      class Scope
+      {
+         public:
+            Scope (WidgetArena & arena);
+            ~Scope();
+         private:
+            WidgetArena * mPrevious;
+      };
+
+      WidgetArena (size_t blockSize = 64 * 1024);
+      ~WidgetArena();
+
+      /// Return the arena of the innermost active scope on this thread, if any
+      static WidgetArena * current();
+
+      /// Return the number of allocations that were not released yet
+      int liveCount() const
+      {
+         return mLiveCount;
+      }
+      /// Return the total size of the blocks owned by the arena
+      size_t capacity() const;
+
+      /// Allocate \c size bytes, aligned like the heap
+      void * allocate (size_t size);
+      /// Release an allocation; the memory is reused once nothing is live anymore
+      void release (void * ptr);
+
+   protected:
+      struct Block
+      {
+         char * data;
+         size_t size;
+      };
+
+      std::vector<Block> mBlocks;
+      size_t mBlockSize;
+      size_t mBlock = 0, mOffset = 0;
+      int mLiveCount = 0;
+};
+
+NAMESPACE_END (nanogui)
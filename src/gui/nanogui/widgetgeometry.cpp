@@ -0,0 +1,104 @@
+/*
+    src/widgetgeometry.cpp -- Rectangles and visibility of a widget tree
+    in flat arrays
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "widgetgeometry.h"
+#include "widget.h"
+#include "../util/Profiler.h"
+
+NAMESPACE_BEGIN (nanogui)
+
+void WidgetGeometry::rebuild (Widget * root)
+{
+   PROFILE_ZONE ("WidgetGeometry::rebuild");
+   mGeneration = Widget::sStructureGeneration;
+   mWidgets.clear();
+   mParents.clear();
+   mX.clear();
+   mY.clear();
+   mWidth.clear();
+   mHeight.clear();
+   mVisible.clear();
+   std::vector<std::pair<Widget *, int>> stack (1, std::make_pair (root, -1));
+   while (!stack.empty())
+   {
+      Widget * widget = stack.back().first;
+      int parent = stack.back().second;
+      stack.pop_back();
+      int index = (int)mWidgets.size();
+      widget->mGeometryIndex = index;
+      mWidgets.push_back (widget);
+      mParents.push_back (parent);
+      mX.push_back (widget->mPos.x() + (parent >= 0 ? mX[parent] : 0));
+      mY.push_back (widget->mPos.y() + (parent >= 0 ? mY[parent] : 0));
+      mWidth.push_back (widget->mSize.x());
+      mHeight.push_back (widget->mSize.y());
+      mVisible.push_back (parent < 0 || (widget->mVisible && !widget->mOccluded));
+      /* Reversed, so that the first child is taken next */
+      for (auto it = widget->mChildren.rbegin(); it != widget->mChildren.rend(); ++it)
+         stack.push_back (std::make_pair (*it, index));
+   }
+   /* Children come after their parent, so every subtree is complete before it is added to the parent's */
+   mSubtree.assign (mWidgets.size(), 1);
+   for (size_t i = mWidgets.size(); i-- > 1;)
+      mSubtree[mParents[i]] += mSubtree[i];
+}
+
+bool WidgetGeometry::current() const
+{
+   return mGeneration == Widget::sStructureGeneration && !mWidgets.empty();
+}
+
+void WidgetGeometry::update (const Widget * widget)
+{
+   int index = widget->mGeometryIndex;
+   if (!current() || index < 0 || index >= size() || mWidgets[index] != widget)
+      return;
+   int parent = mParents[index];
+   int dx = widget->mPos.x() + (parent >= 0 ? mX[parent] : 0) - mX[index];
+   int dy = widget->mPos.y() + (parent >= 0 ? mY[parent] : 0) - mY[index];
+   if (dx || dy)
+      for (int i = index, end = index + mSubtree[index]; i < end; ++i)
+      {
+         mX[i] += dx;
+         mY[i] += dy;
+      }
+   mWidth[index] = widget->mSize.x();
+   mHeight[index] = widget->mSize.y();
+   mVisible[index] = parent < 0 || (widget->mVisible && !widget->mOccluded);
+}
+
+Widget * WidgetGeometry::find (const Vector2i & p)
+{
+   const int n = size(), px = p.x(), py = p.y();
+   mHits.resize (n);
+   const int * x = mX.data(), * y = mY.data(), * w = mWidth.data(), * h = mHeight.data();
+   const uint8_t * visible = mVisible.data();
+   uint8_t * hits = mHits.data();
+   for (int i = 0; i < n; ++i)
+      hits[i] = visible[i] & (px >= x[i]) & (py >= y[i]) & (px < x[i] + w[i]) & (py < y[i] + h[i]);
+
+   /* Later siblings are on top, so the last hit whose ancestors were all hit is the deepest topmost one */
+   Widget * found = nullptr;
+   for (int i = 0; i < n;)
+   {
+      if (hits[i])
+      {
+         found = mWidgets[i];
+         ++i;
+      }
+      else
+         i += mSubtree[i];
+   }
+   return found;
+}
+
+NAMESPACE_END (nanogui)
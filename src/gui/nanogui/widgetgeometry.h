@@ -0,0 +1,67 @@
+/*
+    nanogui/widgetgeometry.h -- Rectangles and visibility of a widget tree
+    in flat arrays
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Absolute rectangles and visibility of every widget below a root
+
+   The widgets are stored in pre-order, each with the number of widgets in
+   its subtree, so that a subtree is a contiguous range that a scan skips in
+   one step. Every attribute has an array of its own, and queries first test
+   all rectangles in a branch-free loop the compiler vectorizes, then walk
+   the results once. Moving a widget shifts the absolute positions of its
+   range in place.
+
+   Adding, removing and reordering widgets only marks the arrays stale, see
+   \ref current(); they are rebuilt by the next \ref rebuild(). Setters of
+   widgets indexed by a stale build are ignored, as the rebuild reads them
+   anyway.
+*/
+class  WidgetGeometry
+{
+   public:
+      /// Index \c root and all widgets below it
+      void rebuild (Widget * root);
+      /// Return whether no widget was added, removed or reordered since the last build
+      bool current() const;
+
+      /// Copy the position, size and visibility of \c widget, called by its setters
+      void update (const Widget * widget);
+
+      /// The deepest visible widget containing \c p, in the coordinates of the root's parent, like \ref Widget::findWidget()
+      Widget * find (const Vector2i & p);
+
+      /// Number of indexed widgets
+      int size() const
+      {
+         return (int)mWidgets.size();
+      }
+
+   protected:
+      std::vector<Widget *> mWidgets;
+      std::vector<int> mParents;	// -1 for the root
+      std::vector<int> mSubtree;	// widgets in the subtree, including itself
+      std::vector<int> mX, mY;	// absolute
+      std::vector<int> mWidth, mHeight;
+      std::vector<uint8_t> mVisible;	// visible and not occluded, the root always is
+      std::vector<uint8_t> mHits;	// scratch of find()
+      unsigned int mGeneration = 0;	// Widget::sStructureGeneration of the build
+};
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,243 @@
+/*
+    src/widgetsearch.cpp -- Trigram index over the ids and captions of a
+    widget tree, for finding controls by name
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include "widgetsearch.h"
+#include "widget.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <cctype>
+
+NAMESPACE_BEGIN (nanogui)
+
+static uint32_t trigram (const char * s)
+{
+   return (uint32_t) (unsigned char)s[0] << 16 | (uint32_t) (unsigned char)s[1] << 8 | (unsigned char)s[2];
+}
+
+static bool wordStart (const std::string & text, size_t pos)
+{
+   return pos == 0 || !std::isalnum ((unsigned char)text[pos - 1]);
+}
+
+/* Substring matches score above 3000, subsequences between 1000 and 3000, shared trigrams alone up to 1000 */
+static int scoreText (const std::string & query, const std::string & text, int hits, int trigrams)
+{
+   size_t pos = text.find (query);
+   if (pos != std::string::npos)
+   {
+      int score = 4000 - (int)std::min (pos, (size_t)999);
+      if (wordStart (text, pos))
+         score += 500;
+      if (query.size() == text.size())
+         score += 1000;
+      return score;
+   }
+   int score = 2000;
+   size_t last = std::string::npos;
+   for (char c : query)
+   {
+      size_t p = text.find (c, last == std::string::npos ? 0 : last + 1);
+      if (p == std::string::npos)
+      {
+         score = -1;
+         break;
+      }
+      if (last != std::string::npos && p != last + 1)
+         score -= 10 * (int)std::min (p - last - 1, (size_t)20);
+      if (wordStart (text, p))
+         score += 20;
+      last = p;
+   }
+   if (score >= 0)
+      return std::min (std::max (score, 1001), 2999);
+   return trigrams > 0 ? 1000 * hits / trigrams : 0;
+}
+
+void WidgetSearch::add (Widget * widget)
+{
+   auto it = mEntryOf.find (widget);
+   if (it != mEntryOf.end())
+      markStale (it->second);
+   else
+   {
+      int e;
+      if (!mFree.empty())
+      {
+         e = mFree.back();
+         mFree.pop_back();
+      }
+      else
+      {
+         e = (int)mEntries.size();
+         mEntries.push_back (Entry { nullptr, 0, false, 0, std::string(), std::string() });
+      }
+      mEntries[e].widget = widget;
+      mEntryOf.emplace (widget, e);
+      markStale (e);
+   }
+   for (Widget * child : widget->children())
+      add (child);
+}
+
+void WidgetSearch::remove (const Widget * widget)
+{
+   auto it = mEntryOf.find (widget);
+   if (it != mEntryOf.end())
+   {
+      Entry & entry = mEntries[it->second];
+      /* The postings of the old version are skipped by queries and dropped by the next compact() */
+      entry.widget = nullptr;
+      entry.version++;
+      mLivePostings -= entry.trigrams;
+      entry.trigrams = 0;
+      mFree.push_back (it->second);
+      mEntryOf.erase (it);
+   }
+   for (const Widget * child : widget->children())
+      remove (child);
+}
+
+void WidgetSearch::touch (const Widget * widget)
+{
+   auto it = mEntryOf.find (widget);
+   if (it != mEntryOf.end())
+      markStale (it->second);
+}
+
+void WidgetSearch::markStale (int entry)
+{
+   if (mEntries[entry].stale)
+      return;
+   mEntries[entry].stale = true;
+   mStale.push_back (entry);
+}
+
+void WidgetSearch::flush()
+{
+   if (mStale.empty())
+      return;
+   PROFILE_ZONE ("WidgetSearch::flush");
+   for (int e : mStale)
+   {
+      Entry & entry = mEntries[e];
+      entry.stale = false;
+      if (!entry.widget)
+         continue;
+      mLivePostings -= entry.trigrams;
+      entry.trigrams = 0;
+      entry.version++;
+      const std::string & caption = entry.widget->searchText(), & id = entry.widget->id();
+      entry.text = caption;
+      if (!id.empty())
+         entry.text += (caption.empty() ? "" : "  ") + id;
+      entry.lower.resize (entry.text.size());
+      std::transform (entry.text.begin(), entry.text.end(), entry.lower.begin(),
+                      [] (char c) { return (char)std::tolower ((unsigned char)c); });
+      if (entry.lower.size() < 3)
+         continue;
+      mQueryTrigrams.clear();
+      for (size_t i = 0; i + 3 <= entry.lower.size(); ++i)
+         mQueryTrigrams.push_back (trigram (&entry.lower[i]));
+      std::sort (mQueryTrigrams.begin(), mQueryTrigrams.end());
+      mQueryTrigrams.erase (std::unique (mQueryTrigrams.begin(), mQueryTrigrams.end()), mQueryTrigrams.end());
+      for (uint32_t t : mQueryTrigrams)
+         mPostings[t].push_back (Posting { e, entry.version });
+      entry.trigrams = (int)mQueryTrigrams.size();
+      mPostingCount += mQueryTrigrams.size();
+      mLivePostings += mQueryTrigrams.size();
+   }
+   mStale.clear();
+   if (mPostingCount > 2 * mLivePostings + 4096)
+      compact();
+}
+
+void WidgetSearch::compact()
+{
+   PROFILE_ZONE ("WidgetSearch::compact");
+   mPostingCount = 0;
+   for (auto & list : mPostings)
+   {
+      list.second.erase (std::remove_if (list.second.begin(), list.second.end(), [this] (const Posting & p)
+      {
+         const Entry & entry = mEntries[p.entry];
+         return !entry.widget || entry.version != p.version;
+      }), list.second.end());
+      mPostingCount += list.second.size();
+   }
+   mLivePostings = mPostingCount;
+}
+
+void WidgetSearch::search (const std::string & query, std::vector<Match> & matches, size_t max)
+{
+   flush();
+   matches.clear();
+   mQuery.resize (query.size());
+   std::transform (query.begin(), query.end(), mQuery.begin(),
+                   [] (char c) { return (char)std::tolower ((unsigned char)c); });
+   if (mQuery.empty() || max == 0)
+      return;
+   if (mHits.size() < mEntries.size())
+      mHits.resize (mEntries.size(), 0);
+   mCandidates.clear();
+   int trigrams = 0, need = 0;
+   if (mQuery.size() >= 3)
+   {
+      mQueryTrigrams.clear();
+      for (size_t i = 0; i + 3 <= mQuery.size(); ++i)
+         mQueryTrigrams.push_back (trigram (&mQuery[i]));
+      std::sort (mQueryTrigrams.begin(), mQueryTrigrams.end());
+      mQueryTrigrams.erase (std::unique (mQueryTrigrams.begin(), mQueryTrigrams.end()), mQueryTrigrams.end());
+      trigrams = (int)mQueryTrigrams.size();
+      /* Half of the trigrams survive a typo or two in a longer query */
+      need = std::max (1, (trigrams + 1) / 2);
+      for (uint32_t t : mQueryTrigrams)
+      {
+         auto it = mPostings.find (t);
+         if (it == mPostings.end())
+            continue;
+         for (const Posting & p : it->second)
+         {
+            const Entry & entry = mEntries[p.entry];
+            if (!entry.widget || entry.version != p.version)
+               continue;
+            if (mHits[p.entry]++ == 0)
+               mCandidates.push_back (p.entry);
+         }
+      }
+   }
+   else
+   {
+      for (int e = 0; e < (int)mEntries.size(); ++e)
+         if (mEntries[e].widget && !mEntries[e].lower.empty())
+            mCandidates.push_back (e);
+   }
+   for (int e : mCandidates)
+   {
+      int hits = mHits[e];
+      mHits[e] = 0;
+      if (hits < need)
+         continue;
+      const Entry & entry = mEntries[e];
+      int score = scoreText (mQuery, entry.lower, hits, trigrams);
+      if (score > 0)
+         matches.push_back (Match { entry.widget, score, &entry.text });
+   }
+   auto better = [] (const Match & a, const Match & b)
+   {
+      return a.score != b.score ? a.score > b.score : a.text->size() < b.text->size();
+   };
+   size_t n = std::min (max, matches.size());
+   std::partial_sort (matches.begin(), matches.begin() + n, matches.end(), better);
+   matches.resize (n);
+}
+
+NAMESPACE_END (nanogui)
@@ -0,0 +1,99 @@
+/*
+    nanogui/widgetsearch.h -- Trigram index over the ids and captions of a
+    widget tree, for finding controls by name
+
+    NanoGUI was developed by Wenzel Jakob <wenzel@inf.ethz.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+NAMESPACE_BEGIN (nanogui)
+
+/**
+   \brief Search index over the ids and captions of the widgets below a screen
+
+   Kept up to date incrementally: widgets attached to or removed from the
+   screen add and drop their subtree, and changing an id or caption marks the
+   widget, see \ref Widget::searchText(). Texts are only read, lowercased and
+   split into trigrams by the next query, so building a large UI costs one
+   hash lookup per widget.
+
+   Queries of three or more characters only score the widgets sharing at
+   least half of their trigrams, which tolerates typos; shorter queries scan
+   all entries. A match as a substring ranks above a match as a subsequence,
+   which ranks above a match by shared trigrams only, with bonuses for
+   matching at the start of a word. Queries reuse their buffers and do not
+   allocate once warm.
+*/
+class  WidgetSearch
+{
+   public:
+      struct Match
+      {
+         Widget * widget;
+         int score;	// higher is better
+         const std::string * text;	// "caption  id" as indexed, valid until the next query
+      };
+
+      /// Index \c widget and the widgets below it
+      void add (Widget * widget);
+      /// Drop \c widget and the widgets below it
+      void remove (const Widget * widget);
+      /// Read the id and caption of \c widget again on the next query
+      void touch (const Widget * widget);
+
+      /// Fill \c matches with the \c max best matches of \c query, best first
+      void search (const std::string & query, std::vector<Match> & matches, size_t max = 20);
+
+      /// Number of indexed widgets
+      size_t size() const
+      {
+         return mEntryOf.size();
+      }
+
+   protected:
+      struct Entry
+      {
+         Widget * widget;	// null once removed
+         unsigned int version;	// bumped when the trigrams of the entry are replaced
+         bool stale;	// texts to be read again
+         int trigrams;	// distinct trigrams indexed for the current version
+         std::string text, lower;
+      };
+      struct Posting
+      {
+         int entry;
+         unsigned int version;
+      };
+
+      /// Read the texts of the entries touched since the last query and index their trigrams
+      void flush();
+      /// Rebuild all posting lists once most of their postings are out of date
+      void compact();
+      void markStale (int entry);
+
+      std::vector<Entry> mEntries;
+      std::vector<int> mFree;	// removed entries, reused first
+      std::vector<int> mStale;	// entries to flush()
+      std::unordered_map<const Widget *, int> mEntryOf;
+      std::unordered_map<uint32_t, std::vector<Posting>> mPostings;	// by trigram of the lowercased text
+      size_t mPostingCount = 0, mLivePostings = 0;
+      /* Scratch of search() */
+      std::string mQuery;
+      std::vector<uint32_t> mQueryTrigrams;
+      std::vector<uint16_t> mHits;	// per entry
+      std::vector<int> mCandidates;
+};
+
+NAMESPACE_END (nanogui)
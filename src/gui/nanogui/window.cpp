@@ -10,6 +10,7 @@
 */
 
 #include "window.h"
+#include "popup.h"
 #include "theme.h"
 #include "../nanovg/nanovg.h"
 #include "screen.h"
@@ -17,14 +18,26 @@
 
 NAMESPACE_BEGIN (nanogui)
 
+uint64_t Window::sStackOrder = 0;
+
 Window::Window (Widget * parent, const std::string & title)
-   : Widget (parent), mTitle (title), mModal (false), mDrag (false) { }
+   : Widget (parent), mTitle (title), mModal (false), mDrag (false), mDragRetained (false), mStackOrder (++sStackOrder)
+{
+   mKind |= WindowKind;
+   mLayered = true;
+}
+
+Window::~Window()
+{
+   if (mBackdrop)
+      nvgDeleteBackdrop (mBackdropContext, mBackdrop);
+}
 
 Vector2i Window::preferredSize (NVGcontext * ctx) const
 {
    Vector2i result = Widget::preferredSize (ctx);
    nvgFontSize (ctx, 18.0f);
-   nvgFontFace (ctx, "sans-bold");
+   nvgFontFaceId (ctx, mTheme->mFontBold.id (ctx));
    float bounds[4];
    nvgTextBounds (ctx, 0, 0, mTitle.c_str(), nullptr, bounds);
    return result.cwiseMax (Vector2i (
@@ -32,67 +45,133 @@ Vector2i Window::preferredSize (NVGcontext * ctx) const
                            ));
 }
 
+bool Window::opaque() const
+{
+   return mTheme && mTheme->mWindowFillFocused.w() >= 1.0f && mTheme->mWindowFillUnfocused.w() >= 1.0f;
+}
+
 void Window::draw (NVGcontext * ctx)
 {
    int ds = mTheme->mWindowDropShadowSize, cr = mTheme->mWindowCornerRadius;
    int hh = mTheme->mWindowHeaderHeight;
-   /* Draw window */
+   float w = mSize.x(), h = mSize.y();
+   /* The shapes are built around the origin so that moving the window reuses them */
    nvgSave (ctx);
-   nvgBeginPath (ctx);
-   nvgRoundedRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), cr);
+   nvgTranslate (ctx, mPos.x(), mPos.y());
+   /* Draw window */
+   NVGgeometry * body = mBodyGeometry.get (ctx, Vector4f (w, h, cr, 0), [&]
+   {
+      nvgRoundedRect (ctx, 0, 0, w, h, cr);
+   });
+   if (mBackdropBlur > 0.0f)
+      drawBackdrop (ctx, body);
    nvgFillColor (ctx, mMouseFocus ? mTheme->mWindowFillFocused
                  : mTheme->mWindowFillUnfocused);
-   nvgFill (ctx);
-   /* Draw a drop shadow */
-   NVGpaint shadowPaint = nvgBoxGradient (
-                             ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), cr * 2, ds * 2,
-                             mTheme->mDropShadow, mTheme->mTransparent);
-   nvgBeginPath (ctx);
-   nvgRect (ctx, mPos.x() - ds, mPos.y() - ds, mSize.x() + 2 * ds, mSize.y() + 2 * ds);
-   nvgRoundedRect (ctx, mPos.x(), mPos.y(), mSize.x(), mSize.y(), cr);
-   nvgPathWinding (ctx, NVG_HOLE);
-   nvgFillPaint (ctx, shadowPaint);
-   nvgFill (ctx);
+   nvgFillGeometry (ctx, body);
+   /* Draw a drop shadow, unless the quality governor of the screen dropped them */
+   Screen * screen = this->screen();
+   if (!screen || screen->quality() < Screen::Quality::NoShadows)
+   {
+      NVGpaint shadowPaint = nvgBoxGradient (
+                                ctx, 0, 0, w, h, cr * 2, ds * 2,
+                                mTheme->mDropShadow, mTheme->mTransparent);
+      nvgFillPaint (ctx, shadowPaint);
+      nvgDrawBoxShadow (ctx, 0, 0, w, h, cr, ds);
+   }
    if (!mTitle.empty())
    {
       /* Draw header */
-      NVGpaint headerPaint = nvgLinearGradient (
-                                ctx, mPos.x(), mPos.y(), mPos.x(),
-                                mPos.y() + hh,
-                                mTheme->mWindowHeaderGradientTop,
-                                mTheme->mWindowHeaderGradientBot);
-      nvgBeginPath (ctx);
-      nvgRoundedRect (ctx, mPos.x(), mPos.y(), mSize.x(), hh, cr);
+      NVGpaint headerPaint = Theme::placePaint (mTheme->mWindowHeaderPaint, 0, 0, hh);
+      NVGgeometry * header = mHeaderGeometry.get (ctx, Vector4f (w, hh, cr, 0), [&]
+      {
+         nvgRoundedRect (ctx, 0, 0, w, hh, cr);
+      });
       nvgFillPaint (ctx, headerPaint);
-      nvgFill (ctx);
-      nvgBeginPath (ctx);
-      nvgRoundedRect (ctx, mPos.x(), mPos.y(), mSize.x(), hh, cr);
+      nvgFillGeometry (ctx, header);
       nvgStrokeColor (ctx, mTheme->mWindowHeaderSepTop);
-      nvgScissor (ctx, mPos.x(), mPos.y(), mSize.x(), 0.5f);
-      nvgStroke (ctx);
-      nvgResetScissor (ctx);
+      nvgSave (ctx);
+      nvgIntersectScissor (ctx, 0, 0, w, 0.5f);
+      nvgStrokeGeometry (ctx, header);
+      nvgRestore (ctx);
       nvgBeginPath (ctx);
-      nvgMoveTo (ctx, mPos.x() + 0.5f, mPos.y() + hh - 1.5f);
-      nvgLineTo (ctx, mPos.x() + mSize.x() - 0.5f, mPos.y() + hh - 1.5);
+      nvgMoveTo (ctx, 0.5f, hh - 1.5f);
+      nvgLineTo (ctx, w - 0.5f, hh - 1.5f);
       nvgStrokeColor (ctx, mTheme->mWindowHeaderSepBot);
       nvgStroke (ctx);
       nvgFontSize (ctx, 18.0f);
-      nvgFontFace (ctx, "sans-bold");
+      nvgFontFaceId (ctx, mTheme->mFontBold.id (ctx));
       nvgTextAlign (ctx, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
       nvgFontBlur (ctx, 2);
       nvgFillColor (ctx, mTheme->mDropShadow);
-      nvgText (ctx, mPos.x() + mSize.x() / 2,
-               mPos.y() + hh / 2, mTitle.c_str(), nullptr);
+      nvgText (ctx, w / 2, hh / 2, mTitle.c_str(), nullptr);
       nvgFontBlur (ctx, 0);
       nvgFillColor (ctx, mFocused ? mTheme->mWindowTitleFocused
                     : mTheme->mWindowTitleUnfocused);
-      nvgText (ctx, mPos.x() + mSize.x() / 2, mPos.y() + hh / 2 - 1,
-               mTitle.c_str(), nullptr);
+      nvgText (ctx, w / 2, hh / 2 - 1, mTitle.c_str(), nullptr);
    }
    nvgRestore (ctx);
    Widget::draw (ctx);
 }
 
+void Window::setBackdropBlur (float radius)
+{
+   radius = std::max (radius, 0.0f);
+   if (radius == mBackdropBlur)
+      return;
+   mBackdropBlur = radius;
+   if (radius == 0.0f && mBackdrop)
+   {
+      nvgDeleteBackdrop (mBackdropContext, mBackdrop);
+      mBackdrop = 0;
+      mBackdropContext = nullptr;
+   }
+   invalidateBackdrop();
+}
+
+void Window::invalidateBackdrop()
+{
+   mBackdropValid = false;
+   markDirty();
+}
+
+void Window::drawBackdrop (NVGcontext * ctx, NVGgeometry * body)
+{
+   if (mBackdropContext != ctx)
+   {
+      if (mBackdrop)
+         nvgDeleteBackdrop (mBackdropContext, mBackdrop);
+      mBackdrop = nvgCreateBackdrop (ctx);
+      mBackdropContext = ctx;
+      mBackdropValid = false;
+   }
+   if (!mBackdrop)
+      return;
+   Vector2f pos = absolutePosition().cast<float>();
+   Vector4f rect (pos.x(), pos.y(), mSize.x(), mSize.y());
+   if (!mBackdropValid || rect != mBackdropRect)
+   {
+      /* Outside of the damaged rectangles the framebuffer still holds the last frame, this window
+         included, so only a repaint of all of it behind the window gives the right pixels */
+      float clip[4];
+      Screen * screen = this->screen();
+      Vector2f view = screen ? screen->size().cast<float>() : Vector2f (1e30f, 1e30f);
+      bool covered = !nvgCurrentClipBounds (ctx, clip) ||
+                     (clip[0] <= std::max (rect[0], 0.0f) && clip[1] <= std::max (rect[1], 0.0f) &&
+                      clip[2] >= std::min (rect[0] + rect[2], view.x()) && clip[3] >= std::min (rect[1] + rect[3], view.y()));
+      if (covered && nvgCaptureBackdrop (ctx, mBackdrop, rect[0], rect[1], rect[2], rect[3], mBackdropBlur))
+      {
+         mBackdropValid = true;
+         mBackdropRect = rect;
+      }
+   }
+   /* A stale backdrop still beats none, as long as it lies where the window is */
+   NVGpaint paint;
+   if (rect != mBackdropRect || !nvgBackdropPattern (ctx, mBackdrop, 1.0f, &paint))
+      return;
+   nvgFillPaint (ctx, paint);
+   nvgFillGeometry (ctx, body);
+}
+
 void Window::dispose()
 {
    Widget * widget = this;
@@ -114,9 +193,17 @@ bool Window::mouseDragEvent (const Vector2i &, const Vector2i & rel,
 {
    if (mDrag && (button & (1 << MOUSE_BUTTON_LEFT)) != 0)
    {
-      mPos += rel;
-      mPos = mPos.cwiseMax (Vector2i::Zero());
-      mPos = mPos.cwiseMin (parent()->size() - mSize);
+      Vector2i pos = (mPos + rel).cwiseMax (Vector2i::Zero());
+      setPosition (pos.cwiseMin (parent()->size() - mSize));
+      /* Popups only follow their parent window while they are redrawn */
+      for (auto child : parent()->children())
+      {
+         if (!child->isPopup())
+            continue;
+         Popup * popup = (Popup *) child;
+         if (popup->parentWindow() == this)
+            ((Window *) popup)->refreshRelativePlacement();
+      }
       return true;
    }
    return false;
@@ -124,11 +211,24 @@ bool Window::mouseDragEvent (const Vector2i &, const Vector2i & rel,
 
 bool Window::mouseButtonEvent (const Vector2i & p, int button, bool down, int modifiers)
 {
+   if (button == MOUSE_BUTTON_LEFT && !down && mDragRetained)
+   {
+      /* The recording was only kept for moving the window */
+      setRetained (false);
+      mDragRetained = false;
+   }
    if (Widget::mouseButtonEvent (p, button, down, modifiers))
       return true;
    if (button == MOUSE_BUTTON_LEFT)
    {
       mDrag = down && (p.y() - mPos.y()) < mTheme->mWindowHeaderHeight;
+      /* While dragged, the window replays one recording moved to its position instead of
+         tessellating its contents again every frame */
+      if (mDrag && !mRetained)
+      {
+         setRetained (true);
+         mDragRetained = true;
+      }
       return true;
    }
    return false;
@@ -12,14 +12,17 @@
 #pragma once
 
 #include "widget.h"
+#include "cachedgeometry.h"
 
 NAMESPACE_BEGIN (nanogui)
 
 class  Window : public Widget
 {
       friend class Popup;
+      friend class Screen;
    public:
       Window (Widget * parent, const std::string & title = "Untitled");
+      ~Window();
 
       /// Return the window title
       const std::string & title() const
@@ -30,6 +33,12 @@ class  Window : public Widget
       void setTitle (const std::string & title)
       {
          mTitle = title;
+         invalidateLayout();
+         searchTextChanged();
+      }
+      virtual const std::string & searchText() const
+      {
+         return mTitle;
       }
 
       /// Is this a model dialog?
@@ -49,8 +58,41 @@ class  Window : public Widget
       /// Center the window in the current \ref Screen
       void center();
 
+      /// Return the stacking order among the windows of the screen, higher is in front
+      uint64_t stackOrder() const
+      {
+         return mStackOrder;
+      }
+      /// Return whether the window hides everything behind its rectangle, short of the rounded corners
+      virtual bool opaque() const;
+
+      /// Return the radius, in window units, the content behind the window is blurred by, 0 for none
+      float backdropBlur() const
+      {
+         return mBackdropBlur;
+      }
+      /**
+         \brief Blur the content behind the window by about \c radius, 0 to turn it off
+
+         Frosted glass for translucent window fills. The pixels behind the window
+         are copied once and blurred at reduced resolution with
+         nvgCaptureBackdrop(), then kept while the window keeps its place and the
+         widgets drawn before it do not change there, so a still window costs a
+         single textured fill per frame. The backdrop is only captured where the
+         frame repainted everything behind the window, and not while the window
+         is recorded or drawn through its layer, which keep the last one.
+      */
+      void setBackdropBlur (float radius);
+      /// Capture the backdrop again next frame, for content the screen does not track, such as visuals drawn under the screen
+      void invalidateBackdrop();
+
       /// Draw the window
       virtual void draw (NVGcontext * ctx);
+      /// The backdrop is captured from the framebuffer of the context drawn with
+      virtual bool threadSafeDraw() const
+      {
+         return mBackdropBlur <= 0.0f;
+      }
 
       /// Handle window drag events
       virtual bool mouseDragEvent (const Vector2i & p, const Vector2i & rel, int button, int modifiers);
@@ -63,10 +105,23 @@ class  Window : public Widget
    protected:
       /// Internal helper function to maintain nested window position values; overridden in \ref Popup
       virtual void refreshRelativePlacement();
+      /// Fill the body with the blurred backdrop, capturing it first if it is stale
+      void drawBackdrop (NVGcontext * ctx, NVGgeometry * body);
    protected:
+      /// Number of windows created or brought to the front so far, the source of \ref mStackOrder
+      static uint64_t sStackOrder;
+
       std::string mTitle;
       bool mModal;
       bool mDrag;
+      bool mDragRetained;	// retained only for the drag in progress
+      uint64_t mStackOrder;
+      CachedGeometry mBodyGeometry, mHeaderGeometry;
+      float mBackdropBlur = 0.0f;
+      NVGcontext * mBackdropContext = nullptr;	// the backdrop was created with
+      int mBackdrop = 0;
+      bool mBackdropValid = false;	// holds the content behind mBackdropRect
+      Vector4f mBackdropRect = Vector4f::Zero();	// view position and size of the window at the last capture
 };
 
 NAMESPACE_END (nanogui)
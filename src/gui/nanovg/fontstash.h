@@ -25,8 +25,29 @@ enum FONSflags
 {
    FONS_ZERO_TOPLEFT = 1,
    FONS_ZERO_BOTTOMLEFT = 2,
+   // Rasterize every glyph once as a signed distance field and scale its quad to the requested
+   // size. The atlas then holds coverage 0.5 + distance / (2 * FONS_SDF_SPREAD) instead of alpha,
+   // and blur is left to the renderer.
+   FONS_DISTANCE_FIELD = 4,
+   // Leave blur to the renderer. Blurred glyphs are rasterized sharp with a margin to blur into,
+   // one copy per size serving every blur up to its margin, and quads cover the margin.
+   FONS_BLUR_IN_RENDERER = 8,
 };
 
+// Size distance field glyphs are rasterized at, and the distance in atlas texels the field spans
+// on either side of the outline.
+#ifndef FONS_SDF_SIZE
+   #define FONS_SDF_SIZE 32
+#endif
+#ifndef FONS_SDF_SPREAD
+   #define FONS_SDF_SPREAD 6
+#endif
+
+// Upper bound on atlas pages, see FONSparams.maxPages.
+#ifndef FONS_MAX_PAGES
+   #define FONS_MAX_PAGES 8
+#endif
+
 enum FONSalign
 {
    // Horizontal align
@@ -56,6 +77,9 @@ struct FONSparams
 {
    int width, height;
    unsigned char flags;
+   // Pages of width x height the atlas may grow to once the first one is full, after which the least
+   // recently used page is evicted. 0 or 1 keeps the single page that raises FONS_ATLAS_FULL.
+   int maxPages;
    void * userPtr;
    int (*renderCreate) (void * uptr, int width, int height);
    int (*renderResize) (void * uptr, int width, int height);
@@ -69,6 +93,7 @@ struct FONSquad
 {
    float x0, y0, s0, t0;
    float x1, y1, s1, t1;
+   int page;
 };
 typedef struct FONSquad FONSquad;
 
@@ -78,10 +103,11 @@ struct FONStextIter
    unsigned int codepoint;
    short isize, iblur;
    struct FONSfont * font;
-   int prevGlyphIndex;
+   int prevGlyphIndex;			// -1 before the first glyph and after missing ones, -2 after fallback glyphs
    const char * str;
    const char * next;
    const char * end;
+   const char * ascii;			// the bytes from next up to here are ASCII
    unsigned int utf8state;
 };
 typedef struct FONStextIter FONStextIter;
@@ -93,6 +119,21 @@ FONScontext * fonsCreateInternal (FONSparams * params);
 void fonsDeleteInternal (FONScontext * s);
 
 void fonsSetErrorCallback (FONScontext * s, void (*callback) (void * uptr, int error, int val), void * uptr);
+// Glyph rasterizers. FONS_RASTER_DEFAULT is stb_truetype, or FreeType with FONS_USE_FREETYPE. The
+// FreeType rasterizers need FONS_WITH_FREETYPE and draw the outlines stb_truetype lays out, so
+// metrics, kerning and layout stay the same whichever is used.
+enum FONSrasterizer
+{
+   FONS_RASTER_DEFAULT = 0,
+   FONS_RASTER_FREETYPE = 1,
+   FONS_RASTER_FREETYPE_HINTED = 2,
+};
+
+// Selects the rasterizer of the glyphs and resets the atlas if it changes. Returns 0 if the
+// rasterizer is not built in.
+int fonsSetRasterizer (FONScontext * s, int rasterizer);
+int fonsGetRasterizer (FONScontext * s);
+
 // Returns current atlas size.
 void fonsGetAtlasSize (FONScontext * s, int * width, int * height);
 // Expands the atlas size.
@@ -100,10 +141,24 @@ int fonsExpandAtlas (FONScontext * s, int width, int height);
 // Resets the whole stash.
 int fonsResetAtlas (FONScontext * stash, int width, int height);
 
-// Add fonts
+// Add fonts. fonsAddFont() maps the file and keeps it mapped while the font lives, the glyphs are
+// then paged in from the file as they are rasterized instead of the whole file being read up front.
 int fonsAddFont (FONScontext * s, const char * name, const char * path);
+// freeData 1 frees data with the font, FONS_FREE_UNMAP releases it with fonsUnmapFile().
 int fonsAddFontMem (FONScontext * s, const char * name, unsigned char * data, int ndata, int freeData);
+#define FONS_FREE_UNMAP 2
+
+// Maps a file into memory read only. Returns NULL for empty files and where it cannot be mapped.
+const unsigned char * fonsMapFile (const char * path, int * size);
+void fonsUnmapFile (const unsigned char * data, int size);
 int fonsGetFontByName (FONScontext * s, const char * name);
+int fonsFontCount (FONScontext * s);
+
+// Fallback fonts, tried in the order added for codepoints the base font has no glyph for. Which
+// font has a codepoint is looked up once and cached per base font, the glyphs that depend on the
+// chain are looked up again when it changes. Returns 0 if the chain is full.
+int fonsAddFallbackFont (FONScontext * s, int base, int fallback);
+void fonsResetFallbackFont (FONScontext * s, int base);
 
 // State handling
 void fonsPushState (FONScontext * s);
@@ -121,7 +176,8 @@ void fonsSetFont (FONScontext * s, int font);
 // Draw text
 float fonsDrawText (FONScontext * s, float x, float y, const char * string, const char * end);
 
-// Measure text
+// Measure text. Bounds come from glyph advances and boxes cached per font and size, measuring
+// neither rasterizes glyphs nor takes atlas space.
 float fonsTextBounds (FONScontext * s, float x, float y, const char * string, const char * end, float * bounds);
 void fonsLineBounds (FONScontext * s, float y, float * miny, float * maxy);
 void fonsVertMetrics (FONScontext * s, float * ascender, float * descender, float * lineh);
@@ -130,13 +186,70 @@ void fonsVertMetrics (FONScontext * s, float * ascender, float * descender, floa
 int fonsTextIterInit (FONScontext * stash, FONStextIter * iter, float x, float y, const char * str, const char * end);
 int fonsTextIterNext (FONScontext * stash, FONStextIter * iter, struct FONSquad * quad);
 
-// Pull texture changes
+// Pull texture changes, these only cover the first page.
 const unsigned char * fonsGetTextureData (FONScontext * stash, int * width, int * height);
 int fonsValidateTexture (FONScontext * s, int * dirty);
 
+// Per page variants of the above for atlases with more than one page.
+int fonsPageCount (FONScontext * s);
+// Bumped every time the page is evicted, quads handed out before then point at stale texels.
+int fonsPageEpoch (FONScontext * s, int page);
+const unsigned char * fonsGetPageData (FONScontext * s, int page, int * width, int * height);
+int fonsValidatePage (FONScontext * s, int page, int * dirty);
+
+// Bytes held by the glyph rasterization scratch and by the pixels and packers of the atlas pages.
+void fonsMemoryUsage (FONScontext * s, int * scratch, int * atlas);
+
 // Draws the stash texture for debugging
 void fonsDrawDebug (FONScontext * s, float x, float y);
 
+// Rasterizes the glyphs of the string with the current font, size and blur ahead of drawing,
+// returns how many of them are in the atlas.
+int fonsPrewarm (FONScontext * s, const char * str, const char * end);
+// Creates an empty stash with the parameters and fonts of another, without render callbacks. The
+// font data is shared and must outlive it. With stb_truetype the two may be used from different
+// threads.
+FONScontext * fonsCreateShared (FONScontext * s);
+// Adds the fonts of from that were created since s was shared from it, under the same handles, and
+// copies the fallback chains. Returns 0 if a font could not be added.
+int fonsShareFonts (FONScontext * s, FONScontext * from);
+
+// Atlas pages and glyph tables as a blob, release it with free(). Loading replaces the atlas and
+// keeps the glyphs of fonts added under the same name with the same data, it fails unless the
+// atlas size, flags and page count fit the stash. Saving fails while glyph jobs are pending.
+unsigned char * fonsSaveAtlasMem (FONScontext * s, int * size);
+int fonsLoadAtlasMem (FONScontext * s, const unsigned char * data, int size);
+int fonsSaveAtlas (FONScontext * s, const char * path);
+int fonsLoadAtlas (FONScontext * s, const char * path);
+
+// A glyph whose rect is reserved in the atlas but not rasterized yet.
+struct FONSglyphJob
+{
+   int font;
+   int glyph;					// glyph index in the font
+   int rasterizer;
+   short size, blur;
+   int page, epoch;
+   int x, y, width, height;	// rect in the page
+   unsigned char * bitmap;		// width x height, filled by fonsRasterizeGlyphJob()
+};
+typedef struct FONSglyphJob FONSglyphJob;
+
+// With async glyphs on, a glyph missing from the atlas gets its metrics and rect right away but
+// is left blank and queued as a job instead of being rasterized.
+void fonsSetAsyncGlyphs (FONScontext * s, int enabled);
+// Moves up to max queued jobs into jobs and returns how many. Every job taken must be handed back
+// to fonsCompleteGlyphJob().
+int fonsTakeGlyphJobs (FONScontext * s, FONSglyphJob * jobs, int max);
+// Rasterizes the bitmap of a job. Meant for a worker thread with its own stash from
+// fonsCreateShared(), returns 0 if it could not.
+int fonsRasterizeGlyphJob (FONScontext * worker, FONSglyphJob * job);
+// Copies the bitmap of a job into its rect and frees it. A job without a bitmap is rasterized in
+// place. Returns 0 for jobs whose page was evicted or reset since.
+int fonsCompleteGlyphJob (FONScontext * s, FONSglyphJob * job);
+// Jobs queued or taken and not completed yet.
+int fonsPendingGlyphJobs (FONScontext * s);
+
 #endif // FONTSTASH_H
 
 
@@ -144,6 +257,26 @@ void fonsDrawDebug (FONScontext * s, float x, float y);
 
 #define FONS_NOTUSED(v)  (void)sizeof(v)
 
+// Runs of ASCII bytes are found sixteen at a time with SSE2 or NEON, define FONS_NO_SIMD to scan a byte at a time.
+#if !defined(FONS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  include <emmintrin.h>
+#  define FONS__SSE2 1
+#elif !defined(FONS_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define FONS__NEON 1
+#endif
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 #ifdef FONS_USE_FREETYPE
 
 #include <ft2build.h>
@@ -304,23 +437,54 @@ int fons__tt_getGlyphKernAdvance (FONSttFontImpl * font, int glyph1, int glyph2)
    return stbtt_GetGlyphKernAdvance (&font->font, glyph1, glyph2);
 }
 
+int fons__tt_hasKerning (FONSttFontImpl * font)
+{
+   return font->font.kern != 0;
+}
+
+#endif
+
+// FreeType as a second rasterizer next to stb_truetype, selected with fonsSetRasterizer().
+#if defined(FONS_WITH_FREETYPE) && !defined(FONS_USE_FREETYPE)
+#define FONS__FT_RASTER
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_GLYPH_H
+#include FT_OUTLINE_H
+#include <math.h>
 #endif
 
 #ifndef FONS_SCRATCH_BUF_SIZE
-   #define FONS_SCRATCH_BUF_SIZE 16000
+   #define FONS_SCRATCH_BUF_SIZE 64000	// holds the rasterizer state of oversampled distance field glyphs
 #endif
-#ifndef FONS_HASH_LUT_SIZE
-   #define FONS_HASH_LUT_SIZE 256
+#ifndef FONS_SDF_OVERSAMPLE
+   #define FONS_SDF_OVERSAMPLE 4
 #endif
+#ifndef FONS_KERN_CACHE_SIZE
+   #define FONS_KERN_CACHE_SIZE 256	// power of two
+#endif
+#define FONS_KERN_FIRST 32
+#define FONS_KERN_LAST 255
+#define FONS_KERN_UNSET -32768
 #ifndef FONS_INIT_FONTS
    #define FONS_INIT_FONTS 4
 #endif
 #ifndef FONS_INIT_GLYPHS
    #define FONS_INIT_GLYPHS 256
 #endif
-#ifndef FONS_INIT_ATLAS_NODES
-   #define FONS_INIT_ATLAS_NODES 256
+#ifndef FONS_OUTLINE_CACHE_SIZE
+   #define FONS_OUTLINE_CACHE_SIZE 256	// power of two
+#endif
+#ifndef FONS_MAX_FALLBACKS
+   #define FONS_MAX_FALLBACKS 20
 #endif
+#ifndef FONS_ASCII_SIZES
+   #define FONS_ASCII_SIZES 4	// sizes and blurs per font with a direct table of their ASCII glyphs
+#endif
+#ifndef FONS_INIT_ATLAS_SHELVES
+   #define FONS_INIT_ATLAS_SHELVES 64
+#endif
+#define FONS_ATLAS_CLASSES 32	// shelf heights, in steps of 4 up to 64 and of 16 above
 #ifndef FONS_VERTEX_COUNT
    #define FONS_VERTEX_COUNT 1024
 #endif
@@ -328,15 +492,18 @@ int fons__tt_getGlyphKernAdvance (FONSttFontImpl * font, int glyph1, int glyph2)
    #define FONS_MAX_STATES 20
 #endif
 
-static unsigned int fons__hashint (unsigned int a)
+// Codepoint in the high, size and blur in the low 32 bits.
+static unsigned long long fons__glyphKey (unsigned int codepoint, short isize, short iblur)
+{
+   return ((unsigned long long)codepoint << 32) | ((unsigned int) (unsigned short)isize << 16) | (unsigned short)iblur;
+}
+
+static unsigned int fons__hashGlyphKey (unsigned long long k)
 {
-   a += ~ (a << 15);
-   a ^=  (a >> 10);
-   a +=  (a << 3);
-   a ^=  (a >> 6);
-   a += ~ (a << 11);
-   a ^=  (a >> 16);
-   return a;
+   k ^= k >> 33;
+   k *= 0xff51afd7ed558ccdULL;
+   k ^= k >> 33;
+   return (unsigned int)k;
 }
 
 static int fons__mini (int a, int b)
@@ -353,13 +520,72 @@ struct FONSglyph
 {
    unsigned int codepoint;
    int index;
-   int next;
    short size, blur;
    short x0, y0, x1, y1;
    short xadv, xoff, yoff;
+   short page;
+   short source;	// fallback font the glyph was rasterized from, -1 for the font's own
 };
 typedef struct FONSglyph FONSglyph;
 
+// Open addressing slot of the glyph map, glyph is -1 for empty slots.
+struct FONSglyphSlot
+{
+   unsigned long long key;
+   int glyph;
+};
+typedef struct FONSglyphSlot FONSglyphSlot;
+
+// Open addressing slot of the codepoint cache, index is -1 for empty slots and 0 for codepoints
+// no font of the chain has.
+struct FONScodepointSlot
+{
+   unsigned int codepoint;
+   int source;
+   int index;
+};
+typedef struct FONScodepointSlot FONScodepointSlot;
+
+// Glyphs of the ASCII codepoints at one size and blur, as index + 1 into the glyphs of the font, 0
+// when not looked up yet. Entries are checked against the glyph they point at, so that glyphs being
+// dropped or moved only cost a lookup in the map.
+struct FONSasciiGlyphs
+{
+   short size, blur;	// size 0 for unused tables
+   int glyphs[128];
+};
+typedef struct FONSasciiGlyphs FONSasciiGlyphs;
+
+// Advance and unpadded box of a glyph at one size, as fons__buildGlyph() gives them, so that text
+// can be measured without rasterizing it or touching the atlas.
+struct FONSmetric
+{
+   unsigned long long key;	// codepoint and size
+   int index;				// glyph index, -1 for empty slots
+   short source;
+   short xadv;
+   short x0, y0, x1, y1;
+};
+typedef struct FONSmetric FONSmetric;
+
+struct FONSkernPair
+{
+   int glyph1, glyph2;
+   int advance;
+};
+typedef struct FONSkernPair FONSkernPair;
+
+#ifdef FONS__FT_RASTER
+// Decoded outline of a glyph, in font units, or hinted at ppem 26.6 pixels per em.
+struct FONSoutline
+{
+   int glyph;
+   int ppem;				// -1 for unhinted outlines
+   FT_Glyph outline;		// NULL for empty slots
+};
+typedef struct FONSoutline FONSoutline;
+#endif
+
 struct FONSfont
 {
    FONSttFontImpl font;
@@ -373,7 +599,28 @@ struct FONSfont
    FONSglyph * glyphs;
    int cglyphs;
    int nglyphs;
-   int lut[FONS_HASH_LUT_SIZE];
+   FONSglyphSlot * map;		// linear probing, at most half full
+   int cmap;
+   int hasKern;
+   unsigned char * kernSlot;	// glyph index -> dense slot + 1, 0 for glyphs outside Latin-1
+   int nkernSlot;
+   short * kernDense;		// nkern x nkern advances of the Latin-1 glyphs, FONS_KERN_UNSET until used
+   int nkern;
+   FONSkernPair kernCache[FONS_KERN_CACHE_SIZE];	// direct mapped, all other pairs
+   int fallbacks[FONS_MAX_FALLBACKS];
+   int nfallbacks;
+   FONScodepointSlot * cpmap;	// codepoint -> font and glyph index, linear probing, at most half full
+   int ccpmap;
+   int ncpmap;
+   FONSasciiGlyphs ascii[FONS_ASCII_SIZES];
+   int nextAscii;			// table replaced when a size without one comes up
+   FONSmetric * metrics;	// codepoint and size -> glyph metrics, linear probing, at most half full
+   int cmetrics;
+   int nmetrics;
+#ifdef FONS__FT_RASTER
+   FT_Face face;			// created on first use of a FreeType rasterizer
+   FONSoutline * outlines;	// direct mapped, FONS_OUTLINE_CACHE_SIZE slots
+#endif
 };
 typedef struct FONSfont FONSfont;
 
@@ -388,29 +635,44 @@ struct FONSstate
 };
 typedef struct FONSstate FONSstate;
 
-struct FONSatlasNode
+// Row of rects of about the same height, filled from the left.
+struct FONSatlasShelf
 {
-   short x, y, width;
+   short y, height;
+   short x;	// where the free part of the shelf starts
 };
-typedef struct FONSatlasNode FONSatlasNode;
+typedef struct FONSatlasShelf FONSatlasShelf;
 
 struct FONSatlas
 {
    int width, height;
-   FONSatlasNode * nodes;
-   int nnodes;
-   int cnodes;
+   FONSatlasShelf * shelves;
+   int nshelves;
+   int cshelves;
+   int top;	// bottom of the lowest shelf, where the next one goes
+   short open[FONS_ATLAS_CLASSES];	// shelf each height class opened last, -1 for none
 };
 typedef struct FONSatlas FONSatlas;
 
+struct FONSpage
+{
+   FONSatlas * atlas;
+   unsigned char * data;
+   int dirtyRect[4];
+   unsigned int lastUse;
+   int epoch;
+};
+typedef struct FONSpage FONSpage;
+
 struct FONScontext
 {
    FONSparams params;
    float itw, ith;
-   unsigned char * texData;
-   int dirtyRect[4];
+   FONSpage pages[FONS_MAX_PAGES];
+   int npages;
+   int page;   // page new glyphs are packed into
+   unsigned int useStamp;
    FONSfont ** fonts;
-   FONSatlas * atlas;
    int cfonts;
    int nfonts;
    float verts[FONS_VERTEX_COUNT * 2];
@@ -423,6 +685,15 @@ struct FONScontext
    int nstates;
    void (*handleError) (void * uptr, int error, int val);
    void * errorUptr;
+   int asyncGlyphs;
+   int rasterizer;
+#ifdef FONS__FT_RASTER
+   FT_Library ftLibrary;	// of this stash only, FreeType objects are not shared between threads
+#endif
+   FONSglyphJob * jobs;		// queued, not taken yet
+   int njobs;
+   int cjobs;
+   int npending;		// queued plus taken
 };
 
 static void * fons__tmpalloc (size_t size, void * up)
@@ -486,199 +757,443 @@ static unsigned int fons__decutf8 (unsigned int * state, unsigned int * codep, u
    return *state;
 }
 
-// Atlas based on Skyline Bin Packer by Jukka Jylänki
+// Shelf packer: rects go left to right onto shelves stacked from the top of the page. Shelf heights
+// are rounded up into classes and each class keeps the shelf it opened last, so that placing a
+// glyph costs a look at one shelf instead of a walk over a skyline that grows with the page. Glyphs
+// of one font and size share a class and pack nearly as tight as on a skyline; only once there is
+// no room left for another shelf are all of them searched for the tightest one the rect fits on.
+
+static int fons__atlasShelfHeight (int h)
+{
+   return h <= 64 ? (h + 3) & ~3 : (h + 15) & ~15;
+}
+
+static int fons__atlasShelfClass (int height)
+{
+   return fons__mini (height <= 64 ? height / 4 : 16 + (height - 64) / 16, FONS_ATLAS_CLASSES - 1);
+}
 
 static void fons__deleteAtlas (FONSatlas * atlas)
 {
    if (atlas == NULL) return;
-   if (atlas->nodes != NULL) free (atlas->nodes);
+   if (atlas->shelves != NULL) free (atlas->shelves);
    free (atlas);
 }
 
-static FONSatlas * fons__allocAtlas (int w, int h, int nnodes)
+static void fons__atlasReset (FONSatlas * atlas, int w, int h)
+{
+   int i;
+   atlas->width = w;
+   atlas->height = h;
+   atlas->nshelves = 0;
+   atlas->top = 0;
+   for (i = 0; i < FONS_ATLAS_CLASSES; i++)
+      atlas->open[i] = -1;
+}
+
+static FONSatlas * fons__allocAtlas (int w, int h, int nshelves)
 {
    FONSatlas * atlas = NULL;
    // Allocate memory for the font stash.
    atlas = (FONSatlas *)malloc (sizeof (FONSatlas));
    if (atlas == NULL) goto error;
    memset (atlas, 0, sizeof (FONSatlas));
-   atlas->width = w;
-   atlas->height = h;
-   // Allocate space for skyline nodes
-   atlas->nodes = (FONSatlasNode *)malloc (sizeof (FONSatlasNode) * nnodes);
-   if (atlas->nodes == NULL) goto error;
-   memset (atlas->nodes, 0, sizeof (FONSatlasNode) * nnodes);
-   atlas->nnodes = 0;
-   atlas->cnodes = nnodes;
-   // Init root node.
-   atlas->nodes[0].x = 0;
-   atlas->nodes[0].y = 0;
-   atlas->nodes[0].width = (short)w;
-   atlas->nnodes++;
+   // Allocate space for shelves
+   atlas->shelves = (FONSatlasShelf *)malloc (sizeof (FONSatlasShelf) * nshelves);
+   if (atlas->shelves == NULL) goto error;
+   atlas->cshelves = nshelves;
+   fons__atlasReset (atlas, w, h);
    return atlas;
 error:
    if (atlas) fons__deleteAtlas (atlas);
    return NULL;
 }
 
-static int fons__atlasInsertNode (FONSatlas * atlas, int idx, int x, int y, int w)
+// Picks the shelf each class left open and the top of the shelves up again, after the shelves
+// were loaded.
+static void fons__atlasRestore (FONSatlas * atlas)
 {
    int i;
-   // Insert node
-   if (atlas->nnodes + 1 > atlas->cnodes)
+   for (i = 0; i < FONS_ATLAS_CLASSES; i++)
+      atlas->open[i] = -1;
+   atlas->top = 0;
+   for (i = 0; i < atlas->nshelves; i++)
    {
-      atlas->cnodes = atlas->cnodes == 0 ? 8 : atlas->cnodes * 2;
-      atlas->nodes = (FONSatlasNode *)realloc (atlas->nodes, sizeof (FONSatlasNode) * atlas->cnodes);
-      if (atlas->nodes == NULL)
-         return 0;
+      FONSatlasShelf * s = &atlas->shelves[i];
+      atlas->open[fons__atlasShelfClass (s->height)] = (short)i;
+      atlas->top = fons__maxi (atlas->top, s->y + s->height);
    }
-   for (i = atlas->nnodes; i > idx; i--)
-      atlas->nodes[i] = atlas->nodes[i - 1];
-   atlas->nodes[idx].x = (short)x;
-   atlas->nodes[idx].y = (short)y;
-   atlas->nodes[idx].width = (short)w;
-   atlas->nnodes++;
-   return 1;
 }
 
-static void fons__atlasRemoveNode (FONSatlas * atlas, int idx)
+static int fons__atlasAddShelf (FONSatlas * atlas, int h)
 {
-   int i;
-   if (atlas->nnodes == 0) return;
-   for (i = idx; i < atlas->nnodes - 1; i++)
-      atlas->nodes[i] = atlas->nodes[i + 1];
-   atlas->nnodes--;
+   FONSatlasShelf * s;
+   if (atlas->nshelves + 1 > atlas->cshelves)
+   {
+      int cshelves = atlas->cshelves == 0 ? 8 : atlas->cshelves * 2;
+      FONSatlasShelf * shelves = (FONSatlasShelf *)realloc (atlas->shelves, sizeof (FONSatlasShelf) * cshelves);
+      if (shelves == NULL)
+         return -1;
+      atlas->shelves = shelves;
+      atlas->cshelves = cshelves;
+   }
+   s = &atlas->shelves[atlas->nshelves];
+   s->x = 0;
+   s->y = (short)atlas->top;
+   s->height = (short)h;
+   atlas->top += h;
+   return atlas->nshelves++;
 }
 
 static void fons__atlasExpand (FONSatlas * atlas, int w, int h)
 {
-   // Insert node for empty space
-   if (w > atlas->width)
-      fons__atlasInsertNode (atlas, atlas->nnodes, atlas->width, 0, w - atlas->width);
-   atlas->width = w;
-   atlas->height = h;
-}
-
-static void fons__atlasReset (FONSatlas * atlas, int w, int h)
-{
+   // Shelves run to the width of the atlas, and new ones go below them, so both just grow.
    atlas->width = w;
    atlas->height = h;
-   atlas->nnodes = 0;
-   // Init root node.
-   atlas->nodes[0].x = 0;
-   atlas->nodes[0].y = 0;
-   atlas->nodes[0].width = (short)w;
-   atlas->nnodes++;
 }
 
-static int fons__atlasAddSkylineLevel (FONSatlas * atlas, int idx, int x, int y, int w, int h)
+static int fons__atlasAddRect (FONSatlas * atlas, int rw, int rh, int * rx, int * ry)
 {
-   int i;
-   // Insert new node
-   if (fons__atlasInsertNode (atlas, idx, x, y + h, w) == 0)
+   int height = fons__atlasShelfHeight (rh), c = fons__atlasShelfClass (height), i = atlas->open[c], best = -1;
+   FONSatlasShelf * s;
+   if (rw > atlas->width)
       return 0;
-   // Delete skyline segments that fall under the shadow of the new segment.
-   for (i = idx + 1; i < atlas->nnodes; i++)
+   if (i >= 0 && atlas->shelves[i].height >= rh && atlas->shelves[i].x + rw <= atlas->width)
+      best = i;
+   else if (atlas->top + rh <= atlas->height)
    {
-      if (atlas->nodes[i].x < atlas->nodes[i - 1].x + atlas->nodes[i - 1].width)
-      {
-         int shrink = atlas->nodes[i - 1].x + atlas->nodes[i - 1].width - atlas->nodes[i].x;
-         atlas->nodes[i].x += (short)shrink;
-         atlas->nodes[i].width -= (short)shrink;
-         if (atlas->nodes[i].width <= 0)
-         {
-            fons__atlasRemoveNode (atlas, i);
-            i--;
-         }
-         else
-            break;
-      }
-      else
-         break;
+      // The last shelf of a page may be shorter than its class.
+      best = fons__atlasAddShelf (atlas, fons__mini (height, atlas->height - atlas->top));
+      if (best == -1)
+         return 0;
+      atlas->open[c] = (short)best;
    }
-   // Merge same height skyline segments that are next to each other.
-   for (i = 0; i < atlas->nnodes - 1; i++)
+   else
    {
-      if (atlas->nodes[i].y == atlas->nodes[i + 1].y)
+      for (i = 0; i < atlas->nshelves; i++)
       {
-         atlas->nodes[i].width += atlas->nodes[i + 1].width;
-         fons__atlasRemoveNode (atlas, i + 1);
-         i--;
+         s = &atlas->shelves[i];
+         if (s->height >= rh && s->x + rw <= atlas->width && (best == -1 || s->height < atlas->shelves[best].height))
+            best = i;
       }
+      if (best == -1)
+         return 0;
    }
+   s = &atlas->shelves[best];
+   *rx = s->x;
+   *ry = s->y;
+   s->x += (short)rw;
    return 1;
 }
 
-static int fons__atlasRectFits (FONSatlas * atlas, int i, int w, int h)
+static void fons__resetDirty (FONScontext * stash, FONSpage * page)
 {
-   // Checks if there is enough space at the location of skyline span 'i',
-   // and return the max height of all skyline spans under that at that location,
-   // (think tetris block being dropped at that position). Or -1 if no space found.
-   int x = atlas->nodes[i].x;
-   int y = atlas->nodes[i].y;
-   int spaceLeft;
-   if (x + w > atlas->width)
-      return -1;
-   spaceLeft = w;
-   while (spaceLeft > 0)
-   {
-      if (i == atlas->nnodes) return -1;
-      y = fons__maxi (y, atlas->nodes[i].y);
-      if (y + h > atlas->height) return -1;
-      spaceLeft -= atlas->nodes[i].width;
-      ++i;
-   }
-   return y;
+   page->dirtyRect[0] = stash->params.width;
+   page->dirtyRect[1] = stash->params.height;
+   page->dirtyRect[2] = 0;
+   page->dirtyRect[3] = 0;
 }
 
-static int fons__atlasAddRect (FONSatlas * atlas, int rw, int rh, int * rx, int * ry)
+static void fons__addDirty (FONSpage * page, int x0, int y0, int x1, int y1)
 {
-   int besth = atlas->height, bestw = atlas->width, besti = -1;
-   int bestx = -1, besty = -1, i;
-   // Bottom left fit heuristic.
-   for (i = 0; i < atlas->nnodes; i++)
-   {
-      int y = fons__atlasRectFits (atlas, i, rw, rh);
-      if (y != -1)
-      {
-         if (y + rh < besth || (y + rh == besth && atlas->nodes[i].width < bestw))
-         {
-            besti = i;
-            bestw = atlas->nodes[i].width;
-            besth = y + rh;
-            bestx = atlas->nodes[i].x;
-            besty = y;
-         }
-      }
-   }
-   if (besti == -1)
-      return 0;
-   // Perform the actual packing.
-   if (fons__atlasAddSkylineLevel (atlas, besti, bestx, besty, rw, rh) == 0)
-      return 0;
-   *rx = bestx;
-   *ry = besty;
-   return 1;
+   page->dirtyRect[0] = fons__mini (page->dirtyRect[0], x0);
+   page->dirtyRect[1] = fons__mini (page->dirtyRect[1], y0);
+   page->dirtyRect[2] = fons__maxi (page->dirtyRect[2], x1);
+   page->dirtyRect[3] = fons__maxi (page->dirtyRect[3], y1);
 }
 
-static void fons__addWhiteRect (FONScontext * stash, int w, int h)
+static void fons__addWhiteRect (FONScontext * stash, FONSpage * page, int w, int h)
 {
    int x, y, gx, gy;
    unsigned char * dst;
-   if (fons__atlasAddRect (stash->atlas, w, h, &gx, &gy) == 0)
+   if (fons__atlasAddRect (page->atlas, w, h, &gx, &gy) == 0)
       return;
    // Rasterize
-   dst = &stash->texData[gx + gy * stash->params.width];
+   dst = &page->data[gx + gy * stash->params.width];
    for (y = 0; y < h; y++)
    {
       for (x = 0; x < w; x++)
          dst[x] = 0xff;
       dst += stash->params.width;
    }
-   stash->dirtyRect[0] = fons__mini (stash->dirtyRect[0], gx);
-   stash->dirtyRect[1] = fons__mini (stash->dirtyRect[1], gy);
-   stash->dirtyRect[2] = fons__maxi (stash->dirtyRect[2], gx + w);
-   stash->dirtyRect[3] = fons__maxi (stash->dirtyRect[3], gy + h);
+   fons__addDirty (page, gx, gy, gx + w, gy + h);
+}
+
+// Clears a page for reuse, allocating it on first use.
+static int fons__initPage (FONScontext * stash, FONSpage * page)
+{
+   int size = stash->params.width * stash->params.height;
+   unsigned char * data;
+   if (page->atlas == NULL)
+      page->atlas = fons__allocAtlas (stash->params.width, stash->params.height, FONS_INIT_ATLAS_SHELVES);
+   else
+      fons__atlasReset (page->atlas, stash->params.width, stash->params.height);
+   if (page->atlas == NULL) return 0;
+   data = (unsigned char *)realloc (page->data, size);
+   if (data == NULL) return 0;
+   page->data = data;
+   memset (page->data, 0, size);
+   fons__resetDirty (stash, page);
+   page->lastUse = stash->useStamp;
+   page->epoch++;
+   // Add white rect at 0,0 for debug drawing.
+   fons__addWhiteRect (stash, page, 2, 2);
+   return 1;
+}
+
+static void fons__freePage (FONSpage * page)
+{
+   if (page->atlas) fons__deleteAtlas (page->atlas);
+   if (page->data) free (page->data);
+   page->atlas = NULL;
+   page->data = NULL;
+}
+
+static void fons__nextUse (FONScontext * stash)
+{
+   int i;
+   if (++stash->useStamp != 0)
+      return;
+   for (i = 0; i < stash->npages; i++)
+      stash->pages[i].lastUse = 0;
+   stash->useStamp = 1;
+}
+
+static void fons__mapGlyph (FONSfont * font, int i)
+{
+   const FONSglyph * glyph = &font->glyphs[i];
+   unsigned long long key = fons__glyphKey (glyph->codepoint, glyph->size, glyph->blur);
+   unsigned int mask = (unsigned int)font->cmap - 1;
+   unsigned int h = fons__hashGlyphKey (key) & mask;
+   while (font->map[h].glyph != -1)
+      h = (h + 1) & mask;
+   font->map[h].key = key;
+   font->map[h].glyph = i;
+}
+
+// Maps all glyphs into a new table of cmap slots, cmap is a power of two.
+static int fons__resizeGlyphMap (FONSfont * font, int cmap)
+{
+   int i;
+   FONSglyphSlot * map = (FONSglyphSlot *)malloc (sizeof (FONSglyphSlot) * cmap);
+   if (map == NULL) return 0;
+   for (i = 0; i < cmap; i++)
+      map[i].glyph = -1;
+   free (font->map);
+   font->map = map;
+   font->cmap = cmap;
+   for (i = 0; i < font->nglyphs; i++)
+      fons__mapGlyph (font, i);
+   return 1;
+}
+
+static int fons__rebuildGlyphMap (FONSfont * font)
+{
+   int cmap = font->cmap;
+   while (font->nglyphs * 2 > cmap)
+      cmap *= 2;
+   return fons__resizeGlyphMap (font, cmap);
+}
+
+// Maps the glyph allocated last, growing the table to keep it at most half full.
+static int fons__addGlyphToMap (FONSfont * font)
+{
+   if (font->nglyphs * 2 > font->cmap)
+      return fons__resizeGlyphMap (font, font->cmap * 2);
+   fons__mapGlyph (font, font->nglyphs - 1);
+   return 1;
+}
+
+static void fons__clearCodepointMap (FONSfont * font)
+{
+   int i;
+   for (i = 0; i < font->ccpmap; i++)
+      font->cpmap[i].index = -1;
+   font->ncpmap = 0;
+}
+
+static void fons__putCodepoint (FONScodepointSlot * map, int cmap, unsigned int codepoint, int source, int index)
+{
+   unsigned int mask = (unsigned int)cmap - 1;
+   unsigned int h = fons__hashGlyphKey (codepoint) & mask;
+   while (map[h].index != -1)
+      h = (h + 1) & mask;
+   map[h].codepoint = codepoint;
+   map[h].source = source;
+   map[h].index = index;
+}
+
+// Caches where a codepoint was found, growing the table to keep it at most half full. Failing to
+// grow only costs the lookup next time.
+static void fons__addCodepoint (FONSfont * font, unsigned int codepoint, int source, int index)
+{
+   int i;
+   if ((font->ncpmap + 1) * 2 > font->ccpmap)
+   {
+      int cmap = font->ccpmap == 0 ? 64 : font->ccpmap * 2;
+      FONScodepointSlot * map = (FONScodepointSlot *)malloc (sizeof (FONScodepointSlot) * cmap);
+      if (map == NULL) return;
+      for (i = 0; i < cmap; i++)
+         map[i].index = -1;
+      for (i = 0; i < font->ccpmap; i++)
+         if (font->cpmap[i].index != -1)
+            fons__putCodepoint (map, cmap, font->cpmap[i].codepoint, font->cpmap[i].source, font->cpmap[i].index);
+      free (font->cpmap);
+      font->cpmap = map;
+      font->ccpmap = cmap;
+   }
+   fons__putCodepoint (font->cpmap, font->ccpmap, codepoint, source, index);
+   font->ncpmap++;
+}
+
+static void fons__clearMetrics (FONSfont * font)
+{
+   int i;
+   for (i = 0; i < font->cmetrics; i++)
+      font->metrics[i].index = -1;
+   font->nmetrics = 0;
+}
+
+static FONSmetric * fons__putMetric (FONSmetric * map, int cmap, unsigned long long key)
+{
+   unsigned int mask = (unsigned int)cmap - 1;
+   unsigned int h = fons__hashGlyphKey (key) & mask;
+   while (map[h].index != -1)
+      h = (h + 1) & mask;
+   map[h].key = key;
+   return &map[h];
+}
+
+// Sets up the kerning caches. The Latin-1 pairs get a dense table filled on first use,
+// everything else shares a small direct mapped cache.
+static void fons__initKerning (FONSfont * font)
+{
+   int i, g, n = 0, maxGlyph = -1;
+   int glyphs[FONS_KERN_LAST - FONS_KERN_FIRST + 1];
+   for (i = 0; i < FONS_KERN_CACHE_SIZE; i++)
+      font->kernCache[i].glyph1 = -1;
+   font->hasKern = 1;
+#ifndef FONS_USE_FREETYPE
+   font->hasKern = fons__tt_hasKerning (&font->font);
+   if (!font->hasKern) return;
+   for (i = FONS_KERN_FIRST; i <= FONS_KERN_LAST; i++)
+   {
+      g = fons__tt_getGlyphIndex (&font->font, i);
+      glyphs[i - FONS_KERN_FIRST] = g;
+      if (g > maxGlyph) maxGlyph = g;
+   }
+   if (maxGlyph <= 0) return;
+   font->kernSlot = (unsigned char *)calloc (maxGlyph + 1, 1);
+   if (font->kernSlot == NULL) return;
+   for (i = 0; i <= FONS_KERN_LAST - FONS_KERN_FIRST; i++)
+   {
+      g = glyphs[i];
+      if (g > 0 && font->kernSlot[g] == 0)
+         font->kernSlot[g] = (unsigned char)++n;
+   }
+   font->kernDense = (short *)malloc (sizeof (short) * n * n);
+   if (font->kernDense == NULL)
+   {
+      free (font->kernSlot);
+      font->kernSlot = NULL;
+      return;
+   }
+   for (i = 0; i < n * n; i++)
+      font->kernDense[i] = FONS_KERN_UNSET;
+   font->nkern = n;
+   font->nkernSlot = maxGlyph + 1;
+#else
+   FONS_NOTUSED (g);
+   FONS_NOTUSED (n);
+   FONS_NOTUSED (maxGlyph);
+   FONS_NOTUSED (glyphs);
+#endif
+}
+
+static int fons__getKernAdvance (FONSfont * font, int glyph1, int glyph2)
+{
+   int s1, s2, adv;
+   FONSkernPair * pair;
+   if (!font->hasKern) return 0;
+#ifdef FONS_USE_FREETYPE
+   // FreeType scales kerning to the face's current size, so pairs can not be cached.
+   return fons__tt_getGlyphKernAdvance (&font->font, glyph1, glyph2);
+#else
+   if (glyph1 < font->nkernSlot && glyph2 < font->nkernSlot)
+   {
+      s1 = font->kernSlot[glyph1];
+      s2 = font->kernSlot[glyph2];
+      if (s1 != 0 && s2 != 0)
+      {
+         short * dense = &font->kernDense[ (s1 - 1) * font->nkern + s2 - 1];
+         if (*dense != FONS_KERN_UNSET)
+            return *dense;
+         adv = fons__tt_getGlyphKernAdvance (&font->font, glyph1, glyph2);
+         if (adv > FONS_KERN_UNSET && adv < 32768)
+            *dense = (short)adv;
+         return adv;
+      }
+   }
+   pair = &font->kernCache[fons__hashGlyphKey ( ((unsigned long long)glyph1 << 32) | (unsigned int)glyph2) & (FONS_KERN_CACHE_SIZE - 1)];
+   if (pair->glyph1 != glyph1 || pair->glyph2 != glyph2)
+   {
+      pair->glyph1 = glyph1;
+      pair->glyph2 = glyph2;
+      pair->advance = fons__tt_getGlyphKernAdvance (&font->font, glyph1, glyph2);
+   }
+   return pair->advance;
+#endif
+}
+
+// Forgets every glyph packed into the page, the others keep their slots.
+static void fons__dropPageGlyphs (FONScontext * stash, int page)
+{
+   int i, j, n;
+   for (i = 0; i < stash->nfonts; i++)
+   {
+      FONSfont * font = stash->fonts[i];
+      n = 0;
+      for (j = 0; j < font->nglyphs; j++)
+      {
+         if (font->glyphs[j].page != page)
+            font->glyphs[n++] = font->glyphs[j];
+      }
+      font->nglyphs = n;
+      fons__rebuildGlyphMap (font);
+   }
+}
+
+// Moves packing to a fresh page once the current one is full: a new page while there is room for
+// one, otherwise the least recently used page, preferring one whose changes were already pulled.
+static int fons__nextPage (FONScontext * stash)
+{
+   int i, dirty, victim = -1, victimDirty = 0, limit = fons__mini (stash->params.maxPages, FONS_MAX_PAGES);
+   if (stash->npages < limit)
+   {
+      if (!fons__initPage (stash, &stash->pages[stash->npages]))
+         return 0;
+      stash->page = stash->npages++;
+      return 1;
+   }
+   for (i = 0; i < stash->npages; i++)
+   {
+      FONSpage * page = &stash->pages[i];
+      if (i == stash->page)
+         continue;
+      dirty = page->dirtyRect[0] < page->dirtyRect[2] && page->dirtyRect[1] < page->dirtyRect[3];
+      if (victim == -1 || dirty < victimDirty || (dirty == victimDirty && page->lastUse < stash->pages[victim].lastUse))
+      {
+         victim = i;
+         victimDirty = dirty;
+      }
+   }
+   if (victim == -1)
+      return 0;
+   fons__dropPageGlyphs (stash, victim);
+   if (!fons__initPage (stash, &stash->pages[victim]))
+      return 0;
+   stash->page = victim;
+   return 1;
 }
 
 FONScontext * fonsCreateInternal (FONSparams * params)
@@ -699,8 +1214,6 @@ FONScontext * fonsCreateInternal (FONSparams * params)
       if (stash->params.renderCreate (stash->params.userPtr, stash->params.width, stash->params.height) == 0)
          goto error;
    }
-   stash->atlas = fons__allocAtlas (stash->params.width, stash->params.height, FONS_INIT_ATLAS_NODES);
-   if (stash->atlas == NULL) goto error;
    // Allocate space for fonts.
    stash->fonts = (FONSfont **)malloc (sizeof (FONSfont *) * FONS_INIT_FONTS);
    if (stash->fonts == NULL) goto error;
@@ -710,15 +1223,8 @@ FONScontext * fonsCreateInternal (FONSparams * params)
    // Create texture for the cache.
    stash->itw = 1.0f / stash->params.width;
    stash->ith = 1.0f / stash->params.height;
-   stash->texData = (unsigned char *)malloc (stash->params.width * stash->params.height);
-   if (stash->texData == NULL) goto error;
-   memset (stash->texData, 0, stash->params.width * stash->params.height);
-   stash->dirtyRect[0] = stash->params.width;
-   stash->dirtyRect[1] = stash->params.height;
-   stash->dirtyRect[2] = 0;
-   stash->dirtyRect[3] = 0;
-   // Add white rect at 0,0 for debug drawing.
-   fons__addWhiteRect (stash, 2, 2);
+   if (!fons__initPage (stash, &stash->pages[0])) goto error;
+   stash->npages = 1;
    fonsPushState (stash);
    fonsClearState (stash);
    return stash;
@@ -797,48 +1303,256 @@ void fonsClearState (FONScontext * stash)
    state->align = FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE;
 }
 
-static void fons__freeFont (FONSfont * font)
+#ifdef FONS__FT_RASTER
+
+static FT_Face fons__ftFace (FONScontext * stash, FONSfont * font)
 {
-   if (font == NULL) return;
-   if (font->glyphs) free (font->glyphs);
-   if (font->freeData && font->data) free (font->data);
-   free (font);
+   if (font->face != NULL) return font->face;
+   if (stash->ftLibrary == NULL && FT_Init_FreeType (&stash->ftLibrary) != 0)
+   {
+      stash->ftLibrary = NULL;
+      return NULL;
+   }
+   if (FT_New_Memory_Face (stash->ftLibrary, (const FT_Byte *)font->data, font->dataSize, 0, &font->face) != 0)
+      font->face = NULL;
+   return font->face;
+}
+
+// Returns the outline of glyph g from the cache, decoding it on a miss. Unhinted outlines are kept
+// in font units and serve every size, hinted ones are loaded at the pixels per em of scale.
+static FT_OutlineGlyph fons__ftOutline (FONScontext * stash, FONSfont * font, int g, float scale)
+{
+   int i, ppem = -1;
+   FT_Int32 flags = FT_LOAD_NO_SCALE;
+   FT_Face face = fons__ftFace (stash, font);
+   FONSoutline * slot;
+   FT_Glyph outline;
+   if (face == NULL) return NULL;
+   if (font->outlines == NULL)
+   {
+      font->outlines = (FONSoutline *)malloc (sizeof (FONSoutline) * FONS_OUTLINE_CACHE_SIZE);
+      if (font->outlines == NULL) return NULL;
+      for (i = 0; i < FONS_OUTLINE_CACHE_SIZE; i++)
+         font->outlines[i].outline = NULL;
+   }
+   if (stash->rasterizer == FONS_RASTER_FREETYPE_HINTED)
+   {
+      ppem = (int) (scale * face->units_per_EM * 64.0f + 0.5f);
+      flags = FT_LOAD_NO_BITMAP | FT_LOAD_TARGET_LIGHT;
+   }
+   slot = &font->outlines[fons__hashGlyphKey ( ((unsigned long long)g << 32) | (unsigned int)ppem) & (FONS_OUTLINE_CACHE_SIZE - 1)];
+   if (slot->outline != NULL && slot->glyph == g && slot->ppem == ppem)
+      return (FT_OutlineGlyph)slot->outline;
+   if (ppem != -1 && FT_Set_Char_Size (face, 0, ppem, 0, 0) != 0) return NULL;
+   if (FT_Load_Glyph (face, g, flags) != 0 || face->glyph->format != FT_GLYPH_FORMAT_OUTLINE) return NULL;
+   if (FT_Get_Glyph (face->glyph, &outline) != 0) return NULL;
+   if (slot->outline != NULL) FT_Done_Glyph (slot->outline);
+   slot->glyph = g;
+   slot->ppem = ppem;
+   slot->outline = outline;
+   return (FT_OutlineGlyph)outline;
+}
+
+// Pixel box of the outline at scale, rounded out like stb_truetype's, y down.
+static FT_OutlineGlyph fons__ftGlyphBox (FONScontext * stash, FONSfont * font, int g, float scale,
+                                         int * x0, int * y0, int * x1, int * y1)
+{
+   FT_BBox box;
+   float k = stash->rasterizer == FONS_RASTER_FREETYPE_HINTED ? 1.0f / 64.0f : scale;
+   FT_OutlineGlyph glyph = fons__ftOutline (stash, font, g, scale);
+   if (glyph == NULL) return NULL;
+   FT_Outline_Get_CBox (&glyph->outline, &box);
+   *x0 = (int)floorf (box.xMin * k);
+   *y0 = (int)floorf (-box.yMax * k);
+   *x1 = (int)ceilf (box.xMax * k);
+   *y1 = (int)ceilf (-box.yMin * k);
+   return glyph;
 }
 
-static int fons__allocFont (FONScontext * stash)
+// Renders the outline into the box fons__ftGlyphBox() gives, on top of what is in output.
+static int fons__ftRenderGlyph (FONScontext * stash, FONSfont * font, unsigned char * output, int outWidth,
+                                int outHeight, int outStride, float scale, int g)
 {
-   FONSfont * font = NULL;
-   if (stash->nfonts + 1 > stash->cfonts)
+   int x0, y0, x1, y1;
+   FT_Outline outline;
+   FT_Bitmap bitmap;
+   FT_OutlineGlyph glyph = fons__ftGlyphBox (stash, font, g, scale, &x0, &y0, &x1, &y1);
+   if (glyph == NULL) return 0;
+   if (FT_Outline_New (stash->ftLibrary, glyph->outline.n_points, glyph->outline.n_contours, &outline) != 0) return 0;
+   FT_Outline_Copy (&glyph->outline, &outline);
+   if (stash->rasterizer != FONS_RASTER_FREETYPE_HINTED)
    {
-      stash->cfonts = stash->cfonts == 0 ? 8 : stash->cfonts * 2;
-      stash->fonts = (FONSfont **)realloc (stash->fonts, sizeof (FONSfont *) * stash->cfonts);
-      if (stash->fonts == NULL)
-         return -1;
+      FT_Matrix m;
+      m.xx = m.yy = (FT_Fixed) (scale * 64.0f * 65536.0f);
+      m.xy = m.yx = 0;
+      FT_Outline_Transform (&outline, &m);
    }
-   font = (FONSfont *)malloc (sizeof (FONSfont));
-   if (font == NULL) goto error;
-   memset (font, 0, sizeof (FONSfont));
-   font->glyphs = (FONSglyph *)malloc (sizeof (FONSglyph) * FONS_INIT_GLYPHS);
-   if (font->glyphs == NULL) goto error;
-   font->cglyphs = FONS_INIT_GLYPHS;
-   font->nglyphs = 0;
-   stash->fonts[stash->nfonts++] = font;
-   return stash->nfonts - 1;
-error:
-   fons__freeFont (font);
-   return FONS_INVALID;
+   // Bottom left of the box to the origin, rows run top down.
+   FT_Outline_Translate (&outline, -x0 * 64, y1 * 64);
+   memset (&bitmap, 0, sizeof (bitmap));
+   bitmap.rows = outHeight;
+   bitmap.width = outWidth;
+   bitmap.pitch = outStride;
+   bitmap.buffer = output;
+   bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+   bitmap.num_grays = 256;
+   FT_Outline_Get_Bitmap (stash->ftLibrary, &outline, &bitmap);
+   FT_Outline_Done (stash->ftLibrary, &outline);
+   return 1;
 }
 
-int fonsAddFont (FONScontext * stash, const char * name, const char * path)
+static void fons__ftFreeFont (FONSfont * font)
 {
-   FILE * fp = 0;
-   int dataSize = 0;
-   unsigned char * data = NULL;
-   // Read in the font data.
-   fp = fopen (path, "rb");
-   if (fp == NULL) goto error;
-   fseek (fp, 0, SEEK_END);
-   dataSize = (int)ftell (fp);
+   int i;
+   if (font->outlines)
+   {
+      for (i = 0; i < FONS_OUTLINE_CACHE_SIZE; i++)
+         if (font->outlines[i].outline != NULL)
+            FT_Done_Glyph (font->outlines[i].outline);
+      free (font->outlines);
+   }
+   if (font->face) FT_Done_Face (font->face);
+}
+
+#endif
+
+// Metrics and pixel box of glyph g. The box comes from the selected rasterizer, the metrics always
+// from the font backend.
+static int fons__buildGlyph (FONScontext * stash, FONSfont * font, int g, float size, float scale,
+                             int * advance, int * lsb, int * x0, int * y0, int * x1, int * y1)
+{
+   if (!fons__tt_buildGlyphBitmap (&font->font, g, size, scale, advance, lsb, x0, y0, x1, y1))
+      return 0;
+#ifdef FONS__FT_RASTER
+   if (stash->rasterizer != FONS_RASTER_DEFAULT)
+   {
+      int bx0, by0, bx1, by1;
+      if (fons__ftGlyphBox (stash, font, g, scale, &bx0, &by0, &bx1, &by1) != NULL)
+      {
+         *x0 = bx0;
+         *y0 = by0;
+         *x1 = bx1;
+         *y1 = by1;
+      }
+   }
+#else
+   FONS_NOTUSED (stash);
+#endif
+   return 1;
+}
+
+// Renders glyph g at scale into the box fons__buildGlyph() gave for it, output has to be cleared.
+static void fons__renderGlyph (FONScontext * stash, FONSfont * font, unsigned char * output, int outWidth,
+                               int outHeight, int outStride, float scale, int g)
+{
+#ifdef FONS__FT_RASTER
+   if (stash->rasterizer != FONS_RASTER_DEFAULT &&
+       fons__ftRenderGlyph (stash, font, output, outWidth, outHeight, outStride, scale, g))
+      return;
+#else
+   FONS_NOTUSED (stash);
+#endif
+   fons__tt_renderGlyphBitmap (&font->font, output, outWidth, outHeight, outStride, scale, scale, g);
+}
+
+static void fons__freeFont (FONSfont * font)
+{
+   if (font == NULL) return;
+#ifdef FONS__FT_RASTER
+   fons__ftFreeFont (font);
+#endif
+   if (font->glyphs) free (font->glyphs);
+   if (font->map) free (font->map);
+   if (font->kernSlot) free (font->kernSlot);
+   if (font->kernDense) free (font->kernDense);
+   if (font->cpmap) free (font->cpmap);
+   if (font->metrics) free (font->metrics);
+   if (font->freeData == FONS_FREE_UNMAP && font->data) fonsUnmapFile (font->data, font->dataSize);
+   else
+   if (font->freeData && font->data) free (font->data);
+   free (font);
+}
+
+const unsigned char * fonsMapFile (const char * path, int * size)
+{
+#ifdef _WIN32
+   HANDLE file = CreateFileA (path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   HANDLE mapping = NULL;
+   LARGE_INTEGER length;
+   const unsigned char * data = NULL;
+   if (file == INVALID_HANDLE_VALUE) return NULL;
+   if (GetFileSizeEx (file, &length) && length.QuadPart > 0 && length.QuadPart <= 0x7fffffff)
+      mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+   CloseHandle (file);
+   if (mapping == NULL) return NULL;
+   // The view keeps the mapping alive.
+   data = (const unsigned char *)MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+   CloseHandle (mapping);
+   if (data != NULL) *size = (int)length.QuadPart;
+   return data;
+#else
+   struct stat info;
+   void * mapping = MAP_FAILED;
+   int fd = open (path, O_RDONLY);
+   if (fd < 0) return NULL;
+   if (fstat (fd, &info) == 0 && S_ISREG (info.st_mode) && info.st_size > 0 && info.st_size <= 0x7fffffff)
+      mapping = mmap (NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close (fd);
+   if (mapping == MAP_FAILED) return NULL;
+   *size = (int)info.st_size;
+   return (const unsigned char *)mapping;
+#endif
+}
+
+void fonsUnmapFile (const unsigned char * data, int size)
+{
+   if (data == NULL) return;
+#ifdef _WIN32
+   FONS_NOTUSED (size);
+   UnmapViewOfFile (data);
+#else
+   munmap ((void *)data, (size_t)size);
+#endif
+}
+
+static int fons__allocFont (FONScontext * stash)
+{
+   FONSfont * font = NULL;
+   if (stash->nfonts + 1 > stash->cfonts)
+   {
+      stash->cfonts = stash->cfonts == 0 ? 8 : stash->cfonts * 2;
+      stash->fonts = (FONSfont **)realloc (stash->fonts, sizeof (FONSfont *) * stash->cfonts);
+      if (stash->fonts == NULL)
+         return -1;
+   }
+   font = (FONSfont *)malloc (sizeof (FONSfont));
+   if (font == NULL) goto error;
+   memset (font, 0, sizeof (FONSfont));
+   font->glyphs = (FONSglyph *)malloc (sizeof (FONSglyph) * FONS_INIT_GLYPHS);
+   if (font->glyphs == NULL) goto error;
+   font->cglyphs = FONS_INIT_GLYPHS;
+   font->nglyphs = 0;
+   if (!fons__resizeGlyphMap (font, FONS_INIT_GLYPHS * 2)) goto error;
+   stash->fonts[stash->nfonts++] = font;
+   return stash->nfonts - 1;
+error:
+   fons__freeFont (font);
+   return FONS_INVALID;
+}
+
+int fonsAddFont (FONScontext * stash, const char * name, const char * path)
+{
+   FILE * fp = 0;
+   int dataSize = 0;
+   unsigned char * data = NULL;
+   const unsigned char * mapped = fonsMapFile (path, &dataSize);
+   if (mapped != NULL)
+      return fonsAddFontMem (stash, name, (unsigned char *)mapped, dataSize, FONS_FREE_UNMAP);
+   // Read in the font data where the file cannot be mapped.
+   fp = fopen (path, "rb");
+   if (fp == NULL) goto error;
+   fseek (fp, 0, SEEK_END);
+   dataSize = (int)ftell (fp);
    fseek (fp, 0, SEEK_SET);
    data = (unsigned char *)malloc (dataSize);
    if (data == NULL) goto error;
@@ -854,7 +1568,7 @@ error:
 
 int fonsAddFontMem (FONScontext * stash, const char * name, unsigned char * data, int dataSize, int freeData)
 {
-   int i, ascent, descent, fh, lineGap;
+   int ascent, descent, fh, lineGap;
    FONSfont * font;
    int idx = fons__allocFont (stash);
    if (idx == FONS_INVALID)
@@ -862,9 +1576,6 @@ int fonsAddFontMem (FONScontext * stash, const char * name, unsigned char * data
    font = stash->fonts[idx];
    strncpy (font->name, name, sizeof (font->name));
    font->name[sizeof (font->name) - 1] = '\0';
-   // Init hash lookup.
-   for (i = 0; i < FONS_HASH_LUT_SIZE; ++i)
-      font->lut[i] = -1;
    // Read in the font data.
    font->dataSize = dataSize;
    font->data = data;
@@ -872,6 +1583,7 @@ int fonsAddFontMem (FONScontext * stash, const char * name, unsigned char * data
    // Init font
    stash->nscratch = 0;
    if (!fons__tt_loadFont (stash, &font->font, data, dataSize)) goto error;
+   fons__initKerning (font);
    // Store normalized line height. The real line height is got
    // by multiplying the lineh by font size.
    fons__tt_getFontVMetrics ( &font->font, &ascent, &descent, &lineGap);
@@ -897,14 +1609,62 @@ int fonsGetFontByName (FONScontext * s, const char * name)
    return FONS_INVALID;
 }
 
+int fonsFontCount (FONScontext * s)
+{
+   return s->nfonts;
+}
+
+// Drops the glyphs of missing codepoints, and those of fallback fonts too if fallbacks, so that they
+// are looked up again. Their atlas rects stay allocated until the page is reused.
+static void fons__dropGlyphs (FONSfont * font, int fallbacks)
+{
+   int i, n = 0;
+   for (i = 0; i < font->nglyphs; i++)
+   {
+      const FONSglyph * glyph = &font->glyphs[i];
+      if (glyph->index == 0 || (fallbacks && glyph->source != -1)) continue;
+      font->glyphs[n++] = *glyph;
+   }
+   if (n == font->nglyphs) return;
+   font->nglyphs = n;
+   fons__rebuildGlyphMap (font);
+}
+
+int fonsAddFallbackFont (FONScontext * stash, int base, int fallback)
+{
+   FONSfont * font;
+   if (base < 0 || base >= stash->nfonts || fallback < 0 || fallback >= stash->nfonts || base == fallback) return 0;
+   font = stash->fonts[base];
+   if (font->nfallbacks >= FONS_MAX_FALLBACKS) return 0;
+   font->fallbacks[font->nfallbacks++] = fallback;
+   // Codepoints cached or rasterized as missing may be in the new font.
+   fons__clearCodepointMap (font);
+   fons__clearMetrics (font);
+   fons__dropGlyphs (font, 0);
+   return 1;
+}
+
+void fonsResetFallbackFont (FONScontext * stash, int base)
+{
+   FONSfont * font;
+   if (base < 0 || base >= stash->nfonts) return;
+   font = stash->fonts[base];
+   font->nfallbacks = 0;
+   fons__clearCodepointMap (font);
+   fons__clearMetrics (font);
+   fons__dropGlyphs (font, 1);
+}
+
 
 static FONSglyph * fons__allocGlyph (FONSfont * font)
 {
    if (font->nglyphs + 1 > font->cglyphs)
    {
-      font->cglyphs = font->cglyphs == 0 ? 8 : font->cglyphs * 2;
-      font->glyphs = (FONSglyph *)realloc (font->glyphs, sizeof (FONSglyph) * font->cglyphs);
-      if (font->glyphs == NULL) return NULL;
+      int cglyphs = font->cglyphs == 0 ? 8 : font->cglyphs * 2;
+      FONSglyph * glyphs = (FONSglyph *)realloc (font->glyphs, sizeof (FONSglyph) * cglyphs);
+      if (glyphs == NULL) return NULL;
+      font->glyphs = glyphs;
+      font->cglyphs = cglyphs;
    }
    font->nglyphs++;
    return &font->glyphs[font->nglyphs - 1];
@@ -981,48 +1741,379 @@ static void fons__blur (FONScontext * stash, unsigned char * dst, int w, int h,
    //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
+struct FONSsdfSeed
+{
+   short dx, dy;
+};
+typedef struct FONSsdfSeed FONSsdfSeed;
+
+static void fons__sdfCompare (FONSsdfSeed * grid, int w, int h, int x, int y, int ox, int oy)
+{
+   FONSsdfSeed * p = &grid[x + y * w];
+   FONSsdfSeed q;
+   if (x + ox < 0 || x + ox >= w || y + oy < 0 || y + oy >= h) return;
+   q = grid[x + ox + (y + oy) * w];
+   q.dx = (short) (q.dx + ox);
+   q.dy = (short) (q.dy + oy);
+   if (q.dx * q.dx + q.dy * q.dy < p->dx * p->dx + p->dy * p->dy)
+      *p = q;
+}
+
+// 8SSEDT: leaves in every cell the offset to the nearest seed cell, seeds start at 0 and the rest far away.
+static void fons__sdfSweep (FONSsdfSeed * grid, int w, int h)
+{
+   int x, y;
+   for (y = 0; y < h; y++)
+   {
+      for (x = 0; x < w; x++)
+      {
+         fons__sdfCompare (grid, w, h, x, y, -1, 0);
+         fons__sdfCompare (grid, w, h, x, y, 0, -1);
+         fons__sdfCompare (grid, w, h, x, y, -1, -1);
+         fons__sdfCompare (grid, w, h, x, y, 1, -1);
+      }
+      for (x = w - 1; x >= 0; x--)
+         fons__sdfCompare (grid, w, h, x, y, 1, 0);
+   }
+   for (y = h - 1; y >= 0; y--)
+   {
+      for (x = w - 1; x >= 0; x--)
+      {
+         fons__sdfCompare (grid, w, h, x, y, 1, 0);
+         fons__sdfCompare (grid, w, h, x, y, 0, 1);
+         fons__sdfCompare (grid, w, h, x, y, -1, 1);
+         fons__sdfCompare (grid, w, h, x, y, 1, 1);
+      }
+      for (x = 0; x < w; x++)
+         fons__sdfCompare (grid, w, h, x, y, -1, 0);
+   }
+}
+
+// Rasterizes the glyph FONS_SDF_OVERSAMPLE times larger, and writes the averaged signed distance of
+// each oversampled block into the gw x gh cells at dst. (x0, y0) is the glyph box at the field size,
+// placed pad cells in.
+static int fons__buildDistanceField (FONScontext * stash, FONSfont * font, int g, float size, float scale,
+                                     int x0, int y0, int pad, unsigned char * dst, int gw, int gh, int stride)
+{
+   const int os = FONS_SDF_OVERSAMPLE;
+   int w = gw * os, h = gh * os, bw, bh, ox, oy, x, y, i, j, advance, lsb, bx0, by0, bx1, by1;
+   unsigned char * bitmap;
+   FONSsdfSeed * inside, * outside;
+   if (!fons__buildGlyph (stash, font, g, size * os, scale * os, &advance, &lsb, &bx0, &by0, &bx1, &by1))
+      return 0;
+   bw = bx1 - bx0;
+   bh = by1 - by0;
+   bitmap = (unsigned char *)malloc (w * h + (bw > 0 && bh > 0 ? bw * bh : 0));
+   inside = (FONSsdfSeed *)malloc (sizeof (FONSsdfSeed) * w * h * 2);
+   if (bitmap == NULL || inside == NULL)
+   {
+      free (bitmap);
+      free (inside);
+      return 0;
+   }
+   outside = inside + w * h;
+   memset (bitmap, 0, w * h);
+   if (bw > 0 && bh > 0)
+   {
+      // Render on its own and copy it in, the oversampled box may round past the field's box.
+      unsigned char * glyph = bitmap + w * h;
+      stash->nscratch = 0;
+      memset (glyph, 0, bw * bh);
+      fons__renderGlyph (stash, font, glyph, bw, bh, bw, scale * os, g);
+      ox = bx0 - (x0 - pad) * os;
+      oy = by0 - (y0 - pad) * os;
+      for (y = 0; y < bh; y++)
+         for (x = 0; x < bw; x++)
+            if (x + ox >= 0 && x + ox < w && y + oy >= 0 && y + oy < h)
+               bitmap[x + ox + (y + oy) * w] = glyph[x + y * bw];
+   }
+   for (i = 0; i < w * h; i++)
+   {
+      int in = bitmap[i] >= 128;
+      inside[i].dx = inside[i].dy = (short) (in ? 0 : 8191);
+      outside[i].dx = outside[i].dy = (short) (in ? 8191 : 0);
+   }
+   fons__sdfSweep (inside, w, h);
+   fons__sdfSweep (outside, w, h);
+   // The outline runs half a cell from the center of the nearest cell across it.
+   for (y = 0; y < gh; y++)
+   {
+      for (x = 0; x < gw; x++)
+      {
+         float d = 0.0f;
+         for (j = 0; j < os; j++)
+         {
+            for (i = 0; i < os; i++)
+            {
+               int k = x * os + i + (y * os + j) * w;
+               if (bitmap[k] >= 128)
+                  d += sqrtf ((float) (outside[k].dx * outside[k].dx + outside[k].dy * outside[k].dy)) - 0.5f;
+               else
+                  d -= sqrtf ((float) (inside[k].dx * inside[k].dx + inside[k].dy * inside[k].dy)) - 0.5f;
+            }
+         }
+         d /= (float) (os * os * os);
+         d = 127.5f + d * 127.5f / FONS_SDF_SPREAD;
+         dst[x + y * stride] = (unsigned char) (d < 0.0f ? 0.0f : d > 255.0f ? 255.0f : d + 0.5f);
+      }
+   }
+   free (bitmap);
+   free (inside);
+   return 1;
+}
+
+// Renders glyph g into the gw x gh rect at dst, which has to be cleared.
+static void fons__rasterizeGlyph (FONScontext * stash, FONSfont * font, int g, float size, float scale,
+                                  int x0, int y0, int pad, int iblur, unsigned char * dst, int gw, int gh, int stride)
+{
+   int x, y;
+   if (stash->params.flags & FONS_DISTANCE_FIELD)
+   {
+      if (!fons__buildDistanceField (stash, font, g, size, scale, x0, y0, pad, dst, gw, gh, stride))
+         for (y = 0; y < gh; y++)
+            memset (&dst[y * stride], 0, gw);
+   }
+   else
+      fons__renderGlyph (stash, font, &dst[pad + pad * stride], gw - pad * 2, gh - pad * 2, stride, scale, g);
+   // Make sure there is one pixel empty border.
+   for (y = 0; y < gh; y++)
+   {
+      dst[y * stride] = 0;
+      dst[gw - 1 + y * stride] = 0;
+   }
+   for (x = 0; x < gw; x++)
+   {
+      dst[x] = 0;
+      dst[x + (gh - 1)*stride] = 0;
+   }
+   // Debug code to color the glyph background
+   /*	for (y = 0; y < gh; y++) {
+   		for (x = 0; x < gw; x++) {
+   			int a = (int)dst[x+y*stride] + 20;
+   			if (a > 255) a = 255;
+   			dst[x+y*stride] = a;
+   		}
+   	}*/
+   // Blur
+   if (iblur > 0)
+   {
+      stash->nscratch = 0;
+      fons__blur (stash, dst, gw, gh, stride, iblur);
+   }
+}
+
+// Atlas texels around a glyph. A negative blur is the margin of a sharp glyph the renderer blurs,
+// rasterizing leaves it sharp.
+static int fons__glyphPad (FONScontext * stash, int blur)
+{
+   if (stash->params.flags & FONS_DISTANCE_FIELD) return FONS_SDF_SPREAD + 1;
+   return (blur < 0 ? -blur : blur) + 2;
+}
+
+static int fons__fontIndex (FONScontext * stash, FONSfont * font)
+{
+   int i;
+   for (i = 0; i < stash->nfonts; i++)
+      if (stash->fonts[i] == font)
+         return i;
+   return -1;
+}
+
+static void fons__queueGlyphJob (FONScontext * stash, FONSfont * font, FONSglyph * glyph)
+{
+   FONSglyphJob * job;
+   if (stash->njobs + 1 > stash->cjobs)
+   {
+      int cjobs = stash->cjobs == 0 ? 64 : stash->cjobs * 2;
+      FONSglyphJob * jobs = (FONSglyphJob *)realloc (stash->jobs, sizeof (FONSglyphJob) * cjobs);
+      // The glyph stays blank until its page is reused.
+      if (jobs == NULL) return;
+      stash->jobs = jobs;
+      stash->cjobs = cjobs;
+   }
+   job = &stash->jobs[stash->njobs++];
+   job->font = fons__fontIndex (stash, font);
+   job->glyph = glyph->index;
+   job->rasterizer = stash->rasterizer;
+   job->size = glyph->size;
+   job->blur = glyph->blur;
+   job->page = glyph->page;
+   job->epoch = stash->pages[glyph->page].epoch;
+   job->x = glyph->x0;
+   job->y = glyph->y0;
+   job->width = glyph->x1 - glyph->x0;
+   job->height = glyph->y1 - glyph->y0;
+   job->bitmap = NULL;
+   stash->npending++;
+}
+
+// Returns the glyph index of the codepoint and sets source to the fallback font it is in, or -1
+// when the font has it or no font of the chain does. Fonts with a chain walk it once per codepoint.
+static int fons__resolveGlyph (FONScontext * stash, FONSfont * font, unsigned int codepoint, int * source)
+{
+   int i, g;
+   *source = -1;
+   if (font->nfallbacks == 0) return fons__tt_getGlyphIndex (&font->font, codepoint);
+   if (font->ccpmap > 0)
+   {
+      unsigned int mask = (unsigned int)font->ccpmap - 1;
+      unsigned int h;
+      for (h = fons__hashGlyphKey (codepoint) & mask; font->cpmap[h].index != -1; h = (h + 1) & mask)
+      {
+         if (font->cpmap[h].codepoint == codepoint)
+         {
+            *source = font->cpmap[h].source;
+            return font->cpmap[h].index;
+         }
+      }
+   }
+   g = fons__tt_getGlyphIndex (&font->font, codepoint);
+   for (i = 0; i < font->nfallbacks && g == 0; i++)
+   {
+      int fallback = font->fallbacks[i];
+      if (fallback < 0 || fallback >= stash->nfonts) continue;
+      g = fons__tt_getGlyphIndex (&stash->fonts[fallback]->font, codepoint);
+      if (g != 0) *source = fallback;
+   }
+   fons__addCodepoint (font, codepoint, *source, g);
+   return g;
+}
+
+// Returns the ASCII table of the size and blur, replacing the oldest one if there is none.
+static FONSasciiGlyphs * fons__asciiGlyphs (FONSfont * font, short isize, short iblur)
+{
+   FONSasciiGlyphs * ascii;
+   int i;
+   for (i = 0; i < FONS_ASCII_SIZES; i++)
+   {
+      ascii = &font->ascii[i];
+      if (ascii->size == isize && ascii->blur == iblur)
+         return ascii;
+   }
+   ascii = &font->ascii[font->nextAscii];
+   font->nextAscii = (font->nextAscii + 1) % FONS_ASCII_SIZES;
+   ascii->size = isize;
+   ascii->blur = iblur;
+   memset (ascii->glyphs, 0, sizeof (ascii->glyphs));
+   return ascii;
+}
+
+// Returns the end of the run of ASCII bytes at str.
+static const char * fons__asciiRun (const char * str, const char * end)
+{
+#if defined FONS__SSE2
+   while (end - str >= 16 && _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *)str)) == 0)
+      str += 16;
+#elif defined FONS__NEON
+   while (end - str >= 16 && vmaxvq_u8 (vld1q_u8 ((const unsigned char *)str)) < 0x80)
+      str += 16;
+#endif
+   while (str != end && * (const unsigned char *)str < 0x80)
+      str++;
+   return str;
+}
+
+// Kerning index of the glyph for the next one, fallback glyphs are not kerned.
+static int fons__kernIndex (const FONSglyph * glyph)
+{
+   if (glyph == NULL) return -1;
+   return glyph->source == -1 ? glyph->index : -2;
+}
+
+// Blur a glyph is kept at in the atlas: none for distance fields, the negated margin for blur left
+// to the renderer.
+static short fons__atlasBlur (FONScontext * stash, short iblur)
+{
+   short margin = 4;
+   if (iblur > 20) iblur = 20;
+   if (stash->params.flags & FONS_DISTANCE_FIELD) return 0;
+   if (!(stash->params.flags & FONS_BLUR_IN_RENDERER) || iblur <= 0) return iblur;
+   while (margin < iblur)
+      margin *= 2;
+   return -margin;
+}
+
 static FONSglyph * fons__getGlyph (FONScontext * stash, FONSfont * font, unsigned int codepoint,
                                    short isize, short iblur)
 {
-   int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
+   int g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy;
    float scale;
    FONSglyph * glyph = NULL;
-   unsigned int h;
+   FONSasciiGlyphs * ascii = NULL;
+   unsigned long long key;
+   unsigned int h, mask;
    float size = isize / 10.0f;
-   int pad, added;
-   unsigned char * bdst;
+   int i, pad, added, source;
+   FONSpage * page;
+   FONSfont * from;
    unsigned char * dst;
    if (isize < 2) return NULL;
-   if (iblur > 20) iblur = 20;
-   pad = iblur + 2;
+   iblur = fons__atlasBlur (stash, iblur);
+   // One field serves every size and blur.
+   if (stash->params.flags & FONS_DISTANCE_FIELD)
+   {
+      isize = FONS_SDF_SIZE * 10;
+      size = FONS_SDF_SIZE;
+   }
+   // ASCII goes through a table of the size.
+   if (codepoint < 128)
+   {
+      ascii = fons__asciiGlyphs (font, isize, iblur);
+      i = ascii->glyphs[codepoint] - 1;
+      if (i >= 0 && i < font->nglyphs)
+      {
+         glyph = &font->glyphs[i];
+         if (glyph->codepoint == codepoint && glyph->size == isize && glyph->blur == iblur)
+         {
+            stash->pages[glyph->page].lastUse = stash->useStamp;
+            return glyph;
+         }
+      }
+   }
+   pad = fons__glyphPad (stash, iblur);
    // Reset allocator.
    stash->nscratch = 0;
    // Find code point and size.
-   h = fons__hashint (codepoint) & (FONS_HASH_LUT_SIZE - 1);
-   i = font->lut[h];
-   while (i != -1)
+   key = fons__glyphKey (codepoint, isize, iblur);
+   mask = (unsigned int)font->cmap - 1;
+   for (h = fons__hashGlyphKey (key) & mask; font->map[h].glyph != -1; h = (h + 1) & mask)
    {
-      if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur)
-         return &font->glyphs[i];
-      i = font->glyphs[i].next;
+      if (font->map[h].key == key)
+      {
+         glyph = &font->glyphs[font->map[h].glyph];
+         stash->pages[glyph->page].lastUse = stash->useStamp;
+         if (ascii != NULL)
+            ascii->glyphs[codepoint] = font->map[h].glyph + 1;
+         return glyph;
+      }
    }
-   // Could not find glyph, create it.
-   scale = fons__tt_getPixelHeightScale (&font->font, size);
-   g = fons__tt_getGlyphIndex (&font->font, codepoint);
-   fons__tt_buildGlyphBitmap (&font->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+   // Could not find glyph, create it. It goes into this font's table whichever font it comes from.
+   g = fons__resolveGlyph (stash, font, codepoint, &source);
+   from = source != -1 ? stash->fonts[source] : font;
+   scale = fons__tt_getPixelHeightScale (&from->font, size);
+   fons__buildGlyph (stash, from, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
    gw = x1 - x0 + pad * 2;
    gh = y1 - y0 + pad * 2;
    // Find free spot for the rect in the atlas
-   added = fons__atlasAddRect (stash->atlas, gw, gh, &gx, &gy);
-   if (added == 0 && stash->handleError != NULL)
+   added = fons__atlasAddRect (stash->pages[stash->page].atlas, gw, gh, &gx, &gy);
+   if (added == 0 && stash->params.maxPages > 1)
+   {
+      // Page is full, carry on in another one and try again.
+      if (fons__nextPage (stash))
+         added = fons__atlasAddRect (stash->pages[stash->page].atlas, gw, gh, &gx, &gy);
+   }
+   else if (added == 0 && stash->handleError != NULL)
    {
       // Atlas is full, let the user to resize the atlas (or not), and try again.
       stash->handleError (stash->errorUptr, FONS_ATLAS_FULL, 0);
-      added = fons__atlasAddRect (stash->atlas, gw, gh, &gx, &gy);
+      added = fons__atlasAddRect (stash->pages[stash->page].atlas, gw, gh, &gx, &gy);
    }
    if (added == 0) return NULL;
+   page = &stash->pages[stash->page];
+   page->lastUse = stash->useStamp;
    // Init glyph.
    glyph = fons__allocGlyph (font);
+   if (glyph == NULL) return NULL;
    glyph->codepoint = codepoint;
    glyph->size = isize;
    glyph->blur = iblur;
@@ -1034,56 +2125,117 @@ static FONSglyph * fons__getGlyph (FONScontext * stash, FONSfont * font, unsigne
    glyph->xadv = (short) (scale * advance * 10.0f);
    glyph->xoff = (short) (x0 - pad);
    glyph->yoff = (short) (y0 - pad);
-   glyph->next = 0;
+   glyph->page = (short)stash->page;
+   glyph->source = (short)source;
    // Insert char to hash lookup.
-   glyph->next = font->lut[h];
-   font->lut[h] = font->nglyphs - 1;
-   // Rasterize
-   dst = &stash->texData[ (glyph->x0 + pad) + (glyph->y0 + pad) * stash->params.width];
-   fons__tt_renderGlyphBitmap (&font->font, dst, gw - pad * 2, gh - pad * 2, stash->params.width, scale, scale, g);
-   // Make sure there is one pixel empty border.
-   dst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-   for (y = 0; y < gh; y++)
+   if (!fons__addGlyphToMap (font))
    {
-      dst[y * stash->params.width] = 0;
-      dst[gw - 1 + y * stash->params.width] = 0;
+      font->nglyphs--;
+      return NULL;
    }
-   for (x = 0; x < gw; x++)
+   if (ascii != NULL)
+      ascii->glyphs[codepoint] = font->nglyphs;
+   if (stash->asyncGlyphs)
    {
-      dst[x] = 0;
-      dst[x + (gh - 1)*stash->params.width] = 0;
+      fons__queueGlyphJob (stash, from, glyph);
+      return glyph;
    }
-   // Debug code to color the glyph background
-   /*	unsigned char* fdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-   	for (y = 0; y < gh; y++) {
-   		for (x = 0; x < gw; x++) {
-   			int a = (int)fdst[x+y*stash->params.width] + 20;
-   			if (a > 255) a = 255;
-   			fdst[x+y*stash->params.width] = a;
-   		}
-   	}*/
-   // Blur
-   if (iblur > 0)
+   dst = &page->data[glyph->x0 + glyph->y0 * stash->params.width];
+   fons__rasterizeGlyph (stash, from, g, size, scale, x0, y0, pad, iblur, dst, gw, gh, stash->params.width);
+   fons__addDirty (page, glyph->x0, glyph->y0, glyph->x1, glyph->y1);
+   return glyph;
+}
+
+// Fills glyph with what fons__getQuad() reads of the glyph the atlas would get for the codepoint,
+// from the metrics cached per size. Nothing is rasterized or packed. Returns NULL where
+// fons__getGlyph() would.
+static FONSglyph * fons__measureGlyph (FONScontext * stash, FONSfont * font, unsigned int codepoint,
+                                       short isize, short iblur, FONSglyph * glyph)
+{
+   int i, g, source, advance, lsb, x0, y0, x1, y1, pad;
+   float size, scale;
+   unsigned long long key;
+   unsigned int h, mask;
+   FONSmetric * metric = NULL;
+   FONSfont * from;
+   if (isize < 2) return NULL;
+   if (stash->params.flags & FONS_DISTANCE_FIELD)
+      isize = FONS_SDF_SIZE * 10;
+   size = isize / 10.0f;
+   key = fons__glyphKey (codepoint, isize, 0);
+   if (font->cmetrics > 0)
    {
-      stash->nscratch = 0;
-      bdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-      fons__blur (stash, bdst, gw, gh, stash->params.width, iblur);
+      mask = (unsigned int)font->cmetrics - 1;
+      for (h = fons__hashGlyphKey (key) & mask; font->metrics[h].index != -1; h = (h + 1) & mask)
+      {
+         if (font->metrics[h].key == key)
+         {
+            metric = &font->metrics[h];
+            break;
+         }
+      }
    }
-   stash->dirtyRect[0] = fons__mini (stash->dirtyRect[0], glyph->x0);
-   stash->dirtyRect[1] = fons__mini (stash->dirtyRect[1], glyph->y0);
-   stash->dirtyRect[2] = fons__maxi (stash->dirtyRect[2], glyph->x1);
-   stash->dirtyRect[3] = fons__maxi (stash->dirtyRect[3], glyph->y1);
+   if (metric == NULL)
+   {
+      if ((font->nmetrics + 1) * 2 > font->cmetrics)
+      {
+         int cmap = font->cmetrics == 0 ? 256 : font->cmetrics * 2;
+         FONSmetric * map = (FONSmetric *)malloc (sizeof (FONSmetric) * cmap);
+         // Measure through the atlas then.
+         if (map == NULL) return fons__getGlyph (stash, font, codepoint, isize, iblur);
+         for (i = 0; i < cmap; i++)
+            map[i].index = -1;
+         for (i = 0; i < font->cmetrics; i++)
+            if (font->metrics[i].index != -1)
+               *fons__putMetric (map, cmap, font->metrics[i].key) = font->metrics[i];
+         free (font->metrics);
+         font->metrics = map;
+         font->cmetrics = cmap;
+      }
+      g = fons__resolveGlyph (stash, font, codepoint, &source);
+      from = source != -1 ? stash->fonts[source] : font;
+      scale = fons__tt_getPixelHeightScale (&from->font, size);
+      if (!fons__buildGlyph (stash, from, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1))
+         advance = x0 = y0 = x1 = y1 = 0;
+      metric = fons__putMetric (font->metrics, font->cmetrics, key);
+      metric->index = g;
+      metric->source = (short)source;
+      metric->xadv = (short) (scale * advance * 10.0f);
+      metric->x0 = (short)x0;
+      metric->y0 = (short)y0;
+      metric->x1 = (short)x1;
+      metric->y1 = (short)y1;
+      font->nmetrics++;
+   }
+   // The atlas rect is the box with the padding of the blur around it.
+   pad = fons__glyphPad (stash, fons__atlasBlur (stash, iblur));
+   glyph->codepoint = codepoint;
+   glyph->index = metric->index;
+   glyph->size = isize;
+   glyph->blur = iblur;
+   glyph->x0 = 0;
+   glyph->y0 = 0;
+   glyph->x1 = (short) (metric->x1 - metric->x0 + pad * 2);
+   glyph->y1 = (short) (metric->y1 - metric->y0 + pad * 2);
+   glyph->xadv = metric->xadv;
+   glyph->xoff = (short) (metric->x0 - pad);
+   glyph->yoff = (short) (metric->y0 - pad);
+   glyph->page = 0;
+   glyph->source = metric->source;
    return glyph;
 }
 
 static void fons__getQuad (FONScontext * stash, FONSfont * font,
-                           int prevGlyphIndex, FONSglyph * glyph,
+                           int prevGlyphIndex, FONSglyph * glyph, short isize,
                            float scale, float spacing, float * x, float * y, FONSquad * q)
 {
-   float rx, ry, xoff, yoff, x0, y0, x1, y1;
+   float rx, ry, xoff, yoff, x0, y0, x1, y1, gs = 1.0f;
+   int field = (stash->params.flags & FONS_DISTANCE_FIELD) != 0;
    if (prevGlyphIndex != -1)
    {
-      float adv = fons__tt_getGlyphKernAdvance (&font->font, prevGlyphIndex, glyph->index) * scale;
+      float adv = 0.0f;
+      if (prevGlyphIndex >= 0 && glyph->source == -1)
+         adv = fons__getKernAdvance (font, prevGlyphIndex, glyph->index) * scale;
       *x += (int) (adv + spacing + 0.5f);
    }
    // Each glyph has 2px border to allow good interpolation,
@@ -1095,14 +2247,21 @@ static void fons__getQuad (FONScontext * stash, FONSfont * font,
    y0 = (float) (glyph->y0 + 1);
    x1 = (float) (glyph->x1 - 1);
    y1 = (float) (glyph->y1 - 1);
+   // Distance fields scale to the requested size and need no snapping to whole pixels.
+   if (field)
+   {
+      gs = (float)isize / (float)glyph->size;
+      xoff *= gs;
+      yoff *= gs;
+   }
    if (stash->params.flags & FONS_ZERO_TOPLEFT)
    {
-      rx = (float) (int) (*x + xoff);
-      ry = (float) (int) (*y + yoff);
+      rx = field ? *x + xoff : (float) (int) (*x + xoff);
+      ry = field ? *y + yoff : (float) (int) (*y + yoff);
       q->x0 = rx;
       q->y0 = ry;
-      q->x1 = rx + x1 - x0;
-      q->y1 = ry + y1 - y0;
+      q->x1 = rx + (x1 - x0) * gs;
+      q->y1 = ry + (y1 - y0) * gs;
       q->s0 = x0 * stash->itw;
       q->t0 = y0 * stash->ith;
       q->s1 = x1 * stash->itw;
@@ -1110,32 +2269,34 @@ static void fons__getQuad (FONScontext * stash, FONSfont * font,
    }
    else
    {
-      rx = (float) (int) (*x + xoff);
-      ry = (float) (int) (*y - yoff);
+      rx = field ? *x + xoff : (float) (int) (*x + xoff);
+      ry = field ? *y - yoff : (float) (int) (*y - yoff);
       q->x0 = rx;
       q->y0 = ry;
-      q->x1 = rx + x1 - x0;
-      q->y1 = ry - y1 + y0;
+      q->x1 = rx + (x1 - x0) * gs;
+      q->y1 = ry - (y1 - y0) * gs;
       q->s0 = x0 * stash->itw;
       q->t0 = y0 * stash->ith;
       q->s1 = x1 * stash->itw;
       q->t1 = y1 * stash->ith;
    }
-   *x += (int) (glyph->xadv / 10.0f + 0.5f);
+   q->page = glyph->page;
+   if (field)
+      *x += glyph->xadv / 10.0f * gs;
+   else
+      *x += (int) (glyph->xadv / 10.0f + 0.5f);
 }
 
 static void fons__flush (FONScontext * stash)
 {
+   FONSpage * page = &stash->pages[0];
    // Flush texture
-   if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3])
+   if (page->dirtyRect[0] < page->dirtyRect[2] && page->dirtyRect[1] < page->dirtyRect[3])
    {
       if (stash->params.renderUpdate != NULL)
-         stash->params.renderUpdate (stash->params.userPtr, stash->dirtyRect, stash->texData);
+         stash->params.renderUpdate (stash->params.userPtr, page->dirtyRect, page->data);
       // Reset dirty rect
-      stash->dirtyRect[0] = stash->params.width;
-      stash->dirtyRect[1] = stash->params.height;
-      stash->dirtyRect[2] = 0;
-      stash->dirtyRect[3] = 0;
+      fons__resetDirty (stash, page);
    }
    // Flush triangles
    if (stash->nverts > 0)
@@ -1208,6 +2369,7 @@ float fonsDrawText (FONScontext * stash,
    if (state->font < 0 || state->font >= stash->nfonts) return x;
    font = stash->fonts[state->font];
    if (font->data == NULL) return x;
+   fons__nextUse (stash);
    scale = fons__tt_getPixelHeightScale (&font->font, (float)isize / 10.0f);
    if (end == NULL)
       end = str + strlen (str);
@@ -1237,7 +2399,7 @@ float fonsDrawText (FONScontext * stash,
       glyph = fons__getGlyph (stash, font, codepoint, isize, iblur);
       if (glyph != NULL)
       {
-         fons__getQuad (stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+         fons__getQuad (stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
          if (stash->nverts + 6 > FONS_VERTEX_COUNT)
             fons__flush (stash);
          fons__vertex (stash, q.x0, q.y0, q.s0, q.t0, state->color);
@@ -1247,7 +2409,7 @@ float fonsDrawText (FONScontext * stash,
          fons__vertex (stash, q.x0, q.y1, q.s0, q.t1, state->color);
          fons__vertex (stash, q.x1, q.y1, q.s1, q.t1, state->color);
       }
-      prevGlyphIndex = glyph != NULL ? glyph->index : -1;
+      prevGlyphIndex = fons__kernIndex (glyph);
    }
    fons__flush (stash);
    return x;
@@ -1263,6 +2425,7 @@ int fonsTextIterInit (FONScontext * stash, FONStextIter * iter,
    if (state->font < 0 || state->font >= stash->nfonts) return 0;
    iter->font = stash->fonts[state->font];
    if (iter->font->data == NULL) return 0;
+   fons__nextUse (stash);
    iter->isize = (short) (state->size * 10.0f);
    iter->iblur = (short)state->blur;
    iter->scale = fons__tt_getPixelHeightScale (&iter->font->font, (float)iter->isize / 10.0f);
@@ -1293,6 +2456,7 @@ int fonsTextIterInit (FONScontext * stash, FONStextIter * iter,
    iter->str = str;
    iter->next = str;
    iter->end = end;
+   iter->ascii = str;
    iter->codepoint = 0;
    iter->prevGlyphIndex = -1;
    return 1;
@@ -1305,9 +2469,14 @@ int fonsTextIterNext (FONScontext * stash, FONStextIter * iter, FONSquad * quad)
    iter->str = iter->next;
    if (str == iter->end)
       return 0;
+   // Bytes of an ASCII run are their codepoint, they skip the decoder.
+   if (str >= iter->ascii && iter->utf8state == 0)
+      iter->ascii = fons__asciiRun (str, iter->end);
    for (; str != iter->end; str++)
    {
-      if (fons__decutf8 (&iter->utf8state, &iter->codepoint, * (const unsigned char *)str))
+      if (str < iter->ascii)
+         iter->codepoint = * (const unsigned char *)str;
+      else if (fons__decutf8 (&iter->utf8state, &iter->codepoint, * (const unsigned char *)str))
          continue;
       str++;
       // Get glyph and quad
@@ -1315,8 +2484,8 @@ int fonsTextIterNext (FONScontext * stash, FONStextIter * iter, FONSquad * quad)
       iter->y = iter->nexty;
       glyph = fons__getGlyph (stash, iter->font, iter->codepoint, iter->isize, iter->iblur);
       if (glyph != NULL)
-         fons__getQuad (stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
-      iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
+         fons__getQuad (stash, iter->font, iter->prevGlyphIndex, glyph, iter->isize, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+      iter->prevGlyphIndex = fons__kernIndex (glyph);
       break;
    }
    iter->next = str;
@@ -1347,17 +2516,18 @@ void fonsDrawDebug (FONScontext * stash, float x, float y)
    fons__vertex (stash, x + 0, y + h, 0, 1, 0xffffffff);
    fons__vertex (stash, x + w, y + h, 1, 1, 0xffffffff);
    // Drawbug draw atlas
-   for (i = 0; i < stash->atlas->nnodes; i++)
+   for (i = 0; i < stash->pages[0].atlas->nshelves; i++)
    {
-      FONSatlasNode * n = &stash->atlas->nodes[i];
+      FONSatlasShelf * n = &stash->pages[0].atlas->shelves[i];
+      int ny = n->y + n->height;
       if (stash->nverts + 6 > FONS_VERTEX_COUNT)
          fons__flush (stash);
-      fons__vertex (stash, x + n->x + 0, y + n->y + 0, u, v, 0xc00000ff);
-      fons__vertex (stash, x + n->x + n->width, y + n->y + 1, u, v, 0xc00000ff);
-      fons__vertex (stash, x + n->x + n->width, y + n->y + 0, u, v, 0xc00000ff);
-      fons__vertex (stash, x + n->x + 0, y + n->y + 0, u, v, 0xc00000ff);
-      fons__vertex (stash, x + n->x + 0, y + n->y + 1, u, v, 0xc00000ff);
-      fons__vertex (stash, x + n->x + n->width, y + n->y + 1, u, v, 0xc00000ff);
+      fons__vertex (stash, x + 0, y + ny - 1, u, v, 0xc00000ff);
+      fons__vertex (stash, x + n->x, y + ny, u, v, 0xc00000ff);
+      fons__vertex (stash, x + n->x, y + ny - 1, u, v, 0xc00000ff);
+      fons__vertex (stash, x + 0, y + ny - 1, u, v, 0xc00000ff);
+      fons__vertex (stash, x + 0, y + ny, u, v, 0xc00000ff);
+      fons__vertex (stash, x + n->x, y + ny, u, v, 0xc00000ff);
    }
    fons__flush (stash);
 }
@@ -1371,6 +2541,7 @@ float fonsTextBounds (FONScontext * stash,
    unsigned int codepoint;
    unsigned int utf8state = 0;
    FONSquad q;
+   FONSglyph measured;
    FONSglyph * glyph = NULL;
    int prevGlyphIndex = -1;
    short isize = (short) (state->size * 10.0f);
@@ -1395,10 +2566,10 @@ float fonsTextBounds (FONScontext * stash,
    {
       if (fons__decutf8 (&utf8state, &codepoint, * (const unsigned char *)str))
          continue;
-      glyph = fons__getGlyph (stash, font, codepoint, isize, iblur);
+      glyph = fons__measureGlyph (stash, font, codepoint, isize, iblur, &measured);
       if (glyph != NULL)
       {
-         fons__getQuad (stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+         fons__getQuad (stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
          if (q.x0 < minx) minx = q.x0;
          if (q.x1 > maxx) maxx = q.x1;
          if (stash->params.flags & FONS_ZERO_TOPLEFT)
@@ -1412,7 +2583,7 @@ float fonsTextBounds (FONScontext * stash,
             if (q.y0 > maxy) maxy = q.y0;
          }
       }
-      prevGlyphIndex = glyph != NULL ? glyph->index : -1;
+      prevGlyphIndex = fons__kernIndex (glyph);
    }
    advance = x - startx;
    // Align horizontally
@@ -1490,22 +2661,57 @@ const unsigned char * fonsGetTextureData (FONScontext * stash, int * width, int
       *width = stash->params.width;
    if (height != NULL)
       *height = stash->params.height;
-   return stash->texData;
+   return stash->pages[0].data;
 }
 
 int fonsValidateTexture (FONScontext * stash, int * dirty)
 {
-   if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3])
+   return fonsValidatePage (stash, 0, dirty);
+}
+
+int fonsPageCount (FONScontext * stash)
+{
+   return stash->npages;
+}
+
+void fonsMemoryUsage (FONScontext * stash, int * scratch, int * atlas)
+{
+   int i;
+   *scratch = FONS_SCRATCH_BUF_SIZE;
+   *atlas = 0;
+   for (i = 0; i < stash->npages; i++)
+   {
+      const FONSatlas * a = stash->pages[i].atlas;
+      if (a == NULL) continue;
+      *atlas += a->width * a->height + (int)sizeof (FONSatlas) + a->cshelves * (int)sizeof (FONSatlasShelf);
+   }
+}
+
+int fonsPageEpoch (FONScontext * stash, int page)
+{
+   return stash->pages[page].epoch;
+}
+
+const unsigned char * fonsGetPageData (FONScontext * stash, int page, int * width, int * height)
+{
+   if (width != NULL)
+      *width = stash->params.width;
+   if (height != NULL)
+      *height = stash->params.height;
+   return stash->pages[page].data;
+}
+
+int fonsValidatePage (FONScontext * stash, int page, int * dirty)
+{
+   FONSpage * p = &stash->pages[page];
+   if (p->dirtyRect[0] < p->dirtyRect[2] && p->dirtyRect[1] < p->dirtyRect[3])
    {
-      dirty[0] = stash->dirtyRect[0];
-      dirty[1] = stash->dirtyRect[1];
-      dirty[2] = stash->dirtyRect[2];
-      dirty[3] = stash->dirtyRect[3];
+      dirty[0] = p->dirtyRect[0];
+      dirty[1] = p->dirtyRect[1];
+      dirty[2] = p->dirtyRect[2];
+      dirty[3] = p->dirtyRect[3];
       // Reset dirty rect
-      stash->dirtyRect[0] = stash->params.width;
-      stash->dirtyRect[1] = stash->params.height;
-      stash->dirtyRect[2] = 0;
-      stash->dirtyRect[3] = 0;
+      fons__resetDirty (stash, p);
       return 1;
    }
    return 0;
@@ -1519,13 +2725,42 @@ void fonsDeleteInternal (FONScontext * stash)
       stash->params.renderDelete (stash->params.userPtr);
    for (i = 0; i < stash->nfonts; ++i)
       fons__freeFont (stash->fonts[i]);
-   if (stash->atlas) fons__deleteAtlas (stash->atlas);
+   for (i = 0; i < FONS_MAX_PAGES; ++i)
+      fons__freePage (&stash->pages[i]);
    if (stash->fonts) free (stash->fonts);
-   if (stash->texData) free (stash->texData);
    if (stash->scratch) free (stash->scratch);
+   if (stash->jobs) free (stash->jobs);
+#ifdef FONS__FT_RASTER
+   if (stash->ftLibrary) FT_Done_FreeType (stash->ftLibrary);
+#endif
    free (stash);
 }
 
+int fonsSetRasterizer (FONScontext * stash, int rasterizer)
+{
+   if (stash == NULL) return 0;
+   if (rasterizer == stash->rasterizer) return 1;
+#ifdef FONS__FT_RASTER
+   if (rasterizer != FONS_RASTER_DEFAULT && rasterizer != FONS_RASTER_FREETYPE && rasterizer != FONS_RASTER_FREETYPE_HINTED)
+      return 0;
+   if (rasterizer != FONS_RASTER_DEFAULT && stash->ftLibrary == NULL && FT_Init_FreeType (&stash->ftLibrary) != 0)
+   {
+      stash->ftLibrary = NULL;
+      return 0;
+   }
+#else
+   if (rasterizer != FONS_RASTER_DEFAULT) return 0;
+#endif
+   stash->rasterizer = rasterizer;
+   // Glyphs of the two would not match in one line.
+   return fonsResetAtlas (stash, stash->params.width, stash->params.height);
+}
+
+int fonsGetRasterizer (FONScontext * stash)
+{
+   return stash != NULL ? stash->rasterizer : FONS_RASTER_DEFAULT;
+}
+
 void fonsSetErrorCallback (FONScontext * stash, void (*callback) (void * uptr, int error, int val), void * uptr)
 {
    if (stash == NULL) return;
@@ -1542,7 +2777,7 @@ void fonsGetAtlasSize (FONScontext * stash, int * width, int * height)
 
 int fonsExpandAtlas (FONScontext * stash, int width, int height)
 {
-   int i, maxy = 0;
+   int i, j, maxy;
    unsigned char * data = NULL;
    if (stash == NULL) return 0;
    width = fons__maxi (width, stash->params.width);
@@ -1557,31 +2792,34 @@ int fonsExpandAtlas (FONScontext * stash, int width, int height)
       if (stash->params.renderResize (stash->params.userPtr, width, height) == 0)
          return 0;
    }
-   // Copy old texture data over.
-   data = (unsigned char *)malloc (width * height);
-   if (data == NULL)
-      return 0;
-   for (i = 0; i < stash->params.height; i++)
-   {
-      unsigned char * dst = &data[i * width];
-      unsigned char * src = &stash->texData[i * stash->params.width];
-      memcpy (dst, src, stash->params.width);
-      if (width > stash->params.width)
-         memset (dst + stash->params.width, 0, width - stash->params.width);
-   }
-   if (height > stash->params.height)
-      memset (&data[stash->params.height * width], 0, (height - stash->params.height) * width);
-   free (stash->texData);
-   stash->texData = data;
-   // Increase atlas size
-   fons__atlasExpand (stash->atlas, width, height);
-   // Add existing data as dirty.
-   for (i = 0; i < stash->atlas->nnodes; i++)
-      maxy = fons__maxi (maxy, stash->atlas->nodes[i].y);
-   stash->dirtyRect[0] = 0;
-   stash->dirtyRect[1] = 0;
-   stash->dirtyRect[2] = stash->params.width;
-   stash->dirtyRect[3] = maxy;
+   for (j = 0; j < stash->npages; j++)
+   {
+      FONSpage * page = &stash->pages[j];
+      // Copy old texture data over.
+      data = (unsigned char *)malloc (width * height);
+      if (data == NULL)
+         return 0;
+      for (i = 0; i < stash->params.height; i++)
+      {
+         unsigned char * dst = &data[i * width];
+         unsigned char * src = &page->data[i * stash->params.width];
+         memcpy (dst, src, stash->params.width);
+         if (width > stash->params.width)
+            memset (dst + stash->params.width, 0, width - stash->params.width);
+      }
+      if (height > stash->params.height)
+         memset (&data[stash->params.height * width], 0, (height - stash->params.height) * width);
+      free (page->data);
+      page->data = data;
+      // Increase atlas size
+      fons__atlasExpand (page->atlas, width, height);
+      // Add existing data as dirty.
+      maxy = page->atlas->top;
+      page->dirtyRect[0] = 0;
+      page->dirtyRect[1] = 0;
+      page->dirtyRect[2] = stash->params.width;
+      page->dirtyRect[3] = maxy;
+   }
    stash->params.width = width;
    stash->params.height = height;
    stash->itw = 1.0f / stash->params.width;
@@ -1591,7 +2829,7 @@ int fonsExpandAtlas (FONScontext * stash, int width, int height)
 
 int fonsResetAtlas (FONScontext * stash, int width, int height)
 {
-   int i, j;
+   int i;
    if (stash == NULL) return 0;
    // Flush pending glyphs.
    fons__flush (stash);
@@ -1601,33 +2839,412 @@ int fonsResetAtlas (FONScontext * stash, int width, int height)
       if (stash->params.renderResize (stash->params.userPtr, width, height) == 0)
          return 0;
    }
-   // Reset atlas
-   fons__atlasReset (stash->atlas, width, height);
-   // Clear texture data.
-   stash->texData = (unsigned char *)realloc (stash->texData, width * height);
-   if (stash->texData == NULL) return 0;
-   memset (stash->texData, 0, width * height);
-   // Reset dirty rect
-   stash->dirtyRect[0] = width;
-   stash->dirtyRect[1] = height;
-   stash->dirtyRect[2] = 0;
-   stash->dirtyRect[3] = 0;
-   // Reset cached glyphs
-   for (i = 0; i < stash->nfonts; i++)
-   {
-      FONSfont * font = stash->fonts[i];
-      font->nglyphs = 0;
-      for (j = 0; j < FONS_HASH_LUT_SIZE; j++)
-         font->lut[j] = -1;
-   }
    stash->params.width = width;
    stash->params.height = height;
    stash->itw = 1.0f / stash->params.width;
    stash->ith = 1.0f / stash->params.height;
-   // Add white rect at 0,0 for debug drawing.
-   fons__addWhiteRect (stash, 2, 2);
+   // Drop all but the first page and clear it.
+   for (i = 1; i < stash->npages; i++)
+      fons__freePage (&stash->pages[i]);
+   stash->npages = 1;
+   stash->page = 0;
+   if (!fons__initPage (stash, &stash->pages[0])) return 0;
+   // Reset cached glyphs, the boxes of the metrics depend on the rasterizer.
+   for (i = 0; i < stash->nfonts; i++)
+   {
+      stash->fonts[i]->nglyphs = 0;
+      fons__rebuildGlyphMap (stash->fonts[i]);
+      fons__clearMetrics (stash->fonts[i]);
+   }
+   return 1;
+}
+
+
+int fonsPrewarm (FONScontext * stash, const char * str, const char * end)
+{
+   FONSstate * state = fons__getState (stash);
+   unsigned int codepoint;
+   unsigned int utf8state = 0;
+   short isize = (short) (state->size * 10.0f);
+   short iblur = (short)state->blur;
+   FONSfont * font;
+   int n = 0;
+   if (stash == NULL) return 0;
+   if (state->font < 0 || state->font >= stash->nfonts) return 0;
+   font = stash->fonts[state->font];
+   if (font->data == NULL) return 0;
+   fons__nextUse (stash);
+   if (end == NULL)
+      end = str + strlen (str);
+   for (; str != end; ++str)
+   {
+      if (fons__decutf8 (&utf8state, &codepoint, * (const unsigned char *)str))
+         continue;
+      if (fons__getGlyph (stash, font, codepoint, isize, iblur) != NULL)
+         n++;
+   }
+   return n;
+}
+
+FONScontext * fonsCreateShared (FONScontext * stash)
+{
+   FONSparams params = stash->params;
+   FONScontext * shared;
+   params.userPtr = NULL;
+   params.renderCreate = NULL;
+   params.renderResize = NULL;
+   params.renderUpdate = NULL;
+   params.renderDraw = NULL;
+   params.renderDelete = NULL;
+   shared = fonsCreateInternal (&params);
+   if (shared == NULL) return NULL;
+   shared->rasterizer = stash->rasterizer;
+   if (!fonsShareFonts (shared, stash))
+   {
+      fonsDeleteInternal (shared);
+      return NULL;
+   }
+   return shared;
+}
+
+int fonsShareFonts (FONScontext * stash, FONScontext * from)
+{
+   int i;
+   for (i = stash->nfonts; i < from->nfonts; i++)
+   {
+      FONSfont * font = from->fonts[i];
+      if (fonsAddFontMem (stash, font->name, font->data, font->dataSize, 0) == FONS_INVALID)
+         return 0;
+   }
+   for (i = 0; i < from->nfonts; i++)
+   {
+      FONSfont * font = stash->fonts[i];
+      memcpy (font->fallbacks, from->fonts[i]->fallbacks, sizeof (font->fallbacks));
+      font->nfallbacks = from->fonts[i]->nfallbacks;
+      fons__clearCodepointMap (font);
+      fons__clearMetrics (font);
+   }
+   return 1;
+}
+
+#define FONS_ATLAS_MAGIC 0x414e4f46   // "FONA"
+#define FONS_ATLAS_VERSION 5
+
+static unsigned int fons__checksum (const unsigned char * data, int size)
+{
+   unsigned int h = 2166136261u;
+   int i;
+   for (i = 0; i < size; i++)
+      h = (h ^ data[i]) * 16777619u;
+   return h;
+}
+
+struct FONSblob
+{
+   unsigned char * data;
+   int size;
+   int capacity;
+};
+typedef struct FONSblob FONSblob;
+
+static int fons__put (FONSblob * blob, const void * src, int size)
+{
+   if (blob->size + size > blob->capacity)
+   {
+      int capacity = fons__maxi (blob->size + size, blob->capacity * 2);
+      unsigned char * data = (unsigned char *)realloc (blob->data, capacity);
+      if (data == NULL) return 0;
+      blob->data = data;
+      blob->capacity = capacity;
+   }
+   memcpy (blob->data + blob->size, src, size);
+   blob->size += size;
+   return 1;
+}
+
+static int fons__putInt (FONSblob * blob, int v)
+{
+   return fons__put (blob, &v, sizeof (int));
+}
+
+static const unsigned char * fons__get (const unsigned char ** pos, const unsigned char * end, int size)
+{
+   const unsigned char * p = *pos;
+   if (size < 0 || end - p < size) return NULL;
+   *pos = p + size;
+   return p;
+}
+
+static int fons__getInt (const unsigned char ** pos, const unsigned char * end, int * v)
+{
+   const unsigned char * p = fons__get (pos, end, sizeof (int));
+   if (p == NULL) return 0;
+   memcpy (v, p, sizeof (int));
+   return 1;
+}
+
+unsigned char * fonsSaveAtlasMem (FONScontext * stash, int * size)
+{
+   FONSblob blob = { NULL, 0, 0 };
+   int i, ok = 1;
+   // Glyphs still waiting for their bitmap would be saved blank.
+   if (stash->npending > 0) return NULL;
+   ok &= fons__putInt (&blob, FONS_ATLAS_MAGIC);
+   ok &= fons__putInt (&blob, FONS_ATLAS_VERSION);
+   ok &= fons__putInt (&blob, (int)sizeof (FONSglyph));
+   ok &= fons__putInt (&blob, stash->params.width);
+   ok &= fons__putInt (&blob, stash->params.height);
+   ok &= fons__putInt (&blob, stash->params.flags);
+   ok &= fons__putInt (&blob, stash->rasterizer);
+   ok &= fons__putInt (&blob, stash->npages);
+   ok &= fons__putInt (&blob, stash->nfonts);
+   for (i = 0; i < stash->nfonts && ok; i++)
+   {
+      FONSfont * font = stash->fonts[i];
+      ok &= fons__put (&blob, font->name, sizeof (font->name));
+      ok &= fons__putInt (&blob, font->dataSize);
+      ok &= fons__putInt (&blob, (int)fons__checksum (font->data, font->dataSize));
+      ok &= fons__putInt (&blob, font->nglyphs);
+      ok &= fons__put (&blob, font->glyphs, font->nglyphs * (int)sizeof (FONSglyph));
+   }
+   for (i = 0; i < stash->npages && ok; i++)
+   {
+      FONSatlas * atlas = stash->pages[i].atlas;
+      ok &= fons__putInt (&blob, atlas->nshelves);
+      ok &= fons__put (&blob, atlas->shelves, atlas->nshelves * (int)sizeof (FONSatlasShelf));
+      ok &= fons__put (&blob, stash->pages[i].data, stash->params.width * stash->params.height);
+   }
+   if (!ok)
+   {
+      free (blob.data);
+      return NULL;
+   }
+   *size = blob.size;
+   return blob.data;
+}
+
+int fonsLoadAtlasMem (FONScontext * stash, const unsigned char * data, int size)
+{
+   const unsigned char * end = data + size;
+   const unsigned char * pos = data;
+   const unsigned char * fontsStart, * pagesStart;
+   int i, j, magic, version, glyphSize, width, height, flags, rasterizer, npages, nfonts;
+   int limit = fons__maxi (1, fons__mini (stash->params.maxPages, FONS_MAX_PAGES));
+   int pageSize = stash->params.width * stash->params.height;
+   if (!fons__getInt (&pos, end, &magic) || !fons__getInt (&pos, end, &version) ||
+       !fons__getInt (&pos, end, &glyphSize) || !fons__getInt (&pos, end, &width) ||
+       !fons__getInt (&pos, end, &height) || !fons__getInt (&pos, end, &flags) ||
+       !fons__getInt (&pos, end, &rasterizer) || !fons__getInt (&pos, end, &npages) || !fons__getInt (&pos, end, &nfonts))
+      return 0;
+   if (magic != FONS_ATLAS_MAGIC || version != FONS_ATLAS_VERSION || glyphSize != (int)sizeof (FONSglyph) ||
+       width != stash->params.width || height != stash->params.height || flags != stash->params.flags ||
+       rasterizer != stash->rasterizer || npages < 1 || npages > limit || nfonts < 0)
+      return 0;
+   // Check the whole blob before touching the atlas.
+   fontsStart = pos;
+   for (i = 0; i < nfonts; i++)
+   {
+      int dataSize, checksum, nglyphs;
+      const FONSglyph * glyphs;
+      if (fons__get (&pos, end, 64) == NULL || !fons__getInt (&pos, end, &dataSize) ||
+          !fons__getInt (&pos, end, &checksum) || !fons__getInt (&pos, end, &nglyphs) || nglyphs < 0 ||
+          nglyphs > (int) ((end - pos) / sizeof (FONSglyph)))
+         return 0;
+      glyphs = (const FONSglyph *)fons__get (&pos, end, nglyphs * (int)sizeof (FONSglyph));
+      for (j = 0; j < nglyphs; j++)
+      {
+         FONSglyph g;
+         memcpy (&g, &glyphs[j], sizeof (g));
+         if (g.page < 0 || g.page >= npages)
+            return 0;
+      }
+   }
+   pagesStart = pos;
+   for (i = 0; i < npages; i++)
+   {
+      int nshelves;
+      const FONSatlasShelf * shelves;
+      if (!fons__getInt (&pos, end, &nshelves) || nshelves < 0 || nshelves > (int) ((end - pos) / sizeof (FONSatlasShelf)))
+         return 0;
+      shelves = (const FONSatlasShelf *)fons__get (&pos, end, nshelves * (int)sizeof (FONSatlasShelf));
+      if (fons__get (&pos, end, pageSize) == NULL)
+         return 0;
+      for (j = 0; j < nshelves; j++)
+      {
+         FONSatlasShelf s;
+         memcpy (&s, &shelves[j], sizeof (s));
+         if (s.y < 0 || s.height <= 0 || s.y + s.height > height || s.x < 0 || s.x > width)
+            return 0;
+      }
+   }
+   // Glyphs of the old pages go first, the fonts that match get theirs back below.
+   for (i = 0; i < stash->nfonts; i++)
+   {
+      stash->fonts[i]->nglyphs = 0;
+      fons__rebuildGlyphMap (stash->fonts[i]);
+   }
+   // Pages, all of them dirty.
+   pos = pagesStart;
+   for (i = 0; i < npages; i++)
+   {
+      FONSpage * page = &stash->pages[i];
+      int nshelves;
+      fons__getInt (&pos, end, &nshelves);
+      if (!fons__initPage (stash, page)) return 0;
+      if (nshelves > page->atlas->cshelves)
+      {
+         FONSatlasShelf * shelves = (FONSatlasShelf *)realloc (page->atlas->shelves, sizeof (FONSatlasShelf) * nshelves);
+         if (shelves == NULL) return 0;
+         page->atlas->shelves = shelves;
+         page->atlas->cshelves = nshelves;
+      }
+      memcpy (page->atlas->shelves, fons__get (&pos, end, nshelves * (int)sizeof (FONSatlasShelf)), nshelves * sizeof (FONSatlasShelf));
+      page->atlas->nshelves = nshelves;
+      fons__atlasRestore (page->atlas);
+      memcpy (page->data, fons__get (&pos, end, pageSize), pageSize);
+      fons__addDirty (page, 0, 0, width, height);
+   }
+   for (i = npages; i < stash->npages; i++)
+      fons__freePage (&stash->pages[i]);
+   stash->npages = npages;
+   stash->page = npages - 1;
+   // Glyph tables of the fonts that match.
+   pos = fontsStart;
+   for (i = 0; i < nfonts; i++)
+   {
+      char name[64];
+      int dataSize, checksum, nglyphs, idx;
+      const unsigned char * glyphs;
+      FONSfont * font;
+      memcpy (name, fons__get (&pos, end, 64), 64);
+      name[63] = '\0';
+      fons__getInt (&pos, end, &dataSize);
+      fons__getInt (&pos, end, &checksum);
+      fons__getInt (&pos, end, &nglyphs);
+      glyphs = fons__get (&pos, end, nglyphs * (int)sizeof (FONSglyph));
+      idx = fonsGetFontByName (stash, name);
+      if (idx == FONS_INVALID)
+         continue;
+      font = stash->fonts[idx];
+      if (font->dataSize != dataSize || (int)fons__checksum (font->data, font->dataSize) != checksum)
+         continue;
+      if (nglyphs > font->cglyphs)
+      {
+         FONSglyph * table = (FONSglyph *)realloc (font->glyphs, sizeof (FONSglyph) * nglyphs);
+         if (table == NULL) continue;
+         font->glyphs = table;
+         font->cglyphs = nglyphs;
+      }
+      memcpy (font->glyphs, glyphs, nglyphs * sizeof (FONSglyph));
+      font->nglyphs = nglyphs;
+      fons__rebuildGlyphMap (font);
+   }
+   return 1;
+}
+
+int fonsSaveAtlas (FONScontext * stash, const char * path)
+{
+   FILE * fp;
+   int size = 0, ok;
+   unsigned char * data = fonsSaveAtlasMem (stash, &size);
+   if (data == NULL) return 0;
+   fp = fopen (path, "wb");
+   ok = fp != NULL && fwrite (data, 1, size, fp) == (size_t)size;
+   if (fp) ok &= fclose (fp) == 0;
+   free (data);
+   return ok;
+}
+
+int fonsLoadAtlas (FONScontext * stash, const char * path)
+{
+   FILE * fp = fopen (path, "rb");
+   unsigned char * data = NULL;
+   int size, ok = 0;
+   if (fp == NULL) return 0;
+   fseek (fp, 0, SEEK_END);
+   size = (int)ftell (fp);
+   fseek (fp, 0, SEEK_SET);
+   if (size > 0)
+      data = (unsigned char *)malloc (size);
+   if (data != NULL && fread (data, 1, size, fp) == (size_t)size)
+      ok = fonsLoadAtlasMem (stash, data, size);
+   fclose (fp);
+   free (data);
+   return ok;
+}
+
+void fonsSetAsyncGlyphs (FONScontext * stash, int enabled)
+{
+   stash->asyncGlyphs = enabled;
+}
+
+int fonsTakeGlyphJobs (FONScontext * stash, FONSglyphJob * jobs, int max)
+{
+   int n = fons__mini (stash->njobs, max);
+   if (n <= 0) return 0;
+   memcpy (jobs, stash->jobs, sizeof (FONSglyphJob) * n);
+   stash->njobs -= n;
+   memmove (stash->jobs, stash->jobs + n, sizeof (FONSglyphJob) * stash->njobs);
+   return n;
+}
+
+// Renders a job with the fonts of the given stash into its own bitmap.
+static int fons__rasterizeGlyphJob (FONScontext * stash, FONSglyphJob * job)
+{
+   int advance, lsb, x0, y0, x1, y1;
+   int pad = fons__glyphPad (stash, job->blur);
+   float size = job->size / 10.0f, scale;
+   FONSfont * font;
+   if (job->font < 0 || job->font >= stash->nfonts) return 0;
+   font = stash->fonts[job->font];
+   stash->nscratch = 0;
+   scale = fons__tt_getPixelHeightScale (&font->font, size);
+   fons__buildGlyph (stash, font, job->glyph, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+   if (x1 - x0 + pad * 2 != job->width || y1 - y0 + pad * 2 != job->height) return 0;
+   job->bitmap = (unsigned char *)calloc (job->width * job->height, 1);
+   if (job->bitmap == NULL) return 0;
+   fons__rasterizeGlyph (stash, font, job->glyph, size, scale, x0, y0, pad, job->blur, job->bitmap, job->width, job->height, job->width);
    return 1;
 }
 
+int fonsRasterizeGlyphJob (FONScontext * worker, FONSglyphJob * job)
+{
+   int ok, rasterizer = worker->rasterizer;
+   if (job->bitmap != NULL) return 1;
+   // With the rasterizer the glyph box was taken from.
+   worker->rasterizer = job->rasterizer;
+   ok = fons__rasterizeGlyphJob (worker, job);
+   worker->rasterizer = rasterizer;
+   return ok;
+}
+
+int fonsCompleteGlyphJob (FONScontext * stash, FONSglyphJob * job)
+{
+   int y, ok = 0;
+   FONSpage * page;
+   stash->npending--;
+   if (job->page >= 0 && job->page < stash->npages && stash->pages[job->page].epoch == job->epoch)
+   {
+      page = &stash->pages[job->page];
+      if (job->bitmap == NULL)
+         fons__rasterizeGlyphJob (stash, job);
+      if (job->bitmap != NULL)
+      {
+         for (y = 0; y < job->height; y++)
+            memcpy (&page->data[job->x + (job->y + y) * stash->params.width], &job->bitmap[y * job->width], job->width);
+         fons__addDirty (page, job->x, job->y, job->x + job->width, job->y + job->height);
+         ok = 1;
+      }
+   }
+   free (job->bitmap);
+   job->bitmap = NULL;
+   return ok;
+}
+
+int fonsPendingGlyphJobs (FONScontext * stash)
+{
+   return stash->npending;
+}
+
 
 #endif
@@ -18,12 +18,24 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <stddef.h>
 #include "nanovg.h"
 #define FONTSTASH_IMPLEMENTATION
 #include "fontstash.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+// Four wide SSE2 or NEON versions of the per point loops of path flattening and join calculation,
+// of the vertices of glyph quads and of the pixel conversions of image loading. They produce the same values as the scalar loops;
+// define NVG_NO_SIMD to keep the scalar loops only.
+#if !defined(NVG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define NVG_SIMD 1
+#elif !defined(NVG_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NVG_SIMD 1
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4100)  // unreferenced formal parameter
 #pragma warning(disable: 4127)  // conditional expression is constant
@@ -31,15 +43,27 @@
 #pragma warning(disable: 4706)  // assignment within conditional expression
 #endif
 
-#define NVG_INIT_FONTIMAGE_SIZE  512
-#define NVG_MAX_FONTIMAGE_SIZE   2048
-#define NVG_MAX_FONTIMAGES       4
+#define NVG_FONT_PAGE_SIZE       512
+#define NVG_MAX_FONT_PAGES       8
 
 #define NVG_INIT_COMMANDS_SIZE 256
 #define NVG_INIT_POINTS_SIZE 128
 #define NVG_INIT_PATHS_SIZE 16
 #define NVG_INIT_VERTS_SIZE 256
 #define NVG_MAX_STATES 32
+#define NVG_MAX_DRAWLISTS 8
+#define NVG_MAX_LAYER_DEPTH 8
+#define NVG_MAX_BACKDROP_PASSES 6
+#define NVG_MAX_MEMORY_HISTORY 120
+#define NVG_TEXT_CACHE_SIZE 512			// shaped runs kept by nvgText() and nvgTextBounds()
+#define NVG_TEXT_CACHE_BUCKETS 1024
+#define NVG_TEXT_CACHE_MAX_BYTES 256		// longer strings are shaped every time
+#define NVG_TEXT_BATCH 16				// glyph quads gathered by nvgText() before their vertices are written
+#define NVG_ICON_CACHE_SIZE 256			// glyphs kept by nvgIcon() and nvgIconBounds(), direct mapped
+#define NVG_ICON_ORIGIN 1024.0f			// icons are resolved at this origin, clear of fontstash's rounding of negative positions
+#define NVG_MAX_TRIANGULATE_VERTS 256	// larger concave fills keep using the stencil
+#define NVG_RAMP_WIDTH 256				// texels per multi-stop gradient
+#define NVG_RAMP_ROWS 64				// gradients per ramp texture
 
 #define NVG_KAPPA90 0.5522847493f	// Length proportional to radius of a cubic bezier handle for 90deg arcs.
 
@@ -71,6 +95,7 @@ struct NVGstate {
 	int lineCap;
 	float alpha;
 	float xform[6];
+	int xformKind;		// NVGxformKind of xform
 	NVGscissor scissor;
 	float fontSize;
 	float letterSpacing;
@@ -81,6 +106,35 @@ struct NVGstate {
 };
 typedef struct NVGstate NVGstate;
 
+// Shape of the linear part of a transform, from the cheapest to apply to the most expensive.
+// Points, scales and inverses take shortcuts for the first two.
+enum NVGxformKind {
+	NVG_XFORM_TRANSLATE = 0,	// identity plus a translation
+	NVG_XFORM_SCALE,			// axis aligned, xform[1] and xform[2] are zero
+	NVG_XFORM_GENERAL,
+};
+
+// Groups of state fields, logged as a whole the first time they change after nvgSave().
+// Translation only touches the origin of the transform, so the linear part is a group of its own.
+enum NVGstateFields {
+	NVG_STATE_FILL = 1<<0,
+	NVG_STATE_STROKE = 1<<1,
+	NVG_STATE_STYLE = 1<<2,		// stroke width, miter limit, joins, caps and alpha
+	NVG_STATE_ORIGIN = 1<<3,	// xform[4], xform[5]
+	NVG_STATE_LINEAR = 1<<4,	// xform[0] to xform[3]
+	NVG_STATE_SCISSOR = 1<<5,
+	NVG_STATE_TEXT = 1<<6,
+	NVG_STATE_XFORM = NVG_STATE_ORIGIN | NVG_STATE_LINEAR,
+	NVG_STATE_ALL = (1<<7) - 1,
+};
+
+// A level of the state stack: the values the fields in the mask had when nvgSave() was called.
+struct NVGsave {
+	int fields;
+	NVGstate saved;
+};
+typedef struct NVGsave NVGsave;
+
 struct NVGpoint {
 	float x,y;
 	float dx, dy;
@@ -100,32 +154,358 @@ struct NVGpathCache {
 	NVGvertex* verts;
 	int nverts;
 	int cverts;
+	int* nodes;		// scratch for nvg__triangulateFill()
+	int cnodes;
 	float bounds[4];
 };
 typedef struct NVGpathCache NVGpathCache;
 
+// The part of the context path flattening and expansion work on. Deferred tessellation gives
+// every recorded path its own, so that they can be processed at the same time.
+struct NVGtess {
+	NVGpathCache* cache;
+	const float* commands;
+	int ncommands;
+	float tessTol;
+	float distTol;
+	float fringeWidth;
+	int tessMode;
+	float curveTol;		// largest deviation of a flattened curve in adaptive mode
+	int curveSegments;
+	int triangulate;	// the backend takes fills as triangle lists, see NVGparams.triangleFills
+	int peakPoints;
+	int peakPaths;
+	int peakVerts;
+};
+typedef struct NVGtess NVGtess;
+
+enum NVGdeferredType {
+	NVG_DEFER_FILL = 0,
+	NVG_DEFER_STROKE = 1,
+	NVG_DEFER_TRIANGLES = 2,
+	NVG_DEFER_SHAPE = 3,
+};
+
+// A fill, stroke or triangle submission waiting for nvg__flushDeferred().
+struct NVGdeferredOp {
+	int type;
+	NVGpaint paint;
+	NVGscissor scissor;
+	float strokeWidth;
+	float expandWidth;	// width the outline is expanded by, the fringe for fills
+	int lineCap;
+	int lineJoin;
+	float miterLimit;
+	int first, count;	// path commands in deferCommands, or vertices in deferVerts
+	float shape[4];
+	NVGtess tess;
+};
+typedef struct NVGdeferredOp NVGdeferredOp;
+
+enum NVGtextRunKind {
+	NVG_TEXTRUN_QUADS = 1,
+	NVG_TEXTRUN_BOUNDS = 2,
+};
+
+// Everything fontstash's layout of a string depends on. fx, fy are the fractional parts of the
+// origin in font pixels, glyph positions are rounded from them.
+struct NVGtextKey {
+	unsigned int hash;
+	int kind;
+	int font;
+	int align;
+	int nbytes;
+	float size, spacing, blur;
+	float fx, fy;
+};
+typedef struct NVGtextKey NVGtextKey;
+
+// A shaped string, positions are relative to the integer part of the origin in font pixels.
+struct NVGtextRun {
+	NVGtextKey key;
+	char* string;
+	int cstring;
+	FONSquad* quads;
+	int nquads;
+	int cquads;
+	float x;			// pen position nvgText() returns, or the advance for bounds
+	float minx, maxx;	// horizontal bounds for nvgTextBounds(), before the alignment
+	float qminx, qminy;	// smallest glyph corner, at most 0
+	int generation;		// font atlas the quads point into, -1 while not filled in
+	int next;			// hash bucket chain
+	int prev, lruNext;	// use order, most recent first
+};
+typedef struct NVGtextRun NVGtextRun;
+
+// A single glyph resolved for a font state, positions are relative to the integer origin in font pixels.
+struct NVGicon {
+	int font;
+	int codepoint;
+	int align;
+	float size, blur;
+	FONSquad quad;
+	int hasQuad;		// 0 for glyphs without a bitmap, e.g. space
+	float advance;
+	float minx, maxx;	// horizontal bounds before the alignment, like NVGtextRun
+	float miny, maxy;	// line bounds at y = 0
+	int generation;		// font atlas the quad points into, -1 while not filled in
+};
+typedef struct NVGicon NVGicon;
+
+// Texture of NVG_RAMP_ROWS multi-stop gradients. The pixels are kept since a row is updated from the whole image.
+struct NVGrampPage {
+	int image;
+	unsigned char* pixels;
+};
+typedef struct NVGrampPage NVGrampPage;
+
+// Offscreen image drawn into between nvgBeginLayer() and nvgEndLayer().
+struct NVGlayer {
+	int used;
+	int image;			// 0 until first begun
+	int width, height;	// of the image in device pixels
+	float x, y;			// device pixel of the view at the top left corner of the image
+	float ratio;		// device pixel ratio it was drawn at
+	int valid;			// holds the drawing of a completed nvgEndLayer()
+};
+typedef struct NVGlayer NVGlayer;
+
+// The target drawn to before an open layer, restored by nvgEndLayer().
+struct NVGlayerScope {
+	int layer;
+	int viewWidth, viewHeight;
+	float devicePxRatio;
+	float xform[6];		// from the view to its pixels
+};
+typedef struct NVGlayerScope NVGlayerScope;
+
+// Blurred pixels under a rectangle, see nvgCaptureBackdrop().
+struct NVGbackdrop {
+	int used;
+	int image;			// half the size of the rectangle, 0 until first captured
+	int width, height;	// of the rectangle in device pixels
+	float x, y;			// device pixel of the view at its top left corner
+	float ratio;		// device pixel ratio it was captured at
+	int valid;			// holds the pixels of a successful capture
+};
+typedef struct NVGbackdrop NVGbackdrop;
+
+// Frame capture, see nvgCaptureFrames()
+#define NVG_CAPTURE_VERSION 1
+
+enum NVGcaptureOp {
+	NVG_CAPTURE_BEGIN_FRAME = 1,	// width, height, device pixel ratio
+	NVG_CAPTURE_END_FRAME,
+	NVG_CAPTURE_STATE,				// mask of the groups that changed, each group of the NVGstate as is
+	NVG_CAPTURE_IMAGE,				// id, width, height, before the first draw whose paint uses the image
+	NVG_CAPTURE_FONT,				// id, name length, name, before the first draw with the font
+	NVG_CAPTURE_GEOMETRY,			// id, command count, commands in local space, before its first draw
+	NVG_CAPTURE_FILL,				// command count, commands
+	NVG_CAPTURE_STROKE,
+	NVG_CAPTURE_FILLSTROKE,
+	NVG_CAPTURE_TEXT,				// x, y, byte count, bytes
+	NVG_CAPTURE_ICON,				// x, y, codepoint
+	NVG_CAPTURE_SHAPE,				// x, y, w, h, r, pad, outside
+	NVG_CAPTURE_FILL_GEOMETRY,		// id
+	NVG_CAPTURE_STROKE_GEOMETRY,
+};
+
+typedef struct NVGcapture NVGcapture;
+
 struct NVGcontext {
 	NVGparams params;
 	float* commands;
 	int ccommands;
 	int ncommands;
 	float commandx, commandy;
-	NVGstate states[NVG_MAX_STATES];
+	NVGstate state;
+	NVGsave saves[NVG_MAX_STATES];
 	int nstates;
 	NVGpathCache* cache;
 	float tessTol;
 	float distTol;
 	float fringeWidth;
+	int tessMode;
+	float tessScale;
+	int tessBudget;
 	float devicePxRatio;
+	float viewWidth, viewHeight;
 	struct FONScontext* fs;
-	int fontImages[NVG_MAX_FONTIMAGES];
-	int fontImageIdx;
+	int fontImages[FONS_MAX_PAGES];		// one texture per atlas page
+	int fontEpochs[FONS_MAX_PAGES];
+	int* retiredFontImages;				// textures of evicted pages, still drawn from until the frame ends
+	int nretiredFontImages;
+	int cretiredFontImages;
+	int atlasGeneration;
+	NVGtextRun* textRuns;
+	int ntextRuns;
+	int textBuckets[NVG_TEXT_CACHE_BUCKETS];
+	int textFirst, textLast;
+	int textCacheHits;
+	int textCacheMisses;
+	NVGicon* icons;
+	NVGrampPage* rampPages;			// gradient i is row i % NVG_RAMP_ROWS of page i / NVG_RAMP_ROWS
+	int nrampPages;
+	int* rampNext;					// per gradient -1 while in use, else the next free gradient + 1
+	int nramps;
+	int cramps;
+	int freeRamp;					// first free gradient + 1, 0 for none
+	NVGdrawList* drawLists[NVG_MAX_DRAWLISTS];
+	int ndrawLists;
+	int drawListBegins[NVG_MAX_DRAWLISTS];	// nesting depth at which list i was begun
+	int drawListDepth;				// also counts lists begun without recording, NULL or nested too deeply
+	int recordOnly;
+	NVGlayer* layers;				// layer i is handle i + 1
+	int nlayers;
+	int clayers;
+	NVGlayerScope layerStack[NVG_MAX_LAYER_DEPTH];
+	int nlayerStack;
+	float layerXform[6];			// maps the view to the pixels of the current target, identity outside layers
+	NVGbackdrop* backdrops;			// backdrop i is handle i + 1
+	int nbackdrops;
+	int cbackdrops;
 	int drawCallCount;
 	int fillTriCount;
 	int strokeTriCount;
 	int textTriCount;
+	int atlasUploads;
+	int atlasUploadBytes;
+	int peakPoints;
+	int peakPaths;
+	int peakVerts;
+	int peakCommands;
+	int peakDeferOps;
+	int peakDeferCommands;
+	int peakDeferVerts;
+	int curveSegments;
+	NVGframeStats frameStats;
+	NVGframeMemory memoryHistory[NVG_MAX_MEMORY_HISTORY];
+	int memoryHead;
+	int memoryFrames;
+	int shrinkFrames;				// see nvgMemoryShrinkPolicy(), 0 when off
+	float shrinkRatio;
+	NVGprofileCallback profile;
+	void* profileUser;
+	NVGfontLoader fontLoader;
+	void* fontLoaderUser;
+	int loadingFont;
+	NVGcontext* measureParent;	// set on measure contexts
+	NVGparallelCallback parallel;
+	void* parallelUser;
+	NVGdeferredOp* deferOps;
+	int ndeferOps;
+	int cdeferOps;
+	float* deferCommands;
+	int ndeferCommands;
+	int cdeferCommands;
+	int deferPathFirst;	// offset of the current path in deferCommands, -1 if not copied yet
+	NVGvertex* deferVerts;
+	int ndeferVerts;
+	int cdeferVerts;
+	NVGpathCache** deferCaches;
+	int ndeferCaches;
+	int cdeferCaches;
+	NVGpath* geomPaths;
+	int cgeomPaths;
+	NVGvertex* geomVerts;
+	int cgeomVerts;
+	NVGcapture* capture;	// of the frames requested with nvgCaptureFrames()
+};
+
+static void nvg__flushDeferred(NVGcontext* ctx);
+static int nvg__capturing(NVGcontext* ctx);
+static void nvg__deleteCapture(NVGcontext* ctx);
+static void nvg__captureMute(NVGcontext* ctx, int delta);
+static void nvg__captureBeginFrame(NVGcontext* ctx, int width, int height, float devicePixelRatio);
+static void nvg__captureEndFrame(NVGcontext* ctx);
+static void nvg__captureDraw(NVGcontext* ctx, int op);
+static void nvg__captureText(NVGcontext* ctx, float x, float y, const char* string, const char* end);
+static void nvg__captureIcon(NVGcontext* ctx, float x, float y, int codepoint);
+static void nvg__captureShape(NVGcontext* ctx, float x, float y, float w, float h, float r, float pad, int outside);
+static void nvg__captureGeometry(NVGcontext* ctx, int op, const NVGgeometry* geom);
+
+enum NVGdrawCmdType {
+	NVG_DRAWCMD_FILL = 0,
+	NVG_DRAWCMD_STROKE = 1,
+	NVG_DRAWCMD_TRIANGLES = 2,
+	NVG_DRAWCMD_SHAPE = 3,
+	NVG_DRAWCMD_PLOT = 4,
+	NVG_DRAWCMD_TEXT = 5,	// recorded on a measure context, shaped on replay
+};
+
+struct NVGdrawCmd {
+	int type;
+	NVGpaint paint;
+	NVGscissor scissor;
+	float fringe;
+	float strokeWidth;
+	float bounds[4];
+	float cullBounds[4];	// of all vertices, for skipping the command on replay
+	float shape[4];
+	int pathOffset;
+	int npaths;
+	int vertOffset;
+	int nverts;
+};
+typedef struct NVGdrawCmd NVGdrawCmd;
+
+struct NVGdrawPath {
+	NVGpath path;
+	int fillOffset;
+	int strokeOffset;
+};
+typedef struct NVGdrawPath NVGdrawPath;
+
+// Text drawn on a measure context: the string and the font state, the fill is the command's paint.
+struct NVGdrawText {
+	float x, y;
+	float xform[6];
+	float alpha;
+	float fontSize;
+	float letterSpacing;
+	float fontBlur;
+	int textAlign;
+	int fontId;
+	int codepoint;	// of an icon, -1 for text
+	int charOffset;
+	int nchars;
+};
+typedef struct NVGdrawText NVGdrawText;
+
+struct NVGdrawList {
+	NVGdrawCmd* cmds;
+	int ncmds;
+	int ccmds;
+	NVGdrawPath* paths;
+	int npaths;
+	int cpaths;
+	NVGvertex* verts;
+	int nverts;
+	int cverts;
+	NVGpath* replayPaths;
+	int creplayPaths;
+	NVGplotDraw* plots;	// indexed by pathOffset of plot commands
+	int nplots;
+	int cplots;
+	NVGdrawText* texts;	// indexed by pathOffset of text commands
+	int ntexts;
+	int ctexts;
+	char* chars;
+	int nchars;
+	int cchars;
+	float xform[6];
+	NVGscissor scissor;
+	float devicePxRatio;	// tessellation tolerances and glyph sizes depend on it
+	int atlasGeneration;
+	int hasText;
+	int failed;
+	int valid;
+	int recordOnly;
+	int savedStats[4];
 };
 
+static void nvg__replayText(NVGcontext* ctx, NVGdrawList* list, NVGdrawCmd* cmd, NVGscissor* scissor);
+
 static float nvg__sqrtf(float a) { return sqrtf(a); }
 static float nvg__modf(float a, float b) { return fmodf(a, b); }
 static float nvg__sinf(float a) { return sinf(a); }
@@ -155,6 +535,58 @@ static float nvg__normalize(float *x, float* y)
 	return d;
 }
 
+#if defined(NVG_SIMD) && !defined(__aarch64__)
+typedef __m128 NVGv4;
+static NVGv4 nvg__v4set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static NVGv4 nvg__v4load(const float* src) { return _mm_loadu_ps(src); }
+static NVGv4 nvg__v4splat(float a) { return _mm_set1_ps(a); }
+static void nvg__v4store(float* dst, NVGv4 a) { _mm_storeu_ps(dst, a); }
+static NVGv4 nvg__v4add(NVGv4 a, NVGv4 b) { return _mm_add_ps(a, b); }
+static NVGv4 nvg__v4sub(NVGv4 a, NVGv4 b) { return _mm_sub_ps(a, b); }
+static NVGv4 nvg__v4mul(NVGv4 a, NVGv4 b) { return _mm_mul_ps(a, b); }
+static NVGv4 nvg__v4div(NVGv4 a, NVGv4 b) { return _mm_div_ps(a, b); }
+static NVGv4 nvg__v4sqrt(NVGv4 a) { return _mm_sqrt_ps(a); }
+static NVGv4 nvg__v4min(NVGv4 a, NVGv4 b) { return _mm_min_ps(a, b); }
+static NVGv4 nvg__v4max(NVGv4 a, NVGv4 b) { return _mm_max_ps(a, b); }
+// Lane wise a > b ? x : y
+static NVGv4 nvg__v4selgt(NVGv4 a, NVGv4 b, NVGv4 x, NVGv4 y)
+{
+	__m128 m = _mm_cmpgt_ps(a, b);
+	return _mm_or_ps(_mm_and_ps(m, x), _mm_andnot_ps(m, y));
+}
+// Bit i is set when a > b in lane i
+static int nvg__v4gtmask(NVGv4 a, NVGv4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+// Lanes 0 and 2 of a, 1 and 3 of b
+static NVGv4 nvg__v4evenodd(NVGv4 a, NVGv4 b)
+{
+	__m128 t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 2, 0));	// a0 a2 b1 b3
+	return _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 1, 2, 0));
+}
+#elif defined(NVG_SIMD)
+typedef float32x4_t NVGv4;
+static NVGv4 nvg__v4set(float a, float b, float c, float d) { float v[4] = { a, b, c, d }; return vld1q_f32(v); }
+static NVGv4 nvg__v4load(const float* src) { return vld1q_f32(src); }
+static NVGv4 nvg__v4splat(float a) { return vdupq_n_f32(a); }
+static void nvg__v4store(float* dst, NVGv4 a) { vst1q_f32(dst, a); }
+static NVGv4 nvg__v4add(NVGv4 a, NVGv4 b) { return vaddq_f32(a, b); }
+static NVGv4 nvg__v4sub(NVGv4 a, NVGv4 b) { return vsubq_f32(a, b); }
+static NVGv4 nvg__v4mul(NVGv4 a, NVGv4 b) { return vmulq_f32(a, b); }
+static NVGv4 nvg__v4div(NVGv4 a, NVGv4 b) { return vdivq_f32(a, b); }
+static NVGv4 nvg__v4sqrt(NVGv4 a) { return vsqrtq_f32(a); }
+static NVGv4 nvg__v4min(NVGv4 a, NVGv4 b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+static NVGv4 nvg__v4max(NVGv4 a, NVGv4 b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+static NVGv4 nvg__v4selgt(NVGv4 a, NVGv4 b, NVGv4 x, NVGv4 y) { return vbslq_f32(vcgtq_f32(a, b), x, y); }
+static int nvg__v4gtmask(NVGv4 a, NVGv4 b)
+{
+	static const uint32_t bits[4] = { 1, 2, 4, 8 };
+	return (int)vaddvq_u32(vandq_u32(vcgtq_f32(a, b), vld1q_u32(bits)));
+}
+static NVGv4 nvg__v4evenodd(NVGv4 a, NVGv4 b)
+{
+	static const uint32_t odd[4] = { 0, ~0u, 0, ~0u };
+	return vbslq_f32(vld1q_u32(odd), b, a);
+}
+#endif
 
 static void nvg__deletePathCache(NVGpathCache* c)
 {
@@ -162,6 +594,7 @@ static void nvg__deletePathCache(NVGpathCache* c)
 	if (c->points != NULL) free(c->points);
 	if (c->paths != NULL) free(c->paths);
 	if (c->verts != NULL) free(c->verts);
+	if (c->nodes != NULL) free(c->nodes);
 	free(c);
 }
 
@@ -200,6 +633,11 @@ static void nvg__setDevicePixelRatio(NVGcontext* ctx, float ratio)
 	ctx->devicePxRatio = ratio;
 }
 
+static int nvg__fontImageFlags(NVGcontext* ctx)
+{
+	return ctx->params.distanceFieldText ? NVG_IMAGE_DISTANCE_FIELD : 0;
+}
+
 NVGcontext* nvgCreateInternal(NVGparams* params)
 {
 	FONSparams fontParams;
@@ -209,13 +647,16 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	memset(ctx, 0, sizeof(NVGcontext));
 
 	ctx->params = *params;
-	for (i = 0; i < NVG_MAX_FONTIMAGES; i++)
+	for (i = 0; i < FONS_MAX_PAGES; i++)
 		ctx->fontImages[i] = 0;
 
 	ctx->commands = (float*)malloc(sizeof(float)*NVG_INIT_COMMANDS_SIZE);
 	if (!ctx->commands) goto error;
 	ctx->ncommands = 0;
 	ctx->ccommands = NVG_INIT_COMMANDS_SIZE;
+	ctx->deferPathFirst = -1;
+	ctx->tessScale = 1.0f;
+	nvgTransformIdentity(ctx->layerXform);
 
 	ctx->cache = nvg__allocPathCache();
 	if (ctx->cache == NULL) goto error;
@@ -229,9 +670,11 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 
 	// Init font rendering
 	memset(&fontParams, 0, sizeof(fontParams));
-	fontParams.width = NVG_INIT_FONTIMAGE_SIZE;
-	fontParams.height = NVG_INIT_FONTIMAGE_SIZE;
-	fontParams.flags = FONS_ZERO_TOPLEFT;
+	fontParams.width = NVG_FONT_PAGE_SIZE;
+	fontParams.height = NVG_FONT_PAGE_SIZE;
+	fontParams.flags = FONS_ZERO_TOPLEFT | (params->distanceFieldText ? FONS_DISTANCE_FIELD : 0) |
+					   (params->shaderTextBlur ? FONS_BLUR_IN_RENDERER : 0);
+	fontParams.maxPages = NVG_MAX_FONT_PAGES;
 	fontParams.renderCreate = NULL;
 	fontParams.renderUpdate = NULL;
 	fontParams.renderDraw = NULL;
@@ -240,10 +683,8 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	ctx->fs = fonsCreateInternal(&fontParams);
 	if (ctx->fs == NULL) goto error;
 
-	// Create font texture
-	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, 0, NULL);
-	if (ctx->fontImages[0] == 0) goto error;
-	ctx->fontImageIdx = 0;
+	// Font textures are created when text first uploads to their page, see nvg__syncFontPages(), so
+	// that a context drawing no text allocates none.
 
 	return ctx;
 
@@ -261,18 +702,52 @@ void nvgDeleteInternal(NVGcontext* ctx)
 {
 	int i;
 	if (ctx == NULL) return;
+	nvg__deleteCapture(ctx);
 	if (ctx->commands != NULL) free(ctx->commands);
 	if (ctx->cache != NULL) nvg__deletePathCache(ctx->cache);
+	for (i = 0; i < ctx->ndeferCaches; i++)
+		nvg__deletePathCache(ctx->deferCaches[i]);
+	free(ctx->deferCaches);
+	free(ctx->deferOps);
+	free(ctx->deferCommands);
+	free(ctx->deferVerts);
+	free(ctx->geomPaths);
+	free(ctx->geomVerts);
+	if (ctx->textRuns != NULL) {
+		for (i = 0; i < ctx->ntextRuns; i++) {
+			free(ctx->textRuns[i].string);
+			free(ctx->textRuns[i].quads);
+		}
+		free(ctx->textRuns);
+	}
+	free(ctx->icons);
+	for (i = 0; i < ctx->nrampPages; i++) {
+		nvgDeleteImage(ctx, ctx->rampPages[i].image);
+		free(ctx->rampPages[i].pixels);
+	}
+	free(ctx->rampPages);
+	free(ctx->rampNext);
+	for (i = 0; i < ctx->nlayers; i++)
+		if (ctx->layers[i].image != 0)
+			nvgDeleteImage(ctx, ctx->layers[i].image);
+	free(ctx->layers);
+	for (i = 0; i < ctx->nbackdrops; i++)
+		if (ctx->backdrops[i].image != 0)
+			nvgDeleteImage(ctx, ctx->backdrops[i].image);
+	free(ctx->backdrops);
 
 	if (ctx->fs)
 		fonsDeleteInternal(ctx->fs);
 
-	for (i = 0; i < NVG_MAX_FONTIMAGES; i++) {
+	for (i = 0; i < FONS_MAX_PAGES; i++) {
 		if (ctx->fontImages[i] != 0) {
 			nvgDeleteImage(ctx, ctx->fontImages[i]);
 			ctx->fontImages[i] = 0;
 		}
 	}
+	for (i = 0; i < ctx->nretiredFontImages; i++)
+		nvgDeleteImage(ctx, ctx->retiredFontImages[i]);
+	free(ctx->retiredFontImages);
 
 	if (ctx->params.renderDelete != NULL)
 		ctx->params.renderDelete(ctx->params.userPtr);
@@ -287,52 +762,142 @@ void nvgBeginFrame(NVGcontext* ctx, int windowWidth, int windowHeight, float dev
 		ctx->fillTriCount+ctx->strokeTriCount+ctx->textTriCount);*/
 
 	ctx->nstates = 0;
+	ctx->ndrawLists = 0;
+	ctx->drawListDepth = 0;
+	ctx->recordOnly = 0;
+	ctx->nlayerStack = 0;
+	nvgTransformIdentity(ctx->layerXform);
+	ctx->ndeferOps = 0;
+	ctx->ndeferCommands = 0;
+	ctx->ndeferVerts = 0;
+	ctx->deferPathFirst = -1;
 	nvgSave(ctx);
 	nvgReset(ctx);
 
 	nvg__setDevicePixelRatio(ctx, devicePixelRatio);
+	ctx->viewWidth = (float)windowWidth;
+	ctx->viewHeight = (float)windowHeight;
 	
-	ctx->params.renderViewport(ctx->params.userPtr, windowWidth, windowHeight);
+	ctx->params.renderViewport(ctx->params.userPtr, windowWidth, windowHeight, devicePixelRatio);
 
 	ctx->drawCallCount = 0;
 	ctx->fillTriCount = 0;
 	ctx->strokeTriCount = 0;
 	ctx->textTriCount = 0;
+	ctx->atlasUploads = 0;
+	ctx->atlasUploadBytes = 0;
+	ctx->peakPoints = 0;
+	ctx->peakPaths = 0;
+	ctx->peakVerts = 0;
+	ctx->peakCommands = 0;
+	ctx->peakDeferOps = 0;
+	ctx->peakDeferCommands = 0;
+	ctx->peakDeferVerts = 0;
+	ctx->curveSegments = 0;
+	ctx->textCacheHits = 0;
+	ctx->textCacheMisses = 0;
+	nvg__captureBeginFrame(ctx, windowWidth, windowHeight, devicePixelRatio);
 }
 
 void nvgCancelFrame(NVGcontext* ctx)
 {
+	ctx->ndeferOps = 0;
+	ctx->ndeferCommands = 0;
+	ctx->ndeferVerts = 0;
+	ctx->deferPathFirst = -1;
+	ctx->nlayerStack = 0;
 	ctx->params.renderCancel(ctx->params.userPtr);
+	nvg__captureEndFrame(ctx);
+}
+
+static void nvg__beginProfile(NVGcontext* ctx, const char* name)
+{
+	if (ctx->profile != NULL)
+		ctx->profile(ctx->profileUser, name, 1);
+}
+
+static void nvg__endProfile(NVGcontext* ctx)
+{
+	if (ctx->profile != NULL)
+		ctx->profile(ctx->profileUser, NULL, 0);
+}
+
+void nvgSetProfileCallback(NVGcontext* ctx, NVGprofileCallback callback, void* userPtr)
+{
+	ctx->profile = callback;
+	ctx->profileUser = userPtr;
+}
+
+void nvgSetParallelCallback(NVGcontext* ctx, NVGparallelCallback callback, void* userPtr)
+{
+	nvg__flushDeferred(ctx);
+	ctx->parallel = callback;
+	ctx->parallelUser = userPtr;
+}
+
+void nvgTessellationMode(NVGcontext* ctx, int mode, float tolerance)
+{
+	ctx->tessMode = mode;
+	ctx->tessScale = nvg__maxf(tolerance, 0.01f);
+}
+
+void nvgCurrentTessellation(NVGcontext* ctx, int* mode, float* tolerance)
+{
+	*mode = ctx->tessMode;
+	*tolerance = ctx->tessScale;
+}
+
+void nvgTessellationBudget(NVGcontext* ctx, int segments)
+{
+	ctx->tessBudget = nvg__maxi(segments, 0);
 }
 
+static void nvg__shrinkFrameMemory(NVGcontext* ctx);
+
 void nvgEndFrame(NVGcontext* ctx)
 {
+	NVGframeStats* stats = &ctx->frameStats;
+
+	while (ctx->nlayerStack > 0)
+		nvgEndLayer(ctx);
+	nvg__captureEndFrame(ctx);
+	nvg__flushDeferred(ctx);
+
+	nvg__beginProfile(ctx, "nanovg flush");
 	ctx->params.renderFlush(ctx->params.userPtr);
-	if (ctx->fontImageIdx != 0) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
-		int i, j, iw, ih;
-		// delete images that smaller than current one
-		if (fontImage == 0)
-			return;
-		nvgImageSize(ctx, fontImage, &iw, &ih);
-		for (i = j = 0; i < ctx->fontImageIdx; i++) {
-			if (ctx->fontImages[i] != 0) {
-				int nw, nh;
-				nvgImageSize(ctx, ctx->fontImages[i], &nw, &nh);
-				if (nw < iw || nh < ih)
-					nvgDeleteImage(ctx, ctx->fontImages[i]);
-				else
-					ctx->fontImages[j++] = ctx->fontImages[i];
-			}
-		}
-		// make current font image to first
-		ctx->fontImages[j++] = ctx->fontImages[0];
-		ctx->fontImages[0] = fontImage;
-		ctx->fontImageIdx = 0;
-		// clear all images after j
-		for (i = j; i < NVG_MAX_FONTIMAGES; i++)
-			ctx->fontImages[i] = 0;
-	}
+	nvg__endProfile(ctx);
+
+	memset(stats, 0, sizeof(*stats));
+	if (ctx->params.renderStats != NULL)
+		ctx->params.renderStats(ctx->params.userPtr, stats);
+	stats->drawCalls = ctx->drawCallCount;
+	stats->fillTriCount = ctx->fillTriCount;
+	stats->strokeTriCount = ctx->strokeTriCount;
+	stats->textTriCount = ctx->textTriCount;
+	stats->atlasUploads = ctx->atlasUploads;
+	stats->atlasUploadBytes = ctx->atlasUploadBytes;
+	stats->peakPoints = ctx->peakPoints;
+	stats->peakPaths = ctx->peakPaths;
+	stats->peakVerts = ctx->peakVerts;
+	stats->curveSegments = ctx->curveSegments;
+	stats->textCacheHits = ctx->textCacheHits;
+	stats->textCacheMisses = ctx->textCacheMisses;
+	stats->memory.commands = ctx->peakCommands;
+	stats->memory.points = ctx->peakPoints;
+	stats->memory.paths = ctx->peakPaths;
+	stats->memory.verts = ctx->peakVerts;
+	stats->memory.deferOps = ctx->peakDeferOps;
+	stats->memory.deferCommands = ctx->peakDeferCommands;
+	stats->memory.deferVerts = ctx->peakDeferVerts;
+	ctx->memoryHistory[ctx->memoryHead] = stats->memory;
+	ctx->memoryHead = (ctx->memoryHead + 1) % NVG_MAX_MEMORY_HISTORY;
+	ctx->memoryFrames = nvg__mini(ctx->memoryFrames + 1, NVG_MAX_MEMORY_HISTORY);
+	if (ctx->shrinkFrames > 0 && ctx->memoryFrames >= ctx->shrinkFrames)
+		nvg__shrinkFrameMemory(ctx);
+
+	// Nothing drawn from the textures of evicted pages is left.
+	while (ctx->nretiredFontImages > 0)
+		nvgDeleteImage(ctx, ctx->retiredFontImages[--ctx->nretiredFontImages]);
 }
 
 NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b)
@@ -433,7 +998,66 @@ NVGcolor nvgHSLA(float h, float s, float l, unsigned char a)
 
 static NVGstate* nvg__getState(NVGcontext* ctx)
 {
-	return &ctx->states[ctx->nstates-1];
+	return &ctx->state;
+}
+
+static int nvg__xformKind(const float* t)
+{
+	if (t[1] != 0.0f || t[2] != 0.0f)
+		return NVG_XFORM_GENERAL;
+	if (t[0] != 1.0f || t[3] != 1.0f)
+		return NVG_XFORM_SCALE;
+	return NVG_XFORM_TRANSLATE;
+}
+
+static void nvg__copyState(NVGstate* dst, const NVGstate* src, int fields)
+{
+	if (fields & NVG_STATE_FILL)
+		dst->fill = src->fill;
+	if (fields & NVG_STATE_STROKE)
+		dst->stroke = src->stroke;
+	if (fields & NVG_STATE_STYLE) {
+		dst->strokeWidth = src->strokeWidth;
+		dst->miterLimit = src->miterLimit;
+		dst->lineJoin = src->lineJoin;
+		dst->lineCap = src->lineCap;
+		dst->alpha = src->alpha;
+	}
+	if (fields & NVG_STATE_ORIGIN) {
+		dst->xform[4] = src->xform[4];
+		dst->xform[5] = src->xform[5];
+	}
+	if (fields & NVG_STATE_LINEAR) {
+		memcpy(dst->xform, src->xform, sizeof(float)*4);
+		dst->xformKind = src->xformKind;
+	}
+	if (fields & NVG_STATE_SCISSOR)
+		dst->scissor = src->scissor;
+	if (fields & NVG_STATE_TEXT) {
+		dst->fontSize = src->fontSize;
+		dst->letterSpacing = src->letterSpacing;
+		dst->lineHeight = src->lineHeight;
+		dst->fontBlur = src->fontBlur;
+		dst->textAlign = src->textAlign;
+		dst->fontId = src->fontId;
+	}
+}
+
+// Returns the state for changing the given fields, logging their values for nvgRestore() the
+// first time they change after nvgSave().
+static NVGstate* nvg__editState(NVGcontext* ctx, int fields)
+{
+	NVGsave* save;
+	int log;
+	if (ctx->nstates <= 1)
+		return &ctx->state;
+	save = &ctx->saves[ctx->nstates-1];
+	log = fields & ~save->fields;
+	if (log != 0) {
+		nvg__copyState(&save->saved, &ctx->state, log);
+		save->fields |= log;
+	}
+	return &ctx->state;
 }
 
 void nvgTransformIdentity(float* t)
@@ -507,6 +1131,16 @@ int nvgTransformInverse(float* inv, const float* t)
 		nvgTransformIdentity(inv);
 		return 0;
 	}
+	if (t[1] == 0.0f && t[2] == 0.0f) {
+		// Axis aligned, which covers the paints and scissors of most user interfaces.
+		inv[0] = 1.0f / t[0];
+		inv[1] = 0.0f;
+		inv[2] = 0.0f;
+		inv[3] = 1.0f / t[3];
+		inv[4] = -t[4] * inv[0];
+		inv[5] = -t[5] * inv[3];
+		return 1;
+	}
 	invdet = 1.0 / det;
 	inv[0] = (float)(t[3] * invdet);
 	inv[2] = (float)(-t[2] * invdet);
@@ -547,23 +1181,26 @@ static void nvg__setPaintColor(NVGpaint* p, NVGcolor color)
 // State handling
 void nvgSave(NVGcontext* ctx)
 {
+	// Nothing is copied until a field changes, see nvg__editState().
 	if (ctx->nstates >= NVG_MAX_STATES)
 		return;
-	if (ctx->nstates > 0)
-		memcpy(&ctx->states[ctx->nstates], &ctx->states[ctx->nstates-1], sizeof(NVGstate));
+	ctx->saves[ctx->nstates].fields = 0;
 	ctx->nstates++;
 }
 
 void nvgRestore(NVGcontext* ctx)
 {
+	NVGsave* save;
 	if (ctx->nstates <= 1)
 		return;
+	save = &ctx->saves[ctx->nstates-1];
+	nvg__copyState(&ctx->state, &save->saved, save->fields);
 	ctx->nstates--;
 }
 
 void nvgReset(NVGcontext* ctx)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_ALL);
 	memset(state, 0, sizeof(*state));
 
 	nvg__setPaintColor(&state->fill, nvgRGBA(255,255,255,255));
@@ -573,7 +1210,8 @@ void nvgReset(NVGcontext* ctx)
 	state->lineCap = NVG_BUTT;
 	state->lineJoin = NVG_MITER;
 	state->alpha = 1.0f;
-	nvgTransformIdentity(state->xform);
+	memcpy(state->xform, ctx->layerXform, sizeof(float)*6);
+	state->xformKind = nvg__xformKind(state->xform);
 
 	state->scissor.extent[0] = -1.0f;
 	state->scissor.extent[1] = -1.0f;
@@ -589,85 +1227,95 @@ void nvgReset(NVGcontext* ctx)
 // State setting
 void nvgStrokeWidth(NVGcontext* ctx, float width)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_STYLE);
 	state->strokeWidth = width;
 }
 
 void nvgMiterLimit(NVGcontext* ctx, float limit)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_STYLE);
 	state->miterLimit = limit;
 }
 
 void nvgLineCap(NVGcontext* ctx, int cap)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_STYLE);
 	state->lineCap = cap;
 }
 
 void nvgLineJoin(NVGcontext* ctx, int join)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_STYLE);
 	state->lineJoin = join;
 }
 
 void nvgGlobalAlpha(NVGcontext* ctx, float alpha)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_STYLE);
 	state->alpha = alpha;
 }
 
 void nvgTransform(NVGcontext* ctx, float a, float b, float c, float d, float e, float f)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_XFORM);
 	float t[6] = { a, b, c, d, e, f };
 	nvgTransformPremultiply(state->xform, t);
+	state->xformKind = nvg__xformKind(state->xform);
 }
 
 void nvgResetTransform(NVGcontext* ctx)
 {
-	NVGstate* state = nvg__getState(ctx);
-	nvgTransformIdentity(state->xform);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_XFORM);
+	// Within a layer the view is still where the drawing starts from.
+	memcpy(state->xform, ctx->layerXform, sizeof(float)*6);
+	state->xformKind = nvg__xformKind(state->xform);
 }
 
 void nvgTranslate(NVGcontext* ctx, float x, float y)
 {
-	NVGstate* state = nvg__getState(ctx);
-	float t[6];
-	nvgTransformTranslate(t, x,y);
-	nvgTransformPremultiply(state->xform, t);
+	// Premultiplying a translation leaves the linear part alone, so only the origin is logged.
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_ORIGIN);
+	float* t = state->xform;
+	float tx = x*t[0] + y*t[2] + t[4];
+	float ty = x*t[1] + y*t[3] + t[5];
+	t[4] = tx;
+	t[5] = ty;
 }
 
 void nvgRotate(NVGcontext* ctx, float angle)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_XFORM);
 	float t[6];
 	nvgTransformRotate(t, angle);
 	nvgTransformPremultiply(state->xform, t);
+	state->xformKind = nvg__xformKind(state->xform);
 }
 
 void nvgSkewX(NVGcontext* ctx, float angle)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_XFORM);
 	float t[6];
 	nvgTransformSkewX(t, angle);
 	nvgTransformPremultiply(state->xform, t);
+	state->xformKind = nvg__xformKind(state->xform);
 }
 
 void nvgSkewY(NVGcontext* ctx, float angle)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_XFORM);
 	float t[6];
 	nvgTransformSkewY(t, angle);
 	nvgTransformPremultiply(state->xform, t);
+	state->xformKind = nvg__xformKind(state->xform);
 }
 
 void nvgScale(NVGcontext* ctx, float x, float y)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_XFORM);
 	float t[6];
 	nvgTransformScale(t, x,y);
 	nvgTransformPremultiply(state->xform, t);
+	state->xformKind = nvg__xformKind(state->xform);
 }
 
 void nvgCurrentTransform(NVGcontext* ctx, float* xform)
@@ -679,57 +1327,364 @@ void nvgCurrentTransform(NVGcontext* ctx, float* xform)
 
 void nvgStrokeColor(NVGcontext* ctx, NVGcolor color)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_STROKE);
 	nvg__setPaintColor(&state->stroke, color);
 }
 
 void nvgStrokePaint(NVGcontext* ctx, NVGpaint paint)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_STROKE);
 	state->stroke = paint;
 	nvgTransformMultiply(state->stroke.xform, state->xform);
 }
 
 void nvgFillColor(NVGcontext* ctx, NVGcolor color)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_FILL);
 	nvg__setPaintColor(&state->fill, color);
 }
 
 void nvgFillPaint(NVGcontext* ctx, NVGpaint paint)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_FILL);
 	state->fill = paint;
 	nvgTransformMultiply(state->fill.xform, state->xform);
 }
 
-int nvgCreateImage(NVGcontext* ctx, const char* filename, int imageFlags)
+// Pixel conversions
+
+// Rounded c * a / 255 for 16 bit lanes holding products up to 255 * 255.
+#define NVG__DIV255(t) (((t) + 128 + (((t) + 128) >> 8)) >> 8)
+
+void nvgPremultiplyRGBA(unsigned char* pixels, int npixels)
+{
+	int i = 0;
+#if defined(NVG_SIMD) && !defined(__aarch64__)
+	const __m128i zero = _mm_setzero_si128(), bias = _mm_set1_epi16(128);
+	// Alpha lanes are multiplied by 255 and divided again, which keeps them.
+	const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1), alpha255 = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+	for (; i + 4 <= npixels; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+		__m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+		__m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		alo = _mm_or_si128(_mm_andnot_si128(alphaLanes, alo), alpha255);
+		ahi = _mm_or_si128(_mm_andnot_si128(alphaLanes, ahi), alpha255);
+		lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), bias);
+		hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), bias);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+		_mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_packus_epi16(lo, hi));
+	}
+#elif defined(NVG_SIMD)
+	for (; i + 8 <= npixels; i += 8) {
+		uint8x8x4_t v = vld4_u8(pixels + i * 4);
+		int c;
+		for (c = 0; c < 3; c++) {
+			uint16x8_t t = vaddq_u16(vmull_u8(v.val[c], v.val[3]), vdupq_n_u16(128));
+			v.val[c] = vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+		}
+		vst4_u8(pixels + i * 4, v);
+	}
+#endif
+	for (; i < npixels; i++) {
+		unsigned char* p = pixels + i * 4;
+		int a = p[3];
+		p[0] = (unsigned char)NVG__DIV255(p[0] * a);
+		p[1] = (unsigned char)NVG__DIV255(p[1] * a);
+		p[2] = (unsigned char)NVG__DIV255(p[2] * a);
+	}
+}
+
+void nvgUnpremultiplyRGBA(unsigned char* pixels, int npixels)
+{
+	int i = 0;
+#if defined(NVG_SIMD) && !defined(__aarch64__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 colorLanes = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)), alphaOne = _mm_setr_ps(0, 0, 0, 1.0f);
+	const __m128 half = _mm_set1_ps(0.5f), max = _mm_set1_ps(255.0f), fzero = _mm_setzero_ps();
+	for (; i + 4 <= npixels; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+		__m128 a = _mm_cvtepi32_ps(_mm_srli_epi32(v, 24));
+		// 255 / a, 0 for transparent pixels.
+		__m128 inv = _mm_and_ps(_mm_div_ps(max, _mm_max_ps(a, _mm_set1_ps(1.0f))), _mm_cmpgt_ps(a, fzero));
+		__m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero), p[4];
+		__m128 m[4];
+		int k;
+		m[0] = _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(0, 0, 0, 0));
+		m[1] = _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(1, 1, 1, 1));
+		m[2] = _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(2, 2, 2, 2));
+		m[3] = _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(3, 3, 3, 3));
+		p[0] = _mm_unpacklo_epi16(lo, zero);
+		p[1] = _mm_unpackhi_epi16(lo, zero);
+		p[2] = _mm_unpacklo_epi16(hi, zero);
+		p[3] = _mm_unpackhi_epi16(hi, zero);
+		for (k = 0; k < 4; k++) {
+			__m128 f = _mm_mul_ps(_mm_cvtepi32_ps(p[k]), _mm_or_ps(_mm_and_ps(colorLanes, m[k]), alphaOne));
+			p[k] = _mm_cvttps_epi32(_mm_min_ps(_mm_add_ps(f, half), max));
+		}
+		_mm_storeu_si128((__m128i*)(pixels + i * 4),
+						 _mm_packus_epi16(_mm_packs_epi32(p[0], p[1]), _mm_packs_epi32(p[2], p[3])));
+	}
+#elif defined(NVG_SIMD)
+	for (; i + 8 <= npixels; i += 8) {
+		uint8x8x4_t v = vld4_u8(pixels + i * 4);
+		uint16x8_t a16 = vmovl_u8(v.val[3]);
+		float32x4_t a[2], inv[2];
+		int c, h;
+		a[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(a16)));
+		a[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(a16)));
+		for (h = 0; h < 2; h++)
+			inv[h] = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vdivq_f32(vdupq_n_f32(255.0f), vmaxq_f32(a[h], vdupq_n_f32(1.0f)))),
+													 vcgtq_f32(a[h], vdupq_n_f32(0.0f))));
+		for (c = 0; c < 3; c++) {
+			uint16x8_t c16 = vmovl_u8(v.val[c]);
+			uint32x4_t r[2];
+			for (h = 0; h < 2; h++) {
+				float32x4_t f = vcvtq_f32_u32(vmovl_u16(h == 0 ? vget_low_u16(c16) : vget_high_u16(c16)));
+				f = vminq_f32(vaddq_f32(vmulq_f32(f, inv[h]), vdupq_n_f32(0.5f)), vdupq_n_f32(255.0f));
+				r[h] = vcvtq_u32_f32(f);
+			}
+			v.val[c] = vmovn_u16(vcombine_u16(vmovn_u32(r[0]), vmovn_u32(r[1])));
+		}
+		vst4_u8(pixels + i * 4, v);
+	}
+#endif
+	for (; i < npixels; i++) {
+		unsigned char* p = pixels + i * 4;
+		int a = p[3], c;
+		for (c = 0; c < 3; c++)
+			p[c] = a == 0 ? 0 : (unsigned char)nvg__mini(255, (p[c] * 255 + a / 2) / a);
+	}
+}
+
+void nvgSwizzleRB(unsigned char* pixels, int npixels)
+{
+	int i = 0;
+#if defined(NVG_SIMD) && !defined(__aarch64__)
+	const __m128i ga = _mm_set1_epi32((int)0xff00ff00), low = _mm_set1_epi32(0xff);
+	for (; i + 4 <= npixels; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+		__m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), low), b = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+		_mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_or_si128(_mm_and_si128(v, ga), _mm_or_si128(r, b)));
+	}
+#elif defined(NVG_SIMD)
+	for (; i + 16 <= npixels; i += 16) {
+		uint8x16x4_t v = vld4q_u8(pixels + i * 4);
+		uint8x16_t t = v.val[0];
+		v.val[0] = v.val[2];
+		v.val[2] = t;
+		vst4q_u8(pixels + i * 4, v);
+	}
+#endif
+	for (; i < npixels; i++) {
+		unsigned char t = pixels[i * 4];
+		pixels[i * 4] = pixels[i * 4 + 2];
+		pixels[i * 4 + 2] = t;
+	}
+}
+
+void nvgExpandToRGBA(unsigned char* dst, const unsigned char* src, int npixels, int channels)
+{
+	int i = 0;
+	if (channels == 4) {
+		memcpy(dst, src, (size_t)npixels * 4);
+		return;
+	}
+#if defined(NVG_SIMD) && !defined(__aarch64__)
+	{
+		const __m128i opaque = _mm_set1_epi32((int)0xff000000);
+		if (channels == 1) {
+			for (; i + 16 <= npixels; i += 16) {
+				__m128i g = _mm_loadu_si128((const __m128i*)(src + i));
+				__m128i lo = _mm_unpacklo_epi8(g, g), hi = _mm_unpackhi_epi8(g, g);
+				_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_unpacklo_epi16(lo, lo), opaque));
+				_mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_or_si128(_mm_unpackhi_epi16(lo, lo), opaque));
+				_mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_or_si128(_mm_unpacklo_epi16(hi, hi), opaque));
+				_mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_or_si128(_mm_unpackhi_epi16(hi, hi), opaque));
+			}
+		} else if (channels == 2) {
+			const __m128i low = _mm_set1_epi16(0xff);
+			for (; i + 8 <= npixels; i += 8) {
+				__m128i ga = _mm_loadu_si128((const __m128i*)(src + i * 2));
+				__m128i g = _mm_and_si128(ga, low);
+				__m128i gg = _mm_or_si128(g, _mm_slli_epi16(g, 8));
+				_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_unpacklo_epi16(gg, ga));
+				_mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(gg, ga));
+			}
+		} else if (channels == 3) {
+			// Little endian words, the last pixel is left to the scalar loop so no byte past src is read.
+			for (; i + 1 < npixels; i++) {
+				unsigned int p;
+				memcpy(&p, src + i * 3, 4);
+				p |= 0xff000000u;
+				memcpy(dst + i * 4, &p, 4);
+			}
+		}
+	}
+#elif defined(NVG_SIMD)
+	if (channels == 1) {
+		for (; i + 16 <= npixels; i += 16) {
+			uint8x16x4_t v;
+			v.val[0] = v.val[1] = v.val[2] = vld1q_u8(src + i);
+			v.val[3] = vdupq_n_u8(255);
+			vst4q_u8(dst + i * 4, v);
+		}
+	} else if (channels == 2) {
+		for (; i + 16 <= npixels; i += 16) {
+			uint8x16x2_t ga = vld2q_u8(src + i * 2);
+			uint8x16x4_t v;
+			v.val[0] = v.val[1] = v.val[2] = ga.val[0];
+			v.val[3] = ga.val[1];
+			vst4q_u8(dst + i * 4, v);
+		}
+	} else if (channels == 3) {
+		for (; i + 16 <= npixels; i += 16) {
+			uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+			uint8x16x4_t v;
+			v.val[0] = rgb.val[0];
+			v.val[1] = rgb.val[1];
+			v.val[2] = rgb.val[2];
+			v.val[3] = vdupq_n_u8(255);
+			vst4q_u8(dst + i * 4, v);
+		}
+	}
+#endif
+	for (; i < npixels; i++) {
+		const unsigned char* s = src + i * channels;
+		unsigned char* d = dst + i * 4;
+		d[0] = s[0];
+		d[1] = channels >= 3 ? s[1] : s[0];
+		d[2] = channels >= 3 ? s[2] : s[0];
+		d[3] = channels == 2 ? s[1] : channels == 4 ? s[3] : 255;
+	}
+}
+
+// Turns pixels stb_image decoded with n components into an image, expanding them to RGBA and
+// premultiplying them for NVG_IMAGE_PREMULTIPLIED. Frees img.
+#define NVG_MAX_IMAGE_DECODERS 8
+static NVGimageDecoder nvg__decoders[NVG_MAX_IMAGE_DECODERS];
+static int nvg__ndecoders = 0;
+
+int nvgAddImageDecoder(const NVGimageDecoder* decoder)
+{
+	if (nvg__ndecoders >= NVG_MAX_IMAGE_DECODERS) return 0;
+	if (decoder->probe == NULL || decoder->info == NULL || decoder->decode == NULL) return 0;
+	nvg__decoders[nvg__ndecoders++] = *decoder;
+	return 1;
+}
+
+static const NVGimageDecoder* nvg__findDecoder(const unsigned char* data, int ndata)
+{
+	int i;
+	// The latest first, so that a decoder can take a format over from an earlier one.
+	for (i = nvg__ndecoders-1; i >= 0; i--) {
+		if (nvg__decoders[i].probe(nvg__decoders[i].userPtr, data, ndata))
+			return &nvg__decoders[i];
+	}
+	return NULL;
+}
+
+// Expands the n channel pixels of stb_image to RGBA in a new buffer, freeing img.
+static unsigned char* nvg__expandDecoded(unsigned char* img, int w, int h, int n)
+{
+	unsigned char* rgba;
+	if (img == NULL || n == 4) return img;
+	rgba = (unsigned char*)malloc((size_t)w * h * 4);
+	if (rgba != NULL)
+		nvgExpandToRGBA(rgba, img, w * h, n);
+	stbi_image_free(img);
+	return rgba;
+}
+
+static unsigned char* nvg__stbDecode(const unsigned char* data, int ndata, int* w, int* h, int* n)
 {
-	int w, h, n, image;
-	unsigned char* img;
 	stbi_set_unpremultiply_on_load(1);
 	stbi_convert_iphone_png_to_rgb(1);
-	img = stbi_load(filename, &w, &h, &n, 4);
+	return stbi_load_from_memory(data, ndata, w, h, n, 0);
+}
+
+int nvgImageInfoMem(const unsigned char* data, int ndata, int* w, int* h)
+{
+	int n;
+	const NVGimageDecoder* decoder = nvg__findDecoder(data, ndata);
+	if (decoder != NULL && decoder->info(decoder->userPtr, data, ndata, w, h))
+		return 1;
+	return stbi_info_from_memory(data, ndata, w, h, &n);
+}
+
+unsigned char* nvgDecodeImageMem(const unsigned char* data, int ndata, int* w, int* h)
+{
+	int n;
+	unsigned char* img;
+	const NVGimageDecoder* decoder = nvg__findDecoder(data, ndata);
+	// A registered decoder that fails, on a variant of the format it does not handle, leaves the image to stb_image.
+	if (decoder != NULL && decoder->info(decoder->userPtr, data, ndata, w, h) && *w > 0 && *h > 0) {
+		img = (unsigned char*)malloc((size_t)*w * *h * 4);
+		if (img != NULL && decoder->decode(decoder->userPtr, data, ndata, img, *w * 4))
+			return img;
+		free(img);
+	}
+	img = nvg__stbDecode(data, ndata, w, h, &n);
+	return nvg__expandDecoded(img, *w, *h, n);
+}
+
+int nvgDecodeImageMemInto(const unsigned char* data, int ndata, unsigned char* dst, int rowBytes)
+{
+	int w, h, n, y;
+	unsigned char* img;
+	const NVGimageDecoder* decoder = nvg__findDecoder(data, ndata);
+	if (decoder != NULL && decoder->decode(decoder->userPtr, data, ndata, dst, rowBytes))
+		return 1;
+	img = nvg__stbDecode(data, ndata, &w, &h, &n);
+	if (img == NULL) return 0;
+	for (y = 0; y < h; y++)
+		nvgExpandToRGBA(dst + (size_t)y * rowBytes, img + (size_t)y * w * n, w, n);
+	stbi_image_free(img);
+	return 1;
+}
+
+static int nvg__createImageDecoded(NVGcontext* ctx, unsigned char* img, int w, int h, int imageFlags)
+{
+	int image;
+	if (imageFlags & NVG_IMAGE_PREMULTIPLIED)
+		nvgPremultiplyRGBA(img, w * h);
+	image = nvgCreateImageRGBA(ctx, w, h, imageFlags, img);
+	// Matches the allocator of stb_image, see STBI_FREE.
+	free(img);
+	return image;
+}
+
+int nvgCreateImage(NVGcontext* ctx, const char* filename, int imageFlags)
+{
+	int w, h, n, size = 0;
+	unsigned char* img;
+	// Decoded straight from the mapped file, stb_image would read it through its own buffer.
+	const unsigned char* data = fonsMapFile(filename, &size);
+	if (data != NULL) {
+		img = nvgDecodeImageMem(data, size, &w, &h);
+		fonsUnmapFile(data, size);
+	} else {
+		stbi_set_unpremultiply_on_load(1);
+		stbi_convert_iphone_png_to_rgb(1);
+		img = nvg__expandDecoded(stbi_load(filename, &w, &h, &n, 0), w, h, n);
+	}
 	if (img == NULL) {
 //		printf("Failed to load %s - %s\n", filename, stbi_failure_reason());
 		return 0;
 	}
-	image = nvgCreateImageRGBA(ctx, w, h, imageFlags, img);
-	stbi_image_free(img);
-	return image;
+	return nvg__createImageDecoded(ctx, img, w, h, imageFlags);
 }
 
 int nvgCreateImageMem(NVGcontext* ctx, int imageFlags, unsigned char* data, int ndata)
 {
-	int w, h, n, image;
-	unsigned char* img = stbi_load_from_memory(data, ndata, &w, &h, &n, 4);
+	int w, h;
+	unsigned char* img = nvgDecodeImageMem(data, ndata, &w, &h);
 	if (img == NULL) {
 //		printf("Failed to load %s - %s\n", filename, stbi_failure_reason());
 		return 0;
 	}
-	image = nvgCreateImageRGBA(ctx, w, h, imageFlags, img);
-	stbi_image_free(img);
-	return image;
+	return nvg__createImageDecoded(ctx, img, w, h, imageFlags);
 }
 
 int nvgCreateImageRGBA(NVGcontext* ctx, int w, int h, int imageFlags, const unsigned char* data)
@@ -737,21 +1692,243 @@ int nvgCreateImageRGBA(NVGcontext* ctx, int w, int h, int imageFlags, const unsi
 	return ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_RGBA, w, h, imageFlags, data);
 }
 
-void nvgUpdateImage(NVGcontext* ctx, int image, const unsigned char* data)
+int nvgCompressedLevelSize(int format, int w, int h)
 {
-	int w, h;
-	ctx->params.renderGetTextureSize(ctx->params.userPtr, image, &w, &h);
-	ctx->params.renderUpdateTexture(ctx->params.userPtr, image, 0,0, w,h, data);
+	int blockBytes = (format == NVG_COMPRESSED_BC1 || format == NVG_COMPRESSED_ETC2_RGB) ? 8 : 16;
+	return ((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
 }
 
-void nvgImageSize(NVGcontext* ctx, int image, int* w, int* h)
+static void nvg__bc1Colors(const unsigned char* block, unsigned char colors[4][4], int alpha)
 {
-	ctx->params.renderGetTextureSize(ctx->params.userPtr, image, w, h);
+	int c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8), i, k;
+	for (i = 0; i < 2; i++) {
+		int c = i == 0 ? c0 : c1;
+		colors[i][0] = (unsigned char)(((c >> 11) & 31) * 255 / 31);
+		colors[i][1] = (unsigned char)(((c >> 5) & 63) * 255 / 63);
+		colors[i][2] = (unsigned char)((c & 31) * 255 / 31);
+		colors[i][3] = 255;
+	}
+	for (k = 0; k < 3; k++) {
+		if (c0 > c1 || !alpha) {
+			colors[2][k] = (unsigned char)((2 * colors[0][k] + colors[1][k]) / 3);
+			colors[3][k] = (unsigned char)((colors[0][k] + 2 * colors[1][k]) / 3);
+		} else {
+			colors[2][k] = (unsigned char)((colors[0][k] + colors[1][k]) / 2);
+			colors[3][k] = 0;
+		}
+	}
+	colors[2][3] = 255;
+	colors[3][3] = (c0 > c1 || !alpha) ? 255 : 0;
+}
+
+// Decodes BC1 or BC3 blocks into straight RGBA, for back-ends that cannot sample them.
+static unsigned char* nvg__decodeBlocks(int format, int w, int h, const unsigned char* data)
+{
+	unsigned char* rgba = (unsigned char*)malloc((size_t)w * h * 4);
+	int bx, by, x, y, i, blockBytes = format == NVG_COMPRESSED_BC1 ? 8 : 16;
+	if (rgba == NULL) return NULL;
+	for (by = 0; by < h; by += 4) {
+		for (bx = 0; bx < w; bx += 4, data += blockBytes) {
+			const unsigned char* color = format == NVG_COMPRESSED_BC1 ? data : data + 8;
+			unsigned char colors[4][4], alphas[8];
+			unsigned int indices = color[4] | (color[5] << 8) | (color[6] << 16) | ((unsigned int)color[7] << 24);
+			unsigned long long alphaBits = 0;
+			nvg__bc1Colors(color, colors, format == NVG_COMPRESSED_BC1);
+			if (format == NVG_COMPRESSED_BC3) {
+				alphas[0] = data[0];
+				alphas[1] = data[1];
+				if (alphas[0] > alphas[1]) {
+					for (i = 1; i < 7; i++)
+						alphas[i + 1] = (unsigned char)(((7 - i) * alphas[0] + i * alphas[1]) / 7);
+				} else {
+					for (i = 1; i < 5; i++)
+						alphas[i + 1] = (unsigned char)(((5 - i) * alphas[0] + i * alphas[1]) / 5);
+					alphas[6] = 0;
+					alphas[7] = 255;
+				}
+				for (i = 0; i < 6; i++)
+					alphaBits |= (unsigned long long)data[2 + i] << (8 * i);
+			}
+			for (y = 0; y < 4 && by + y < h; y++) {
+				for (x = 0; x < 4 && bx + x < w; x++) {
+					unsigned char* dst = &rgba[((size_t)(by + y) * w + bx + x) * 4];
+					int texel = y * 4 + x;
+					memcpy(dst, colors[(indices >> (2 * texel)) & 3], 4);
+					if (format == NVG_COMPRESSED_BC3)
+						dst[3] = alphas[(alphaBits >> (3 * texel)) & 7];
+				}
+			}
+		}
+	}
+	return rgba;
 }
 
-void nvgDeleteImage(NVGcontext* ctx, int image)
+int nvgCreateImageCompressed(NVGcontext* ctx, int format, int w, int h, int levels, int imageFlags,
+							 const unsigned char* data, int ndata)
 {
-	ctx->params.renderDeleteTexture(ctx->params.userPtr, image);
+	int i, size = 0, image = 0;
+	unsigned char* rgba;
+	if (format < NVG_COMPRESSED_BC1 || format > NVG_COMPRESSED_ETC2_RGBA || w <= 0 || h <= 0 || levels <= 0)
+		return 0;
+	// Drop the levels that data does not hold completely.
+	for (i = 0; i < levels; i++) {
+		int level = nvgCompressedLevelSize(format, nvg__maxi(1, w >> i), nvg__maxi(1, h >> i));
+		if (size + level > ndata) break;
+		size += level;
+	}
+	if (i == 0) return 0;
+	levels = i;
+	if (ctx->params.renderCreateCompressedTexture != NULL)
+		image = ctx->params.renderCreateCompressedTexture(ctx->params.userPtr, format, w, h, levels, imageFlags, data);
+	if (image != 0 || (format != NVG_COMPRESSED_BC1 && format != NVG_COMPRESSED_BC3))
+		return image;
+	rgba = nvg__decodeBlocks(format, w, h, data);
+	if (rgba == NULL) return 0;
+	if (levels > 1)
+		imageFlags |= NVG_IMAGE_GENERATE_MIPMAPS;
+	image = nvgCreateImageRGBA(ctx, w, h, imageFlags, rgba);
+	free(rgba);
+	return image;
+}
+
+static unsigned int nvg__readU32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static int nvg__compressedFromGL(unsigned int internalFormat)
+{
+	switch (internalFormat) {
+		case 0x83F0: // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		case 0x83F1: return NVG_COMPRESSED_BC1; // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+		case 0x83F3: return NVG_COMPRESSED_BC3; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		case 0x8E8C: return NVG_COMPRESSED_BC7; // GL_COMPRESSED_RGBA_BPTC_UNORM
+		case 0x9274: return NVG_COMPRESSED_ETC2_RGB; // GL_COMPRESSED_RGB8_ETC2
+		case 0x9278: return NVG_COMPRESSED_ETC2_RGBA; // GL_COMPRESSED_RGBA8_ETC2_EAC
+	}
+	return 0;
+}
+
+// KTX 1.1, little endian files with one 2D texture. The levels are copied together without their
+// size prefixes.
+static int nvg__createImageKTX(NVGcontext* ctx, int imageFlags, const unsigned char* data, int ndata)
+{
+	static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	int format, w, h, levels, i, size = 0, image;
+	size_t offset;
+	unsigned char* levelData;
+	if (ndata < 64 || memcmp(data, identifier, 12) != 0 || nvg__readU32(data + 12) != 0x04030201)
+		return 0;
+	format = nvg__compressedFromGL(nvg__readU32(data + 28));
+	w = (int)nvg__readU32(data + 36);
+	h = (int)nvg__readU32(data + 40);
+	levels = nvg__maxi(1, (int)nvg__readU32(data + 56));
+	if (format == 0 || w <= 0 || h <= 0 || nvg__readU32(data + 44) > 1 || nvg__readU32(data + 48) > 0 ||
+		nvg__readU32(data + 52) != 1 || levels > 32)
+		return 0;
+	offset = 64 + (size_t)nvg__readU32(data + 60);
+	levelData = (unsigned char*)malloc((size_t)ndata);
+	if (levelData == NULL) return 0;
+	for (i = 0; i < levels && offset + 4 <= (size_t)ndata; i++) {
+		size_t levelSize = nvg__readU32(data + offset);
+		offset += 4;
+		if (levelSize > (size_t)ndata - offset) break;
+		memcpy(levelData + size, data + offset, levelSize);
+		size += (int)levelSize;
+		offset += (levelSize + 3) & ~(size_t)3;
+	}
+	image = i > 0 ? nvgCreateImageCompressed(ctx, format, w, h, i, imageFlags, levelData, size) : 0;
+	free(levelData);
+	return image;
+}
+
+// DDS files with DXT1, DXT5 or a DX10 header naming BC1, BC3 or BC7.
+static int nvg__createImageDDS(NVGcontext* ctx, int imageFlags, const unsigned char* data, int ndata)
+{
+	int format = 0, w, h, levels, offset = 128;
+	if (ndata < 128 || memcmp(data, "DDS ", 4) != 0 || nvg__readU32(data + 4) != 124)
+		return 0;
+	h = (int)nvg__readU32(data + 12);
+	w = (int)nvg__readU32(data + 16);
+	levels = nvg__maxi(1, (int)nvg__readU32(data + 28));
+	if (memcmp(data + 84, "DXT1", 4) == 0)
+		format = NVG_COMPRESSED_BC1;
+	else if (memcmp(data + 84, "DXT5", 4) == 0)
+		format = NVG_COMPRESSED_BC3;
+	else if (memcmp(data + 84, "DX10", 4) == 0 && ndata >= 148) {
+		switch (nvg__readU32(data + 128)) {
+			case 71: case 72: format = NVG_COMPRESSED_BC1; break;
+			case 77: case 78: format = NVG_COMPRESSED_BC3; break;
+			case 98: case 99: format = NVG_COMPRESSED_BC7; break;
+		}
+		// Only plain 2D textures, no arrays.
+		if (nvg__readU32(data + 132) != 3 || nvg__readU32(data + 140) > 1)
+			format = 0;
+		offset = 148;
+	}
+	if (format == 0 || w <= 0 || h <= 0)
+		return 0;
+	return nvgCreateImageCompressed(ctx, format, w, h, nvg__mini(levels, 32), imageFlags, data + offset, ndata - offset);
+}
+
+int nvgCreateImageCompressedMem(NVGcontext* ctx, int imageFlags, const unsigned char* data, int ndata)
+{
+	if (ndata >= 4 && memcmp(data, "DDS ", 4) == 0)
+		return nvg__createImageDDS(ctx, imageFlags, data, ndata);
+	return nvg__createImageKTX(ctx, imageFlags, data, ndata);
+}
+
+int nvgCreateImageCompressedFile(NVGcontext* ctx, const char* filename, int imageFlags)
+{
+	FILE* fp;
+	unsigned char* data = NULL;
+	const unsigned char* mapped;
+	long size;
+	int image = 0, nmapped = 0;
+	mapped = fonsMapFile(filename, &nmapped);
+	if (mapped != NULL) {
+		image = nvgCreateImageCompressedMem(ctx, imageFlags, mapped, nmapped);
+		fonsUnmapFile(mapped, nmapped);
+		return image;
+	}
+	fp = fopen(filename, "rb");
+	if (fp == NULL) return 0;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (size > 0 && size <= 0x7fffffff)
+		data = (unsigned char*)malloc((size_t)size);
+	if (data != NULL && fread(data, 1, (size_t)size, fp) == (size_t)size)
+		image = nvgCreateImageCompressedMem(ctx, imageFlags, data, (int)size);
+	free(data);
+	fclose(fp);
+	return image;
+}
+
+void nvgUpdateImage(NVGcontext* ctx, int image, const unsigned char* data)
+{
+	int w, h;
+	ctx->params.renderGetTextureSize(ctx->params.userPtr, image, &w, &h);
+	ctx->params.renderUpdateTexture(ctx->params.userPtr, image, 0,0, w,h, data);
+}
+
+int nvgUpdateImageRegion(NVGcontext* ctx, int image, int x, int y, int w, int h, const unsigned char* data, int rowBytes)
+{
+	if (ctx->params.renderUpdateTextureRegion == NULL) return 0;
+	if (w <= 0 || h <= 0) return 1;
+	return ctx->params.renderUpdateTextureRegion(ctx->params.userPtr, image, x, y, w, h, data, rowBytes);
+}
+
+void nvgImageSize(NVGcontext* ctx, int image, int* w, int* h)
+{
+	// Measure contexts draw with the images of their parent.
+	ctx = nvgMeasureParent(ctx);
+	ctx->params.renderGetTextureSize(ctx->params.userPtr, image, w, h);
+}
+
+void nvgDeleteImage(NVGcontext* ctx, int image)
+{
+	ctx->params.renderDeleteTexture(ctx->params.userPtr, image);
 }
 
 NVGpaint nvgLinearGradient(NVGcontext* ctx,
@@ -868,10 +2045,145 @@ NVGpaint nvgImagePattern(NVGcontext* ctx,
 	return p;
 }
 
+// Multi-stop gradients
+static int nvg__reserve(void** items, int* cap, int count, int size, int minCap);
+
+static int nvg__validGradient(NVGcontext* ctx, int gradient)
+{
+	return gradient > 0 && gradient <= ctx->nramps && ctx->rampNext[gradient-1] == -1;
+}
+
+// Samples the stops into a row of premultiplied texels, interpolated premultiplied like the two color gradients.
+static void nvg__sampleRamp(unsigned char* dst, const NVGgradientStop* stops, int nstops)
+{
+	int i, j = 0, k;
+	for (i = 0; i < NVG_RAMP_WIDTH; i++) {
+		float t = (float)i / (NVG_RAMP_WIDTH-1);
+		float c[4], u = 0.0f;
+		const NVGcolor* a;
+		const NVGcolor* b;
+		while (j < nstops && stops[j].offset < t)
+			j++;
+		if (j == 0 || j == nstops) {
+			a = b = &stops[j == 0 ? 0 : nstops-1].color;
+		} else {
+			float span = stops[j].offset - stops[j-1].offset;
+			a = &stops[j-1].color;
+			b = &stops[j].color;
+			u = span > 1e-6f ? (t - stops[j-1].offset) / span : 1.0f;
+		}
+		c[3] = a->a + (b->a - a->a) * u;
+		for (k = 0; k < 3; k++)
+			c[k] = a->rgba[k]*a->a + (b->rgba[k]*b->a - a->rgba[k]*a->a) * u;
+		for (k = 0; k < 4; k++)
+			dst[i*4+k] = (unsigned char)(nvg__clampf(c[k], 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+}
+
+int nvgCreateGradient(NVGcontext* ctx, const NVGgradientStop* stops, int nstops)
+{
+	int index;
+	if (stops == NULL || nstops < 1) return 0;
+	if (ctx->freeRamp != 0) {
+		index = ctx->freeRamp - 1;
+		ctx->freeRamp = ctx->rampNext[index];
+	} else {
+		index = ctx->nramps;
+		if (!nvg__reserve((void**)&ctx->rampNext, &ctx->cramps, index+1, sizeof(int), 64))
+			return 0;
+		if (index % NVG_RAMP_ROWS == 0) {
+			NVGrampPage* pages = (NVGrampPage*)realloc(ctx->rampPages, sizeof(NVGrampPage) * (ctx->nrampPages+1));
+			NVGrampPage* page;
+			if (pages == NULL) return 0;
+			ctx->rampPages = pages;
+			page = &pages[ctx->nrampPages];
+			page->pixels = (unsigned char*)calloc(NVG_RAMP_WIDTH * NVG_RAMP_ROWS, 4);
+			if (page->pixels == NULL) return 0;
+			page->image = nvgCreateImageRGBA(ctx, NVG_RAMP_WIDTH, NVG_RAMP_ROWS, NVG_IMAGE_PREMULTIPLIED, page->pixels);
+			if (page->image == 0) {
+				free(page->pixels);
+				return 0;
+			}
+			ctx->nrampPages++;
+		}
+		ctx->nramps++;
+	}
+	ctx->rampNext[index] = -1;
+	nvgUpdateGradient(ctx, index+1, stops, nstops);
+	return index+1;
+}
+
+void nvgUpdateGradient(NVGcontext* ctx, int gradient, const NVGgradientStop* stops, int nstops)
+{
+	NVGrampPage* page;
+	int row;
+	if (!nvg__validGradient(ctx, gradient) || stops == NULL || nstops < 1) return;
+	page = &ctx->rampPages[(gradient-1) / NVG_RAMP_ROWS];
+	row = (gradient-1) % NVG_RAMP_ROWS;
+	nvg__sampleRamp(&page->pixels[row * NVG_RAMP_WIDTH * 4], stops, nstops);
+	ctx->params.renderUpdateTexture(ctx->params.userPtr, page->image, 0, row, NVG_RAMP_WIDTH, 1, page->pixels);
+}
+
+void nvgDeleteGradient(NVGcontext* ctx, int gradient)
+{
+	if (!nvg__validGradient(ctx, gradient)) return;
+	ctx->rampNext[gradient-1] = ctx->freeRamp;
+	ctx->freeRamp = gradient;
+}
+
+// Paint of the gradient in its own space, where the backend finds the offset from the ramp type.
+static NVGpaint nvg__rampPaint(NVGcontext* ctx, int gradient, int ramp)
+{
+	NVGpaint p;
+	memset(&p, 0, sizeof(p));
+	nvgTransformIdentity(p.xform);
+	if (!nvg__validGradient(ctx, gradient))
+		return p;	// transparent
+	p.image = ctx->rampPages[(gradient-1) / NVG_RAMP_ROWS].image;
+	p.ramp = ramp;
+	p.rampRow = (gradient-1) % NVG_RAMP_ROWS;
+	p.innerColor = p.outerColor = nvgRGBAf(1,1,1,1);
+	return p;
+}
+
+NVGpaint nvgLinearGradientStops(NVGcontext* ctx, float sx, float sy, float ex, float ey, int gradient)
+{
+	NVGpaint p = nvg__rampPaint(ctx, gradient, NVG_RAMP_LINEAR);
+	float dx = ex - sx, dy = ey - sy;
+	if (dx*dx + dy*dy < 1e-8f) {
+		dx = 1e-4f;
+		dy = 0.0f;
+	}
+	// The offset is the x coordinate in the space where the line is the unit vector.
+	p.xform[0] = dx; p.xform[1] = dy;
+	p.xform[2] = -dy; p.xform[3] = dx;
+	p.xform[4] = sx; p.xform[5] = sy;
+	return p;
+}
+
+NVGpaint nvgRadialGradientStops(NVGcontext* ctx, float cx, float cy, float inr, float outr, int gradient)
+{
+	NVGpaint p = nvg__rampPaint(ctx, gradient, NVG_RAMP_RADIAL);
+	p.xform[4] = cx;
+	p.xform[5] = cy;
+	p.radius = inr;
+	p.feather = nvg__maxf(outr - inr, 1e-4f);
+	return p;
+}
+
+NVGpaint nvgConicGradient(NVGcontext* ctx, float cx, float cy, float angle, int gradient)
+{
+	NVGpaint p = nvg__rampPaint(ctx, gradient, NVG_RAMP_CONIC);
+	nvgTransformRotate(p.xform, angle);
+	p.xform[4] = cx;
+	p.xform[5] = cy;
+	return p;
+}
+
 // Scissoring
 void nvgScissor(NVGcontext* ctx, float x, float y, float w, float h)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_SCISSOR);
 
 	w = nvg__maxf(0.0f, w);
 	h = nvg__maxf(0.0f, h);
@@ -930,12 +2242,43 @@ void nvgIntersectScissor(NVGcontext* ctx, float x, float y, float w, float h)
 
 void nvgResetScissor(NVGcontext* ctx)
 {
-	NVGstate* state = nvg__getState(ctx);
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_SCISSOR);
 	memset(state->scissor.xform, 0, sizeof(state->scissor.xform));
 	state->scissor.extent[0] = -1.0f;
 	state->scissor.extent[1] = -1.0f;
 }
 
+int nvgCurrentClipBounds(NVGcontext* ctx, float* bounds)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float* xf = state->scissor.xform;
+	float ex = state->scissor.extent[0], ey = state->scissor.extent[1];
+	float hx, hy;
+
+	if (ex < 0) {
+		// Without a scissor a recording can be replayed anywhere on screen.
+		if (ctx->ndrawLists > 0) return 0;
+		bounds[0] = 0.0f;
+		bounds[1] = 0.0f;
+		bounds[2] = ctx->viewWidth;
+		bounds[3] = ctx->viewHeight;
+		return 1;
+	}
+	hx = nvg__absf(xf[0])*ex + nvg__absf(xf[2])*ey;
+	hy = nvg__absf(xf[1])*ex + nvg__absf(xf[3])*ey;
+	bounds[0] = xf[4] - hx;
+	bounds[1] = xf[5] - hy;
+	bounds[2] = xf[4] + hx;
+	bounds[3] = xf[5] + hy;
+	if (ctx->ndrawLists == 0) {
+		bounds[0] = nvg__maxf(bounds[0], 0.0f);
+		bounds[1] = nvg__maxf(bounds[1], 0.0f);
+		bounds[2] = nvg__minf(bounds[2], ctx->viewWidth);
+		bounds[3] = nvg__minf(bounds[3], ctx->viewHeight);
+	}
+	return 1;
+}
+
 static int nvg__ptEquals(float x1, float y1, float x2, float y2, float tol)
 {
 	float dx = x2 - x1;
@@ -960,42 +2303,47 @@ static float nvg__distPtSeg(float x, float y, float px, float py, float qx, floa
 	return dx*dx + dy*dy;
 }
 
-static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
-{
-	NVGstate* state = nvg__getState(ctx);
-	int i;
-
-	if (ctx->ncommands+nvals > ctx->ccommands) {
-		float* commands;
-		int ccommands = ctx->ncommands+nvals + ctx->ccommands/2;
-		commands = (float*)realloc(ctx->commands, sizeof(float)*ccommands);
-		if (commands == NULL) return;
-		ctx->commands = commands;
-		ctx->ccommands = ccommands;
-	}
-
-	if ((int)vals[0] != NVG_CLOSE && (int)vals[0] != NVG_WINDING) {
-		ctx->commandx = vals[nvals-2];
-		ctx->commandy = vals[nvals-1];
+static void nvg__transformCommands(float* vals, int nvals, const float* xform, int kind)
+{
+	int i = 0;
+	if (kind != NVG_XFORM_GENERAL) {
+		// Axis aligned: x and y scale and move independently, for a translation the scale is one.
+		float sx = xform[0], sy = xform[3], tx = xform[4], ty = xform[5];
+		while (i < nvals) {
+			int cmd = (int)vals[i], npoints;
+			switch (cmd) {
+			case NVG_MOVETO:
+			case NVG_LINETO: npoints = 1; break;
+			case NVG_BEZIERTO: npoints = 3; break;
+			case NVG_WINDING: i += 2; continue;
+			default: i++; continue;
+			}
+			for (i++; npoints > 0; npoints--, i += 2) {
+				if (kind == NVG_XFORM_SCALE) {
+					vals[i] *= sx;
+					vals[i+1] *= sy;
+				}
+				vals[i] += tx;
+				vals[i+1] += ty;
+			}
+		}
+		return;
 	}
-
-	// transform commands
-	i = 0;
 	while (i < nvals) {
 		int cmd = (int)vals[i];
 		switch (cmd) {
 		case NVG_MOVETO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
+			nvgTransformPoint(&vals[i+1],&vals[i+2], xform, vals[i+1],vals[i+2]);
 			i += 3;
 			break;
 		case NVG_LINETO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
+			nvgTransformPoint(&vals[i+1],&vals[i+2], xform, vals[i+1],vals[i+2]);
 			i += 3;
 			break;
 		case NVG_BEZIERTO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
-			nvgTransformPoint(&vals[i+3],&vals[i+4], state->xform, vals[i+3],vals[i+4]);
-			nvgTransformPoint(&vals[i+5],&vals[i+6], state->xform, vals[i+5],vals[i+6]);
+			nvgTransformPoint(&vals[i+1],&vals[i+2], xform, vals[i+1],vals[i+2]);
+			nvgTransformPoint(&vals[i+3],&vals[i+4], xform, vals[i+3],vals[i+4]);
+			nvgTransformPoint(&vals[i+5],&vals[i+6], xform, vals[i+5],vals[i+6]);
 			i += 7;
 			break;
 		case NVG_CLOSE:
@@ -1008,95 +2356,149 @@ static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
 			i++;
 		}
 	}
+}
+
+static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
+{
+	NVGstate* state = nvg__getState(ctx);
+
+	if (ctx->ncommands+nvals > ctx->ccommands) {
+		float* commands;
+		int ccommands = ctx->ncommands+nvals + ctx->ccommands/2;
+		commands = (float*)realloc(ctx->commands, sizeof(float)*ccommands);
+		if (commands == NULL) return;
+		ctx->commands = commands;
+		ctx->ccommands = ccommands;
+	}
+
+	if ((int)vals[0] != NVG_CLOSE && (int)vals[0] != NVG_WINDING) {
+		ctx->commandx = vals[nvals-2];
+		ctx->commandy = vals[nvals-1];
+	}
+
+	nvg__transformCommands(vals, nvals, state->xform, state->xformKind);
 
 	memcpy(&ctx->commands[ctx->ncommands], vals, nvals*sizeof(float));
 
 	ctx->ncommands += nvals;
+	ctx->peakCommands = nvg__maxi(ctx->peakCommands, ctx->ncommands);
+	ctx->deferPathFirst = -1;
+}
+
+
+static void nvg__beginTess(NVGcontext* ctx, NVGtess* tess, NVGpathCache* cache, const float* commands, int ncommands)
+{
+	tess->cache = cache;
+	tess->commands = commands;
+	tess->ncommands = ncommands;
+	tess->tessTol = ctx->tessTol;
+	tess->distTol = ctx->distTol;
+	tess->fringeWidth = ctx->fringeWidth;
+	tess->tessMode = ctx->tessMode;
+	// The flatness test of the recursive mode allows the two control point distances to add up to sqrt(tessTol).
+	tess->curveTol = 0.5f * sqrtf(ctx->tessTol) * ctx->tessScale;
+	if (ctx->tessBudget > 0 && ctx->curveSegments > ctx->tessBudget) {
+		// Segment counts go with the inverse square root of the tolerance.
+		float over = (float)ctx->curveSegments / (float)ctx->tessBudget;
+		tess->curveTol *= nvg__minf(over*over, 16.0f);
+	}
+	tess->curveSegments = 0;
+	tess->triangulate = ctx->params.triangleFills;
+	tess->peakPoints = 0;
+	tess->peakPaths = 0;
+	tess->peakVerts = 0;
 }
 
+static void nvg__endTess(NVGcontext* ctx, NVGtess* tess)
+{
+	ctx->peakPoints = nvg__maxi(ctx->peakPoints, tess->peakPoints);
+	ctx->peakPaths = nvg__maxi(ctx->peakPaths, tess->peakPaths);
+	ctx->peakVerts = nvg__maxi(ctx->peakVerts, tess->peakVerts);
+	ctx->curveSegments += tess->curveSegments;
+}
 
-static void nvg__clearPathCache(NVGcontext* ctx)
+static void nvg__clearPathCache(NVGpathCache* cache)
 {
-	ctx->cache->npoints = 0;
-	ctx->cache->npaths = 0;
+	cache->npoints = 0;
+	cache->npaths = 0;
 }
 
-static NVGpath* nvg__lastPath(NVGcontext* ctx)
+static NVGpath* nvg__lastPath(NVGtess* tess)
 {
-	if (ctx->cache->npaths > 0)
-		return &ctx->cache->paths[ctx->cache->npaths-1];
+	if (tess->cache->npaths > 0)
+		return &tess->cache->paths[tess->cache->npaths-1];
 	return NULL;
 }
 
-static void nvg__addPath(NVGcontext* ctx)
+static void nvg__addPath(NVGtess* tess)
 {
 	NVGpath* path;
-	if (ctx->cache->npaths+1 > ctx->cache->cpaths) {
+	if (tess->cache->npaths+1 > tess->cache->cpaths) {
 		NVGpath* paths;
-		int cpaths = ctx->cache->npaths+1 + ctx->cache->cpaths/2;
-		paths = (NVGpath*)realloc(ctx->cache->paths, sizeof(NVGpath)*cpaths);
+		int cpaths = tess->cache->npaths+1 + tess->cache->cpaths/2;
+		paths = (NVGpath*)realloc(tess->cache->paths, sizeof(NVGpath)*cpaths);
 		if (paths == NULL) return;
-		ctx->cache->paths = paths;
-		ctx->cache->cpaths = cpaths;
+		tess->cache->paths = paths;
+		tess->cache->cpaths = cpaths;
 	}
-	path = &ctx->cache->paths[ctx->cache->npaths];
+	path = &tess->cache->paths[tess->cache->npaths];
 	memset(path, 0, sizeof(*path));
-	path->first = ctx->cache->npoints;
+	path->first = tess->cache->npoints;
 	path->winding = NVG_CCW;
 
-	ctx->cache->npaths++;
+	tess->cache->npaths++;
 }
 
-static NVGpoint* nvg__lastPoint(NVGcontext* ctx)
+static NVGpoint* nvg__lastPoint(NVGtess* tess)
 {
-	if (ctx->cache->npoints > 0)
-		return &ctx->cache->points[ctx->cache->npoints-1];
+	if (tess->cache->npoints > 0)
+		return &tess->cache->points[tess->cache->npoints-1];
 	return NULL;
 }
 
-static void nvg__addPoint(NVGcontext* ctx, float x, float y, int flags)
+static void nvg__addPoint(NVGtess* tess, float x, float y, int flags)
 {
-	NVGpath* path = nvg__lastPath(ctx);
+	NVGpath* path = nvg__lastPath(tess);
 	NVGpoint* pt;
 	if (path == NULL) return;
 
-	if (path->count > 0 && ctx->cache->npoints > 0) {
-		pt = nvg__lastPoint(ctx);
-		if (nvg__ptEquals(pt->x,pt->y, x,y, ctx->distTol)) {
+	if (path->count > 0 && tess->cache->npoints > 0) {
+		pt = nvg__lastPoint(tess);
+		if (nvg__ptEquals(pt->x,pt->y, x,y, tess->distTol)) {
 			pt->flags |= flags;
 			return;
 		}
 	}
 
-	if (ctx->cache->npoints+1 > ctx->cache->cpoints) {
+	if (tess->cache->npoints+1 > tess->cache->cpoints) {
 		NVGpoint* points;
-		int cpoints = ctx->cache->npoints+1 + ctx->cache->cpoints/2;
-		points = (NVGpoint*)realloc(ctx->cache->points, sizeof(NVGpoint)*cpoints);
+		int cpoints = tess->cache->npoints+1 + tess->cache->cpoints/2;
+		points = (NVGpoint*)realloc(tess->cache->points, sizeof(NVGpoint)*cpoints);
 		if (points == NULL) return;
-		ctx->cache->points = points;
-		ctx->cache->cpoints = cpoints;
+		tess->cache->points = points;
+		tess->cache->cpoints = cpoints;
 	}
 
-	pt = &ctx->cache->points[ctx->cache->npoints];
+	pt = &tess->cache->points[tess->cache->npoints];
 	memset(pt, 0, sizeof(*pt));
 	pt->x = x;
 	pt->y = y;
 	pt->flags = (unsigned char)flags;
 
-	ctx->cache->npoints++;
+	tess->cache->npoints++;
 	path->count++;
 }
 
-static void nvg__closePath(NVGcontext* ctx)
+static void nvg__closePath(NVGtess* tess)
 {
-	NVGpath* path = nvg__lastPath(ctx);
+	NVGpath* path = nvg__lastPath(tess);
 	if (path == NULL) return;
 	path->closed = 1;
 }
 
-static void nvg__pathWinding(NVGcontext* ctx, int winding)
+static void nvg__pathWinding(NVGtess* tess, int winding)
 {
-	NVGpath* path = nvg__lastPath(ctx);
+	NVGpath* path = nvg__lastPath(tess);
 	if (path == NULL) return;
 	path->winding = winding;
 }
@@ -1108,18 +2510,28 @@ static float nvg__getAverageScale(float *t)
 	return (sx + sy) * 0.5f;
 }
 
-static NVGvertex* nvg__allocTempVerts(NVGcontext* ctx, int nverts)
+static float nvg__getStateScale(NVGstate* state)
+{
+	if (state->xformKind == NVG_XFORM_TRANSLATE)
+		return 1.0f;
+	if (state->xformKind == NVG_XFORM_SCALE)
+		return (nvg__absf(state->xform[0]) + nvg__absf(state->xform[3])) * 0.5f;
+	return nvg__getAverageScale(state->xform);
+}
+
+static NVGvertex* nvg__allocTempVerts(NVGtess* tess, int nverts)
 {
-	if (nverts > ctx->cache->cverts) {
+	if (nverts > tess->cache->cverts) {
 		NVGvertex* verts;
 		int cverts = (nverts + 0xff) & ~0xff; // Round up to prevent allocations when things change just slightly.
-		verts = (NVGvertex*)realloc(ctx->cache->verts, sizeof(NVGvertex)*cverts);
+		verts = (NVGvertex*)realloc(tess->cache->verts, sizeof(NVGvertex)*cverts);
 		if (verts == NULL) return NULL;
-		ctx->cache->verts = verts;
-		ctx->cache->cverts = cverts;
+		tess->cache->verts = verts;
+		tess->cache->cverts = cverts;
 	}
+	tess->peakVerts = nvg__maxi(tess->peakVerts, nverts);
 
-	return ctx->cache->verts;
+	return tess->cache->verts;
 }
 
 static float nvg__triarea2(float ax, float ay, float bx, float by, float cx, float cy)
@@ -1166,7 +2578,7 @@ static void nvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
 	vtx->v = v;
 }
 
-static void nvg__tesselateBezier(NVGcontext* ctx,
+static void nvg__tesselateBezier(NVGtess* tess,
 								 float x1, float y1, float x2, float y2,
 								 float x3, float y3, float x4, float y4,
 								 int level, int type)
@@ -1190,13 +2602,14 @@ static void nvg__tesselateBezier(NVGcontext* ctx,
 	d2 = nvg__absf(((x2 - x4) * dy - (y2 - y4) * dx));
 	d3 = nvg__absf(((x3 - x4) * dy - (y3 - y4) * dx));
 
-	if ((d2 + d3)*(d2 + d3) < ctx->tessTol * (dx*dx + dy*dy)) {
-		nvg__addPoint(ctx, x4, y4, type);
+	if ((d2 + d3)*(d2 + d3) < tess->tessTol * (dx*dx + dy*dy)) {
+		nvg__addPoint(tess, x4, y4, type);
+		tess->curveSegments++;
 		return;
 	}
 
-/*	if (nvg__absf(x1+x3-x2-x2) + nvg__absf(y1+y3-y2-y2) + nvg__absf(x2+x4-x3-x3) + nvg__absf(y2+y4-y3-y3) < ctx->tessTol) {
-		nvg__addPoint(ctx, x4, y4, type);
+/*	if (nvg__absf(x1+x3-x2-x2) + nvg__absf(y1+y3-y2-y2) + nvg__absf(x2+x4-x3-x3) + nvg__absf(y2+y4-y3-y3) < tess->tessTol) {
+		nvg__addPoint(tess, x4, y4, type);
 		return;
 	}*/
 
@@ -1205,13 +2618,125 @@ static void nvg__tesselateBezier(NVGcontext* ctx,
 	x1234 = (x123+x234)*0.5f;
 	y1234 = (y123+y234)*0.5f;
 
-	nvg__tesselateBezier(ctx, x1,y1, x12,y12, x123,y123, x1234,y1234, level+1, 0); 
-	nvg__tesselateBezier(ctx, x1234,y1234, x234,y234, x34,y34, x4,y4, level+1, type); 
+	nvg__tesselateBezier(tess, x1,y1, x12,y12, x123,y123, x1234,y1234, level+1, 0); 
+	nvg__tesselateBezier(tess, x1234,y1234, x234,y234, x34,y34, x4,y4, level+1, type); 
+}
+
+// Flattens a curve into the number of segments Wang's formula gives for curveTol, capped so that
+// no segment is much shorter than the tolerance, and evaluates it by forward differencing.
+static void nvg__tesselateBezierAdaptive(NVGtess* tess,
+										 float x1, float y1, float x2, float y2,
+										 float x3, float y3, float x4, float y4,
+										 int type)
+{
+	float ddx, ddy, dd, len, h, h2, h3;
+	float ax, ay, bx, by, cx, cy;
+	float fx, fy, dfx, dfy, ddfx, ddfy, dddfx, dddfy;
+	int i, n, maxn;
+
+	ddx = nvg__maxf(nvg__absf(x1 - 2*x2 + x3), nvg__absf(x2 - 2*x3 + x4));
+	ddy = nvg__maxf(nvg__absf(y1 - 2*y2 + y3), nvg__absf(y2 - 2*y3 + y4));
+	dd = sqrtf(ddx*ddx + ddy*ddy);
+	n = (int)ceilf(sqrtf(0.75f * dd / tess->curveTol));
+
+	// Halfway between the chord and the control polygon is a close estimate of the length.
+	len = (sqrtf((x4-x1)*(x4-x1) + (y4-y1)*(y4-y1)) +
+		   sqrtf((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1)) +
+		   sqrtf((x3-x2)*(x3-x2) + (y3-y2)*(y3-y2)) +
+		   sqrtf((x4-x3)*(x4-x3) + (y4-y3)*(y4-y3))) * 0.5f;
+	maxn = (int)ceilf(len / (2.0f * tess->curveTol));
+	n = nvg__clampi(nvg__mini(n, maxn), 1, 1024);
+
+	ax = -x1 + 3*x2 - 3*x3 + x4;
+	ay = -y1 + 3*y2 - 3*y3 + y4;
+	bx = 3*x1 - 6*x2 + 3*x3;
+	by = 3*y1 - 6*y2 + 3*y3;
+	cx = 3*(x2 - x1);
+	cy = 3*(y2 - y1);
+	h = 1.0f / (float)n;
+	h2 = h*h;
+	h3 = h2*h;
+
+	fx = x1;
+	fy = y1;
+	dfx = ax*h3 + bx*h2 + cx*h;
+	dfy = ay*h3 + by*h2 + cy*h;
+	ddfx = 6*ax*h3 + 2*bx*h2;
+	ddfy = 6*ay*h3 + 2*by*h2;
+	dddfx = 6*ax*h3;
+	dddfy = 6*ay*h3;
+	for (i = 1; i < n; i++) {
+		fx += dfx;
+		fy += dfy;
+		dfx += ddfx;
+		dfy += ddfy;
+		ddfx += dddfx;
+		ddfy += dddfy;
+		nvg__addPoint(tess, fx, fy, 0);
+	}
+	nvg__addPoint(tess, x4, y4, type);
+	tess->curveSegments += n;
+}
+
+// Calculates the direction and length of the segments starting at the points before the returned
+// index and grows the bounds by those points. The caller does the remaining points.
+#ifdef NVG_SIMD
+static int nvg__segmentsSimd(NVGpoint* pts, int count, float* bounds)
+{
+	NVGv4 minx = nvg__v4splat(bounds[0]), miny = nvg__v4splat(bounds[1]);
+	NVGv4 maxx = nvg__v4splat(bounds[2]), maxy = nvg__v4splat(bounds[3]);
+	NVGv4 one = nvg__v4splat(1.0f), eps = nvg__v4splat(1e-6f);
+	float dx[4], dy[4], len[4], b[4][4];
+	int i, k;
+
+	// The last segment wraps around to the first point, leave it to the caller.
+	for (i = 0; i + 4 < count; i += 4) {
+		NVGpoint* p = &pts[i];
+		NVGv4 x0 = nvg__v4set(p[0].x, p[1].x, p[2].x, p[3].x);
+		NVGv4 y0 = nvg__v4set(p[0].y, p[1].y, p[2].y, p[3].y);
+		NVGv4 vdx = nvg__v4sub(nvg__v4set(p[1].x, p[2].x, p[3].x, p[4].x), x0);
+		NVGv4 vdy = nvg__v4sub(nvg__v4set(p[1].y, p[2].y, p[3].y, p[4].y), y0);
+		NVGv4 d = nvg__v4sqrt(nvg__v4add(nvg__v4mul(vdx, vdx), nvg__v4mul(vdy, vdy)));
+		NVGv4 id = nvg__v4div(one, d);
+		nvg__v4store(dx, nvg__v4selgt(d, eps, nvg__v4mul(vdx, id), vdx));
+		nvg__v4store(dy, nvg__v4selgt(d, eps, nvg__v4mul(vdy, id), vdy));
+		nvg__v4store(len, d);
+		for (k = 0; k < 4; k++) {
+			p[k].dx = dx[k];
+			p[k].dy = dy[k];
+			p[k].len = len[k];
+		}
+		minx = nvg__v4min(minx, x0);
+		miny = nvg__v4min(miny, y0);
+		maxx = nvg__v4max(maxx, x0);
+		maxy = nvg__v4max(maxy, y0);
+	}
+
+	nvg__v4store(b[0], minx);
+	nvg__v4store(b[1], miny);
+	nvg__v4store(b[2], maxx);
+	nvg__v4store(b[3], maxy);
+	for (k = 0; k < 4; k++) {
+		bounds[0] = nvg__minf(bounds[0], b[0][k]);
+		bounds[1] = nvg__minf(bounds[1], b[1][k]);
+		bounds[2] = nvg__maxf(bounds[2], b[2][k]);
+		bounds[3] = nvg__maxf(bounds[3], b[3][k]);
+	}
+	return i;
+}
+#else
+static int nvg__segmentsSimd(NVGpoint* pts, int count, float* bounds)
+{
+	NVG_NOTUSED(pts);
+	NVG_NOTUSED(count);
+	NVG_NOTUSED(bounds);
+	return 0;
 }
+#endif
 
-static void nvg__flattenPaths(NVGcontext* ctx)
+static void nvg__flattenPaths(NVGtess* tess)
 {
-	NVGpathCache* cache = ctx->cache;
+	NVGpathCache* cache = tess->cache;
 //	NVGstate* state = nvg__getState(ctx);
 	NVGpoint* last;
 	NVGpoint* p0;
@@ -1219,9 +2744,9 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 	NVGpoint* pts;
 	NVGpath* path;
 	int i, j;
-	float* cp1;
-	float* cp2;
-	float* p;
+	const float* cp1;
+	const float* cp2;
+	const float* p;
 	float area;
 
 	if (cache->npaths > 0)
@@ -1229,36 +2754,39 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 
 	// Flatten
 	i = 0;
-	while (i < ctx->ncommands) {
-		int cmd = (int)ctx->commands[i];
+	while (i < tess->ncommands) {
+		int cmd = (int)tess->commands[i];
 		switch (cmd) {
 		case NVG_MOVETO:
-			nvg__addPath(ctx);
-			p = &ctx->commands[i+1];
-			nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
+			nvg__addPath(tess);
+			p = &tess->commands[i+1];
+			nvg__addPoint(tess, p[0], p[1], NVG_PT_CORNER);
 			i += 3;
 			break;
 		case NVG_LINETO:
-			p = &ctx->commands[i+1];
-			nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
+			p = &tess->commands[i+1];
+			nvg__addPoint(tess, p[0], p[1], NVG_PT_CORNER);
 			i += 3;
 			break;
 		case NVG_BEZIERTO:
-			last = nvg__lastPoint(ctx);
+			last = nvg__lastPoint(tess);
 			if (last != NULL) {
-				cp1 = &ctx->commands[i+1];
-				cp2 = &ctx->commands[i+3];
-				p = &ctx->commands[i+5];
-				nvg__tesselateBezier(ctx, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[0],p[1], 0, NVG_PT_CORNER);
+				cp1 = &tess->commands[i+1];
+				cp2 = &tess->commands[i+3];
+				p = &tess->commands[i+5];
+				if (tess->tessMode == NVG_TESS_ADAPTIVE)
+					nvg__tesselateBezierAdaptive(tess, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[0],p[1], NVG_PT_CORNER);
+				else
+					nvg__tesselateBezier(tess, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[0],p[1], 0, NVG_PT_CORNER);
 			}
 			i += 7;
 			break;
 		case NVG_CLOSE:
-			nvg__closePath(ctx);
+			nvg__closePath(tess);
 			i++;
 			break;
 		case NVG_WINDING:
-			nvg__pathWinding(ctx, (int)ctx->commands[i+1]);
+			nvg__pathWinding(tess, (int)tess->commands[i+1]);
 			i += 2;
 			break;
 		default:
@@ -1277,7 +2805,7 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 		// If the first and last points are the same, remove the last, mark as closed path.
 		p0 = &pts[path->count-1];
 		p1 = &pts[0];
-		if (nvg__ptEquals(p0->x,p0->y, p1->x,p1->y, ctx->distTol)) {
+		if (nvg__ptEquals(p0->x,p0->y, p1->x,p1->y, tess->distTol)) {
 			path->count--;
 			p0 = &pts[path->count-1];
 			path->closed = 1;
@@ -1292,7 +2820,9 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 				nvg__polyReverse(pts, path->count);
 		}
 
-		for(i = 0; i < path->count; i++) {
+		for(i = nvg__segmentsSimd(pts, path->count, cache->bounds); i < path->count; i++) {
+			p0 = &pts[i];
+			p1 = &pts[i+1 < path->count ? i+1 : 0];
 			// Calculate segment direction and length
 			p0->dx = p1->x - p0->x;
 			p0->dy = p1->y - p0->y;
@@ -1302,10 +2832,11 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 			cache->bounds[1] = nvg__minf(cache->bounds[1], p0->y);
 			cache->bounds[2] = nvg__maxf(cache->bounds[2], p0->x);
 			cache->bounds[3] = nvg__maxf(cache->bounds[3], p0->y);
-			// Advance
-			p0 = p1++;
 		}
 	}
+
+	tess->peakPoints = nvg__maxi(tess->peakPoints, cache->npoints);
+	tess->peakPaths = nvg__maxi(tess->peakPaths, cache->npaths);
 }
 
 static int nvg__curveDivs(float r, float arc, float tol)
@@ -1533,9 +3064,111 @@ static NVGvertex* nvg__roundCapEnd(NVGvertex* dst, NVGpoint* p,
 }
 
 
-static void nvg__calculateJoins(NVGcontext* ctx, float w, int lineJoin, float miterLimit)
+static void nvg__setJoinFlags(NVGpath* path, NVGpoint* p1, int left, int innerBevel, int bevel, int* nleft)
 {
-	NVGpathCache* cache = ctx->cache;
+	// Clear flags, but keep the corner.
+	p1->flags = (p1->flags & NVG_PT_CORNER) ? NVG_PT_CORNER : 0;
+
+	// Keep track of left turns.
+	if (left) {
+		(*nleft)++;
+		p1->flags |= NVG_PT_LEFT;
+	}
+
+	// Use bevel for the inner join when the miter would be too long.
+	if (innerBevel)
+		p1->flags |= NVG_PR_INNERBEVEL;
+
+	// Check to see if the corner needs to be beveled.
+	if ((p1->flags & NVG_PT_CORNER) && bevel)
+		p1->flags |= NVG_PT_BEVEL;
+
+	if ((p1->flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) != 0)
+		path->nbevel++;
+}
+
+static void nvg__joinPoint(NVGpath* path, NVGpoint* p0, NVGpoint* p1, float iw, int lineJoin, float miterLimit, int* nleft)
+{
+	float dlx0, dly0, dlx1, dly1, dmr2, cross, limit;
+	dlx0 = p0->dy;
+	dly0 = -p0->dx;
+	dlx1 = p1->dy;
+	dly1 = -p1->dx;
+	// Calculate extrusions
+	p1->dmx = (dlx0 + dlx1) * 0.5f;
+	p1->dmy = (dly0 + dly1) * 0.5f;
+	dmr2 = p1->dmx*p1->dmx + p1->dmy*p1->dmy;
+	if (dmr2 > 0.000001f) {
+		float scale = 1.0f / dmr2;
+		if (scale > 600.0f) {
+			scale = 600.0f;
+		}
+		p1->dmx *= scale;
+		p1->dmy *= scale;
+	}
+
+	cross = p1->dx * p0->dy - p0->dx * p1->dy;
+	// Calculate if we should use bevel or miter for inner join.
+	limit = nvg__maxf(1.01f, nvg__minf(p0->len, p1->len) * iw);
+	nvg__setJoinFlags(path, p1, cross > 0.0f, (dmr2 * limit*limit) < 1.0f,
+					  (dmr2 * miterLimit*miterLimit) < 1.0f || lineJoin == NVG_BEVEL || lineJoin == NVG_ROUND, nleft);
+}
+
+// Does nvg__joinPoint() for the points from 1 up to the returned index, the caller does the rest.
+#ifdef NVG_SIMD
+static int nvg__joinsSimd(NVGpath* path, NVGpoint* pts, float iw, int lineJoin, float miterLimit, int* nleft)
+{
+	NVGv4 zero = nvg__v4splat(0.0f), one = nvg__v4splat(1.0f), eps = nvg__v4splat(0.000001f);
+	NVGv4 half = nvg__v4splat(0.5f), mhalf = nvg__v4splat(-0.5f), maxScale = nvg__v4splat(600.0f);
+	NVGv4 minLimit = nvg__v4splat(1.01f), viw = nvg__v4splat(iw), ml = nvg__v4splat(miterLimit);
+	int roundOrBevel = lineJoin == NVG_BEVEL || lineJoin == NVG_ROUND;
+	float dmx[4], dmy[4];
+	int j, k;
+
+	for (j = 1; j + 4 <= path->count; j += 4) {
+		NVGpoint* p = &pts[j];
+		NVGv4 dx0 = nvg__v4set(p[-1].dx, p[0].dx, p[1].dx, p[2].dx);
+		NVGv4 dy0 = nvg__v4set(p[-1].dy, p[0].dy, p[1].dy, p[2].dy);
+		NVGv4 len0 = nvg__v4set(p[-1].len, p[0].len, p[1].len, p[2].len);
+		NVGv4 dx1 = nvg__v4set(p[0].dx, p[1].dx, p[2].dx, p[3].dx);
+		NVGv4 dy1 = nvg__v4set(p[0].dy, p[1].dy, p[2].dy, p[3].dy);
+		NVGv4 len1 = nvg__v4set(p[0].len, p[1].len, p[2].len, p[3].len);
+		// Calculate extrusions, -(a+b)*0.5 equals (-a + -b)*0.5 exactly.
+		NVGv4 mx = nvg__v4mul(nvg__v4add(dy0, dy1), half);
+		NVGv4 my = nvg__v4mul(nvg__v4add(dx0, dx1), mhalf);
+		NVGv4 dmr2 = nvg__v4add(nvg__v4mul(mx, mx), nvg__v4mul(my, my));
+		NVGv4 scale = nvg__v4min(nvg__v4div(one, dmr2), maxScale);
+		NVGv4 cross = nvg__v4sub(nvg__v4mul(dx1, dy0), nvg__v4mul(dx0, dy1));
+		NVGv4 limit = nvg__v4max(minLimit, nvg__v4mul(nvg__v4min(len0, len1), viw));
+		int left = nvg__v4gtmask(cross, zero);
+		int inner = nvg__v4gtmask(one, nvg__v4mul(nvg__v4mul(dmr2, limit), limit));
+		int miter = nvg__v4gtmask(one, nvg__v4mul(nvg__v4mul(dmr2, ml), ml));
+		nvg__v4store(dmx, nvg__v4selgt(dmr2, eps, nvg__v4mul(mx, scale), mx));
+		nvg__v4store(dmy, nvg__v4selgt(dmr2, eps, nvg__v4mul(my, scale), my));
+		for (k = 0; k < 4; k++) {
+			p[k].dmx = dmx[k];
+			p[k].dmy = dmy[k];
+			nvg__setJoinFlags(path, &p[k], (left >> k) & 1, (inner >> k) & 1, ((miter >> k) & 1) || roundOrBevel, nleft);
+		}
+	}
+	return j;
+}
+#else
+static int nvg__joinsSimd(NVGpath* path, NVGpoint* pts, float iw, int lineJoin, float miterLimit, int* nleft)
+{
+	NVG_NOTUSED(path);
+	NVG_NOTUSED(pts);
+	NVG_NOTUSED(iw);
+	NVG_NOTUSED(lineJoin);
+	NVG_NOTUSED(miterLimit);
+	NVG_NOTUSED(nleft);
+	return 1;
+}
+#endif
+
+static void nvg__calculateJoins(NVGtess* tess, float w, int lineJoin, float miterLimit)
+{
+	NVGpathCache* cache = tess->cache;
 	int i, j;
 	float iw = 0.0f;
 
@@ -1545,57 +3178,15 @@ static void nvg__calculateJoins(NVGcontext* ctx, float w, int lineJoin, float mi
 	for (i = 0; i < cache->npaths; i++) {
 		NVGpath* path = &cache->paths[i];
 		NVGpoint* pts = &cache->points[path->first];
-		NVGpoint* p0 = &pts[path->count-1];
-		NVGpoint* p1 = &pts[0];
 		int nleft = 0;
 
 		path->nbevel = 0;
 
-		for (j = 0; j < path->count; j++) {
-			float dlx0, dly0, dlx1, dly1, dmr2, cross, limit;
-			dlx0 = p0->dy;
-			dly0 = -p0->dx;
-			dlx1 = p1->dy;
-			dly1 = -p1->dx;
-			// Calculate extrusions
-			p1->dmx = (dlx0 + dlx1) * 0.5f;
-			p1->dmy = (dly0 + dly1) * 0.5f;
-			dmr2 = p1->dmx*p1->dmx + p1->dmy*p1->dmy;
-			if (dmr2 > 0.000001f) {
-				float scale = 1.0f / dmr2;
-				if (scale > 600.0f) {
-					scale = 600.0f;
-				}
-				p1->dmx *= scale;
-				p1->dmy *= scale;
-			}
-
-			// Clear flags, but keep the corner.
-			p1->flags = (p1->flags & NVG_PT_CORNER) ? NVG_PT_CORNER : 0;
-
-			// Keep track of left turns.
-			cross = p1->dx * p0->dy - p0->dx * p1->dy;
-			if (cross > 0.0f) {
-				nleft++;
-				p1->flags |= NVG_PT_LEFT;
-			}
-
-			// Calculate if we should use bevel or miter for inner join.
-			limit = nvg__maxf(1.01f, nvg__minf(p0->len, p1->len) * iw);
-			if ((dmr2 * limit*limit) < 1.0f)
-				p1->flags |= NVG_PR_INNERBEVEL;
-
-			// Check to see if the corner needs to be beveled.
-			if (p1->flags & NVG_PT_CORNER) {
-				if ((dmr2 * miterLimit*miterLimit) < 1.0f || lineJoin == NVG_BEVEL || lineJoin == NVG_ROUND) {
-					p1->flags |= NVG_PT_BEVEL;
-				}
-			}
-
-			if ((p1->flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) != 0)
-				path->nbevel++;
-
-			p0 = p1++;
+		if (path->count > 0) {
+			// The first point joins the segment closing the path.
+			nvg__joinPoint(path, &pts[path->count-1], &pts[0], iw, lineJoin, miterLimit, &nleft);
+			for (j = nvg__joinsSimd(path, pts, iw, lineJoin, miterLimit, &nleft); j < path->count; j++)
+				nvg__joinPoint(path, &pts[j-1], &pts[j], iw, lineJoin, miterLimit, &nleft);
 		}
 
 		path->convex = (nleft == path->count) ? 1 : 0;
@@ -1603,16 +3194,16 @@ static void nvg__calculateJoins(NVGcontext* ctx, float w, int lineJoin, float mi
 }
 
 
-static int nvg__expandStroke(NVGcontext* ctx, float w, int lineCap, int lineJoin, float miterLimit)
+static int nvg__expandStroke(NVGtess* tess, float w, int lineCap, int lineJoin, float miterLimit)
 {	
-	NVGpathCache* cache = ctx->cache;
+	NVGpathCache* cache = tess->cache;
 	NVGvertex* verts;
 	NVGvertex* dst;
 	int cverts, i, j;
-	float aa = ctx->fringeWidth;
-	int ncap = nvg__curveDivs(w, NVG_PI, ctx->tessTol);	// Calculate divisions per half circle.
+	float aa = tess->fringeWidth;
+	int ncap = nvg__curveDivs(w, NVG_PI, tess->tessTol);	// Calculate divisions per half circle.
 
-	nvg__calculateJoins(ctx, w, lineJoin, miterLimit);
+	nvg__calculateJoins(tess, w, lineJoin, miterLimit);
 
 	// Calculate max vertex usage.
 	cverts = 0;
@@ -1633,7 +3224,7 @@ static int nvg__expandStroke(NVGcontext* ctx, float w, int lineCap, int lineJoin
 		}
 	}
 
-	verts = nvg__allocTempVerts(ctx, cverts);
+	verts = nvg__allocTempVerts(tess, cverts);
 	if (verts == NULL) return 0;
 
 	for (i = 0; i < cache->npaths; i++) {
@@ -1718,60 +3309,387 @@ static int nvg__expandStroke(NVGcontext* ctx, float w, int lineCap, int lineJoin
 	return 1;
 }
 
-static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLimit)
+static int* nvg__allocTempNodes(NVGtess* tess, int nnodes)
 {
-	NVGpathCache* cache = ctx->cache;
-	NVGvertex* verts;
-	NVGvertex* dst;
-	int cverts, convex, i, j;
-	float aa = ctx->fringeWidth;
-	int fringe = w > 0.0f;
+	if (nnodes > tess->cache->cnodes) {
+		int* nodes;
+		int cnodes = (nnodes + 0xff) & ~0xff;
+		nodes = (int*)realloc(tess->cache->nodes, sizeof(int)*cnodes);
+		if (nodes == NULL) return NULL;
+		tess->cache->nodes = nodes;
+		tess->cache->cnodes = cnodes;
+	}
+	return tess->cache->nodes;
+}
 
-	nvg__calculateJoins(ctx, w, lineJoin, miterLimit);
+static int nvg__onSegment(const NVGvertex* a, const NVGvertex* b, const NVGvertex* p)
+{
+	return p->x >= nvg__minf(a->x, b->x) && p->x <= nvg__maxf(a->x, b->x) &&
+		p->y >= nvg__minf(a->y, b->y) && p->y <= nvg__maxf(a->y, b->y);
+}
 
-	// Calculate max vertex usage.
-	cverts = 0;
-	for (i = 0; i < cache->npaths; i++) {
-		NVGpath* path = &cache->paths[i];
-		cverts += path->count + path->nbevel + 1;
-		if (fringe)
-			cverts += (path->count + path->nbevel*5 + 1) * 2; // plus one for loop
+// Whether segments ab and cd cross or touch.
+static int nvg__segmentsTouch(const NVGvertex* a, const NVGvertex* b, const NVGvertex* c, const NVGvertex* d)
+{
+	float d1, d2, d3, d4;
+	if (nvg__maxf(a->x, b->x) < nvg__minf(c->x, d->x) || nvg__maxf(c->x, d->x) < nvg__minf(a->x, b->x) ||
+		nvg__maxf(a->y, b->y) < nvg__minf(c->y, d->y) || nvg__maxf(c->y, d->y) < nvg__minf(a->y, b->y))
+		return 0;
+	d1 = nvg__triarea2(c->x,c->y, d->x,d->y, a->x,a->y);
+	d2 = nvg__triarea2(c->x,c->y, d->x,d->y, b->x,b->y);
+	d3 = nvg__triarea2(a->x,a->y, b->x,b->y, c->x,c->y);
+	d4 = nvg__triarea2(a->x,a->y, b->x,b->y, d->x,d->y);
+	if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+		return 1;
+	return (d1 == 0 && nvg__onSegment(c, d, a)) || (d2 == 0 && nvg__onSegment(c, d, b)) ||
+		(d3 == 0 && nvg__onSegment(a, b, c)) || (d4 == 0 && nvg__onSegment(a, b, d));
+}
+
+static int nvg__pointInOutline(const NVGvertex* pts, int npts, float x, float y)
+{
+	int i, j, inside = 0;
+	for (i = 0, j = npts-1; i < npts; j = i++) {
+		if ((pts[i].y > y) != (pts[j].y > y) &&
+			x < (pts[j].x - pts[i].x) * (y - pts[i].y) / (pts[j].y - pts[i].y) + pts[i].x)
+			inside = !inside;
 	}
+	return inside;
+}
 
-	verts = nvg__allocTempVerts(ctx, cverts);
-	if (verts == NULL) return 0;
+static int nvg__samePos(const NVGvertex* a, const NVGvertex* b)
+{
+	return a->x == b->x && a->y == b->y;
+}
 
-	convex = cache->npaths == 1 && cache->paths[0].convex;
+// Whether the direction from node n to p lies within the interior angle at n.
+static int nvg__inCorner(const NVGvertex* base, const int* next, const int* prev, const int* vert, int n, const NVGvertex* p)
+{
+	const NVGvertex* a = &base[vert[prev[n]]];
+	const NVGvertex* b = &base[vert[n]];
+	const NVGvertex* c = &base[vert[next[n]]];
+	int left = nvg__triarea2(a->x,a->y, b->x,b->y, p->x,p->y) >= 0;
+	int right = nvg__triarea2(b->x,b->y, c->x,c->y, p->x,p->y) >= 0;
+	if (nvg__triarea2(a->x,a->y, b->x,b->y, c->x,c->y) > 0)
+		return left && right;
+	return left || right;
+}
 
-	for (i = 0; i < cache->npaths; i++) {
-		NVGpath* path = &cache->paths[i];
-		NVGpoint* pts = &cache->points[path->first];
-		NVGpoint* p0;
-		NVGpoint* p1;
-		float rw, lw, woff;
-		float ru, lu;
+// Finds the node of the ring through start that the hole vertex h can be joined to without crossing an edge.
+static int nvg__holeBridge(const NVGvertex* base, const int* next, const int* prev, const int* vert, int start, const NVGvertex* h)
+{
+	float bestx = 1e30f, bestt = 1e30f, bestd = 1e30f;
+	int n, p = -1, q = -1;
+	NVGvertex hit;
+	// Closest edge to the right of h, the ray meets it at hit.
+	n = start;
+	do {
+		const NVGvertex* a = &base[vert[n]];
+		const NVGvertex* b = &base[vert[next[n]]];
+		if (a->y != b->y && ((a->y <= h->y && h->y <= b->y) || (b->y <= h->y && h->y <= a->y))) {
+			float x = a->x + (h->y - a->y) * (b->x - a->x) / (b->y - a->y);
+			if (x >= h->x && x < bestx) {
+				bestx = x;
+				p = a->x > b->x ? n : next[n];
+			}
+		}
+		n = next[n];
+	} while (n != start);
+	if (p == -1) return -1;
+	hit.x = bestx;
+	hit.y = h->y;
+	// The edge end may be hidden behind other vertices, take the one closest to the ray within the
+	// triangle h, hit, p instead.
+	q = p;
+	n = start;
+	do {
+		const NVGvertex* v = &base[vert[n]];
+		const NVGvertex* pv = &base[vert[p]];
+		float dx = v->x - h->x, dy = nvg__absf(v->y - h->y);
+		if (n != p && dx > 0 && v->x <= nvg__maxf(hit.x, pv->x) &&
+			nvg__triarea2(h->x,h->y, hit.x,hit.y, v->x,v->y) * nvg__triarea2(h->x,h->y, hit.x,hit.y, pv->x,pv->y) >= 0 &&
+			nvg__triarea2(hit.x,hit.y, pv->x,pv->y, v->x,v->y) * nvg__triarea2(hit.x,hit.y, pv->x,pv->y, h->x,h->y) >= 0 &&
+			nvg__triarea2(pv->x,pv->y, h->x,h->y, v->x,v->y) * nvg__triarea2(pv->x,pv->y, h->x,h->y, hit.x,hit.y) >= 0) {
+			float t = dy / dx;
+			if (t < bestt || (t == bestt && dx < bestd)) {
+				bestt = t;
+				bestd = dx;
+				q = n;
+			}
+		}
+		n = next[n];
+	} while (n != start);
+	// Earlier bridges duplicate nodes, pick the copy whose corner faces h.
+	n = start;
+	do {
+		if (nvg__samePos(&base[vert[n]], &base[vert[q]]) && nvg__inCorner(base, next, prev, vert, n, h))
+			return n;
+		n = next[n];
+	} while (n != start);
+	return q;
+}
 
-		// Calculate shape vertices.
-		woff = 0.5f*aa;
-		dst = verts;
-		path->fill = dst;
+static int nvg__isReflex(const NVGvertex* base, const int* next, const int* prev, const int* vert, int n)
+{
+	const NVGvertex* a = &base[vert[prev[n]]];
+	const NVGvertex* b = &base[vert[n]];
+	const NVGvertex* c = &base[vert[next[n]]];
+	return nvg__triarea2(a->x,a->y, b->x,b->y, c->x,c->y) <= 0;
+}
 
-		if (fringe) {
-			// Looping
-			p0 = &pts[path->count-1];
-			p1 = &pts[0];
-			for (j = 0; j < path->count; ++j) {
-				if (p1->flags & NVG_PT_BEVEL) {
-					float dlx0 = p0->dy;
-					float dly0 = -p0->dx;
-					float dlx1 = p1->dy;
-					float dly1 = -p1->dx;
-					if (p1->flags & NVG_PT_LEFT) {
-						float lx = p1->x + p1->dmx * woff;
-						float ly = p1->y + p1->dmy * woff;
-						nvg__vset(dst, lx, ly, 0.5f,1); dst++;
-					} else {
-						float lx0 = p1->x + dlx0 * woff;
+// Whether ear is convex and none of the reflex nodes lies within the triangle it forms with its neighbours.
+static int nvg__isEar(const NVGvertex* base, const int* next, const int* prev, const int* vert, int ear,
+					  const int* reflex, int nreflex)
+{
+	const NVGvertex* a = &base[vert[prev[ear]]];
+	const NVGvertex* b = &base[vert[ear]];
+	const NVGvertex* c = &base[vert[next[ear]]];
+	int i;
+	if (nvg__triarea2(a->x,a->y, b->x,b->y, c->x,c->y) <= 0)
+		return 0;
+	// Only reflex vertices can lie within an ear.
+	for (i = 0; i < nreflex; i++) {
+		const NVGvertex* p = &base[vert[reflex[i]]];
+		// Copies of the corners left by hole bridges don't count.
+		if (nvg__triarea2(a->x,a->y, b->x,b->y, p->x,p->y) >= 0 &&
+			nvg__triarea2(b->x,b->y, c->x,c->y, p->x,p->y) >= 0 &&
+			nvg__triarea2(c->x,c->y, a->x,a->y, p->x,p->y) >= 0 &&
+			!nvg__samePos(p, a) && !nvg__samePos(p, b) && !nvg__samePos(p, c))
+			return 0;
+	}
+	return 1;
+}
+
+// Triangulates the fill outlines of the path cache when they are simple, neither cross nor touch each
+// other, and every outline is either a solid at the top level or a hole directly inside a solid. Holes are
+// bridged into their solid and the result is clipped ear by ear. Writes the triangles to dst and returns
+// their vertex count, or 0 if the fill has to go through the stencil.
+static int nvg__triangulateFill(NVGtess* tess, NVGvertex* dst)
+{
+	NVGpathCache* cache = tess->cache;
+	NVGpath* paths = cache->paths;
+	NVGvertex* base = paths[0].fill;
+	int npaths = cache->npaths;
+	int i, j, k, l, nverts = 0, nnodes, ndst = 0;
+	int *nodes, *next, *prev, *vert, *reflex, *parent, *first;
+
+	for (i = 0; i < npaths; i++) {
+		if (paths[i].nfill < 3) return 0;
+		nverts += paths[i].nfill;
+	}
+	if (nverts > NVG_MAX_TRIANGULATE_VERTS) return 0;
+
+	nodes = nvg__allocTempNodes(tess, (nverts + 2*npaths) * 4 + npaths * 2);
+	if (nodes == NULL) return 0;
+	next = nodes;
+	prev = next + nverts + 2*npaths;
+	vert = prev + nverts + 2*npaths;
+	reflex = vert + nverts + 2*npaths;
+	parent = reflex + nverts + 2*npaths;
+	first = parent + npaths;
+
+	// One ring per outline, in outline order.
+	nnodes = 0;
+	for (i = 0; i < npaths; i++) {
+		int n = paths[i].nfill, start = (int)(paths[i].fill - base);
+		first[i] = nnodes;
+		for (k = 0; k < n; k++) {
+			vert[nnodes+k] = start + k;
+			next[nnodes+k] = nnodes + (k+1) % n;
+			prev[nnodes+k] = nnodes + (k+n-1) % n;
+		}
+		nnodes += n;
+	}
+
+	// No two edges may meet except neighbours at their shared vertex. Edge n runs from node n to next[n],
+	// sweep them in order of their left end.
+	for (i = 0; i < nverts; i++)
+		reflex[i] = i;
+	for (l = nverts/2; l > 0; l /= 2) {
+		for (i = l; i < nverts; i++) {
+			int e = reflex[i];
+			float x = nvg__minf(base[e].x, base[next[e]].x);
+			for (j = i; j >= l && nvg__minf(base[reflex[j-l]].x, base[next[reflex[j-l]]].x) > x; j -= l)
+				reflex[j] = reflex[j-l];
+			reflex[j] = e;
+		}
+	}
+	for (i = 0; i < nverts; i++) {
+		int e = reflex[i];
+		float maxx = nvg__maxf(base[e].x, base[next[e]].x);
+		for (j = i+1; j < nverts; j++) {
+			int f = reflex[j];
+			if (nvg__minf(base[f].x, base[next[f]].x) > maxx)
+				break;
+			if (next[e] == f || next[f] == e)
+				continue;
+			if (nvg__segmentsTouch(&base[e], &base[next[e]], &base[f], &base[next[f]]))
+				return 0;
+		}
+	}
+
+	// Solids must wind positive and holes negative, one level deep.
+	for (i = 0; i < npaths; i++) {
+		float area = 0;
+		int depth = 0;
+		const NVGvertex* p = paths[i].fill;
+		for (k = 2; k < paths[i].nfill; k++)
+			area += nvg__triarea2(p[0].x,p[0].y, p[k-1].x,p[k-1].y, p[k].x,p[k].y);
+		parent[i] = -1;
+		for (j = 0; j < npaths; j++) {
+			if (j != i && nvg__pointInOutline(paths[j].fill, paths[j].nfill, p[0].x, p[0].y)) {
+				parent[i] = j;
+				depth++;
+			}
+		}
+		if (depth > 1 || (depth == 0 && area <= 0) || (depth == 1 && area >= 0))
+			return 0;
+	}
+
+	for (i = 0; i < npaths; i++) {
+		int ear, stop, count, nreflex;
+		if (parent[i] != -1) continue;
+		count = paths[i].nfill;
+		// Join the holes rightmost first, so that no ray runs into a hole that is still separate.
+		for (;;) {
+			int hole = -1, h = -1, b, hp;
+			float maxx = -1e30f;
+			for (j = 0; j < npaths; j++) {
+				if (parent[j] != i) continue;
+				for (k = 0; k < paths[j].nfill; k++) {
+					if (paths[j].fill[k].x > maxx) {
+						maxx = paths[j].fill[k].x;
+						hole = j;
+						h = first[j] + k;
+					}
+				}
+			}
+			if (hole == -1) break;
+			parent[hole] = -2;
+			b = nvg__holeBridge(base, next, prev, vert, first[i], &base[vert[h]]);
+			if (b == -1) return 0;
+			// b -> h ... around the hole ... -> h' -> b' -> on along the solid.
+			hp = prev[h];
+			vert[nnodes] = vert[h];
+			vert[nnodes+1] = vert[b];
+			next[nnodes+1] = next[b];
+			prev[next[b]] = nnodes+1;
+			next[b] = h;
+			prev[h] = b;
+			next[hp] = nnodes;
+			prev[nnodes] = hp;
+			next[nnodes] = nnodes+1;
+			prev[nnodes+1] = nnodes;
+			nnodes += 2;
+			count += paths[hole].nfill + 2;
+		}
+
+		// Clipping an ear only makes the corners of its neighbours sharper, so reflex nodes can only
+		// turn convex and the list only ever shrinks.
+		nreflex = 0;
+		ear = first[i];
+		do {
+			if (nvg__isReflex(base, next, prev, vert, ear))
+				reflex[nreflex++] = ear;
+			ear = next[ear];
+		} while (ear != first[i]);
+
+		stop = ear;
+		while (count > 3) {
+			if (nvg__isEar(base, next, prev, vert, ear, reflex, nreflex)) {
+				int n = 0;
+				dst[ndst++] = base[vert[prev[ear]]];
+				dst[ndst++] = base[vert[ear]];
+				dst[ndst++] = base[vert[next[ear]]];
+				next[prev[ear]] = next[ear];
+				prev[next[ear]] = prev[ear];
+				for (k = 0; k < nreflex; k++)
+					if ((reflex[k] != prev[ear] && reflex[k] != next[ear]) || nvg__isReflex(base, next, prev, vert, reflex[k]))
+						reflex[n++] = reflex[k];
+				nreflex = n;
+				ear = stop = next[ear];
+				count--;
+			} else {
+				ear = next[ear];
+				if (ear == stop) {
+					// What is left may only be slivers of float noise.
+					float area = 0;
+					int n = next[ear];
+					do {
+						area += nvg__triarea2(base[vert[ear]].x,base[vert[ear]].y, base[vert[n]].x,base[vert[n]].y,
+							base[vert[next[n]]].x,base[vert[next[n]]].y);
+						n = next[n];
+					} while (next[n] != ear);
+					if (nvg__absf(area) > 1e-3f) return 0;
+					break;
+				}
+			}
+		}
+		if (count == 3) {
+			dst[ndst++] = base[vert[prev[ear]]];
+			dst[ndst++] = base[vert[ear]];
+			dst[ndst++] = base[vert[next[ear]]];
+		}
+	}
+
+	return ndst;
+}
+
+static int nvg__expandFill(NVGtess* tess, float w, int lineJoin, float miterLimit)
+{
+	NVGpathCache* cache = tess->cache;
+	NVGvertex* verts;
+	NVGvertex* dst;
+	int cverts, convex, i, j;
+	float aa = tess->fringeWidth;
+	int fringe = w > 0.0f;
+	float woff = 0.5f*aa;
+
+	nvg__calculateJoins(tess, w, lineJoin, miterLimit);
+
+	// Calculate max vertex usage.
+	cverts = 0;
+	for (i = 0; i < cache->npaths; i++) {
+		NVGpath* path = &cache->paths[i];
+		cverts += path->count + path->nbevel + 1;
+		if (fringe)
+			cverts += (path->count + path->nbevel*5 + 1) * 2; // plus one for loop
+	}
+
+	convex = cache->npaths == 1 && cache->paths[0].convex;
+	// Room for the triangles, bridging each hole adds two vertices.
+	if (!convex && tess->triangulate)
+		for (i = 0; i < cache->npaths; i++)
+			cverts += (cache->paths[i].count + cache->paths[i].nbevel + 2) * 3;
+
+	verts = nvg__allocTempVerts(tess, cverts);
+	if (verts == NULL) return 0;
+
+	// Calculate shape vertices.
+	for (i = 0; i < cache->npaths; i++) {
+		NVGpath* path = &cache->paths[i];
+		NVGpoint* pts = &cache->points[path->first];
+		NVGpoint* p0;
+		NVGpoint* p1;
+
+		dst = verts;
+		path->fill = dst;
+
+		if (fringe) {
+			// Looping
+			p0 = &pts[path->count-1];
+			p1 = &pts[0];
+			for (j = 0; j < path->count; ++j) {
+				if (p1->flags & NVG_PT_BEVEL) {
+					float dlx0 = p0->dy;
+					float dly0 = -p0->dx;
+					float dlx1 = p1->dy;
+					float dly1 = -p1->dx;
+					if (p1->flags & NVG_PT_LEFT) {
+						float lx = p1->x + p1->dmx * woff;
+						float ly = p1->y + p1->dmy * woff;
+						nvg__vset(dst, lx, ly, 0.5f,1); dst++;
+					} else {
+						float lx0 = p1->x + dlx0 * woff;
 						float ly0 = p1->y + dly0 * woff;
 						float lx1 = p1->x + dlx1 * woff;
 						float ly1 = p1->y + dly1 * woff;
@@ -1792,8 +3710,32 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 
 		path->nfill = (int)(dst - verts);
 		verts = dst;
+	}
+
+	// Simple concave and holed fills become triangles on the first path, drawn like a convex fill.
+	if (!convex && tess->triangulate) {
+		int ntris = nvg__triangulateFill(tess, verts);
+		if (ntris > 0) {
+			for (i = 0; i < cache->npaths; i++) {
+				cache->paths[i].triangles = 1;
+				cache->paths[i].nfill = 0;
+			}
+			cache->paths[0].fill = verts;
+			cache->paths[0].nfill = ntris;
+			verts += ntris;
+			convex = 1;
+		}
+	}
+
+	// Calculate fringe
+	for (i = 0; i < cache->npaths; i++) {
+		NVGpath* path = &cache->paths[i];
+		NVGpoint* pts = &cache->points[path->first];
+		NVGpoint* p0;
+		NVGpoint* p1;
+		float rw, lw;
+		float ru, lu;
 
-		// Calculate fringe
 		if (fringe) {
 			lw = w + woff;
 			rw = w - woff;
@@ -1815,7 +3757,7 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 
 			for (j = 0; j < path->count; ++j) {
 				if ((p1->flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) != 0) {
-					dst = nvg__bevelJoin(dst, p0, p1, lw, rw, lu, ru, ctx->fringeWidth);
+					dst = nvg__bevelJoin(dst, p0, p1, lw, rw, lu, ru, tess->fringeWidth);
 				} else {
 					nvg__vset(dst, p1->x + (p1->dmx * lw), p1->y + (p1->dmy * lw), lu,1); dst++;
 					nvg__vset(dst, p1->x - (p1->dmx * rw), p1->y - (p1->dmy * rw), ru,1); dst++;
@@ -1843,7 +3785,8 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 void nvgBeginPath(NVGcontext* ctx)
 {
 	ctx->ncommands = 0;
-	nvg__clearPathCache(ctx);
+	ctx->deferPathFirst = -1;
+	nvg__clearPathCache(ctx->cache);
 }
 
 void nvgMoveTo(NVGcontext* ctx, float x, float y)
@@ -2062,6 +4005,28 @@ void nvgCircle(NVGcontext* ctx, float cx, float cy, float r)
 	nvgEllipse(ctx, cx,cy, r,r);
 }
 
+int nvgDrawCallCount(NVGcontext* ctx)
+{
+	return ctx->drawCallCount;
+}
+
+int nvgTriangleCount(NVGcontext* ctx)
+{
+	return ctx->fillTriCount + ctx->strokeTriCount + ctx->textTriCount;
+}
+
+int nvgEdgeAntiAlias(NVGcontext* ctx, int enabled)
+{
+	if (ctx->params.renderEdgeAntiAlias != NULL)
+		ctx->params.edgeAntiAlias = ctx->params.renderEdgeAntiAlias(ctx->params.userPtr, enabled);
+	return ctx->params.edgeAntiAlias;
+}
+
+void nvgFrameStats(NVGcontext* ctx, NVGframeStats* stats)
+{
+	*stats = ctx->frameStats;
+}
+
 void nvgDebugDumpPathCache(NVGcontext* ctx)
 {
 	const NVGpath* path;
@@ -2084,221 +4049,3001 @@ void nvgDebugDumpPathCache(NVGcontext* ctx)
 	}
 }
 
-void nvgFill(NVGcontext* ctx)
+static int nvg__reserve(void** items, int* cap, int count, int size, int minCap)
 {
-	NVGstate* state = nvg__getState(ctx);
-	const NVGpath* path;
-	NVGpaint fillPaint = state->fill;
-	int i;
-
-	nvg__flattenPaths(ctx);
-	if (ctx->params.edgeAntiAlias)
-		nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
-	else
-		nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
-
-	// Apply global alpha
-	fillPaint.innerColor.a *= state->alpha;
-	fillPaint.outerColor.a *= state->alpha;
-
-	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, &state->scissor, ctx->fringeWidth,
-						   ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+	void* p;
+	int c;
+	if (count <= *cap) return 1;
+	c = nvg__maxi(count, minCap) + *cap/2;
+	p = realloc(*items, (size_t)c * size);
+	if (p == NULL) return 0;
+	*items = p;
+	*cap = c;
+	return 1;
+}
 
-	// Count triangles
-	for (i = 0; i < ctx->cache->npaths; i++) {
-		path = &ctx->cache->paths[i];
-		ctx->fillTriCount += path->nfill-2;
-		ctx->fillTriCount += path->nstroke-2;
-		ctx->drawCallCount += 2;
+static NVGdrawCmd* nvg__allocDrawCmd(NVGdrawList* list, int type, NVGpaint* paint, NVGscissor* scissor)
+{
+	NVGdrawCmd* cmd;
+	if (!nvg__reserve((void**)&list->cmds, &list->ccmds, list->ncmds+1, sizeof(NVGdrawCmd), 16)) {
+		list->failed = 1;
+		return NULL;
+	}
+	cmd = &list->cmds[list->ncmds++];
+	memset(cmd, 0, sizeof(NVGdrawCmd));
+	cmd->type = type;
+	cmd->paint = *paint;
+	cmd->scissor = *scissor;
+	cmd->pathOffset = list->npaths;
+	cmd->vertOffset = list->nverts;
+	return cmd;
+}
+
+static int nvg__recordVerts(NVGdrawList* list, const NVGvertex* verts, int nverts)
+{
+	int offset = list->nverts;
+	if (nverts <= 0) return offset;
+	if (!nvg__reserve((void**)&list->verts, &list->cverts, list->nverts+nverts, sizeof(NVGvertex), 256)) {
+		list->failed = 1;
+		return -1;
 	}
+	memcpy(&list->verts[offset], verts, sizeof(NVGvertex)*nverts);
+	list->nverts += nverts;
+	return offset;
 }
 
-void nvgStroke(NVGcontext* ctx)
+static void nvg__vertBounds(float* bounds, const NVGvertex* verts, int nverts)
 {
-	NVGstate* state = nvg__getState(ctx);
-	float scale = nvg__getAverageScale(state->xform);
-	float strokeWidth = nvg__clampf(state->strokeWidth * scale, 0.0f, 200.0f);
-	NVGpaint strokePaint = state->stroke;
-	const NVGpath* path;
 	int i;
-
-	if (strokeWidth < ctx->fringeWidth) {
-		// If the stroke width is less than pixel size, use alpha to emulate coverage.
-		// Since coverage is area, scale by alpha*alpha.
-		float alpha = nvg__clampf(strokeWidth / ctx->fringeWidth, 0.0f, 1.0f);
-		strokePaint.innerColor.a *= alpha*alpha;
-		strokePaint.outerColor.a *= alpha*alpha;
-		strokeWidth = ctx->fringeWidth;
+	for (i = 0; i < nverts; i++) {
+		bounds[0] = nvg__minf(bounds[0], verts[i].x);
+		bounds[1] = nvg__minf(bounds[1], verts[i].y);
+		bounds[2] = nvg__maxf(bounds[2], verts[i].x);
+		bounds[3] = nvg__maxf(bounds[3], verts[i].y);
 	}
+}
 
-	// Apply global alpha
-	strokePaint.innerColor.a *= state->alpha;
-	strokePaint.outerColor.a *= state->alpha;
+static void nvg__recordPaths(NVGdrawList* list, NVGdrawCmd* cmd, const NVGpath* paths, int npaths)
+{
+	int i;
+	cmd->cullBounds[0] = cmd->cullBounds[1] = 1e6f;
+	cmd->cullBounds[2] = cmd->cullBounds[3] = -1e6f;
+	if (!nvg__reserve((void**)&list->paths, &list->cpaths, list->npaths+npaths, sizeof(NVGdrawPath), 16)) {
+		list->failed = 1;
+		return;
+	}
+	for (i = 0; i < npaths; i++) {
+		NVGdrawPath* dst = &list->paths[list->npaths++];
+		dst->path = paths[i];
+		dst->path.fill = NULL;
+		dst->path.stroke = NULL;
+		dst->fillOffset = nvg__recordVerts(list, paths[i].fill, paths[i].nfill);
+		dst->strokeOffset = nvg__recordVerts(list, paths[i].stroke, paths[i].nstroke);
+		nvg__vertBounds(cmd->cullBounds, paths[i].fill, paths[i].nfill);
+		nvg__vertBounds(cmd->cullBounds, paths[i].stroke, paths[i].nstroke);
+	}
+	cmd->npaths = npaths;
+}
 
-	nvg__flattenPaths(ctx);
+// Deferred tessellation
 
-	if (ctx->params.edgeAntiAlias)
-		nvg__expandStroke(ctx, strokeWidth*0.5f + ctx->fringeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
-	else
-		nvg__expandStroke(ctx, strokeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+// Paths are deferred unless they have to be recorded into a draw list right away.
+static int nvg__deferring(NVGcontext* ctx)
+{
+	return ctx->parallel != NULL && ctx->ndrawLists == 0 && ctx->recordOnly == 0;
+}
 
-	ctx->params.renderStroke(ctx->params.userPtr, &strokePaint, &state->scissor, ctx->fringeWidth,
-							 strokeWidth, ctx->cache->paths, ctx->cache->npaths);
+static NVGdeferredOp* nvg__allocDeferredOp(NVGcontext* ctx, int type, NVGpaint* paint, NVGscissor* scissor)
+{
+	NVGdeferredOp* op;
+	if (!nvg__reserve((void**)&ctx->deferOps, &ctx->cdeferOps, ctx->ndeferOps+1, sizeof(NVGdeferredOp), 64))
+		return NULL;
+	op = &ctx->deferOps[ctx->ndeferOps++];
+	memset(op, 0, sizeof(*op));
+	op->type = type;
+	op->paint = *paint;
+	op->scissor = *scissor;
+	return op;
+}
 
-	// Count triangles
-	for (i = 0; i < ctx->cache->npaths; i++) {
-		path = &ctx->cache->paths[i];
-		ctx->strokeTriCount += path->nstroke-2;
-		ctx->drawCallCount++;
+// Copies the current path once, a fill and a stroke of the same path share it.
+static NVGdeferredOp* nvg__deferPath(NVGcontext* ctx, int type, NVGpaint* paint, NVGscissor* scissor)
+{
+	NVGdeferredOp* op;
+	if (ctx->deferPathFirst < 0) {
+		if (!nvg__reserve((void**)&ctx->deferCommands, &ctx->cdeferCommands, ctx->ndeferCommands+ctx->ncommands, sizeof(float), 256))
+			return NULL;
+		memcpy(&ctx->deferCommands[ctx->ndeferCommands], ctx->commands, sizeof(float)*ctx->ncommands);
+		ctx->deferPathFirst = ctx->ndeferCommands;
+		ctx->ndeferCommands += ctx->ncommands;
 	}
+	op = nvg__allocDeferredOp(ctx, type, paint, scissor);
+	if (op == NULL) return NULL;
+	op->first = ctx->deferPathFirst;
+	op->count = ctx->ncommands;
+	return op;
 }
 
-// Add fonts
-int nvgCreateFont(NVGcontext* ctx, const char* name, const char* path)
+static void nvg__deferTriangles(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts)
 {
-	return fonsAddFont(ctx->fs, name, path);
+	NVGdeferredOp* op;
+	if (!nvg__reserve((void**)&ctx->deferVerts, &ctx->cdeferVerts, ctx->ndeferVerts+nverts, sizeof(NVGvertex), 256))
+		return;
+	op = nvg__allocDeferredOp(ctx, NVG_DEFER_TRIANGLES, paint, scissor);
+	if (op == NULL) return;
+	memcpy(&ctx->deferVerts[ctx->ndeferVerts], verts, sizeof(NVGvertex)*nverts);
+	op->first = ctx->ndeferVerts;
+	op->count = nverts;
+	ctx->ndeferVerts += nverts;
 }
 
-int nvgCreateFontMem(NVGcontext* ctx, const char* name, unsigned char* data, int ndata, int freeData)
+static void nvg__deferShape(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, const float* shape, const NVGvertex* verts, int nverts)
 {
-	return fonsAddFontMem(ctx->fs, name, data, ndata, freeData);
+	NVGdeferredOp* op;
+	if (!nvg__reserve((void**)&ctx->deferVerts, &ctx->cdeferVerts, ctx->ndeferVerts+nverts, sizeof(NVGvertex), 256))
+		return;
+	op = nvg__allocDeferredOp(ctx, NVG_DEFER_SHAPE, paint, scissor);
+	if (op == NULL) return;
+	memcpy(&ctx->deferVerts[ctx->ndeferVerts], verts, sizeof(NVGvertex)*nverts);
+	memcpy(op->shape, shape, sizeof(op->shape));
+	op->first = ctx->ndeferVerts;
+	op->count = nverts;
+	ctx->ndeferVerts += nverts;
+}
+
+// Only touches the operation and its own path cache, so operations can run on any thread.
+static void nvg__tessellateDeferred(void* data, int index)
+{
+	NVGcontext* ctx = (NVGcontext*)data;
+	NVGdeferredOp* op = &ctx->deferOps[index];
+	if (op->tess.cache == NULL) return;
+	nvg__clearPathCache(op->tess.cache);
+	nvg__flattenPaths(&op->tess);
+	if (op->type == NVG_DEFER_FILL)
+		nvg__expandFill(&op->tess, op->expandWidth, NVG_MITER, 2.4f);
+	else
+		nvg__expandStroke(&op->tess, op->expandWidth, op->lineCap, op->lineJoin, op->miterLimit);
 }
 
-int nvgFindFont(NVGcontext* ctx, const char* name)
+static void nvg__countFill(NVGcontext* ctx, NVGpathCache* cache)
 {
-	if (name == NULL) return -1;
-	return fonsGetFontByName(ctx->fs, name);
+	int i;
+	for (i = 0; i < cache->npaths; i++) {
+		const NVGpath* path = &cache->paths[i];
+		ctx->fillTriCount += path->nfill-2;
+		ctx->fillTriCount += path->nstroke-2;
+		ctx->drawCallCount += 2;
+	}
 }
 
-// State setting
-void nvgFontSize(NVGcontext* ctx, float size)
+static void nvg__countStroke(NVGcontext* ctx, NVGpathCache* cache)
 {
-	NVGstate* state = nvg__getState(ctx);
-	state->fontSize = size;
+	int i;
+	for (i = 0; i < cache->npaths; i++) {
+		ctx->strokeTriCount += cache->paths[i].nstroke-2;
+		ctx->drawCallCount++;
+	}
 }
 
-void nvgFontBlur(NVGcontext* ctx, float blur)
+// Tessellates all deferred paths, in parallel through the callback, and submits the operations in order.
+static void nvg__flushDeferred(NVGcontext* ctx)
 {
-	NVGstate* state = nvg__getState(ctx);
-	state->fontBlur = blur;
+	int i;
+	if (ctx->ndeferOps == 0) return;
+
+	nvg__beginProfile(ctx, "nanovg tessellate");
+	for (i = 0; i < ctx->ndeferOps; i++) {
+		NVGdeferredOp* op = &ctx->deferOps[i];
+		NVGpathCache* cache = NULL;
+		if (op->type == NVG_DEFER_TRIANGLES || op->type == NVG_DEFER_SHAPE) continue;
+		if (i >= ctx->ndeferCaches) {
+			if (nvg__reserve((void**)&ctx->deferCaches, &ctx->cdeferCaches, i+1, sizeof(NVGpathCache*), 16) &&
+				(ctx->deferCaches[i] = nvg__allocPathCache()) != NULL)
+				ctx->ndeferCaches = i+1;
+		}
+		if (i < ctx->ndeferCaches)
+			cache = ctx->deferCaches[i];
+		nvg__beginTess(ctx, &op->tess, cache, &ctx->deferCommands[op->first], op->count);
+	}
+	if (ctx->parallel != NULL && ctx->ndeferOps > 1)
+		ctx->parallel(ctx->parallelUser, nvg__tessellateDeferred, ctx, ctx->ndeferOps);
+	else
+		for (i = 0; i < ctx->ndeferOps; i++)
+			nvg__tessellateDeferred(ctx, i);
+	nvg__endProfile(ctx);
+
+	for (i = 0; i < ctx->ndeferOps; i++) {
+		NVGdeferredOp* op = &ctx->deferOps[i];
+		NVGpathCache* cache = op->tess.cache;
+		if (op->type == NVG_DEFER_TRIANGLES) {
+			ctx->params.renderTriangles(ctx->params.userPtr, &op->paint, &op->scissor, &ctx->deferVerts[op->first], op->count);
+			continue;
+		}
+		if (op->type == NVG_DEFER_SHAPE) {
+			ctx->params.renderShape(ctx->params.userPtr, &op->paint, &op->scissor, ctx->fringeWidth,
+									op->shape, &ctx->deferVerts[op->first], op->count);
+			continue;
+		}
+		if (cache == NULL) continue;
+		nvg__endTess(ctx, &op->tess);
+		if (op->type == NVG_DEFER_FILL) {
+			ctx->params.renderFill(ctx->params.userPtr, &op->paint, &op->scissor, ctx->fringeWidth,
+								   cache->bounds, cache->paths, cache->npaths);
+			nvg__countFill(ctx, cache);
+		} else {
+			ctx->params.renderStroke(ctx->params.userPtr, &op->paint, &op->scissor, ctx->fringeWidth,
+									 op->strokeWidth, cache->paths, cache->npaths);
+			nvg__countStroke(ctx, cache);
+		}
+	}
+
+	ctx->peakDeferOps = nvg__maxi(ctx->peakDeferOps, ctx->ndeferOps);
+	ctx->peakDeferCommands = nvg__maxi(ctx->peakDeferCommands, ctx->ndeferCommands);
+	ctx->peakDeferVerts = nvg__maxi(ctx->peakDeferVerts, ctx->ndeferVerts);
+	ctx->ndeferOps = 0;
+	ctx->ndeferCommands = 0;
+	ctx->ndeferVerts = 0;
+	ctx->deferPathFirst = -1;
 }
 
-void nvgTextLetterSpacing(NVGcontext* ctx, float spacing)
+void nvgFrameMemoryPeaks(NVGcontext* ctx, int frames, NVGframeMemory* mem)
 {
-	NVGstate* state = nvg__getState(ctx);
-	state->letterSpacing = spacing;
+	int i;
+	memset(mem, 0, sizeof(*mem));
+	frames = nvg__mini(frames, ctx->memoryFrames);
+	for (i = 0; i < frames; i++) {
+		const NVGframeMemory* m = &ctx->memoryHistory[(ctx->memoryHead - 1 - i + NVG_MAX_MEMORY_HISTORY) % NVG_MAX_MEMORY_HISTORY];
+		mem->commands = nvg__maxi(mem->commands, m->commands);
+		mem->points = nvg__maxi(mem->points, m->points);
+		mem->paths = nvg__maxi(mem->paths, m->paths);
+		mem->verts = nvg__maxi(mem->verts, m->verts);
+		mem->deferOps = nvg__maxi(mem->deferOps, m->deferOps);
+		mem->deferCommands = nvg__maxi(mem->deferCommands, m->deferCommands);
+		mem->deferVerts = nvg__maxi(mem->deferVerts, m->deferVerts);
+		mem->renderCalls = nvg__maxi(mem->renderCalls, m->renderCalls);
+		mem->renderPaths = nvg__maxi(mem->renderPaths, m->renderPaths);
+		mem->renderVerts = nvg__maxi(mem->renderVerts, m->renderVerts);
+		mem->renderUniforms = nvg__maxi(mem->renderUniforms, m->renderUniforms);
+	}
 }
 
-void nvgTextLineHeight(NVGcontext* ctx, float lineHeight)
+static void nvg__reservePathCache(NVGpathCache* cache, const NVGframeMemory* mem)
 {
-	NVGstate* state = nvg__getState(ctx);
-	state->lineHeight = lineHeight;
+	nvg__reserve((void**)&cache->points, &cache->cpoints, mem->points, sizeof(NVGpoint), NVG_INIT_POINTS_SIZE);
+	nvg__reserve((void**)&cache->paths, &cache->cpaths, mem->paths, sizeof(NVGpath), NVG_INIT_PATHS_SIZE);
+	nvg__reserve((void**)&cache->verts, &cache->cverts, mem->verts, sizeof(NVGvertex), NVG_INIT_VERTS_SIZE);
 }
 
-void nvgTextAlign(NVGcontext* ctx, int align)
+void nvgReserveFrameMemory(NVGcontext* ctx, const NVGframeMemory* mem)
 {
-	NVGstate* state = nvg__getState(ctx);
-	state->textAlign = align;
+	nvg__reserve((void**)&ctx->commands, &ctx->ccommands, mem->commands, sizeof(float), NVG_INIT_COMMANDS_SIZE);
+	nvg__reservePathCache(ctx->cache, mem);
+	if (mem->deferOps > 0) {
+		nvg__reserve((void**)&ctx->deferOps, &ctx->cdeferOps, mem->deferOps, sizeof(NVGdeferredOp), 64);
+		nvg__reserve((void**)&ctx->deferCommands, &ctx->cdeferCommands, mem->deferCommands, sizeof(float), 256);
+		nvg__reserve((void**)&ctx->deferVerts, &ctx->cdeferVerts, mem->deferVerts, sizeof(NVGvertex), 256);
+		// Deferred paths are tessellated one per cache, create them all up front but leave their
+		// buffers to grow, the peaks only bound the largest.
+		if (nvg__reserve((void**)&ctx->deferCaches, &ctx->cdeferCaches, mem->deferOps, sizeof(NVGpathCache*), 16)) {
+			while (ctx->ndeferCaches < mem->deferOps &&
+				   (ctx->deferCaches[ctx->ndeferCaches] = nvg__allocPathCache()) != NULL)
+				ctx->ndeferCaches++;
+		}
+	}
+	if (ctx->params.renderReserve != NULL)
+		ctx->params.renderReserve(ctx->params.userPtr, mem);
 }
 
-void nvgFontFaceId(NVGcontext* ctx, int font)
+// Reallocates a buffer holding more than ratio times count items down to one and a half times that.
+static void nvg__shrink(void** items, int* cap, int count, int size, int minCap, float ratio)
 {
-	NVGstate* state = nvg__getState(ctx);
-	state->fontId = font;
+	void* p;
+	int c = nvg__maxi(count + count/2, minCap);
+	if (*cap <= c || (float)*cap <= count * ratio) return;
+	p = realloc(*items, (size_t)c * size);
+	if (p == NULL) return;
+	*items = p;
+	*cap = c;
 }
 
-void nvgFontFace(NVGcontext* ctx, const char* font)
+static void nvg__shrinkFrameMemory(NVGcontext* ctx)
 {
-	NVGstate* state = nvg__getState(ctx);
-	state->fontId = fonsGetFontByName(ctx->fs, font);
+	NVGpathCache* cache = ctx->cache;
+	NVGframeMemory mem;
+	float ratio = ctx->shrinkRatio;
+	nvgFrameMemoryPeaks(ctx, ctx->shrinkFrames, &mem);
+	// The current path and cache outlive the frame, keep what they hold.
+	nvg__shrink((void**)&ctx->commands, &ctx->ccommands, nvg__maxi(mem.commands, ctx->ncommands),
+				sizeof(float), NVG_INIT_COMMANDS_SIZE, ratio);
+	nvg__shrink((void**)&cache->points, &cache->cpoints, nvg__maxi(mem.points, cache->npoints),
+				sizeof(NVGpoint), NVG_INIT_POINTS_SIZE, ratio);
+	nvg__shrink((void**)&cache->paths, &cache->cpaths, nvg__maxi(mem.paths, cache->npaths),
+				sizeof(NVGpath), NVG_INIT_PATHS_SIZE, ratio);
+	nvg__shrink((void**)&cache->verts, &cache->cverts, nvg__maxi(mem.verts, cache->nverts),
+				sizeof(NVGvertex), NVG_INIT_VERTS_SIZE, ratio);
+	// Deferred buffers are empty between frames.
+	nvg__shrink((void**)&ctx->deferOps, &ctx->cdeferOps, mem.deferOps, sizeof(NVGdeferredOp), 64, ratio);
+	nvg__shrink((void**)&ctx->deferCommands, &ctx->cdeferCommands, mem.deferCommands, sizeof(float), 256, ratio);
+	nvg__shrink((void**)&ctx->deferVerts, &ctx->cdeferVerts, mem.deferVerts, sizeof(NVGvertex), 256, ratio);
+	while (ctx->ndeferCaches > 0 && (float)ctx->ndeferCaches > mem.deferOps * ratio)
+		nvg__deletePathCache(ctx->deferCaches[--ctx->ndeferCaches]);
+	if (ctx->params.renderShrink != NULL)
+		ctx->params.renderShrink(ctx->params.userPtr, &mem, ratio);
+}
+
+void nvgMemoryShrinkPolicy(NVGcontext* ctx, int frames, float ratio)
+{
+	ctx->shrinkFrames = nvg__clampi(frames, 0, NVG_MAX_MEMORY_HISTORY);
+	ctx->shrinkRatio = nvg__maxf(ratio, 2.0f);
+}
+
+static int nvg__kbytes(size_t bytes)
+{
+	return (int)((bytes + 1023) >> 10);
+}
+
+void nvgMemoryReport(NVGcontext* ctx, NVGmemoryReport* report)
+{
+	const NVGpathCache* cache = ctx->cache;
+	size_t deferred;
+	int i, scratch, atlas;
+	memset(report, 0, sizeof(*report));
+	report->commands = nvg__kbytes((size_t)ctx->ccommands * sizeof(float));
+	report->pathCache = nvg__kbytes((size_t)cache->cpoints * sizeof(NVGpoint) + (size_t)cache->cpaths * sizeof(NVGpath) +
+									(size_t)cache->cverts * sizeof(NVGvertex) + (size_t)cache->cnodes * sizeof(int));
+	deferred = (size_t)ctx->cdeferOps * sizeof(NVGdeferredOp) + (size_t)ctx->cdeferCommands * sizeof(float) +
+			   (size_t)ctx->cdeferVerts * sizeof(NVGvertex) + (size_t)ctx->cdeferCaches * sizeof(NVGpathCache*);
+	for (i = 0; i < ctx->ndeferCaches; i++) {
+		const NVGpathCache* c = ctx->deferCaches[i];
+		deferred += sizeof(NVGpathCache) + (size_t)c->cpoints * sizeof(NVGpoint) + (size_t)c->cpaths * sizeof(NVGpath) +
+					(size_t)c->cverts * sizeof(NVGvertex) + (size_t)c->cnodes * sizeof(int);
+	}
+	report->deferred = nvg__kbytes(deferred);
+	fonsMemoryUsage(ctx->fs, &scratch, &atlas);
+	report->fontScratch = nvg__kbytes((size_t)scratch);
+	report->fontAtlas = nvg__kbytes((size_t)atlas);
+	report->fontAtlasPages = fonsPageCount(ctx->fs);
+	if (ctx->params.renderMemory != NULL)
+		ctx->params.renderMemory(ctx->params.userPtr, report);
 }
 
-static float nvg__quantize(float a, float d)
+int nvgImageKBytes(NVGcontext* ctx, int image)
 {
-	return ((int)(a / d + 0.5f)) * d;
+	if (ctx->params.renderTextureKBytes == NULL) return 0;
+	return ctx->params.renderTextureKBytes(ctx->params.userPtr, image);
 }
 
-static float nvg__getFontScale(NVGstate* state)
+// All geometry handed to the back-end goes through these, so that it can be captured by the active draw lists.
+static void nvg__submitFill(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, float fringe,
+							const float* bounds, const NVGpath* paths, int npaths)
 {
-	return nvg__minf(nvg__quantize(nvg__getAverageScale(state->xform), 0.01f), 4.0f);
+	int i;
+	nvg__flushDeferred(ctx);
+	if (ctx->recordOnly == 0)
+		ctx->params.renderFill(ctx->params.userPtr, paint, scissor, fringe, bounds, paths, npaths);
+	for (i = 0; i < ctx->ndrawLists; i++) {
+		NVGdrawCmd* cmd = nvg__allocDrawCmd(ctx->drawLists[i], NVG_DRAWCMD_FILL, paint, scissor);
+		if (cmd == NULL) continue;
+		cmd->fringe = fringe;
+		memcpy(cmd->bounds, bounds, sizeof(cmd->bounds));
+		nvg__recordPaths(ctx->drawLists[i], cmd, paths, npaths);
+	}
 }
 
-static void nvg__flushTextTexture(NVGcontext* ctx)
+static void nvg__submitStroke(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, float fringe,
+							  float strokeWidth, const NVGpath* paths, int npaths)
 {
-	int dirty[4];
-
-	if (fonsValidateTexture(ctx->fs, dirty)) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
-		// Update texture
-		if (fontImage != 0) {
-			int iw, ih;
-			const unsigned char* data = fonsGetTextureData(ctx->fs, &iw, &ih);
-			int x = dirty[0];
-			int y = dirty[1];
-			int w = dirty[2] - dirty[0];
-			int h = dirty[3] - dirty[1];
-			ctx->params.renderUpdateTexture(ctx->params.userPtr, fontImage, x,y, w,h, data);
-		}
+	int i;
+	nvg__flushDeferred(ctx);
+	if (ctx->recordOnly == 0)
+		ctx->params.renderStroke(ctx->params.userPtr, paint, scissor, fringe, strokeWidth, paths, npaths);
+	for (i = 0; i < ctx->ndrawLists; i++) {
+		NVGdrawCmd* cmd = nvg__allocDrawCmd(ctx->drawLists[i], NVG_DRAWCMD_STROKE, paint, scissor);
+		if (cmd == NULL) continue;
+		cmd->fringe = fringe;
+		cmd->strokeWidth = strokeWidth;
+		nvg__recordPaths(ctx->drawLists[i], cmd, paths, npaths);
 	}
 }
 
-static int nvg__allocTextAtlas(NVGcontext* ctx)
+static void nvg__submitTriangles(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor,
+								 const NVGvertex* verts, int nverts, int text)
 {
-	int iw, ih;
-	nvg__flushTextTexture(ctx);
-	if (ctx->fontImageIdx >= NVG_MAX_FONTIMAGES-1)
-		return 0;
-	// if next fontImage already have a texture
-	if (ctx->fontImages[ctx->fontImageIdx+1] != 0)
-		nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx+1], &iw, &ih);
-	else { // calculate the new font image size and create it.
-		nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx], &iw, &ih);
-		if (iw > ih)
-			ih *= 2;
-		else
-			iw *= 2;
-		if (iw > NVG_MAX_FONTIMAGE_SIZE || ih > NVG_MAX_FONTIMAGE_SIZE)
-			iw = ih = NVG_MAX_FONTIMAGE_SIZE;
-		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
+	int i;
+	if (nvg__deferring(ctx)) {
+		nvg__deferTriangles(ctx, paint, scissor, verts, nverts);
+		return;
+	}
+	nvg__flushDeferred(ctx);
+	if (ctx->recordOnly == 0)
+		ctx->params.renderTriangles(ctx->params.userPtr, paint, scissor, verts, nverts);
+	for (i = 0; i < ctx->ndrawLists; i++) {
+		NVGdrawList* list = ctx->drawLists[i];
+		NVGdrawCmd* cmd = nvg__allocDrawCmd(list, NVG_DRAWCMD_TRIANGLES, paint, scissor);
+		if (cmd == NULL) continue;
+		cmd->vertOffset = nvg__recordVerts(list, verts, nverts);
+		cmd->nverts = nverts;
+		cmd->cullBounds[0] = cmd->cullBounds[1] = 1e6f;
+		cmd->cullBounds[2] = cmd->cullBounds[3] = -1e6f;
+		nvg__vertBounds(cmd->cullBounds, verts, nverts);
+		list->hasText |= text;
 	}
-	++ctx->fontImageIdx;
-	fonsResetAtlas(ctx->fs, iw, ih);
-	return 1;
 }
 
-static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
+static void nvg__submitShape(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, float fringe,
+							 const float* shape, const NVGvertex* verts, int nverts)
 {
-	NVGstate* state = nvg__getState(ctx);
-	NVGpaint paint = state->fill;
-
-	// Render triangles.
-	paint.image = ctx->fontImages[ctx->fontImageIdx];
+	int i;
+	if (nvg__deferring(ctx)) {
+		nvg__deferShape(ctx, paint, scissor, shape, verts, nverts);
+		return;
+	}
+	nvg__flushDeferred(ctx);
+	if (ctx->recordOnly == 0)
+		ctx->params.renderShape(ctx->params.userPtr, paint, scissor, fringe, shape, verts, nverts);
+	for (i = 0; i < ctx->ndrawLists; i++) {
+		NVGdrawList* list = ctx->drawLists[i];
+		NVGdrawCmd* cmd = nvg__allocDrawCmd(list, NVG_DRAWCMD_SHAPE, paint, scissor);
+		if (cmd == NULL) continue;
+		cmd->fringe = fringe;
+		memcpy(cmd->shape, shape, sizeof(cmd->shape));
+		cmd->vertOffset = nvg__recordVerts(list, verts, nverts);
+		cmd->nverts = nverts;
+		cmd->cullBounds[0] = cmd->cullBounds[1] = 1e6f;
+		cmd->cullBounds[2] = cmd->cullBounds[3] = -1e6f;
+		nvg__vertBounds(cmd->cullBounds, verts, nverts);
+	}
+}
 
-	// Apply global alpha
-	paint.innerColor.a *= state->alpha;
-	paint.outerColor.a *= state->alpha;
+static void nvg__submitPlot(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, const NVGplotDraw* draw,
+							const float* cullBounds)
+{
+	int i;
+	nvg__flushDeferred(ctx);
+	if (ctx->recordOnly == 0)
+		ctx->params.renderPlot(ctx->params.userPtr, scissor, draw);
+	for (i = 0; i < ctx->ndrawLists; i++) {
+		NVGdrawList* list = ctx->drawLists[i];
+		NVGdrawCmd* cmd;
+		if (!nvg__reserve((void**)&list->plots, &list->cplots, list->nplots+1, sizeof(NVGplotDraw), 4)) {
+			list->failed = 1;
+			continue;
+		}
+		cmd = nvg__allocDrawCmd(list, NVG_DRAWCMD_PLOT, paint, scissor);
+		if (cmd == NULL) continue;
+		cmd->pathOffset = list->nplots;
+		list->plots[list->nplots++] = *draw;
+		memcpy(cmd->cullBounds, cullBounds, sizeof(cmd->cullBounds));
+	}
+}
 
-	ctx->params.renderTriangles(ctx->params.userPtr, &paint, &state->scissor, verts, nverts);
+NVGdrawList* nvgCreateDrawList(void)
+{
+	NVGdrawList* list = (NVGdrawList*)malloc(sizeof(NVGdrawList));
+	if (list == NULL) return NULL;
+	memset(list, 0, sizeof(NVGdrawList));
+	return list;
+}
 
-	ctx->drawCallCount++;
-	ctx->textTriCount += nverts/3;
+void nvgDeleteDrawList(NVGdrawList* list)
+{
+	if (list == NULL) return;
+	free(list->cmds);
+	free(list->paths);
+	free(list->verts);
+	free(list->replayPaths);
+	free(list->plots);
+	free(list->texts);
+	free(list->chars);
+	free(list);
 }
 
-float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
+void nvgBeginDrawList(NVGcontext* ctx, NVGdrawList* list)
 {
 	NVGstate* state = nvg__getState(ctx);
-	FONStextIter iter, prevIter;
-	FONSquad q;
-	NVGvertex* verts;
-	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
-	float invscale = 1.0f / scale;
+	if (list == NULL) {
+		ctx->drawListDepth++;
+		return;
+	}
+	// Paths deferred before belong to the frame, not to the list.
+	nvg__flushDeferred(ctx);
+	list->ncmds = 0;
+	list->npaths = 0;
+	list->nverts = 0;
+	list->nplots = 0;
+	list->ntexts = 0;
+	list->nchars = 0;
+	list->hasText = 0;
+	list->valid = 0;
+	list->failed = 0;
+	list->recordOnly = 0;
+	list->atlasGeneration = nvgMeasureParent(ctx)->atlasGeneration;
+	list->devicePxRatio = ctx->devicePxRatio;
+	memcpy(list->xform, state->xform, sizeof(float)*6);
+	list->scissor = state->scissor;
+	if (ctx->ndrawLists >= NVG_MAX_DRAWLISTS) {
+		list->failed = 1;
+		ctx->drawListDepth++;
+		return;
+	}
+	ctx->drawListBegins[ctx->ndrawLists] = ctx->drawListDepth++;
+	ctx->drawLists[ctx->ndrawLists++] = list;
+}
+
+void nvgRecordDrawList(NVGcontext* ctx, NVGdrawList* list)
+{
+	nvgBeginDrawList(ctx, list);
+	if (list == NULL || list->failed) return;
+	list->recordOnly = 1;
+	list->savedStats[0] = ctx->drawCallCount;
+	list->savedStats[1] = ctx->fillTriCount;
+	list->savedStats[2] = ctx->strokeTriCount;
+	list->savedStats[3] = ctx->textTriCount;
+	ctx->recordOnly++;
+}
+
+void nvgEndDrawList(NVGcontext* ctx)
+{
+	NVGdrawList* list;
+	if (ctx->drawListDepth <= 0) return;
+	ctx->drawListDepth--;
+	// Ends a list that was skipped when begun, the innermost recording one stays open.
+	if (ctx->ndrawLists <= 0 || ctx->drawListBegins[ctx->ndrawLists-1] != ctx->drawListDepth) return;
+	list = ctx->drawLists[--ctx->ndrawLists];
+	if (list->recordOnly) {
+		ctx->drawCallCount = list->savedStats[0];
+		ctx->fillTriCount = list->savedStats[1];
+		ctx->strokeTriCount = list->savedStats[2];
+		ctx->textTriCount = list->savedStats[3];
+		ctx->recordOnly--;
+		list->recordOnly = 0;
+	}
+	// Glyph quads recorded before an atlas reset point to stale texture coordinates.
+	list->valid = !list->failed && list->atlasGeneration == nvgMeasureParent(ctx)->atlasGeneration;
+}
+
+int nvgDrawListValid(NVGcontext* ctx, NVGdrawList* list)
+{
+	if (list == NULL || !list->valid) return 0;
+	if (list->devicePxRatio != ctx->devicePxRatio) return 0;
+	if (list->hasText && list->atlasGeneration != nvgMeasureParent(ctx)->atlasGeneration) return 0;
+	return 1;
+}
+
+static void nvg__translateDrawList(NVGdrawList* list, float dx, float dy)
+{
+	int i;
+	for (i = 0; i < list->nverts; i++) {
+		list->verts[i].x += dx;
+		list->verts[i].y += dy;
+	}
+	for (i = 0; i < list->ncmds; i++) {
+		NVGdrawCmd* cmd = &list->cmds[i];
+		cmd->paint.xform[4] += dx;
+		cmd->paint.xform[5] += dy;
+		cmd->scissor.xform[4] += dx;
+		cmd->scissor.xform[5] += dy;
+		cmd->bounds[0] += dx;
+		cmd->bounds[1] += dy;
+		cmd->bounds[2] += dx;
+		cmd->bounds[3] += dy;
+		cmd->cullBounds[0] += dx;
+		cmd->cullBounds[1] += dy;
+		cmd->cullBounds[2] += dx;
+		cmd->cullBounds[3] += dy;
+	}
+	for (i = 0; i < list->nplots; i++) {
+		list->plots[i].xform[4] += dx;
+		list->plots[i].xform[5] += dy;
+	}
+	for (i = 0; i < list->ntexts; i++) {
+		list->texts[i].xform[4] += dx;
+		list->texts[i].xform[5] += dy;
+	}
+	list->xform[4] += dx;
+	list->xform[5] += dy;
+	list->scissor.xform[4] += dx;
+	list->scissor.xform[5] += dy;
+}
+
+static int nvg__scissorEquals(const NVGscissor* a, const NVGscissor* b, float dx, float dy)
+{
+	const float eps = 1e-5f;
+	int i;
+	if (a->extent[0] < -0.5f || b->extent[0] < -0.5f)
+		return (a->extent[0] < -0.5f) == (b->extent[0] < -0.5f);
+	for (i = 0; i < 4; i++)
+		if (nvg__absf(a->xform[i] - b->xform[i]) > eps) return 0;
+	return nvg__absf(a->xform[4] - (b->xform[4] + dx)) <= eps && nvg__absf(a->xform[5] - (b->xform[5] + dy)) <= eps &&
+		nvg__absf(a->extent[0] - b->extent[0]) <= eps && nvg__absf(a->extent[1] - b->extent[1]) <= eps;
+}
+
+static int nvg__scissorAxisAligned(const NVGscissor* s)
+{
+	const float eps = 1e-5f;
+	return nvg__absf(s->xform[1]) <= eps && nvg__absf(s->xform[2]) <= eps;
+}
+
+// Whether the current scissor a lies inside the recorded scissor b moved by (dx,dy).
+static int nvg__scissorInside(const NVGscissor* a, const NVGscissor* b, float dx, float dy)
+{
+	const float eps = 1e-3f;
+	float ax, ay, bx, by;
+	if (b->extent[0] < -0.5f) return 1;
+	if (a->extent[0] < -0.5f) return 0;
+	if (!nvg__scissorAxisAligned(a) || !nvg__scissorAxisAligned(b)) return 0;
+	ax = nvg__absf(a->xform[0])*a->extent[0];
+	ay = nvg__absf(a->xform[3])*a->extent[1];
+	bx = nvg__absf(b->xform[0])*b->extent[0];
+	by = nvg__absf(b->xform[3])*b->extent[1];
+	return a->xform[4]-ax >= b->xform[4]+dx-bx-eps && a->xform[4]+ax <= b->xform[4]+dx+bx+eps &&
+		a->xform[5]-ay >= b->xform[5]+dy-by-eps && a->xform[5]+ay <= b->xform[5]+dy+by+eps;
+}
+
+// Intersects a recorded command scissor with the current scissor, like nvgIntersectScissor().
+static void nvg__clipScissor(NVGscissor* dst, const NVGscissor* cmd, const NVGscissor* cur)
+{
+	float pxform[6], invxform[6], rect[4];
+	float ex, ey, tex, tey;
+	if (cmd->extent[0] < -0.5f) {
+		*dst = *cur;
+		return;
+	}
+	memcpy(pxform, cur->xform, sizeof(float)*6);
+	nvgTransformInverse(invxform, cmd->xform);
+	nvgTransformMultiply(pxform, invxform);
+	ex = cur->extent[0];
+	ey = cur->extent[1];
+	tex = ex*nvg__absf(pxform[0]) + ey*nvg__absf(pxform[2]);
+	tey = ex*nvg__absf(pxform[1]) + ey*nvg__absf(pxform[3]);
+	nvg__isectRects(rect, pxform[4]-tex,pxform[5]-tey,tex*2,tey*2,
+		-cmd->extent[0],-cmd->extent[1],cmd->extent[0]*2,cmd->extent[1]*2);
+	nvgTransformIdentity(dst->xform);
+	dst->xform[4] = rect[0]+rect[2]*0.5f;
+	dst->xform[5] = rect[1]+rect[3]*0.5f;
+	nvgTransformMultiply(dst->xform, cmd->xform);
+	dst->extent[0] = rect[2]*0.5f;
+	dst->extent[1] = rect[3]*0.5f;
+}
+
+int nvgDrawList(NVGcontext* ctx, NVGdrawList* list)
+{
+	NVGstate* state = nvg__getState(ctx);
+	const float eps = 1e-5f;
+	NVGscissor clipped;
+	NVGscissor* scissor;
+	float dx, dy, cull[4];
+	int i, j, clip, culling;
+
+	if (!nvgDrawListValid(ctx, list)) return 0;
+	// A captured frame needs the calls, so the caller draws the content again.
+	if (nvg__capturing(ctx)) return 0;
+	if (nvg__absf(state->xform[0] - list->xform[0]) > eps || nvg__absf(state->xform[1] - list->xform[1]) > eps ||
+		nvg__absf(state->xform[2] - list->xform[2]) > eps || nvg__absf(state->xform[3] - list->xform[3]) > eps)
+		return 0;
+
+	// Move the recording to the current translation, so that replays at a fixed position cost nothing extra.
+	dx = state->xform[4] - list->xform[4];
+	dy = state->xform[5] - list->xform[5];
+	// The recorded geometry was clipped against the scissor that was active at record time,
+	// so it can only be replayed under that scissor or a smaller one.
+	clip = 0;
+	if (!nvg__scissorEquals(&state->scissor, &list->scissor, dx, dy)) {
+		if (!nvg__scissorInside(&state->scissor, &list->scissor, dx, dy))
+			return 0;
+		clip = 1;
+	}
+	if (dx != 0.0f || dy != 0.0f)
+		nvg__translateDrawList(list, dx, dy);
+	culling = nvgCurrentClipBounds(ctx, cull);
+
+	for (i = 0; i < list->ncmds; i++) {
+		NVGdrawCmd* cmd = &list->cmds[i];
+		if (culling && (cmd->cullBounds[2] < cull[0] || cmd->cullBounds[0] > cull[2] ||
+						cmd->cullBounds[3] < cull[1] || cmd->cullBounds[1] > cull[3]))
+			continue;
+		scissor = &cmd->scissor;
+		if (clip) {
+			nvg__clipScissor(&clipped, &cmd->scissor, &state->scissor);
+			scissor = &clipped;
+		}
+		if (cmd->type == NVG_DRAWCMD_TRIANGLES) {
+			nvg__submitTriangles(ctx, &cmd->paint, scissor, &list->verts[cmd->vertOffset], cmd->nverts, list->hasText);
+			ctx->drawCallCount++;
+			ctx->textTriCount += cmd->nverts/3;
+			continue;
+		}
+		if (cmd->type == NVG_DRAWCMD_SHAPE) {
+			nvg__submitShape(ctx, &cmd->paint, scissor, cmd->fringe, cmd->shape, &list->verts[cmd->vertOffset], cmd->nverts);
+			ctx->drawCallCount++;
+			ctx->fillTriCount += cmd->nverts-2;
+			continue;
+		}
+		if (cmd->type == NVG_DRAWCMD_PLOT) {
+			// Draws the samples the plot holds now, not those it held when recorded.
+			nvg__submitPlot(ctx, &cmd->paint, scissor, &list->plots[cmd->pathOffset], cmd->cullBounds);
+			ctx->drawCallCount++;
+			continue;
+		}
+		if (cmd->type == NVG_DRAWCMD_TEXT) {
+			nvg__replayText(ctx, list, cmd, scissor);
+			continue;
+		}
+		if (!nvg__reserve((void**)&list->replayPaths, &list->creplayPaths, cmd->npaths, sizeof(NVGpath), 16))
+			return 0;
+		for (j = 0; j < cmd->npaths; j++) {
+			NVGdrawPath* src = &list->paths[cmd->pathOffset + j];
+			NVGpath* dst = &list->replayPaths[j];
+			*dst = src->path;
+			dst->fill = src->path.nfill > 0 ? &list->verts[src->fillOffset] : NULL;
+			dst->stroke = src->path.nstroke > 0 ? &list->verts[src->strokeOffset] : NULL;
+			if (cmd->type == NVG_DRAWCMD_FILL) {
+				ctx->fillTriCount += dst->nfill-2;
+				ctx->fillTriCount += dst->nstroke-2;
+				ctx->drawCallCount += 2;
+			} else {
+				ctx->strokeTriCount += dst->nstroke-2;
+				ctx->drawCallCount++;
+			}
+		}
+		if (cmd->type == NVG_DRAWCMD_FILL)
+			nvg__submitFill(ctx, &cmd->paint, scissor, cmd->fringe, cmd->bounds, list->replayPaths, cmd->npaths);
+		else
+			nvg__submitStroke(ctx, &cmd->paint, scissor, cmd->fringe, cmd->strokeWidth, list->replayPaths, cmd->npaths);
+	}
+	return 1;
+}
+
+void nvgFill(NVGcontext* ctx)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpaint fillPaint = state->fill;
+	float fringe = ctx->params.edgeAntiAlias ? ctx->fringeWidth : 0.0f;
+	NVGtess tess;
+
+	nvg__beginProfile(ctx, "nvgFill");
+	if (nvg__capturing(ctx))
+		nvg__captureDraw(ctx, NVG_CAPTURE_FILL);
+
+	// Apply global alpha
+	fillPaint.innerColor.a *= state->alpha;
+	fillPaint.outerColor.a *= state->alpha;
+
+	if (nvg__deferring(ctx)) {
+		NVGdeferredOp* op = nvg__deferPath(ctx, NVG_DEFER_FILL, &fillPaint, &state->scissor);
+		if (op != NULL)
+			op->expandWidth = fringe;
+		nvg__endProfile(ctx);
+		return;
+	}
+
+	nvg__beginTess(ctx, &tess, ctx->cache, ctx->commands, ctx->ncommands);
+	nvg__flattenPaths(&tess);
+	nvg__expandFill(&tess, fringe, NVG_MITER, 2.4f);
+	nvg__endTess(ctx, &tess);
+
+	nvg__submitFill(ctx, &fillPaint, &state->scissor, ctx->fringeWidth,
+					ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+	nvg__countFill(ctx, ctx->cache);
+	nvg__endProfile(ctx);
+}
+
+// Computes the stroke paint, the stroke width handed to the back-end and the width the outline is expanded by.
+static void nvg__strokeParams(NVGcontext* ctx, float scale, NVGpaint* strokePaint, float* width, float* expandWidth)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float strokeWidth = nvg__clampf(state->strokeWidth * scale, 0.0f, 200.0f);
+
+	*strokePaint = state->stroke;
+	if (strokeWidth < ctx->fringeWidth) {
+		// If the stroke width is less than pixel size, use alpha to emulate coverage.
+		// Since coverage is area, scale by alpha*alpha.
+		float alpha = nvg__clampf(strokeWidth / ctx->fringeWidth, 0.0f, 1.0f);
+		strokePaint->innerColor.a *= alpha*alpha;
+		strokePaint->outerColor.a *= alpha*alpha;
+		strokeWidth = ctx->fringeWidth;
+	}
+
+	// Apply global alpha
+	strokePaint->innerColor.a *= state->alpha;
+	strokePaint->outerColor.a *= state->alpha;
+
+	*width = strokeWidth;
+	if (ctx->params.edgeAntiAlias)
+		*expandWidth = strokeWidth*0.5f + ctx->fringeWidth*0.5f;
+	else
+		*expandWidth = strokeWidth*0.5f;
+}
+
+void nvgStroke(NVGcontext* ctx)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpaint strokePaint;
+	float strokeWidth, expandWidth;
+	NVGtess tess;
+
+	nvg__beginProfile(ctx, "nvgStroke");
+	if (nvg__capturing(ctx))
+		nvg__captureDraw(ctx, NVG_CAPTURE_STROKE);
+	nvg__strokeParams(ctx, nvg__getStateScale(state), &strokePaint, &strokeWidth, &expandWidth);
+
+	if (nvg__deferring(ctx)) {
+		NVGdeferredOp* op = nvg__deferPath(ctx, NVG_DEFER_STROKE, &strokePaint, &state->scissor);
+		if (op != NULL) {
+			op->strokeWidth = strokeWidth;
+			op->expandWidth = expandWidth;
+			op->lineCap = state->lineCap;
+			op->lineJoin = state->lineJoin;
+			op->miterLimit = state->miterLimit;
+		}
+		nvg__endProfile(ctx);
+		return;
+	}
+
+	nvg__beginTess(ctx, &tess, ctx->cache, ctx->commands, ctx->ncommands);
+	nvg__flattenPaths(&tess);
+	nvg__expandStroke(&tess, expandWidth, state->lineCap, state->lineJoin, state->miterLimit);
+	nvg__endTess(ctx, &tess);
+
+	nvg__submitStroke(ctx, &strokePaint, &state->scissor, ctx->fringeWidth,
+					  strokeWidth, ctx->cache->paths, ctx->cache->npaths);
+	nvg__countStroke(ctx, ctx->cache);
+	nvg__endProfile(ctx);
+}
+
+void nvgFillStroke(NVGcontext* ctx)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpaint fillPaint = state->fill;
+	NVGpaint strokePaint;
+	float fringe = ctx->params.edgeAntiAlias ? ctx->fringeWidth : 0.0f;
+	float strokeWidth, expandWidth;
+	NVGtess tess;
+
+	if (nvg__capturing(ctx))
+		nvg__captureDraw(ctx, NVG_CAPTURE_FILLSTROKE);
+	if (nvg__deferring(ctx)) {
+		nvg__captureMute(ctx, 1);
+		nvgFill(ctx);
+		nvgStroke(ctx);
+		nvg__captureMute(ctx, -1);
+		return;
+	}
+
+	nvg__beginProfile(ctx, "nvgFillStroke");
+
+	// Apply global alpha
+	fillPaint.innerColor.a *= state->alpha;
+	fillPaint.outerColor.a *= state->alpha;
+	nvg__strokeParams(ctx, nvg__getStateScale(state), &strokePaint, &strokeWidth, &expandWidth);
+
+	// An opaque stroke at least a pixel wide covers the outline, and with it the fringe of the fill.
+	if (strokePaint.image == 0 && strokePaint.innerColor.a >= 1.0f && strokePaint.outerColor.a >= 1.0f &&
+		strokeWidth >= ctx->fringeWidth)
+		fringe = 0.0f;
+
+	nvg__beginTess(ctx, &tess, ctx->cache, ctx->commands, ctx->ncommands);
+	nvg__flattenPaths(&tess);
+
+	// Both expansions write the vertices of the cache, so the fill goes out before the stroke is expanded.
+	nvg__expandFill(&tess, fringe, NVG_MITER, 2.4f);
+	nvg__submitFill(ctx, &fillPaint, &state->scissor, ctx->fringeWidth,
+					ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+	nvg__countFill(ctx, ctx->cache);
+
+	nvg__expandStroke(&tess, expandWidth, state->lineCap, state->lineJoin, state->miterLimit);
+	nvg__submitStroke(ctx, &strokePaint, &state->scissor, ctx->fringeWidth,
+					  strokeWidth, ctx->cache->paths, ctx->cache->npaths);
+	nvg__countStroke(ctx, ctx->cache);
+
+	nvg__endTess(ctx, &tess);
+	nvg__endProfile(ctx);
+}
+
+// Analytic shapes
+
+// Submits the quad covering the rounded rectangle x,y,w,h,r grown by pad. Its vertices carry the
+// position relative to the rectangle center, in the space of the current transform.
+// Submits the part [x0,x1]x[y0,y1] of a shape around (cx,cy) as one quad, texture coordinates relative to the center.
+static void nvg__submitShapeQuad(NVGcontext* ctx, NVGpaint* paint, const float* shape, float cx, float cy,
+								 float x0, float y0, float x1, float y1)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGvertex verts[4];
+	float corners[8];
+	int i, flip;
+
+	// Counter-clockwise on screen like the fill quads, unless the transform mirrors.
+	flip = state->xform[0]*state->xform[3] - state->xform[2]*state->xform[1] < 0.0f;
+	corners[0] = x0; corners[1] = y1;
+	corners[2] = x1; corners[3] = y1;
+	corners[4] = x1; corners[5] = y0;
+	corners[6] = x0; corners[7] = y0;
+	for (i = 0; i < 4; i++) {
+		const float* c = &corners[(flip ? 3-i : i)*2];
+		float px, py;
+		nvgTransformPoint(&px, &py, state->xform, cx + c[0], cy + c[1]);
+		verts[i].x = px;
+		verts[i].y = py;
+		verts[i].u = c[0];
+		verts[i].v = c[1];
+	}
+
+	nvg__submitShape(ctx, paint, &state->scissor, ctx->fringeWidth, shape, verts, 4);
+	ctx->drawCallCount++;
+	ctx->fillTriCount += 2;
+}
+
+static void nvg__fillShape(NVGcontext* ctx, float x, float y, float w, float h, float r, float pad, int outside)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpaint fillPaint = state->fill;
+	float shape[4];
+	float scale = nvg__getStateScale(state);
+	float hw = nvg__absf(w)*0.5f, hh = nvg__absf(h)*0.5f;
+	float cx = x + w*0.5f, cy = y + h*0.5f;
+	float aa, ex, ey, ix, iy;
+
+	if (scale < 1e-6f) return;
+	if (nvg__capturing(ctx))
+		nvg__captureShape(ctx, x, y, w, h, r, pad, outside);
+	fillPaint.innerColor.a *= state->alpha;
+	fillPaint.outerColor.a *= state->alpha;
+
+	// Coverage ramps from 1 to 0 over one fringe, centered on the edge.
+	aa = ctx->fringeWidth / scale;
+	shape[0] = hw;
+	shape[1] = hh;
+	shape[2] = nvg__clampf(r, 0.0f, nvg__minf(hw, hh));
+	shape[3] = outside ? -1.0f / aa : 1.0f / aa;
+
+	ex = hw + pad + aa;
+	ey = hh + pad + aa;
+	// Outside coverage is zero deeper than the corner radius plus a fringe inside the rectangle,
+	// like the center of a nine-slice. Leaving it out keeps large shadows to their border.
+	ix = hw - shape[2] - aa;
+	iy = hh - shape[2] - aa;
+	if (!outside || ix <= 0.0f || iy <= 0.0f) {
+		nvg__submitShapeQuad(ctx, &fillPaint, shape, cx, cy, -ex, -ey, ex, ey);
+		return;
+	}
+	nvg__submitShapeQuad(ctx, &fillPaint, shape, cx, cy, -ex, -ey, ex, -iy);
+	nvg__submitShapeQuad(ctx, &fillPaint, shape, cx, cy, -ex, iy, ex, ey);
+	nvg__submitShapeQuad(ctx, &fillPaint, shape, cx, cy, -ex, -iy, -ix, iy);
+	nvg__submitShapeQuad(ctx, &fillPaint, shape, cx, cy, ix, -iy, ex, iy);
+}
+
+void nvgDrawRoundedRectSDF(NVGcontext* ctx, float x, float y, float w, float h, float r)
+{
+	nvgBeginPath(ctx);
+	if (ctx->params.renderShape == NULL) {
+		nvgRoundedRect(ctx, x, y, w, h, r);
+		nvgFill(ctx);
+		nvgBeginPath(ctx);
+		return;
+	}
+	nvg__beginProfile(ctx, "nvgDrawRoundedRectSDF");
+	nvg__fillShape(ctx, x, y, w, h, r, 0.0f, 0);
+	nvg__endProfile(ctx);
+}
+
+void nvgDrawBoxShadow(NVGcontext* ctx, float x, float y, float w, float h, float r, float spread)
+{
+	nvgBeginPath(ctx);
+	if (ctx->params.renderShape == NULL) {
+		nvgRect(ctx, x - spread, y - spread, w + 2*spread, h + 2*spread);
+		nvgRoundedRect(ctx, x, y, w, h, r);
+		nvgPathWinding(ctx, NVG_HOLE);
+		nvgFill(ctx);
+		nvgBeginPath(ctx);
+		return;
+	}
+	nvg__beginProfile(ctx, "nvgDrawBoxShadow");
+	nvg__fillShape(ctx, x, y, w, h, r, spread, 1);
+	nvg__endProfile(ctx);
+}
+
+void nvgDrawImageSlices(NVGcontext* ctx, int image, float sx, float sy, float sw, float sh,
+						float l, float t, float r, float b, float x, float y, float w, float h, float alpha)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float dx[4], dy[4], u[4], v[4];
+	NVGpaint paint;
+	NVGvertex* verts;
+	NVGtess tess;
+	int iw = 0, ih = 0, i, j, n = 0;
+
+	if (image == 0 || w <= 0.0f || h <= 0.0f || sw <= 0.0f || sh <= 0.0f) return;
+	nvgImageSize(ctx, image, &iw, &ih);
+	if (iw <= 0 || ih <= 0) return;
+	// Borders wider than the destination shrink in proportion, so that the slices never overlap.
+	if (l + r > w) { float s = w / (l + r); l *= s; r *= s; }
+	if (t + b > h) { float s = h / (t + b); t *= s; b *= s; }
+	dx[0] = x; dx[1] = x + l; dx[2] = x + w - r; dx[3] = x + w;
+	dy[0] = y; dy[1] = y + t; dy[2] = y + h - b; dy[3] = y + h;
+	u[0] = sx / iw; u[1] = (sx + nvg__minf(l, sw*0.5f)) / iw; u[2] = (sx + sw - nvg__minf(r, sw*0.5f)) / iw; u[3] = (sx + sw) / iw;
+	v[0] = sy / ih; v[1] = (sy + nvg__minf(t, sh*0.5f)) / ih; v[2] = (sy + sh - nvg__minf(b, sh*0.5f)) / ih; v[3] = (sy + sh) / ih;
+
+	if (nvg__capturing(ctx)) {
+		// Captures replay fills, so the slices are drawn as image patterns over rectangles.
+		for (j = 0; j < 3; j++) {
+			for (i = 0; i < 3; i++) {
+				float cw = dx[i+1] - dx[i], ch = dy[j+1] - dy[j];
+				float kx, ky;
+				if (cw <= 0.0f || ch <= 0.0f || u[i+1] <= u[i] || v[j+1] <= v[j]) continue;
+				kx = cw / ((u[i+1] - u[i]) * iw);
+				ky = ch / ((v[j+1] - v[j]) * ih);
+				nvgBeginPath(ctx);
+				nvgRect(ctx, dx[i], dy[j], cw, ch);
+				nvgFillPaint(ctx, nvgImagePattern(ctx, dx[i] - u[i]*iw*kx, dy[j] - v[j]*ih*ky, iw*kx, ih*ky, 0.0f, image, alpha));
+				nvgFill(ctx);
+			}
+		}
+		nvgBeginPath(ctx);
+		return;
+	}
+
+	nvg__beginProfile(ctx, "nvgDrawImageSlices");
+	nvg__beginTess(ctx, &tess, ctx->cache, NULL, 0);
+	verts = nvg__allocTempVerts(&tess, 9*6);
+	nvg__endTess(ctx, &tess);
+	if (verts == NULL) {
+		nvg__endProfile(ctx);
+		return;
+	}
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < 3; i++) {
+			float px[4], py[4];
+			if (dx[i+1] <= dx[i] || dy[j+1] <= dy[j]) continue;
+			nvgTransformPoint(&px[0], &py[0], state->xform, dx[i], dy[j]);
+			nvgTransformPoint(&px[1], &py[1], state->xform, dx[i+1], dy[j]);
+			nvgTransformPoint(&px[2], &py[2], state->xform, dx[i+1], dy[j+1]);
+			nvgTransformPoint(&px[3], &py[3], state->xform, dx[i], dy[j+1]);
+			nvg__vset(&verts[n++], px[0], py[0], u[i], v[j]);
+			nvg__vset(&verts[n++], px[2], py[2], u[i+1], v[j+1]);
+			nvg__vset(&verts[n++], px[1], py[1], u[i+1], v[j]);
+			nvg__vset(&verts[n++], px[0], py[0], u[i], v[j]);
+			nvg__vset(&verts[n++], px[3], py[3], u[i], v[j+1]);
+			nvg__vset(&verts[n++], px[2], py[2], u[i+1], v[j+1]);
+		}
+	}
+	memset(&paint, 0, sizeof(paint));
+	nvgTransformIdentity(paint.xform);
+	paint.image = image;
+	paint.innerColor = paint.outerColor = nvgRGBAf(1, 1, 1, alpha * state->alpha);
+	nvg__submitTriangles(ctx, &paint, &state->scissor, verts, n, 0);
+	ctx->drawCallCount++;
+	nvg__endProfile(ctx);
+}
+
+int nvgCreatePlot(NVGcontext* ctx, int capacity)
+{
+	if (ctx->params.renderCreatePlot == NULL || capacity < 2) return 0;
+	return ctx->params.renderCreatePlot(ctx->params.userPtr, capacity);
+}
+
+void nvgDeletePlot(NVGcontext* ctx, int plot)
+{
+	if (ctx->params.renderDeletePlot == NULL || plot == 0) return;
+	ctx->params.renderDeletePlot(ctx->params.userPtr, plot);
+}
+
+void nvgPlotAppend(NVGcontext* ctx, int plot, const float* samples, int n)
+{
+	if (ctx->params.renderAppendPlot == NULL || plot == 0 || n <= 0) return;
+	ctx->params.renderAppendPlot(ctx->params.userPtr, plot, samples, n);
+}
+
+void nvgPlotClear(NVGcontext* ctx, int plot)
+{
+	if (ctx->params.renderClearPlot == NULL || plot == 0) return;
+	ctx->params.renderClearPlot(ctx->params.userPtr, plot);
+}
+
+void nvgDrawPlot(NVGcontext* ctx, int plot, float x, float y, float w, float h, float lo, float hi)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGplotDraw draw;
+	float scale = nvg__getStateScale(state);
+	float bounds[4], pad;
+	int i;
+
+	if (ctx->params.renderPlot == NULL || plot == 0 || w <= 0.0f || h <= 0.0f) return;
+	nvg__beginProfile(ctx, "nvgDrawPlot");
+
+	memset(&draw, 0, sizeof(draw));
+	draw.plot = plot;
+	memcpy(draw.xform, state->xform, sizeof(float)*6);
+	draw.rect[0] = x;
+	draw.rect[1] = y;
+	draw.rect[2] = w;
+	draw.rect[3] = h;
+	draw.range[0] = lo;
+	draw.range[1] = hi;
+	draw.strokeWidth = nvg__maxf(state->strokeWidth * scale, ctx->fringeWidth);
+	draw.fringe = ctx->fringeWidth;
+	draw.strokeColor = state->stroke.innerColor;
+	draw.strokeColor.a *= state->alpha;
+	draw.fillColor = state->fill.innerColor;
+	draw.fillColor.a *= state->alpha;
+
+	// Samples outside the range are clamped to it, so the line stays within the rectangle and its width.
+	pad = draw.strokeWidth*0.5f + ctx->fringeWidth;
+	bounds[0] = bounds[1] = 1e6f;
+	bounds[2] = bounds[3] = -1e6f;
+	for (i = 0; i < 4; i++) {
+		float px, py;
+		nvgTransformPoint(&px, &py, state->xform, (i & 1) ? x + w : x, (i & 2) ? y + h : y);
+		bounds[0] = nvg__minf(bounds[0], px - pad);
+		bounds[1] = nvg__minf(bounds[1], py - pad);
+		bounds[2] = nvg__maxf(bounds[2], px + pad);
+		bounds[3] = nvg__maxf(bounds[3], py + pad);
+	}
+
+	nvg__submitPlot(ctx, &state->fill, &state->scissor, &draw, bounds);
+	ctx->drawCallCount++;
+	nvg__endProfile(ctx);
+}
+
+// Layers
+
+static NVGlayer* nvg__layer(NVGcontext* ctx, int layer)
+{
+	if (layer <= 0 || layer > ctx->nlayers || !ctx->layers[layer-1].used) return NULL;
+	return &ctx->layers[layer-1];
+}
+
+static int nvg__layerOpen(NVGcontext* ctx, int layer)
+{
+	int i;
+	for (i = 0; i < ctx->nlayerStack; i++)
+		if (ctx->layerStack[i].layer == layer) return 1;
+	return 0;
+}
+
+int nvgCreateLayer(NVGcontext* ctx)
+{
+	int i;
+	if (ctx->params.renderBeginLayer == NULL || ctx->params.renderEndLayer == NULL) return 0;
+	for (i = 0; i < ctx->nlayers; i++)
+		if (!ctx->layers[i].used) break;
+	if (i == ctx->nlayers) {
+		if (!nvg__reserve((void**)&ctx->layers, &ctx->clayers, ctx->nlayers + 1, sizeof(NVGlayer), 8)) return 0;
+		ctx->nlayers++;
+	}
+	memset(&ctx->layers[i], 0, sizeof(NVGlayer));
+	ctx->layers[i].used = 1;
+	return i + 1;
+}
+
+void nvgDeleteLayer(NVGcontext* ctx, int layer)
+{
+	NVGlayer* l = nvg__layer(ctx, layer);
+	if (l == NULL || nvg__layerOpen(ctx, layer)) return;
+	if (l->image != 0)
+		nvgDeleteImage(ctx, l->image);
+	memset(l, 0, sizeof(NVGlayer));
+}
+
+int nvgBeginLayer(NVGcontext* ctx, int layer, float x, float y, float w, float h)
+{
+	NVGlayer* l = nvg__layer(ctx, layer);
+	NVGlayerScope* scope;
+	NVGstate* state;
+	float ratio, x0, y0, toLayer[6], t[6];
+	int width, height;
+
+	if (l == NULL || nvg__layerOpen(ctx, layer)) return 0;
+	if (ctx->nlayerStack >= NVG_MAX_LAYER_DEPTH || ctx->nstates >= NVG_MAX_STATES) return 0;
+	// Recordings and captures replay the calls, which would have to redirect the target as well.
+	if (ctx->ndrawLists > 0 || ctx->recordOnly || nvg__capturing(ctx)) return 0;
+
+	// Device pixels of the frame, also within another layer, with the image on whole pixels.
+	ratio = ctx->layerXform[0] * ctx->devicePxRatio;
+	x0 = floorf(x * ratio);
+	y0 = floorf(y * ratio);
+	width = (int)(ceilf((x + w) * ratio) - x0);
+	height = (int)(ceilf((y + h) * ratio) - y0);
+	if (width <= 0 || height <= 0) return 0;
+
+	if (l->image == 0 || l->width != width || l->height != height) {
+		if (l->image != 0)
+			nvgDeleteImage(ctx, l->image);
+		l->image = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_RGBA, width, height,
+												   NVG_IMAGE_PREMULTIPLIED | NVG_IMAGE_FLIPY, NULL);
+		l->width = l->image != 0 ? width : 0;
+		l->height = l->image != 0 ? height : 0;
+		if (l->image == 0) return 0;
+	}
+	l->valid = 0;
+
+	nvg__flushDeferred(ctx);
+	if (!ctx->params.renderBeginLayer(ctx->params.userPtr, l->image)) return 0;
+
+	scope = &ctx->layerStack[ctx->nlayerStack];
+	scope->layer = layer;
+	if (ctx->nlayerStack > 0) {
+		NVGlayer* parent = nvg__layer(ctx, ctx->layerStack[ctx->nlayerStack-1].layer);
+		scope->viewWidth = parent->width;
+		scope->viewHeight = parent->height;
+	} else {
+		scope->viewWidth = (int)ctx->viewWidth;
+		scope->viewHeight = (int)ctx->viewHeight;
+	}
+	scope->devicePxRatio = ctx->devicePxRatio;
+	memcpy(scope->xform, ctx->layerXform, sizeof(float)*6);
+	ctx->nlayerStack++;
+
+	l->x = x0;
+	l->y = y0;
+	l->ratio = ratio;
+
+	// The drawing keeps its view coordinates, the transform moves them from the pixels of the
+	// previous target to those of the layer, which is drawn at a device pixel ratio of 1.
+	nvgSave(ctx);
+	toLayer[0] = ratio; toLayer[1] = 0.0f;
+	toLayer[2] = 0.0f; toLayer[3] = ratio;
+	toLayer[4] = -x0; toLayer[5] = -y0;
+	nvgTransformInverse(t, ctx->layerXform);
+	nvgTransformMultiply(t, toLayer);
+	state = nvg__editState(ctx, NVG_STATE_XFORM | NVG_STATE_SCISSOR);
+	nvgTransformMultiply(state->xform, t);
+	state->xformKind = nvg__xformKind(state->xform);
+	if (state->scissor.extent[0] >= 0.0f)
+		nvgTransformMultiply(state->scissor.xform, t);
+	memcpy(ctx->layerXform, toLayer, sizeof(float)*6);
+	nvg__setDevicePixelRatio(ctx, 1.0f);
+	ctx->params.renderViewport(ctx->params.userPtr, width, height, 1.0f);
+	return 1;
+}
+
+void nvgEndLayer(NVGcontext* ctx)
+{
+	NVGlayerScope* scope;
+	NVGlayer* l;
+	if (ctx->nlayerStack <= 0) return;
+	scope = &ctx->layerStack[--ctx->nlayerStack];
+	l = nvg__layer(ctx, scope->layer);
+
+	nvg__flushDeferred(ctx);
+	nvg__beginProfile(ctx, "nanovg layer");
+	ctx->params.renderEndLayer(ctx->params.userPtr);
+	nvg__endProfile(ctx);
+	l->valid = 1;
+
+	memcpy(ctx->layerXform, scope->xform, sizeof(float)*6);
+	nvg__setDevicePixelRatio(ctx, scope->devicePxRatio);
+	ctx->params.renderViewport(ctx->params.userPtr, scope->viewWidth, scope->viewHeight, scope->devicePxRatio);
+	nvgRestore(ctx);
+}
+
+int nvgDrawLayer(NVGcontext* ctx, int layer, float alpha)
+{
+	NVGlayer* l = nvg__layer(ctx, layer);
+	float x, y, w, h;
+	if (l == NULL || !l->valid || nvg__layerOpen(ctx, layer)) return 0;
+	x = l->x / l->ratio;
+	y = l->y / l->ratio;
+	w = l->width / l->ratio;
+	h = l->height / l->ratio;
+	nvgSave(ctx);
+	nvgResetTransform(ctx);
+	nvgBeginPath(ctx);
+	nvgRect(ctx, x, y, w, h);
+	nvgFillPaint(ctx, nvgImagePattern(ctx, x, y, w, h, 0.0f, l->image, alpha));
+	nvgFill(ctx);
+	nvgRestore(ctx);
+	return 1;
+}
+
+// Backdrops
+
+static NVGbackdrop* nvg__backdrop(NVGcontext* ctx, int backdrop)
+{
+	if (backdrop <= 0 || backdrop > ctx->nbackdrops || !ctx->backdrops[backdrop-1].used) return NULL;
+	return &ctx->backdrops[backdrop-1];
+}
+
+int nvgCreateBackdrop(NVGcontext* ctx)
+{
+	int i;
+	if (ctx->params.renderBackdrop == NULL) return 0;
+	for (i = 0; i < ctx->nbackdrops; i++)
+		if (!ctx->backdrops[i].used) break;
+	if (i == ctx->nbackdrops) {
+		if (!nvg__reserve((void**)&ctx->backdrops, &ctx->cbackdrops, ctx->nbackdrops + 1, sizeof(NVGbackdrop), 8)) return 0;
+		ctx->nbackdrops++;
+	}
+	memset(&ctx->backdrops[i], 0, sizeof(NVGbackdrop));
+	ctx->backdrops[i].used = 1;
+	return i + 1;
+}
+
+void nvgDeleteBackdrop(NVGcontext* ctx, int backdrop)
+{
+	NVGbackdrop* b = nvg__backdrop(ctx, backdrop);
+	if (b == NULL) return;
+	if (b->image != 0)
+		nvgDeleteImage(ctx, b->image);
+	memset(b, 0, sizeof(NVGbackdrop));
+}
+
+int nvgCaptureBackdrop(NVGcontext* ctx, int backdrop, float x, float y, float w, float h, float radius)
+{
+	NVGbackdrop* b = nvg__backdrop(ctx, backdrop);
+	float ratio, x0, y0, x1, y1;
+	int width, height, passes, ok;
+
+	// Within a layer the target holds the layer, and replayed calls could not copy the pixels.
+	if (b == NULL || ctx->nlayerStack > 0 || ctx->ndrawLists > 0 || ctx->recordOnly || nvg__capturing(ctx)) return 0;
+
+	ratio = ctx->devicePxRatio;
+	x0 = nvg__maxf(floorf(x * ratio), 0.0f);
+	y0 = nvg__maxf(floorf(y * ratio), 0.0f);
+	x1 = nvg__minf(ceilf((x + w) * ratio), floorf(ctx->viewWidth * ratio));
+	y1 = nvg__minf(ceilf((y + h) * ratio), floorf(ctx->viewHeight * ratio));
+	width = (int)(x1 - x0);
+	height = (int)(y1 - y0);
+	b->valid = 0;
+	if (width < 2 || height < 2) return 0;
+	// Every level of the filter halves the size and about doubles the reach.
+	passes = 1;
+	while (passes < NVG_MAX_BACKDROP_PASSES && (float)(2 << passes) < radius * ratio)
+		passes++;
+
+	if (b->image == 0 || b->width != width || b->height != height) {
+		if (b->image != 0)
+			nvgDeleteImage(ctx, b->image);
+		b->image = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_RGBA, (width + 1) / 2, (height + 1) / 2,
+												   NVG_IMAGE_PREMULTIPLIED | NVG_IMAGE_FLIPY, NULL);
+		b->width = b->image != 0 ? width : 0;
+		b->height = b->image != 0 ? height : 0;
+		if (b->image == 0) return 0;
+	}
+
+	nvg__flushDeferred(ctx);
+	nvg__beginProfile(ctx, "nanovg backdrop");
+	ok = ctx->params.renderBackdrop(ctx->params.userPtr, b->image, (int)x0, (int)y0, width, height, passes);
+	nvg__endProfile(ctx);
+	if (!ok) return 0;
+	b->x = x0;
+	b->y = y0;
+	b->ratio = ratio;
+	b->valid = 1;
+	return 1;
+}
+
+int nvgBackdropPattern(NVGcontext* ctx, int backdrop, float alpha, NVGpaint* paint)
+{
+	NVGbackdrop* b = nvg__backdrop(ctx, backdrop);
+	float x, y, w, h, inv[6];
+	if (b == NULL || !b->valid) return 0;
+	x = b->x / b->ratio;
+	y = b->y / b->ratio;
+	w = b->width / b->ratio;
+	h = b->height / b->ratio;
+	// Undoes the current transform, which nvgFillPaint() applies, so that the image stays at its
+	// rectangle of the view.
+	*paint = nvgImagePattern(ctx, x, y, w, h, 0.0f, b->image, alpha);
+	nvgTransformMultiply(paint->xform, ctx->layerXform);
+	nvgTransformInverse(inv, nvg__getState(ctx)->xform);
+	nvgTransformMultiply(paint->xform, inv);
+	return 1;
+}
+
+// Retained geometry
+
+// One kind of tessellation of a geometry, made under the transform diag(scale, flip*scale).
+struct NVGgeometryTess {
+	NVGpathCache* cache;
+	float scale;
+	float flip;
+	float tessTol;
+	int tessMode;
+	float tessScale;
+	float fringeWidth;
+	float expandWidth;
+	float strokeWidth;	// of the state, for strokes
+	int lineCap;
+	int lineJoin;
+	float miterLimit;
+	float width;		// stroke width handed to the back-end
+};
+typedef struct NVGgeometryTess NVGgeometryTess;
+
+struct NVGgeometry {
+	float* commands;	// in the local space of the transform at capture time
+	int ncommands;
+	NVGgeometryTess fill;
+	NVGgeometryTess stroke;
+};
+
+NVGgeometry* nvgCreateGeometry(NVGcontext* ctx)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGgeometry* geom;
+	float inv[6];
+
+	geom = (NVGgeometry*)malloc(sizeof(NVGgeometry));
+	if (geom == NULL) return NULL;
+	memset(geom, 0, sizeof(NVGgeometry));
+	geom->commands = (float*)malloc(sizeof(float)*nvg__maxi(ctx->ncommands, 1));
+	if (geom->commands == NULL) {
+		free(geom);
+		return NULL;
+	}
+	memcpy(geom->commands, ctx->commands, sizeof(float)*ctx->ncommands);
+	geom->ncommands = ctx->ncommands;
+
+	// The path is stored transformed, undo the transform it was built with.
+	if (nvgTransformInverse(inv, state->xform))
+		nvg__transformCommands(geom->commands, geom->ncommands, inv, nvg__xformKind(inv));
+	return geom;
+}
+
+void nvgDeleteGeometry(NVGgeometry* geom)
+{
+	if (geom == NULL) return;
+	nvg__deletePathCache(geom->fill.cache);
+	nvg__deletePathCache(geom->stroke.cache);
+	free(geom->commands);
+	free(geom);
+}
+
+// Splits the transform into the uniform scale and orientation a tessellation is made for.
+static int nvg__geometryScale(const float* xform, float* scale, float* flip)
+{
+	*scale = nvg__getAverageScale((float*)xform);
+	*flip = xform[0]*xform[3] - xform[2]*xform[1] < 0.0f ? -1.0f : 1.0f;
+	return *scale > 1e-6f;
+}
+
+// A tessellation stays usable while stroke and fringe widths would move by less than the tessellation tolerance.
+static int nvg__geometryValid(NVGcontext* ctx, NVGgeometryTess* t, float scale, float flip)
+{
+	float width = nvg__maxf(t->expandWidth, ctx->fringeWidth);
+	return t->cache != NULL && t->flip == flip && t->tessTol == ctx->tessTol && t->fringeWidth == ctx->fringeWidth &&
+		t->tessMode == ctx->tessMode && t->tessScale == ctx->tessScale &&
+		nvg__absf(scale - t->scale) * width <= ctx->tessTol * t->scale;
+}
+
+static int nvg__tessellateGeometry(NVGcontext* ctx, NVGgeometry* geom, NVGgeometryTess* t, int stroke,
+								   float scale, float flip, float expandWidth)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float xform[6];
+	float* commands;
+	NVGtess tess;
+
+	if (t->cache == NULL)
+		t->cache = nvg__allocPathCache();
+	commands = (float*)malloc(sizeof(float)*nvg__maxi(geom->ncommands, 1));
+	if (t->cache == NULL || commands == NULL) {
+		free(commands);
+		return 0;
+	}
+	memcpy(commands, geom->commands, sizeof(float)*geom->ncommands);
+	nvgTransformScale(xform, scale, flip*scale);
+	nvg__transformCommands(commands, geom->ncommands, xform, NVG_XFORM_SCALE);
+
+	nvg__clearPathCache(t->cache);
+	nvg__beginTess(ctx, &tess, t->cache, commands, geom->ncommands);
+	nvg__flattenPaths(&tess);
+	if (stroke)
+		nvg__expandStroke(&tess, expandWidth, state->lineCap, state->lineJoin, state->miterLimit);
+	else
+		nvg__expandFill(&tess, expandWidth, NVG_MITER, 2.4f);
+	nvg__endTess(ctx, &tess);
+	free(commands);
+
+	t->scale = scale;
+	t->flip = flip;
+	t->tessTol = ctx->tessTol;
+	t->tessMode = ctx->tessMode;
+	t->tessScale = ctx->tessScale;
+	t->fringeWidth = ctx->fringeWidth;
+	t->expandWidth = expandWidth;
+	t->strokeWidth = state->strokeWidth;
+	t->lineCap = state->lineCap;
+	t->lineJoin = state->lineJoin;
+	t->miterLimit = state->miterLimit;
+	return 1;
+}
+
+// Moves a tessellation into the current transform, into the context's geometry buffers.
+static int nvg__placeGeometry(NVGcontext* ctx, NVGgeometryTess* t, float* bounds)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpathCache* src = t->cache;
+	NVGvertex* dst;
+	float xform[6], sy = t->flip * t->scale;
+	float c[8];
+	int i, j, nverts = 0;
+
+	xform[0] = state->xform[0] / t->scale;
+	xform[1] = state->xform[1] / t->scale;
+	xform[2] = state->xform[2] / sy;
+	xform[3] = state->xform[3] / sy;
+	xform[4] = state->xform[4];
+	xform[5] = state->xform[5];
+
+	for (i = 0; i < src->npaths; i++)
+		nverts += src->paths[i].nfill + src->paths[i].nstroke;
+	if (!nvg__reserve((void**)&ctx->geomPaths, &ctx->cgeomPaths, src->npaths, sizeof(NVGpath), 16) ||
+		!nvg__reserve((void**)&ctx->geomVerts, &ctx->cgeomVerts, nverts, sizeof(NVGvertex), 256))
+		return 0;
+
+	dst = ctx->geomVerts;
+	for (i = 0; i < src->npaths; i++) {
+		const NVGpath* path = &src->paths[i];
+		NVGpath* placed = &ctx->geomPaths[i];
+		*placed = *path;
+		placed->fill = path->nfill > 0 ? dst : NULL;
+		for (j = 0; j < path->nfill; j++, dst++) {
+			nvgTransformPoint(&dst->x, &dst->y, xform, path->fill[j].x, path->fill[j].y);
+			dst->u = path->fill[j].u;
+			dst->v = path->fill[j].v;
+		}
+		placed->stroke = path->nstroke > 0 ? dst : NULL;
+		for (j = 0; j < path->nstroke; j++, dst++) {
+			nvgTransformPoint(&dst->x, &dst->y, xform, path->stroke[j].x, path->stroke[j].y);
+			dst->u = path->stroke[j].u;
+			dst->v = path->stroke[j].v;
+		}
+	}
+
+	nvgTransformPoint(&c[0], &c[1], xform, src->bounds[0], src->bounds[1]);
+	nvgTransformPoint(&c[2], &c[3], xform, src->bounds[2], src->bounds[1]);
+	nvgTransformPoint(&c[4], &c[5], xform, src->bounds[2], src->bounds[3]);
+	nvgTransformPoint(&c[6], &c[7], xform, src->bounds[0], src->bounds[3]);
+	bounds[0] = nvg__minf(nvg__minf(c[0], c[2]), nvg__minf(c[4], c[6]));
+	bounds[1] = nvg__minf(nvg__minf(c[1], c[3]), nvg__minf(c[5], c[7]));
+	bounds[2] = nvg__maxf(nvg__maxf(c[0], c[2]), nvg__maxf(c[4], c[6]));
+	bounds[3] = nvg__maxf(nvg__maxf(c[1], c[3]), nvg__maxf(c[5], c[7]));
+	return 1;
+}
+
+void nvgFillGeometry(NVGcontext* ctx, NVGgeometry* geom)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpaint fillPaint = state->fill;
+	float fringe = ctx->params.edgeAntiAlias ? ctx->fringeWidth : 0.0f;
+	float scale, flip, bounds[4];
+
+	if (geom == NULL || !nvg__geometryScale(state->xform, &scale, &flip)) return;
+	nvg__beginProfile(ctx, "nvgFillGeometry");
+	if (nvg__capturing(ctx))
+		nvg__captureGeometry(ctx, NVG_CAPTURE_FILL_GEOMETRY, geom);
+	if (nvg__geometryValid(ctx, &geom->fill, scale, flip) || nvg__tessellateGeometry(ctx, geom, &geom->fill, 0, scale, flip, fringe)) {
+		if (nvg__placeGeometry(ctx, &geom->fill, bounds)) {
+			// Apply global alpha
+			fillPaint.innerColor.a *= state->alpha;
+			fillPaint.outerColor.a *= state->alpha;
+			nvg__submitFill(ctx, &fillPaint, &state->scissor, ctx->fringeWidth,
+							bounds, ctx->geomPaths, geom->fill.cache->npaths);
+			nvg__countFill(ctx, geom->fill.cache);
+		}
+	}
+	nvg__endProfile(ctx);
+}
+
+void nvgStrokeGeometry(NVGcontext* ctx, NVGgeometry* geom)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGgeometryTess* t;
+	NVGpaint strokePaint;
+	float scale, flip, strokeWidth, expandWidth, bounds[4];
+
+	if (geom == NULL || !nvg__geometryScale(state->xform, &scale, &flip)) return;
+	nvg__beginProfile(ctx, "nvgStrokeGeometry");
+	if (nvg__capturing(ctx))
+		nvg__captureGeometry(ctx, NVG_CAPTURE_STROKE_GEOMETRY, geom);
+	t = &geom->stroke;
+	nvg__strokeParams(ctx, scale, &strokePaint, &strokeWidth, &expandWidth);
+	if (t->cache != NULL && t->strokeWidth == state->strokeWidth && t->lineCap == state->lineCap &&
+		t->lineJoin == state->lineJoin && t->miterLimit == state->miterLimit && nvg__geometryValid(ctx, t, scale, flip)) {
+		// Keep the width the outline was expanded for.
+		strokeWidth = t->width;
+	} else if (nvg__tessellateGeometry(ctx, geom, t, 1, scale, flip, expandWidth)) {
+		t->width = strokeWidth;
+	} else {
+		nvg__endProfile(ctx);
+		return;
+	}
+	if (nvg__placeGeometry(ctx, t, bounds)) {
+		nvg__submitStroke(ctx, &strokePaint, &state->scissor, ctx->fringeWidth,
+						  strokeWidth, ctx->geomPaths, t->cache->npaths);
+		nvg__countStroke(ctx, t->cache);
+	}
+	nvg__endProfile(ctx);
+}
+
+// Frame capture
+
+struct NVGcaptureGeometry {
+	const NVGgeometry* geom;
+	int ncommands;
+	unsigned int hash;	// of the commands, an address reused by a new geometry gets a new id
+};
+typedef struct NVGcaptureGeometry NVGcaptureGeometry;
+
+struct NVGcapture {
+	unsigned char* data;
+	int ndata;
+	int cdata;
+	int frames;		// still to capture, counting the current one
+	int active;		// inside a captured frame
+	int mute;		// inside a call that records itself, whose nested calls are not recorded
+	int failed;		// out of memory, the capture is dropped
+	NVGstate last;	// state of the previous draw
+	int haveLast;
+	int* images;
+	int nimages;
+	int cimages;
+	int* fonts;
+	int nfonts;
+	int cfonts;
+	NVGcaptureGeometry* geoms;
+	int ngeoms;
+	int cgeoms;
+};
+
+static void nvg__deleteCapture(NVGcontext* ctx)
+{
+	NVGcapture* c = ctx->capture;
+	if (c == NULL) return;
+	free(c->data);
+	free(c->images);
+	free(c->fonts);
+	free(c->geoms);
+	free(c);
+	ctx->capture = NULL;
+}
+
+static void nvg__captureMute(NVGcontext* ctx, int delta)
+{
+	if (ctx->capture != NULL)
+		ctx->capture->mute += delta;
+}
+
+static int nvg__capturing(NVGcontext* ctx)
+{
+	NVGcapture* c = ctx->capture;
+	return c != NULL && c->active && c->mute == 0 && !c->failed && ctx->recordOnly == 0;
+}
+
+static void nvg__captureWrite(NVGcapture* c, const void* p, int n)
+{
+	if (c->failed) return;
+	if (!nvg__reserve((void**)&c->data, &c->cdata, c->ndata + n, 1, 4096)) {
+		c->failed = 1;
+		return;
+	}
+	memcpy(&c->data[c->ndata], p, n);
+	c->ndata += n;
+}
+
+static void nvg__captureOp(NVGcapture* c, int op)
+{
+	unsigned char b = (unsigned char)op;
+	nvg__captureWrite(c, &b, 1);
+}
+
+static void nvg__captureInt(NVGcapture* c, int v)
+{
+	nvg__captureWrite(c, &v, sizeof(int));
+}
+
+static void nvg__captureFloat(NVGcapture* c, float v)
+{
+	nvg__captureWrite(c, &v, sizeof(float));
+}
+
+static int nvg__captureSeen(int** ids, int* n, int* cap, int id)
+{
+	int i;
+	for (i = 0; i < *n; i++)
+		if ((*ids)[i] == id) return 1;
+	if (nvg__reserve((void**)ids, cap, *n + 1, sizeof(int), 16))
+		(*ids)[(*n)++] = id;
+	return 0;
+}
+
+static void nvg__captureImage(NVGcontext* ctx, int image)
+{
+	NVGcapture* c = ctx->capture;
+	int w = 0, h = 0;
+	if (image == 0 || nvg__captureSeen(&c->images, &c->nimages, &c->cimages, image)) return;
+	nvgImageSize(ctx, image, &w, &h);
+	nvg__captureOp(c, NVG_CAPTURE_IMAGE);
+	nvg__captureInt(c, image);
+	nvg__captureInt(c, w);
+	nvg__captureInt(c, h);
+}
+
+static void nvg__captureFont(NVGcontext* ctx, int font)
+{
+	NVGcapture* c = ctx->capture;
+	const char* name = "";
+	if (font < 0 || nvg__captureSeen(&c->fonts, &c->nfonts, &c->cfonts, font)) return;
+	if (font < ctx->fs->nfonts)
+		name = ctx->fs->fonts[font]->name;
+	nvg__captureOp(c, NVG_CAPTURE_FONT);
+	nvg__captureInt(c, font);
+	nvg__captureInt(c, (int)strlen(name));
+	nvg__captureWrite(c, name, (int)strlen(name));
+}
+
+// Byte ranges of the state written as a whole when anything in them changed.
+static const struct { int offset, size; } nvg__stateGroups[] = {
+	{ offsetof(NVGstate, fill), sizeof(NVGpaint) },
+	{ offsetof(NVGstate, stroke), sizeof(NVGpaint) },
+	{ offsetof(NVGstate, strokeWidth), offsetof(NVGstate, xform) - offsetof(NVGstate, strokeWidth) },
+	{ offsetof(NVGstate, xform), offsetof(NVGstate, scissor) - offsetof(NVGstate, xform) },
+	{ offsetof(NVGstate, scissor), sizeof(NVGscissor) },
+	{ offsetof(NVGstate, fontSize), sizeof(NVGstate) - offsetof(NVGstate, fontSize) },
+};
+#define NVG_STATE_GROUPS (int)(sizeof(nvg__stateGroups) / sizeof(nvg__stateGroups[0]))
+
+// Writes the images and the font the state refers to if they are new, then the parts of the state that changed.
+static void nvg__captureState(NVGcontext* ctx)
+{
+	NVGcapture* c = ctx->capture;
+	NVGstate* state = nvg__getState(ctx);
+	const unsigned char* now = (const unsigned char*)state;
+	const unsigned char* last = (const unsigned char*)&c->last;
+	int i, mask = 0;
+	nvg__captureImage(ctx, state->fill.image);
+	nvg__captureImage(ctx, state->stroke.image);
+	nvg__captureFont(ctx, state->fontId);
+	for (i = 0; i < NVG_STATE_GROUPS; i++)
+		if (!c->haveLast || memcmp(now + nvg__stateGroups[i].offset, last + nvg__stateGroups[i].offset, nvg__stateGroups[i].size) != 0)
+			mask |= 1 << i;
+	if (mask == 0) return;
+	nvg__captureOp(c, NVG_CAPTURE_STATE);
+	nvg__captureOp(c, mask);
+	for (i = 0; i < NVG_STATE_GROUPS; i++)
+		if (mask & (1 << i))
+			nvg__captureWrite(c, now + nvg__stateGroups[i].offset, nvg__stateGroups[i].size);
+	c->last = *state;
+	c->haveLast = 1;
+}
+
+static void nvg__captureBeginFrame(NVGcontext* ctx, int width, int height, float devicePixelRatio)
+{
+	NVGcapture* c = ctx->capture;
+	if (c == NULL || c->frames <= 0 || c->active) return;
+	c->active = 1;
+	c->haveLast = 0;
+	nvg__captureOp(c, NVG_CAPTURE_BEGIN_FRAME);
+	nvg__captureInt(c, width);
+	nvg__captureInt(c, height);
+	nvg__captureFloat(c, devicePixelRatio);
+}
+
+static void nvg__captureEndFrame(NVGcontext* ctx)
+{
+	NVGcapture* c = ctx->capture;
+	if (c == NULL || !c->active) return;
+	nvg__captureOp(c, NVG_CAPTURE_END_FRAME);
+	c->active = 0;
+	c->frames--;
+}
+
+// Records a fill or stroke of the current path, whose commands are already transformed.
+static void nvg__captureDraw(NVGcontext* ctx, int op)
+{
+	NVGcapture* c = ctx->capture;
+	nvg__captureState(ctx);
+	nvg__captureOp(c, op);
+	nvg__captureInt(c, ctx->ncommands);
+	nvg__captureWrite(c, ctx->commands, ctx->ncommands * (int)sizeof(float));
+}
+
+static void nvg__captureText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
+{
+	NVGcapture* c = ctx->capture;
+	int n = end != NULL ? (int)(end - string) : (int)strlen(string);
+	nvg__captureState(ctx);
+	nvg__captureOp(c, NVG_CAPTURE_TEXT);
+	nvg__captureFloat(c, x);
+	nvg__captureFloat(c, y);
+	nvg__captureInt(c, n);
+	nvg__captureWrite(c, string, n);
+}
+
+static void nvg__captureIcon(NVGcontext* ctx, float x, float y, int codepoint)
+{
+	NVGcapture* c = ctx->capture;
+	nvg__captureState(ctx);
+	nvg__captureOp(c, NVG_CAPTURE_ICON);
+	nvg__captureFloat(c, x);
+	nvg__captureFloat(c, y);
+	nvg__captureInt(c, codepoint);
+}
+
+static void nvg__captureShape(NVGcontext* ctx, float x, float y, float w, float h, float r, float pad, int outside)
+{
+	NVGcapture* c = ctx->capture;
+	nvg__captureState(ctx);
+	nvg__captureOp(c, NVG_CAPTURE_SHAPE);
+	nvg__captureFloat(c, x);
+	nvg__captureFloat(c, y);
+	nvg__captureFloat(c, w);
+	nvg__captureFloat(c, h);
+	nvg__captureFloat(c, r);
+	nvg__captureFloat(c, pad);
+	nvg__captureInt(c, outside);
+}
+
+static unsigned int nvg__hashBytes(const unsigned char* bytes, int n)
+{
+	unsigned int hash = 2166136261u;
+	int i;
+	for (i = 0; i < n; i++)
+		hash = (hash ^ bytes[i]) * 16777619u;
+	return hash;
+}
+
+static void nvg__captureGeometry(NVGcontext* ctx, int op, const NVGgeometry* geom)
+{
+	NVGcapture* c = ctx->capture;
+	unsigned int hash = nvg__hashBytes((const unsigned char*)geom->commands, geom->ncommands * (int)sizeof(float));
+	int i, id = -1;
+
+	for (i = 0; i < c->ngeoms && id < 0; i++) {
+		const NVGcaptureGeometry* g = &c->geoms[i];
+		if (g->geom == geom && g->ncommands == geom->ncommands && g->hash == hash)
+			id = i;
+	}
+	if (id < 0) {
+		if (!nvg__reserve((void**)&c->geoms, &c->cgeoms, c->ngeoms + 1, sizeof(NVGcaptureGeometry), 16)) {
+			c->failed = 1;
+			return;
+		}
+		id = c->ngeoms++;
+		c->geoms[id].geom = geom;
+		c->geoms[id].ncommands = geom->ncommands;
+		c->geoms[id].hash = hash;
+		nvg__captureOp(c, NVG_CAPTURE_GEOMETRY);
+		nvg__captureInt(c, id);
+		nvg__captureInt(c, geom->ncommands);
+		nvg__captureWrite(c, geom->commands, geom->ncommands * (int)sizeof(float));
+	}
+	nvg__captureState(ctx);
+	nvg__captureOp(c, op);
+	nvg__captureInt(c, id);
+}
+
+void nvgCaptureFrames(NVGcontext* ctx, int frames)
+{
+	NVGcapture* c = ctx->capture;
+	int version = NVG_CAPTURE_VERSION, stateSize = (int)sizeof(NVGstate);
+	if (c == NULL) {
+		c = (NVGcapture*)malloc(sizeof(NVGcapture));
+		if (c == NULL) return;
+		memset(c, 0, sizeof(NVGcapture));
+		ctx->capture = c;
+	}
+	c->ndata = 0;
+	c->nimages = 0;
+	c->nfonts = 0;
+	c->ngeoms = 0;
+	c->active = 0;
+	c->mute = 0;
+	c->failed = 0;
+	c->haveLast = 0;
+	c->frames = nvg__maxi(frames, 0);
+	nvg__captureWrite(c, "NVGC", 4);
+	nvg__captureInt(c, version);
+	nvg__captureInt(c, stateSize);
+}
+
+const unsigned char* nvgCaptureData(NVGcontext* ctx, int* size)
+{
+	NVGcapture* c = ctx->capture;
+	*size = 0;
+	if (c == NULL || c->frames > 0 || c->active || c->failed) return NULL;
+	*size = c->ndata;
+	return c->data;
+}
+
+// Replay of captured frames
+
+struct NVGreplay {
+	unsigned char* data;
+	int ndata;
+	int pos;			// offset of the next frame
+	NVGstate state;		// as captured, before the ids are mapped
+	int* images;		// pairs of captured and replayed ids
+	int nimages;
+	int cimages;
+	int* fonts;			// pairs of captured and replayed ids
+	int nfonts;
+	int cfonts;
+	NVGgeometry** geoms;	// by captured id
+	unsigned int* geomHashes;	// of the commands each geometry was created from
+	int ngeoms;
+	int cgeoms;
+	int cgeomHashes;
+};
+
+struct NVGreader {
+	const unsigned char* p;
+	const unsigned char* end;
+	int failed;
+};
+typedef struct NVGreader NVGreader;
+
+static const unsigned char* nvg__readBytes(NVGreader* r, int n)
+{
+	const unsigned char* p = r->p;
+	if (n < 0 || r->end - r->p < n) {
+		r->failed = 1;
+		return NULL;
+	}
+	r->p += n;
+	return p;
+}
+
+static int nvg__readInt(NVGreader* r)
+{
+	int v = 0;
+	const unsigned char* p = nvg__readBytes(r, sizeof(int));
+	if (p != NULL) memcpy(&v, p, sizeof(int));
+	return v;
+}
+
+static float nvg__readFloat(NVGreader* r)
+{
+	float v = 0.0f;
+	const unsigned char* p = nvg__readBytes(r, sizeof(float));
+	if (p != NULL) memcpy(&v, p, sizeof(float));
+	return v;
+}
+
+static int nvg__replayId(const int* pairs, int n, int id, int missing)
+{
+	int i;
+	for (i = 0; i < n; i++)
+		if (pairs[i*2] == id) return pairs[i*2+1];
+	return missing;
+}
+
+static int nvg__replayMap(int** pairs, int* n, int* cap, int id, int replayed)
+{
+	if (!nvg__reserve((void**)pairs, cap, (*n + 1) * 2, sizeof(int), 16)) return 0;
+	(*pairs)[*n*2] = id;
+	(*pairs)[*n*2+1] = replayed;
+	(*n)++;
+	return 1;
+}
+
+// Makes the captured commands the current path, as they were when the draw was captured.
+static int nvg__replayCommands(NVGcontext* ctx, NVGreader* r)
+{
+	int n = nvg__readInt(r);
+	const unsigned char* p = nvg__readBytes(r, n * (int)sizeof(float));
+	if (p == NULL) return 0;
+	nvgBeginPath(ctx);
+	if (!nvg__reserve((void**)&ctx->commands, &ctx->ccommands, n, sizeof(float), 256)) return 0;
+	memcpy(ctx->commands, p, n * sizeof(float));
+	ctx->ncommands = n;
+	ctx->peakCommands = nvg__maxi(ctx->peakCommands, n);
+	return 1;
+}
+
+static void nvg__replayState(NVGcontext* ctx, NVGreplay* replay, NVGreader* r)
+{
+	NVGstate s;
+	const unsigned char* p;
+	int i, mask;
+	p = nvg__readBytes(r, 1);
+	if (p == NULL) return;
+	mask = *p;
+	for (i = 0; i < NVG_STATE_GROUPS; i++) {
+		if ((mask & (1 << i)) == 0) continue;
+		p = nvg__readBytes(r, nvg__stateGroups[i].size);
+		if (p == NULL) return;
+		memcpy((unsigned char*)&replay->state + nvg__stateGroups[i].offset, p, nvg__stateGroups[i].size);
+	}
+	s = replay->state;
+	if (s.fill.image != 0)
+		s.fill.image = nvg__replayId(replay->images, replay->nimages, s.fill.image, 0);
+	if (s.stroke.image != 0)
+		s.stroke.image = nvg__replayId(replay->images, replay->nimages, s.stroke.image, 0);
+	s.fontId = nvg__replayId(replay->fonts, replay->nfonts, s.fontId, FONS_INVALID);
+	*nvg__editState(ctx, NVG_STATE_ALL) = s;
+}
+
+// Images stand in for the captured ones with their size, their content is not captured.
+static void nvg__replayImage(NVGcontext* ctx, NVGreplay* replay, NVGreader* r)
+{
+	int id = nvg__readInt(r), w = nvg__readInt(r), h = nvg__readInt(r), image = 0;
+	unsigned char* pixels;
+	if (r->failed || nvg__replayId(replay->images, replay->nimages, id, -1) != -1) return;
+	if (w > 0 && h > 0 && w <= 16384 && h <= 16384) {
+		pixels = (unsigned char*)calloc((size_t)w * h, 4);
+		if (pixels != NULL) {
+			image = nvgCreateImageRGBA(ctx, w, h, 0, pixels);
+			free(pixels);
+		}
+	}
+	nvg__replayMap(&replay->images, &replay->nimages, &replay->cimages, id, image);
+}
+
+// Fonts are looked up by name, a font the context does not know is drawn with its first font.
+static void nvg__replayFont(NVGcontext* ctx, NVGreplay* replay, NVGreader* r)
+{
+	char name[64];
+	int id = nvg__readInt(r), n = nvg__readInt(r), font;
+	const unsigned char* p = nvg__readBytes(r, n);
+	if (p == NULL || nvg__replayId(replay->fonts, replay->nfonts, id, -2) != -2) return;
+	n = nvg__mini(n, (int)sizeof(name) - 1);
+	memcpy(name, p, n);
+	name[n] = '\0';
+	font = nvgFindFont(ctx, name);
+	if (font < 0 && nvgFontCount(ctx) > 0)
+		font = 0;
+	nvg__replayMap(&replay->fonts, &replay->nfonts, &replay->cfonts, id, font);
+}
+
+// A geometry is created again only if the commands under its id changed, as they do between
+// streams captured one after the other.
+static void nvg__replayGeometry(NVGcontext* ctx, NVGreplay* replay, NVGreader* r)
+{
+	NVGstate saved = *nvg__getState(ctx);
+	NVGstate* state;
+	NVGreader commands;
+	unsigned int hash;
+	int id = nvg__readInt(r), n;
+	if (r->failed || id < 0) {
+		r->failed = 1;
+		return;
+	}
+	commands = *r;
+	n = nvg__readInt(r);
+	if (nvg__readBytes(r, n * (int)sizeof(float)) == NULL) return;
+	hash = nvg__hashBytes(r->p - n * sizeof(float), n * (int)sizeof(float));
+	if (id < replay->ngeoms && replay->geoms[id] != NULL) {
+		if (replay->geomHashes[id] == hash) return;
+		nvgDeleteGeometry(replay->geoms[id]);
+		replay->geoms[id] = NULL;
+	}
+	if (!nvg__reserve((void**)&replay->geoms, &replay->cgeoms, id + 1, sizeof(NVGgeometry*), 16) ||
+		!nvg__reserve((void**)&replay->geomHashes, &replay->cgeomHashes, id + 1, sizeof(unsigned int), 16)) {
+		r->failed = 1;
+		return;
+	}
+	while (replay->ngeoms <= id)
+		replay->geoms[replay->ngeoms++] = NULL;
+	// The commands are in the local space of the geometry, built under the identity.
+	state = nvg__editState(ctx, NVG_STATE_XFORM);
+	nvgTransformIdentity(state->xform);
+	state->xformKind = NVG_XFORM_TRANSLATE;
+	if (nvg__replayCommands(ctx, &commands)) {
+		replay->geoms[id] = nvgCreateGeometry(ctx);
+		replay->geomHashes[id] = hash;
+	}
+	*nvg__editState(ctx, NVG_STATE_ALL) = saved;
+	nvgBeginPath(ctx);
+}
+
+static NVGgeometry* nvg__replayGeometryId(NVGreplay* replay, NVGreader* r)
+{
+	int id = nvg__readInt(r);
+	if (r->failed || id < 0 || id >= replay->ngeoms) {
+		r->failed = 1;
+		return NULL;
+	}
+	return replay->geoms[id];
+}
+
+// Returns the offset of the first frame if the stream was captured by this build, else 0.
+static int nvg__replayHeader(const unsigned char* data, int ndata)
+{
+	NVGreader r;
+	const unsigned char* magic;
+	int version, stateSize;
+
+	r.p = data;
+	r.end = data + ndata;
+	r.failed = 0;
+	magic = nvg__readBytes(&r, 4);
+	version = nvg__readInt(&r);
+	stateSize = nvg__readInt(&r);
+	if (r.failed || memcmp(magic, "NVGC", 4) != 0 || version != NVG_CAPTURE_VERSION || stateSize != (int)sizeof(NVGstate))
+		return 0;
+	return (int)(r.p - data);
+}
+
+NVGreplay* nvgCreateReplay(const unsigned char* data, int ndata)
+{
+	NVGreplay* replay;
+	if (nvg__replayHeader(data, ndata) == 0) return NULL;
+	replay = (NVGreplay*)malloc(sizeof(NVGreplay));
+	if (replay == NULL) return NULL;
+	memset(replay, 0, sizeof(NVGreplay));
+	if (!nvgReplayLoad(replay, data, ndata)) {
+		free(replay);
+		return NULL;
+	}
+	return replay;
+}
+
+int nvgReplayLoad(NVGreplay* replay, const unsigned char* data, int ndata)
+{
+	int first = nvg__replayHeader(data, ndata);
+	unsigned char* copy;
+	if (first == 0) return 0;
+	copy = (unsigned char*)malloc(ndata);
+	if (copy == NULL) return 0;
+	memcpy(copy, data, ndata);
+	free(replay->data);
+	replay->data = copy;
+	replay->ndata = ndata;
+	replay->pos = first;
+	return 1;
+}
+
+void nvgDeleteReplay(NVGcontext* ctx, NVGreplay* replay)
+{
+	int i;
+	if (replay == NULL) return;
+	for (i = 0; i < replay->nimages; i++)
+		if (replay->images[i*2+1] != 0)
+			nvgDeleteImage(ctx, replay->images[i*2+1]);
+	for (i = 0; i < replay->ngeoms; i++)
+		nvgDeleteGeometry(replay->geoms[i]);
+	free(replay->images);
+	free(replay->fonts);
+	free(replay->geoms);
+	free(replay->geomHashes);
+	free(replay->data);
+	free(replay);
+}
+
+void nvgRewindReplay(NVGreplay* replay)
+{
+	replay->pos = 4 + 2 * (int)sizeof(int);
+}
+
+int nvgReplayFrame(NVGcontext* ctx, NVGreplay* replay)
+{
+	NVGreader r;
+	NVGgeometry* geom;
+	int op, w, h, n, frame = 0;
+	float x, y, v[4];
+	const unsigned char* p;
+
+	r.p = replay->data + replay->pos;
+	r.end = replay->data + replay->ndata;
+	r.failed = 0;
+	if (r.p == r.end) return 0;
+
+	while (!r.failed && r.p < r.end) {
+		op = *r.p++;
+		if (!frame && op != NVG_CAPTURE_BEGIN_FRAME) break;
+		switch (op) {
+		case NVG_CAPTURE_BEGIN_FRAME:
+			if (frame) {
+				r.failed = 1;
+				break;
+			}
+			w = nvg__readInt(&r);
+			h = nvg__readInt(&r);
+			x = nvg__readFloat(&r);
+			if (r.failed) break;
+			nvgBeginFrame(ctx, w, h, x);
+			frame = 1;
+			break;
+		case NVG_CAPTURE_END_FRAME:
+			nvgEndFrame(ctx);
+			replay->pos = (int)(r.p - replay->data);
+			return 1;
+		case NVG_CAPTURE_STATE:
+			nvg__replayState(ctx, replay, &r);
+			break;
+		case NVG_CAPTURE_IMAGE:
+			nvg__replayImage(ctx, replay, &r);
+			break;
+		case NVG_CAPTURE_FONT:
+			nvg__replayFont(ctx, replay, &r);
+			break;
+		case NVG_CAPTURE_GEOMETRY:
+			nvg__replayGeometry(ctx, replay, &r);
+			break;
+		case NVG_CAPTURE_FILL:
+			if (nvg__replayCommands(ctx, &r)) nvgFill(ctx);
+			break;
+		case NVG_CAPTURE_STROKE:
+			if (nvg__replayCommands(ctx, &r)) nvgStroke(ctx);
+			break;
+		case NVG_CAPTURE_FILLSTROKE:
+			if (nvg__replayCommands(ctx, &r)) nvgFillStroke(ctx);
+			break;
+		case NVG_CAPTURE_TEXT:
+			x = nvg__readFloat(&r);
+			y = nvg__readFloat(&r);
+			n = nvg__readInt(&r);
+			p = nvg__readBytes(&r, n);
+			if (p != NULL) nvgText(ctx, x, y, (const char*)p, (const char*)p + n);
+			break;
+		case NVG_CAPTURE_ICON:
+			x = nvg__readFloat(&r);
+			y = nvg__readFloat(&r);
+			n = nvg__readInt(&r);
+			if (!r.failed) nvgIcon(ctx, x, y, n);
+			break;
+		case NVG_CAPTURE_SHAPE:
+			x = nvg__readFloat(&r);
+			y = nvg__readFloat(&r);
+			for (n = 0; n < 4; n++)
+				v[n] = nvg__readFloat(&r);
+			n = nvg__readInt(&r);
+			if (r.failed) break;
+			if (n)
+				nvgDrawBoxShadow(ctx, x, y, v[0], v[1], v[2], v[3]);
+			else
+				nvgDrawRoundedRectSDF(ctx, x, y, v[0], v[1], v[2]);
+			break;
+		case NVG_CAPTURE_FILL_GEOMETRY:
+			geom = nvg__replayGeometryId(replay, &r);
+			if (geom != NULL) nvgFillGeometry(ctx, geom);
+			break;
+		case NVG_CAPTURE_STROKE_GEOMETRY:
+			geom = nvg__replayGeometryId(replay, &r);
+			if (geom != NULL) nvgStrokeGeometry(ctx, geom);
+			break;
+		default:
+			r.failed = 1;
+			break;
+		}
+	}
+
+	// A malformed or truncated stream ends the replay.
+	if (frame) nvgCancelFrame(ctx);
+	replay->pos = replay->ndata;
+	return -1;
+}
+
+// Add fonts
+int nvgCreateFont(NVGcontext* ctx, const char* name, const char* path)
+{
+	return fonsAddFont(ctx->fs, name, path);
+}
+
+int nvgCreateFontMem(NVGcontext* ctx, const char* name, unsigned char* data, int ndata, int freeData)
+{
+	return fonsAddFontMem(ctx->fs, name, data, ndata, freeData);
+}
+
+void nvgSetFontLoader(NVGcontext* ctx, NVGfontLoader loader, void* userPtr)
+{
+	ctx->fontLoader = loader;
+	ctx->fontLoaderUser = userPtr;
+}
+
+int nvgFindFont(NVGcontext* ctx, const char* name)
+{
+	int font;
+	if (name == NULL) return -1;
+	font = fonsGetFontByName(ctx->fs, name);
+	// A loader creating some other font than the one asked for must not recurse.
+	if (font == FONS_INVALID && ctx->fontLoader != NULL && !ctx->loadingFont) {
+		ctx->loadingFont = 1;
+		font = ctx->fontLoader(ctx->fontLoaderUser, ctx, name);
+		ctx->loadingFont = 0;
+		if (font < 0)
+			font = FONS_INVALID;
+	}
+	return font;
+}
+
+int nvgFontCount(NVGcontext* ctx)
+{
+	return fonsFontCount(ctx->fs);
+}
+
+int nvgAddFallbackFontId(NVGcontext* ctx, int baseFont, int fallbackFont)
+{
+	if (baseFont == -1 || fallbackFont == -1) return 0;
+	return fonsAddFallbackFont(ctx->fs, baseFont, fallbackFont);
+}
+
+int nvgAddFallbackFont(NVGcontext* ctx, const char* baseFont, const char* fallbackFont)
+{
+	return nvgAddFallbackFontId(ctx, nvgFindFont(ctx, baseFont), nvgFindFont(ctx, fallbackFont));
+}
+
+void nvgResetFallbackFontsId(NVGcontext* ctx, int baseFont)
+{
+	fonsResetFallbackFont(ctx->fs, baseFont);
+}
+
+void nvgResetFallbackFonts(NVGcontext* ctx, const char* baseFont)
+{
+	nvgResetFallbackFontsId(ctx, nvgFindFont(ctx, baseFont));
+}
+
+// State setting
+void nvgFontSize(NVGcontext* ctx, float size)
+{
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_TEXT);
+	state->fontSize = size;
+}
+
+void nvgFontBlur(NVGcontext* ctx, float blur)
+{
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_TEXT);
+	state->fontBlur = blur;
+}
+
+void nvgTextLetterSpacing(NVGcontext* ctx, float spacing)
+{
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_TEXT);
+	state->letterSpacing = spacing;
+}
+
+void nvgTextLineHeight(NVGcontext* ctx, float lineHeight)
+{
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_TEXT);
+	state->lineHeight = lineHeight;
+}
+
+void nvgTextAlign(NVGcontext* ctx, int align)
+{
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_TEXT);
+	state->textAlign = align;
+}
+
+void nvgFontFaceId(NVGcontext* ctx, int font)
+{
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_TEXT);
+	state->fontId = font;
+}
+
+void nvgFontFace(NVGcontext* ctx, const char* font)
+{
+	NVGstate* state = nvg__editState(ctx, NVG_STATE_TEXT);
+	state->fontId = nvgFindFont(ctx, font);
+}
+
+static float nvg__quantize(float a, float d)
+{
+	return ((int)(a / d + 0.5f)) * d;
+}
+
+static float nvg__getFontScale(NVGstate* state)
+{
+	return nvg__minf(nvg__quantize(nvg__getStateScale(state), 0.01f), 4.0f);
+}
+
+static void nvg__retireFontImage(NVGcontext* ctx, int image)
+{
+	if (ctx->nretiredFontImages+1 > ctx->cretiredFontImages) {
+		int cimages = nvg__maxi(ctx->nretiredFontImages+1, 4) + ctx->cretiredFontImages/2;
+		int* images = (int*)realloc(ctx->retiredFontImages, sizeof(int)*cimages);
+		if (images == NULL) {
+			nvgDeleteImage(ctx, image);
+			return;
+		}
+		ctx->retiredFontImages = images;
+		ctx->cretiredFontImages = cimages;
+	}
+	ctx->retiredFontImages[ctx->nretiredFontImages++] = image;
+}
+
+// Gives every atlas page a texture. Pages fontstash evicted get a new one, the old texture lives
+// on until the end of the frame as earlier text may still be drawn from it.
+static void nvg__syncFontPages(NVGcontext* ctx)
+{
+	int i, iw, ih, n = fonsPageCount(ctx->fs);
+
+	for (i = 0; i < n; i++) {
+		int epoch = fonsPageEpoch(ctx->fs, i);
+		if (ctx->fontImages[i] != 0 && ctx->fontEpochs[i] == epoch)
+			continue;
+		if (ctx->fontImages[i] != 0) {
+			nvg__retireFontImage(ctx, ctx->fontImages[i]);
+			++ctx->atlasGeneration;
+		}
+		fonsGetPageData(ctx->fs, i, &iw, &ih);
+		ctx->fontImages[i] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, nvg__fontImageFlags(ctx), NULL);
+		ctx->fontEpochs[i] = epoch;
+	}
+}
+
+static void nvg__flushTextTexture(NVGcontext* ctx)
+{
+	int i, dirty[4], n = fonsPageCount(ctx->fs);
+
+	nvg__syncFontPages(ctx);
+	for (i = 0; i < n; i++) {
+		if (fonsValidatePage(ctx->fs, i, dirty)) {
+			int fontImage = ctx->fontImages[i];
+			// Update texture
+			if (fontImage != 0) {
+				int iw, ih;
+				const unsigned char* data = fonsGetPageData(ctx->fs, i, &iw, &ih);
+				int x = dirty[0];
+				int y = dirty[1];
+				int w = dirty[2] - dirty[0];
+				int h = dirty[3] - dirty[1];
+				ctx->params.renderUpdateTexture(ctx->params.userPtr, fontImage, x,y, w,h, data);
+				ctx->atlasUploads++;
+				ctx->atlasUploadBytes += w*h;
+			}
+		}
+	}
+}
+
+struct NVGglyphBuilder {
+	struct FONScontext* fs;
+};
+
+static int nvg__prewarmGlyphs(FONScontext* fs, int font, const float* sizes, int nsizes, float ratio,
+							  const char* string, const char* end)
+{
+	int i, n = 0;
+
+	if (font < 0) return 0;
+	if (end == NULL)
+		end = string + strlen(string);
+
+	fonsSetBlur(fs, 0.0f);
+	fonsSetFont(fs, font);
+	for (i = 0; i < nsizes; i++) {
+		fonsSetSize(fs, sizes[i] * nvg__minf(nvg__quantize(ratio, 0.01f), 4.0f));
+		n += fonsPrewarm(fs, string, end);
+	}
+	return n;
+}
+
+int nvgPrewarmGlyphs(NVGcontext* ctx, int font, const float* sizes, int nsizes, float devicePixelRatio,
+					 const char* string, const char* end)
+{
+	int n = nvg__prewarmGlyphs(ctx->fs, font, sizes, nsizes, devicePixelRatio, string, end);
+	nvg__flushTextTexture(ctx);
+	return n;
+}
+
+int nvgSaveFontAtlas(NVGcontext* ctx, const char* filename)
+{
+	return fonsSaveAtlas(ctx->fs, filename);
+}
+
+int nvgLoadFontAtlas(NVGcontext* ctx, const char* filename)
+{
+	int ok = fonsLoadAtlas(ctx->fs, filename);
+	// Even a failed load may have cleared pages.
+	++ctx->atlasGeneration;
+	nvg__flushTextTexture(ctx);
+	return ok;
+}
+
+int nvgFontRasterizer(NVGcontext* ctx, int rasterizer)
+{
+	int changed = rasterizer != fonsGetRasterizer(ctx->fs);
+	int ok = fonsSetRasterizer(ctx->fs, rasterizer);
+	if (ok && changed) {
+		++ctx->atlasGeneration;
+		nvg__flushTextTexture(ctx);
+	}
+	return ok;
+}
+
+NVGglyphBuilder* nvgCreateGlyphBuilder(NVGcontext* ctx)
+{
+	NVGglyphBuilder* builder = (NVGglyphBuilder*)malloc(sizeof(NVGglyphBuilder));
+	if (builder == NULL) return NULL;
+	builder->fs = fonsCreateShared(ctx->fs);
+	if (builder->fs == NULL) {
+		free(builder);
+		return NULL;
+	}
+	return builder;
+}
+
+int nvgBuilderPrewarmGlyphs(NVGglyphBuilder* builder, int font, const float* sizes, int nsizes, float devicePixelRatio,
+							const char* string, const char* end)
+{
+	return nvg__prewarmGlyphs(builder->fs, font, sizes, nsizes, devicePixelRatio, string, end);
+}
+
+int nvgBuilderSaveFontAtlas(NVGglyphBuilder* builder, const char* filename)
+{
+	return fonsSaveAtlas(builder->fs, filename);
+}
+
+int nvgInstallGlyphBuilder(NVGcontext* ctx, NVGglyphBuilder* builder)
+{
+	int size = 0, ok;
+	unsigned char* data = fonsSaveAtlasMem(builder->fs, &size);
+	if (data == NULL) return 0;
+	ok = fonsLoadAtlasMem(ctx->fs, data, size);
+	free(data);
+	++ctx->atlasGeneration;
+	nvg__flushTextTexture(ctx);
+	return ok;
+}
+
+void nvgDeleteGlyphBuilder(NVGglyphBuilder* builder)
+{
+	if (builder == NULL) return;
+	fonsDeleteInternal(builder->fs);
+	free(builder);
+}
+
+// Measure contexts have a back-end that accepts textures and draws nothing.
+static int nvg__measureCreate(void* uptr)
+{
+	NVG_NOTUSED(uptr);
+	return 1;
+}
+
+static int nvg__measureCreateTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data)
+{
+	NVG_NOTUSED(uptr); NVG_NOTUSED(type); NVG_NOTUSED(w); NVG_NOTUSED(h); NVG_NOTUSED(imageFlags); NVG_NOTUSED(data);
+	return 1;
+}
+
+static int nvg__measureDeleteTexture(void* uptr, int image)
+{
+	NVG_NOTUSED(uptr); NVG_NOTUSED(image);
+	return 1;
+}
+
+static int nvg__measureUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data)
+{
+	NVG_NOTUSED(uptr); NVG_NOTUSED(image); NVG_NOTUSED(x); NVG_NOTUSED(y); NVG_NOTUSED(w); NVG_NOTUSED(h); NVG_NOTUSED(data);
+	return 1;
+}
+
+static int nvg__measureGetTextureSize(void* uptr, int image, int* w, int* h)
+{
+	NVG_NOTUSED(uptr); NVG_NOTUSED(image);
+	*w = *h = NVG_FONT_PAGE_SIZE;
+	return 1;
+}
+
+NVGcontext* nvgCreateMeasureContext(NVGcontext* parent)
+{
+	NVGparams params;
+	NVGcontext* ctx;
+	memset(&params, 0, sizeof(params));
+	params.distanceFieldText = parent->params.distanceFieldText;
+	params.shaderTextBlur = parent->params.shaderTextBlur;
+	params.renderCreate = nvg__measureCreate;
+	params.renderCreateTexture = nvg__measureCreateTexture;
+	params.renderDeleteTexture = nvg__measureDeleteTexture;
+	params.renderUpdateTexture = nvg__measureUpdateTexture;
+	params.renderGetTextureSize = nvg__measureGetTextureSize;
+	ctx = nvgCreateInternal(&params);
+	if (ctx == NULL) return NULL;
+	// The stash made for the context has none of the fonts, and the handles must match the parent's.
+	fonsDeleteInternal(ctx->fs);
+	ctx->fs = fonsCreateShared(parent->fs);
+	if (ctx->fs == NULL) {
+		nvgDeleteInternal(ctx);
+		return NULL;
+	}
+	ctx->fontEpochs[0] = fonsPageEpoch(ctx->fs, 0);
+	ctx->measureParent = parent;
+	nvg__setDevicePixelRatio(ctx, parent->devicePxRatio);
+	return ctx;
+}
+
+int nvgUpdateMeasureContext(NVGcontext* ctx)
+{
+	NVGcontext* parent = ctx->measureParent;
+	if (parent == NULL) return 0;
+	if (ctx->devicePxRatio != parent->devicePxRatio)
+		nvg__setDevicePixelRatio(ctx, parent->devicePxRatio);
+	return fonsShareFonts(ctx->fs, parent->fs);
+}
+
+NVGcontext* nvgMeasureParent(NVGcontext* ctx)
+{
+	return ctx->measureParent != NULL ? ctx->measureParent : ctx;
+}
+
+void nvgDeleteMeasureContext(NVGcontext* ctx)
+{
+	nvgDeleteInternal(ctx);
+}
+
+struct NVGglyphJobs {
+	FONSglyphJob* jobs;
+	int count;
+};
+
+void nvgSetAsyncGlyphs(NVGcontext* ctx, int enabled)
+{
+	fonsSetAsyncGlyphs(ctx->fs, enabled);
+}
+
+NVGglyphJobs* nvgTakeGlyphJobs(NVGcontext* ctx)
+{
+	NVGglyphJobs* jobs;
+	int n = fonsPendingGlyphJobs(ctx->fs);
+
+	if (n <= 0) return NULL;
+	jobs = (NVGglyphJobs*)malloc(sizeof(NVGglyphJobs) + sizeof(FONSglyphJob)*n);
+	if (jobs == NULL) return NULL;
+	jobs->jobs = (FONSglyphJob*)(jobs + 1);
+	jobs->count = fonsTakeGlyphJobs(ctx->fs, jobs->jobs, n);
+	if (jobs->count == 0) {
+		free(jobs);
+		return NULL;
+	}
+	return jobs;
+}
+
+void nvgBuilderRasterizeGlyphJobs(NVGglyphBuilder* builder, NVGglyphJobs* jobs)
+{
+	int i;
+	for (i = 0; i < jobs->count; i++)
+		fonsRasterizeGlyphJob(builder->fs, &jobs->jobs[i]);
+}
+
+void nvgCompleteGlyphJobs(NVGcontext* ctx, NVGglyphJobs* jobs)
+{
+	int i;
+	if (jobs == NULL) return;
+	for (i = 0; i < jobs->count; i++)
+		fonsCompleteGlyphJob(ctx->fs, &jobs->jobs[i]);
+	free(jobs);
+	nvg__flushTextTexture(ctx);
+}
+
+int nvgPendingGlyphs(NVGcontext* ctx)
+{
+	return fonsPendingGlyphJobs(ctx->fs);
+}
+
+static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts, float scale, int page)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpaint paint = state->fill;
+
+	// Render triangles.
+	paint.image = ctx->fontImages[page];
+
+	if (ctx->params.distanceFieldText) {
+		// Field units per device pixel, the edge is smoothed over one pixel plus the blur on either side.
+		float px = FONS_SDF_SIZE / (state->fontSize*scale * 2.0f*FONS_SDF_SPREAD);
+		paint.feather = nvg__minf(px*0.5f + state->fontBlur*scale*px, 0.5f);
+	} else if (ctx->params.shaderTextBlur) {
+		// Glyphs are drawn a texel per device pixel.
+		paint.feather = state->fontBlur*scale;
+	}
+
+	// Apply global alpha
+	paint.innerColor.a *= state->alpha;
+	paint.outerColor.a *= state->alpha;
+
+	nvg__submitTriangles(ctx, &paint, &state->scissor, verts, nverts, 1);
+
+	ctx->drawCallCount++;
+	ctx->textTriCount += nverts/3;
+}
+
+static void nvg__unlinkTextRun(NVGcontext* ctx, int i)
+{
+	NVGtextRun* run = &ctx->textRuns[i];
+	if (run->prev != -1) ctx->textRuns[run->prev].lruNext = run->lruNext;
+	else ctx->textFirst = run->lruNext;
+	if (run->lruNext != -1) ctx->textRuns[run->lruNext].prev = run->prev;
+	else ctx->textLast = run->prev;
+}
+
+static void nvg__pushTextRun(NVGcontext* ctx, int i)
+{
+	NVGtextRun* run = &ctx->textRuns[i];
+	run->prev = -1;
+	run->lruNext = ctx->textFirst;
+	if (ctx->textFirst != -1) ctx->textRuns[ctx->textFirst].prev = i;
+	else ctx->textLast = i;
+	ctx->textFirst = i;
+}
+
+// Fills in the cache key of a string drawn at x,y (in font pixels) with the current font state,
+// returns 0 if the string is not worth caching.
+static int nvg__textKey(NVGstate* state, float scale, int kind, float x, float y,
+						const char* string, const char* end, NVGtextKey* key)
+{
+	const unsigned char* p;
+	unsigned int h = 2166136261u;
+	if (end - string > NVG_TEXT_CACHE_MAX_BYTES) return 0;
+	for (p = (const unsigned char*)string; p != (const unsigned char*)end; p++)
+		h = (h ^ *p) * 16777619u;
+	memset(key, 0, sizeof(*key));
+	key->hash = h;
+	key->kind = kind;
+	key->font = state->fontId;
+	key->align = state->textAlign;
+	key->nbytes = (int)(end - string);
+	key->size = state->fontSize*scale;
+	key->spacing = state->letterSpacing*scale;
+	key->blur = state->fontBlur*scale;
+	key->fx = x - floorf(x);
+	key->fy = y - floorf(y);
+	return 1;
+}
+
+// Returns the run cached for the key, or a run to fill in (generation -1) after evicting the
+// least recently used one. NULL when out of memory.
+static NVGtextRun* nvg__findTextRun(NVGcontext* ctx, const NVGtextKey* key, const char* string)
+{
+	NVGtextRun* run;
+	int i, *link, bucket = key->hash & (NVG_TEXT_CACHE_BUCKETS-1);
+
+	if (ctx->textRuns == NULL) {
+		ctx->textRuns = (NVGtextRun*)malloc(sizeof(NVGtextRun) * NVG_TEXT_CACHE_SIZE);
+		if (ctx->textRuns == NULL) return NULL;
+		memset(ctx->textRuns, 0, sizeof(NVGtextRun) * NVG_TEXT_CACHE_SIZE);
+		for (i = 0; i < NVG_TEXT_CACHE_BUCKETS; i++)
+			ctx->textBuckets[i] = -1;
+		ctx->ntextRuns = 0;
+		ctx->textFirst = ctx->textLast = -1;
+	}
+
+	for (i = ctx->textBuckets[bucket]; i != -1; i = run->next) {
+		run = &ctx->textRuns[i];
+		if (memcmp(&run->key, key, sizeof(*key)) == 0 && memcmp(run->string, string, key->nbytes) == 0) {
+			nvg__unlinkTextRun(ctx, i);
+			nvg__pushTextRun(ctx, i);
+			if (run->generation != ctx->atlasGeneration)
+				run->generation = -1;
+			return run;
+		}
+	}
+
+	if (ctx->ntextRuns < NVG_TEXT_CACHE_SIZE) {
+		i = ctx->ntextRuns++;
+	} else {
+		i = ctx->textLast;
+		run = &ctx->textRuns[i];
+		for (link = &ctx->textBuckets[run->key.hash & (NVG_TEXT_CACHE_BUCKETS-1)]; *link != i; link = &ctx->textRuns[*link].next);
+		*link = run->next;
+		nvg__unlinkTextRun(ctx, i);
+	}
+	run = &ctx->textRuns[i];
+	run->key = *key;
+	run->generation = -1;
+	run->nquads = 0;
+	run->next = ctx->textBuckets[bucket];
+	ctx->textBuckets[bucket] = i;
+	nvg__pushTextRun(ctx, i);
+	if (key->nbytes > run->cstring || run->string == NULL) {
+		char* str = (char*)realloc(run->string, nvg__maxi(key->nbytes, 32));
+		if (str == NULL) {
+			run->key.kind = 0;	// never matches, evicted like any other run
+			return NULL;
+		}
+		run->string = str;
+		run->cstring = nvg__maxi(key->nbytes, 32);
+	}
+	memcpy(run->string, string, key->nbytes);
+	return run;
+}
+
+// Maps the quads of a text or icon call to the view. Quads are offset by dx,dy and scaled by invscale
+// before the transform, which for axis aligned transforms folds into a scale and offset per lane of
+// the vertex, so that x, y, s and t of a corner are computed together.
+struct NVGquadXform {
+	const float* xform;
+	int kind;
+	float dx, dy, invscale;
+	float scale[4];
+	float offset[4];
+};
+typedef struct NVGquadXform NVGquadXform;
+
+static void nvg__quadXform(NVGquadXform* qx, const float* xform, int kind, float dx, float dy, float invscale)
+{
+	qx->xform = xform;
+	qx->kind = kind;
+	qx->dx = dx;
+	qx->dy = dy;
+	qx->invscale = invscale;
+	// A translation only leaves the font scale.
+	qx->scale[0] = kind == NVG_XFORM_TRANSLATE ? invscale : invscale*xform[0];
+	qx->scale[1] = kind == NVG_XFORM_TRANSLATE ? invscale : invscale*xform[3];
+	qx->scale[2] = qx->scale[3] = 1.0f;
+	qx->offset[0] = dx*qx->scale[0] + xform[4];
+	qx->offset[1] = dy*qx->scale[1] + xform[5];
+	qx->offset[2] = qx->offset[3] = 0.0f;
+}
+
+// Writes the six vertices of each of n quads.
+static void nvg__emitTextQuads(NVGvertex* verts, const NVGquadXform* qx, const FONSquad* quads, int n)
+{
+	const float* xform = qx->xform;
+	float c[4*2];
+	int i;
+	if (qx->kind != NVG_XFORM_GENERAL) {
+		// Axis aligned: the quad stays a rectangle, its two stored corners give all four.
+#ifdef NVG_SIMD
+		NVGv4 scale = nvg__v4load(qx->scale), offset = nvg__v4load(qx->offset);
+		for (i = 0; i < n; i++, verts += 6) {
+			NVGv4 v0 = nvg__v4add(nvg__v4mul(nvg__v4load(&quads[i].x0), scale), offset);	// x0 y0 s0 t0
+			NVGv4 v1 = nvg__v4add(nvg__v4mul(nvg__v4load(&quads[i].x1), scale), offset);	// x1 y1 s1 t1
+			nvg__v4store(&verts[0].x, v0);
+			nvg__v4store(&verts[1].x, v1);
+			nvg__v4store(&verts[2].x, nvg__v4evenodd(v1, v0));
+			nvg__v4store(&verts[3].x, v0);
+			nvg__v4store(&verts[4].x, nvg__v4evenodd(v0, v1));
+			nvg__v4store(&verts[5].x, v1);
+		}
+#else
+		for (i = 0; i < n; i++, verts += 6) {
+			const FONSquad* q = &quads[i];
+			float x0 = q->x0*qx->scale[0] + qx->offset[0];
+			float y0 = q->y0*qx->scale[1] + qx->offset[1];
+			float x1 = q->x1*qx->scale[0] + qx->offset[0];
+			float y1 = q->y1*qx->scale[1] + qx->offset[1];
+			nvg__vset(&verts[0], x0, y0, q->s0, q->t0);
+			nvg__vset(&verts[1], x1, y1, q->s1, q->t1);
+			nvg__vset(&verts[2], x1, y0, q->s1, q->t0);
+			nvg__vset(&verts[3], x0, y0, q->s0, q->t0);
+			nvg__vset(&verts[4], x0, y1, q->s0, q->t1);
+			nvg__vset(&verts[5], x1, y1, q->s1, q->t1);
+		}
+#endif
+		return;
+	}
+	for (i = 0; i < n; i++, verts += 6) {
+		const FONSquad* q = &quads[i];
+		float x0 = (q->x0 + qx->dx)*qx->invscale, y0 = (q->y0 + qx->dy)*qx->invscale;
+		float x1 = (q->x1 + qx->dx)*qx->invscale, y1 = (q->y1 + qx->dy)*qx->invscale;
+		// Transform corners.
+		nvgTransformPoint(&c[0],&c[1], xform, x0, y0);
+		nvgTransformPoint(&c[2],&c[3], xform, x1, y0);
+		nvgTransformPoint(&c[4],&c[5], xform, x1, y1);
+		nvgTransformPoint(&c[6],&c[7], xform, x0, y1);
+		// Create triangles
+		nvg__vset(&verts[0], c[0], c[1], q->s0, q->t0);
+		nvg__vset(&verts[1], c[4], c[5], q->s1, q->t1);
+		nvg__vset(&verts[2], c[2], c[3], q->s1, q->t0);
+		nvg__vset(&verts[3], c[0], c[1], q->s0, q->t0);
+		nvg__vset(&verts[4], c[6], c[7], q->s0, q->t1);
+		nvg__vset(&verts[5], c[4], c[5], q->s1, q->t1);
+	}
+}
+
+// Measure contexts have no atlas to draw glyphs from. Text drawn on one while it records keeps the string
+// and the font state in the lists, and is shaped by the context the lists are replayed on, which
+// rasterizes or queues the glyphs it misses. Returns the advance like drawing it would.
+static float nvg__recordText(NVGcontext* ctx, float x, float y, const char* string, const char* end, int codepoint)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float b[4], pts[8], width;
+	int i, j, n = codepoint < 0 ? (int)(end - string) : 0;
+
+	if (codepoint < 0)
+		width = nvgTextBounds(ctx, x, y, string, end, b);
+	else
+		width = nvgIconBounds(ctx, x, y, codepoint, b);
+	nvgTransformPoint(&pts[0], &pts[1], state->xform, b[0], b[1]);
+	nvgTransformPoint(&pts[2], &pts[3], state->xform, b[2], b[1]);
+	nvgTransformPoint(&pts[4], &pts[5], state->xform, b[2], b[3]);
+	nvgTransformPoint(&pts[6], &pts[7], state->xform, b[0], b[3]);
+
+	for (i = 0; i < ctx->ndrawLists; i++) {
+		NVGdrawList* list = ctx->drawLists[i];
+		NVGdrawText* text;
+		NVGdrawCmd* cmd;
+		if (!nvg__reserve((void**)&list->texts, &list->ctexts, list->ntexts+1, sizeof(NVGdrawText), 16) ||
+			!nvg__reserve((void**)&list->chars, &list->cchars, list->nchars+n, 1, 256)) {
+			list->failed = 1;
+			continue;
+		}
+		cmd = nvg__allocDrawCmd(list, NVG_DRAWCMD_TEXT, &state->fill, &state->scissor);
+		if (cmd == NULL) continue;
+		cmd->pathOffset = list->ntexts;
+		cmd->cullBounds[0] = cmd->cullBounds[1] = 1e6f;
+		cmd->cullBounds[2] = cmd->cullBounds[3] = -1e6f;
+		for (j = 0; j < 4; j++) {
+			cmd->cullBounds[0] = nvg__minf(cmd->cullBounds[0], pts[j*2]);
+			cmd->cullBounds[1] = nvg__minf(cmd->cullBounds[1], pts[j*2+1]);
+			cmd->cullBounds[2] = nvg__maxf(cmd->cullBounds[2], pts[j*2]);
+			cmd->cullBounds[3] = nvg__maxf(cmd->cullBounds[3], pts[j*2+1]);
+		}
+		text = &list->texts[list->ntexts++];
+		text->x = x;
+		text->y = y;
+		memcpy(text->xform, state->xform, sizeof(float)*6);
+		text->alpha = state->alpha;
+		text->fontSize = state->fontSize;
+		text->letterSpacing = state->letterSpacing;
+		text->fontBlur = state->fontBlur;
+		text->textAlign = state->textAlign;
+		text->fontId = state->fontId;
+		text->codepoint = codepoint;
+		text->charOffset = list->nchars;
+		text->nchars = n;
+		if (n > 0) memcpy(&list->chars[list->nchars], string, n);
+		list->nchars += n;
+	}
+
+	if (codepoint >= 0 || (state->textAlign & NVG_ALIGN_RIGHT))
+		return codepoint >= 0 ? x + width : x;
+	if (state->textAlign & NVG_ALIGN_CENTER)
+		return x + width*0.5f;
+	return x + width;
+}
+
+static float nvg__text(NVGcontext* ctx, float x, float y, const char* string, const char* end)
+{
+	NVGstate* state = nvg__getState(ctx);
+	FONStextIter iter;
+	FONSquad q;
+	NVGvertex* verts;
+	NVGtess tess;
+	NVGtextKey key;
+	NVGtextRun* run = NULL;
+	NVGquadXform qx;
+	FONSquad batch[NVG_TEXT_BATCH];
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float invscale = 1.0f / scale;
+	float bx = floorf(x*scale), by = floorf(y*scale);
+	int generation = ctx->atlasGeneration;
 	int cverts = 0;
 	int nverts = 0;
+	int nbatch = 0;
+	int page = -1, first = 0;
+	int i;
 
 	if (end == NULL)
 		end = string + strlen(string);
 
 	if (state->fontId == FONS_INVALID) return x;
+	if (ctx->measureParent != NULL && ctx->ndrawLists > 0)
+		return nvg__recordText(ctx, x, y, string, end, -1);
+
+	if (nvg__textKey(state, scale, NVG_TEXTRUN_QUADS, x*scale, y*scale, string, end, &key))
+		run = nvg__findTextRun(ctx, &key, string);
+	if (run != NULL && run->generation != -1) {
+		if (run->qminx + bx > 0.0f && run->qminy + by > 0.0f) {
+			ctx->textCacheHits++;
+			nvg__beginTess(ctx, &tess, ctx->cache, NULL, 0);
+			verts = nvg__allocTempVerts(&tess, run->nquads*6);
+			nvg__endTess(ctx, &tess);
+			if (verts == NULL) return x;
+			nvg__quadXform(&qx, state->xform, state->xformKind, bx, by, invscale);
+			nvg__emitTextQuads(verts, &qx, run->quads, run->nquads);
+			// One call per stretch of glyphs sharing an atlas page.
+			for (i = first = 0; i < run->nquads; i++) {
+				if (i+1 == run->nquads || run->quads[i+1].page != run->quads[first].page) {
+					nvg__renderText(ctx, &verts[first*6], (i+1 - first)*6, scale, run->quads[first].page);
+					first = i+1;
+				}
+			}
+			if (run->nquads == 0)
+				nvg__renderText(ctx, verts, 0, scale, 0);
+			return run->x + bx;
+		}
+		run = NULL;	// fontstash rounds negative positions differently, shape it in place
+	}
+	if (run != NULL) {
+		ctx->textCacheMisses++;
+		if (run->cquads < (int)(end - string)) {
+			int cquads = nvg__maxi((int)(end - string), 16);
+			FONSquad* quads = (FONSquad*)realloc(run->quads, sizeof(FONSquad) * cquads);
+			if (quads != NULL) {
+				run->quads = quads;
+				run->cquads = cquads;
+			} else {
+				run = NULL;
+			}
+		}
+		if (run != NULL) {
+			run->nquads = 0;
+			run->qminx = run->qminy = 0.0f;
+		}
+	}
 
 	fonsSetSize(ctx->fs, state->fontSize*scale);
 	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
@@ -2307,50 +7052,98 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 	fonsSetFont(ctx->fs, state->fontId);
 
 	cverts = nvg__maxi(2, (int)(end - string)) * 6; // conservative estimate.
-	verts = nvg__allocTempVerts(ctx, cverts);
+	nvg__beginTess(ctx, &tess, ctx->cache, NULL, 0);
+	verts = nvg__allocTempVerts(&tess, cverts);
+	nvg__endTess(ctx, &tess);
 	if (verts == NULL) return x;
 
+	// The quads are gathered and their vertices written a batch at a time, the last nbatch*6
+	// vertices are not written yet.
+	nvg__quadXform(&qx, state->xform, state->xformKind, 0.0f, 0.0f, invscale);
 	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		float c[4*2];
-		if (iter.prevGlyphIndex == -1) { // can not retrieve glyph?
-			if (!nvg__allocTextAtlas(ctx))
-				break; // no memory :(
-			if (nverts != 0) {
-				nvg__renderText(ctx, verts, nverts);
-				nverts = 0;
-			}
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-			if (iter.prevGlyphIndex == -1) // still can not find glyph?
-				break;
+		if (iter.prevGlyphIndex == -1) // can not retrieve glyph?
+			break;
+		// Glyphs from another page, or landing in a page that was just evicted, start a new call.
+		if (q.page != page || ctx->fontEpochs[page] != fonsPageEpoch(ctx->fs, page)) {
+			nvg__emitTextQuads(&verts[nverts - nbatch*6], &qx, batch, nbatch);
+			nbatch = 0;
+			if (nverts > first)
+				nvg__renderText(ctx, &verts[first], nverts - first, scale, page);
+			nvg__syncFontPages(ctx);
+			page = q.page;
+			first = nverts;
 		}
-		prevIter = iter;
-		// Transform corners.
-		nvgTransformPoint(&c[0],&c[1], state->xform, q.x0*invscale, q.y0*invscale);
-		nvgTransformPoint(&c[2],&c[3], state->xform, q.x1*invscale, q.y0*invscale);
-		nvgTransformPoint(&c[4],&c[5], state->xform, q.x1*invscale, q.y1*invscale);
-		nvgTransformPoint(&c[6],&c[7], state->xform, q.x0*invscale, q.y1*invscale);
-		// Create triangles
 		if (nverts+6 <= cverts) {
-			nvg__vset(&verts[nverts], c[0], c[1], q.s0, q.t0); nverts++;
-			nvg__vset(&verts[nverts], c[4], c[5], q.s1, q.t1); nverts++;
-			nvg__vset(&verts[nverts], c[2], c[3], q.s1, q.t0); nverts++;
-			nvg__vset(&verts[nverts], c[0], c[1], q.s0, q.t0); nverts++;
-			nvg__vset(&verts[nverts], c[6], c[7], q.s0, q.t1); nverts++;
-			nvg__vset(&verts[nverts], c[4], c[5], q.s1, q.t1); nverts++;
+			batch[nbatch++] = q;
+			nverts += 6;
+			if (nbatch == NVG_TEXT_BATCH) {
+				nvg__emitTextQuads(&verts[nverts - nbatch*6], &qx, batch, nbatch);
+				nbatch = 0;
+			}
+			// Keep the quads relative to the integer origin, the fraction is part of the key.
+			if (run != NULL && run->nquads < run->cquads) {
+				FONSquad* rq = &run->quads[run->nquads++];
+				*rq = q;
+				rq->x0 -= bx; rq->x1 -= bx;
+				rq->y0 -= by; rq->y1 -= by;
+				run->qminx = nvg__minf(run->qminx, rq->x0);
+				run->qminy = nvg__minf(run->qminy, rq->y0);
+			}
 		}
 	}
 
+	nvg__emitTextQuads(&verts[nverts - nbatch*6], &qx, batch, nbatch);
+
 	// TODO: add back-end bit to do this just once per frame. 
 	nvg__flushTextTexture(ctx);
 
-	nvg__renderText(ctx, verts, nverts);
+	// Runs that saw a page evicted or were drawn partly at negative positions are shaped again next time.
+	if (run != NULL && generation == ctx->atlasGeneration && iter.next == end &&
+		run->qminx + bx > 0.0f && run->qminy + by > 0.0f) {
+		run->x = iter.x - bx;
+		run->generation = generation;
+	}
+
+	nvg__renderText(ctx, &verts[first], nverts - first, scale, nvg__maxi(page, 0));
 
 	return iter.x;
 }
 
+static void nvg__replayText(NVGcontext* ctx, NVGdrawList* list, NVGdrawCmd* cmd, NVGscissor* scissor)
+{
+	NVGdrawText* text = &list->texts[cmd->pathOffset];
+	NVGstate* state;
+	nvgSave(ctx);
+	state = nvg__editState(ctx, NVG_STATE_FILL | NVG_STATE_STYLE | NVG_STATE_XFORM | NVG_STATE_SCISSOR | NVG_STATE_TEXT);
+	state->fill = cmd->paint;
+	state->alpha = text->alpha;
+	memcpy(state->xform, text->xform, sizeof(float)*6);
+	state->xformKind = nvg__xformKind(state->xform);
+	state->scissor = *scissor;
+	state->fontSize = text->fontSize;
+	state->letterSpacing = text->letterSpacing;
+	state->fontBlur = text->fontBlur;
+	state->textAlign = text->textAlign;
+	state->fontId = text->fontId;
+	if (text->codepoint >= 0)
+		nvgIcon(ctx, text->x, text->y, text->codepoint);
+	else if (text->nchars > 0)
+		nvg__text(ctx, text->x, text->y, &list->chars[text->charOffset], &list->chars[text->charOffset + text->nchars]);
+	nvgRestore(ctx);
+}
+
+float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
+{
+	float ret;
+	nvg__beginProfile(ctx, "nvgText");
+	if (nvg__capturing(ctx))
+		nvg__captureText(ctx, x, y, string, end);
+	ret = nvg__text(ctx, x, y, string, end);
+	nvg__endProfile(ctx);
+	return ret;
+}
+
 void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2384,12 +7177,161 @@ void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const ch
 	state->textAlign = oldAlign;
 }
 
+static int nvg__encodeUtf8(unsigned int c, char* s)
+{
+	if (c < 0x80) { s[0] = (char)c; return 1; }
+	if (c < 0x800) { s[0] = (char)(0xc0 | (c >> 6)); s[1] = (char)(0x80 | (c & 0x3f)); return 2; }
+	if (c < 0x10000) {
+		s[0] = (char)(0xe0 | (c >> 12)); s[1] = (char)(0x80 | ((c >> 6) & 0x3f));
+		s[2] = (char)(0x80 | (c & 0x3f));
+		return 3;
+	}
+	s[0] = (char)(0xf0 | ((c >> 18) & 0x07)); s[1] = (char)(0x80 | ((c >> 12) & 0x3f));
+	s[2] = (char)(0x80 | ((c >> 6) & 0x3f)); s[3] = (char)(0x80 | (c & 0x3f));
+	return 4;
+}
+
+// Returns the icon cached for the font state and codepoint, resolving it with fontstash when it is
+// missing or its atlas page was evicted. Leaves fontstash set up for the state. NULL when out of memory.
+static NVGicon* nvg__findIcon(NVGcontext* ctx, NVGstate* state, float scale, int codepoint)
+{
+	NVGicon* icon;
+	FONStextIter iter;
+	FONSquad q;
+	float b[4];
+	char str[4];
+	int n;
+	float size = state->fontSize*scale, blur = state->fontBlur*scale;
+	unsigned int h = (unsigned int)codepoint * 2654435761u;
+	h ^= (unsigned int)state->fontId * 40503u + (unsigned int)(size * 4.0f) * 97u + (unsigned int)state->textAlign * 31u;
+
+	if (ctx->icons == NULL) {
+		ctx->icons = (NVGicon*)malloc(sizeof(NVGicon) * NVG_ICON_CACHE_SIZE);
+		if (ctx->icons == NULL) return NULL;
+		memset(ctx->icons, 0, sizeof(NVGicon) * NVG_ICON_CACHE_SIZE);
+		for (n = 0; n < NVG_ICON_CACHE_SIZE; n++)
+			ctx->icons[n].generation = -1;
+	}
+	icon = &ctx->icons[h & (NVG_ICON_CACHE_SIZE-1)];
+
+	fonsSetSize(ctx->fs, size);
+	fonsSetSpacing(ctx->fs, 0.0f);
+	fonsSetBlur(ctx->fs, blur);
+	fonsSetFont(ctx->fs, state->fontId);
+	if (icon->generation == ctx->atlasGeneration && icon->font == state->fontId && icon->codepoint == codepoint &&
+		icon->align == state->textAlign && icon->size == size && icon->blur == blur &&
+		(!icon->hasQuad || ctx->fontEpochs[icon->quad.page] == fonsPageEpoch(ctx->fs, icon->quad.page))) {
+		ctx->textCacheHits++;
+		fonsSetAlign(ctx->fs, state->textAlign);
+		return icon;
+	}
+
+	// Collisions simply replace the slot.
+	ctx->textCacheMisses++;
+	icon->font = state->fontId;
+	icon->codepoint = codepoint;
+	icon->align = state->textAlign;
+	icon->size = size;
+	icon->blur = blur;
+	icon->hasQuad = 0;
+	icon->generation = -1;
+	n = nvg__encodeUtf8((unsigned int)codepoint, str);
+
+	// Measured left aligned like nvgTextBounds(), the alignment is applied when measuring.
+	fonsSetAlign(ctx->fs, (state->textAlign & ~(NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT)) | NVG_ALIGN_LEFT);
+	icon->advance = fonsTextBounds(ctx->fs, NVG_ICON_ORIGIN, NVG_ICON_ORIGIN, str, str + n, b);
+	icon->minx = b[0] - NVG_ICON_ORIGIN;
+	icon->maxx = b[2] - NVG_ICON_ORIGIN;
+	fonsSetAlign(ctx->fs, state->textAlign);
+	fonsLineBounds(ctx->fs, 0.0f, &icon->miny, &icon->maxy);
+
+	fonsTextIterInit(ctx->fs, &iter, NVG_ICON_ORIGIN, NVG_ICON_ORIGIN, str, str + n);
+	if (fonsTextIterNext(ctx->fs, &iter, &q) && iter.prevGlyphIndex != -1) {
+		q.x0 -= NVG_ICON_ORIGIN; q.x1 -= NVG_ICON_ORIGIN;
+		q.y0 -= NVG_ICON_ORIGIN; q.y1 -= NVG_ICON_ORIGIN;
+		icon->quad = q;
+		icon->hasQuad = q.x1 > q.x0 && q.y1 > q.y0;
+	}
+	// A new glyph may have evicted a page, which moves the generation on.
+	nvg__flushTextTexture(ctx);
+	icon->generation = ctx->atlasGeneration;
+	return icon;
+}
+
+float nvgIcon(NVGcontext* ctx, float x, float y, int codepoint)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float invscale = 1.0f / scale;
+	float bx = floorf(x*scale), by = floorf(y*scale);
+	NVGicon* icon;
+	NVGvertex* verts;
+	NVGtess tess;
+	float advance;
+
+	if (state->fontId == FONS_INVALID) return x;
+	if (ctx->measureParent != NULL && ctx->ndrawLists > 0)
+		return nvg__recordText(ctx, x, y, NULL, NULL, codepoint);
+	nvg__beginProfile(ctx, "nvgIcon");
+	if (nvg__capturing(ctx))
+		nvg__captureIcon(ctx, x, y, codepoint);
+	icon = nvg__findIcon(ctx, state, scale, codepoint);
+	if (icon == NULL || !icon->hasQuad) {
+		nvg__endProfile(ctx);
+		return icon == NULL ? x : x + icon->advance*invscale;
+	}
+	nvg__beginTess(ctx, &tess, ctx->cache, NULL, 0);
+	verts = nvg__allocTempVerts(&tess, 6);
+	nvg__endTess(ctx, &tess);
+	if (verts != NULL) {
+		NVGquadXform qx;
+		nvg__quadXform(&qx, state->xform, state->xformKind, bx, by, invscale);
+		nvg__emitTextQuads(verts, &qx, &icon->quad, 1);
+		nvg__renderText(ctx, verts, 6, scale, icon->quad.page);
+	}
+	advance = icon->advance;
+	nvg__endProfile(ctx);
+	return x + advance*invscale;
+}
+
+float nvgIconBounds(NVGcontext* ctx, float x, float y, int codepoint, float* bounds)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float invscale = 1.0f / scale;
+	float minx, maxx, width;
+	NVGicon* icon;
+
+	if (state->fontId == FONS_INVALID) return 0;
+	icon = nvg__findIcon(ctx, state, scale, codepoint);
+	if (icon == NULL) return 0;
+	width = icon->advance;
+	if (bounds != NULL) {
+		minx = icon->minx + x*scale;
+		maxx = icon->maxx + x*scale;
+		if (state->textAlign & NVG_ALIGN_LEFT) {
+			// empty
+		} else if (state->textAlign & NVG_ALIGN_RIGHT) {
+			minx -= width;
+			maxx -= width;
+		} else if (state->textAlign & NVG_ALIGN_CENTER) {
+			minx -= width * 0.5f;
+			maxx -= width * 0.5f;
+		}
+		bounds[0] = minx * invscale;
+		bounds[1] = (icon->miny + y*scale) * invscale;
+		bounds[2] = maxx * invscale;
+		bounds[3] = (icon->maxy + y*scale) * invscale;
+	}
+	return width * invscale;
+}
+
 int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string, const char* end, NVGglyphPosition* positions, int maxPositions)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	int npos = 0;
 
@@ -2408,13 +7350,7 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	fonsSetFont(ctx->fs, state->fontId);
 
 	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		positions[npos].str = iter.str;
 		positions[npos].x = iter.x * invscale;
 		positions[npos].minx = nvg__minf(iter.x, q.x0) * invscale;
@@ -2433,12 +7369,14 @@ enum NVGcodepointType {
 	NVG_CHAR,
 };
 
-int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
+// pcodepoint is the codepoint before string, so a row broken after a \r of a \r\n pair skips its \n.
+static int nvg__breakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows,
+						   unsigned int pcodepoint)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	int nrows = 0;
 	float rowStartX = 0;
@@ -2454,7 +7392,6 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	float breakWidth = 0;
 	float breakMaxX = 0;
 	int type = NVG_SPACE, ptype = NVG_SPACE;
-	unsigned int pcodepoint = 0;
 
 	if (maxRows == 0) return 0;
 	if (state->fontId == FONS_INVALID) return 0;
@@ -2473,13 +7410,7 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	breakRowWidth *= scale;
 
 	fonsTextIterInit(ctx->fs, &iter, 0, 0, string, end);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		switch (iter.codepoint) {
 			case 9:			// \t
 			case 11:		// \v
@@ -2597,11 +7528,12 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 						nrows++;
 						if (nrows >= maxRows)
 							return nrows;
+						// wordMinX is relative to the old row start.
+						rowMinX = wordMinX - (wordStartX - rowStartX);
 						rowStartX = wordStartX;
 						rowStart = wordStart;
 						rowEnd = iter.next;
 						rowWidth = iter.nextx - rowStartX;
-						rowMinX = wordMinX;
 						rowMaxX = q.x1 - rowStartX;
 						// No change to the word start
 					}
@@ -2631,22 +7563,406 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	return nrows;
 }
 
+int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
+{
+	return nvg__breakLines(ctx, string, end, breakRowWidth, rows, maxRows, 0);
+}
+
+typedef struct NVGparagraphGlyph {
+	int offset;			// from the row start
+	float x, minx, maxx;
+} NVGparagraphGlyph;
+
+typedef struct NVGparagraphRow {
+	int start, end, next;	// byte offsets into the paragraph text
+	float width, minx, maxx;
+	NVGparagraphGlyph* glyphs;	// measured on first use, relative to the row start
+	int nglyphs;
+} NVGparagraphRow;
+
+struct NVGparagraph {
+	char* text;
+	int ntext, ctext;
+	// Text style and wrap width the rows were laid out with.
+	int fontId;
+	float fontSize, letterSpacing, scale, breakRowWidth;
+	NVGparagraphRow* rows;
+	int nrows, crows;
+	NVGparagraphRow* tail;	// rows after the edit point, while reflowing
+	int ctail;
+	NVGtextRow* textRows;	// rows handed out by nvgParagraphRows()
+	int ctextRows;
+	int reflowed;			// rows laid out by the last nvgParagraphLayout()
+};
+
+NVGparagraph* nvgCreateParagraph(void)
+{
+	NVGparagraph* para = (NVGparagraph*)malloc(sizeof(NVGparagraph));
+	if (para == NULL) return NULL;
+	memset(para, 0, sizeof(NVGparagraph));
+	para->fontId = FONS_INVALID;
+	return para;
+}
+
+static void nvg__freeParagraphRows(NVGparagraphRow* rows, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+		free(rows[i].glyphs);
+}
+
+void nvgDeleteParagraph(NVGparagraph* para)
+{
+	if (para == NULL) return;
+	nvg__freeParagraphRows(para->rows, para->nrows);
+	free(para->rows);
+	free(para->tail);
+	free(para->textRows);
+	free(para->text);
+	free(para);
+}
+
+static int nvg__appendParagraphRow(NVGparagraph* para, const NVGparagraphRow* row)
+{
+	if (para->nrows + 1 > para->crows) {
+		int crows = nvg__maxi(para->nrows + 1, 16) + para->crows / 2;
+		NVGparagraphRow* rows = (NVGparagraphRow*)realloc(para->rows, sizeof(NVGparagraphRow) * crows);
+		if (rows == NULL) return 0;
+		para->rows = rows;
+		para->crows = crows;
+	}
+	para->rows[para->nrows++] = *row;
+	return 1;
+}
+
+// A row broken on its own after a \r or \n has to know it, so that \r\n and \n\r end one row.
+static unsigned int nvg__paragraphPrevCodepoint(const NVGparagraph* para, int pos)
+{
+	unsigned char c = pos > 0 ? (unsigned char)para->text[pos - 1] : 0;
+	return c == 10 || c == 13 ? c : 0;
+}
+
+int nvgParagraphLayout(NVGcontext* ctx, NVGparagraph* para, const char* string, const char* end, float breakRowWidth)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	int n, i, same, prefix = 0, suffix = 0, restart = 0, ntail = 0, j = 0, pos, delta;
+
+	if (end == NULL)
+		end = string + strlen(string);
+	n = (int)(end - string);
+	para->reflowed = 0;
+	same = para->fontId == state->fontId && para->fontSize == state->fontSize &&
+		para->letterSpacing == state->letterSpacing && para->scale == scale && para->breakRowWidth == breakRowWidth;
+	if (same && n == para->ntext && memcmp(para->text, string, n) == 0)
+		return para->nrows;
+
+	if (same) {
+		int m = nvg__mini(n, para->ntext);
+		while (prefix < m && para->text[prefix] == string[prefix])
+			prefix++;
+		while (suffix < m - prefix && para->text[para->ntext - 1 - suffix] == string[n - 1 - suffix])
+			suffix++;
+		// The row before the edited one may take up the start of an edited word.
+		while (restart < para->nrows && para->rows[restart].next <= prefix)
+			restart++;
+		restart = nvg__maxi(restart - 1, 0);
+	}
+
+	// Set aside the rows from the restart on, the ones past the edit can be reused.
+	ntail = para->nrows - restart;
+	if (ntail > para->ctail) {
+		NVGparagraphRow* tail = (NVGparagraphRow*)realloc(para->tail, sizeof(NVGparagraphRow) * ntail);
+		if (tail == NULL) {
+			nvg__freeParagraphRows(para->rows + restart, ntail);
+			ntail = 0;
+		} else {
+			para->tail = tail;
+			para->ctail = ntail;
+		}
+	}
+	if (ntail > 0)
+		memcpy(para->tail, para->rows + restart, sizeof(NVGparagraphRow) * ntail);
+	para->nrows = restart;
+	delta = n - para->ntext;
+
+	if (n > para->ctext) {
+		int ctext = n + para->ctext / 2;
+		char* text = (char*)realloc(para->text, ctext);
+		if (text == NULL) {
+			nvg__freeParagraphRows(para->rows, para->nrows);
+			nvg__freeParagraphRows(para->tail, ntail);
+			para->nrows = para->ntext = 0;
+			para->fontId = FONS_INVALID;
+			return 0;
+		}
+		para->text = text;
+		para->ctext = ctext;
+	}
+	memcpy(para->text, string, n);
+	para->ntext = n;
+	para->fontId = state->fontId;
+	para->fontSize = state->fontSize;
+	para->letterSpacing = state->letterSpacing;
+	para->scale = scale;
+	para->breakRowWidth = breakRowWidth;
+	if (state->fontId == FONS_INVALID) {
+		nvg__freeParagraphRows(para->tail, ntail);
+		return 0;
+	}
+
+	pos = restart > 0 ? para->rows[restart - 1].next : 0;
+	for (;;) {
+		NVGtextRow row;
+		NVGparagraphRow prow;
+		// Past the edit every row is broken as before, once a row starts where an old one did.
+		if (pos > n - suffix) {
+			int old = pos - delta;
+			while (j < ntail && (j > 0 ? para->tail[j - 1].next : para->tail[0].start) < old)
+				j++;
+			if (j < ntail && j > 0 && para->tail[j - 1].next == old) {
+				for (i = j; i < ntail; i++) {
+					prow = para->tail[i];
+					prow.start += delta;
+					prow.end += delta;
+					prow.next += delta;
+					if (!nvg__appendParagraphRow(para, &prow))
+						free(prow.glyphs);
+				}
+				nvg__freeParagraphRows(para->tail, j);
+				ntail = 0;
+				break;
+			}
+		}
+		if (nvg__breakLines(ctx, para->text + pos, para->text + n, breakRowWidth, &row, 1,
+							nvg__paragraphPrevCodepoint(para, pos)) == 0)
+			break;
+		prow.start = (int)(row.start - para->text);
+		prow.end = (int)(row.end - para->text);
+		prow.next = (int)(row.next - para->text);
+		prow.width = row.width;
+		prow.minx = row.minx;
+		prow.maxx = row.maxx;
+		prow.glyphs = NULL;
+		prow.nglyphs = 0;
+		if (prow.next <= pos || !nvg__appendParagraphRow(para, &prow))
+			break;
+		para->reflowed++;
+		pos = prow.next;
+	}
+	nvg__freeParagraphRows(para->tail, ntail);
+	return para->nrows;
+}
+
+const NVGtextRow* nvgParagraphRows(NVGparagraph* para, int* nrows)
+{
+	int i;
+	if (para->nrows > para->ctextRows) {
+		NVGtextRow* rows = (NVGtextRow*)realloc(para->textRows, sizeof(NVGtextRow) * para->nrows);
+		if (rows == NULL) {
+			if (nrows != NULL) *nrows = 0;
+			return NULL;
+		}
+		para->textRows = rows;
+		para->ctextRows = para->nrows;
+	}
+	for (i = 0; i < para->nrows; i++) {
+		const NVGparagraphRow* prow = &para->rows[i];
+		NVGtextRow* row = &para->textRows[i];
+		row->start = para->text + prow->start;
+		row->end = para->text + prow->end;
+		row->next = para->text + prow->next;
+		row->width = prow->width;
+		row->minx = prow->minx;
+		row->maxx = prow->maxx;
+	}
+	if (nrows != NULL) *nrows = para->nrows;
+	return para->textRows;
+}
+
+int nvgParagraphGlyphPositions(NVGcontext* ctx, NVGparagraph* para, int row, float x, NVGglyphPosition* positions, int maxPositions)
+{
+	NVGparagraphRow* prow;
+	int i, n;
+
+	if (row < 0 || row >= para->nrows) return 0;
+	prow = &para->rows[row];
+	if (prow->glyphs == NULL && prow->end > prow->start) {
+		int size = prow->end - prow->start;
+		NVGglyphPosition* measured = (NVGglyphPosition*)malloc(sizeof(NVGglyphPosition) * size);
+		prow->glyphs = (NVGparagraphGlyph*)malloc(sizeof(NVGparagraphGlyph) * size);
+		if (measured == NULL || prow->glyphs == NULL) {
+			free(measured);
+			free(prow->glyphs);
+			prow->glyphs = NULL;
+			return 0;
+		}
+		prow->nglyphs = nvgTextGlyphPositions(ctx, 0, 0, para->text + prow->start, para->text + prow->end, measured, size);
+		for (i = 0; i < prow->nglyphs; i++) {
+			prow->glyphs[i].offset = (int)(measured[i].str - para->text) - prow->start;
+			prow->glyphs[i].x = measured[i].x;
+			prow->glyphs[i].minx = measured[i].minx;
+			prow->glyphs[i].maxx = measured[i].maxx;
+		}
+		free(measured);
+	}
+	n = nvg__mini(prow->nglyphs, maxPositions);
+	for (i = 0; i < n; i++) {
+		positions[i].str = para->text + prow->start + prow->glyphs[i].offset;
+		positions[i].x = x + prow->glyphs[i].x;
+		positions[i].minx = x + prow->glyphs[i].minx;
+		positions[i].maxx = x + prow->glyphs[i].maxx;
+	}
+	return n;
+}
+
+void nvgParagraphDraw(NVGcontext* ctx, NVGparagraph* para, float x, float y)
+{
+	NVGstate* state = nvg__getState(ctx);
+	int i;
+	int oldAlign = state->textAlign;
+	int haling = state->textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
+	int valign = state->textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
+	float lineh = 0;
+
+	if (state->fontId == FONS_INVALID) return;
+
+	nvgTextMetrics(ctx, NULL, NULL, &lineh);
+
+	state->textAlign = NVG_ALIGN_LEFT | valign;
+
+	for (i = 0; i < para->nrows; i++) {
+		const NVGparagraphRow* row = &para->rows[i];
+		const char* start = para->text + row->start;
+		const char* end = para->text + row->end;
+		if (haling & NVG_ALIGN_LEFT)
+			nvgText(ctx, x, y, start, end);
+		else if (haling & NVG_ALIGN_CENTER)
+			nvgText(ctx, x + para->breakRowWidth*0.5f - row->width*0.5f, y, start, end);
+		else if (haling & NVG_ALIGN_RIGHT)
+			nvgText(ctx, x + para->breakRowWidth - row->width, y, start, end);
+		y += lineh * state->lineHeight;
+	}
+
+	state->textAlign = oldAlign;
+}
+
+void nvgParagraphBounds(NVGcontext* ctx, NVGparagraph* para, float x, float y, float* bounds)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float invscale = 1.0f / scale;
+	int i;
+	int haling = state->textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
+	int valign = state->textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
+	float lineh = 0, rminy = 0, rmaxy = 0;
+	float minx, miny, maxx, maxy;
+
+	if (state->fontId == FONS_INVALID) {
+		if (bounds != NULL)
+			bounds[0] = bounds[1] = bounds[2] = bounds[3] = 0.0f;
+		return;
+	}
+
+	nvgTextMetrics(ctx, NULL, NULL, &lineh);
+
+	minx = maxx = x;
+	miny = maxy = y;
+
+	fonsSetSize(ctx->fs, state->fontSize*scale);
+	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
+	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetAlign(ctx->fs, NVG_ALIGN_LEFT | valign);
+	fonsSetFont(ctx->fs, state->fontId);
+	fonsLineBounds(ctx->fs, 0, &rminy, &rmaxy);
+	rminy *= invscale;
+	rmaxy *= invscale;
+
+	for (i = 0; i < para->nrows; i++) {
+		const NVGparagraphRow* row = &para->rows[i];
+		float dx = 0;
+		// Horizontal bounds
+		if (haling & NVG_ALIGN_LEFT)
+			dx = 0;
+		else if (haling & NVG_ALIGN_CENTER)
+			dx = para->breakRowWidth*0.5f - row->width*0.5f;
+		else if (haling & NVG_ALIGN_RIGHT)
+			dx = para->breakRowWidth - row->width;
+		minx = nvg__minf(minx, x + row->minx + dx);
+		maxx = nvg__maxf(maxx, x + row->maxx + dx);
+		// Vertical bounds.
+		miny = nvg__minf(miny, y + rminy);
+		maxy = nvg__maxf(maxy, y + rmaxy);
+		y += lineh * state->lineHeight;
+	}
+
+	if (bounds != NULL) {
+		bounds[0] = minx;
+		bounds[1] = miny;
+		bounds[2] = maxx;
+		bounds[3] = maxy;
+	}
+}
+
 float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const char* end, float* bounds)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	float width;
+	float width, bx = floorf(x*scale);
+	NVGtextKey key;
+	NVGtextRun* run = NULL;
 
 	if (state->fontId == FONS_INVALID) return 0;
 
+	if (end == NULL)
+		end = string + strlen(string);
+	// Only the horizontal bounds come from the glyphs, the key ignores y.
+	if (nvg__textKey(state, scale, NVG_TEXTRUN_BOUNDS, x*scale, 0.0f, string, end, &key))
+		run = nvg__findTextRun(ctx, &key, string);
+
 	fonsSetSize(ctx->fs, state->fontSize*scale);
 	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
 	fonsSetBlur(ctx->fs, state->fontBlur*scale);
-	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 
-	width = fonsTextBounds(ctx->fs, x*scale, y*scale, string, end, bounds);
+	if (run != NULL && run->generation == -1) {
+		// Measure left aligned, the alignment is applied below the same way fontstash does.
+		float b[4];
+		ctx->textCacheMisses++;
+		fonsSetAlign(ctx->fs, (state->textAlign & ~(NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT)) | NVG_ALIGN_LEFT);
+		run->x = fonsTextBounds(ctx->fs, x*scale, y*scale, string, end, b);
+		run->minx = b[0] - bx;
+		run->maxx = b[2] - bx;
+		if (run->minx + bx > 0.0f)
+			run->generation = ctx->atlasGeneration;
+	} else if (run != NULL) {
+		if (run->minx + bx > 0.0f)
+			ctx->textCacheHits++;
+		else
+			run = NULL;	// fontstash rounds negative positions differently, measure it in place
+	}
+	fonsSetAlign(ctx->fs, state->textAlign);
+
+	if (run != NULL) {
+		float minx = run->minx + bx, maxx = run->maxx + bx;
+		width = run->x;
+		if (state->textAlign & NVG_ALIGN_LEFT) {
+			// empty
+		} else if (state->textAlign & NVG_ALIGN_RIGHT) {
+			minx -= width;
+			maxx -= width;
+		} else if (state->textAlign & NVG_ALIGN_CENTER) {
+			minx -= width * 0.5f;
+			maxx -= width * 0.5f;
+		}
+		if (bounds != NULL) {
+			bounds[0] = minx;
+			bounds[2] = maxx;
+		}
+	} else {
+		width = fonsTextBounds(ctx->fs, x*scale, y*scale, string, end, bounds);
+	}
 	if (bounds != NULL) {
 		// Use line bounds for height.
 		fonsLineBounds(ctx->fs, y*scale, &bounds[1], &bounds[3]);
@@ -54,9 +54,27 @@ struct NVGpaint
    NVGcolor innerColor;
    NVGcolor outerColor;
    int image;
+   int ramp;		// NVGrampType of a multi-stop gradient, whose colors are row rampRow of image
+   int rampRow;
 };
 typedef struct NVGpaint NVGpaint;
 
+// How a multi-stop gradient maps positions to its stops, see nvgCreateGradient().
+enum NVGrampType
+{
+   NVG_RAMP_NONE,
+   NVG_RAMP_LINEAR,
+   NVG_RAMP_RADIAL,
+   NVG_RAMP_CONIC,
+};
+
+struct NVGgradientStop
+{
+   float offset;			// in [0,1], ascending along the stops
+   NVGcolor color;
+};
+typedef struct NVGgradientStop NVGgradientStop;
+
 enum NVGwinding
 {
    NVG_CCW = 1,			// Winding for solid shapes
@@ -78,6 +96,12 @@ enum NVGlineCap
    NVG_MITER,
 };
 
+enum NVGtessMode
+{
+   NVG_TESS_RECURSIVE,		// Default, curves are split until flat enough.
+   NVG_TESS_ADAPTIVE,		// The segment count of a curve is estimated up front.
+};
+
 enum NVGalign
 {
    // Horizontal align
@@ -116,6 +140,7 @@ enum NVGimageFlags
    NVG_IMAGE_REPEATY			= 1 << 2,		// Repeat image in Y direction.
    NVG_IMAGE_FLIPY				= 1 << 3,		// Flips (inverses) image in Y direction when rendered.
    NVG_IMAGE_PREMULTIPLIED		= 1 << 4,		// Image data has premultiplied alpha.
+   NVG_IMAGE_DISTANCE_FIELD	= 1 << 5,		// Alpha image holds a signed distance field, set on font atlases with NVGparams.distanceFieldText.
 };
 
 // Begin drawing a new frame
@@ -179,6 +204,8 @@ NVGcolor nvgHSLA (float h, float s, float l, unsigned char a);
 
 // Pushes and saves the current render state into a state stack.
 // A matching nvgRestore() must be used to restore the state.
+// Saving copies nothing, the stack keeps the old values of the fields changed after it, so a
+// save and restore around a translation costs little more than the translation itself.
 void nvgSave (NVGcontext * ctx);
 
 // Pops and restores current render state.
@@ -330,13 +357,95 @@ int nvgCreateImage (NVGcontext * ctx, const char * filename, int imageFlags);
 // Returns handle to the image.
 int nvgCreateImageMem (NVGcontext * ctx, int imageFlags, unsigned char * data, int ndata);
 
+// Image decoders. Files are decoded by stb_image unless a registered decoder, such as a SIMD PNG or
+// JPEG decoder, claims them; the decoders apply to every context and to nvgDecodeImageMem(), and are
+// registered before images are loaded, as the list is not locked.
+struct NVGimageDecoder
+{
+   void * userPtr;
+   // Returns nonzero if data is in a format the decoder handles, from its first bytes.
+   int (*probe) (void * userPtr, const unsigned char * data, int ndata);
+   // Reads the size of the image without decoding it. Returns 0 on failure.
+   int (*info) (void * userPtr, const unsigned char * data, int ndata, int * w, int * h);
+   // Decodes the image as RGBA, not premultiplied, into dst with rows rowBytes apart. Returns 0 on failure,
+   // the image is then decoded by stb_image.
+   int (*decode) (void * userPtr, const unsigned char * data, int ndata, unsigned char * dst, int rowBytes);
+};
+typedef struct NVGimageDecoder NVGimageDecoder;
+
+// Registers a decoder, tried before the ones registered earlier and stb_image. Returns 0 if there are too many.
+int nvgAddImageDecoder (const NVGimageDecoder * decoder);
+
+// Reads the size of an image file in memory. Returns 0 if it is not an image.
+int nvgImageInfoMem (const unsigned char * data, int ndata, int * w, int * h);
+
+// Decodes an image file in memory to RGBA pixels, not premultiplied, to be released with free().
+// Returns NULL on failure.
+unsigned char * nvgDecodeImageMem (const unsigned char * data, int ndata, int * w, int * h);
+
+// Decodes an image file in memory into dst, such as a pixel buffer mapped with nvglMapImage(), as RGBA
+// rows rowBytes apart; dst holds the size reported by nvgImageInfoMem(). Decoders write there directly,
+// stb_image through a temporary copy. Returns 0 on failure.
+int nvgDecodeImageMemInto (const unsigned char * data, int ndata, unsigned char * dst, int rowBytes);
+
 // Creates image from specified image data.
 // Returns handle to the image.
 int nvgCreateImageRGBA (NVGcontext * ctx, int w, int h, int imageFlags, const unsigned char * data);
 
+// Block compressed formats for nvgCreateImageCompressed().
+enum NVGcompressedFormat
+{
+   NVG_COMPRESSED_BC1 = 1,		// DXT1, RGB with 1 bit alpha, 8 bytes per 4x4 block
+   NVG_COMPRESSED_BC3,		// DXT5, RGBA, 16 bytes per 4x4 block
+   NVG_COMPRESSED_BC7,		// RGBA, 16 bytes per 4x4 block
+   NVG_COMPRESSED_ETC2_RGB,	// 8 bytes per 4x4 block
+   NVG_COMPRESSED_ETC2_RGBA,	// ETC2 with EAC alpha, 16 bytes per 4x4 block
+};
+
+// Creates image from block compressed data holding levels mip levels, largest first, each level
+// right after the previous one. When the back-end cannot sample the format, BC1 and BC3 are decoded
+// and created as RGBA instead. Compressed images cannot be updated.
+// Returns handle to the image, 0 if the format is not supported or data is too short.
+int nvgCreateImageCompressed (NVGcontext * ctx, int format, int w, int h, int levels, int imageFlags,
+                              const unsigned char * data, int ndata);
+
+// Creates image by loading a KTX (version 1) or DDS file with block compressed data from the disk.
+// Returns handle to the image.
+int nvgCreateImageCompressedFile (NVGcontext * ctx, const char * filename, int imageFlags);
+
+// Creates image from a KTX or DDS file in the specified chunk of memory.
+// Returns handle to the image.
+int nvgCreateImageCompressedMem (NVGcontext * ctx, int imageFlags, const unsigned char * data, int ndata);
+
+// Returns the bytes of one w x h level in the specified NVGcompressedFormat.
+int nvgCompressedLevelSize (int format, int w, int h);
+
+// Pixel conversions of image loading, vectorized with SSE2 or NEON where available. nvgCreateImage()
+// and nvgCreateImageMem() use them to expand gray, gray alpha and RGB files to RGBA and, with
+// NVG_IMAGE_PREMULTIPLIED, to premultiply the pixels before they are uploaded.
+
+// Multiplies the color of npixels RGBA pixels by their alpha, in place.
+void nvgPremultiplyRGBA (unsigned char * pixels, int npixels);
+
+// Divides the color of npixels premultiplied RGBA pixels by their alpha, in place.
+void nvgUnpremultiplyRGBA (unsigned char * pixels, int npixels);
+
+// Swaps the first and third channel of npixels pixels in place, turning BGRA into RGBA and back.
+void nvgSwizzleRB (unsigned char * pixels, int npixels);
+
+// Writes npixels pixels of src with channels 1 (gray), 2 (gray, alpha), 3 (RGB) or 4 components
+// to dst as RGBA.
+void nvgExpandToRGBA (unsigned char * dst, const unsigned char * src, int npixels, int channels);
+
 // Updates image data specified by image handle.
 void nvgUpdateImage (NVGcontext * ctx, int image, const unsigned char * data);
 
+// Updates the w x h rect of an image at x, y. data points at the first pixel of the rect, its rows are
+// rowBytes apart, 0 for rows of w pixels. Only the rect is uploaded, so a live image that changes by a
+// row or a column per frame costs that row or column. The rect is clipped to the image.
+// Returns 0 if the back-end has no rect updates.
+int nvgUpdateImageRegion (NVGcontext * ctx, int image, int x, int y, int w, int h, const unsigned char * data, int rowBytes);
+
 // Returns the dimensions of a created image.
 void nvgImageSize (NVGcontext * ctx, int image, int * w, int * h);
 
@@ -375,6 +484,35 @@ NVGpaint nvgRadialGradient (NVGcontext * ctx, float cx, float cy, float inr, flo
 NVGpaint nvgImagePattern (NVGcontext * ctx, float ox, float oy, float ex, float ey,
                           float angle, int image, float alpha);
 
+//
+// Multi-stop gradients
+//
+// A gradient of any number of color stops is sampled once into a row of a ramp texture shared by
+// the gradients of the context. Its paints then draw all stops with a single fill or stroke, laid
+// out along a line, between two circles or around a center. Positions before the first stop take
+// its color, positions after the last stop the color of the last one.
+
+// Creates a gradient from nstops stops with ascending offsets.
+// Returns its handle, 0 on failure.
+int nvgCreateGradient (NVGcontext * ctx, const NVGgradientStop * stops, int nstops);
+
+// Replaces the stops of a gradient. Paints created from it before draw with the new stops.
+void nvgUpdateGradient (NVGcontext * ctx, int gradient, const NVGgradientStop * stops, int nstops);
+
+// Deletes a created gradient.
+void nvgDeleteGradient (NVGcontext * ctx, int gradient);
+
+// Creates and returns a paint of the gradient laid out from (sx,sy), offset 0, to (ex,ey), offset 1.
+NVGpaint nvgLinearGradientStops (NVGcontext * ctx, float sx, float sy, float ex, float ey, int gradient);
+
+// Creates and returns a paint of the gradient laid out from the circle of radius inr around (cx,cy),
+// offset 0, to the circle of radius outr, offset 1.
+NVGpaint nvgRadialGradientStops (NVGcontext * ctx, float cx, float cy, float inr, float outr, int gradient);
+
+// Creates and returns a paint of the gradient laid out clockwise around (cx,cy), starting with offset 0
+// at angle (in radians) and ending with offset 1 after a full turn.
+NVGpaint nvgConicGradient (NVGcontext * ctx, float cx, float cy, float angle, int gradient);
+
 //
 // Scissoring
 //
@@ -396,6 +534,12 @@ void nvgIntersectScissor (NVGcontext * ctx, float x, float y, float w, float h);
 // Reset and disables scissoring.
 void nvgResetScissor (NVGcontext * ctx);
 
+// Returns the screen space bounding box [minx,miny,maxx,maxy] outside of which nothing drawn
+// now can become visible: the current scissor intersected with the frame's viewport.
+// While a draw list is recorded only the scissor counts, because the recording may be replayed
+// at another offset. Returns 0 when there is no such bound (no scissor while recording).
+int nvgCurrentClipBounds (NVGcontext * ctx, float * bounds);
+
 //
 // Paths
 //
@@ -460,6 +604,130 @@ void nvgFill (NVGcontext * ctx);
 // Fills the current path with current stroke style.
 void nvgStroke (NVGcontext * ctx);
 
+// Fills and then strokes the current path with the current styles. The path is flattened once for both,
+// and the fringe of the fill is left out when an opaque stroke covers it.
+void nvgFillStroke (NVGcontext * ctx);
+
+// Selects how Bezier curves are flattened, see NVGtessMode. In adaptive mode every curve gets
+// the segment count it needs for the tolerance, capped by an estimate of its length, and is
+// evaluated without recursion. Tolerance scales the allowed deviation, values above 1 trade
+// smoothness for fewer vertices. Takes effect for the paths filled or stroked afterwards.
+void nvgTessellationMode (NVGcontext * ctx, int mode, float tolerance);
+
+// Returns the mode and tolerance last set with nvgTessellationMode().
+void nvgCurrentTessellation (NVGcontext * ctx, int * mode, float * tolerance);
+
+// Sets how many curve segments a frame may produce in adaptive mode before the tolerance starts
+// to grow, so that segment counts fall roughly in proportion to the overrun. 0 removes the limit.
+void nvgTessellationBudget (NVGcontext * ctx, int segments);
+
+// Fills the rounded rectangle x,y,w,h,r with the current fill style like nvgRoundedRect() and
+// nvgFill() would, but as a single quad whose edges are computed in the fragment shader, without
+// tessellation or stencil passes. Falls back to a path when the back-end has no renderShape.
+// Clears the current path.
+void nvgDrawRoundedRectSDF (NVGcontext * ctx, float x, float y, float w, float h, float r);
+
+// Fills the area within spread around the rounded rectangle x,y,w,h,r, leaving out the rectangle
+// itself, with the current fill style. Used with a box gradient for drop shadows, it replaces a
+// rectangle with a rounded hole and needs neither tessellation nor stencil passes. Only the
+// border within the corner radius of the edges is drawn, as four quads like the outer slices of
+// a nine-slice, so the fragments shaded grow with the perimeter instead of the area.
+// Clears the current path.
+void nvgDrawBoxShadow (NVGcontext * ctx, float x, float y, float w, float h, float r, float spread);
+
+// Draws the rectangle sx,sy,sw,sh of an image, in pixels, stretched over x,y,w,h as a nine-slice:
+// the borders l,t,r,b keep their size, the edges between them stretch along their length and the
+// center along both axes. The slices are submitted as textured triangles without anti-aliasing
+// fringes, like text, so they meet without seams, and slices of one image drawn in a row merge
+// into a single draw. The image is blended with the global alpha times alpha.
+void nvgDrawImageSlices (NVGcontext * ctx, int image, float sx, float sy, float sw, float sh,
+                         float l, float t, float r, float b, float x, float y, float w, float h, float alpha);
+
+//
+// Plots
+//
+// A plot keeps a ring of capacity samples in video memory that is only ever appended to, and is
+// drawn as a line and the area under it by a vertex shader that reads the samples directly. No
+// path is tessellated, so the CPU cost of a frame is that of the samples appended in it.
+// Plots are optional, nvgCreatePlot() returns 0 when the back-end has none.
+
+// Creates a plot holding up to capacity samples. Returns its handle, 0 if plots are not supported.
+int nvgCreatePlot (NVGcontext * ctx, int capacity);
+
+// Deletes a plot.
+void nvgDeletePlot (NVGcontext * ctx, int plot);
+
+// Appends n samples to a plot, the oldest samples beyond its capacity are dropped.
+void nvgPlotAppend (NVGcontext * ctx, int plot, const float * samples, int n);
+
+// Drops all samples of a plot.
+void nvgPlotClear (NVGcontext * ctx, int plot);
+
+// Draws the samples of a plot into the rectangle x,y,w,h under the current transform and scissor.
+// Capacity - 1 sample intervals span the width and the newest sample sits at the right edge, the
+// values lo and hi map to the bottom and top edge. The area down to the bottom edge is filled with
+// the color of the current fill paint and the line is stroked with the color and width of the
+// current stroke; a transparent color skips either. Gradients and images are not supported.
+void nvgDrawPlot (NVGcontext * ctx, int plot, float x, float y, float w, float h, float lo, float hi);
+
+//
+// Layers
+//
+// A layer is an offscreen image a group of drawing is rendered into, and then composited with a
+// single alpha blended quad. Fading the group through its layer blends every pixel once instead
+// of every shape with its own alpha, so overlapping shapes don't show through each other, and a
+// layer keeps its image, so that later frames can composite it again without drawing the group.
+// Layers are optional, nvgCreateLayer() returns 0 when the back-end has none.
+
+// Creates a layer. Returns its handle, 0 if layers are not supported.
+int nvgCreateLayer (NVGcontext * ctx);
+
+// Deletes a layer and its image.
+void nvgDeleteLayer (NVGcontext * ctx, int layer);
+
+// Redirects the drawing that follows into the layer, cleared, which covers the rectangle x,y,w,h
+// of the view, rounded out to device pixels and regardless of the current transform. The drawing
+// keeps its coordinates and state, nvgResetTransform() included, but is clipped to the rectangle.
+// Returns 0, leaving the drawing on the current target, if the layer can't be used: no support,
+// a draw list is recording, frames are being captured or layers are nested deeper than 8. Every
+// call that returns 1 is matched by nvgEndLayer().
+int nvgBeginLayer (NVGcontext * ctx, int layer, float x, float y, float w, float h);
+
+// Finishes the image of the layer begun last and returns to the previous target, with the state
+// of the nvgBeginLayer() call. Open layers are ended by nvgEndFrame().
+void nvgEndLayer (NVGcontext * ctx);
+
+// Composites the image of a layer at its rectangle with the given alpha, under the current
+// scissor. Returns 0 if the layer has no finished image. Clears the current path.
+int nvgDrawLayer (NVGcontext * ctx, int layer, float alpha);
+
+//
+// Backdrops
+//
+// A backdrop is a blurred copy of what was drawn so far under a rectangle, for frosted glass
+// panels. The pixels are copied once and blurred at half resolution and below by a dual filter,
+// a chain of small passes down and back up through levels half the size of each other, so that a
+// wide blur costs a fraction of a full resolution one. A backdrop keeps its image, later frames
+// can fill with it again without capturing while what lies under the rectangle has not changed.
+// Backdrops are optional, nvgCreateBackdrop() returns 0 when the back-end has none.
+
+// Creates a backdrop. Returns its handle, 0 if backdrops are not supported.
+int nvgCreateBackdrop (NVGcontext * ctx);
+
+// Deletes a backdrop and its image.
+void nvgDeleteBackdrop (NVGcontext * ctx, int backdrop);
+
+// Draws what was drawn so far and copies the pixels of the rectangle x,y,w,h of the view into the
+// backdrop, rounded out to device pixels, clipped to the view and regardless of the current
+// transform, blurred by about radius. Returns 0, keeping the previous pixels, if the backdrop
+// can't be captured now: no support, within a layer, a draw list is recording or frames are being
+// captured. Returns 0 and leaves the backdrop empty if the capture itself fails.
+int nvgCaptureBackdrop (NVGcontext * ctx, int backdrop, float x, float y, float w, float h, float radius);
+
+// Sets paint to the image of a backdrop with the given alpha, for nvgFillPaint() under the current
+// transform, which lays it at its rectangle of the view. Returns 0 if the backdrop is empty.
+int nvgBackdropPattern (NVGcontext * ctx, int backdrop, float alpha, NVGpaint * paint);
+
 
 //
 // Text
@@ -503,8 +771,111 @@ int nvgCreateFont (NVGcontext * ctx, const char * name, const char * filename);
 int nvgCreateFontMem (NVGcontext * ctx, const char * name, unsigned char * data, int ndata, int freeData);
 
 // Finds a loaded font of specified name, and returns handle to it, or -1 if the font is not found.
+// Fonts that are not loaded yet are handed to the font loader, if one is set.
 int nvgFindFont (NVGcontext * ctx, const char * name);
 
+// Adds a fallback font to the base font, drawn for codepoints the base font and the fallbacks
+// added before it have no glyph for. Returns 1 on success, 0 if the chain is full.
+int nvgAddFallbackFontId (NVGcontext * ctx, int baseFont, int fallbackFont);
+int nvgAddFallbackFont (NVGcontext * ctx, const char * baseFont, const char * fallbackFont);
+
+// Removes the fallback fonts of the base font.
+void nvgResetFallbackFontsId (NVGcontext * ctx, int baseFont);
+void nvgResetFallbackFonts (NVGcontext * ctx, const char * baseFont);
+
+// Returns the number of fonts created so far. Handles stay valid once created, so a cached handle
+// only needs to be looked up again when this changed since its lookup found no font.
+int nvgFontCount (NVGcontext * ctx);
+
+// Sets a callback creating fonts on first use. nvgFindFont() and nvgFontFace() call it with the
+// name of a font that is not loaded, it returns the handle of the font it created or -1.
+typedef int (*NVGfontLoader) (void * userPtr, NVGcontext * ctx, const char * name);
+void nvgSetFontLoader (NVGcontext * ctx, NVGfontLoader loader, void * userPtr);
+
+// Rasterizes the glyphs of string for the font at each of the sizes, scaled by devicePixelRatio
+// like nvgBeginFrame() does, so that drawing them later skips rasterization. Returns the number
+// of glyphs pre-warmed.
+int nvgPrewarmGlyphs (NVGcontext * ctx, int font, const float * sizes, int nsizes, float devicePixelRatio,
+                      const char * string, const char * end);
+
+// Writes the font atlas and glyph tables to a cache file. Returns 1 on success.
+int nvgSaveFontAtlas (NVGcontext * ctx, const char * filename);
+
+// Replaces the font atlas with a cache file written by nvgSaveFontAtlas(), glyphs of fonts that
+// changed since are dropped. Returns 1 on success, 0 leaves the atlas as it was or empty.
+int nvgLoadFontAtlas (NVGcontext * ctx, const char * filename);
+
+enum NVGrasterizer
+{
+   NVG_RASTER_DEFAULT = 0,			// stb_truetype
+   NVG_RASTER_FREETYPE = 1,			// FreeType, built with FONS_WITH_FREETYPE
+   NVG_RASTER_FREETYPE_HINTED = 2,	// FreeType with light hinting
+};
+
+// Selects the rasterizer of text glyphs, clearing the font atlas when it changes. Text lays out the
+// same with each, only the glyph bitmaps differ. Returns 0 if the rasterizer is not built in.
+int nvgFontRasterizer (NVGcontext * ctx, int rasterizer);
+
+// A private font atlas with the fonts of a context, for pre-warming glyphs on another thread
+// while the context keeps drawing. The font data is shared, the fonts must outlive the builder.
+typedef struct NVGglyphBuilder NVGglyphBuilder;
+
+// Creates a glyph builder for the fonts currently loaded into the context.
+NVGglyphBuilder * nvgCreateGlyphBuilder (NVGcontext * ctx);
+
+// Same as nvgPrewarmGlyphs() for the builder, may be called from any thread.
+int nvgBuilderPrewarmGlyphs (NVGglyphBuilder * builder, int font, const float * sizes, int nsizes, float devicePixelRatio,
+                             const char * string, const char * end);
+
+// Same as nvgSaveFontAtlas() for the builder, may be called from any thread.
+int nvgBuilderSaveFontAtlas (NVGglyphBuilder * builder, const char * filename);
+
+// Replaces the font atlas of the context with the glyphs of the builder. Returns 1 on success.
+int nvgInstallGlyphBuilder (NVGcontext * ctx, NVGglyphBuilder * builder);
+
+// Deletes the glyph builder.
+void nvgDeleteGlyphBuilder (NVGglyphBuilder * builder);
+
+// A context for measuring text on another thread while its parent keeps drawing, e.g. to lay out
+// widgets in parallel. It has a private font atlas with the fonts of the parent under the same
+// handles, sharing their data, and the device pixel ratio of the parent. Text state, bounds,
+// metrics and line breaking work as on the parent; beginning a frame does not.
+// Drawing works only while recording with nvgRecordDrawList(), and the lists are then replayed on the
+// parent. Fills and strokes are tessellated into the list, text and icons keep their string and font
+// state and are shaped on replay, where glyphs missing from the atlas of the parent are rasterized or
+// queued. Images are those of the parent; creating images, plots, gradients or layers does not work.
+NVGcontext * nvgCreateMeasureContext (NVGcontext * parent);
+
+// Adds the fonts created in the parent since and takes over its device pixel ratio. Call it while
+// neither context is in use elsewhere. Returns 0 if a font could not be added.
+int nvgUpdateMeasureContext (NVGcontext * ctx);
+
+// Returns the parent of a measure context, or ctx itself for any other context.
+NVGcontext * nvgMeasureParent (NVGcontext * ctx);
+
+// Deletes a measure context, before its parent.
+void nvgDeleteMeasureContext (NVGcontext * ctx);
+
+// Turns async glyphs on or off. Text with glyphs missing from the atlas is then laid out right
+// away, the missing glyphs stay blank until their queued bitmaps are rasterized and completed.
+void nvgSetAsyncGlyphs (NVGcontext * ctx, int enabled);
+
+// The glyphs queued by the text drawn so far.
+typedef struct NVGglyphJobs NVGglyphJobs;
+
+// Takes the queued glyphs, returns NULL when there are none.
+NVGglyphJobs * nvgTakeGlyphJobs (NVGcontext * ctx);
+
+// Rasterizes the taken glyphs with the fonts of the builder, may be called from any thread.
+void nvgBuilderRasterizeGlyphJobs (NVGglyphBuilder * builder, NVGglyphJobs * jobs);
+
+// Copies the glyphs into the atlas, uploads them and frees the jobs. Glyphs the builder did not
+// rasterize are rasterized here.
+void nvgCompleteGlyphJobs (NVGcontext * ctx, NVGglyphJobs * jobs);
+
+// Returns the number of glyphs queued or taken and not completed yet.
+int nvgPendingGlyphs (NVGcontext * ctx);
+
 // Sets the font size of current text style.
 void nvgFontSize (NVGcontext * ctx, float size);
 
@@ -527,6 +898,7 @@ void nvgFontFaceId (NVGcontext * ctx, int font);
 void nvgFontFace (NVGcontext * ctx, const char * font);
 
 // Draws text string at specified location. If end is specified only the sub-string up to the end is drawn.
+// The glyph layout of short strings is cached per font state, redrawing unchanged text skips shaping.
 float nvgText (NVGcontext * ctx, float x, float y, const char * string, const char * end);
 
 // Draws multi-line text string at specified location wrapped at the specified width. If end is specified only the sub-string up to the end is drawn.
@@ -545,6 +917,14 @@ float nvgTextBounds (NVGcontext * ctx, float x, float y, const char * string, co
 // Measured values are returned in local coordinate space.
 void nvgTextBoxBounds (NVGcontext * ctx, float x, float y, float breakRowWidth, const char * string, const char * end, float * bounds);
 
+// Draws a single glyph of an icon font at the specified location, e.g. a symbol of Entypo. The quad of
+// the glyph is resolved once per font, size, blur and alignment and kept in a small cache, so icons drawn
+// every frame skip decoding, shaping and the atlas lookup. Returns the horizontal advance like nvgText().
+float nvgIcon (NVGcontext * ctx, float x, float y, int codepoint);
+
+// Measures a glyph of an icon font like nvgTextBounds(), from the same cache as nvgIcon().
+float nvgIconBounds (NVGcontext * ctx, float x, float y, int codepoint, float * bounds);
+
 // Calculates the glyph x positions of the specified text. If end is specified only the sub-string will be used.
 // Measured values are returned in local coordinate space.
 int nvgTextGlyphPositions (NVGcontext * ctx, float x, float y, const char * string, const char * end, NVGglyphPosition * positions, int maxPositions);
@@ -558,6 +938,148 @@ void nvgTextMetrics (NVGcontext * ctx, float * ascender, float * descender, floa
 // Words longer than the max width are slit at nearest character (i.e. no hyphenation).
 int nvgTextBreakLines (NVGcontext * ctx, const char * string, const char * end, float breakRowWidth, NVGtextRow * rows, int maxRows);
 
+//
+// Paragraphs
+//
+// A paragraph keeps a copy of a text together with its rows as broken by nvgTextBreakLines(),
+// so that wrapped text which is drawn every frame is only broken again when it or its style changes.
+// After an edit only the rows from the one before the change up to the first row that starts where
+// it did before are broken again, the rows past it are shifted and reused.
+// Glyph positions of a row are measured the first time they are asked for and kept with the row.
+typedef struct NVGparagraph NVGparagraph;
+
+// Creates an empty paragraph.
+NVGparagraph * nvgCreateParagraph (void);
+
+// Deletes a paragraph.
+void nvgDeleteParagraph (NVGparagraph * para);
+
+// Lays the text out with the current font, size and letter spacing, breaking rows at breakRowWidth.
+// Returns right away if neither the text nor the style changed since the last call. Returns the number of rows.
+int nvgParagraphLayout (NVGcontext * ctx, NVGparagraph * para, const char * string, const char * end, float breakRowWidth);
+
+// Returns the rows of the last layout, pointing into the paragraph's copy of the text.
+// The pointers are valid until the next call to nvgParagraphLayout().
+const NVGtextRow * nvgParagraphRows (NVGparagraph * para, int * nrows);
+
+// Draws the rows of the last layout like nvgTextBox(), using the current alignment and line height.
+void nvgParagraphDraw (NVGcontext * ctx, NVGparagraph * para, float x, float y);
+
+// Measures the rows of the last layout like nvgTextBoxBounds().
+void nvgParagraphBounds (NVGcontext * ctx, NVGparagraph * para, float x, float y, float * bounds);
+
+// Calculates the glyph x positions of the specified row, starting at x.
+int nvgParagraphGlyphPositions (NVGcontext * ctx, NVGparagraph * para, int row, float x, NVGglyphPosition * positions, int maxPositions);
+
+//
+// Draw lists
+//
+// A draw list captures the geometry that is handed to the render back-end between
+// nvgBeginDrawList() and nvgEndDrawList(), so that unchanged content can be submitted
+// again later with nvgDrawList() without flattening, expanding or shaping it again.
+// Content is still rendered normally while it is being recorded, and draw lists may be
+// nested (up to a small fixed depth) and replayed while another list is recording.
+//
+// Replaying applies the difference in translation between the current transform and
+// the transform at record time. If the rest of the transform or the device pixel ratio
+// differs, or the font atlas was rebuilt after text was recorded, nvgDrawList() returns 0
+// and nothing is drawn; the caller should record the list again.
+//
+// The current scissor must either equal the recorded one (moved by the same translation)
+// or, for axis aligned scissors, lie inside it; in the latter case the recording is clipped
+// to the current scissor. A scrolling view can therefore record content once under a larger
+// scissor (or none) with nvgRecordDrawList() and move it under its fixed viewport scissor.
+// Recorded commands outside of nvgCurrentClipBounds() are skipped on replay.
+
+typedef struct NVGdrawList NVGdrawList;
+
+// Creates an empty draw list.
+NVGdrawList * nvgCreateDrawList (void);
+
+// Deletes a draw list created with nvgCreateDrawList().
+void nvgDeleteDrawList (NVGdrawList * list);
+
+// Clears the specified draw list and starts recording into it.
+void nvgBeginDrawList (NVGcontext * ctx, NVGdrawList * list);
+
+// Clears the specified draw list and starts recording into it without rendering anything,
+// until the matching nvgEndDrawList(). Frame statistics do not count recorded-only content.
+void nvgRecordDrawList (NVGcontext * ctx, NVGdrawList * list);
+
+// Stops recording into the most recently begun draw list.
+void nvgEndDrawList (NVGcontext * ctx);
+
+// Returns 1 if the draw list holds a complete recording.
+int nvgDrawListValid (NVGcontext * ctx, NVGdrawList * list);
+
+// Submits the recorded content of the draw list again. Returns 0 if the list has to be re-recorded.
+int nvgDrawList (NVGcontext * ctx, NVGdrawList * list);
+
+//
+// Retained geometry
+//
+// A geometry captures the current path once, so that static shapes can be filled and stroked
+// frame after frame without rebuilding and tessellating the path. The path is kept in the local
+// space of the transform it was built with. A tessellation is made for the average scale of the
+// transform at submission and reused under any translation and rotation, until the scale changes
+// enough to move the stroke or fringe edges by more than the tessellation tolerance, or the
+// stroke style changes. The geometry is placed with the current transform, paint and scissor.
+
+typedef struct NVGgeometry NVGgeometry;
+
+// Creates a geometry from the current path. Returns NULL if out of memory.
+NVGgeometry * nvgCreateGeometry (NVGcontext * ctx);
+
+// Deletes a geometry created with nvgCreateGeometry().
+void nvgDeleteGeometry (NVGgeometry * geom);
+
+// Fills the geometry with the current fill style, like nvgFill() does for the current path.
+void nvgFillGeometry (NVGcontext * ctx, NVGgeometry * geom);
+
+// Strokes the geometry with the current stroke style, like nvgStroke() does for the current path.
+void nvgStrokeGeometry (NVGcontext * ctx, NVGgeometry * geom);
+
+//
+// Frame capture
+//
+// Captures the drawing of whole frames into a compact binary stream that draws them again on
+// another context, without the application, to profile tessellation and back-ends on real frames.
+// Every fill, stroke, text, icon, analytic shape and retained geometry is stored with its path
+// commands, already transformed, and with the state it was drawn with, which is only written
+// when it changed since the previous draw. Images are captured with their size only and fonts
+// with their name. While a frame is captured nvgDrawList() returns 0, so that the content of
+// draw lists is drawn, and captured, again; plots are not captured.
+//
+// The stream holds the state as it is laid out in memory, so it is only replayed by the build
+// of NanoVG that captured it.
+
+typedef struct NVGreplay NVGreplay;
+
+// Starts capturing with the next nvgBeginFrame(), for the given number of frames. Drops the previous capture.
+void nvgCaptureFrames (NVGcontext * ctx, int frames);
+
+// Returns the captured stream once all frames were captured, else NULL. Valid until the next nvgCaptureFrames().
+const unsigned char * nvgCaptureData (NVGcontext * ctx, int * size);
+
+// Creates a replay of a captured stream, copying it. Returns NULL if the stream was not captured by this build.
+NVGreplay * nvgCreateReplay (const unsigned char * data, int ndata);
+
+// Replaces the stream of a replay with another capture and starts it from its first frame, keeping the
+// stand-in images and the geometries whose commands did not change. Returns 0 if the stream was not
+// captured by this build, leaving the replay as it was.
+int nvgReplayLoad (NVGreplay * replay, const unsigned char * data, int ndata);
+
+// Deletes a replay and the stand-in images and geometries it created on the context.
+void nvgDeleteReplay (NVGcontext * ctx, NVGreplay * replay);
+
+// Draws the next captured frame, from nvgBeginFrame() to nvgEndFrame(). Captured images are replaced
+// by blank images of their size and fonts are looked up by name, falling back to the first font.
+// Returns 1 if a frame was drawn, 0 at the end of the stream and -1 if the stream is malformed.
+int nvgReplayFrame (NVGcontext * ctx, NVGreplay * replay);
+
+// Starts the replay over from the first frame.
+void nvgRewindReplay (NVGreplay * replay);
+
 //
 // Internal Render API
 //
@@ -592,25 +1114,151 @@ struct NVGpath
    int nstroke;
    int winding;
    int convex;
+   // The fill is a triangle list rather than a fan. The triangles of the whole fill are on the
+   // first path, the other paths only keep their fringe.
+   int triangles;
 };
 typedef struct NVGpath NVGpath;
 
+// Buffer sizes, in elements, a frame needed, see nvgFrameMemoryPeaks() and nvgReserveFrameMemory().
+struct NVGframeMemory
+{
+   int commands;			// path command floats
+   int points;				// path cache
+   int paths;
+   int verts;
+   int deferOps;			// deferred tessellation, see nvgSetParallelCallback()
+   int deferCommands;
+   int deferVerts;
+   int renderCalls;		// back-end, filled in by renderStats
+   int renderPaths;
+   int renderVerts;
+   int renderUniforms;
+};
+typedef struct NVGframeMemory NVGframeMemory;
+
+// Rendering statistics of a frame, see nvgFrameStats().
+struct NVGframeStats
+{
+   int drawCalls;			// render calls submitted to the backend
+   int glDrawCalls;		// draws issued by the backend, after merging
+   int fillTriCount;
+   int strokeTriCount;
+   int textTriCount;
+   int vertexBytes;		// uploaded by the backend
+   int uniformBytes;
+   int textureBinds;
+   int stencilPasses;		// passes drawn with the stencil test enabled
+   int atlasUploads;		// font atlas updates
+   int atlasUploadBytes;
+   int peakPoints;			// path cache high water marks
+   int peakPaths;
+   int peakVerts;
+   int curveSegments;		// line segments Bezier curves were flattened into
+   int textCacheHits;		// nvgText() and nvgTextBounds() calls served from shaped runs
+   int textCacheMisses;
+   int textureKBytes;		// video memory held by the textures of images and atlas pages, in KiB
+   NVGframeMemory memory;
+};
+typedef struct NVGframeStats NVGframeStats;
+
+// Memory held by a context in KiB, see nvgMemoryReport(). Buffers count what they can hold, not
+// what the last frame put in them.
+struct NVGmemoryReport
+{
+   int commands;			// path commands
+   int pathCache;			// points, paths and vertices of the path cache
+   int deferred;			// deferred tessellation buffers and their path caches
+   int fontScratch;		// glyph rasterization scratch
+   int fontAtlas;			// pixels and packers of the font atlas pages
+   int fontAtlasPages;		// a count, not KiB
+   int renderBuffers;		// back-end per frame buffers, filled in by renderMemory
+   int gpuBuffers;			// back-end vertex, uniform and upload buffers
+   int textures;			// video memory of the textures of images, font atlas pages included
+};
+typedef struct NVGmemoryReport NVGmemoryReport;
+
+// A draw of a plot as handed to the back-end, colors are straight and include the global alpha.
+struct NVGplotDraw
+{
+   int plot;
+   float xform[6];
+   float rect[4];		// x, y, w, h before the transform
+   float range[2];		// values at the bottom and top edge
+   float strokeWidth;	// in pixels, after the transform
+   float fringe;
+   NVGcolor strokeColor;
+   NVGcolor fillColor;
+};
+typedef struct NVGplotDraw NVGplotDraw;
+
 struct NVGparams
 {
    void * userPtr;
    int edgeAntiAlias;
+   // Set when renderFill draws fills flagged NVGpath.triangles in one pass. Simple concave and holed
+   // fills are then triangulated instead of going through the stencil.
+   int triangleFills;
+   // Set when the backend renders NVG_IMAGE_DISTANCE_FIELD textures. Glyphs are then rasterized once as
+   // distance fields and drawn at any size and blur, text paints carry the half width of the edge in
+   // field units in feather.
+   int distanceFieldText;
+   // Set when the backend blurs alpha glyphs itself. Blurred glyphs are then rasterized sharp with a
+   // margin, whatever the blur, and text paints carry the blur in atlas texels in feather.
+   int shaderTextBlur;
    int (*renderCreate) (void * uptr);
    int (*renderCreateTexture) (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data);
+   // Optional, creates a texture from levels mip levels of NVGcompressedFormat data laid out as for
+   // nvgCreateImageCompressed(). Returns 0 when the format is not supported.
+   int (*renderCreateCompressedTexture) (void * uptr, int format, int w, int h, int levels, int imageFlags,
+                                         const unsigned char * data);
    int (*renderDeleteTexture) (void * uptr, int image);
    int (*renderUpdateTexture) (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data);
+   // Optional, updates the rect x, y, w, h from data pointing at its first pixel, rows rowBytes apart.
+   int (*renderUpdateTextureRegion) (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data,
+                                     int rowBytes);
    int (*renderGetTextureSize) (void * uptr, int image, int * w, int * h);
-   void (*renderViewport) (void * uptr, int width, int height);
+   void (*renderViewport) (void * uptr, int width, int height, float devicePixelRatio);
    void (*renderCancel) (void * uptr);
    void (*renderFlush) (void * uptr);
    void (*renderFill) (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, const float * bounds, const NVGpath * paths, int npaths);
    void (*renderStroke) (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, float strokeWidth, const NVGpath * paths, int npaths);
    void (*renderTriangles) (void * uptr, NVGpaint * paint, NVGscissor * scissor, const NVGvertex * verts, int nverts);
+   // Optional, fills the quad fan verts with paint masked by a rounded rectangle evaluated per pixel.
+   // The vertex u,v are positions relative to the rectangle center, shape holds its half extents,
+   // corner radius and the inverse of the antialiasing width in those units, negated to keep the outside.
+   void (*renderShape) (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, const float * shape, const NVGvertex * verts, int nverts);
    void (*renderDelete) (void * uptr);
+   // Optional, fills in the backend counters of the frame that was just flushed.
+   void (*renderStats) (void * uptr, NVGframeStats * stats);
+   // Optional, grows the per frame buffers of the backend to hold at least the render counts of mem.
+   void (*renderReserve) (void * uptr, const NVGframeMemory * mem);
+   // Optional, shrinks the per frame buffers of the backend holding more than ratio times the render
+   // counts of mem down to about one and a half times them. Called after renderFlush.
+   void (*renderShrink) (void * uptr, const NVGframeMemory * mem, float ratio);
+   // Optional, fills in renderBuffers, gpuBuffers and textures of report.
+   void (*renderMemory) (void * uptr, NVGmemoryReport * report);
+   // Optional, returns the video memory of the texture of image in KiB, rounded up.
+   int (*renderTextureKBytes) (void * uptr, int image);
+   // Optional, switches the fringe passes of edgeAntiAlias on or off and returns whether they are on.
+   int (*renderEdgeAntiAlias) (void * uptr, int enabled);
+   // Optional GPU plots, see nvgCreatePlot(). renderCreatePlot returns 0 on failure; appending n
+   // samples, n at most the capacity, replaces the oldest ones once the ring is full.
+   int (*renderCreatePlot) (void * uptr, int capacity);
+   void (*renderDeletePlot) (void * uptr, int plot);
+   void (*renderAppendPlot) (void * uptr, int plot, const float * samples, int n);
+   void (*renderClearPlot) (void * uptr, int plot);
+   void (*renderPlot) (void * uptr, NVGscissor * scissor, const NVGplotDraw * draw);
+   // Optional layers, see nvgCreateLayer(). renderBeginLayer draws the calls so far to the current
+   // target and sends the following ones to the texture of image, cleared, returning 0 on failure.
+   // renderEndLayer draws them into it and switches back. Layers nest, and the viewport is set by
+   // renderViewport() after either call.
+   int (*renderBeginLayer) (void * uptr, int image);
+   void (*renderEndLayer) (void * uptr);
+   // Optional backdrops, see nvgCaptureBackdrop(). renderBackdrop draws the calls so far to the
+   // current target, then blurs its pixels x,y,w,h, counted from the top left, with passes levels
+   // of the dual filter into the texture of image, half their size. Returns 0 on failure.
+   int (*renderBackdrop) (void * uptr, int image, int x, int y, int w, int h, int passes);
 };
 typedef struct NVGparams NVGparams;
 
@@ -623,6 +1271,60 @@ NVGparams * nvgInternalParams (NVGcontext * ctx);
 // Debug function to dump cached path data.
 void nvgDebugDumpPathCache (NVGcontext * ctx);
 
+// Returns the number of render calls submitted to the backend since nvgBeginFrame(), before any
+// merging done by the backend.
+int nvgDrawCallCount (NVGcontext * ctx);
+
+// Returns the number of fill, stroke and text triangles submitted since nvgBeginFrame().
+int nvgTriangleCount (NVGcontext * ctx);
+
+// Returns the statistics of the last frame finished with nvgEndFrame().
+void nvgFrameStats (NVGcontext * ctx, NVGframeStats * stats);
+
+// Turns the fringes anti-aliasing the edges of fills on or off, for frames rendered into a
+// multisampled framebuffer where they only cost vertices and draw calls. Call it before
+// nvgBeginFrame(). A back-end created without anti-aliasing keeps it off. Returns whether the
+// fringes are on.
+int nvgEdgeAntiAlias (NVGcontext * ctx, int enabled);
+
+// Returns the largest buffer sizes any of the last frames (at most 120) needed.
+void nvgFrameMemoryPeaks (NVGcontext * ctx, int frames, NVGframeMemory * mem);
+
+// Grows the command, path cache, deferred and backend buffers to hold at least mem, so that frames
+// within those sizes don't allocate. Call outside nvgBeginFrame()/nvgEndFrame().
+void nvgReserveFrameMemory (NVGcontext * ctx, const NVGframeMemory * mem);
+
+// Sets when buffers give memory back. At the end of every frame, once frames frames (at most 120)
+// were drawn, the command, path cache, deferred and backend buffers holding more than ratio times
+// what any of those frames needed are shrunk to one and a half times that. A single huge frame then
+// stops pinning its memory frames frames later. Frames of 0, the default, keeps buffers at their
+// high water mark. Ratio is at least 2.
+void nvgMemoryShrinkPolicy (NVGcontext * ctx, int frames, float ratio);
+
+// Fills in the memory held by the context and its backend.
+void nvgMemoryReport (NVGcontext * ctx, NVGmemoryReport * report);
+
+// Returns the video memory of the texture of image in KiB. Images the backend packed into a shared
+// atlas page or whose texture it does not own report 0, the page is counted by nvgMemoryReport().
+int nvgImageKBytes (NVGcontext * ctx, int image);
+
+// Sets a callback bracketing nvgFill(), nvgStroke(), nvgText() and the backend flush in named
+// scopes, begin is 1 when a scope opens and 0 when it closes. Names are string literals.
+typedef void (*NVGprofileCallback) (void * userPtr, const char * name, int begin);
+void nvgSetProfileCallback (NVGcontext * ctx, NVGprofileCallback callback, void * userPtr);
+
+// Called with every index in [0, count) by a parallel callback.
+typedef void (*NVGtaskCallback) (void * data, int index);
+// Must call task(data, i) once for every i in [0, count) and return when all calls have finished.
+// The calls may run at the same time on different threads.
+typedef void (*NVGparallelCallback) (void * userPtr, NVGtaskCallback task, void * data, int count);
+// Sets a callback that enables deferred tessellation. nvgFill() and nvgStroke() then only copy the
+// path and its state. The paths are flattened and expanded all together, through the callback,
+// when the frame ends or before the next submission that cannot wait. Submissions still reach the
+// back-end in order. Paths recorded into a draw list are tessellated right away. The frame
+// statistics of deferred paths are updated when they are flushed. Pass NULL to turn it off.
+void nvgSetParallelCallback (NVGcontext * ctx, NVGparallelCallback callback, void * userPtr);
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
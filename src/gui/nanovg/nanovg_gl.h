@@ -30,9 +30,66 @@ enum NVGcreateFlags
    NVG_ANTIALIAS 		= 1 << 0,
    // Flag indicating if strokes should be drawn using stencil buffer. The rendering will be a little
    // slower, but path overlaps (i.e. self-intersecting or sharp turns) will be drawn just once.
+   // Opaque strokes that cannot overlap, such as lines and convex outlines, still take one pass.
    NVG_STENCIL_STROKES	= 1 << 1,
    // Flag indicating that additional debug checks are done.
    NVG_DEBUG 			= 1 << 2,
+   // Flag indicating that vertex and uniform data is streamed through a ring of mapped buffers instead
+   // of being re-specified with glBufferData() every frame (GL3 only). Buffers are persistently mapped
+   // when ARB_buffer_storage is available, otherwise they are written with unsynchronized maps.
+   NVG_RING_BUFFERS	= 1 << 3,
+   // Flag indicating that runs of adjacent convex fills, strokes and text that use the same image are
+   // merged into single indexed draws (GL3 only). The paints of merged draws are then fetched from a
+   // texture buffer instead of being bound per call, other calls keep them in uniforms.
+   NVG_MERGE_CALLS		= 1 << 4,
+   // Flag indicating that text is drawn as instanced quads (GL3 only). Every glyph then uploads one
+   // small instance record instead of six vertices. Combined with NVG_MERGE_CALLS, adjacent text
+   // calls with the same font atlas are drawn with a single instanced draw.
+   NVG_INSTANCED_QUADS	= 1 << 5,
+   // Flag indicating that small RGBA images without mipmaps, repeat or flipping are packed into shared
+   // atlas pages (GL3 only). Fills with different images on the same page can then be merged, and
+   // nvglImageHandle() returns the page texture for them.
+   NVG_ATLAS_IMAGES	= 1 << 6,
+   // Flag indicating that glyphs are rasterized once as signed distance fields and scaled to any font
+   // size and blur in the shader. The font atlas then holds one bitmap per glyph instead of one per
+   // size and blur, at the cost of slightly softer small text.
+   NVG_SDF_TEXT		= 1 << 7,
+   // Flag indicating that texture updates, such as new glyphs and nvgUpdateImage(), are collected over
+   // the frame and uploaded together before it is drawn, through a ring of pixel unpack buffers so the
+   // driver can copy them asynchronously (GL3 only). See nvglFlushUploads().
+   NVG_BATCH_UPLOADS	= 1 << 8,
+   // Flag indicating that calls drawn on their own use programs specialized for their paint type,
+   // scissor, analytic shape and anti-aliasing, which are compiled on first use, instead of the
+   // program branching on all of them. Merged calls and instanced text keep the general program.
+   NVG_SHADER_VARIANTS	= 1 << 9,
+   // Flag indicating that vertices are uploaded as 8 byte records instead of 16: positions in 16 bit
+   // fixed point with 1/8 pixel steps and texture coordinates in normalized 16 bit. A flush with a
+   // vertex beyond 4096 pixels from the origin, or with texture coordinates outside [-1, 1], is
+   // uploaded as floats. Vertices then stay on the heap even with NVG_RING_BUFFERS.
+   NVG_PACKED_VERTICES	= 1 << 10,
+   // Flag indicating that a call may be drawn earlier than submitted, right after an earlier call it
+   // can be merged with, when it overlaps none of the calls in between (GL3 only, needs
+   // NVG_MERGE_CALLS). Text and images of widgets interleaved with fills then end up in one draw.
+   NVG_REORDER_CALLS	= 1 << 11,
+   // Flag indicating that scissors which are axis aligned rectangles with their edges on framebuffer
+   // pixels, such as those of scroll panels and windows, are applied with glScissor() instead of in
+   // the fragment shader. Calls then only merge with calls under the same rectangle.
+   NVG_HARDWARE_SCISSOR	= 1 << 12,
+   // Flag indicating that on GL 4.5 buffers and textures are created with immutable storage and
+   // updated through direct state access instead of being bound to edit them, the vertex format is
+   // set once per vertex array, and the paths of a flush are drawn with glMultiDrawArraysIndirect()
+   // from a buffer of draw commands uploaded once (GL3 only). Ignored on older drivers.
+   NVG_DIRECT_STATE_ACCESS	= 1 << 13,
+   // Flag indicating that the winding of concave fills is written into the stencil buffer by the
+   // path renderer of NV_path_rendering instead of by triangle fans (GL3 only). All the sub-paths of
+   // a fill then take one stencil call without the overdraw of fans, the fringes and the cover pass
+   // stay the same. Ignored on drivers without the extension.
+   NVG_PATH_RENDERING	= 1 << 14,
+   // Flag indicating that convex fills and single pass strokes whose geometry repeats one drawn
+   // earlier in the flush, only moved, such as the boxes of a column of check boxes, keep no
+   // vertices of their own (GL3 only, needs NVG_MERGE_CALLS). Adjacent calls drawing the same shape
+   // are drawn with a single instanced draw, every call giving an offset and its own paint.
+   NVG_INSTANCE_SHAPES	= 1 << 15,
 };
 
 #if defined NANOVG_GL2_IMPLEMENTATION
@@ -90,7 +147,111 @@ enum NVGimageFlagsGL
 };
 
 int nvglCreateImageFromHandle (NVGcontext * ctx, GLuint textureId, int w, int h, int flags);
+// Returns the GL texture of an image, for images packed with NVG_ATLAS_IMAGES the shared atlas page.
 GLuint nvglImageHandle (NVGcontext * ctx, int image);
+// Uploads the texture updates batched with NVG_BATCH_UPLOADS right away, for textures that are
+// used outside NanoVG before the frame ends.
+void nvglFlushUploads (NVGcontext * ctx);
+
+// Replaces all pixels of an RGBA image, such as the frame of a video or camera feed, whose rows
+// are rowBytes apart. On GL3 the pixels are copied into one of two pixel unpack buffers owned by
+// the image, taking turns, and the texture is updated from there, so the call neither waits for
+// the GPU to finish reading the previous frame nor repacks padded rows. The update is issued right
+// away instead of being batched; do not mix it with nvgUpdateImage() or, with NVG_BATCH_UPLOADS,
+// nvgUpdateImageRegion() on the same image.
+// Returns 0 for unsuitable images or, on GLES2, padded rows.
+int nvglStreamImage (NVGcontext * ctx, int image, const unsigned char * data, int rowBytes);
+
+// Maps a pixel unpack buffer holding all pixels of an RGBA image, rows *rowBytes apart, for the caller
+// to write them, such as by decoding a file into it with nvgDecodeImageMemInto(). nvglUnmapImage()
+// then updates the image from the buffer without a copy on the CPU. Uses the buffers of
+// nvglStreamImage(). Returns NULL for unsuitable images and on back-ends other than GL3.
+unsigned char * nvglMapImage (NVGcontext * ctx, int image, int * rowBytes);
+void nvglUnmapImage (NVGcontext * ctx, int image);
+
+// Sets the texels of level 0 whose mipmaps are generated per frame, 4M by default, 0 for no limit.
+// Images created or updated with NVG_IMAGE_GENERATE_MIPMAPS are queued and get their levels at the
+// start of a later flush, at least one image per flush; they are drawn from level 0 until then.
+// Mipmaps are not generated on GL2, which keeps them current through GL_GENERATE_MIPMAP.
+void nvglSetMipmapBudget (NVGcontext * ctx, int texels);
+
+// Sets the flushes that pass between mipmap generations of an image updated more often, such as a
+// live feed, 0 to regenerate after every update (the default) or -1 to keep the first levels.
+void nvglSetMipmapInterval (NVGcontext * ctx, int image, int flushes);
+
+// Returns the number of GL draw calls issued by the last flush, after call merging.
+int nvglIssuedDrawCallCount (NVGcontext * ctx);
+
+// Callback bracketing the GL work of a flush in named, nested scopes, begin is 1 when a scope opens
+// and 0 when it closes. Names are string literals.
+typedef void (*NVGLprofileCallback) (void * userPtr, const char * name, int begin);
+void nvglSetProfileCallback (NVGcontext * ctx, NVGLprofileCallback callback, void * userPtr);
+
+// Sharing one context between windows. Programs, buffers and textures are shared between GL
+// contexts created to share objects, vertex arrays are not (GL3). A window other than the one the
+// NanoVG context was created in gets its own from nvglCreateWindowState(), called with its GL
+// context current, and selects it with nvglUseWindowState() before each frame it draws; 0 selects
+// the state of the creating window. Delete a state with its GL context current. On GL2 and GLES2
+// the states are 0 and selecting them does nothing.
+int nvglCreateWindowState (NVGcontext * ctx);
+void nvglUseWindowState (NVGcontext * ctx, int state);
+void nvglDeleteWindowState (NVGcontext * ctx, int state);
+
+// Bits of NVGglState, one per shadowed piece of state.
+enum NVGglStateBits
+{
+   NVG_GL_PROGRAM		= 1 << 0,
+   NVG_GL_VERTEX_ARRAY	= 1 << 1,	// GL3 only
+   NVG_GL_ACTIVE_TEXTURE	= 1 << 2,
+   NVG_GL_TEXTURE		= 1 << 3,
+   NVG_GL_BLEND			= 1 << 4,
+   NVG_GL_BLEND_FUNC		= 1 << 5,
+   NVG_GL_CULL_FACE		= 1 << 6,
+   NVG_GL_CULL_MODE		= 1 << 7,	// cullFace and frontFace
+   NVG_GL_DEPTH_TEST		= 1 << 8,
+   NVG_GL_SCISSOR_TEST	= 1 << 9,
+   NVG_GL_STENCIL_TEST	= 1 << 10,
+   NVG_GL_COLOR_MASK		= 1 << 11,
+   NVG_GL_STENCIL_MASK	= 1 << 12,
+   NVG_GL_STENCIL_FUNC	= 1 << 13,
+   NVG_GL_STENCIL_OP		= 1 << 14,
+   NVG_GL_ALL_STATE		= (1 << 15) - 1,
+};
+
+// GL state NanoVG sets, as last set by whoever holds the structure. A field is trusted while its
+// bit is in known, NanoVG sets it regardless otherwise and then adds the bit.
+struct NVGglState
+{
+   unsigned int known;
+   GLuint program;
+   GLuint vertexArray;
+   GLenum activeTexture;	// GL_TEXTURE0 + unit
+   GLuint texture;		// GL_TEXTURE_2D of unit 0
+   GLenum blendSrc, blendDst;	// of glBlendFunc()
+   GLenum cullFace, frontFace;
+   GLuint stencilMask;
+   GLenum stencilFunc;
+   GLint stencilRef;
+   GLuint stencilFuncMask;
+   GLenum stencilOp[2][3];	// front and back, fail, depth fail and pass
+   GLboolean blend, cullFaceEnabled, depthTest, scissorTest, stencilTest;
+   GLboolean colorMask;	// all channels on or off
+};
+typedef struct NVGglState NVGglState;
+
+// Shares the shadow of the GL state with the application, for the GL context current while
+// drawing, or NULL to stop. Flushes then only set state that differs from it, record what they set
+// and leave it behind instead of restoring defaults afterwards: the application fills it in from
+// its own state cache before nvgEndFrame() and takes it over into that cache, or restores what
+// differs, after. Without a shared state every flush sets all its state and restores defaults, as
+// nothing set outside NanoVG is known.
+void nvglShareState (NVGcontext * ctx, NVGglState * state);
+
+// Sets the directory linked programs are cached in, for contexts created afterwards, or NULL (the
+// default) to always compile them. Binaries are named by a hash of the shader sources and the GL
+// renderer and version, and are compiled from source again when missing or rejected by the driver.
+// Needs GL 4.1, ARB_get_program_binary or GLES3, and does nothing otherwise.
+void nvglSetProgramCache (const char * dir);
 
 
 #ifdef __cplusplus
@@ -101,6 +262,7 @@ GLuint nvglImageHandle (NVGcontext * ctx, int image);
 
 #ifdef NANOVG_GL_IMPLEMENTATION
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -112,6 +274,15 @@ enum GLNVGuniformLoc
    GLNVG_LOC_VIEWSIZE,
    GLNVG_LOC_TEX,
    GLNVG_LOC_FRAG,
+   GLNVG_LOC_PAINTS,
+   GLNVG_LOC_PAINTPASS,
+   GLNVG_LOC_QUADS,
+   GLNVG_LOC_INSTANCES,
+   GLNVG_LOC_PLOT,
+   GLNVG_LOC_PLOTPASS,
+   GLNVG_LOC_VERTEXSCALE,
+   GLNVG_LOC_BLURREGION,
+   GLNVG_LOC_BLURPASS,
    GLNVG_MAX_LOCS
 };
 
@@ -120,8 +291,59 @@ enum GLNVGshaderType
    NSVG_SHADER_FILLGRAD,
    NSVG_SHADER_FILLIMG,
    NSVG_SHADER_SIMPLE,
-   NSVG_SHADER_IMG
+   NSVG_SHADER_IMG,
+   NSVG_SHADER_FILLRAMP
+};
+
+// Key of a shader variant, see NVG_SHADER_VARIANTS: the shader type in the low bits, then whether
+// the paint is scissored, draws an analytic shape and the fringes are anti-aliased.
+enum GLNVGvariantBits
+{
+   GLNVG_VARIANT_TYPE = (1 << 3) - 1,
+   GLNVG_VARIANT_SCISSOR = 1 << 3,
+   GLNVG_VARIANT_SHAPE = 1 << 4,
+   GLNVG_VARIANT_EDGE_AA = 1 << 5,
+   GLNVG_VARIANTS = 1 << 6
+};
+
+// Desktop GL draws the paths of a call with a single glMultiDrawArrays().
+#if defined NANOVG_GL2 || defined NANOVG_GL3
+#  define NANOVG_GL_HAS_MULTIDRAW 1
+#endif
+
+#if (defined NANOVG_GL3 && (defined GL_VERSION_4_1 || defined GL_ARB_get_program_binary)) || defined NANOVG_GLES3
+#  define NANOVG_GL_HAS_PROGRAM_BINARY 1
+#endif
+
+// Layers render into framebuffer objects, core from GL3 and ES2 on.
+#if defined NANOVG_GL3 || defined NANOVG_GLES2 || defined NANOVG_GLES3
+#  define NANOVG_GL_HAS_LAYERS 1
+// Framebuffers kept for layers, and how deep layers nest.
+#  define NANOVG_GL_LAYER_TARGETS 4
+#  define NANOVG_GL_MAX_LAYER_DEPTH 8
+// Stencil buffers of layer framebuffers are allocated in steps of this many pixels, so that a
+// layer growing a little, say with a window being resized, still fits.
+#  define NANOVG_GL_LAYER_STEP 128
+
+// Framebuffer with its stencil buffer, shared by all the layers that fit into it.
+struct GLNVGlayerTarget
+{
+   GLuint fbo;
+   GLuint stencil;
+   int width, height;	// of the stencil buffer, 0 while the slot is free
+   int open;			// a layer is drawn through it
+};
+typedef struct GLNVGlayerTarget GLNVGlayerTarget;
+
+// The target drawn to before an open layer.
+struct GLNVGlayerScope
+{
+   int target;			// index into layerTargets
+   GLint fbo;
+   GLint viewport[4];
 };
+typedef struct GLNVGlayerScope GLNVGlayerScope;
+#endif
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
 enum GLNVGuniformBindings
@@ -130,12 +352,125 @@ enum GLNVGuniformBindings
 };
 #endif
 
+#if defined NANOVG_GL3
+// Number of frames that may be in flight when streaming through the buffer ring.
+#define NANOVG_GL_RING_SIZE 3
+#define NANOVG_GL_RING_INIT_VERTS 65536
+#define NANOVG_GL_RING_INIT_UNIFORMS 1024
+// Floats per paint in the merged paint buffer, the uniform block repacked as 13 vec4s.
+#define NANOVG_GL_PAINT_FLOATS 52
+// Calls looked back over for a batch to join when reordering, see NVG_REORDER_CALLS.
+#define NANOVG_GL_REORDER_WINDOW 64
+// Image atlas pages, images larger than the limit keep their own texture.
+#define NANOVG_GL_ATLAS_PAGE_SIZE 2048
+#define NANOVG_GL_ATLAS_MAX_IMAGE 512
+#define NANOVG_GL_ATLAS_MAX_SHELVES 128
+#if defined GL_VERSION_4_4 || defined GL_ARB_buffer_storage
+#  define NANOVG_GL_HAS_BUFFER_STORAGE 1
+#  ifndef GL_MAP_PERSISTENT_BIT
+#     define GL_MAP_PERSISTENT_BIT 0x0040
+#  endif
+#  ifndef GL_MAP_COHERENT_BIT
+#     define GL_MAP_COHERENT_BIT 0x0080
+#  endif
+#endif
+// Direct state access and indirect draws, see NVG_DIRECT_STATE_ACCESS.
+#if defined GL_VERSION_4_5
+#  define NANOVG_GL_HAS_DSA 1
+#endif
+// Vertex arrays whose vertex format was set with direct state access, see glnvg__dsaVertexBuffer.
+#define NANOVG_GL_DSA_FORMATS 8
+#define NANOVG_GL_DSA_INIT_COMMANDS 1024
+// Stencilling fills with the path renderer, see NVG_PATH_RENDERING. Path objects are reused
+// round robin, so that respecifying one doesn't wait on the fill drawn with it before.
+#if defined GL_NV_path_rendering
+#  define NANOVG_GL_HAS_PATH_RENDERING 1
+#endif
+#define NANOVG_GL_PATH_OBJECTS 16
+
+struct GLNVGvertexFormat
+{
+   GLuint vertArr;
+   int packed;
+};
+typedef struct GLNVGvertexFormat GLNVGvertexFormat;
+
+// Layout of the commands read by glMultiDrawArraysIndirect().
+struct GLNVGdrawCommand
+{
+   GLuint count;
+   GLuint instanceCount;
+   GLuint first;
+   GLuint baseInstance;
+};
+typedef struct GLNVGdrawCommand GLNVGdrawCommand;
+
+struct GLNVGringSlot
+{
+   GLuint vertBuf;
+   GLuint fragBuf;
+   int vertCapacity;		// in bytes
+   int fragCapacity;		// in bytes
+   void * vertMap;			// persistent mapping, or NULL
+   void * fragMap;
+   GLsync fence;
+};
+typedef struct GLNVGringSlot GLNVGringSlot;
+
+// One instanced quad: corner, the two edge vectors from it and the texture rectangle.
+struct GLNVGquad
+{
+   float pos[4];		// corner x,y and first edge
+   float edge[2];		// second edge
+   float uv[4];		// texture coordinates at the corner and at the opposite corner
+   int paint;			// paint index when merging calls
+};
+typedef struct GLNVGquad GLNVGquad;
+
+// A row of images of about the same height along the top of an atlas page.
+struct GLNVGatlasShelf
+{
+   int y, h;
+   int x;				// first free column
+};
+typedef struct GLNVGatlasShelf GLNVGatlasShelf;
+
+struct GLNVGatlasPage
+{
+   GLuint tex;
+   int refs;			// images on the page, its space is reused once they are all deleted
+   int top;			// first row no shelf uses
+   GLNVGatlasShelf shelves[NANOVG_GL_ATLAS_MAX_SHELVES];
+   int nshelves;
+};
+typedef struct GLNVGatlasPage GLNVGatlasPage;
+
+// A texture update waiting for the next flush, its pixels are packed into the staging bytes.
+struct GLNVGupload
+{
+   int image;
+   int x, y, w, h;
+   int offset;
+};
+typedef struct GLNVGupload GLNVGupload;
+#endif
+
+// Vertex of NVG_PACKED_VERTICES, the position in steps of 1 / NANOVG_GL_PACKED_SUBPIXELS pixels.
+struct GLNVGpackedVertex
+{
+   short x, y;
+   short u, v;
+};
+typedef struct GLNVGpackedVertex GLNVGpackedVertex;
+#define NANOVG_GL_PACKED_SUBPIXELS 8.0f
+
 struct GLNVGshader
 {
    GLuint prog;
    GLuint frag;
    GLuint vert;
    GLint loc[GLNVG_MAX_LOCS];
+   int flush;		// flush whose view and texture unit were set, see glnvg__useProgram
 };
 typedef struct GLNVGshader GLNVGshader;
 
@@ -146,6 +481,21 @@ struct GLNVGtexture
    int width, height;
    int type;
    int flags;
+   int page;			// atlas page index + 1, 0 if the image has its own texture
+   int x, y;			// position on the atlas page
+   int compressed;		// NVGcompressedFormat of the data, 0 if uncompressed
+   size_t bytes;		// video memory of the own texture, 0 for atlas images and foreign handles
+   int nextFree;		// index + 1 of the next free slot while this one is free
+   int mipQueued;		// waiting in the mipmap queue
+   int mipReady;		// levels were generated at least once and are sampled
+   int mipFlush;		// flush the levels were last generated in
+   int mipInterval;		// flushes between generations after updates, -1 for never again
+#if defined NANOVG_GL3
+   GLuint streamBufs[2];	// pixel unpack buffers of unbatched updates, used in turn
+   int streamSizes[2];
+   int streamIndex;
+   int streamMapped;	// the buffer at streamIndex is mapped by nvglMapImage()
+#endif
 };
 typedef struct GLNVGtexture GLNVGtexture;
 
@@ -156,6 +506,9 @@ enum GLNVGcallType
    GLNVG_CONVEXFILL,
    GLNVG_STROKE,
    GLNVG_TRIANGLES,
+   GLNVG_SHAPE,
+   GLNVG_QUADS,
+   GLNVG_PLOT,
 };
 
 struct GLNVGcall
@@ -167,6 +520,24 @@ struct GLNVGcall
    int triangleOffset;
    int triangleCount;
    int uniformOffset;
+   int mergeCount;		// number of calls drawn by this call's merged draw, 0 if not merged
+   int indexOffset;
+   int indexCount;
+   int quadOffset;
+   int quadCount;		// for merged quad calls, the quads of the whole run
+   GLuint texture;		// resolved from image when merging
+   int fillTriangles;	// convex fill whose fill is a triangle list instead of fans
+   int stencilStroke;	// stroke drawn with the stencil passes of NVG_STENCIL_STROKES
+   int plotOffset;		// into the plot draws of the frame
+   int clipped;		// drawn under a hardware scissor, see NVG_HARDWARE_SCISSOR
+   int clip[4];		// its framebuffer rectangle, x and y from the top left
+   int commandOffset;	// path commands and coordinates of a fill stencilled with NVG_PATH_RENDERING
+   int commandCount;	// 0 for fans
+   int coordOffset;
+   int coordCount;
+   int instanced;		// draws a shape shared with other calls, see NVG_INSTANCE_SHAPES
+   float offset[2];		// of the call to the vertices of the shape
+   int instanceOffset;	// for the first call of a run of instances, into the instances of the frame
 };
 typedef struct GLNVGcall GLNVGcall;
 
@@ -195,10 +566,12 @@ struct GLNVGfragUniforms
    float strokeThr;
    int texType;
    int type;
+   float shape[4];		// half extents, radius and coverage scale of an analytic shape, see renderShape
+   float texRect[4];	// texel center bounds of an image packed into an atlas page
 #else
    // note: after modifying layout or size of uniform array,
    // don't forget to also update the fragment shader source!
-#define NANOVG_GL_UNIFORMARRAY_SIZE 11
+#define NANOVG_GL_UNIFORMARRAY_SIZE 13
    union
    {
       struct
@@ -216,6 +589,8 @@ struct GLNVGfragUniforms
          float strokeThr;
          float texType;
          float type;
+         float shape[4];
+         float texRect[4];
       };
       float uniformArray[NANOVG_GL_UNIFORMARRAY_SIZE][4];
    };
@@ -223,23 +598,230 @@ struct GLNVGfragUniforms
 };
 typedef struct GLNVGfragUniforms GLNVGfragUniforms;
 
+#if defined NANOVG_GL3
+// Samples of a plot live in a ring inside a single channel float texture, NANOVG_GL_PLOT_ROW
+// samples per row, and are only written where they were appended.
+#define NANOVG_GL_PLOT_ROW 1024
+#define NANOVG_GL_PLOT_VEC4S 11
+
+struct GLNVGplot
+{
+   GLuint tex;			// 0 while the slot is free
+   int capacity;
+   int head;			// ring position of the next sample
+   int count;
+};
+typedef struct GLNVGplot GLNVGplot;
+
+// Uniforms of a plot draw as vec4s: scissor matrix (3), scissor extent and scale, xform (2, the second
+// one with half the stroke width and the fringe), rectangle, range, ring start and count, capacity,
+// stroke and fill color. Ring start, count and capacity are filled in at flush time.
+struct GLNVGplotDraw
+{
+   int plot;
+   float uniforms[NANOVG_GL_PLOT_VEC4S * 4];
+};
+typedef struct GLNVGplotDraw GLNVGplotDraw;
+
+// Backdrops blur through levels half the size of each other, level 1 being the image of the
+// backdrop and the others textures kept across frames, grown in steps of this many pixels.
+#define NANOVG_GL_BLUR_LEVELS 7
+#define NANOVG_GL_BLUR_STEP 64
+
+struct GLNVGblurLevel
+{
+   GLuint tex;
+   GLuint fbo;
+   int width, height;	// of the texture, 0 until first used
+};
+typedef struct GLNVGblurLevel GLNVGblurLevel;
+
+// Call whose geometry a later call of the flush may share, see NVG_INSTANCE_SHAPES.
+struct GLNVGshapeEntry
+{
+   unsigned int hash;	// of the vertices relative to the first one and the path layout
+   unsigned int frame;	// entry is valid while it equals the context's paint frame
+   int call;
+};
+typedef struct GLNVGshapeEntry GLNVGshapeEntry;
+
+// One call of a run drawing a shared shape.
+struct GLNVGinstance
+{
+   float offset[2];
+   int paint;
+};
+typedef struct GLNVGinstance GLNVGinstance;
+#endif
+
+// Everything glnvg__convertPaint() and the call type put into the uniform slots of a call.
+struct GLNVGpaintKey
+{
+   NVGpaint paint;
+   NVGscissor scissor;
+   float width;
+   float fringe;
+   float shape[4];
+   int type;
+};
+typedef struct GLNVGpaintKey GLNVGpaintKey;
+
+struct GLNVGpaintEntry
+{
+   GLNVGpaintKey key;
+   unsigned int hash;
+   unsigned int frame;	// entry is valid while it equals the context's paint frame
+   int uniformOffset;
+};
+typedef struct GLNVGpaintEntry GLNVGpaintEntry;
+
 struct GLNVGcontext
 {
    GLNVGshader shader;
    GLNVGtexture * textures;
    float view[2];
+   float pixelRatio;		// framebuffer pixels per view unit
    int ntextures;
    int ctextures;
    int textureId;
+   int freeTextures;		// index + 1 of the first free slot, 0 if none
+   size_t textureBytes;	// video memory of all textures, atlas pages included
+   int * mipQueue;		// images whose mipmaps are to be generated, see glnvg__generateMipmaps
+   int nmipQueue;
+   int cmipQueue;
+   int mipBudget;		// texels of level 0 to generate mipmaps for per flush, 0 for no limit
+   int flushes;
+   int layerFlushed;		// calls were drawn this frame when a layer began or ended, the counters keep them
+#if defined NANOVG_GL_HAS_LAYERS
+   GLNVGlayerTarget layerTargets[NANOVG_GL_LAYER_TARGETS];
+   GLNVGlayerScope layerStack[NANOVG_GL_MAX_LAYER_DEPTH];
+   int nlayerStack;
+#endif
    GLuint vertBuf;
+   int compressedFormats;	// bit per NVGcompressedFormat the driver can sample
 #if defined NANOVG_GL3
    GLuint vertArr;
+   GLuint windowVertArr;	// vertex array of the window drawing now, 0 for vertArr
+   GLNVGringSlot ring[NANOVG_GL_RING_SIZE];
+   int ringEnabled;
+   int ringPersistent;
+   int ringIndex;
+   int ringBegun;
+   GLuint drawVertBuf;		// buffer the vertices of the current flush live in
+   // Direct state access
+   int dsaEnabled;
+   int vertBufSize;		// immutable storage of vertBuf and fragBuf, in bytes
+   int fragBufSize;
+   GLNVGvertexFormat formats[NANOVG_GL_DSA_FORMATS];
+   int nextFormat;
+   GLuint indirectBuf;
+   int indirectBufSize;
+   GLNVGdrawCommand * commands;	// fill and stroke command of every path
+   int ccommands;
+   int drawIndirect;		// the commands of the current flush are bound
+   // Path rendering
+   int pathRendering;
+   GLuint pathObjects;		// first of NANOVG_GL_PATH_OBJECTS names
+   int nextPathObject;
+   int pathFlush;		// flush the path matrices were last loaded in
+   GLubyte * pathCommands;	// of the fills of the flush
+   int npathCommands;
+   int cpathCommands;
+   float * pathCoords;
+   int npathCoords;
+   int cpathCoords;
 #endif
 #if NANOVG_GL_USE_UNIFORMBUFFER
    GLuint fragBuf;
+   GLuint drawFragBuf;		// buffer the uniforms of the current flush live in
 #endif
    int fragSize;
    int flags;
+   int clipped;		// state of the hardware scissor while flushing, see glnvg__setClip
+   int clip[4];
+   int edgeAA;		// fringe passes are drawn, NVG_ANTIALIAS unless switched off by nvgEdgeAntiAlias()
+   int issuedDraws;
+   int vertexBytes;
+   int uniformBytes;
+   int textureBinds;
+   int stencilPasses;
+   NVGframeMemory memory;	// per frame buffer use of the last flush
+   NVGLprofileCallback profile;
+   void * profileUser;
+#if defined NANOVG_GL3
+   // Call merging
+   int merge;
+   GLNVGshader mergeShader;	// reads the paints of merged calls from the paint buffer
+   int callBase;
+   int paintPass;
+   GLuint paintIdxBuf;
+   GLuint indexBuf;
+   GLuint paintBuf;
+   GLuint paintTex;
+   int * paintIdx;
+   int cpaintIdx;
+   GLuint * indices;
+   int cindices;
+   int nindices;
+   float * paints;
+   int cpaints;
+   // Instanced quads
+   int quadsEnabled;
+   int quadMode;
+   // Image atlas
+   int atlasEnabled;
+   GLNVGatlasPage * pages;
+   int npages;
+   int cpages;
+   GLuint quadBuf;
+   GLNVGquad * quads;
+   int cquads;
+   int nquads;
+   // Shape instancing
+   int instancesEnabled;
+   GLNVGshapeEntry * shapes;	// open addressed by hash
+   int cshapes;
+   int nshapes;
+   GLuint instanceBuf;
+   GLNVGinstance * instances;
+   int cinstances;
+   int ninstances;
+   // Call reordering
+   GLNVGcall * sortedCalls;
+   int csortedCalls;
+   GLNVGquad * sortedQuads;
+   int csortedQuads;
+   float * callBounds;
+   int * callOrder;
+   int ccallOrder;
+   // Batched texture uploads
+   int uploadsEnabled;
+   GLNVGupload * uploads;
+   int cuploads;
+   int nuploads;
+   // Plots
+   GLNVGshader plotShader;
+   signed char plotState;	// 1 once the shader is built, -1 if that failed, 0 before first use
+   const char * plotSources[2];
+   GLNVGplot * plots;
+   int cplots;
+   GLNVGplotDraw * plotDraws;
+   int cplotDraws;
+   int nplotDraws;
+   // Backdrops
+   GLNVGshader blurShader;
+   signed char blurState;	// as plotState
+   const char * blurSources[2];
+   GLNVGblurLevel blurLevels[NANOVG_GL_BLUR_LEVELS];
+   GLuint backdropFbo;	// renders into the image of a backdrop
+   unsigned char * uploadData;
+   int cuploadData;
+   int nuploadData;
+   GLuint uploadBufs[NANOVG_GL_RING_SIZE];
+   int uploadCapacity[NANOVG_GL_RING_SIZE];
+   GLsync uploadFences[NANOVG_GL_RING_SIZE];
+   int uploadIndex;
+#endif
 
    // Per frame buffers
    GLNVGcall * calls;
@@ -248,29 +830,65 @@ struct GLNVGcontext
    GLNVGpath * paths;
    int cpaths;
    int npaths;
+   // verts and uniforms point either to the heap arrays below or, while streaming
+   // through a persistently mapped ring slot, straight into GPU visible memory.
    struct NVGvertex * verts;
    int cverts;
    int nverts;
+   int vertsMapped;
+   struct NVGvertex * vertHeap;
+   int cvertHeap;
    unsigned char * uniforms;
    int cuniforms;
    int nuniforms;
+   int uniformsMapped;
+   unsigned char * uniformHeap;
+   int cuniformHeap;
+   GLint * multiFirst;	// ranges of glnvg__drawPaths
+   GLsizei * multiCount;
+   int cmulti;
+   GLNVGpackedVertex * packedVerts;	// verts converted for upload, see NVG_PACKED_VERTICES
+   int cpackedVerts;
+   int vertsPacked;		// the current flush draws from packedVerts
+   // Uniform slots of the paints converted this frame, open addressed by key hash
+   GLNVGpaintEntry * paintCache;
+   int cpaintCache;
+   int npaintCache;
+   unsigned int paintFrame;
+   int fragOffset;		// uniform slot last bound by glnvg__setUniforms, -1 if none
+   // Shader variants, see NVG_SHADER_VARIANTS. Their keys are taken per uniform slot before the
+   // uniforms are uploaded, since a mapped ring slot is not readable once it was flushed.
+   GLNVGshader * program;	// bound during a flush
+   GLNVGshader variants[GLNVG_VARIANTS];
+   signed char variantState[GLNVG_VARIANTS];	// 1 once built, -1 if that failed
+   int variantsEnabled;
+   unsigned char * variantKeys;
+   int cvariantKeys;
+   int useVariants;		// keys of the current flush are valid
+   const char * shaderHeader;
+   const char * vertShader;
+   const char * fragShader;
+   char * programCache;	// directory of program binaries, NULL for none
 
-   // cached state
-#if NANOVG_GL_USE_STATE_FILTER
-   GLuint boundTexture;
-   GLuint stencilMask;
-   GLenum stencilFunc;
-   GLint stencilFuncRef;
-   GLuint stencilFuncMask;
-#endif
+   // cached state, see NVGglState
+   NVGglState ownState;
+   NVGglState * state;		// ownState unless shared with nvglShareState()
 };
 typedef struct GLNVGcontext GLNVGcontext;
 
+// Program binary directory of contexts created next, see nvglSetProgramCache().
+static const char * glnvg__programCacheDir = NULL;
+
 static int glnvg__maxi (int a, int b)
 {
    return a > b ? a : b;
 }
 
+static int glnvg__mini (int a, int b)
+{
+   return a < b ? a : b;
+}
+
 #ifdef NANOVG_GLES2
 static unsigned int glnvg__nearestPow2 (unsigned int num)
 {
@@ -285,63 +903,180 @@ static unsigned int glnvg__nearestPow2 (unsigned int num)
 }
 #endif
 
-static void glnvg__bindTexture (GLNVGcontext * gl, GLuint tex)
+// Whether the shadowed state of bit is known to be current, see NVGglState. Setting state goes
+// through the functions below, which skip the GL call when it is and mark it known after.
+static int glnvg__known (GLNVGcontext * gl, unsigned int bit)
 {
 #if NANOVG_GL_USE_STATE_FILTER
-   if (gl->boundTexture != tex)
-   {
-      gl->boundTexture = tex;
-      glBindTexture (GL_TEXTURE_2D, tex);
-   }
+   return (gl->state->known & bit) != 0;
 #else
-   glBindTexture (GL_TEXTURE_2D, tex);
+   NVG_NOTUSED (gl);
+   NVG_NOTUSED (bit);
+   return 0;
 #endif
 }
 
-static void glnvg__stencilMask (GLNVGcontext * gl, GLuint mask)
+static void glnvg__enable (GLNVGcontext * gl, GLenum cap, int on)
 {
-#if NANOVG_GL_USE_STATE_FILTER
-   if (gl->stencilMask != mask)
+   NVGglState * state = gl->state;
+   GLboolean * value;
+   unsigned int bit;
+   switch (cap)
    {
-      gl->stencilMask = mask;
-      glStencilMask (mask);
+      case GL_BLEND: value = &state->blend; bit = NVG_GL_BLEND; break;
+      case GL_CULL_FACE: value = &state->cullFaceEnabled; bit = NVG_GL_CULL_FACE; break;
+      case GL_DEPTH_TEST: value = &state->depthTest; bit = NVG_GL_DEPTH_TEST; break;
+      case GL_SCISSOR_TEST: value = &state->scissorTest; bit = NVG_GL_SCISSOR_TEST; break;
+      default: value = &state->stencilTest; bit = NVG_GL_STENCIL_TEST; break;
    }
-#else
-   glStencilMask (mask);
+   on = on != 0;
+   if (glnvg__known (gl, bit) && *value == on) return;
+   if (on)
+      glEnable (cap);
+   else
+      glDisable (cap);
+   *value = (GLboolean)on;
+   state->known |= bit;
+}
+
+static void glnvg__useProgramHandle (GLNVGcontext * gl, GLuint prog)
+{
+   if (glnvg__known (gl, NVG_GL_PROGRAM) && gl->state->program == prog) return;
+   glUseProgram (prog);
+   gl->state->program = prog;
+   gl->state->known |= NVG_GL_PROGRAM;
+}
+
+#if defined NANOVG_GL3
+static void glnvg__bindVertexArray (GLNVGcontext * gl, GLuint vertArr)
+{
+   if (glnvg__known (gl, NVG_GL_VERTEX_ARRAY) && gl->state->vertexArray == vertArr) return;
+   glBindVertexArray (vertArr);
+   gl->state->vertexArray = vertArr;
+   gl->state->known |= NVG_GL_VERTEX_ARRAY;
+}
 #endif
+
+static void glnvg__activeTexture (GLNVGcontext * gl, GLenum unit)
+{
+   if (glnvg__known (gl, NVG_GL_ACTIVE_TEXTURE) && gl->state->activeTexture == unit) return;
+   glActiveTexture (unit);
+   gl->state->activeTexture = unit;
+   gl->state->known |= NVG_GL_ACTIVE_TEXTURE;
+}
+
+// Binds a 2D texture to unit 0, the one NanoVG samples images from.
+static void glnvg__bindTexture (GLNVGcontext * gl, GLuint tex)
+{
+   glnvg__activeTexture (gl, GL_TEXTURE0);
+   if (glnvg__known (gl, NVG_GL_TEXTURE) && gl->state->texture == tex) return;
+   glBindTexture (GL_TEXTURE_2D, tex);
+   gl->state->texture = tex;
+   gl->state->known |= NVG_GL_TEXTURE;
+   gl->textureBinds++;
+}
+
+// Deleting a bound texture binds 0 in its place.
+static void glnvg__forgetTexture (GLNVGcontext * gl, GLuint tex)
+{
+   if (gl->state->texture == tex)
+      gl->state->texture = 0;
+}
+
+static void glnvg__blendFunc (GLNVGcontext * gl, GLenum src, GLenum dst)
+{
+   NVGglState * state = gl->state;
+   if (glnvg__known (gl, NVG_GL_BLEND_FUNC) && state->blendSrc == src && state->blendDst == dst) return;
+   glBlendFunc (src, dst);
+   state->blendSrc = src;
+   state->blendDst = dst;
+   state->known |= NVG_GL_BLEND_FUNC;
+}
+
+static void glnvg__cullMode (GLNVGcontext * gl, GLenum cullFace, GLenum frontFace)
+{
+   NVGglState * state = gl->state;
+   if (glnvg__known (gl, NVG_GL_CULL_MODE) && state->cullFace == cullFace && state->frontFace == frontFace) return;
+   glCullFace (cullFace);
+   glFrontFace (frontFace);
+   state->cullFace = cullFace;
+   state->frontFace = frontFace;
+   state->known |= NVG_GL_CULL_MODE;
+}
+
+static void glnvg__colorMask (GLNVGcontext * gl, int on)
+{
+   on = on != 0;
+   if (glnvg__known (gl, NVG_GL_COLOR_MASK) && gl->state->colorMask == on) return;
+   glColorMask ((GLboolean)on, (GLboolean)on, (GLboolean)on, (GLboolean)on);
+   gl->state->colorMask = (GLboolean)on;
+   gl->state->known |= NVG_GL_COLOR_MASK;
+}
+
+static void glnvg__stencilMask (GLNVGcontext * gl, GLuint mask)
+{
+   if (glnvg__known (gl, NVG_GL_STENCIL_MASK) && gl->state->stencilMask == mask) return;
+   glStencilMask (mask);
+   gl->state->stencilMask = mask;
+   gl->state->known |= NVG_GL_STENCIL_MASK;
 }
 
 static void glnvg__stencilFunc (GLNVGcontext * gl, GLenum func, GLint ref, GLuint mask)
 {
-#if NANOVG_GL_USE_STATE_FILTER
-   if ((gl->stencilFunc != func) ||
-         (gl->stencilFuncRef != ref) ||
-         (gl->stencilFuncMask != mask))
-   {
-      gl->stencilFunc = func;
-      gl->stencilFuncRef = ref;
-      gl->stencilFuncMask = mask;
-      glStencilFunc (func, ref, mask);
-   }
-#else
+   NVGglState * state = gl->state;
+   if (glnvg__known (gl, NVG_GL_STENCIL_FUNC) && state->stencilFunc == func && state->stencilRef == ref &&
+         state->stencilFuncMask == mask)
+      return;
    glStencilFunc (func, ref, mask);
-#endif
+   state->stencilFunc = func;
+   state->stencilRef = ref;
+   state->stencilFuncMask = mask;
+   state->known |= NVG_GL_STENCIL_FUNC;
+}
+
+// Stencil operations of the front faces, face 0, and back faces, face 1.
+static void glnvg__stencilOpSeparate (GLNVGcontext * gl, int face, GLenum fail, GLenum zfail, GLenum zpass)
+{
+   GLenum * op = gl->state->stencilOp[face];
+   if (glnvg__known (gl, NVG_GL_STENCIL_OP) && op[0] == fail && op[1] == zfail && op[2] == zpass) return;
+   glStencilOpSeparate (face == 0 ? GL_FRONT : GL_BACK, fail, zfail, zpass);
+   op[0] = fail;
+   op[1] = zfail;
+   op[2] = zpass;
+   // The bit stays unset until glnvg__stencilOp() sets both faces.
+}
+
+static void glnvg__stencilOp (GLNVGcontext * gl, GLenum fail, GLenum zfail, GLenum zpass)
+{
+   NVGglState * state = gl->state;
+   if (glnvg__known (gl, NVG_GL_STENCIL_OP) && state->stencilOp[0][0] == fail && state->stencilOp[0][1] == zfail &&
+         state->stencilOp[0][2] == zpass && state->stencilOp[1][0] == fail && state->stencilOp[1][1] == zfail &&
+         state->stencilOp[1][2] == zpass)
+      return;
+   glStencilOp (fail, zfail, zpass);
+   state->stencilOp[0][0] = state->stencilOp[1][0] = fail;
+   state->stencilOp[0][1] = state->stencilOp[1][1] = zfail;
+   state->stencilOp[0][2] = state->stencilOp[1][2] = zpass;
+   state->known |= NVG_GL_STENCIL_OP;
 }
 
+// Image handles hold the index + 1 of their slot in the low bits and a serial above them, so a slot
+// is found without searching and handles of deleted images do not match the slot's next image.
+#define NANOVG_GL_SLOT_BITS 20
+#define NANOVG_GL_SLOT_MASK ((1 << NANOVG_GL_SLOT_BITS) - 1)
+#define NANOVG_GL_MAX_SERIAL ((1 << (31 - NANOVG_GL_SLOT_BITS)) - 1)
+
 static GLNVGtexture * glnvg__allocTexture (GLNVGcontext * gl)
 {
    GLNVGtexture * tex = NULL;
-   int i;
-   for (i = 0; i < gl->ntextures; i++)
+   if (gl->freeTextures != 0)
    {
-      if (gl->textures[i].id == 0)
-      {
-         tex = &gl->textures[i];
-         break;
-      }
+      tex = &gl->textures[gl->freeTextures - 1];
+      gl->freeTextures = tex->nextFree;
    }
-   if (tex == NULL)
+   else
    {
+      if (gl->ntextures >= NANOVG_GL_SLOT_MASK) return NULL;
       if (gl->ntextures + 1 > gl->ctextures)
       {
          GLNVGtexture * textures;
@@ -354,33 +1089,55 @@ static GLNVGtexture * glnvg__allocTexture (GLNVGcontext * gl)
       tex = &gl->textures[gl->ntextures++];
    }
    memset (tex, 0, sizeof (*tex));
-   tex->id = ++gl->textureId;
+   gl->textureId = gl->textureId % NANOVG_GL_MAX_SERIAL + 1;
+   tex->id = (gl->textureId << NANOVG_GL_SLOT_BITS) | (int) (tex - gl->textures + 1);
    return tex;
 }
 
 static GLNVGtexture * glnvg__findTexture (GLNVGcontext * gl, int id)
 {
-   int i;
-   for (i = 0; i < gl->ntextures; i++)
-      if (gl->textures[i].id == id)
-         return &gl->textures[i];
-   return NULL;
+   int i = (id & NANOVG_GL_SLOT_MASK) - 1;
+   if (id <= 0 || i < 0 || i >= gl->ntextures || gl->textures[i].id != id)
+      return NULL;
+   return &gl->textures[i];
 }
 
 static int glnvg__deleteTexture (GLNVGcontext * gl, int id)
 {
-   int i;
-   for (i = 0; i < gl->ntextures; i++)
+   GLNVGtexture * tex = glnvg__findTexture (gl, id);
+   if (tex == NULL)
+      return 0;
+#if defined NANOVG_GL3
+   if (tex->streamBufs[0] != 0 || tex->streamBufs[1] != 0)
+      glDeleteBuffers (2, tex->streamBufs);
+   if (tex->page != 0)
    {
-      if (gl->textures[i].id == id)
+      GLNVGatlasPage * page = &gl->pages[tex->page - 1];
+      if (--page->refs == 0)
       {
-         if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
-            glDeleteTextures (1, &gl->textures[i].tex);
-         memset (&gl->textures[i], 0, sizeof (gl->textures[i]));
-         return 1;
+         page->top = 0;
+         page->nshelves = 0;
       }
    }
-   return 0;
+   else
+#endif
+   if (tex->tex != 0 && (tex->flags & NVG_IMAGE_NODELETE) == 0)
+   {
+      glnvg__forgetTexture (gl, tex->tex);
+      glDeleteTextures (1, &tex->tex);
+   }
+   gl->textureBytes -= tex->bytes;
+   memset (tex, 0, sizeof (*tex));
+   tex->nextFree = gl->freeTextures;
+   gl->freeTextures = (int) (tex - gl->textures + 1);
+   return 1;
+}
+
+// Bytes of a w x h texture of type, a third more with mipmaps.
+static size_t glnvg__textureBytes (int type, int w, int h, int imageFlags)
+{
+   size_t bytes = (size_t)w * h * (type == NVG_TEXTURE_RGBA ? 4 : 1);
+   return (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS) ? bytes + bytes / 3 : bytes;
 }
 
 static void glnvg__dumpShaderError (GLuint shader, const char * name, const char * type)
@@ -415,18 +1172,131 @@ static void glnvg__checkError (GLNVGcontext * gl, const char * str)
    }
 }
 
-static int glnvg__createShader (GLNVGshader * shader, const char * name, const char * header, const char * opts, const char * vshader, const char * fshader)
+#if NANOVG_GL_HAS_PROGRAM_BINARY
+static int glnvg__hasProgramBinary (void)
+{
+   GLint formats = 0;
+#if !defined NANOVG_GLES3
+   GLint major = 0, minor = 0, n = 0, i;
+   int supported;
+   glGetIntegerv (GL_MAJOR_VERSION, &major);
+   glGetIntegerv (GL_MINOR_VERSION, &minor);
+   supported = major > 4 || (major == 4 && minor >= 1);
+   glGetIntegerv (GL_NUM_EXTENSIONS, &n);
+   for (i = 0; i < n && !supported; i++)
+   {
+      const char * ext = (const char *)glGetStringi (GL_EXTENSIONS, i);
+      supported = ext != NULL && strcmp (ext, "GL_ARB_get_program_binary") == 0;
+   }
+   if (!supported) return 0;
+#endif
+   glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+   return formats > 0;
+}
+
+static unsigned long long glnvg__hashSource (unsigned long long h, const char * str)
+{
+   // FNV-1a, the sources are hashed in one go with a separator between them.
+   for (; str != NULL && *str != '\0'; str++)
+      h = (h ^ (unsigned char)*str) * 1099511628211ull;
+   return (h ^ 0xff) * 1099511628211ull;
+}
+
+// Cache file of a program, NULL if the path does not fit.
+static const char * glnvg__programPath (char * path, int size, const char * cache, const char ** str, int nstr)
+{
+   unsigned long long h = 14695981039346656037ull;
+   int i;
+   h = glnvg__hashSource (h, (const char *)glGetString (GL_RENDERER));
+   h = glnvg__hashSource (h, (const char *)glGetString (GL_VERSION));
+   for (i = 0; i < nstr; i++)
+      h = glnvg__hashSource (h, str[i]);
+   i = snprintf (path, size, "%s/nanovg-%016llx.bin", cache, h);
+   return i > 0 && i < size ? path : NULL;
+}
+
+// Program linked from a cached binary, 0 if there is none or the driver rejects it.
+static GLuint glnvg__loadProgram (const char * path)
+{
+   FILE * f = fopen (path, "rb");
+   GLenum format = 0;
+   GLint status = GL_FALSE;
+   GLuint prog = 0;
+   long size = 0;
+   void * data = NULL;
+   if (f == NULL) return 0;
+   if (fseek (f, 0, SEEK_END) == 0)
+      size = ftell (f) - (long)sizeof (format);
+   if (size > 0 && fseek (f, 0, SEEK_SET) == 0)
+      data = malloc (size);
+   if (data != NULL && fread (&format, sizeof (format), 1, f) == 1 && fread (data, size, 1, f) == 1)
+   {
+      prog = glCreateProgram();
+      glProgramBinary (prog, format, data, (GLsizei)size);
+      glGetProgramiv (prog, GL_LINK_STATUS, &status);
+      if (status != GL_TRUE)
+      {
+         glDeleteProgram (prog);
+         prog = 0;
+      }
+   }
+   free (data);
+   fclose (f);
+   return prog;
+}
+
+static void glnvg__saveProgram (GLuint prog, const char * path)
+{
+   GLint size = 0;
+   GLenum format = 0;
+   void * data;
+   FILE * f;
+   glGetProgramiv (prog, GL_PROGRAM_BINARY_LENGTH, &size);
+   if (size <= 0) return;
+   data = malloc (size);
+   if (data == NULL) return;
+   glGetProgramBinary (prog, size, NULL, &format, data);
+   f = fopen (path, "wb");
+   if (f != NULL)
+   {
+      // A partly written file is rejected by the size check or the driver on the next load.
+      fwrite (&format, sizeof (format), 1, f);
+      fwrite (data, size, 1, f);
+      fclose (f);
+   }
+   free (data);
+}
+#endif
+
+// Compiles and links a program, or loads it from the binaries in cache unless that is NULL.
+static int glnvg__createShader (GLNVGshader * shader, const char * name, const char * header, const char * opts, const char * vshader, const char * fshader, const char * cache)
 {
    GLint status;
    GLuint prog, vert, frag;
-   const char * str[3];
+   const char * str[4];
+#if NANOVG_GL_HAS_PROGRAM_BINARY
+   char buf[1024];
+   const char * path = NULL;
+#endif
    str[0] = header;
    str[1] = opts != NULL ? opts : "";
+   str[2] = vshader;
+   str[3] = fshader;
    memset (shader, 0, sizeof (*shader));
+#if NANOVG_GL_HAS_PROGRAM_BINARY
+   if (cache != NULL)
+   {
+      path = glnvg__programPath (buf, sizeof (buf), cache, str, 4);
+      shader->prog = path != NULL ? glnvg__loadProgram (path) : 0;
+      if (shader->prog != 0)
+         return 1;
+   }
+#else
+   (void)cache;
+#endif
    prog = glCreateProgram();
    vert = glCreateShader (GL_VERTEX_SHADER);
    frag = glCreateShader (GL_FRAGMENT_SHADER);
-   str[2] = vshader;
    glShaderSource (vert, 3, str, 0);
    str[2] = fshader;
    glShaderSource (frag, 3, str, 0);
@@ -448,6 +1318,17 @@ static int glnvg__createShader (GLNVGshader * shader, const char * name, const c
    glAttachShader (prog, frag);
    glBindAttribLocation (prog, 0, "vertex");
    glBindAttribLocation (prog, 1, "tcoord");
+   glBindAttribLocation (prog, 2, "paintIdx");
+   glBindAttribLocation (prog, 3, "quadPos");
+   glBindAttribLocation (prog, 4, "quadEdge");
+   glBindAttribLocation (prog, 5, "quadUV");
+   glBindAttribLocation (prog, 6, "quadPaint");
+   glBindAttribLocation (prog, 7, "instOffset");
+   glBindAttribLocation (prog, 8, "instPaint");
+#if NANOVG_GL_HAS_PROGRAM_BINARY
+   if (path != NULL)
+      glProgramParameteri (prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
    glLinkProgram (prog);
    glGetProgramiv (prog, GL_LINK_STATUS, &status);
    if (status != GL_TRUE)
@@ -458,6 +1339,10 @@ static int glnvg__createShader (GLNVGshader * shader, const char * name, const c
    shader->prog = prog;
    shader->vert = vert;
    shader->frag = frag;
+#if NANOVG_GL_HAS_PROGRAM_BINARY
+   if (path != NULL)
+      glnvg__saveProgram (prog, path);
+#endif
    return 1;
 }
 
@@ -475,6 +1360,15 @@ static void glnvg__getUniforms (GLNVGshader * shader)
 {
    shader->loc[GLNVG_LOC_VIEWSIZE] = glGetUniformLocation (shader->prog, "viewSize");
    shader->loc[GLNVG_LOC_TEX] = glGetUniformLocation (shader->prog, "tex");
+   shader->loc[GLNVG_LOC_PAINTS] = glGetUniformLocation (shader->prog, "paints");
+   shader->loc[GLNVG_LOC_PAINTPASS] = glGetUniformLocation (shader->prog, "paintPass");
+   shader->loc[GLNVG_LOC_QUADS] = glGetUniformLocation (shader->prog, "quads");
+   shader->loc[GLNVG_LOC_INSTANCES] = glGetUniformLocation (shader->prog, "instances");
+   shader->loc[GLNVG_LOC_PLOT] = glGetUniformLocation (shader->prog, "plot");
+   shader->loc[GLNVG_LOC_PLOTPASS] = glGetUniformLocation (shader->prog, "plotPass");
+   shader->loc[GLNVG_LOC_VERTEXSCALE] = glGetUniformLocation (shader->prog, "vertexScale");
+   shader->loc[GLNVG_LOC_BLURREGION] = glGetUniformLocation (shader->prog, "blurRegion");
+   shader->loc[GLNVG_LOC_BLURPASS] = glGetUniformLocation (shader->prog, "blurPass");
 #if NANOVG_GL_USE_UNIFORMBUFFER
    shader->loc[GLNVG_LOC_FRAG] = glGetUniformBlockIndex (shader->prog, "frag");
 #else
@@ -482,38 +1376,467 @@ static void glnvg__getUniforms (GLNVGshader * shader)
 #endif
 }
 
-static int glnvg__renderCreate (void * uptr)
+// Converts the vertices of the flush for NVG_PACKED_VERTICES, returns 0 if one of them doesn't fit.
+static int glnvg__packVerts (GLNVGcontext * gl)
 {
-   GLNVGcontext * gl = (GLNVGcontext *)uptr;
-   int align = 4;
-   // TODO: mediump float may not be enough for GLES2 in iOS.
-   // see the following discussion: https://github.com/memononen/nanovg/issues/46
-   static const char * shaderHeader =
-#if defined NANOVG_GL2
-      "#define NANOVG_GL2 1\n"
-#elif defined NANOVG_GL3
-      "#version 150 core\n"
-      "#define NANOVG_GL3 1\n"
-#elif defined NANOVG_GLES2
-      "#version 100\n"
-      "#define NANOVG_GL2 1\n"
-#elif defined NANOVG_GLES3
-      "#version 300 es\n"
-      "#define NANOVG_GL3 1\n"
-#endif
-#if NANOVG_GL_USE_UNIFORMBUFFER
-      "#define USE_UNIFORMBUFFER 1\n"
-#else
-      "#define UNIFORMARRAY_SIZE 11\n"
-#endif
-      "\n";
-   static const char * fillVertShader =
-      "#ifdef NANOVG_GL3\n"
-      "	uniform vec2 viewSize;\n"
-      "	in vec2 vertex;\n"
-      "	in vec2 tcoord;\n"
+   const float limit = 32767.0f / NANOVG_GL_PACKED_SUBPIXELS;
+   int i;
+   if (gl->nverts > gl->cpackedVerts)
+   {
+      int cpackedVerts = glnvg__maxi (gl->nverts, 4096) + gl->cpackedVerts / 2; // 1.5x Overallocate
+      GLNVGpackedVertex * packedVerts = (GLNVGpackedVertex *)realloc (gl->packedVerts, sizeof (GLNVGpackedVertex) * cpackedVerts);
+      if (packedVerts == NULL) return 0;
+      gl->packedVerts = packedVerts;
+      gl->cpackedVerts = cpackedVerts;
+   }
+   for (i = 0; i < gl->nverts; i++)
+   {
+      const NVGvertex * v = &gl->verts[i];
+      GLNVGpackedVertex * p = &gl->packedVerts[i];
+      // Negated so that NaNs fail too.
+      if (! (fabsf (v->x) <= limit && fabsf (v->y) <= limit && fabsf (v->u) <= 1.0f && fabsf (v->v) <= 1.0f))
+         return 0;
+      p->x = (short)floorf (v->x * NANOVG_GL_PACKED_SUBPIXELS + 0.5f);
+      p->y = (short)floorf (v->y * NANOVG_GL_PACKED_SUBPIXELS + 0.5f);
+      p->u = (short)floorf (v->u * 32767.0f + 0.5f);
+      p->v = (short)floorf (v->v * 32767.0f + 0.5f);
+   }
+   return 1;
+}
+
+// Vertices uploaded by the flush and their size in bytes.
+static const void * glnvg__vertexData (GLNVGcontext * gl, int * bytes)
+{
+   if (gl->vertsPacked)
+   {
+      *bytes = gl->nverts * (int)sizeof (GLNVGpackedVertex);
+      return gl->packedVerts;
+   }
+   *bytes = gl->nverts * (int)sizeof (NVGvertex);
+   return gl->verts;
+}
+
+#if defined NANOVG_GL3
+static int glnvg__hasBufferStorage (void)
+{
+#if NANOVG_GL_HAS_BUFFER_STORAGE
+   GLint major = 0, minor = 0, n = 0, i;
+   glGetIntegerv (GL_MAJOR_VERSION, &major);
+   glGetIntegerv (GL_MINOR_VERSION, &minor);
+   if (major > 4 || (major == 4 && minor >= 4))
+      return 1;
+   glGetIntegerv (GL_NUM_EXTENSIONS, &n);
+   for (i = 0; i < n; i++)
+   {
+      const char * ext = (const char *)glGetStringi (GL_EXTENSIONS, i);
+      if (ext != NULL && strcmp (ext, "GL_ARB_buffer_storage") == 0)
+         return 1;
+   }
+#endif
+   return 0;
+}
+
+static int glnvg__createRingBuffer (GLNVGcontext * gl, GLenum target, GLuint * buf, void ** map, int size)
+{
+   glGenBuffers (1, buf);
+   glBindBuffer (target, *buf);
+#if NANOVG_GL_HAS_BUFFER_STORAGE
+   if (gl->ringPersistent)
+   {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage (target, size, NULL, flags);
+      *map = glMapBufferRange (target, 0, size, flags);
+      glBindBuffer (target, 0);
+      return *map != NULL;
+   }
+#endif
+   glBufferData (target, size, NULL, GL_STREAM_DRAW);
+   *map = NULL;
+   glBindBuffer (target, 0);
+   return 1;
+}
+
+static void glnvg__deleteRingBuffer (GLenum target, GLuint * buf, void ** map)
+{
+   if (*buf == 0) return;
+   if (*map != NULL)
+   {
+      glBindBuffer (target, *buf);
+      glUnmapBuffer (target);
+      glBindBuffer (target, 0);
+   }
+   glDeleteBuffers (1, buf);
+   *buf = 0;
+   *map = NULL;
+}
+
+static int glnvg__growRingSlot (GLNVGcontext * gl, GLNVGringSlot * slot, int vertBytes, int fragBytes)
+{
+   if (vertBytes > slot->vertCapacity)
+   {
+      int size = glnvg__maxi (vertBytes, NANOVG_GL_RING_INIT_VERTS * (int)sizeof (NVGvertex)) + slot->vertCapacity / 2;
+      glnvg__deleteRingBuffer (GL_ARRAY_BUFFER, &slot->vertBuf, &slot->vertMap);
+      slot->vertCapacity = 0;
+      if (!glnvg__createRingBuffer (gl, GL_ARRAY_BUFFER, &slot->vertBuf, &slot->vertMap, size)) return 0;
+      slot->vertCapacity = size;
+   }
+   if (fragBytes > slot->fragCapacity)
+   {
+      int size = glnvg__maxi (fragBytes, NANOVG_GL_RING_INIT_UNIFORMS * gl->fragSize) + slot->fragCapacity / 2;
+      glnvg__deleteRingBuffer (GL_UNIFORM_BUFFER, &slot->fragBuf, &slot->fragMap);
+      slot->fragCapacity = 0;
+      if (!glnvg__createRingBuffer (gl, GL_UNIFORM_BUFFER, &slot->fragBuf, &slot->fragMap, size)) return 0;
+      slot->fragCapacity = size;
+   }
+   return 1;
+}
+
+static int glnvg__initRing (GLNVGcontext * gl)
+{
+   int i;
+   gl->ringPersistent = glnvg__hasBufferStorage();
+   for (i = 0; i < NANOVG_GL_RING_SIZE; i++)
+   {
+      if (!glnvg__growRingSlot (gl, &gl->ring[i], 1, 1))
+         return 0;
+   }
+   gl->ringIndex = 0;
+   gl->ringBegun = 0;
+   return 1;
+}
+
+static void glnvg__deleteRing (GLNVGcontext * gl)
+{
+   int i;
+   for (i = 0; i < NANOVG_GL_RING_SIZE; i++)
+   {
+      GLNVGringSlot * slot = &gl->ring[i];
+      if (slot->fence != 0)
+         glDeleteSync (slot->fence);
+      glnvg__deleteRingBuffer (GL_ARRAY_BUFFER, &slot->vertBuf, &slot->vertMap);
+      glnvg__deleteRingBuffer (GL_UNIFORM_BUFFER, &slot->fragBuf, &slot->fragMap);
+      memset (slot, 0, sizeof (*slot));
+   }
+}
+
+// Waits until the GPU is done with the current ring slot and, when the buffers are persistently
+// mapped, lets the per frame allocators write straight into it.
+static void glnvg__beginRingFrame (GLNVGcontext * gl)
+{
+   GLNVGringSlot * slot;
+   if (!gl->ringEnabled || gl->ringBegun) return;
+   gl->ringBegun = 1;
+   slot = &gl->ring[gl->ringIndex];
+   if (slot->fence != 0)
+   {
+      glClientWaitSync (slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+      glDeleteSync (slot->fence);
+      slot->fence = 0;
+   }
+   if (slot->vertMap != NULL && gl->nverts == 0 && gl->nuniforms == 0)
+   {
+      // Packed vertices are converted when flushed, the floats stay on the heap.
+      if ((gl->flags & NVG_PACKED_VERTICES) == 0)
+      {
+         gl->verts = (NVGvertex *)slot->vertMap;
+         gl->cverts = slot->vertCapacity / (int)sizeof (NVGvertex);
+         gl->vertsMapped = 1;
+      }
+      // Merged calls read the uniforms back when building the paint buffer, keep them on the heap.
+      if (slot->fragMap != NULL && !gl->merge)
+      {
+         gl->uniforms = (unsigned char *)slot->fragMap;
+         gl->cuniforms = slot->fragCapacity / gl->fragSize;
+         gl->uniformsMapped = 1;
+      }
+   }
+}
+
+static void glnvg__uploadRingBuffer (GLenum target, GLuint buf, void * map, const void * data, int size)
+{
+   if (size <= 0) return;
+   if (map != NULL)
+   {
+      memcpy (map, data, size);
+      return;
+   }
+   glBindBuffer (target, buf);
+   map = glMapBufferRange (target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+   if (map != NULL)
+   {
+      memcpy (map, data, size);
+      glUnmapBuffer (target);
+   }
+}
+
+// Makes the frame data available in the current ring slot and binds it for drawing.
+static int glnvg__flushRingFrame (GLNVGcontext * gl)
+{
+   GLNVGringSlot * slot = &gl->ring[gl->ringIndex];
+   int vertBytes;
+   const void * vertData = glnvg__vertexData (gl, &vertBytes);
+   int fragBytes = gl->nuniforms * gl->fragSize;
+   glnvg__beginRingFrame (gl);
+   if (!gl->vertsMapped || !gl->uniformsMapped)
+   {
+      if (!glnvg__growRingSlot (gl, slot, vertBytes, fragBytes)) return 0;
+      if (!gl->vertsMapped)
+         glnvg__uploadRingBuffer (GL_ARRAY_BUFFER, slot->vertBuf, slot->vertMap, vertData, vertBytes);
+      if (!gl->uniformsMapped)
+         glnvg__uploadRingBuffer (GL_UNIFORM_BUFFER, slot->fragBuf, slot->fragMap, gl->uniforms, fragBytes);
+   }
+   gl->drawFragBuf = slot->fragBuf;
+   gl->drawVertBuf = slot->vertBuf;
+   return 1;
+}
+
+// Fences the slot that was just drawn from and moves on to the next one.
+static void glnvg__endRingFrame (GLNVGcontext * gl)
+{
+   GLNVGringSlot * slot = &gl->ring[gl->ringIndex];
+   if (!gl->ringEnabled) return;
+   if (gl->ringBegun)
+   {
+      slot->fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      gl->ringIndex = (gl->ringIndex + 1) % NANOVG_GL_RING_SIZE;
+   }
+   gl->ringBegun = 0;
+   gl->verts = gl->vertHeap;
+   gl->cverts = gl->cvertHeap;
+   gl->vertsMapped = 0;
+   gl->uniforms = gl->uniformHeap;
+   gl->cuniforms = gl->cuniformHeap;
+   gl->uniformsMapped = 0;
+}
+
+static int glnvg__hasDSA (void)
+{
+#if NANOVG_GL_HAS_DSA
+   GLint major = 0, minor = 0;
+   glGetIntegerv (GL_MAJOR_VERSION, &major);
+   glGetIntegerv (GL_MINOR_VERSION, &minor);
+   return major > 4 || (major == 4 && minor >= 5);
+#else
+   return 0;
+#endif
+}
+
+#if NANOVG_GL_HAS_DSA
+// Replaces the contents of a buffer with immutable storage, replacing the buffer by a 1.5x larger
+// one when they don't fit. Nothing is bound.
+static void glnvg__namedBufferData (GLuint * buf, int * size, const void * data, int bytes)
+{
+   if (bytes > *size)
+   {
+      int grown = glnvg__maxi (bytes, 4096) + *size / 2;
+      if (*buf != 0)
+         glDeleteBuffers (1, buf);
+      glCreateBuffers (1, buf);
+      glNamedBufferStorage (*buf, grown, NULL, GL_DYNAMIC_STORAGE_BIT);
+      *size = grown;
+   }
+   if (bytes > 0)
+      glNamedBufferSubData (*buf, 0, bytes, data);
+}
+
+// Points attributes 0 and 1 of a vertex array at the vertices of the flush. Their format is set
+// when the vertex array is first seen or the flush switches between packed and float vertices.
+static void glnvg__dsaVertexBuffer (GLNVGcontext * gl, GLuint vertArr)
+{
+   GLNVGvertexFormat * format = NULL;
+   int i;
+   for (i = 0; i < NANOVG_GL_DSA_FORMATS; i++)
+      if (gl->formats[i].vertArr == vertArr)
+         format = &gl->formats[i];
+   if (format == NULL || format->packed != gl->vertsPacked)
+   {
+      if (format == NULL)
+      {
+         format = &gl->formats[gl->nextFormat];
+         gl->nextFormat = (gl->nextFormat + 1) % NANOVG_GL_DSA_FORMATS;
+         format->vertArr = vertArr;
+         glVertexArrayAttribBinding (vertArr, 0, 0);
+         glVertexArrayAttribBinding (vertArr, 1, 0);
+      }
+      format->packed = gl->vertsPacked;
+      if (gl->vertsPacked)
+      {
+         glVertexArrayAttribFormat (vertArr, 0, 2, GL_SHORT, GL_FALSE, 0);
+         glVertexArrayAttribFormat (vertArr, 1, 2, GL_SHORT, GL_TRUE, 2 * sizeof (short));
+      }
+      else
+      {
+         glVertexArrayAttribFormat (vertArr, 0, 2, GL_FLOAT, GL_FALSE, 0);
+         glVertexArrayAttribFormat (vertArr, 1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof (float));
+      }
+   }
+   glVertexArrayVertexBuffer (vertArr, 0, gl->drawVertBuf, 0,
+                              gl->vertsPacked ? sizeof (GLNVGpackedVertex) : sizeof (NVGvertex));
+}
+
+// Forgets the format of a vertex array that is deleted, its name may come back for a new one.
+static void glnvg__dsaForgetVertexArray (GLNVGcontext * gl, GLuint vertArr)
+{
+   int i;
+   for (i = 0; i < NANOVG_GL_DSA_FORMATS; i++)
+      if (gl->formats[i].vertArr == vertArr)
+         gl->formats[i].vertArr = 0;
+}
+
+// Uploads a fill and a stroke command per path and binds them for glnvg__drawPaths, which then
+// draws the paths of a call with one glMultiDrawArraysIndirect().
+static int glnvg__uploadCommands (GLNVGcontext * gl)
+{
+   int i, n = gl->npaths * 2;
+   if (n > gl->ccommands)
+   {
+      int ccommands = glnvg__maxi (n, NANOVG_GL_DSA_INIT_COMMANDS) + gl->ccommands / 2; // 1.5x Overallocate
+      GLNVGdrawCommand * commands = (GLNVGdrawCommand *)realloc (gl->commands, sizeof (GLNVGdrawCommand) * ccommands);
+      if (commands == NULL) return 0;
+      gl->commands = commands;
+      gl->ccommands = ccommands;
+   }
+   for (i = 0; i < gl->npaths; i++)
+   {
+      const GLNVGpath * path = &gl->paths[i];
+      GLNVGdrawCommand * fill = &gl->commands[i * 2], * stroke = fill + 1;
+      fill->count = path->fillCount;
+      fill->instanceCount = 1;
+      fill->first = path->fillOffset;
+      fill->baseInstance = 0;
+      stroke->count = path->strokeCount;
+      stroke->instanceCount = 1;
+      stroke->first = path->strokeOffset;
+      stroke->baseInstance = 0;
+   }
+   glnvg__namedBufferData (&gl->indirectBuf, &gl->indirectBufSize, gl->commands, n * (int)sizeof (GLNVGdrawCommand));
+   gl->vertexBytes += n * (int)sizeof (GLNVGdrawCommand);
+   glBindBuffer (GL_DRAW_INDIRECT_BUFFER, gl->indirectBuf);
+   return 1;
+}
+#endif
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+static int glnvg__hasExtension (const char * name)
+{
+#if defined NANOVG_GL3 || defined NANOVG_GLES3
+   GLint n = 0, i;
+   glGetIntegerv (GL_NUM_EXTENSIONS, &n);
+   for (i = 0; i < n; i++)
+   {
+      const char * ext = (const char *)glGetStringi (GL_EXTENSIONS, i);
+      if (ext != NULL && strcmp (ext, name) == 0)
+         return 1;
+   }
+#else
+   const char * ext = (const char *)glGetString (GL_EXTENSIONS);
+   size_t len = strlen (name);
+   while (ext != NULL && (ext = strstr (ext, name)) != NULL)
+   {
+      if (ext[len] == ' ' || ext[len] == '\0')
+         return 1;
+      ext += len;
+   }
+#endif
+   return 0;
+}
+
+#if defined NANOVG_GL3
+static int glnvg__hasPathRendering (void)
+{
+#if NANOVG_GL_HAS_PATH_RENDERING
+   return glnvg__hasExtension ("GL_NV_path_rendering");
+#else
+   return 0;
+#endif
+}
+#endif
+
+// Returns a bit per NVGcompressedFormat that can be sampled, from the core version and extensions.
+static int glnvg__compressedSupport (void)
+{
+   int formats = 0;
+   GLint major = 0, minor = 0;
+   const int etc2 = (1 << NVG_COMPRESSED_ETC2_RGB) | (1 << NVG_COMPRESSED_ETC2_RGBA);
+#if defined NANOVG_GL3 || defined NANOVG_GLES3
+   glGetIntegerv (GL_MAJOR_VERSION, &major);
+   glGetIntegerv (GL_MINOR_VERSION, &minor);
+#endif
+   if (glnvg__hasExtension ("GL_EXT_texture_compression_s3tc"))
+      formats |= (1 << NVG_COMPRESSED_BC1) | (1 << NVG_COMPRESSED_BC3);
+#if defined NANOVG_GLES3
+   formats |= etc2;
+   if (glnvg__hasExtension ("GL_EXT_texture_compression_bptc"))
+      formats |= 1 << NVG_COMPRESSED_BC7;
+#else
+   if (major > 4 || (major == 4 && minor >= 2) || glnvg__hasExtension ("GL_ARB_texture_compression_bptc"))
+      formats |= 1 << NVG_COMPRESSED_BC7;
+   if (major > 4 || (major == 4 && minor >= 3) || glnvg__hasExtension ("GL_ARB_ES3_compatibility"))
+      formats |= etc2;
+#endif
+   return formats;
+}
+
+static int glnvg__renderCreate (void * uptr)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   int align = 4;
+   // TODO: mediump float may not be enough for GLES2 in iOS.
+   // see the following discussion: https://github.com/memononen/nanovg/issues/46
+   static const char * shaderHeader =
+#if defined NANOVG_GL2
+      "#define NANOVG_GL2 1\n"
+#elif defined NANOVG_GL3
+      "#version 150 core\n"
+      "#define NANOVG_GL3 1\n"
+#elif defined NANOVG_GLES2
+      "#version 100\n"
+      "#define NANOVG_GL2 1\n"
+#elif defined NANOVG_GLES3
+      "#version 300 es\n"
+      "#define NANOVG_GL3 1\n"
+#endif
+#if NANOVG_GL_USE_UNIFORMBUFFER
+      "#define USE_UNIFORMBUFFER 1\n"
+#else
+      "#define UNIFORMARRAY_SIZE 13\n"
+#endif
+      "\n";
+   static const char * fillVertShader =
+      "#ifdef NANOVG_GL3\n"
+      "	uniform vec2 viewSize;\n"
+      "	in vec2 vertex;\n"
+      "	in vec2 tcoord;\n"
       "	out vec2 ftcoord;\n"
       "	out vec2 fpos;\n"
+      "	uniform int quads;\n"
+      "	in vec4 quadPos;\n"
+      "	in vec2 quadEdge;\n"
+      "	in vec4 quadUV;\n"
+      "#ifdef USE_PAINTBUFFER\n"
+      "	in int paintIdx;\n"
+      "	in int quadPaint;\n"
+      "	flat out int fpaint;\n"
+      "	uniform int instances;\n"
+      "	in vec2 instOffset;\n"
+      "	in int instPaint;\n"
+      "#endif\n"
       "#else\n"
       "	uniform vec2 viewSize;\n"
       "	attribute vec2 vertex;\n"
@@ -521,10 +1844,33 @@ static int glnvg__renderCreate (void * uptr)
       "	varying vec2 ftcoord;\n"
       "	varying vec2 fpos;\n"
       "#endif\n"
+      "uniform float vertexScale;\n"
       "void main(void) {\n"
+      "	vec2 pos = vertex * vertexScale;\n"
       "	ftcoord = tcoord;\n"
-      "	fpos = vertex;\n"
-      "	gl_Position = vec4(2.0*vertex.x/viewSize.x - 1.0, 1.0 - 2.0*vertex.y/viewSize.y, 0, 1);\n"
+      "#ifdef USE_PAINTBUFFER\n"
+      "	fpaint = paintIdx;\n"
+      "#endif\n"
+      "#ifdef NANOVG_GL3\n"
+      "	if (quads != 0) {\n"
+      "		// Instanced quad, drawn as a strip of its four corners.\n"
+      "		vec2 corner = vec2(float(gl_VertexID >> 1), float(gl_VertexID & 1));\n"
+      "		pos = quadPos.xy + quadPos.zw * corner.x + quadEdge * corner.y;\n"
+      "		ftcoord = mix(quadUV.xy, quadUV.zw, corner);\n"
+      "#ifdef USE_PAINTBUFFER\n"
+      "		fpaint = quadPaint;\n"
+      "#endif\n"
+      "	}\n"
+      "#ifdef USE_PAINTBUFFER\n"
+      "	if (instances != 0) {\n"
+      "		// Shared shape, moved to the instance and drawn with its paint.\n"
+      "		pos += instOffset;\n"
+      "		fpaint = instPaint;\n"
+      "	}\n"
+      "#endif\n"
+      "#endif\n"
+      "	fpos = pos;\n"
+      "	gl_Position = vec4(2.0*pos.x/viewSize.x - 1.0, 1.0 - 2.0*pos.y/viewSize.y, 0, 1);\n"
       "}\n";
    static const char * fillFragShader =
       "#ifdef GL_ES\n"
@@ -535,7 +1881,12 @@ static int glnvg__renderCreate (void * uptr)
       "#endif\n"
       "#endif\n"
       "#ifdef NANOVG_GL3\n"
-      "#ifdef USE_UNIFORMBUFFER\n"
+      "#if defined(USE_PAINTBUFFER)\n"
+      "	uniform samplerBuffer paints;\n"
+      "	uniform int paintPass;\n"
+      "	flat in int fpaint;\n"
+      "	vec4 frag[UNIFORMARRAY_SIZE];\n"
+      "#elif defined(USE_UNIFORMBUFFER)\n"
       "	layout(std140) uniform frag {\n"
       "		mat3 scissorMat;\n"
       "		mat3 paintMat;\n"
@@ -550,6 +1901,8 @@ static int glnvg__renderCreate (void * uptr)
       "		float strokeThr;\n"
       "		int texType;\n"
       "		int type;\n"
+      "		vec4 shape;\n"
+      "		vec4 texRect;\n"
       "	};\n"
       "#else\n" // NANOVG_GL3 && !USE_UNIFORMBUFFER
       "	uniform vec4 frag[UNIFORMARRAY_SIZE];\n"
@@ -564,7 +1917,7 @@ static int glnvg__renderCreate (void * uptr)
       "	varying vec2 ftcoord;\n"
       "	varying vec2 fpos;\n"
       "#endif\n"
-      "#ifndef USE_UNIFORMBUFFER\n"
+      "#if !defined(USE_UNIFORMBUFFER) || defined(USE_PAINTBUFFER)\n"
       "	#define scissorMat mat3(frag[0].xyz, frag[1].xyz, frag[2].xyz)\n"
       "	#define paintMat mat3(frag[3].xyz, frag[4].xyz, frag[5].xyz)\n"
       "	#define innerCol frag[6]\n"
@@ -578,6 +1931,8 @@ static int glnvg__renderCreate (void * uptr)
       "	#define strokeThr frag[10].y\n"
       "	#define texType int(frag[10].z)\n"
       "	#define type int(frag[10].w)\n"
+      "	#define shape frag[11]\n"
+      "	#define texRect frag[12]\n"
       "#endif\n"
       "\n"
       "float sdroundrect(vec2 pt, vec2 ext, float rad) {\n"
@@ -592,6 +1947,12 @@ static int glnvg__renderCreate (void * uptr)
       "	sc = vec2(0.5,0.5) - sc * scissorScale;\n"
       "	return clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);\n"
       "}\n"
+      "\n"
+      "// Analytic shape - ftcoord is the position relative to the center of a rounded rect.\n"
+      "float shapeMask() {\n"
+      "	float c = clamp(0.5 - sdroundrect(ftcoord, shape.xy, shape.z) * abs(shape.w), 0.0, 1.0);\n"
+      "	return shape.w < 0.0 ? 1.0 - c : c;\n"
+      "}\n"
       "#ifdef EDGE_AA\n"
       "// Stroke - from [0..1] to clipped pyramid, where the slope is 1px.\n"
       "float strokeMask() {\n"
@@ -599,15 +1960,51 @@ static int glnvg__renderCreate (void * uptr)
       "}\n"
       "#endif\n"
       "\n"
+      "// Alpha glyph blurred by feather texels, extent is the texel size. 7x7 taps over two sigmas\n"
+      "// either way, filtering fills in between them.\n"
+      "float blurredGlyph(vec2 uv) {\n"
+      "	vec2 dt = extent * max(feather * 0.57735, 0.5) * (2.0 / 3.0);\n"
+      "	float sum = 0.0, wsum = 0.0;\n"
+      "	for (int y = -3; y <= 3; y++) {\n"
+      "		for (int x = -3; x <= 3; x++) {\n"
+      "			float w = exp(-float(x*x + y*y) * (2.0 / 9.0));\n"
+      "#ifdef NANOVG_GL3\n"
+      "			sum += w * texture(tex, uv + vec2(float(x), float(y)) * dt).x;\n"
+      "#else\n"
+      "			sum += w * texture2D(tex, uv + vec2(float(x), float(y)) * dt).x;\n"
+      "#endif\n"
+      "			wsum += w;\n"
+      "		}\n"
+      "	}\n"
+      "	return sum / wsum;\n"
+      "}\n"
+      "\n"
       "void main(void) {\n"
       "   vec4 result;\n"
+      "#ifdef USE_PAINTBUFFER\n"
+      "	for (int i = 0; i < UNIFORMARRAY_SIZE; i++)\n"
+      "		frag[i] = texelFetch(paints, (fpaint + paintPass) * UNIFORMARRAY_SIZE + i);\n"
+      "#endif\n"
+      "#if defined(VARIANT_TYPE) && !defined(VARIANT_SCISSOR)\n"
+      "	float scissor = 1.0;\n"
+      "#else\n"
       "	float scissor = scissorMask(fpos);\n"
+      "#endif\n"
       "#ifdef EDGE_AA\n"
       "	float strokeAlpha = strokeMask();\n"
       "#else\n"
       "	float strokeAlpha = 1.0;\n"
       "#endif\n"
-      "	if (type == 0) {			// Gradient\n"
+      "#if !defined(VARIANT_TYPE)\n"
+      "	if (shape.w != 0.0) strokeAlpha = shapeMask();\n"
+      "	int paintType = type;\n"
+      "#else\n"
+      "#ifdef VARIANT_SHAPE\n"
+      "	strokeAlpha = shapeMask();\n"
+      "#endif\n"
+      "	const int paintType = VARIANT_TYPE;\n"
+      "#endif\n"
+      "	if (paintType == 0) {			// Gradient\n"
       "		// Calculate gradient color using box gradient\n"
       "		vec2 pt = (paintMat * vec3(fpos,1.0)).xy;\n"
       "		float d = clamp((sdroundrect(pt, extent, radius) + feather*0.5) / feather, 0.0, 1.0);\n"
@@ -615,9 +2012,11 @@ static int glnvg__renderCreate (void * uptr)
       "		// Combine alpha\n"
       "		color *= strokeAlpha * scissor;\n"
       "		result = color;\n"
-      "	} else if (type == 1) {		// Image\n"
+      "	} else if (paintType == 1) {		// Image\n"
       "		// Calculate color fron texture\n"
       "		vec2 pt = (paintMat * vec3(fpos,1.0)).xy / extent;\n"
+      "		// Images on an atlas page clamp to their own texels.\n"
+      "		if (texRect.z > 0.0) pt = clamp(pt, texRect.xy, texRect.zw);\n"
       "#ifdef NANOVG_GL3\n"
       "		vec4 color = texture(tex, pt);\n"
       "#else\n"
@@ -625,14 +2024,15 @@ static int glnvg__renderCreate (void * uptr)
       "#endif\n"
       "		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
       "		if (texType == 2) color = vec4(color.x);"
+      "		if (texType == 3) color = vec4(smoothstep(0.5 - feather, 0.5 + feather, color.x));\n"
       "		// Apply color tint and alpha.\n"
       "		color *= innerCol;\n"
       "		// Combine alpha\n"
       "		color *= strokeAlpha * scissor;\n"
       "		result = color;\n"
-      "	} else if (type == 2) {		// Stencil fill\n"
+      "	} else if (paintType == 2) {		// Stencil fill\n"
       "		result = vec4(1,1,1,1);\n"
-      "	} else if (type == 3) {		// Textured tris\n"
+      "	} else if (paintType == 3) {		// Textured tris\n"
       "#ifdef NANOVG_GL3\n"
       "		vec4 color = texture(tex, ftcoord);\n"
       "#else\n"
@@ -640,8 +2040,26 @@ static int glnvg__renderCreate (void * uptr)
       "#endif\n"
       "		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
       "		if (texType == 2) color = vec4(color.x);"
+      "		if (texType == 3) color = vec4(smoothstep(0.5 - feather, 0.5 + feather, color.x));\n"
+      "		if (texType == 4) color = vec4(blurredGlyph(ftcoord));\n"
       "		color *= scissor;\n"
       "		result = color * innerCol;\n"
+      "	} else if (paintType == 4) {		// Multi-stop gradient\n"
+      "		// Offset along the gradient by its NVGrampType, then the color from its row of the ramp texture\n"
+      "		vec2 pt = (paintMat * vec3(fpos,1.0)).xy;\n"
+      "		float t;\n"
+      "		if (texType == 1) t = pt.x;\n"
+      "		else if (texType == 2) t = (length(pt) - radius) / feather;\n"
+      "		else t = fract(atan(pt.y, pt.x) * 0.15915494);\n"
+      "		vec2 uv = vec2(mix(texRect.x, texRect.z, clamp(t, 0.0, 1.0)), texRect.y);\n"
+      "#ifdef NANOVG_GL3\n"
+      "		vec4 color = texture(tex, uv);\n"
+      "#else\n"
+      "		vec4 color = texture2D(tex, uv);\n"
+      "#endif\n"
+      "		color *= innerCol;\n"
+      "		color *= strokeAlpha * scissor;\n"
+      "		result = color;\n"
       "	}\n"
       "#ifdef EDGE_AA\n"
       "	if (strokeAlpha < strokeThr) discard;\n"
@@ -652,19 +2070,172 @@ static int glnvg__renderCreate (void * uptr)
       "	gl_FragColor = result;\n"
       "#endif\n"
       "}\n";
+#if defined NANOVG_GL3
+   // Plots, see nvgDrawPlot(). Every instance is the segment between two samples, drawn as a quad
+   // down to the bottom edge in pass 0 and as a quad around the line in pass 1.
+   static const char * plotVertShader =
+      "uniform vec2 viewSize;\n"
+      "uniform sampler2D tex;\n"
+      "uniform vec4 plot[11];\n"
+      "uniform int plotPass;\n"
+      "out vec2 fpos;\n"
+      "out vec3 fline;\n"
+      "vec2 samplePos(int i) {\n"
+      "	int count = int(plot[7].w);\n"
+      "	int p = int(plot[7].z) + i;\n"
+      "	if (p >= int(plot[8].x)) p -= int(plot[8].x);\n"
+      "	float v = texelFetch(tex, ivec2(p % 1024, p / 1024), 0).x;\n"
+      "	float t = clamp((v - plot[7].x) * plot[7].y, 0.0, 1.0);\n"
+      "	float step = plot[6].z / (plot[8].x - 1.0);\n"
+      "	return vec2(plot[6].x + plot[6].z - float(count - 1 - i) * step, plot[6].y + plot[6].w * (1.0 - t));\n"
+      "}\n"
+      "vec2 toScreen(vec2 p) {\n"
+      "	return vec2(plot[4].x*p.x + plot[4].z*p.y + plot[5].x, plot[4].y*p.x + plot[4].w*p.y + plot[5].y);\n"
+      "}\n"
+      "void main(void) {\n"
+      "	vec2 a = samplePos(gl_InstanceID);\n"
+      "	vec2 b = samplePos(gl_InstanceID + 1);\n"
+      "	int corner = gl_VertexID;\n"
+      "	vec2 p;\n"
+      "	if (plotPass == 0) {\n"
+      "		vec2 q = corner < 2 ? a : b;\n"
+      "		if (corner == 1 || corner == 3) q.y = plot[6].y + plot[6].w;\n"
+      "		p = toScreen(q);\n"
+      "		fline = vec3(0.0);\n"
+      "	} else {\n"
+      "		// Line coordinates along and across the segment, in pixels.\n"
+      "		vec2 sa = toScreen(a);\n"
+      "		vec2 d = toScreen(b) - sa;\n"
+      "		float len = length(d);\n"
+      "		vec2 dir = len > 0.0001 ? d / len : vec2(1.0, 0.0);\n"
+      "		float ext = plot[5].z + plot[5].w;\n"
+      "		float u = corner < 2 ? -ext : len + ext;\n"
+      "		float v = (corner == 1 || corner == 3) ? ext : -ext;\n"
+      "		p = sa + dir * u + vec2(-dir.y, dir.x) * v;\n"
+      "		fline = vec3(u, v, len);\n"
+      "	}\n"
+      "	fpos = p;\n"
+      "	gl_Position = vec4(2.0*p.x/viewSize.x - 1.0, 1.0 - 2.0*p.y/viewSize.y, 0, 1);\n"
+      "}\n";
+   static const char * plotFragShader =
+      "uniform vec4 plot[11];\n"
+      "uniform int plotPass;\n"
+      "in vec2 fpos;\n"
+      "in vec3 fline;\n"
+      "out vec4 outColor;\n"
+      "float scissorMask(vec2 p) {\n"
+      "	mat3 scissorMat = mat3(plot[0].xyz, plot[1].xyz, plot[2].xyz);\n"
+      "	vec2 sc = (abs((scissorMat * vec3(p,1.0)).xy) - plot[3].xy);\n"
+      "	sc = vec2(0.5,0.5) - sc * plot[3].zw;\n"
+      "	return clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);\n"
+      "}\n"
+      "void main(void) {\n"
+      "	float cover = scissorMask(fpos);\n"
+      "	if (plotPass == 0) {\n"
+      "		outColor = plot[10] * cover;\n"
+      "		return;\n"
+      "	}\n"
+      "	// Distance to the segment, round at its ends so that consecutive segments join.\n"
+      "	float du = max(max(-fline.x, fline.x - fline.z), 0.0);\n"
+      "	float dist = length(vec2(du, fline.y));\n"
+      "	cover *= clamp((plot[5].z - dist) / plot[5].w + 0.5, 0.0, 1.0);\n"
+      "	outColor = plot[9] * cover;\n"
+      "}\n";
+   // Backdrops, see nvgCaptureBackdrop(). A pass covers its whole target with one quad, reading
+   // the region of the level before: 5 taps of the dual filter going down a level, 8 going up.
+   static const char * blurVertShader =
+      "uniform vec4 blurRegion;\n"
+      "out vec2 fuv;\n"
+      "void main(void) {\n"
+      "	vec2 p = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));\n"
+      "	fuv = p * blurRegion.xy;\n"
+      "	gl_Position = vec4(2.0*p - 1.0, 0, 1);\n"
+      "}\n";
+   static const char * blurFragShader =
+      "uniform sampler2D tex;\n"
+      "uniform vec4 blurRegion;\n"
+      "uniform int blurPass;\n"
+      "in vec2 fuv;\n"
+      "out vec4 outColor;\n"
+      "// The region is the part of the texture the level covers, xy its extent and zw a texel.\n"
+      "vec4 tap(vec2 uv) {\n"
+      "	return texture(tex, clamp(uv, 0.5*blurRegion.zw, blurRegion.xy - 0.5*blurRegion.zw));\n"
+      "}\n"
+      "void main(void) {\n"
+      "	vec2 t = blurRegion.zw;\n"
+      "	vec2 s = vec2(t.x, -t.y);\n"
+      "	if (blurPass == 0) {\n"
+      "		outColor = (tap(fuv)*4.0 + tap(fuv - t) + tap(fuv + t) + tap(fuv - s) + tap(fuv + s)) / 8.0;\n"
+      "	} else {\n"
+      "		vec4 sum = tap(fuv - vec2(t.x, 0.0)) + tap(fuv + vec2(t.x, 0.0)) + tap(fuv - vec2(0.0, t.y)) + tap(fuv + vec2(0.0, t.y));\n"
+      "		sum += (tap(fuv - 0.5*t) + tap(fuv + 0.5*t) + tap(fuv - 0.5*s) + tap(fuv + 0.5*s)) * 2.0;\n"
+      "		outColor = sum / 12.0;\n"
+      "	}\n"
+      "}\n";
+#endif
+   static const char * shaderOpts[4] =
+   {
+      NULL,
+      "#define EDGE_AA 1\n",
+      "#define USE_PAINTBUFFER 1\n#define UNIFORMARRAY_SIZE 13\n",
+      "#define EDGE_AA 1\n#define USE_PAINTBUFFER 1\n#define UNIFORMARRAY_SIZE 13\n",
+   };
+   int opts = (gl->flags & NVG_ANTIALIAS) ? 1 : 0;
+#if defined NANOVG_GL3
+   gl->merge = (gl->flags & NVG_MERGE_CALLS) != 0;
+   if (gl->merge)
+      opts += 2;
+   gl->quadsEnabled = (gl->flags & NVG_INSTANCED_QUADS) != 0;
+   gl->instancesEnabled = gl->merge && (gl->flags & NVG_INSTANCE_SHAPES) != 0;
+   gl->atlasEnabled = (gl->flags & NVG_ATLAS_IMAGES) != 0;
+   gl->uploadsEnabled = (gl->flags & NVG_BATCH_UPLOADS) != 0;
+#endif
+   gl->compressedFormats = glnvg__compressedSupport();
+   gl->mipBudget = 4 << 20;
    glnvg__checkError (gl, "init");
-   if (gl->flags & NVG_ANTIALIAS)
+#if NANOVG_GL_HAS_PROGRAM_BINARY
+   if (gl->programCache != NULL && !glnvg__hasProgramBinary())
+#endif
    {
-      if (glnvg__createShader (&gl->shader, "shader", shaderHeader, "#define EDGE_AA 1\n", fillVertShader, fillFragShader) == 0)
-         return 0;
+      free (gl->programCache);
+      gl->programCache = NULL;
    }
-   else
+   // Unmerged calls keep their paint in the uniform block, only merged draws fetch it per pixel.
+   if (glnvg__createShader (&gl->shader, "shader", shaderHeader, shaderOpts[opts & 1], fillVertShader, fillFragShader, gl->programCache) == 0)
+      return 0;
+#if defined NANOVG_GL3
+   if (gl->merge)
    {
-      if (glnvg__createShader (&gl->shader, "shader", shaderHeader, NULL, fillVertShader, fillFragShader) == 0)
+      if (glnvg__createShader (&gl->mergeShader, "merge", shaderHeader, shaderOpts[opts], fillVertShader, fillFragShader, gl->programCache) == 0)
          return 0;
+      glnvg__getUniforms (&gl->mergeShader);
    }
+#endif
+   // Variants are built from the same sources when first drawn with.
+   gl->variantsEnabled = (gl->flags & NVG_SHADER_VARIANTS) != 0;
+   gl->shaderHeader = shaderHeader;
+   gl->vertShader = fillVertShader;
+   gl->fragShader = fillFragShader;
    glnvg__checkError (gl, "uniform locations");
    glnvg__getUniforms (&gl->shader);
+#if defined NANOVG_GL3
+   if (gl->merge)
+   {
+      glGenBuffers (1, &gl->paintIdxBuf);
+      glGenBuffers (1, &gl->indexBuf);
+      glGenBuffers (1, &gl->paintBuf);
+      glGenTextures (1, &gl->paintTex);
+   }
+   if (gl->quadsEnabled)
+      glGenBuffers (1, &gl->quadBuf);
+   if (gl->instancesEnabled)
+      glGenBuffers (1, &gl->instanceBuf);
+   // Plots and backdrops build their shaders when first used, most applications never pay for them.
+   gl->plotSources[0] = plotVertShader;
+   gl->plotSources[1] = plotFragShader;
+   gl->blurSources[0] = blurVertShader;
+   gl->blurSources[1] = blurFragShader;
+#endif
    // Create dynamic vertex array
 #if defined NANOVG_GL3
    glGenVertexArrays (1, &gl->vertArr);
@@ -672,21 +2243,246 @@ static int glnvg__renderCreate (void * uptr)
    glGenBuffers (1, &gl->vertBuf);
 #if NANOVG_GL_USE_UNIFORMBUFFER
    // Create UBOs
-   glUniformBlockBinding (gl->shader.prog, gl->shader.loc[GLNVG_LOC_FRAG], GLNVG_FRAG_BINDING);
+   if (gl->shader.loc[GLNVG_LOC_FRAG] != (GLint)GL_INVALID_INDEX)
+      glUniformBlockBinding (gl->shader.prog, gl->shader.loc[GLNVG_LOC_FRAG], GLNVG_FRAG_BINDING);
    glGenBuffers (1, &gl->fragBuf);
    glGetIntegerv (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
 #endif
    gl->fragSize = sizeof (GLNVGfragUniforms) + align - sizeof (GLNVGfragUniforms) % align;
-   glnvg__checkError (gl, "create done");
-   glFinish();
-   return 1;
-}
-
-static int glnvg__renderCreateTexture (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data)
-{
+#if defined NANOVG_GL3
+   if (gl->flags & NVG_RING_BUFFERS)
+   {
+      gl->ringEnabled = glnvg__initRing (gl);
+      if (!gl->ringEnabled)
+      {
+         printf ("Could not create the buffer ring, falling back to glBufferData\n");
+         glnvg__deleteRing (gl);
+      }
+   }
+   gl->dsaEnabled = (gl->flags & NVG_DIRECT_STATE_ACCESS) && glnvg__hasDSA();
+#if NANOVG_GL_HAS_PATH_RENDERING
+   if ((gl->flags & NVG_PATH_RENDERING) && glnvg__hasPathRendering())
+   {
+      gl->pathObjects = glGenPathsNV (NANOVG_GL_PATH_OBJECTS);
+      gl->pathRendering = gl->pathObjects != 0;
+   }
+#endif
+#endif
+   glnvg__checkError (gl, "create done");
+   glFinish();
+   return 1;
+}
+
+#if NANOVG_GL_HAS_DSA
+static void glnvg__dsaTextureParameters (GLuint tex, GLint minFilter, int imageFlags)
+{
+   glTextureParameteri (tex, GL_TEXTURE_MIN_FILTER, minFilter);
+   glTextureParameteri (tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTextureParameteri (tex, GL_TEXTURE_WRAP_S, (imageFlags & NVG_IMAGE_REPEATX) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+   glTextureParameteri (tex, GL_TEXTURE_WRAP_T, (imageFlags & NVG_IMAGE_REPEATY) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+}
+#endif
+
+#if defined NANOVG_GL3
+static int glnvg__atlasPack (GLNVGatlasPage * page, int w, int h, int * x, int * y)
+{
+   GLNVGatlasShelf * best = NULL;
+   int i;
+   // Use the lowest shelf the image fits on without wasting more than a quarter of its height.
+   for (i = 0; i < page->nshelves; i++)
+   {
+      GLNVGatlasShelf * shelf = &page->shelves[i];
+      if (h <= shelf->h && shelf->h - h <= shelf->h / 4 && shelf->x + w <= NANOVG_GL_ATLAS_PAGE_SIZE &&
+            (best == NULL || shelf->h < best->h))
+         best = shelf;
+   }
+   if (best == NULL)
+   {
+      if (page->top + h > NANOVG_GL_ATLAS_PAGE_SIZE || page->nshelves == NANOVG_GL_ATLAS_MAX_SHELVES)
+         return 0;
+      best = &page->shelves[page->nshelves++];
+      best->y = page->top;
+      best->h = h;
+      best->x = 0;
+      page->top += h;
+   }
+   *x = best->x;
+   *y = best->y;
+   best->x += w;
+   page->refs++;
+   return 1;
+}
+
+// Finds room for an image on an atlas page, adding a page when all are full. Returns the page index + 1.
+static int glnvg__atlasAlloc (GLNVGcontext * gl, int w, int h, int * x, int * y)
+{
+   GLNVGatlasPage * page;
+   int i;
+   for (i = 0; i < gl->npages; i++)
+      if (glnvg__atlasPack (&gl->pages[i], w, h, x, y))
+         return i + 1;
+   if (gl->npages + 1 > gl->cpages)
+   {
+      int cpages = glnvg__maxi (gl->npages + 1, 2) + gl->cpages / 2; // 1.5x Overallocate
+      GLNVGatlasPage * pages = (GLNVGatlasPage *)realloc (gl->pages, sizeof (GLNVGatlasPage) * cpages);
+      if (pages == NULL) return 0;
+      gl->pages = pages;
+      gl->cpages = cpages;
+   }
+   page = &gl->pages[gl->npages];
+   memset (page, 0, sizeof (*page));
+#if NANOVG_GL_HAS_DSA
+   if (gl->dsaEnabled)
+   {
+      glCreateTextures (GL_TEXTURE_2D, 1, &page->tex);
+      glTextureStorage2D (page->tex, 1, GL_RGBA8, NANOVG_GL_ATLAS_PAGE_SIZE, NANOVG_GL_ATLAS_PAGE_SIZE);
+      glnvg__dsaTextureParameters (page->tex, GL_LINEAR, 0);
+   }
+   else
+#endif
+   {
+      glGenTextures (1, &page->tex);
+      glnvg__bindTexture (gl, page->tex);
+      glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA, NANOVG_GL_ATLAS_PAGE_SIZE, NANOVG_GL_ATLAS_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   }
+   glnvg__checkError (gl, "create atlas page");
+   gl->textureBytes += (size_t)NANOVG_GL_ATLAS_PAGE_SIZE * NANOVG_GL_ATLAS_PAGE_SIZE * 4;
+   gl->npages++;
+   if (!glnvg__atlasPack (page, w, h, x, y)) return 0;
+   return gl->npages;
+}
+
+static int glnvg__atlasCompatible (GLNVGcontext * gl, int type, int w, int h, int imageFlags)
+{
+   const int own = NVG_IMAGE_GENERATE_MIPMAPS | NVG_IMAGE_REPEATX | NVG_IMAGE_REPEATY | NVG_IMAGE_FLIPY;
+   return gl->atlasEnabled && type == NVG_TEXTURE_RGBA && (imageFlags & own) == 0 &&
+          w > 0 && h > 0 && w <= NANOVG_GL_ATLAS_MAX_IMAGE && h <= NANOVG_GL_ATLAS_MAX_IMAGE;
+}
+#endif
+
+static int glnvg__renderUpdateTexture (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data);
+static void glnvg__texSubImage (GLNVGcontext * gl, GLNVGtexture * tex, int x, int y, int w, int h, int rowLength,
+                                const unsigned char * data);
+
+// Queues the mipmaps of a texture whose level 0 changed, unless they are queued already or were
+// made static with nvglSetMipmapInterval().
+static void glnvg__queueMipmaps (GLNVGcontext * gl, GLNVGtexture * tex)
+{
+#if !defined(NANOVG_GL2)
+   if ((tex->flags & NVG_IMAGE_GENERATE_MIPMAPS) == 0 || tex->page != 0 || tex->mipQueued ||
+         (tex->mipReady && tex->mipInterval < 0))
+      return;
+   if (gl->nmipQueue + 1 > gl->cmipQueue)
+   {
+      int cmipQueue = glnvg__maxi (gl->nmipQueue + 1, 16) + gl->cmipQueue / 2;
+      int * queue = (int *)realloc (gl->mipQueue, sizeof (int) * cmipQueue);
+      if (queue == NULL) return;
+      gl->mipQueue = queue;
+      gl->cmipQueue = cmipQueue;
+   }
+   gl->mipQueue[gl->nmipQueue++] = tex->id;
+   tex->mipQueued = 1;
+#else
+   // GL_GENERATE_MIPMAP keeps the levels current.
+   NVG_NOTUSED (gl);
+   NVG_NOTUSED (tex);
+#endif
+}
+
+// Generates the queued mipmaps at the start of a flush, oldest first, until the level 0 texels of
+// the generated textures exceed the budget; at least one texture is done per flush. Textures
+// updated sooner than their interval after the last generation wait in the queue, images deleted
+// since they were queued are dropped.
+static void glnvg__generateMipmaps (GLNVGcontext * gl)
+{
+#if !defined(NANOVG_GL2)
+   int i, n = 0, texels = 0;
+   for (i = 0; i < gl->nmipQueue; i++)
+   {
+      GLNVGtexture * tex = glnvg__findTexture (gl, gl->mipQueue[i]);
+      if (tex == NULL)
+         continue;
+      if ((tex->mipReady && tex->mipInterval > 0 && gl->flushes - tex->mipFlush < tex->mipInterval) ||
+            (gl->mipBudget > 0 && texels > 0 && texels + tex->width * tex->height > gl->mipBudget))
+      {
+         gl->mipQueue[n++] = tex->id;
+         continue;
+      }
+#if NANOVG_GL_HAS_DSA
+      if (gl->dsaEnabled)
+      {
+         glGenerateTextureMipmap (tex->tex);
+         if (!tex->mipReady)
+            glTextureParameteri (tex->tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      }
+      else
+#endif
+      {
+         glnvg__bindTexture (gl, tex->tex);
+         glGenerateMipmap (GL_TEXTURE_2D);
+         if (!tex->mipReady)
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      }
+      tex->mipReady = 1;
+      tex->mipQueued = 0;
+      tex->mipFlush = gl->flushes;
+      texels += tex->width * tex->height;
+   }
+   gl->nmipQueue = n;
+   glnvg__bindTexture (gl, 0);
+   glnvg__checkError (gl, "generate mipmaps");
+#else
+   NVG_NOTUSED (gl);
+#endif
+}
+
+static int glnvg__renderCreateTexture (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data)
+{
    GLNVGcontext * gl = (GLNVGcontext *)uptr;
    GLNVGtexture * tex = glnvg__allocTexture (gl);
    if (tex == NULL) return 0;
+#if defined NANOVG_GL3
+   if (glnvg__atlasCompatible (gl, type, w, h, imageFlags) &&
+         (tex->page = glnvg__atlasAlloc (gl, w, h, &tex->x, &tex->y)) != 0)
+   {
+      tex->tex = gl->pages[tex->page - 1].tex;
+      tex->width = w;
+      tex->height = h;
+      tex->type = type;
+      tex->flags = imageFlags;
+      if (data != NULL)
+         glnvg__renderUpdateTexture (gl, tex->id, 0, 0, w, h, data);
+      return tex->id;
+   }
+#if NANOVG_GL_HAS_DSA
+   if (gl->dsaEnabled)
+   {
+      // Immutable storage, with room for the levels from the start when mipmaps are generated.
+      int levels = 1;
+      if (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS)
+         while ((glnvg__maxi (w, h) >> levels) > 0)
+            levels++;
+      glCreateTextures (GL_TEXTURE_2D, 1, &tex->tex);
+      tex->width = w;
+      tex->height = h;
+      tex->type = type;
+      tex->flags = imageFlags;
+      glTextureStorage2D (tex->tex, levels, type == NVG_TEXTURE_RGBA ? GL_RGBA8 : GL_R8, w, h);
+      glnvg__dsaTextureParameters (tex->tex, GL_LINEAR, imageFlags);
+      if (data != NULL)
+         glnvg__texSubImage (gl, tex, 0, 0, w, h, w, data);
+      glnvg__queueMipmaps (gl, tex);
+      glnvg__checkError (gl, "create tex");
+      tex->bytes = glnvg__textureBytes (type, w, h, imageFlags);
+      gl->textureBytes += tex->bytes;
+      return tex->id;
+   }
+#endif
+#endif
 #ifdef NANOVG_GLES2
    // Check for non-power of 2.
    if (glnvg__nearestPow2 (w) != (unsigned int)w || glnvg__nearestPow2 (h) != (unsigned int)h)
@@ -732,9 +2528,12 @@ static int glnvg__renderCreateTexture (void * uptr, int type, int w, int h, int
 #else
       glTexImage2D (GL_TEXTURE_2D, 0, GL_RED, w, h, 0, GL_RED, GL_UNSIGNED_BYTE, data);
 #endif
+#if defined (NANOVG_GL2)
    if (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS)
       glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
    else
+#endif
+      // Mipmapped filtering starts once the levels exist, until then level 0 alone keeps the texture complete.
       glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
    if (imageFlags & NVG_IMAGE_REPEATX)
@@ -751,13 +2550,59 @@ static int glnvg__renderCreateTexture (void * uptr, int type, int w, int h, int
    glPixelStorei (GL_UNPACK_SKIP_PIXELS, 0);
    glPixelStorei (GL_UNPACK_SKIP_ROWS, 0);
 #endif
-   // The new way to build mipmaps on GLES and GL3
+   // The new way to build mipmaps on GLES and GL3, deferred to a flush within the mipmap budget.
 #if !defined(NANOVG_GL2)
    if (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS)
-      glGenerateMipmap (GL_TEXTURE_2D);
+      glnvg__queueMipmaps (gl, tex);
 #endif
    glnvg__checkError (gl, "create tex");
    glnvg__bindTexture (gl, 0);
+   tex->bytes = glnvg__textureBytes (type, w, h, imageFlags);
+   gl->textureBytes += tex->bytes;
+   return tex->id;
+}
+
+// Uploads the levels of block compressed data as they are. Mipmaps cannot be generated from
+// compressed data, only the levels given are sampled.
+static int glnvg__renderCreateCompressedTexture (void * uptr, int format, int w, int h, int levels, int imageFlags,
+      const unsigned char * data)
+{
+   static const GLenum internalFormats[] =
+   {
+      0, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RGBA_BPTC_UNORM,
+      GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC
+   };
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGtexture * tex;
+   int i;
+   if ((gl->compressedFormats & (1 << format)) == 0) return 0;
+   tex = glnvg__allocTexture (gl);
+   if (tex == NULL) return 0;
+   imageFlags &= ~NVG_IMAGE_GENERATE_MIPMAPS;
+   glGenTextures (1, &tex->tex);
+   tex->width = w;
+   tex->height = h;
+   tex->type = NVG_TEXTURE_RGBA;
+   tex->flags = imageFlags;
+   tex->compressed = format;
+   glnvg__bindTexture (gl, tex->tex);
+   for (i = 0; i < levels; i++)
+   {
+      int lw = glnvg__maxi (1, w >> i), lh = glnvg__maxi (1, h >> i), size = nvgCompressedLevelSize (format, lw, lh);
+      glCompressedTexImage2D (GL_TEXTURE_2D, i, internalFormats[format], lw, lh, 0, size, data);
+      data += size;
+      tex->bytes += size;
+   }
+#ifndef NANOVG_GLES2
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+#endif
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (imageFlags & NVG_IMAGE_REPEATX) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (imageFlags & NVG_IMAGE_REPEATY) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+   glnvg__checkError (gl, "create compressed tex");
+   glnvg__bindTexture (gl, 0);
+   gl->textureBytes += tex->bytes;
    return tex->id;
 }
 
@@ -768,15 +2613,198 @@ static int glnvg__renderDeleteTexture (void * uptr, int image)
    return glnvg__deleteTexture (gl, image);
 }
 
+// Copies a rect of data, whose rows are rowLength pixels apart, into the texture, which is bound
+// unless it is updated through direct state access.
+static void glnvg__texSubImage (GLNVGcontext * gl, GLNVGtexture * tex, int x, int y, int w, int h, int rowLength,
+                                const unsigned char * data)
+{
+   glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+#ifndef NANOVG_GLES2
+   glPixelStorei (GL_UNPACK_ROW_LENGTH, rowLength);
+#else
+   NVG_NOTUSED (rowLength);
+#endif
+#if NANOVG_GL_HAS_DSA
+   if (gl->dsaEnabled)
+   {
+      if (tex->page != 0)
+         glTextureSubImage2D (tex->tex, 0, tex->x + x, tex->y + y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
+      else
+         glTextureSubImage2D (tex->tex, 0, x, y, w, h, tex->type == NVG_TEXTURE_RGBA ? GL_RGBA : GL_RED,
+                              GL_UNSIGNED_BYTE, data);
+   }
+   else
+#endif
+   {
+      glnvg__bindTexture (gl, tex->tex);
+      if (tex->page != 0)
+         glTexSubImage2D (GL_TEXTURE_2D, 0, tex->x + x, tex->y + y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
+      else
+      if (tex->type == NVG_TEXTURE_RGBA)
+         glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
+      else
+#ifdef NANOVG_GLES2
+         glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, w, h, GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
+#else
+         glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE, data);
+#endif
+   }
+   glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+#ifndef NANOVG_GLES2
+   glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+#endif
+}
+
+#if defined NANOVG_GL3
+// Keeps a copy of the rect for glnvg__flushUploads(), the caller may change data before the flush.
+// data points at the first pixel of the rect, its rows are rowBytes apart.
+static int glnvg__stageUpload (GLNVGcontext * gl, GLNVGtexture * tex, int x, int y, int w, int h,
+                               const unsigned char * data, int rowBytes)
+{
+   int bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1, size = w * h * bpp, row;
+   GLNVGupload * upload;
+   if (w <= 0 || h <= 0) return 1;
+   if (gl->nuploads + 1 > gl->cuploads)
+   {
+      int cuploads = glnvg__maxi (gl->nuploads + 1, 64) + gl->cuploads / 2;
+      GLNVGupload * uploads = (GLNVGupload *)realloc (gl->uploads, sizeof (GLNVGupload) * cuploads);
+      if (uploads == NULL) return 0;
+      gl->uploads = uploads;
+      gl->cuploads = cuploads;
+   }
+   if (gl->nuploadData + size > gl->cuploadData)
+   {
+      int cdata = glnvg__maxi (gl->nuploadData + size, 65536) + gl->cuploadData / 2;
+      unsigned char * bytes = (unsigned char *)realloc (gl->uploadData, cdata);
+      if (bytes == NULL) return 0;
+      gl->uploadData = bytes;
+      gl->cuploadData = cdata;
+   }
+   upload = &gl->uploads[gl->nuploads++];
+   upload->image = tex->id;
+   upload->x = x;
+   upload->y = y;
+   upload->w = w;
+   upload->h = h;
+   upload->offset = gl->nuploadData;
+   for (row = 0; row < h; row++)
+      memcpy (gl->uploadData + upload->offset + row * w * bpp, data + (size_t)row * rowBytes, w * bpp);
+   // Keep the next rect 4 byte aligned.
+   gl->nuploadData += (size + 3) & ~3;
+   return 1;
+}
+
+// Streams the staged rects through the next pixel unpack buffer of the ring and copies them into
+// their textures. Images deleted since they were updated are skipped.
+static void glnvg__flushUploads (GLNVGcontext * gl)
+{
+   int i, slot = gl->uploadIndex;
+   const unsigned char * base = gl->uploadData;
+   void * map = NULL;
+   if (gl->nuploads == 0) return;
+   if (gl->uploadFences[slot] != 0)
+   {
+      glClientWaitSync (gl->uploadFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+      glDeleteSync (gl->uploadFences[slot]);
+      gl->uploadFences[slot] = 0;
+   }
+   if (gl->uploadBufs[slot] == 0)
+      glGenBuffers (1, &gl->uploadBufs[slot]);
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, gl->uploadBufs[slot]);
+   if (gl->nuploadData > gl->uploadCapacity[slot])
+   {
+      gl->uploadCapacity[slot] = gl->cuploadData;
+      glBufferData (GL_PIXEL_UNPACK_BUFFER, gl->uploadCapacity[slot], NULL, GL_STREAM_DRAW);
+   }
+   map = glMapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0, gl->nuploadData, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+   if (map != NULL)
+   {
+      memcpy (map, gl->uploadData, gl->nuploadData);
+      glUnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+      base = NULL;
+   }
+   else
+      glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+   for (i = 0; i < gl->nuploads; i++)
+   {
+      GLNVGupload * upload = &gl->uploads[i];
+      GLNVGtexture * tex = glnvg__findTexture (gl, upload->image);
+      if (tex == NULL) continue;
+      glnvg__texSubImage (gl, tex, upload->x, upload->y, upload->w, upload->h, upload->w, base + upload->offset);
+      glnvg__queueMipmaps (gl, tex);
+   }
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+   glnvg__bindTexture (gl, 0);
+   if (base == NULL)
+   {
+      gl->uploadFences[slot] = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      gl->uploadIndex = (slot + 1) % NANOVG_GL_RING_SIZE;
+   }
+   gl->nuploads = 0;
+   gl->nuploadData = 0;
+}
+
+// Copies a rect into the next of the two pixel unpack buffers of the texture, taking turns, and updates
+// the texture from there, so the call neither waits for the GPU to finish reading the previous update
+// nor repacks padded rows.
+static void glnvg__streamRect (GLNVGcontext * gl, GLNVGtexture * tex, int x, int y, int w, int h,
+                               const unsigned char * data, int rowBytes)
+{
+   int bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+   int slot = tex->streamIndex, size = rowBytes * (h - 1) + w * bpp;
+   void * map;
+   if (tex->streamBufs[slot] == 0)
+      glGenBuffers (1, &tex->streamBufs[slot]);
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, tex->streamBufs[slot]);
+   if (tex->streamSizes[slot] < size)
+   {
+      glBufferData (GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+      tex->streamSizes[slot] = size;
+   }
+   // Invalidating lets the driver hand out fresh memory while the GPU still reads the old contents.
+   map = glMapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+   if (map != NULL)
+   {
+      memcpy (map, data, size);
+      glUnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+      data = NULL;
+   }
+   else
+      glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+   tex->streamIndex = 1 - slot;
+   glnvg__texSubImage (gl, tex, x, y, w, h, rowBytes / bpp, data);
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+static void glnvg__deleteUploads (GLNVGcontext * gl)
+{
+   int i;
+   for (i = 0; i < NANOVG_GL_RING_SIZE; i++)
+   {
+      if (gl->uploadFences[i] != 0)
+         glDeleteSync (gl->uploadFences[i]);
+      if (gl->uploadBufs[i] != 0)
+         glDeleteBuffers (1, &gl->uploadBufs[i]);
+   }
+   free (gl->uploads);
+   free (gl->uploadData);
+}
+#endif
+
 static int glnvg__renderUpdateTexture (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data)
 {
    GLNVGcontext * gl = (GLNVGcontext *)uptr;
    GLNVGtexture * tex = glnvg__findTexture (gl, image);
-   if (tex == NULL) return 0;
-   glnvg__bindTexture (gl, tex->tex);
-   glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+   if (tex == NULL || tex->compressed) return 0;
+#if defined NANOVG_GL3
+   {
+      int bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+      if (gl->uploadsEnabled
+          && glnvg__stageUpload (gl, tex, x, y, w, h, data + ((size_t)y * tex->width + x) * bpp, tex->width * bpp))
+         return 1;
+   }
+#endif
 #ifndef NANOVG_GLES2
-   glPixelStorei (GL_UNPACK_ROW_LENGTH, tex->width);
    glPixelStorei (GL_UNPACK_SKIP_PIXELS, x);
    glPixelStorei (GL_UNPACK_SKIP_ROWS, y);
 #else
@@ -788,21 +2816,62 @@ static int glnvg__renderUpdateTexture (void * uptr, int image, int x, int y, int
    x = 0;
    w = tex->width;
 #endif
-   if (tex->type == NVG_TEXTURE_RGBA)
-      glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
-   else
-#ifdef NANOVG_GLES2
-      glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, w, h, GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
-#else
-      glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE, data);
-#endif
-   glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+   glnvg__texSubImage (gl, tex, x, y, w, h, tex->width, data);
 #ifndef NANOVG_GLES2
-   glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
    glPixelStorei (GL_UNPACK_SKIP_PIXELS, 0);
    glPixelStorei (GL_UNPACK_SKIP_ROWS, 0);
 #endif
    glnvg__bindTexture (gl, 0);
+   glnvg__queueMipmaps (gl, tex);
+   return 1;
+}
+
+static int glnvg__renderUpdateTextureRegion (void * uptr, int image, int x, int y, int w, int h,
+                                             const unsigned char * data, int rowBytes)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   int bpp;
+   if (tex == NULL || tex->compressed) return 0;
+   bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+   if (rowBytes == 0)
+      rowBytes = w * bpp;
+   if (rowBytes < w * bpp || rowBytes % bpp != 0) return 0;
+   // Clip to the image, moving data along.
+   if (x < 0)
+   {
+      data -= x * bpp;
+      w += x;
+      x = 0;
+   }
+   if (y < 0)
+   {
+      data -= (ptrdiff_t)y * rowBytes;
+      h += y;
+      y = 0;
+   }
+   w = glnvg__mini (w, tex->width - x);
+   h = glnvg__mini (h, tex->height - y);
+   if (w <= 0 || h <= 0) return 1;
+#if defined NANOVG_GL3
+   if (gl->uploadsEnabled && glnvg__stageUpload (gl, tex, x, y, w, h, data, rowBytes))
+      return 1;
+   glnvg__streamRect (gl, tex, x, y, w, h, data, rowBytes);
+#elif defined NANOVG_GLES2
+   // No row length, padded rows go up one at a time.
+   if (rowBytes == w * bpp)
+      glnvg__texSubImage (gl, tex, x, y, w, h, w, data);
+   else
+   {
+      int row;
+      for (row = 0; row < h; row++)
+         glnvg__texSubImage (gl, tex, x, y + row, w, 1, w, data + (size_t)row * rowBytes);
+   }
+#else
+   glnvg__texSubImage (gl, tex, x, y, w, h, rowBytes / bpp, data);
+#endif
+   glnvg__bindTexture (gl, 0);
+   glnvg__queueMipmaps (gl, tex);
    return 1;
 }
 
@@ -862,13 +2931,48 @@ static int glnvg__convertPaint (GLNVGcontext * gl, GLNVGfragUniforms * frag, NVG
       glnvg__xformToMat3x4 (frag->scissorMat, invxform);
       frag->scissorExt[0] = scissor->extent[0];
       frag->scissorExt[1] = scissor->extent[1];
-      frag->scissorScale[0] = sqrtf (scissor->xform[0] * scissor->xform[0] + scissor->xform[2] * scissor->xform[2]) / fringe;
-      frag->scissorScale[1] = sqrtf (scissor->xform[1] * scissor->xform[1] + scissor->xform[3] * scissor->xform[3]) / fringe;
+      if (scissor->xform[1] == 0.0f && scissor->xform[2] == 0.0f)
+      {
+         frag->scissorScale[0] = fabsf (scissor->xform[0]) / fringe;
+         frag->scissorScale[1] = fabsf (scissor->xform[3]) / fringe;
+      }
+      else
+      {
+         frag->scissorScale[0] = sqrtf (scissor->xform[0] * scissor->xform[0] + scissor->xform[2] * scissor->xform[2]) / fringe;
+         frag->scissorScale[1] = sqrtf (scissor->xform[1] * scissor->xform[1] + scissor->xform[3] * scissor->xform[3]) / fringe;
+      }
    }
    memcpy (frag->extent, paint->extent, sizeof (frag->extent));
-   frag->strokeMult = (width * 0.5f + fringe * 0.5f) / fringe;
+   // Without fringes the edges are left to multisampling, strokes then keep full coverage up to them.
+   frag->strokeMult = gl->edgeAA ? (width * 0.5f + fringe * 0.5f) / fringe : 1e6f;
    frag->strokeThr = strokeThr;
-   if (paint->image != 0)
+   if (paint->ramp != NVG_RAMP_NONE)
+   {
+      // Texel centers of the gradient's row, within its atlas page if it was packed into one.
+      float w, h, x = 0.0f, y = 0.0f;
+      tex = glnvg__findTexture (gl, paint->image);
+      if (tex == NULL) return 0;
+      w = (float)tex->width;
+      h = (float)tex->height;
+#if defined NANOVG_GL3
+      if (tex->page != 0)
+      {
+         w = h = (float)NANOVG_GL_ATLAS_PAGE_SIZE;
+         x = (float)tex->x;
+         y = (float)tex->y;
+      }
+#endif
+      frag->texRect[0] = (x + 0.5f) / w;
+      frag->texRect[1] = (y + paint->rampRow + 0.5f) / h;
+      frag->texRect[2] = (x + tex->width - 0.5f) / w;
+      frag->texRect[3] = frag->texRect[1];
+      frag->type = NSVG_SHADER_FILLRAMP;
+      frag->texType = paint->ramp;
+      frag->radius = paint->radius;
+      frag->feather = paint->feather;
+      nvgTransformInverse (invxform, paint->xform);
+   }
+   else if (paint->image != 0)
    {
       tex = glnvg__findTexture (gl, paint->image);
       if (tex == NULL) return 0;
@@ -881,11 +2985,34 @@ static int glnvg__convertPaint (GLNVGcontext * gl, GLNVGfragUniforms * frag, NVG
       }
       else
          nvgTransformInverse (invxform, paint->xform);
+#if defined NANOVG_GL3
+      if (tex->page != 0)
+      {
+         // Map the image space onto its rectangle of the page.
+         const float size = (float)NANOVG_GL_ATLAS_PAGE_SIZE;
+         float page[6];
+         nvgTransformScale (page, tex->width / size, tex->height / size);
+         page[4] = paint->extent[0] * tex->x / size;
+         page[5] = paint->extent[1] * tex->y / size;
+         nvgTransformMultiply (invxform, page);
+         frag->texRect[0] = (tex->x + 0.5f) / size;
+         frag->texRect[1] = (tex->y + 0.5f) / size;
+         frag->texRect[2] = (tex->x + tex->width - 0.5f) / size;
+         frag->texRect[3] = (tex->y + tex->height - 0.5f) / size;
+      }
+#endif
       frag->type = NSVG_SHADER_FILLIMG;
       if (tex->type == NVG_TEXTURE_RGBA)
          frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
       else
-         frag->texType = 2;
+         if (tex->flags & NVG_IMAGE_DISTANCE_FIELD)
+         {
+            // Edge width, see NVGparams.distanceFieldText.
+            frag->texType = 3;
+            frag->feather = paint->feather;
+         }
+         else
+            frag->texType = 2;
       //		printf("frag->texType = %d\n", frag->texType);
    }
    else
@@ -901,14 +3028,33 @@ static int glnvg__convertPaint (GLNVGcontext * gl, GLNVGfragUniforms * frag, NVG
 
 static GLNVGfragUniforms * nvg__fragUniformPtr (GLNVGcontext * gl, int i);
 
-static void glnvg__setUniforms (GLNVGcontext * gl, int uniformOffset, int image)
+// Binds the paint of a uniform slot to the current program.
+static void glnvg__setPaintUniforms (GLNVGcontext * gl, int uniformOffset, int image)
 {
+#if defined NANOVG_GL3
+   if (gl->program == &gl->mergeShader)
+   {
+      // Paints are fetched per vertex, only select which of the call's paints to use.
+      int pass = uniformOffset / gl->fragSize - gl->callBase;
+      if (gl->paintPass != pass)
+      {
+         gl->paintPass = pass;
+         glUniform1i (gl->program->loc[GLNVG_LOC_PAINTPASS], pass);
+      }
+   }
+   else
+#endif
+   // Calls sharing a cached paint share its slot too.
+   if (gl->fragOffset != uniformOffset)
+   {
 #if NANOVG_GL_USE_UNIFORMBUFFER
-   glBindBufferRange (GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->fragBuf, uniformOffset, sizeof (GLNVGfragUniforms));
+      glBindBufferRange (GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->drawFragBuf, uniformOffset, sizeof (GLNVGfragUniforms));
 #else
-   GLNVGfragUniforms * frag = nvg__fragUniformPtr (gl, uniformOffset);
-   glUniform4fv (gl->shader.loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, & (frag->uniformArray[0][0]));
+      GLNVGfragUniforms * frag = nvg__fragUniformPtr (gl, uniformOffset);
+      glUniform4fv (gl->program->loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, & (frag->uniformArray[0][0]));
 #endif
+      gl->fragOffset = uniformOffset;
+   }
    if (image != 0)
    {
       GLNVGtexture * tex = glnvg__findTexture (gl, image);
@@ -919,96 +3065,405 @@ static void glnvg__setUniforms (GLNVGcontext * gl, int uniformOffset, int image)
       glnvg__bindTexture (gl, 0);
 }
 
-static void glnvg__renderViewport (void * uptr, int width, int height)
+// Makes a program current, setting the uniforms that stay the same for the flush on first use.
+static void glnvg__useProgram (GLNVGcontext * gl, GLNVGshader * shader)
 {
-   GLNVGcontext * gl = (GLNVGcontext *)uptr;
-   gl->view[0] = (float)width;
-   gl->view[1] = (float)height;
+   if (gl->program == shader) return;
+   glnvg__useProgramHandle (gl, shader->prog);
+   gl->program = shader;
+   // The paint uniforms of the previous program don't carry over.
+   gl->fragOffset = -1;
+#if defined NANOVG_GL3
+   gl->paintPass = -1;
+#endif
+   if (shader->flush != gl->flushes)
+   {
+      shader->flush = gl->flushes;
+      glUniform1i (shader->loc[GLNVG_LOC_TEX], 0);
+      glUniform2fv (shader->loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
+      glUniform1f (shader->loc[GLNVG_LOC_VERTEXSCALE], gl->vertsPacked ? 1.0f / NANOVG_GL_PACKED_SUBPIXELS : 1.0f);
+#if defined NANOVG_GL3
+      if (shader == &gl->mergeShader)
+         glUniform1i (shader->loc[GLNVG_LOC_PAINTS], 1);
+#endif
+   }
 }
 
-static void glnvg__fill (GLNVGcontext * gl, GLNVGcall * call)
+#if defined NANOVG_GL3
+// Builds the shader of an optional feature on first use. Features are optional, a driver that can't
+// build their shader simply has none.
+static int glnvg__featureShader (GLNVGcontext * gl, GLNVGshader * shader, signed char * state, const char * name,
+                                 const char * const * sources)
 {
-   GLNVGpath * paths = &gl->paths[call->pathOffset];
-   int i, npaths = call->pathCount;
-   // Draw shapes
-   glEnable (GL_STENCIL_TEST);
-   glnvg__stencilMask (gl, 0xff);
-   glnvg__stencilFunc (gl, GL_ALWAYS, 0, 0xff);
-   glColorMask (GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-   // set bindpoint for solid loc
-   glnvg__setUniforms (gl, call->uniformOffset, 0);
-   glnvg__checkError (gl, "fill simple");
-   glStencilOpSeparate (GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
-   glStencilOpSeparate (GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
-   glDisable (GL_CULL_FACE);
-   for (i = 0; i < npaths; i++)
-      glDrawArrays (GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
-   glEnable (GL_CULL_FACE);
-   // Draw anti-aliased pixels
-   glColorMask (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-   glnvg__setUniforms (gl, call->uniformOffset + gl->fragSize, call->image);
-   glnvg__checkError (gl, "fill fill");
-   if (gl->flags & NVG_ANTIALIAS)
+   if (*state == 0)
    {
-      glnvg__stencilFunc (gl, GL_EQUAL, 0x00, 0xff);
-      glStencilOp (GL_KEEP, GL_KEEP, GL_KEEP);
-      // Draw fringes
+      *state = -1;
+      if (glnvg__createShader (shader, name, gl->shaderHeader, NULL, sources[0], sources[1], gl->programCache))
+      {
+         glnvg__getUniforms (shader);
+         *state = 1;
+      }
+      else
+      {
+         glnvg__deleteShader (shader);
+         memset (shader, 0, sizeof (*shader));
+      }
+   }
+   return *state > 0;
+}
+#endif
+
+// Program of a variant key, built on first use. Falls back to the general program if that fails.
+static GLNVGshader * glnvg__variant (GLNVGcontext * gl, int key)
+{
+   GLNVGshader * shader = &gl->variants[key];
+   char opts[256];
+   if (gl->variantState[key] == 0)
+   {
+      snprintf (opts, sizeof (opts), "%s#define VARIANT_TYPE %d\n%s%s",
+                (key & GLNVG_VARIANT_EDGE_AA) ? "#define EDGE_AA 1\n" : "", key & GLNVG_VARIANT_TYPE,
+                (key & GLNVG_VARIANT_SCISSOR) ? "#define VARIANT_SCISSOR 1\n" : "",
+                (key & GLNVG_VARIANT_SHAPE) ? "#define VARIANT_SHAPE 1\n" : "");
+      gl->variantState[key] = -1;
+      if (glnvg__createShader (shader, "variant", gl->shaderHeader, opts, gl->vertShader, gl->fragShader, gl->programCache))
+      {
+         glnvg__getUniforms (shader);
+#if NANOVG_GL_USE_UNIFORMBUFFER
+         if (shader->loc[GLNVG_LOC_FRAG] != (GLint)GL_INVALID_INDEX)
+            glUniformBlockBinding (shader->prog, shader->loc[GLNVG_LOC_FRAG], GLNVG_FRAG_BINDING);
+#endif
+         gl->variantState[key] = 1;
+      }
+      else
+      {
+         glnvg__deleteShader (shader);
+         memset (shader, 0, sizeof (*shader));
+      }
+   }
+   return gl->variantState[key] > 0 ? shader : &gl->shader;
+}
+
+// Takes the variant key of every uniform slot of the flush, returns 0 if they can't be kept.
+static int glnvg__variantKeys (GLNVGcontext * gl)
+{
+   int i;
+   if (gl->nuniforms > gl->cvariantKeys)
+   {
+      int cvariantKeys = glnvg__maxi (gl->nuniforms, 128) + gl->cvariantKeys / 2; // 1.5x Overallocate
+      unsigned char * variantKeys = (unsigned char *)realloc (gl->variantKeys, cvariantKeys);
+      if (variantKeys == NULL) return 0;
+      gl->variantKeys = variantKeys;
+      gl->cvariantKeys = cvariantKeys;
+   }
+   for (i = 0; i < gl->nuniforms; i++)
+   {
+      GLNVGfragUniforms * frag = nvg__fragUniformPtr (gl, i * gl->fragSize);
+      int key = (int)frag->type & GLNVG_VARIANT_TYPE;
+      // Without a scissor the matrix is all zeros.
+      if (frag->scissorMat[10] != 0.0f)
+         key |= GLNVG_VARIANT_SCISSOR;
+      if (frag->shape[3] != 0.0f)
+         key |= GLNVG_VARIANT_SHAPE;
+      if (gl->edgeAA)
+         key |= GLNVG_VARIANT_EDGE_AA;
+      gl->variantKeys[i] = (unsigned char)key;
+   }
+   return 1;
+}
+
+// Selects the program for the paint of a uniform slot and binds the paint.
+static void glnvg__setUniforms (GLNVGcontext * gl, int uniformOffset, int image)
+{
+   if (gl->useVariants)
+      glnvg__useProgram (gl, glnvg__variant (gl, gl->variantKeys[uniformOffset / gl->fragSize]));
+   glnvg__setPaintUniforms (gl, uniformOffset, image);
+}
+
+static void glnvg__renderViewport (void * uptr, int width, int height, float devicePixelRatio)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   gl->view[0] = (float)width;
+   gl->view[1] = (float)height;
+   gl->pixelRatio = devicePixelRatio;
+}
+
+// Switches the hardware scissor to the one of the call.
+static void glnvg__setClip (GLNVGcontext * gl, const GLNVGcall * call)
+{
+   if (!call->clipped)
+   {
+      if (gl->clipped)
+         glnvg__enable (gl, GL_SCISSOR_TEST, 0);
+      gl->clipped = 0;
+      return;
+   }
+   if (!gl->clipped)
+      glnvg__enable (gl, GL_SCISSOR_TEST, 1);
+   if (!gl->clipped || memcmp (gl->clip, call->clip, sizeof (gl->clip)) != 0)
+   {
+      // GL counts rows from the bottom.
+      int height = (int) (gl->view[1] * gl->pixelRatio + 0.5f);
+      glScissor (call->clip[0], height - call->clip[1] - call->clip[3], call->clip[2], call->clip[3]);
+      memcpy (gl->clip, call->clip, sizeof (gl->clip));
+   }
+   gl->clipped = 1;
+}
+
+#if defined NANOVG_GL3
+static int glnvg__sameClip (const GLNVGcall * a, const GLNVGcall * b)
+{
+   return a->clipped == b->clipped && (!a->clipped || memcmp (a->clip, b->clip, sizeof (a->clip)) == 0);
+}
+#endif
+
+static void glnvg__beginScope (GLNVGcontext * gl, const char * name)
+{
+   if (gl->profile != NULL)
+      gl->profile (gl->profileUser, name, 1);
+}
+
+static void glnvg__endScope (GLNVGcontext * gl)
+{
+   if (gl->profile != NULL)
+      gl->profile (gl->profileUser, NULL, 0);
+}
+
+static void glnvg__drawArrays (GLNVGcontext * gl, GLenum mode, GLint first, GLsizei count)
+{
+   glDrawArrays (mode, first, count);
+   gl->issuedDraws++;
+}
+
+#if NANOVG_GL_HAS_MULTIDRAW
+static int glnvg__reserveMulti (GLNVGcontext * gl, int n)
+{
+   if (n > gl->cmulti)
+   {
+      int cmulti = glnvg__maxi (n, 64) + gl->cmulti / 2; // 1.5x Overallocate
+      GLint * first = (GLint *)realloc (gl->multiFirst, sizeof (GLint) * cmulti);
+      GLsizei * count;
+      if (first == NULL) return 0;
+      gl->multiFirst = first;
+      count = (GLsizei *)realloc (gl->multiCount, sizeof (GLsizei) * cmulti);
+      if (count == NULL) return 0;
+      gl->multiCount = count;
+      gl->cmulti = cmulti;
+   }
+   return 1;
+}
+#endif
+
+// Draws the fill or the stroke vertices of paths, in one draw where multi-draws are available.
+static void glnvg__drawPaths (GLNVGcontext * gl, GLenum mode, const GLNVGpath * paths, int npaths, int stroke)
+{
+   int i;
+#if NANOVG_GL_HAS_DSA
+   if (npaths > 1 && gl->drawIndirect)
+   {
+      // The fill and stroke commands of a path are adjacent, every other one is drawn.
+      size_t command = (size_t) ((paths - gl->paths) * 2 + stroke) * sizeof (GLNVGdrawCommand);
+      glMultiDrawArraysIndirect (mode, (const GLvoid *)command, npaths, 2 * sizeof (GLNVGdrawCommand));
+      gl->issuedDraws++;
+      return;
+   }
+#endif
+#if NANOVG_GL_HAS_MULTIDRAW
+   if (npaths > 1 && glnvg__reserveMulti (gl, npaths))
+   {
+      int n = 0;
       for (i = 0; i < npaths; i++)
-         glDrawArrays (GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+      {
+         gl->multiFirst[n] = stroke ? paths[i].strokeOffset : paths[i].fillOffset;
+         gl->multiCount[n] = stroke ? paths[i].strokeCount : paths[i].fillCount;
+         if (gl->multiCount[n] > 0)
+            n++;
+      }
+      if (n > 0)
+      {
+         glMultiDrawArrays (mode, gl->multiFirst, gl->multiCount, n);
+         gl->issuedDraws++;
+      }
+      return;
+   }
+#endif
+   for (i = 0; i < npaths; i++)
+   {
+      if (stroke && paths[i].strokeCount > 0)
+         glnvg__drawArrays (gl, mode, paths[i].strokeOffset, paths[i].strokeCount);
+      else if (!stroke && paths[i].fillCount > 0)
+         glnvg__drawArrays (gl, mode, paths[i].fillOffset, paths[i].fillCount);
+   }
+}
+
+#if NANOVG_GL_HAS_PATH_RENDERING
+// Keeps the fill polygons of paths as path commands, drawn by glnvg__stencilPath(). Returns 0 when
+// out of memory, the fill is then stencilled with fans.
+static int glnvg__allocPathCommands (GLNVGcontext * gl, GLNVGcall * call, const NVGpath * paths, int npaths)
+{
+   int i, j, ncommands = 0, ncoords = 0;
+   GLubyte * command;
+   float * coord;
+   for (i = 0; i < npaths; i++)
+   {
+      if (paths[i].nfill < 3) continue;
+      ncommands += paths[i].nfill + 1;
+      ncoords += paths[i].nfill * 2;
+   }
+   if (ncommands == 0) return 0;
+   if (gl->npathCommands + ncommands > gl->cpathCommands)
+   {
+      int cpathCommands = glnvg__maxi (gl->npathCommands + ncommands, 4096) + gl->cpathCommands / 2; // 1.5x Overallocate
+      GLubyte * pathCommands = (GLubyte *)realloc (gl->pathCommands, cpathCommands);
+      if (pathCommands == NULL) return 0;
+      gl->pathCommands = pathCommands;
+      gl->cpathCommands = cpathCommands;
+   }
+   if (gl->npathCoords + ncoords > gl->cpathCoords)
+   {
+      int cpathCoords = glnvg__maxi (gl->npathCoords + ncoords, 8192) + gl->cpathCoords / 2; // 1.5x Overallocate
+      float * pathCoords = (float *)realloc (gl->pathCoords, sizeof (float) * cpathCoords);
+      if (pathCoords == NULL) return 0;
+      gl->pathCoords = pathCoords;
+      gl->cpathCoords = cpathCoords;
+   }
+   call->commandOffset = gl->npathCommands;
+   call->commandCount = ncommands;
+   call->coordOffset = gl->npathCoords;
+   call->coordCount = ncoords;
+   command = &gl->pathCommands[gl->npathCommands];
+   coord = &gl->pathCoords[gl->npathCoords];
+   // Every sub-path is a closed polygon through the fill vertices, as the fan drawn without.
+   for (i = 0; i < npaths; i++)
+   {
+      const NVGpath * path = &paths[i];
+      if (path->nfill < 3) continue;
+      for (j = 0; j < path->nfill; j++)
+      {
+         *command++ = j == 0 ? GL_MOVE_TO_NV : GL_LINE_TO_NV;
+         *coord++ = path->fill[j].x;
+         *coord++ = path->fill[j].y;
+      }
+      *command++ = GL_CLOSE_PATH_NV;
+   }
+   gl->npathCommands += ncommands;
+   gl->npathCoords += ncoords;
+   return 1;
+}
+
+// Counts the winding of a fill into the stencil buffer with the path renderer, as the fans of
+// glnvg__fill() do with wrapping increments and decrements.
+static void glnvg__stencilPath (GLNVGcontext * gl, GLNVGcall * call)
+{
+   GLuint path = gl->pathObjects + gl->nextPathObject;
+   gl->nextPathObject = (gl->nextPathObject + 1) % NANOVG_GL_PATH_OBJECTS;
+   if (gl->pathFlush != gl->flushes)
+   {
+      // Path coordinates are in view units like vertices, see the vertex shader.
+      const float identity[6] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+      const float projection[6] = { 2.0f / gl->view[0], 0.0f, 0.0f, -2.0f / gl->view[1], -1.0f, 1.0f };
+      glMatrixLoad3x2fNV (GL_PATH_MODELVIEW_NV, identity);
+      glMatrixLoad3x2fNV (GL_PATH_PROJECTION_NV, projection);
+      gl->pathFlush = gl->flushes;
+   }
+   glPathCommandsNV (path, call->commandCount, &gl->pathCommands[call->commandOffset], call->coordCount, GL_FLOAT,
+                     &gl->pathCoords[call->coordOffset]);
+   glStencilFillPathNV (path, GL_COUNT_UP_NV, 0xff);
+   gl->issuedDraws++;
+}
+#endif
+
+static void glnvg__fill (GLNVGcontext * gl, GLNVGcall * call)
+{
+   GLNVGpath * paths = &gl->paths[call->pathOffset];
+   int npaths = call->pathCount;
+   glnvg__beginScope (gl, "fill");
+   glnvg__beginScope (gl, "fill stencil pass");
+   gl->stencilPasses += gl->edgeAA ? 3 : 2;
+   // Draw shapes
+   glnvg__enable (gl, GL_STENCIL_TEST, 1);
+   glnvg__stencilMask (gl, 0xff);
+#if NANOVG_GL_HAS_PATH_RENDERING
+   if (call->commandCount > 0)
+      glnvg__stencilPath (gl, call);
+   else
+#endif
+   {
+      glnvg__stencilFunc (gl, GL_ALWAYS, 0, 0xff);
+      glnvg__colorMask (gl, 0);
+      // set bindpoint for solid loc
+      glnvg__setUniforms (gl, call->uniformOffset, 0);
+      glnvg__checkError (gl, "fill simple");
+      glnvg__stencilOpSeparate (gl, 0, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+      glnvg__stencilOpSeparate (gl, 1, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+      glnvg__enable (gl, GL_CULL_FACE, 0);
+      glnvg__drawPaths (gl, GL_TRIANGLE_FAN, paths, npaths, 0);
+      glnvg__enable (gl, GL_CULL_FACE, 1);
+   }
+   glnvg__endScope (gl);
+   // Draw anti-aliased pixels
+   glnvg__colorMask (gl, 1);
+   glnvg__setUniforms (gl, call->uniformOffset + gl->fragSize, call->image);
+   glnvg__checkError (gl, "fill fill");
+   if (gl->edgeAA)
+   {
+      glnvg__stencilFunc (gl, GL_EQUAL, 0x00, 0xff);
+      glnvg__stencilOp (gl, GL_KEEP, GL_KEEP, GL_KEEP);
+      // Draw fringes
+      glnvg__drawPaths (gl, GL_TRIANGLE_STRIP, paths, npaths, 1);
    }
    // Draw fill
    glnvg__stencilFunc (gl, GL_NOTEQUAL, 0x0, 0xff);
-   glStencilOp (GL_ZERO, GL_ZERO, GL_ZERO);
-   glDrawArrays (GL_TRIANGLES, call->triangleOffset, call->triangleCount);
-   glDisable (GL_STENCIL_TEST);
+   glnvg__stencilOp (gl, GL_ZERO, GL_ZERO, GL_ZERO);
+   glnvg__drawArrays (gl, GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+   glnvg__enable (gl, GL_STENCIL_TEST, 0);
+   glnvg__endScope (gl);
 }
 
 static void glnvg__convexFill (GLNVGcontext * gl, GLNVGcall * call)
 {
    GLNVGpath * paths = &gl->paths[call->pathOffset];
-   int i, npaths = call->pathCount;
+   int npaths = call->pathCount;
+   glnvg__beginScope (gl, "convex fill");
    glnvg__setUniforms (gl, call->uniformOffset, call->image);
    glnvg__checkError (gl, "convex fill");
-   for (i = 0; i < npaths; i++)
-      glDrawArrays (GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
-   if (gl->flags & NVG_ANTIALIAS)
+   glnvg__drawPaths (gl, call->fillTriangles ? GL_TRIANGLES : GL_TRIANGLE_FAN, paths, npaths, 0);
+   if (gl->edgeAA)
    {
       // Draw fringes
-      for (i = 0; i < npaths; i++)
-         glDrawArrays (GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+      glnvg__drawPaths (gl, GL_TRIANGLE_STRIP, paths, npaths, 1);
    }
+   glnvg__endScope (gl);
 }
 
 static void glnvg__stroke (GLNVGcontext * gl, GLNVGcall * call)
 {
    GLNVGpath * paths = &gl->paths[call->pathOffset];
-   int npaths = call->pathCount, i;
-   if (gl->flags & NVG_STENCIL_STROKES)
+   int npaths = call->pathCount;
+   glnvg__beginScope (gl, "stroke");
+   if (call->stencilStroke)
    {
-      glEnable (GL_STENCIL_TEST);
+      glnvg__enable (gl, GL_STENCIL_TEST, 1);
       glnvg__stencilMask (gl, 0xff);
+      gl->stencilPasses += 3;
       // Fill the stroke base without overlap
       glnvg__stencilFunc (gl, GL_EQUAL, 0x0, 0xff);
-      glStencilOp (GL_KEEP, GL_KEEP, GL_INCR);
+      glnvg__stencilOp (gl, GL_KEEP, GL_KEEP, GL_INCR);
       glnvg__setUniforms (gl, call->uniformOffset + gl->fragSize, call->image);
       glnvg__checkError (gl, "stroke fill 0");
-      for (i = 0; i < npaths; i++)
-         glDrawArrays (GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+      glnvg__drawPaths (gl, GL_TRIANGLE_STRIP, paths, npaths, 1);
       // Draw anti-aliased pixels.
       glnvg__setUniforms (gl, call->uniformOffset, call->image);
       glnvg__stencilFunc (gl, GL_EQUAL, 0x00, 0xff);
-      glStencilOp (GL_KEEP, GL_KEEP, GL_KEEP);
-      for (i = 0; i < npaths; i++)
-         glDrawArrays (GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+      glnvg__stencilOp (gl, GL_KEEP, GL_KEEP, GL_KEEP);
+      glnvg__drawPaths (gl, GL_TRIANGLE_STRIP, paths, npaths, 1);
       // Clear stencil buffer.
-      glColorMask (GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      glnvg__colorMask (gl, 0);
       glnvg__stencilFunc (gl, GL_ALWAYS, 0x0, 0xff);
-      glStencilOp (GL_ZERO, GL_ZERO, GL_ZERO);
+      glnvg__stencilOp (gl, GL_ZERO, GL_ZERO, GL_ZERO);
       glnvg__checkError (gl, "stroke fill 1");
-      for (i = 0; i < npaths; i++)
-         glDrawArrays (GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
-      glColorMask (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-      glDisable (GL_STENCIL_TEST);
+      glnvg__drawPaths (gl, GL_TRIANGLE_STRIP, paths, npaths, 1);
+      glnvg__colorMask (gl, 1);
+      glnvg__enable (gl, GL_STENCIL_TEST, 0);
       //		glnvg__convertPaint(gl, nvg__fragUniformPtr(gl, call->uniformOffset + gl->fragSize), paint, scissor, strokeWidth, fringe, 1.0f - 0.5f/255.0f);
    }
    else
@@ -1016,79 +3471,772 @@ static void glnvg__stroke (GLNVGcontext * gl, GLNVGcall * call)
       glnvg__setUniforms (gl, call->uniformOffset, call->image);
       glnvg__checkError (gl, "stroke fill");
       // Draw Strokes
-      for (i = 0; i < npaths; i++)
-         glDrawArrays (GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+      glnvg__drawPaths (gl, GL_TRIANGLE_STRIP, paths, npaths, 1);
    }
+   glnvg__endScope (gl);
 }
 
+// Triangle calls come from text rendering.
 static void glnvg__triangles (GLNVGcontext * gl, GLNVGcall * call)
 {
+   glnvg__beginScope (gl, "text");
    glnvg__setUniforms (gl, call->uniformOffset, call->image);
    glnvg__checkError (gl, "triangles fill");
-   glDrawArrays (GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+   glnvg__drawArrays (gl, GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+   glnvg__endScope (gl);
+}
+
+// Shape calls draw a single quad covering an analytic shape.
+static void glnvg__shape (GLNVGcontext * gl, GLNVGcall * call)
+{
+   glnvg__beginScope (gl, "shape");
+   glnvg__setUniforms (gl, call->uniformOffset, call->image);
+   glnvg__checkError (gl, "shape fill");
+   glnvg__drawArrays (gl, GL_TRIANGLE_FAN, call->triangleOffset, call->triangleCount);
+   glnvg__endScope (gl);
+}
+
+#if defined NANOVG_GL3
+// Switches the vertex inputs between the vertex buffer and the instanced quads.
+static void glnvg__setQuadMode (GLNVGcontext * gl, int on)
+{
+   int i;
+   if (gl->quadMode == on) return;
+   gl->quadMode = on;
+   for (i = 0; i < 3; i++)
+   {
+      if (i == 2 && !gl->merge) break;
+      if (on)
+         glDisableVertexAttribArray (i);
+      else
+         glEnableVertexAttribArray (i);
+   }
+   for (i = 3; i < 7; i++)
+   {
+      if (i == 6 && !gl->merge) break;
+      if (on)
+         glEnableVertexAttribArray (i);
+      else
+         glDisableVertexAttribArray (i);
+   }
+   // Set on the program drawing the quads, which stays current until they are switched off.
+   glUniform1i (gl->program->loc[GLNVG_LOC_QUADS], on);
+}
+
+// Quad calls come from text rendering, every glyph is one instance.
+static void glnvg__quads (GLNVGcontext * gl, GLNVGcall * call)
+{
+   const GLvoid * base = (const GLvoid *) (call->quadOffset * sizeof (GLNVGquad));
+   glnvg__beginScope (gl, "text quads");
+   glnvg__useProgram (gl, gl->merge ? &gl->mergeShader : &gl->shader);
+   glnvg__setQuadMode (gl, 1);
+   glnvg__setPaintUniforms (gl, call->uniformOffset, call->image);
+   glnvg__checkError (gl, "quads fill");
+   glBindBuffer (GL_ARRAY_BUFFER, gl->quadBuf);
+   glVertexAttribPointer (3, 4, GL_FLOAT, GL_FALSE, sizeof (GLNVGquad), base);
+   glVertexAttribPointer (4, 2, GL_FLOAT, GL_FALSE, sizeof (GLNVGquad), (const GLvoid *) ((const char *)base + 4 * sizeof (float)));
+   glVertexAttribPointer (5, 4, GL_FLOAT, GL_FALSE, sizeof (GLNVGquad), (const GLvoid *) ((const char *)base + 6 * sizeof (float)));
+   if (gl->merge)
+      glVertexAttribIPointer (6, 1, GL_INT, sizeof (GLNVGquad), (const GLvoid *) ((const char *)base + 10 * sizeof (float)));
+   glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, call->quadCount);
+   gl->issuedDraws++;
+   glnvg__endScope (gl);
+}
+
+// Uploads the quad instances and makes their attributes advance once per instance.
+static void glnvg__uploadQuads (GLNVGcontext * gl)
+{
+   int i;
+   gl->vertexBytes += gl->nquads * (int)sizeof (GLNVGquad);
+   glBindBuffer (GL_ARRAY_BUFFER, gl->quadBuf);
+   glBufferData (GL_ARRAY_BUFFER, gl->nquads * sizeof (GLNVGquad), gl->quads, GL_STREAM_DRAW);
+   for (i = 3; i < 7; i++)
+      glVertexAttribDivisor (i, 1);
+   gl->quadMode = 0;
+   glUniform1i (gl->shader.loc[GLNVG_LOC_QUADS], 0);
+}
+
+// Draws a plot with its own program, reading the samples where the ring stands at flush time.
+static void glnvg__plot (GLNVGcontext * gl, GLNVGcall * call)
+{
+   GLNVGplotDraw * draw = &gl->plotDraws[call->plotOffset];
+   GLNVGplot * plot = &gl->plots[draw->plot - 1];
+   float * u = draw->uniforms;
+   // Deleted since it was drawn, or too few samples for a segment.
+   if (plot->tex == 0 || plot->count < 2) return;
+   glnvg__beginScope (gl, "plot");
+   u[7 * 4 + 2] = (float) ((plot->head - plot->count + plot->capacity) % plot->capacity);
+   u[7 * 4 + 3] = (float)plot->count;
+   u[8 * 4 + 0] = (float)plot->capacity;
+   glnvg__useProgramHandle (gl, gl->plotShader.prog);
+   glUniform2fv (gl->plotShader.loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
+   glUniform1i (gl->plotShader.loc[GLNVG_LOC_TEX], 0);
+   glUniform4fv (gl->plotShader.loc[GLNVG_LOC_PLOT], NANOVG_GL_PLOT_VEC4S, u);
+   glnvg__bindTexture (gl, plot->tex);
+   // Segments of a falling line wind the other way.
+   glnvg__enable (gl, GL_CULL_FACE, 0);
+   if (u[10 * 4 + 3] > 0.0f)
+   {
+      glUniform1i (gl->plotShader.loc[GLNVG_LOC_PLOTPASS], 0);
+      glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, plot->count - 1);
+      gl->issuedDraws++;
+   }
+   if (u[9 * 4 + 3] > 0.0f)
+   {
+      glUniform1i (gl->plotShader.loc[GLNVG_LOC_PLOTPASS], 1);
+      glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, plot->count - 1);
+      gl->issuedDraws++;
+   }
+   glnvg__enable (gl, GL_CULL_FACE, 1);
+   gl->program = NULL;
+   glnvg__useProgram (gl, &gl->shader);
+   glnvg__endScope (gl);
+}
+
+static int glnvg__mergeable (GLNVGcall * call)
+{
+   // Shared shapes are drawn as instances instead.
+   if (call->instanced)
+      return 0;
+   if (call->type == GLNVG_CONVEXFILL || call->type == GLNVG_TRIANGLES || call->type == GLNVG_SHAPE)
+      return 1;
+   // Stencil strokes need their stencil passes between calls.
+   return call->type == GLNVG_STROKE && !call->stencilStroke;
+}
+
+static int glnvg__reserveIndices (GLNVGcontext * gl, int n)
+{
+   if (gl->nindices + n > gl->cindices)
+   {
+      GLuint * indices;
+      int cindices = glnvg__maxi (gl->nindices + n, 4096) + gl->cindices / 2; // 1.5x Overallocate
+      indices = (GLuint *)realloc (gl->indices, sizeof (GLuint) * cindices);
+      if (indices == NULL) return 0;
+      gl->indices = indices;
+      gl->cindices = cindices;
+   }
+   return 1;
+}
+
+// Appends a triangle fan as a triangle list.
+static int glnvg__pushFan (GLNVGcontext * gl, int offset, int count)
+{
+   GLuint * dst;
+   int k;
+   if (count < 3) return 1;
+   if (!glnvg__reserveIndices (gl, (count - 2) * 3)) return 0;
+   dst = &gl->indices[gl->nindices];
+   for (k = 1; k < count - 1; k++)
+   {
+      *dst++ = offset;
+      *dst++ = offset + k;
+      *dst++ = offset + k + 1;
+   }
+   gl->nindices += (count - 2) * 3;
+   return 1;
+}
+
+// Appends a triangle strip as a triangle list, keeping the winding of every triangle.
+static int glnvg__pushStrip (GLNVGcontext * gl, int offset, int count)
+{
+   GLuint * dst;
+   int k;
+   if (count < 3) return 1;
+   if (!glnvg__reserveIndices (gl, (count - 2) * 3)) return 0;
+   dst = &gl->indices[gl->nindices];
+   for (k = 0; k < count - 2; k++)
+   {
+      *dst++ = offset + k + (k & 1);
+      *dst++ = offset + k + 1 - (k & 1);
+      *dst++ = offset + k + 2;
+   }
+   gl->nindices += (count - 2) * 3;
+   return 1;
+}
+
+static int glnvg__pushList (GLNVGcontext * gl, int offset, int count)
+{
+   int k;
+   if (count <= 0) return 1;
+   if (!glnvg__reserveIndices (gl, count)) return 0;
+   for (k = 0; k < count; k++)
+      gl->indices[gl->nindices++] = offset + k;
+   return 1;
+}
+
+// Appends the geometry of a call in the order its unmerged draws would have issued it.
+static int glnvg__pushCallIndices (GLNVGcontext * gl, GLNVGcall * call)
+{
+   GLNVGpath * paths = &gl->paths[call->pathOffset];
+   int i;
+   if (call->type == GLNVG_TRIANGLES)
+      return glnvg__pushList (gl, call->triangleOffset, call->triangleCount);
+   if (call->type == GLNVG_SHAPE)
+      return glnvg__pushFan (gl, call->triangleOffset, call->triangleCount);
+   if (call->type == GLNVG_CONVEXFILL)
+   {
+      for (i = 0; i < call->pathCount; i++)
+         if (call->fillTriangles ? !glnvg__pushList (gl, paths[i].fillOffset, paths[i].fillCount) :
+               !glnvg__pushFan (gl, paths[i].fillOffset, paths[i].fillCount)) return 0;
+      if (!gl->edgeAA)
+         return 1;
+   }
+   for (i = 0; i < call->pathCount; i++)
+      if (!glnvg__pushStrip (gl, paths[i].strokeOffset, paths[i].strokeCount)) return 0;
+   return 1;
+}
+
+static void glnvg__growBounds (float * b, const NVGvertex * verts, int nverts)
+{
+   int i;
+   for (i = 0; i < nverts; i++)
+   {
+      b[0] = fminf (b[0], verts[i].x);
+      b[1] = fminf (b[1], verts[i].y);
+      b[2] = fmaxf (b[2], verts[i].x);
+      b[3] = fmaxf (b[3], verts[i].y);
+   }
+}
+
+// Bounds of everything a call draws, fringes included.
+static void glnvg__callBounds (GLNVGcontext * gl, const GLNVGcall * call, float * b)
+{
+   const GLNVGpath * paths = &gl->paths[call->pathOffset];
+   int i, k;
+   b[0] = b[1] = 1e30f;
+   b[2] = b[3] = -1e30f;
+   if (call->type == GLNVG_PLOT)
+   {
+      // Drawn by its own program, nothing moves across it.
+      b[0] = b[1] = -1e30f;
+      b[2] = b[3] = 1e30f;
+      return;
+   }
+   for (i = 0; i < call->pathCount; i++)
+   {
+      glnvg__growBounds (b, &gl->verts[paths[i].fillOffset], paths[i].fillCount);
+      glnvg__growBounds (b, &gl->verts[paths[i].strokeOffset], paths[i].strokeCount);
+   }
+   glnvg__growBounds (b, &gl->verts[call->triangleOffset], call->triangleCount);
+   for (i = 0; i < call->quadCount; i++)
+   {
+      const GLNVGquad * q = &gl->quads[call->quadOffset + i];
+      for (k = 0; k < 4; k++)
+      {
+         float x = q->pos[0] + ((k & 1) ? q->pos[2] : 0.0f) + ((k & 2) ? q->edge[0] : 0.0f);
+         float y = q->pos[1] + ((k & 1) ? q->pos[3] : 0.0f) + ((k & 2) ? q->edge[1] : 0.0f);
+         b[0] = fminf (b[0], x);
+         b[1] = fminf (b[1], y);
+         b[2] = fmaxf (b[2], x);
+         b[3] = fmaxf (b[3], y);
+      }
+   }
+   if (call->instanced)
+   {
+      b[0] += call->offset[0];
+      b[1] += call->offset[1];
+      b[2] += call->offset[0];
+      b[3] += call->offset[1];
+   }
+}
+
+static int glnvg__boundsOverlap (const float * a, const float * b)
+{
+   // A pixel of slack for coverage rounded outwards.
+   return a[0] < b[2] + 1.0f && b[0] < a[2] + 1.0f && a[1] < b[3] + 1.0f && b[1] < a[3] + 1.0f;
+}
+
+// Calls that end up in the same draw when adjacent, see glnvg__prepareMerge.
+static int glnvg__batchable (GLNVGcall * a, GLNVGcall * b)
+{
+   if (a->texture != b->texture || !glnvg__sameClip (a, b)) return 0;
+   if (a->type == GLNVG_QUADS || b->type == GLNVG_QUADS)
+      return a->type == b->type;
+   if (a->instanced || b->instanced)
+      return a->instanced && b->instanced && a->pathOffset == b->pathOffset;
+   return glnvg__mergeable (a) && glnvg__mergeable (b);
+}
+
+// Moves every call that can join an earlier batch right behind it, unless it overlaps a call in
+// between, then lays the quads out in the new order so that runs of text stay contiguous.
+// Draw order only changes between calls that share no pixels, so the result looks the same.
+static void glnvg__reorderCalls (GLNVGcontext * gl)
+{
+   int i, k, n, moved = 0;
+   if (gl->ncalls < 3) return;
+   if (gl->ncalls > gl->ccallOrder)
+   {
+      int ccallOrder = glnvg__maxi (gl->ncalls, 256) + gl->ccallOrder / 2; // 1.5x Overallocate
+      int * callOrder = (int *)realloc (gl->callOrder, sizeof (int) * ccallOrder);
+      float * callBounds;
+      if (callOrder == NULL) return;
+      gl->callOrder = callOrder;
+      callBounds = (float *)realloc (gl->callBounds, sizeof (float) * 4 * ccallOrder);
+      if (callBounds == NULL) return;
+      gl->callBounds = callBounds;
+      gl->ccallOrder = ccallOrder;
+   }
+   if (gl->ncalls > gl->csortedCalls)
+   {
+      GLNVGcall * sortedCalls = (GLNVGcall *)realloc (gl->sortedCalls, sizeof (GLNVGcall) * gl->ccalls);
+      if (sortedCalls == NULL) return;
+      gl->sortedCalls = sortedCalls;
+      gl->csortedCalls = gl->ccalls;
+   }
+   if (gl->nquads > gl->csortedQuads)
+   {
+      GLNVGquad * sortedQuads = (GLNVGquad *)realloc (gl->sortedQuads, sizeof (GLNVGquad) * gl->cquads);
+      if (sortedQuads == NULL) return;
+      gl->sortedQuads = sortedQuads;
+      gl->csortedQuads = gl->cquads;
+   }
+   for (i = 0; i < gl->ncalls; i++)
+      glnvg__callBounds (gl, &gl->calls[i], &gl->callBounds[i * 4]);
+   for (n = 0; n < gl->ncalls; n++)
+   {
+      GLNVGcall * call = &gl->calls[n];
+      const float * b = &gl->callBounds[n * 4];
+      int pos = n;
+      if (call->type != GLNVG_PLOT)
+      {
+         for (k = n - 1; k >= 0 && k >= n - NANOVG_GL_REORDER_WINDOW; k--)
+         {
+            int other = gl->callOrder[k];
+            if (glnvg__batchable (&gl->calls[other], call))
+            {
+               pos = k + 1;
+               break;
+            }
+            if (glnvg__boundsOverlap (&gl->callBounds[other * 4], b))
+               break;
+         }
+      }
+      if (pos < n)
+      {
+         memmove (&gl->callOrder[pos + 1], &gl->callOrder[pos], sizeof (int) * (n - pos));
+         moved = 1;
+      }
+      gl->callOrder[pos] = n;
+   }
+   if (!moved) return;
+   for (i = 0, k = 0; i < gl->ncalls; i++)
+   {
+      GLNVGcall * call = &gl->sortedCalls[i];
+      *call = gl->calls[gl->callOrder[i]];
+      if (call->quadCount > 0)
+      {
+         memcpy (&gl->sortedQuads[k], &gl->quads[call->quadOffset], sizeof (GLNVGquad) * call->quadCount);
+         call->quadOffset = k;
+         k += call->quadCount;
+      }
+   }
+   memcpy (gl->calls, gl->sortedCalls, sizeof (GLNVGcall) * gl->ncalls);
+   if (k > 0)
+      memcpy (gl->quads, gl->sortedQuads, sizeof (GLNVGquad) * k);
+}
+
+static int glnvg__reserveInstances (GLNVGcontext * gl, int n)
+{
+   if (gl->ninstances + n > gl->cinstances)
+   {
+      GLNVGinstance * instances;
+      int cinstances = glnvg__maxi (gl->ninstances + n, 256) + gl->cinstances / 2; // 1.5x Overallocate
+      instances = (GLNVGinstance *)realloc (gl->instances, sizeof (GLNVGinstance) * cinstances);
+      if (instances == NULL) return 0;
+      gl->instances = instances;
+      gl->cinstances = cinstances;
+   }
+   return 1;
+}
+
+static void glnvg__setPaintIndex (GLNVGcontext * gl, int offset, int count, int paint)
+{
+   int k;
+   for (k = 0; k < count; k++)
+      gl->paintIdx[offset + k] = paint;
+}
+
+// Builds the per vertex paint indices and the paint buffer, and turns runs of compatible calls
+// into single indexed draws.
+static int glnvg__prepareMerge (GLNVGcontext * gl)
+{
+   int i, j, nfloats = gl->nuniforms * NANOVG_GL_PAINT_FLOATS;
+   gl->nindices = 0;
+   if (gl->nverts > gl->cpaintIdx)
+   {
+      int cpaintIdx = glnvg__maxi (gl->nverts, 4096) + gl->cpaintIdx / 2; // 1.5x Overallocate
+      int * paintIdx = (int *)realloc (gl->paintIdx, sizeof (int) * cpaintIdx);
+      if (paintIdx == NULL) return 0;
+      gl->paintIdx = paintIdx;
+      gl->cpaintIdx = cpaintIdx;
+   }
+   if (nfloats > gl->cpaints)
+   {
+      int cpaints = glnvg__maxi (nfloats, 128 * NANOVG_GL_PAINT_FLOATS) + gl->cpaints / 2; // 1.5x Overallocate
+      float * paints = (float *)realloc (gl->paints, sizeof (float) * cpaints);
+      if (paints == NULL) return 0;
+      gl->paints = paints;
+      gl->cpaints = cpaints;
+   }
+   // Repack the uniform block layout as vec4s, converting the trailing ints.
+   for (i = 0; i < gl->nuniforms; i++)
+   {
+      GLNVGfragUniforms * frag = nvg__fragUniformPtr (gl, i * gl->fragSize);
+      float * dst = &gl->paints[i * NANOVG_GL_PAINT_FLOATS];
+      memcpy (dst, frag, sizeof (float) * (NANOVG_GL_PAINT_FLOATS - 10));
+      dst[NANOVG_GL_PAINT_FLOATS - 10] = (float)frag->texType;
+      dst[NANOVG_GL_PAINT_FLOATS - 9] = (float)frag->type;
+      memcpy (&dst[NANOVG_GL_PAINT_FLOATS - 8], frag->shape, sizeof (frag->shape));
+      memcpy (&dst[NANOVG_GL_PAINT_FLOATS - 4], frag->texRect, sizeof (frag->texRect));
+   }
+   for (i = 0; i < gl->ncalls; i++)
+   {
+      GLNVGcall * call = &gl->calls[i];
+      GLNVGpath * paths = &gl->paths[call->pathOffset];
+      int paint = call->uniformOffset / gl->fragSize;
+      // Instances take their paint from the instance, and share the vertices with other calls.
+      for (j = 0; j < call->pathCount && !call->instanced; j++)
+      {
+         glnvg__setPaintIndex (gl, paths[j].fillOffset, paths[j].fillCount, paint);
+         glnvg__setPaintIndex (gl, paths[j].strokeOffset, paths[j].strokeCount, paint);
+      }
+      glnvg__setPaintIndex (gl, call->triangleOffset, call->triangleCount, paint);
+      for (j = 0; j < call->quadCount; j++)
+         gl->quads[call->quadOffset + j].paint = paint;
+      call->mergeCount = 0;
+      // Images sharing an atlas page can be merged, so compare textures rather than images.
+      if (call->image != 0)
+      {
+         GLNVGtexture * tex = glnvg__findTexture (gl, call->image);
+         call->texture = tex != NULL ? tex->tex : 0;
+      }
+      else
+         call->texture = 0;
+   }
+   if (gl->flags & NVG_REORDER_CALLS)
+      glnvg__reorderCalls (gl);
+   // Runs of text quads with the same atlas become single instanced draws.
+   for (i = 0; i < gl->ncalls; i = j)
+   {
+      GLNVGcall * call = &gl->calls[i];
+      j = i + 1;
+      if (call->type != GLNVG_QUADS) continue;
+      while (j < gl->ncalls && gl->calls[j].type == GLNVG_QUADS && gl->calls[j].texture == call->texture &&
+             gl->calls[j].quadOffset == call->quadOffset + call->quadCount && glnvg__sameClip (call, &gl->calls[j]))
+      {
+         call->quadCount += gl->calls[j].quadCount;
+         j++;
+      }
+      if (j - i > 1)
+         call->mergeCount = j - i;
+   }
+   // Runs of calls drawing the same shape become single instanced draws, even runs of one, as
+   // only the first call of a shape has vertices where it is drawn.
+   gl->ninstances = 0;
+   for (i = 0; i < gl->ncalls; i = j)
+   {
+      GLNVGcall * call = &gl->calls[i];
+      j = i + 1;
+      if (!call->instanced) continue;
+      while (j < gl->ncalls && gl->calls[j].instanced && gl->calls[j].pathOffset == call->pathOffset &&
+             gl->calls[j].texture == call->texture && glnvg__sameClip (call, &gl->calls[j]))
+         j++;
+      if (!glnvg__reserveInstances (gl, j - i)) return 0;
+      call->indexOffset = gl->nindices;
+      if (!glnvg__pushCallIndices (gl, call)) return 0;
+      call->indexCount = gl->nindices - call->indexOffset;
+      call->instanceOffset = gl->ninstances;
+      call->mergeCount = j - i;
+      for (; i < j; i++)
+      {
+         GLNVGinstance * instance = &gl->instances[gl->ninstances++];
+         instance->offset[0] = gl->calls[i].offset[0];
+         instance->offset[1] = gl->calls[i].offset[1];
+         instance->paint = gl->calls[i].uniformOffset / gl->fragSize;
+      }
+   }
+   for (i = 0; i < gl->ncalls; i = j)
+   {
+      GLNVGcall * call = &gl->calls[i];
+      j = i + 1;
+      if (!glnvg__mergeable (call)) continue;
+      while (j < gl->ncalls && gl->calls[j].texture == call->texture && glnvg__mergeable (&gl->calls[j]) &&
+             glnvg__sameClip (call, &gl->calls[j]))
+         j++;
+      if (j - i < 2) continue;
+      call->indexOffset = gl->nindices;
+      for (; i < j; i++)
+         if (!glnvg__pushCallIndices (gl, &gl->calls[i])) return 0;
+      call->indexCount = gl->nindices - call->indexOffset;
+      call->mergeCount = (int) (&gl->calls[j] - call);
+   }
+   return 1;
+}
+
+static void glnvg__mergedCalls (GLNVGcontext * gl, GLNVGcall * call)
+{
+   glnvg__beginScope (gl, "merged calls");
+   glnvg__useProgram (gl, &gl->mergeShader);
+   glnvg__setPaintUniforms (gl, call->uniformOffset, call->image);
+   glnvg__checkError (gl, "merged calls");
+   glDrawElements (GL_TRIANGLES, call->indexCount, GL_UNSIGNED_INT, (const GLvoid *) (call->indexOffset * sizeof (GLuint)));
+   gl->issuedDraws++;
+   glnvg__endScope (gl);
+}
+
+// Draws a run of calls sharing a shape, every call is one instance.
+static void glnvg__instances (GLNVGcontext * gl, GLNVGcall * call)
+{
+   const GLvoid * base = (const GLvoid *) (call->instanceOffset * sizeof (GLNVGinstance));
+   glnvg__beginScope (gl, "shape instances");
+   glnvg__useProgram (gl, &gl->mergeShader);
+   glnvg__setPaintUniforms (gl, call->uniformOffset, call->image);
+   glnvg__checkError (gl, "shape instances");
+   glBindBuffer (GL_ARRAY_BUFFER, gl->instanceBuf);
+   glVertexAttribPointer (7, 2, GL_FLOAT, GL_FALSE, sizeof (GLNVGinstance), base);
+   glVertexAttribIPointer (8, 1, GL_INT, sizeof (GLNVGinstance), (const GLvoid *) ((const char *)base + 2 * sizeof (float)));
+   glEnableVertexAttribArray (7);
+   glEnableVertexAttribArray (8);
+   glUniform1i (gl->mergeShader.loc[GLNVG_LOC_INSTANCES], 1);
+   glDrawElementsInstanced (GL_TRIANGLES, call->indexCount, GL_UNSIGNED_INT,
+                            (const GLvoid *) (call->indexOffset * sizeof (GLuint)), call->mergeCount);
+   glUniform1i (gl->mergeShader.loc[GLNVG_LOC_INSTANCES], 0);
+   glDisableVertexAttribArray (7);
+   glDisableVertexAttribArray (8);
+   gl->issuedDraws++;
+   glnvg__endScope (gl);
 }
 
+// Uploads the instances of shared shapes and makes their attributes advance once per instance.
+static void glnvg__uploadInstances (GLNVGcontext * gl)
+{
+   gl->vertexBytes += gl->ninstances * (int)sizeof (GLNVGinstance);
+   glBindBuffer (GL_ARRAY_BUFFER, gl->instanceBuf);
+   glBufferData (GL_ARRAY_BUFFER, gl->ninstances * sizeof (GLNVGinstance), gl->instances, GL_STREAM_DRAW);
+   glVertexAttribDivisor (7, 1);
+   glVertexAttribDivisor (8, 1);
+}
+
+// Uploads the paint buffer, paint indices and merged indices. Expects the vertex array to be bound.
+static void glnvg__uploadMerge (GLNVGcontext * gl)
+{
+   gl->vertexBytes += gl->nverts * (int)sizeof (int) + gl->nindices * (int)sizeof (GLuint);
+   gl->uniformBytes += gl->nuniforms * NANOVG_GL_PAINT_FLOATS * (int)sizeof (float);
+   glBindBuffer (GL_TEXTURE_BUFFER, gl->paintBuf);
+   glBufferData (GL_TEXTURE_BUFFER, gl->nuniforms * NANOVG_GL_PAINT_FLOATS * sizeof (float), gl->paints, GL_STREAM_DRAW);
+   glnvg__activeTexture (gl, GL_TEXTURE1);
+   glBindTexture (GL_TEXTURE_BUFFER, gl->paintTex);
+   glTexBuffer (GL_TEXTURE_BUFFER, GL_RGBA32F, gl->paintBuf);
+   glnvg__activeTexture (gl, GL_TEXTURE0);
+   glBindBuffer (GL_TEXTURE_BUFFER, 0);
+   glBindBuffer (GL_ARRAY_BUFFER, gl->paintIdxBuf);
+   glBufferData (GL_ARRAY_BUFFER, gl->nverts * sizeof (int), gl->paintIdx, GL_STREAM_DRAW);
+   glEnableVertexAttribArray (2);
+   glVertexAttribIPointer (2, 1, GL_INT, sizeof (int), (const GLvoid *) (size_t)0);
+   glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, gl->indexBuf);
+   glBufferData (GL_ELEMENT_ARRAY_BUFFER, gl->nindices * sizeof (GLuint), gl->indices, GL_STREAM_DRAW);
+}
+#endif
+
+static void glnvg__resetPaintCache (GLNVGcontext * gl)
+{
+   // Bumping the frame invalidates every entry without touching the table. Frame 0 marks empty entries.
+   if (++gl->paintFrame == 0)
+   {
+      if (gl->paintCache != NULL)
+         memset (gl->paintCache, 0, sizeof (GLNVGpaintEntry) * gl->cpaintCache);
+      gl->paintFrame = 1;
+#if defined NANOVG_GL3
+      if (gl->shapes != NULL)
+         memset (gl->shapes, 0, sizeof (GLNVGshapeEntry) * gl->cshapes);
+#endif
+   }
+   gl->npaintCache = 0;
+#if defined NANOVG_GL3
+   gl->nshapes = 0;
+#endif
+}
+
+#if defined NANOVG_GL_HAS_LAYERS
+static void glnvg__popLayer (GLNVGcontext * gl);
+#endif
+
 static void glnvg__renderCancel (void * uptr)
 {
    GLNVGcontext * gl = (GLNVGcontext *)uptr;
+#if defined NANOVG_GL_HAS_LAYERS
+   while (gl->nlayerStack > 0)
+      glnvg__popLayer (gl);
+#endif
+   gl->layerFlushed = 0;
    gl->nverts = 0;
    gl->npaths = 0;
    gl->ncalls = 0;
    gl->nuniforms = 0;
+   glnvg__resetPaintCache (gl);
+#if defined NANOVG_GL3
+   gl->nquads = 0;
+   gl->ninstances = 0;
+   gl->nplotDraws = 0;
+   gl->npathCommands = 0;
+   gl->npathCoords = 0;
+#endif
 }
 
-static void glnvg__renderFlush (void * uptr)
+// Draws the calls so far to the bound framebuffer.
+static void glnvg__drawCalls (GLNVGcontext * gl)
 {
-   GLNVGcontext * gl = (GLNVGcontext *)uptr;
-   int i;
+   int i, vertBytes;
+   const void * vertData;
+#if defined NANOVG_GL3
+   GLuint vertArr;
+#endif
+#if defined NANOVG_GL3
+   if (gl->nuploads > 0)
+   {
+      glnvg__beginScope (gl, "texture uploads");
+      glnvg__flushUploads (gl);
+      glnvg__endScope (gl);
+   }
+#endif
+   gl->flushes++;
+   if (gl->nmipQueue > 0)
+   {
+      glnvg__beginScope (gl, "mipmaps");
+      glnvg__generateMipmaps (gl);
+      glnvg__endScope (gl);
+   }
+#if defined NANOVG_GL3
+   // The shader needs the paint buffer, drop the frame if it can't be built.
+   if (gl->merge && gl->ncalls > 0 && !glnvg__prepareMerge (gl))
+      gl->ncalls = 0;
+#endif
+   gl->useVariants = gl->variantsEnabled && gl->ncalls > 0 && glnvg__variantKeys (gl);
+   gl->vertsPacked = (gl->flags & NVG_PACKED_VERTICES) && gl->ncalls > 0 && !gl->vertsMapped && glnvg__packVerts (gl);
    if (gl->ncalls > 0)
    {
-      // Setup require GL state.
-      glUseProgram (gl->shader.prog);
-      glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-      glEnable (GL_CULL_FACE);
-      glCullFace (GL_BACK);
-      glFrontFace (GL_CCW);
-      glEnable (GL_BLEND);
-      glDisable (GL_DEPTH_TEST);
-      glDisable (GL_SCISSOR_TEST);
-      glColorMask (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-      glStencilMask (0xffffffff);
-      glStencilOp (GL_KEEP, GL_KEEP, GL_KEEP);
-      glStencilFunc (GL_ALWAYS, 0, 0xffffffff);
-      glActiveTexture (GL_TEXTURE0);
-      glBindTexture (GL_TEXTURE_2D, 0);
-#if NANOVG_GL_USE_STATE_FILTER
-      gl->boundTexture = 0;
-      gl->stencilMask = 0xffffffff;
-      gl->stencilFunc = GL_ALWAYS;
-      gl->stencilFuncRef = 0;
-      gl->stencilFuncMask = 0xffffffff;
+      glnvg__beginScope (gl, "nanovg flush");
+      // Setup require GL state, view and texture are set just once per frame. Only state that
+      // differs from a shared shadow is set, see nvglShareState().
+      if (gl->state == &gl->ownState)
+         gl->ownState.known = 0;
+      gl->program = NULL;
+      glnvg__useProgram (gl, &gl->shader);
+      glnvg__blendFunc (gl, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+      glnvg__enable (gl, GL_CULL_FACE, 1);
+      glnvg__cullMode (gl, GL_BACK, GL_CCW);
+      glnvg__enable (gl, GL_BLEND, 1);
+      glnvg__enable (gl, GL_DEPTH_TEST, 0);
+      glnvg__enable (gl, GL_SCISSOR_TEST, 0);
+      gl->clipped = 0;
+      glnvg__colorMask (gl, 1);
+      glnvg__stencilMask (gl, 0xffffffff);
+      glnvg__stencilOp (gl, GL_KEEP, GL_KEEP, GL_KEEP);
+      glnvg__stencilFunc (gl, GL_ALWAYS, 0, 0xffffffff);
+      glnvg__activeTexture (gl, GL_TEXTURE0);
+      gl->fragOffset = -1;
+      // Upload vertex data
+      vertData = glnvg__vertexData (gl, &vertBytes);
+#if defined NANOVG_GL3
+      vertArr = gl->windowVertArr != 0 ? gl->windowVertArr : gl->vertArr;
+      glnvg__bindVertexArray (gl, vertArr);
+      if (!gl->ringEnabled || !glnvg__flushRingFrame (gl))
+#endif
+      {
+#if NANOVG_GL_HAS_DSA
+         if (gl->dsaEnabled)
+         {
+            glnvg__namedBufferData (&gl->fragBuf, &gl->fragBufSize, gl->uniforms, gl->nuniforms * gl->fragSize);
+            glnvg__namedBufferData (&gl->vertBuf, &gl->vertBufSize, vertData, vertBytes);
+         }
+         else
 #endif
+         {
 #if NANOVG_GL_USE_UNIFORMBUFFER
-      // Upload ubo for frag shaders
-      glBindBuffer (GL_UNIFORM_BUFFER, gl->fragBuf);
-      glBufferData (GL_UNIFORM_BUFFER, gl->nuniforms * gl->fragSize, gl->uniforms, GL_STREAM_DRAW);
+            // Upload ubo for frag shaders
+            glBindBuffer (GL_UNIFORM_BUFFER, gl->fragBuf);
+            glBufferData (GL_UNIFORM_BUFFER, gl->nuniforms * gl->fragSize, gl->uniforms, GL_STREAM_DRAW);
+#endif
+            glBindBuffer (GL_ARRAY_BUFFER, gl->vertBuf);
+            glBufferData (GL_ARRAY_BUFFER, vertBytes, vertData, GL_STREAM_DRAW);
+         }
+#if NANOVG_GL_USE_UNIFORMBUFFER
+         gl->drawFragBuf = gl->fragBuf;
 #endif
-      // Upload vertex data
 #if defined NANOVG_GL3
-      glBindVertexArray (gl->vertArr);
+         gl->drawVertBuf = gl->vertBuf;
 #endif
-      glBindBuffer (GL_ARRAY_BUFFER, gl->vertBuf);
-      glBufferData (GL_ARRAY_BUFFER, gl->nverts * sizeof (NVGvertex), gl->verts, GL_STREAM_DRAW);
+      }
+      gl->vertexBytes += vertBytes;
+      gl->uniformBytes += gl->nuniforms * gl->fragSize;
       glEnableVertexAttribArray (0);
       glEnableVertexAttribArray (1);
-      glVertexAttribPointer (0, 2, GL_FLOAT, GL_FALSE, sizeof (NVGvertex), (const GLvoid *) (size_t)0);
-      glVertexAttribPointer (1, 2, GL_FLOAT, GL_FALSE, sizeof (NVGvertex), (const GLvoid *) (0 + 2 * sizeof (float)));
-      // Set view and texture just once per frame.
-      glUniform1i (gl->shader.loc[GLNVG_LOC_TEX], 0);
-      glUniform2fv (gl->shader.loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
+#if NANOVG_GL_HAS_DSA
+      if (gl->dsaEnabled)
+      {
+         glnvg__dsaVertexBuffer (gl, vertArr);
+         gl->drawIndirect = gl->npaths > 0 && glnvg__uploadCommands (gl);
+      }
+      else
+#endif
+      {
+#if defined NANOVG_GL3
+         glBindBuffer (GL_ARRAY_BUFFER, gl->drawVertBuf);
+#endif
+         if (gl->vertsPacked)
+         {
+            glVertexAttribPointer (0, 2, GL_SHORT, GL_FALSE, sizeof (GLNVGpackedVertex), (const GLvoid *) (size_t)0);
+            glVertexAttribPointer (1, 2, GL_SHORT, GL_TRUE, sizeof (GLNVGpackedVertex), (const GLvoid *) (0 + 2 * sizeof (short)));
+         }
+         else
+         {
+            glVertexAttribPointer (0, 2, GL_FLOAT, GL_FALSE, sizeof (NVGvertex), (const GLvoid *) (size_t)0);
+            glVertexAttribPointer (1, 2, GL_FLOAT, GL_FALSE, sizeof (NVGvertex), (const GLvoid *) (0 + 2 * sizeof (float)));
+         }
+      }
 #if NANOVG_GL_USE_UNIFORMBUFFER
-      glBindBuffer (GL_UNIFORM_BUFFER, gl->fragBuf);
+      glBindBuffer (GL_UNIFORM_BUFFER, gl->drawFragBuf);
+#endif
+#if defined NANOVG_GL3
+      if (gl->merge)
+         glnvg__uploadMerge (gl);
+      if (gl->nquads > 0)
+         glnvg__uploadQuads (gl);
+      if (gl->ninstances > 0)
+         glnvg__uploadInstances (gl);
 #endif
       for (i = 0; i < gl->ncalls; i++)
       {
          GLNVGcall * call = &gl->calls[i];
+         glnvg__setClip (gl, call);
+#if defined NANOVG_GL3
+         gl->callBase = call->uniformOffset / gl->fragSize;
+         if (call->type == GLNVG_QUADS)
+         {
+            glnvg__quads (gl, call);
+            if (call->mergeCount > 0)
+               i += call->mergeCount - 1;
+            continue;
+         }
+         glnvg__setQuadMode (gl, 0);
+         if (call->type == GLNVG_PLOT)
+         {
+            glnvg__plot (gl, call);
+            continue;
+         }
+         if (call->instanced)
+         {
+            glnvg__instances (gl, call);
+            i += call->mergeCount - 1;
+            continue;
+         }
+         if (call->mergeCount > 0)
+         {
+            glnvg__mergedCalls (gl, call);
+            i += call->mergeCount - 1;
+            continue;
+         }
+#endif
          if (call->type == GLNVG_FILL)
             glnvg__fill (gl, call);
          else
@@ -1100,22 +4248,546 @@ static void glnvg__renderFlush (void * uptr)
                else
                   if (call->type == GLNVG_TRIANGLES)
                      glnvg__triangles (gl, call);
+                  else
+                     if (call->type == GLNVG_SHAPE)
+                        glnvg__shape (gl, call);
       }
+#if defined NANOVG_GL3
+      glnvg__setQuadMode (gl, 0);
+#endif
+      if (gl->clipped)
+         glnvg__enable (gl, GL_SCISSOR_TEST, 0);
       glDisableVertexAttribArray (0);
       glDisableVertexAttribArray (1);
 #if defined NANOVG_GL3
-      glBindVertexArray (0);
+      if (gl->merge)
+      {
+         glDisableVertexAttribArray (2);
+         glnvg__activeTexture (gl, GL_TEXTURE1);
+         glBindTexture (GL_TEXTURE_BUFFER, 0);
+         glnvg__activeTexture (gl, GL_TEXTURE0);
+      }
+#if NANOVG_GL_HAS_DSA
+      if (gl->drawIndirect)
+         glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+      gl->drawIndirect = 0;
+#endif
 #endif
-      glDisable (GL_CULL_FACE);
       glBindBuffer (GL_ARRAY_BUFFER, 0);
-      glUseProgram (0);
-      glnvg__bindTexture (gl, 0);
+      gl->program = NULL;
+      // A shared shadow takes the state over as it is, the application syncs from it.
+      if (gl->state == &gl->ownState)
+      {
+#if defined NANOVG_GL3
+         glnvg__bindVertexArray (gl, 0);
+#endif
+         glnvg__enable (gl, GL_CULL_FACE, 0);
+         glnvg__useProgramHandle (gl, 0);
+         glnvg__bindTexture (gl, 0);
+         gl->ownState.known = 0;
+      }
+      glnvg__endScope (gl);
    }
+#if defined NANOVG_GL3
+   glnvg__endRingFrame (gl);
+#endif
+   gl->memory.renderCalls = gl->ncalls;
+   gl->memory.renderPaths = gl->npaths;
+   gl->memory.renderVerts = gl->nverts;
+   gl->memory.renderUniforms = gl->nuniforms;
    // Reset calls
    gl->nverts = 0;
    gl->npaths = 0;
    gl->ncalls = 0;
    gl->nuniforms = 0;
+   glnvg__resetPaintCache (gl);
+#if defined NANOVG_GL3
+   gl->nquads = 0;
+   gl->ninstances = 0;
+   gl->nplotDraws = 0;
+   gl->npathCommands = 0;
+   gl->npathCoords = 0;
+#endif
+}
+
+// Zeroes the counters of renderStats(), unless a layer drew calls of the frame already.
+static void glnvg__resetCounters (GLNVGcontext * gl)
+{
+   if (gl->layerFlushed) return;
+   gl->issuedDraws = 0;
+   gl->vertexBytes = 0;
+   gl->uniformBytes = 0;
+   gl->textureBinds = 0;
+   gl->stencilPasses = 0;
+}
+
+static void glnvg__renderFlush (void * uptr)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   glnvg__resetCounters (gl);
+   gl->layerFlushed = 0;
+   glnvg__drawCalls (gl);
+}
+
+#if defined NANOVG_GL_HAS_LAYERS
+static void glnvg__deleteLayerTarget (GLNVGlayerTarget * target)
+{
+   if (target->fbo != 0)
+      glDeleteFramebuffers (1, &target->fbo);
+   if (target->stencil != 0)
+      glDeleteRenderbuffers (1, &target->stencil);
+   memset (target, 0, sizeof (*target));
+}
+
+// Returns the index of a framebuffer whose stencil covers w x h, making one if none does, or -1.
+static int glnvg__layerTarget (GLNVGcontext * gl, int w, int h)
+{
+   GLNVGlayerTarget * target;
+   GLint fbo, rbo;
+   int i, best = -1, spare = -1;
+   for (i = 0; i < NANOVG_GL_LAYER_TARGETS; i++)
+   {
+      target = &gl->layerTargets[i];
+      if (target->open) continue;
+      if (target->width >= w && target->height >= h &&
+          (best < 0 || target->width * target->height < gl->layerTargets[best].width * gl->layerTargets[best].height))
+         best = i;
+      // A free slot, or else the smallest closed one, makes room for a larger target.
+      if (spare < 0 || target->width * target->height < gl->layerTargets[spare].width * gl->layerTargets[spare].height)
+         spare = i;
+   }
+   if (best >= 0) return best;
+   if (spare < 0) return -1;
+   target = &gl->layerTargets[spare];
+   glnvg__deleteLayerTarget (target);
+   target->width = (w + NANOVG_GL_LAYER_STEP - 1) / NANOVG_GL_LAYER_STEP * NANOVG_GL_LAYER_STEP;
+   target->height = (h + NANOVG_GL_LAYER_STEP - 1) / NANOVG_GL_LAYER_STEP * NANOVG_GL_LAYER_STEP;
+   glGetIntegerv (GL_FRAMEBUFFER_BINDING, &fbo);
+   glGetIntegerv (GL_RENDERBUFFER_BINDING, &rbo);
+   glGenFramebuffers (1, &target->fbo);
+   glGenRenderbuffers (1, &target->stencil);
+   glBindRenderbuffer (GL_RENDERBUFFER, target->stencil);
+   glRenderbufferStorage (GL_RENDERBUFFER, GL_STENCIL_INDEX8, target->width, target->height);
+   glBindFramebuffer (GL_FRAMEBUFFER, target->fbo);
+   glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target->stencil);
+   glBindFramebuffer (GL_FRAMEBUFFER, fbo);
+   glBindRenderbuffer (GL_RENDERBUFFER, rbo);
+   return spare;
+}
+
+static int glnvg__renderBeginLayer (void * uptr, int image)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   GLNVGlayerScope * scope;
+   GLNVGlayerTarget * target;
+   GLint fbo, viewport[4];
+   int index;
+   if (tex == NULL || tex->page != 0 || gl->nlayerStack >= NANOVG_GL_MAX_LAYER_DEPTH) return 0;
+   index = glnvg__layerTarget (gl, tex->width, tex->height);
+   if (index < 0) return 0;
+   target = &gl->layerTargets[index];
+   glGetIntegerv (GL_FRAMEBUFFER_BINDING, &fbo);
+   glGetIntegerv (GL_VIEWPORT, viewport);
+   glBindFramebuffer (GL_FRAMEBUFFER, target->fbo);
+   glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex->tex, 0);
+   if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+   {
+      glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+      glBindFramebuffer (GL_FRAMEBUFFER, fbo);
+      return 0;
+   }
+   // The calls so far belong to the previous target.
+   glBindFramebuffer (GL_FRAMEBUFFER, fbo);
+   glnvg__resetCounters (gl);
+   gl->layerFlushed = 1;
+   glnvg__drawCalls (gl);
+   scope = &gl->layerStack[gl->nlayerStack++];
+   scope->target = index;
+   scope->fbo = fbo;
+   memcpy (scope->viewport, viewport, sizeof (viewport));
+   target->open = 1;
+   glBindFramebuffer (GL_FRAMEBUFFER, target->fbo);
+   glViewport (0, 0, tex->width, tex->height);
+   glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+   glClearStencil (0);
+   glClear (GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+   return 1;
+}
+
+// Switches back to the target before the layer begun last.
+static void glnvg__popLayer (GLNVGcontext * gl)
+{
+   GLNVGlayerScope * scope = &gl->layerStack[--gl->nlayerStack];
+   GLNVGlayerTarget * target = &gl->layerTargets[scope->target];
+   glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+   target->open = 0;
+   glBindFramebuffer (GL_FRAMEBUFFER, scope->fbo);
+   glViewport (scope->viewport[0], scope->viewport[1], scope->viewport[2], scope->viewport[3]);
+}
+
+static void glnvg__renderEndLayer (void * uptr)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   if (gl->nlayerStack <= 0) return;
+   glnvg__resetCounters (gl);
+   gl->layerFlushed = 1;
+   glnvg__drawCalls (gl);
+   glnvg__popLayer (gl);
+}
+#endif
+
+#if defined NANOVG_GL3
+static void glnvg__deleteBlurLevel (GLNVGblurLevel * level)
+{
+   if (level->fbo != 0)
+      glDeleteFramebuffers (1, &level->fbo);
+   if (level->tex != 0)
+      glDeleteTextures (1, &level->tex);
+   memset (level, 0, sizeof (*level));
+}
+
+// Returns blur level i with a texture of at least w x h, bound as the framebuffer, or NULL.
+static GLNVGblurLevel * glnvg__blurLevel (GLNVGcontext * gl, int i, int w, int h)
+{
+   GLNVGblurLevel * level = &gl->blurLevels[i];
+   int width, height;
+   if (level->width >= w && level->height >= h)
+   {
+      glBindFramebuffer (GL_FRAMEBUFFER, level->fbo);
+      return level;
+   }
+   width = glnvg__maxi (level->width, (w + NANOVG_GL_BLUR_STEP - 1) / NANOVG_GL_BLUR_STEP * NANOVG_GL_BLUR_STEP);
+   height = glnvg__maxi (level->height, (h + NANOVG_GL_BLUR_STEP - 1) / NANOVG_GL_BLUR_STEP * NANOVG_GL_BLUR_STEP);
+   glnvg__deleteBlurLevel (level);
+   glGenTextures (1, &level->tex);
+   glnvg__bindTexture (gl, level->tex);
+   glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glGenFramebuffers (1, &level->fbo);
+   glBindFramebuffer (GL_FRAMEBUFFER, level->fbo);
+   glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, level->tex, 0);
+   if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+   {
+      glnvg__deleteBlurLevel (level);
+      return NULL;
+   }
+   level->width = width;
+   level->height = height;
+   return level;
+}
+
+// Draws the w x h region of tex, a tw x th texture, over the dw x dh framebuffer bound.
+static void glnvg__blurPass (GLNVGcontext * gl, GLuint tex, int w, int h, int tw, int th, int dw, int dh, int pass)
+{
+   glViewport (0, 0, dw, dh);
+   glnvg__bindTexture (gl, tex);
+   glUniform4f (gl->blurShader.loc[GLNVG_LOC_BLURREGION], (float)w / tw, (float)h / th, 1.0f / tw, 1.0f / th);
+   glUniform1i (gl->blurShader.loc[GLNVG_LOC_BLURPASS], pass);
+   glDrawArrays (GL_TRIANGLE_STRIP, 0, 4);
+   gl->issuedDraws++;
+}
+
+static int glnvg__renderBackdrop (void * uptr, int image, int x, int y, int w, int h, int passes)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   GLNVGblurLevel * levels[NANOVG_GL_BLUR_LEVELS];
+   GLint fbo, viewport[4];
+   int i, ok = 0, lw[NANOVG_GL_BLUR_LEVELS], lh[NANOVG_GL_BLUR_LEVELS];
+   if (tex == NULL || tex->page != 0 || passes < 1 || passes >= NANOVG_GL_BLUR_LEVELS) return 0;
+   if (!glnvg__featureShader (gl, &gl->blurShader, &gl->blurState, "blur", gl->blurSources)) return 0;
+   lw[0] = w;
+   lh[0] = h;
+   for (i = 1; i <= passes; i++)
+   {
+      lw[i] = (lw[i - 1] + 1) / 2;
+      lh[i] = (lh[i - 1] + 1) / 2;
+   }
+   if (tex->width != lw[1] || tex->height != lh[1]) return 0;
+   glGetIntegerv (GL_FRAMEBUFFER_BINDING, &fbo);
+   glGetIntegerv (GL_VIEWPORT, viewport);
+   // The calls so far are what lies under the backdrop.
+   glnvg__resetCounters (gl);
+   gl->layerFlushed = 1;
+   glnvg__drawCalls (gl);
+   glnvg__beginScope (gl, "backdrop");
+   // Level 1 is the image itself, the others come from the pool.
+   if (gl->backdropFbo == 0)
+      glGenFramebuffers (1, &gl->backdropFbo);
+   glBindFramebuffer (GL_FRAMEBUFFER, gl->backdropFbo);
+   glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex->tex, 0);
+   if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      goto done;
+   levels[1] = NULL;
+   for (i = 0; i <= passes; i++)
+   {
+      if (i == 1) continue;
+      levels[i] = glnvg__blurLevel (gl, i, lw[i], lh[i]);
+      if (levels[i] == NULL)
+         goto done;
+   }
+   // A copy of the rect, which also resolves a multisampled target. GL counts rows from the bottom.
+   glnvg__enable (gl, GL_SCISSOR_TEST, 0);
+   glBindFramebuffer (GL_READ_FRAMEBUFFER, fbo);
+   glBindFramebuffer (GL_DRAW_FRAMEBUFFER, levels[0]->fbo);
+   glBlitFramebuffer (viewport[0] + x, viewport[1] + viewport[3] - y - h, viewport[0] + x + w, viewport[1] + viewport[3] - y,
+                      0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+   glnvg__useProgramHandle (gl, gl->blurShader.prog);
+   glUniform1i (gl->blurShader.loc[GLNVG_LOC_TEX], 0);
+   glnvg__bindVertexArray (gl, gl->windowVertArr != 0 ? gl->windowVertArr : gl->vertArr);
+   glnvg__enable (gl, GL_BLEND, 0);
+   glnvg__enable (gl, GL_STENCIL_TEST, 0);
+   glnvg__enable (gl, GL_CULL_FACE, 0);
+   // Down to the smallest level, level 1 reading the copy and writing the image...
+   for (i = 1; i <= passes; i++)
+   {
+      GLuint src = i == 2 ? tex->tex : levels[i - 1]->tex;
+      int tw = i == 2 ? tex->width : levels[i - 1]->width, th = i == 2 ? tex->height : levels[i - 1]->height;
+      glBindFramebuffer (GL_FRAMEBUFFER, i == 1 ? gl->backdropFbo : levels[i]->fbo);
+      glnvg__blurPass (gl, src, lw[i - 1], lh[i - 1], tw, th, lw[i], lh[i], 0);
+   }
+   // ...and back up, the last pass into the image.
+   for (i = passes - 1; i >= 1; i--)
+   {
+      GLNVGblurLevel * src = levels[i + 1];
+      glBindFramebuffer (GL_FRAMEBUFFER, i == 1 ? gl->backdropFbo : levels[i]->fbo);
+      glnvg__blurPass (gl, src->tex, lw[i + 1], lh[i + 1], src->width, src->height, lw[i], lh[i], 1);
+   }
+   glnvg__enable (gl, GL_BLEND, 1);
+   glnvg__bindVertexArray (gl, 0);
+   glnvg__useProgramHandle (gl, 0);
+   gl->program = NULL;
+   glnvg__bindTexture (gl, 0);
+   if (gl->state == &gl->ownState)
+      gl->ownState.known = 0;
+   ok = 1;
+done:
+   glBindFramebuffer (GL_FRAMEBUFFER, gl->backdropFbo);
+   glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+   glBindFramebuffer (GL_FRAMEBUFFER, fbo);
+   glViewport (viewport[0], viewport[1], viewport[2], viewport[3]);
+   glnvg__endScope (gl);
+   return ok;
+}
+#endif
+
+static void glnvg__renderStats (void * uptr, NVGframeStats * stats)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   stats->glDrawCalls = gl->issuedDraws;
+   stats->vertexBytes = gl->vertexBytes;
+   stats->uniformBytes = gl->uniformBytes;
+   stats->textureBinds = gl->textureBinds;
+   stats->stencilPasses = gl->stencilPasses;
+   stats->textureKBytes = (int) (gl->textureBytes >> 10);
+   stats->memory.renderCalls = gl->memory.renderCalls;
+   stats->memory.renderPaths = gl->memory.renderPaths;
+   stats->memory.renderVerts = gl->memory.renderVerts;
+   stats->memory.renderUniforms = gl->memory.renderUniforms;
+}
+
+static int glnvg__growPaintCache (GLNVGcontext * gl);
+
+static int glnvg__renderEdgeAntiAlias (void * uptr, int enabled)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   // The shaders keep EDGE_AA, it has no effect on vertices without fringes.
+   gl->edgeAA = enabled && (gl->flags & NVG_ANTIALIAS) != 0;
+   return gl->edgeAA;
+}
+
+static void glnvg__renderReserve (void * uptr, const NVGframeMemory * mem)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   if (mem->renderCalls > gl->ccalls)
+   {
+      GLNVGcall * calls = (GLNVGcall *)realloc (gl->calls, sizeof (GLNVGcall) * mem->renderCalls);
+      if (calls == NULL) return;
+      gl->calls = calls;
+      gl->ccalls = mem->renderCalls;
+   }
+   if (mem->renderPaths > gl->cpaths)
+   {
+      GLNVGpath * paths = (GLNVGpath *)realloc (gl->paths, sizeof (GLNVGpath) * mem->renderPaths);
+      if (paths == NULL) return;
+      gl->paths = paths;
+      gl->cpaths = mem->renderPaths;
+   }
+   // Only the heap copies, mapped ring slots are grown by the frames that overrun them.
+   if (mem->renderVerts > gl->cvertHeap)
+   {
+      NVGvertex * verts = (NVGvertex *)realloc (gl->vertHeap, sizeof (NVGvertex) * mem->renderVerts);
+      if (verts == NULL) return;
+      gl->vertHeap = verts;
+      gl->cvertHeap = mem->renderVerts;
+      if (!gl->vertsMapped)
+      {
+         gl->verts = verts;
+         gl->cverts = gl->cvertHeap;
+      }
+   }
+   if (mem->renderUniforms > gl->cuniformHeap)
+   {
+      unsigned char * uniforms = (unsigned char *)realloc (gl->uniformHeap, gl->fragSize * mem->renderUniforms);
+      if (uniforms == NULL) return;
+      gl->uniformHeap = uniforms;
+      gl->cuniformHeap = mem->renderUniforms;
+      if (!gl->uniformsMapped)
+      {
+         gl->uniforms = uniforms;
+         gl->cuniforms = gl->cuniformHeap;
+      }
+   }
+   while ((mem->renderUniforms + 1) * 2 > gl->cpaintCache)
+      if (!glnvg__growPaintCache (gl)) return;
+#if defined NANOVG_GL3
+   if (gl->merge)
+   {
+      if (mem->renderVerts > gl->cpaintIdx)
+      {
+         int * paintIdx = (int *)realloc (gl->paintIdx, sizeof (int) * mem->renderVerts);
+         if (paintIdx == NULL) return;
+         gl->paintIdx = paintIdx;
+         gl->cpaintIdx = mem->renderVerts;
+      }
+      if (mem->renderUniforms * NANOVG_GL_PAINT_FLOATS > gl->cpaints)
+      {
+         float * paints = (float *)realloc (gl->paints, sizeof (float) * mem->renderUniforms * NANOVG_GL_PAINT_FLOATS);
+         if (paints == NULL) return;
+         gl->paints = paints;
+         gl->cpaints = mem->renderUniforms * NANOVG_GL_PAINT_FLOATS;
+      }
+   }
+#endif
+}
+
+// Reallocates a per frame buffer of more than ratio times count items down to one and a half times that.
+static void * glnvg__shrinkBuffer (void * items, int * cap, int count, int size, int minCap, float ratio)
+{
+   void * p;
+   int c = glnvg__maxi (count + count / 2, minCap);
+   if (*cap <= c || (float)*cap <= count * ratio) return items;
+   p = realloc (items, (size_t)c * size);
+   if (p == NULL) return items;
+   *cap = c;
+   return p;
+}
+
+#if defined NANOVG_GL3
+static void glnvg__shrinkRingBuffer (GLNVGcontext * gl, GLenum target, GLuint * buf, void ** map, int * capacity,
+                                     int need, int minSize, float ratio)
+{
+   int size = glnvg__maxi (need + need / 2, minSize);
+   if (*capacity <= size || (float)*capacity <= need * ratio) return;
+   // The GPU may still read the old buffer, GL keeps it alive until it is done.
+   glnvg__deleteRingBuffer (target, buf, map);
+   *capacity = 0;
+   if (glnvg__createRingBuffer (gl, target, buf, map, size))
+      *capacity = size;
+}
+#endif
+
+static void glnvg__renderShrink (void * uptr, const NVGframeMemory * mem, float ratio)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   gl->calls = (GLNVGcall *)glnvg__shrinkBuffer (gl->calls, &gl->ccalls, mem->renderCalls, sizeof (GLNVGcall), 128, ratio);
+   gl->paths = (GLNVGpath *)glnvg__shrinkBuffer (gl->paths, &gl->cpaths, mem->renderPaths, sizeof (GLNVGpath), 128, ratio);
+   gl->vertHeap = (NVGvertex *)glnvg__shrinkBuffer (gl->vertHeap, &gl->cvertHeap, mem->renderVerts, sizeof (NVGvertex), 4096, ratio);
+   gl->uniformHeap = (unsigned char *)glnvg__shrinkBuffer (gl->uniformHeap, &gl->cuniformHeap, mem->renderUniforms,
+                                                           gl->fragSize, 128, ratio);
+   gl->packedVerts = (GLNVGpackedVertex *)glnvg__shrinkBuffer (gl->packedVerts, &gl->cpackedVerts, mem->renderVerts,
+                                                               sizeof (GLNVGpackedVertex), 4096, ratio);
+   // Between frames verts and uniforms are back on the heap.
+   if (!gl->vertsMapped)
+   {
+      gl->verts = gl->vertHeap;
+      gl->cverts = gl->cvertHeap;
+   }
+   if (!gl->uniformsMapped)
+   {
+      gl->uniforms = gl->uniformHeap;
+      gl->cuniforms = gl->cuniformHeap;
+   }
+#if defined NANOVG_GL3
+   gl->paintIdx = (int *)glnvg__shrinkBuffer (gl->paintIdx, &gl->cpaintIdx, mem->renderVerts, sizeof (int), 4096, ratio);
+   gl->paints = (float *)glnvg__shrinkBuffer (gl->paints, &gl->cpaints, mem->renderUniforms * NANOVG_GL_PAINT_FLOATS,
+                                              sizeof (float), 128 * NANOVG_GL_PAINT_FLOATS, ratio);
+   gl->sortedCalls = (GLNVGcall *)glnvg__shrinkBuffer (gl->sortedCalls, &gl->csortedCalls, mem->renderCalls,
+                                                       sizeof (GLNVGcall), 128, ratio);
+   gl->instances = (GLNVGinstance *)glnvg__shrinkBuffer (gl->instances, &gl->cinstances, mem->renderCalls,
+                                                        sizeof (GLNVGinstance), 256, ratio);
+   if (gl->ringEnabled && !gl->ringBegun)
+   {
+      int i;
+      for (i = 0; i < NANOVG_GL_RING_SIZE; i++)
+      {
+         GLNVGringSlot * slot = &gl->ring[i];
+         glnvg__shrinkRingBuffer (gl, GL_ARRAY_BUFFER, &slot->vertBuf, &slot->vertMap, &slot->vertCapacity,
+                                  mem->renderVerts * (int)sizeof (NVGvertex),
+                                  NANOVG_GL_RING_INIT_VERTS * (int)sizeof (NVGvertex), ratio);
+         glnvg__shrinkRingBuffer (gl, GL_UNIFORM_BUFFER, &slot->fragBuf, &slot->fragMap, &slot->fragCapacity,
+                                  mem->renderUniforms * gl->fragSize, NANOVG_GL_RING_INIT_UNIFORMS * gl->fragSize, ratio);
+      }
+   }
+#endif
+}
+
+static int glnvg__kbytes (size_t bytes)
+{
+   return (int) ((bytes + 1023) >> 10);
+}
+
+static void glnvg__renderMemory (void * uptr, NVGmemoryReport * report)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   size_t cpu, gpu = 0;
+   cpu = (size_t)gl->ccalls * sizeof (GLNVGcall) + (size_t)gl->cpaths * sizeof (GLNVGpath) +
+         (size_t)gl->cvertHeap * sizeof (NVGvertex) + (size_t)gl->cuniformHeap * gl->fragSize +
+         (size_t)gl->cpackedVerts * sizeof (GLNVGpackedVertex) + (size_t)gl->cpaintCache * sizeof (GLNVGpaintEntry) +
+         (size_t)gl->cmulti * (sizeof (GLint) + sizeof (GLsizei)) + (size_t)gl->cvariantKeys +
+         (size_t)gl->ctextures * sizeof (GLNVGtexture);
+#if defined NANOVG_GL3
+   cpu += (size_t)gl->cpaintIdx * sizeof (int) + (size_t)gl->cpaints * sizeof (float) +
+          (size_t)gl->cindices * sizeof (GLuint) + (size_t)gl->cquads * sizeof (GLNVGquad) +
+          (size_t)gl->csortedCalls * sizeof (GLNVGcall) + (size_t)gl->csortedQuads * sizeof (GLNVGquad) +
+          (size_t)gl->ccallOrder * (sizeof (int) + 4 * sizeof (float)) + (size_t)gl->ccommands * sizeof (GLNVGdrawCommand) +
+          (size_t)gl->cpathCommands + (size_t)gl->cpathCoords * sizeof (float) + (size_t)gl->cuploadData +
+          (size_t)gl->cuploads * sizeof (GLNVGupload) + (size_t)gl->cplotDraws * sizeof (GLNVGplotDraw) +
+          (size_t)gl->cshapes * sizeof (GLNVGshapeEntry) + (size_t)gl->cinstances * sizeof (GLNVGinstance);
+   if (gl->ringEnabled)
+   {
+      int i;
+      for (i = 0; i < NANOVG_GL_RING_SIZE; i++)
+         gpu += (size_t)gl->ring[i].vertCapacity + (size_t)gl->ring[i].fragCapacity;
+   }
+   else if (gl->dsaEnabled)
+      gpu += (size_t)gl->vertBufSize + (size_t)gl->fragBufSize;
+   else
+#endif
+   // Buffers respecified every frame hold what the last flush uploaded.
+   gpu += (size_t)gl->vertexBytes + (size_t)gl->uniformBytes;
+#if defined NANOVG_GL3
+   {
+      int i;
+      gpu += (size_t)gl->indirectBufSize;
+      for (i = 0; i < NANOVG_GL_RING_SIZE; i++)
+         gpu += (size_t)gl->uploadCapacity[i];
+   }
+#endif
+   report->renderBuffers = glnvg__kbytes (cpu);
+   report->gpuBuffers = glnvg__kbytes (gpu);
+   report->textures = glnvg__kbytes (gl->textureBytes);
+}
+
+static int glnvg__renderTextureKBytes (void * uptr, int image)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   return tex != NULL ? glnvg__kbytes (tex->bytes) : 0;
 }
 
 static int glnvg__maxVertCount (const NVGpath * paths, int npaths)
@@ -1165,60 +4837,313 @@ static int glnvg__allocPaths (GLNVGcontext * gl, int n)
 
 static int glnvg__allocVerts (GLNVGcontext * gl, int n)
 {
-   int ret = 0;
-   if (gl->nverts + n > gl->cverts)
+   int ret = 0;
+#if defined NANOVG_GL3
+   glnvg__beginRingFrame (gl);
+#endif
+   if (gl->nverts + n > gl->cverts)
+   {
+      NVGvertex * verts;
+      int cverts = glnvg__maxi (gl->nverts + n, 4096) + gl->cverts / 2; // 1.5x Overallocate
+      verts = (NVGvertex *)realloc (gl->vertHeap, sizeof (NVGvertex) * cverts);
+      if (verts == NULL) return -1;
+      // Ran out of mapped memory, continue the frame on the heap.
+      if (gl->vertsMapped)
+         memcpy (verts, gl->verts, sizeof (NVGvertex) * gl->nverts);
+      gl->vertsMapped = 0;
+      gl->vertHeap = verts;
+      gl->cvertHeap = cverts;
+      gl->verts = verts;
+      gl->cverts = cverts;
+   }
+   ret = gl->nverts;
+   gl->nverts += n;
+   return ret;
+}
+
+static int glnvg__allocFragUniforms (GLNVGcontext * gl, int n)
+{
+   int ret = 0, structSize = gl->fragSize;
+#if defined NANOVG_GL3
+   glnvg__beginRingFrame (gl);
+#endif
+   if (gl->nuniforms + n > gl->cuniforms)
+   {
+      unsigned char * uniforms;
+      int cuniforms = glnvg__maxi (gl->nuniforms + n, 128) + gl->cuniforms / 2; // 1.5x Overallocate
+      uniforms = (unsigned char *)realloc (gl->uniformHeap, structSize * cuniforms);
+      if (uniforms == NULL) return -1;
+      if (gl->uniformsMapped)
+         memcpy (uniforms, gl->uniforms, structSize * gl->nuniforms);
+      gl->uniformsMapped = 0;
+      gl->uniformHeap = uniforms;
+      gl->cuniformHeap = cuniforms;
+      gl->uniforms = uniforms;
+      gl->cuniforms = cuniforms;
+   }
+   ret = gl->nuniforms * structSize;
+   gl->nuniforms += n;
+   return ret;
+}
+
+static GLNVGfragUniforms * nvg__fragUniformPtr (GLNVGcontext * gl, int i)
+{
+   return (GLNVGfragUniforms *)&gl->uniforms[i];
+}
+
+static unsigned int glnvg__hashPaintKey (const GLNVGpaintKey * key)
+{
+   // FNV-1a
+   const unsigned char * p = (const unsigned char *)key;
+   unsigned int h = 2166136261u;
+   size_t i;
+   for (i = 0; i < sizeof (*key); i++)
+      h = (h ^ p[i]) * 16777619u;
+   return h;
+}
+
+static GLNVGpaintEntry * glnvg__findPaintEntry (GLNVGcontext * gl, const GLNVGpaintKey * key, unsigned int hash)
+{
+   int mask = gl->cpaintCache - 1, i = (int) (hash & mask);
+   for (;;)
+   {
+      GLNVGpaintEntry * entry = &gl->paintCache[i];
+      if (entry->frame != gl->paintFrame)
+         return entry;
+      if (entry->hash == hash && memcmp (&entry->key, key, sizeof (*key)) == 0)
+         return entry;
+      i = (i + 1) & mask;
+   }
+}
+
+static int glnvg__growPaintCache (GLNVGcontext * gl)
+{
+   GLNVGpaintEntry * old = gl->paintCache;
+   int i, cold = gl->cpaintCache, cpaintCache = glnvg__maxi (cold * 2, 256);
+   GLNVGpaintEntry * cache = (GLNVGpaintEntry *)malloc (sizeof (GLNVGpaintEntry) * cpaintCache);
+   if (cache == NULL) return 0;
+   memset (cache, 0, sizeof (GLNVGpaintEntry) * cpaintCache);
+   gl->paintCache = cache;
+   gl->cpaintCache = cpaintCache;
+   for (i = 0; i < cold; i++)
+      if (old[i].frame == gl->paintFrame)
+         *glnvg__findPaintEntry (gl, &old[i].key, old[i].hash) = old[i];
+   free (old);
+   return 1;
+}
+
+// Returns the offset of n uniform slots for the paint, sharing the slots of an identical paint
+// converted earlier in the frame. *fresh is set when the caller has to fill them in.
+static int glnvg__allocPaintUniforms (GLNVGcontext * gl, int type, const NVGpaint * paint, const NVGscissor * scissor,
+                                      float width, float fringe, const float * shape, int n, int * fresh)
+{
+   GLNVGpaintKey key;
+   GLNVGpaintEntry * entry;
+   unsigned int hash;
+   int offset;
+   *fresh = 1;
+   // Zero the padding too, keys are hashed and compared bytewise.
+   memset (&key, 0, sizeof (key));
+   key.paint = *paint;
+   key.scissor = *scissor;
+   key.width = width;
+   key.fringe = fringe;
+   if (shape != NULL)
+      memcpy (key.shape, shape, sizeof (key.shape));
+   key.type = type;
+   if ((gl->npaintCache + 1) * 2 > gl->cpaintCache && !glnvg__growPaintCache (gl))
+      return glnvg__allocFragUniforms (gl, n);
+   hash = glnvg__hashPaintKey (&key);
+   entry = glnvg__findPaintEntry (gl, &key, hash);
+   if (entry->frame == gl->paintFrame)
+   {
+      *fresh = 0;
+      return entry->uniformOffset;
+   }
+   offset = glnvg__allocFragUniforms (gl, n);
+   if (offset == -1) return -1;
+   entry->key = key;
+   entry->hash = hash;
+   entry->frame = gl->paintFrame;
+   entry->uniformOffset = offset;
+   gl->npaintCache++;
+   return offset;
+}
+
+static void glnvg__vset (NVGvertex * vtx, float x, float y, float u, float v)
+{
+   vtx->x = x;
+   vtx->y = y;
+   vtx->u = u;
+   vtx->v = v;
+}
+
+// Leaves the scissor of a call to glScissor() when it is an axis aligned rectangle with its edges on
+// framebuffer pixels, see NVG_HARDWARE_SCISSOR. The shader would then cover whole pixels on either
+// side of the edges anyway. Returns the scissor to convert the paint with, none in that case.
+static NVGscissor * glnvg__clipCall (GLNVGcontext * gl, GLNVGcall * call, NVGscissor * scissor, NVGscissor * none)
+{
+   float ex, ey, edges[4];
+   int i;
+   if (!(gl->flags & NVG_HARDWARE_SCISSOR) || scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f)
+      return scissor;
+   if (scissor->xform[1] != 0.0f || scissor->xform[2] != 0.0f)
+      return scissor;
+   ex = fabsf (scissor->xform[0]) * scissor->extent[0];
+   ey = fabsf (scissor->xform[3]) * scissor->extent[1];
+   edges[0] = (scissor->xform[4] - ex) * gl->pixelRatio;
+   edges[1] = (scissor->xform[5] - ey) * gl->pixelRatio;
+   edges[2] = (scissor->xform[4] + ex) * gl->pixelRatio;
+   edges[3] = (scissor->xform[5] + ey) * gl->pixelRatio;
+   for (i = 0; i < 4; i++)
+   {
+      float rounded = floorf (edges[i] + 0.5f);
+      if (fabsf (edges[i] - rounded) > 1e-3f)
+         return scissor;
+      edges[i] = rounded;
+   }
+   call->clipped = 1;
+   call->clip[0] = (int)edges[0];
+   call->clip[1] = (int)edges[1];
+   call->clip[2] = (int)edges[2] - (int)edges[0];
+   call->clip[3] = (int)edges[3] - (int)edges[1];
+   // Disabled like nvgResetScissor() does, so the paint is shared with unscissored calls.
+   memset (none, 0, sizeof (*none));
+   none->extent[0] = -1.0f;
+   none->extent[1] = -1.0f;
+   return none;
+}
+
+#if defined NANOVG_GL3
+// FNV-1a over the path layout of a call and its vertices relative to the first one, which stay the
+// same when the geometry is only moved.
+static unsigned int glnvg__hashShape (GLNVGcontext * gl, const GLNVGcall * call, int base, int nverts)
+{
+   const GLNVGpath * paths = &gl->paths[call->pathOffset];
+   const NVGvertex * v = &gl->verts[base];
+   unsigned int h = 2166136261u, bits;
+   float rel[4];
+   int i, k;
+   h = (h ^ (unsigned int)call->type) * 16777619u;
+   h = (h ^ (unsigned int)call->fillTriangles) * 16777619u;
+   for (i = 0; i < call->pathCount; i++)
    {
-      NVGvertex * verts;
-      int cverts = glnvg__maxi (gl->nverts + n, 4096) + gl->cverts / 2; // 1.5x Overallocate
-      verts = (NVGvertex *)realloc (gl->verts, sizeof (NVGvertex) * cverts);
-      if (verts == NULL) return -1;
-      gl->verts = verts;
-      gl->cverts = cverts;
+      h = (h ^ (unsigned int)paths[i].fillCount) * 16777619u;
+      h = (h ^ (unsigned int)paths[i].strokeCount) * 16777619u;
    }
-   ret = gl->nverts;
-   gl->nverts += n;
-   return ret;
+   for (i = 0; i < nverts; i++)
+   {
+      rel[0] = v[i].x - v[0].x;
+      rel[1] = v[i].y - v[0].y;
+      rel[2] = v[i].u;
+      rel[3] = v[i].v;
+      for (k = 0; k < 4; k++)
+      {
+         memcpy (&bits, &rel[k], sizeof (bits));
+         h = (h ^ bits) * 16777619u;
+      }
+   }
+   return h;
 }
 
-static int glnvg__allocFragUniforms (GLNVGcontext * gl, int n)
+// Returns the first vertex of an earlier call whose geometry is that of call moved, base being the
+// first of the nverts vertices of call, or -1 if it differs.
+static int glnvg__sharedShape (GLNVGcontext * gl, const GLNVGcall * shape, const GLNVGcall * call, int base, int nverts)
 {
-   int ret = 0, structSize = gl->fragSize;
-   if (gl->nuniforms + n > gl->cuniforms)
+   const GLNVGpath * a = &gl->paths[shape->pathOffset], * b = &gl->paths[call->pathOffset];
+   const NVGvertex * u, * v = &gl->verts[base];
+   int i, first = -1;
+   if (shape->type != call->type || shape->fillTriangles != call->fillTriangles || shape->stencilStroke ||
+         shape->pathCount != call->pathCount || shape->pathOffset + shape->pathCount > call->pathOffset)
+      return -1;
+   for (i = 0; i < call->pathCount; i++)
    {
-      unsigned char * uniforms;
-      int cuniforms = glnvg__maxi (gl->nuniforms + n, 128) + gl->cuniforms / 2; // 1.5x Overallocate
-      uniforms = (unsigned char *)realloc (gl->uniforms, structSize * cuniforms);
-      if (uniforms == NULL) return -1;
-      gl->uniforms = uniforms;
-      gl->cuniforms = cuniforms;
+      if (a[i].fillCount != b[i].fillCount || a[i].strokeCount != b[i].strokeCount)
+         return -1;
+      if (first < 0)
+         first = a[i].fillCount > 0 ? a[i].fillOffset : a[i].strokeCount > 0 ? a[i].strokeOffset : -1;
    }
-   ret = gl->nuniforms * structSize;
-   gl->nuniforms += n;
-   return ret;
+   if (first < 0 || first + nverts > base)
+      return -1;
+   u = &gl->verts[first];
+   for (i = 0; i < nverts; i++)
+      if (u[i].x - u[0].x != v[i].x - v[0].x || u[i].y - u[0].y != v[i].y - v[0].y || u[i].u != v[i].u || u[i].v != v[i].v)
+         return -1;
+   return first;
 }
 
-static GLNVGfragUniforms * nvg__fragUniformPtr (GLNVGcontext * gl, int i)
+static int glnvg__growShapes (GLNVGcontext * gl)
 {
-   return (GLNVGfragUniforms *)&gl->uniforms[i];
+   GLNVGshapeEntry * old = gl->shapes;
+   int i, k, cold = gl->cshapes, cshapes = glnvg__maxi (cold * 2, 256);
+   GLNVGshapeEntry * shapes = (GLNVGshapeEntry *)malloc (sizeof (GLNVGshapeEntry) * cshapes);
+   if (shapes == NULL) return 0;
+   memset (shapes, 0, sizeof (GLNVGshapeEntry) * cshapes);
+   for (i = 0; i < cold; i++)
+   {
+      if (old[i].frame != gl->paintFrame) continue;
+      k = (int) (old[i].hash & (cshapes - 1));
+      while (shapes[k].frame == gl->paintFrame)
+         k = (k + 1) & (cshapes - 1);
+      shapes[k] = old[i];
+   }
+   free (old);
+   gl->shapes = shapes;
+   gl->cshapes = cshapes;
+   return 1;
 }
 
-static void glnvg__vset (NVGvertex * vtx, float x, float y, float u, float v)
+// Lets a convex fill or single pass stroke draw the geometry of an earlier call of the flush that
+// only differs in position, see NVG_INSTANCE_SHAPES. The call then gives back its paths and the
+// vertices from base on, which it allocated last, and keeps the offset to the shared ones.
+static void glnvg__instanceShape (GLNVGcontext * gl, GLNVGcall * call, int base, int nverts)
 {
-   vtx->x = x;
-   vtx->y = y;
-   vtx->u = u;
-   vtx->v = v;
+   GLNVGshapeEntry * entry;
+   unsigned int hash;
+   int i, mask, index = (int) (call - gl->calls);
+   if (nverts <= 0) return;
+   if ((gl->nshapes + 1) * 2 > gl->cshapes && !glnvg__growShapes (gl)) return;
+   hash = glnvg__hashShape (gl, call, base, nverts);
+   mask = gl->cshapes - 1;
+   for (i = (int) (hash & mask);; i = (i + 1) & mask)
+   {
+      GLNVGcall * shape;
+      int first;
+      entry = &gl->shapes[i];
+      if (entry->frame != gl->paintFrame) break;
+      // Entries of calls rolled back since may name other calls, the comparison catches those.
+      if (entry->hash != hash || entry->call >= index) continue;
+      shape = &gl->calls[entry->call];
+      first = glnvg__sharedShape (gl, shape, call, base, nverts);
+      if (first < 0) continue;
+      call->offset[0] = gl->verts[base].x - gl->verts[first].x;
+      call->offset[1] = gl->verts[base].y - gl->verts[first].y;
+      gl->npaths -= call->pathCount;
+      gl->nverts = base;
+      call->pathOffset = shape->pathOffset;
+      call->triangleCount = 0;
+      call->instanced = 1;
+      shape->instanced = 1;
+      return;
+   }
+   entry->hash = hash;
+   entry->frame = gl->paintFrame;
+   entry->call = index;
+   gl->nshapes++;
 }
+#endif
 
 static void glnvg__renderFill (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
                                const float * bounds, const NVGpath * paths, int npaths)
 {
    GLNVGcontext * gl = (GLNVGcontext *)uptr;
    GLNVGcall * call = glnvg__allocCall (gl);
+   NVGscissor none;
    NVGvertex * quad;
    GLNVGfragUniforms * frag;
-   int i, maxverts, offset;
+   int i, maxverts, offset, base, fresh;
    if (call == NULL) return;
+   scissor = glnvg__clipCall (gl, call, scissor, &none);
    call->type = GLNVG_FILL;
    call->pathOffset = glnvg__allocPaths (gl, npaths);
    if (call->pathOffset == -1) goto error;
@@ -1226,10 +5151,16 @@ static void glnvg__renderFill (void * uptr, NVGpaint * paint, NVGscissor * sciss
    call->image = paint->image;
    if (npaths == 1 && paths[0].convex)
       call->type = GLNVG_CONVEXFILL;
+   if (paths[0].triangles)
+   {
+      call->type = GLNVG_CONVEXFILL;
+      call->fillTriangles = 1;
+   }
    // Allocate vertices for all the paths.
    maxverts = glnvg__maxVertCount (paths, npaths) + 6;
    offset = glnvg__allocVerts (gl, maxverts);
    if (offset == -1) goto error;
+   base = offset;
    for (i = 0; i < npaths; i++)
    {
       GLNVGpath * copy = &gl->paths[call->pathOffset + i];
@@ -1250,6 +5181,10 @@ static void glnvg__renderFill (void * uptr, NVGpaint * paint, NVGscissor * sciss
          offset += path->nstroke;
       }
    }
+#if NANOVG_GL_HAS_PATH_RENDERING
+   if (call->type == GLNVG_FILL && gl->pathRendering)
+      glnvg__allocPathCommands (gl, call, paths, npaths);
+#endif
    // Quad
    call->triangleOffset = offset;
    call->triangleCount = 6;
@@ -1263,23 +5198,33 @@ static void glnvg__renderFill (void * uptr, NVGpaint * paint, NVGscissor * sciss
    // Setup uniforms for draw calls
    if (call->type == GLNVG_FILL)
    {
-      call->uniformOffset = glnvg__allocFragUniforms (gl, 2);
+      call->uniformOffset = glnvg__allocPaintUniforms (gl, call->type, paint, scissor, fringe, fringe, NULL, 2, &fresh);
       if (call->uniformOffset == -1) goto error;
-      // Simple shader for stencil
-      frag = nvg__fragUniformPtr (gl, call->uniformOffset);
-      memset (frag, 0, sizeof (*frag));
-      frag->strokeThr = -1.0f;
-      frag->type = NSVG_SHADER_SIMPLE;
-      // Fill shader
-      glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset + gl->fragSize), paint, scissor, fringe, fringe, -1.0f);
+      if (fresh)
+      {
+         // Simple shader for stencil
+         frag = nvg__fragUniformPtr (gl, call->uniformOffset);
+         memset (frag, 0, sizeof (*frag));
+         frag->strokeThr = -1.0f;
+         frag->type = NSVG_SHADER_SIMPLE;
+         // Fill shader
+         glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset + gl->fragSize), paint, scissor, fringe, fringe, -1.0f);
+      }
    }
    else
    {
-      call->uniformOffset = glnvg__allocFragUniforms (gl, 1);
+      call->uniformOffset = glnvg__allocPaintUniforms (gl, call->type, paint, scissor, fringe, fringe, NULL, 1, &fresh);
       if (call->uniformOffset == -1) goto error;
       // Fill shader
-      glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset), paint, scissor, fringe, fringe, -1.0f);
+      if (fresh)
+         glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset), paint, scissor, fringe, fringe, -1.0f);
    }
+#if defined NANOVG_GL3
+   if (gl->instancesEnabled && call->type == GLNVG_CONVEXFILL)
+      glnvg__instanceShape (gl, call, base, call->triangleOffset - base);
+#else
+   NVG_NOTUSED (base);
+#endif
    return;
 error:
    // We get here if call alloc was ok, but something else is not.
@@ -1287,14 +5232,35 @@ error:
    if (gl->ncalls > 0) gl->ncalls--;
 }
 
+// Whether a stroke looks the same without the stencil passes. Those keep overlapping triangles from
+// blending twice, which an opaque paint hides. Segments and convex closed paths with miter joins
+// only overlap at their antialiased edges, or on the inside when wider than the curve they follow;
+// everything else, e.g. bevels, round joins and crossings, keeps the stencil.
+static int glnvg__strokeNeedsStencil (const NVGpaint * paint, const NVGpath * paths, int npaths)
+{
+   int i;
+   if (paint->image != 0 || paint->innerColor.a < 1.0f || paint->outerColor.a < 1.0f)
+      return 1;
+   for (i = 0; i < npaths; i++)
+   {
+      const NVGpath * path = &paths[i];
+      if (path->nbevel != 0 || !(path->count <= 2 || (path->closed && path->convex)))
+         return 1;
+   }
+   return 0;
+}
+
 static void glnvg__renderStroke (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
                                  float strokeWidth, const NVGpath * paths, int npaths)
 {
    GLNVGcontext * gl = (GLNVGcontext *)uptr;
    GLNVGcall * call = glnvg__allocCall (gl);
-   int i, maxverts, offset;
+   NVGscissor none;
+   int i, maxverts, offset, base, fresh;
    if (call == NULL) return;
+   scissor = glnvg__clipCall (gl, call, scissor, &none);
    call->type = GLNVG_STROKE;
+   call->stencilStroke = (gl->flags & NVG_STENCIL_STROKES) && glnvg__strokeNeedsStencil (paint, paths, npaths);
    call->pathOffset = glnvg__allocPaths (gl, npaths);
    if (call->pathOffset == -1) goto error;
    call->pathCount = npaths;
@@ -1303,6 +5269,7 @@ static void glnvg__renderStroke (void * uptr, NVGpaint * paint, NVGscissor * sci
    maxverts = glnvg__maxVertCount (paths, npaths);
    offset = glnvg__allocVerts (gl, maxverts);
    if (offset == -1) goto error;
+   base = offset;
    for (i = 0; i < npaths; i++)
    {
       GLNVGpath * copy = &gl->paths[call->pathOffset + i];
@@ -1316,21 +5283,31 @@ static void glnvg__renderStroke (void * uptr, NVGpaint * paint, NVGscissor * sci
          offset += path->nstroke;
       }
    }
-   if (gl->flags & NVG_STENCIL_STROKES)
+   if (call->stencilStroke)
    {
       // Fill shader
-      call->uniformOffset = glnvg__allocFragUniforms (gl, 2);
+      call->uniformOffset = glnvg__allocPaintUniforms (gl, call->type, paint, scissor, strokeWidth, fringe, NULL, 2, &fresh);
       if (call->uniformOffset == -1) goto error;
-      glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset), paint, scissor, strokeWidth, fringe, -1.0f);
-      glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset + gl->fragSize), paint, scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f);
+      if (fresh)
+      {
+         glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset), paint, scissor, strokeWidth, fringe, -1.0f);
+         glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset + gl->fragSize), paint, scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f);
+      }
    }
    else
    {
       // Fill shader
-      call->uniformOffset = glnvg__allocFragUniforms (gl, 1);
+      call->uniformOffset = glnvg__allocPaintUniforms (gl, call->type, paint, scissor, strokeWidth, fringe, NULL, 1, &fresh);
       if (call->uniformOffset == -1) goto error;
-      glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset), paint, scissor, strokeWidth, fringe, -1.0f);
+      if (fresh)
+         glnvg__convertPaint (gl, nvg__fragUniformPtr (gl, call->uniformOffset), paint, scissor, strokeWidth, fringe, -1.0f);
    }
+#if defined NANOVG_GL3
+   if (gl->instancesEnabled && !call->stencilStroke)
+      glnvg__instanceShape (gl, call, base, offset - base);
+#else
+   NVG_NOTUSED (base);
+#endif
    return;
 error:
    // We get here if call alloc was ok, but something else is not.
@@ -1338,26 +5315,158 @@ error:
    if (gl->ncalls > 0) gl->ncalls--;
 }
 
+#if defined NANOVG_GL3
+// Whether six vertices are the two triangles nvgText() emits for a glyph: corners 0,2,1 and 0,3,2
+// of a parallelogram whose texture coordinates follow its edges.
+static int glnvg__isGlyphQuad (const NVGvertex * v)
+{
+   const float eps = 1e-3f;
+   return v[3].x == v[0].x && v[3].y == v[0].y && v[3].u == v[0].u && v[3].v == v[0].v &&
+          v[5].x == v[1].x && v[5].y == v[1].y && v[5].u == v[1].u && v[5].v == v[1].v &&
+          v[2].u == v[1].u && v[2].v == v[0].v && v[4].u == v[0].u && v[4].v == v[1].v &&
+          fabsf (v[2].x + v[4].x - v[0].x - v[1].x) <= eps && fabsf (v[2].y + v[4].y - v[0].y - v[1].y) <= eps;
+}
+
+static int glnvg__allocQuads (GLNVGcontext * gl, const NVGvertex * verts, int nverts)
+{
+   int i, n = nverts / 6, ret = gl->nquads;
+   if (nverts % 6 != 0) return -1;
+   for (i = 0; i < n; i++)
+      if (!glnvg__isGlyphQuad (&verts[i * 6])) return -1;
+   if (gl->nquads + n > gl->cquads)
+   {
+      int cquads = glnvg__maxi (gl->nquads + n, 1024) + gl->cquads / 2; // 1.5x Overallocate
+      GLNVGquad * quads = (GLNVGquad *)realloc (gl->quads, sizeof (GLNVGquad) * cquads);
+      if (quads == NULL) return -1;
+      gl->quads = quads;
+      gl->cquads = cquads;
+   }
+   for (i = 0; i < n; i++)
+   {
+      const NVGvertex * v = &verts[i * 6];
+      GLNVGquad * q = &gl->quads[ret + i];
+      q->pos[0] = v[0].x;
+      q->pos[1] = v[0].y;
+      q->pos[2] = v[2].x - v[0].x;
+      q->pos[3] = v[2].y - v[0].y;
+      q->edge[0] = v[4].x - v[0].x;
+      q->edge[1] = v[4].y - v[0].y;
+      q->uv[0] = v[0].u;
+      q->uv[1] = v[0].v;
+      q->uv[2] = v[1].u;
+      q->uv[3] = v[1].v;
+      q->paint = 0;
+   }
+   gl->nquads += n;
+   return ret;
+}
+#endif
+
 static void glnvg__renderTriangles (void * uptr, NVGpaint * paint, NVGscissor * scissor,
                                     const NVGvertex * verts, int nverts)
 {
    GLNVGcontext * gl = (GLNVGcontext *)uptr;
    GLNVGcall * call = glnvg__allocCall (gl);
+   NVGscissor none;
    GLNVGfragUniforms * frag;
+   int fresh;
    if (call == NULL) return;
+   scissor = glnvg__clipCall (gl, call, scissor, &none);
    call->type = GLNVG_TRIANGLES;
    call->image = paint->image;
-   // Allocate vertices for all the paths.
+#if defined NANOVG_GL3
+   // Glyph quads become instances, anything else stays a triangle list.
+   if (gl->quadsEnabled && (call->quadOffset = glnvg__allocQuads (gl, verts, nverts)) != -1)
+   {
+      call->type = GLNVG_QUADS;
+      call->quadCount = nverts / 6;
+   }
+   else
+#endif
+   {
+      // Allocate vertices for all the paths.
+      call->quadOffset = 0;
+      call->triangleOffset = glnvg__allocVerts (gl, nverts);
+      if (call->triangleOffset == -1) goto error;
+      call->triangleCount = nverts;
+      memcpy (&gl->verts[call->triangleOffset], verts, sizeof (NVGvertex) * nverts);
+   }
+   // Fill shader
+   call->uniformOffset = glnvg__allocPaintUniforms (gl, GLNVG_TRIANGLES, paint, scissor, 1.0f, 1.0f, NULL, 1, &fresh);
+   if (call->uniformOffset == -1) goto error;
+   if (fresh)
+   {
+      frag = nvg__fragUniformPtr (gl, call->uniformOffset);
+      glnvg__convertPaint (gl, frag, paint, scissor, 1.0f, 1.0f, -1.0f);
+      frag->type = NSVG_SHADER_IMG;
+      if (frag->texType == 2 && paint->feather > 0.0f)
+      {
+         // Blurred text, see NVGparams.shaderTextBlur.
+         GLNVGtexture * tex = glnvg__findTexture (gl, paint->image);
+         if (tex != NULL)
+         {
+            frag->texType = 4;
+            frag->feather = paint->feather;
+            frag->extent[0] = 1.0f / tex->width;
+            frag->extent[1] = 1.0f / tex->height;
+         }
+      }
+   }
+   return;
+error:
+   // We get here if call alloc was ok, but something else is not.
+   // Roll back the last call to prevent drawing it.
+   if (gl->ncalls > 0) gl->ncalls--;
+}
+
+static void glnvg__renderShape (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
+                                const float * shape, const NVGvertex * verts, int nverts)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGcall * call = glnvg__allocCall (gl);
+   NVGscissor none;
+   GLNVGfragUniforms * frag;
+   float scaled[4];
+   int fresh, i;
+   if (call == NULL) return;
+   scissor = glnvg__clipCall (gl, call, scissor, &none);
+   call->type = GLNVG_SHAPE;
+   call->image = paint->image;
    call->triangleOffset = glnvg__allocVerts (gl, nverts);
    if (call->triangleOffset == -1) goto error;
    call->triangleCount = nverts;
    memcpy (&gl->verts[call->triangleOffset], verts, sizeof (NVGvertex) * nverts);
-   // Fill shader
-   call->uniformOffset = glnvg__allocFragUniforms (gl, 1);
+   // Packed texture coordinates end at 1, so scale the shape down to fit. Its distance scales
+   // along, which the coverage scale makes up for.
+   if (gl->flags & NVG_PACKED_VERTICES)
+   {
+      NVGvertex * dst = &gl->verts[call->triangleOffset];
+      float s = 1.0f;
+      for (i = 0; i < nverts; i++)
+         s = fmaxf (s, fmaxf (fabsf (dst[i].u), fabsf (dst[i].v)));
+      if (s > 1.0f)
+      {
+         for (i = 0; i < nverts; i++)
+         {
+            dst[i].u /= s;
+            dst[i].v /= s;
+         }
+         scaled[0] = shape[0] / s;
+         scaled[1] = shape[1] / s;
+         scaled[2] = shape[2] / s;
+         scaled[3] = shape[3] * s;
+         shape = scaled;
+      }
+   }
+   // Fill shader, the coverage comes from the shape instead of the fringe.
+   call->uniformOffset = glnvg__allocPaintUniforms (gl, call->type, paint, scissor, fringe, fringe, shape, 1, &fresh);
    if (call->uniformOffset == -1) goto error;
-   frag = nvg__fragUniformPtr (gl, call->uniformOffset);
-   glnvg__convertPaint (gl, frag, paint, scissor, 1.0f, 1.0f, -1.0f);
-   frag->type = NSVG_SHADER_IMG;
+   if (fresh)
+   {
+      frag = nvg__fragUniformPtr (gl, call->uniformOffset);
+      glnvg__convertPaint (gl, frag, paint, scissor, fringe, fringe, -1.0f);
+      memcpy (frag->shape, shape, sizeof (frag->shape));
+   }
    return;
 error:
    // We get here if call alloc was ok, but something else is not.
@@ -1365,12 +5474,175 @@ error:
    if (gl->ncalls > 0) gl->ncalls--;
 }
 
+#if defined NANOVG_GL3
+static GLNVGplot * glnvg__findPlot (GLNVGcontext * gl, int id)
+{
+   if (id <= 0 || id > gl->cplots || gl->plots[id - 1].tex == 0)
+      return NULL;
+   return &gl->plots[id - 1];
+}
+
+static int glnvg__renderCreatePlot (void * uptr, int capacity)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGplot * plot = NULL;
+   GLint maxSize = 0;
+   int i, rows = (capacity + NANOVG_GL_PLOT_ROW - 1) / NANOVG_GL_PLOT_ROW;
+   if (!glnvg__featureShader (gl, &gl->plotShader, &gl->plotState, "plot", gl->plotSources)) return 0;
+   glGetIntegerv (GL_MAX_TEXTURE_SIZE, &maxSize);
+   if (rows > maxSize) return 0;
+   for (i = 0; i < gl->cplots; i++)
+      if (gl->plots[i].tex == 0)
+      {
+         plot = &gl->plots[i];
+         break;
+      }
+   if (plot == NULL)
+   {
+      int cplots = glnvg__maxi (gl->cplots + 1, 4) + gl->cplots / 2; // 1.5x Overallocate
+      GLNVGplot * plots = (GLNVGplot *)realloc (gl->plots, sizeof (GLNVGplot) * cplots);
+      if (plots == NULL) return 0;
+      memset (&plots[gl->cplots], 0, sizeof (GLNVGplot) * (cplots - gl->cplots));
+      plot = &plots[gl->cplots];
+      gl->plots = plots;
+      gl->cplots = cplots;
+   }
+   glGenTextures (1, &plot->tex);
+   glnvg__bindTexture (gl, plot->tex);
+   glTexImage2D (GL_TEXTURE_2D, 0, GL_R32F, NANOVG_GL_PLOT_ROW, rows, 0, GL_RED, GL_FLOAT, NULL);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+   glnvg__checkError (gl, "create plot");
+   plot->capacity = capacity;
+   plot->head = 0;
+   plot->count = 0;
+   gl->textureBytes += (size_t)NANOVG_GL_PLOT_ROW * rows * sizeof (float);
+   return (int) (plot - gl->plots) + 1;
+}
+
+static void glnvg__renderDeletePlot (void * uptr, int id)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGplot * plot = glnvg__findPlot (gl, id);
+   int rows;
+   if (plot == NULL) return;
+   rows = (plot->capacity + NANOVG_GL_PLOT_ROW - 1) / NANOVG_GL_PLOT_ROW;
+   gl->textureBytes -= (size_t)NANOVG_GL_PLOT_ROW * rows * sizeof (float);
+   glnvg__forgetTexture (gl, plot->tex);
+   glDeleteTextures (1, &plot->tex);
+   memset (plot, 0, sizeof (*plot));
+}
+
+// Writes the samples where the ring stands, whole rows at once where they line up.
+static void glnvg__renderAppendPlot (void * uptr, int id, const float * samples, int n)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGplot * plot = glnvg__findPlot (gl, id);
+   if (plot == NULL) return;
+   if (n > plot->capacity)
+   {
+      samples += n - plot->capacity;
+      n = plot->capacity;
+   }
+   glnvg__bindTexture (gl, plot->tex);
+   glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+   while (n > 0)
+   {
+      int x = plot->head % NANOVG_GL_PLOT_ROW, y = plot->head / NANOVG_GL_PLOT_ROW;
+      int run = glnvg__mini (n, plot->capacity - plot->head), w, h;
+      if (x == 0 && run >= NANOVG_GL_PLOT_ROW)
+      {
+         w = NANOVG_GL_PLOT_ROW;
+         h = run / NANOVG_GL_PLOT_ROW;
+      }
+      else
+      {
+         w = glnvg__mini (run, NANOVG_GL_PLOT_ROW - x);
+         h = 1;
+      }
+      glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_FLOAT, samples);
+      samples += w * h;
+      n -= w * h;
+      plot->head = (plot->head + w * h) % plot->capacity;
+      plot->count = glnvg__mini (plot->count + w * h, plot->capacity);
+   }
+   glnvg__checkError (gl, "append plot");
+}
+
+static void glnvg__renderClearPlot (void * uptr, int id)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGplot * plot = glnvg__findPlot (gl, id);
+   if (plot == NULL) return;
+   plot->head = 0;
+   plot->count = 0;
+}
+
+static void glnvg__renderPlot (void * uptr, NVGscissor * scissor, const NVGplotDraw * draw)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)uptr;
+   GLNVGcall * call;
+   GLNVGplotDraw * dst;
+   GLNVGfragUniforms frag;
+   NVGpaint paint;
+   NVGcolor stroke, fill;
+   float * u;
+   if (glnvg__findPlot (gl, draw->plot) == NULL) return;
+   if (gl->nplotDraws + 1 > gl->cplotDraws)
+   {
+      int cplotDraws = glnvg__maxi (gl->nplotDraws + 1, 16) + gl->cplotDraws / 2; // 1.5x Overallocate
+      GLNVGplotDraw * draws = (GLNVGplotDraw *)realloc (gl->plotDraws, sizeof (GLNVGplotDraw) * cplotDraws);
+      if (draws == NULL) return;
+      gl->plotDraws = draws;
+      gl->cplotDraws = cplotDraws;
+   }
+   call = glnvg__allocCall (gl);
+   if (call == NULL) return;
+   call->type = GLNVG_PLOT;
+   call->plotOffset = gl->nplotDraws++;
+   dst = &gl->plotDraws[call->plotOffset];
+   memset (dst, 0, sizeof (*dst));
+   dst->plot = draw->plot;
+   u = dst->uniforms;
+   // The scissor is set up exactly like that of the other calls.
+   memset (&paint, 0, sizeof (paint));
+   nvgTransformIdentity (paint.xform);
+   glnvg__convertPaint (gl, &frag, &paint, scissor, draw->strokeWidth, draw->fringe, -1.0f);
+   memcpy (&u[0], frag.scissorMat, sizeof (float) * 12);
+   memcpy (&u[12], frag.scissorExt, sizeof (float) * 2);
+   memcpy (&u[14], frag.scissorScale, sizeof (float) * 2);
+   memcpy (&u[16], draw->xform, sizeof (float) * 6);
+   u[22] = draw->strokeWidth * 0.5f;
+   u[23] = draw->fringe;
+   memcpy (&u[24], draw->rect, sizeof (float) * 4);
+   u[28] = draw->range[0];
+   u[29] = draw->range[1] != draw->range[0] ? 1.0f / (draw->range[1] - draw->range[0]) : 0.0f;
+   stroke = glnvg__premulColor (draw->strokeColor);
+   fill = glnvg__premulColor (draw->fillColor);
+   memcpy (&u[36], &stroke, sizeof (float) * 4);
+   memcpy (&u[40], &fill, sizeof (float) * 4);
+}
+#endif
+
 static void glnvg__renderDelete (void * uptr)
 {
    GLNVGcontext * gl = (GLNVGcontext *)uptr;
    int i;
    if (gl == NULL) return;
    glnvg__deleteShader (&gl->shader);
+#if defined NANOVG_GL3
+   if (gl->merge)
+      glnvg__deleteShader (&gl->mergeShader);
+#endif
+   for (i = 0; i < GLNVG_VARIANTS; i++)
+      glnvg__deleteShader (&gl->variants[i]);
+   free (gl->variantKeys);
+   free (gl->programCache);
+#if defined NANOVG_GL_HAS_LAYERS
+   for (i = 0; i < NANOVG_GL_LAYER_TARGETS; i++)
+      glnvg__deleteLayerTarget (&gl->layerTargets[i]);
+#endif
 #if NANOVG_GL3
 #if NANOVG_GL_USE_UNIFORMBUFFER
    if (gl->fragBuf != 0)
@@ -1378,18 +5650,71 @@ static void glnvg__renderDelete (void * uptr)
 #endif
    if (gl->vertArr != 0)
       glDeleteVertexArrays (1, &gl->vertArr);
+   if (gl->indirectBuf != 0)
+      glDeleteBuffers (1, &gl->indirectBuf);
+   free (gl->commands);
+#if NANOVG_GL_HAS_PATH_RENDERING
+   if (gl->pathObjects != 0)
+      glDeletePathsNV (gl->pathObjects, NANOVG_GL_PATH_OBJECTS);
+#endif
+   free (gl->pathCommands);
+   free (gl->pathCoords);
+   glnvg__deleteRing (gl);
+   glnvg__deleteUploads (gl);
+   if (gl->quadBuf != 0)
+      glDeleteBuffers (1, &gl->quadBuf);
+   free (gl->quads);
+   if (gl->instanceBuf != 0)
+      glDeleteBuffers (1, &gl->instanceBuf);
+   free (gl->instances);
+   free (gl->shapes);
+   free (gl->sortedCalls);
+   free (gl->sortedQuads);
+   free (gl->callBounds);
+   free (gl->callOrder);
+   for (i = 0; i < gl->npages; i++)
+      glDeleteTextures (1, &gl->pages[i].tex);
+   free (gl->pages);
+   if (gl->paintIdxBuf != 0)
+      glDeleteBuffers (1, &gl->paintIdxBuf);
+   if (gl->indexBuf != 0)
+      glDeleteBuffers (1, &gl->indexBuf);
+   if (gl->paintBuf != 0)
+      glDeleteBuffers (1, &gl->paintBuf);
+   if (gl->paintTex != 0)
+      glDeleteTextures (1, &gl->paintTex);
+   free (gl->paintIdx);
+   free (gl->indices);
+   free (gl->paints);
+   glnvg__deleteShader (&gl->plotShader);
+   glnvg__deleteShader (&gl->blurShader);
+   for (i = 0; i < NANOVG_GL_BLUR_LEVELS; i++)
+      glnvg__deleteBlurLevel (&gl->blurLevels[i]);
+   if (gl->backdropFbo != 0)
+      glDeleteFramebuffers (1, &gl->backdropFbo);
+   for (i = 0; i < gl->cplots; i++)
+      if (gl->plots[i].tex != 0)
+         glDeleteTextures (1, &gl->plots[i].tex);
+   free (gl->plots);
+   free (gl->plotDraws);
 #endif
    if (gl->vertBuf != 0)
       glDeleteBuffers (1, &gl->vertBuf);
    for (i = 0; i < gl->ntextures; i++)
    {
-      if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
+      // Atlas pages were deleted above.
+      if (gl->textures[i].tex != 0 && gl->textures[i].page == 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
          glDeleteTextures (1, &gl->textures[i].tex);
    }
    free (gl->textures);
+   free (gl->mipQueue);
    free (gl->paths);
-   free (gl->verts);
-   free (gl->uniforms);
+   free (gl->vertHeap);
+   free (gl->uniformHeap);
+   free (gl->packedVerts);
+   free (gl->multiFirst);
+   free (gl->multiCount);
+   free (gl->paintCache);
    free (gl->calls);
    free (gl);
 }
@@ -1410,11 +5735,15 @@ static void glnvg__renderDelete (void * uptr)
    GLNVGcontext * gl = (GLNVGcontext *)malloc (sizeof (GLNVGcontext));
    if (gl == NULL) goto error;
    memset (gl, 0, sizeof (GLNVGcontext));
+   gl->state = &gl->ownState;
+   gl->paintFrame = 1;
    memset (&params, 0, sizeof (params));
    params.renderCreate = glnvg__renderCreate;
    params.renderCreateTexture = glnvg__renderCreateTexture;
+   params.renderCreateCompressedTexture = glnvg__renderCreateCompressedTexture;
    params.renderDeleteTexture = glnvg__renderDeleteTexture;
    params.renderUpdateTexture = glnvg__renderUpdateTexture;
+   params.renderUpdateTextureRegion = glnvg__renderUpdateTextureRegion;
    params.renderGetTextureSize = glnvg__renderGetTextureSize;
    params.renderViewport = glnvg__renderViewport;
    params.renderCancel = glnvg__renderCancel;
@@ -1422,10 +5751,39 @@ static void glnvg__renderDelete (void * uptr)
    params.renderFill = glnvg__renderFill;
    params.renderStroke = glnvg__renderStroke;
    params.renderTriangles = glnvg__renderTriangles;
+   params.renderShape = glnvg__renderShape;
    params.renderDelete = glnvg__renderDelete;
+   params.renderStats = glnvg__renderStats;
+   params.renderReserve = glnvg__renderReserve;
+   params.renderShrink = glnvg__renderShrink;
+   params.renderMemory = glnvg__renderMemory;
+   params.renderTextureKBytes = glnvg__renderTextureKBytes;
+   params.renderEdgeAntiAlias = glnvg__renderEdgeAntiAlias;
+#if defined NANOVG_GL3
+   params.renderCreatePlot = glnvg__renderCreatePlot;
+   params.renderDeletePlot = glnvg__renderDeletePlot;
+   params.renderAppendPlot = glnvg__renderAppendPlot;
+   params.renderClearPlot = glnvg__renderClearPlot;
+   params.renderPlot = glnvg__renderPlot;
+   params.renderBackdrop = glnvg__renderBackdrop;
+#endif
+#if defined NANOVG_GL_HAS_LAYERS
+   params.renderBeginLayer = glnvg__renderBeginLayer;
+   params.renderEndLayer = glnvg__renderEndLayer;
+#endif
    params.userPtr = gl;
+   params.triangleFills = 1;
+   params.distanceFieldText = flags & NVG_SDF_TEXT ? 1 : 0;
+   params.shaderTextBlur = 1;
    params.edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
    gl->flags = flags;
+   if (glnvg__programCacheDir != NULL)
+   {
+      gl->programCache = (char *)malloc (strlen (glnvg__programCacheDir) + 1);
+      if (gl->programCache == NULL) goto error;
+      strcpy (gl->programCache, glnvg__programCacheDir);
+   }
+   gl->edgeAA = (flags & NVG_ANTIALIAS) != 0;
    ctx = nvgCreateInternal (&params);
    if (ctx == NULL) goto error;
    return ctx;
@@ -1468,4 +5826,179 @@ GLuint nvglImageHandle (NVGcontext * ctx, int image)
    return tex->tex;
 }
 
+void nvglFlushUploads (NVGcontext * ctx)
+{
+#if defined NANOVG_GL3
+   glnvg__flushUploads ((GLNVGcontext *)nvgInternalParams (ctx)->userPtr);
+#else
+   NVG_NOTUSED (ctx);
+#endif
+}
+
+int nvglStreamImage (NVGcontext * ctx, int image, const unsigned char * data, int rowBytes)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   if (tex == NULL || tex->compressed || tex->type != NVG_TEXTURE_RGBA || rowBytes < tex->width * 4 || rowBytes % 4 != 0)
+      return 0;
+#ifdef NANOVG_GLES2
+   if (rowBytes != tex->width * 4)
+      return 0;
+#endif
+#if defined NANOVG_GL3
+   glnvg__streamRect (gl, tex, 0, 0, tex->width, tex->height, data, rowBytes);
+#else
+   glnvg__texSubImage (gl, tex, 0, 0, tex->width, tex->height, rowBytes / 4, data);
+#endif
+   glnvg__bindTexture (gl, 0);
+   glnvg__queueMipmaps (gl, tex);
+   glnvg__checkError (gl, "stream image");
+   return 1;
+}
+
+unsigned char * nvglMapImage (NVGcontext * ctx, int image, int * rowBytes)
+{
+#if defined NANOVG_GL3
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   int slot, size;
+   void * map;
+   if (tex == NULL || tex->compressed || tex->type != NVG_TEXTURE_RGBA || tex->streamMapped)
+      return NULL;
+   slot = tex->streamIndex;
+   size = tex->width * tex->height * 4;
+   if (tex->streamBufs[slot] == 0)
+      glGenBuffers (1, &tex->streamBufs[slot]);
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, tex->streamBufs[slot]);
+   if (tex->streamSizes[slot] < size)
+   {
+      glBufferData (GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+      tex->streamSizes[slot] = size;
+   }
+   map = glMapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+   if (map == NULL)
+      return NULL;
+   tex->streamMapped = 1;
+   *rowBytes = tex->width * 4;
+   return (unsigned char *)map;
+#else
+   NVG_NOTUSED (ctx);
+   NVG_NOTUSED (image);
+   NVG_NOTUSED (rowBytes);
+   return NULL;
+#endif
+}
+
+void nvglUnmapImage (NVGcontext * ctx, int image)
+{
+#if defined NANOVG_GL3
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   int slot;
+   if (tex == NULL || !tex->streamMapped)
+      return;
+   slot = tex->streamIndex;
+   tex->streamMapped = 0;
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, tex->streamBufs[slot]);
+   // The contents are undefined if the buffer was lost while mapped, the image keeps its pixels then.
+   if (glUnmapBuffer (GL_PIXEL_UNPACK_BUFFER))
+   {
+      glnvg__texSubImage (gl, tex, 0, 0, tex->width, tex->height, tex->width, NULL);
+      glnvg__queueMipmaps (gl, tex);
+   }
+   glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+   glnvg__bindTexture (gl, 0);
+   tex->streamIndex = 1 - slot;
+   glnvg__checkError (gl, "unmap image");
+#else
+   NVG_NOTUSED (ctx);
+   NVG_NOTUSED (image);
+#endif
+}
+
+void nvglSetMipmapBudget (NVGcontext * ctx, int texels)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   gl->mipBudget = glnvg__maxi (texels, 0);
+}
+
+void nvglSetMipmapInterval (NVGcontext * ctx, int image, int flushes)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   GLNVGtexture * tex = glnvg__findTexture (gl, image);
+   if (tex != NULL)
+      tex->mipInterval = glnvg__maxi (flushes, -1);
+}
+
+int nvglIssuedDrawCallCount (NVGcontext * ctx)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   return gl->issuedDraws;
+}
+
+void nvglSetProfileCallback (NVGcontext * ctx, NVGLprofileCallback callback, void * userPtr)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   gl->profile = callback;
+   gl->profileUser = userPtr;
+}
+
+int nvglCreateWindowState (NVGcontext * ctx)
+{
+#if defined NANOVG_GL3
+   GLuint vertArr = 0;
+   NVG_NOTUSED (ctx);
+   glGenVertexArrays (1, &vertArr);
+   return (int)vertArr;
+#else
+   NVG_NOTUSED (ctx);
+   return 0;
+#endif
+}
+
+void nvglUseWindowState (NVGcontext * ctx, int state)
+{
+#if defined NANOVG_GL3
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   gl->windowVertArr = (GLuint)state;
+#else
+   NVG_NOTUSED (ctx);
+   NVG_NOTUSED (state);
+#endif
+}
+
+void nvglDeleteWindowState (NVGcontext * ctx, int state)
+{
+#if defined NANOVG_GL3
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   GLuint vertArr = (GLuint)state;
+   if (gl->windowVertArr == vertArr)
+      gl->windowVertArr = 0;
+#if NANOVG_GL_HAS_DSA
+   glnvg__dsaForgetVertexArray (gl, vertArr);
+#endif
+   // Deleting the bound vertex array binds 0 in its place.
+   if (gl->state->vertexArray == vertArr)
+      gl->state->vertexArray = 0;
+   if (vertArr != 0)
+      glDeleteVertexArrays (1, &vertArr);
+#else
+   NVG_NOTUSED (ctx);
+   NVG_NOTUSED (state);
+#endif
+}
+
+void nvglShareState (NVGcontext * ctx, NVGglState * state)
+{
+   GLNVGcontext * gl = (GLNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   gl->state = state != NULL ? state : &gl->ownState;
+   gl->ownState.known = 0;
+}
+
+void nvglSetProgramCache (const char * dir)
+{
+   glnvg__programCacheDir = dir;
+}
+
 #endif /* NANOVG_GL_IMPLEMENTATION */
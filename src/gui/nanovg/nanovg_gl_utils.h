@@ -23,6 +23,7 @@ struct NVGLUframebuffer
    NVGcontext * ctx;
    GLuint fbo;
    GLuint rbo;
+   GLuint colorRbo;	// multisampled color buffer, used instead of texture
    GLuint texture;
    int image;
 };
@@ -33,6 +34,12 @@ void nvgluBindFramebuffer (NVGLUframebuffer * fb);
 NVGLUframebuffer * nvgluCreateFramebuffer (NVGcontext * ctx, int w, int h, int imageFlags);
 void nvgluDeleteFramebuffer (NVGLUframebuffer * fb);
 
+// Helper functions to render into a multisampled frame buffer, which has no image, and to resolve
+// its w x h pixels into another one, or into the default frame buffer when dst is NULL. They
+// need OpenGL 3 or OpenGL ES 3 and return NULL otherwise. samples is clamped to GL_MAX_SAMPLES.
+NVGLUframebuffer * nvgluCreateMultisampleFramebuffer (NVGcontext * ctx, int w, int h, int samples);
+void nvgluResolveFramebuffer (NVGLUframebuffer * src, NVGLUframebuffer * dst, int w, int h);
+
 #endif // NANOVG_GL_UTILS_H
 
 #ifdef NANOVG_GL_IMPLEMENTATION
@@ -48,6 +55,10 @@ void nvgluDeleteFramebuffer (NVGLUframebuffer * fb);
    #endif
 #endif
 
+#if defined(NANOVG_GL3) || defined(NANOVG_GLES3)
+   #define NANOVG_MSAA_VALID 1
+#endif
+
 static GLint defaultFBO = -1;
 
 NVGLUframebuffer * nvgluCreateFramebuffer (NVGcontext * ctx, int w, int h, int imageFlags)
@@ -92,6 +103,69 @@ error:
 #endif
 }
 
+NVGLUframebuffer * nvgluCreateMultisampleFramebuffer (NVGcontext * ctx, int w, int h, int samples)
+{
+#ifdef NANOVG_MSAA_VALID
+   GLint defaultFBO;
+   GLint defaultRBO;
+   GLint maxSamples;
+   NVGLUframebuffer * fb = NULL;
+   glGetIntegerv (GL_FRAMEBUFFER_BINDING, &defaultFBO);
+   glGetIntegerv (GL_RENDERBUFFER_BINDING, &defaultRBO);
+   glGetIntegerv (GL_MAX_SAMPLES, &maxSamples);
+   if (samples > maxSamples) samples = maxSamples;
+   fb = (NVGLUframebuffer *)malloc (sizeof (NVGLUframebuffer));
+   if (fb == NULL) goto error;
+   memset (fb, 0, sizeof (NVGLUframebuffer));
+   fb->image = -1;
+   fb->ctx = ctx;
+   glGenFramebuffers (1, &fb->fbo);
+   glBindFramebuffer (GL_FRAMEBUFFER, fb->fbo);
+   glGenRenderbuffers (1, &fb->colorRbo);
+   glBindRenderbuffer (GL_RENDERBUFFER, fb->colorRbo);
+   glRenderbufferStorageMultisample (GL_RENDERBUFFER, samples, GL_RGBA8, w, h);
+   glGenRenderbuffers (1, &fb->rbo);
+   glBindRenderbuffer (GL_RENDERBUFFER, fb->rbo);
+   glRenderbufferStorageMultisample (GL_RENDERBUFFER, samples, GL_STENCIL_INDEX8, w, h);
+   glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, fb->colorRbo);
+   glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, fb->rbo);
+   if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) goto error;
+   glBindFramebuffer (GL_FRAMEBUFFER, defaultFBO);
+   glBindRenderbuffer (GL_RENDERBUFFER, defaultRBO);
+   return fb;
+error:
+   glBindFramebuffer (GL_FRAMEBUFFER, defaultFBO);
+   glBindRenderbuffer (GL_RENDERBUFFER, defaultRBO);
+   nvgluDeleteFramebuffer (fb);
+   return NULL;
+#else
+   NVG_NOTUSED (ctx);
+   NVG_NOTUSED (w);
+   NVG_NOTUSED (h);
+   NVG_NOTUSED (samples);
+   return NULL;
+#endif
+}
+
+void nvgluResolveFramebuffer (NVGLUframebuffer * src, NVGLUframebuffer * dst, int w, int h)
+{
+#ifdef NANOVG_MSAA_VALID
+   GLint readFBO, drawFBO;
+   glGetIntegerv (GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+   glGetIntegerv (GL_DRAW_FRAMEBUFFER_BINDING, &drawFBO);
+   glBindFramebuffer (GL_READ_FRAMEBUFFER, src->fbo);
+   glBindFramebuffer (GL_DRAW_FRAMEBUFFER, dst != NULL ? dst->fbo : 0);
+   glBlitFramebuffer (0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+   glBindFramebuffer (GL_READ_FRAMEBUFFER, readFBO);
+   glBindFramebuffer (GL_DRAW_FRAMEBUFFER, drawFBO);
+#else
+   NVG_NOTUSED (src);
+   NVG_NOTUSED (dst);
+   NVG_NOTUSED (w);
+   NVG_NOTUSED (h);
+#endif
+}
+
 void nvgluBindFramebuffer (NVGLUframebuffer * fb)
 {
 #ifdef NANOVG_FBO_VALID
@@ -110,11 +184,14 @@ void nvgluDeleteFramebuffer (NVGLUframebuffer * fb)
       glDeleteFramebuffers (1, &fb->fbo);
    if (fb->rbo != 0)
       glDeleteRenderbuffers (1, &fb->rbo);
+   if (fb->colorRbo != 0)
+      glDeleteRenderbuffers (1, &fb->colorRbo);
    if (fb->image >= 0)
       nvgDeleteImage (fb->ctx, fb->image);
    fb->ctx = NULL;
    fb->fbo = 0;
    fb->rbo = 0;
+   fb->colorRbo = 0;
    fb->texture = 0;
    fb->image = -1;
    free (fb);
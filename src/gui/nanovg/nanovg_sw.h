@@ -0,0 +1,1015 @@
+//
+// Copyright (c) 2009-2013 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+#ifndef NANOVG_SW_H
+#define NANOVG_SW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Software back-end, for rendering without a GPU, e.g. headless tests and thumbnails. Calls are
+// queued as they are submitted and rasterized by nvgEndFrame() into an RGBA buffer of the
+// application, premultiplied, top row first. The buffer is cut into square tiles that each draw
+// all calls touching them in order, so tiles go in parallel through nvgswSetParallelCallback().
+//
+// Within a tile the calls follow the passes of the GL back-end: triangles are sampled at pixel
+// centers from vertices snapped to 1/16 pixel, fills wind into a stencil of the tile before they
+// are covered, and fringes take their coverage from the vertex u,v, so pictures match the GL
+// back-end without MSAA. Blending is source over, with SSE2 where the compiler targets it.
+//
+// A frame goes like this:
+//    memset (pixels, 0, height * stride);	// the back-end never clears
+//    nvgswSetFramebuffer (vg, pixels, width, height, stride);
+//    nvgBeginFrame (vg, width / pixelRatio, height / pixelRatio, pixelRatio);
+//    ...
+//    nvgEndFrame (vg);
+//
+// Layers, backdrops, plots, compressed images, mipmaps and composite operations are not supported.
+
+// Create flags, with the values of nanovg_gl.h. Include that or nanovg_vk.h first when using both.
+#if !defined (NANOVG_GL_H) && !defined (NANOVG_VK_H)
+enum NVGcreateFlags
+{
+   // Flag indicating if geometry based anti-aliasing is used (may not be needed when using MSAA).
+   NVG_ANTIALIAS 		= 1 << 0,
+   // Flag indicating if strokes should be drawn using stencil buffer. The rendering will be a little
+   // slower, but path overlaps (i.e. self-intersecting or sharp turns) will be drawn just once.
+   NVG_STENCIL_STROKES	= 1 << 1,
+   // Flag indicating that additional debug checks are done.
+   NVG_DEBUG 			= 1 << 2,
+};
+#endif
+
+NVGcontext * nvgCreateSW (int flags);
+void nvgDeleteSW (NVGcontext * ctx);
+
+// Sets the buffer the following flushes draw into: width by height RGBA pixels with premultiplied
+// alpha, rows stride bytes apart, top row first. The buffer is not copied.
+void nvgswSetFramebuffer (NVGcontext * ctx, unsigned char * pixels, int width, int height, int stride);
+
+// Spreads the tiles of a flush over the threads of callback, the same kind of callback as that of
+// nvgSetParallelCallback(), e.g. TaskPool::nvgCallback. Tiles go one after the other on the
+// calling thread when it is NULL, the default.
+void nvgswSetParallelCallback (NVGcontext * ctx, NVGparallelCallback callback, void * userPtr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NANOVG_SW_H */
+
+#ifdef NANOVG_SW_IMPLEMENTATION
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "nanovg.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Size of the tiles, whose stencil is on the stack of the thread drawing them.
+#define NANOVG_SW_TILE 64
+// Vertices are snapped to 1 / (1 << NANOVG_SW_SUBPIXEL) pixel, where edges are evaluated exactly.
+#define NANOVG_SW_SUBPIXEL 4
+// Vertices are clamped to that many pixels either way, so that edge functions fit 64 bits.
+#define NANOVG_SW_MAX_COORD 65536.0f
+
+// Passes of the calls, those of nanovg_vk.h, with the same topology and stencil use.
+enum SWNVGmode
+{
+   SWNVG_FILL_STENCIL,		// winding into the stencil, fan, no color
+   SWNVG_FILL_AA,			// where the stencil is 0, strip
+   SWNVG_FILL_COVER,		// where the stencil is not 0, clearing it, list
+   SWNVG_FAN,				// convex fills and shapes
+   SWNVG_STRIP,			// fringes and strokes
+   SWNVG_LIST,				// triangles
+   SWNVG_STROKE_DRAW,		// where the stencil is 0, incrementing it, strip
+   SWNVG_STROKE_CLEAR		// clearing the stencil, strip, no color
+};
+
+enum SWNVGshaderType
+{
+   SWNVG_SHADER_FILLGRAD,
+   SWNVG_SHADER_FILLIMG,
+   SWNVG_SHADER_IMG,
+   SWNVG_SHADER_FILLRAMP
+};
+
+struct SWNVGtexture
+{
+   int id;
+   int width, height;
+   int type;
+   int flags;
+   unsigned char * data;
+};
+typedef struct SWNVGtexture SWNVGtexture;
+
+// The uniforms of nanovg_vk.frag, with affine matrices and colors premultiplied.
+struct SWNVGpaint
+{
+   float scissorMat[6];
+   float paintMat[6];
+   float innerCol[4];
+   float outerCol[4];
+   float scissorExt[2];
+   float scissorScale[2];
+   float extent[2];
+   float radius;
+   float feather;
+   float strokeMult;
+   float strokeThr;
+   float texRect[4];
+   float shape[4];
+   int type;
+   int texType;
+   int image;
+   int edgeAA;
+   int solid;					// one color, neither scissored nor shaped
+   const SWNVGtexture * tex;	// looked up by the flush
+};
+typedef struct SWNVGpaint SWNVGpaint;
+
+struct SWNVGdraw
+{
+   int mode;
+   int paint;
+   int first;
+   int count;
+   int bounds[4];		// pixels the vertices touch, x0, y0, x1, y1 exclusive
+};
+typedef struct SWNVGdraw SWNVGdraw;
+
+struct SWNVGcontext
+{
+   int flags;
+   int edgeAA;
+   unsigned char * pixels;
+   int width, height, stride;
+   float pixelRatio;
+   SWNVGtexture * textures;
+   int ntextures;
+   int ctextures;
+   int textureId;
+   // Calls of the frame, vertices in pixels.
+   SWNVGdraw * draws;
+   int ndraws;
+   int cdraws;
+   SWNVGpaint * paints;
+   int npaints;
+   int cpaints;
+   NVGvertex * verts;
+   int nverts;
+   int cverts;
+   NVGparallelCallback parallel;
+   void * parallelUser;
+   int tilesX;
+};
+typedef struct SWNVGcontext SWNVGcontext;
+
+struct SWNVGtile
+{
+   SWNVGcontext * sw;
+   int x0, y0, x1, y1;
+   unsigned char stencil[NANOVG_SW_TILE * NANOVG_SW_TILE];
+   float span[NANOVG_SW_TILE * 4];
+};
+typedef struct SWNVGtile SWNVGtile;
+
+static int swnvg__maxi (int a, int b)
+{
+   return a > b ? a : b;
+}
+
+static int swnvg__mini (int a, int b)
+{
+   return a < b ? a : b;
+}
+
+static float swnvg__clampf (float a, float mn, float mx)
+{
+   return a < mn ? mn : (a > mx ? mx : a);
+}
+
+// Makes room for n more elements of size in *ptr, holding *count of *capacity.
+static int swnvg__reserve (void ** ptr, int * capacity, int count, int n, size_t size)
+{
+   void * grown;
+   int cap;
+   if (count + n <= *capacity) return 1;
+   cap = swnvg__maxi (count + n, 64) + *capacity / 2; // 1.5x Overallocate
+   grown = realloc (*ptr, size * cap);
+   if (grown == NULL) return 0;
+   *ptr = grown;
+   *capacity = cap;
+   return 1;
+}
+
+static SWNVGtexture * swnvg__findTexture (SWNVGcontext * sw, int id)
+{
+   int i;
+   for (i = 0; i < sw->ntextures; i++)
+      if (sw->textures[i].id == id && id != 0)
+         return &sw->textures[i];
+   return NULL;
+}
+
+static int swnvg__renderCreate (void * uptr)
+{
+   NVG_NOTUSED (uptr);
+   return 1;
+}
+
+static int swnvg__renderCreateTexture (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   SWNVGtexture * tex = NULL;
+   size_t size = (size_t)w * h * (type == NVG_TEXTURE_RGBA ? 4 : 1);
+   int i;
+   if (w <= 0 || h <= 0) return 0;
+   for (i = 0; i < sw->ntextures; i++)
+      if (sw->textures[i].id == 0)
+      {
+         tex = &sw->textures[i];
+         break;
+      }
+   if (tex == NULL)
+   {
+      if (!swnvg__reserve ((void **)&sw->textures, &sw->ctextures, sw->ntextures, 1, sizeof (SWNVGtexture)))
+         return 0;
+      tex = &sw->textures[sw->ntextures++];
+   }
+   memset (tex, 0, sizeof (*tex));
+   tex->data = (unsigned char *)malloc (size);
+   if (tex->data == NULL) return 0;
+   if (data != NULL)
+      memcpy (tex->data, data, size);
+   else
+      memset (tex->data, 0, size);
+   tex->id = ++sw->textureId;
+   tex->width = w;
+   tex->height = h;
+   tex->type = type;
+   tex->flags = imageFlags;
+   return tex->id;
+}
+
+static int swnvg__renderDeleteTexture (void * uptr, int image)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   SWNVGtexture * tex = swnvg__findTexture (sw, image);
+   if (tex == NULL) return 0;
+   free (tex->data);
+   memset (tex, 0, sizeof (*tex));
+   return 1;
+}
+
+static int swnvg__renderUpdateTextureRegion (void * uptr, int image, int x, int y, int w, int h,
+                                             const unsigned char * data, int rowBytes)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   SWNVGtexture * tex = swnvg__findTexture (sw, image);
+   int bpp, row;
+   if (tex == NULL) return 0;
+   bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+   if (rowBytes == 0)
+      rowBytes = w * bpp;
+   if (rowBytes < w * bpp) return 0;
+   // Clip to the image, moving data along.
+   if (x < 0)
+   {
+      data -= x * bpp;
+      w += x;
+      x = 0;
+   }
+   if (y < 0)
+   {
+      data -= (ptrdiff_t)y * rowBytes;
+      h += y;
+      y = 0;
+   }
+   w = swnvg__mini (w, tex->width - x);
+   h = swnvg__mini (h, tex->height - y);
+   for (row = 0; row < h; row++)
+      memcpy (tex->data + ((size_t) (y + row) * tex->width + x) * bpp, data + (size_t)row * rowBytes, (size_t)w * bpp);
+   return 1;
+}
+
+static int swnvg__renderUpdateTexture (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   SWNVGtexture * tex = swnvg__findTexture (sw, image);
+   int bpp;
+   if (tex == NULL) return 0;
+   bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+   return swnvg__renderUpdateTextureRegion (uptr, image, x, y, w, h, data + ((size_t)y * tex->width + x) * bpp,
+                                            tex->width * bpp);
+}
+
+static int swnvg__renderGetTextureSize (void * uptr, int image, int * w, int * h)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   SWNVGtexture * tex = swnvg__findTexture (sw, image);
+   if (tex == NULL) return 0;
+   *w = tex->width;
+   *h = tex->height;
+   return 1;
+}
+
+static void swnvg__premulColor (float * out, NVGcolor c)
+{
+   out[0] = c.r * c.a;
+   out[1] = c.g * c.a;
+   out[2] = c.b * c.a;
+   out[3] = c.a;
+}
+
+// As vknvg__convertPaint(), returning the index of the paint or -1.
+static int swnvg__addPaint (SWNVGcontext * sw, NVGpaint * paint, NVGscissor * scissor, float width, float fringe,
+                            float strokeThr)
+{
+   SWNVGtexture * tex;
+   SWNVGpaint * p;
+   int scissored = !(scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f);
+   if (!swnvg__reserve ((void **)&sw->paints, &sw->cpaints, sw->npaints, 1, sizeof (SWNVGpaint)))
+      return -1;
+   p = &sw->paints[sw->npaints];
+   memset (p, 0, sizeof (*p));
+   swnvg__premulColor (p->innerCol, paint->innerColor);
+   swnvg__premulColor (p->outerCol, paint->outerColor);
+   if (!scissored)
+   {
+      p->scissorExt[0] = 1.0f;
+      p->scissorExt[1] = 1.0f;
+      p->scissorScale[0] = 1.0f;
+      p->scissorScale[1] = 1.0f;
+   }
+   else
+   {
+      nvgTransformInverse (p->scissorMat, scissor->xform);
+      p->scissorExt[0] = scissor->extent[0];
+      p->scissorExt[1] = scissor->extent[1];
+      p->scissorScale[0] = sqrtf (scissor->xform[0] * scissor->xform[0] + scissor->xform[2] * scissor->xform[2]) / fringe;
+      p->scissorScale[1] = sqrtf (scissor->xform[1] * scissor->xform[1] + scissor->xform[3] * scissor->xform[3]) / fringe;
+   }
+   memcpy (p->extent, paint->extent, sizeof (p->extent));
+   p->strokeMult = (width * 0.5f + fringe * 0.5f) / fringe;
+   p->strokeThr = strokeThr;
+   p->edgeAA = sw->edgeAA;
+   p->image = paint->image;
+   if (paint->ramp != NVG_RAMP_NONE)
+   {
+      tex = swnvg__findTexture (sw, paint->image);
+      if (tex == NULL) return -1;
+      p->texRect[0] = 0.5f / tex->width;
+      p->texRect[1] = (paint->rampRow + 0.5f) / tex->height;
+      p->texRect[2] = (tex->width - 0.5f) / tex->width;
+      p->texRect[3] = p->texRect[1];
+      p->type = SWNVG_SHADER_FILLRAMP;
+      p->texType = paint->ramp;
+      p->radius = paint->radius;
+      p->feather = paint->feather;
+      nvgTransformInverse (p->paintMat, paint->xform);
+   }
+   else if (paint->image != 0)
+   {
+      tex = swnvg__findTexture (sw, paint->image);
+      if (tex == NULL) return -1;
+      if ((tex->flags & NVG_IMAGE_FLIPY) != 0)
+      {
+         float flipped[6];
+         nvgTransformScale (flipped, 1.0f, -1.0f);
+         nvgTransformMultiply (flipped, paint->xform);
+         nvgTransformInverse (p->paintMat, flipped);
+      }
+      else
+         nvgTransformInverse (p->paintMat, paint->xform);
+      p->type = SWNVG_SHADER_FILLIMG;
+      if (tex->type == NVG_TEXTURE_RGBA)
+         p->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
+      else
+         p->texType = 2;
+   }
+   else
+   {
+      p->type = SWNVG_SHADER_FILLGRAD;
+      p->radius = paint->radius;
+      p->feather = paint->feather;
+      nvgTransformInverse (p->paintMat, paint->xform);
+      p->solid = !scissored && memcmp (p->innerCol, p->outerCol, sizeof (p->innerCol)) == 0;
+   }
+   return sw->npaints++;
+}
+
+// Appends a pass over nverts vertices, scaled to pixels, unless they miss the framebuffer.
+static void swnvg__addDraw (SWNVGcontext * sw, int mode, int paint, const NVGvertex * verts, int nverts)
+{
+   SWNVGdraw * draw;
+   NVGvertex * dst;
+   float minx = 1e30f, miny = 1e30f, maxx = -1e30f, maxy = -1e30f;
+   int i;
+   if (paint < 0 || nverts < 3) return;
+   if (!swnvg__reserve ((void **)&sw->verts, &sw->cverts, sw->nverts, nverts, sizeof (NVGvertex)) ||
+         !swnvg__reserve ((void **)&sw->draws, &sw->cdraws, sw->ndraws, 1, sizeof (SWNVGdraw)))
+      return;
+   dst = &sw->verts[sw->nverts];
+   for (i = 0; i < nverts; i++)
+   {
+      dst[i].x = swnvg__clampf (verts[i].x * sw->pixelRatio, -NANOVG_SW_MAX_COORD, NANOVG_SW_MAX_COORD);
+      dst[i].y = swnvg__clampf (verts[i].y * sw->pixelRatio, -NANOVG_SW_MAX_COORD, NANOVG_SW_MAX_COORD);
+      dst[i].u = verts[i].u;
+      dst[i].v = verts[i].v;
+      minx = dst[i].x < minx ? dst[i].x : minx;
+      miny = dst[i].y < miny ? dst[i].y : miny;
+      maxx = dst[i].x > maxx ? dst[i].x : maxx;
+      maxy = dst[i].y > maxy ? dst[i].y : maxy;
+   }
+   draw = &sw->draws[sw->ndraws];
+   draw->bounds[0] = swnvg__maxi ((int)floorf (minx), 0);
+   draw->bounds[1] = swnvg__maxi ((int)floorf (miny), 0);
+   draw->bounds[2] = swnvg__mini ((int)floorf (maxx) + 1, sw->width);
+   draw->bounds[3] = swnvg__mini ((int)floorf (maxy) + 1, sw->height);
+   if (draw->bounds[0] >= draw->bounds[2] || draw->bounds[1] >= draw->bounds[3]) return;
+   draw->mode = mode;
+   draw->paint = paint;
+   draw->first = sw->nverts;
+   draw->count = nverts;
+   sw->nverts += nverts;
+   sw->ndraws++;
+}
+
+static void swnvg__texel (const SWNVGtexture * tex, int x, int y, float * out)
+{
+   const unsigned char * p;
+   if (tex->flags & NVG_IMAGE_REPEATX)
+      x = ((x % tex->width) + tex->width) % tex->width;
+   else
+      x = x < 0 ? 0 : (x >= tex->width ? tex->width - 1 : x);
+   if (tex->flags & NVG_IMAGE_REPEATY)
+      y = ((y % tex->height) + tex->height) % tex->height;
+   else
+      y = y < 0 ? 0 : (y >= tex->height ? tex->height - 1 : y);
+   if (tex->type == NVG_TEXTURE_RGBA)
+   {
+      p = tex->data + ((size_t)y * tex->width + x) * 4;
+      out[0] = p[0] * (1.0f / 255.0f);
+      out[1] = p[1] * (1.0f / 255.0f);
+      out[2] = p[2] * (1.0f / 255.0f);
+      out[3] = p[3] * (1.0f / 255.0f);
+   }
+   else
+      out[0] = out[1] = out[2] = out[3] = tex->data[(size_t)y * tex->width + x] * (1.0f / 255.0f);
+}
+
+// Bilinear sample at u,v in [0,1], alpha textures in all channels, white without a texture.
+static void swnvg__sample (const SWNVGtexture * tex, float u, float v, float * out)
+{
+   float x, y, fx, fy, t[4][4];
+   int x0, y0, i;
+   if (tex == NULL)
+   {
+      out[0] = out[1] = out[2] = out[3] = 1.0f;
+      return;
+   }
+   x = u * tex->width - 0.5f;
+   y = v * tex->height - 0.5f;
+   x0 = (int)floorf (x);
+   y0 = (int)floorf (y);
+   fx = x - x0;
+   fy = y - y0;
+   swnvg__texel (tex, x0, y0, t[0]);
+   swnvg__texel (tex, x0 + 1, y0, t[1]);
+   swnvg__texel (tex, x0, y0 + 1, t[2]);
+   swnvg__texel (tex, x0 + 1, y0 + 1, t[3]);
+   for (i = 0; i < 4; i++)
+   {
+      float top = t[0][i] + (t[1][i] - t[0][i]) * fx;
+      float bottom = t[2][i] + (t[3][i] - t[2][i]) * fx;
+      out[i] = top + (bottom - top) * fy;
+   }
+}
+
+static float swnvg__sdroundrect (float x, float y, float ex, float ey, float rad)
+{
+   float dx = fabsf (x) - (ex - rad), dy = fabsf (y) - (ey - rad);
+   float mx = dx > 0.0f ? dx : 0.0f, my = dy > 0.0f ? dy : 0.0f;
+   float inside = dx > dy ? dx : dy;
+   return (inside < 0.0f ? inside : 0.0f) + sqrtf (mx * mx + my * my) - rad;
+}
+
+// The fragment shader of nanovg_vk.frag at fpos fx,fy and ftcoord u,v. Writes the premultiplied color
+// to out and returns the alpha of the fringe or shape, which the caller tests against strokeThr.
+static float swnvg__shade (const SWNVGpaint * p, float fx, float fy, float u, float v, float * out)
+{
+   float strokeAlpha = 1.0f, scissor, sx, sy, px, py, t, d, color[4];
+   int i;
+   if (p->edgeAA)
+      strokeAlpha = swnvg__clampf ((1.0f - fabsf (u * 2.0f - 1.0f)) * p->strokeMult, 0.0f, 1.0f) *
+                    swnvg__clampf (v, 0.0f, 1.0f);
+   if (p->solid)
+   {
+      for (i = 0; i < 4; i++)
+         out[i] = p->innerCol[i] * strokeAlpha;
+      return strokeAlpha;
+   }
+   if (p->shape[3] != 0.0f)
+   {
+      float c = swnvg__clampf (0.5f - swnvg__sdroundrect (u, v, p->shape[0], p->shape[1], p->shape[2]) * fabsf (p->shape[3]),
+                               0.0f, 1.0f);
+      strokeAlpha = p->shape[3] < 0.0f ? 1.0f - c : c;
+   }
+   sx = fabsf (p->scissorMat[0] * fx + p->scissorMat[2] * fy + p->scissorMat[4]) - p->scissorExt[0];
+   sy = fabsf (p->scissorMat[1] * fx + p->scissorMat[3] * fy + p->scissorMat[5]) - p->scissorExt[1];
+   scissor = swnvg__clampf (0.5f - sx * p->scissorScale[0], 0.0f, 1.0f) * swnvg__clampf (0.5f - sy * p->scissorScale[1], 0.0f, 1.0f);
+   px = p->paintMat[0] * fx + p->paintMat[2] * fy + p->paintMat[4];
+   py = p->paintMat[1] * fx + p->paintMat[3] * fy + p->paintMat[5];
+   switch (p->type)
+   {
+      case SWNVG_SHADER_FILLGRAD:
+         d = swnvg__clampf ((swnvg__sdroundrect (px, py, p->extent[0], p->extent[1], p->radius) + p->feather * 0.5f) / p->feather,
+                            0.0f, 1.0f);
+         for (i = 0; i < 4; i++)
+            color[i] = p->innerCol[i] + (p->outerCol[i] - p->innerCol[i]) * d;
+         break;
+      case SWNVG_SHADER_FILLIMG:
+      case SWNVG_SHADER_IMG:
+         if (p->type == SWNVG_SHADER_IMG)
+            swnvg__sample (p->tex, u, v, color);
+         else
+            swnvg__sample (p->tex, px / p->extent[0], py / p->extent[1], color);
+         if (p->texType == 1)
+         {
+            color[0] *= color[3];
+            color[1] *= color[3];
+            color[2] *= color[3];
+         }
+         for (i = 0; i < 4; i++)
+            color[i] *= p->innerCol[i];
+         if (p->type == SWNVG_SHADER_IMG)
+            strokeAlpha = 1.0f;
+         break;
+      default:
+         if (p->texType == NVG_RAMP_LINEAR)
+            t = px;
+         else if (p->texType == NVG_RAMP_RADIAL)
+            t = (sqrtf (px * px + py * py) - p->radius) / p->feather;
+         else
+         {
+            t = atan2f (py, px) * 0.15915494f;
+            t -= floorf (t);
+         }
+         t = swnvg__clampf (t, 0.0f, 1.0f);
+         swnvg__sample (p->tex, p->texRect[0] + (p->texRect[2] - p->texRect[0]) * t, p->texRect[1], color);
+         for (i = 0; i < 4; i++)
+            color[i] *= p->innerCol[i];
+         break;
+   }
+   for (i = 0; i < 4; i++)
+      out[i] = color[i] * strokeAlpha * scissor;
+   return strokeAlpha;
+}
+
+// Source over blending of n premultiplied colors onto dst.
+static void swnvg__blendSpan (unsigned char * dst, const float * src, int n)
+{
+   int i;
+#ifdef __SSE2__
+   const __m128 scale = _mm_set1_ps (255.0f), one = _mm_set1_ps (1.0f), half = _mm_set1_ps (0.5f);
+   const __m128i zero = _mm_setzero_si128();
+   for (i = 0; i < n; i++, dst += 4, src += 4)
+   {
+      __m128 s, sa, d;
+      __m128i di;
+      int pixel;
+      if (src[3] <= 0.0f) continue;
+      s = _mm_loadu_ps (src);
+      sa = _mm_shuffle_ps (s, s, _MM_SHUFFLE (3, 3, 3, 3));
+      memcpy (&pixel, dst, 4);
+      di = _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (pixel), zero), zero);
+      d = _mm_cvtepi32_ps (di);
+      d = _mm_add_ps (_mm_add_ps (_mm_mul_ps (s, scale), _mm_mul_ps (d, _mm_sub_ps (one, sa))), half);
+      di = _mm_cvttps_epi32 (d);
+      di = _mm_packs_epi32 (di, di);
+      di = _mm_packus_epi16 (di, di);
+      pixel = _mm_cvtsi128_si32 (di);
+      memcpy (dst, &pixel, 4);
+   }
+#else
+   for (i = 0; i < n; i++, dst += 4, src += 4)
+   {
+      float keep = 1.0f - src[3];
+      int c;
+      if (src[3] <= 0.0f) continue;
+      for (c = 0; c < 4; c++)
+      {
+         float value = src[c] * 255.0f + dst[c] * keep + 0.5f;
+         dst[c] = (unsigned char) (value > 255.0f ? 255.0f : value);
+      }
+   }
+#endif
+}
+
+// Shades the pixels x0 to x1 of row y of a triangle, whose barycentric weights of v[1] and v[2] at
+// x0 are wb and wc, going up by dwb and dwc a pixel.
+static void swnvg__span (SWNVGtile * tile, const SWNVGdraw * draw, const NVGvertex * const * v, int winding,
+                         int y, int x0, int x1, float wb, float wc, float dwb, float dwc)
+{
+   SWNVGcontext * sw = tile->sw;
+   const SWNVGpaint * paint = &sw->paints[draw->paint];
+   unsigned char * stencil = &tile->stencil[(y - tile->y0) * NANOVG_SW_TILE + x0 - tile->x0];
+   float * color = tile->span;
+   float invRatio = 1.0f / sw->pixelRatio, fy = (y + 0.5f) * invRatio;
+   int n = x1 - x0, i;
+   if (draw->mode == SWNVG_FILL_STENCIL)
+   {
+      for (i = 0; i < n; i++)
+         stencil[i] = (unsigned char) (stencil[i] + winding);
+      return;
+   }
+   if (draw->mode == SWNVG_STROKE_CLEAR)
+   {
+      memset (stencil, 0, (size_t)n);
+      return;
+   }
+   for (i = 0; i < n; i++, wb += dwb, wc += dwc, color += 4)
+   {
+      float u = v[0]->u + (v[1]->u - v[0]->u) * wb + (v[2]->u - v[0]->u) * wc;
+      float t = v[0]->v + (v[1]->v - v[0]->v) * wb + (v[2]->v - v[0]->v) * wc;
+      int pass = 1;
+      if (draw->mode == SWNVG_FILL_AA || draw->mode == SWNVG_STROKE_DRAW)
+         pass = stencil[i] == 0;
+      else if (draw->mode == SWNVG_FILL_COVER)
+      {
+         pass = stencil[i] != 0;
+         stencil[i] = 0;
+      }
+      if (pass && (swnvg__shade (paint, (x0 + i + 0.5f) * invRatio, fy, u, t, color) >= paint->strokeThr ||
+                   !paint->edgeAA))
+      {
+         if (draw->mode == SWNVG_STROKE_DRAW)
+            stencil[i]++;
+         continue;
+      }
+      color[0] = color[1] = color[2] = color[3] = 0.0f;
+   }
+   swnvg__blendSpan (sw->pixels + (size_t)y * sw->stride + (size_t)x0 * 4, tile->span, n);
+}
+
+static long long swnvg__fixed (float v)
+{
+   return (long long)floorf (v * (1 << NANOVG_SW_SUBPIXEL) + 0.5f);
+}
+
+// Rasterizes a triangle into the tile, covering the pixels whose center is inside. The edge functions
+// are exact on the snapped vertices and pixels on an edge go to the triangle it is a top or left
+// edge of, so triangles sharing an edge never both cover a pixel, nor leave one out.
+static void swnvg__triangle (SWNVGtile * tile, const SWNVGdraw * draw, const NVGvertex * a, const NVGvertex * b,
+                             const NVGvertex * c)
+{
+   const int one = 1 << NANOVG_SW_SUBPIXEL;
+   const NVGvertex * v[3];
+   long long px[3], py[3], e[3], dx[3], dy[3], bias[3], area, minx, miny, maxx, maxy;
+   int i, x, y, x0, y0, x1, y1, winding = 1;
+   float invArea;
+   v[0] = a;
+   v[1] = b;
+   v[2] = c;
+   for (i = 0; i < 3; i++)
+   {
+      px[i] = swnvg__fixed (v[i]->x);
+      py[i] = swnvg__fixed (v[i]->y);
+   }
+   area = (px[1] - px[0]) * (py[2] - py[0]) - (py[1] - py[0]) * (px[2] - px[0]);
+   if (area == 0) return;
+   if (area < 0)
+   {
+      long long tx = px[1], ty = py[1];
+      px[1] = px[2];
+      py[1] = py[2];
+      px[2] = tx;
+      py[2] = ty;
+      v[1] = c;
+      v[2] = b;
+      area = -area;
+      winding = -1;
+   }
+   minx = maxx = px[0];
+   miny = maxy = py[0];
+   for (i = 1; i < 3; i++)
+   {
+      minx = px[i] < minx ? px[i] : minx;
+      miny = py[i] < miny ? py[i] : miny;
+      maxx = px[i] > maxx ? px[i] : maxx;
+      maxy = py[i] > maxy ? py[i] : maxy;
+   }
+   x0 = swnvg__maxi ((int)floor ((double)minx / one), tile->x0);
+   y0 = swnvg__maxi ((int)floor ((double)miny / one), tile->y0);
+   x1 = swnvg__mini ((int)floor ((double)maxx / one) + 1, tile->x1);
+   y1 = swnvg__mini ((int)floor ((double)maxy / one) + 1, tile->y1);
+   if (x0 >= x1 || y0 >= y1) return;
+   // Edge i goes from vertex i + 1 to i + 2, its function at a pixel is the weight of vertex i.
+   for (i = 0; i < 3; i++)
+   {
+      int p = (i + 1) % 3, q = (i + 2) % 3;
+      long long ex = px[q] - px[p], ey = py[q] - py[p];
+      e[i] = ex * ((long long)y0 * one + one / 2 - py[p]) - ey * ((long long)x0 * one + one / 2 - px[p]);
+      dx[i] = -ey * one;
+      dy[i] = ex * one;
+      bias[i] = ey > 0 || (ey == 0 && ex < 0) ? 1 : 0;
+   }
+   invArea = 1.0f / (float)area;
+   for (y = y0; y < y1; y++)
+   {
+      long long w0 = e[0] + bias[0], w1 = e[1] + bias[1], w2 = e[2] + bias[2];
+      int sx = -1, ex = x1;
+      for (x = x0; x < x1; x++, w0 += dx[0], w1 += dx[1], w2 += dx[2])
+      {
+         if (w0 > 0 && w1 > 0 && w2 > 0)
+         {
+            if (sx < 0) sx = x;
+         }
+         else if (sx >= 0)
+         {
+            ex = x;
+            break;
+         }
+      }
+      if (sx >= 0)
+         swnvg__span (tile, draw, v, winding, y, sx, ex,
+                      (float) (e[1] + (sx - x0) * dx[1]) * invArea, (float) (e[2] + (sx - x0) * dx[2]) * invArea,
+                      (float)dx[1] * invArea, (float)dx[2] * invArea);
+      for (i = 0; i < 3; i++)
+         e[i] += dy[i];
+   }
+}
+
+static void swnvg__drawTile (SWNVGtile * tile, const SWNVGdraw * draw)
+{
+   const NVGvertex * verts = &tile->sw->verts[draw->first];
+   int i;
+   switch (draw->mode)
+   {
+      case SWNVG_FILL_STENCIL:
+      case SWNVG_FAN:
+         for (i = 2; i < draw->count; i++)
+            swnvg__triangle (tile, draw, &verts[0], &verts[i - 1], &verts[i]);
+         break;
+      case SWNVG_FILL_COVER:
+      case SWNVG_LIST:
+         for (i = 2; i < draw->count; i += 3)
+            swnvg__triangle (tile, draw, &verts[i - 2], &verts[i - 1], &verts[i]);
+         break;
+      default:
+         for (i = 2; i < draw->count; i++)
+            swnvg__triangle (tile, draw, &verts[i - 2], &verts[i - 1], &verts[i]);
+         break;
+   }
+}
+
+static void swnvg__tileTask (void * arg, int index)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)arg;
+   SWNVGtile tile;
+   int i;
+   tile.sw = sw;
+   tile.x0 = (index % sw->tilesX) * NANOVG_SW_TILE;
+   tile.y0 = (index / sw->tilesX) * NANOVG_SW_TILE;
+   tile.x1 = swnvg__mini (tile.x0 + NANOVG_SW_TILE, sw->width);
+   tile.y1 = swnvg__mini (tile.y0 + NANOVG_SW_TILE, sw->height);
+   memset (tile.stencil, 0, sizeof (tile.stencil));
+   for (i = 0; i < sw->ndraws; i++)
+   {
+      const SWNVGdraw * draw = &sw->draws[i];
+      if (draw->bounds[0] < tile.x1 && draw->bounds[2] > tile.x0 && draw->bounds[1] < tile.y1 && draw->bounds[3] > tile.y0)
+         swnvg__drawTile (&tile, draw);
+   }
+}
+
+static void swnvg__renderViewport (void * uptr, int width, int height, float devicePixelRatio)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   NVG_NOTUSED (width);
+   NVG_NOTUSED (height);
+   sw->pixelRatio = devicePixelRatio > 0.0f ? devicePixelRatio : 1.0f;
+}
+
+static void swnvg__renderCancel (void * uptr)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   sw->ndraws = 0;
+   sw->npaints = 0;
+   sw->nverts = 0;
+}
+
+static void swnvg__renderFlush (void * uptr)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   int i, ntiles;
+   if (sw->pixels != NULL && sw->ndraws > 0)
+   {
+      // Images may have been deleted or recreated since the calls were made.
+      for (i = 0; i < sw->npaints; i++)
+         sw->paints[i].tex = swnvg__findTexture (sw, sw->paints[i].image);
+      sw->tilesX = (sw->width + NANOVG_SW_TILE - 1) / NANOVG_SW_TILE;
+      ntiles = sw->tilesX * ((sw->height + NANOVG_SW_TILE - 1) / NANOVG_SW_TILE);
+      if (sw->parallel != NULL)
+         sw->parallel (sw->parallelUser, swnvg__tileTask, sw, ntiles);
+      else
+         for (i = 0; i < ntiles; i++)
+            swnvg__tileTask (sw, i);
+   }
+   swnvg__renderCancel (uptr);
+}
+
+static void swnvg__renderFill (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
+                               const float * bounds, const NVGpath * paths, int npaths)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   NVGvertex quad[6];
+   int i, p;
+   if (npaths <= 0) return;
+   p = swnvg__addPaint (sw, paint, scissor, fringe, fringe, -1.0f);
+   if ((npaths == 1 && paths[0].convex) || paths[0].triangles)
+   {
+      for (i = 0; i < npaths; i++)
+         swnvg__addDraw (sw, paths[0].triangles ? SWNVG_LIST : SWNVG_FAN, p, paths[i].fill, paths[i].nfill);
+      for (i = 0; sw->edgeAA && i < npaths; i++)
+         swnvg__addDraw (sw, SWNVG_STRIP, p, paths[i].stroke, paths[i].nstroke);
+      return;
+   }
+   for (i = 0; i < npaths; i++)
+      swnvg__addDraw (sw, SWNVG_FILL_STENCIL, p, paths[i].fill, paths[i].nfill);
+   for (i = 0; sw->edgeAA && i < npaths; i++)
+      swnvg__addDraw (sw, SWNVG_FILL_AA, p, paths[i].stroke, paths[i].nstroke);
+   // Quad covering the bounds, drawn where the stencil was written.
+   quad[0].x = bounds[0]; quad[0].y = bounds[3];
+   quad[1].x = bounds[2]; quad[1].y = bounds[3];
+   quad[2].x = bounds[2]; quad[2].y = bounds[1];
+   quad[3].x = bounds[0]; quad[3].y = bounds[3];
+   quad[4].x = bounds[2]; quad[4].y = bounds[1];
+   quad[5].x = bounds[0]; quad[5].y = bounds[1];
+   for (i = 0; i < 6; i++)
+   {
+      quad[i].u = 0.5f;
+      quad[i].v = 1.0f;
+   }
+   swnvg__addDraw (sw, SWNVG_FILL_COVER, p, quad, 6);
+}
+
+// Whether a stroke looks the same without the stencil passes, see glnvg__strokeNeedsStencil().
+static int swnvg__strokeNeedsStencil (const NVGpaint * paint, const NVGpath * paths, int npaths)
+{
+   int i;
+   if (paint->image != 0 || paint->innerColor.a < 1.0f || paint->outerColor.a < 1.0f)
+      return 1;
+   for (i = 0; i < npaths; i++)
+   {
+      const NVGpath * path = &paths[i];
+      if (path->nbevel != 0 || !(path->count <= 2 || (path->closed && path->convex)))
+         return 1;
+   }
+   return 0;
+}
+
+static void swnvg__renderStroke (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
+                                 float strokeWidth, const NVGpath * paths, int npaths)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   int i, p, inner;
+   if (npaths <= 0) return;
+   p = swnvg__addPaint (sw, paint, scissor, strokeWidth, fringe, -1.0f);
+   if ((sw->flags & NVG_STENCIL_STROKES) && swnvg__strokeNeedsStencil (paint, paths, npaths))
+   {
+      // The inside of the stroke first, then its fringes around it, and the stencil cleared.
+      inner = swnvg__addPaint (sw, paint, scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f);
+      for (i = 0; i < npaths; i++)
+         swnvg__addDraw (sw, SWNVG_STROKE_DRAW, inner, paths[i].stroke, paths[i].nstroke);
+      for (i = 0; i < npaths; i++)
+         swnvg__addDraw (sw, SWNVG_FILL_AA, p, paths[i].stroke, paths[i].nstroke);
+      for (i = 0; i < npaths; i++)
+         swnvg__addDraw (sw, SWNVG_STROKE_CLEAR, p, paths[i].stroke, paths[i].nstroke);
+   }
+   else
+      for (i = 0; i < npaths; i++)
+         swnvg__addDraw (sw, SWNVG_STRIP, p, paths[i].stroke, paths[i].nstroke);
+}
+
+static void swnvg__renderTriangles (void * uptr, NVGpaint * paint, NVGscissor * scissor,
+                                    const NVGvertex * verts, int nverts)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   int p = swnvg__addPaint (sw, paint, scissor, 1.0f, 1.0f, -1.0f);
+   if (p < 0) return;
+   sw->paints[p].type = SWNVG_SHADER_IMG;
+   swnvg__addDraw (sw, SWNVG_LIST, p, verts, nverts);
+}
+
+static void swnvg__renderShape (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
+                                const float * shape, const NVGvertex * verts, int nverts)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   int p = swnvg__addPaint (sw, paint, scissor, fringe, fringe, -1.0f);
+   if (p < 0) return;
+   memcpy (sw->paints[p].shape, shape, sizeof (sw->paints[p].shape));
+   sw->paints[p].solid = 0;
+   swnvg__addDraw (sw, SWNVG_FAN, p, verts, nverts);
+}
+
+static int swnvg__renderEdgeAntiAlias (void * uptr, int enabled)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   sw->edgeAA = enabled && (sw->flags & NVG_ANTIALIAS) != 0;
+   return sw->edgeAA;
+}
+
+static void swnvg__renderDelete (void * uptr)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)uptr;
+   int i;
+   if (sw == NULL) return;
+   for (i = 0; i < sw->ntextures; i++)
+      free (sw->textures[i].data);
+   free (sw->textures);
+   free (sw->draws);
+   free (sw->paints);
+   free (sw->verts);
+   free (sw);
+}
+
+NVGcontext * nvgCreateSW (int flags)
+{
+   NVGparams params;
+   NVGcontext * ctx = NULL;
+   SWNVGcontext * sw = (SWNVGcontext *)malloc (sizeof (SWNVGcontext));
+   if (sw == NULL) goto error;
+   memset (sw, 0, sizeof (SWNVGcontext));
+   sw->pixelRatio = 1.0f;
+   memset (&params, 0, sizeof (params));
+   params.renderCreate = swnvg__renderCreate;
+   params.renderCreateTexture = swnvg__renderCreateTexture;
+   params.renderDeleteTexture = swnvg__renderDeleteTexture;
+   params.renderUpdateTexture = swnvg__renderUpdateTexture;
+   params.renderUpdateTextureRegion = swnvg__renderUpdateTextureRegion;
+   params.renderGetTextureSize = swnvg__renderGetTextureSize;
+   params.renderViewport = swnvg__renderViewport;
+   params.renderCancel = swnvg__renderCancel;
+   params.renderFlush = swnvg__renderFlush;
+   params.renderFill = swnvg__renderFill;
+   params.renderStroke = swnvg__renderStroke;
+   params.renderTriangles = swnvg__renderTriangles;
+   params.renderShape = swnvg__renderShape;
+   params.renderEdgeAntiAlias = swnvg__renderEdgeAntiAlias;
+   params.renderDelete = swnvg__renderDelete;
+   params.userPtr = sw;
+   params.triangleFills = 1;
+   params.edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
+   sw->flags = flags;
+   sw->edgeAA = (flags & NVG_ANTIALIAS) != 0;
+   ctx = nvgCreateInternal (&params);
+   if (ctx == NULL) goto error;
+   return ctx;
+error:
+   // 'sw' is freed by nvgDeleteInternal.
+   if (ctx != NULL) nvgDeleteInternal (ctx);
+   return NULL;
+}
+
+void nvgDeleteSW (NVGcontext * ctx)
+{
+   nvgDeleteInternal (ctx);
+}
+
+void nvgswSetFramebuffer (NVGcontext * ctx, unsigned char * pixels, int width, int height, int stride)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   sw->pixels = width > 0 && height > 0 ? pixels : NULL;
+   sw->width = width;
+   sw->height = height;
+   sw->stride = stride != 0 ? stride : width * 4;
+}
+
+void nvgswSetParallelCallback (NVGcontext * ctx, NVGparallelCallback callback, void * userPtr)
+{
+   SWNVGcontext * sw = (SWNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   sw->parallel = callback;
+   sw->parallelUser = userPtr;
+}
+
+#endif /* NANOVG_SW_IMPLEMENTATION */
@@ -0,0 +1,113 @@
+// Fragment shader of nanovg_vk.h, compiled to SPIR-V with e.g.
+//    glslc nanovg_vk.frag -o nanovg_vk.frag.spv
+// The paint type is a specialization constant, every pipeline is built for one of them.
+#version 450
+
+layout(constant_id = 0) const int PAINT_TYPE = 0;
+layout(constant_id = 1) const int EDGE_AA = 1;
+
+layout(std140, set = 0, binding = 0) uniform frag {
+	mat3 scissorMat;
+	mat3 paintMat;
+	vec4 innerCol;
+	vec4 outerCol;
+	vec2 scissorExt;
+	vec2 scissorScale;
+	vec2 extent;
+	float radius;
+	float feather;
+	float strokeMult;
+	float strokeThr;
+	int texType;
+	int type;
+	vec4 shape;
+	vec4 texRect;
+};
+layout(set = 1, binding = 0) uniform sampler2D tex;
+
+layout(location = 0) in vec2 ftcoord;
+layout(location = 1) in vec2 fpos;
+layout(location = 0) out vec4 outColor;
+
+float sdroundrect(vec2 pt, vec2 ext, float rad) {
+	vec2 ext2 = ext - vec2(rad,rad);
+	vec2 d = abs(pt) - ext2;
+	return min(max(d.x,d.y),0.0) + length(max(d,0.0)) - rad;
+}
+
+// Scissoring
+float scissorMask(vec2 p) {
+	vec2 sc = (abs((scissorMat * vec3(p,1.0)).xy) - scissorExt);
+	sc = vec2(0.5,0.5) - sc * scissorScale;
+	return clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);
+}
+
+// Analytic shape - ftcoord is the position relative to the center of a rounded rect.
+float shapeMask() {
+	float c = clamp(0.5 - sdroundrect(ftcoord, shape.xy, shape.z) * abs(shape.w), 0.0, 1.0);
+	return shape.w < 0.0 ? 1.0 - c : c;
+}
+
+// Stroke - from [0..1] to clipped pyramid, where the slope is 1px.
+float strokeMask() {
+	return min(1.0, (1.0-abs(ftcoord.x*2.0-1.0))*strokeMult) * min(1.0, ftcoord.y);
+}
+
+// Alpha glyph blurred by feather texels, extent is the texel size. 7x7 taps over two sigmas
+// either way, filtering fills in between them.
+float blurredGlyph(vec2 uv) {
+	vec2 dt = extent * max(feather * 0.57735, 0.5) * (2.0 / 3.0);
+	float sum = 0.0, wsum = 0.0;
+	for (int y = -3; y <= 3; y++) {
+		for (int x = -3; x <= 3; x++) {
+			float w = exp(-float(x*x + y*y) * (2.0 / 9.0));
+			sum += w * texture(tex, uv + vec2(float(x), float(y)) * dt).x;
+			wsum += w;
+		}
+	}
+	return sum / wsum;
+}
+
+void main(void) {
+	vec4 result;
+	float scissor = scissorMask(fpos);
+	float strokeAlpha = EDGE_AA != 0 ? strokeMask() : 1.0;
+	if (shape.w != 0.0) strokeAlpha = shapeMask();
+	if (PAINT_TYPE == 0) {			// Gradient
+		vec2 pt = (paintMat * vec3(fpos,1.0)).xy;
+		float d = clamp((sdroundrect(pt, extent, radius) + feather*0.5) / feather, 0.0, 1.0);
+		vec4 color = mix(innerCol,outerCol,d);
+		color *= strokeAlpha * scissor;
+		result = color;
+	} else if (PAINT_TYPE == 1) {		// Image
+		vec2 pt = (paintMat * vec3(fpos,1.0)).xy / extent;
+		vec4 color = texture(tex, pt);
+		if (texType == 1) color = vec4(color.xyz*color.w,color.w);
+		if (texType == 2) color = vec4(color.x);
+		color *= innerCol;
+		color *= strokeAlpha * scissor;
+		result = color;
+	} else if (PAINT_TYPE == 2) {		// Stencil fill
+		result = vec4(1,1,1,1);
+	} else if (PAINT_TYPE == 3) {		// Textured tris
+		vec4 color = texture(tex, ftcoord);
+		if (texType == 1) color = vec4(color.xyz*color.w,color.w);
+		if (texType == 2) color = vec4(color.x);
+		if (texType == 4) color = vec4(blurredGlyph(ftcoord));
+		color *= scissor;
+		result = color * innerCol;
+	} else {				// Multi-stop gradient
+		vec2 pt = (paintMat * vec3(fpos,1.0)).xy;
+		float t;
+		if (texType == 1) t = pt.x;
+		else if (texType == 2) t = (length(pt) - radius) / feather;
+		else t = fract(atan(pt.y, pt.x) * 0.15915494);
+		vec2 uv = vec2(mix(texRect.x, texRect.z, clamp(t, 0.0, 1.0)), texRect.y);
+		vec4 color = texture(tex, uv);
+		color *= innerCol;
+		color *= strokeAlpha * scissor;
+		result = color;
+	}
+	if (EDGE_AA != 0 && strokeAlpha < strokeThr) discard;
+	outColor = result;
+}
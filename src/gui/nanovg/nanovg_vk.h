@@ -0,0 +1,1676 @@
+//
+// Copyright (c) 2009-2013 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+#ifndef NANOVG_VK_H
+#define NANOVG_VK_H
+
+#include <vulkan/vulkan.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Vulkan back-end. Calls are turned into draws as they are submitted: vertices and uniforms go
+// straight into host visible buffers owned by the frame slot, which are reset when the slot comes
+// around again, and every draw uses one of the pipelines built up front for each stencil mode and
+// paint type. nvgEndFrame() freezes the draws of the slot, which are then recorded into command
+// buffers of the application with nvgvkRecordUploads() and nvgvkRecordDraws(), on any thread.
+//
+// A frame goes like this:
+//    nvgvkBeginFrame (vg, slot);		// after waiting on the fence of the slot's last submission
+//    nvgBeginFrame (vg, width, height, pixelRatio);
+//    ...
+//    nvgEndFrame (vg);
+//    // Maybe on a worker thread, which has to be done before nvgvkBeginFrame() of the same slot:
+//    nvgvkRecordUploads (vg, cmd);		// outside the render pass
+//    vkCmdBeginRenderPass (cmd, ...);
+//    nvgvkRecordDraws (vg, cmd);		// or into a secondary command buffer of the subpass
+//    vkCmdEndRenderPass (cmd);
+//
+// Layers, backdrops, plots and compressed images are not supported. Fills are drawn as triangle
+// fans, which the Vulkan portability subset lacks.
+
+// Create flags, with the values of nanovg_gl.h. Include that first when using both.
+#ifndef NANOVG_GL_H
+enum NVGcreateFlags
+{
+   // Flag indicating if geometry based anti-aliasing is used (may not be needed when using MSAA).
+   NVG_ANTIALIAS 		= 1 << 0,
+   // Flag indicating if strokes should be drawn using stencil buffer. The rendering will be a little
+   // slower, but path overlaps (i.e. self-intersecting or sharp turns) will be drawn just once.
+   NVG_STENCIL_STROKES	= 1 << 1,
+   // Flag indicating that additional debug checks are done.
+   NVG_DEBUG 			= 1 << 2,
+};
+#endif
+
+// Frame slots the back-end keeps buffers for, at most.
+#define NANOVG_VK_MAX_FRAMES 3
+
+struct NVGVkCreateInfo
+{
+   VkPhysicalDevice physicalDevice;
+   VkDevice device;
+   const VkAllocationCallbacks * allocator;	// may be NULL
+   VkPipelineCache pipelineCache;			// may be VK_NULL_HANDLE
+   // Render pass and subpass the draws are recorded in. Its depth stencil attachment needs a
+   // stencil aspect.
+   VkRenderPass renderPass;
+   uint32_t subpass;
+   VkSampleCountFlagBits samples;
+   // SPIR-V of nanovg_vk.vert and nanovg_vk.frag, only read by nvgCreateVk().
+   const uint32_t * vertCode;
+   size_t vertSize;					// in bytes
+   const uint32_t * fragCode;
+   size_t fragSize;
+   // Frame slots in flight, from 1 to NANOVG_VK_MAX_FRAMES.
+   int frames;
+};
+typedef struct NVGVkCreateInfo NVGVkCreateInfo;
+
+NVGcontext * nvgCreateVk (const NVGVkCreateInfo * info, int flags);
+// Delete with the GPU done with all frames, as after vkDeviceWaitIdle().
+void nvgDeleteVk (NVGcontext * ctx);
+
+// Starts using frame slot frame, in [0, frames), for the following frame. The GPU must be done with
+// the commands last recorded from the slot. Resets the buffers of the slot and destroys images
+// deleted long enough ago.
+void nvgvkBeginFrame (NVGcontext * ctx, int frame);
+
+// Records the image uploads of the frames ended since nvgvkBeginFrame() into cmd, outside a render
+// pass and before the draws. Only reads the frame slot, see above.
+void nvgvkRecordUploads (NVGcontext * ctx, VkCommandBuffer cmd);
+
+// Records the draws of the frames ended since nvgvkBeginFrame() into cmd, inside the subpass of
+// NVGVkCreateInfo. Sets the viewport and scissor to the frame size in pixels. Only reads the frame
+// slot, see above.
+void nvgvkRecordDraws (NVGcontext * ctx, VkCommandBuffer cmd);
+
+// Returns the number of draws recorded by nvgvkRecordDraws() for the current slot.
+int nvgvkDrawCount (NVGcontext * ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NANOVG_VK_H */
+
+#ifdef NANOVG_VK_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "nanovg.h"
+
+// Size of the buffers frames take vertices, uniforms and staged pixels from. A frame that needs
+// more gets another one, or a larger one for an image larger than that.
+#define NANOVG_VK_BLOCK_SIZE (1 << 20)
+// Descriptor sets per pool, pools are added as needed.
+#define NANOVG_VK_POOL_SETS 256
+
+// Stencil modes, each with its own topology and stencil state, see vknvg__createPipelines().
+enum VKNVGmode
+{
+   VKNVG_FILL_STENCIL,		// winding into the stencil, fan, no color
+   VKNVG_FILL_AA,			// where the stencil is 0, strip
+   VKNVG_FILL_COVER,		// where the stencil is not 0, clearing it, list
+   VKNVG_FAN,				// convex fills and shapes
+   VKNVG_STRIP,			// fringes and strokes
+   VKNVG_LIST,				// triangles
+   VKNVG_STROKE_DRAW,		// where the stencil is 0, incrementing it, strip
+   VKNVG_STROKE_CLEAR,		// clearing the stencil, strip, no color
+   VKNVG_MODES
+};
+
+// Paint types, passed to the fragment shader as a specialization constant.
+enum VKNVGshaderType
+{
+   VKNVG_SHADER_FILLGRAD,
+   VKNVG_SHADER_FILLIMG,
+   VKNVG_SHADER_SIMPLE,
+   VKNVG_SHADER_IMG,
+   VKNVG_SHADER_FILLRAMP,
+   VKNVG_SHADER_TYPES
+};
+
+// Layout of the uniform block of nanovg_vk.frag, std140.
+struct VKNVGfragUniforms
+{
+   float scissorMat[12]; // matrices are actually 3 vec4s
+   float paintMat[12];
+   struct NVGcolor innerCol;
+   struct NVGcolor outerCol;
+   float scissorExt[2];
+   float scissorScale[2];
+   float extent[2];
+   float radius;
+   float feather;
+   float strokeMult;
+   float strokeThr;
+   int texType;
+   int type;
+   float shape[4];
+   float texRect[4];
+};
+typedef struct VKNVGfragUniforms VKNVGfragUniforms;
+
+struct VKNVGtexture
+{
+   int id;
+   VkImage image;
+   VkDeviceMemory memory;
+   VkImageView view;
+   VkDescriptorSet set;
+   VkDescriptorPool pool;
+   int width, height;
+   int type;
+   int flags;
+   int levels;
+   int staged;			// an upload was staged, later ones keep the contents
+   int nextFree;		// index + 1 of the next free slot
+};
+typedef struct VKNVGtexture VKNVGtexture;
+
+// Image objects deleted while frames in flight may still sample them.
+struct VKNVGgarbage
+{
+   VkImage image;
+   VkDeviceMemory memory;
+   VkImageView view;
+   VkDescriptorSet set;
+   VkDescriptorPool pool;
+   int begins;			// nvgvkBeginFrame() count when deleted
+};
+typedef struct VKNVGgarbage VKNVGgarbage;
+
+// Texture update waiting for the next flush, its pixels packed in uploadData.
+struct VKNVGupload
+{
+   int image;
+   int x, y, w, h;
+   int offset;			// -1 clears the image
+};
+typedef struct VKNVGupload VKNVGupload;
+
+// Host visible buffer a frame allocates from front to back.
+struct VKNVGblock
+{
+   VkBuffer buffer;
+   VkDeviceMemory memory;
+   unsigned char * data;	// mapped for the life of the block
+   VkDeviceSize size;
+   VkDeviceSize used;
+   VkDescriptorSet uniformSet;	// the buffer as a dynamic uniform buffer
+};
+typedef struct VKNVGblock VKNVGblock;
+
+// Everything the recording functions need, resolved to handles so they don't look anything up.
+struct VKNVGdraw
+{
+   VkPipeline pipeline;
+   VkBuffer vertBuf;
+   uint32_t first;
+   uint32_t count;
+   VkDescriptorSet uniformSet;
+   uint32_t uniformOffset;
+   VkDescriptorSet imageSet;
+};
+typedef struct VKNVGdraw VKNVGdraw;
+
+struct VKNVGcopy
+{
+   VkImage image;
+   VkBuffer buffer;		// VK_NULL_HANDLE clears the image
+   VkDeviceSize offset;
+   int x, y, w, h;
+   int width, height;
+   int levels;			// mipmaps are rebuilt from level 0 after the copy when more than 1
+   int initial;			// the image has no contents yet
+};
+typedef struct VKNVGcopy VKNVGcopy;
+
+struct VKNVGframe
+{
+   VKNVGblock * blocks;
+   int nblocks;
+   int cblocks;
+   int block;			// first block with room
+   VKNVGdraw * draws;
+   int ndraws;
+   int cdraws;
+   int nflushed;		// draws of ended frames, the rest belong to the frame being built
+   VKNVGcopy * copies;
+   int ncopies;
+   int ccopies;
+   float view[2];
+   float pixelRatio;
+};
+typedef struct VKNVGframe VKNVGframe;
+
+struct VKNVGcontext
+{
+   NVGVkCreateInfo info;
+   int flags;
+   int edgeAA;
+   VkPhysicalDeviceMemoryProperties memoryProps;
+   VkDeviceSize uniformAlign;
+   int fragSize;
+   VkDescriptorSetLayout uniformLayout;
+   VkDescriptorSetLayout imageLayout;
+   VkPipelineLayout pipelineLayout;
+   VkPipeline pipelines[VKNVG_MODES][VKNVG_SHADER_TYPES];
+   VkSampler samplers[8];	// by repeat x, repeat y and mipmaps
+   VkDescriptorPool * pools;
+   int npools;
+   int cpools;
+   int mipmaps;			// both formats can be blitted with linear filtering
+   VKNVGtexture * textures;
+   int ntextures;
+   int ctextures;
+   int textureId;
+   int freeTextures;
+   int dummyTex;			// white pixel sampled by draws without an image
+   VKNVGgarbage * garbage;
+   int ngarbage;
+   int cgarbage;
+   VKNVGupload * uploads;
+   int nuploads;
+   int cuploads;
+   unsigned char * uploadData;
+   int nuploadData;
+   int cuploadData;
+   VKNVGframe frames[NANOVG_VK_MAX_FRAMES];
+   int frame;
+   int begins;
+};
+typedef struct VKNVGcontext VKNVGcontext;
+
+static int vknvg__maxi (int a, int b)
+{
+   return a > b ? a : b;
+}
+
+static int vknvg__mini (int a, int b)
+{
+   return a < b ? a : b;
+}
+
+static void vknvg__check (VKNVGcontext * vk, VkResult res, const char * str)
+{
+   if ((vk->flags & NVG_DEBUG) != 0 && res != VK_SUCCESS)
+      printf ("Error %d after %s\n", (int)res, str);
+}
+
+static int vknvg__memoryType (VKNVGcontext * vk, uint32_t bits, VkMemoryPropertyFlags props)
+{
+   uint32_t i;
+   for (i = 0; i < vk->memoryProps.memoryTypeCount; i++)
+      if ((bits & (1u << i)) != 0 && (vk->memoryProps.memoryTypes[i].propertyFlags & props) == props)
+         return (int)i;
+   return -1;
+}
+
+static int vknvg__allocMemory (VKNVGcontext * vk, VkMemoryRequirements * req, VkMemoryPropertyFlags props,
+                               VkDeviceMemory * memory)
+{
+   VkMemoryAllocateInfo alloc;
+   int type = vknvg__memoryType (vk, req->memoryTypeBits, props);
+   if (type < 0) return 0;
+   memset (&alloc, 0, sizeof (alloc));
+   alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+   alloc.allocationSize = req->size;
+   alloc.memoryTypeIndex = (uint32_t)type;
+   return vkAllocateMemory (vk->info.device, &alloc, vk->info.allocator, memory) == VK_SUCCESS;
+}
+
+// Allocates a descriptor set, adding a pool when the existing ones are full.
+static int vknvg__allocSet (VKNVGcontext * vk, VkDescriptorSetLayout layout, VkDescriptorSet * set,
+                            VkDescriptorPool * pool)
+{
+   VkDescriptorSetAllocateInfo alloc;
+   VkDescriptorPoolCreateInfo info;
+   VkDescriptorPoolSize sizes[2];
+   int i;
+   memset (&alloc, 0, sizeof (alloc));
+   alloc.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+   alloc.descriptorSetCount = 1;
+   alloc.pSetLayouts = &layout;
+   // The newest pool is the one most likely to have room.
+   for (i = vk->npools - 1; i >= 0; i--)
+   {
+      alloc.descriptorPool = vk->pools[i];
+      if (vkAllocateDescriptorSets (vk->info.device, &alloc, set) == VK_SUCCESS)
+      {
+         *pool = vk->pools[i];
+         return 1;
+      }
+   }
+   if (vk->npools + 1 > vk->cpools)
+   {
+      int cpools = vknvg__maxi (vk->npools + 1, 4) + vk->cpools / 2; // 1.5x Overallocate
+      VkDescriptorPool * pools = (VkDescriptorPool *)realloc (vk->pools, sizeof (VkDescriptorPool) * cpools);
+      if (pools == NULL) return 0;
+      vk->pools = pools;
+      vk->cpools = cpools;
+   }
+   sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+   sizes[0].descriptorCount = NANOVG_VK_POOL_SETS;
+   sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+   sizes[1].descriptorCount = NANOVG_VK_POOL_SETS;
+   memset (&info, 0, sizeof (info));
+   info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+   info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+   info.maxSets = NANOVG_VK_POOL_SETS;
+   info.poolSizeCount = 2;
+   info.pPoolSizes = sizes;
+   if (vkCreateDescriptorPool (vk->info.device, &info, vk->info.allocator, &vk->pools[vk->npools]) != VK_SUCCESS)
+      return 0;
+   alloc.descriptorPool = vk->pools[vk->npools++];
+   if (vkAllocateDescriptorSets (vk->info.device, &alloc, set) != VK_SUCCESS)
+      return 0;
+   *pool = alloc.descriptorPool;
+   return 1;
+}
+
+// Adds a block of at least size bytes to the frame and makes it the one allocated from.
+static int vknvg__addBlock (VKNVGcontext * vk, VKNVGframe * frame, VkDeviceSize size)
+{
+   VkBufferCreateInfo info;
+   VkMemoryRequirements req;
+   VkDescriptorBufferInfo bufferInfo;
+   VkWriteDescriptorSet write;
+   VkDescriptorPool pool;
+   VKNVGblock * block;
+   void * data = NULL;
+   if (frame->nblocks + 1 > frame->cblocks)
+   {
+      int cblocks = vknvg__maxi (frame->nblocks + 1, 4) + frame->cblocks / 2; // 1.5x Overallocate
+      VKNVGblock * blocks = (VKNVGblock *)realloc (frame->blocks, sizeof (VKNVGblock) * cblocks);
+      if (blocks == NULL) return 0;
+      frame->blocks = blocks;
+      frame->cblocks = cblocks;
+   }
+   block = &frame->blocks[frame->nblocks];
+   memset (block, 0, sizeof (*block));
+   memset (&info, 0, sizeof (info));
+   info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+   info.size = size;
+   info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+   info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+   if (vkCreateBuffer (vk->info.device, &info, vk->info.allocator, &block->buffer) != VK_SUCCESS)
+      return 0;
+   vkGetBufferMemoryRequirements (vk->info.device, block->buffer, &req);
+   if (!vknvg__allocMemory (vk, &req, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &block->memory) ||
+         vkBindBufferMemory (vk->info.device, block->buffer, block->memory, 0) != VK_SUCCESS ||
+         vkMapMemory (vk->info.device, block->memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS ||
+         !vknvg__allocSet (vk, vk->uniformLayout, &block->uniformSet, &pool))
+   {
+      if (block->memory != VK_NULL_HANDLE)
+         vkFreeMemory (vk->info.device, block->memory, vk->info.allocator);
+      vkDestroyBuffer (vk->info.device, block->buffer, vk->info.allocator);
+      return 0;
+   }
+   block->data = (unsigned char *)data;
+   block->size = size;
+   memset (&bufferInfo, 0, sizeof (bufferInfo));
+   bufferInfo.buffer = block->buffer;
+   bufferInfo.range = sizeof (VKNVGfragUniforms);
+   memset (&write, 0, sizeof (write));
+   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+   write.dstSet = block->uniformSet;
+   write.descriptorCount = 1;
+   write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+   write.pBufferInfo = &bufferInfo;
+   vkUpdateDescriptorSets (vk->info.device, 1, &write, 0, NULL);
+   frame->block = frame->nblocks++;
+   return 1;
+}
+
+// Returns room for bytes in a block of the current frame, at a multiple of align, a power of two.
+static unsigned char * vknvg__alloc (VKNVGcontext * vk, VkDeviceSize bytes, VkDeviceSize align, VKNVGblock ** ret,
+                                     VkDeviceSize * offset)
+{
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   VKNVGblock * block;
+   for (; frame->block < frame->nblocks; frame->block++)
+   {
+      block = &frame->blocks[frame->block];
+      *offset = (block->used + align - 1) & ~ (align - 1);
+      if (*offset + bytes <= block->size)
+         break;
+   }
+   if (frame->block == frame->nblocks)
+   {
+      if (!vknvg__addBlock (vk, frame, bytes > NANOVG_VK_BLOCK_SIZE ? bytes : NANOVG_VK_BLOCK_SIZE))
+         return NULL;
+      *offset = 0;
+   }
+   block = &frame->blocks[frame->block];
+   block->used = *offset + bytes;
+   *ret = block;
+   return block->data + *offset;
+}
+
+static void vknvg__destroyImage (VKNVGcontext * vk, VkImage image, VkDeviceMemory memory, VkImageView view,
+                                 VkDescriptorSet set, VkDescriptorPool pool)
+{
+   if (set != VK_NULL_HANDLE)
+      vkFreeDescriptorSets (vk->info.device, pool, 1, &set);
+   if (view != VK_NULL_HANDLE)
+      vkDestroyImageView (vk->info.device, view, vk->info.allocator);
+   if (image != VK_NULL_HANDLE)
+      vkDestroyImage (vk->info.device, image, vk->info.allocator);
+   if (memory != VK_NULL_HANDLE)
+      vkFreeMemory (vk->info.device, memory, vk->info.allocator);
+}
+
+// Destroys the images deleted before the frame slots in flight then were started.
+static void vknvg__collectGarbage (VKNVGcontext * vk, int all)
+{
+   int i, n = 0;
+   for (i = 0; i < vk->ngarbage; i++)
+   {
+      VKNVGgarbage * g = &vk->garbage[i];
+      if (all || vk->begins - g->begins >= vk->info.frames)
+         vknvg__destroyImage (vk, g->image, g->memory, g->view, g->set, g->pool);
+      else
+         vk->garbage[n++] = *g;
+   }
+   vk->ngarbage = n;
+}
+
+// Image handles hold the index + 1 of their slot in the low bits and a serial above them, see nanovg_gl.h.
+#define NANOVG_VK_SLOT_BITS 20
+#define NANOVG_VK_SLOT_MASK ((1 << NANOVG_VK_SLOT_BITS) - 1)
+#define NANOVG_VK_MAX_SERIAL ((1 << (31 - NANOVG_VK_SLOT_BITS)) - 1)
+
+static VKNVGtexture * vknvg__allocTexture (VKNVGcontext * vk)
+{
+   VKNVGtexture * tex = NULL;
+   if (vk->freeTextures != 0)
+   {
+      tex = &vk->textures[vk->freeTextures - 1];
+      vk->freeTextures = tex->nextFree;
+   }
+   else
+   {
+      if (vk->ntextures >= NANOVG_VK_SLOT_MASK) return NULL;
+      if (vk->ntextures + 1 > vk->ctextures)
+      {
+         VKNVGtexture * textures;
+         int ctextures = vknvg__maxi (vk->ntextures + 1, 4) +  vk->ctextures / 2; // 1.5x Overallocate
+         textures = (VKNVGtexture *)realloc (vk->textures, sizeof (VKNVGtexture) * ctextures);
+         if (textures == NULL) return NULL;
+         vk->textures = textures;
+         vk->ctextures = ctextures;
+      }
+      tex = &vk->textures[vk->ntextures++];
+   }
+   memset (tex, 0, sizeof (*tex));
+   vk->textureId = vk->textureId % NANOVG_VK_MAX_SERIAL + 1;
+   tex->id = (vk->textureId << NANOVG_VK_SLOT_BITS) | (int) (tex - vk->textures + 1);
+   return tex;
+}
+
+static VKNVGtexture * vknvg__findTexture (VKNVGcontext * vk, int id)
+{
+   int i = (id & NANOVG_VK_SLOT_MASK) - 1;
+   if (id <= 0 || i < 0 || i >= vk->ntextures || vk->textures[i].id != id)
+      return NULL;
+   return &vk->textures[i];
+}
+
+static int vknvg__deleteTexture (VKNVGcontext * vk, int id)
+{
+   VKNVGtexture * tex = vknvg__findTexture (vk, id);
+   VKNVGgarbage * g;
+   if (tex == NULL)
+      return 0;
+   if (vk->ngarbage + 1 > vk->cgarbage)
+   {
+      int cgarbage = vknvg__maxi (vk->ngarbage + 1, 16) + vk->cgarbage / 2; // 1.5x Overallocate
+      VKNVGgarbage * garbage = (VKNVGgarbage *)realloc (vk->garbage, sizeof (VKNVGgarbage) * cgarbage);
+      if (garbage == NULL) return 0;
+      vk->garbage = garbage;
+      vk->cgarbage = cgarbage;
+   }
+   g = &vk->garbage[vk->ngarbage++];
+   g->image = tex->image;
+   g->memory = tex->memory;
+   g->view = tex->view;
+   g->set = tex->set;
+   g->pool = tex->pool;
+   g->begins = vk->begins;
+   memset (tex, 0, sizeof (*tex));
+   tex->nextFree = vk->freeTextures;
+   vk->freeTextures = (int) (tex - vk->textures + 1);
+   return 1;
+}
+
+// Keeps a copy of a rect of pixels, rows rowBytes apart, until the next flush stages it. NULL data
+// clears the image.
+static int vknvg__queueUpload (VKNVGcontext * vk, VKNVGtexture * tex, int x, int y, int w, int h,
+                               const unsigned char * data, int rowBytes)
+{
+   int bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1, size = data != NULL ? w * h * bpp : 0, row;
+   VKNVGupload * upload;
+   if (vk->nuploads + 1 > vk->cuploads)
+   {
+      int cuploads = vknvg__maxi (vk->nuploads + 1, 16) + vk->cuploads / 2; // 1.5x Overallocate
+      VKNVGupload * uploads = (VKNVGupload *)realloc (vk->uploads, sizeof (VKNVGupload) * cuploads);
+      if (uploads == NULL) return 0;
+      vk->uploads = uploads;
+      vk->cuploads = cuploads;
+   }
+   if (vk->nuploadData + size > vk->cuploadData)
+   {
+      int cuploadData = vknvg__maxi (vk->nuploadData + size, 65536) + vk->cuploadData / 2; // 1.5x Overallocate
+      unsigned char * uploadData = (unsigned char *)realloc (vk->uploadData, cuploadData);
+      if (uploadData == NULL) return 0;
+      vk->uploadData = uploadData;
+      vk->cuploadData = cuploadData;
+   }
+   upload = &vk->uploads[vk->nuploads++];
+   upload->image = tex->id;
+   upload->x = x;
+   upload->y = y;
+   upload->w = w;
+   upload->h = h;
+   upload->offset = data != NULL ? vk->nuploadData : -1;
+   for (row = 0; data != NULL && row < h; row++)
+      memcpy (vk->uploadData + vk->nuploadData + row * w * bpp, data + (size_t)row * rowBytes, w * bpp);
+   vk->nuploadData += size;
+   return 1;
+}
+
+// Moves the queued uploads into the buffers of the current frame, as copies for nvgvkRecordUploads().
+static void vknvg__stageUploads (VKNVGcontext * vk)
+{
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   int i;
+   for (i = 0; i < vk->nuploads; i++)
+   {
+      VKNVGupload * upload = &vk->uploads[i];
+      VKNVGtexture * tex = vknvg__findTexture (vk, upload->image);
+      VKNVGcopy * copy;
+      VKNVGblock * block = NULL;
+      VkDeviceSize offset = 0;
+      if (tex == NULL) continue;
+      if (frame->ncopies + 1 > frame->ccopies)
+      {
+         int ccopies = vknvg__maxi (frame->ncopies + 1, 16) + frame->ccopies / 2; // 1.5x Overallocate
+         VKNVGcopy * copies = (VKNVGcopy *)realloc (frame->copies, sizeof (VKNVGcopy) * ccopies);
+         if (copies == NULL) break;
+         frame->copies = copies;
+         frame->ccopies = ccopies;
+      }
+      if (upload->offset >= 0)
+      {
+         int size = upload->w * upload->h * (tex->type == NVG_TEXTURE_RGBA ? 4 : 1);
+         unsigned char * dst = vknvg__alloc (vk, size, 16, &block, &offset);
+         if (dst == NULL) break;
+         memcpy (dst, vk->uploadData + upload->offset, size);
+      }
+      copy = &frame->copies[frame->ncopies++];
+      copy->image = tex->image;
+      copy->buffer = block != NULL ? block->buffer : VK_NULL_HANDLE;
+      copy->offset = offset;
+      copy->x = upload->x;
+      copy->y = upload->y;
+      copy->w = upload->w;
+      copy->h = upload->h;
+      copy->width = tex->width;
+      copy->height = tex->height;
+      copy->levels = tex->levels;
+      copy->initial = !tex->staged;
+      tex->staged = 1;
+   }
+   vk->nuploads = 0;
+   vk->nuploadData = 0;
+}
+
+static VkShaderModule vknvg__createModule (VKNVGcontext * vk, const uint32_t * code, size_t size)
+{
+   VkShaderModuleCreateInfo info;
+   VkShaderModule module = VK_NULL_HANDLE;
+   memset (&info, 0, sizeof (info));
+   info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+   info.codeSize = size;
+   info.pCode = code;
+   vknvg__check (vk, vkCreateShaderModule (vk->info.device, &info, vk->info.allocator, &module), "create shader module");
+   return module;
+}
+
+// Builds a pipeline for every stencil mode and the paint types drawn with it: the passes that only
+// write the stencil use the simple type, the others every type but that.
+static int vknvg__createPipelines (VKNVGcontext * vk, VkShaderModule vert, VkShaderModule frag)
+{
+   VkPipelineShaderStageCreateInfo stages[2];
+   VkSpecializationMapEntry entries[2];
+   VkSpecializationInfo spec;
+   int constants[2];
+   VkVertexInputBindingDescription binding;
+   VkVertexInputAttributeDescription attribs[2];
+   VkPipelineVertexInputStateCreateInfo vertexInput;
+   VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+   VkPipelineViewportStateCreateInfo viewport;
+   VkPipelineRasterizationStateCreateInfo raster;
+   VkPipelineMultisampleStateCreateInfo multisample;
+   VkPipelineDepthStencilStateCreateInfo depthStencil;
+   VkPipelineColorBlendAttachmentState blendAttachment;
+   VkPipelineColorBlendStateCreateInfo blend;
+   VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+   VkPipelineDynamicStateCreateInfo dynamic;
+   VkGraphicsPipelineCreateInfo info;
+   int mode, type;
+   memset (stages, 0, sizeof (stages));
+   stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+   stages[0].module = vert;
+   stages[0].pName = "main";
+   stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+   stages[1].module = frag;
+   stages[1].pName = "main";
+   stages[1].pSpecializationInfo = &spec;
+   entries[0].constantID = 0;
+   entries[0].offset = 0;
+   entries[0].size = sizeof (int);
+   entries[1].constantID = 1;
+   entries[1].offset = sizeof (int);
+   entries[1].size = sizeof (int);
+   spec.mapEntryCount = 2;
+   spec.pMapEntries = entries;
+   spec.dataSize = sizeof (constants);
+   spec.pData = constants;
+   binding.binding = 0;
+   binding.stride = sizeof (NVGvertex);
+   binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+   attribs[0].location = 0;
+   attribs[0].binding = 0;
+   attribs[0].format = VK_FORMAT_R32G32_SFLOAT;
+   attribs[0].offset = 0;
+   attribs[1].location = 1;
+   attribs[1].binding = 0;
+   attribs[1].format = VK_FORMAT_R32G32_SFLOAT;
+   attribs[1].offset = 2 * sizeof (float);
+   memset (&vertexInput, 0, sizeof (vertexInput));
+   vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+   vertexInput.vertexBindingDescriptionCount = 1;
+   vertexInput.pVertexBindingDescriptions = &binding;
+   vertexInput.vertexAttributeDescriptionCount = 2;
+   vertexInput.pVertexAttributeDescriptions = attribs;
+   memset (&inputAssembly, 0, sizeof (inputAssembly));
+   inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+   memset (&viewport, 0, sizeof (viewport));
+   viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+   viewport.viewportCount = 1;
+   viewport.scissorCount = 1;
+   memset (&raster, 0, sizeof (raster));
+   raster.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+   raster.polygonMode = VK_POLYGON_MODE_FILL;
+   raster.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+   raster.lineWidth = 1.0f;
+   memset (&multisample, 0, sizeof (multisample));
+   multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+   multisample.rasterizationSamples = vk->info.samples != 0 ? vk->info.samples : VK_SAMPLE_COUNT_1_BIT;
+   memset (&depthStencil, 0, sizeof (depthStencil));
+   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+   // Premultiplied alpha, as glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+   memset (&blendAttachment, 0, sizeof (blendAttachment));
+   blendAttachment.blendEnable = VK_TRUE;
+   blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+   blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+   blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+   blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+   blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+   blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+   memset (&blend, 0, sizeof (blend));
+   blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+   blend.attachmentCount = 1;
+   blend.pAttachments = &blendAttachment;
+   memset (&dynamic, 0, sizeof (dynamic));
+   dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+   dynamic.dynamicStateCount = 2;
+   dynamic.pDynamicStates = dynamicStates;
+   memset (&info, 0, sizeof (info));
+   info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+   info.stageCount = 2;
+   info.pStages = stages;
+   info.pVertexInputState = &vertexInput;
+   info.pInputAssemblyState = &inputAssembly;
+   info.pViewportState = &viewport;
+   info.pRasterizationState = &raster;
+   info.pMultisampleState = &multisample;
+   info.pDepthStencilState = &depthStencil;
+   info.pColorBlendState = &blend;
+   info.pDynamicState = &dynamic;
+   info.layout = vk->pipelineLayout;
+   info.renderPass = vk->info.renderPass;
+   info.subpass = vk->info.subpass;
+   for (mode = 0; mode < VKNVG_MODES; mode++)
+   {
+      VkStencilOpState * front = &depthStencil.front, * back = &depthStencil.back;
+      int colorless = mode == VKNVG_FILL_STENCIL || mode == VKNVG_STROKE_CLEAR;
+      if (mode == VKNVG_FILL_STENCIL || mode == VKNVG_FAN)
+         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN;
+      else if (mode == VKNVG_FILL_COVER || mode == VKNVG_LIST)
+         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+      else
+         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+      raster.cullMode = mode == VKNVG_FILL_STENCIL ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+      blendAttachment.colorWriteMask = colorless ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                       VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+      memset (front, 0, sizeof (*front));
+      front->failOp = VK_STENCIL_OP_KEEP;
+      front->passOp = VK_STENCIL_OP_KEEP;
+      front->depthFailOp = VK_STENCIL_OP_KEEP;
+      front->compareOp = VK_COMPARE_OP_ALWAYS;
+      front->compareMask = 0xff;
+      front->writeMask = 0xff;
+      front->reference = 0;
+      depthStencil.stencilTestEnable = mode != VKNVG_FAN && mode != VKNVG_STRIP && mode != VKNVG_LIST;
+      if (mode == VKNVG_FILL_AA)
+         front->compareOp = VK_COMPARE_OP_EQUAL;
+      else if (mode == VKNVG_FILL_COVER)
+      {
+         front->compareOp = VK_COMPARE_OP_NOT_EQUAL;
+         front->failOp = front->passOp = front->depthFailOp = VK_STENCIL_OP_ZERO;
+      }
+      else if (mode == VKNVG_STROKE_DRAW)
+      {
+         front->compareOp = VK_COMPARE_OP_EQUAL;
+         front->passOp = VK_STENCIL_OP_INCREMENT_AND_CLAMP;
+      }
+      else if (mode == VKNVG_STROKE_CLEAR)
+         front->failOp = front->passOp = front->depthFailOp = VK_STENCIL_OP_ZERO;
+      *back = *front;
+      if (mode == VKNVG_FILL_STENCIL)
+      {
+         front->passOp = VK_STENCIL_OP_INCREMENT_AND_WRAP;
+         back->passOp = VK_STENCIL_OP_DECREMENT_AND_WRAP;
+      }
+      for (type = 0; type < VKNVG_SHADER_TYPES; type++)
+      {
+         if ((type == VKNVG_SHADER_SIMPLE) != colorless)
+            continue;
+         constants[0] = type;
+         constants[1] = vk->edgeAA;
+         if (vkCreateGraphicsPipelines (vk->info.device, vk->info.pipelineCache, 1, &info, vk->info.allocator,
+                                        &vk->pipelines[mode][type]) != VK_SUCCESS)
+            return 0;
+      }
+   }
+   return 1;
+}
+
+static int vknvg__renderCreateTexture (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data);
+
+static int vknvg__renderCreate (void * uptr)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VkPhysicalDeviceProperties props;
+   VkFormatProperties formatProps[2];
+   VkDescriptorSetLayoutBinding binding;
+   VkDescriptorSetLayoutCreateInfo layoutInfo;
+   VkDescriptorSetLayout setLayouts[2];
+   VkPushConstantRange push;
+   VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+   VkSamplerCreateInfo samplerInfo;
+   VkShaderModule vert, frag;
+   const VkFormatFeatureFlags blit = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                     VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+   static const unsigned char white[4] = { 255, 255, 255, 255 };
+   int i, ok;
+   vkGetPhysicalDeviceProperties (vk->info.physicalDevice, &props);
+   vkGetPhysicalDeviceMemoryProperties (vk->info.physicalDevice, &vk->memoryProps);
+   vkGetPhysicalDeviceFormatProperties (vk->info.physicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProps[0]);
+   vkGetPhysicalDeviceFormatProperties (vk->info.physicalDevice, VK_FORMAT_R8_UNORM, &formatProps[1]);
+   vk->mipmaps = (formatProps[0].optimalTilingFeatures & blit) == blit && (formatProps[1].optimalTilingFeatures & blit) == blit;
+   vk->uniformAlign = props.limits.minUniformBufferOffsetAlignment > 16 ? props.limits.minUniformBufferOffsetAlignment : 16;
+   vk->fragSize = (int) ((sizeof (VKNVGfragUniforms) + vk->uniformAlign - 1) & ~ (vk->uniformAlign - 1));
+   // Set 0 is the uniform block of a call, at a dynamic offset, set 1 its image.
+   memset (&binding, 0, sizeof (binding));
+   binding.binding = 0;
+   binding.descriptorCount = 1;
+   binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+   memset (&layoutInfo, 0, sizeof (layoutInfo));
+   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+   layoutInfo.bindingCount = 1;
+   layoutInfo.pBindings = &binding;
+   binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+   if (vkCreateDescriptorSetLayout (vk->info.device, &layoutInfo, vk->info.allocator, &vk->uniformLayout) != VK_SUCCESS)
+      return 0;
+   binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+   if (vkCreateDescriptorSetLayout (vk->info.device, &layoutInfo, vk->info.allocator, &vk->imageLayout) != VK_SUCCESS)
+      return 0;
+   setLayouts[0] = vk->uniformLayout;
+   setLayouts[1] = vk->imageLayout;
+   push.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+   push.offset = 0;
+   push.size = 2 * sizeof (float);
+   memset (&pipelineLayoutInfo, 0, sizeof (pipelineLayoutInfo));
+   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+   pipelineLayoutInfo.setLayoutCount = 2;
+   pipelineLayoutInfo.pSetLayouts = setLayouts;
+   pipelineLayoutInfo.pushConstantRangeCount = 1;
+   pipelineLayoutInfo.pPushConstantRanges = &push;
+   if (vkCreatePipelineLayout (vk->info.device, &pipelineLayoutInfo, vk->info.allocator, &vk->pipelineLayout) != VK_SUCCESS)
+      return 0;
+   vert = vknvg__createModule (vk, vk->info.vertCode, vk->info.vertSize);
+   frag = vknvg__createModule (vk, vk->info.fragCode, vk->info.fragSize);
+   ok = vert != VK_NULL_HANDLE && frag != VK_NULL_HANDLE && vknvg__createPipelines (vk, vert, frag);
+   if (vert != VK_NULL_HANDLE)
+      vkDestroyShaderModule (vk->info.device, vert, vk->info.allocator);
+   if (frag != VK_NULL_HANDLE)
+      vkDestroyShaderModule (vk->info.device, frag, vk->info.allocator);
+   vk->info.vertCode = vk->info.fragCode = NULL;
+   if (!ok)
+   {
+      printf ("Could not create the NanoVG pipelines\n");
+      return 0;
+   }
+   memset (&samplerInfo, 0, sizeof (samplerInfo));
+   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+   samplerInfo.magFilter = VK_FILTER_LINEAR;
+   samplerInfo.minFilter = VK_FILTER_LINEAR;
+   samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+   for (i = 0; i < 8; i++)
+   {
+      samplerInfo.addressModeU = (i & 1) ? VK_SAMPLER_ADDRESS_MODE_REPEAT : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+      samplerInfo.addressModeV = (i & 2) ? VK_SAMPLER_ADDRESS_MODE_REPEAT : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+      samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+      samplerInfo.maxLod = (i & 4) ? VK_LOD_CLAMP_NONE : 0.0f;
+      if (vkCreateSampler (vk->info.device, &samplerInfo, vk->info.allocator, &vk->samplers[i]) != VK_SUCCESS)
+         return 0;
+   }
+   vk->dummyTex = vknvg__renderCreateTexture (vk, NVG_TEXTURE_RGBA, 1, 1, 0, white);
+   return vk->dummyTex != 0;
+}
+
+static int vknvg__renderCreateTexture (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGtexture * tex;
+   VkImageCreateInfo info;
+   VkImageViewCreateInfo viewInfo;
+   VkMemoryRequirements req;
+   VkDescriptorImageInfo imageInfo;
+   VkWriteDescriptorSet write;
+   int levels = 1, id;
+   if (w <= 0 || h <= 0) return 0;
+   tex = vknvg__allocTexture (vk);
+   if (tex == NULL) return 0;
+   id = tex->id;
+   if ((imageFlags & NVG_IMAGE_GENERATE_MIPMAPS) && !vk->mipmaps)
+      imageFlags &= ~NVG_IMAGE_GENERATE_MIPMAPS;
+   if (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS)
+      while ((vknvg__maxi (w, h) >> levels) > 0)
+         levels++;
+   tex->width = w;
+   tex->height = h;
+   tex->type = type;
+   tex->flags = imageFlags;
+   tex->levels = levels;
+   memset (&info, 0, sizeof (info));
+   info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+   info.imageType = VK_IMAGE_TYPE_2D;
+   info.format = type == NVG_TEXTURE_RGBA ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8_UNORM;
+   info.extent.width = (uint32_t)w;
+   info.extent.height = (uint32_t)h;
+   info.extent.depth = 1;
+   info.mipLevels = (uint32_t)levels;
+   info.arrayLayers = 1;
+   info.samples = VK_SAMPLE_COUNT_1_BIT;
+   info.tiling = VK_IMAGE_TILING_OPTIMAL;
+   info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | (levels > 1 ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+   info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+   info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+   if (vkCreateImage (vk->info.device, &info, vk->info.allocator, &tex->image) != VK_SUCCESS)
+      goto error;
+   vkGetImageMemoryRequirements (vk->info.device, tex->image, &req);
+   if (!vknvg__allocMemory (vk, &req, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &tex->memory) ||
+         vkBindImageMemory (vk->info.device, tex->image, tex->memory, 0) != VK_SUCCESS)
+      goto error;
+   memset (&viewInfo, 0, sizeof (viewInfo));
+   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+   viewInfo.image = tex->image;
+   viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+   viewInfo.format = info.format;
+   viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+   viewInfo.subresourceRange.levelCount = (uint32_t)levels;
+   viewInfo.subresourceRange.layerCount = 1;
+   if (vkCreateImageView (vk->info.device, &viewInfo, vk->info.allocator, &tex->view) != VK_SUCCESS ||
+         !vknvg__allocSet (vk, vk->imageLayout, &tex->set, &tex->pool))
+      goto error;
+   memset (&imageInfo, 0, sizeof (imageInfo));
+   imageInfo.sampler = vk->samplers[((imageFlags & NVG_IMAGE_REPEATX) ? 1 : 0) | ((imageFlags & NVG_IMAGE_REPEATY) ? 2 : 0) |
+                                    (levels > 1 ? 4 : 0)];
+   imageInfo.imageView = tex->view;
+   imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+   memset (&write, 0, sizeof (write));
+   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+   write.dstSet = tex->set;
+   write.descriptorCount = 1;
+   write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+   write.pImageInfo = &imageInfo;
+   vkUpdateDescriptorSets (vk->info.device, 1, &write, 0, NULL);
+   // The image gets its contents, or is cleared, with the next flush, as all updates.
+   if (!vknvg__queueUpload (vk, tex, 0, 0, w, h, data, w * (type == NVG_TEXTURE_RGBA ? 4 : 1)))
+      goto error;
+   return id;
+error:
+   vknvg__deleteTexture (vk, id);
+   return 0;
+}
+
+static int vknvg__renderDeleteTexture (void * uptr, int image)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   return vknvg__deleteTexture (vk, image);
+}
+
+static int vknvg__renderUpdateTextureRegion (void * uptr, int image, int x, int y, int w, int h,
+                                             const unsigned char * data, int rowBytes)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGtexture * tex = vknvg__findTexture (vk, image);
+   int bpp;
+   if (tex == NULL) return 0;
+   bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+   if (rowBytes == 0)
+      rowBytes = w * bpp;
+   if (rowBytes < w * bpp) return 0;
+   // Clip to the image, moving data along.
+   if (x < 0)
+   {
+      data -= x * bpp;
+      w += x;
+      x = 0;
+   }
+   if (y < 0)
+   {
+      data -= (ptrdiff_t)y * rowBytes;
+      h += y;
+      y = 0;
+   }
+   w = vknvg__mini (w, tex->width - x);
+   h = vknvg__mini (h, tex->height - y);
+   if (w <= 0 || h <= 0) return 1;
+   return vknvg__queueUpload (vk, tex, x, y, w, h, data, rowBytes);
+}
+
+static int vknvg__renderUpdateTexture (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGtexture * tex = vknvg__findTexture (vk, image);
+   int bpp;
+   if (tex == NULL) return 0;
+   bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+   return vknvg__renderUpdateTextureRegion (uptr, image, x, y, w, h, data + ((size_t)y * tex->width + x) * bpp,
+                                            tex->width * bpp);
+}
+
+static int vknvg__renderGetTextureSize (void * uptr, int image, int * w, int * h)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGtexture * tex = vknvg__findTexture (vk, image);
+   if (tex == NULL) return 0;
+   *w = tex->width;
+   *h = tex->height;
+   return 1;
+}
+
+static void vknvg__xformToMat3x4 (float * m3, float * t)
+{
+   m3[0] = t[0];
+   m3[1] = t[1];
+   m3[2] = 0.0f;
+   m3[3] = 0.0f;
+   m3[4] = t[2];
+   m3[5] = t[3];
+   m3[6] = 0.0f;
+   m3[7] = 0.0f;
+   m3[8] = t[4];
+   m3[9] = t[5];
+   m3[10] = 1.0f;
+   m3[11] = 0.0f;
+}
+
+static NVGcolor vknvg__premulColor (NVGcolor c)
+{
+   c.r *= c.a;
+   c.g *= c.a;
+   c.b *= c.a;
+   return c;
+}
+
+// As glnvg__convertPaint(), without atlas pages and distance fields.
+static int vknvg__convertPaint (VKNVGcontext * vk, VKNVGfragUniforms * frag, NVGpaint * paint,
+                                NVGscissor * scissor, float width, float fringe, float strokeThr)
+{
+   VKNVGtexture * tex = NULL;
+   float invxform[6];
+   memset (frag, 0, sizeof (*frag));
+   frag->innerCol = vknvg__premulColor (paint->innerColor);
+   frag->outerCol = vknvg__premulColor (paint->outerColor);
+   if (scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f)
+   {
+      memset (frag->scissorMat, 0, sizeof (frag->scissorMat));
+      frag->scissorExt[0] = 1.0f;
+      frag->scissorExt[1] = 1.0f;
+      frag->scissorScale[0] = 1.0f;
+      frag->scissorScale[1] = 1.0f;
+   }
+   else
+   {
+      nvgTransformInverse (invxform, scissor->xform);
+      vknvg__xformToMat3x4 (frag->scissorMat, invxform);
+      frag->scissorExt[0] = scissor->extent[0];
+      frag->scissorExt[1] = scissor->extent[1];
+      frag->scissorScale[0] = sqrtf (scissor->xform[0] * scissor->xform[0] + scissor->xform[2] * scissor->xform[2]) / fringe;
+      frag->scissorScale[1] = sqrtf (scissor->xform[1] * scissor->xform[1] + scissor->xform[3] * scissor->xform[3]) / fringe;
+   }
+   memcpy (frag->extent, paint->extent, sizeof (frag->extent));
+   frag->strokeMult = vk->edgeAA ? (width * 0.5f + fringe * 0.5f) / fringe : 1e6f;
+   frag->strokeThr = strokeThr;
+   if (paint->ramp != NVG_RAMP_NONE)
+   {
+      tex = vknvg__findTexture (vk, paint->image);
+      if (tex == NULL) return 0;
+      frag->texRect[0] = 0.5f / tex->width;
+      frag->texRect[1] = (paint->rampRow + 0.5f) / tex->height;
+      frag->texRect[2] = (tex->width - 0.5f) / tex->width;
+      frag->texRect[3] = frag->texRect[1];
+      frag->type = VKNVG_SHADER_FILLRAMP;
+      frag->texType = paint->ramp;
+      frag->radius = paint->radius;
+      frag->feather = paint->feather;
+      nvgTransformInverse (invxform, paint->xform);
+   }
+   else if (paint->image != 0)
+   {
+      tex = vknvg__findTexture (vk, paint->image);
+      if (tex == NULL) return 0;
+      if ((tex->flags & NVG_IMAGE_FLIPY) != 0)
+      {
+         float flipped[6];
+         nvgTransformScale (flipped, 1.0f, -1.0f);
+         nvgTransformMultiply (flipped, paint->xform);
+         nvgTransformInverse (invxform, flipped);
+      }
+      else
+         nvgTransformInverse (invxform, paint->xform);
+      frag->type = VKNVG_SHADER_FILLIMG;
+      if (tex->type == NVG_TEXTURE_RGBA)
+         frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
+      else
+         frag->texType = 2;
+   }
+   else
+   {
+      frag->type = VKNVG_SHADER_FILLGRAD;
+      frag->radius = paint->radius;
+      frag->feather = paint->feather;
+      nvgTransformInverse (invxform, paint->xform);
+   }
+   vknvg__xformToMat3x4 (frag->paintMat, invxform);
+   return 1;
+}
+
+// Returns room for n uniform blocks of a call, which go fragSize apart from *offset in block.
+static VKNVGfragUniforms * vknvg__allocUniforms (VKNVGcontext * vk, int n, VKNVGblock ** block, uint32_t * offset)
+{
+   VkDeviceSize off;
+   unsigned char * data = vknvg__alloc (vk, (VkDeviceSize)n * vk->fragSize, vk->uniformAlign, block, &off);
+   if (data == NULL) return NULL;
+   memset (data, 0, (size_t)n * vk->fragSize);
+   *offset = (uint32_t)off;
+   return (VKNVGfragUniforms *)data;
+}
+
+static VKNVGfragUniforms * vknvg__fragAt (VKNVGcontext * vk, VKNVGfragUniforms * frag, int i)
+{
+   return (VKNVGfragUniforms *) ((unsigned char *)frag + (size_t)i * vk->fragSize);
+}
+
+// Returns room for nverts vertices, whose index in block is *first.
+static NVGvertex * vknvg__allocVerts (VKNVGcontext * vk, int nverts, VKNVGblock ** block, uint32_t * first)
+{
+   VkDeviceSize off;
+   unsigned char * data = vknvg__alloc (vk, (VkDeviceSize)nverts * sizeof (NVGvertex), sizeof (NVGvertex), block, &off);
+   if (data == NULL) return NULL;
+   *first = (uint32_t) (off / sizeof (NVGvertex));
+   return (NVGvertex *)data;
+}
+
+// Appends a draw of the current frame, in a pipeline chosen by its mode and the type of its uniforms.
+static void vknvg__draw (VKNVGcontext * vk, int mode, VKNVGblock * verts, uint32_t first, uint32_t count,
+                         VKNVGblock * uniforms, uint32_t uniformOffset, const VKNVGfragUniforms * frag, int image)
+{
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   VKNVGtexture * tex = vknvg__findTexture (vk, image != 0 ? image : vk->dummyTex);
+   VKNVGdraw * draw;
+   if (count == 0) return;
+   if (frame->ndraws + 1 > frame->cdraws)
+   {
+      int cdraws = vknvg__maxi (frame->ndraws + 1, 128) + frame->cdraws / 2; // 1.5x Overallocate
+      VKNVGdraw * draws = (VKNVGdraw *)realloc (frame->draws, sizeof (VKNVGdraw) * cdraws);
+      if (draws == NULL) return;
+      frame->draws = draws;
+      frame->cdraws = cdraws;
+   }
+   if (tex == NULL)
+      tex = vknvg__findTexture (vk, vk->dummyTex);
+   draw = &frame->draws[frame->ndraws++];
+   draw->pipeline = vk->pipelines[mode][frag->type];
+   draw->vertBuf = verts->buffer;
+   draw->first = first;
+   draw->count = count;
+   draw->uniformSet = uniforms->uniformSet;
+   draw->uniformOffset = uniformOffset;
+   draw->imageSet = tex->set;
+}
+
+static void vknvg__vset (NVGvertex * vtx, float x, float y, float u, float v)
+{
+   vtx->x = x;
+   vtx->y = y;
+   vtx->u = u;
+   vtx->v = v;
+}
+
+static int vknvg__maxVertCount (const NVGpath * paths, int npaths)
+{
+   int i, count = 0;
+   for (i = 0; i < npaths; i++)
+   {
+      count += paths[i].nfill;
+      count += paths[i].nstroke;
+   }
+   return count;
+}
+
+// Copies the fill and stroke vertices of the paths, setting their first vertex in fills and strokes.
+static NVGvertex * vknvg__copyPaths (VKNVGcontext * vk, const NVGpath * paths, int npaths, int extra,
+                                     VKNVGblock ** block, uint32_t * fills, uint32_t * strokes)
+{
+   uint32_t first;
+   int i;
+   NVGvertex * verts = vknvg__allocVerts (vk, vknvg__maxVertCount (paths, npaths) + extra, block, &first);
+   if (verts == NULL) return NULL;
+   for (i = 0; i < npaths; i++)
+   {
+      const NVGpath * path = &paths[i];
+      fills[i] = first;
+      memcpy (verts, path->fill, sizeof (NVGvertex) * path->nfill);
+      verts += path->nfill;
+      first += path->nfill;
+      strokes[i] = first;
+      memcpy (verts, path->stroke, sizeof (NVGvertex) * path->nstroke);
+      verts += path->nstroke;
+      first += path->nstroke;
+   }
+   return verts;
+}
+
+static void vknvg__renderViewport (void * uptr, int width, int height, float devicePixelRatio)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   frame->view[0] = (float)width;
+   frame->view[1] = (float)height;
+   frame->pixelRatio = devicePixelRatio;
+}
+
+static void vknvg__renderCancel (void * uptr)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   frame->ndraws = frame->nflushed;
+}
+
+static void vknvg__renderFlush (void * uptr)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   vknvg__stageUploads (vk);
+   frame->nflushed = frame->ndraws;
+}
+
+static void vknvg__renderFill (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
+                               const float * bounds, const NVGpath * paths, int npaths)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGblock * vertBlock, * fragBlock;
+   VKNVGfragUniforms * frag;
+   NVGvertex * quad;
+   uint32_t * fills, * strokes, offset;
+   int i;
+   if (npaths <= 0) return;
+   fills = (uint32_t *)malloc (sizeof (uint32_t) * npaths * 2);
+   if (fills == NULL) return;
+   strokes = fills + npaths;
+   quad = vknvg__copyPaths (vk, paths, npaths, 6, &vertBlock, fills, strokes);
+   if (quad == NULL) goto done;
+   if ((npaths == 1 && paths[0].convex) || paths[0].triangles)
+   {
+      frag = vknvg__allocUniforms (vk, 1, &fragBlock, &offset);
+      if (frag == NULL || !vknvg__convertPaint (vk, frag, paint, scissor, fringe, fringe, -1.0f)) goto done;
+      for (i = 0; i < npaths; i++)
+         vknvg__draw (vk, paths[0].triangles ? VKNVG_LIST : VKNVG_FAN, vertBlock, fills[i], paths[i].nfill,
+                      fragBlock, offset, frag, paint->image);
+      for (i = 0; vk->edgeAA && i < npaths; i++)
+         vknvg__draw (vk, VKNVG_STRIP, vertBlock, strokes[i], paths[i].nstroke, fragBlock, offset, frag, paint->image);
+      goto done;
+   }
+   // Quad covering the bounds, drawn where the stencil was written.
+   vknvg__vset (&quad[0], bounds[0], bounds[3], 0.5f, 1.0f);
+   vknvg__vset (&quad[1], bounds[2], bounds[3], 0.5f, 1.0f);
+   vknvg__vset (&quad[2], bounds[2], bounds[1], 0.5f, 1.0f);
+   vknvg__vset (&quad[3], bounds[0], bounds[3], 0.5f, 1.0f);
+   vknvg__vset (&quad[4], bounds[2], bounds[1], 0.5f, 1.0f);
+   vknvg__vset (&quad[5], bounds[0], bounds[1], 0.5f, 1.0f);
+   // Simple shader for stencil, then the fill shader.
+   frag = vknvg__allocUniforms (vk, 2, &fragBlock, &offset);
+   if (frag == NULL) goto done;
+   frag->strokeThr = -1.0f;
+   frag->type = VKNVG_SHADER_SIMPLE;
+   if (!vknvg__convertPaint (vk, vknvg__fragAt (vk, frag, 1), paint, scissor, fringe, fringe, -1.0f)) goto done;
+   for (i = 0; i < npaths; i++)
+      vknvg__draw (vk, VKNVG_FILL_STENCIL, vertBlock, fills[i], paths[i].nfill, fragBlock, offset, frag, 0);
+   for (i = 0; vk->edgeAA && i < npaths; i++)
+      vknvg__draw (vk, VKNVG_FILL_AA, vertBlock, strokes[i], paths[i].nstroke, fragBlock, offset + vk->fragSize,
+                   vknvg__fragAt (vk, frag, 1), paint->image);
+   vknvg__draw (vk, VKNVG_FILL_COVER, vertBlock, strokes[npaths - 1] + paths[npaths - 1].nstroke, 6, fragBlock,
+                offset + vk->fragSize, vknvg__fragAt (vk, frag, 1), paint->image);
+done:
+   free (fills);
+}
+
+// Whether a stroke looks the same without the stencil passes, see glnvg__strokeNeedsStencil().
+static int vknvg__strokeNeedsStencil (const NVGpaint * paint, const NVGpath * paths, int npaths)
+{
+   int i;
+   if (paint->image != 0 || paint->innerColor.a < 1.0f || paint->outerColor.a < 1.0f)
+      return 1;
+   for (i = 0; i < npaths; i++)
+   {
+      const NVGpath * path = &paths[i];
+      if (path->nbevel != 0 || !(path->count <= 2 || (path->closed && path->convex)))
+         return 1;
+   }
+   return 0;
+}
+
+static void vknvg__renderStroke (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
+                                 float strokeWidth, const NVGpath * paths, int npaths)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGblock * vertBlock, * fragBlock;
+   VKNVGfragUniforms * frag, * simple;
+   uint32_t * fills, * strokes, offset;
+   int i;
+   if (npaths <= 0) return;
+   fills = (uint32_t *)malloc (sizeof (uint32_t) * npaths * 2);
+   if (fills == NULL) return;
+   strokes = fills + npaths;
+   if (vknvg__copyPaths (vk, paths, npaths, 0, &vertBlock, fills, strokes) == NULL) goto done;
+   if ((vk->flags & NVG_STENCIL_STROKES) && vknvg__strokeNeedsStencil (paint, paths, npaths))
+   {
+      // Fill shader, the one discarding the edges for the stencil pass and the simple one clearing it.
+      frag = vknvg__allocUniforms (vk, 3, &fragBlock, &offset);
+      if (frag == NULL ||
+            !vknvg__convertPaint (vk, frag, paint, scissor, strokeWidth, fringe, -1.0f) ||
+            !vknvg__convertPaint (vk, vknvg__fragAt (vk, frag, 1), paint, scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f))
+         goto done;
+      simple = vknvg__fragAt (vk, frag, 2);
+      simple->strokeThr = -1.0f;
+      simple->type = VKNVG_SHADER_SIMPLE;
+      for (i = 0; i < npaths; i++)
+         vknvg__draw (vk, VKNVG_STROKE_DRAW, vertBlock, strokes[i], paths[i].nstroke, fragBlock, offset + vk->fragSize,
+                      vknvg__fragAt (vk, frag, 1), paint->image);
+      for (i = 0; i < npaths; i++)
+         vknvg__draw (vk, VKNVG_FILL_AA, vertBlock, strokes[i], paths[i].nstroke, fragBlock, offset, frag, paint->image);
+      for (i = 0; i < npaths; i++)
+         vknvg__draw (vk, VKNVG_STROKE_CLEAR, vertBlock, strokes[i], paths[i].nstroke, fragBlock, offset + 2 * vk->fragSize,
+                      simple, 0);
+   }
+   else
+   {
+      frag = vknvg__allocUniforms (vk, 1, &fragBlock, &offset);
+      if (frag == NULL || !vknvg__convertPaint (vk, frag, paint, scissor, strokeWidth, fringe, -1.0f)) goto done;
+      for (i = 0; i < npaths; i++)
+         vknvg__draw (vk, VKNVG_STRIP, vertBlock, strokes[i], paths[i].nstroke, fragBlock, offset, frag, paint->image);
+   }
+done:
+   free (fills);
+}
+
+static void vknvg__renderTriangles (void * uptr, NVGpaint * paint, NVGscissor * scissor,
+                                    const NVGvertex * verts, int nverts)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGblock * vertBlock, * fragBlock;
+   VKNVGfragUniforms * frag;
+   NVGvertex * dst;
+   uint32_t first, offset;
+   if (nverts <= 0) return;
+   dst = vknvg__allocVerts (vk, nverts, &vertBlock, &first);
+   if (dst == NULL) return;
+   memcpy (dst, verts, sizeof (NVGvertex) * nverts);
+   frag = vknvg__allocUniforms (vk, 1, &fragBlock, &offset);
+   if (frag == NULL || !vknvg__convertPaint (vk, frag, paint, scissor, 1.0f, 1.0f, -1.0f)) return;
+   frag->type = VKNVG_SHADER_IMG;
+   if (frag->texType == 2 && paint->feather > 0.0f)
+   {
+      // Blurred text, see NVGparams.shaderTextBlur.
+      VKNVGtexture * tex = vknvg__findTexture (vk, paint->image);
+      if (tex != NULL)
+      {
+         frag->texType = 4;
+         frag->feather = paint->feather;
+         frag->extent[0] = 1.0f / tex->width;
+         frag->extent[1] = 1.0f / tex->height;
+      }
+   }
+   vknvg__draw (vk, VKNVG_LIST, vertBlock, first, (uint32_t)nverts, fragBlock, offset, frag, paint->image);
+}
+
+static void vknvg__renderShape (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe,
+                                const float * shape, const NVGvertex * verts, int nverts)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VKNVGblock * vertBlock, * fragBlock;
+   VKNVGfragUniforms * frag;
+   NVGvertex * dst;
+   uint32_t first, offset;
+   if (nverts <= 0) return;
+   dst = vknvg__allocVerts (vk, nverts, &vertBlock, &first);
+   if (dst == NULL) return;
+   memcpy (dst, verts, sizeof (NVGvertex) * nverts);
+   frag = vknvg__allocUniforms (vk, 1, &fragBlock, &offset);
+   if (frag == NULL || !vknvg__convertPaint (vk, frag, paint, scissor, fringe, fringe, -1.0f)) return;
+   memcpy (frag->shape, shape, sizeof (frag->shape));
+   vknvg__draw (vk, VKNVG_FAN, vertBlock, first, (uint32_t)nverts, fragBlock, offset, frag, paint->image);
+}
+
+static void vknvg__renderDelete (void * uptr)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)uptr;
+   VkDevice device;
+   int i, j;
+   if (vk == NULL) return;
+   device = vk->info.device;
+   for (i = 0; i < vk->ntextures; i++)
+      if (vk->textures[i].id != 0)
+         vknvg__deleteTexture (vk, vk->textures[i].id);
+   vknvg__collectGarbage (vk, 1);
+   for (i = 0; i < NANOVG_VK_MAX_FRAMES; i++)
+   {
+      VKNVGframe * frame = &vk->frames[i];
+      for (j = 0; j < frame->nblocks; j++)
+      {
+         vkDestroyBuffer (device, frame->blocks[j].buffer, vk->info.allocator);
+         vkFreeMemory (device, frame->blocks[j].memory, vk->info.allocator);
+      }
+      free (frame->blocks);
+      free (frame->draws);
+      free (frame->copies);
+   }
+   for (i = 0; i < VKNVG_MODES; i++)
+      for (j = 0; j < VKNVG_SHADER_TYPES; j++)
+         if (vk->pipelines[i][j] != VK_NULL_HANDLE)
+            vkDestroyPipeline (device, vk->pipelines[i][j], vk->info.allocator);
+   for (i = 0; i < 8; i++)
+      if (vk->samplers[i] != VK_NULL_HANDLE)
+         vkDestroySampler (device, vk->samplers[i], vk->info.allocator);
+   // Destroying the pools frees the sets of the blocks.
+   for (i = 0; i < vk->npools; i++)
+      vkDestroyDescriptorPool (device, vk->pools[i], vk->info.allocator);
+   if (vk->pipelineLayout != VK_NULL_HANDLE)
+      vkDestroyPipelineLayout (device, vk->pipelineLayout, vk->info.allocator);
+   if (vk->uniformLayout != VK_NULL_HANDLE)
+      vkDestroyDescriptorSetLayout (device, vk->uniformLayout, vk->info.allocator);
+   if (vk->imageLayout != VK_NULL_HANDLE)
+      vkDestroyDescriptorSetLayout (device, vk->imageLayout, vk->info.allocator);
+   free (vk->pools);
+   free (vk->textures);
+   free (vk->garbage);
+   free (vk->uploads);
+   free (vk->uploadData);
+   free (vk);
+}
+
+NVGcontext * nvgCreateVk (const NVGVkCreateInfo * info, int flags)
+{
+   NVGparams params;
+   NVGcontext * ctx = NULL;
+   VKNVGcontext * vk = (VKNVGcontext *)malloc (sizeof (VKNVGcontext));
+   if (vk == NULL) goto error;
+   memset (vk, 0, sizeof (VKNVGcontext));
+   vk->info = *info;
+   if (vk->info.frames < 1)
+      vk->info.frames = 1;
+   if (vk->info.frames > NANOVG_VK_MAX_FRAMES)
+      vk->info.frames = NANOVG_VK_MAX_FRAMES;
+   memset (&params, 0, sizeof (params));
+   params.renderCreate = vknvg__renderCreate;
+   params.renderCreateTexture = vknvg__renderCreateTexture;
+   params.renderDeleteTexture = vknvg__renderDeleteTexture;
+   params.renderUpdateTexture = vknvg__renderUpdateTexture;
+   params.renderUpdateTextureRegion = vknvg__renderUpdateTextureRegion;
+   params.renderGetTextureSize = vknvg__renderGetTextureSize;
+   params.renderViewport = vknvg__renderViewport;
+   params.renderCancel = vknvg__renderCancel;
+   params.renderFlush = vknvg__renderFlush;
+   params.renderFill = vknvg__renderFill;
+   params.renderStroke = vknvg__renderStroke;
+   params.renderTriangles = vknvg__renderTriangles;
+   params.renderShape = vknvg__renderShape;
+   params.renderDelete = vknvg__renderDelete;
+   params.userPtr = vk;
+   params.triangleFills = 1;
+   params.shaderTextBlur = 1;
+   params.edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
+   vk->flags = flags;
+   vk->edgeAA = (flags & NVG_ANTIALIAS) != 0;
+   ctx = nvgCreateInternal (&params);
+   if (ctx == NULL) goto error;
+   return ctx;
+error:
+   // 'vk' is freed by nvgDeleteInternal.
+   if (ctx != NULL) nvgDeleteInternal (ctx);
+   return NULL;
+}
+
+void nvgDeleteVk (NVGcontext * ctx)
+{
+   nvgDeleteInternal (ctx);
+}
+
+void nvgvkBeginFrame (NVGcontext * ctx, int frame)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   VKNVGframe * f;
+   int i;
+   vk->frame = frame >= 0 && frame < vk->info.frames ? frame : 0;
+   vk->begins++;
+   vknvg__collectGarbage (vk, 0);
+   f = &vk->frames[vk->frame];
+   for (i = 0; i < f->nblocks; i++)
+      f->blocks[i].used = 0;
+   f->block = 0;
+   f->ndraws = 0;
+   f->nflushed = 0;
+   f->ncopies = 0;
+}
+
+static void vknvg__imageBarrier (VkCommandBuffer cmd, VkImage image, uint32_t level, uint32_t levels,
+                                 VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess,
+                                 VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+   VkImageMemoryBarrier barrier;
+   memset (&barrier, 0, sizeof (barrier));
+   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+   barrier.srcAccessMask = srcAccess;
+   barrier.dstAccessMask = dstAccess;
+   barrier.oldLayout = oldLayout;
+   barrier.newLayout = newLayout;
+   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   barrier.image = image;
+   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+   barrier.subresourceRange.baseMipLevel = level;
+   barrier.subresourceRange.levelCount = levels;
+   barrier.subresourceRange.layerCount = 1;
+   vkCmdPipelineBarrier (cmd, srcStage, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+void nvgvkRecordUploads (NVGcontext * ctx, VkCommandBuffer cmd)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   int i;
+   for (i = 0; i < frame->ncopies; i++)
+   {
+      const VKNVGcopy * copy = &frame->copies[i];
+      uint32_t levels = (uint32_t)copy->levels, level;
+      // Earlier frames may still sample the image, the copy waits for them.
+      vknvg__imageBarrier (cmd, copy->image, 0, levels,
+                           copy->initial ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copy->initial ? 0 : VK_ACCESS_SHADER_READ_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT,
+                           copy->initial ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT);
+      if (copy->buffer == VK_NULL_HANDLE)
+      {
+         VkClearColorValue zero;
+         VkImageSubresourceRange range;
+         memset (&zero, 0, sizeof (zero));
+         memset (&range, 0, sizeof (range));
+         range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+         range.levelCount = levels;
+         range.layerCount = 1;
+         vkCmdClearColorImage (cmd, copy->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &zero, 1, &range);
+      }
+      else
+      {
+         VkBufferImageCopy region;
+         memset (&region, 0, sizeof (region));
+         region.bufferOffset = copy->offset;
+         region.bufferRowLength = (uint32_t)copy->w;
+         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+         region.imageSubresource.layerCount = 1;
+         region.imageOffset.x = copy->x;
+         region.imageOffset.y = copy->y;
+         region.imageExtent.width = (uint32_t)copy->w;
+         region.imageExtent.height = (uint32_t)copy->h;
+         region.imageExtent.depth = 1;
+         vkCmdCopyBufferToImage (cmd, copy->buffer, copy->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+      }
+      // Every level is blitted down from the one above, which then is a transfer source.
+      for (level = 1; level < levels; level++)
+      {
+         VkImageBlit blit;
+         vknvg__imageBarrier (cmd, copy->image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+         memset (&blit, 0, sizeof (blit));
+         blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+         blit.srcSubresource.mipLevel = level - 1;
+         blit.srcSubresource.layerCount = 1;
+         blit.srcOffsets[1].x = vknvg__maxi (1, copy->width >> (level - 1));
+         blit.srcOffsets[1].y = vknvg__maxi (1, copy->height >> (level - 1));
+         blit.srcOffsets[1].z = 1;
+         blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+         blit.dstSubresource.mipLevel = level;
+         blit.dstSubresource.layerCount = 1;
+         blit.dstOffsets[1].x = vknvg__maxi (1, copy->width >> level);
+         blit.dstOffsets[1].y = vknvg__maxi (1, copy->height >> level);
+         blit.dstOffsets[1].z = 1;
+         vkCmdBlitImage (cmd, copy->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, copy->image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+      }
+      if (levels > 1)
+         vknvg__imageBarrier (cmd, copy->image, 0, levels - 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+      vknvg__imageBarrier (cmd, copy->image, levels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+   }
+}
+
+void nvgvkRecordDraws (NVGcontext * ctx, VkCommandBuffer cmd)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   VKNVGframe * frame = &vk->frames[vk->frame];
+   VkPipeline pipeline = VK_NULL_HANDLE;
+   VkBuffer vertBuf = VK_NULL_HANDLE;
+   VkDescriptorSet sets[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+   uint32_t uniformOffset = 0;
+   VkViewport viewport;
+   VkRect2D scissor;
+   int i;
+   if (frame->nflushed == 0) return;
+   viewport.x = 0.0f;
+   viewport.y = 0.0f;
+   viewport.width = frame->view[0] * frame->pixelRatio;
+   viewport.height = frame->view[1] * frame->pixelRatio;
+   viewport.minDepth = 0.0f;
+   viewport.maxDepth = 1.0f;
+   scissor.offset.x = 0;
+   scissor.offset.y = 0;
+   scissor.extent.width = (uint32_t) (viewport.width + 0.5f);
+   scissor.extent.height = (uint32_t) (viewport.height + 0.5f);
+   vkCmdSetViewport (cmd, 0, 1, &viewport);
+   vkCmdSetScissor (cmd, 0, 1, &scissor);
+   vkCmdPushConstants (cmd, vk->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, 2 * sizeof (float), frame->view);
+   for (i = 0; i < frame->nflushed; i++)
+   {
+      const VKNVGdraw * draw = &frame->draws[i];
+      if (draw->pipeline != pipeline)
+      {
+         pipeline = draw->pipeline;
+         vkCmdBindPipeline (cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+      }
+      if (draw->vertBuf != vertBuf)
+      {
+         VkDeviceSize zero = 0;
+         vertBuf = draw->vertBuf;
+         vkCmdBindVertexBuffers (cmd, 0, 1, &vertBuf, &zero);
+      }
+      if (draw->uniformSet != sets[0] || draw->uniformOffset != uniformOffset || draw->imageSet != sets[1])
+      {
+         sets[0] = draw->uniformSet;
+         sets[1] = draw->imageSet;
+         uniformOffset = draw->uniformOffset;
+         vkCmdBindDescriptorSets (cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->pipelineLayout, 0, 2, sets, 1, &uniformOffset);
+      }
+      vkCmdDraw (cmd, draw->count, 1, draw->first, 0);
+   }
+}
+
+int nvgvkDrawCount (NVGcontext * ctx)
+{
+   VKNVGcontext * vk = (VKNVGcontext *)nvgInternalParams (ctx)->userPtr;
+   return vk->frames[vk->frame].nflushed;
+}
+
+#endif /* NANOVG_VK_IMPLEMENTATION */
@@ -509,8 +509,21 @@ static stbi_uc * stbi__gif_load (stbi__context * s, int * x, int * y, int * comp
 static int      stbi__gif_info (stbi__context * s, int * x, int * y, int * comp);
 
 
-// this is not threadsafe
-static const char * stbi__g_failure_reason;
+// thread local where the compiler supports it, so decoding on several threads does not race
+#ifndef STBI_THREAD_LOCAL
+   #if defined(__cplusplus) && __cplusplus >= 201103L
+      #define STBI_THREAD_LOCAL thread_local
+   #elif defined(_MSC_VER)
+      #define STBI_THREAD_LOCAL __declspec(thread)
+   #elif defined(__GNUC__)
+      #define STBI_THREAD_LOCAL __thread
+   #elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+      #define STBI_THREAD_LOCAL _Thread_local
+   #else
+      #define STBI_THREAD_LOCAL
+   #endif
+#endif
+static STBI_THREAD_LOCAL const char * stbi__g_failure_reason;
 
 STBIDEF const char * stbi_failure_reason (void)
 {
@@ -0,0 +1,222 @@
+// Asynchronous readback of framebuffers into image files
+// Copyright (c) 2015, HurleyWorks
+
+#include "FrameCapture.h"
+#include "cinder/gl/gl.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../nanovg/stb_image_write.h"
+
+FrameCapture::FrameCapture (int slots)
+   : mSlots (std::max (slots, 1))
+{
+   mThread = std::thread (&FrameCapture::run, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mStop = true;
+   }
+   mWake.notify_all();
+   mThread.join();
+   /* Captures still in flight are dropped without calling back */
+   for (Slot & slot : mSlots)
+   {
+      if (slot.fence)
+         glDeleteSync ((GLsync)slot.fence);
+      if (slot.buffer)
+         glDeleteBuffers (1, &slot.buffer);
+   }
+}
+
+void FrameCapture::request (const std::string & path, int maxWidth, const Callback & callback)
+{
+   Capture capture;
+   capture.path = path;
+   capture.maxWidth = maxWidth;
+   capture.callback = callback;
+   mRequests.push_back (std::move (capture));
+}
+
+void FrameCapture::read (unsigned int fbo, int width, int height, bool premultiplied, bool opaque)
+{
+   /* With every buffer in flight the request waits for a later frame */
+   if (mRequests.empty() || mInFlight == (int)mSlots.size() || width <= 0 || height <= 0)
+      return;
+   Slot & slot = mSlots[(mNext + mInFlight) % mSlots.size()];
+   size_t size = (size_t)width * height * 4;
+   GLint prevPack, prevRead;
+   glGetIntegerv (GL_PIXEL_PACK_BUFFER_BINDING, &prevPack);
+   glGetIntegerv (GL_READ_FRAMEBUFFER_BINDING, &prevRead);
+   if (!slot.buffer)
+      glGenBuffers (1, &slot.buffer);
+   glBindBuffer (GL_PIXEL_PACK_BUFFER, slot.buffer);
+   if (slot.size != size)
+   {
+      glBufferData (GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_READ);
+      slot.size = size;
+   }
+   glBindFramebuffer (GL_READ_FRAMEBUFFER, fbo);
+   /* Only queues the copy, the buffer is mapped once the fence signals */
+   glReadPixels (0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+   slot.fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   glBindFramebuffer (GL_READ_FRAMEBUFFER, prevRead);
+   glBindBuffer (GL_PIXEL_PACK_BUFFER, prevPack);
+
+   slot.capture = std::move (mRequests.front());
+   mRequests.pop_front();
+   slot.capture.width = width;
+   slot.capture.height = height;
+   slot.capture.premultiplied = premultiplied;
+   slot.capture.opaque = opaque;
+   mInFlight++;
+}
+
+bool FrameCapture::poll()
+{
+   GLint prevPack = 0;
+   bool bound = false;
+   while (mInFlight > 0)
+   {
+      Slot & slot = mSlots[mNext];
+      GLenum status = glClientWaitSync ((GLsync)slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (status == GL_TIMEOUT_EXPIRED)
+         break;
+      glDeleteSync ((GLsync)slot.fence);
+      slot.fence = nullptr;
+      Capture capture = std::move (slot.capture);
+      if (status != GL_WAIT_FAILED)
+      {
+         if (!bound)
+         {
+            glGetIntegerv (GL_PIXEL_PACK_BUFFER_BINDING, &prevPack);
+            bound = true;
+         }
+         glBindBuffer (GL_PIXEL_PACK_BUFFER, slot.buffer);
+         const void * data = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)slot.size, GL_MAP_READ_BIT);
+         if (data)
+         {
+            /* Copied out as is, the buffer is needed again long before the worker is done */
+            const unsigned char * bytes = (const unsigned char *)data;
+            capture.pixels.assign (bytes, bytes + slot.size);
+            glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+         }
+      }
+      mNext = (mNext + 1) % (int)mSlots.size();
+      mInFlight--;
+      {
+         std::lock_guard<std::mutex> lock (mMutex);
+         mTodo.push_back (std::move (capture));
+      }
+      mPending++;
+      mWake.notify_one();
+   }
+   if (bound)
+      glBindBuffer (GL_PIXEL_PACK_BUFFER, prevPack);
+
+   std::deque<Capture> done;
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      done.swap (mDone);
+   }
+   for (Capture & capture : done)
+   {
+      mPending--;
+      if (capture.callback)
+         capture.callback (capture.pixels, capture.width, capture.height);
+   }
+   return mInFlight > 0 || mPending > 0;
+}
+
+void FrameCapture::run()
+{
+   std::unique_lock<std::mutex> lock (mMutex);
+   for (;;)
+   {
+      mWake.wait (lock, [this] { return mStop || !mTodo.empty(); });
+      if (mStop)
+         return;
+      Capture capture = std::move (mTodo.front());
+      mTodo.pop_front();
+      lock.unlock();
+      convert (capture);
+      if (!capture.pixels.empty() && !capture.path.empty())
+      {
+         std::string ext = capture.path.substr (std::min (capture.path.rfind ('.'), capture.path.size()));
+         std::transform (ext.begin(), ext.end(), ext.begin(), ::tolower);
+         const char * path = capture.path.c_str();
+         int w = capture.width, h = capture.height;
+         int ok = ext == ".tga" ? stbi_write_tga (path, w, h, 4, capture.pixels.data()) :
+                  ext == ".bmp" ? stbi_write_bmp (path, w, h, 4, capture.pixels.data()) :
+                  stbi_write_png (path, w, h, 4, capture.pixels.data(), w * 4);
+         if (!ok)
+            std::cerr << "Could not write the frame capture " << capture.path << std::endl;
+      }
+      lock.lock();
+      mDone.push_back (std::move (capture));
+   }
+}
+
+/* Runs on the worker. Flips the rows GL reads bottom up and shrinks the image to maxWidth in the same
+   pass, averaging the premultiplied pixels each output pixel covers; then divides by alpha */
+void FrameCapture::convert (Capture & capture)
+{
+   int sw = capture.width, sh = capture.height;
+   if (capture.pixels.size() != (size_t)sw * sh * 4)
+   {
+      capture.pixels.clear();
+      capture.width = capture.height = 0;
+      return;
+   }
+   int dw = capture.maxWidth > 0 && sw > capture.maxWidth ? capture.maxWidth : sw;
+   int dh = std::max (1, (int)((long long)sh * dw / sw));
+   std::vector<unsigned char> out ((size_t)dw * dh * 4);
+   const unsigned char * src = capture.pixels.data();
+   std::vector<unsigned int> acc ((size_t)dw * 4);
+   for (int y = 0; y < dh; ++y)
+   {
+      int y0 = (int)((long long)y * sh / dh), y1 = std::max (y0 + 1, (int)((long long)(y + 1) * sh / dh));
+      std::fill (acc.begin(), acc.end(), 0u);
+      for (int sy = y0; sy < y1; ++sy)
+      {
+         const unsigned char * row = src + (size_t)(sh - 1 - sy) * sw * 4;
+         for (int x = 0; x < dw; ++x)
+         {
+            int x0 = (int)((long long)x * sw / dw), x1 = std::max (x0 + 1, (int)((long long)(x + 1) * sw / dw));
+            unsigned int * a = &acc[x * 4];
+            for (const unsigned char * p = row + x0 * 4; p < row + x1 * 4; p += 4)
+            {
+               a[0] += p[0];
+               a[1] += p[1];
+               a[2] += p[2];
+               a[3] += p[3];
+            }
+         }
+      }
+      unsigned char * dst = &out[(size_t)y * dw * 4];
+      for (int x = 0; x < dw; ++x)
+      {
+         int x0 = (int)((long long)x * sw / dw), x1 = std::max (x0 + 1, (int)((long long)(x + 1) * sw / dw));
+         unsigned int n = (unsigned int)((x1 - x0) * (y1 - y0));
+         const unsigned int * a = &acc[x * 4];
+         unsigned int alpha = (a[3] + n / 2) / n;
+         for (int c = 0; c < 3; ++c)
+         {
+            unsigned int v = (a[c] + n / 2) / n;
+            if (capture.premultiplied && !capture.opaque)
+               v = alpha > 0 ? std::min (255u, (a[c] * 255 + a[3] / 2) / std::max (a[3], 1u)) : 0;
+            dst[x * 4 + c] = (unsigned char)v;
+         }
+         dst[x * 4 + 3] = capture.opaque ? 255 : (unsigned char)alpha;
+      }
+   }
+   capture.pixels.swap (out);
+   capture.width = dw;
+   capture.height = dh;
+}
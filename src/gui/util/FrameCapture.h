@@ -0,0 +1,80 @@
+// Asynchronous readback of framebuffers into image files
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads framebuffers through a ring of pixel pack buffers, so that glReadPixels() only queues a copy
+// on the GPU instead of waiting for the frame to finish. A buffer is mapped once its fence signals,
+// usually a frame or two later, and a worker thread flips the rows, shrinks the image and writes the
+// file. All calls are made on the thread that owns the GL context.
+class FrameCapture
+{
+   public:
+      /// Receives the captured pixels, RGBA with straight alpha, top row first; empty when the
+      /// capture failed
+      typedef std::function<void (const std::vector<unsigned char> & rgba, int width, int height)> Callback;
+
+      /// \c slots pixel pack buffers are in flight at most
+      explicit FrameCapture (int slots = 3);
+      ~FrameCapture();
+
+      FrameCapture (const FrameCapture &) = delete;
+      FrameCapture & operator= (const FrameCapture &) = delete;
+
+      /// Queues a capture of the next read(). A \c path ending in .png, .tga or .bmp is written,
+      /// an empty one is not. A non zero \c maxWidth shrinks wider frames to it, keeping the aspect
+      void request (const std::string & path, int maxWidth, const Callback & callback);
+
+      /// Whether a capture waits for read()
+      bool wanted() const
+      {
+         return !mRequests.empty();
+      }
+      /// Starts reading \c fbo of \c width by \c height pixels for the oldest request. Pixels
+      /// written with premultiplied alpha are divided by it, \c opaque ones get an alpha of 255
+      void read (unsigned int fbo, int width, int height, bool premultiplied, bool opaque);
+
+      /// Hands the buffers whose copy finished to the worker and calls back the captures it
+      /// completed. Returns true while captures are in flight
+      bool poll();
+
+   private:
+      struct Capture
+      {
+         std::string path;
+         int maxWidth;
+         Callback callback;
+         bool premultiplied, opaque;
+         int width, height;
+         std::vector<unsigned char> pixels;	// as read, bottom row first, then as delivered
+      };
+      struct Slot
+      {
+         unsigned int buffer = 0;
+         size_t size = 0;
+         void * fence = nullptr;	// GLsync, null while the slot is free
+         Capture capture;
+      };
+
+      void run();
+      static void convert (Capture & capture);
+
+      std::vector<Slot> mSlots;
+      int mNext = 0;	// oldest slot in flight
+      int mInFlight = 0;
+      std::deque<Capture> mRequests;
+      std::thread mThread;
+      std::mutex mMutex;
+      std::condition_variable mWake;
+      std::deque<Capture> mTodo, mDone;
+      int mPending = 0;	// handed to the worker and not called back yet
+      bool mStop = false;
+};
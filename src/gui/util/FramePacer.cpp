@@ -0,0 +1,86 @@
+// Schedules the start of GUI frames against the display refresh
+// Copyright (c) 2015, HurleyWorks
+
+#include "FramePacer.h"
+#include <algorithm>
+
+FramePacer::FramePacer()
+{
+   std::fill (mIntervals, mIntervals + History, 0.0);
+   std::fill (mCpuTimes, mCpuTimes + History, 0.0);
+   std::fill (mGpuTimes, mGpuTimes + History, 0.0);
+}
+
+void FramePacer::setRefreshRate (double hz)
+{
+   mRefreshPeriod = hz > 0.0 ? 1.0 / hz : 0.0;
+}
+
+double FramePacer::refreshPeriod() const
+{
+   if (mRefreshPeriod > 0.0)
+      return mRefreshPeriod;
+   /* The median ignores the odd dropped or early frame */
+   double sorted[History];
+   int n = 0;
+   for (double interval : mIntervals)
+      if (interval > 0.0)
+         sorted[n++] = interval;
+   if (n < History / 2)
+      return 0.0;
+   std::nth_element (sorted, sorted + n / 2, sorted + n);
+   return sorted[n / 2];
+}
+
+double FramePacer::worst (const double * samples)
+{
+   return *std::max_element (samples, samples + History);
+}
+
+double FramePacer::predictedCost() const
+{
+   return worst (mCpuTimes) + worst (mGpuTimes);
+}
+
+double FramePacer::frameStart (double now)
+{
+   double period = refreshPeriod();
+   if (mLastStart >= 0.0)
+   {
+      double interval = now - mLastStart;
+      /* Idle gaps say nothing about the display */
+      if (interval > 0.002 && interval < 0.1)
+      {
+         mIntervals[mInterval] = interval;
+         mInterval = (mInterval + 1) % History;
+      }
+      if (period > 0.0 && mDelay > 0.0 && interval > 1.5 * period)
+         mBackoff = std::min (mBackoff + 0.001, 0.5 * period);
+      else
+         mBackoff *= 0.98;
+   }
+   mLastStart = now;
+
+   /* The host starts a frame shortly after the previous one was presented, so it is due one period later */
+   mDelay = 0.0;
+   if (period > 0.0)
+      mDelay = std::max (0.0, std::min (period - predictedCost() - margin(), 0.9 * period));
+   mDrawStart = now + mDelay;
+   return mDelay;
+}
+
+void FramePacer::frameEnd (double now)
+{
+   if (mDrawStart < 0.0)
+      return;
+   /* Oversleeping counts as cost, which keeps the prediction on the safe side */
+   mCpuTimes[mCpu] = std::max (0.0, now - mDrawStart);
+   mCpu = (mCpu + 1) % History;
+   mDrawStart = -1.0;
+}
+
+void FramePacer::addGpuTime (double seconds)
+{
+   mGpuTimes[mGpu] = seconds;
+   mGpu = (mGpu + 1) % History;
+}
@@ -0,0 +1,62 @@
+// Schedules the start of GUI frames against the display refresh
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+// Predicts how long a frame takes to draw and submit, and how much of the refresh period is left
+// after the host starts it, so the screen can wait before sampling input instead of after
+// submitting. Input drawn by a frame is then as fresh as the deadline allows. The period is
+// measured from the starts of consecutive frames unless it is set. A frame that missed its
+// deadline, seen as an interval of more than one and a half periods, widens the safety margin,
+// which then shrinks again slowly.
+class FramePacer
+{
+   public:
+      FramePacer();
+
+      /// Sets the display refresh rate in Hz, 0 measures it from the frame intervals
+      void setRefreshRate (double hz);
+      /// Returns the refresh period in seconds, 0 while it is unknown
+      double refreshPeriod() const;
+
+      /// Sets the time in seconds kept free before the deadline, not counting the adaptive part
+      void setMargin (double seconds)
+      {
+         mMargin = seconds;
+      }
+      double margin() const
+      {
+         return mMargin + mBackoff;
+      }
+
+      /// Call when the host starts a frame, returns the seconds to wait before sampling input
+      double frameStart (double now);
+      /// Call once the frame was submitted, \c now on the same clock as frameStart()
+      void frameEnd (double now);
+      /// Adds the GPU time of a finished frame, as read back from the GPU timer
+      void addGpuTime (double seconds);
+
+      /// Returns the CPU plus GPU time expected for the next frame, the worst of the recent frames
+      double predictedCost() const;
+      /// Returns the wait returned by the last frameStart()
+      double lastDelay() const
+      {
+         return mDelay;
+      }
+
+   private:
+      static const int History = 16;
+
+      static double worst (const double * samples);
+
+      double mRefreshPeriod = 0.0;	// set by the host, 0 when measured
+      double mIntervals[History];
+      double mCpuTimes[History];
+      double mGpuTimes[History];
+      int mInterval = 0, mCpu = 0, mGpu = 0;	// next sample written
+      double mMargin = 0.0015;
+      double mBackoff = 0.0;
+      double mLastStart = -1.0;
+      double mDrawStart = -1.0;
+      double mDelay = 0.0;
+};
@@ -0,0 +1,81 @@
+// Background rasterization of the glyphs a NanoVG context queues in async glyph mode
+// Copyright (c) 2015, HurleyWorks
+
+#include "GlyphWorker.h"
+#include "../nanovg/nanovg.h"
+
+GlyphWorker::GlyphWorker (NVGcontext * ctx)
+   : mContext (ctx),
+     mBuilder (nvgCreateGlyphBuilder (ctx))
+{
+   /* Without a builder the queued glyphs are rasterized by merge() on the drawing thread */
+   if (mBuilder)
+      mThread = std::thread (&GlyphWorker::run, this);
+   nvgSetAsyncGlyphs (mContext, 1);
+}
+
+GlyphWorker::~GlyphWorker()
+{
+   nvgSetAsyncGlyphs (mContext, 0);
+   if (mThread.joinable())
+   {
+      {
+         std::lock_guard<std::mutex> lock (mMutex);
+         mStop = true;
+      }
+      mWake.notify_all();
+      mThread.join();
+   }
+   /* Glyphs left blank so far are rasterized here */
+   for (auto jobs : mTodo)
+      nvgCompleteGlyphJobs (mContext, jobs);
+   for (auto jobs : mDone)
+      nvgCompleteGlyphJobs (mContext, jobs);
+   nvgCompleteGlyphJobs (mContext, nvgTakeGlyphJobs (mContext));
+   nvgDeleteGlyphBuilder (mBuilder);
+}
+
+void GlyphWorker::merge()
+{
+   std::vector<NVGglyphJobs *> done;
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      done.swap (mDone);
+   }
+   for (auto jobs : done)
+      nvgCompleteGlyphJobs (mContext, jobs);
+}
+
+bool GlyphWorker::submit()
+{
+   NVGglyphJobs * jobs = nvgTakeGlyphJobs (mContext);
+   if (jobs && !mBuilder)
+      nvgCompleteGlyphJobs (mContext, jobs);
+   else
+      if (jobs)
+      {
+         {
+            std::lock_guard<std::mutex> lock (mMutex);
+            mTodo.push_back (jobs);
+         }
+         mWake.notify_one();
+      }
+   return nvgPendingGlyphs (mContext) > 0;
+}
+
+void GlyphWorker::run()
+{
+   std::unique_lock<std::mutex> lock (mMutex);
+   for (;;)
+   {
+      mWake.wait (lock, [this] { return mStop || !mTodo.empty(); });
+      if (mStop)
+         return;
+      NVGglyphJobs * jobs = mTodo.front();
+      mTodo.erase (mTodo.begin());
+      lock.unlock();
+      nvgBuilderRasterizeGlyphJobs (mBuilder, jobs);
+      lock.lock();
+      mDone.push_back (jobs);
+   }
+}
@@ -0,0 +1,41 @@
+// Background rasterization of the glyphs a NanoVG context queues in async glyph mode
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct NVGcontext;
+struct NVGglyphBuilder;
+struct NVGglyphJobs;
+
+// Turns on async glyphs for a context and rasterizes the glyphs it queues on a worker thread with
+// a private copy of its fonts. All calls are made on the thread that draws with the context.
+class GlyphWorker
+{
+   public:
+      explicit GlyphWorker (NVGcontext * ctx);
+      ~GlyphWorker();
+
+      GlyphWorker (const GlyphWorker &) = delete;
+      GlyphWorker & operator= (const GlyphWorker &) = delete;
+
+      /// Copies the glyphs the worker finished into the atlas, call before a frame
+      void merge();
+      /// Hands the glyphs queued by the last frame to the worker, returns true while any are in flight
+      bool submit();
+
+   private:
+      void run();
+
+      NVGcontext * mContext;
+      NVGglyphBuilder * mBuilder;
+      std::thread mThread;
+      std::mutex mMutex;
+      std::condition_variable mWake;
+      std::vector<NVGglyphJobs *> mTodo, mDone;
+      bool mStop = false;
+};
@@ -0,0 +1,231 @@
+// Background decoding of image files for a NanoVG context
+// Copyright (c) 2015, HurleyWorks
+
+#include "ImageLoader.h"
+#include "MappedFile.h"
+#include "ThumbnailCache.h"
+#include "../nanovg/nanovg.h"
+#include "../nanovg/stb_image.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+ImageLoader::ImageLoader (NVGcontext * ctx, int threads)
+   : mContext (ctx)
+{
+   static const unsigned char transparent[4] = { 0, 0, 0, 0 };
+   mPlaceholder = nvgCreateImageRGBA (ctx, 1, 1, 0, transparent);
+   /* The decoder settings nvgCreateImage() uses, set once here since they are global */
+   stbi_set_unpremultiply_on_load (1);
+   stbi_convert_iphone_png_to_rgb (1);
+   if (threads <= 0)
+      threads = std::max (1, (int)std::thread::hardware_concurrency() - 1);
+   for (int i = 0; i < threads; ++i)
+      mThreads.push_back (std::thread (&ImageLoader::run, this));
+}
+
+ImageLoader::~ImageLoader()
+{
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mStop = true;
+   }
+   mWake.notify_all();
+   for (auto & thread : mThreads)
+      thread.join();
+   /* Files that never made it to a texture are dropped without calling back */
+   for (auto & request : mDone)
+      if (!request.cached)
+         stbi_image_free ((void *)request.pixels);
+   mDone.clear();
+   if (mCache && mCache->dirty())
+      mCache->save();
+   if (mPlaceholder)
+      nvgDeleteImage (mContext, mPlaceholder);
+}
+
+void ImageLoader::load (const std::string & path, int imageFlags, const Callback & callback, int thumbSize)
+{
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mTodo.push_back (Request { path, imageFlags, callback, thumbSize, nullptr, 0, 0, false });
+   }
+   mPending++;
+   mWake.notify_one();
+}
+
+void ImageLoader::setThumbnailCache (const std::string & file)
+{
+   mCache.reset (new ThumbnailCache (file));
+}
+
+bool ImageLoader::update (size_t budget)
+{
+   size_t uploaded = 0;
+   while (uploaded == 0 || uploaded < budget)
+   {
+      Request request;
+      {
+         std::lock_guard<std::mutex> lock (mMutex);
+         if (mDone.empty())
+            break;
+         request = std::move (mDone.front());
+         mDone.pop_front();
+      }
+      int image = 0;
+      if (request.pixels)
+      {
+         image = nvgCreateImageRGBA (mContext, request.width, request.height, request.flags, request.pixels);
+         if (!request.cached)
+            stbi_image_free ((void *)request.pixels);
+         uploaded += (size_t)request.width * request.height * 4;
+      }
+      else
+         uploaded++;
+      mPending--;
+      if (request.callback)
+         request.callback (image);
+   }
+   /* No request points into the cache any more, so it can be written and mapped again */
+   if (mPending == 0 && mCache && mCache->dirty())
+      mCache->save();
+   return mPending > 0;
+}
+
+void ImageLoader::run()
+{
+   std::unique_lock<std::mutex> lock (mMutex);
+   for (;;)
+   {
+      mWake.wait (lock, [this] { return mStop || !mTodo.empty(); });
+      if (mStop)
+         return;
+      Request request = std::move (mTodo.front());
+      mTodo.pop_front();
+      lock.unlock();
+      if (request.thumbSize > 0 && mCache)
+         request.pixels = mCache->find (request.path, request.thumbSize, request.width, request.height);
+      request.cached = request.pixels != nullptr;
+      if (!request.cached)
+         decode (request);
+      else if (request.flags & NVG_IMAGE_PREMULTIPLIED)
+      {
+         /* The cache holds straight alpha, premultiply a copy since the mapping is read only */
+         size_t bytes = (size_t)request.width * request.height * 4;
+         unsigned char * copy = (unsigned char *)malloc (bytes);
+         if (copy)
+         {
+            memcpy (copy, request.pixels, bytes);
+            nvgPremultiplyRGBA (copy, request.width * request.height);
+         }
+         request.pixels = copy;
+         request.cached = false;
+      }
+      lock.lock();
+      mDone.push_back (std::move (request));
+   }
+}
+
+/* Runs on a worker, loads the file and shrinks it to a thumbnail when one was asked for. Files with
+   fewer channels are expanded to RGBA by the vectorized nanovg kernel rather than by stb_image */
+void ImageLoader::decode (Request & request)
+{
+   int n = 4;
+   unsigned char * pixels = nullptr;
+   {
+      /* Decoded from the mapped file rather than through a copy read by stb_image, by the decoders
+         registered with nanovg when one takes the format */
+      MappedFile file (request.path);
+      if (file.data() && file.size() <= 0x7fffffff)
+         pixels = nvgDecodeImageMem (file.data(), (int)file.size(), &request.width, &request.height);
+      else
+         pixels = stbi_load (request.path.c_str(), &request.width, &request.height, &n, 0);
+   }
+   if (pixels && n != 4)
+   {
+      unsigned char * rgba = (unsigned char *)malloc ((size_t)request.width * request.height * 4);
+      if (rgba)
+         nvgExpandToRGBA (rgba, pixels, request.width * request.height, n);
+      stbi_image_free (pixels);
+      pixels = rgba;
+   }
+   int side = std::min (request.width, request.height);
+   if (pixels && request.thumbSize > 0 && (side > request.thumbSize || request.width != request.height))
+   {
+      /* Only the centered square is shown in a thumbnail, which then fits an atlas page tightly */
+      int size = std::min (side, request.thumbSize);
+      const unsigned char * crop = pixels +
+                                   ((size_t) ((request.height - side) / 2) * request.width + (request.width - side) / 2) * 4;
+      unsigned char * thumb = downscale (crop, request.width, side, side, size, size);
+      stbi_image_free (pixels);
+      pixels = thumb;
+      request.width = size;
+      request.height = size;
+   }
+   request.pixels = pixels;
+   if (pixels && request.thumbSize > 0 && mCache)
+      mCache->insert (request.path, request.thumbSize, pixels, request.width, request.height);
+   if (pixels && (request.flags & NVG_IMAGE_PREMULTIPLIED))
+      nvgPremultiplyRGBA (pixels, request.width * request.height);
+}
+
+/* Calls f (i, weight) for the source pixels covered by output pixel o, weight being the covered fraction */
+template <typename F>
+static void forSpan (int o, float scale, int n, F f)
+{
+   float begin = o * scale, end = std::min ((o + 1) * scale, (float)n);
+   for (int i = (int)begin; i < end; ++i)
+      f (i, std::min (end, i + 1.0f) - std::max (begin, (float)i));
+}
+
+/* Area average of a straight alpha image, weighted by alpha so that transparent pixels do not bleed
+   their color into the edges. Rows are resampled first, then columns, the inner loops run over the
+   four channels of a pixel and vectorize. Source rows are stride pixels apart. The result is freed
+   with stbi_image_free(). */
+unsigned char * ImageLoader::downscale (const unsigned char * src, int stride, int sw, int sh, int dw, int dh)
+{
+   std::vector<float> rows ((size_t)sh * dw * 4, 0.0f);
+   float sx = (float)sw / dw, sy = (float)sh / dh;
+   for (int y = 0; y < sh; ++y)
+   {
+      const unsigned char * in = src + (size_t)y * stride * 4;
+      float * out = &rows[(size_t)y * dw * 4];
+      for (int x = 0; x < dw; ++x, out += 4)
+      {
+         forSpan (x, sx, sw, [&] (int i, float w)
+         {
+            const unsigned char * p = in + i * 4;
+            float a = p[3] * w;
+            out[0] += p[0] * a;
+            out[1] += p[1] * a;
+            out[2] += p[2] * a;
+            out[3] += a;
+         });
+      }
+   }
+   unsigned char * dst = (unsigned char *)malloc ((size_t)dw * dh * 4);
+   if (!dst)
+      return nullptr;
+   std::vector<float> acc ((size_t)dw * 4);
+   float norm = 1.0f / (sx * sy);
+   for (int y = 0; y < dh; ++y)
+   {
+      std::fill (acc.begin(), acc.end(), 0.0f);
+      forSpan (y, sy, sh, [&] (int i, float w)
+      {
+         const float * in = &rows[(size_t)i * dw * 4];
+         for (int k = 0; k < dw * 4; ++k)
+            acc[k] += in[k] * w;
+      });
+      unsigned char * out = dst + (size_t)y * dw * 4;
+      for (int x = 0; x < dw; ++x)
+      {
+         const float * a = &acc[x * 4];
+         float inv = a[3] > 0.0f ? 1.0f / a[3] : 0.0f;
+         for (int c = 0; c < 3; ++c)
+            out[x * 4 + c] = (unsigned char)std::min (255.0f, a[c] * inv + 0.5f);
+         out[x * 4 + 3] = (unsigned char)std::min (255.0f, a[3] * norm + 0.5f);
+      }
+   }
+   return dst;
+}
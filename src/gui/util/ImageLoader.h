@@ -0,0 +1,90 @@
+// Background decoding of image files for a NanoVG context
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct NVGcontext;
+class ThumbnailCache;
+
+// Decodes image files with stb_image on a few worker threads. The textures are created by update()
+// on the thread that draws with the context, within a per call upload budget, so loading a large
+// folder never stalls a frame. All calls except the decoding are made on that thread.
+class ImageLoader
+{
+   public:
+      /// Receives the image created for a file, 0 if it could not be decoded
+      typedef std::function<void (int image)> Callback;
+
+      /// Starts \c threads decoders, 0 means one less than the number of hardware threads
+      explicit ImageLoader (NVGcontext * ctx, int threads = 0);
+      ~ImageLoader();
+
+      ImageLoader (const ImageLoader &) = delete;
+      ImageLoader & operator= (const ImageLoader &) = delete;
+
+      /// Queues a file for decoding, the callback is called from a later update(). A non zero
+      /// \c thumbSize has the worker crop the image to its centered square and shrink that to at most
+      /// \c thumbSize pixels. With NVG_IMAGE_PREMULTIPLIED in \c imageFlags the worker premultiplies
+      /// the pixels, so the shader does not have to
+      void load (const std::string & path, int imageFlags, const Callback & callback, int thumbSize = 0);
+
+      /// Keeps the thumbnails in \c file across runs, so that loading them again needs no decoding.
+      /// New thumbnails are written whenever no more files are pending. Call before the first load()
+      void setThumbnailCache (const std::string & file);
+
+      /// Creates the images of decoded files until \c budget bytes of pixels were uploaded, at least
+      /// one per call. Returns true while files are still pending
+      bool update (size_t budget);
+
+      /// The context the images are created in
+      NVGcontext * context() const
+      {
+         return mContext;
+      }
+      /// Number of queued files whose callback was not called yet
+      int pending() const
+      {
+         return mPending;
+      }
+      /// A transparent 1x1 image to show in place of the ones still loading, valid as long as the loader
+      int placeholder() const
+      {
+         return mPlaceholder;
+      }
+
+   private:
+      struct Request
+      {
+         std::string path;
+         int flags;
+         Callback callback;
+         int thumbSize;
+         const unsigned char * pixels;
+         int width, height;
+         bool cached;	// pixels belong to the thumbnail cache
+      };
+
+      void run();
+      void decode (Request & request);
+      static unsigned char * downscale (const unsigned char * src, int stride, int sw, int sh, int dw, int dh);
+
+      NVGcontext * mContext;
+      int mPlaceholder;
+      int mPending = 0;
+      std::vector<std::thread> mThreads;
+      std::mutex mMutex;
+      std::condition_variable mWake;
+      std::deque<Request> mTodo, mDone;
+      std::unique_ptr<ThumbnailCache> mCache;
+      bool mStop = false;
+};
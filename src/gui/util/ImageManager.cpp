@@ -0,0 +1,169 @@
+// Images of files kept within a texture memory budget
+// Copyright (c) 2015, HurleyWorks
+
+#include "ImageManager.h"
+#include "ImageLoader.h"
+#include "../nanovg/nanovg.h"
+
+ImageManager::ImageManager (ImageLoader & loader, size_t budget)
+   : mLoader (loader), mBudget (budget), mAlive (std::make_shared<bool> (true))
+{
+}
+
+ImageManager::~ImageManager()
+{
+   /* Images still loading are deleted by their callbacks */
+   for (auto & e : mEntries)
+      if (e.state == Resident)
+         nvgDeleteImage (mLoader.context(), e.image);
+}
+
+ImageManager::Entry * ImageManager::entry (int handle)
+{
+   if (handle <= 0 || handle > (int)mEntries.size() || mEntries[handle - 1].path.empty())
+      return nullptr;
+   return &mEntries[handle - 1];
+}
+
+const ImageManager::Entry * ImageManager::entry (int handle) const
+{
+   return const_cast<ImageManager *> (this)->entry (handle);
+}
+
+int ImageManager::add (const std::string & path, int imageFlags, int thumbSize)
+{
+   if (path.empty())
+      return 0;
+   int handle;
+   if (!mFree.empty())
+   {
+      handle = mFree.back();
+      mFree.pop_back();
+   }
+   else
+   {
+      mEntries.emplace_back();
+      handle = (int)mEntries.size();
+   }
+   Entry & e = mEntries[handle - 1];
+   e.path = path;
+   e.flags = imageFlags;
+   e.thumbSize = thumbSize;
+   e.state = Unloaded;
+   e.image = 0;
+   e.bytes = 0;
+   e.frame = 0;
+   e.serial = ++mSerial;
+   e.use = mUse.end();
+   return handle;
+}
+
+void ImageManager::release (int handle)
+{
+   Entry * e = entry (handle);
+   if (!e)
+      return;
+   unload (*e);
+   e->path.clear();
+   e->serial = ++mSerial;
+   mFree.push_back (handle);
+}
+
+int ImageManager::image (int handle)
+{
+   Entry * e = entry (handle);
+   if (!e)
+      return 0;
+   e->frame = mFrame;
+   switch (e->state)
+   {
+      case Resident:
+         mUse.splice (mUse.begin(), mUse, e->use);
+         return e->image;
+      case Failed:
+         return 0;
+      case Loading:
+         return mLoader.placeholder();
+      case Unloaded:
+         break;
+   }
+   e->state = Loading;
+   std::weak_ptr<bool> alive = mAlive;
+   NVGcontext * ctx = mLoader.context();
+   uint32_t serial = e->serial;
+   mLoader.load (e->path, e->flags, [this, alive, ctx, handle, serial] (int image)
+   {
+      if (alive.expired())
+      {
+         if (image)
+            nvgDeleteImage (ctx, image);
+         return;
+      }
+      arrived (handle, serial, image);
+   }, e->thumbSize);
+   return mLoader.placeholder();
+}
+
+int ImageManager::peek (int handle) const
+{
+   const Entry * e = entry (handle);
+   return e && e->state == Resident ? e->image : 0;
+}
+
+void ImageManager::arrived (int handle, uint32_t serial, int image)
+{
+   Entry * e = entry (handle);
+   /* Released, or released and added again, while the file was decoding */
+   if (!e || e->serial != serial || e->state != Loading)
+   {
+      if (image)
+         nvgDeleteImage (mLoader.context(), image);
+      return;
+   }
+   if (!image)
+   {
+      e->state = Failed;
+      return;
+   }
+   int w = 0, h = 0;
+   nvgImageSize (mLoader.context(), image, &w, &h);
+   e->state = Resident;
+   e->image = image;
+   e->bytes = (size_t)w * h * 4;
+   if (e->flags & NVG_IMAGE_GENERATE_MIPMAPS)
+      e->bytes += e->bytes / 3;
+   mBytes += e->bytes;
+   mUse.push_front (handle);
+   e->use = mUse.begin();
+   if (mCallback)
+      mCallback();
+}
+
+void ImageManager::unload (Entry & e)
+{
+   if (e.state == Resident)
+   {
+      nvgDeleteImage (mLoader.context(), e.image);
+      mBytes -= e.bytes;
+      mUse.erase (e.use);
+   }
+   /* A load in flight is dropped on arrival since the serial changed */
+   e.serial = ++mSerial;
+   e.state = Unloaded;
+   e.image = 0;
+   e.bytes = 0;
+   e.use = mUse.end();
+}
+
+void ImageManager::endFrame()
+{
+   while (mBytes > mBudget && !mUse.empty())
+   {
+      Entry & e = mEntries[mUse.back() - 1];
+      /* Everything further up was drawn this frame as well */
+      if (e.frame == mFrame)
+         break;
+      unload (e);
+   }
+   ++mFrame;
+}
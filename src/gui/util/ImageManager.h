@@ -0,0 +1,102 @@
+// Images of files kept within a texture memory budget
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ImageLoader;
+
+// Hands out stable handles for image files and keeps their images resident only while they fit a
+// budget of texture memory. Images not drawn for the longest time are deleted first once the budget
+// is exceeded and decoded again on the workers of an ImageLoader when they are asked for later, so
+// browsing many folders does not pile up textures. Handles are indices into a table and resolve in
+// constant time. All calls are made on the thread that draws with the loader's context.
+class ImageManager
+{
+   public:
+      explicit ImageManager (ImageLoader & loader, size_t budget = 512 << 20);
+      ~ImageManager();
+
+      ImageManager (const ImageManager &) = delete;
+      ImageManager & operator= (const ImageManager &) = delete;
+
+      /// Registers a file without decoding it yet. \c imageFlags and \c thumbSize are passed on to
+      /// ImageLoader::load(). Returns a handle, valid until release()
+      int add (const std::string & path, int imageFlags = 0, int thumbSize = 0);
+      /// Deletes the image of a handle and frees the handle for reuse
+      void release (int handle);
+
+      /// Returns the image of a handle to draw in the current frame, which keeps it from being evicted
+      /// until endFrame(). An image that is not resident is queued for decoding and the loader's
+      /// placeholder is returned meanwhile; 0 if the handle is unknown or the file could not be decoded
+      int image (int handle);
+      /// Returns the image of a handle if it is resident, without touching or loading it
+      int peek (int handle) const;
+
+      /// Deletes the least recently drawn images until the resident ones fit the budget again. Images
+      /// drawn since the last call are kept even when they alone exceed it. Call once per frame
+      void endFrame();
+
+      /// Set the texture memory images may hold before the least recently drawn ones are deleted
+      void setBudget (size_t bytes)
+      {
+         mBudget = bytes;
+      }
+      size_t budget() const
+      {
+         return mBudget;
+      }
+      /// Texture memory held by the resident images
+      size_t bytes() const
+      {
+         return mBytes;
+      }
+      /// Number of resident images
+      int resident() const
+      {
+         return (int)mUse.size();
+      }
+
+      /// Set a function called whenever an image arrived, e.g. to redraw the widget showing it
+      void setCallback (const std::function<void()> & callback)
+      {
+         mCallback = callback;
+      }
+
+   private:
+      enum State { Unloaded, Loading, Resident, Failed };
+      struct Entry
+      {
+         std::string path;	// empty for free handles
+         int flags, thumbSize;
+         State state;
+         int image;
+         size_t bytes;
+         uint64_t frame;	// last frame the image was asked for
+         uint32_t serial;	// changes with every load and release, to drop stale arrivals
+         std::list<int>::iterator use;	// into mUse while resident
+      };
+
+      Entry * entry (int handle);
+      const Entry * entry (int handle) const;
+      void arrived (int handle, uint32_t serial, int image);
+      void unload (Entry & e);
+
+      ImageLoader & mLoader;
+      size_t mBudget;
+      size_t mBytes = 0;
+      uint64_t mFrame = 0;
+      uint32_t mSerial = 0;
+      std::vector<Entry> mEntries;	// handle - 1
+      std::vector<int> mFree;
+      std::list<int> mUse;	// resident handles, most recently drawn first
+      std::function<void()> mCallback;
+      std::shared_ptr<bool> mAlive;	// lets callbacks of the loader outlive the manager
+};
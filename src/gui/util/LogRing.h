@@ -0,0 +1,119 @@
+// Lock-free ring of preformatted log lines from any number of threads to the GUI thread
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Multi producer ring of text lines with a fixed memory budget of capacity * lineBytes bytes.
+// Producers claim a line with one atomic add and copy the text into its slot, they never block and
+// never allocate. Once full, a new line overwrites the oldest one. Every line gets a sequence number,
+// its index in the order lines were claimed; readers copy a line by its number and are told when it
+// was overwritten or is still being written, so the GUI thread reads straight from the ring without
+// taking a lock. Lines are cut to lineBytes - 1 bytes. A line only comes out garbled if the ring
+// wraps all the way around while it is being written.
+class LogRing
+{
+   public:
+      /// \c capacity, in lines, is rounded up to a power of two
+      LogRing (size_t capacity = 16384, size_t lineBytes = 160)
+         : mLineBytes (std::max (lineBytes, (size_t)2))
+      {
+         size_t n = 2;
+         while (n < capacity)
+            n <<= 1;
+         mSlots.reset (new Slot[n]);
+         mText.resize (n * mLineBytes);
+         mMask = n - 1;
+      }
+
+      LogRing (const LogRing &) = delete;
+      LogRing & operator= (const LogRing &) = delete;
+
+      /// Producer side, any thread. \c level is kept with the line, e.g. 0 info, 1 warning, 2 error
+      void push (const char * text, size_t length, int level = 0)
+      {
+         uint64_t seq = mHead.fetch_add (1, std::memory_order_relaxed);
+         Slot & slot = mSlots[seq & mMask];
+         length = std::min (length, mLineBytes - 1);
+         /* Odd while being written, then twice the sequence number plus two */
+         slot.state.store (seq * 2 + 1, std::memory_order_relaxed);
+         std::atomic_thread_fence (std::memory_order_release);
+         memcpy (&mText[(seq & mMask) * mLineBytes], text, length);
+         slot.meta.store ((uint32_t)length | (uint32_t)(level & 0xff) << 24, std::memory_order_relaxed);
+         slot.state.store (seq * 2 + 2, std::memory_order_release);
+      }
+      void push (const char * text, int level = 0)
+      {
+         push (text, strlen (text), level);
+      }
+
+      /// Return the number of lines claimed so far, which is the sequence number of the next one
+      uint64_t head() const
+      {
+         return mHead.load (std::memory_order_acquire);
+      }
+      /// Return the sequence number of the oldest line that has not been overwritten
+      uint64_t tail() const
+      {
+         uint64_t head = this->head();
+         return head > capacity() ? head - capacity() : 0;
+      }
+      /// Return whether line \c seq was written, it may have been overwritten since
+      bool ready (uint64_t seq) const
+      {
+         return mSlots[seq & mMask].state.load (std::memory_order_acquire) >= seq * 2 + 2;
+      }
+
+      /// Copy line \c seq, terminated, to \c out of \ref lineBytes() bytes and return its length, or -1
+      /// when it was overwritten or is still being written
+      int read (uint64_t seq, char * out, int * level = nullptr) const
+      {
+         const Slot & slot = mSlots[seq & mMask];
+         uint64_t written = seq * 2 + 2;
+         if (slot.state.load (std::memory_order_acquire) != written)
+            return -1;
+         uint32_t meta = slot.meta.load (std::memory_order_relaxed);
+         size_t length = std::min ((size_t)(meta & 0xffffff), mLineBytes - 1);
+         memcpy (out, &mText[(seq & mMask) * mLineBytes], length);
+         std::atomic_thread_fence (std::memory_order_acquire);
+         if (slot.state.load (std::memory_order_relaxed) != written)
+            return -1;
+         out[length] = '\0';
+         if (level)
+            *level = (int)(meta >> 24);
+         return (int)length;
+      }
+
+      size_t lineBytes() const
+      {
+         return mLineBytes;
+      }
+      /// Return the number of lines the ring holds
+      size_t capacity() const
+      {
+         return mMask + 1;
+      }
+
+   private:
+      struct Slot
+      {
+         std::atomic<uint64_t> state { 0 };
+         std::atomic<uint32_t> meta { 0 };	// length, level in the top byte
+      };
+
+      std::unique_ptr<Slot[]> mSlots;
+      std::vector<char> mText;
+      size_t mLineBytes;
+      size_t mMask;
+      // Padded to a cache line of its own, make_shared does not honour alignas before C++17.
+      char mPadding0[64];
+      std::atomic<uint64_t> mHead { 0 };
+      char mPadding1[64 - sizeof (std::atomic<uint64_t>)];
+};
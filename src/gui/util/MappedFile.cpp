@@ -0,0 +1,62 @@
+// Read only memory mapping of a whole file
+// Copyright (c) 2015, HurleyWorks
+
+#include "MappedFile.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile (const std::string & path)
+{
+#ifdef _WIN32
+   HANDLE file = CreateFileA (path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+   if (file == INVALID_HANDLE_VALUE)
+      return;
+   LARGE_INTEGER size;
+   HANDLE mapping = NULL;
+   if (GetFileSizeEx (file, &size) && size.QuadPart > 0)
+      mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+   CloseHandle (file);
+   if (!mapping)
+      return;
+   /* The view keeps the mapping alive */
+   mData = (const unsigned char *)MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+   CloseHandle (mapping);
+   if (mData)
+      mSize = (size_t)size.QuadPart;
+#else
+   int fd = open (path.c_str(), O_RDONLY);
+   if (fd < 0)
+      return;
+   struct stat info;
+   void * mapping = MAP_FAILED;
+   if (fstat (fd, &info) == 0 && info.st_size > 0)
+      mapping = mmap (nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close (fd);
+   if (mapping == MAP_FAILED)
+      return;
+   mData = (const unsigned char *)mapping;
+   mSize = (size_t)info.st_size;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+   if (!mData)
+      return;
+#ifdef _WIN32
+   UnmapViewOfFile (mData);
+#else
+   munmap ((void *)mData, mSize);
+#endif
+}
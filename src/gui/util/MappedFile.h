@@ -0,0 +1,33 @@
+// Read only memory mapping of a whole file
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Maps a file into memory read only, so that its contents are paged in as they are read instead of
+// being copied into a buffer first. Empty and missing files leave the mapping empty.
+class MappedFile
+{
+   public:
+      explicit MappedFile (const std::string & path);
+      ~MappedFile();
+
+      MappedFile (const MappedFile &) = delete;
+      MappedFile & operator= (const MappedFile &) = delete;
+
+      /// Returns the contents of the file, nullptr when it could not be mapped
+      const unsigned char * data() const
+      {
+         return mData;
+      }
+      size_t size() const
+      {
+         return mSize;
+      }
+
+   private:
+      const unsigned char * mData = nullptr;
+      size_t mSize = 0;
+};
@@ -3,8 +3,14 @@
 // Copyright (c) 2015, HurleyWorks
 
 #include "NanoUtil.h"
+#include "ImageLoader.h"
 #include "../nanovg/nanovg.h"
+#include "../nanogui/vectoricon.h"
 #include <cinder/Filesystem.h>
+#include <cinder/gl/gl.h>
+#include "../nanovg/nanovg_gl.h"
+#include <cstring>
+#include <stdexcept>
 
 using namespace cinder;
 
@@ -31,3 +37,86 @@ std::vector<std::pair<int, std::string>> NanoUtil::loadImageDirectory (NVGcontex
    return result;
 }
 
+
+std::vector<std::pair<int, std::string>> NanoUtil::loadImageDirectory (ImageLoader & loader, const std::string & folder,
+      const std::function<void (size_t, int)> & callback, int thumbSize)
+{
+   std::vector<std::pair<int, std::string> > result;
+   fs::path p (folder);
+   if (!fs::is_directory (p))
+      return std::vector<std::pair<int, std::string>>();
+   for (fs::directory_iterator it (p); it != fs::directory_iterator(); ++it)
+   {
+      fs::path imgPath = it->path();
+      if (imgPath.extension() == ".png")
+      {
+         size_t index = result.size();
+         loader.load (imgPath.string(), 0, [callback, index] (int image)
+         {
+            if (callback)
+               callback (index, image);
+         }, thumbSize);
+         result.push_back (
+            std::make_pair (loader.placeholder(), imgPath.string().substr (0, imgPath.string().length() - 4)));
+      }
+   }
+   return result;
+}
+
+std::vector<std::pair<nanogui::ref<nanogui::VectorIcon>, std::string>> NanoUtil::loadVectorDirectory (const std::string & folder)
+{
+   std::vector<std::pair<nanogui::ref<nanogui::VectorIcon>, std::string>> result;
+   fs::path p (folder);
+   if (!fs::is_directory (p))
+      return result;
+   for (fs::directory_iterator it (p); it != fs::directory_iterator(); ++it)
+   {
+      fs::path iconPath = it->path();
+      if (iconPath.extension() == ".svg")
+      {
+         try
+         {
+            result.push_back (std::make_pair (nanogui::VectorIcon::load (iconPath.string()),
+                                              iconPath.string().substr (0, iconPath.string().length() - 4)));
+         }
+         catch (const std::runtime_error &)
+         {
+            continue;
+         }
+      }
+   }
+   return result;
+}
+
+int NanoUtil::createImage (NVGcontext * ctx, const gl::TextureRef & texture, int imageFlags)
+{
+   if (!texture)
+      return 0;
+   if (!texture->isTopDown())
+      imageFlags |= NVG_IMAGE_FLIPY;
+   return nvglCreateImageFromHandle (ctx, texture->getId(), texture->getWidth(), texture->getHeight(),
+                                     imageFlags | NVG_IMAGE_NODELETE);
+}
+
+bool NanoUtil::streamImage (NVGcontext * ctx, int image, const Surface8u & surface)
+{
+   int order = surface.getChannelOrder().getCode();
+   if (!surface.hasAlpha() || (order != SurfaceChannelOrder::RGBA && order != SurfaceChannelOrder::BGRA))
+      return false;
+   int w, h;
+   nvgImageSize (ctx, image, &w, &h);
+   if (surface.getWidth() != w || surface.getHeight() != h)
+      return false;
+   if (order == SurfaceChannelOrder::RGBA)
+      return nvglStreamImage (ctx, image, surface.getData(), (int)surface.getRowBytes()) != 0;
+   /* Swizzled into a buffer kept between frames, streaming happens on the GUI thread only */
+   static std::vector<unsigned char> rgba;
+   rgba.resize ((size_t)w * h * 4);
+   for (int y = 0; y < h; ++y)
+   {
+      unsigned char * row = &rgba[(size_t)y * w * 4];
+      memcpy (row, surface.getData (ivec2 (0, y)), (size_t)w * 4);
+      nvgSwizzleRB (row, w);
+   }
+   return nvglStreamImage (ctx, image, rgba.data(), w * 4) != 0;
+}
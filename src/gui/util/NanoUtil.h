@@ -5,7 +5,12 @@
 #pragma once
 
 #include <cinder/Timer.h>
-#include "../nanogui/common.h"
+#include <cinder/Surface.h>
+#include <cinder/gl/Texture.h>
+#include <functional>
+#include "../nanogui/object.h"
+
+class ImageLoader;
 
 struct NanoUtil
 {
@@ -15,6 +20,22 @@ struct NanoUtil
       }
 
       static std::vector<std::pair<int, std::string>> loadImageDirectory (NVGcontext * ctx, const std::string & folder);
+      /// Queues the PNGs of a folder on the loader and returns them with its placeholder image. The
+      /// callback receives the index of each entry with its image once the loader created it. A non
+      /// zero \c thumbSize keeps square thumbnails of that size instead of the full images, small
+      /// enough to be packed into shared atlas pages
+      static std::vector<std::pair<int, std::string>> loadImageDirectory (ImageLoader & loader, const std::string & folder,
+            const std::function<void (size_t, int)> & callback, int thumbSize = 0);
+      /// Parses the SVGs of a folder into vector icons, which stay sharp at any size and scale
+      /// factor. Files that cannot be read are skipped
+      static std::vector<std::pair<nanogui::ref<nanogui::VectorIcon>, std::string>> loadVectorDirectory (const std::string & folder);
+
+      /// Wraps a Cinder texture as an image without copying it, flipped when its first row is the
+      /// bottom of the image. The texture has to outlive the image, deleting the image leaves it alone
+      static int createImage (NVGcontext * ctx, const cinder::gl::TextureRef & texture, int imageFlags = 0);
+      /// Copies an RGBA or BGRA surface of the size of an image into it through nvglStreamImage(), for
+      /// live sources updated every frame. Returns false for surfaces without alpha or in another order
+      static bool streamImage (NVGcontext * ctx, int image, const cinder::Surface8u & surface);
 
       static double getElapsedSeconds()
       {
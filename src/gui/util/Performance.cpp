@@ -3,6 +3,10 @@
 // Copyright (c) 2015, HurleyWorks
 
 #include "Performance.h"
+#include "TraceSink.h"
+#include "SampleQueue.h"
+#include "Profiler.h"
+#include "../nanogui/numberformat.h"
 #include "cinder/gl/gl.h"
 //#include "../resources/resources.h"
 
@@ -15,62 +19,230 @@
 // timer query support
 #ifndef GL_ARB_timer_query
    #define GL_TIME_ELAPSED                   0x88BF
-   //typedef void (APIENTRY *pfnGLGETQUERYOBJECTUI64V)(GLuint id, GLenum pname, GLuint64* params);
-   //pfnGLGETQUERYOBJECTUI64V glGetQueryObjectui64v = 0;
+   #define GL_TIMESTAMP                      0x8E28
 #endif
 
 void initGPUTimer (GPUtimer * timer)
 {
+   GLint major = 0, minor = 0;
    memset (timer, 0, sizeof (*timer));
-   /*	timer->supported = glfwExtensionSupported("GL_ARB_timer_query");
-      if (timer->supported) {*/
-   //#ifndef GL_ARB_timer_query
-   //glGetQueryObjectui64v = (pfnGLGETQUERYOBJECTUI64V)glfwGetProcAddress("glGetQueryObjectui64v");
-   ////printf("glGetQueryObjectui64v=%p\n", glGetQueryObjectui64v);
-   //if (!glGetQueryObjectui64v) {
-   //timer->supported = GL_FALSE;
-   //return;
-   //}*/
-   //#endif
+   // Timer queries are core since GL 3.3
+   glGetIntegerv (GL_MAJOR_VERSION, &major);
+   glGetIntegerv (GL_MINOR_VERSION, &minor);
+   timer->supported = major > 3 || (major == 3 && minor >= 3) || ci::gl::isExtensionAvailable ("GL_ARB_timer_query");
+   if (!timer->supported)
+      return;
    glGenQueries (GPU_QUERY_COUNT, timer->queries);
-   //}
+   glGenQueries (GPU_QUERY_COUNT, timer->endQueries);
+   for (int i = 0; i < GPU_TIMER_FRAMES; i++)
+      glGenQueries (GPU_TIMER_MAX_SCOPES * 2, timer->frames[i].queries);
+}
+
+void deleteGPUTimer (GPUtimer * timer)
+{
+   if (!timer->supported)
+      return;
+   glDeleteQueries (GPU_QUERY_COUNT, timer->queries);
+   glDeleteQueries (GPU_QUERY_COUNT, timer->endQueries);
+   for (int i = 0; i < GPU_TIMER_FRAMES; i++)
+      glDeleteQueries (GPU_TIMER_MAX_SCOPES * 2, timer->frames[i].queries);
+   timer->supported = 0;
+}
+
+static int isQueryAvailable (unsigned int query)
+{
+   GLint available = 0;
+   glGetQueryObjectiv (query, GL_QUERY_RESULT_AVAILABLE, &available);
+   return available;
+}
+
+// Reads back a frame of scopes if the GPU is done with it, merging siblings with the same name.
+static int collectGPUScopes (GPUtimer * timer, GPUscopeFrame * frame)
+{
+   int map[GPU_TIMER_MAX_SCOPES];
+   int i, j;
+   if (!frame->pending)
+      return 0;
+   // Queries complete in order, so the last end timestamp tells for the whole frame.
+   if (frame->nscopes > 0 && !isQueryAvailable (frame->queries[frame->nscopes * 2 - 1]))
+      return 0;
+   frame->pending = 0;
+   timer->nresults = 0;
+#ifdef NANOGUI_TRACE
+   // Map GPU timestamps onto the trace's CPU clock
+   GLint64 gpuNow = 0;
+   glGetInteger64v (GL_TIMESTAMP, &gpuNow);
+   int64_t gpuToCpu = TraceSink::now() - (int64_t)gpuNow;
+#endif
+   for (i = 0; i < frame->nscopes; i++)
+   {
+      GLuint64 begin = 0, end = 0;
+      int parent = frame->parents[i] >= 0 ? map[frame->parents[i]] : -1;
+      GPUscope * scope = NULL;
+      glGetQueryObjectui64v (frame->queries[i * 2], GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v (frame->queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+      for (j = parent + 1; j < timer->nresults; j++)
+      {
+         if (timer->scopes[j].parent == parent && strcmp (timer->scopes[j].name, frame->names[i]) == 0)
+         {
+            scope = &timer->scopes[j];
+            break;
+         }
+      }
+      if (scope == NULL)
+      {
+         scope = &timer->scopes[timer->nresults++];
+         scope->name = frame->names[i];
+         scope->depth = parent >= 0 ? timer->scopes[parent].depth + 1 : 0;
+         scope->parent = parent;
+         scope->count = 0;
+         scope->time = 0.0f;
+      }
+      map[i] = (int) (scope - timer->scopes);
+      TRACE_ZONE (frame->names[i], TraceSink::GpuTrack, (int64_t)begin + gpuToCpu, (int64_t)end + gpuToCpu);
+      scope->count++;
+      scope->time += (float) ((double) (end - begin) * 1e-9);
+   }
+   return 1;
 }
 
 void startGPUTimer (GPUtimer * timer)
 {
+   GPUscopeFrame * frame;
    if (!timer->supported)
       return;
-   glBeginQuery (GL_TIME_ELAPSED, timer->queries[timer->cur % GPU_QUERY_COUNT]);
-   timer->cur++;
+   // Skip the frame time rather than reuse a query that is still in flight.
+   timer->frameActive = timer->cur - timer->ret < GPU_QUERY_COUNT;
+   if (timer->frameActive)
+   {
+      glBeginQuery (GL_TIME_ELAPSED, timer->queries[timer->cur % GPU_QUERY_COUNT]);
+      timer->cur++;
+   }
+   // The same goes for scopes, a frame is dropped if its slot hasn't been read back yet.
+   timer->frame = (timer->frame + 1) % GPU_TIMER_FRAMES;
+   frame = &timer->frames[timer->frame];
+   collectGPUScopes (timer, frame);
+   timer->recording = !frame->pending;
+   timer->nstack = 0;
+   if (timer->recording)
+      frame->nscopes = 0;
 }
 
 int stopGPUTimer (GPUtimer * timer, float * times, int maxTimes)
 {
-   NVG_NOTUSED (times);
-   NVG_NOTUSED (maxTimes);
    GLint available = 1;
-   int n = 0;
+   int i, n = 0;
    if (!timer->supported)
       return 0;
-   glEndQuery (GL_TIME_ELAPSED);
-   while (available && timer->ret <= timer->cur)
+   if (timer->frameActive)
+      glEndQuery (GL_TIME_ELAPSED);
+   timer->frameActive = 0;
+   if (timer->recording)
+   {
+      while (timer->nstack > 0)
+         endGPUScope (timer);
+      timer->frames[timer->frame].pending = 1;
+      timer->recording = 0;
+   }
+   while (available && timer->ret < timer->cur)
    {
       // check for results if there are any
       glGetQueryObjectiv (timer->queries[timer->ret % GPU_QUERY_COUNT], GL_QUERY_RESULT_AVAILABLE, &available);
       if (available)
       {
-         /*			GLuint64 timeElapsed = 0;
-            glGetQueryObjectui64v(timer->queries[timer->ret % GPU_QUERY_COUNT], GL_QUERY_RESULT, &timeElapsed);
-            timer->ret++;
-            if (n < maxTimes) {
-            times[n] = (float)((double)timeElapsed * 1e-9);
+         GLuint64 timeElapsed = 0;
+         glGetQueryObjectui64v (timer->queries[timer->ret % GPU_QUERY_COUNT], GL_QUERY_RESULT, &timeElapsed);
+         timer->ret++;
+         if (n < maxTimes)
+         {
+            times[n] = (float) ((double)timeElapsed * 1e-9);
             n++;
-            }*/
+         }
       }
    }
+   // Pick up the oldest finished scope frames without waiting on the ones still in flight.
+   for (i = 1; i < GPU_TIMER_FRAMES; i++)
+      collectGPUScopes (timer, &timer->frames[(timer->frame + i) % GPU_TIMER_FRAMES]);
    return n;
 }
 
+void beginGPUScope (GPUtimer * timer, const char * name)
+{
+   GPUscopeFrame * frame = &timer->frames[timer->frame];
+   int index;
+   if (!timer->recording)
+      return;
+   if (frame->nscopes >= GPU_TIMER_MAX_SCOPES || timer->nstack >= GPU_TIMER_MAX_DEPTH)
+   {
+      // Still push so that the matching endGPUScope() is ignored too.
+      if (timer->nstack < GPU_TIMER_MAX_DEPTH)
+         timer->stack[timer->nstack++] = -1;
+      return;
+   }
+   index = frame->nscopes++;
+   frame->names[index] = name;
+   frame->parents[index] = timer->nstack > 0 ? timer->stack[timer->nstack - 1] : -1;
+   glQueryCounter (frame->queries[index * 2], GL_TIMESTAMP);
+   timer->stack[timer->nstack++] = index;
+}
+
+void endGPUScope (GPUtimer * timer)
+{
+   int index;
+   if (!timer->recording || timer->nstack == 0)
+      return;
+   index = timer->stack[--timer->nstack];
+   if (index >= 0)
+      glQueryCounter (timer->frames[timer->frame].queries[index * 2 + 1], GL_TIMESTAMP);
+}
+
+int getGPUScopes (GPUtimer * timer, const GPUscope ** scopes)
+{
+   *scopes = timer->scopes;
+   return timer->nresults;
+}
+
+void gpuTimerScopeCallback (void * userPtr, const char * name, int begin)
+{
+   GPUtimer * timer = (GPUtimer *)userPtr;
+   if (begin)
+      beginGPUScope (timer, name);
+   else
+      endGPUScope (timer);
+}
+
+
+void markGPUFrameEnd (GPUtimer * timer, double now, double inputTime)
+{
+   GLint64 gpuNow = 0;
+   int slot;
+   // Like frame times, skip the frame rather than reuse a query that is still in flight.
+   if (!timer->supported || inputTime < 0.0 || timer->endCur - timer->endRet >= GPU_QUERY_COUNT)
+      return;
+   slot = timer->endCur % GPU_QUERY_COUNT;
+   glQueryCounter (timer->endQueries[slot], GL_TIMESTAMP);
+   glGetInteger64v (GL_TIMESTAMP, &gpuNow);
+   timer->endInputTimes[slot] = inputTime;
+   timer->endOffsets[slot] = now - (double)gpuNow * 1e-9;
+   timer->endCur++;
+}
+
+int getGPUFrameLatencies (GPUtimer * timer, float * latencies, int maxLatencies)
+{
+   int n = 0;
+   if (!timer->supported)
+      return 0;
+   while (timer->endRet < timer->endCur && isQueryAvailable (timer->endQueries[timer->endRet % GPU_QUERY_COUNT]))
+   {
+      int slot = timer->endRet % GPU_QUERY_COUNT;
+      GLuint64 done = 0;
+      glGetQueryObjectui64v (timer->endQueries[slot], GL_QUERY_RESULT, &done);
+      timer->endRet++;
+      if (n < maxLatencies)
+         latencies[n++] = (float) ((double)done * 1e-9 + timer->endOffsets[slot] - timer->endInputTimes[slot]);
+   }
+   return n;
+}
 
 void initGraph (PerfGraph * fps, int style, const char * name)
 {
@@ -78,6 +250,7 @@ void initGraph (PerfGraph * fps, int style, const char * name)
    fps->style = style;
    strncpy (fps->name, name, sizeof (fps->name));
    fps->name[sizeof (fps->name) - 1] = '\0';
+   fps->font = -1;
 }
 
 void updateGraph (PerfGraph * fps, float frameTime)
@@ -86,6 +259,15 @@ void updateGraph (PerfGraph * fps, float frameTime)
    fps->values[fps->head] = frameTime;
 }
 
+void drainGraph (PerfGraph * fps, SampleQueue * queue)
+{
+   float values[GRAPH_HISTORY_COUNT];
+   size_t n;
+   while ((n = queue->pop (values, GRAPH_HISTORY_COUNT)) > 0)
+      for (size_t i = 0; i < n; i++)
+         updateGraph (fps, values[i]);
+}
+
 float getGraphAverage (PerfGraph * fps)
 {
    int i;
@@ -95,6 +277,13 @@ float getGraphAverage (PerfGraph * fps)
    return avg / (float)GRAPH_HISTORY_COUNT;
 }
 
+// Writes value with the given decimals and then suffix, without the locale or the heap.
+static void formatValue (char * str, double value, int decimals, const char * suffix)
+{
+   int n = nanogui::formatFloat (str, value, nanogui::NumberFormat::Fixed, decimals);
+   strcpy (str + n, suffix);
+}
+
 void renderGraph (NVGcontext * vg, float x, float y, PerfGraph * fps, NVGcolor color)
 {
    int i;
@@ -149,7 +338,12 @@ void renderGraph (NVGcontext * vg, float x, float y, PerfGraph * fps, NVGcolor c
    nvgLineTo (vg, x + w, y + h);
    nvgFillColor (vg, color);
    nvgFill (vg);
-   nvgFontFace (vg, "sans");
+   if (fps->font < 0 && fps->fontCount != nvgFontCount (vg))
+   {
+      fps->font = nvgFindFont (vg, "sans");
+      fps->fontCount = nvgFontCount (vg);
+   }
+   nvgFontFaceId (vg, fps->font);
    if (fps->name[0] != '\0')
    {
       nvgFontSize (vg, 14.0f);
@@ -162,12 +356,12 @@ void renderGraph (NVGcontext * vg, float x, float y, PerfGraph * fps, NVGcolor c
       nvgFontSize (vg, 18.0f);
       nvgTextAlign (vg, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP);
       nvgFillColor (vg, nvgRGBA (240, 240, 240, 255));
-      sprintf (str, "%.2f FPS", 1.0f / avg);
+      formatValue (str, 1.0f / avg, 2, " FPS");
       nvgText (vg, x + w - 3, y + 1, str, NULL);
       nvgFontSize (vg, 15.0f);
       nvgTextAlign (vg, NVG_ALIGN_RIGHT | NVG_ALIGN_BOTTOM);
       nvgFillColor (vg, nvgRGBA (240, 240, 240, 160));
-      sprintf (str, "%.2f ms", avg * 1000.0f);
+      formatValue (str, avg * 1000.0f, 2, " ms");
       nvgText (vg, x + w - 3, y + h - 1, str, NULL);
    }
    else
@@ -176,7 +370,7 @@ void renderGraph (NVGcontext * vg, float x, float y, PerfGraph * fps, NVGcolor c
          nvgFontSize (vg, 18.0f);
          nvgTextAlign (vg, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP);
          nvgFillColor (vg, nvgRGBA (240, 240, 240, 255));
-         sprintf (str, "%.1f %%", avg * 1.0f);
+         formatValue (str, avg * 1.0f, 1, " %");
          nvgText (vg, x + w - 3, y + 1, str, NULL);
       }
       else
@@ -184,7 +378,332 @@ void renderGraph (NVGcontext * vg, float x, float y, PerfGraph * fps, NVGcolor c
          nvgFontSize (vg, 18.0f);
          nvgTextAlign (vg, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP);
          nvgFillColor (vg, nvgRGBA (240, 240, 240, 255));
-         sprintf (str, "%.2f ms", avg * 1000.0f);
+         formatValue (str, avg * 1000.0f, 2, " ms");
          nvgText (vg, x + w - 3, y + 1, str, NULL);
       }
 }
+
+static const double perfHistorySpans[PERF_HISTORY_RESOLUTIONS] = { 0.0, 1.0, 60.0, 600.0 };
+
+void initPerfHistory (PerfHistory * history)
+{
+   memset (history, 0, sizeof (*history));
+}
+
+static void pushPerfBucket (PerfHistoryRing * ring, const PerfBucket * bucket)
+{
+   ring->buckets[ring->head] = *bucket;
+   ring->head = (ring->head + 1) % PERF_HISTORY_CAPACITY;
+   if (ring->count < PERF_HISTORY_CAPACITY)
+      ring->count++;
+   ring->total++;
+}
+
+void updatePerfHistory (PerfHistory * history, double time, float value)
+{
+   int i;
+   PerfBucket sample;
+   sample.min = sample.avg = sample.max = value;
+   sample.time = time;
+   pushPerfBucket (&history->rings[PERF_HISTORY_FRAMES], &sample);
+   for (i = PERF_HISTORY_SECONDS; i < PERF_HISTORY_RESOLUTIONS; i++)
+   {
+      PerfHistoryRing * ring = &history->rings[i];
+      double span = perfHistorySpans[i];
+      if (ring->openCount > 0 && time >= ring->open.time + span)
+      {
+         ring->open.avg /= (float)ring->openCount;
+         pushPerfBucket (ring, &ring->open);
+         ring->openCount = 0;
+      }
+      // Buckets start on multiples of their span, with gaps where no samples came
+      if (ring->openCount == 0)
+      {
+         ring->open = sample;
+         ring->open.avg = 0.0f;
+         ring->open.time = floor (time / span) * span;
+      }
+      if (value < ring->open.min)
+         ring->open.min = value;
+      if (value > ring->open.max)
+         ring->open.max = value;
+      ring->open.avg += value;
+      ring->openCount++;
+   }
+}
+
+double getPerfHistorySpan (int resolution)
+{
+   return perfHistorySpans[resolution];
+}
+
+int getPerfHistory (const PerfHistory * history, int resolution, PerfBucket * buckets, int maxBuckets)
+{
+   const PerfHistoryRing * ring = &history->rings[resolution];
+   int i, n = ring->count < maxBuckets ? ring->count : maxBuckets;
+   int start = ring->head + PERF_HISTORY_CAPACITY - n;
+   for (i = 0; i < n; i++)
+      buckets[i] = ring->buckets[(start + i) % PERF_HISTORY_CAPACITY];
+   return n;
+}
+
+// Bucket of a frame time, see FRAME_HISTOGRAM_SUB_BUCKETS.
+static int histogramBucket (float frameTime)
+{
+   const unsigned int limit = 1u << (5 + FRAME_HISTOGRAM_OCTAVES);
+   double us = (double)frameTime * 1e6 + 0.5;
+   unsigned int u, e;
+   if (!(us > 0.0))
+      return 0;
+   u = us < (double)limit ? (unsigned int)us : limit - 1;
+   if (u < FRAME_HISTOGRAM_SUB_BUCKETS)
+      return (int)u;
+   for (e = 0; (u >> e) >= 2 * FRAME_HISTOGRAM_SUB_BUCKETS; e++)
+      ;
+   return (int) ((e + 1) * FRAME_HISTOGRAM_SUB_BUCKETS + (u >> e) - FRAME_HISTOGRAM_SUB_BUCKETS);
+}
+
+// Upper bound of a bucket in seconds.
+static float histogramBucketLimit (int bucket)
+{
+   unsigned int e = 0, m = (unsigned int)bucket;
+   if (bucket >= FRAME_HISTOGRAM_SUB_BUCKETS)
+   {
+      e = bucket / FRAME_HISTOGRAM_SUB_BUCKETS - 1;
+      m = bucket % FRAME_HISTOGRAM_SUB_BUCKETS + FRAME_HISTOGRAM_SUB_BUCKETS;
+   }
+   return (float) ((double) ((m + 1) << e) * 1e-6);
+}
+
+void initFrameHistogram (FrameHistogram * hist, int window)
+{
+   memset (hist, 0, sizeof (*hist));
+   hist->window = window < 0 ? 0 : window < FRAME_HISTOGRAM_MAX_WINDOW ? window : FRAME_HISTOGRAM_MAX_WINDOW;
+   hist->font = -1;
+}
+
+void updateFrameHistogram (FrameHistogram * hist, float frameTime)
+{
+   int i, rescan = 0;
+   if (hist->window > 0)
+   {
+      if (hist->total == hist->window)
+      {
+         float old = hist->samples[hist->head];
+         hist->counts[histogramBucket (old)]--;
+         hist->total--;
+         rescan = old >= hist->max;
+      }
+      hist->samples[hist->head] = frameTime;
+      hist->head = (hist->head + 1) % hist->window;
+   }
+   hist->counts[histogramBucket (frameTime)]++;
+   hist->total++;
+   // The maximum left the window, the window is full then
+   if (rescan)
+   {
+      hist->max = 0.0f;
+      for (i = 0; i < hist->window; i++)
+         if (hist->samples[i] > hist->max)
+            hist->max = hist->samples[i];
+   }
+   else
+      if (frameTime > hist->max)
+         hist->max = frameTime;
+}
+
+float getFrameHistogramPercentile (const FrameHistogram * hist, float percent)
+{
+   int i, seen = 0, rank;
+   if (hist->total == 0)
+      return 0.0f;
+   rank = (int)ceil ((double)percent / 100.0 * hist->total);
+   if (rank < 1)
+      rank = 1;
+   for (i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++)
+   {
+      seen += hist->counts[i];
+      if (seen >= rank)
+      {
+         float limit = histogramBucketLimit (i);
+         return limit < hist->max ? limit : hist->max;
+      }
+   }
+   return hist->max;
+}
+
+void getFrameHistogramStats (const FrameHistogram * hist, FrameTimeStats * stats)
+{
+   stats->count = hist->total;
+   stats->p50 = getFrameHistogramPercentile (hist, 50.0f);
+   stats->p95 = getFrameHistogramPercentile (hist, 95.0f);
+   stats->p99 = getFrameHistogramPercentile (hist, 99.0f);
+   stats->max = hist->total > 0 ? hist->max : 0.0f;
+}
+
+// Writes label and then the time in milliseconds.
+static void formatStat (char * str, const char * label, float seconds)
+{
+   size_t n = strlen (label);
+   memcpy (str, label, n);
+   formatValue (str + n, seconds * 1000.0f, 2, " ms");
+}
+
+void renderFrameStats (NVGcontext * vg, float x, float y, FrameHistogram * hist, NVGcolor color)
+{
+   FrameTimeStats stats;
+   float w = 200, h = 35;
+   char str[64];
+   getFrameHistogramStats (hist, &stats);
+   nvgBeginPath (vg);
+   nvgRect (vg, x, y, w, h);
+   nvgFillColor (vg, nvgRGBA (0, 0, 0, 128));
+   nvgFill (vg);
+   // The bar runs up to the maximum, the mark is the 99th percentile, on the scale of renderGraph()
+   nvgBeginPath (vg);
+   nvgRect (vg, x, y + h - 4, w * fminf (stats.max * 1000.0f / 20.0f, 1.0f), 4);
+   nvgFillColor (vg, color);
+   nvgFill (vg);
+   nvgBeginPath (vg);
+   nvgRect (vg, x + (w - 2) * fminf (stats.p99 * 1000.0f / 20.0f, 1.0f), y + h - 8, 2, 8);
+   nvgFillColor (vg, nvgRGBA (240, 240, 240, 192));
+   nvgFill (vg);
+   if (hist->font < 0 && hist->fontCount != nvgFontCount (vg))
+   {
+      hist->font = nvgFindFont (vg, "sans");
+      hist->fontCount = nvgFontCount (vg);
+   }
+   nvgFontFaceId (vg, hist->font);
+   nvgFontSize (vg, 14.0f);
+   nvgTextAlign (vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+   nvgFillColor (vg, nvgRGBA (240, 240, 240, 192));
+   formatStat (str, "p50 ", stats.p50);
+   nvgText (vg, x + 3, y + 1, str, NULL);
+   formatStat (str, "p95 ", stats.p95);
+   nvgText (vg, x + w / 2, y + 1, str, NULL);
+   formatStat (str, "p99 ", stats.p99);
+   nvgText (vg, x + 3, y + 15, str, NULL);
+   formatStat (str, "max ", stats.max);
+   nvgText (vg, x + w / 2, y + 15, str, NULL);
+}
+
+HitchDetector::HitchDetector (float threshold, int capacity)
+   : mThreshold (threshold), mCapacity (capacity > 1 ? capacity : 1)
+{
+   memset (&mLastStats, 0, sizeof (mLastStats));
+}
+
+void HitchDetector::setCapacity (int capacity)
+{
+   if (capacity < 1)
+      capacity = 1;
+   // Unroll the ring, dropping the oldest reports that no longer fit
+   std::vector<SlowFrameReport> reports;
+   for (int i = count() > capacity ? count() - capacity : 0; i < count(); i++)
+      reports.push_back (std::move (mReports[(mHead + i) % mReports.size()]));
+   mReports.swap (reports);
+   mHead = 0;
+   mCapacity = capacity;
+}
+
+void HitchDetector::noteEvent (std::string event)
+{
+   if (mEvents.size() < MaxEventsPerFrame)
+      mEvents.push_back (std::move (event));
+}
+
+bool HitchDetector::endFrame (float frameTime, float cpuTime, const NVGframeStats & stats)
+{
+   // The first call has no frame drawn at the start of its interval
+   bool slow = mFrames > 0 && frameTime > mThreshold;
+   if (slow)
+   {
+      SlowFrameReport report;
+      report.frame = mFrames;
+      report.frameTime = frameTime;
+      report.cpuTime = mLastCpuTime;
+      report.stats = mLastStats;
+      // The profiler closed the frame drawn at the start of the interval when the last one began
+      Profiler & profiler = Profiler::instance();
+      if (profiler.enabled())
+      {
+         for (const Profiler::ZoneStats & zone : profiler.zones())
+         {
+            if (zone.calls > 0)
+               report.zones.push_back ({ zone.name, zone.depth, zone.calls, zone.last });
+         }
+      }
+      report.events.swap (mEvents);
+      if ((int)mReports.size() < mCapacity)
+         mReports.push_back (std::move (report));
+      else
+      {
+         mReports[mHead] = std::move (report);
+         mHead = (mHead + 1) % mReports.size();
+      }
+      mHitches++;
+   }
+   mEvents.clear();
+   mLastStats = stats;
+   mLastCpuTime = cpuTime;
+   mFrames++;
+   return slow;
+}
+
+void HitchDetector::clear()
+{
+   mReports.clear();
+   mHead = 0;
+   mHitches = 0;
+}
+
+void HitchDetector::dump (FILE * file) const
+{
+   for (int i = 0; i < count(); i++)
+   {
+      const SlowFrameReport & r = report (i);
+      fprintf (file, "Slow frame %d: %.2f ms, CPU %.2f ms, %d draw calls (%d GL), %d triangles, %d stencil passes\n",
+               r.frame, r.frameTime * 1000.0, r.cpuTime * 1000.0, r.stats.drawCalls, r.stats.glDrawCalls,
+               r.stats.fillTriCount + r.stats.strokeTriCount + r.stats.textTriCount, r.stats.stencilPasses);
+      for (const SlowFrameReport::Zone & zone : r.zones)
+         fprintf (file, "   %*s%s: %.3f ms, %d calls\n", zone.depth * 2, "", zone.name, zone.time * 1000.0, zone.calls);
+      for (const std::string & event : r.events)
+         fprintf (file, "   event: %s\n", event.c_str());
+   }
+}
+
+void renderHitches (NVGcontext * vg, float x, float y, const HitchDetector & detector, int maxReports)
+{
+   int n = detector.count() < maxReports ? detector.count() : maxReports;
+   int font = nvgFindFont (vg, "sans");
+   float w = 410, lineHeight = 16;
+   char str[160];
+   if (n <= 0 || font < 0)
+      return;
+   nvgBeginPath (vg);
+   nvgRect (vg, x, y - n * lineHeight - 4, w, n * lineHeight + 4);
+   nvgFillColor (vg, nvgRGBA (0, 0, 0, 128));
+   nvgFill (vg);
+   nvgFontFaceId (vg, font);
+   nvgFontSize (vg, 14.0f);
+   nvgTextAlign (vg, NVG_ALIGN_LEFT | NVG_ALIGN_BOTTOM);
+   nvgFillColor (vg, nvgRGBA (240, 200, 120, 255));
+   for (int i = 0; i < n; i++)
+   {
+      const SlowFrameReport & r = detector.report (detector.count() - 1 - i);
+      // The top level zone spans the frame, the slowest one below it says more
+      const SlowFrameReport::Zone * slowest = NULL;
+      for (const SlowFrameReport::Zone & zone : r.zones)
+      {
+         if (zone.depth > 0 && (!slowest || zone.time > slowest->time))
+            slowest = &zone;
+      }
+      int len = snprintf (str, sizeof (str), "#%d  %.1f ms  CPU %.1f ms  %d draws", r.frame,
+                          r.frameTime * 1000.0, r.cpuTime * 1000.0, r.stats.drawCalls);
+      if (slowest && len > 0 && len < (int)sizeof (str))
+         len += snprintf (str + len, sizeof (str) - len, "  %s %.1f ms", slowest->name, slowest->time * 1000.0);
+      if (!r.events.empty() && len > 0 && len < (int)sizeof (str))
+         snprintf (str + len, sizeof (str) - len, "  %d events", (int)r.events.size());
+      nvgText (vg, x + 3, y - 2 - i * lineHeight, str, NULL);
+   }
+}
@@ -24,6 +24,8 @@ struct PerfGraph
    char name[32];
    float values[GRAPH_HISTORY_COUNT];
    int head;
+   int font;			// handle of "sans", looked up again when fontCount changed while it was missing
+   int fontCount;
 };
 typedef struct PerfGraph PerfGraph;
 
@@ -32,19 +34,257 @@ void updateGraph (PerfGraph * fps, float frameTime);
 void renderGraph (NVGcontext * vg, float x, float y, PerfGraph * fps, NVGcolor color = nvgRGBA (128, 128, 0, 128));
 float getGraphAverage (PerfGraph * fps);
 
+// Long history of a value, e.g. the frame time, at several resolutions: every sample, then the
+// minimum, average and maximum of each second, minute and ten minutes. Each resolution is a ring of
+// PERF_HISTORY_CAPACITY buckets, so updates take constant time and the memory stays fixed however
+// long the history runs. A bucket is closed by the first sample past its end.
+#define PERF_HISTORY_CAPACITY 600
+enum PerfHistoryResolution
+{
+   PERF_HISTORY_FRAMES,			// 10 seconds at 60 Hz
+   PERF_HISTORY_SECONDS,		// 10 minutes
+   PERF_HISTORY_MINUTES,		// 10 hours
+   PERF_HISTORY_TEN_MINUTES,	// 100 hours
+   PERF_HISTORY_RESOLUTIONS
+};
+
+struct PerfBucket
+{
+   float min, avg, max;
+   double time;					// start of the bucket, seconds
+};
+typedef struct PerfBucket PerfBucket;
+
+struct PerfHistoryRing
+{
+   PerfBucket buckets[PERF_HISTORY_CAPACITY];
+   int head;
+   int count;
+   unsigned int total;			// buckets closed so far, tells readers which ones are new
+   PerfBucket open;				// accumulated, avg holds the sum
+   int openCount;
+};
+typedef struct PerfHistoryRing PerfHistoryRing;
+
+struct PerfHistory
+{
+   PerfHistoryRing rings[PERF_HISTORY_RESOLUTIONS];
+};
+typedef struct PerfHistory PerfHistory;
+
+void initPerfHistory (PerfHistory * history);
+// time in seconds of a clock that never goes back.
+void updatePerfHistory (PerfHistory * history, double time, float value);
+// Seconds a bucket of the resolution spans, 0 for PERF_HISTORY_FRAMES.
+double getPerfHistorySpan (int resolution);
+// Copies the newest maxBuckets closed buckets of a resolution, oldest first, returns how many.
+int getPerfHistory (const PerfHistory * history, int resolution, PerfBucket * buckets, int maxBuckets);
+
+// Frame times in buckets of about 3 % relative width, from 1 us up to half a minute, like an
+// HDR histogram: linear up to 32 us, then 32 linear buckets per octave. Percentiles are read from
+// the buckets, so they come out as the upper bound of theirs; the maximum is exact.
+#define FRAME_HISTOGRAM_SUB_BUCKETS 32
+#define FRAME_HISTOGRAM_OCTAVES 20
+#define FRAME_HISTOGRAM_BUCKETS ((FRAME_HISTOGRAM_OCTAVES + 1) * FRAME_HISTOGRAM_SUB_BUCKETS)
+#define FRAME_HISTOGRAM_MAX_WINDOW 3600
+struct FrameHistogram
+{
+   int window;			// frames covered, 0 for all frames since initFrameHistogram()
+   int counts[FRAME_HISTOGRAM_BUCKETS];
+   int total;			// frames in the buckets
+   float samples[FRAME_HISTOGRAM_MAX_WINDOW];	// the frames in the window, oldest at head once full
+   int head;
+   float max;
+   int font;			// handle of "sans", see PerfGraph
+   int fontCount;
+};
+typedef struct FrameHistogram FrameHistogram;
+
+struct FrameTimeStats
+{
+   int count;
+   float p50, p95, p99, max;	// seconds
+};
+typedef struct FrameTimeStats FrameTimeStats;
+
+// window is clamped to FRAME_HISTOGRAM_MAX_WINDOW frames.
+void initFrameHistogram (FrameHistogram * hist, int window);
+void updateFrameHistogram (FrameHistogram * hist, float frameTime);
+// Returns the time in seconds that percent of the frames in the window took at most, 0 when empty.
+float getFrameHistogramPercentile (const FrameHistogram * hist, float percent);
+void getFrameHistogramStats (const FrameHistogram * hist, FrameTimeStats * stats);
+// Draws the percentiles of the window into a box of the size of renderGraph()'s.
+void renderFrameStats (NVGcontext * vg, float x, float y, FrameHistogram * hist, NVGcolor color = nvgRGBA (128, 128, 0, 128));
+
 #define GPU_QUERY_COUNT 5
+#define GPU_TIMER_FRAMES 4			// frames whose scope queries may be in flight
+#define GPU_TIMER_MAX_SCOPES 256	// scopes recorded per frame, further scopes are dropped
+#define GPU_TIMER_MAX_DEPTH 16
+
+// Accumulated GPU time of all scopes with the same name under the same parent.
+struct GPUscope
+{
+   const char * name;
+   int depth;
+   int parent;		// index into the scope array, -1 for top level scopes
+   int count;
+   float time;		// seconds
+};
+typedef struct GPUscope GPUscope;
+
+struct GPUscopeFrame
+{
+   unsigned int queries[GPU_TIMER_MAX_SCOPES * 2];	// begin and end timestamps
+   const char * names[GPU_TIMER_MAX_SCOPES];
+   int parents[GPU_TIMER_MAX_SCOPES];
+   int nscopes;
+   int pending;
+};
+typedef struct GPUscopeFrame GPUscopeFrame;
+
 struct GPUtimer
 {
    int supported;
    int cur, ret;
    unsigned int queries[GPU_QUERY_COUNT];
+   int frameActive;
+   // Nested scopes, timed with timestamp queries
+   GPUscopeFrame frames[GPU_TIMER_FRAMES];
+   int frame;
+   int recording;
+   int stack[GPU_TIMER_MAX_DEPTH];
+   int nstack;
+   GPUscope scopes[GPU_TIMER_MAX_SCOPES];
+   int nresults;
+   // Frame end timestamps for the input latency, see markGPUFrameEnd()
+   unsigned int endQueries[GPU_QUERY_COUNT];
+   double endInputTimes[GPU_QUERY_COUNT];
+   double endOffsets[GPU_QUERY_COUNT];	// CPU clock minus GPU clock when the frame ended, seconds
+   int endCur, endRet;
 };
 typedef struct GPUtimer GPUtimer;
 
 void initGPUTimer (GPUtimer * timer);
+void deleteGPUTimer (GPUtimer * timer);
 void startGPUTimer (GPUtimer * timer);
 int stopGPUTimer (GPUtimer * timer, float * times, int maxTimes);
 
+// Named GPU scopes between startGPUTimer() and stopGPUTimer(). Scopes nest, names must stay valid
+// until the frame's results have been read back (string literals are the usual choice).
+void beginGPUScope (GPUtimer * timer, const char * name);
+void endGPUScope (GPUtimer * timer);
+// Returns the scopes of the most recent frame whose results are available, in pre-order.
+int getGPUScopes (GPUtimer * timer, const GPUscope ** scopes);
+// Adapter for nvglSetProfileCallback(), userPtr is the GPUtimer.
+void gpuTimerScopeCallback (void * userPtr, const char * name, int begin);
+
+// Input latency of frames. Call after the GPU commands of a frame were issued, with the current
+// time and the time its oldest input was received, both in seconds of the same CPU clock; frames
+// with a negative inputTime are skipped. A timestamp query records when the GPU finished the
+// frame, mapped to the CPU clock through GL_TIMESTAMP. The scanout that follows is not included.
+void markGPUFrameEnd (GPUtimer * timer, double now, double inputTime);
+// Returns the latencies in seconds of the marked frames whose timestamps are available, oldest first.
+int getGPUFrameLatencies (GPUtimer * timer, float * latencies, int maxLatencies);
+
 #ifdef __cplusplus
 }
 #endif
+
+#ifdef __cplusplus
+class SampleQueue;
+
+// Moves the values another thread pushed into queue into the graph, oldest first, as if each had
+// been passed to updateGraph(). Call on the thread that renders the graph.
+void drainGraph (PerfGraph * fps, SampleQueue * queue);
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// What was going on in a frame that took longer than the threshold of a HitchDetector.
+struct SlowFrameReport
+{
+   struct Zone
+   {
+      const char * name;
+      int depth;
+      int calls;
+      double time;			// seconds
+   };
+
+   int frame;					// frames passed to HitchDetector::endFrame() before this one
+   float frameTime;			// seconds
+   float cpuTime;
+   NVGframeStats stats;
+   std::vector<Zone> zones;	// profiler zones that ran, in pre-order, none while the profiler is off
+   std::vector<std::string> events;
+};
+
+// Keeps reports of the frames that took longer than a threshold in a ring. Frames are timed from
+// the start of one to the start of the next, so the report of a slow interval holds the nanovg
+// statistics, CPU time and profiler zones of the frame drawn at its start and the events noted
+// during it.
+class HitchDetector
+{
+   public:
+      static const int MaxEventsPerFrame = 64;
+
+      explicit HitchDetector (float threshold = 1.0f / 30.0f, int capacity = 16);
+
+      void setThreshold (float seconds)
+      {
+         mThreshold = seconds;
+      }
+      float threshold() const
+      {
+         return mThreshold;
+      }
+      // Keeps the newest reports when shrinking
+      void setCapacity (int capacity);
+      int capacity() const
+      {
+         return mCapacity;
+      }
+
+      // Notes an input event or the like for the report of the current frame, the first
+      // MaxEventsPerFrame per frame are kept
+      void noteEvent (std::string event);
+      // Call once per frame after drawing, with the time since the previous call. Returns whether
+      // the interval was slow and a report was captured.
+      bool endFrame (float frameTime, float cpuTime, const NVGframeStats & stats);
+
+      // Reports in the ring, 0 is the oldest
+      int count() const
+      {
+         return (int) mReports.size();
+      }
+      const SlowFrameReport & report (int i) const
+      {
+         return mReports[(mHead + i) % mReports.size()];
+      }
+      // Slow frames seen since construction or clear(), including those that left the ring
+      int hitches() const
+      {
+         return mHitches;
+      }
+      void clear();
+
+      // Writes the reports in the ring as text, oldest first
+      void dump (FILE * file) const;
+
+   private:
+      float mThreshold;
+      int mCapacity;
+      std::vector<SlowFrameReport> mReports;
+      int mHead = 0;
+      int mHitches = 0;
+      int mFrames = 0;
+      std::vector<std::string> mEvents;
+      NVGframeStats mLastStats;		// of the frame drawn at the start of the current interval
+      float mLastCpuTime = 0.0f;
+};
+
+// Lists the newest maxReports reports of detector upwards from y, one line each, nothing when
+// there are none.
+void renderHitches (NVGcontext * vg, float x, float y, const HitchDetector & detector, int maxReports = 4);
+#endif
@@ -0,0 +1,143 @@
+// Editable text stored as a piece table, with an index of its lines
+// Copyright (c) 2015, HurleyWorks
+
+#include "PieceTable.h"
+#include <algorithm>
+
+PieceTable::PieceTable (const std::string & text)
+{
+   assign (text);
+}
+
+void PieceTable::assign (const std::string & text)
+{
+   mOriginal = text;
+   mAdded.clear();
+   mPieces.clear();
+   if (!text.empty())
+      mPieces.push_back (Piece { false, 0, text.size() });
+   mSize = text.size();
+   mLineStarts.assign (1, 0);
+   for (size_t i = 0; i < text.size(); ++i)
+      if (text[i] == '\n')
+         mLineStarts.push_back (i + 1);
+}
+
+size_t PieceTable::lineOf (size_t pos) const
+{
+   return (size_t) (std::upper_bound (mLineStarts.begin(), mLineStarts.end(), pos) - mLineStarts.begin()) - 1;
+}
+
+size_t PieceTable::find (size_t pos, size_t & offset) const
+{
+   size_t start = 0;
+   for (size_t i = 0; i < mPieces.size(); ++i)
+   {
+      if (pos < start + mPieces[i].length)
+      {
+         offset = pos - start;
+         return i;
+      }
+      start += mPieces[i].length;
+   }
+   offset = 0;
+   return mPieces.size();
+}
+
+void PieceTable::insert (size_t pos, const char * text, size_t count)
+{
+   if (count == 0)
+      return;
+   pos = std::min (pos, mSize);
+   /* Lines after the insertion move, every '\n' inserted starts a new one */
+   size_t line = lineOf (pos);
+   for (size_t i = line + 1; i < mLineStarts.size(); ++i)
+      mLineStarts[i] += count;
+   std::vector<size_t> starts;
+   for (size_t i = 0; i < count; ++i)
+      if (text[i] == '\n')
+         starts.push_back (pos + i + 1);
+   mLineStarts.insert (mLineStarts.begin() + line + 1, starts.begin(), starts.end());
+
+   size_t added = mAdded.size();
+   mAdded.append (text, count);
+   mSize += count;
+   size_t offset;
+   size_t i = find (pos, offset);
+   if (offset == 0)
+   {
+      /* Right behind the previous insertion: grow its piece */
+      if (i > 0 && mPieces[i - 1].added && mPieces[i - 1].start + mPieces[i - 1].length == added)
+      {
+         mPieces[i - 1].length += count;
+         return;
+      }
+      mPieces.insert (mPieces.begin() + i, Piece { true, added, count });
+      return;
+   }
+   Piece tail = mPieces[i];
+   tail.start += offset;
+   tail.length -= offset;
+   mPieces[i].length = offset;
+   Piece pieces[2] = { Piece { true, added, count }, tail };
+   mPieces.insert (mPieces.begin() + i + 1, pieces, pieces + 2);
+}
+
+void PieceTable::erase (size_t pos, size_t count)
+{
+   if (pos >= mSize)
+      return;
+   count = std::min (count, mSize - pos);
+   if (count == 0)
+      return;
+   /* Lines starting inside the erased range disappear, those behind it move */
+   auto first = std::upper_bound (mLineStarts.begin(), mLineStarts.end(), pos);
+   auto last = std::upper_bound (first, mLineStarts.end(), pos + count);
+   for (auto it = last; it != mLineStarts.end(); ++it)
+      *it -= count;
+   mLineStarts.erase (first, last);
+
+   size_t offset;
+   size_t i = find (pos, offset);
+   if (offset > 0)
+   {
+      Piece tail = mPieces[i];
+      tail.start += offset;
+      tail.length -= offset;
+      mPieces[i].length = offset;
+      mPieces.insert (mPieces.begin() + ++i, tail);
+   }
+   size_t remaining = count, end = i;
+   while (remaining > 0 && mPieces[end].length <= remaining)
+      remaining -= mPieces[end++].length;
+   if (remaining > 0)
+   {
+      mPieces[end].start += remaining;
+      mPieces[end].length -= remaining;
+   }
+   mPieces.erase (mPieces.begin() + i, mPieces.begin() + end);
+   mSize -= count;
+}
+
+char PieceTable::at (size_t pos) const
+{
+   size_t offset;
+   size_t i = find (pos, offset);
+   return i < mPieces.size() ? data (mPieces[i])[offset] : '\0';
+}
+
+std::string PieceTable::substr (size_t pos, size_t count) const
+{
+   std::string result;
+   if (pos >= mSize)
+      return result;
+   count = std::min (count, mSize - pos);
+   result.reserve (count);
+   size_t offset;
+   for (size_t i = find (pos, offset); i < mPieces.size() && result.size() < count; ++i, offset = 0)
+   {
+      size_t n = std::min (mPieces[i].length - offset, count - result.size());
+      result.append (data (mPieces[i]) + offset, n);
+   }
+   return result;
+}
@@ -0,0 +1,82 @@
+// Editable text stored as a piece table, with an index of its lines
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Text made of pieces of two buffers: the text it was created with, which is never modified, and
+// an append-only buffer of everything inserted since. An edit splits or trims a few pieces instead
+// of moving the text behind it, and typing at the same place keeps growing a single piece. The
+// start of every line is kept alongside, so that a line is found by binary search. Positions are
+// byte offsets.
+class PieceTable
+{
+   public:
+      explicit PieceTable (const std::string & text = std::string());
+
+      /// Replace the whole text, dropping the buffer of insertions
+      void assign (const std::string & text);
+
+      size_t size() const
+      {
+         return mSize;
+      }
+      bool empty() const
+      {
+         return mSize == 0;
+      }
+
+      void insert (size_t pos, const char * text, size_t count);
+      void insert (size_t pos, const std::string & text)
+      {
+         insert (pos, text.data(), text.size());
+      }
+      void erase (size_t pos, size_t count);
+
+      char at (size_t pos) const;
+      std::string substr (size_t pos, size_t count) const;
+      std::string text() const
+      {
+         return substr (0, mSize);
+      }
+
+      /// Number of lines, one more than the number of '\n'
+      size_t lineCount() const
+      {
+         return mLineStarts.size();
+      }
+      size_t lineStart (size_t line) const
+      {
+         return mLineStarts[line];
+      }
+      /// Position of the '\n' ending a line, or the size for the last one
+      size_t lineEnd (size_t line) const
+      {
+         return line + 1 < mLineStarts.size() ? mLineStarts[line + 1] - 1 : mSize;
+      }
+      /// Line containing a position
+      size_t lineOf (size_t pos) const;
+
+   private:
+      struct Piece
+      {
+         bool added;	// in mAdded rather than mOriginal
+         size_t start;
+         size_t length;
+      };
+
+      /// Piece containing pos and the offset of pos in it; the number of pieces for the end
+      size_t find (size_t pos, size_t & offset) const;
+      const char * data (const Piece & piece) const
+      {
+         return (piece.added ? mAdded.data() : mOriginal.data()) + piece.start;
+      }
+
+      std::string mOriginal, mAdded;
+      std::vector<Piece> mPieces;
+      std::vector<size_t> mLineStarts;
+      size_t mSize = 0;
+};
@@ -0,0 +1,161 @@
+// Hierarchical CPU frame profiler
+// Copyright (c) 2015, HurleyWorks
+
+#include "Profiler.h"
+#include "TraceSink.h"
+#include <algorithm>
+#include <cstring>
+
+Profiler & Profiler::instance()
+{
+   static Profiler profiler;
+   return profiler;
+}
+
+// Buffers are never freed: endFrame() may still be draining the buffer of a thread that just exited.
+Profiler::ThreadBuffer * Profiler::threadBuffer()
+{
+   static thread_local ThreadBuffer * buffer = nullptr;
+   if (!buffer)
+   {
+      Profiler & profiler = instance();
+      buffer = new ThreadBuffer();
+      std::lock_guard<std::mutex> lock (profiler.mBuffersMutex);
+      buffer->track = (int)profiler.mBuffers.size();
+      profiler.mBuffers.push_back (buffer);
+   }
+   return buffer;
+}
+
+void Profiler::beginZone (const char * name)
+{
+   if (!instance().enabled())
+      return;
+   ThreadBuffer * buffer = threadBuffer();
+   std::lock_guard<std::mutex> lock (buffer->mutex);
+   Event e;
+   e.name = name;
+   e.parent = buffer->stack.empty() ? -1 : buffer->stack.back();
+   e.start = Clock::now();
+   buffer->stack.push_back ((int)buffer->events.size());
+   buffer->events.push_back (e);
+}
+
+void Profiler::endZone()
+{
+   if (!instance().enabled())
+      return;
+   Clock::time_point now = Clock::now();
+   ThreadBuffer * buffer = threadBuffer();
+   std::lock_guard<std::mutex> lock (buffer->mutex);
+   /* Zones opened before the profiler was enabled have nothing to close */
+   if (buffer->stack.empty())
+      return;
+   buffer->events[buffer->stack.back()].end = now;
+   buffer->stack.pop_back();
+}
+
+void Profiler::nvgCallback (void *, const char * name, int begin)
+{
+   if (begin)
+      beginZone (name);
+   else
+      endZone();
+}
+
+int Profiler::findZone (int parent, const char * name)
+{
+   for (size_t i = parent + 1; i < mZones.size(); ++i)
+   {
+      const ZoneStats & z = mZones[i];
+      if (z.parent == parent && (z.name == name || std::strcmp (z.name, name) == 0))
+         return (int)i;
+   }
+   ZoneStats z;
+   std::memset (&z, 0, sizeof (z));
+   z.name = name;
+   z.parent = parent;
+   z.depth = parent >= 0 ? mZones[parent].depth + 1 : 0;
+   mZones.push_back (z);
+   return (int)mZones.size() - 1;
+}
+
+void Profiler::drain (ThreadBuffer * buffer)
+{
+   std::lock_guard<std::mutex> lock (buffer->mutex);
+   std::vector<Event> & events = buffer->events;
+   mEventZones.resize (events.size());
+   for (size_t i = 0; i < events.size(); ++i)
+   {
+      const Event & e = events[i];
+      int zone = findZone (e.parent >= 0 ? mEventZones[e.parent] : -1, e.name);
+      mEventZones[i] = zone;
+      if (e.end == Clock::time_point())
+         continue;
+      mZones[zone].frameTime += std::chrono::duration<double> (e.end - e.start).count();
+      mZones[zone].frameCalls++;
+      TRACE_ZONE (e.name, buffer->track,
+                  std::chrono::duration_cast<std::chrono::nanoseconds> (e.start.time_since_epoch()).count(),
+                  std::chrono::duration_cast<std::chrono::nanoseconds> (e.end.time_since_epoch()).count());
+   }
+   /* Keep the zones that are still open, they are accounted in the frame they close in */
+   std::vector<Event> open;
+   for (size_t i = 0; i < buffer->stack.size(); ++i)
+   {
+      Event e = events[buffer->stack[i]];
+      e.parent = i > 0 ? (int)i - 1 : -1;
+      open.push_back (e);
+      buffer->stack[i] = (int)i;
+   }
+   events.swap (open);
+}
+
+void Profiler::updateStats (ZoneStats & zone)
+{
+   zone.calls = zone.frameCalls;
+   zone.last = zone.frameTime;
+   zone.history[zone.head] = zone.frameTime;
+   zone.head = (zone.head + 1) % HistoryCount;
+   zone.count = std::min (zone.count + 1, HistoryCount);
+   zone.frameTime = 0.0;
+   zone.frameCalls = 0;
+   double sorted[HistoryCount];
+   std::copy (zone.history, zone.history + zone.count, sorted);
+   std::sort (sorted, sorted + zone.count);
+   double sum = 0.0;
+   for (int i = 0; i < zone.count; ++i)
+      sum += sorted[i];
+   zone.min = sorted[0];
+   zone.avg = sum / zone.count;
+   zone.p99 = sorted[(zone.count - 1) * 99 / 100];
+}
+
+void Profiler::endFrame()
+{
+   bool wasEnabled = enabled();
+   if (wasEnabled)
+   {
+      std::lock_guard<std::mutex> lock (mBuffersMutex);
+      for (auto buffer : mBuffers)
+         drain (buffer);
+      for (auto & zone : mZones)
+      {
+         if (zone.frameCalls > 0)
+            updateStats (zone);
+         else
+            zone.calls = 0;
+      }
+   }
+   if (mRequestEnabled != wasEnabled)
+   {
+      std::lock_guard<std::mutex> lock (mBuffersMutex);
+      for (auto buffer : mBuffers)
+      {
+         std::lock_guard<std::mutex> bufferLock (buffer->mutex);
+         buffer->events.clear();
+         buffer->stack.clear();
+      }
+      mEnabled.store (mRequestEnabled, std::memory_order_relaxed);
+   }
+   mFrameIndex++;
+}
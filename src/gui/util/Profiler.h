@@ -0,0 +1,114 @@
+// Hierarchical CPU frame profiler
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Collects nested zones per thread and folds them into a tree of per frame statistics.
+// Zone names must outlive the profiler, string literals are the usual choice.
+class Profiler
+{
+   public:
+      typedef std::chrono::steady_clock Clock;
+
+      static const int HistoryCount = 120;
+
+      struct ZoneStats
+      {
+         const char * name;
+         int depth;
+         int parent;				// index into zones(), -1 for top level zones
+         int calls;				// calls in the last frame
+         double last;				// seconds in the last frame the zone ran
+         double min, avg, p99;	// over the history
+         double history[HistoryCount];
+         int head, count;
+         double frameTime;		// accumulated while the frame is open
+         int frameCalls;
+      };
+
+      static Profiler & instance();
+
+      /// Enabling and disabling takes effect at the next frame boundary
+      void setEnabled (bool enabled)
+      {
+         mRequestEnabled = enabled;
+      }
+      bool enabled() const
+      {
+         return mEnabled.load (std::memory_order_relaxed);
+      }
+
+      /// Closes the current frame and folds every thread's finished zones into the statistics
+      void endFrame();
+
+      /// All zones seen so far, a parent always precedes its children
+      const std::vector<ZoneStats> & zones() const
+      {
+         return mZones;
+      }
+      /// Number of frames closed so far
+      int frameIndex() const
+      {
+         return mFrameIndex;
+      }
+
+      static void beginZone (const char * name);
+      static void endZone();
+
+      /// Adapter for nvgSetProfileCallback()
+      static void nvgCallback (void * userPtr, const char * name, int begin);
+
+   private:
+      struct Event
+      {
+         const char * name;
+         int parent;
+         Clock::time_point start, end;
+      };
+
+      struct ThreadBuffer
+      {
+         std::mutex mutex;		// only contended while endFrame() drains the buffer
+         std::vector<Event> events;
+         std::vector<int> stack;
+         int track;				// of the trace export, the index in mBuffers
+      };
+
+      Profiler() = default;
+
+      static ThreadBuffer * threadBuffer();
+      void drain (ThreadBuffer * buffer);
+      int findZone (int parent, const char * name);
+      void updateStats (ZoneStats & zone);
+
+      std::atomic<bool> mEnabled { false };
+      bool mRequestEnabled = false;
+      std::mutex mBuffersMutex;
+      std::vector<ThreadBuffer *> mBuffers;
+      std::vector<ZoneStats> mZones;
+      std::vector<int> mEventZones;
+      int mFrameIndex = 0;
+};
+
+/// Times the enclosing scope as a profiler zone
+struct ProfileZone
+{
+   ProfileZone (const char * name)
+   {
+      Profiler::beginZone (name);
+   }
+   ~ProfileZone()
+   {
+      Profiler::endZone();
+   }
+};
+
+#define PROFILE_ZONE_CAT2(a, b) a##b
+#define PROFILE_ZONE_CAT(a, b) PROFILE_ZONE_CAT2 (a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CAT (profileZone, __LINE__) (name)
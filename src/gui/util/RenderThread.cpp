@@ -0,0 +1,482 @@
+// Submits NanoVG frames to the GPU on a dedicated thread
+// Copyright (c) 2015, HurleyWorks
+
+#include "RenderThread.h"
+#include <cstring>
+#include <stdexcept>
+
+RenderThread::RenderThread (const Callbacks & callbacks)
+   : mCallbacks (callbacks)
+{
+   mSpare[0] = nullptr;
+   mSpare[1] = nullptr;
+   std::memset (&mParams, 0, sizeof (mParams));
+   std::memset (&mStats, 0, sizeof (mStats));
+   mThread = std::thread (&RenderThread::run, this);
+   {
+      std::unique_lock<std::mutex> lock (mMutex);
+      mWake.wait (lock, [this] { return mStarted; });
+   }
+   if (mTarget == nullptr)
+   {
+      mThread.join();
+      throw std::runtime_error ("RenderThread: could not create the NanoVG back-end");
+   }
+
+   /* The UI context tessellates like the back-end would and records what reaches it */
+   NVGparams params;
+   std::memset (&params, 0, sizeof (params));
+   params.userPtr = this;
+   params.edgeAntiAlias = mParams.edgeAntiAlias;
+   params.triangleFills = mParams.triangleFills;
+   params.distanceFieldText = mParams.distanceFieldText;
+   params.renderCreate = renderCreate;
+   params.renderCreateTexture = renderCreateTexture;
+   params.renderDeleteTexture = renderDeleteTexture;
+   params.renderUpdateTexture = renderUpdateTexture;
+   params.renderGetTextureSize = renderGetTextureSize;
+   params.renderViewport = renderViewport;
+   params.renderCancel = renderCancel;
+   params.renderFlush = renderFlush;
+   params.renderFill = renderFill;
+   params.renderStroke = renderStroke;
+   params.renderTriangles = renderTriangles;
+   params.renderDelete = renderDelete;
+   if (mParams.renderShape)
+      params.renderShape = renderShape;
+   if (mParams.renderStats)
+      params.renderStats = renderStats;
+   if (mParams.renderCreatePlot)
+   {
+      params.renderCreatePlot = renderCreatePlot;
+      params.renderDeletePlot = renderDeletePlot;
+      params.renderAppendPlot = renderAppendPlot;
+      params.renderClearPlot = renderClearPlot;
+      params.renderPlot = renderPlot;
+   }
+   mBuilding = freeFrame();
+   mContext = nvgCreateInternal (&params);
+   if (mContext == nullptr)
+   {
+      {
+         std::lock_guard<std::mutex> lock (mMutex);
+         mStop = true;
+      }
+      mWake.notify_one();
+      mThread.join();
+      throw std::runtime_error ("RenderThread: could not create the NanoVG context");
+   }
+}
+
+RenderThread::~RenderThread()
+{
+   nvgDeleteInternal (mContext);
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mStop = true;
+   }
+   mWake.notify_one();
+   mThread.join();
+}
+
+void RenderThread::run()
+{
+   if (mCallbacks.makeCurrent)
+      mCallbacks.makeCurrent();
+   NVGcontext * target = mCallbacks.createContext();
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mTarget = target;
+      if (target)
+         mParams = *nvgInternalParams (target);
+      mStarted = true;
+   }
+   mWake.notify_all();
+   if (target == nullptr)
+      return;
+
+   for (;;)
+   {
+      Frame * frame;
+      {
+         std::unique_lock<std::mutex> lock (mMutex);
+         mWake.wait (lock, [this] { return mStop || mReady.load() != nullptr; });
+         if (mStop)
+            break;
+         frame = mReady.exchange (nullptr);
+      }
+      submit (*frame);
+      frame->updates.clear();
+      frame->clearDraws();
+      for (auto & spare : mSpare)
+      {
+         Frame * expected = nullptr;
+         if (spare.compare_exchange_strong (expected, frame))
+            break;
+      }
+      /* Both slots taken, the frame stays in mFrames and is freed with the others */
+   }
+   mCallbacks.deleteContext (mTarget);
+}
+
+int RenderThread::targetImage (int image) const
+{
+   auto it = mImages.find (image);
+   return it == mImages.end() ? 0 : it->second;
+}
+
+void RenderThread::submit (Frame & frame)
+{
+   void * uptr = mParams.userPtr;
+   for (auto & op : frame.updates)
+   {
+      switch (op.type)
+      {
+         case OpType::CreateTexture:
+            mImages[op.id] = mParams.renderCreateTexture (uptr, op.args[0], op.args[1], op.args[2], op.args[3],
+                             op.data.empty() ? nullptr : op.data.data());
+            break;
+         case OpType::DeleteTexture:
+            mParams.renderDeleteTexture (uptr, targetImage (op.id));
+            mImages.erase (op.id);
+            break;
+         case OpType::UpdateTexture:
+         {
+            /* The data holds the updated rows at the full width of the texture, starting at row y */
+            size_t stride = op.data.size() / op.args[3];
+            mParams.renderUpdateTexture (uptr, targetImage (op.id), op.args[0], op.args[1], op.args[2], op.args[3],
+                                         op.data.data() - stride * op.args[1]);
+            break;
+         }
+         case OpType::CreatePlot:
+            mPlots[op.id] = mParams.renderCreatePlot (uptr, op.args[0]);
+            break;
+         case OpType::DeletePlot:
+            mParams.renderDeletePlot (uptr, mPlots[op.id]);
+            mPlots.erase (op.id);
+            break;
+         case OpType::AppendPlot:
+            mParams.renderAppendPlot (uptr, mPlots[op.id], reinterpret_cast<const float *> (op.data.data()),
+                                      (int) (op.data.size() / sizeof (float)));
+            break;
+         case OpType::ClearPlot:
+            mParams.renderClearPlot (uptr, mPlots[op.id]);
+            break;
+         default:
+            break;
+      }
+   }
+   if (frame.width <= 0 || frame.height <= 0)
+      return;
+
+   if (mCallbacks.begin)
+      mCallbacks.begin (frame.width, frame.height);
+   mParams.renderViewport (uptr, frame.width, frame.height, frame.pixelRatio);
+   NVGvertex * verts = frame.verts.data();
+   for (auto & path : frame.paths)
+   {
+      path.fill = path.nfill ? verts + (size_t)path.fill : nullptr;
+      path.stroke = path.nstroke ? verts + (size_t)path.stroke : nullptr;
+   }
+   for (auto & op : frame.draws)
+   {
+      op.paint.image = targetImage (op.paint.image);
+      switch (op.type)
+      {
+         case OpType::Fill:
+            mParams.renderFill (uptr, &op.paint, &op.scissor, op.fringe, op.rect, frame.paths.data() + op.first,
+                                (int)op.count);
+            break;
+         case OpType::Stroke:
+            mParams.renderStroke (uptr, &op.paint, &op.scissor, op.fringe, op.strokeWidth, frame.paths.data() + op.first,
+                                  (int)op.count);
+            break;
+         case OpType::Triangles:
+            mParams.renderTriangles (uptr, &op.paint, &op.scissor, verts + op.first, (int)op.count);
+            break;
+         case OpType::Shape:
+            mParams.renderShape (uptr, &op.paint, &op.scissor, op.fringe, op.rect, verts + op.first, (int)op.count);
+            break;
+         case OpType::Plot:
+            op.plot.plot = mPlots[op.plot.plot];
+            mParams.renderPlot (uptr, &op.scissor, &op.plot);
+            break;
+         default:
+            break;
+      }
+   }
+   mParams.renderFlush (uptr);
+   if (mParams.renderStats)
+   {
+      NVGframeStats stats;
+      std::memset (&stats, 0, sizeof (stats));
+      mParams.renderStats (uptr, &stats);
+      std::lock_guard<std::mutex> lock (mMutex);
+      mStats = stats;
+   }
+   if (mCallbacks.present)
+      mCallbacks.present();
+}
+
+RenderThread::Frame * RenderThread::freeFrame()
+{
+   for (auto & spare : mSpare)
+   {
+      Frame * frame = spare.exchange (nullptr);
+      if (frame)
+         return frame;
+   }
+   mFrames.emplace_back (new Frame());
+   return mFrames.back().get();
+}
+
+void RenderThread::publish()
+{
+   Frame * next;
+   Frame * stale = mReady.exchange (nullptr);
+   if (stale)
+   {
+      /* Not taken yet: drop its drawing, but apply its updates before the ones of the new frame */
+      mDropped++;
+      stale->updates.insert (stale->updates.end(), std::make_move_iterator (mBuilding->updates.begin()),
+                             std::make_move_iterator (mBuilding->updates.end()));
+      mBuilding->updates.swap (stale->updates);
+      stale->updates.clear();
+      stale->clearDraws();
+      next = stale;
+   }
+   else
+      next = freeFrame();
+   {
+      /* Held only while the render thread checks for work, never while it submits */
+      std::lock_guard<std::mutex> lock (mMutex);
+      mReady.store (mBuilding);
+   }
+   mWake.notify_one();
+   mBuilding = next;
+}
+
+size_t RenderThread::copyPaths (const NVGpath * paths, int npaths)
+{
+   Frame & frame = *mBuilding;
+   size_t first = frame.paths.size();
+   for (int i = 0; i < npaths; ++i)
+   {
+      NVGpath path = paths[i];
+      size_t fill = frame.verts.size();
+      frame.verts.insert (frame.verts.end(), paths[i].fill, paths[i].fill + paths[i].nfill);
+      size_t stroke = frame.verts.size();
+      frame.verts.insert (frame.verts.end(), paths[i].stroke, paths[i].stroke + paths[i].nstroke);
+      /* Offsets until submit(), the vertex array may still grow */
+      path.fill = reinterpret_cast<NVGvertex *> (fill);
+      path.stroke = reinterpret_cast<NVGvertex *> (stroke);
+      frame.paths.push_back (path);
+   }
+   return first;
+}
+
+int RenderThread::renderCreate (void *)
+{
+   return 1;
+}
+
+int RenderThread::renderCreateTexture (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::CreateTexture;
+   int id = op.id = self->mNextImage++;
+   op.args[0] = type;
+   op.args[1] = w;
+   op.args[2] = h;
+   op.args[3] = imageFlags;
+   if (data)
+      op.data.assign (data, data + (size_t)w * h * (type == NVG_TEXTURE_RGBA ? 4 : 1));
+   self->mBuilding->updates.push_back (std::move (op));
+   self->mTextures[id] = Texture { type, w, h };
+   return id;
+}
+
+int RenderThread::renderDeleteTexture (void * uptr, int image)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   if (self->mTextures.erase (image) == 0)
+      return 0;
+   Op op;
+   op.type = OpType::DeleteTexture;
+   op.id = image;
+   self->mBuilding->updates.push_back (std::move (op));
+   return 1;
+}
+
+int RenderThread::renderUpdateTexture (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   auto it = self->mTextures.find (image);
+   if (it == self->mTextures.end() || w <= 0 || h <= 0)
+      return it != self->mTextures.end();
+   size_t stride = (size_t)it->second.width * (it->second.type == NVG_TEXTURE_RGBA ? 4 : 1);
+   Op op;
+   op.type = OpType::UpdateTexture;
+   op.id = image;
+   op.args[0] = x;
+   op.args[1] = y;
+   op.args[2] = w;
+   op.args[3] = h;
+   op.data.assign (data + stride * y, data + stride * (y + h));
+   self->mBuilding->updates.push_back (std::move (op));
+   return 1;
+}
+
+int RenderThread::renderGetTextureSize (void * uptr, int image, int * w, int * h)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   auto it = self->mTextures.find (image);
+   if (it == self->mTextures.end())
+      return 0;
+   *w = it->second.width;
+   *h = it->second.height;
+   return 1;
+}
+
+void RenderThread::renderViewport (void * uptr, int width, int height, float devicePixelRatio)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   self->mBuilding->width = width;
+   self->mBuilding->height = height;
+   self->mBuilding->pixelRatio = devicePixelRatio;
+}
+
+void RenderThread::renderCancel (void * uptr)
+{
+   /* Updates already happened as far as the UI context is concerned, keep them */
+   static_cast<RenderThread *> (uptr)->mBuilding->clearDraws();
+}
+
+void RenderThread::renderFlush (void * uptr)
+{
+   static_cast<RenderThread *> (uptr)->publish();
+}
+
+void RenderThread::renderFill (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, const float * bounds,
+                               const NVGpath * paths, int npaths)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::Fill;
+   op.paint = *paint;
+   op.scissor = *scissor;
+   op.fringe = fringe;
+   std::memcpy (op.rect, bounds, sizeof (op.rect));
+   op.first = self->copyPaths (paths, npaths);
+   op.count = npaths;
+   self->mBuilding->draws.push_back (std::move (op));
+}
+
+void RenderThread::renderStroke (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, float strokeWidth,
+                                 const NVGpath * paths, int npaths)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::Stroke;
+   op.paint = *paint;
+   op.scissor = *scissor;
+   op.fringe = fringe;
+   op.strokeWidth = strokeWidth;
+   op.first = self->copyPaths (paths, npaths);
+   op.count = npaths;
+   self->mBuilding->draws.push_back (std::move (op));
+}
+
+void RenderThread::renderTriangles (void * uptr, NVGpaint * paint, NVGscissor * scissor, const NVGvertex * verts, int nverts)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Frame & frame = *self->mBuilding;
+   Op op;
+   op.type = OpType::Triangles;
+   op.paint = *paint;
+   op.scissor = *scissor;
+   op.first = frame.verts.size();
+   op.count = nverts;
+   frame.verts.insert (frame.verts.end(), verts, verts + nverts);
+   frame.draws.push_back (std::move (op));
+}
+
+void RenderThread::renderShape (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, const float * shape,
+                                const NVGvertex * verts, int nverts)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Frame & frame = *self->mBuilding;
+   Op op;
+   op.type = OpType::Shape;
+   op.paint = *paint;
+   op.scissor = *scissor;
+   op.fringe = fringe;
+   std::memcpy (op.rect, shape, sizeof (op.rect));
+   op.first = frame.verts.size();
+   op.count = nverts;
+   frame.verts.insert (frame.verts.end(), verts, verts + nverts);
+   frame.draws.push_back (std::move (op));
+}
+
+void RenderThread::renderDelete (void *)
+{
+   /* The back-end is deleted on the render thread when it stops */
+}
+
+void RenderThread::renderStats (void * uptr, NVGframeStats * stats)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   std::lock_guard<std::mutex> lock (self->mMutex);
+   *stats = self->mStats;
+}
+
+int RenderThread::renderCreatePlot (void * uptr, int capacity)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::CreatePlot;
+   int id = op.id = self->mNextPlot++;
+   op.args[0] = capacity;
+   self->mBuilding->updates.push_back (std::move (op));
+   return id;
+}
+
+void RenderThread::renderDeletePlot (void * uptr, int plot)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::DeletePlot;
+   op.id = plot;
+   self->mBuilding->updates.push_back (std::move (op));
+}
+
+void RenderThread::renderAppendPlot (void * uptr, int plot, const float * samples, int n)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::AppendPlot;
+   op.id = plot;
+   const unsigned char * bytes = reinterpret_cast<const unsigned char *> (samples);
+   op.data.assign (bytes, bytes + sizeof (float) * n);
+   self->mBuilding->updates.push_back (std::move (op));
+}
+
+void RenderThread::renderClearPlot (void * uptr, int plot)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::ClearPlot;
+   op.id = plot;
+   self->mBuilding->updates.push_back (std::move (op));
+}
+
+void RenderThread::renderPlot (void * uptr, NVGscissor * scissor, const NVGplotDraw * draw)
+{
+   RenderThread * self = static_cast<RenderThread *> (uptr);
+   Op op;
+   op.type = OpType::Plot;
+   op.scissor = *scissor;
+   op.plot = *draw;
+   self->mBuilding->draws.push_back (std::move (op));
+}
@@ -0,0 +1,160 @@
+// Submits NanoVG frames to the GPU on a dedicated thread
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include "../nanovg/nanovg.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Splits a NanoVG context in two. The UI thread draws with context(): paths are flattened,
+// expanded and shaped there as usual, and a flush records the resulting vertices and calls into a
+// frame instead of issuing GL. The render thread owns the GL context and a real back-end, and
+// submits the latest frame the UI thread handed over. The handoff is an atomic pointer swap, so
+// nvgEndFrame() never waits for the GPU. A frame the render thread had no time for is dropped in
+// favour of the next one, but its texture and plot updates are carried over in order.
+//
+// The GL specific calls (nvgl*, nvglu*) are not available on context(); images are created and
+// updated through the regular NanoVG calls. Frame statistics report the back-end counters of the
+// last frame the render thread submitted.
+class RenderThread
+{
+   public:
+      // Make the GL context current on the render thread, create and delete the back-end context
+      // there, and present a submitted frame (e.g. swap buffers). begin prepares the framebuffer
+      // of a frame of the given size, e.g. binds and clears it; it may be empty
+      struct Callbacks
+      {
+         std::function<void()> makeCurrent;
+         std::function<NVGcontext * ()> createContext;
+         std::function<void (NVGcontext *)> deleteContext;
+         std::function<void (int width, int height)> begin;
+         std::function<void()> present;
+      };
+
+      /// Starts the render thread and waits until it created the back-end, throws if that failed
+      explicit RenderThread (const Callbacks & callbacks);
+      ~RenderThread();
+
+      RenderThread (const RenderThread &) = delete;
+      RenderThread & operator= (const RenderThread &) = delete;
+
+      /// The context the UI thread draws with
+      NVGcontext * context() const
+      {
+         return mContext;
+      }
+
+      /// Number of frames handed over that were replaced by a newer one before being submitted
+      unsigned droppedFrames() const
+      {
+         return mDropped;
+      }
+
+   private:
+      enum class OpType
+      {
+         CreateTexture, DeleteTexture, UpdateTexture, CreatePlot, DeletePlot, AppendPlot, ClearPlot,
+         Fill, Stroke, Triangles, Shape, Plot
+      };
+
+      // A texture or plot update, or a draw call of a frame. Draw calls keep their paths and
+      // vertices in the arrays of the frame, updates own their data
+      struct Op
+      {
+         OpType type;
+         int id = 0;	// image or plot of the UI context
+         int args[5] = { 0, 0, 0, 0, 0 };
+         NVGpaint paint = NVGpaint();
+         NVGscissor scissor = NVGscissor();
+         float fringe = 0.0f, strokeWidth = 0.0f;
+         float rect[4] = { 0.0f, 0.0f, 0.0f, 0.0f };	// fill bounds or shape
+         size_t first = 0, count = 0;	// paths of fills and strokes, vertices otherwise
+         NVGplotDraw plot = NVGplotDraw();
+         std::vector<unsigned char> data;
+      };
+
+      struct Frame
+      {
+         std::vector<Op> updates;
+         std::vector<Op> draws;
+         std::vector<NVGpath> paths;	// fill and stroke hold offsets into verts until submitted
+         std::vector<NVGvertex> verts;
+         int width = 0, height = 0;
+         float pixelRatio = 1;
+
+         void clearDraws()
+         {
+            draws.clear();
+            paths.clear();
+            verts.clear();
+         }
+      };
+
+      struct Texture
+      {
+         int type, width, height;
+      };
+
+      void run();
+      void submit (Frame & frame);
+      void publish();
+      Frame * freeFrame();
+      size_t copyPaths (const NVGpath * paths, int npaths);
+      int targetImage (int image) const;
+
+      /* Back-end callbacks of the UI context, called on the UI thread */
+      static int renderCreate (void * uptr);
+      static int renderCreateTexture (void * uptr, int type, int w, int h, int imageFlags, const unsigned char * data);
+      static int renderDeleteTexture (void * uptr, int image);
+      static int renderUpdateTexture (void * uptr, int image, int x, int y, int w, int h, const unsigned char * data);
+      static int renderGetTextureSize (void * uptr, int image, int * w, int * h);
+      static void renderViewport (void * uptr, int width, int height, float devicePixelRatio);
+      static void renderCancel (void * uptr);
+      static void renderFlush (void * uptr);
+      static void renderFill (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, const float * bounds,
+                              const NVGpath * paths, int npaths);
+      static void renderStroke (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, float strokeWidth,
+                                const NVGpath * paths, int npaths);
+      static void renderTriangles (void * uptr, NVGpaint * paint, NVGscissor * scissor, const NVGvertex * verts, int nverts);
+      static void renderShape (void * uptr, NVGpaint * paint, NVGscissor * scissor, float fringe, const float * shape,
+                               const NVGvertex * verts, int nverts);
+      static void renderDelete (void * uptr);
+      static void renderStats (void * uptr, NVGframeStats * stats);
+      static int renderCreatePlot (void * uptr, int capacity);
+      static void renderDeletePlot (void * uptr, int plot);
+      static void renderAppendPlot (void * uptr, int plot, const float * samples, int n);
+      static void renderClearPlot (void * uptr, int plot);
+      static void renderPlot (void * uptr, NVGscissor * scissor, const NVGplotDraw * draw);
+
+      Callbacks mCallbacks;
+      NVGcontext * mContext = nullptr;
+
+      // UI thread
+      std::vector<std::unique_ptr<Frame>> mFrames;	// every frame, owned here
+      Frame * mBuilding = nullptr;
+      std::unordered_map<int, Texture> mTextures;
+      int mNextImage = 1, mNextPlot = 1;
+
+      // Handoff: the UI thread publishes to mReady, the render thread returns submitted frames to mSpare
+      std::atomic<Frame *> mReady { nullptr };
+      std::atomic<Frame *> mSpare[2];
+      std::atomic<unsigned> mDropped { 0 };
+
+      // Render thread
+      std::thread mThread;
+      std::mutex mMutex;
+      std::condition_variable mWake;
+      bool mStop = false;
+      bool mStarted = false;
+      NVGcontext * mTarget = nullptr;
+      NVGparams mParams;	// of mTarget
+      std::unordered_map<int, int> mImages, mPlots;	// UI ids to back-end ids
+      NVGframeStats mStats;	// guarded by mMutex
+};
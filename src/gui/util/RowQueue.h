@@ -0,0 +1,97 @@
+// Lock-free queue of fixed size rows from one producer thread to the GUI thread
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Single producer, single consumer ring of rows of rowBytes bytes, such as the color mapped spectra
+// of a waterfall. Works like SampleQueue, a row at a time: the producer writes a row straight into
+// its slot, never blocks and never allocates, rows that do not fit are dropped and counted, and the
+// consumer copies rows out on the GUI thread without taking a lock.
+class RowQueue
+{
+   public:
+      /// \c capacity, in rows, is rounded up to a power of two
+      RowQueue (size_t rowBytes, size_t capacity = 64)
+         : mRowBytes (rowBytes)
+      {
+         size_t n = 2;
+         while (n < capacity)
+            n <<= 1;
+         mData.resize (n * rowBytes);
+         mMask = n - 1;
+      }
+
+      RowQueue (const RowQueue &) = delete;
+      RowQueue & operator= (const RowQueue &) = delete;
+
+      /// Producer side, calls fill (row) to write the next row in place, returns false when the queue
+      /// is full and the row was dropped
+      template <typename Fill> bool push (const Fill & fill)
+      {
+         size_t head = mHead.load (std::memory_order_relaxed);
+         if (head - mTailCache > mMask)
+         {
+            mTailCache = mTail.load (std::memory_order_acquire);
+            if (head - mTailCache > mMask)
+            {
+               mDropped.fetch_add (1, std::memory_order_relaxed);
+               return false;
+            }
+         }
+         fill (&mData[(head & mMask) * mRowBytes]);
+         mHead.store (head + 1, std::memory_order_release);
+         return true;
+      }
+
+      /// Consumer side, copies the oldest row to \c out, false when there is none
+      bool pop (unsigned char * out)
+      {
+         size_t tail = mTail.load (std::memory_order_relaxed);
+         if (mHeadCache == tail)
+         {
+            mHeadCache = mHead.load (std::memory_order_acquire);
+            if (mHeadCache == tail)
+               return false;
+         }
+         memcpy (out, &mData[(tail & mMask) * mRowBytes], mRowBytes);
+         mTail.store (tail + 1, std::memory_order_release);
+         return true;
+      }
+
+      size_t rowBytes() const
+      {
+         return mRowBytes;
+      }
+      /// Return the number of rows the queue holds
+      size_t capacity() const
+      {
+         return mMask + 1;
+      }
+      /// Rows the producer dropped because the queue was full
+      uint64_t dropped() const
+      {
+         return mDropped.load (std::memory_order_relaxed);
+      }
+
+   private:
+      std::vector<unsigned char> mData;
+      size_t mRowBytes;
+      size_t mMask;
+      std::atomic<uint64_t> mDropped { 0 };
+      // The two sides are padded a cache line apart, new does not honour alignas before C++17.
+      char mPadding0[64];
+      // Producer side
+      std::atomic<size_t> mHead { 0 };
+      size_t mTailCache = 0;
+      char mPadding1[64 - sizeof (std::atomic<size_t>) - sizeof (size_t)];
+      // Consumer side
+      std::atomic<size_t> mTail { 0 };
+      size_t mHeadCache = 0;
+      char mPadding2[64 - sizeof (std::atomic<size_t>) - sizeof (size_t)];
+};
@@ -0,0 +1,97 @@
+// Lock-free queue of samples from one producer thread to the GUI thread
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Single producer, single consumer ring of float samples. The producer, e.g. an audio or network
+// thread, never blocks and never allocates: samples that do not fit are dropped and counted. The
+// consumer drains the queue on the GUI thread without taking a lock. Each side keeps a cached copy
+// of the other side's position and only reads the shared one when the cached copy says the ring
+// is full or empty, so the two threads rarely touch the same cache line.
+class SampleQueue
+{
+   public:
+      /// \c capacity is rounded up to a power of two
+      explicit SampleQueue (size_t capacity = 1 << 14)
+      {
+         size_t n = 2;
+         while (n < capacity)
+            n <<= 1;
+         mData.resize (n);
+         mMask = n - 1;
+      }
+
+      SampleQueue (const SampleQueue &) = delete;
+      SampleQueue & operator= (const SampleQueue &) = delete;
+
+      /// Producer side, returns false when the queue is full and the sample was dropped
+      bool push (float value)
+      {
+         return push (&value, 1) == 1;
+      }
+      /// Producer side, returns the number of samples queued, the rest were dropped
+      size_t push (const float * values, size_t count)
+      {
+         size_t head = mHead.load (std::memory_order_relaxed);
+         size_t room = mData.size() - (head - mTailCache);
+         if (room < count)
+         {
+            mTailCache = mTail.load (std::memory_order_acquire);
+            room = mData.size() - (head - mTailCache);
+         }
+         size_t n = count < room ? count : room;
+         for (size_t i = 0; i < n; ++i)
+            mData[(head + i) & mMask] = values[i];
+         mHead.store (head + n, std::memory_order_release);
+         if (n < count)
+            mDropped.fetch_add (count - n, std::memory_order_relaxed);
+         return n;
+      }
+
+      /// Consumer side, moves up to \c max of the oldest samples to \c out and returns their number
+      size_t pop (float * out, size_t max)
+      {
+         size_t tail = mTail.load (std::memory_order_relaxed);
+         size_t available = mHeadCache - tail;
+         if (available < max)
+         {
+            mHeadCache = mHead.load (std::memory_order_acquire);
+            available = mHeadCache - tail;
+         }
+         size_t n = max < available ? max : available;
+         for (size_t i = 0; i < n; ++i)
+            out[i] = mData[(tail + i) & mMask];
+         mTail.store (tail + n, std::memory_order_release);
+         return n;
+      }
+
+      size_t capacity() const
+      {
+         return mData.size();
+      }
+      /// Samples the producer dropped because the queue was full
+      uint64_t dropped() const
+      {
+         return mDropped.load (std::memory_order_relaxed);
+      }
+
+   private:
+      std::vector<float> mData;
+      size_t mMask;
+      std::atomic<uint64_t> mDropped { 0 };
+      // The two sides are padded a cache line apart, new does not honour alignas before C++17.
+      char mPadding0[64];
+      // Producer side
+      std::atomic<size_t> mHead { 0 };
+      size_t mTailCache = 0;
+      char mPadding1[64 - sizeof (std::atomic<size_t>) - sizeof (size_t)];
+      // Consumer side
+      std::atomic<size_t> mTail { 0 };
+      size_t mHeadCache = 0;
+      char mPadding2[64 - sizeof (std::atomic<size_t>) - sizeof (size_t)];
+};
@@ -0,0 +1,86 @@
+// Timeline of the steps from process start to the first frame
+// Copyright (c) 2015, HurleyWorks
+
+#include "StartupTimeline.h"
+
+namespace
+{
+   /* Taken while static objects are constructed, as close to the program being loaded as portable code gets */
+   const StartupTimeline::Clock::time_point loadTime = StartupTimeline::Clock::now();
+}
+
+StartupTimeline & StartupTimeline::instance()
+{
+   static StartupTimeline timeline;
+   return timeline;
+}
+
+double StartupTimeline::now() const
+{
+   return std::chrono::duration<double> (Clock::now() - loadTime).count();
+}
+
+void StartupTimeline::begin (const char * name)
+{
+   std::lock_guard<std::mutex> lock (mMutex);
+   if (mDone)
+      return;
+   Step step;
+   step.name = name;
+   step.depth = (int)mOpen.size();
+   step.start = now();
+   step.duration = -1;
+   mOpen.push_back ((int)mSteps.size());
+   mSteps.push_back (step);
+}
+
+void StartupTimeline::end()
+{
+   std::lock_guard<std::mutex> lock (mMutex);
+   if (mDone || mOpen.empty())
+      return;
+   Step & step = mSteps[mOpen.back()];
+   mOpen.pop_back();
+   step.duration = now() - step.start;
+   if (step.depth == 0)
+      mLastEnd = step.start + step.duration;
+}
+
+void StartupTimeline::firstFrame (FILE * out)
+{
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      if (mDone)
+         return;
+      /* Steps still open are left out rather than reported with a made up length */
+      Step step;
+      step.name = "first frame";
+      step.depth = 0;
+      step.start = mLastEnd;
+      step.duration = now() - mLastEnd;
+      mSteps.push_back (step);
+      mDone = true;
+   }
+   if (out)
+      dump (out);
+}
+
+std::vector<StartupTimeline::Step> StartupTimeline::steps() const
+{
+   std::lock_guard<std::mutex> lock (mMutex);
+   return mSteps;
+}
+
+void StartupTimeline::dump (FILE * out) const
+{
+   std::lock_guard<std::mutex> lock (mMutex);
+   double total = mDone ? mSteps.back().start + mSteps.back().duration : now();
+   fprintf (out, "startup: %.1f ms to the first frame\n", total * 1000.0);
+   for (const Step & step : mSteps)
+   {
+      if (step.duration < 0)
+         continue;
+      fprintf (out, "  %8.1f ms %8.1f ms  %*s%s\n", step.start * 1000.0, step.duration * 1000.0, step.depth * 2, "",
+               step.name);
+   }
+}
@@ -0,0 +1,71 @@
+// Timeline of the steps from process start to the first frame
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Records how long each startup step took, from the moment the program was loaded until the first
+// frame was presented, and prints the timeline once that frame is done. Steps nest: a step begun
+// while another is open is listed below it, indented. Step names must outlive the timeline, string
+// literals are the usual choice. Once the first frame is done further steps are ignored.
+class StartupTimeline
+{
+   public:
+      typedef std::chrono::steady_clock Clock;
+
+      struct Step
+      {
+         const char * name;
+         int depth;
+         double start;		// seconds since the program was loaded
+         double duration;		// -1 while the step is open
+      };
+
+      static StartupTimeline & instance();
+
+      void begin (const char * name);
+      void end();
+
+      /// Closes the timeline with a "first frame" step running from the previous top level step to
+      /// now, and prints it to \c out unless that is null. Later calls do nothing.
+      void firstFrame (FILE * out = stdout);
+      bool done() const
+      {
+         return mDone;
+      }
+
+      std::vector<Step> steps() const;
+      void dump (FILE * out) const;
+
+   private:
+      StartupTimeline() = default;
+
+      double now() const;
+
+      mutable std::mutex mMutex;
+      std::vector<Step> mSteps;
+      std::vector<int> mOpen;	// indices of the open steps, innermost last
+      double mLastEnd = 0;		// end of the last top level step
+      bool mDone = false;
+};
+
+/// Times the enclosing scope as a startup step
+struct StartupStep
+{
+   StartupStep (const char * name)
+   {
+      StartupTimeline::instance().begin (name);
+   }
+   ~StartupStep()
+   {
+      StartupTimeline::instance().end();
+   }
+};
+
+#define STARTUP_STEP_CAT2(a, b) a##b
+#define STARTUP_STEP_CAT(a, b) STARTUP_STEP_CAT2 (a, b)
+#define STARTUP_STEP(name) StartupStep STARTUP_STEP_CAT (startupStep, __LINE__) (name)
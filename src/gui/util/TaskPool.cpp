@@ -0,0 +1,155 @@
+// Work-stealing thread pool for parallel loops
+// Copyright (c) 2015, HurleyWorks
+
+#include "TaskPool.h"
+#include <algorithm>
+
+static uint64_t packRange (uint32_t begin, uint32_t end)
+{
+   return (uint64_t)end << 32 | begin;
+}
+
+TaskPool::TaskPool (int threads)
+{
+   if (threads <= 0)
+      threads = std::max (1, (int)std::thread::hardware_concurrency() - 1);
+   /* Slot 0 belongs to the thread calling parallelFor() */
+   std::vector<Slot> slots (threads + 1);
+   mSlots.swap (slots);
+   for (int i = 0; i < threads; ++i)
+      mThreads.push_back (std::thread (&TaskPool::workerMain, this, i + 1));
+}
+
+TaskPool::~TaskPool()
+{
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mStop = true;
+   }
+   mWake.notify_all();
+   for (auto & thread : mThreads)
+      thread.join();
+}
+
+void TaskPool::nvgCallback (void * userPtr, Task task, void * data, int count)
+{
+   static_cast<TaskPool *> (userPtr)->parallelFor (task, data, count);
+}
+
+void TaskPool::parallelFor (Task task, void * data, int count)
+{
+   if (count <= 0)
+      return;
+   if (count == 1 || mThreads.empty())
+   {
+      for (int i = 0; i < count; ++i)
+         task (data, i);
+      return;
+   }
+   int n = (int)mSlots.size();
+   for (int i = 0; i < n; ++i)
+      mSlots[i].range.store (packRange ((uint32_t) ((int64_t)count * i / n), (uint32_t) ((int64_t)count * (i + 1) / n)),
+                             std::memory_order_relaxed);
+   {
+      std::lock_guard<std::mutex> lock (mMutex);
+      mTask = task;
+      mData = data;
+      mBusy = (int)mThreads.size();
+      mGeneration++;
+   }
+   mWake.notify_all();
+   run (0);
+   /* Every index has been taken once all participants ran out of work; wait for the last ones to finish */
+   std::unique_lock<std::mutex> lock (mMutex);
+   mDone.wait (lock, [this] { return mBusy == 0; });
+   mTask = nullptr;
+   mData = nullptr;
+}
+
+void TaskPool::workerMain (int slot)
+{
+   uint64_t seen = 0;
+   for (;;)
+   {
+      {
+         std::unique_lock<std::mutex> lock (mMutex);
+         mWake.wait (lock, [&] { return mStop || mGeneration != seen; });
+         if (mStop)
+            return;
+         seen = mGeneration;
+      }
+      run (slot);
+      std::lock_guard<std::mutex> lock (mMutex);
+      if (--mBusy == 0)
+         mDone.notify_one();
+   }
+}
+
+void TaskPool::run (int slot)
+{
+   Task task = mTask;
+   void * data = mData;
+   int index;
+   for (;;)
+   {
+      while (pop (slot, index))
+         task (data, index);
+      if (!steal (slot))
+         return;
+   }
+}
+
+bool TaskPool::pop (int slot, int & index)
+{
+   std::atomic<uint64_t> & range = mSlots[slot].range;
+   uint64_t r = range.load (std::memory_order_acquire);
+   for (;;)
+   {
+      uint32_t begin = (uint32_t)r, end = (uint32_t) (r >> 32);
+      if (begin >= end)
+         return false;
+      if (range.compare_exchange_weak (r, packRange (begin + 1, end), std::memory_order_acq_rel))
+      {
+         index = (int)begin;
+         return true;
+      }
+   }
+}
+
+/* Takes the upper half of the largest remaining range into our own, empty slot. Ranges only ever
+   shrink while a loop runs and indices are never handed out twice, so comparing the packed range
+   is enough to detect a concurrent pop or steal. */
+bool TaskPool::steal (int slot)
+{
+   int n = (int)mSlots.size();
+   for (;;)
+   {
+      int victim = -1;
+      uint32_t largest = 0;
+      for (int i = 0; i < n; ++i)
+      {
+         if (i == slot)
+            continue;
+         uint64_t r = mSlots[i].range.load (std::memory_order_relaxed);
+         uint32_t begin = (uint32_t)r, end = (uint32_t) (r >> 32);
+         if (end > begin && end - begin > largest)
+         {
+            largest = end - begin;
+            victim = i;
+         }
+      }
+      if (victim < 0)
+         return false;
+      std::atomic<uint64_t> & range = mSlots[victim].range;
+      uint64_t r = range.load (std::memory_order_acquire);
+      uint32_t begin = (uint32_t)r, end = (uint32_t) (r >> 32);
+      if (begin >= end)
+         continue;
+      uint32_t mid = begin + (end - begin) / 2;
+      if (range.compare_exchange_strong (r, packRange (begin, mid), std::memory_order_acq_rel))
+      {
+         mSlots[slot].range.store (packRange (mid, end), std::memory_order_release);
+         return true;
+      }
+   }
+}
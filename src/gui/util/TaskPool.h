@@ -0,0 +1,63 @@
+// Work-stealing thread pool for parallel loops
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the iterations of a loop on a fixed set of worker threads and the calling thread. Every
+// participant starts with an equal share of the index range and, once done with it, steals half
+// of the largest remaining share of another participant, so uneven iterations still balance out.
+class TaskPool
+{
+   public:
+      typedef void (*Task) (void * data, int index);
+
+      /// Starts \c threads workers, 0 means one less than the number of hardware threads
+      explicit TaskPool (int threads = 0);
+      ~TaskPool();
+
+      TaskPool (const TaskPool &) = delete;
+      TaskPool & operator= (const TaskPool &) = delete;
+
+      /// Calls task (data, i) for every i in [0, count) and returns once all calls have finished
+      void parallelFor (Task task, void * data, int count);
+
+      /// Number of worker threads, not counting the thread calling parallelFor()
+      int threadCount() const
+      {
+         return (int)mThreads.size();
+      }
+
+      /// Adapter for nvgSetParallelCallback(), \c userPtr is the pool
+      static void nvgCallback (void * userPtr, Task task, void * data, int count);
+
+   private:
+      // Remaining range of a participant, begin in the low and end in the high 32 bits. Padded to
+      // a cache line, std::vector does not honour alignas before C++17.
+      struct Slot
+      {
+         std::atomic<uint64_t> range { 0 };
+         char padding[64 - sizeof (std::atomic<uint64_t>)];
+      };
+
+      void workerMain (int slot);
+      void run (int slot);
+      bool pop (int slot, int & index);
+      bool steal (int slot);
+
+      std::vector<std::thread> mThreads;
+      std::vector<Slot> mSlots;
+      std::mutex mMutex;
+      std::condition_variable mWake, mDone;
+      uint64_t mGeneration = 0;
+      int mBusy = 0;
+      bool mStop = false;
+      Task mTask = nullptr;
+      void * mData = nullptr;
+};
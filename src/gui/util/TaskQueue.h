@@ -0,0 +1,88 @@
+// Lock-free queue of tasks from any thread to the GUI thread
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+// Multiple producer, single consumer list of tasks. Any thread pushes with one atomic exchange and
+// never waits for another one; the GUI thread pops in the order the exchanges happened. The list
+// always holds a stub node the consumer has already taken, so producers and the consumer only meet
+// on the node last pushed. A task pushed while the consumer looks at the end of the list may be
+// missed by that pop and is returned by the next one.
+class TaskQueue
+{
+   public:
+      typedef std::function<void()> Task;
+
+      TaskQueue()
+      {
+         mHead.store (mTail, std::memory_order_relaxed);
+      }
+      ~TaskQueue()
+      {
+         while (mTail)
+         {
+            Node * next = mTail->next.load (std::memory_order_relaxed);
+            delete mTail;
+            mTail = next;
+         }
+      }
+
+      TaskQueue (const TaskQueue &) = delete;
+      TaskQueue & operator= (const TaskQueue &) = delete;
+
+      /// Any thread
+      void push (Task task)
+      {
+         Node * node = new Node;
+         node->task = std::move (task);
+         mSize.fetch_add (1, std::memory_order_relaxed);
+         Node * prev = mHead.exchange (node, std::memory_order_acq_rel);
+         prev->next.store (node, std::memory_order_release);
+      }
+
+      /// Consumer side, moves the oldest task to \c task, returns false when there is none
+      bool pop (Task & task)
+      {
+         Node * next = mTail->next.load (std::memory_order_acquire);
+         if (!next)
+            return false;
+         task = std::move (next->task);
+         next->task = nullptr;
+         delete mTail;
+         mTail = next;
+         mSize.fetch_sub (1, std::memory_order_relaxed);
+         return true;
+      }
+
+      /// Number of tasks pushed and not popped yet, approximate while producers are pushing
+      size_t size() const
+      {
+         return mSize.load (std::memory_order_relaxed);
+      }
+      bool empty() const
+      {
+         return size() == 0;
+      }
+
+   private:
+      struct Node
+      {
+         std::atomic<Node *> next { nullptr };
+         Task task;
+      };
+
+      std::atomic<size_t> mSize { 0 };
+      // The two sides are padded a cache line apart, new does not honour alignas before C++17.
+      char mPadding0[64];
+      // Producer side, the node pushed last
+      std::atomic<Node *> mHead;
+      char mPadding1[64 - sizeof (std::atomic<Node *>)];
+      // Consumer side, the stub before the oldest task
+      Node * mTail = new Node;
+      char mPadding2[64 - sizeof (Node *)];
+};
@@ -0,0 +1,225 @@
+// Persistent store of image thumbnails in a memory mapped file
+// Copyright (c) 2015, HurleyWorks
+
+#include "ThumbnailCache.h"
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* The file starts with a header and the index of all thumbnails, followed by their pixels, each
+   block aligned to 16 bytes. Numbers are stored in native byte order, the version changes with the
+   layout. */
+static const uint32_t CacheMagic = 0x43485447;	// "GTHC"
+static const uint32_t CacheVersion = 1;
+static const size_t HeaderSize = 16;
+static const size_t RecordSize = 40;	// without the path that follows
+
+static size_t align16 (size_t n)
+{
+   return (n + 15) & ~(size_t)15;
+}
+
+ThumbnailCache::ThumbnailCache (const std::string & file)
+   : mFile (file)
+{
+   map();
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+   unmap();
+}
+
+bool ThumbnailCache::stamp (const std::string & path, int64_t & modified, int64_t & size)
+{
+   struct stat info;
+   if (stat (path.c_str(), &info) != 0)
+      return false;
+   modified = (int64_t)info.st_mtime;
+   size = (int64_t)info.st_size;
+   return true;
+}
+
+const unsigned char * ThumbnailCache::find (const std::string & path, int thumbSize, int & width, int & height)
+{
+   int64_t modified, size;
+   if (!stamp (path, modified, size))
+      return nullptr;
+   std::lock_guard<std::mutex> lock (mMutex);
+   auto it = mEntries.find (path);
+   if (it == mEntries.end())
+      return nullptr;
+   const Entry & entry = it->second;
+   if (entry.modified != modified || entry.size != size || entry.thumbSize != thumbSize)
+      return nullptr;
+   width = entry.width;
+   height = entry.height;
+   return entry.pixels;
+}
+
+void ThumbnailCache::insert (const std::string & path, int thumbSize, const unsigned char * pixels, int width, int height)
+{
+   Entry entry;
+   if (!stamp (path, entry.modified, entry.size))
+      return;
+   entry.thumbSize = thumbSize;
+   entry.width = width;
+   entry.height = height;
+   entry.data.assign (pixels, pixels + (size_t)width * height * 4);
+   entry.pixels = entry.data.data();
+   std::lock_guard<std::mutex> lock (mMutex);
+   mEntries[path] = std::move (entry);
+   mDirty = true;
+}
+
+bool ThumbnailCache::dirty()
+{
+   std::lock_guard<std::mutex> lock (mMutex);
+   return mDirty;
+}
+
+bool ThumbnailCache::save()
+{
+   std::lock_guard<std::mutex> lock (mMutex);
+   std::vector<const std::pair<const std::string, Entry> *> entries;
+   size_t offset = HeaderSize;
+   for (const auto & entry : mEntries)
+   {
+      entries.push_back (&entry);
+      offset += RecordSize + entry.first.size();
+   }
+   std::vector<unsigned char> index (align16 (offset), 0);
+   uint32_t header[4] = { CacheMagic, CacheVersion, (uint32_t)entries.size(), 0 };
+   memcpy (index.data(), header, sizeof (header));
+   unsigned char * record = index.data() + HeaderSize;
+   offset = index.size();
+   for (auto entry : entries)
+   {
+      const Entry & e = entry->second;
+      int64_t longs[3] = { e.modified, e.size, (int64_t)offset };
+      int32_t ints[4] = { e.thumbSize, e.width, e.height, (int32_t)entry->first.size() };
+      memcpy (record, longs, sizeof (longs));
+      memcpy (record + sizeof (longs), ints, sizeof (ints));
+      memcpy (record + RecordSize, entry->first.data(), entry->first.size());
+      record += RecordSize + entry->first.size();
+      offset += align16 ((size_t)e.width * e.height * 4);
+   }
+   std::string temp = mFile + ".tmp";
+   FILE * fp = fopen (temp.c_str(), "wb");
+   if (!fp)
+      return false;
+   static const unsigned char padding[16] = { 0 };
+   bool ok = fwrite (index.data(), 1, index.size(), fp) == index.size();
+   for (auto entry : entries)
+   {
+      size_t bytes = (size_t)entry->second.width * entry->second.height * 4;
+      ok = ok && fwrite (entry->second.pixels, 1, bytes, fp) == bytes;
+      ok = ok && fwrite (padding, 1, align16 (bytes) - bytes, fp) == align16 (bytes) - bytes;
+   }
+   ok = fclose (fp) == 0 && ok;
+   if (!ok)
+   {
+      std::remove (temp.c_str());
+      return false;
+   }
+   /* The mapping has to go before the file can be replaced on Windows */
+   unmap();
+   std::remove (mFile.c_str());
+   ok = std::rename (temp.c_str(), mFile.c_str()) == 0;
+   map();
+   mDirty = false;
+   return ok;
+}
+
+/* Maps the file and fills the entries from its index, leaving them empty when any of it is off */
+void ThumbnailCache::map()
+{
+   mEntries.clear();
+#ifdef _WIN32
+   HANDLE file = CreateFileA (mFile.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+   if (file == INVALID_HANDLE_VALUE)
+      return;
+   LARGE_INTEGER size;
+   HANDLE mapping = NULL;
+   if (GetFileSizeEx (file, &size) && size.QuadPart > 0)
+      mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+   CloseHandle (file);
+   if (!mapping)
+      return;
+   /* The view keeps the mapping alive */
+   mMapping = (const unsigned char *)MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+   CloseHandle (mapping);
+   if (!mMapping)
+      return;
+   mMappingSize = (size_t)size.QuadPart;
+#else
+   int fd = open (mFile.c_str(), O_RDONLY);
+   if (fd < 0)
+      return;
+   struct stat info;
+   void * mapping = MAP_FAILED;
+   if (fstat (fd, &info) == 0 && info.st_size > 0)
+      mapping = mmap (nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close (fd);
+   if (mapping == MAP_FAILED)
+      return;
+   mMapping = (const unsigned char *)mapping;
+   mMappingSize = (size_t)info.st_size;
+#endif
+   uint32_t header[4];
+   if (mMappingSize < HeaderSize)
+      return;
+   memcpy (header, mMapping, sizeof (header));
+   if (header[0] != CacheMagic || header[1] != CacheVersion)
+      return;
+   const unsigned char * record = mMapping + HeaderSize, * end = mMapping + mMappingSize;
+   for (uint32_t i = 0; i < header[2]; ++i)
+   {
+      int64_t longs[3];
+      int32_t ints[4];
+      if ((size_t)(end - record) < RecordSize)
+         break;
+      memcpy (longs, record, sizeof (longs));
+      memcpy (ints, record + sizeof (longs), sizeof (ints));
+      size_t pathLength = (size_t)(uint32_t)ints[3];
+      size_t bytes = (size_t)(uint32_t)ints[1] * (uint32_t)ints[2] * 4;
+      if ((size_t)(end - record) - RecordSize < pathLength || longs[2] < 0 ||
+            (uint64_t)longs[2] > mMappingSize || mMappingSize - (size_t)longs[2] < bytes)
+         break;
+      Entry & entry = mEntries[std::string ((const char *)record + RecordSize, pathLength)];
+      entry.modified = longs[0];
+      entry.size = longs[1];
+      entry.thumbSize = ints[0];
+      entry.width = ints[1];
+      entry.height = ints[2];
+      entry.pixels = mMapping + longs[2];
+      record += RecordSize + pathLength;
+   }
+   if (mEntries.size() != header[2])
+      mEntries.clear();
+}
+
+void ThumbnailCache::unmap()
+{
+   if (!mMapping)
+      return;
+#ifdef _WIN32
+   UnmapViewOfFile (mMapping);
+#else
+   munmap ((void *)mMapping, mMappingSize);
+#endif
+   mMapping = nullptr;
+   mMappingSize = 0;
+}
@@ -0,0 +1,57 @@
+// Persistent store of image thumbnails in a memory mapped file
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Keeps RGBA thumbnails keyed by the path, modification time and size of their source files. The
+// cache file is mapped read only and the thumbnails found in it point straight into the mapped
+// pages, so an unchanged folder is shown without decoding a single file. find() and insert() may
+// be called from any thread, save() only while no pointer returned by find() is in use.
+class ThumbnailCache
+{
+   public:
+      /// Maps \c file if it holds a valid cache, otherwise starts empty
+      explicit ThumbnailCache (const std::string & file);
+      ~ThumbnailCache();
+
+      ThumbnailCache (const ThumbnailCache &) = delete;
+      ThumbnailCache & operator= (const ThumbnailCache &) = delete;
+
+      /// Returns the pixels of the thumbnail of \c path at \c thumbSize, nullptr when the file changed
+      /// or has none. They stay valid until the next save()
+      const unsigned char * find (const std::string & path, int thumbSize, int & width, int & height);
+      /// Adds a copy of the thumbnail of \c path, kept in memory until the next save()
+      void insert (const std::string & path, int thumbSize, const unsigned char * pixels, int width, int height);
+
+      /// Returns true when thumbnails were inserted since the file was written
+      bool dirty();
+      /// Rewrites the file with all thumbnails and maps it again. Returns true on success
+      bool save();
+
+   private:
+      struct Entry
+      {
+         int64_t modified, size;
+         int thumbSize, width, height;
+         const unsigned char * pixels;	// into the mapping or data
+         std::vector<unsigned char> data;	// for inserted thumbnails
+      };
+
+      static bool stamp (const std::string & path, int64_t & modified, int64_t & size);
+      void map();
+      void unmap();
+
+      std::string mFile;
+      std::mutex mMutex;
+      std::unordered_map<std::string, Entry> mEntries;
+      const unsigned char * mMapping = nullptr;
+      size_t mMappingSize = 0;
+      bool mDirty = false;
+};
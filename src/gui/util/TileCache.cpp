@@ -0,0 +1,92 @@
+// Tiles of an image pyramid loaded on demand
+// Copyright (c) 2015, HurleyWorks
+
+#include "TileCache.h"
+#include "ImageLoader.h"
+#include "../nanovg/nanovg.h"
+#include <algorithm>
+
+TileCache::TileCache (ImageLoader & loader, const std::string & folder, int width, int height, int tileSize, int levels)
+   : mLoader (loader), mFolder (folder), mWidth (width), mHeight (height), mTileSize (std::max (1, tileSize)),
+     mLevels (std::max (1, levels)), mAlive (std::make_shared<bool> (true))
+{
+}
+
+TileCache::~TileCache()
+{
+   /* Tiles still loading are deleted by their callbacks */
+   for (auto & tile : mTiles)
+      if (tile.second.image)
+         nvgDeleteImage (mLoader.context(), tile.second.image);
+}
+
+int TileCache::columns (int level) const
+{
+   int w = std::max (1, mWidth >> level);
+   return (w + mTileSize - 1) / mTileSize;
+}
+
+int TileCache::rows (int level) const
+{
+   int h = std::max (1, mHeight >> level);
+   return (h + mTileSize - 1) / mTileSize;
+}
+
+int TileCache::tile (int level, int column, int row, bool request)
+{
+   uint64_t k = key (level, column, row);
+   auto it = mTiles.find (k);
+   if (it != mTiles.end())
+   {
+      if (it->second.image)
+         mUse.splice (mUse.begin(), mUse, it->second.use);
+      return it->second.image;
+   }
+   if (!request || mLoading >= mMaxLoading || level < 0 || level >= mLevels ||
+         column < 0 || column >= columns (level) || row < 0 || row >= rows (level))
+      return 0;
+   mTiles[k] = Tile { 0, true, mUse.end() };
+   mLoading++;
+   std::weak_ptr<bool> alive = mAlive;
+   NVGcontext * ctx = mLoader.context();
+   std::string path = mFolder + "/" + std::to_string (level) + "/" + std::to_string (column) + "_" + std::to_string (row) + ".png";
+   mLoader.load (path, 0, [this, alive, ctx, k] (int image)
+   {
+      if (alive.expired())
+      {
+         if (image)
+            nvgDeleteImage (ctx, image);
+         return;
+      }
+      arrived (k, image);
+   });
+   return 0;
+}
+
+void TileCache::arrived (uint64_t k, int image)
+{
+   mLoading--;
+   /* A tile that failed stays without image, so that it is not asked for again */
+   if (!image)
+   {
+      mTiles[k].loading = false;
+      return;
+   }
+   mUse.push_front (k);
+   mTiles[k] = Tile { image, false, mUse.begin() };
+   evict();
+   if (mCallback)
+      mCallback();
+}
+
+void TileCache::evict()
+{
+   while ((int)mUse.size() > mMaxTiles)
+   {
+      uint64_t k = mUse.back();
+      mUse.pop_back();
+      auto it = mTiles.find (k);
+      nvgDeleteImage (mLoader.context(), it->second.image);
+      mTiles.erase (it);
+   }
+}
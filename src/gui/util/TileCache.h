@@ -0,0 +1,106 @@
+// Tiles of an image pyramid loaded on demand
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class ImageLoader;
+
+// Keeps the tiles of an image too large for a single texture as images, decoding them on the workers
+// of an ImageLoader when they are first asked for and deleting the least recently used ones beyond a
+// limit. Level 0 is the full image, every further level is half the size of the previous one. All
+// calls are made on the thread that draws with the loader's context.
+class TileCache
+{
+   public:
+      /// Tiles are read from \c folder as <level>/<column>_<row>.png, \c tileSize pixels square except
+      /// at the right and bottom edges of a level
+      TileCache (ImageLoader & loader, const std::string & folder, int width, int height, int tileSize, int levels);
+      ~TileCache();
+
+      TileCache (const TileCache &) = delete;
+      TileCache & operator= (const TileCache &) = delete;
+
+      int width() const
+      {
+         return mWidth;
+      }
+      int height() const
+      {
+         return mHeight;
+      }
+      int tileSize() const
+      {
+         return mTileSize;
+      }
+      int levels() const
+      {
+         return mLevels;
+      }
+      /// Number of columns and rows of tiles of a level
+      int columns (int level) const;
+      int rows (int level) const;
+
+      /// Returns the image of a tile or 0 when it is not resident. With \c request set a missing tile is
+      /// queued for decoding, unless \ref maxLoading() tiles are already on their way
+      int tile (int level, int column, int row, bool request = true);
+
+      /// Set the number of resident tiles beyond which the least recently used ones are deleted
+      void setMaxTiles (int maxTiles)
+      {
+         mMaxTiles = maxTiles;
+         evict();
+      }
+      int maxTiles() const
+      {
+         return mMaxTiles;
+      }
+      /// Set the number of tiles queued on the loader at a time, so that tiles which scrolled out of
+      /// view before they were decoded do not hold up the visible ones for long
+      void setMaxLoading (int maxLoading)
+      {
+         mMaxLoading = maxLoading;
+      }
+      int maxLoading() const
+      {
+         return mMaxLoading;
+      }
+
+      /// Set a function called whenever a tile arrived, e.g. to redraw the view showing it
+      void setCallback (const std::function<void()> & callback)
+      {
+         mCallback = callback;
+      }
+
+   private:
+      struct Tile
+      {
+         int image;	// 0 while loading or when the file could not be decoded
+         bool loading;
+         std::list<uint64_t>::iterator use;	// into mUse once loaded
+      };
+
+      static uint64_t key (int level, int column, int row)
+      {
+         return ((uint64_t)level << 48) | ((uint64_t)(uint32_t)column << 24) | (uint32_t)row;
+      }
+      void arrived (uint64_t key, int image);
+      void evict();
+
+      ImageLoader & mLoader;
+      std::string mFolder;
+      int mWidth, mHeight, mTileSize, mLevels;
+      int mMaxTiles = 256;
+      int mMaxLoading = 16;
+      int mLoading = 0;
+      std::unordered_map<uint64_t, Tile> mTiles;
+      std::list<uint64_t> mUse;	// loaded tiles, most recently used first
+      std::function<void()> mCallback;
+      std::shared_ptr<bool> mAlive;	// lets callbacks of the loader outlive the cache
+};
@@ -0,0 +1,241 @@
+// Hierarchical timer wheel for one-shot and periodic timers
+// Copyright (c) 2015, HurleyWorks
+
+#include "TimerWheel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+   // Offset of the first set bit of mask, counting up from bit from and around
+   int firstFrom (uint64_t mask, int from)
+   {
+      uint64_t rotated = from ? (mask >> from) | (mask << (64 - from)) : mask;
+      int k = 0;
+      while (! (rotated & 1))
+      {
+         rotated >>= 1;
+         ++k;
+      }
+      return k;
+   }
+}
+
+TimerWheel::TimerWheel (double tick)
+   : mTick (tick > 0.0 ? tick : 0.001)
+{
+   for (auto & level : mHeads)
+      std::fill (level, level + Slots, None);
+}
+
+uint64_t TimerWheel::toTicks (double seconds) const
+{
+   return seconds > 0.0 ? (uint64_t) std::ceil (seconds / mTick) : 0;
+}
+
+TimerWheel::TimerId TimerWheel::add (double now, double delay, const Callback & callback, double period)
+{
+   if (!mStarted)
+   {
+      mCurrent = (uint64_t) std::floor (std::max (now, 0.0) / mTick);
+      mStarted = true;
+   }
+   uint32_t index;
+   if (!mFree.empty())
+   {
+      index = mFree.back();
+      mFree.pop_back();
+   }
+   else
+   {
+      index = (uint32_t)mTimers.size();
+      mTimers.emplace_back();
+      mTimers.back().generation = 1;
+   }
+   Timer & timer = mTimers[index];
+   timer.callback = callback;
+   timer.deadline = std::max (toTicks (now + delay), mCurrent);
+   timer.period = period > 0.0 ? std::max (toTicks (period), (uint64_t)1) : 0;
+   insert (index);
+   ++mCount;
+   return ((TimerId)timer.generation << 32) | index;
+}
+
+void TimerWheel::cancel (TimerId id)
+{
+   if (!pending (id))
+      return;
+   uint32_t index = (uint32_t)id;
+   if (mTimers[index].level >= 0)
+      unlink (index);
+   release (index);
+}
+
+bool TimerWheel::pending (TimerId id) const
+{
+   uint32_t index = (uint32_t)id;
+   return index < mTimers.size() && mTimers[index].generation == (uint32_t) (id >> 32);
+}
+
+void TimerWheel::insert (uint32_t index)
+{
+   Timer & timer = mTimers[index];
+   /* The level whose slots are the finest that still reach the deadline, capped at the span of the wheel */
+   uint64_t delta = timer.deadline > mCurrent ? timer.deadline - mCurrent : 0;
+   int level = 0;
+   while (level < Levels - 1 && delta >> (SlotBits * (level + 1)))
+      ++level;
+   uint64_t ticks = std::min (delta, ((uint64_t)1 << (SlotBits * Levels)) - 1);
+   int slot = (int) (((mCurrent + ticks) >> (SlotBits * level)) & (Slots - 1));
+   uint32_t & head = mHeads[level][slot];
+   timer.level = (int16_t)level;
+   timer.slot = (int16_t)slot;
+   timer.prev = None;
+   timer.next = head;
+   if (head != None)
+      mTimers[head].prev = index;
+   head = index;
+   mOccupied[level] |= (uint64_t)1 << slot;
+}
+
+void TimerWheel::unlink (uint32_t index)
+{
+   Timer & timer = mTimers[index];
+   uint32_t & head = mHeads[timer.level][timer.slot];
+   if (timer.prev != None)
+      mTimers[timer.prev].next = timer.next;
+   else
+      head = timer.next;
+   if (timer.next != None)
+      mTimers[timer.next].prev = timer.prev;
+   if (head == None)
+      mOccupied[timer.level] &= ~ ((uint64_t)1 << timer.slot);
+   timer.level = -1;
+}
+
+void TimerWheel::release (uint32_t index)
+{
+   Timer & timer = mTimers[index];
+   timer.callback = nullptr;
+   timer.level = -1;
+   if (++timer.generation == 0)
+      timer.generation = 1;
+   mFree.push_back (index);
+   --mCount;
+}
+
+void TimerWheel::cascade (int level)
+{
+   int slot = (int) ((mCurrent >> (SlotBits * level)) & (Slots - 1));
+   uint32_t index = mHeads[level][slot];
+   mHeads[level][slot] = None;
+   mOccupied[level] &= ~ ((uint64_t)1 << slot);
+   while (index != None)
+   {
+      uint32_t next = mTimers[index].next;
+      insert (index);
+      index = next;
+   }
+}
+
+void TimerWheel::fire (uint64_t tick)
+{
+   /* Taken out of the wheel first, so that the callbacks can add and cancel timers freely */
+   int slot = (int) (tick & (Slots - 1));
+   std::vector<std::pair<uint32_t, uint32_t>> due;	// index and generation
+   for (uint32_t index = mHeads[0][slot]; index != None; index = mTimers[index].next)
+      due.push_back (std::make_pair (index, mTimers[index].generation));
+   mHeads[0][slot] = None;
+   mOccupied[0] &= ~ ((uint64_t)1 << slot);
+   for (auto & entry : due)
+      mTimers[entry.first].level = -1;
+   /* Slots hold their timers in reverse order of insertion */
+   std::reverse (due.begin(), due.end());
+   mCurrent = tick + 1;
+   for (auto & entry : due)
+   {
+      uint32_t index = entry.first;
+      Timer & timer = mTimers[index];
+      if (timer.generation != entry.second)
+         continue;
+      if (timer.deadline > tick)
+      {
+         /* Beyond the span of the wheel when it was added */
+         insert (index);
+         continue;
+      }
+      if (timer.period)
+      {
+         /* A periodic timer that fell behind fires once and skips the periods it missed */
+         timer.deadline += timer.period;
+         if (timer.deadline <= mLast)
+            timer.deadline += ((mLast - timer.deadline) / timer.period + 1) * timer.period;
+         insert (index);
+         Callback callback = timer.callback;
+         callback();
+      }
+      else
+      {
+         Callback callback = std::move (timer.callback);
+         release (index);
+         callback();
+      }
+   }
+}
+
+void TimerWheel::advance (double now)
+{
+   /* A deadline returned by nextDeadline() lands on its tick despite rounding */
+   uint64_t last = (uint64_t) std::floor (std::max (now, 0.0) / mTick + 1e-6);
+   mLast = last;
+   if (!mStarted)
+   {
+      mCurrent = last;
+      mStarted = true;
+   }
+   while (mCurrent <= last)
+   {
+      /* The ticks in between have neither timers to fire nor slots to spread */
+      uint64_t next = nextTick();
+      if (next > last)
+      {
+         mCurrent = last + 1;
+         break;
+      }
+      mCurrent = next;
+      if ((mCurrent & (Slots - 1)) == 0)
+         for (int level = 1; level < Levels; ++level)
+         {
+            cascade (level);
+            if ((mCurrent >> (SlotBits * level)) & (Slots - 1))
+               break;
+         }
+      fire (mCurrent);
+   }
+}
+
+uint64_t TimerWheel::nextTick() const
+{
+   uint64_t next = std::numeric_limits<uint64_t>::max();
+   if (mOccupied[0])
+      next = mCurrent + firstFrom (mOccupied[0], (int) (mCurrent & (Slots - 1)));
+   /* Timers of the upper levels fire no earlier than their slot is spread over the level below */
+   for (int level = 1; level < Levels; ++level)
+   {
+      if (!mOccupied[level])
+         continue;
+      int shift = SlotBits * level;
+      uint64_t start = (mCurrent >> shift) + ((mCurrent & (((uint64_t)1 << shift) - 1)) ? 1 : 0);
+      uint64_t slots = start + firstFrom (mOccupied[level], (int) (start & (Slots - 1)));
+      next = std::min (next, slots << shift);
+   }
+   return next;
+}
+
+double TimerWheel::nextDeadline() const
+{
+   if (mCount == 0)
+      return std::numeric_limits<double>::infinity();
+   return nextTick() * mTick;
+}
@@ -0,0 +1,83 @@
+// Hierarchical timer wheel for one-shot and periodic timers
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Keeps timers in four levels of 64 slots, each slot of a level spanning the whole lower level.
+// Adding and cancelling a timer is O(1), and so is every tick: the timers of the current slot of
+// the first level fire, and once the first level wrapped the next slot of the level above is
+// spread over it. Ticks with neither are skipped, so advancing after a long sleep is cheap. Time
+// is in seconds on the caller's clock and rounded up to whole ticks, so a timer never fires
+// early. Deadlines beyond the span of the wheel, about 4.6 hours with the default tick, wait in
+// the last level and are placed again when it comes around.
+class TimerWheel
+{
+   public:
+      typedef uint64_t TimerId;	// 0 is never a timer
+      typedef std::function<void()> Callback;
+
+      /// \c tick is the resolution in seconds
+      explicit TimerWheel (double tick = 0.001);
+
+      TimerWheel (const TimerWheel &) = delete;
+      TimerWheel & operator= (const TimerWheel &) = delete;
+
+      /// Calls \c callback once \c delay seconds after \c now, then every \c period seconds if it is positive
+      TimerId add (double now, double delay, const Callback & callback, double period = 0.0);
+      /// Removes a timer, ids of timers that fired or were cancelled are ignored
+      void cancel (TimerId id);
+      /// Returns whether the timer is still pending
+      bool pending (TimerId id) const;
+
+      /// Fires the timers due at \c now in the order of their deadlines, callbacks may add and cancel timers
+      void advance (double now);
+
+      /// Returns the time the next timer may fire, never later than it does, infinity without timers
+      double nextDeadline() const;
+      /// Number of pending timers
+      size_t size() const
+      {
+         return mCount;
+      }
+
+   private:
+      static const int Levels = 4;
+      static const int SlotBits = 6;
+      static const int Slots = 1 << SlotBits;
+      static const uint32_t None = 0xffffffffu;
+
+      struct Timer
+      {
+         Callback callback;
+         uint64_t deadline = 0;	// in ticks
+         uint64_t period = 0;	// in ticks, 0 for one-shot timers
+         uint32_t generation = 0;	// bumped whenever the entry is freed
+         uint32_t prev = None, next = None;
+         int16_t level = -1;	// -1 while not in a slot
+         int16_t slot = 0;
+      };
+
+      uint64_t toTicks (double seconds) const;
+      void insert (uint32_t index);
+      void unlink (uint32_t index);
+      void release (uint32_t index);
+      void cascade (int level);
+      void fire (uint64_t tick);
+      /// The next tick that fires timers or spreads a slot, the largest tick when there is none
+      uint64_t nextTick() const;
+
+      double mTick;
+      uint64_t mCurrent = 0;	// the next tick to process
+      uint64_t mLast = 0;	// the last tick of the current advance()
+      bool mStarted = false;
+      std::vector<Timer> mTimers;
+      std::vector<uint32_t> mFree;
+      uint32_t mHeads[Levels][Slots];
+      uint64_t mOccupied[Levels] = { 0, 0, 0, 0 };	// bit per non-empty slot
+      size_t mCount = 0;
+};
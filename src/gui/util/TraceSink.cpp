@@ -0,0 +1,168 @@
+// Chrome trace export for profiler zones, GPU scopes and frame counters
+// Copyright (c) 2015, HurleyWorks
+
+#include "TraceSink.h"
+
+#ifdef NANOGUI_TRACE
+
+#include <chrono>
+
+TraceSink & TraceSink::instance()
+{
+   static TraceSink sink;
+   return sink;
+}
+
+TraceSink::~TraceSink()
+{
+   close();
+}
+
+int64_t TraceSink::now()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool TraceSink::open (const std::string & path, size_t capacity)
+{
+   close();
+   mFile = fopen (path.c_str(), "w");
+   if (!mFile)
+      return false;
+   size_t size = 1;
+   while (size < capacity)
+      size <<= 1;
+   std::vector<Cell> cells (size);
+   mCells.swap (cells);
+   for (size_t i = 0; i < size; ++i)
+      mCells[i].sequence.store (i, std::memory_order_relaxed);
+   mMask = size - 1;
+   mEnqueuePos.store (0, std::memory_order_relaxed);
+   mDequeuePos = 0;
+   mDropped.store (0, std::memory_order_relaxed);
+   mEpoch = now();
+   fprintf (mFile, "{\"traceEvents\":[\n");
+   fprintf (mFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", GpuTrack);
+   mFirst = false;
+   mOpen.store (true, std::memory_order_release);
+   mWriter = std::thread (&TraceSink::run, this);
+   return true;
+}
+
+void TraceSink::close()
+{
+   if (!mOpen.exchange (false))
+      return;
+   /* A producer that saw the sink open may still be writing into the queue, open() replaces it */
+   while (mProducers.load() > 0)
+      std::this_thread::yield();
+   mWriter.join();
+   /* Pick up whatever was pushed while the writer was shutting down */
+   Event e;
+   while (pop (e))
+      write (e);
+   fprintf (mFile, "\n]}\n");
+   fclose (mFile);
+   mFile = nullptr;
+}
+
+void TraceSink::push (const Event & e)
+{
+   /* Counted before mOpen is checked again, so that close() either sees the push or the push sees it closed */
+   mProducers.fetch_add (1);
+   if (mOpen.load())
+      enqueue (e);
+   mProducers.fetch_sub (1, std::memory_order_release);
+}
+
+/* Bounded multi-producer queue: a cell is free for position p when its sequence equals p, and holds
+   the event for p once its sequence is p + 1. */
+void TraceSink::enqueue (const Event & e)
+{
+   size_t pos = mEnqueuePos.load (std::memory_order_relaxed);
+   for (;;)
+   {
+      Cell & cell = mCells[pos & mMask];
+      size_t seq = cell.sequence.load (std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+      if (dif == 0)
+      {
+         if (mEnqueuePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+         {
+            cell.event = e;
+            cell.sequence.store (pos + 1, std::memory_order_release);
+            return;
+         }
+      }
+      else
+         if (dif < 0)
+         {
+            mDropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+         }
+         else
+            pos = mEnqueuePos.load (std::memory_order_relaxed);
+   }
+}
+
+bool TraceSink::pop (Event & e)
+{
+   Cell & cell = mCells[mDequeuePos & mMask];
+   size_t seq = cell.sequence.load (std::memory_order_acquire);
+   if ((intptr_t)seq - (intptr_t) (mDequeuePos + 1) < 0)
+      return false;
+   e = cell.event;
+   cell.sequence.store (mDequeuePos + mMask + 1, std::memory_order_release);
+   mDequeuePos++;
+   return true;
+}
+
+void TraceSink::zone (const char * name, int track, int64_t startNs, int64_t endNs)
+{
+   if (!isOpen())
+      return;
+   Event e = { name, ZoneEvent, track, startNs, endNs - startNs, 0.0 };
+   push (e);
+}
+
+void TraceSink::counter (const char * name, double value, int64_t timeNs)
+{
+   if (!isOpen())
+      return;
+   Event e = { name, CounterEvent, 0, timeNs, 0, value };
+   push (e);
+}
+
+void TraceSink::write (const Event & e)
+{
+   double ts = (e.time - mEpoch) * 1e-3;
+   if (!mFirst)
+      fputs (",\n", mFile);
+   mFirst = false;
+   if (e.type == ZoneEvent)
+      fprintf (mFile, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+               e.name, e.track, ts, e.duration * 1e-3);
+   else
+      fprintf (mFile, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"args\":{\"value\":%g}}",
+               e.name, ts, e.value);
+}
+
+void TraceSink::run()
+{
+   while (mOpen.load (std::memory_order_acquire))
+   {
+      Event e;
+      int n = 0;
+      while (pop (e))
+      {
+         write (e);
+         n++;
+      }
+      if (n > 0)
+         fflush (mFile);
+      else
+         std::this_thread::sleep_for (std::chrono::milliseconds (10));
+   }
+}
+
+#endif
@@ -0,0 +1,102 @@
+// Chrome trace export for profiler zones, GPU scopes and frame counters
+// Copyright (c) 2015, HurleyWorks
+
+#pragma once
+
+// Tracing is compiled in only when NANOGUI_TRACE is defined, otherwise the TRACE_* macros expand to
+// nothing and TraceSink does not exist.
+#ifdef NANOGUI_TRACE
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams events to a Chrome trace JSON file (chrome://tracing, Perfetto). Producers never block
+// and never allocate: events go into a fixed size lock-free queue and are dropped when it is full.
+// A writer thread drains the queue into the file.
+class TraceSink
+{
+   public:
+      /// Track of the GPU scopes, CPU tracks are profiler thread indices
+      static const int GpuTrack = 1000;
+
+      static TraceSink & instance();
+
+      /// Starts streaming to \c path, \c capacity is rounded up to a power of two
+      bool open (const std::string & path, size_t capacity = 1 << 16);
+      /// Drains the remaining events and closes the file
+      void close();
+      bool isOpen() const
+      {
+         return mOpen.load (std::memory_order_acquire);
+      }
+
+      /// Timestamps are std::chrono::steady_clock nanoseconds since its epoch
+      void zone (const char * name, int track, int64_t startNs, int64_t endNs);
+      void counter (const char * name, double value, int64_t timeNs);
+      /// Current time in the sink's time base
+      static int64_t now();
+
+      /// Events lost because the queue was full
+      uint64_t dropped() const
+      {
+         return mDropped.load (std::memory_order_relaxed);
+      }
+
+   private:
+      enum EventType
+      {
+         ZoneEvent,
+         CounterEvent,
+      };
+
+      struct Event
+      {
+         const char * name;
+         int type;
+         int track;
+         int64_t time;
+         int64_t duration;
+         double value;
+      };
+
+      struct Cell
+      {
+         std::atomic<size_t> sequence;
+         Event event;
+      };
+
+      TraceSink() = default;
+      ~TraceSink();
+
+      void push (const Event & e);
+      void enqueue (const Event & e);
+      bool pop (Event & e);
+      void write (const Event & e);
+      void run();
+
+      std::vector<Cell> mCells;
+      size_t mMask = 0;
+      std::atomic<size_t> mEnqueuePos { 0 };
+      size_t mDequeuePos = 0;
+      std::atomic<uint64_t> mDropped { 0 };
+      std::atomic<bool> mOpen { false };
+      std::atomic<int> mProducers { 0 };	// pushes in flight, close() waits for them before the queue goes
+      std::thread mWriter;
+      FILE * mFile = nullptr;
+      bool mFirst = true;
+      int64_t mEpoch = 0;
+};
+
+#define TRACE_ZONE(name, track, startNs, endNs) TraceSink::instance().zone (name, track, startNs, endNs)
+#define TRACE_COUNTER(name, value) TraceSink::instance().counter (name, value, TraceSink::now())
+
+#else
+
+#define TRACE_ZONE(name, track, startNs, endNs)
+#define TRACE_COUNTER(name, value)
+
+#endif